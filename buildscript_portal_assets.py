@@ -0,0 +1,41 @@
+# Gzips the static portal pages in lib/selfPortal/html/src into
+# lib/selfPortal/html/portal_assets.h, served as they are with
+# Content-Encoding: gzip. The header is rewritten only when a page changed.
+import gzip
+import hashlib
+import os
+
+SRC_DIR = 'lib/selfPortal/html/src'
+OUT_H = 'lib/selfPortal/html/portal_assets.h'
+ASSETS = [
+    ('index.html', 'index_html'),
+    ('device.html', 'device_html'),
+    ('editor.html', 'editor_html'),
+]
+
+out = ['#pragma once', '// Generated by buildscript_portal_assets.py from html/src, do not edit', '',
+       '#include <Arduino.h>', '']
+for fname, sym in ASSETS:
+    with open(os.path.join(SRC_DIR, fname), 'rb') as f:
+        raw = f.read()
+    gz = gzip.compress(raw, 9, mtime=0)
+    etag = hashlib.sha1(raw).hexdigest()[:16]
+    out.append('// {}: {} bytes, {} gzipped'.format(fname, len(raw), len(gz)))
+    out.append('#define {}_ETAG "\\"{}\\""'.format(sym.upper(), etag))
+    out.append('const uint8_t {}_gz[] PROGMEM = {{'.format(sym))
+    for i in range(0, len(gz), 16):
+        out.append('    ' + ', '.join('0x{:02X}'.format(b) for b in gz[i:i + 16]) + ',')
+    out.append('};')
+    out.append('')
+text = '\n'.join(out)
+
+old = None
+try:
+    with open(OUT_H) as f:
+        old = f.read()
+except OSError:
+    pass
+if old != text:
+    with open(OUT_H, 'w') as f:
+        f.write(text)
+    print('Portal assets: {} rewritten'.format(OUT_H))
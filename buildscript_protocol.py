@@ -0,0 +1,149 @@
+# Generates the binary message definitions of firmware and game server from
+# one schema, protocol/zgame_messages.json. Runs before every build and by
+# hand (python buildscript_protocol.py) after editing the schema; an output
+# is only rewritten when it changes, so it does not force a rebuild.
+import json
+import os
+import re
+import struct
+
+FILENAME_SCHEMA = 'protocol/zgame_messages.json'
+FILENAME_CPP = 'game/gameEngine/gameProtocol.h'
+FILENAMES_PY = ['servers/SingleGameServer/zgame_protocol.py']
+
+TYPES = {
+    'u8':  ('uint8_t',  'B'),
+    'i8':  ('int8_t',   'b'),
+    'u16': ('uint16_t', 'H'),
+    'i16': ('int16_t',  'h'),
+    'u32': ('uint32_t', 'I'),
+    'i32': ('int32_t',  'i'),
+    'u64': ('uint64_t', 'Q'),
+}
+BANNER = 'Generated by buildscript_protocol.py from ' + FILENAME_SCHEMA + ', do not edit'
+
+
+def snake(name):
+    return re.sub(r'(?<!^)(?=[A-Z])', '_', name).lower()
+
+
+def load_schema():
+    with open(FILENAME_SCHEMA) as f:
+        schema = json.load(f)
+    consts = {c['c']: int(c['value'], 0) for c in schema['constants']}
+    for msg in schema['messages']:
+        msg['latest'] = consts[msg['version']]
+        msg['fields'] = [{'name': f[0], 'type': f[1],
+                          'doc': f[2] if len(f) > 2 else '',
+                          'since': f[3] if len(f) > 3 else 1} for f in msg['fields']]
+        for fld in msg['fields']:
+            if fld['type'] not in TYPES:
+                raise ValueError('{}.{}: unknown type {}'.format(msg['c'], fld['name'], fld['type']))
+        sinces = [fld['since'] for fld in msg['fields']]
+        if sinces != sorted(sinces) or sinces[-1] > msg['latest']:
+            raise ValueError('{}: a newer field must follow the older ones'.format(msg['c']))
+    return schema
+
+
+def versions(msg):
+    """{version: struct format}, an older version is a prefix of the newer"""
+    return {v: '<' + ''.join(TYPES[f['type']][1] for f in msg['fields'] if f['since'] <= v)
+            for v in range(1, msg['latest'] + 1)}
+
+
+def gen_cpp(schema):
+    out = ['#pragma once', '', '// ' + BANNER, '',
+           '#include <stddef.h>', '#include <stdint.h>', '#include <string.h>', '']
+    width = max(len(c['c']) for c in schema['constants']) + 1
+    for c in schema['constants']:
+        line = '#define {} {}'.format(c['c'].ljust(width), c['value'])
+        out.append(line.ljust(40) + '// ' + c['doc'] if c.get('doc') else line)
+    out += ['', '// The target is little endian, so a packed struct is its own wire image and',
+            '// an older version of a message is a prefix of it',
+            'static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "wire format is little endian");',
+            '', 'template <typename T> constexpr size_t protoSize(uint8_t version);']
+    for msg in schema['messages']:
+        out.append('')
+        if msg.get('doc'):
+            out.append('// ' + msg['doc'])
+        out += ['struct __attribute__((packed)) ' + msg['c'], '{']
+        for fld in msg['fields']:
+            line = '    {} {};'.format(TYPES[fld['type']][0].ljust(8), fld['name'])
+            doc = fld['doc']
+            if fld['since'] > 1:
+                doc = (doc + ', ' if doc else '') + 'since version {}'.format(fld['since'])
+            out.append(line.ljust(32) + '// ' + doc if doc else line)
+        out.append('};')
+        sizes = {v: struct.calcsize(f) for v, f in versions(msg).items()}
+        out.append('static_assert(sizeof({}) == {}, "{} layout");'.format(msg['c'], sizes[msg['latest']], msg['c']))
+        expr = str(sizes[1])
+        for v in range(2, msg['latest'] + 1):
+            if sizes[v] != sizes[v - 1]:
+                expr = 'version >= {} ? {} : {}'.format(v, sizes[v], expr)
+        args = 'uint8_t version' if '?' in expr else 'uint8_t'
+        out.append('template <> constexpr size_t protoSize<{}>({}) {{ return {}; }}'.format(msg['c'], args, expr))
+    out += ['',
+            '// Bytes written or read at that version of the message, 0 if size is short.',
+            '// Decoding an older version leaves the newer fields zero.',
+            'template <typename T>',
+            'inline size_t protoEncode(const T &msg, uint8_t *dst, size_t size, uint8_t version)',
+            '{',
+            '    size_t n = protoSize<T>(version);',
+            '    if (n > size)',
+            '    {',
+            '        return 0;',
+            '    }',
+            '    memcpy(dst, &msg, n);',
+            '    return n;',
+            '}',
+            '',
+            'template <typename T>',
+            'inline size_t protoDecode(T &msg, const uint8_t *src, size_t size, uint8_t version)',
+            '{',
+            '    size_t n = protoSize<T>(version);',
+            '    if (n > size)',
+            '    {',
+            '        return 0;',
+            '    }',
+            '    memset(&msg, 0, sizeof(msg));',
+            '    memcpy(&msg, src, n);',
+            '    return n;',
+            '}', '']
+    return '\n'.join(out)
+
+
+def gen_py(schema):
+    out = ['"""' + BANNER + '"""', 'import struct', '']
+    for c in schema['constants']:
+        line = '{} = {}'.format(c['py'], c['value'])
+        out.append(line + '  # ' + c['doc'] if c.get('doc') else line)
+    for msg in schema['messages']:
+        vers = versions(msg)
+        out += ['', '# {}{}'.format(msg['c'], ': ' + msg['doc'] if msg.get('doc') else '')]
+        out.append('{}_FIELDS = ({})'.format(msg['py'], ', '.join("'{}'".format(snake(f['name'])) for f in msg['fields'])))
+        out.append("{}_VERSIONS = {{{}}}".format(msg['py'], ', '.join("{}: struct.Struct('{}')".format(v, f) for v, f in vers.items())))
+        out.append('{0} = {0}_VERSIONS[{1}]'.format(msg['py'], msg['latest']))
+    out += ['', '',
+            'def unpack_fields(fmt, fields, buf, pos=0):',
+            '    """One message as a dict, an older version of it has the first fields only"""',
+            '    return dict(zip(fields, fmt.unpack_from(buf, pos)))', '']
+    return '\n'.join(out)
+
+
+def write_if_changed(path, text):
+    try:
+        with open(path) as f:
+            if f.read() == text:
+                return
+    except OSError:
+        pass
+    with open(path, 'w', newline='\n') as f:
+        f.write(text)
+    print('Protocol: wrote {}'.format(path))
+
+
+schema = load_schema()
+write_if_changed(FILENAME_CPP, gen_cpp(schema))
+for name in FILENAMES_PY:
+    if os.path.isdir(os.path.dirname(name)):
+        write_if_changed(name, gen_py(schema))
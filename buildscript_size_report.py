@@ -0,0 +1,103 @@
+# Firmware size report after every link: image size against the app
+# partition, IRAM/DRAM use, the change since the previous build and the
+# largest symbols, so a table or an image compiled in by mistake shows up in
+# the build log. Over custom_size_budget_pct of the partition it warns, with
+# custom_size_strict = yes it fails the build.
+import json
+import os
+import subprocess
+
+Import('env')
+
+REPORT_FILE = 'size_report.json'
+TOP_SYMBOLS = 12
+APP_SUBTYPES = ('factory', 'ota_0', 'ota_1')
+
+
+def app_partition_size(env):
+    csv = env.GetProjectOption('board_build.partitions', '')
+    path = os.path.join(env.subst('$PROJECT_DIR'), csv) if csv else ''
+    if not os.path.isfile(path):
+        return 0
+    with open(path) as f:
+        for line in f:
+            cols = [c.strip() for c in line.split('#')[0].split(',')]
+            if len(cols) >= 5 and cols[1] == 'app' and cols[2] in APP_SUBTYPES:
+                return int(cols[4], 0)
+    return 0
+
+
+def section_sizes(tool, elf):
+    sizes = {}
+    out = subprocess.run([tool, '-A', elf], capture_output=True, text=True, check=True).stdout
+    for line in out.splitlines():
+        cols = line.split()
+        if len(cols) >= 2 and cols[0].startswith('.') and cols[1].isdigit():
+            sizes[cols[0]] = int(cols[1])
+    return sizes
+
+
+def top_symbols(tool, elf):
+    out = subprocess.run([tool, '--size-sort', '-S', '-C', '-r', elf], capture_output=True, text=True).stdout
+    symbols = []
+    for line in out.splitlines():
+        cols = line.split(None, 3)
+        if len(cols) == 4 and cols[2] in 'tTrRdDbB':
+            symbols.append((int(cols[1], 16), cols[2], cols[3]))
+        if len(symbols) >= TOP_SYMBOLS:
+            break
+    return symbols
+
+
+def delta(new, old):
+    return '' if old is None else ' ({:+d})'.format(new - old)
+
+
+def size_report(source, target, env):
+    build_dir = env.subst('$BUILD_DIR')
+    elf = env.subst('$BUILD_DIR/${PROGNAME}.elf')
+    image = env.subst('$BUILD_DIR/${PROGNAME}.bin')
+    size_tool = env.subst('$SIZETOOL')
+    try:
+        sections = section_sizes(size_tool, elf)
+    except (OSError, subprocess.CalledProcessError) as e:
+        print('*** Size report WARNING! {} failed: {}'.format(size_tool, e))
+        return
+    report = {
+        'image': os.path.getsize(image) if os.path.isfile(image) else 0,
+        'flash_code': sections.get('.flash.text', 0),
+        'flash_rodata': sections.get('.flash.rodata', 0),
+        'iram': sum(v for k, v in sections.items() if k.startswith('.iram0')),
+        'dram': sections.get('.dram0.data', 0) + sections.get('.dram0.bss', 0),
+    }
+    old = {}
+    try:
+        with open(os.path.join(build_dir, REPORT_FILE)) as f:
+            old = json.load(f)
+    except (OSError, ValueError):
+        pass
+
+    partition = app_partition_size(env)
+    print('')
+    print('Firmware size report, bytes:')
+    for key in ('image', 'flash_code', 'flash_rodata', 'iram', 'dram'):
+        print('  {:<14}{:>10}{}'.format(key, report[key], delta(report[key], old.get(key))))
+    nm_tool = size_tool[:-len('size')] + 'nm' if size_tool.endswith('size') else 'nm'
+    print('  largest symbols:')
+    for size, kind, name in top_symbols(nm_tool, elf):
+        print('  {:>10} {} {}'.format(size, kind, name[:96]))
+    with open(os.path.join(build_dir, REPORT_FILE), 'w') as f:
+        json.dump(report, f, indent=1)
+
+    if partition and report['image']:
+        budget = int(env.GetProjectOption('custom_size_budget_pct', '90'))
+        used = report['image'] * 100.0 / partition
+        print('  app partition {} bytes, {:.1f}% used, budget {}%'.format(partition, used, budget))
+        if used > budget:
+            print('*** Size report WARNING! The image is over {}% of the app partition'.format(budget))
+            if env.GetProjectOption('custom_size_strict', 'no').lower() in ('1', 'yes', 'true'):
+                env.Exit(1)
+    print('')
+
+
+env.AddPostAction('$BUILD_DIR/${PROGNAME}.bin', size_report)
@@ -0,0 +1,143 @@
+#include "baseArbiter.h"
+#include "deviceRecords.h"
+
+struct tArbPlayer
+{
+    uint64_t   id;
+    tGameRole  role;
+    int        hitNear;         // from the beacon that carried the report
+    int        hitMiddle;
+    int        hitFar;
+    uint32_t   heardMs;
+    tEspReport report;
+};
+
+static tArbPlayer players[ARBITER_PLAYERS];     // WiFi task writes, the game loop copies
+static uint8_t playerCount = 0;
+static int64_t pointMs[ARBITER_PLAYERS];        // game loop only, same slots as players
+static tArbPlayer work[ARBITER_PLAYERS];
+static bool arbiterOn = false;
+static uint32_t lastTickMs = 0;
+static portMUX_TYPE arbMux = portMUX_INITIALIZER_UNLOCKED;
+
+static void onReport(const tEspPacket &pkt, int rssi, const tEspReport &report)
+{
+    if ((pkt.deviceRole != grZombie) && (pkt.deviceRole != grHuman))
+    {
+        return;
+    }
+    uint32_t now = millis();
+    portENTER_CRITICAL(&arbMux);
+    int slot = -1;
+    for (int i = 0; i < playerCount; i++)
+    {
+        if (players[i].id == pkt.deviceID)
+        {
+            slot = i;
+            break;
+        }
+    }
+    if ((slot < 0) && (playerCount < ARBITER_PLAYERS))
+    {
+        slot = playerCount++;
+    }
+    if (slot >= 0)
+    {
+        tArbPlayer &p = players[slot];
+        p.id = pkt.deviceID;
+        p.role = pkt.deviceRole;
+        p.hitNear = pkt.hitPointsNear;
+        p.hitMiddle = pkt.hitPointsMiddle;
+        p.hitFar = pkt.hitPointsFar;
+        p.heardMs = now;
+        p.report = report;
+    }
+    portEXIT_CRITICAL(&arbMux);
+}
+
+static tRssiZone reportedZone(const tEspReport &report, uint64_t id)
+{
+    for (uint8_t i = 0; i < report.neighborCount; i++)
+    {
+        if (report.neighbors[i].id == id)
+        {
+            return (tRssiZone)report.neighbors[i].zone;
+        }
+    }
+    return rzOut;
+}
+
+// The base's own view of a player, from its neighbour table
+static tRssiZone baseZone(const tNeighborSnapshot *snap, uint64_t id)
+{
+    for (uint16_t i = 0; i < snap->count; i++)
+    {
+        if (snap->recs[i].deviceID == id)
+        {
+            return snap->recs[i].zone;
+        }
+    }
+    return rzOut;
+}
+
+void baseArbiterStart(void)
+{
+    if (arbiterOn)
+    {
+        return;
+    }
+    arbiterOn = true;
+    lastTickMs = millis();
+    espGatewayStart(onReport, ESP_GATEWAY_FLAG_ARBITER);
+    Serial.println(">>> baseArbiterStart: this base decides the hits of its zone");
+}
+
+bool baseArbiterActive(void)
+{
+    return arbiterOn;
+}
+
+void baseArbiterTick(void)
+{
+    uint32_t now = millis();
+    if (!arbiterOn || (now - lastTickMs < ARBITER_TICK_MS))
+    {
+        return;
+    }
+    uint32_t dt = now - lastTickMs;
+    lastTickMs = now;
+
+    portENTER_CRITICAL(&arbMux);
+    uint8_t count = playerCount;
+    memcpy(work, players, count * sizeof(tArbPlayer));
+    portEXIT_CRITICAL(&arbMux);
+
+    const tDeviceDataRecord *base = getSelfDataRecord();
+    const tNeighborSnapshot *snap = getNeighborSnapshot();
+    int loopMs = getGameLoopIntMs();
+    for (uint8_t a = 0; a < count; a++)
+    {
+        const tArbPlayer &pa = work[a];
+        if (now - pa.heardMs >= ARBITER_REPORT_AGE_MS)
+        {
+            continue;
+        }
+        int rate = 0;
+        for (uint8_t b = 0; b < count; b++)
+        {
+            const tArbPlayer &pb = work[b];
+            if ((b == a) || (pb.role == pa.role) || (now - pb.heardMs >= ARBITER_REPORT_AGE_MS))
+            {
+                continue;
+            }
+            // either side may miss the other in its short list, the closer view counts for both
+            tRssiZone zone = (tRssiZone)max(reportedZone(pa.report, pb.id), reportedZone(pb.report, pa.id));
+            rate += zonePoints(zone, pb.hitNear, pb.hitMiddle, pb.hitFar);
+        }
+        tRssiZone healZone = (tRssiZone)max(reportedZone(pa.report, base->deviceID), baseZone(snap, pa.id));
+        rate += zonePoints(healZone, base->hitPointsNear, base->hitPointsMiddle, base->hitPointsFar);
+
+        pointMs[a] += (int64_t)rate * dt;
+        espArbiterPublish(pa.id, (int32_t)(pointMs[a] / loopMs));
+    }
+}
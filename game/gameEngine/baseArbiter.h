@@ -0,0 +1,20 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "espGateway.h"
+
+// Base as the hit arbiter of its zone (role JSON "baseArbiter": true). The
+// base collects the players' ESP-NOW reports (see espGateway.h), decides
+// every zombie/human pair from both sides' view of each other, adds its own
+// heal, and publishes each player's running total of health points. Both
+// sides of a pair use the closer of the two zones they reported, so they
+// always agree on the outcome.
+
+#define ARBITER_TICK_MS         250
+#define ARBITER_REPORT_AGE_MS   (3 * ESP_REPORT_ARBITER_MS)    // older reports are left out
+#define ARBITER_PLAYERS         ESP_ARBITER_MAX
+
+void baseArbiterStart(void);    // once the base runs with an arbiter profile
+void baseArbiterTick(void);     // game loop
+bool baseArbiterActive(void);
@@ -5,199 +5,931 @@
 #include "PSRamFS.h"
 #include "tft_utils.h"
 #include "xgConfig.h"
+#include "rxRecorder.h"
+#include "logRing.h"
+#include "jsonAlloc.h"
+#include "tunables.h"
 
 static tDeviceDataRecord self;
 static tEspPacket selfTxPacket;
-static tDeviceDataRecord dRecords[MAX_REC_COUNT];
+static int16_t dRecIndex[DREC_HASH_SIZE];           // deviceID hash -> position in the table, -1 if empty
+static uint16_t dRecCount = 0;
+static bool dRecIndexReady = false;
 
 // static int farRSSI   = GAME_START_FAR_RSSI;
 // static int middlRSSI = GAME_START_MIDDL_RSSI;
 // static int closeRSSI = GAME_START_CLOSE_RSSI;
 static int gameLoopIntMs = GAME_START_LOOP_INT_MS;
+static int damageTickMs = GAME_DAMAGE_TICK_MS;
+static int dwellHoldMs = GAME_DWELL_HOLD_MS;
+static bool selfArbiter = false;
+static bool linkWeight = false;
+static tRssiCurve hitCurve;
+static tRssiCurve healCurve;
+static tRssiFilterCfg rssiCfg;
+static tRssiFilterType roleRssiFilter = rfNone;     // the role's choice under the rssi_filter tunable
+static uint32_t rssiTunedGen = 0;
+static tRadioProfile radioProfile;
+
+// Role profiles parsed once at boot, a role switch only copies the selected profile into self
+static tRoleProfile roleProfiles[ROLE_PROFILE_COUNT];
+static tRoleProfile adHocProfile;               // setSelfJson() and files that are not preloaded
+
+// The neighbour table belongs to the radio task, the game loop only sees snapshots
+#define SNAP_FRESH  0x04
+static tNeighborSnapshot snapBufs[3];
+static uint8_t snapBack = 0;                // radio task only
+static uint8_t snapFront = 1;               // game loop only
+static volatile uint8_t snapMiddle = 2;     // exchanged atomically, SNAP_FRESH set by the writer
+
+// Records heard within dwellHoldMs sit on the present list and feed the damage integral,
+// then stay on the recent list (neighbour counts only) until their own expiry (see
+// DREC_EXPIRE_INTERVALS) and finally wait on the stale list until DREC_EVICT_MS, out of
+// the role index and the snapshot. The present and stale lists are kept least recently
+// heard first, the recent list soonest expiring first, so expiry only touches the records
+// that actually expire.
+#define DREC_LIST_NONE      0
+#define DREC_LIST_PRESENT   1
+#define DREC_LIST_RECENT    2
+#define DREC_LIST_STALE     3
+#define DREC_LIST_COUNT     4
+
+struct tRecList
+{
+    int16_t head = -1;
+    int16_t tail = -1;
+};
+
+static tRecList recLists[DREC_LIST_COUNT];  // [DREC_LIST_NONE] is unused
+
+// Neighbour table, one array per field so the frame path, the expiry walks
+// and the totals touch only their fields, packed to the widths the radio
+// gives (RSSI fits int8, role zone and list fit a byte). Positions
+// [0..dRecCount) are live. The filter state is the only wide member and is
+// read per frame only. Plain statics are in internal DRAM (.bss), never in
+// PSRAM, which the radio task can't afford to miss on.
+struct tNeighborTable
+{
+    uint64_t deviceID[MAX_REC_COUNT];
+    uint32_t lastReceivedMs[MAX_REC_COUNT];
+    uint32_t liveUntilMs[MAX_REC_COUNT];    // leaves the recent list
+    uint32_t intervalQ4[MAX_REC_COUNT];     // EMA of the inter-arrival time, ms * 16
+    int16_t  hitNear[MAX_REC_COUNT];
+    int16_t  hitMiddle[MAX_REC_COUNT];
+    int16_t  hitFar[MAX_REC_COUNT];
+    int16_t  hitContrib[MAX_REC_COUNT];     // what the record currently adds to tScanTotals
+    int16_t  healContrib[MAX_REC_COUNT];
+    int16_t  lruPrev[MAX_REC_COUNT];        // position links in the lists above
+    int16_t  lruNext[MAX_REC_COUNT];
+    int8_t   rssi[MAX_REC_COUNT];
+    int8_t   rssiFiltered[MAX_REC_COUNT];   // output of the filter selected in the self role JSON
+    int8_t   rssiMin[MAX_REC_COUNT];        // frames received since the last snapshot
+    int8_t   rssiMax[MAX_REC_COUNT];
+    uint8_t  role[MAX_REC_COUNT];           // tGameRole
+    uint8_t  zone[MAX_REC_COUNT];           // tRssiZone of the last update, against the self thresholds
+    uint8_t  lruList[MAX_REC_COUNT];
+    int32_t  rssiSum[MAX_REC_COUNT];
+    uint16_t rssiCount[MAX_REC_COUNT];
+    uint16_t seqLast[MAX_REC_COUNT];        // sender's frame sequence of the last update
+    uint16_t seqSent[MAX_REC_COUNT];        // frames sent and delivered within the link window
+    uint16_t seqHeard[MAX_REC_COUNT];
+    uint8_t  lossBurst[MAX_REC_COUNT];
+    tRssiFilterState filter[MAX_REC_COUNT];
+};
+
+static tNeighborTable nt;
+
+// Secondary index: one bit per table position for every role, so role queries
+// only visit the k records of that role
+#define DREC_ROLE_SLOTS     8
+#define DREC_ROLE_WORDS     ((MAX_REC_COUNT + 31) / 32)
+static uint32_t dRecRoleBits[DREC_ROLE_SLOTS][DREC_ROLE_WORDS];
+static tScanTotals scanTotals;              // radio task only, published with the snapshot
+static volatile bool scanTotalsDirty = false;   // self role or thresholds changed, contributions are stale
+static int64_t hitApplied = 0;              // game loop only, integral already converted to health
+static int64_t healApplied = 0;
+
+// During a replay the table runs on the recorded timestamps instead of millis()
+static volatile bool replayActive = false;
+static uint32_t replayNowMs = 0;
+static int replaySavedHealth = 0;
+
+static inline uint32_t recNowMs(void)
+{
+    return replayActive ? replayNowMs : millis();
+}
 
-// int i = sizeof(dRecords);
 
 uint32_t lastHpUpdatedMs = 0;
 
-void tDeviceDataRecord::print(void)
+// [[dBm, percent], ...] with the RSSI rising; absent keeps the zone points
+static void curveFromJson(JsonDocument &doc, const char *key, tRssiCurve &curve)
+{
+    curve.on = false;
+    JsonArrayConst knots = doc[key].as<JsonArrayConst>();
+    if (knots.isNull())
+    {
+        return;
+    }
+    int8_t rssi[RSSI_CURVE_MAX_POINTS];
+    int16_t pct[RSSI_CURVE_MAX_POINTS];
+    uint8_t count = 0;
+    for (JsonArrayConst knot : knots)
+    {
+        if (count == RSSI_CURVE_MAX_POINTS)
+        {
+            count++;
+            break;
+        }
+        rssi[count] = (int8_t)constrain((int)(knot[0] | 0), -RSSI_CURVE_LUT + 1, 0);
+        pct[count] = (int16_t)(knot[1] | 0);
+        count++;
+    }
+    if (!rssiCurveCompile(curve, rssi, pct, count))
+    {
+        Serial.printf("!!! roleCfgFromJson ERROR: %s needs 1..%d [dBm, %%] knots of rising RSSI, zone points used\r\n",
+                      key, RSSI_CURVE_MAX_POINTS);
+        return;
+    }
+    Serial.printf(">>> roleCfgFromJson: %s, %u knots, %d..%d dBm\r\n", key, (unsigned)count, rssi[0], rssi[count - 1]);
+}
+
+static void roleCfgFromJson(JsonDocument &doc, tRoleProfile &prof)
 {
-    Serial.printf("[deviceID = %s] [deviceRole = %s] [lastReceivedMs = %lu (%d)] [rssi = %d] [near = %d] [mid = %d] [far = %d] ",
-                  utilsGetDeviceID64Hex().c_str(), role2str(deviceRole), lastReceivedMs, lastReceivedMs - millis(), rssi, hitPointsNear, hitPointsMiddle, hitPointsFar);
+    tRssiFilterCfg &cfg = prof.rssiCfg;
+    cfg = tRssiFilterCfg();
+    cfg.type = str2rssiFilter(doc["rssiFilter"] | "none");
+    cfg.emaAlphaQ8 = (int32_t)((doc["rssiEmaAlpha"] | (float)RSSI_DEF_EMA_ALPHA_Q8 / RSSI_Q8_ONE) * RSSI_Q8_ONE);
+    cfg.medianWin = doc["rssiMedianWindow"] | RSSI_DEF_MEDIAN_WIN;
+    cfg.kalmanQQ8 = (int32_t)((doc["rssiKalmanQ"] | (float)RSSI_DEF_KALMAN_Q_Q8 / RSSI_Q8_ONE) * RSSI_Q8_ONE);
+    cfg.kalmanRQ8 = (int32_t)((doc["rssiKalmanR"] | (float)RSSI_DEF_KALMAN_R_Q8 / RSSI_Q8_ONE) * RSSI_Q8_ONE);
+    cfg.hystClose = doc["rssiHystClose"] | RSSI_DEF_HYST_DB;
+    cfg.hystMiddle = doc["rssiHystMiddle"] | RSSI_DEF_HYST_DB;
+    cfg.hystFar = doc["rssiHystFar"] | RSSI_DEF_HYST_DB;
+
+    cfg.emaAlphaQ8 = constrain(cfg.emaAlphaQ8, 1, RSSI_Q8_ONE);
+    cfg.medianWin = constrain(cfg.medianWin, 1, RSSI_MEDIAN_MAX_WIN);
+    if (cfg.kalmanRQ8 < 1)
+        cfg.kalmanRQ8 = 1;
+    prof.damageTickMs = constrain((int)(doc["damageTickMs"] | GAME_DAMAGE_TICK_MS), 10, gameLoopIntMs);
+    prof.dwellHoldMs = constrain((int)(doc["dwellHoldMs"] | GAME_DWELL_HOLD_MS), 10, gameLoopIntMs);
+    prof.baseArbiter = doc["baseArbiter"] | false;
+    prof.linkWeight = doc["linkWeight"] | false;
+    curveFromJson(doc, "damageCurve", prof.hitCurve);
+    curveFromJson(doc, "healCurve", prof.healCurve);
+    prof.radio = tRadioProfile();
+    prof.radio.protocolMask = str2protoMask(doc["radioProtocol"] | "bgnlr");
+    prof.radio.rate = str2phyRate(doc["radioRate"] | "1m");
+    prof.radio.txPower = doc["radioTxPower"] | WIFI_TX_POWER;
+
+    Serial.printf(">>> roleCfgFromJson: filter = %s, hysteresis = %d/%d/%d, tick = %d ms, dwell = %d ms, link weight %s\r\n",
+                  rssiFilter2str(cfg.type), cfg.hystClose, cfg.hystMiddle, cfg.hystFar, prof.damageTickMs, prof.dwellHoldMs,
+                  prof.linkWeight ? "on" : "off");
 }
 
-bool tDeviceDataRecord::setJson(String jsonStr, bool self)
+static bool roleProfileFromJson(String jsonStr, tRoleProfile &prof)
 {
-    JsonDocument doc;
+    tJsonArenaAllocator arena(jdkRole, JSON_ARENA_ROLE);
+    JsonDocument doc(&arena);
 
     DeserializationError error = deserializeJson(doc, jsonStr);
     if (error)
     {
-        Serial.print("!!! tDeviceDataRecord::setJson ERROR. deserializeJson() failed: ");
+        Serial.print("!!! roleProfileFromJson ERROR. deserializeJson() failed: ");
         Serial.println(error.c_str());
         return false;
     }
 
-    // if (self)
-    // {
-    //     deviceID = utilsGetDeviceID64();
-    // }
-    // else
-    // {
-    //     deviceID = doc["deviceID"].as<uint64_t>();
-    // }
-
-    deviceID = ConfigAPI::getDeviceID();
+    tDeviceDataRecord &rec = prof.rec;
+    rec = tDeviceDataRecord();
+    rec.deviceID = ConfigAPI::getDeviceID();
 
     const char *roleStr = doc["deviceRole"] | "grNone";
-    deviceRole = str2role(roleStr);
-
-    hitPointsNear = doc["hitPointsNear"] | 0;
-    hitPointsMiddle = doc["hitPointsMiddle"] | 0;
-    hitPointsFar = doc["hitPointsFar"] | 0;
-    health = doc["health"] | 0;
-    beginHealth = health;
-    maxHealth = doc["maxHealth"] | 0;
+    rec.deviceRole = str2role(roleStr);
+
+    rec.hitPointsNear = doc["hitPointsNear"] | 0;
+    rec.hitPointsMiddle = doc["hitPointsMiddle"] | 0;
+    rec.hitPointsFar = doc["hitPointsFar"] | 0;
+    rec.health = doc["health"] | 0;
+    rec.maxHealth = doc["maxHealth"] | 0;
+    rec.beginHealth = rec.health;
+
+    rec.rssiFar = doc["rssiFar"] | 0;
+    rec.rssiMiddle = doc["rssiMiddle"] | 0;
+    rec.rssiClose = doc["rssiClose"] | 0;
+
+    roleCfgFromJson(doc, prof);
+    prof.loaded = true;
     return true;
 }
 
-bool tDeviceDataRecord::setJsonFromFile(String filename, bool self)
+static bool readJsonFile(String filename, String &jsonStr)
 {
-
-    // // Check if file exists
-    // if (!PSRamFS.exists(filename)) {
-    //     Serial.print("!!! tDeviceDataRecord::setJsonFromFile ERROR. File does not exist: ");
-    //     Serial.println(filename);
-    //     return false;
-    // }
-
-    // Open file for reading    
     File file = PSRamFS.open(filename, "r");
     if (!file)
     {
-        Serial.print("!!! tDeviceDataRecord::setJsonFromFile ERROR. Failed to open file: ");
+        Serial.print("!!! readJsonFile ERROR. Failed to open file: ");
         Serial.println(filename);
         return false;
     }    
-    // Read file content
-    String jsonStr = file.readString();
+    jsonStr = file.readString();
     file.close();    
-    // Check if file was empty
     if (jsonStr.length() == 0)
     {
-        Serial.print("!!! tDeviceDataRecord::setJsonFromFile ERROR. File is empty: ");
+        Serial.print("!!! readJsonFile ERROR. File is empty: ");
         Serial.println(filename);
         return false;
     }    
-    // Parse JSON
-    JsonDocument doc;
-    DeserializationError error = deserializeJson(doc, jsonStr);
-    if (error)
+    return true;
+}
+
+static int roleProfileSlot(tGameRole role)
+{
+    switch (role)
     {
-        Serial.print("!!! tDeviceDataRecord::setJsonFromFile ERROR. deserializeJson() failed: ");
-        Serial.println(error.c_str());
-        return false;
-    }    
-    // Set device data from JSON
-    // if (self) {
-    //     deviceID = utilsGetDeviceID64();
-    // }
-    // else {
-    //     deviceID = doc["deviceID"].as<uint64_t>();
-    // }
-    deviceID = ConfigAPI::getDeviceID();
+    case grZombie:
+        return 0;
+    case grHuman:
+        return 1;
+    case grBase:
+        return 2;
+    case grRssiMonitor:
+        return 3;
+    default:
+        return -1;
+    }
+}
 
-    const char *roleStr = doc["deviceRole"] | "grNone";
-    deviceRole = str2role(roleStr);
+void tDeviceDataRecord::print(void)
+{
+    LOGR(lmRecords, llInfo, "[deviceID = %08lX%08lX] [deviceRole = %s] [lastReceivedMs = %lu (%d)] [rssi = %d] [near = %d] [mid = %d] [far = %d]\r\n",
+         (uint32_t)(deviceID >> 32), (uint32_t)deviceID, role2str(deviceRole), lastReceivedMs, (int)(lastReceivedMs - millis()), rssi, hitPointsNear, hitPointsMiddle, hitPointsFar);
+}
 
-    hitPointsNear = doc["hitPointsNear"] | 0;
-    hitPointsMiddle = doc["hitPointsMiddle"] | 0;
-    hitPointsFar = doc["hitPointsFar"] | 0;
-    health = doc["health"] | 0;
-    maxHealth = doc["maxHealth"] | 0;
-    beginHealth = health;
+static uint8_t linkPdrPct(uint16_t pos)
+{
+    uint16_t sent = nt.seqSent[pos];
+    return sent ? (uint8_t)((nt.seqHeard[pos] * 100 + sent / 2) / sent) : 100;
+}
 
-    rssiFar = doc["rssiFar"] | 0;
-    rssiMiddle = doc["rssiMiddle"] | 0;
-    rssiClose = doc["rssiClose"] | 0;
+// Two ring entries, one takes LOG_RING_ARGS arguments at most
+static void printNeighbor(uint16_t pos)
+{
+    LOGR(lmRecords, llInfo, "[deviceID = %08lX%08lX] [deviceRole = %s] [lastReceivedMs = %lu (%d)] ",
+         (uint32_t)(nt.deviceID[pos] >> 32), (uint32_t)nt.deviceID[pos], role2str((tGameRole)nt.role[pos]), nt.lastReceivedMs[pos],
+         (int)(nt.lastReceivedMs[pos] - millis()));
+    LOGR(lmRecords, llInfo, "[rssi = %d] [near = %d] [mid = %d] [far = %d] [pdr = %u%%] [burst = %u]\r\n",
+         nt.rssi[pos], nt.hitNear[pos], nt.hitMiddle[pos], nt.hitFar[pos], (unsigned)linkPdrPct(pos), (unsigned)nt.lossBurst[pos]);
+}
 
-    return true;
+static inline int8_t rssi8(int rssi)
+{
+    return (int8_t)constrain(rssi, -128, 127);
+}
+
+static inline int16_t points16(int points)
+{
+    return (int16_t)constrain(points, -32768, 32767);
+}
+
+static inline bool isZomboHumRole(uint8_t role)
+{
+    return (role == grZombie) || (role == grHuman);
+}
+
+// An empty slot, as findPos() hands it out
+static void clearSlot(uint16_t pos)
+{
+    nt.deviceID[pos] = 0;
+    nt.lastReceivedMs[pos] = 0;
+    nt.liveUntilMs[pos] = 0;
+    nt.intervalQ4[pos] = 0;
+    nt.hitNear[pos] = nt.hitMiddle[pos] = nt.hitFar[pos] = 0;
+    nt.hitContrib[pos] = nt.healContrib[pos] = 0;
+    nt.lruPrev[pos] = nt.lruNext[pos] = -1;
+    nt.rssi[pos] = nt.rssiFiltered[pos] = 0;
+    nt.rssiMin[pos] = nt.rssiMax[pos] = 0;
+    nt.role[pos] = grNone;
+    nt.zone[pos] = rzOut;
+    nt.lruList[pos] = DREC_LIST_NONE;
+    nt.rssiSum[pos] = 0;
+    nt.rssiCount[pos] = 0;
+    nt.seqLast[pos] = 0;
+    nt.seqSent[pos] = nt.seqHeard[pos] = 0;
+    nt.lossBurst[pos] = 0;
+    nt.filter[pos] = tRssiFilterState();
+}
+
+static void moveSlot(uint16_t to, uint16_t from)
+{
+    nt.deviceID[to] = nt.deviceID[from];
+    nt.lastReceivedMs[to] = nt.lastReceivedMs[from];
+    nt.liveUntilMs[to] = nt.liveUntilMs[from];
+    nt.intervalQ4[to] = nt.intervalQ4[from];
+    nt.hitNear[to] = nt.hitNear[from];
+    nt.hitMiddle[to] = nt.hitMiddle[from];
+    nt.hitFar[to] = nt.hitFar[from];
+    nt.hitContrib[to] = nt.hitContrib[from];
+    nt.healContrib[to] = nt.healContrib[from];
+    nt.lruPrev[to] = nt.lruPrev[from];
+    nt.lruNext[to] = nt.lruNext[from];
+    nt.rssi[to] = nt.rssi[from];
+    nt.rssiFiltered[to] = nt.rssiFiltered[from];
+    nt.rssiMin[to] = nt.rssiMin[from];
+    nt.rssiMax[to] = nt.rssiMax[from];
+    nt.role[to] = nt.role[from];
+    nt.zone[to] = nt.zone[from];
+    nt.lruList[to] = nt.lruList[from];
+    nt.rssiSum[to] = nt.rssiSum[from];
+    nt.rssiCount[to] = nt.rssiCount[from];
+    nt.seqLast[to] = nt.seqLast[from];
+    nt.seqSent[to] = nt.seqSent[from];
+    nt.seqHeard[to] = nt.seqHeard[from];
+    nt.lossBurst[to] = nt.lossBurst[from];
+    nt.filter[to] = nt.filter[from];
+}
+
+static inline uint16_t recHash(uint64_t deviceID)
+{
+    return (uint16_t)((deviceID * 0x9E3779B97F4A7C15ULL) >> (64 - DREC_HASH_BITS));
 }
 
-static uint16_t findPos(uint64_t deviceID)
+static void rebuildIndex(void)
 {
-    for (int i = 0; i < MAX_REC_COUNT; i++)
+    for (int i = 0; i < DREC_HASH_SIZE; i++)
     {
-        if (dRecords[i].deviceID == deviceID)
-            return i;
+        dRecIndex[i] = -1;
     }
+    for (uint16_t pos = 0; pos < dRecCount; pos++)
+    {
+        uint16_t h = recHash(nt.deviceID[pos]);
+        while (dRecIndex[h] >= 0)
+        {
+            h = (h + 1) & (DREC_HASH_SIZE - 1);
+        }
+        dRecIndex[h] = pos;
+    }
+    dRecIndexReady = true;
+}
 
-    for (int i = 0; i < MAX_REC_COUNT; i++)
+int zonePoints(tRssiZone zone, int nearPoints, int middlePoints, int farPoints)
+{
+    switch (zone)
     {
-        if (!dRecords[i].deviceID)
-            return i;
+    case rzClose:
+        return nearPoints;
+    case rzMiddle:
+        return middlePoints;
+    case rzFar:
+        return farPoints;
+    default:
+        return 0;
     }
+}
 
-    return 0;
+static int roleIndexSlot(tGameRole role)
+{
+    switch (role)
+    {
+    case grZombie:
+        return 0;
+    case grHuman:
+        return 1;
+    case grBase:
+        return 2;
+    case grServer:
+        return 3;
+    case grPinger:
+        return 4;
+    case grApPortalBeacon:
+        return 5;
+    case grRssiMonitor:
+        return 6;
+    default:
+        return -1;
+    }
 }
 
-void addScannedRecord(tEspPacket *rData, unsigned long lastMs, int rssi)
+static inline void roleIndexSet(uint16_t pos, tGameRole role, bool on)
 {
-    uint16_t pos = findPos(rData->deviceID);
-    dRecords[pos].processed = false;
-    dRecords[pos].deviceID = rData->deviceID;
-    dRecords[pos].deviceRole = rData->deviceRole;
+    int slot = roleIndexSlot(role);
+    if (slot < 0)
+    {
+        return;
+    }
+    if (on)
+        dRecRoleBits[slot][pos >> 5] |= (1UL << (pos & 31));
+    else
+        dRecRoleBits[slot][pos >> 5] &= ~(1UL << (pos & 31));
+}
 
-    dRecords[pos].hitPointsNear = rData->hitPointsNear;
-    dRecords[pos].hitPointsMiddle = rData->hitPointsMiddle;
-    dRecords[pos].hitPointsFar = rData->hitPointsFar;
+static void listUnlink(uint16_t pos)
+{
+    if (nt.lruList[pos] == DREC_LIST_NONE)
+    {
+        return;
+    }
+    tRecList *list = &recLists[nt.lruList[pos]];
+    int16_t prev = nt.lruPrev[pos];
+    int16_t next = nt.lruNext[pos];
+    if (prev >= 0)
+        nt.lruNext[prev] = next;
+    else
+        list->head = next;
+    if (next >= 0)
+        nt.lruPrev[next] = prev;
+    else
+        list->tail = prev;
+    nt.lruPrev[pos] = nt.lruNext[pos] = -1;
+    nt.lruList[pos] = DREC_LIST_NONE;
+}
 
-    dRecords[pos].lastReceivedMs = lastMs;
-    dRecords[pos].rssi = rssi;
-    // dRec.print();
+static void listAppend(uint16_t pos, uint8_t listID)
+{
+    tRecList *list = &recLists[listID];
+    nt.lruList[pos] = listID;
+    nt.lruPrev[pos] = list->tail;
+    nt.lruNext[pos] = -1;
+    if (list->tail >= 0)
+        nt.lruNext[list->tail] = pos;
+    else
+        list->head = pos;
+    list->tail = pos;
 }
 
-void printScannedRecords(tGameRole filterRole)
+// Keeps the list ordered by key, new entries mostly belong at the tail
+static void listInsertBy(uint16_t pos, uint8_t listID, const uint32_t *key)
 {
-    Serial.println(">>>>>>>>>>>>>>> RECORDS LIST <<<<<<<<<<<<<<<<<<");
-    self.print();
-    Serial.println("\r\n----");
-    for (int i = 0; i < MAX_REC_COUNT; i++)
+    tRecList *list = &recLists[listID];
+    int16_t after = list->tail;
+    while ((after >= 0) && ((int32_t)(key[after] - key[pos]) > 0))
+    {
+        after = nt.lruPrev[after];
+    }
+    nt.lruList[pos] = listID;
+    nt.lruPrev[pos] = after;
+    nt.lruNext[pos] = (after >= 0) ? nt.lruNext[after] : list->head;
+    if (after >= 0)
+        nt.lruNext[after] = pos;
+    else
+        list->head = pos;
+    if (nt.lruNext[pos] >= 0)
+        nt.lruPrev[nt.lruNext[pos]] = pos;
+    else
+        list->tail = pos;
+}
+
+static inline bool isLiveList(uint8_t listID)
+{
+    return (listID == DREC_LIST_PRESENT) || (listID == DREC_LIST_RECENT);
+}
+
+// count frames came since the last update of a live record; a gap longer
+// than the bound is a return after an absence and says nothing of the rate
+static void expiryUpdate(uint16_t pos, uint32_t lastMs, uint16_t count, bool live)
+{
+    uint32_t gapMs = lastMs - nt.lastReceivedMs[pos];
+    if (live && nt.lastReceivedMs[pos] && (gapMs <= DREC_EXPIRE_MAX_MS))
+    {
+        uint32_t sampleQ4 = (gapMs << 4) / max(count, (uint16_t)1);
+        if (nt.intervalQ4[pos] == 0)
+            nt.intervalQ4[pos] = sampleQ4;
+        else
+            nt.intervalQ4[pos] += ((int32_t)sampleQ4 - (int32_t)nt.intervalQ4[pos]) / 8;
+    }
+    uint32_t windowMs = gameLoopIntMs;
+    if (nt.intervalQ4[pos])
+    {
+        windowMs = constrain((nt.intervalQ4[pos] * DREC_EXPIRE_INTERVALS) >> 4, (uint32_t)DREC_EXPIRE_MIN_MS,
+                             (uint32_t)DREC_EXPIRE_MAX_MS);
+    }
+    nt.liveUntilMs[pos] = lastMs + max(windowMs, (uint32_t)dwellHoldMs);
+}
+
+// Accumulates the current hit/heal rate up to toMs, the rates only change on
+// list transitions so the integral is exact between them
+static void totalsIntegrate(uint32_t toMs)
+{
+    int32_t dt = (int32_t)(toMs - scanTotals.integratedMs);
+    if (dt <= 0)
     {
-        bool printIt = true;
-        if (!dRecords[i].deviceID)
+        return;
+    }
+    scanTotals.hitPointMs += (int64_t)scanTotals.hitPoints * dt;
+    scanTotals.healPointMs += (int64_t)scanTotals.healPoints * dt;
+    scanTotals.integratedMs = toMs;
+}
+
+static void totalsCount(uint16_t pos, int sign)
+{
+    uint8_t role = nt.role[pos];
+    if (role == grZombie)
+        scanTotals.zCount += sign;
+    if (role == grHuman)
+        scanTotals.hCount += sign;
+    if (role == grBase)
+        scanTotals.bCount += sign;
+    scanTotals.active += sign;
+}
+
+// Adds (sign = 1) or removes (sign = -1) a present record from the rates,
+// the contribution is recalculated on add and reused on remove
+static void totalsPoints(uint16_t pos, int sign)
+{
+    if (sign > 0)
+    {
+        uint8_t role = nt.role[pos];
+        const tRssiCurve &curve = (role == grBase) ? healCurve : hitCurve;
+        int points = curve.on ? rssiCurvePoints(curve, nt.rssiFiltered[pos], nt.hitNear[pos])
+                              : zonePoints((tRssiZone)nt.zone[pos], nt.hitNear[pos], nt.hitMiddle[pos], nt.hitFar[pos]);
+        uint8_t pdr = linkPdrPct(pos);
+        if (linkWeight && (pdr < DREC_LINK_FULL_PCT))
         {
-            continue;
+            // an edge of range link with most frames lost is a weaker observation
+            points = points * pdr / DREC_LINK_FULL_PCT;
+        }
+        nt.hitContrib[pos] = (isZomboHumRole(role) && (self.deviceRole != role)) ? points16(points) : 0;
+        nt.healContrib[pos] = (role == grBase) ? points16(points) : 0;
+    }
+    scanTotals.hitPoints += sign * nt.hitContrib[pos];
+    scanTotals.healPoints += sign * nt.healContrib[pos];
+}
+
+// Takes the record out of the totals it is counted in, the caller unlinks it
+static void totalsLeave(uint16_t pos, uint32_t nowMs)
+{
+    uint8_t list = nt.lruList[pos];
+    if (list == DREC_LIST_PRESENT)
+    {
+        totalsIntegrate(nowMs);
+        totalsPoints(pos, -1);
+    }
+    if ((list == DREC_LIST_PRESENT) || (list == DREC_LIST_RECENT))
+    {
+        totalsCount(pos, -1);
+    }
+}
+
+static void recomputeTotals(uint32_t nowMs)
+{
+    totalsIntegrate(nowMs);
+    scanTotals.zCount = scanTotals.hCount = scanTotals.bCount = 0;
+    scanTotals.hitPoints = scanTotals.healPoints = 0;
+    scanTotals.active = 0;
+    for (int16_t pos = recLists[DREC_LIST_PRESENT].head; pos >= 0; pos = nt.lruNext[pos])
+    {
+        totalsCount(pos, 1);
+        totalsPoints(pos, 1);
+    }
+    for (int16_t pos = recLists[DREC_LIST_RECENT].head; pos >= 0; pos = nt.lruNext[pos])
+    {
+        totalsCount(pos, 1);
+    }
+}
+
+// Ends the dwell of the records not heard within dwellHoldMs (integrating each one up to
+// its own hold end) and stops counting the ones past their own expiry
+static void expireActive(uint32_t nowMs)
+{
+    int16_t pos;
+    while ((pos = recLists[DREC_LIST_PRESENT].head) >= 0)
+    {
+        uint32_t heardMs = nt.lastReceivedMs[pos];
+        if (nowMs - heardMs <= (uint32_t)dwellHoldMs)
+        {
+            break;
         }
+        totalsIntegrate(heardMs + dwellHoldMs);
+        totalsPoints(pos, -1);
+        listUnlink(pos);
+        listInsertBy(pos, DREC_LIST_RECENT, nt.liveUntilMs);
+    }
 
-        if ((filterRole != grNone) && (filterRole != dRecords[i].deviceRole))
+    while ((pos = recLists[DREC_LIST_RECENT].head) >= 0)
+    {
+        if ((int32_t)(nowMs - nt.liveUntilMs[pos]) < 0)
         {
-            continue;
+            break;
         }
-        dRecords[i].print();
-        Serial.println();
+        totalsCount(pos, -1);
+        listUnlink(pos);
+        listInsertBy(pos, DREC_LIST_STALE, nt.lastReceivedMs);
+        roleIndexSet(pos, (tGameRole)nt.role[pos], false);
     }
-    Serial.println("===============================================");
+    totalsIntegrate(nowMs);
 }
 
-bool checkIfApPortal(int rssiLevel)
+// Swap-removes the record from the packed table, the index has to be rebuilt afterwards
+static void dropRecord(uint16_t pos)
 {
-    bool wasPortal = false;
-    for (int i = 0; i < MAX_REC_COUNT; i++)
+    totalsLeave(pos, recNowMs());
+    listUnlink(pos);
+    roleIndexSet(pos, (tGameRole)nt.role[pos], false);
+
+    dRecCount--;
+    if (pos != dRecCount)
     {
-        if (!dRecords[i].deviceID)
-            break;
+        moveSlot(pos, dRecCount);
+        tGameRole role = (tGameRole)nt.role[pos];
+        roleIndexSet(dRecCount, role, false);
+        roleIndexSet(pos, role, isLiveList(nt.lruList[pos]));
+        if (nt.lruList[pos] != DREC_LIST_NONE)
+        {
+            tRecList *list = &recLists[nt.lruList[pos]];
+            if (nt.lruPrev[pos] >= 0)
+                nt.lruNext[nt.lruPrev[pos]] = pos;
+            else
+                list->head = pos;
+            if (nt.lruNext[pos] >= 0)
+                nt.lruPrev[nt.lruNext[pos]] = pos;
+            else
+                list->tail = pos;
+        }
+    }
+    clearSlot(dRecCount);
+}
 
-        if (dRecords[i].deviceRole != grApPortalBeacon)
+static uint16_t evictRecords(uint32_t maxAgeMs)
+{
+    uint16_t evicted = 0;
+    uint32_t nowMs = recNowMs();
+    int16_t pos;
+    expireActive(nowMs);
+    while ((pos = recLists[DREC_LIST_STALE].head) >= 0)
+    {
+        if (nowMs - nt.lastReceivedMs[pos] <= maxAgeMs)
+        {
             break;
+        }
+        dropRecord(pos);
+        evicted++;
+    }
+    if (evicted)
+    {
+        rebuildIndex();
+    }
+    return evicted;
+}
+
+static void evictOldest(void)
+{
+    int16_t oldest = recLists[DREC_LIST_STALE].head;
+    if (oldest < 0)
+    {
+        oldest = recLists[DREC_LIST_RECENT].head;
+    }
+    if (oldest < 0)
+    {
+        oldest = recLists[DREC_LIST_PRESENT].head;
+    }
+    if (oldest < 0)
+    {
+        oldest = 0;
+    }
+    dropRecord(oldest);
+    rebuildIndex();
+}
+
+static int findPos(uint64_t deviceID, bool doInsert)
+{
+    if (!dRecIndexReady)
+    {
+        rebuildIndex();
+    }
+    uint16_t h = recHash(deviceID);
+    while (dRecIndex[h] >= 0)
+    {
+        if (nt.deviceID[dRecIndex[h]] == deviceID)
+        {
+            return dRecIndex[h];
+        }
+        h = (h + 1) & (DREC_HASH_SIZE - 1);
+    }
+
+    if (!doInsert)
+    {
+        return -1;
+    }
+
+    if (dRecCount >= MAX_REC_COUNT)
+    {
+        if (!evictRecords(DREC_EVICT_MS))
+        {
+            evictOldest();
+        }
+        return findPos(deviceID, true);
+    }
+
+    uint16_t pos = dRecCount++;
+    clearSlot(pos);
+    nt.deviceID[pos] = deviceID;
+    dRecIndex[h] = pos;
+    return pos;
+}
+
+// count frames of the sender arrived, the last one with sequence seq; a
+// sequence that stands still (replays, duplicates) or jumps tells nothing
+static void linkUpdate(uint16_t pos, uint16_t seq, uint16_t count, bool first)
+{
+    uint16_t gap = seq - nt.seqLast[pos];
+    nt.seqLast[pos] = seq;
+    if (first || (gap == 0) || (gap > DREC_LINK_SEQ_JUMP))
+    {
+        return;
+    }
+    uint16_t heard = min(count, gap);
+    uint16_t lost = gap - heard;
+    nt.seqSent[pos] += gap;
+    nt.seqHeard[pos] += heard;
+    if (lost > nt.lossBurst[pos])
+    {
+        nt.lossBurst[pos] = (uint8_t)min(lost, (uint16_t)255);
+    }
+    while (nt.seqSent[pos] > 2 * DREC_LINK_WINDOW)
+    {
+        nt.seqSent[pos] >>= 1;
+        nt.seqHeard[pos] >>= 1;
+        nt.lossBurst[pos] >>= 1;
+    }
+}
+
+// The rssi_filter tunable over the role's filter, looked at by generation so
+// the frame path pays one compare; the filters start over on another type
+static void tuneRssiFilter(bool force)
+{
+    uint32_t gen = tunablesGen();
+    if (!force && (gen == rssiTunedGen))
+    {
+        return;
+    }
+    rssiTunedGen = gen;
+    int32_t tuned = tunable(tuRssiFilter);
+    tRssiFilterType type = (tuned > 0) ? (tRssiFilterType)(tuned - 1) : roleRssiFilter;
+    if (type == rssiCfg.type)
+    {
+        return;
+    }
+    Serial.printf(">>> tuneRssiFilter: %s -> %s\r\n", rssiFilter2str(rssiCfg.type), rssiFilter2str(type));
+    rssiCfg.type = type;
+    for (uint16_t pos = 0; pos < dRecCount; pos++)
+    {
+        rssiFilterReset(nt.filter[pos]);
+    }
+}
+
+void addScannedAggregate(tEspPacket *rData, unsigned long lastMs, int rssi, int rssiMin, int rssiMax, int32_t rssiSum, uint16_t count)
+{
+    if (!rData->deviceID)
+    {
+        return;
+    }
+    int pos = findPos(rData->deviceID, true);
+    bool live = isLiveList(nt.lruList[pos]);
+    totalsLeave(pos, lastMs);
+    listUnlink(pos);
+    if (!live || (nt.role[pos] != rData->deviceRole))
+    {
+        // back from the stale list or new: in the role index again
+        roleIndexSet(pos, (tGameRole)nt.role[pos], false);
+        roleIndexSet(pos, rData->deviceRole, true);
+    }
+    nt.role[pos] = rData->deviceRole;
+    linkUpdate(pos, (uint16_t)rData->packetID, count, nt.lastReceivedMs[pos] == 0);
+
+    nt.hitNear[pos] = points16(rData->hitPointsNear);
+    nt.hitMiddle[pos] = points16(rData->hitPointsMiddle);
+    nt.hitFar[pos] = points16(rData->hitPointsFar);
+
+    expiryUpdate(pos, lastMs, count, live);
+    nt.lastReceivedMs[pos] = lastMs;
+    nt.rssi[pos] = rssi8(rssi);
 
-        // Serial.printf("----->>> AP PORTAL BEACON: %d\r\n", dRecords[i].rssi);
-        if (dRecords[i].rssi > rssiLevel)
-            wasPortal = true;
+    if (nt.rssiCount[pos] == 0)
+    {
+        nt.rssiMin[pos] = rssi8(rssiMin);
+        nt.rssiMax[pos] = rssi8(rssiMax);
+    }
+    else
+    {
+        if (rssiMin < nt.rssiMin[pos])
+            nt.rssiMin[pos] = rssi8(rssiMin);
+        if (rssiMax > nt.rssiMax[pos])
+            nt.rssiMax[pos] = rssi8(rssiMax);
+    }
+    nt.rssiSum[pos] += rssiSum;
+    nt.rssiCount[pos] += count;
+
+    int sample = (count > 1) ? (int)(rssiSum / count) : rssi;
+    if (!replayActive)
+    {
+        rxRecorderLog(rData, lastMs, sample);
+    }
+    tuneRssiFilter(false);
+    int filtered = rssiFilterUpdate(nt.filter[pos], rssiCfg, sample);
+    nt.rssiFiltered[pos] = rssi8(filtered);
+    nt.zone[pos] = rssiClassifyZone(nt.filter[pos], rssiCfg, filtered, self.rssiFar, self.rssiMiddle, self.rssiClose);
+
+    totalsIntegrate(lastMs);
+    totalsCount(pos, 1);
+    totalsPoints(pos, 1);
+    listAppend(pos, DREC_LIST_PRESENT);
+}
+
+void addScannedRecord(tEspPacket *rData, unsigned long lastMs, int rssi)
+{
+    addScannedAggregate(rData, lastMs, rssi, rssi, rssi, rssi, 1);
+}
 
-        dRecords[i].deviceID = 0;
+void printScannedRecords(tGameRole filterRole)
+{
+    // through the log ring like the records themselves, so the lines keep their order
+    LOGR(lmRecords, llInfo, ">>>>>>>>>>>>>>> RECORDS LIST <<<<<<<<<<<<<<<<<<\r\n");
+    self.print();
+    LOGR(lmRecords, llInfo, "----\r\n");
+    for (int i = 0; i < dRecCount; i++)
+    {
+        if ((filterRole != grNone) && (filterRole != nt.role[i]))
+        {
+            continue;
+        }
+        printNeighbor(i);
     }
+    LOGR(lmRecords, llInfo, "===============================================\r\n");
+}
+
+static void fillNeighbor(uint16_t pos, tNeighborRecord *n)
+{
+    uint16_t count = nt.rssiCount[pos];
+    n->deviceID = nt.deviceID[pos];
+    n->deviceRole = (tGameRole)nt.role[pos];
+    n->lastReceivedMs = nt.lastReceivedMs[pos];
+    n->hitPointsNear = nt.hitNear[pos];
+    n->hitPointsMiddle = nt.hitMiddle[pos];
+    n->hitPointsFar = nt.hitFar[pos];
+    n->rssi = nt.rssi[pos];
+    n->rssiFiltered = nt.rssiFiltered[pos];
+    n->rssiMin = count ? nt.rssiMin[pos] : nt.rssi[pos];
+    n->rssiMax = count ? nt.rssiMax[pos] : nt.rssi[pos];
+    n->rssiMean = count ? (int16_t)(nt.rssiSum[pos] / count) : nt.rssi[pos];
+    n->rssiCount = count;
+    n->zone = (tRssiZone)nt.zone[pos];
+    n->pdrPct = linkPdrPct(pos);
+    n->lossBurst = nt.lossBurst[pos];
+    n->intervalMs = (uint16_t)min(nt.intervalQ4[pos] >> 4, (uint32_t)UINT16_MAX);
+}
 
-    return wasPortal;
+uint16_t copyScannedRecords(tNeighborRecord *dst, uint16_t maxCount)
+{
+    uint16_t count = min(dRecCount, maxCount);
+    for (uint16_t i = 0; i < count; i++)
+    {
+        fillNeighbor(i, &dst[i]);
+    }
+    return count;
+}
+
+bool hasRoleAboveRssi(tGameRole role, int rssiLevel)
+{
+    int slot = roleIndexSlot(role);
+    if (slot < 0)
+    {
+        return false;
+    }
+    for (int w = 0; w < DREC_ROLE_WORDS; w++)
+    {
+        uint32_t bits = dRecRoleBits[slot][w];
+        while (bits)
+        {
+            int pos = (w << 5) + __builtin_ctz(bits);
+            bits &= bits - 1;
+            if ((pos < dRecCount) && (nt.rssi[pos] > rssiLevel))
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+uint16_t getRoleRecordCount(tGameRole role)
+{
+    int slot = roleIndexSlot(role);
+    uint16_t count = 0;
+    if (slot < 0)
+    {
+        return 0;
+    }
+    for (int w = 0; w < DREC_ROLE_WORDS; w++)
+    {
+        count += __builtin_popcount(dRecRoleBits[slot][w]);
+    }
+    return count;
+}
+
+// Portal beacons stay in the table (they add no points) and age out like any other sender
+bool checkIfApPortal(int rssiLevel)
+{
+    return hasRoleAboveRssi(grApPortalBeacon, rssiLevel);
 }
 
 static void self2tx(void)
@@ -209,18 +941,69 @@ static void self2tx(void)
     selfTxPacket.hitPointsFar = self.hitPointsFar;
 }
 
+// Makes prof the self record, health starts over from the profile
+static void applyRoleProfile(const tRoleProfile *prof)
+{
+    self = prof->rec;
+    rssiCfg = prof->rssiCfg;
+    roleRssiFilter = rssiCfg.type;
+    tuneRssiFilter(true);
+    radioProfile = prof->radio;
+    damageTickMs = prof->damageTickMs;
+    dwellHoldMs = prof->dwellHoldMs;
+    selfArbiter = prof->baseArbiter;
+    linkWeight = prof->linkWeight;
+    hitCurve = prof->hitCurve;
+    healCurve = prof->healCurve;
+    self2tx();
+    scanTotalsDirty = true;
+}
+
+bool loadRoleProfile(String fName)
+{
+    String jsonStr;
+    tRoleProfile prof;
+    if (!readJsonFile(fName, jsonStr) || !roleProfileFromJson(jsonStr, prof))
+    {
+        Serial.printf("!!! loadRoleProfile ERROR: [%s]\r\n", fName.c_str());
+        return false;
+    }
+    int slot = roleProfileSlot(prof.rec.deviceRole);
+    if (slot < 0)
+    {
+        Serial.printf("!!! loadRoleProfile ERROR: [%s] has no playable role\r\n", fName.c_str());
+        return false;
+    }
+    prof.fileName = fName;
+    roleProfiles[slot] = prof;
+    Serial.printf(">>> loadRoleProfile: [%s] -> %s\r\n", fName.c_str(), role2str(prof.rec.deviceRole));
+    return true;
+}
+
+bool setSelfRole(tGameRole role)
+{
+    int slot = roleProfileSlot(role);
+    if ((slot < 0) || !roleProfiles[slot].loaded)
+    {
+        return false;
+    }
+    applyRoleProfile(&roleProfiles[slot]);
+    return true;
+}
+
 bool setSelfJson(String jsonS, bool print)
 {
-    bool res = self.setJson(jsonS, true);
+    bool res = roleProfileFromJson(jsonS, adHocProfile);
     if (res)
     {
+        adHocProfile.fileName = "";
+        applyRoleProfile(&adHocProfile);
         if (print)
         {
-            Serial.println(">>> SELF record is set to:");
+            LOGR(lmRecords, llInfo, ">>> SELF record is set to:\r\n");
             self.print();
-            Serial.println("\n=========================");
+            LOGR(lmRecords, llInfo, "=========================\r\n");
         }
-        self2tx();
     }
     else
     {
@@ -232,12 +1015,25 @@ bool setSelfJson(String jsonS, bool print)
 bool setSelfJsonFromFile(String fName)
 {
     Serial.printf(">>> setSelfJsonFromFile [%s]: START\r\n", fName.c_str());
-    bool res = self.setJsonFromFile(fName, true);
+    for (int i = 0; i < ROLE_PROFILE_COUNT; i++)
+    {
+        if (roleProfiles[i].loaded && (roleProfiles[i].fileName == fName))
+        {
+            applyRoleProfile(&roleProfiles[i]);
+            Serial.println(">>> setSelfJsonFromFile: OK (preloaded)");
+            self.print();
+            return true;
+        }
+    }
+
+    String jsonStr;
+    bool res = readJsonFile(fName, jsonStr) && roleProfileFromJson(jsonStr, adHocProfile);
     if (res)
     {
+        adHocProfile.fileName = fName;
+        applyRoleProfile(&adHocProfile);
         Serial.println(">>> setSelfJsonFromFile: OK");
         self.print();
-        self2tx();
     }
     else
     {
@@ -251,26 +1047,40 @@ tEspPacket *getSelfTxPacket(void)
     return &selfTxPacket;
 }
 
+const tRadioProfile *getSelfRadioProfile(void)
+{
+    return &radioProfile;
+}
+
 tDeviceDataRecord *getSelfDataRecord(void)
 {
     return &self;
 }
 
-static int rssi2points(tDeviceDataRecord *rec, String &rangeName)
+// Debug variant for the RSSI monitor, the game loop uses zonePoints() via scanTotals
+static int rssi2pointsDebug(const tNeighborRecord *rec, String &rangeName)
 {
-    if (rec->rssi < self.rssiFar)
+    const tRssiCurve &curve = (rec->deviceRole == grBase) ? healCurve : hitCurve;
+    if (curve.on)
+    {
+        int points = rssiCurvePoints(curve, rec->rssiFiltered, rec->hitPointsNear);
+        rangeName = " (CURVE:" + String(points) + ")";
+        return points;
+    }
+
+    if (rec->zone == rzOut)
     {
         rangeName = " (OUT:0)";
         return 0;
     }
 
-    if (rec->rssi > self.rssiClose)
+    if (rec->zone == rzClose)
     {
         rangeName = " (CLOSE:" + String(rec->hitPointsNear) + ")";
         return rec->hitPointsNear;
     }
 
-    if (rec->rssi > self.rssiMiddle)
+    if (rec->zone == rzMiddle)
     {
         rangeName = " (MIDDLE:" + String(rec->hitPointsMiddle) + ")";
         return rec->hitPointsMiddle;
@@ -280,6 +1090,47 @@ static int rssi2points(tDeviceDataRecord *rec, String &rangeName)
     return rec->hitPointsFar;
 }
 
+void publishNeighborSnapshot(void)
+{
+    if (scanTotalsDirty)
+    {
+        scanTotalsDirty = false;
+        for (uint16_t i = 0; i < dRecCount; i++)
+        {
+            nt.zone[i] = rssiClassifyZone(nt.filter[i], rssiCfg, nt.rssiFiltered[i], self.rssiFar, self.rssiMiddle, self.rssiClose);
+        }
+        recomputeTotals(recNowMs());
+    }
+    evictRecords(DREC_EVICT_MS);
+
+    tNeighborSnapshot *snap = &snapBufs[snapBack];
+    snap->count = 0;
+    for (uint8_t list = DREC_LIST_PRESENT; list <= DREC_LIST_RECENT; list++)
+    {
+        for (int16_t pos = recLists[list].head; pos >= 0; pos = nt.lruNext[pos])
+        {
+            fillNeighbor(pos, &snap->recs[snap->count++]);
+        }
+    }
+    memset(nt.rssiCount, 0, dRecCount * sizeof(nt.rssiCount[0]));
+    memset(nt.rssiSum, 0, dRecCount * sizeof(nt.rssiSum[0]));
+    snap->totals = scanTotals;
+    snap->publishedMs = recNowMs();
+
+    uint8_t prev = __atomic_exchange_n(&snapMiddle, (uint8_t)(snapBack | SNAP_FRESH), __ATOMIC_ACQ_REL);
+    snapBack = prev & 0x03;
+}
+
+const tNeighborSnapshot *getNeighborSnapshot(void)
+{
+    if (snapMiddle & SNAP_FRESH)
+    {
+        uint8_t prev = __atomic_exchange_n(&snapMiddle, snapFront, __ATOMIC_ACQ_REL);
+        snapFront = prev & 0x03;
+    }
+    return &snapBufs[snapFront];
+}
+
 static bool loopRssiMonitor(void)
 {
     String deviceS, roleS, rssiS, rangeS;
@@ -289,32 +1140,22 @@ static bool loopRssiMonitor(void)
     {
         return false;
     }
-    for (int i = 0; i < MAX_REC_COUNT; i++)
+    const tNeighborSnapshot *snap = getNeighborSnapshot();
+    for (int i = 0; i < snap->count; i++)
     {
-
-        if (!dRecords[i].deviceID)
+        if (snap->recs[i].rssi > maxRssi)
         {
-            continue;
-        }
-
-        if (millis() - dRecords[i].lastReceivedMs > gameLoopIntMs)
-        {
-            continue;
-        }
-
-        if (dRecords[i].rssi > maxRssi)
-        {
-            maxRssi = dRecords[i].rssi;
+            maxRssi = snap->recs[i].rssi;
             maxPos = i;
         }
     }
 
     if (maxPos >= 0)
     {
-        deviceS = dRecords[maxPos].deviceID;
-        roleS = role2str(dRecords[maxPos].deviceRole);
-        rssi2points(&dRecords[maxPos], rangeS);
-        rssiS = String(dRecords[maxPos].rssi) + rangeS;
+        deviceS = snap->recs[maxPos].deviceID;
+        roleS = role2str(snap->recs[maxPos].deviceRole);
+        rssi2pointsDebug(&snap->recs[maxPos], rangeS);
+        rssiS = String(snap->recs[maxPos].rssi) + rangeS;
     }
     else
     {
@@ -327,17 +1168,44 @@ static bool loopRssiMonitor(void)
     return true;
 }
 
+// Converts the new part of the damage integral into health, zone points are per
+// game loop interval and the snapshot integrals are in point * ms
+static void applyTotals(const tScanTotals &totals, int &hitPoints, int &healPoints)
+{
+    int64_t hitTotal = totals.hitPointMs / gameLoopIntMs;
+    int64_t healTotal = totals.healPointMs / gameLoopIntMs;
+    hitPoints = (int)(hitTotal - hitApplied);
+    healPoints = (int)(healTotal - healApplied);
+    hitApplied = hitTotal;
+    healApplied = healTotal;
+    self.health += healPoints;
+    self.health += hitPoints;
+}
+
+static void resetApplied(void)
+{
+    const tNeighborSnapshot *snap = getNeighborSnapshot();
+    hitApplied = snap->totals.hitPointMs / gameLoopIntMs;
+    healApplied = snap->totals.healPointMs / gameLoopIntMs;
+}
+
 bool loopScanRecords(tGameRole &deviceRole, int &zCount, int &hCount, int &bCount, int &healPoints, int &hitPoints, int &healthPoints, bool &base)
 {
     static uint32_t lastLoopedMs = 0;
-    String tmpS;
+    static tGameRole lastRole = grNone;
+    int hitDelta, healDelta;
+
+    if (replayActive)
+    {
+        return false;
+    }
 
     if (loopRssiMonitor())
     {
         return true;
     }
 
-    if (millis() - lastLoopedMs < gameLoopIntMs)
+    if (millis() - lastLoopedMs < damageTickMs)
     {
         return false;
     }
@@ -354,71 +1222,141 @@ bool loopScanRecords(tGameRole &deviceRole, int &zCount, int &hCount, int &bCoun
         base = false;
     }
 
-    zCount = hCount = bCount = healPoints = hitPoints = 0;
+    if (self.deviceRole != lastRole)
+    {
+        // damage integrated for the previous role is not carried over
+        lastRole = self.deviceRole;
+        resetApplied();
+    }
+
+    const tNeighborSnapshot *snap = getNeighborSnapshot();
+    zCount = snap->totals.zCount;
+    hCount = snap->totals.hCount;
+    bCount = snap->totals.bCount;
+    hitPoints = snap->totals.hitPoints;
+    healPoints = snap->totals.healPoints;
+
+    // an arbiter base in range decides, the local integral only keeps its baseline
+    if (espArbiterHeard() && base == false)
+    {
+        resetApplied();
+    }
+    else
+    {
+        applyTotals(snap->totals, hitDelta, healDelta);
+    }
+    self.health += espArbiterTake();
     healthPoints = self.health;
+    return true;
+}
 
-    for (int i = 0; i < MAX_REC_COUNT; i++)
+void recordsStartScoring(void)
+{
+    resetApplied();
+    espArbiterTake();
+}
+
+static void resetRecords(void)
+{
+    for (uint16_t i = 0; i < dRecCount; i++)
     {
-        if (!dRecords[i].deviceID)
-        {
-            continue;
-        }
+        clearSlot(i);
+    }
+    dRecCount = 0;
+    for (int i = 0; i < DREC_LIST_COUNT; i++)
+    {
+        recLists[i] = tRecList();
+    }
+    memset(dRecRoleBits, 0, sizeof(dRecRoleBits));
+    scanTotals = tScanTotals();
+    scanTotals.integratedMs = recNowMs();
+    rebuildIndex();
+    publishNeighborSnapshot();
+    publishNeighborSnapshot();
+    resetApplied();
+}
 
-        if (millis() - dRecords[i].lastReceivedMs > gameLoopIntMs)
-        {
-            continue;
-        }
+// The caller has to give the radio task a snapshot period to step aside before feeding frames
+void recordsReplayBegin(uint32_t startMs)
+{
+    replaySavedHealth = self.health;
+    replayNowMs = startMs;
+    replayActive = true;
+    delay(RADIO_REPLAY_PARK_MS);
+    resetRecords();
+}
 
-        if (dRecords[i].deviceRole == grZombie)
-        {
-            zCount++;
-        }
+void recordsReplaySetClock(uint32_t ms)
+{
+    replayNowMs = ms;
+}
 
-        if (dRecords[i].deviceRole == grHuman)
-        {
-            hCount++;
-        }
+void recordsReplayTick(int &health, int &hitPoints, int &healPoints)
+{
+    publishNeighborSnapshot();
+    applyTotals(getNeighborSnapshot()->totals, hitPoints, healPoints);
+    health = self.health;
+}
 
-        if (dRecords[i].deviceRole == grBase)
-        {
-            bCount++;
-        }
+void recordsReplayEnd(void)
+{
+    resetRecords();
+    self.health = replaySavedHealth;
+    replayActive = false;
+}
 
-        if (dRecords[i].isZomboHum())
-        {
-            if (self.deviceRole != dRecords[i].deviceRole)
-            {
-                int hp = rssi2points(&dRecords[i], tmpS);
-                hitPoints += hp;
-            }
-        }
+bool recordsReplayActive(void)
+{
+    return replayActive;
+}
 
-        if (dRecords[i].isBase())
-        {
-            int hp = rssi2points(&dRecords[i], tmpS);
-            healPoints += hp;
-        }
-    }
-    self.health += healPoints;
-    self.health += hitPoints;
-    healthPoints = self.health;
-    return true;
+int getDamageTickMs(void)
+{
+    return damageTickMs;
+}
+
+int getGameLoopIntMs(void)
+{
+    return gameLoopIntMs;
 }
 
+bool getSelfArbiter(void)
+{
+    return selfArbiter && (self.deviceRole == grBase);
+}
+
+// Swaps zombie <-> human. With the profiles preloaded this is a table lookup,
+// otherwise only the role flips and health restarts from the current profile.
 tGameRole revertGameRole(void)
 {
+    tGameRole newRole;
     if (self.deviceRole == grZombie)
     {
-        self.deviceRole = grHuman;
-        Serial.println("--->>> Converted to HUMAN");
-        return self.deviceRole;
+        newRole = grHuman;
+    }
+    else if (self.deviceRole == grHuman)
+    {
+        newRole = grZombie;
+    }
+    else
+    {
+        return grNone;
     }
 
-    if (self.deviceRole == grHuman)
+    if (!setSelfRole(newRole))
     {
-        self.deviceRole = grZombie;
-        Serial.println("--->>> Converted to ZOMBIE");
-        return self.deviceRole;
+        Serial.printf("*** revertGameRole: no %s profile loaded\r\n", role2str(newRole));
+        self.deviceRole = newRole;
+        self.health = self.beginHealth;
+        self2tx();
+        scanTotalsDirty = true;
     }
-    return grNone;
+    Serial.println((newRole == grHuman) ? "--->>> Converted to HUMAN" : "--->>> Converted to ZOMBIE");
+    return newRole;
+}
+
+// Devices within their own expiry, radio task only
+uint16_t getLiveRecordCount(void)
+{
+    return scanTotals.active;
 }
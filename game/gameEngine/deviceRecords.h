@@ -3,19 +3,44 @@
 #include <Arduino.h>
 
 #include "espPacket.h"
+#include "espRadio.h"
 #include "gameRole.h"
+#include "rssiFilter.h"
 
 #define GAME_START_FAR_RSSI     -80
 #define GAME_START_MIDDL_RSSI   -65
 #define GAME_START_CLOSE_RSSI   -50
 #define GAME_START_LOOP_INT_MS  1000
+#define GAME_DAMAGE_TICK_MS     100     // health is integrated at this tick, zone points are per GAME_START_LOOP_INT_MS
+#define GAME_DWELL_HOLD_MS      300     // a neighbour keeps dealing damage this long after its last frame
+#define RADIO_REPLAY_PARK_MS    250     // longer than a radio task cycle, see recordsReplayBegin()
 
+#ifndef DREC_HASH_BITS
+#define DREC_HASH_BITS          8       // index size is 1 << DREC_HASH_BITS, keep it >= 2 * MAX_REC_COUNT
+#endif
+#define DREC_HASH_SIZE          (1 << DREC_HASH_BITS)
+#define DREC_EVICT_MS           10000   // devices not heard for this long are dropped from the table
+// A neighbour stops counting once it missed DREC_EXPIRE_INTERVALS of its own
+// observed beacon intervals, bounded; until an interval is seen it gets the
+// game loop interval. Never shorter than its dwell hold.
+#define DREC_EXPIRE_INTERVALS   4
+#define DREC_EXPIRE_MIN_MS      250
+#define DREC_EXPIRE_MAX_MS      3000
+
+// Link quality from the senders' frame sequence (the low 16 bits of packetID
+// on the wire): delivered against sent over about the last DREC_LINK_WINDOW
+// frames, and the longest run of lost ones, which decays with the window
+#define DREC_LINK_WINDOW        32
+#define DREC_LINK_SEQ_JUMP      1024    // a bigger jump is a restarted sender, not lost frames
+#define DREC_LINK_FULL_PCT      80      // with "linkWeight" a link this good or better counts fully
+
+// Self and the role profiles. The neighbours live in a packed table of
+// their own in deviceRecords.cpp, only the fields the frame path touches.
 struct tDeviceDataRecord
 {
     uint64_t deviceID = 0;
     tGameRole deviceRole;   
     uint32_t lastReceivedMs = 0;
-    bool     processed = false;    
     int      hitPointsNear; 
     int      hitPointsMiddle;
     int      hitPointsFar;
@@ -27,17 +52,109 @@ struct tDeviceDataRecord
     int      maxHealth;     
     int  rssi = 0;         
     void print(void);   
-    bool setJson(String jsonStr, bool self = true);
-    bool setJsonFromFile(String filename, bool self);
     inline bool isZomboHum(void) {if (deviceRole == grZombie || deviceRole == grHuman) return true; return false;}
     inline bool isBase(void) {if (deviceRole == grBase) return true; return false;}
 };
 
+#define ROLE_PROFILE_COUNT      4       // zombie, human, base, rssi monitor
+
+// Everything a role JSON configures, parsed once so a role switch needs no file I/O
+struct tRoleProfile
+{
+    bool              loaded = false;
+    String            fileName;
+    tDeviceDataRecord rec;
+    tRssiFilterCfg    rssiCfg;
+    tRadioProfile     radio;
+    int               damageTickMs = GAME_DAMAGE_TICK_MS;
+    int               dwellHoldMs = GAME_DWELL_HOLD_MS;
+    bool              baseArbiter = false;  // a base decides the hits of its zone, see baseArbiter.h
+    bool              linkWeight = false;   // hit and heal points scaled by the sender's delivery ratio
+    tRssiCurve        hitCurve;             // "damageCurve", instead of the zone points of the other side
+    tRssiCurve        healCurve;            // "healCurve", the same for the bases
+};
+
+// Read-only copy of the live neighbours, published by the radio task and
+// consumed by the game loop without locks (triple buffered); expired ones
+// are left out
+struct tNeighborRecord
+{
+    uint64_t  deviceID;
+    tGameRole deviceRole;
+    uint32_t  lastReceivedMs;
+    int       hitPointsNear;
+    int       hitPointsMiddle;
+    int       hitPointsFar;
+    int16_t   rssi;
+    int16_t   rssiFiltered;
+    int16_t   rssiMin;
+    int16_t   rssiMax;
+    int16_t   rssiMean;
+    uint16_t  rssiCount;
+    tRssiZone zone;
+    uint8_t   pdrPct;           // frames delivered of the ones sent, 100 until the sequence says otherwise
+    uint8_t   lossBurst;        // longest run of lost frames, decaying
+    uint16_t  intervalMs;       // observed inter-arrival time, 0 until two frames came
+    inline bool isZomboHum(void) const {if (deviceRole == grZombie || deviceRole == grHuman) return true; return false;}
+    inline bool isBase(void) const {if (deviceRole == grBase) return true; return false;}
+};
+
+// Running sums updated on every received frame and on expiry instead of rescanned.
+// Counts cover the game loop interval, hitPoints/healPoints are the current zone rates
+// of the neighbours within their dwell hold and the *PointMs integrals accumulate them over time
+struct tScanTotals
+{
+    int      zCount = 0;
+    int      hCount = 0;
+    int      bCount = 0;
+    int      hitPoints = 0;
+    int      healPoints = 0;
+    uint16_t active = 0;
+    int64_t  hitPointMs = 0;
+    int64_t  healPointMs = 0;
+    uint32_t integratedMs = 0;
+};
+
+struct tNeighborSnapshot
+{
+    uint32_t        publishedMs = 0;
+    uint16_t        count = 0;
+    tScanTotals     totals;
+    tNeighborRecord recs[MAX_REC_COUNT];
+};
+
+void publishNeighborSnapshot(void);
+const tNeighborSnapshot *getNeighborSnapshot(void);
+
+bool hasRoleAboveRssi(tGameRole role, int rssiLevel);
+uint16_t getRoleRecordCount(tGameRole role);
 bool checkIfApPortal(int rssiLevel);
 void printScannedRecords(tGameRole filterRole = grNone);
+// Debug copy of the live table for other tasks; like printScannedRecords it
+// takes no lock, a record being updated meanwhile may come out mixed
+uint16_t copyScannedRecords(tNeighborRecord *dst, uint16_t maxCount);
 bool setSelfJson(String fName, bool print);
 bool setSelfJsonFromFile(String jsonS);
+bool loadRoleProfile(String fName);
+bool setSelfRole(tGameRole role);
 tEspPacket *getSelfTxPacket(void);
+const tRadioProfile *getSelfRadioProfile(void);
 tDeviceDataRecord *getSelfDataRecord(void);
 bool loopScanRecords(tGameRole &deviceRole, int &zCount, int &hCount, int &bCount, int &healPoints, int &hitPoints, int &healthPoints, bool &base);
 tGameRole revertGameRole(void);
+// Game start: what the warm table integrated in the countdown is not scored
+void recordsStartScoring(void);
+uint16_t getLiveRecordCount(void);
+int getDamageTickMs(void);
+int getGameLoopIntMs(void);
+bool getSelfArbiter(void);
+int zonePoints(tRssiZone zone, int nearPoints, int middlePoints, int farPoints);
+void addScannedRecord(tEspPacket *rData, unsigned long lastMs, int rssi);
+void addScannedAggregate(tEspPacket *rData, unsigned long lastMs, int rssi, int rssiMin, int rssiMax, int32_t rssiSum, uint16_t count);
+
+// Replay of recorded sessions (rxRecorder), the live table is cleared before and after
+void recordsReplayBegin(uint32_t startMs);
+void recordsReplaySetClock(uint32_t ms);
+void recordsReplayTick(int &health, int &hitPoints, int &healPoints);
+void recordsReplayEnd(void);
+bool recordsReplayActive(void);
@@ -9,161 +9,572 @@
 #include "xgConfig.h"
 #include "utils.h"
 #include "board.h"
+#include "warmState.h"
 #include "statusClient.h"
+#include "espRadio.h"
+#include "uplink.h"
+#include "gamePush.h"
+#include "gameMcast.h"
+#include "jsonWriter.h"
+#include "jsonAlloc.h"
+#include "serverSync.h"
+#include "pmLocks.h"
+#include "httpPool.h"
+#include "tunables.h"
 
 static SemaphoreHandle_t gameApiMutex = NULL;
-static TaskHandle_t gameApiTaskHandle = NULL;
+static bool gameApiRegistered = false;
 
 static tGameApiResponse cachedResponse;
 static bool hasNewResult = false;
 
-static String currentRole = "";
-static String currentStatus = "";
+static tGameRole currentRole = grNone;
+static tGameApiStatus currentStatus = gasWait;
 static int currentHealth = 0;
+static tGameApiTelemetry currentTelemetry;
+static tEspReport gatewayReport;
 
-tGameApiRequest::tGameApiRequest()
+static const char *roleNames[GAME_API_ROLE_COUNT] = {"neutral", "zombie", "human", "base", "zwin", "hwin", "draw"};
+static const char *phaseNames[GAME_API_PHASE_COUNT] = {"sleep", "prepare", "distribution", "countdown", "game", "end"};
+static const char *statusNames[GAME_API_STATUS_COUNT] = {"idle", "wait", "GAME_LOOP"};
+
+const char *gameApiRoleName(tGameApiRole role)
 {
-    id = utilsGetDeviceID64Hex();
-    role = "neutral";
-    status = "wait";
+    return (role < GAME_API_ROLE_COUNT) ? roleNames[role] : "neutral";
 }
 
-tGameApiResponse sendDeviceData(tGameApiRequest request, String serverURL)
+const char *gameApiPhaseName(tGameApiPhase phase)
 {
-    tGameApiResponse response;
-    response.success = false;
-    
-    if (WiFi.status() != WL_CONNECTED)
+    return (phase < GAME_API_PHASE_COUNT) ? phaseNames[phase] : "";
+}
+
+const char *gameApiStatusName(tGameApiStatus status)
+{
+    return (status < GAME_API_STATUS_COUNT) ? statusNames[status] : "";
+}
+
+tGameApiRole gameApiRoleFromName(const char *name)
+{
+    for (int i = 0; name && (i < GAME_API_ROLE_COUNT); i++)
     {
-        Serial.println("WiFi not connected");
-        return response;
+        if (strcmp(name, roleNames[i]) == 0)
+        {
+            return (tGameApiRole)i;
+        }
     }
-    
+    return garNeutral;
+}
+
+tGameApiPhase gameApiPhaseFromName(const char *name)
+{
+    for (int i = 0; name && (i < GAME_API_PHASE_COUNT); i++)
+    {
+        if (strcmp(name, phaseNames[i]) == 0)
+        {
+            return (tGameApiPhase)i;
+        }
+    }
+    return gapUnknown;
+}
+
+// One session shared by waitGame(), the API task and the bench, its
+// keep-alive connection is leased from the HTTP pool for each call
+static SemaphoreHandle_t apiSessionMutex = NULL;
+static String apiSessionUrl = "";
+static tJsonArenaAllocator apiRespAllocator(jdkGameApi, JSON_ARENA_GAME_API);   // reset before every parse
+static JsonDocument apiRespDoc(&apiRespAllocator);
+static tJsonArenaAllocator pushRespAllocator(jdkGameApi, JSON_ARENA_GAME_PUSH);  // gamePush task only
+static JsonDocument pushRespDoc(&pushRespAllocator);
+static char apiJsonBuf[GAME_API_JSON_BUF];
+static char apiUrlBuf[GAME_API_URL_BUF];
+static char apiRespBuf[GAME_API_RESP_BUF];
+static uint8_t apiBodyBuf[GAME_API_BODY_BUF];
+static uint8_t apiPostFormat = 0;       // negotiated POST format, 0 = GET
+static bool apiPostRejected = false;    // the server refused a POST, stay on GET
+
+static bool apiSessionLock(void)
+{
+    if (apiSessionMutex == NULL)
+    {
+        apiSessionMutex = xSemaphoreCreateMutex();
+    }
+    return xSemaphoreTake(apiSessionMutex, portMAX_DELAY) == pdTRUE;
+}
+
+void gameApiSessionClose(void)
+{
+    if (apiSessionLock())
+    {
+        httpPoolCloseAll();
+        apiSessionUrl = "";
+        xSemaphoreGive(apiSessionMutex);
+    }
+}
+
+// Percent-encodes everything outside the RFC 3986 unreserved set,
+// returns the encoded length or -1 if it does not fit
+static int urlEncodeTo(char *dst, size_t dstSize, const char *src)
+{
+    static const char hex[] = "0123456789ABCDEF";
+    size_t n = 0;
+    for (; *src; src++)
+    {
+        uint8_t c = (uint8_t)*src;
+        if (isalnum(c) || (c == '-') || (c == '_') || (c == '.') || (c == '~'))
+        {
+            if (n + 1 >= dstSize)
+                return -1;
+            dst[n++] = c;
+        }
+        else
+        {
+            if (n + 3 >= dstSize)
+                return -1;
+            dst[n++] = '%';
+            dst[n++] = hex[c >> 4];
+            dst[n++] = hex[c & 0x0F];
+        }
+    }
+    dst[n] = 0;
+    return n;
+}
+
+static bool putBinString(size_t &n, const char *str)
+{
+    size_t len = min(strlen(str), (size_t)255);
+    if (n + 1 + len > sizeof(apiBodyBuf))
+    {
+        return false;
+    }
+    apiBodyBuf[n++] = len;
+    memcpy(apiBodyBuf + n, str, len);
+    n += len;
+    return true;
+}
+
+// Fixed-layout body, see tGameApiBinHeader; returns its length or -1
+static int buildBinBody(const tGameApiRequest &request, const char *name, int rssi)
+{
+    const tGameApiTelemetry &tel = request.telemetry;
+    tGameApiBinHeader hdr;
+    hdr.magic = GAME_API_BIN_MAGIC;
+    hdr.version = GAME_API_BIN_VERSION;
+    hdr.neighborCount = min(tel.neighborCount, (uint8_t)GAME_API_NEIGHBORS);
+    hdr.ip = (uint32_t)WiFi.localIP();
+    hdr.rssi = (int8_t)constrain(rssi, -128, 127);
+    hdr.battery = (uint8_t)constrain(boardGetVccPercent(), 0, 255);
+    hdr.health = (int16_t)constrain(request.health, -32768, 32767);
+    hdr.zCount = tel.zCount;
+    hdr.hCount = tel.hCount;
+    hdr.bCount = tel.bCount;
+    hdr.apChannel = espApChannel();
+    size_t n = protoEncode(hdr, apiBodyBuf, sizeof(apiBodyBuf), GAME_API_BIN_VERSION);
+    if (!putBinString(n, name) || !putBinString(n, gameApiDeviceRoleName(request.role)) ||
+        !putBinString(n, gameApiStatusName(request.status)) || !putBinString(n, request.comment))
+    {
+        return -1;
+    }
+    for (int i = 0; i < hdr.neighborCount; i++)
+    {
+        tGameApiBinNeighbor nb;
+        nb.id = tel.neighbors[i].id;
+        nb.role = tel.neighbors[i].role;
+        nb.rssi = tel.neighbors[i].rssi;
+        nb.zone = tel.neighbors[i].zone;
+        nb.pdr = tel.neighbors[i].pdr;
+        size_t len = protoEncode(nb, apiBodyBuf + n, sizeof(apiBodyBuf) - n, GAME_API_BIN_VERSION);
+        if (len == 0)
+        {
+            return -1;
+        }
+        n += len;
+    }
+    return n;
+}
+
+static void fillResponse(JsonDocument &doc, tGameApiResponse &response)
+{
+    response.game_duration = doc["game_duration"];
+    response.game_timeout = doc["game_timeout"];
+    response.role = gameApiRoleFromName(doc["role"] | "neutral");
+    response.status = gameApiPhaseFromName(doc["status"] | "");
+    response.beacon_slot = doc["beacon_slot"] | -1;
+    response.beacon_slots = doc["beacon_slots"] | 0;
+    response.beacon_frame_ms = doc["beacon_frame_ms"] | 0;
+    response.server_ms = doc["server_ms"] | 0ULL;
+    response.phase_end_ms = doc["phase_end_ms"] | 0ULL;
+    response.channel = doc["channel"] | 0;
+    response.protocol_id = doc["protocol_id"] | 0UL;
+    strlcpy(response.asset_roles, doc["asset_roles"] | "", sizeof(response.asset_roles));
+    response.next_poll_ms = doc["next_poll_ms"] | 0UL;
+    if (response.next_poll_ms)
+    {
+        response.next_poll_ms = constrain(response.next_poll_ms, (uint32_t)GAME_API_POLL_MIN_MS, (uint32_t)GAME_API_POLL_MAX_MS);
+    }
+    response.event_start_ms = doc["event_start_ms"] | -1LL;
+    response.wake_window_ms = doc["wake_window_ms"] | 0UL;
+    response.fw_apply = doc["fw_apply"] | false;
+    response.success = true;
+}
+
+// The timer wake for the next event, from a round trip so server_ms is fresh
+static void scheduleEventWake(const tGameApiResponse &response)
+{
+    static int64_t scheduledFor = -1;
+    if ((response.event_start_ms < 0) || (response.server_ms == 0))
+    {
+        return;
+    }
+    // 0 or a start in the past: no event ahead
+    int64_t leftMs = response.event_start_ms - (int64_t)response.server_ms;
+    if (leftMs <= 0)
+    {
+        if (scheduledFor > 0)
+        {
+            Serial.println(">>> scheduleEventWake: event cleared");
+        }
+        scheduledFor = 0;
+        boardSetWakeIn(0);
+        return;
+    }
+
+    uint32_t windowMs = response.wake_window_ms ? response.wake_window_ms : GAME_WAKE_WINDOW_MS;
+    uint32_t slot = ConfigAPI::getDeviceID() % GAME_WAKE_SLOTS;
+    int64_t beforeMs = GAME_WAKE_READY_MS + (int64_t)windowMs * (GAME_WAKE_SLOTS - slot) / GAME_WAKE_SLOTS;
+    uint32_t inS = (leftMs > beforeMs) ? (uint32_t)((leftMs - beforeMs) / 1000) : 0;
+    boardSetWakeIn(inS);
+    if (scheduledFor != response.event_start_ms)
+    {
+        scheduledFor = response.event_start_ms;
+        Serial.printf(">>> scheduleEventWake: event in %lld s, slot %u, timer wake in %u s\r\n",
+                      (long long)(leftMs / 1000), slot, inS);
+    }
+}
+
+// Pushed states use the same fields as the /api/device response
+bool gameApiParseResponse(const char *json, size_t len, tGameApiResponse &resp)
+{
+    resp.success = false;
+    pushRespAllocator.reset();
+    if (deserializeJson(pushRespDoc, json, len))
+    {
+        return false;
+    }
+    fillResponse(pushRespDoc, resp);
+    return true;
+}
+
+// Reads the response body into apiRespBuf, returns its length or -1
+static int readResponseBody(tHttpLease &lease)
+{
+    HTTPClient &apiHttp = lease.http();
+    int len = apiHttp.getSize();
+    if ((len > 0) && (len < GAME_API_RESP_BUF))
+    {
+        WiFiClient *stream = apiHttp.getStreamPtr();
+        int got = stream ? stream->readBytes(apiRespBuf, len) : 0;
+        if (got != len)
+        {
+            // the rest of the body would be read as the next response
+            lease.drop();
+            return -1;
+        }
+        apiRespBuf[len] = 0;
+        return len;
+    }
+
+    // chunked or oversized body, let HTTPClient decode it
+    String payload = apiHttp.getString();
+    if (payload.length() >= GAME_API_RESP_BUF)
+    {
+        return -1;
+    }
+    memcpy(apiRespBuf, payload.c_str(), payload.length() + 1);
+    return payload.length();
+}
+
+// Device report as JSON, the telemetry only goes into POST bodies
+static void writeRequestJson(tJsonWriter &json, const tGameApiRequest &request, uint32_t deviceIP, int rssi, bool telemetry)
+{
+    json.beginObject();
+    json.field("id", statusClientGetName());//request.id;
+    json.fieldIp("ip", deviceIP);
+    json.field("rssi", rssi);
+    json.field("role", gameApiDeviceRoleName(request.role));
+    json.field("status", gameApiStatusName(request.status));
+    json.field("health", request.health);
+    json.field("battery", boardGetVccPercent());//request.battery;
+    json.field("comment", request.comment);
+    json.field("ap_ch", espApChannel());
+    if (telemetry)
+    {
+        const tGameApiTelemetry &tel = request.telemetry;
+        json.field("z", tel.zCount);
+        json.field("h", tel.hCount);
+        json.field("b", tel.bCount);
+        json.beginArray("neighbors");
+        for (int i = 0; i < min(tel.neighborCount, (uint8_t)GAME_API_NEIGHBORS); i++)
+        {
+            json.beginArray();
+            json.value((unsigned long long)tel.neighbors[i].id);
+            json.value(tel.neighbors[i].role);
+            json.value(tel.neighbors[i].rssi);
+            json.value(tel.neighbors[i].zone);
+            json.value(tel.neighbors[i].pdr);
+            json.endArray();
+        }
+        json.endArray();
+    }
+    json.endObject();
+}
+
+static tGameApiResponse sendDeviceDataLocked(const tGameApiRequest &request, const char *serverURL)
+{
+    tGameApiResponse response;
+    response.success = false;
+
     // Get WiFi info automatically
-    String deviceIP = WiFi.localIP().toString();
+    uint32_t deviceIP = (uint32_t)WiFi.localIP();
     int rssi = WiFi.RSSI();
-    
-    // Create JSON data string
-    JsonDocument jsonDoc;
-    jsonDoc["id"] = statusClientGetName();//request.id;
-    jsonDoc["ip"] = deviceIP;
-    jsonDoc["rssi"] = rssi;
-    jsonDoc["role"] = request.role;
-    jsonDoc["status"] = request.status;
-    jsonDoc["health"] = request.health;
-    jsonDoc["battery"] =  boardGetVccPercent();//request.battery;
-    jsonDoc["comment"] = request.comment;
-    
-    String jsonString;
-    serializeJson(jsonDoc, jsonString);
-    
-    // URL encode the JSON string for GET parameter
-    String encodedJson = "";
-    for (int i = 0; i < jsonString.length(); i++) {
-        char c = jsonString.charAt(i);
-        if (c == ' ') {
-            encodedJson += "%20";
-        } else if (c == '"') {
-            encodedJson += "%22";
-        } else if (c == '{') {
-            encodedJson += "%7B";
-        } else if (c == '}') {
-            encodedJson += "%7D";
-        } else if (c == ':') {
-            encodedJson += "%3A";
-        } else if (c == ',') {
-            encodedJson += "%2C";
-        } else {
-            encodedJson += c;
+
+    // the negotiated format belongs to the previous server, the pool keys its connection by host
+    if (apiSessionUrl != serverURL)
+    {
+        apiSessionUrl = serverURL;
+        apiPostFormat = 0;
+        apiPostRejected = false;
+    }
+
+    uint8_t postFormat = apiPostRejected ? 0 : apiPostFormat;
+    int bodyLen = -1;
+    if (postFormat == GAME_API_FMT_BIN)
+    {
+        bodyLen = buildBinBody(request, statusClientGetName(), rssi);
+    }
+    else if (postFormat == GAME_API_FMT_JSON)
+    {
+        tJsonWriter json((char *)apiBodyBuf, sizeof(apiBodyBuf));
+        writeRequestJson(json, request, deviceIP, rssi, true);
+        bodyLen = json.ok() ? (int)json.length() : -1;
+    }
+    if ((postFormat != 0) && (bodyLen < 0))
+    {
+        Serial.println("*** sendDeviceData: request does not fit the POST body, using GET");
+        postFormat = 0;
+    }
+
+    if (postFormat != 0)
+    {
+        snprintf(apiUrlBuf, sizeof(apiUrlBuf), "%s/api/device", serverURL);
+    }
+    else
+    {
+        tJsonWriter json(apiJsonBuf, sizeof(apiJsonBuf));
+        writeRequestJson(json, request, deviceIP, rssi, false);
+        if (!json.ok())
+        {
+            Serial.println("!!! sendDeviceData ERROR: request does not fit the JSON buffer");
+            return response;
+        }
+
+        // Build complete URL with data parameter
+        int baseLen = snprintf(apiUrlBuf, sizeof(apiUrlBuf), "%s/api/device?data=", serverURL);
+        if ((baseLen <= 0) || (baseLen >= (int)sizeof(apiUrlBuf)) ||
+            (urlEncodeTo(apiUrlBuf + baseLen, sizeof(apiUrlBuf) - baseLen, apiJsonBuf) < 0))
+        {
+            Serial.println("!!! sendDeviceData ERROR: request does not fit the URL buffer");
+            return response;
         }
     }
-    
-    // Build complete URL with data parameter
-    String fullURL = serverURL + "/api/device?data=" + encodedJson;
-    
-    //Serial.println("Sending GET request to: " + fullURL);
-    
-    HTTPClient http;
-    http.begin(fullURL);
+
+    tHttpLease lease(apiUrlBuf);
+    HTTPClient &apiHttp = lease.http();
+    if (!lease.begin(apiUrlBuf))
+    {
+        Serial.println("!!! sendDeviceData ERROR: bad server URL");
+        return response;
+    }
     uint32_t startMs = millis();
-    int httpResponseCode = http.GET();
-    response.respTimeMs = millis() - startMs;
+    int httpResponseCode;
+    if (postFormat != 0)
+    {
+        apiHttp.addHeader("Content-Type", (postFormat == GAME_API_FMT_BIN) ? GAME_API_CT_BIN : GAME_API_CT_JSON);
+        httpResponseCode = apiHttp.POST(apiBodyBuf, bodyLen);
+    }
+    else
+    {
+        httpResponseCode = apiHttp.GET();
+    }
+    response.rxMs = millis();
+    response.respTimeMs = response.rxMs - startMs;
+
+    // an older server or a proxy that does not take the POST: fall back for good
+    bool postRefused = (postFormat != 0) && (httpResponseCode >= 400) && (httpResponseCode < 500);
+    if (postRefused)
+    {
+        Serial.printf("*** sendDeviceData: POST refused with %d, back to GET\r\n", httpResponseCode);
+        apiPostRejected = true;
+    }
 
-    
     if (httpResponseCode > 0)
     {
-        String responsePayload = http.getString();
-        // Serial.println("HTTP Response Code: " + String(httpResponseCode));
-        // Serial.println("Response: " + responsePayload);
-        
+        // the server clock is read against the headers, the body may take longer
+        uint32_t headersMs = response.rxMs;
+        int respLen = readResponseBody(lease);
+        response.rxMs = millis();
+        response.respTimeMs = response.rxMs - startMs;
+
         // Parse JSON response
-        DynamicJsonDocument responseDoc(1024);
-        DeserializationError error = deserializeJson(responseDoc, responsePayload);
-        
+        apiRespAllocator.reset();
+        DeserializationError error = (respLen >= 0) ? deserializeJson(apiRespDoc, apiRespBuf, respLen)
+                                                    : DeserializationError(DeserializationError::NoMemory);
+
         if (!error)
         {
-            response.game_duration = responseDoc["game_duration"];
-            response.game_timeout = responseDoc["game_timeout"];
-            response.role = responseDoc["role"].as<String>();
-            response.status = responseDoc["status"].as<String>();
-            response.success = true;
+            fillResponse(apiRespDoc, response);
+            espClockServerSample(response.server_ms, startMs, headersMs);
+            scheduleEventWake(response);
+
+            uint8_t formats = apiRespDoc["api_formats"] | 0;
+            apiPostFormat = (formats & GAME_API_FMT_BIN) ? GAME_API_FMT_BIN : (formats & GAME_API_FMT_JSON);
+            response.success = !postRefused;
         }
         else
         {
             Serial.println("Failed to parse JSON response");
         }
+        apiRespDoc.clear();
     }
     else
     {
         Serial.println("HTTP request failed with code: " + String(httpResponseCode));
+        lease.drop();
     }
-    
-    http.end();
+
+    // keeps the TCP connection open for the next call when the server allows it
+    apiHttp.end();
     return response;
 }
 
-tGameRole waitGame(uint16_t &preTimeoutMs, uint32_t toMs)
+tGameApiResponse sendDeviceData(const tGameApiRequest &request, const char *serverURL)
 {
-    String serverURL = ConfigAPI::getGameServerUrl();
-    uint32_t startMs = millis();
-    tGameApiRequest req;
-    tGameRole res;
+    tGameApiResponse response;
+    response.success = false;
+
+    if (WiFi.status() != WL_CONNECTED)
+    {
+        Serial.println("WiFi not connected");
+        return response;
+    }
+
+    if (!apiSessionLock())
+    {
+        return response;
+    }
+    pmAcquire(plHttp);
+    response = sendDeviceDataLocked(request, serverURL);
+    pmRelease(plHttp);
+    xSemaphoreGive(apiSessionMutex);
+    return response;
+}
+
+static const char *waitServerURL = "";
+static uint32_t waitNextPollMs = 0;
+static bool waitRest = false;
+
+void waitGameBegin(bool rest)
+{
+    waitRest = rest;
+    waitServerURL = ConfigAPI::getServerUrl(csGame);
+    waitNextPollMs = millis();
     Serial.print(">>> waitGame: ");
     statusClientSetGameStatus("GAME WAIT");
-    if (serverURL.isEmpty())
+    if (waitServerURL[0] == 0)
     {
-        Serial.println("NO GAME SERVER ERROR!");    
-        statusClientSetGameStatus("NO SERVER");    
-        return grNone;
+        Serial.println("NO GAME SERVER ERROR!");
+        statusClientSetGameStatus("NO SERVER");
+        return;
     }
-    else 
+    tGameApiRequest req;
+    req.print(waitServerURL);
+}
+
+// With the push channel up the device only reports every GAME_PUSH_HEARTBEAT_MS;
+// the report also registers the device before the channel is opened
+// The server knows the phase better than the lobby does: its interval wins
+// over the device's own, except while pushed states make polls pointless
+static uint32_t waitPollIntervalMs(const tGameApiResponse &resp)
+{
+    if (gamePushAlive())
+    {
+        return GAME_PUSH_HEARTBEAT_MS;
+    }
+    if (resp.success && resp.next_poll_ms)
     {
-        req.print(serverURL);
+        uint32_t spread = resp.next_poll_ms * GAME_API_POLL_JITTER_PCT / 100;
+        return resp.next_poll_ms - spread + esp_random() % (2 * spread + 1);
     }
+    return waitRest ? GAME_WAIT_REST_POLL_MS : R2R_INT_MS;
+}
 
-    while(millis() - startMs < toMs)
+tGameRole waitGamePoll(uint16_t &preTimeoutMs)
+{
+    if (waitServerURL[0] == 0)
+    {
+        return grNone;
+    }
+    tGameApiResponse resp;
+    if (!gamePushAlive() || !gamePushTake(resp))
     {
-        tGameApiResponse resp = sendDeviceData(req, serverURL);
-        resp.print();
-        if (!resp.success)
+        if ((int32_t)(millis() - waitNextPollMs) < 0)
         {
-            Serial.println("*** SERVER IS OFFLINE");
-            statusClientSetGameStatus("OFFLINE_HAT");    
-            delay(5000);
-            continue;
+            return grNone;
         }
-
-        if (resp.role != "neutral")
+        tGameApiRequest req;
+        resp = sendDeviceData(req, waitServerURL);
+        if (resp.success)
         {
-            res = resp.getRole();
-            preTimeoutMs = resp.game_timeout * 1000;
-            break;
+            gamePushBegin(waitServerURL);
         }
-        delay(R2R_INT_MS);
+        waitNextPollMs = millis() + waitPollIntervalMs(resp);
     }
-    
+    resp.print();
+    if (!resp.success)
+    {
+        Serial.println("*** SERVER IS OFFLINE");
+        statusClientSetGameStatus("OFFLINE_HAT");
+        waitNextPollMs = millis() + GAME_WAIT_OFFLINE_MS;
+        return grNone;
+    }
+
+    // a role switch the server announces gets its files staged before the game
+    if (resp.asset_roles[0] && syncSetRoles(resp.asset_roles))
+    {
+        syncStageStart(ConfigAPI::getFileServerUrl().c_str());
+    }
+
+    // firmware staged in the background boots when the server finds it a good moment
+    if (resp.fw_apply && otaStageReady())
+    {
+        statusClientSetGameStatus("OTA_APPLY");
+        otaStageApply();
+    }
+
+    // neutral, or the result of the last game still up
+    tGameRole res = resp.getRole();
+    if (res == grNone)
+    {
+        return grNone;
+    }
+    // session radio settings have to be in place before the first beacon
+    if (resp.protocol_id)
+    {
+        espSetProtocolId(resp.protocol_id);
+    }
+    espSetChannel(resp.channel);
+    warmSetLastRole((uint8_t)res);
+    preTimeoutMs = resp.game_timeout * 1000;
     Serial.print(">>> waitGame ROLE: ");
-    
     Serial.println(role2str(res));
     return res;
 }
@@ -178,38 +589,57 @@ tGameRole waitGame(uint16_t &preTimeoutMs, uint32_t toMs)
 //     return sendDeviceData(req, serverURL);    
 // }
 
-// Background task
-static void gameApiTask(void* pvParameters)
+// Uplink task, every game_api_ms (tunables.h). While a push channel is up the
+// state comes from the server by itself, so a report is only sent when
+// role, status or health change or every GAME_PUSH_HEARTBEAT_MS
+static void gameApiService(void)
 {
-    while (true)
+    static tGameApiRequest lastSent;
+    static uint32_t lastSentMs = 0;
+    const char *serverURL = ConfigAPI::getServerUrl(csGame);
+    tGameApiRequest req;
+
+    // Get current params
+    if (xSemaphoreTake(gameApiMutex, portMAX_DELAY))
     {
-        String serverURL = ConfigAPI::getGameServerUrl();
-        tGameApiRequest req;
-        
-        // Get current params
-        if (xSemaphoreTake(gameApiMutex, portMAX_DELAY))
-        {
-            req.role = currentRole;
-            req.status = currentStatus;
-            req.health = currentHealth;
-            xSemaphoreGive(gameApiMutex);
-        }
-        
-        // Send request (blocking, but in separate task)
-        tGameApiResponse resp = sendDeviceData(req, serverURL);
-        
-        // Store result
-        if (xSemaphoreTake(gameApiMutex, portMAX_DELAY))
+        req.role = currentRole;
+        req.status = currentStatus;
+        req.health = currentHealth;
+        req.telemetry = currentTelemetry;
+        xSemaphoreGive(gameApiMutex);
+    }
+
+    gamePushBegin(serverURL);
+    if (gamePushAlive() && (req.role == lastSent.role) && (req.status == lastSent.status) &&
+        (req.health == lastSent.health) && (millis() - lastSentMs < GAME_PUSH_HEARTBEAT_MS))
+    {
+        return;
+    }
+    // a gateway in range carries health and telemetry to the server
+    if (espGatewayHeard() && (req.role == lastSent.role) && (req.status == lastSent.status) &&
+        (millis() - lastSentMs < GAME_API_GATEWAY_HEARTBEAT_MS))
+    {
+        return;
+    }
+    lastSent = req;
+    lastSentMs = millis();
+
+    // Send request (blocking, but in the uplink task)
+    tGameApiResponse resp = sendDeviceData(req, serverURL);
+    if (resp.success)
+    {
+        uplinkSetInterval(ucGameApi, resp.next_poll_ms, GAME_API_POLL_JITTER_PCT);
+    }
+
+    // Store result
+    if (xSemaphoreTake(gameApiMutex, portMAX_DELAY))
+    {
+        cachedResponse = resp;
+        if (resp.success)
         {
-            cachedResponse = resp;
-            if (resp.success)
-            {
-                hasNewResult = true;
-            }
-            xSemaphoreGive(gameApiMutex);
+            hasNewResult = true;
         }
-        
-        vTaskDelay(pdMS_TO_TICKS(1000));
+        xSemaphoreGive(gameApiMutex);
     }
 }
 
@@ -222,21 +652,43 @@ void gameApiAsyncInit(void)
         gameApiMutex = xSemaphoreCreateMutex();
     }
     
-    if (gameApiTaskHandle == NULL)
+    // shares the uplink task (and its stack) with the status client
+    if (!gameApiRegistered && uplinkStart())
     {
-        xTaskCreate(
-            gameApiTask,
-            "GameAPI",
-            4096,  // stack size, adjust if needed
-            NULL,
-            1,     // priority
-            &gameApiTaskHandle
-        );
+        uplinkRegister(ucGameApi, GAME_API_UPLINK_PRIORITY, tunable(tuGameApiMs), gameApiService);
+        gameApiRegistered = true;
+    }
+    gameMcastRelayStart();
+}
+
+// State for a gateway in range, it goes out in a beacon when one is heard
+static void setGatewayReport(int health, const tGameApiTelemetry *telemetry)
+{
+    if (gatewayReport.nameHash == 0)
+    {
+        gatewayReport.nameHash = gameMcastIdHash(statusClientGetName());
+    }
+    gatewayReport.health = (int16_t)constrain(health, -32768, 32767);
+    gatewayReport.battery = (uint8_t)constrain(boardGetVccPercent(), 0, 255);
+    if (telemetry)
+    {
+        gatewayReport.zCount = telemetry->zCount;
+        gatewayReport.hCount = telemetry->hCount;
+        gatewayReport.bCount = telemetry->bCount;
+        gatewayReport.neighborCount = min(telemetry->neighborCount, (uint8_t)ESP_REPORT_NEIGHBORS);
+        for (int i = 0; i < gatewayReport.neighborCount; i++)
+        {
+            gatewayReport.neighbors[i].id = telemetry->neighbors[i].id;
+            gatewayReport.neighbors[i].role = telemetry->neighbors[i].role;
+            gatewayReport.neighbors[i].rssi = telemetry->neighbors[i].rssi;
+            gatewayReport.neighbors[i].zone = telemetry->neighbors[i].zone;
+        }
     }
+    espReportSet(gatewayReport);
 }
 
 // Non-blocking call - updates params and returns latest result
-tGameApiResponse updateGameStep(String role_, String status_, int health_)
+tGameApiResponse updateGameStep(tGameRole role, tGameApiStatus status, int health, const tGameApiTelemetry *telemetry)
 {
     tGameApiResponse result;
     result.success = false;
@@ -250,9 +702,13 @@ tGameApiResponse updateGameStep(String role_, String status_, int health_)
     if (xSemaphoreTake(gameApiMutex, pdMS_TO_TICKS(10)))
     {
         // Update request params for next cycle
-        currentRole = role_;
-        currentStatus = status_;
-        currentHealth = health_;
+        currentRole = role;
+        currentStatus = status;
+        currentHealth = health;
+        if (telemetry)
+        {
+            currentTelemetry = *telemetry;
+        }
         
         // Return cached response
         result = cachedResponse;
@@ -267,6 +723,19 @@ tGameApiResponse updateGameStep(String role_, String status_, int health_)
     {
         Serial.println("!!! updateGameStep: semaphore error !!!");
     }
+    setGatewayReport(health, telemetry);
+
+    // a pushed state is newer than the last report reply
+    tGameApiResponse pushed;
+    if (gamePushTake(pushed))
+    {
+        result = pushed;
+    }
+    else if (!gamePushAlive() && gameMcastRelayTake(pushed))
+    {
+        // out of WiFi range, a neighbour passed the server state on
+        result = pushed;
+    }
     
     return result;
 }
@@ -275,9 +744,21 @@ tGameApiResponse updateGameStep(String role_, String status_, int health_)
 void gameApiAsyncStop(void)
 {
     Serial.println(">>> gameApiAsyncStop");
-    if (gameApiTaskHandle != NULL)
+    if (gameApiRegistered)
     {
-        vTaskDelete(gameApiTaskHandle);
-        gameApiTaskHandle = NULL;
+        uplinkUnregister(ucGameApi);
+        gameApiRegistered = false;
+    }
+}
+
+void gameApiFlush(void)
+{
+    tGameApiResponse stale;
+    if ((gameApiMutex != NULL) && xSemaphoreTake(gameApiMutex, portMAX_DELAY))
+    {
+        hasNewResult = false;
+        xSemaphoreGive(gameApiMutex);
     }
+    gamePushTake(stale);
+    gameMcastRelayTake(stale);
 }
\ No newline at end of file
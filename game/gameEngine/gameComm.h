@@ -1,52 +1,128 @@
 #pragma once
 #include <Arduino.h>
 #include "gameRole.h"
+#include "gameProtocol.h"         // tGameApiBin*, GAME_API_BIN_MAGIC/VERSION, from protocol/zgame_messages.json
 
+#define GAME_API_JSON_BUF       384     // serialized request
+#define GAME_API_URL_BUF        1152    // base URL + percent-encoded request
+#define GAME_API_RESP_BUF       1024    // response body
+#define GAME_API_BODY_BUF       512     // POST body, binary or JSON
+#define GAME_API_POLL_MIN_MS    250     // bounds of the server's next_poll_ms
+#define GAME_API_POLL_MAX_MS    10000
+#define GAME_API_POLL_JITTER_PCT 10
+#define GAME_API_UPLINK_PRIORITY 2      // ahead of the status client
+
+// POST /api/device formats, advertised by the server as a bitmask in "api_formats".
+// Until a server advertises one the device keeps using the plain GET
+#define GAME_API_FMT_JSON       0x01
+#define GAME_API_FMT_BIN        0x02
+#define GAME_API_CT_JSON        "application/json"
+#define GAME_API_CT_BIN         "application/x-zgame-device"
+#define GAME_API_NEIGHBORS      8       // strongest neighbours reported per cycle
+#define GAME_API_GATEWAY_HEARTBEAT_MS 10000  // report interval while an ESP-NOW gateway is in range
+#define GAME_WAIT_OFFLINE_MS    5000    // lobby poll interval while the server does not answer
+#define GAME_WAIT_REST_POLL_MS  5000    // between rounds without a push channel, a role is rarely that urgent
+// Pre-wake for the server's next event start: a sleeping device wakes by
+// timer, spread by device ID over the wake window before the event, so the
+// boots, OTA checks and file syncs of the fleet do not hit the server at once
+#define GAME_WAKE_WINDOW_MS     600000  // unless the server sends wake_window_ms
+#define GAME_WAKE_READY_MS      120000  // the last device wakes this long before the start
+#define GAME_WAKE_SLOTS         64      // places in the window, device ID modulo this
+
+struct tGameApiNeighbor
+{
+    uint64_t id;
+    uint8_t  role;
+    int8_t   rssi;
+    uint8_t  zone;
+    uint8_t  pdr;           // % of its frames heard, see DREC_LINK_WINDOW
+};
+
+struct tGameApiTelemetry
+{
+    uint8_t zCount = 0;
+    uint8_t hCount = 0;
+    uint8_t bCount = 0;
+    uint8_t neighborCount = 0;
+    tGameApiNeighbor neighbors[GAME_API_NEIGHBORS];
+};
+
+// Server roles and game phases, in the order of the game server's tables; the
+// game state multicast carries the same values
+enum tGameApiRole
+{
+    garNeutral = 0,
+    garZombie,
+    garHuman,
+    garBase,
+    garZombieWin,
+    garHumanWin,
+    garDraw,
+    GAME_API_ROLE_COUNT
+};
+
+enum tGameApiPhase
+{
+    gapSleep = 0,
+    gapPrepare,
+    gapDistribution,
+    gapCountdown,
+    gapGame,
+    gapEnd,
+    GAME_API_PHASE_COUNT,
+    gapUnknown = GAME_API_PHASE_COUNT
+};
+
+// What the device reports as its own status
+enum tGameApiStatus
+{
+    gasIdle = 0,
+    gasWait,
+    gasGameLoop,
+    GAME_API_STATUS_COUNT
+};
+
+#define GAME_API_COMMENT_LEN    24
+
+const char    *gameApiRoleName(tGameApiRole role);
+const char    *gameApiPhaseName(tGameApiPhase phase);
+const char    *gameApiStatusName(tGameApiStatus status);
+tGameApiRole   gameApiRoleFromName(const char *name);
+tGameApiPhase  gameApiPhaseFromName(const char *name);
+
+// Device role as the server expects it in a report
+inline const char *gameApiDeviceRoleName(tGameRole role)
+{
+    switch(role) 
+    {
+        case grNone:            return "none";
+        case grZombie:          return "zombie";
+        case grHuman:           return "human";
+        case grBase:            return "base";
+        case grServer:          return "server";
+        case grPinger:          return "pinger";
+        case grApPortalBeacon:  return "apportalbeacon";
+        default:                return "unknown";
+    }    
+}
+
+// Fixed size on both sides, the game loop hands it over without touching the heap
 struct tGameApiRequest
 {
-    String id = "NoID";
-    String role = "neutral";
-    String status = "idle";
+    tGameRole role = grNone;
+    tGameApiStatus status = gasWait;
     int health = 0;
-    int battery = 0;
-    String comment = "";
-
-    tGameApiRequest();
+    char comment[GAME_API_COMMENT_LEN] = "";
+    tGameApiTelemetry telemetry;
 
-    inline void setRole(tGameRole role)
+    inline void setComment(const char *text)
     {
-        switch(role) 
-        {
-            case grNone:
-                this->role = "none";
-                break;
-            case grZombie:
-                this->role = "zombie";
-                break;
-            case grHuman:
-                this->role = "human";
-                break;
-            case grBase:
-                this->role = "base";
-                break;
-            case grServer:
-                this->role = "server";
-                break;
-            case grPinger:
-                this->role = "pinger";
-                break;
-            case grApPortalBeacon:
-                this->role = "apportalbeacon";
-                break;
-            default:
-                this->role = "unknown";
-                break;
-        }    
+        strlcpy(comment, text, sizeof(comment));
     }
-    inline void print(String url)
+    inline void print(const char *url)
     {
-        Serial.printf(">>> [GAME REQUEST] [%s] [%s] [%s] [%s] [health = %d] [bat = %d] [%s]\n", 
-                    url.c_str(), id.c_str(), role.c_str(), status.c_str(), health, battery, comment.c_str());
+        Serial.printf(">>> [GAME REQUEST] [%s] [%s] [%s] [health = %d] [%s]\n", 
+                    url, gameApiDeviceRoleName(role), gameApiStatusName(status), health, comment);
     }
 };
 
@@ -54,31 +130,57 @@ struct tGameApiResponse
 {
     int game_duration = 0;
     int game_timeout = 0;
-    String role;
-    String status;
+    tGameApiRole role = garNeutral;
+    tGameApiPhase status = gapUnknown;
     uint32_t respTimeMs = 0;
+    uint32_t rxMs = 0;               // millis() when the response arrived
+    int beacon_slot = -1;            // TDMA beacon slot, -1 if the server did not assign one
+    int beacon_slots = 0;
+    uint32_t beacon_frame_ms = 0;
+    uint64_t server_ms = 0;
+    uint64_t phase_end_ms = 0;       // server clock at the end of the countdown or the game, 0 = not sent
+    int channel = 0;                 // ESP-NOW channel of the session, 0 = keep
+    uint32_t protocol_id = 0;        // ESP-NOW protocol ID of the session, 0 = keep
+    bool relayed = false;            // heard over the ESP-NOW relay, no slot or server clock
+    char asset_roles[24] = "";       // roles whose files the device may need next, "" = no announcement
+    uint32_t next_poll_ms = 0;       // report interval the server wants for this phase, 0 = the device's own
+    int64_t event_start_ms = -1;     // server clock at the next event, 0 = none planned, -1 = not sent
+    uint32_t wake_window_ms = 0;     // pre-wake spread for that event, 0 = GAME_WAKE_WINDOW_MS
+    bool fw_apply = false;           // between games: a staged firmware may boot now
     bool success;
     
     inline void print(void)
     {
         Serial.printf(">>> [GAME RESPONSE] [game_duration = %d] [game_timeout = %d] [role = %s] [status = %s] [time = %u] [success = %s]\n",
-                     game_duration, game_timeout, role.c_str(), status.c_str(), respTimeMs, success ? "true" : "false");
+                     game_duration, game_timeout, gameApiRoleName(role), gameApiPhaseName(status), respTimeMs, success ? "true" : "false");
     }
 
     inline tGameRole getRole(void)
     {
-        if (role == "none") return grNone;
-        if (role == "zombie") return grZombie;
-        if (role == "human") return grHuman;
-        if (role == "base") return grBase;
-        if (role == "server") return grServer;
-        if (role == "pinger") return grPinger;
-        if (role == "apportalbeacon") return grApPortalBeacon;
-        return grNone; // default fallback
+        switch (role)
+        {
+            case garZombie: return grZombie;
+            case garHuman:  return grHuman;
+            case garBase:   return grBase;
+            default:        return grNone;
+        }
+    }
+
+    inline bool isResult(void)
+    {
+        return (role == garZombieWin) || (role == garHumanWin) || (role == garDraw);
     }
 };
 
-tGameRole waitGame(uint16_t &preTimeoutMs, uint32_t toMs = 0xffffffff);
+tGameApiResponse sendDeviceData(const tGameApiRequest &request, const char *serverURL);
+bool gameApiParseResponse(const char *json, size_t len, tGameApiResponse &resp);
+void gameApiSessionClose(void);
+// Lobby: waitGameBegin() once, then waitGamePoll() from the game flow until
+// it hands out a role; a poll only blocks for the report it is due to send.
+// Resting between rounds the lobby polls at GAME_WAIT_REST_POLL_MS
+void waitGameBegin(bool rest = false);
+tGameRole waitGamePoll(uint16_t &preTimeoutMs);
 void gameApiAsyncInit(void);
 void gameApiAsyncStop(void);
-tGameApiResponse updateGameStep(String role_, String status_, int health_);
\ No newline at end of file
+void gameApiFlush(void);        // new game: the last game's replies and pushed states are dropped
+tGameApiResponse updateGameStep(tGameRole role, tGameApiStatus status, int health, const tGameApiTelemetry *telemetry = NULL);
\ No newline at end of file
@@ -5,94 +5,373 @@
 #include "serialCommander.h"
 #include "gameEngine.h"
 #include "tft_utils.h"
+#include "patterns.h"
+#include "powerPolicy.h"
+#include "taskRegistry.h"
+#include "loopProfile.h"
+#include "espHitStamp.h"
+#include "espNeighbors.h"
+#include "espTxPower.h"
+#include "tunables.h"
+#include "gameLog.h"
+#include "gameCheckpoint.h"
 
-#define COM_LOOP_DELAY 2
+// Radio RX/TX runs in its own task so slow screen or LED work in the game
+// loop can not delay beacons or leave the RX ring undrained
+#define RADIO_SNAPSHOT_MS           100
+
+// Adaptive beacon scheduler: keep the channel load roughly constant by
+// stretching the interval once more than BEACON_DENSITY_REF neighbours are heard
+#define BEACON_DENSITY_REF          10
+#define BEACON_MAX_INTERVAL_MS      250
+#define BEACON_JITTER_PCT           20
+#define BEACON_FAST_INTERVAL_MS     20
+#define BEACON_FAST_DURATION_MS     1500
+
+#define API_TELEMETRY_INT_MS        500
+#define GAME_CLOCK_TOLERANCE_S      2       // a state's time left this far off the end we count to replaces it
 
 static bool commStarted = false;
-static TaskHandle_t taskHandle = NULL;
+static TaskHandle_t radioTaskHandle = NULL;
+static int commSecondsLeft = 10;         // game_duration of the last state, counted down from commSecondsMs
+static uint32_t commSecondsMs = 0;
+static uint64_t commPhaseEndMs = 0;     // shared clock, 0 = counted down from commSecondsLeft
+static tGameApiTelemetry commTelemetry;
+static uint32_t commTelemetryMs = 0;
+static bool commRejoined = false;       // back in after a crash, the first reply says whether the game still runs
+
+static unsigned long nextBeaconInterval(void)
+{
+    static tGameRole lastRole = grNone;
+    static unsigned long fastUntilMs = 0;
+    tGameRole role = getSelfDataRecord()->deviceRole;
+    if (role != lastRole)
+    {
+        lastRole = role;
+        fastUntilMs = millis() + BEACON_FAST_DURATION_MS;
+    }
 
-static void waitForTheNextGame(String gRes)
-{    
-    if (gRes == "zwin")
+    unsigned long baseMs = tunable(tuBeaconMs);
+    unsigned long intMs = baseMs;
+    if ((long)(fastUntilMs - millis()) > 0)
     {
-        zombieWinPicture();
-    } 
-    
-    if (gRes == "hwin")
+        intMs = BEACON_FAST_INTERVAL_MS;
+    }
+    else
     {
-        humanWinPicture();
+        uint16_t neighbors = getLiveRecordCount();
+        if (neighbors > BEACON_DENSITY_REF)
+        {
+            intMs = (baseMs * neighbors) / BEACON_DENSITY_REF;
+        }
+        if (intMs > BEACON_MAX_INTERVAL_MS)
+        {
+            intMs = BEACON_MAX_INTERVAL_MS;
+        }
+        intMs = max(intMs, (unsigned long)powerBeaconMinMs());
     }
-    
-    if (gRes == "draw")
+
+    // +-BEACON_JITTER_PCT so devices that started together drift apart
+    long jitter = (long)(intMs * BEACON_JITTER_PCT) / 100;
+    if (jitter > 0)
     {
-        drawPicture();
+        intMs += (long)(esp_random() % (2 * jitter + 1)) - jitter;
     }
+    return intMs;
+}
 
-    while(true)
+// Round trips feed the server clock as they come in (sendDeviceData), a
+// pushed or multicast state only until one did
+static void applyBeaconSlot(const tGameApiResponse &resp)
+{
+    if ((resp.server_ms != 0) && (resp.respTimeMs == 0))
     {
-        delay(1000);
-        Serial.println("!!! waitForTheNextGame: FIX ME !!! ");
+        espClockSetServerOffset((int64_t)resp.server_ms - (int64_t)resp.rxMs);
+    }
+    if ((resp.beacon_slot < 0) || (resp.server_ms == 0))
+    {
+        espClearTxSlot();
+        return;
+    }
+    espSetTxSlot(resp.beacon_slot, resp.beacon_slots, resp.beacon_frame_ms);
+}
+
+// With the end on the shared clock every device counts down to the same
+// moment, whenever its last state arrived; a state without it (multicast,
+// relay) only drops an end it disagrees with, the game was made longer
+static void followGameClock(const tGameApiResponse &resp)
+{
+    if (resp.phase_end_ms && (espClockSource() != ecsNone))
+    {
+        commPhaseEndMs = resp.phase_end_ms;
+    }
+    else if (commPhaseEndMs)
+    {
+        int64_t leftMs = (int64_t)(commPhaseEndMs - espClockNowMs());
+        if (abs((int)(leftMs / 1000) - resp.game_duration) > GAME_CLOCK_TOLERANCE_S)
+        {
+            commPhaseEndMs = 0;
+        }
     }
+    commSecondsLeft = resp.game_duration;
+    commSecondsMs = resp.rxMs;
 }
 
-static String communicatorJob(void)
-{   
+static int gameSecondsLeft(void)
+{
+    int32_t left;
+    if (commPhaseEndMs)
+    {
+        int64_t leftMs = (int64_t)(commPhaseEndMs - espClockNowMs());
+        left = (leftMs > 0) ? (int32_t)((leftMs + 999) / 1000) : 0;
+    }
+    else
+    {
+        left = commSecondsLeft - (int32_t)((millis() - commSecondsMs) / 1000);
+    }
+    return (left > 0) ? left : 0;
+}
+
+static void radioTask(void *pvParameters)
+{
     unsigned long lastBeaconMs = 0;
-    unsigned long lastPrintedMs = 0;
-    const int beaconRssi = -40;   
-    int secondsLeft_ = 10;  
-    String globalResult = "";
-    //commStarted = true;
-    delay(10);
-    gameApiAsyncInit();
-    Serial.println(">>> communicatorJob: LOOP STARTED");   
-    while(true)
+    unsigned long beaconIntMs = tunable(tuBeaconMs);
+    unsigned long lastSnapshotMs = 0;
+    Serial.println(">>> radioTask: STARTED");
+    while (true)
     {
-        espProcessRx(RECEIVER_INTERVAL_MS);        
-        if (millis() - lastBeaconMs > BEACON_INTERVAL_MS)
+        if (recordsReplayActive())
+        {
+            // a recorded session is being fed through the record table
+            delay(RADIO_SNAPSHOT_MS);
+            continue;
+        }
+        if (powerPolicyUpdate())
+        {
+            // woken up, the neighbours hear about it right away
+            beaconIntMs = 0;
+        }
+        espChannelService();
+        espTxPowerService(getSelfDataRecord()->deviceRole);
+        unsigned long rxMs = powerRxWaitMs(RECEIVER_INTERVAL_MS);
+        if (espTxSlotActive())
         {
+            rxMs = min((uint32_t)rxMs, espMsToNextSlot());
+        }
+        espProcessRx(rxMs);
+        if (espTxSlotActive())
+        {
+            // a slowed down device leaves some of its frames out
+            if (espTxSlotDue() && (millis() - lastBeaconMs >= powerBeaconMinMs()))
+            {
+                uint32_t txUs = loopProfNowUs();
+                espProcessTx();
+                loopProfSince(lsTx, txUs);
+                lastBeaconMs = millis();
+            }
+        }
+        else if (millis() - lastBeaconMs > beaconIntMs)
+        {
+            uint32_t txUs = loopProfNowUs();
             espProcessTx();
+            loopProfSince(lsTx, txUs);
             lastBeaconMs = millis();
-        }  
-        String role_;
-        int health_;
-        doGameStep(role_, health_, secondsLeft_);
-        tGameApiResponse updRes = updateGameStep(role_, "GAME_LOOP", health_);
-        if (updRes.success)
-        {
-            updRes.print();
-            secondsLeft_ = updRes.game_duration;            
-            if ((updRes.role == "zwin") || (updRes.role == "hwin") || (updRes.role == "draw"))
+            beaconIntMs = nextBeaconInterval();
+        }
+
+        if (millis() - lastSnapshotMs >= RADIO_SNAPSHOT_MS)
+        {
+            publishNeighborSnapshot();
+            lastSnapshotMs = millis();
+        }
+        if (rxMs == 0)
+        {
+            // slot already due, but let lower priority tasks on this core run
+            taskYIELD();
+        }
+    }
+}
+
+// Game loop side: the neighbour snapshot has a single reader, so the API
+// task gets a compact copy of the strongest neighbours from here
+static void fillApiTelemetry(tGameApiTelemetry &tel)
+{
+    const tNeighborSnapshot *snap = getNeighborSnapshot();
+    tel.zCount = constrain(snap->totals.zCount, 0, 255);
+    tel.hCount = constrain(snap->totals.hCount, 0, 255);
+    tel.bCount = constrain(snap->totals.bCount, 0, 255);
+    tel.neighborCount = 0;
+    for (int i = 0; i < snap->count; i++)
+    {
+        const tNeighborRecord &rec = snap->recs[i];
+        if (rec.zone == rzOut)
+        {
+            continue;
+        }
+        // insertion into the short list, strongest first
+        int pos = tel.neighborCount;
+        while ((pos > 0) && (tel.neighbors[pos - 1].rssi < rec.rssiFiltered))
+        {
+            if (pos < GAME_API_NEIGHBORS)
             {
-                globalResult = updRes.role;
-                break;
+                tel.neighbors[pos] = tel.neighbors[pos - 1];
             }
-        }        
-        delay(COM_LOOP_DELAY);      
-    }    
-    Serial.printf(">>> communicatorJob: LOOP COMPLETED <%s>\r\n", globalResult.c_str());   
-    gameApiAsyncStop();
-    waitForTheNextGame(globalResult);
-    return globalResult;
+            pos--;
+        }
+        if (pos >= GAME_API_NEIGHBORS)
+        {
+            continue;
+        }
+        tel.neighbors[pos].id = rec.deviceID;
+        tel.neighbors[pos].role = (uint8_t)rec.deviceRole;
+        tel.neighbors[pos].rssi = (int8_t)constrain(rec.rssiFiltered, -128, 127);
+        tel.neighbors[pos].zone = (uint8_t)rec.zone;
+        tel.neighbors[pos].pdr = rec.pdrPct;
+        if (tel.neighborCount < GAME_API_NEIGHBORS)
+        {
+            tel.neighborCount++;
+        }
+    }
+}
+
+// The same short list goes into the beacons' neighbour summary
+static void setBeaconNeighbors(const tGameApiTelemetry &tel)
+{
+    tEspNeighbor list[ESP_NEIGHBORS_MAX];
+    uint8_t n = min(tel.neighborCount, (uint8_t)ESP_NEIGHBORS_MAX);
+    for (uint8_t i = 0; i < n; i++)
+    {
+        list[i].id = tel.neighbors[i].id;
+        list[i].role = tel.neighbors[i].role;
+        list[i].rssi = tel.neighbors[i].rssi;
+    }
+    espNeighborsSet(list, n);
 }
 
-String startGameCommunicator(void)
+static bool startRadioTask(void)
+{
+    if (radioTaskHandle != NULL)
+    {
+        return true;
+    }
+    return taskStart(tkRadio, radioTask, NULL, &radioTaskHandle);
+}
+
+// The radio runs ahead of the game loop through the pre-game countdown, so
+// the table and the RSSI filters have settled by the first step
+bool startGameRadio(void)
+{
+    espInitRxTx(getSelfTxPacket(), true, getSelfRadioProfile());
+    return startRadioTask();
+}
+
+bool startGameCommunicator(void)
 {
     if (commStarted)
     {
         Serial.println("!!! startCommunicator: ALREADY STARTED !!!");
-        return "error";
+        return false;
+    }
+    commStarted = true;
+    commSecondsLeft = 10;
+    commSecondsMs = millis();
+    commPhaseEndMs = 0;
+    commTelemetryMs = 0;
+    commRejoined = false;
+    gameApiFlush();
+    gameApiAsyncInit();
+    espHitLatencyReset();
+    // bases piece the arena together from the players' summaries
+    if (getSelfDataRecord()->deviceRole == grBase)
+    {
+        espNeighborsCollect();
     }
-    //xTaskCreatePinnedToCore(communicatorJob, "communicatorJob", 25000, NULL, 7 | portPRIVILEGE_BIT, &taskHandle, APP_CPU_NUM);
-    return communicatorJob();
+    gameLogStart(getSelfDataRecord()->deviceRole, getSelfDataRecord()->health);
+    startRadioTask();
+    recordsStartScoring();
+    Serial.println(">>> startGameCommunicator: LOOP STARTED");
+    return true;
 }
 
+// One pass of the game loop, the game flow calls it every few ms; true with
+// the result once the server ends the game
+bool gameCommunicatorStep(tGameApiRole &result)
+{
+    if (!commStarted)
+    {
+        return false;
+    }
+    tGameRole role_;
+    int health_;
+    uint32_t loopUs = loopProfNowUs();
+    doGameStep(role_, health_, gameSecondsLeft());
+    loopProfSince(lsGameStep, loopUs);
+    const tGameApiTelemetry *tel = NULL;
+    if (millis() - commTelemetryMs >= API_TELEMETRY_INT_MS)
+    {
+        commTelemetryMs = millis();
+        fillApiTelemetry(commTelemetry);
+        setBeaconNeighbors(commTelemetry);
+        tel = &commTelemetry;
+        gameLogSample(getSelfDataRecord()->deviceRole, getSelfDataRecord()->health, commTelemetry);
+    }
+    uint32_t apiUs = loopProfNowUs();
+    tGameApiResponse updRes = updateGameStep(role_, gasGameLoop, health_, tel);
+    loopProfSince(lsApiUpdate, apiUs);
+    bool done = false;
+    if (updRes.success)
+    {
+        updRes.print();
+        if (updRes.respTimeMs)
+        {
+            gameLogApiRtt(updRes.respTimeMs);
+        }
+        if (!updRes.relayed)
+        {
+            applyBeaconSlot(updRes);
+        }
+        followGameClock(updRes);
+        if (updRes.isResult())
+        {
+            result = updRes.role;
+            done = true;
+        }
+        else if (commRejoined && (updRes.status != gapGame))
+        {
+            Serial.printf("*** gameCommunicatorStep WARNING! rejoined, but the server is in %s\r\n", gameApiPhaseName(updRes.status));
+            result = garNeutral;
+            done = true;
+        }
+        commRejoined = false;
+    }
+    loopProfSince(lsGameLoop, loopUs);
+    return done;
+}
+
+// Time left as the game is shown, for the checkpoint
+int gameCommunicatorSecondsLeft(void)
+{
+    return gameSecondsLeft();
+}
+
+// Right after startGameCommunicator() on a rejoin, the countdown goes on from
+// the checkpoint until the server's first state
+void gameCommunicatorRejoined(int secondsLeft)
+{
+    commSecondsLeft = secondsLeft;
+    commSecondsMs = millis();
+    commRejoined = true;
+}
+
+// The radio task goes on, the lobby and the next game's countdown use it
 void stopCommunicator(void)
 {
     if (!commStarted)
     {
         return;
     }
-    // vTaskDelete(taskHandle);
-    // delay(200);
-}
\ No newline at end of file
+    commStarted = false;
+    gameCheckpointClear();
+    Serial.println(">>> stopCommunicator: LOOP COMPLETED");
+    gameApiAsyncStop();
+}
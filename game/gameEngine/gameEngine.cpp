@@ -2,9 +2,30 @@
 #include "gameComm.h"
 #include "valPlayer.h"
 #include "patterns.h"
+#include "gamePrefetch.h"
 #include "tft_utils.h"
+#include "tftImageCache.h"
+#include "tftPower.h"
+#include "tftAnim.h"
+#include "tftFrame.h"
 #include "espRadio.h"
+#include "espAirtime.h"
+#include "baseArbiter.h"
 #include "statusClient.h"
+#include "powerPolicy.h"
+#include "logRing.h"
+#include "taskRegistry.h"
+#include "loopProfile.h"
+#include "pmLocks.h"
+#include "espHitStamp.h"
+#include "gameLog.h"
+#include "serverSync.h"
+#include "xgConfig.h"
+#include "tunables.h"
+#include "gameCheckpoint.h"
+#include "deviceClass.h"
+#include "scoreboard.h"
+#include "version.h"
 
 static uint32_t gameStartedMs = 0;
 
@@ -13,6 +34,220 @@ static uint32_t gameStep = 0;
 static uint32_t lastBaseStartedMs = 0;
 static uint32_t gameDurationS = 180;
 static bool inTheBase = 0;
+static uint32_t lastReportedMs = 0;
+
+enum tGameScreenKind
+{
+    gsBase,
+    gsZombie,
+    gsHuman,
+    gsHumanPre,     // secLeft is the countdown
+    gsZombiePre,
+    gsBasePre,
+    gsWaitLogo,
+    gsGameOver,
+    gsZombieWin,
+    gsHumanWin,
+    gsDraw,
+    gsScore,        // base station: topVal humans, botVal zombies
+    gsCritical      // screenErrText
+};
+
+struct tGameScreenEvent
+{
+    tGameScreenKind kind;
+    int32_t         topVal;
+    int32_t         botVal;
+    uint32_t        secLeft;
+};
+
+static QueueHandle_t gameScreenQ = NULL;
+static tGameScreenStats screenStats;
+static uint64_t screenFrameMsTotal = 0;
+static char screenErrText[32];
+static tGameScreenKind renderingKind = gsCritical;
+static bool screenShown = false;    // renderingKind is on the panel
+
+static tTftPowerPhase screenPhase(tGameScreenKind kind)
+{
+    switch (kind)
+    {
+        case gsWaitLogo:
+            return tpWait;
+        case gsGameOver:
+        case gsZombieWin:
+        case gsHumanWin:
+        case gsDraw:
+            return tpGameOver;
+        case gsBase:
+        case gsZombie:
+        case gsHuman:
+        case gsScore:
+            return tpGame;
+        default:
+            return tpPreGame;
+    }
+}
+
+// A different screen posted ends an animation, the same one posted again (the
+// next countdown second) is drawn once it is over
+static bool screenChangeQueued(void)
+{
+    tGameScreenEvent next;
+    return (xQueuePeek(gameScreenQ, &next, 0) == pdTRUE) && (next.kind != renderingKind);
+}
+
+// The screen's animation instead of its picture, only on entering the screen;
+// false when there is none, or it is corrupt, and the picture is drawn
+static bool playTransition(bool entering, const char *anim)
+{
+    if (!entering || !tftAnimAvailable(anim))
+    {
+        return false;
+    }
+    tTftAnimResult result = tftAnimPlay(anim, screenChangeQueued);
+    return (result == taDone) || (result == taAborted);
+}
+
+static void renderGameScreen(const tGameScreenEvent &ev)
+{
+    tftPowerSetPhase(screenPhase(ev.kind));
+    bool entering = !screenShown || (ev.kind != renderingKind);
+    renderingKind = ev.kind;
+    screenShown = true;
+    switch (ev.kind)
+    {
+        case gsBase:
+            tftGameScreenBase(ev.topVal, ev.botVal, ev.secLeft);
+        break;
+        case gsZombie:
+            tftGameScreenZombie(ev.topVal, ev.botVal, ev.secLeft);
+        break;
+        case gsHuman:
+            tftGameScreenHuman(ev.topVal, ev.botVal, ev.secLeft);
+        break;
+        case gsScore:
+            tftGameScreenScore(ev.topVal, ev.botVal, ev.secLeft);
+        break;
+        case gsHumanPre:
+            if (!playTransition(entering, TFT_ANIM_PRE_HUMAN))
+            {
+                humanPreWaitPicture();
+            }
+            tftPrintTextBig(String(ev.secLeft), TFT_BLACK, TFT_GREEN, true);
+        break;
+        case gsZombiePre:
+            if (!playTransition(entering, TFT_ANIM_PRE_ZOMBIE))
+            {
+                zombiPreWaitPicture();
+            }
+            tftPrintTextBig(String(ev.secLeft), TFT_BLACK, TFT_GREEN, true);
+        break;
+        case gsBasePre:
+            if (!playTransition(entering, TFT_ANIM_PRE_BASE))
+            {
+                basePreWaitPicture();
+            }
+        break;
+        case gsWaitLogo:
+            gameWaitLogo();
+        break;
+        case gsGameOver:
+            gameOverPicture();
+        break;
+        case gsZombieWin:
+            if (!playTransition(entering, TFT_ANIM_ZOMBIE_WIN))
+            {
+                zombieWinPicture();
+            }
+        break;
+        case gsHumanWin:
+            if (!playTransition(entering, TFT_ANIM_HUMAN_WIN))
+            {
+                humanWinPicture();
+            }
+        break;
+        case gsDraw:
+            if (!playTransition(entering, TFT_ANIM_DRAW))
+            {
+                drawPicture();
+            }
+        break;
+        case gsCritical:
+            gameCriticalErrorPicture(String(screenErrText));
+        break;
+    }
+}
+
+// Draws the newest posted state at most screen_fps times a second (tunables.h, the
+// power policy lowers it for a still device), states posted while a frame is drawn
+// or the interval runs out are dropped;
+// a wait screen left unchanged for TFT_POWER_IDLE_AFTER_MS dims the panel to idle
+static void gameScreenTask(void *pvParameters)
+{
+    tGameScreenEvent ev;
+    Serial.println(">>> gameScreenTask: STARTED");
+    while (true)
+    {
+        bool idleDue = (tftPowerPhase() == tpWait) && !tftPowerIsIdle();
+        TickType_t waitTicks = idleDue ? pdMS_TO_TICKS(TFT_POWER_IDLE_AFTER_MS) : portMAX_DELAY;
+        if (xQueueReceive(gameScreenQ, &ev, waitTicks) != pdTRUE)
+        {
+            if (idleDue)
+            {
+                tftPowerIdle();
+            }
+            continue;
+        }
+        TickType_t frameStart = xTaskGetTickCount();
+        uint32_t startMs = millis();
+        pmAcquire(plDisplay);
+        renderGameScreen(ev);
+        pmRelease(plDisplay);
+        uint32_t frameMs = millis() - startMs;
+        if (screenPhase(ev.kind) == tpGame)
+        {
+            espHitStampScreen();
+        }
+
+        tftFrameNoteRender(frameMs);
+        screenStats.frames++;
+        screenStats.lastFrameMs = frameMs;
+        screenFrameMsTotal += frameMs;
+        screenStats.avgFrameMs = screenFrameMsTotal / screenStats.frames;
+        if (frameMs > screenStats.maxFrameMs)
+        {
+            screenStats.maxFrameMs = frameMs;
+        }
+        vTaskDelayUntil(&frameStart, pdMS_TO_TICKS(1000 / powerScreenFps(tunable(tuScreenFps))));
+    }
+}
+
+// Only the latest screen matters, a redraw still in progress just gets the newest state next
+static void postGameScreen(tGameScreenKind kind, int32_t topVal, int32_t botVal, uint32_t secLeft)
+{
+    if (gameScreenQ == NULL)
+    {
+        gameScreenQ = xQueueCreate(1, sizeof(tGameScreenEvent));
+        if (gameScreenQ == NULL)
+        {
+            Serial.println("!!! postGameScreen ERROR: xQueueCreate failed");
+            return;
+        }
+        taskStart(tkGameScreen, gameScreenTask);
+    }
+    tGameScreenEvent ev = {kind, topVal, botVal, secLeft};
+    if (uxQueueMessagesWaiting(gameScreenQ) > 0)
+    {
+        screenStats.dropped++;
+    }
+    xQueueOverwrite(gameScreenQ, &ev);
+}
+
+void gameScreenGetStats(tGameScreenStats &st)
+{
+    st = screenStats;
+}
 
 void gameOnCritical(String errS, bool noVal)
 {
@@ -20,9 +255,10 @@ void gameOnCritical(String errS, bool noVal)
     int waitSec = 5;
     if (!noVal)
     {
-        valPlayPattern(ERROR_PATTERN);    
+        gamePlayPattern(gpError);    
     }
-    gameCriticalErrorPicture(errS);
+    strlcpy(screenErrText, errS.c_str(), sizeof(screenErrText));
+    postGameScreen(gsCritical, 0, 0, 0);
     while(waitSec)
     {
         Serial.printf("!!! GAME ERROR: [%s] [%d sec to reboot]\r\n", errS.c_str(), waitSec);        
@@ -34,106 +270,290 @@ void gameOnCritical(String errS, bool noVal)
     ESP.restart();
 }
 
-void humanPreGame(uint16_t preTimeoutMs)
-{    
-    //CHANGE!!!
-    int lastDrawMs = 0;
-    uint32_t startMs = millis();    
-    valPlayPattern(ROLE_ZOMBI_PATTERN);
-    statusClientSetGameStatus("HUM_WAIT");    
-    while(millis() - startMs < preTimeoutMs)
-    {        
-        if (millis() - lastDrawMs < 1000)       
-        {
-            delay(10);
-            continue;
-        }
-        lastDrawMs = millis();
-        int secLeft = (preTimeoutMs - (millis() - startMs))/1000;
-        humanPreWaitPicture();
-        tftPrintTextBig(String(secLeft), TFT_BLACK, TFT_GREEN, true);
-    }
+static tGamePhase flowPhase = gphIdle;
+static uint32_t phaseStartMs = 0;
+static uint32_t lastDrawMs = 0;
+static tGameRole flowRole = grNone;
+static uint16_t flowPreMs = 0;
+static bool flowLobby = false;          // the server hands out the roles, otherwise the fixed profile plays
+static String flowProfile = "";         // role profile file or, with flowProfileJson, the profile itself
+static bool flowProfileJson = false;
+
+static const char *const phaseNames[] = {"idle", "wait", "pregame", "play", "result"};
+
+const char *gamePhaseName(tGamePhase phase)
+{
+    return (phase <= gphResult) ? phaseNames[phase] : "?";
 }
 
-void zombiePreGame(uint16_t preTimeoutMs)
+tGamePhase gameFlowPhase(void)
 {
-    int lastDrawMs = 0;
-    uint32_t startMs = millis();    
-    valPlayPattern(ROLE_ZOMBI_PATTERN);
-    statusClientSetGameStatus("ZOM_WAIT");    
-    while(millis() - startMs < preTimeoutMs)
-    {        
-        if (millis() - lastDrawMs < 1000)       
-        {
-            delay(50);
-            continue;
-        }
-        lastDrawMs = millis();
-        int secLeft = (preTimeoutMs - (millis() - startMs))/1000;
-        zombiPreWaitPicture();
-        tftPrintTextBig(String(secLeft), TFT_BLACK, TFT_GREEN, true);
-        lastDrawMs = millis();
+    return flowPhase;
+}
+
+static const char *roleProfileFName(tGameRole role)
+{
+    switch (role)
+    {
+        case grZombie:      return GAME_ZOMB_FNAME;
+        case grHuman:       return GAME_HUMB_FNANE;
+        case grBase:        return GAME_BASE_FNAME;
+        case grRssiMonitor: return GAME_RSSI_FNAME;
+        default:            return NULL;
     }
-    valPlayPattern(GAME_ZOMBIE_NEUTRAL);    
 }
 
-void basePreGame(void)
-{    
-    //CHANGE!!!
-    int lastDrawMs = 0;
-    uint32_t startMs = millis();    
-    statusClientSetGameStatus("BASE");    
-    basePreWaitPicture();
-    valPlayPattern(BASE_ROLE_PATTERN);    
+static bool applyFlowProfile(bool print)
+{
+    return flowProfileJson ? setSelfJson(flowProfile, print) : setSelfJsonFromFile(flowProfile);
 }
 
-void rssiMonitorPreGame(void)
+static void enterPhase(tGamePhase phase)
 {
-    tftPrintText("RSSI MONITOR");
+    Serial.printf(">>> gameFlow: %s -> %s\r\n", gamePhaseName(flowPhase), gamePhaseName(phase));
+    flowPhase = phase;
+    phaseStartMs = millis();
+    lastDrawMs = 0;
+    airtimeSetPlay((phase == gphPreGame) || (phase == gphPlay));
 }
 
-static void preGame(tGameRole role, uint16_t preTimeoutMs)
+// Back from a result the device rests until the server hands out the next game
+static void enterWait(bool rest)
 {
-    bool res = false;
-    switch(role)
+    enterPhase(gphWait);
+    powerPolicyRest(rest);
+    gamePlayPattern(gpGameWait);
+    postGameScreen(gsWaitLogo, 0, 0, 0);
+    gamePrefetch(pfWait);
+    // changed server files are staged while nobody plays, they go live before the game's first screen
+    syncStageStart(ConfigAPI::getFileServerUrl().c_str());
+    // so is a newer firmware, the game server says when it boots
+    otaStageStart(ConfigAPI::getOTAServerUrl().c_str(), String(BUILD_NUMBER).toInt());
+    waitGameBegin(rest);
+}
+
+// The role's profile goes live before the countdown, the radio hears the
+// others through it; the game step loop only starts at its end
+static void enterPreGame(tGameRole role, uint16_t preTimeoutMs)
+{
+    if (roleProfileFName(role) == NULL)
+    {
+        gameOnCritical("ERR_ROLE", false);
+    }
+    enterPhase(gphPreGame);
+    flowRole = role;
+    flowPreMs = preTimeoutMs;
+    // the countdown is drawn from the cache, the game's own screens decode meanwhile
+    gamePrefetch(pfPlay, role);
+    if (!applyFlowProfile(false) || !startGameRadio())
+    {
+        Serial.println("*** enterPreGame WARNING! the radio starts with the game");
+    }
+    switch (role)
     {
         case grZombie:
             Serial.println(">>> preGame: ZOMBIE");
-            zombiePreGame(preTimeoutMs);            
-            res = startZombieGame(preTimeoutMs);
-        return;        
+            gamePlayPattern(gpRoleZombie);
+            statusClientSetGameStatus("ZOM_WAIT");
+        break;
         case grHuman:
+            //CHANGE!!!
             Serial.println(">>> preGame: HUMAN");
-            humanPreGame(preTimeoutMs);
-            res = startHumanGame(preTimeoutMs);
-        return;        
+            gamePlayPattern(gpRoleZombie);
+            statusClientSetGameStatus("HUM_WAIT");
+        break;
         case grBase:
             Serial.println(">>> preGame: BASE");
-            basePreGame();
-        return;
-        case grRssiMonitor:
-            Serial.println(">>> preGame: RSSI MONITOR");
-            rssiMonitorPreGame();
-        return;
+            statusClientSetGameStatus("BASE");
+            postGameScreen(gsBasePre, 0, 0, 0);
+            gamePlayPattern(gpRoleBase);
+            flowPreMs = 0;
+        break;
         default:
-            gameOnCritical("ERR_ROLE", false);
+            Serial.println(">>> preGame: RSSI MONITOR");
+            tftPrintText("RSSI MONITOR");
+            flowPreMs = 0;
         break;
     }
-    if (!res)
+}
+
+// A fresh self record, health and role as the profile has them, or the
+// checkpoint's health on a rejoin
+static void enterPlay(const tGameCheckpoint *rejoin = NULL)
+{
+    if (!applyFlowProfile(false))
+    {
+        gameOnCritical("GAME_FAILED", false);
+    }
+    if (rejoin != NULL)
+    {
+        getSelfDataRecord()->health = rejoin->health;
+    }
+    espInitRxTx(getSelfTxPacket(), true, getSelfRadioProfile());
+    lastBaseStartedMs = 0;
+    inTheBase = 0;
+    if (!startGameCommunicator())
     {
         gameOnCritical("GAME_FAILED", false);
     }
+    if (rejoin != NULL)
+    {
+        gameCommunicatorRejoined(rejoin->secondsLeft);
+    }
+    enterPhase(gphPlay);
+}
+
+static void enterResult(tGameApiRole result)
+{
+    enterPhase(gphResult);
+    Serial.printf(">>> gameFlow: result <%s>\r\n", gameApiRoleName(result));
+    switch (result)
+    {
+        case garZombieWin:
+            gameShowStart(shwZombieWin);
+            postGameScreen(gsZombieWin, 0, 0, 0);
+        break;
+        case garHumanWin:
+            gameShowStart(shwHumanWin);
+            postGameScreen(gsHumanWin, 0, 0, 0);
+        break;
+        case garDraw:
+            gameShowStart(shwDraw);
+            postGameScreen(gsDraw, 0, 0, 0);
+        break;
+        default:
+            Serial.println(">>>>>>>>>> GAME OVER <<<<<<<<<<<");
+            postGameScreen(gsGameOver, 0, 0, 0);
+        break;
+    }
+}
+
+static uint32_t stepWait(void)
+{
+    uint16_t preTimeoutMs = 0;
+    tGameRole role = waitGamePoll(preTimeoutMs);
+    if (role == grNone)
+    {
+        return powerPolicyResting() ? GAME_FLOW_REST_MS : GAME_FLOW_PHASE_MS;
+    }
+    powerPolicyRest(false);
+    otaStageStop();
+    if (syncStageSwitch())
+    {
+        tftImageCacheLock();
+        tftImageCacheClear();
+        tftImageCacheUnlock();
+    }
+    if (flowLobby)
+    {
+        flowProfile = String(roleProfileFName(role) ? roleProfileFName(role) : "");
+        flowProfileJson = false;
+        flowRole = role;
+    }
+    // a fixed profile keeps its role, the server only says when the game starts
+    enterPreGame(flowRole, preTimeoutMs);
+    return 0;
+}
+
+static uint32_t stepPreGame(void)
+{
+    uint32_t elapsedMs = millis() - phaseStartMs;
+    if (elapsedMs >= flowPreMs)
+    {
+        if (flowRole == grZombie)
+        {
+            gamePlayPattern(gpZombieNeutral);
+        }
+        enterPlay();
+        return 0;
+    }
+    if (millis() - lastDrawMs >= 1000)
+    {
+        lastDrawMs = millis();
+        postGameScreen((flowRole == grHuman) ? gsHumanPre : gsZombiePre, 0, 0, (flowPreMs - elapsedMs) / 1000);
+    }
+    return GAME_FLOW_PHASE_MS;
+}
+
+static uint32_t stepPlay(void)
+{
+    tGameApiRole result;
+    if (gameCommunicatorStep(result))
+    {
+        stopCommunicator();
+        gameLogFinish(result);
+        enterResult(result);
+    }
+    else if (flowLobby)
+    {
+        tDeviceDataRecord *self = getSelfDataRecord();
+        gameCheckpointSave((uint8_t)self->deviceRole, self->health, gameCommunicatorSecondsLeft(), espGetProtocolId());
+    }
+    return GAME_FLOW_PLAY_MS;
+}
+
+static uint32_t stepResult(void)
+{
+    if (millis() - phaseStartMs >= GAME_RESULT_HOLD_MS)
+    {
+        enterWait(true);
+    }
+    return GAME_FLOW_PHASE_MS;
+}
+
+uint32_t gameFlowStep(void)
+{
+    switch (flowPhase)
+    {
+        case gphWait:
+            return stepWait();
+        case gphPreGame:
+            return stepPreGame();
+        case gphPlay:
+            return stepPlay();
+        case gphResult:
+            return stepResult();
+        default:
+            return GAME_FLOW_PHASE_MS;
+    }
+}
+
+// Straight into the interrupted game: the session's protocol ID so the
+// others hear the device at once, the role's profile with the health it had
+static bool rejoinGame(void)
+{
+    if (!gameRejoinPending())
+    {
+        return false;
+    }
+    gameRejoinDone();
+    const tGameCheckpoint &ck = gameRejoinState();
+    tGameRole role = (tGameRole)ck.role;
+    if (roleProfileFName(role) == NULL)
+    {
+        Serial.printf("*** gameWait WARNING! checkpoint role %u can not rejoin\r\n", (unsigned)ck.role);
+        gameCheckpointClear();
+        return false;
+    }
+    Serial.printf(">>> gameWait: REJOIN as %s, health %ld\r\n", role2str(role), (long)ck.health);
+    espSetProtocolId(ck.protocolId);
+    flowRole = role;
+    flowProfile = String(roleProfileFName(role));
+    flowProfileJson = false;
+    statusClientSetGameStatus("REJOIN");
+    enterPlay(&ck);
+    return true;
 }
 
 void gameWait(void)
 {
-    const uint32_t gameWaitToMs = (60 * 60 * 1000);
-    uint16_t preTimeoutMs;
     Serial.println(">>> gameWait");
-    valPlayPattern(GAME_WAIT_PATTERN);
-    gameWaitLogo();
-    tGameRole role = waitGame(preTimeoutMs, gameWaitToMs);
-    preGame(role, preTimeoutMs);
+    flowLobby = true;
+    if (rejoinGame())
+    {
+        return;
+    }
+    enterWait(false);
 }
 
 void gamePrintStep(tGameRole deviceRole, int zCount, int hCount, int bCount, int healPoints, int hitPoints, int healthPoints, bool isBase)
@@ -142,69 +562,139 @@ void gamePrintStep(tGameRole deviceRole, int zCount, int hCount, int bCount, int
     {
         healthPoints = 0;
     }
-    Serial.printf(">>> STEP #%05lu [%s] [%d] [Z: %d] [H: %d] [B: %d] [HEAL: %d] [HIT: %d] \r\n", 
-                            gameStep, role2str(deviceRole), healthPoints, zCount, hCount, bCount, healPoints, hitPoints);
+    tAudioStats audioStats = audioGetStats();
+    // two entries, a deferred line takes LOG_RING_ARGS arguments
+    LOGR(lmGame, llInfo, ">>> STEP #%05lu [%s] [%d] [Z: %d] [H: %d] [B: %d] [HEAL: %d] [HIT: %d] ",
+         gameStep, role2str(deviceRole), healthPoints, zCount, hCount, bCount, healPoints, hitPoints);
+    LOGR(lmGame, llInfo, "[SCR: %lu/%lu dropped, %lu/%lu ms] [AUD: %lu underruns, %lu late, %lu ms] \r\n",
+         screenStats.frames, screenStats.dropped, screenStats.avgFrameMs, screenStats.maxFrameMs,
+         audioStats.underruns, audioStats.lateFeeds, audioStats.maxFeedGapMs);
 }
 
+// What the outputs currently show, a step that maps to the same state draws nothing
+struct tGameVisualState
+{
+    tGameRole role = grNone;
+    int8_t    zoneSign = 0;
+    bool      inBase = false;
+    int32_t   healthBucket = 0;
+    int32_t   secLeft = -1;
+    inline bool operator==(const tGameVisualState &o) const
+    {
+        return (role == o.role) && (zoneSign == o.zoneSign) && (inBase == o.inBase) &&
+               (healthBucket == o.healthBucket) && (secLeft == o.secLeft);
+    }
+};
+
 void gameVisualizeStep(tGameRole deviceRole, int zCount, int hCount, int bCount, int healPoints, int hitPoints, int healthPoints, bool isBase, int secLeft)
 {
+    static tGameVisualState shown;
     int lifePoint = healPoints + hitPoints;
+
+    tGameVisualState cur;
+    cur.role = deviceRole;
+    cur.zoneSign = (lifePoint > 0) - (lifePoint < 0);
+    cur.inBase = inTheBase;
+    cur.healthBucket = healthPoints / GAME_VIS_HEALTH_BUCKET;
+    cur.secLeft = secLeft;
+    if (cur == shown)
+    {
+        return;
+    }
+    bool patternChanged = (cur.role != shown.role) || (cur.zoneSign != shown.zoneSign);
+    if ((cur.role != shown.role) && (shown.role != grNone))
+    {
+        sfxPlay(sfxRole);
+        gamePrefetch(pfPlay, cur.role);
+    }
+    else if ((cur.zoneSign != shown.zoneSign) && (cur.zoneSign != 0))
+    {
+        sfxPlay((cur.zoneSign < 0) ? sfxHit : sfxHeal);
+        gamePlayFlash((cur.zoneSign < 0) ? gpHitFlash : gpHealFlash);
+    }
+    shown = cur;
+
     if (inTheBase)
     {
-        tftGameScreenBase(healthPoints, lifePoint, secLeft);        
+        postGameScreen(gsBase, healthPoints, lifePoint, secLeft);
     }
     
     if (deviceRole == grZombie)    
     {
-        
-        //tftPrintText(String(healthPoints));
-        if (lifePoint == 0)
-        {
-            valPlayPattern(GAME_ZOMBIE_NEUTRAL);           
-        }
-        
-        if (lifePoint > 0)
+        if (patternChanged)
         {
-            valPlayPattern(GAME_ZOMBIE_HEALING);           
-        }
+            if (lifePoint == 0)
+            {
+                gamePlayPattern(gpZombieNeutral);           
+            }
+            
+            if (lifePoint > 0)
+            {
+                gamePlayPattern(gpZombieHealing);           
+            }
 
-        if (lifePoint < 0)
-        {
-            valPlayPattern(GAME_ZOMBIE_KILLING);           
+            if (lifePoint < 0)
+            {
+                gamePlayPattern(gpZombieKilling);           
+            }
         }
         
         if (!inTheBase)
         {
-            tftGameScreenZombie(healthPoints, lifePoint, secLeft);
+            postGameScreen(gsZombie, healthPoints, lifePoint, secLeft);
         }
     }
     
     if (deviceRole == grHuman)    
     {
-        
-        //tftPrintText(String(healthPoints), TFT_BLACK, TFT_RED);
-        if (lifePoint == 0)
-        {
-            valPlayPattern(GAME_HUMAN_NEUTRAL);           
-        }
-        
-        if (lifePoint > 0)
+        if (patternChanged)
         {
-            valPlayPattern(GAME_HUMAN_HEALING);           
-        }
+            if (lifePoint == 0)
+            {
+                gamePlayPattern(gpHumanNeutral);           
+            }
+            
+            if (lifePoint > 0)
+            {
+                gamePlayPattern(gpHumanHealing);           
+            }
 
-        if (lifePoint < 0)
-        {
-            valPlayPattern(GAME_HUMAN_KILLING);           
+            if (lifePoint < 0)
+            {
+                gamePlayPattern(gpHumanKilling);           
+            }
         }
 
         if (!inTheBase)
         {
-            tftGameScreenHuman(healthPoints, lifePoint, secLeft);
+            postGameScreen(gsHuman, healthPoints, lifePoint, secLeft);
         }
     }
 }
 
+// A base station with a panel shows the game instead of its own state,
+// redrawn when a count or the second changes
+static void gameScoreboardStep(int zCount, int hCount, int secLeft)
+{
+    static tScoreboard shown;
+    static bool shownValid = false;
+    static tScoreSource lastSource = scNone;
+    tScoreboard sb;
+    scoreboardGet(sb, hCount, zCount, secLeft);
+    if (sb.source != lastSource)
+    {
+        Serial.printf(">>> gameScoreboardStep: counts from %s\r\n", scoreSource2str(sb.source));
+        lastSource = sb.source;
+    }
+    if (shownValid && (sb.humans == shown.humans) && (sb.zombies == shown.zombies) && (sb.secLeft == shown.secLeft))
+    {
+        return;
+    }
+    shown = sb;
+    shownValid = true;
+    postGameScreen(gsScore, sb.humans, sb.zombies, sb.secLeft);
+}
+
 bool isInTheBase(int healPoints)
 {
     if (!healPoints)
@@ -237,16 +727,6 @@ bool isInTheBase(int healPoints)
     return inTheBase;
 }
 
-static void processGameOver(void)
-{
-    Serial.println(">>>>>>>>>> GAME OVER <<<<<<<<<<<");
-    gameOverPicture();
-    while(true)
-    {
-
-    }
-}
-
 static int32_t getGameDurationLeftS(void)
 {
     int32_t res;
@@ -265,7 +745,7 @@ static int32_t getGameDurationLeftS(void)
     return res;
 }
 
-bool doGameStep(String &role__, int &healthPoints__, int secondsLeft__)
+bool doGameStep(tGameRole &role__, int &healthPoints__, int secondsLeft__)
 {
     int zCount, hCount, bCount, healPoints, hitPoints, healthPoints;
     bool isBase;
@@ -287,26 +767,30 @@ bool doGameStep(String &role__, int &healthPoints__, int secondsLeft__)
         hitPoints = 0;
     }
 
-    role__ =  role2str(deviceRole);
+    if (getSelfArbiter())
+    {
+        baseArbiterStart();
+        baseArbiterTick();
+    }
+
+    role__ = deviceRole;
     healthPoints__ = healthPoints;
 
     if (healthPoints < 0)
     {
         Serial.println("***** UNDER ZERO HEALTH *****");
+        // the communicator keeps running, only the self record and the radio profile change
         tGameRole newRole = revertGameRole();   
-        // preGame(newRole, 10000); 
-        // healthPoints = getSelfDataRecord()->beginHealth;
         if (newRole == grHuman)
         {         
             Serial.println("***** TO HUMAN *****");
-            startZombieGame(GAME_SWAPROLE_PRE_MS);
         }
 
         if (newRole == grZombie)
         {        
             Serial.println("***** TO ZOMBIE *****");
-            startZombieGame(GAME_SWAPROLE_PRE_MS);
         }
+        espApplyRadioProfile(getSelfRadioProfile());
         
         lastBaseStartedMs = 0;
         inTheBase = 0;                
@@ -318,19 +802,33 @@ bool doGameStep(String &role__, int &healthPoints__, int secondsLeft__)
 
     if (deviceRole == grBase)
     {
+        if constexpr (devClass.display)
+        {
+            gameScoreboardStep(zCount, hCount, secLeft);
+        }
         secLeft = 3000;
     }
 
     if (secLeft <= 0) 
     {
         secLeft = 0;
-        //processGameOver();        
         //return false;
     }
 
     isInTheBase(healPoints);
-    gamePrintStep(deviceRole, zCount, hCount, bCount, healPoints, hitPoints, healthPoints, isBase);
+    uint32_t visualUs = loopProfNowUs();
     gameVisualizeStep(deviceRole, zCount, hCount, bCount, healPoints, hitPoints, healthPoints, isBase, secLeft);
+    loopProfSince(lsVisual, visualUs);
+    if (hitPoints < 0)
+    {
+        espHitStampDamage();
+    }
+    if (millis() - lastReportedMs < GAME_REPORT_INT_MS)
+    {
+        return true;
+    }
+    lastReportedMs = millis();
+    gamePrintStep(deviceRole, zCount, hCount, bCount, healPoints, hitPoints, healthPoints, isBase);
     return true;
 }
 
@@ -340,29 +838,46 @@ bool startFixedGame(String captS, String jsonS)
     Serial.print(">>> ");
     Serial.println(captS);
 
-    if (setSelfJson(jsonS, true))
+    if (!setSelfJson(jsonS, true))
     {
-        preGame(getSelfDataRecord()->deviceRole, fixedGameToMs);
-        espInitRxTx(getSelfTxPacket(), true);
-        startGameCommunicator();
-        return true;
+        return false;
     }
-    return false;
+    flowLobby = false;
+    flowProfile = jsonS;
+    flowProfileJson = true;
+    enterPreGame(getSelfDataRecord()->deviceRole, fixedGameToMs);
+    return true;
 }
 
 bool startGameFromFile(String captS, String fileName, uint16_t gameToMs)
 {        
     Serial.printf("\r\n>>> startGameFromFile [%s] [%s] [%lu ms]\r\n", captS.c_str(), fileName.c_str(), gameToMs);    
     stopCommunicator();
-    if (setSelfJsonFromFile(fileName))
-    {        
-        //preGame(getSelfDataRecord()->deviceRole, gameToMs);        
-        espInitRxTx(getSelfTxPacket(), true);
-        startGameCommunicator();
-        return true;
+    flowLobby = false;
+    flowProfile = fileName;
+    flowProfileJson = false;
+    if (!applyFlowProfile(false))
+    {
+        return false;
     }
-    
-    return false;
+    flowRole = getSelfDataRecord()->deviceRole;
+    startGameRadio();
+    enterPlay();
+    return true;
+}
+
+bool gameLoadRoleProfiles(void)
+{
+    const char *fileNames[] = {GAME_ZOMB_FNAME, GAME_HUMB_FNANE, GAME_BASE_FNAME, GAME_RSSI_FNAME};
+    bool res = true;
+    for (size_t i = 0; i < sizeof(fileNames) / sizeof(fileNames[0]); i++)
+    {
+        if (!loadRoleProfile(fileNames[i]))
+        {
+            res = false;
+        }
+    }
+    return res;
 }
 
 bool startZombieGame(uint16_t gameToMs)
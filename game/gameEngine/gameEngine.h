@@ -10,6 +10,12 @@
 #define GAME_RSSI_FNAME "/xcon_rsettings.json"
 #define GAME_FIXED_PRE_MS       10000
 #define GAME_SWAPROLE_PRE_MS    10000
+#define GAME_REPORT_INT_MS      1000    // serial step report period, health itself is updated every damage tick
+#define GAME_VIS_HEALTH_BUCKET  100     // the screen is redrawn when health crosses a bucket
+#define GAME_RESULT_HOLD_MS     15000   // result screen before the lobby takes over again
+#define GAME_FLOW_PLAY_MS       10      // loop task pass while playing
+#define GAME_FLOW_PHASE_MS      50      // loop task pass in the lobby, the countdown and on the result
+#define GAME_FLOW_REST_MS       250     // lobby pass while resting between rounds, a pushed game waits that long at most
 
 #define GAME_START_LIFE_POINT 10000
 #define GAME_MAX_TIME_MS      10 * 60 * 1000;  
@@ -46,17 +52,51 @@ struct tGameRecord
 
 };
 
+struct tGameScreenStats
+{
+    uint32_t frames = 0;
+    uint32_t dropped = 0;       // posted states overwritten before they were drawn
+    uint32_t lastFrameMs = 0;
+    uint32_t avgFrameMs = 0;
+    uint32_t maxFrameMs = 0;
+};
+
 bool testGameHuman(void);
 bool testGameZombie(void);
 bool testGameBase(void);
 bool testRssiMonitor(void);
 
 void gameOnCritical(String errS, bool noVal);
+void gameScreenGetStats(tGameScreenStats &st);
+// Game flow, wait -> pre-game -> play -> result -> wait, stepped from the
+// Arduino loop task; radio, uplink and display run in their own tasks
+// through every phase. gameWait() enters the lobby, the start*Game() calls a
+// fixed profile, which after a result waits for the server's next game. A
+// lobby game that a crash interrupted is rejoined by gameWait() right away,
+// see gameCheckpoint.h.
+enum tGamePhase
+{
+    gphIdle = 0,
+    gphWait,
+    gphPreGame,
+    gphPlay,
+    gphResult
+};
+
 void gameWait(void);
-String startGameCommunicator(void);
+uint32_t gameFlowStep(void);           // one pass of the current phase, ms until the next one
+tGamePhase gameFlowPhase(void);
+const char *gamePhaseName(tGamePhase phase);
+
+bool startGameRadio(void);             // beacons and the neighbour table, no game steps
+bool startGameCommunicator(void);
+bool gameCommunicatorStep(tGameApiRole &result);   // true with the result once the game is over
+int gameCommunicatorSecondsLeft(void);
+void gameCommunicatorRejoined(int secondsLeft);
 void stopCommunicator(void);
-bool doGameStep(String &role__, int &healthPoints__, int secondsLeft__);
+bool doGameStep(tGameRole &role__, int &healthPoints__, int secondsLeft__);
 bool startFixedGame(String captS, String jsonS);
+bool gameLoadRoleProfiles(void);
 bool startGameFromFile(String captS, String fileName, uint16_t gameToMs);
 
 bool startZombieGame(uint16_t gameToMs);
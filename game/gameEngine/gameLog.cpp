@@ -0,0 +1,358 @@
+#include "gameLog.h"
+
+#include <WiFi.h>
+#include <HTTPClient.h>
+#include <esp_heap_caps.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#if CONFIG_IDF_TARGET_ESP32S3
+#include <esp32s3/rom/miniz.h>
+#else
+#include <esp32/rom/miniz.h>
+#endif
+
+#include "xgConfig.h"
+#include "statusClient.h"
+#include "espRadio.h"
+#include "espHitStamp.h"
+#include "rssiFilter.h"
+#include "uplink.h"
+#include "pmLocks.h"
+#include "httpPool.h"
+#include "logRing.h"
+
+struct tZoneTrack
+{
+    uint64_t id;
+    uint8_t  zone;
+    bool     seen;
+};
+
+// buf holds one game: recorded by the game loop, then read by the uplink
+// task once finished; logMutex covers the hand-over
+static uint8_t *logBuf = NULL;
+static size_t logLen = 0;
+static bool logRecording = false;
+static bool logPending = false;     // finished, not uploaded yet
+static uint8_t logTries = 0;
+static uint32_t logStartMs = 0;
+static uint32_t logLastMs = 0;
+static SemaphoreHandle_t logMutex = NULL;
+
+static int logHealth = 0;
+static tGameRole logRole = grNone;
+static uint8_t logCounts[3];
+static tZoneTrack zones[GAME_LOG_ZONE_TRACK];
+static uint8_t zoneCount = 0;
+
+static tGameLogHeader &header(void)
+{
+    return *(tGameLogHeader *)logBuf;
+}
+
+static bool fits(size_t n, bool tail)
+{
+    if (logLen + n + (tail ? 0 : GAME_LOG_TAIL) <= GAME_LOG_BUF)
+    {
+        return true;
+    }
+    header().flags |= GAME_LOG_FLAG_TRUNCATED;
+    return false;
+}
+
+static void putVarint(uint32_t v)
+{
+    while (v >= 0x80)
+    {
+        logBuf[logLen++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    logBuf[logLen++] = (uint8_t)v;
+}
+
+// One event: up to 5 bytes of time, the type, payloadMax more bytes to follow
+static bool beginEvent(tGameLogEvent type, size_t payloadMax, bool tail = false)
+{
+    if (!logRecording || !fits(6 + payloadMax, tail))
+    {
+        return false;
+    }
+    uint32_t now = millis();
+    putVarint(now - logLastMs);
+    logLastMs = now;
+    logBuf[logLen++] = (uint8_t)type;
+    header().events++;
+    return true;
+}
+
+static void putHealth(int health)
+{
+    int32_t delta = health - logHealth;
+    if ((delta != 0) && beginEvent(glHealth, 5))
+    {
+        putVarint(((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31));
+        logHealth = health;
+    }
+}
+
+static void putZone(uint64_t id, uint8_t zone, int8_t rssi)
+{
+    if (beginEvent(glZone, sizeof(id) + 2))
+    {
+        memcpy(logBuf + logLen, &id, sizeof(id));
+        logLen += sizeof(id);
+        logBuf[logLen++] = zone;
+        logBuf[logLen++] = (uint8_t)rssi;
+    }
+}
+
+void gameLogStart(tGameRole role, int health)
+{
+    if (logMutex == NULL)
+    {
+        logMutex = xSemaphoreCreateMutex();
+    }
+    if (logBuf == NULL)
+    {
+        logBuf = (uint8_t *)heap_caps_malloc(GAME_LOG_BUF, MALLOC_CAP_SPIRAM);
+        if (logBuf == NULL)
+        {
+            Serial.println("!!! gameLogStart ERROR: out of PSRAM");
+            return;
+        }
+    }
+    if (xSemaphoreTake(logMutex, pdMS_TO_TICKS(GAME_LOG_LOCK_MS)) != pdTRUE)
+    {
+        Serial.println("*** gameLogStart WARNING! the last game's upload is busy, this game is not logged");
+        return;
+    }
+    if (logPending)
+    {
+        Serial.println("*** gameLogStart WARNING! the last game's log was not uploaded");
+        logPending = false;
+        uplinkUnregister(ucGameLog);
+    }
+    const char *name = statusClientGetName();
+    size_t nameLen = min(strlen(name), (size_t)255);
+
+    memset(logBuf, 0, sizeof(tGameLogHeader));
+    tGameLogHeader &hdr = header();
+    hdr.magic = GAME_LOG_MAGIC;
+    hdr.version = GAME_LOG_VERSION;
+    hdr.protocolId = espGetProtocolId();
+    hdr.startSharedMs = (espClockSource() != ecsNone) ? espClockNowMs() : 0;
+    hdr.startHealth = (int16_t)constrain(health, -32768, 32767);
+    hdr.startRole = (uint8_t)role;
+    logLen = sizeof(tGameLogHeader);
+    logBuf[logLen++] = (uint8_t)nameLen;
+    memcpy(logBuf + logLen, name, nameLen);
+    logLen += nameLen;
+
+    logStartMs = logLastMs = millis();
+    logHealth = health;
+    logRole = role;
+    memset(logCounts, 0, sizeof(logCounts));
+    zoneCount = 0;
+    logRecording = true;
+    xSemaphoreGive(logMutex);
+}
+
+// Only what changed since the last sample goes in
+void gameLogSample(tGameRole role, int health, const tGameApiTelemetry &telemetry)
+{
+    if (!logRecording)
+    {
+        return;
+    }
+    if ((role != logRole) && beginEvent(glRole, 1))
+    {
+        logBuf[logLen++] = (uint8_t)role;
+        logRole = role;
+    }
+    putHealth(health);
+    uint8_t counts[3] = {telemetry.zCount, telemetry.hCount, telemetry.bCount};
+    if (memcmp(counts, logCounts, sizeof(counts)) && beginEvent(glCounts, sizeof(counts)))
+    {
+        memcpy(logBuf + logLen, counts, sizeof(counts));
+        logLen += sizeof(counts);
+        memcpy(logCounts, counts, sizeof(counts));
+    }
+
+    for (uint8_t i = 0; i < zoneCount; i++)
+    {
+        zones[i].seen = false;
+    }
+    for (uint8_t n = 0; n < telemetry.neighborCount; n++)
+    {
+        const tGameApiNeighbor &nb = telemetry.neighbors[n];
+        uint8_t i = 0;
+        while ((i < zoneCount) && (zones[i].id != nb.id))
+        {
+            i++;
+        }
+        if (i == zoneCount)
+        {
+            if (zoneCount == GAME_LOG_ZONE_TRACK)
+            {
+                continue;
+            }
+            zones[zoneCount++] = {nb.id, rzOut, false};
+        }
+        zones[i].seen = true;
+        if (zones[i].zone != nb.zone)
+        {
+            zones[i].zone = nb.zone;
+            putZone(nb.id, nb.zone, nb.rssi);
+        }
+    }
+    // the ones that left the short list are out, their slots go to the next
+    for (uint8_t i = 0; i < zoneCount;)
+    {
+        if (zones[i].seen)
+        {
+            i++;
+            continue;
+        }
+        putZone(zones[i].id, rzOut, -128);
+        zones[i] = zones[--zoneCount];
+    }
+}
+
+void gameLogApiRtt(uint32_t ms)
+{
+    if (beginEvent(glApiRtt, 5))
+    {
+        putVarint(ms);
+    }
+}
+
+// Deflated into a buffer of its own, the next game may start logging while it goes out
+static uint8_t *deflateLog(size_t &outLen)
+{
+    outLen = 0;
+    if (xSemaphoreTake(logMutex, portMAX_DELAY) != pdTRUE)
+    {
+        return NULL;
+    }
+    if (!logPending)
+    {
+        xSemaphoreGive(logMutex);
+        return NULL;
+    }
+    size_t outMax = logLen + logLen / 8 + 64;
+    tdefl_compressor *comp = (tdefl_compressor *)heap_caps_malloc(sizeof(tdefl_compressor), MALLOC_CAP_SPIRAM);
+    uint8_t *out = (uint8_t *)heap_caps_malloc(outMax, MALLOC_CAP_SPIRAM);
+    bool ok = (comp != NULL) && (out != NULL) &&
+              (tdefl_init(comp, NULL, NULL, TDEFL_WRITE_ZLIB_HEADER | GAME_LOG_DEFLATE_PROBES) == TDEFL_STATUS_OKAY);
+    if (ok)
+    {
+        size_t inBytes = logLen;
+        outLen = outMax;
+        ok = tdefl_compress(comp, logBuf, &inBytes, out, &outLen, TDEFL_FINISH) == TDEFL_STATUS_DONE;
+    }
+    xSemaphoreGive(logMutex);
+    free(comp);
+    if (!ok)
+    {
+        Serial.println("!!! gameLog ERROR: deflate failed");
+        free(out);
+        return NULL;
+    }
+    return out;
+}
+
+static void gameLogService(void)
+{
+    size_t bodyLen;
+    uint8_t *body = deflateLog(bodyLen);
+    if (body == NULL)
+    {
+        uplinkUnregister(ucGameLog);
+        return;
+    }
+    String url = String(ConfigAPI::getServerUrl(csGame)) + "/api/gamelog";
+    int code = -1;
+    {
+        tPmHold hold(plHttp);
+        tHttpLease lease(url);
+        HTTPClient &logHttp = lease.http();
+        if (lease.begin(url))
+        {
+            logHttp.addHeader("Content-Type", GAME_LOG_CT);
+            code = logHttp.POST(body, bodyLen);
+            logHttp.end();
+        }
+    }
+    free(body);
+
+    // a server without the endpoint does not get it on the next try either
+    bool done = (code >= 200) && (code < 500);
+    if (done || (++logTries >= GAME_LOG_TRIES))
+    {
+        if (done)
+        {
+            Serial.printf(">>> gameLog: %u bytes sent as %u, server answered %d\r\n", (unsigned)logLen, (unsigned)bodyLen, code);
+        }
+        else
+        {
+            LOGR(lmGame, llWarn, "game log dropped after %u tries (%d)", (unsigned)logTries, code);
+        }
+        if (xSemaphoreTake(logMutex, portMAX_DELAY) == pdTRUE)
+        {
+            logPending = false;
+            xSemaphoreGive(logMutex);
+        }
+        uplinkUnregister(ucGameLog);
+    }
+}
+
+void gameLogFinish(tGameApiRole result)
+{
+    if (!logRecording)
+    {
+        return;
+    }
+    if (beginEvent(glHitLat, HIT_LAT_STAGE_COUNT * (2 + ESP_HIT_LAT_BUCKETS) * 5, true))
+    {
+        for (int s = 0; s < HIT_LAT_STAGE_COUNT; s++)
+        {
+            tHitLatStats stats;
+            espHitLatencyGet((tHitLatStage)s, stats);
+            putVarint(stats.count);
+            putVarint(stats.maxMs);
+            for (uint8_t b = 0; b < ESP_HIT_LAT_BUCKETS; b++)
+            {
+                putVarint(stats.hist[b]);
+            }
+        }
+    }
+    if (beginEvent(glEnd, 1, true))
+    {
+        logBuf[logLen++] = (uint8_t)result;
+    }
+    header().durationMs = millis() - logStartMs;
+    logRecording = false;
+    logPending = true;
+    logTries = 0;
+    Serial.printf(">>> gameLogFinish: %u events, %u bytes%s\r\n", (unsigned)header().events, (unsigned)logLen,
+                  (header().flags & GAME_LOG_FLAG_TRUNCATED) ? ", truncated" : "");
+    if (uplinkStart())
+    {
+        uplinkSetBulk(ucGameLog, true);
+        uplinkRegister(ucGameLog, GAME_LOG_UPLINK_PRIORITY, GAME_LOG_RETRY_MS, gameLogService);
+    }
+}
+
+void gameLogPrint(void)
+{
+    if (logBuf == NULL)
+    {
+        Serial.println(">>> gameLogPrint: no game logged");
+        return;
+    }
+    Serial.printf(">>> gameLogPrint: %s, %u events, %u of %u bytes, %u ms%s\r\n",
+                  logRecording ? "recording" : (logPending ? "upload pending" : "sent"),
+                  (unsigned)header().events, (unsigned)logLen, (unsigned)GAME_LOG_BUF,
+                  (unsigned)(logRecording ? millis() - logStartMs : header().durationMs),
+                  (header().flags & GAME_LOG_FLAG_TRUNCATED) ? ", truncated" : "");
+}
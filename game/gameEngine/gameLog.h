@@ -0,0 +1,72 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "gameRole.h"
+#include "gameComm.h"
+
+// Per-game analytics for balance tuning. While a game runs the game loop
+// appends compact events to a PSRAM buffer; the result phase deflates it and
+// the uplink task sends it in one POST /api/gamelog, so none of it competes
+// with the game's own reports. The game server keeps the logs per game and
+// merges them into one timeline for its replay view.
+//
+// Layout (little endian): tGameLogHeader, the device name as u8 length +
+// bytes, then events, each a varint of the ms since the previous event, a
+// type byte and its payload:
+//   glHealth   zigzag varint health change
+//   glCounts   zombies, humans and bases in range, u8 each
+//   glZone     neighbour id u64, zone (tRssiZone) and filtered RSSI i8, on
+//              every zone change; rzOut once it dropped out of the short list
+//   glRole     the device's new role u8
+//   glApiRtt   varint ms of a game API round trip
+//   glHitLat   per stage (espHitStamp.h) count, max ms and the histogram
+//              buckets as varints, once at the end
+//   glEnd      the result (tGameApiRole) u8, the last event
+
+#define GAME_LOG_MAGIC          0x314C475A  // "ZGL1"
+#define GAME_LOG_VERSION        1
+#define GAME_LOG_BUF            65536       // PSRAM, a long game of 2 samples/s needs about a third
+#define GAME_LOG_TAIL           192         // kept free for the summary events
+#define GAME_LOG_ZONE_TRACK     16          // neighbours whose zone is followed
+#define GAME_LOG_CT             "application/x-zgame-log"
+#define GAME_LOG_UPLINK_PRIORITY 0          // below the status client, the next game's reports go first
+#define GAME_LOG_RETRY_MS       5000
+#define GAME_LOG_TRIES          3
+#define GAME_LOG_LOCK_MS        200         // a new game waits this long for an upload still deflating
+#define GAME_LOG_DEFLATE_PROBES 32          // tdefl probes, the log is small and upload time matters more
+
+enum tGameLogEvent
+{
+    glHealth = 1,
+    glCounts,
+    glZone,
+    glRole,
+    glApiRtt,
+    glHitLat,
+    glEnd
+};
+
+struct __attribute__((packed)) tGameLogHeader
+{
+    uint32_t magic;
+    uint8_t  version;
+    uint8_t  flags;             // GAME_LOG_FLAG_*
+    uint16_t events;
+    uint32_t protocolId;        // the session, espGetProtocolId()
+    uint64_t startSharedMs;     // shared clock at the first event, 0 = none set
+    uint32_t durationMs;
+    int16_t  startHealth;
+    uint8_t  startRole;
+    uint8_t  reserved;
+};
+
+#define GAME_LOG_FLAG_TRUNCATED 0x01        // the buffer filled up, later events are missing
+
+// Game loop only
+void gameLogStart(tGameRole role, int health);
+void gameLogSample(tGameRole role, int health, const tGameApiTelemetry &telemetry);
+void gameLogApiRtt(uint32_t ms);
+// Closes the log and queues its upload on the uplink
+void gameLogFinish(tGameApiRole result);
+void gameLogPrint(void);
@@ -0,0 +1,194 @@
+#include "gameMcast.h"
+
+#include <AsyncUDP.h>
+
+#include "gamePush.h"
+#include "espRelay.h"
+#include "scoreboard.h"
+#include "statusClient.h"
+#include "uplink.h"
+#include "xgConfig.h"
+
+static AsyncUDP mcastUdp;
+static bool mcastListening = false;
+static volatile uint32_t lastRxMs = 0;
+static volatile bool rxSeen = false;
+
+// AsyncUDP task only
+static uint32_t ownHash = 0;
+static uint32_t lastSeq = 0;
+static bool seqValid = false;
+static bool seqFound = false;
+static tEspRelayEntry relayEntries[ESP_RELAY_MAX];
+
+
+uint32_t gameMcastIdHash(const char *id)
+{
+    uint32_t hash = 2166136261UL;
+    while (*id)
+    {
+        hash ^= (uint8_t)*id++;
+        hash *= 16777619UL;
+    }
+    return hash;
+}
+
+// Devices out of WiFi range get the tick over ESP-NOW
+static void offerRelay(const tGameMcastHeader &hdr, const uint8_t *p)
+{
+    tEspRelayState state;
+    state.seq = hdr.seq;
+    state.phase = hdr.phase;
+    state.timeLeft = hdr.timeLeft;
+    state.gameTimeout = hdr.gameTimeout;
+    uint16_t count = min(hdr.count, (uint16_t)ESP_RELAY_MAX);
+    for (uint16_t i = 0; i < count; i++, p += sizeof(tGameMcastEntry))
+    {
+        tGameMcastEntry entry;
+        memcpy(&entry, p, sizeof(entry));
+        relayEntries[i].idHash = entry.idHash;
+        relayEntries[i].role = entry.role;
+    }
+    espRelayOffer(state, relayEntries, count);
+}
+
+// the server fills the gap with a regular report
+static void requestRepair(void)
+{
+    uplinkKick(ucGameApi);
+}
+
+static void fillState(tGameApiResponse &resp, uint8_t phase, uint8_t role, uint16_t timeLeft, uint16_t gameTimeout)
+{
+    resp.role = (role < GAME_API_ROLE_COUNT) ? (tGameApiRole)role : garNeutral;
+    resp.status = (phase < GAME_API_PHASE_COUNT) ? (tGameApiPhase)phase : gapUnknown;
+    resp.game_duration = timeLeft;
+    resp.game_timeout = gameTimeout;
+}
+
+static void deliverEntry(const tGameMcastHeader &hdr, const tGameMcastEntry &entry)
+{
+    tGameApiResponse resp;
+    fillState(resp, hdr.phase, entry.role, hdr.timeLeft, hdr.gameTimeout);
+    resp.beacon_slot = entry.beaconSlot;
+    resp.beacon_slots = hdr.beaconSlots;
+    resp.beacon_frame_ms = hdr.beaconFrameMs;
+    resp.server_ms = hdr.serverMs;
+    resp.channel = hdr.channel;
+    resp.protocol_id = hdr.protocolId;
+    resp.rxMs = millis();
+    resp.success = true;
+    gamePushDeliver(resp);
+}
+
+static void onMcastPacket(AsyncUDPPacket &packet)
+{
+    size_t len = packet.length();
+    const uint8_t *data = packet.data();
+    tGameMcastHeader hdr;
+    if (protoDecode(hdr, data, len, GAME_MCAST_VERSION) == 0)
+    {
+        return;
+    }
+    if ((hdr.magic != GAME_MCAST_MAGIC) || (hdr.version != GAME_MCAST_VERSION) ||
+        (len < sizeof(hdr) + hdr.count * sizeof(tGameMcastEntry)))
+    {
+        return;
+    }
+    lastRxMs = millis();
+    rxSeen = true;
+
+    if (!seqValid || (hdr.seq != lastSeq))
+    {
+        // the previous tick was lost in part or did not list us
+        if (seqValid && ((hdr.seq != lastSeq + 1) || !seqFound))
+        {
+            requestRepair();
+        }
+        seqValid = true;
+        lastSeq = hdr.seq;
+        seqFound = false;
+    }
+    offerRelay(hdr, data + sizeof(hdr));
+    scoreboardOnMcast(hdr, data + sizeof(hdr));
+    if (seqFound)
+    {
+        return;
+    }
+
+    const uint8_t *p = data + sizeof(hdr);
+    for (int i = 0; i < hdr.count; i++, p += sizeof(tGameMcastEntry))
+    {
+        tGameMcastEntry entry;
+        memcpy(&entry, p, sizeof(entry));
+        if (entry.idHash == ownHash)
+        {
+            seqFound = true;
+            deliverEntry(hdr, entry);
+            break;
+        }
+    }
+}
+
+IPAddress gameMcastGroup(void)
+{
+    IPAddress group = GAME_MCAST_GROUP;
+    group[3] += ConfigAPI::getArena();
+    return group;
+}
+
+bool gameMcastBegin(void)
+{
+    if (mcastListening)
+    {
+        return true;
+    }
+    ownHash = gameMcastIdHash(statusClientGetName());
+    seqValid = false;
+    IPAddress group = gameMcastGroup();
+    if (!mcastUdp.listenMulticast(group, GAME_MCAST_PORT))
+    {
+        Serial.println("!!! gameMcastBegin ERROR: listenMulticast failed");
+        return false;
+    }
+    mcastUdp.onPacket(onMcastPacket);
+    mcastListening = true;
+    Serial.printf(">>> gameMcastBegin: listening on %s:%d\r\n", group.toString().c_str(), GAME_MCAST_PORT);
+    return true;
+}
+
+void gameMcastStop(void)
+{
+    if (mcastListening)
+    {
+        mcastUdp.close();
+        mcastListening = false;
+    }
+    rxSeen = false;
+}
+
+bool gameMcastAlive(void)
+{
+    return rxSeen && (millis() - lastRxMs < GAME_MCAST_STALE_MS);
+}
+
+void gameMcastRelayStart(void)
+{
+    espRelayStart(gameMcastIdHash(statusClientGetName()));
+}
+
+// Beacon slot and server clock stay as they are, the relay does not carry them
+bool gameMcastRelayTake(tGameApiResponse &resp)
+{
+    tEspRelayState state;
+    uint8_t role;
+    if (!espRelayTake(state, role))
+    {
+        return false;
+    }
+    fillState(resp, state.phase, role, state.timeLeft, state.gameTimeout);
+    resp.rxMs = millis();
+    resp.relayed = true;
+    resp.success = true;
+    return true;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "gameComm.h"          // and gameProtocol.h: tGameMcastHeader, tGameMcastEntry
+
+// Game state multicast from the game server: one datagram set per tick
+// carries the phase, time left and a compact role table for every device,
+// so devices do not have to ask. A sequence gap or a tick without our own
+// entry kicks an immediate /api/device report to repair the state. The ticks
+// also go on over ESP-NOW (espRelay.h) to devices out of WiFi range.
+
+#define GAME_MCAST_GROUP            IPAddress(239, 77, 71, 1)       // arena 0, arena N listens on .1+N
+#define GAME_MCAST_PORT             4211
+#define GAME_MCAST_STALE_MS         3000    // no datagram for this long = not alive
+
+uint32_t gameMcastIdHash(const char *id);
+IPAddress gameMcastGroup(void);     // of the device's arena, MCAST_GROUP of its game server
+bool gameMcastBegin(void);
+void gameMcastStop(void);
+bool gameMcastAlive(void);
+void gameMcastRelayStart(void);
+bool gameMcastRelayTake(tGameApiResponse &resp);  // relayed state for this device, once
@@ -0,0 +1,54 @@
+#include "gamePinger.h"
+#include "gameRole.h"
+#include "espRadio.h"
+#include "espPing.h"
+#include "tft_utils.h"
+#include "taskRegistry.h"
+
+static tEspPacket pingerPacket;
+static TaskHandle_t pingerHandle = NULL;
+
+static void pingerScreen(void)
+{
+    tEspPingStats st;
+    espPingGetStats(st);
+    char line1[32];
+    char line2[32];
+    char line3[32];
+    snprintf(line1, sizeof(line1), "RTT %u/%u ms", (unsigned)(st.p50Us / 1000), (unsigned)(st.p95Us / 1000));
+    snprintf(line2, sizeof(line2), "LOSS %u%%", (unsigned)st.lossPct);
+    snprintf(line3, sizeof(line3), "DEV %u/%u", (unsigned)st.reachable, (unsigned)st.peers);
+    tftPrintThreeLines(line1, line2, line3, TFT_BLACK, st.reachable ? TFT_GREEN : TFT_RED);
+}
+
+// Stands in for the radio task: a request, then the pongs until the next one
+static void pingerTask(void *pvParameters)
+{
+    unsigned long lastScreenMs = 0;
+    Serial.println(">>> pingerTask: STARTED");
+    while (true)
+    {
+        espChannelService();
+        espPingSend(&pingerPacket);
+        espProcessRx(ESP_PING_INTERVAL_MS);
+        if (millis() - lastScreenMs >= PINGER_SCREEN_MS)
+        {
+            pingerScreen();
+            lastScreenMs = millis();
+        }
+    }
+}
+
+bool startPinger(void)
+{
+    if (pingerHandle != NULL)
+    {
+        return true;
+    }
+    Serial.println(">>> startPinger");
+    pingerPacket.deviceRole = grPinger;
+    espInitRxTx(&pingerPacket, true);
+    espPingStart(pingerPacket.deviceID);
+    tftPrintThreeLines("PINGER", "", "", TFT_BLACK, TFT_GREEN);
+    return taskStart(tkPinger, pingerTask, NULL, &pingerHandle);
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <Arduino.h>
+
+// The "fixPinger" device role: no game, the device sends an ESP-NOW echo
+// request every ESP_PING_INTERVAL_MS (espPing.h) and shows the RTT, the loss
+// and the reachable device count; the same goes to the status server.
+
+#define PINGER_SCREEN_MS    1000
+
+bool startPinger(void);
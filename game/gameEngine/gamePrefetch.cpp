@@ -0,0 +1,98 @@
+#include "gamePrefetch.h"
+#include "patterns.h"
+#include "tft_utils.h"
+#include "serverSync.h"
+#include "taskRegistry.h"
+
+static TaskHandle_t prefetchHandle = NULL;
+static volatile uint32_t wantGen = 0;
+static volatile tPrefetchPhase wantPhase = pfWait;
+static volatile tGameRole wantRole = grNone;
+
+static const char *const waitPictures[] = {
+    TFT_PIC_PRE_ZOMBIE, TFT_PIC_PRE_HUMAN, TFT_PIC_PRE_BASE,
+    TFT_GAME_ZOMB_ICO_FNAME, TFT_GAME_HUMN_ICO_FNAME, TFT_GAME_BASE_ICO_FNAME
+};
+static const tGamePattern waitPatterns[] = {gpRoleZombie, gpRoleHuman, gpRoleBase, gpZombieNeutral};
+
+static const char *const playPictures[] = {
+    TFT_PIC_ZOMBIE_WIN, TFT_PIC_HUMAN_WIN, TFT_PIC_DRAW, TFT_PIC_GAME_OVER
+};
+
+// False once a newer phase was asked for
+static bool fresh(uint32_t gen)
+{
+    return gen == wantGen;
+}
+
+static void warmSound(const char *fName)
+{
+    if (fName != NULL)
+    {
+        ensureFileInPsram(fName);
+    }
+}
+
+static void prefetchPhase(uint32_t gen, tPrefetchPhase phase, tGameRole role)
+{
+    uint32_t startMs = millis();
+    uint8_t pictures = 0;
+    if (phase == pfWait)
+    {
+        for (size_t i = 0; (i < sizeof(waitPictures) / sizeof(waitPictures[0])) && fresh(gen); i++)
+        {
+            pictures += tftBmpPrefetch(waitPictures[i]);
+        }
+        for (size_t i = 0; (i < sizeof(waitPatterns) / sizeof(waitPatterns[0])) && fresh(gen); i++)
+        {
+            warmSound(gamePatternSound(waitPatterns[i]));
+        }
+    }
+    else
+    {
+        for (size_t i = 0; (i < sizeof(playPictures) / sizeof(playPictures[0])) && fresh(gen); i++)
+        {
+            pictures += tftBmpPrefetch(playPictures[i]);
+        }
+        // a human that gets bitten plays on as a zombie
+        if ((role == grHuman) && fresh(gen))
+        {
+            pictures += tftBmpPrefetch(TFT_GAME_ZOMB_ICO_FNAME);
+            warmSound(gamePatternSound(gpZombieNeutral));
+        }
+        for (int i = 0; (i < shwCount) && fresh(gen); i++)
+        {
+            warmSound(gameShowSound((tGameShow)i));
+        }
+    }
+    Serial.printf(">>> gamePrefetch: %s phase, %u pictures ready in %lu ms%s\r\n", (phase == pfWait) ? "wait" : "play",
+                  pictures, millis() - startMs, fresh(gen) ? "" : " (superseded)");
+}
+
+static void prefetchTask(void *pvParameters)
+{
+    while (true)
+    {
+        uint32_t gen = wantGen;
+        prefetchPhase(gen, wantPhase, wantRole);
+        if (fresh(gen))
+        {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        }
+    }
+}
+
+void gamePrefetch(tPrefetchPhase phase, tGameRole role)
+{
+#if GAME_PREFETCH
+    wantPhase = phase;
+    wantRole = role;
+    wantGen++;
+    if (prefetchHandle == NULL)
+    {
+        taskStart(tkPrefetch, prefetchTask, NULL, &prefetchHandle);
+        return;
+    }
+    xTaskNotifyGive(prefetchHandle);
+#endif
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "gameRole.h"
+
+// Next phase assets ahead of time: while waiting for a game the pre-game
+// pictures and role tracks, once the role is known the result pictures, the
+// other role's icon and the show tracks. A low priority task decodes the
+// bitmaps into the image cache and gives every file a PSRAM copy, so the
+// screen of a phase change is drawn in one frame and its sound starts
+// without a flash read.
+
+#ifndef GAME_PREFETCH
+#define GAME_PREFETCH   1
+#endif
+
+enum tPrefetchPhase
+{
+    pfWait,             // lobby: pre-game screens next
+    pfPlay              // in a game: result screens and a role swap next
+};
+
+// Any task, cheap: the prefetcher drops what it was doing for the newest phase
+void gamePrefetch(tPrefetchPhase phase, tGameRole role = grNone);
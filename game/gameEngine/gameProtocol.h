@@ -0,0 +1,104 @@
+#pragma once
+
+// Generated by buildscript_protocol.py from protocol/zgame_messages.json, do not edit
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define GAME_API_BIN_MAGIC    0x445A    // "ZD"
+#define GAME_API_BIN_VERSION  2         // 2: the neighbours carry their delivery ratio
+#define GAME_MCAST_MAGIC      0x475A    // "ZG"
+#define GAME_MCAST_VERSION    1
+
+// The target is little endian, so a packed struct is its own wire image and
+// an older version of a message is a prefix of it
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "wire format is little endian");
+
+template <typename T> constexpr size_t protoSize(uint8_t version);
+
+// POST /api/device body: this header, then id, role, status and comment as u8 length + bytes, then neighborCount tGameApiBinNeighbor
+struct __attribute__((packed)) tGameApiBinHeader
+{
+    uint16_t magic;
+    uint8_t  version;
+    uint8_t  neighborCount;
+    uint32_t ip;
+    int8_t   rssi;
+    uint8_t  battery;
+    int16_t  health;
+    uint8_t  zCount;
+    uint8_t  hCount;
+    uint8_t  bCount;
+    uint8_t  apChannel;         // channel of the AP the device is associated to, 0 = unknown
+};
+static_assert(sizeof(tGameApiBinHeader) == 16, "tGameApiBinHeader layout");
+template <> constexpr size_t protoSize<tGameApiBinHeader>(uint8_t) { return 16; }
+
+struct __attribute__((packed)) tGameApiBinNeighbor
+{
+    uint64_t id;
+    uint8_t  role;
+    int8_t   rssi;
+    uint8_t  zone;
+    uint8_t  pdr;               // % of its frames heard, since version 2
+};
+static_assert(sizeof(tGameApiBinNeighbor) == 12, "tGameApiBinNeighbor layout");
+template <> constexpr size_t protoSize<tGameApiBinNeighbor>(uint8_t version) { return version >= 2 ? 12 : 11; }
+
+// Game state multicast datagram: this header, then count tGameMcastEntry
+struct __attribute__((packed)) tGameMcastHeader
+{
+    uint16_t magic;
+    uint8_t  version;
+    uint8_t  phase;             // tGameApiPhase
+    uint32_t seq;               // one per tick, shared by all parts
+    uint64_t serverMs;
+    uint16_t gameTimeout;
+    uint16_t timeLeft;          // seconds
+    uint8_t  beaconSlots;
+    uint8_t  channel;
+    uint16_t beaconFrameMs;
+    uint32_t protocolId;
+    uint8_t  part;
+    uint8_t  parts;
+    uint16_t count;             // tGameMcastEntry records that follow
+};
+static_assert(sizeof(tGameMcastHeader) == 32, "tGameMcastHeader layout");
+template <> constexpr size_t protoSize<tGameMcastHeader>(uint8_t) { return 32; }
+
+struct __attribute__((packed)) tGameMcastEntry
+{
+    uint32_t idHash;            // FNV-1a of the device name
+    uint8_t  role;              // tGameApiRole
+    uint8_t  beaconSlot;
+};
+static_assert(sizeof(tGameMcastEntry) == 6, "tGameMcastEntry layout");
+template <> constexpr size_t protoSize<tGameMcastEntry>(uint8_t) { return 6; }
+
+// Bytes written or read at that version of the message, 0 if size is short.
+// Decoding an older version leaves the newer fields zero.
+template <typename T>
+inline size_t protoEncode(const T &msg, uint8_t *dst, size_t size, uint8_t version)
+{
+    size_t n = protoSize<T>(version);
+    if (n > size)
+    {
+        return 0;
+    }
+    memcpy(dst, &msg, n);
+    return n;
+}
+
+template <typename T>
+inline size_t protoDecode(T &msg, const uint8_t *src, size_t size, uint8_t version)
+{
+    size_t n = protoSize<T>(version);
+    if (n > size)
+    {
+        return 0;
+    }
+    memset(&msg, 0, sizeof(msg));
+    memcpy(&msg, src, n);
+    return n;
+}
@@ -0,0 +1,351 @@
+#include "gamePush.h"
+
+#include <AsyncTCP.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+#include "statusClient.h"
+#include "gameMcast.h"
+
+enum tChunkState
+{
+    csSize = 0,
+    csData,
+    csDataEnd
+};
+
+static AsyncClient *pushClient = NULL;
+static volatile bool pushConnected = false;     // headers accepted, events flowing
+static String pushUrl = "";
+static char pushHost[64] = {0};
+static uint16_t pushPort = 80;
+static uint32_t lastAttemptMs = 0;
+
+// parser state, only touched from the AsyncTCP task
+static bool headersDone = false;
+static bool statusLine = true;
+static bool chunked = false;
+static tChunkState chunkState = csSize;
+static size_t chunkLeft = 0;
+static char chunkSizeBuf[12];
+static size_t chunkSizeLen = 0;
+static char lineBuf[GAME_PUSH_LINE_BUF];
+static size_t lineLen = 0;
+static bool lineOverflow = false;
+
+static SemaphoreHandle_t pushMutex = NULL;
+static tGameApiResponse pushResp;
+static bool pushFresh = false;
+
+static void resetParser(void)
+{
+    headersDone = false;
+    statusLine = true;
+    chunked = false;
+    chunkState = csSize;
+    chunkLeft = 0;
+    chunkSizeLen = 0;
+    lineLen = 0;
+    lineOverflow = false;
+}
+
+static void storeEvent(const char *json, size_t len)
+{
+    tGameApiResponse resp;
+    if (!gameApiParseResponse(json, len, resp))
+    {
+        Serial.println("!!! gamePush ERROR: bad event");
+        return;
+    }
+    resp.rxMs = millis();
+    gamePushDeliver(resp);
+}
+
+void gamePushDeliver(const tGameApiResponse &resp)
+{
+    if (pushMutex == NULL)
+    {
+        return;
+    }
+    if (xSemaphoreTake(pushMutex, pdMS_TO_TICKS(50)) == pdTRUE)
+    {
+        pushResp = resp;
+        pushFresh = true;
+        xSemaphoreGive(pushMutex);
+    }
+}
+
+static void handleLine(AsyncClient *client, char *line, size_t len)
+{
+    if (!headersDone)
+    {
+        if (statusLine)
+        {
+            statusLine = false;
+            // "HTTP/1.1 200 OK"
+            char *code = strchr(line, ' ');
+            if ((code == NULL) || (atoi(code + 1) != 200))
+            {
+                Serial.printf("!!! gamePush ERROR: [%s]\r\n", line);
+                client->close();
+            }
+            return;
+        }
+        if (len == 0)
+        {
+            headersDone = true;
+            pushConnected = true;
+            Serial.println(">>> gamePush: events connected");
+            return;
+        }
+        if ((strncasecmp(line, "Transfer-Encoding:", 18) == 0) && strstr(line + 18, "chunked"))
+        {
+            chunked = true;
+        }
+        return;
+    }
+
+    // "data: {...}", comment lines (": keepalive") and blank separators are skipped
+    if (strncmp(line, "data:", 5) == 0)
+    {
+        char *json = line + 5;
+        if (*json == ' ')
+        {
+            json++;
+        }
+        storeEvent(json, len - (json - line));
+    }
+}
+
+static void lineByte(AsyncClient *client, char c)
+{
+    if (c == '\n')
+    {
+        if (lineLen && (lineBuf[lineLen - 1] == '\r'))
+        {
+            lineLen--;
+        }
+        lineBuf[lineLen] = 0;
+        if (!lineOverflow)
+        {
+            handleLine(client, lineBuf, lineLen);
+        }
+        lineLen = 0;
+        lineOverflow = false;
+        return;
+    }
+    if (lineLen < GAME_PUSH_LINE_BUF - 1)
+    {
+        lineBuf[lineLen++] = c;
+    }
+    else
+    {
+        lineOverflow = true;
+    }
+}
+
+static void bodyByte(AsyncClient *client, char c)
+{
+    if (!chunked)
+    {
+        lineByte(client, c);
+        return;
+    }
+    switch (chunkState)
+    {
+    case csSize:
+        if (c == '\n')
+        {
+            chunkSizeBuf[chunkSizeLen] = 0;
+            chunkLeft = strtoul(chunkSizeBuf, NULL, 16);
+            chunkSizeLen = 0;
+            if (chunkLeft == 0)
+            {
+                // end of the stream
+                client->close();
+                return;
+            }
+            chunkState = csData;
+        }
+        else if (chunkSizeLen < sizeof(chunkSizeBuf) - 1)
+        {
+            chunkSizeBuf[chunkSizeLen++] = c;
+        }
+        break;
+    case csData:
+        lineByte(client, c);
+        if (--chunkLeft == 0)
+        {
+            chunkState = csDataEnd;
+        }
+        break;
+    case csDataEnd:
+        if (c == '\n')
+        {
+            chunkState = csSize;
+        }
+        break;
+    }
+}
+
+static void onPushData(void *arg, AsyncClient *client, void *data, size_t len)
+{
+    const char *p = (const char *)data;
+    for (size_t i = 0; i < len; i++)
+    {
+        if (headersDone)
+        {
+            bodyByte(client, p[i]);
+        }
+        else
+        {
+            lineByte(client, p[i]);
+        }
+    }
+}
+
+static void onPushConnect(void *arg, AsyncClient *client)
+{
+    char req[192];
+    snprintf(req, sizeof(req),
+             "GET /api/events?id=%s HTTP/1.1\r\nHost: %s:%u\r\nAccept: text/event-stream\r\nCache-Control: no-cache\r\n\r\n",
+             statusClientGetName(), pushHost, pushPort);
+    client->setRxTimeout(GAME_PUSH_RX_TIMEOUT_S);
+    client->write(req);
+}
+
+static void onPushDisconnect(void *arg, AsyncClient *client)
+{
+    if (pushConnected)
+    {
+        Serial.println("*** gamePush: events disconnected");
+    }
+    pushConnected = false;
+}
+
+static void onPushError(void *arg, AsyncClient *client, int8_t error)
+{
+    Serial.printf("!!! gamePush ERROR: %s\r\n", client->errorToString(error));
+}
+
+// "http://host[:port][/...]"
+static bool parseServerUrl(const String &url)
+{
+    int start = url.indexOf("://");
+    start = (start < 0) ? 0 : start + 3;
+    int end = url.indexOf('/', start);
+    String hostPort = (end < 0) ? url.substring(start) : url.substring(start, end);
+    int colon = hostPort.indexOf(':');
+    String host = (colon < 0) ? hostPort : hostPort.substring(0, colon);
+    if (host.isEmpty() || (host.length() >= sizeof(pushHost)))
+    {
+        return false;
+    }
+    strcpy(pushHost, host.c_str());
+    pushPort = (colon < 0) ? 80 : hostPort.substring(colon + 1).toInt();
+    return pushPort != 0;
+}
+
+bool gamePushBegin(const char *serverURL)
+{
+    if (pushMutex == NULL)
+    {
+        pushMutex = xSemaphoreCreateMutex();
+    }
+    if (pushClient == NULL)
+    {
+        pushClient = new AsyncClient();
+        pushClient->onConnect(onPushConnect);
+        pushClient->onDisconnect(onPushDisconnect);
+        pushClient->onError(onPushError);
+        pushClient->onData(onPushData);
+    }
+    gameMcastBegin();
+
+    if (pushUrl != serverURL)
+    {
+        if (!pushClient->disconnected())
+        {
+            pushClient->close(true);
+        }
+        pushUrl = serverURL;
+        lastAttemptMs = millis() - GAME_PUSH_RECONNECT_MS;
+    }
+    if (!pushClient->disconnected())
+    {
+        return pushConnected;
+    }
+    if (millis() - lastAttemptMs < GAME_PUSH_RECONNECT_MS)
+    {
+        return false;
+    }
+    lastAttemptMs = millis();
+
+    if (!parseServerUrl(serverURL))
+    {
+        Serial.printf("!!! gamePushBegin ERROR: bad server URL [%s]\r\n", serverURL);
+        return false;
+    }
+    resetParser();
+    pushConnected = false;
+    pushClient->connect(pushHost, pushPort);
+    return false;
+}
+
+void gamePushStop(void)
+{
+    if ((pushClient != NULL) && !pushClient->disconnected())
+    {
+        pushClient->close(true);
+    }
+    pushConnected = false;
+    pushUrl = "";
+}
+
+bool gamePushConnected(void)
+{
+    return pushConnected;
+}
+
+bool gamePushAlive(void)
+{
+    return pushConnected || gameMcastAlive();
+}
+
+bool gamePushTake(tGameApiResponse &resp)
+{
+    bool res = false;
+    if ((pushMutex == NULL) || !pushFresh)
+    {
+        return false;
+    }
+    if (xSemaphoreTake(pushMutex, pdMS_TO_TICKS(10)) == pdTRUE)
+    {
+        if (pushFresh)
+        {
+            resp = pushResp;
+            pushFresh = false;
+            res = true;
+        }
+        xSemaphoreGive(pushMutex);
+    }
+    return res;
+}
+
+bool gamePushWait(tGameApiResponse &resp, uint32_t toMs)
+{
+    uint32_t startMs = millis();
+    while (millis() - startMs < toMs)
+    {
+        if (gamePushTake(resp))
+        {
+            return true;
+        }
+        if (!gamePushAlive())
+        {
+            return false;
+        }
+        delay(20);
+    }
+    return false;
+}
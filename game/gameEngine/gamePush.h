@@ -0,0 +1,23 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "gameComm.h"
+
+// Server push channel: a long-lived GET /api/events (server-sent events) on
+// AsyncTCP and the game state multicast (gameMcast.h). Every pushed state lands
+// as a tGameApiResponse, so role changes, timeouts and game results arrive
+// without polling.
+
+#define GAME_PUSH_LINE_BUF          768     // one SSE line, a full state fits
+#define GAME_PUSH_RECONNECT_MS      3000
+#define GAME_PUSH_RX_TIMEOUT_S      25      // the server sends a keepalive every 10 s
+#define GAME_PUSH_HEARTBEAT_MS      5000    // device report interval while push is up
+
+bool gamePushBegin(const char *serverURL);  // (re)connects if needed, rate limited
+void gamePushStop(void);
+bool gamePushConnected(void);
+bool gamePushAlive(void);                   // events stream up or multicast heard
+void gamePushDeliver(const tGameApiResponse &resp);
+bool gamePushTake(tGameApiResponse &resp);  // latest pushed state, once
+bool gamePushWait(tGameApiResponse &resp, uint32_t toMs);
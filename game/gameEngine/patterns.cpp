@@ -0,0 +1,107 @@
+#include "patterns.h"
+#include "valPlayer.h"
+#include "espTimecode.h"
+
+static const char *const gamePatternNames[gpCount] = {
+    WHILE_BOOT_PATTERN,
+    ON_BOOT_PATTERN,
+    GAME_WAIT_PATTERN,
+    ROLE_ZOMBI_PATTERN,
+    ROLE_HUMAN_PATTERN,
+    BASE_ROLE_PATTERN,
+    GAME_ZOMBIE_NEUTRAL,
+    GAME_ZOMBIE_HEALING,
+    GAME_ZOMBIE_KILLING,
+    GAME_HUMAN_NEUTRAL,
+    GAME_HUMAN_HEALING,
+    GAME_HUMAN_KILLING,
+    ERROR_PATTERN,
+    GAME_HIT_FLASH,
+    GAME_HEAL_FLASH
+};
+
+static uint8_t gamePatternIds[gpCount];
+static bool resolved = false;
+static uint16_t resolvedGen = 0;     // valPackGeneration() the IDs are of
+
+void gamePatternsResolve(void)
+{
+    resolvedGen = valPackGeneration();
+    for (int i = 0; i < gpCount; i++)
+    {
+        gamePatternIds[i] = valPatternId(gamePatternNames[i]);
+        if (gamePatternIds[i] == VAL_PATTERN_NONE)
+        {
+            Serial.printf("*** gamePatternsResolve WARNING! <%s> is not in val.json\r\n", gamePatternNames[i]);
+        }
+    }
+    resolved = true;
+}
+
+// valReload() swapped in a new pack, its IDs are looked up again
+static void resolveIfReloaded(void)
+{
+    if (resolved && (resolvedGen != valPackGeneration()))
+    {
+        gamePatternsResolve();
+    }
+}
+
+bool gamePlayPattern(tGamePattern pattern)
+{
+    if (!resolved)
+    {
+        return valPlayPattern(gamePatternNames[pattern]);
+    }
+    resolveIfReloaded();
+    return valPlayPatternId(gamePatternIds[pattern]);
+}
+
+bool gamePlayFlash(tGamePattern pattern)
+{
+    if (!resolved)
+    {
+        return false;
+    }
+    resolveIfReloaded();
+    return valPlayOverlayId(gamePatternIds[pattern], vlOverlay, GAME_FLASH_MAX_MS);
+}
+
+const char *gamePatternSound(tGamePattern pattern)
+{
+    resolveIfReloaded();
+    return resolved ? valPatternSound(gamePatternIds[pattern]) : NULL;
+}
+
+static const tGamePattern gameShowPatterns[shwCount] = {
+    gpRoleZombie,       // shwZombieWin
+    gpRoleHuman,        // shwHumanWin
+    gpGameWait          // shwDraw
+};
+
+// WiFi task, from espTimecode
+static void onGameShow(uint8_t showId, uint64_t startMs)
+{
+    if (showId >= shwCount)
+    {
+        return;
+    }
+    resolveIfReloaded();
+    valPlayPatternAt(gamePatternIds[gameShowPatterns[showId]], startMs);
+}
+
+void gameShowsInit(void)
+{
+    valSetClock(espClockNowMs);
+    espSetShowHandler(onGameShow);
+}
+
+void gameShowStart(tGameShow show)
+{
+    espShowStart(show, GAME_SHOW_LEAD_MS);
+}
+
+const char *gameShowSound(tGameShow show)
+{
+    return gamePatternSound(gameShowPatterns[show]);
+}
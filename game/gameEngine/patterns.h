@@ -1,5 +1,7 @@
 #pragma once
 
+#include <Arduino.h>
+
 #define WHILE_BOOT_PATTERN  "boot"
 #define ON_BOOT_PATTERN     "StartIt"
 #define GAME_WAIT_PATTERN   "GameWait"
@@ -14,3 +16,51 @@
 #define GAME_HUMAN_KILLING  "HumanKilling"
 
 #define ERROR_PATTERN       "ERROR"
+
+// Optional overlays flashed over the zone pattern when a hit or a heal starts
+#define GAME_HIT_FLASH      "HitFlash"
+#define GAME_HEAL_FLASH     "HealFlash"
+#define GAME_FLASH_MAX_MS   1500    // a circular flash pattern is cut after it
+
+// The patterns above as val.json IDs, resolved once by gamePatternsResolve()
+// after the player has loaded; the game loop plays them by ID
+enum tGamePattern
+{
+    gpWhileBoot,
+    gpOnBoot,
+    gpGameWait,
+    gpRoleZombie,
+    gpRoleHuman,
+    gpRoleBase,
+    gpZombieNeutral,
+    gpZombieHealing,
+    gpZombieKilling,
+    gpHumanNeutral,
+    gpHumanHealing,
+    gpHumanKilling,
+    gpError,
+    gpHitFlash,
+    gpHealFlash,
+    gpCount
+};
+
+void gamePatternsResolve(void);
+bool gamePlayPattern(tGamePattern pattern);
+bool gamePlayFlash(tGamePattern pattern);      // on the overlay layer, the pattern playing goes on
+const char *gamePatternSound(tGamePattern pattern);     // NULL before gamePatternsResolve() or without a track
+
+// Fleet-wide shows: one device starts it, every device in radio range plays
+// the show's pattern at the same moment on the shared clock
+#define GAME_SHOW_LEAD_MS   400     // a few beacon periods for the show to spread
+
+enum tGameShow
+{
+    shwZombieWin = 0,
+    shwHumanWin,
+    shwDraw,
+    shwCount
+};
+
+void gameShowsInit(void);           // after gamePatternsResolve()
+void gameShowStart(tGameShow show);
+const char *gameShowSound(tGameShow show);
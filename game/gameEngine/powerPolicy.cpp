@@ -0,0 +1,174 @@
+#include "powerPolicy.h"
+#include "board.h"
+#include "tftPower.h"
+#include "deviceRecords.h"
+#include "energyProfile.h"
+#include "pmLocks.h"
+
+#include <esp_wifi.h>
+
+static volatile tPowerMode mode = pmActive;
+static volatile uint32_t kickMs = 0;
+static wifi_ps_type_t activePs = WIFI_PS_NONE;
+static bool psSaved = false;
+static bool softAp = false;
+static volatile bool restOn = false;
+static uint32_t activeMhz = 0;
+
+static const char *modeName(tPowerMode m)
+{
+    switch (m)
+    {
+        case pmActive:  return "active";
+        case pmCalm:    return "calm";
+        case pmIdle:    return "idle";
+        default:        return "rest";
+    }
+}
+
+static tPowerMode wantedMode(void)
+{
+    static tGameRole lastRole = grNone;
+    static tTftPowerPhase lastPhase = tpWait;
+    tGameRole role = getSelfDataRecord()->deviceRole;
+    tTftPowerPhase phase = tftPowerPhase();
+    if ((role != lastRole) || (phase != lastPhase))
+    {
+        lastRole = role;
+        lastPhase = phase;
+        powerPolicyKick();
+    }
+    if ((millis() - kickMs < POWER_KICK_HOLD_MS) || (role == grBase) || (phase == tpPreGame))
+    {
+        return pmActive;
+    }
+    if (restOn)
+    {
+        return pmRest;
+    }
+    if ((phase == tpWait) || (phase == tpGameOver))
+    {
+        return accelMotionless() ? pmIdle : pmCalm;
+    }
+    return (accelStillMs() >= POWER_CALM_STILL_MS) ? pmCalm : pmActive;
+}
+
+// Modem sleep only while idle; the link to the AP wakes on DTIMs.
+// The driver keeps the modem awake while the soft AP is up
+static void applyModemSleep(tPowerMode m)
+{
+    if (!psSaved)
+    {
+        esp_wifi_get_ps(&activePs);
+        psSaved = true;
+        wifi_mode_t wifiMode;
+        softAp = (esp_wifi_get_mode(&wifiMode) == ESP_OK) && (wifiMode == WIFI_MODE_APSTA);
+        if (softAp)
+        {
+            Serial.println("*** powerPolicy WARNING! soft AP is up, no modem sleep");
+        }
+    }
+    esp_wifi_set_ps((m >= pmIdle) ? WIFI_PS_MAX_MODEM : activePs);
+    energyProfLevel(esRadio, ((m >= pmIdle) && !softAp) ? ENERGY_RADIO_PS_LEVEL : 255);
+}
+
+// With DFS on (pmLocks.h) an idle device already runs at the low clock or
+// light sleeps, without it the clock alone goes down
+static void applyRestClock(bool on)
+{
+    if (pmEnabled())
+    {
+        return;
+    }
+    if (activeMhz == 0)
+    {
+        activeMhz = getCpuFrequencyMhz();
+    }
+    if (!setCpuFrequencyMhz(on ? POWER_REST_CPU_MHZ : activeMhz))
+    {
+        Serial.println("!!! powerPolicy ERROR: setCpuFrequencyMhz");
+    }
+}
+
+bool powerPolicyUpdate(void)
+{
+    tPowerMode m = wantedMode();
+    if (m == mode)
+    {
+        return false;
+    }
+    Serial.printf(">>> powerPolicy: %s -> %s\r\n", modeName(mode), modeName(m));
+    bool wakeUp = (m < mode);
+    if ((m >= pmIdle) != (mode >= pmIdle))
+    {
+        applyModemSleep(m);
+    }
+    if ((m == pmRest) != (mode == pmRest))
+    {
+        applyRestClock(m == pmRest);
+    }
+    mode = m;
+    return wakeUp;
+}
+
+tPowerMode powerPolicyMode(void)
+{
+    return mode;
+}
+
+void powerPolicyKick(void)
+{
+    kickMs = millis();
+}
+
+void powerPolicyRest(bool on)
+{
+    if (on == restOn)
+    {
+        return;
+    }
+    restOn = on;
+    if (!on)
+    {
+        // the next game is on, everything back at once
+        powerPolicyKick();
+    }
+}
+
+bool powerPolicyResting(void)
+{
+    return restOn;
+}
+
+uint32_t powerBeaconMinMs(void)
+{
+    switch (mode)
+    {
+        case pmCalm:    return POWER_CALM_BEACON_MS;
+        case pmIdle:    return POWER_IDLE_BEACON_MS;
+        case pmRest:    return POWER_REST_BEACON_MS;
+        default:        return 0;
+    }
+}
+
+uint32_t powerRxWaitMs(uint32_t activeMs)
+{
+    switch (mode)
+    {
+        case pmCalm:    return max(activeMs, (uint32_t)POWER_CALM_RX_WAIT_MS);
+        case pmIdle:    return max(activeMs, (uint32_t)POWER_IDLE_RX_WAIT_MS);
+        case pmRest:    return max(activeMs, (uint32_t)POWER_REST_RX_WAIT_MS);
+        default:        return activeMs;
+    }
+}
+
+uint8_t powerScreenFps(uint8_t activeFps)
+{
+    switch (mode)
+    {
+        case pmCalm:    return min(activeFps, (uint8_t)POWER_CALM_SCREEN_FPS);
+        case pmIdle:    return min(activeFps, (uint8_t)POWER_IDLE_SCREEN_FPS);
+        case pmRest:    return min(activeFps, (uint8_t)POWER_REST_SCREEN_FPS);
+        default:        return activeFps;
+    }
+}
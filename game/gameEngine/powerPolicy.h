@@ -0,0 +1,48 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Radio and display duty cycling from the accelerometer and the game phase.
+// A player standing still in the lobby beacons rarely, lets the modem sleep
+// between DTIMs and redraws the screen slowly; moving, a role change or a new
+// phase brings everything back on the next radio task pass. A base never
+// slows its beacons, the humans around it heal from them.
+// Between rounds the game flow puts the device to rest: modem sleep with
+// wake on DTIMs, rare beacons and the CPU clocked down or, where the build
+// has power management with tickless idle, in automatic light sleep.
+// The device stays associated, and the lobby's push channel or its next
+// poll brings the next game in without a boot.
+
+enum tPowerMode
+{
+    pmActive = 0,
+    pmCalm,             // in a game but still for POWER_CALM_STILL_MS, or moving on the wait screen
+    pmIdle,             // on the wait screen and motionless
+    pmRest              // between rounds, until the server hands out the next game
+};
+
+#define POWER_CALM_STILL_MS     10000
+#define POWER_KICK_HOLD_MS      5000    // full rate after a role or phase change
+#define POWER_CALM_BEACON_MS    150
+#define POWER_IDLE_BEACON_MS    500
+#define POWER_CALM_RX_WAIT_MS   20      // radio task pass, against RECEIVER_INTERVAL_MS
+#define POWER_IDLE_RX_WAIT_MS   50
+#define POWER_CALM_SCREEN_FPS   5
+#define POWER_IDLE_SCREEN_FPS   2
+#define POWER_REST_BEACON_MS    2000
+#define POWER_REST_RX_WAIT_MS   100
+#define POWER_REST_SCREEN_FPS   1
+#ifndef POWER_REST_CPU_MHZ
+#define POWER_REST_CPU_MHZ      80      // the lowest clock WiFi keeps working at
+#endif
+
+// Radio task; true when the mode got more active, the next beacon should go now
+bool       powerPolicyUpdate(void);
+tPowerMode powerPolicyMode(void);
+void       powerPolicyKick(void);               // any task, full rate for POWER_KICK_HOLD_MS
+void       powerPolicyRest(bool on);            // any task, the radio task applies it on its next pass
+bool       powerPolicyResting(void);
+
+uint32_t   powerBeaconMinMs(void);              // 0: no limit
+uint32_t   powerRxWaitMs(uint32_t activeMs);
+uint8_t    powerScreenFps(uint8_t activeFps);
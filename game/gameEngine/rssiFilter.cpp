@@ -0,0 +1,154 @@
+#include "rssiFilter.h"
+
+tRssiFilterType str2rssiFilter(const char *s)
+{
+    if (!s)
+        return rfNone;
+    if (!strcmp(s, "ema"))
+        return rfEma;
+    if (!strcmp(s, "median"))
+        return rfMedian;
+    if (!strcmp(s, "kalman"))
+        return rfKalman;
+    return rfNone;
+}
+
+const char *rssiFilter2str(tRssiFilterType t)
+{
+    switch (t)
+    {
+        case rfEma:
+            return "ema";
+        case rfMedian:
+            return "median";
+        case rfKalman:
+            return "kalman";
+        default:
+            return "none";
+    }
+}
+
+void rssiFilterReset(tRssiFilterState &st)
+{
+    st = tRssiFilterState();
+}
+
+static int32_t medianQ8(const tRssiFilterState &st, uint8_t win)
+{
+    int8_t buf[RSSI_MEDIAN_MAX_WIN];
+    uint8_t n = (st.samples < win) ? st.samples : win;
+    for (uint8_t i = 0; i < n; i++)
+    {
+        int8_t v = st.win[i];
+        int8_t j = i - 1;
+        while ((j >= 0) && (buf[j] > v))
+        {
+            buf[j + 1] = buf[j];
+            j--;
+        }
+        buf[j + 1] = v;
+    }
+    if (n & 1)
+    {
+        return (int32_t)buf[n / 2] * RSSI_Q8_ONE;
+    }
+    return ((int32_t)buf[n / 2 - 1] + buf[n / 2]) * (RSSI_Q8_ONE / 2);
+}
+
+int rssiFilterUpdate(tRssiFilterState &st, const tRssiFilterCfg &cfg, int rssi)
+{
+    int32_t zQ8 = (int32_t)rssi * RSSI_Q8_ONE;
+
+    if ((cfg.type == rfNone) || (st.samples == 0))
+    {
+        st.xQ8 = zQ8;
+        st.pQ8 = cfg.kalmanRQ8;
+    }
+    else if (cfg.type == rfEma)
+    {
+        st.xQ8 += ((zQ8 - st.xQ8) * cfg.emaAlphaQ8) / RSSI_Q8_ONE;
+    }
+    else if (cfg.type == rfKalman)
+    {
+        int32_t p = st.pQ8 + cfg.kalmanQQ8;
+        int32_t kQ8 = (p * RSSI_Q8_ONE) / (p + cfg.kalmanRQ8);
+        st.xQ8 += ((zQ8 - st.xQ8) * kQ8) / RSSI_Q8_ONE;
+        st.pQ8 = ((RSSI_Q8_ONE - kQ8) * p) / RSSI_Q8_ONE;
+    }
+
+    uint8_t win = cfg.medianWin;
+    if (win < 1)
+        win = 1;
+    if (win > RSSI_MEDIAN_MAX_WIN)
+        win = RSSI_MEDIAN_MAX_WIN;
+    st.win[st.winPos] = (int8_t)constrain(rssi, -128, 127);
+    st.winPos = (st.winPos + 1) % win;
+    if (st.samples < 255)
+        st.samples++;
+
+    if (cfg.type == rfMedian)
+    {
+        st.xQ8 = medianQ8(st, win);
+    }
+    return rssiFilterValue(st);
+}
+
+int rssiFilterValue(const tRssiFilterState &st)
+{
+    // round to nearest dB, values are negative most of the time
+    if (st.xQ8 < 0)
+        return -((-st.xQ8 + RSSI_Q8_ONE / 2) / RSSI_Q8_ONE);
+    return (st.xQ8 + RSSI_Q8_ONE / 2) / RSSI_Q8_ONE;
+}
+
+// A zone the device is already in (or closer) is kept until the signal
+// drops below the zone threshold minus its hysteresis band.
+tRssiZone rssiClassifyZone(tRssiFilterState &st, const tRssiFilterCfg &cfg, int rssi, int rssiFar, int rssiMiddle, int rssiClose)
+{
+    int closeThr  = rssiClose  - ((st.zone >= rzClose)  ? cfg.hystClose  : 0);
+    int middleThr = rssiMiddle - ((st.zone >= rzMiddle) ? cfg.hystMiddle : 0);
+    int farThr    = rssiFar    - ((st.zone >= rzFar)    ? cfg.hystFar    : 0);
+
+    if (rssi < farThr)
+        st.zone = rzOut;
+    else if (rssi > closeThr)
+        st.zone = rzClose;
+    else if (rssi > middleThr)
+        st.zone = rzMiddle;
+    else
+        st.zone = rzFar;
+    return st.zone;
+}
+
+bool rssiCurveCompile(tRssiCurve &curve, const int8_t *rssi, const int16_t *pct, uint8_t count)
+{
+    curve.on = false;
+    if ((count < 1) || (count > RSSI_CURVE_MAX_POINTS))
+        return false;
+    for (uint8_t i = 0; i < count; i++)
+    {
+        if ((pct[i] < -RSSI_CURVE_MAX_PCT) || (pct[i] > RSSI_CURVE_MAX_PCT) || ((i > 0) && (rssi[i] <= rssi[i - 1])))
+            return false;
+    }
+
+    uint8_t seg = 0;
+    for (int idx = RSSI_CURVE_LUT - 1; idx >= 0; idx--)
+    {
+        int r = -idx;
+        int32_t p;
+        if (r <= rssi[0])
+            p = pct[0] * RSSI_Q8_ONE;
+        else if (r >= rssi[count - 1])
+            p = pct[count - 1] * RSSI_Q8_ONE;
+        else
+        {
+            // r rises with the loop, so does the segment
+            while (r >= rssi[seg + 1])
+                seg++;
+            p = pct[seg] * RSSI_Q8_ONE + (pct[seg + 1] - pct[seg]) * RSSI_Q8_ONE * (r - rssi[seg]) / (rssi[seg + 1] - rssi[seg]);
+        }
+        curve.scaleQ8[idx] = (int16_t)((p + (p < 0 ? -50 : 50)) / 100);
+    }
+    curve.on = true;
+    return true;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Per-device RSSI smoothing and zone classification. All state is kept in
+// Q8 fixed point (value * 256) so the update stays cheap in the RX path.
+
+#define RSSI_Q8_ONE             256
+#define RSSI_MEDIAN_MAX_WIN     7
+
+#define RSSI_DEF_EMA_ALPHA_Q8   77      // ~0.3
+#define RSSI_DEF_MEDIAN_WIN     5
+#define RSSI_DEF_KALMAN_Q_Q8    128     // process noise, ~0.5 dB^2
+#define RSSI_DEF_KALMAN_R_Q8    1024    // measurement noise, ~4 dB^2
+#define RSSI_DEF_HYST_DB        0
+
+#define RSSI_CURVE_LUT          128     // one entry per dBm, 0 down to -127
+#define RSSI_CURVE_MAX_POINTS   16
+#define RSSI_CURVE_MAX_PCT      400
+
+enum tRssiFilterType
+{
+    rfNone   = 0,
+    rfEma    = 1,
+    rfMedian = 2,
+    rfKalman = 3
+};
+
+enum tRssiZone
+{
+    rzOut    = 0,
+    rzFar    = 1,
+    rzMiddle = 2,
+    rzClose  = 3
+};
+
+struct tRssiFilterCfg
+{
+    tRssiFilterType type     = rfNone;
+    int32_t  emaAlphaQ8      = RSSI_DEF_EMA_ALPHA_Q8;
+    uint8_t  medianWin       = RSSI_DEF_MEDIAN_WIN;
+    int32_t  kalmanQQ8       = RSSI_DEF_KALMAN_Q_Q8;
+    int32_t  kalmanRQ8       = RSSI_DEF_KALMAN_R_Q8;
+    int8_t   hystClose       = RSSI_DEF_HYST_DB;
+    int8_t   hystMiddle      = RSSI_DEF_HYST_DB;
+    int8_t   hystFar         = RSSI_DEF_HYST_DB;
+};
+
+struct tRssiFilterState
+{
+    int32_t  xQ8             = 0;       // filtered value
+    int32_t  pQ8             = 0;       // kalman error covariance
+    int8_t   win[RSSI_MEDIAN_MAX_WIN];
+    uint8_t  winPos          = 0;
+    uint8_t  samples         = 0;
+    tRssiZone zone           = rzOut;
+};
+
+// Points against RSSI as a piecewise-linear curve of (dBm, percent of the
+// sender's near points) knots, compiled into a table once when the role is
+// loaded: evaluating a neighbour is one load and a multiply, whatever the
+// number of knots. Flat beyond the first and the last knot.
+struct tRssiCurve
+{
+    bool     on = false;
+    int16_t  scaleQ8[RSSI_CURVE_LUT];
+};
+
+tRssiFilterType str2rssiFilter(const char *s);
+const char *rssiFilter2str(tRssiFilterType t);
+void rssiFilterReset(tRssiFilterState &st);
+int  rssiFilterUpdate(tRssiFilterState &st, const tRssiFilterCfg &cfg, int rssi);
+int  rssiFilterValue(const tRssiFilterState &st);
+tRssiZone rssiClassifyZone(tRssiFilterState &st, const tRssiFilterCfg &cfg, int rssi, int rssiFar, int rssiMiddle, int rssiClose);
+
+// Knots in rising RSSI order; false (and the curve off) on anything else
+bool rssiCurveCompile(tRssiCurve &curve, const int8_t *rssi, const int16_t *pct, uint8_t count);
+
+inline int rssiCurvePoints(const tRssiCurve &curve, int rssi, int nearPoints)
+{
+    return nearPoints * curve.scaleQ8[constrain(-rssi, 0, RSSI_CURVE_LUT - 1)] / RSSI_Q8_ONE;
+}
@@ -0,0 +1,192 @@
+#include "rxRecorder.h"
+
+#include "PSRamFS.h"
+#include "deviceRecords.h"
+
+static tRxRecFrame *recRing = NULL;
+static uint32_t recHead = 0;        // next write position
+static uint32_t recCount = 0;
+static volatile bool recActive = false;
+static portMUX_TYPE recMux = portMUX_INITIALIZER_UNLOCKED;
+
+bool rxRecorderStart(void)
+{
+    if (recRing == NULL)
+    {
+        recRing = (tRxRecFrame *)ps_malloc(RX_REC_CAPACITY * sizeof(tRxRecFrame));
+        if (recRing == NULL)
+        {
+            Serial.println("!!! rxRecorderStart ERROR: ps_malloc failed");
+            return false;
+        }
+    }
+    portENTER_CRITICAL(&recMux);
+    recHead = 0;
+    recCount = 0;
+    portEXIT_CRITICAL(&recMux);
+    recActive = true;
+    Serial.printf(">>> rxRecorderStart: recording up to %d frames\r\n", RX_REC_CAPACITY);
+    return true;
+}
+
+bool rxRecorderActive(void)
+{
+    return recActive;
+}
+
+// Radio task, one frame per accepted packet (or coalesced sender aggregate)
+void rxRecorderLog(const tEspPacket *rData, uint32_t ms, int rssi)
+{
+    if (!recActive)
+    {
+        return;
+    }
+    tRxRecFrame frame;
+    frame.ms = ms;
+    frame.deviceID = rData->deviceID;
+    frame.deviceRole = (uint8_t)rData->deviceRole;
+    frame.rssi = (int8_t)constrain(rssi, -128, 127);
+    frame.hitPointsNear = (int16_t)rData->hitPointsNear;
+    frame.hitPointsMiddle = (int16_t)rData->hitPointsMiddle;
+    frame.hitPointsFar = (int16_t)rData->hitPointsFar;
+
+    portENTER_CRITICAL(&recMux);
+    recRing[recHead] = frame;
+    recHead = (recHead + 1) % RX_REC_CAPACITY;
+    if (recCount < RX_REC_CAPACITY)
+    {
+        recCount++;
+    }
+    portEXIT_CRITICAL(&recMux);
+}
+
+bool rxRecorderStop(String fName)
+{
+    if (!recActive)
+    {
+        Serial.println("!!! rxRecorderStop ERROR: recorder is not running");
+        return false;
+    }
+    recActive = false;
+
+    portENTER_CRITICAL(&recMux);
+    uint32_t count = recCount;
+    uint32_t first = (recHead + RX_REC_CAPACITY - recCount) % RX_REC_CAPACITY;
+    portEXIT_CRITICAL(&recMux);
+
+    File file = PSRamFS.open(fName, "w");
+    if (!file)
+    {
+        Serial.printf("!!! rxRecorderStop ERROR: failed to open [%s]\r\n", fName.c_str());
+        return false;
+    }
+
+    tRxRecHeader hdr;
+    hdr.magic = RX_REC_MAGIC;
+    hdr.version = RX_REC_VERSION;
+    hdr.frameSize = sizeof(tRxRecFrame);
+    hdr.count = count;
+    hdr.firstMs = count ? recRing[first].ms : 0;
+    hdr.lastMs = count ? recRing[(first + count - 1) % RX_REC_CAPACITY].ms : 0;
+    file.write((const uint8_t *)&hdr, sizeof(hdr));
+
+    // the ring is dumped oldest first, in at most two contiguous chunks
+    uint32_t chunk = min(count, (uint32_t)(RX_REC_CAPACITY - first));
+    size_t written = file.write((const uint8_t *)&recRing[first], chunk * sizeof(tRxRecFrame));
+    if (count > chunk)
+    {
+        written += file.write((const uint8_t *)&recRing[0], (count - chunk) * sizeof(tRxRecFrame));
+    }
+    file.close();
+
+    if (written != count * sizeof(tRxRecFrame))
+    {
+        Serial.printf("!!! rxRecorderStop ERROR: short write to [%s]\r\n", fName.c_str());
+        return false;
+    }
+    Serial.printf(">>> rxRecorderStop: %lu frames (%lu ms) saved to [%s]\r\n", count, hdr.lastMs - hdr.firstMs, fName.c_str());
+    return true;
+}
+
+static void replayTick(tRxReplayResult &res)
+{
+    int health, hitPoints, healPoints;
+    recordsReplayTick(health, hitPoints, healPoints);
+    res.ticks++;
+    res.hitPoints += hitPoints;
+    res.healPoints += healPoints;
+    res.endHealth = health;
+    if (health < res.minHealth)
+        res.minHealth = health;
+    if (health > res.maxHealth)
+        res.maxHealth = health;
+}
+
+// Feeds a recorded session through the live record table on a virtual clock,
+// the radio task and the game loop are parked while it runs
+bool rxReplayRun(String fName, tRxReplayResult &res)
+{
+    res = tRxReplayResult();
+    if (recActive)
+    {
+        Serial.println("!!! rxReplayRun ERROR: stop the recorder first");
+        return false;
+    }
+
+    File file = PSRamFS.open(fName, "r");
+    if (!file)
+    {
+        Serial.printf("!!! rxReplayRun ERROR: failed to open [%s]\r\n", fName.c_str());
+        return false;
+    }
+
+    tRxRecHeader hdr;
+    if ((file.read((uint8_t *)&hdr, sizeof(hdr)) != sizeof(hdr)) || (hdr.magic != RX_REC_MAGIC) ||
+        (hdr.version != RX_REC_VERSION) || (hdr.frameSize != sizeof(tRxRecFrame)))
+    {
+        Serial.printf("!!! rxReplayRun ERROR: [%s] is not a recorder file\r\n", fName.c_str());
+        file.close();
+        return false;
+    }
+
+    uint32_t startedMs = millis();
+    recordsReplayBegin(hdr.firstMs);
+
+    uint32_t tickMs = getDamageTickMs();
+    uint32_t nextTickMs = hdr.firstMs + tickMs;
+    res.startHealth = res.endHealth = res.minHealth = res.maxHealth = getSelfDataRecord()->health;
+
+    tRxRecFrame frame;
+    tEspPacket pkt;
+    while (file.read((uint8_t *)&frame, sizeof(frame)) == sizeof(frame))
+    {
+        while ((int32_t)(frame.ms - nextTickMs) >= 0)
+        {
+            recordsReplaySetClock(nextTickMs);
+            replayTick(res);
+            nextTickMs += tickMs;
+        }
+        recordsReplaySetClock(frame.ms);
+        pkt.deviceID = frame.deviceID;
+        pkt.deviceRole = (tGameRole)frame.deviceRole;
+        pkt.hitPointsNear = frame.hitPointsNear;
+        pkt.hitPointsMiddle = frame.hitPointsMiddle;
+        pkt.hitPointsFar = frame.hitPointsFar;
+        addScannedRecord(&pkt, frame.ms, frame.rssi);
+        res.frames++;
+    }
+    file.close();
+
+    // run on until the last neighbours expire so their dwell is accounted for
+    while ((int32_t)(nextTickMs - hdr.lastMs) <= GAME_START_LOOP_INT_MS)
+    {
+        recordsReplaySetClock(nextTickMs);
+        replayTick(res);
+        nextTickMs += tickMs;
+    }
+
+    recordsReplayEnd();
+    res.sessionMs = hdr.lastMs - hdr.firstMs;
+    res.elapsedMs = millis() - startedMs;
+    return true;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "espPacket.h"
+
+// Records every accepted frame of a session into a PSRAM ring and dumps it to a
+// compact binary file, which can be replayed through deviceRecords faster than
+// real time to re-run a session with different role parameters.
+
+#define RX_REC_FNAME        "/rx_rec.bin"
+#define RX_REC_CAPACITY     20000       // frames kept in the ring, ~20 bytes each
+#define RX_REC_MAGIC        0x3158525A  // "ZRX1"
+#define RX_REC_VERSION      1
+
+struct __attribute__((packed)) tRxRecFrame
+{
+    uint32_t ms;
+    uint64_t deviceID;
+    uint8_t  deviceRole;
+    int8_t   rssi;
+    int16_t  hitPointsNear;
+    int16_t  hitPointsMiddle;
+    int16_t  hitPointsFar;
+};
+
+struct __attribute__((packed)) tRxRecHeader
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t frameSize;
+    uint32_t count;
+    uint32_t firstMs;
+    uint32_t lastMs;
+};
+
+struct tRxReplayResult
+{
+    uint32_t frames = 0;
+    uint32_t ticks = 0;
+    uint32_t sessionMs = 0;     // recorded time span
+    uint32_t elapsedMs = 0;     // wall time of the replay
+    int      startHealth = 0;
+    int      endHealth = 0;
+    int      minHealth = 0;
+    int      maxHealth = 0;
+    int64_t  hitPoints = 0;
+    int64_t  healPoints = 0;
+};
+
+bool rxRecorderStart(void);
+bool rxRecorderStop(String fName = RX_REC_FNAME);
+bool rxRecorderActive(void);
+void rxRecorderLog(const tEspPacket *rData, uint32_t ms, int rssi);
+bool rxReplayRun(String fName, tRxReplayResult &res);
@@ -0,0 +1,129 @@
+#include "scoreboard.h"
+
+#include "gameComm.h"
+#include "espRelay.h"
+
+struct tMcastTally
+{
+    bool     valid = false;
+    uint32_t seq = 0;
+    uint32_t partsSeen = 0;     // bit per part
+    uint8_t  parts = 0;
+    uint8_t  phase = 0;
+    uint16_t timeLeft = 0;
+    uint16_t humans = 0;
+    uint16_t zombies = 0;
+};
+
+// AsyncUDP task only
+static tMcastTally building;
+
+// Last tick heard in full, under scoreMux
+static tScoreboard mcastDone;
+static uint32_t mcastDoneMs = 0;
+static bool mcastDoneValid = false;
+static portMUX_TYPE scoreMux = portMUX_INITIALIZER_UNLOCKED;
+
+void scoreboardOnMcast(const tGameMcastHeader &hdr, const uint8_t *entries)
+{
+    if (!building.valid || (hdr.seq != building.seq))
+    {
+        // a tick missing a part is never published, the last full one stays
+        building = tMcastTally();
+        building.valid = true;
+        building.seq = hdr.seq;
+        uint8_t parts = hdr.parts ? hdr.parts : 1;
+        building.parts = (parts < SCOREBOARD_MCAST_PARTS) ? parts : SCOREBOARD_MCAST_PARTS;
+        building.phase = hdr.phase;
+        building.timeLeft = hdr.timeLeft;
+    }
+    if (hdr.part >= building.parts)
+    {
+        return;
+    }
+    uint32_t bit = 1UL << hdr.part;
+    if (building.partsSeen & bit)
+    {
+        return;
+    }
+    building.partsSeen |= bit;
+
+    const uint8_t *p = entries;
+    for (int i = 0; i < hdr.count; i++, p += sizeof(tGameMcastEntry))
+    {
+        tGameMcastEntry entry;
+        memcpy(&entry, p, sizeof(entry));
+        if (entry.role == garHuman)
+        {
+            building.humans++;
+        }
+        else if (entry.role == garZombie)
+        {
+            building.zombies++;
+        }
+    }
+    if (__builtin_popcount(building.partsSeen) < building.parts)
+    {
+        return;
+    }
+    portENTER_CRITICAL(&scoreMux);
+    mcastDone.humans = building.humans;
+    mcastDone.zombies = building.zombies;
+    mcastDone.secLeft = building.timeLeft;
+    mcastDone.phase = building.phase;
+    mcastDone.source = scMcast;
+    mcastDoneMs = millis();
+    mcastDoneValid = true;
+    portEXIT_CRITICAL(&scoreMux);
+}
+
+void scoreboardGet(tScoreboard &sb, int localHumans, int localZombies, int localSecLeft)
+{
+    bool fresh = false;
+    portENTER_CRITICAL(&scoreMux);
+    uint32_t ageMs = millis() - mcastDoneMs;
+    if (mcastDoneValid && (ageMs < GAME_MCAST_STALE_MS))
+    {
+        sb = mcastDone;
+        sb.secLeft = (sb.secLeft > ageMs / 1000) ? sb.secLeft - ageMs / 1000 : 0;
+        fresh = true;
+    }
+    portEXIT_CRITICAL(&scoreMux);
+    if (fresh)
+    {
+        return;
+    }
+
+    tEspRelayState state;
+    uint16_t counts[GAME_API_ROLE_COUNT];
+    if (espRelayTally(state, counts, GAME_API_ROLE_COUNT) && (counts[garHuman] + counts[garZombie] > 0))
+    {
+        sb.humans = counts[garHuman];
+        sb.zombies = counts[garZombie];
+        sb.secLeft = state.timeLeft;
+        sb.phase = state.phase;
+        sb.source = scRelay;
+        return;
+    }
+
+    sb.humans = (uint16_t)max(0, localHumans);
+    sb.zombies = (uint16_t)max(0, localZombies);
+    sb.secLeft = (uint32_t)max(0, localSecLeft);
+    sb.phase = 0;
+    sb.source = scBeacons;
+}
+
+const char *scoreSource2str(tScoreSource source)
+{
+    switch (source)
+    {
+        case scBeacons:
+            return "BEACONS";
+        case scRelay:
+            return "RELAY";
+        case scMcast:
+            return "MCAST";
+        default:
+            return "NONE";
+    }
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "gameMcast.h"
+
+// Live head count and time left for a base station, kept on the device from
+// what it hears anyway: the game state multicast (every device with its role,
+// once a tick), the relayed role table of the ESP-NOW beacons, and at least
+// the players around the base. Drawing it costs no server request.
+
+#define SCOREBOARD_MCAST_PARTS  32      // parts of one tick counted, more are ignored
+
+enum tScoreSource
+{
+    scNone = 0,
+    scBeacons,      // the neighbours the base hears
+    scRelay,        // roles relayed over ESP-NOW, at most ESP_RELAY_MAX
+    scMcast         // the server's full roster
+};
+
+struct tScoreboard
+{
+    uint16_t     humans = 0;
+    uint16_t     zombies = 0;
+    uint32_t     secLeft = 0;
+    uint8_t      phase = 0;         // tGameApiPhase, 0 for scBeacons
+    tScoreSource source = scNone;
+};
+
+// Every part of every tick, from the AsyncUDP task
+void scoreboardOnMcast(const tGameMcastHeader &hdr, const uint8_t *entries);
+// The best source still fresh, the local counts when no other is
+void scoreboardGet(tScoreboard &sb, int localHumans, int localZombies, int localSecLeft);
+const char *scoreSource2str(tScoreSource source);
@@ -1,6 +1,8 @@
 #include "board.h"
+#include "deviceClass.h"
 
 #include "kxtj3-1057.h"
+#include "taskRegistry.h"
 
 KXTJ3 myIMU(KXTJ3_ADDR);
 #define IMU_SAMPLE_RATE (6.25)
@@ -21,8 +23,28 @@ KXTJ3 myIMU(KXTJ3_ADDR);
 // For 6.25 Hz and 1 count: 1/6.25 = 0.16 sec
 #define WAKE_NA_DURATION (1)
 
+// Activity service: data-ready interrupt on ACCEL_INT_PIN, a sliding window of
+// per-sample deltas summed incrementally, all in 1/1024 g (12 bits at +-2g)
+#define ACCEL_POLL_MS           400     // read anyway when no data-ready came
+
+static TaskHandle_t accelTask = NULL;
+static volatile bool accelRunning = false;
+static int16_t lastXyz[3];
+static bool haveLast = false;
+static uint16_t deltas[ACCEL_WINDOW];
+static uint8_t deltaIdx = 0;
+static uint8_t deltaCount = 0;
+static uint32_t deltaSum = 0;
+static volatile uint8_t activity = 1;
+static volatile uint32_t lastMotionMs = 0;
+
 bool accelInit(void)
 {
+    if constexpr (!devClass.accel)
+    {
+        Serial.printf(">>> accelInit: no accelerometer on a %s build\r\n", devClass.name);
+        return false;
+    }
     if (myIMU.begin(IMU_SAMPLE_RATE, IMU_ACCEL_RANGE, IMU_HIGH_RES) == IMU_SUCCESS)
     {
         Serial.println(">>> accelInit: OK");
@@ -37,6 +59,13 @@ bool accelInit(void)
 
 bool accelWakeOnShake(void)
 {
+    if constexpr (!devClass.accel)
+    {
+        return false;
+    }
+    // the pin goes from data-ready to the motion wake-up
+    accelServiceStop();
+
     // Configure the KXTJ3 accelerometer for motion wake-up interrupt
     // using the library's intConf() method
     //
@@ -74,4 +103,148 @@ bool accelWakeOnShake(void)
     
     Serial.println(">>> accelWakeOnShake: OK");
     return true;
-}
\ No newline at end of file
+}
+
+static void IRAM_ATTR accelIsr(void)
+{
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(accelTask, &woken);
+    if (woken)
+    {
+        portYIELD_FROM_ISR();
+    }
+}
+
+static bool accelRead(int16_t *xyz)
+{
+    uint8_t raw[6];
+    if (myIMU.readRegisterRegion(raw, KXTJ3_XOUT_L, sizeof(raw)) != IMU_SUCCESS)
+    {
+        return false;
+    }
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        xyz[i] = (int16_t)(raw[2 * i] | (raw[2 * i + 1] << 8)) >> 4;
+    }
+    // latched data-ready, released by reading INT_REL
+    uint8_t rel;
+    myIMU.readRegister(&rel, KXTJ3_INT_REL);
+    return true;
+}
+
+static void accelAddSample(const int16_t *xyz)
+{
+    if (!haveLast)
+    {
+        memcpy(lastXyz, xyz, sizeof(lastXyz));
+        haveLast = true;
+        return;
+    }
+    uint16_t delta = abs(xyz[0] - lastXyz[0]) + abs(xyz[1] - lastXyz[1]) + abs(xyz[2] - lastXyz[2]);
+    memcpy(lastXyz, xyz, sizeof(lastXyz));
+
+    if (deltaCount == ACCEL_WINDOW)
+    {
+        deltaSum -= deltas[deltaIdx];
+    }
+    else
+    {
+        deltaCount++;
+    }
+    deltas[deltaIdx] = delta;
+    deltaSum += delta;
+    deltaIdx = (deltaIdx + 1) % ACCEL_WINDOW;
+
+    // 1 g average delta is 100
+    uint32_t avg = deltaSum / deltaCount;
+    activity = constrain(avg * 100 / 1024 + 1, 1, 100);
+    if (avg >= ACCEL_STILL_COUNTS)
+    {
+        lastMotionMs = millis();
+    }
+}
+
+static void accelTaskFn(void *arg)
+{
+    int16_t xyz[3];
+    while (accelRunning)
+    {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(ACCEL_POLL_MS));
+        if (accelRunning && accelRead(xyz))
+        {
+            accelAddSample(xyz);
+        }
+    }
+    accelTask = NULL;
+    vTaskDelete(NULL);
+}
+
+bool accelServiceStart(void)
+{
+    if (accelRunning)
+    {
+        return true;
+    }
+    kxtj3_status_t result = myIMU.intConf(
+        WAKE_THRESHOLD_COUNTS,  // unused without motion
+        WAKE_MOVE_DURATION,
+        WAKE_NA_DURATION,
+        HIGH,                   // polarity: active HIGH
+        -1,                     // wuRate: use IMU data rate
+        true,                   // latched: released by accelRead()
+        false,                  // pulsed: no
+        false,                  // motion: disabled
+        true,                   // dataReady: one interrupt per sample
+        true                    // intPin: enable interrupt pin
+    );
+    if (result != IMU_SUCCESS)
+    {
+        Serial.print("*** accelServiceStart WARNING! data-ready not set, polling: ");
+        Serial.println(result);
+    }
+    haveLast = false;
+    deltaIdx = 0;
+    deltaCount = 0;
+    deltaSum = 0;
+    lastMotionMs = millis();
+    accelRunning = true;
+    if (!taskStart(tkAccel, accelTaskFn, NULL, &accelTask))
+    {
+        accelRunning = false;
+        return false;
+    }
+    pinMode(ACCEL_INT_PIN, INPUT_PULLDOWN);
+    attachInterrupt(ACCEL_INT_PIN, accelIsr, RISING);
+    Serial.println(">>> accelServiceStart: OK");
+    return true;
+}
+
+void accelServiceStop(void)
+{
+    if (!accelRunning)
+    {
+        return;
+    }
+    detachInterrupt(ACCEL_INT_PIN);
+    accelRunning = false;
+    xTaskNotifyGive(accelTask);
+    while (accelTask != NULL)
+    {
+        delay(1);
+    }
+}
+
+uint8_t accelActivity(void)
+{
+    return activity;
+}
+
+uint32_t accelStillMs(void)
+{
+    return accelRunning ? millis() - lastMotionMs : 0;
+}
+
+bool accelMotionless(void)
+{
+    return accelStillMs() >= ACCEL_STILL_MS;
+}
@@ -0,0 +1,154 @@
+#include <board.h>
+#include <esp_adc_cal.h>
+
+#include "pin_config.h"
+#include "taskRegistry.h"
+
+// The battery is sampled at a low rate by its own task, the readers only get
+// the filtered result: a median over the last few samples against ADC spikes
+// from the radio, then a slow EMA against the ripple of the LEDs and audio
+
+#define BATT_SAMPLE_MS          250
+#define BATT_MEDIAN_LEN         5
+#define BATT_EMA_SHIFT          3       // 1/8 of each new median
+
+static esp_adc_cal_characteristics_t adcChars;
+static TaskHandle_t battTask = NULL;
+static uint16_t samples[BATT_MEDIAN_LEN];
+static uint8_t sampleIdx = 0;
+static uint32_t emaMv16 = 0;            // mV << 4
+static volatile uint16_t battMv = 0;
+static volatile uint8_t battPct = 0;
+
+static uint16_t readMv(void)
+{
+    uint32_t raw = analogRead(PIN_BAT_VOLT);
+    return esp_adc_cal_raw_to_voltage(raw, &adcChars) * 2;
+}
+
+static uint16_t median(void)
+{
+    uint16_t sorted[BATT_MEDIAN_LEN];
+    memcpy(sorted, samples, sizeof(sorted));
+    for (uint8_t i = 1; i < BATT_MEDIAN_LEN; i++)
+    {
+        uint16_t v = sorted[i];
+        int8_t j = i - 1;
+        while ((j >= 0) && (sorted[j] > v))
+        {
+            sorted[j + 1] = sorted[j];
+            j--;
+        }
+        sorted[j + 1] = v;
+    }
+    return sorted[BATT_MEDIAN_LEN / 2];
+}
+
+static uint8_t vccToPercent(int voltage_mV)
+{
+    const int voltage_table[][2] = 
+    {
+        {4200, 100},
+        {4150, 95},
+        {4110, 90},
+        {4080, 85},
+        {4020, 80},
+        {3980, 75},
+        {3950, 70},
+        {3910, 65},
+        {3870, 60},
+        {3850, 55},
+        {3840, 50},
+        {3820, 45},
+        {3800, 40},
+        {3790, 35},
+        {3770, 30},
+        {3750, 25},
+        {3730, 20},
+        {3710, 15},
+        {3690, 10},
+        {3610, 5},
+        {3000, 0}
+    };
+
+    const int table_size = sizeof(voltage_table) / sizeof(voltage_table[0]);
+
+    // Handle edge cases
+    if (voltage_mV >= voltage_table[0][0])
+        return voltage_table[0][1];
+    if (voltage_mV <= voltage_table[table_size - 1][0])
+        return voltage_table[table_size - 1][1];
+
+    // Linear interpolation between table values
+    for (int i = 0; i < table_size - 1; i++)
+    {
+        if (voltage_mV <= voltage_table[i][0] && voltage_mV >= voltage_table[i + 1][0])
+        {
+            int v1 = voltage_table[i + 1][0];
+            int v2 = voltage_table[i][0];
+            int p1 = voltage_table[i + 1][1];
+            int p2 = voltage_table[i][1];
+
+            return p1 + (voltage_mV - v1) * (p2 - p1) / (v2 - v1);
+        }
+    }
+
+    return 0; // Fallback
+}
+
+static void publish(uint16_t mv)
+{
+    battMv = mv;
+    battPct = vccToPercent(mv);
+}
+
+static void battTaskFn(void *arg)
+{
+    TickType_t lastWake = xTaskGetTickCount();
+    for (;;)
+    {
+        vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(BATT_SAMPLE_MS));
+        samples[sampleIdx] = readMv();
+        sampleIdx = (sampleIdx + 1) % BATT_MEDIAN_LEN;
+        uint32_t med16 = (uint32_t)median() << 4;
+        emaMv16 = emaMv16 + ((int32_t)(med16 - emaMv16) >> BATT_EMA_SHIFT);
+        publish(emaMv16 >> 4);
+    }
+}
+
+void batteryMonitorStart(void)
+{
+    if (battTask != NULL)
+    {
+        return;
+    }
+    // Calibration from eFuse, read once
+    esp_adc_cal_characterize(ADC_UNIT_1, ADC_ATTEN_DB_11, ADC_WIDTH_BIT_12, 1100, &adcChars);
+
+    // Seeded from one read so the first values are already usable
+    uint16_t mv = readMv();
+    for (uint8_t i = 0; i < BATT_MEDIAN_LEN; i++)
+    {
+        samples[i] = mv;
+    }
+    emaMv16 = (uint32_t)mv << 4;
+    publish(mv);
+
+    if (!taskStart(tkBattery, battTaskFn, NULL, &battTask))
+    {
+        return;
+    }
+    Serial.printf(">>> batteryMonitorStart: %u mV, %u%%\r\n", mv, battPct);
+}
+
+uint16_t boardGetVcc(void)
+{
+    batteryMonitorStart();
+    return battMv;
+}
+
+uint8_t boardGetVccPercent(void)
+{
+    batteryMonitorStart();
+    return battPct;
+}
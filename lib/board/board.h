@@ -9,10 +9,33 @@
 
 void boardPowerOn(void);
 void boardPowerOff(void);
+// Battery, filtered in the background from the first call on
+void batteryMonitorStart(void);
 uint16_t boardGetVcc(void);
 uint8_t boardGetVccPercent(void);
 
+#define ACCEL_WINDOW            32      // samples of the activity window, ~5 s at 6.25 Hz
+#define ACCEL_STILL_COUNTS      16      // average delta below this (1/1024 g) is no motion
+#ifndef ACCEL_STILL_MS
+#define ACCEL_STILL_MS          60000   // no motion this long is motionless
+#endif
+
 bool accelInit(void);
-bool accelWakeOnShake(void);
+bool accelWakeOnShake(void);        // stops the service
+
+// Activity from the accelerometer's data-ready interrupt, after accelInit()
+bool accelServiceStart(void);
+void accelServiceStop(void);
+uint8_t accelActivity(void);        // 1-100 over the last ACCEL_WINDOW samples
+uint32_t accelStillMs(void);        // since the last motion, 0 while stopped
+bool accelMotionless(void);         // still for ACCEL_STILL_MS
+
+#define BOARD_WAKE_MIN_S        60      // a timer wake closer than this is not armed
+
+// Timer wake for the sleeps to come, kept in RTC memory through every wake
+// but a power loss; it counts on gettimeofday(), which runs on in deep sleep.
+// 0 clears it, a due time in the past is ignored.
+void boardSetWakeIn(uint32_t inS);
+uint32_t boardWakeDueS(void);       // seconds to the timer wake, 0 = none
 
 void boardStartSleep(bool btnWake = true, bool accelWake = true);
\ No newline at end of file
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stdint.h>
+
+// What a build carries, picked with -D DEVICE_CLASS=... in platformio.ini.
+// The libraries test the fields with if constexpr: a subsystem the class has
+// not got returns at its entry points, the linker then drops its driver, and
+// a build that has it carries no runtime check.
+
+#define DEVICE_CLASS_GAME       0   // the game terminal: AMOLED, sound, LED strips, accelerometer
+#define DEVICE_CLASS_HEADLESS   1   // the same board without the panel, speaker and accelerometer fitted
+
+#ifndef DEVICE_CLASS
+#define DEVICE_CLASS            DEVICE_CLASS_GAME
+#endif
+
+struct tDeviceClass
+{
+    const char *name;
+    bool display;           // RM67162 panel; without it the sprite is still drawn, nothing is pushed
+    bool audio;             // I2S tracks and effects
+    bool leds;              // RMT LED strips and the vibro motor
+    bool accel;             // KXTJ3 on I2C
+};
+
+constexpr tDeviceClass deviceClasses[] =
+{
+    {"game",     true,  true,  true,  true},
+    {"headless", false, false, true,  false},
+};
+
+static_assert(DEVICE_CLASS < sizeof(deviceClasses) / sizeof(deviceClasses[0]), "unknown DEVICE_CLASS");
+
+constexpr tDeviceClass devClass = deviceClasses[DEVICE_CLASS];
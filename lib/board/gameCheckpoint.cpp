@@ -0,0 +1,138 @@
+#include "gameCheckpoint.h"
+
+#include <esp_ota_ops.h>
+#include <esp_rom_crc.h>
+#include <esp_system.h>
+
+RTC_NOINIT_ATTR static tGameCheckpoint ckpt;
+static tGameCheckpoint rejoin;
+static bool rejoinPending = false;
+static uint8_t rejoinCount = 0;         // carried into the checkpoints of a rejoined game
+static uint32_t lastSaveMs = 0;
+
+static uint32_t srvIp = 0;
+static uint16_t srvPorts[4] = {0, 0, 0, 0};     // file, game, ota, status
+static uint32_t srvGameIp = 0;
+
+static uint32_t ckptCrc(void)
+{
+    return esp_rom_crc32_le(0, (const uint8_t *)&ckpt, offsetof(tGameCheckpoint, crc));
+}
+
+static bool resetIsCrash(esp_reset_reason_t reason)
+{
+    return (reason == ESP_RST_PANIC) || (reason == ESP_RST_INT_WDT) || (reason == ESP_RST_TASK_WDT) ||
+           (reason == ESP_RST_WDT) || (reason == ESP_RST_BROWNOUT);
+}
+
+void gameCheckpointInit(void)
+{
+    esp_reset_reason_t reason = esp_reset_reason();
+    const uint8_t *sha = esp_ota_get_app_description()->app_elf_sha256;
+    const char *why = NULL;
+    if (!resetIsCrash(reason))
+    {
+        why = "not a crash";
+    }
+    else if ((ckpt.magic != GAME_CKPT_MAGIC) || (ckpt.version != GAME_CKPT_VERSION) || (ckpt.size != sizeof(ckpt)) ||
+             (ckpt.crc != ckptCrc()))
+    {
+        why = "no game";
+    }
+    else if (memcmp(ckpt.appSha, sha, sizeof(ckpt.appSha)))
+    {
+        why = "another firmware";
+    }
+    else if (ckpt.rejoins >= GAME_CKPT_MAX_REJOINS)
+    {
+        why = "rejoined too often";
+    }
+
+    if (why != NULL)
+    {
+        if (resetIsCrash(reason))
+        {
+            Serial.printf(">>> gameCheckpointInit: reset %d, cold boot (%s)\r\n", (int)reason, why);
+        }
+        memset(&ckpt, 0, sizeof(ckpt));
+        return;
+    }
+    // counted right away, a crash before the next checkpoint counts too
+    ckpt.rejoins++;
+    ckpt.crc = ckptCrc();
+    rejoin = ckpt;
+    rejoinPending = true;
+    rejoinCount = ckpt.rejoins;
+    gameCheckpointSetServer(ckpt.serverIp, ckpt.filePort, ckpt.gamePort, ckpt.otaPort, ckpt.statusPort);
+    gameCheckpointSetGameHost(ckpt.gameIp);
+    Serial.printf(">>> gameCheckpointInit: reset %d in a game, rejoin #%u as role %u, health %ld, %ld s left\r\n",
+                  (int)reason, (unsigned)ckpt.rejoins, (unsigned)ckpt.role, (long)ckpt.health, (long)ckpt.secondsLeft);
+}
+
+bool gameRejoinPending(void)
+{
+    return rejoinPending;
+}
+
+const tGameCheckpoint &gameRejoinState(void)
+{
+    return rejoin;
+}
+
+void gameRejoinDone(void)
+{
+    rejoinPending = false;
+}
+
+void gameCheckpointSetServer(uint32_t ip, uint16_t filePort, uint16_t gamePort, uint16_t otaPort, uint16_t statusPort)
+{
+    srvIp = ip;
+    srvPorts[0] = filePort;
+    srvPorts[1] = gamePort;
+    srvPorts[2] = otaPort;
+    srvPorts[3] = statusPort;
+    srvGameIp = 0;
+}
+
+void gameCheckpointSetGameHost(uint32_t ip)
+{
+    srvGameIp = ip;
+}
+
+// A few dozen bytes of RTC memory and a CRC, cheap enough for the game loop
+void gameCheckpointSave(uint8_t role, int health, int secondsLeft, uint32_t protocolId)
+{
+    bool valid = (ckpt.magic == GAME_CKPT_MAGIC);
+    if (valid && (millis() - lastSaveMs < GAME_CKPT_INTERVAL_MS))
+    {
+        return;
+    }
+    lastSaveMs = millis();
+    if (!valid)
+    {
+        memset(&ckpt, 0, sizeof(ckpt));
+        ckpt.magic = GAME_CKPT_MAGIC;
+        ckpt.version = GAME_CKPT_VERSION;
+        ckpt.size = sizeof(ckpt);
+        memcpy(ckpt.appSha, esp_ota_get_app_description()->app_elf_sha256, sizeof(ckpt.appSha));
+    }
+    ckpt.protocolId = protocolId;
+    ckpt.serverIp = srvIp;
+    ckpt.filePort = srvPorts[0];
+    ckpt.gamePort = srvPorts[1];
+    ckpt.otaPort = srvPorts[2];
+    ckpt.statusPort = srvPorts[3];
+    ckpt.gameIp = srvGameIp;
+    ckpt.role = role;
+    ckpt.rejoins = rejoinCount;
+    ckpt.health = health;
+    ckpt.secondsLeft = secondsLeft;
+    ckpt.crc = ckptCrc();
+}
+
+// The game is over or was left, the next game starts counting rejoins anew
+void gameCheckpointClear(void)
+{
+    memset(&ckpt, 0, sizeof(ckpt));
+    rejoinCount = 0;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <Arduino.h>
+
+// The live game, kept in RTC memory that a crash does not clear. The game
+// loop refreshes it every GAME_CKPT_INTERVAL_MS while a lobby game plays;
+// after a brownout, panic or watchdog reset in the middle of one the boot
+// skips discovery, the OTA check and the file sync, and the game flow goes
+// straight back into the game with the role and health it had, instead of
+// waiting in the lobby with a fresh profile. The server either goes on
+// with it or, when the game ended meanwhile, its reply ends it.
+//
+// The WiFi fast-connect cache (wifiAuto.cpp) lives in the same memory, the
+// AP and channel come from there.
+
+#define GAME_CKPT_MAGIC         0x54504B43      // "CKPT"
+#define GAME_CKPT_VERSION       2
+#define GAME_CKPT_INTERVAL_MS   2000
+#define GAME_CKPT_MAX_REJOINS   3       // a game that keeps crashing the device goes back to a cold boot
+
+struct tGameCheckpoint
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t size;
+    uint8_t  appSha[8];         // of the firmware that wrote it
+    uint32_t protocolId;        // the game's session, espGetProtocolId()
+    uint32_t serverIp;          // the discovery server
+    uint16_t filePort;          // the ports discovery handed out, 0 = the config's
+    uint16_t gamePort;
+    uint16_t otaPort;
+    uint16_t statusPort;
+    uint32_t gameIp;            // the arena's game server when not on the discovery server, else 0
+    uint8_t  role;              // tGameRole
+    uint8_t  rejoins;           // fast rejoins into this game so far
+    uint8_t  reserved[2];
+    int32_t  health;
+    int32_t  secondsLeft;
+    uint32_t crc;
+};
+
+void gameCheckpointInit(void);  // on boot before WiFi: keeps the checkpoint after a crash, drops it otherwise
+bool gameRejoinPending(void);   // this boot rejoins a game
+const tGameCheckpoint &gameRejoinState(void);
+void gameRejoinDone(void);      // the game flow took it over or gave it up
+
+// Boot: where the servers are, for the checkpoints to come
+void gameCheckpointSetServer(uint32_t ip, uint16_t filePort, uint16_t gamePort, uint16_t otaPort, uint16_t statusPort);
+void gameCheckpointSetGameHost(uint32_t ip);
+// Game loop, refreshed at most every GAME_CKPT_INTERVAL_MS
+void gameCheckpointSave(uint8_t role, int health, int secondsLeft, uint32_t protocolId);
+void gameCheckpointClear(void);
@@ -3,6 +3,43 @@
 #include <driver/rtc_io.h>
 #include <esp_sleep.h>
 #include <esp32-hal-gpio.h>
+#include <sys/time.h>
+#include "fsMount.h"
+
+#define BOARD_WAKE_MAGIC    0x454B4157      // "WAKE"
+
+struct tTimerWake
+{
+    uint32_t magic;
+    int64_t  atS;           // gettimeofday()
+    uint32_t check;         // ~atS, RTC memory of another firmware is garbage
+};
+
+RTC_DATA_ATTR static tTimerWake timerWake;
+
+static int64_t nowS(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec;
+}
+
+void boardSetWakeIn(uint32_t inS)
+{
+    timerWake.magic = inS ? BOARD_WAKE_MAGIC : 0;
+    timerWake.atS = nowS() + inS;
+    timerWake.check = ~(uint32_t)timerWake.atS;
+}
+
+uint32_t boardWakeDueS(void)
+{
+    if ((timerWake.magic != BOARD_WAKE_MAGIC) || (timerWake.check != ~(uint32_t)timerWake.atS))
+    {
+        return 0;
+    }
+    int64_t left = timerWake.atS - nowS();
+    return (left > 0) ? (uint32_t)left : 0;
+}
 
 void boardStartSleep(bool btnWake, bool accelWake)
 {
@@ -76,6 +113,13 @@ void boardStartSleep(bool btnWake, bool accelWake)
         esp_sleep_enable_ext1_wakeup(ext1_wakeup_mask, ESP_EXT1_WAKEUP_ANY_HIGH);
     }
     
+    uint32_t wakeS = boardWakeDueS();
+    if (wakeS >= BOARD_WAKE_MIN_S)
+    {
+        Serial.printf("[TIMER WAKE in %u s] ", wakeS);
+        esp_sleep_enable_timer_wakeup((uint64_t)wakeS * 1000000ULL);
+    }
+
     Serial.println();
     Serial.flush();
     
@@ -86,11 +130,12 @@ void boardStartSleep(bool btnWake, bool accelWake)
     // IMPORTANT: Keep RTC_PERIPH ON to maintain GPIO state for wake-up!
     esp_sleep_pd_config(ESP_PD_DOMAIN_RTC_PERIPH, ESP_PD_OPTION_ON);
     
-    // These can be turned off to save power
-    esp_sleep_pd_config(ESP_PD_DOMAIN_RTC_SLOW_MEM, ESP_PD_OPTION_OFF);
+    // RTC slow memory holds the RTC_DATA_ATTR warm-resume snapshot, see warmState.h
+    esp_sleep_pd_config(ESP_PD_DOMAIN_RTC_SLOW_MEM, ESP_PD_OPTION_ON);
     esp_sleep_pd_config(ESP_PD_DOMAIN_RTC_FAST_MEM, ESP_PD_OPTION_OFF);
     esp_sleep_pd_config(ESP_PD_DOMAIN_XTAL, ESP_PD_OPTION_OFF);
     
+    fsUnmount();
     delay(100);
     
     esp_deep_sleep_start();
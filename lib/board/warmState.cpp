@@ -0,0 +1,121 @@
+#include "warmState.h"
+
+#include <esp_ota_ops.h>
+#include <esp_rom_crc.h>
+#include <esp_sleep.h>
+#include <sys/time.h>
+
+RTC_DATA_ATTR static tWarmState warm;
+static bool warmBoot = false;
+
+static int64_t nowS(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec;
+}
+
+static uint32_t warmCrc(void)
+{
+    return esp_rom_crc32_le(0, (const uint8_t *)&warm, offsetof(tWarmState, crc));
+}
+
+static void warmSeal(void)
+{
+    warm.crc = warmCrc();
+}
+
+static void warmReset(void)
+{
+    memset(&warm, 0, sizeof(warm));
+    warm.magic = WARM_MAGIC;
+    warm.version = WARM_VERSION;
+    warm.size = sizeof(warm);
+    memcpy(warm.appSha, esp_ota_get_app_description()->app_elf_sha256, sizeof(warm.appSha));
+    warm.coldBootS = nowS();
+    warmSeal();
+}
+
+void warmStateInit(void)
+{
+    esp_sleep_wakeup_cause_t cause = esp_sleep_get_wakeup_cause();
+    bool napWake = (cause == ESP_SLEEP_WAKEUP_EXT0) || (cause == ESP_SLEEP_WAKEUP_EXT1);
+    const char *why = NULL;
+    if (!napWake)
+    {
+        why = "not a button or accel wake";
+    }
+    else if ((warm.magic != WARM_MAGIC) || (warm.version != WARM_VERSION) || (warm.size != sizeof(warm)) ||
+             (warm.crc != warmCrc()))
+    {
+        why = "no valid snapshot";
+    }
+    else if (memcmp(warm.appSha, esp_ota_get_app_description()->app_elf_sha256, sizeof(warm.appSha)))
+    {
+        why = "another firmware";
+    }
+    else if ((nowS() < warm.coldBootS) || (nowS() - warm.coldBootS > WARM_MAX_AGE_S))
+    {
+        why = "snapshot too old";
+    }
+
+    warmBoot = (why == NULL);
+    if (warmBoot)
+    {
+        Serial.printf(">>> warmStateInit: WARM resume, cold boot %lld s ago, role %u\r\n",
+                      (long long)(nowS() - warm.coldBootS), warm.lastRole);
+        return;
+    }
+    Serial.printf(">>> warmStateInit: cold boot (%s)\r\n", why);
+    warmReset();
+}
+
+bool warmResume(void)
+{
+    return warmBoot;
+}
+
+bool warmDiscoIp(uint32_t &ip)
+{
+    ip = warm.discoIp;
+    return warmBoot && (ip != 0);
+}
+
+bool warmOtaCurrent(void)
+{
+    return warmBoot && warm.otaCurrent;
+}
+
+bool warmFilesSynced(void)
+{
+    return warmBoot && warm.filesSynced;
+}
+
+uint8_t warmLastRole(void)
+{
+    return warmBoot ? warm.lastRole : 0;
+}
+
+void warmSetDiscoIp(uint32_t ip)
+{
+    warm.discoIp = ip;
+    warmSeal();
+}
+
+void warmSetOtaCurrent(void)
+{
+    warm.otaCurrent = true;
+    warmSeal();
+}
+
+void warmSetFilesSynced(void)
+{
+    warm.filesSynced = true;
+    warmSeal();
+}
+
+void warmSetLastRole(uint8_t role)
+{
+    warm.lastRole = role;
+    warmSeal();
+}
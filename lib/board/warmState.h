@@ -0,0 +1,42 @@
+#pragma once
+
+#include <Arduino.h>
+
+// What a boot learned that still holds after a nap in deep sleep, kept in RTC
+// slow memory. On a button or accelerometer wake within WARM_MAX_AGE_S of the
+// last cold boot the boot skips discovery, the OTA check and the file sync,
+// and WiFi may reuse its DHCP lease; any other reset, another firmware or a
+// bad CRC drops it and the boot runs cold.
+
+#define WARM_MAGIC              0x4D524157      // "WARM"
+#define WARM_VERSION            2       // 2: the AP moved to the WiFi fast-connect cache
+#define WARM_MAX_AGE_S          1800    // later a cold boot checks server, files and firmware again
+
+struct tWarmState
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t size;
+    uint8_t  appSha[8];         // of the firmware that wrote it
+    int64_t  coldBootS;         // gettimeofday(), which runs on through deep sleep
+    uint32_t discoIp;           // 0: not known
+    uint8_t  lastRole;          // tGameRole the server gave last
+    bool     otaCurrent;
+    bool     filesSynced;
+    uint32_t crc;
+};
+
+void warmStateInit(void);       // first thing on boot, decides between warm and cold
+bool warmResume(void);          // this boot is a warm one
+
+// Valid parts of the snapshot on a warm boot, false / 0 on a cold one
+bool     warmDiscoIp(uint32_t &ip);
+bool     warmOtaCurrent(void);
+bool     warmFilesSynced(void);
+uint8_t  warmLastRole(void);
+
+// Recorded as the boot gets them, for the wake after the next sleep
+void warmSetDiscoIp(uint32_t ip);
+void warmSetOtaCurrent(void);
+void warmSetFilesSynced(void);
+void warmSetLastRole(uint8_t role);
@@ -0,0 +1,90 @@
+#include "espAirtime.h"
+#include "espTimecode.h"
+
+static volatile bool playing = false;
+static volatile int8_t bulkDepth = 0;
+static uint32_t bulkSinceMs = 0;
+static tAirtimeStats airStats;
+static portMUX_TYPE airMux = portMUX_INITIALIZER_UNLOCKED;
+
+void airtimeSetPlay(bool on)
+{
+    if (on != playing)
+    {
+        Serial.printf(">>> airtimeSetPlay: bulk traffic %s\r\n", on ? "in the gaps only" : "free");
+    }
+    playing = on;
+}
+
+bool airtimePlaying(void)
+{
+    return AIRTIME_ARBITER && playing;
+}
+
+uint32_t airtimeBulkWaitMs(void)
+{
+    if (!airtimePlaying())
+    {
+        return 0;
+    }
+    uint32_t phase = (uint32_t)(espClockNowMs() % AIRTIME_GAP_EVERY_MS);
+    return (phase < AIRTIME_GAP_MS) ? 0 : AIRTIME_GAP_EVERY_MS - phase;
+}
+
+bool airtimeBulkWait(volatile bool *cancel)
+{
+    uint32_t waitMs;
+    while ((waitMs = airtimeBulkWaitMs()) > 0)
+    {
+        if ((cancel != NULL) && *cancel)
+        {
+            return false;
+        }
+        delay(min(waitMs, (uint32_t)AIRTIME_POLL_MS));
+    }
+    return (cancel == NULL) || !*cancel;
+}
+
+void airtimeBulkBegin(void)
+{
+    portENTER_CRITICAL(&airMux);
+    if (bulkDepth++ == 0)
+    {
+        bulkSinceMs = millis();
+        airStats.bulkRuns++;
+    }
+    portEXIT_CRITICAL(&airMux);
+}
+
+void airtimeBulkEnd(void)
+{
+    portENTER_CRITICAL(&airMux);
+    if ((bulkDepth > 0) && (--bulkDepth == 0))
+    {
+        airStats.bulkMs += millis() - bulkSinceMs;
+    }
+    portEXIT_CRITICAL(&airMux);
+}
+
+bool airtimeBulkActive(void)
+{
+    return bulkDepth > 0;
+}
+
+void airtimeOnDeferred(void)
+{
+    portENTER_CRITICAL(&airMux);
+    airStats.deferred++;
+    portEXIT_CRITICAL(&airMux);
+}
+
+void airtimeGetStats(tAirtimeStats &stats)
+{
+    portENTER_CRITICAL(&airMux);
+    stats = airStats;
+    if (bulkDepth > 0)
+    {
+        stats.bulkMs += millis() - bulkSinceMs;
+    }
+    portEXIT_CRITICAL(&airMux);
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Airtime arbiter for the one radio ESP-NOW and WiFi share. ESP-NOW and the
+// small game API exchanges are real-time; status posts, game log uploads,
+// background sync and firmware staging are bulk. Outside play bulk goes
+// freely. In play (countdown and game) a bulk exchange may only start in a
+// gap, AIRTIME_GAP_MS of every AIRTIME_GAP_EVERY_MS on the shared clock, so
+// the gaps of the whole fleet line up and the beacons in between meet a quiet
+// channel. espStats counts the ESP-NOW sequence gaps with and without bulk
+// on air, which is what the arbiter is measured by.
+
+#ifndef AIRTIME_ARBITER
+#define AIRTIME_ARBITER         1
+#endif
+#define AIRTIME_GAP_EVERY_MS    3000
+#define AIRTIME_GAP_MS          250
+#define AIRTIME_POLL_MS         100     // airtimeBulkWait() checks its cancel flag this often
+
+enum tAirClass
+{
+    acRealtime = 0,
+    acBulk
+};
+
+struct tAirtimeStats
+{
+    uint32_t deferred = 0;      // bulk exchanges held back to a gap
+    uint32_t bulkRuns = 0;
+    uint32_t bulkMs = 0;        // time with bulk on air
+};
+
+void     airtimeSetPlay(bool on);               // game flow
+bool     airtimePlaying(void);
+uint32_t airtimeBulkWaitMs(void);               // 0: bulk may start now, else ms to the next gap
+bool     airtimeBulkWait(volatile bool *cancel = NULL);     // blocks until then, false when cancelled
+void     airtimeBulkBegin(void);                // any task, nests
+void     airtimeBulkEnd(void);
+bool     airtimeBulkActive(void);               // WiFi task too
+void     airtimeOnDeferred(void);
+void     airtimeGetStats(tAirtimeStats &stats);
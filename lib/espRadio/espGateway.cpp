@@ -0,0 +1,319 @@
+#include "espGateway.h"
+
+// Report extension value, little endian:
+//  off size field
+//   0   4   nameHash
+//   4   2   health    int16
+//   6   1   battery   %
+//   7   3   zCount, hCount, bCount
+//  10   1   neighborCount
+//  11  9*n  neighbors {id 6 bytes, role, rssi int8, zone}
+#define REPORT_FIXED_LEN        11
+#define REPORT_NEIGHBOR_LEN     9
+#define ARBITER_ENTRY_LEN       8
+
+struct tArbiterEntry
+{
+    uint32_t id;                // low 32 bits of the device ID
+    int32_t  total;
+    uint32_t publishedMs;
+};
+
+static tEspReport           report;
+static bool                 reportSet = false;
+static uint32_t             reportSentMs = 0;
+static volatile uint32_t    gatewayHeardMs = 0;
+static bool                 gatewayHeardOnce = false;
+static tEspReportHandler    reportHandler = NULL;     // set on a gateway or an arbiter only
+static uint8_t              gatewayFlags = 0;
+static uint32_t             announceSentMs = 0;
+static portMUX_TYPE         gwMux = portMUX_INITIALIZER_UNLOCKED;      // game loop and radio task
+
+// Player side of the arbiter: the totals of one arbiter at a time
+static uint32_t             selfId32 = 0;
+static uint64_t             arbiterID = 0;
+static uint8_t              arbiterEpoch = 0;
+static int32_t              arbiterLast = 0;
+static int32_t              arbiterPending = 0;
+static uint32_t             arbiterHeardMs = 0;
+static uint32_t             arbiterListedMs = 0;    // own total last seen
+static bool                 arbiterListed = false;
+
+// Arbiter side: published totals, sent a few per beacon in turn
+static tArbiterEntry        arbiterTable[ESP_ARBITER_MAX];
+static uint8_t              arbiterCount = 0;
+static uint8_t              arbiterCursor = 0;
+static uint8_t              ownEpoch = 0;
+
+static inline void putLe(uint8_t *buf, uint64_t v, uint8_t size)
+{
+    for (uint8_t i = 0; i < size; i++)
+    {
+        buf[i] = (uint8_t)(v >> (8 * i));
+    }
+}
+
+static inline uint64_t getLe(const uint8_t *buf, uint8_t size)
+{
+    uint64_t v = 0;
+    for (uint8_t i = 0; i < size; i++)
+    {
+        v |= (uint64_t)buf[i] << (8 * i);
+    }
+    return v;
+}
+
+void espReportSet(const tEspReport &r)
+{
+    portENTER_CRITICAL(&gwMux);
+    report = r;
+    reportSet = true;
+    portEXIT_CRITICAL(&gwMux);
+}
+
+bool espGatewayHeard(void)
+{
+    return gatewayHeardOnce && (millis() - gatewayHeardMs < ESP_GATEWAY_AGE_MS);
+}
+
+bool espArbiterHeard(void)
+{
+    return arbiterListed && (millis() - arbiterListedMs < ESP_ARBITER_LISTED_MS);
+}
+
+int32_t espArbiterTake(void)
+{
+    portENTER_CRITICAL(&gwMux);
+    int32_t d = arbiterPending;
+    arbiterPending = 0;
+    portEXIT_CRITICAL(&gwMux);
+    return d;
+}
+
+void espGatewayStart(tEspReportHandler handler, uint8_t flags)
+{
+    reportHandler = handler;
+    gatewayFlags = flags;
+    // a restarted arbiter must not look like the old one to the players
+    ownEpoch = (uint8_t)(esp_random() | 1);
+    Serial.printf(">>> espGatewayStart: collecting player reports, flags 0x%02X\r\n", flags);
+}
+
+void espArbiterPublish(uint64_t deviceID, int32_t total)
+{
+    uint32_t id = (uint32_t)deviceID;
+    portENTER_CRITICAL(&gwMux);
+    uint8_t i = 0;
+    while ((i < arbiterCount) && (arbiterTable[i].id != id))
+    {
+        i++;
+    }
+    for (uint8_t k = 0; (i == ESP_ARBITER_MAX) && (k < arbiterCount); k++)
+    {
+        if (millis() - arbiterTable[k].publishedMs >= ESP_ARBITER_ENTRY_MS)
+        {
+            i = k;      // full, take the place of a player that left
+        }
+    }
+    if (i < ESP_ARBITER_MAX)
+    {
+        arbiterTable[i].id = id;
+        arbiterTable[i].total = total;
+        arbiterTable[i].publishedMs = millis();
+        if (i == arbiterCount)
+        {
+            arbiterCount++;
+        }
+    }
+    portEXIT_CRITICAL(&gwMux);
+}
+
+static uint8_t buildReport(uint8_t *buf, uint8_t bufSize)
+{
+    portENTER_CRITICAL(&gwMux);
+    tEspReport r = report;
+    portEXIT_CRITICAL(&gwMux);
+    uint8_t count = min(r.neighborCount, (uint8_t)ESP_REPORT_NEIGHBORS);
+    uint8_t len = REPORT_FIXED_LEN + count * REPORT_NEIGHBOR_LEN;
+    if (2 + len > bufSize)
+    {
+        return 0;
+    }
+    uint8_t *v = &buf[2];
+    putLe(&v[0], r.nameHash, 4);
+    putLe(&v[4], (uint16_t)r.health, 2);
+    v[6] = r.battery;
+    v[7] = r.zCount;
+    v[8] = r.hCount;
+    v[9] = r.bCount;
+    v[10] = count;
+    for (uint8_t i = 0; i < count; i++)
+    {
+        uint8_t *nb = &v[REPORT_FIXED_LEN + i * REPORT_NEIGHBOR_LEN];
+        putLe(&nb[0], r.neighbors[i].id, 6);
+        nb[6] = r.neighbors[i].role;
+        nb[7] = (uint8_t)r.neighbors[i].rssi;
+        nb[8] = r.neighbors[i].zone;
+    }
+    buf[0] = ESP_WIRE_EXT_REPORT;
+    buf[1] = len;
+    return 2 + len;
+}
+
+// As many totals as fit, continuing where the last beacon stopped
+static uint8_t buildArbiter(uint8_t *buf, uint8_t bufSize)
+{
+    if ((arbiterCount == 0) || (bufSize < 3 + ARBITER_ENTRY_LEN))
+    {
+        return 0;
+    }
+    uint8_t fit = (bufSize - 3) / ARBITER_ENTRY_LEN;
+    uint8_t n = 0;
+    uint32_t now = millis();
+    buf[2] = ownEpoch;
+    portENTER_CRITICAL(&gwMux);
+    for (uint8_t i = 0; (i < arbiterCount) && (n < fit); i++)
+    {
+        arbiterCursor %= arbiterCount;
+        const tArbiterEntry &e = arbiterTable[arbiterCursor++];
+        if (now - e.publishedMs >= ESP_ARBITER_ENTRY_MS)
+        {
+            continue;       // gone from the zone, its player decides on its own again
+        }
+        putLe(&buf[3 + n * ARBITER_ENTRY_LEN], e.id, 4);
+        putLe(&buf[7 + n * ARBITER_ENTRY_LEN], (uint32_t)e.total, 4);
+        n++;
+    }
+    portEXIT_CRITICAL(&gwMux);
+    if (n == 0)
+    {
+        return 0;
+    }
+    buf[0] = ESP_WIRE_EXT_ARBITER;
+    buf[1] = 1 + n * ARBITER_ENTRY_LEN;
+    return 2 + buf[1];
+}
+
+// A gateway announces itself, an arbiter also sends the totals; a player that
+// hears either reports now and then
+uint8_t espGatewayBuildExt(uint64_t selfID, uint8_t *buf, uint8_t bufSize)
+{
+    uint32_t now = millis();
+    selfId32 = (uint32_t)selfID;
+    if (reportHandler != NULL)
+    {
+        uint8_t len = 0;
+        if ((now - announceSentMs >= ESP_GATEWAY_ANNOUNCE_MS) && (bufSize >= 3))
+        {
+            announceSentMs = now;
+            buf[0] = ESP_WIRE_EXT_GATEWAY;
+            buf[1] = 1;
+            buf[2] = gatewayFlags;
+            len = 3;
+        }
+        if (gatewayFlags & ESP_GATEWAY_FLAG_ARBITER)
+        {
+            len += buildArbiter(buf + len, bufSize - len);
+        }
+        return len;
+    }
+    uint32_t interval = espArbiterHeard() ? ESP_REPORT_ARBITER_MS : ESP_REPORT_INTERVAL_MS;
+    bool collector = espGatewayHeard() || ((arbiterID != 0) && (now - arbiterHeardMs < ESP_GATEWAY_AGE_MS));
+    if (!reportSet || !collector || (now - reportSentMs < interval))
+    {
+        return 0;
+    }
+    uint8_t len = buildReport(buf, bufSize);
+    if (len)
+    {
+        reportSentMs = now;
+    }
+    return len;
+}
+
+// A total seen for the first time, or from a restarted arbiter, is only the baseline
+static void arbiterOnRx(const uint8_t *value, uint8_t valueLen)
+{
+    uint8_t epoch = value[0];
+    arbiterHeardMs = millis();
+    for (uint8_t pos = 1; pos + ARBITER_ENTRY_LEN <= valueLen; pos += ARBITER_ENTRY_LEN)
+    {
+        if ((uint32_t)getLe(&value[pos], 4) != selfId32)
+        {
+            continue;
+        }
+        int32_t total = (int32_t)getLe(&value[pos + 4], 4);
+        portENTER_CRITICAL(&gwMux);
+        if (espArbiterHeard() && (epoch == arbiterEpoch))
+        {
+            arbiterPending += total - arbiterLast;
+        }
+        arbiterLast = total;
+        arbiterEpoch = epoch;
+        arbiterListed = true;
+        arbiterListedMs = millis();
+        portEXIT_CRITICAL(&gwMux);
+        return;
+    }
+}
+
+void espGatewayOnRx(const tEspPacket &pkt, const tEspWireExt &ext, int rssi)
+{
+    if (ext.len == 0)
+    {
+        return;
+    }
+    const uint8_t *value;
+    uint8_t valueLen;
+    if (espWireFindExt(ext, ESP_WIRE_EXT_GATEWAY, value, valueLen) && (valueLen >= 1))
+    {
+        if (value[0] & ESP_GATEWAY_FLAG_FORWARD)
+        {
+            gatewayHeardMs = millis();
+            gatewayHeardOnce = true;
+        }
+        if ((value[0] & ESP_GATEWAY_FLAG_ARBITER) && (reportHandler == NULL))
+        {
+            if ((pkt.deviceID != arbiterID) && ((arbiterID == 0) || (millis() - arbiterHeardMs >= ESP_GATEWAY_AGE_MS)))
+            {
+                // follow this base until it is out of range
+                arbiterID = pkt.deviceID;
+                arbiterListed = false;
+            }
+            if (pkt.deviceID == arbiterID)
+            {
+                arbiterHeardMs = millis();
+            }
+        }
+    }
+    if ((pkt.deviceID == arbiterID) && espWireFindExt(ext, ESP_WIRE_EXT_ARBITER, value, valueLen) && (valueLen >= 1))
+    {
+        arbiterOnRx(value, valueLen);
+    }
+    if ((reportHandler == NULL) || !espWireFindExt(ext, ESP_WIRE_EXT_REPORT, value, valueLen) ||
+        (valueLen < REPORT_FIXED_LEN))
+    {
+        return;
+    }
+    tEspReport r;
+    r.nameHash = (uint32_t)getLe(&value[0], 4);
+    r.health = (int16_t)getLe(&value[4], 2);
+    r.battery = value[6];
+    r.zCount = value[7];
+    r.hCount = value[8];
+    r.bCount = value[9];
+    r.neighborCount = min(value[10], (uint8_t)ESP_REPORT_NEIGHBORS);
+    if (valueLen < REPORT_FIXED_LEN + r.neighborCount * REPORT_NEIGHBOR_LEN)
+    {
+        return;
+    }
+    for (uint8_t i = 0; i < r.neighborCount; i++)
+    {
+        const uint8_t *nb = &value[REPORT_FIXED_LEN + i * REPORT_NEIGHBOR_LEN];
+        r.neighbors[i].id = getLe(&nb[0], 6);
+        r.neighbors[i].role = nb[6];
+        r.neighbors[i].rssi = (int8_t)nb[7];
+        r.neighbors[i].zone = nb[8];
+    }
+    reportHandler(pkt, rssi, r);
+}
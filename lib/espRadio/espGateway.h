@@ -0,0 +1,67 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "espPacket.h"
+#include "espWire.h"
+
+// ESP-NOW to WiFi gateway. A gateway puts a short announce into its beacons;
+// players that hear one add their compact state (health, battery, near
+// counts, strongest neighbours) to a beacon every ESP_REPORT_INTERVAL_MS and
+// report to the game server over WiFi only on a role change or a heartbeat.
+// The gateway collects the reports and forwards them in one batch per interval.
+//
+// A base in arbiter mode collects the same reports, computes the hits and
+// heals of its zone centrally and puts every player's running total into its
+// beacons; a player listed there takes its health changes from the totals
+// instead of its own neighbour table, so both sides of a fight agree.
+
+#define ESP_WIRE_EXT_REPORT     3       // tEspReport, see espGateway.cpp for the layout
+#define ESP_WIRE_EXT_GATEWAY    4       // uint8 ESP_GATEWAY_FLAG_*
+#define ESP_WIRE_EXT_ARBITER    5       // uint8 epoch, {uint32 device, int32 total points}...
+#define ESP_GATEWAY_FLAG_FORWARD 0x01   // reports go on to the game server
+#define ESP_GATEWAY_FLAG_ARBITER 0x02   // a base computes the zone's damage
+#define ESP_REPORT_NEIGHBORS    3       // what fits next to timecode and show
+#define ESP_REPORT_INTERVAL_MS  2000
+#define ESP_REPORT_ARBITER_MS   500     // the arbiter's damage follows these reports
+#define ESP_ARBITER_MAX         64      // players one arbiter keeps totals for
+#define ESP_ARBITER_ENTRY_MS    1000    // a total not published again this long is no longer sent
+#define ESP_ARBITER_LISTED_MS   3000    // a player not listed this long decides on its own again
+#define ESP_GATEWAY_ANNOUNCE_MS 1000
+#define ESP_GATEWAY_AGE_MS      6000    // a gateway not heard this long is gone
+
+struct tEspReportNeighbor
+{
+    uint64_t id;                // 48 bit MAC
+    uint8_t  role;              // tGameRole
+    int8_t   rssi;
+    uint8_t  zone;              // tRssiZone
+};
+
+struct tEspReport
+{
+    uint32_t nameHash = 0;      // gameMcastIdHash() of the device name the server knows
+    int16_t  health = 0;
+    uint8_t  battery = 0;
+    uint8_t  zCount = 0;
+    uint8_t  hCount = 0;
+    uint8_t  bCount = 0;
+    uint8_t  neighborCount = 0;
+    tEspReportNeighbor neighbors[ESP_REPORT_NEIGHBORS];
+};
+
+// Runs in the WiFi task, keep it short; pkt is the beacon that carried the report
+typedef void (*tEspReportHandler)(const tEspPacket &pkt, int rssi, const tEspReport &report);
+
+// Player side
+void    espReportSet(const tEspReport &report);
+bool    espGatewayHeard(void);          // a forwarding gateway is in range
+bool    espArbiterHeard(void);          // an arbiter lists this device
+int32_t espArbiterTake(void);           // health change since the last call
+
+// Gateway and arbiter side
+void espGatewayStart(tEspReportHandler handler, uint8_t flags);
+void espArbiterPublish(uint64_t deviceID, int32_t total);     // repeat at least every ESP_ARBITER_ENTRY_MS
+
+uint8_t espGatewayBuildExt(uint64_t selfID, uint8_t *buf, uint8_t bufSize);
+void    espGatewayOnRx(const tEspPacket &pkt, const tEspWireExt &ext, int rssi);
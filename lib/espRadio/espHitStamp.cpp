@@ -0,0 +1,202 @@
+#include "espHitStamp.h"
+#include "espTimecode.h"
+
+static const char *stageNames[HIT_LAT_STAGE_COUNT] = {"react", "screen"};
+
+static volatile bool    stampOn = ESP_HIT_STAMP;
+static bool             pendingValid = false;   // first stamp since the last damage step
+static uint32_t         pendingSentMs = 0;
+static bool             screenValid = false;    // damage applied, not drawn yet
+static uint32_t         screenSentMs = 0;
+static uint32_t         sessionId = 0;          // protocol ID the histograms belong to
+static uint32_t         dropped = 0;            // stamps out of the plausible range
+static tHitLatStats     stats[HIT_LAT_STAGE_COUNT];
+static portMUX_TYPE     hitMux = portMUX_INITIALIZER_UNLOCKED;     // WiFi task, game loop and the screen task
+
+static inline uint8_t bucketOf(uint32_t ms)
+{
+    uint8_t b = (ms == 0) ? 0 : 31 - __builtin_clz(ms);
+    return (b < ESP_HIT_LAT_BUCKETS) ? b : ESP_HIT_LAT_BUCKETS - 1;
+}
+
+static inline uint32_t sharedNowMs(void)
+{
+    return (uint32_t)espClockNowMs();
+}
+
+void espHitStampEnable(bool on)
+{
+    stampOn = on;
+    Serial.printf(">>> espHitStampEnable: %s\r\n", on ? "on" : "off");
+}
+
+bool espHitStampEnabled(void)
+{
+    return stampOn;
+}
+
+// Without a shared clock a stamp says nothing
+uint8_t espHitStampBuildExt(uint8_t *buf, uint8_t bufSize)
+{
+    if (!stampOn || (espClockSource() == ecsNone) || (bufSize < 2 + 4))
+    {
+        return 0;
+    }
+    uint32_t now = sharedNowMs();
+    buf[0] = ESP_WIRE_EXT_HITSTAMP;
+    buf[1] = 4;
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        buf[2 + i] = (uint8_t)(now >> (8 * i));
+    }
+    return 2 + 4;
+}
+
+void espHitStampOnRx(const tEspPacket &pkt, const tEspWireExt &ext, tGameRole selfRole)
+{
+    const uint8_t *value;
+    uint8_t valueLen;
+    if ((ext.len == 0) || (pkt.deviceRole == selfRole) || (espClockSource() == ecsNone) ||
+        !espWireFindExt(ext, ESP_WIRE_EXT_HITSTAMP, value, valueLen) || (valueLen != 4))
+    {
+        return;
+    }
+    uint32_t sentMs = (uint32_t)value[0] | ((uint32_t)value[1] << 8) | ((uint32_t)value[2] << 16) | ((uint32_t)value[3] << 24);
+    uint32_t now = sharedNowMs();
+    portENTER_CRITICAL(&hitMux);
+    if (!pendingValid || ((int32_t)(now - pendingSentMs) > ESP_HIT_LAT_PENDING_MS))
+    {
+        pendingSentMs = sentMs;
+        pendingValid = true;
+    }
+    portEXIT_CRITICAL(&hitMux);
+}
+
+// Under hitMux; the game server may hand out the session's protocol ID after
+// the game loop started, the samples under the old one are dropped then
+static void recordLocked(tHitLatStage stage, uint32_t sentMs)
+{
+    uint32_t session = espGetProtocolId();
+    if (session != sessionId)
+    {
+        memset(stats, 0, sizeof(stats));
+        dropped = 0;
+        sessionId = session;
+    }
+    int32_t latMs = (int32_t)(sharedNowMs() - sentMs);
+    if ((latMs < -ESP_HIT_LAT_EARLY_MS) || (latMs > ESP_HIT_LAT_MAX_MS))
+    {
+        dropped++;
+        return;
+    }
+    uint32_t ms = (latMs > 0) ? (uint32_t)latMs : 0;
+    tHitLatStats &s = stats[stage];
+    s.count++;
+    s.hist[bucketOf(ms)]++;
+    if (ms > s.maxMs)
+    {
+        s.maxMs = ms;
+    }
+}
+
+void espHitStampDamage(void)
+{
+    portENTER_CRITICAL(&hitMux);
+    if (pendingValid)
+    {
+        recordLocked(hlReact, pendingSentMs);
+        screenSentMs = pendingSentMs;
+        screenValid = true;
+        pendingValid = false;
+    }
+    portEXIT_CRITICAL(&hitMux);
+}
+
+void espHitStampScreen(void)
+{
+    portENTER_CRITICAL(&hitMux);
+    if (screenValid)
+    {
+        recordLocked(hlScreen, screenSentMs);
+        screenValid = false;
+    }
+    portEXIT_CRITICAL(&hitMux);
+}
+
+void espHitLatencyReset(void)
+{
+    portENTER_CRITICAL(&hitMux);
+    memset(stats, 0, sizeof(stats));
+    pendingValid = false;
+    screenValid = false;
+    dropped = 0;
+    sessionId = espGetProtocolId();
+    portEXIT_CRITICAL(&hitMux);
+}
+
+void espHitLatencyGet(tHitLatStage stage, tHitLatStats &out)
+{
+    portENTER_CRITICAL(&hitMux);
+    out = stats[stage];
+    portEXIT_CRITICAL(&hitMux);
+}
+
+uint32_t espHitLatencySamples(void)
+{
+    return stats[hlReact].count + stats[hlScreen].count;
+}
+
+// Upper edge of the bucket that holds the pct-th sample, capped at the max
+static uint32_t percentile(const tHitLatStats &s, uint32_t pct)
+{
+    uint32_t want = (s.count * pct + 99) / 100;
+    uint32_t seen = 0;
+    for (uint8_t b = 0; b < ESP_HIT_LAT_BUCKETS; b++)
+    {
+        seen += s.hist[b];
+        if (seen >= want)
+        {
+            uint32_t upper = (b < ESP_HIT_LAT_BUCKETS - 1) ? (2UL << b) - 1 : s.maxMs;
+            return min(upper, s.maxMs);
+        }
+    }
+    return s.maxMs;
+}
+
+void espHitLatencyPrint(void)
+{
+    Serial.printf(">>> espHitLatencyPrint: stamps %s, clock %d, session %08X, %u dropped\r\n",
+                  stampOn ? "on" : "off", (int)espClockSource(), (unsigned)sessionId, (unsigned)dropped);
+    Serial.printf("%-8s %8s %8s %8s %8s\r\n", "stage", "hits", "p50 ms", "p99 ms", "max ms");
+    for (int i = 0; i < HIT_LAT_STAGE_COUNT; i++)
+    {
+        tHitLatStats s;
+        espHitLatencyGet((tHitLatStage)i, s);
+        Serial.printf("%-8s %8u %8u %8u %8u\r\n", stageNames[i], (unsigned)s.count,
+                      (unsigned)(s.count ? percentile(s, 50) : 0), (unsigned)(s.count ? percentile(s, 99) : 0), (unsigned)s.maxMs);
+    }
+}
+
+// The histograms themselves, the server merges them over the devices of a game
+void espHitLatencyWriteJson(tJsonWriter &json)
+{
+    json.beginObject("hit_latency");
+    json.field("game", sessionId);
+    json.field("dropped", dropped);
+    for (int i = 0; i < HIT_LAT_STAGE_COUNT; i++)
+    {
+        tHitLatStats s;
+        espHitLatencyGet((tHitLatStage)i, s);
+        json.beginObject(stageNames[i]);
+        json.field("n", s.count);
+        json.field("max", s.maxMs);
+        json.beginArray("hist");
+        for (uint8_t b = 0; b < ESP_HIT_LAT_BUCKETS; b++)
+        {
+            json.value(s.hist[b]);
+        }
+        json.endArray();
+        json.endObject();
+    }
+    json.endObject();
+}
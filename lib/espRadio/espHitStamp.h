@@ -0,0 +1,56 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "espWire.h"
+#include "jsonWriter.h"
+
+// Hit latency, attacker's beacon to the damage the victim shows. With the
+// mode on, a device whose shared clock is set (espTimecode.h) puts the shared
+// ms of every beacon into it. The victim keeps the stamp of the first frame
+// from another role since its last damage step (or since a second ago when
+// no damage followed); when a step takes health the latency to the LED and
+// vibro reaction is counted, and the next game screen drawn gives the
+// latency to the display. Both go into log2 histograms for
+// the running game session, which the status report carries so the server
+// can merge them per game.
+
+#define ESP_WIRE_EXT_HITSTAMP   7       // uint32 low bits of the sender's shared ms at encode time
+#ifndef ESP_HIT_STAMP
+#define ESP_HIT_STAMP           0       // off by default, 6 more bytes per beacon
+#endif
+#define ESP_HIT_LAT_BUCKETS     12      // [2^b, 2^(b+1)) ms, 0 ms in the first, the last one open ended
+#define ESP_HIT_LAT_MAX_MS      5000    // older stamps are a clock jump, not a hit
+#define ESP_HIT_LAT_EARLY_MS    20      // clock error allowed before a stamp "from the future" is dropped
+#define ESP_HIT_LAT_PENDING_MS  1000    // a stamp no damage followed this long gives way to the next one
+
+enum tHitLatStage
+{
+    hlReact,            // LEDs and vibro, the game step that applied the damage
+    hlScreen,           // the game screen that shows it
+    HIT_LAT_STAGE_COUNT
+};
+
+struct tHitLatStats
+{
+    uint32_t count;
+    uint32_t maxMs;
+    uint32_t hist[ESP_HIT_LAT_BUCKETS];
+};
+
+void espHitStampEnable(bool on);
+bool espHitStampEnabled(void);
+
+uint8_t espHitStampBuildExt(uint8_t *buf, uint8_t bufSize);
+void    espHitStampOnRx(const tEspPacket &pkt, const tEspWireExt &ext, tGameRole selfRole);   // WiFi task
+
+// Game loop, once the step that took health has been visualized
+void espHitStampDamage(void);
+// Game screen task, after a game screen was drawn
+void espHitStampScreen(void);
+
+void espHitLatencyReset(void);      // new game session
+void espHitLatencyGet(tHitLatStage stage, tHitLatStats &stats);
+uint32_t espHitLatencySamples(void);            // both stages, changes with every new sample
+void espHitLatencyPrint(void);
+void espHitLatencyWriteJson(tJsonWriter &json); // "hit_latency":{...} member of an open object
@@ -0,0 +1,184 @@
+#include "espNeighbors.h"
+
+#include "gameRole.h"
+
+static tEspNeighbor     ownList[ESP_NEIGHBORS_MAX];
+static uint8_t          ownCount = 0;
+static uint32_t         ownSetMs = 0;
+static uint32_t         ownSentMs = 0;
+static tEspGraphNode   *graph = NULL;          // ESP_GRAPH_NODES, collectors only
+static uint8_t          graphCount = 0;
+static portMUX_TYPE     nbMux = portMUX_INITIALIZER_UNLOCKED;      // game loop, radio and WiFi task
+
+// Zombie, human and base keep their role, the rest reads as grNone
+static inline uint8_t packEntry(uint8_t role, int8_t rssi)
+{
+    uint8_t r = (role <= grBase) ? role : grNone;
+    int bucket = constrain((rssi - ESP_NEIGHBORS_RSSI_MIN) / ESP_NEIGHBORS_RSSI_STEP, 0, 63);
+    return (uint8_t)((r << 6) | bucket);
+}
+
+void espNeighborsSet(const tEspNeighbor *list, uint8_t count)
+{
+    count = min(count, (uint8_t)ESP_NEIGHBORS_MAX);
+    portENTER_CRITICAL(&nbMux);
+    memcpy(ownList, list, count * sizeof(tEspNeighbor));
+    ownCount = count;
+    ownSetMs = millis();
+    portEXIT_CRITICAL(&nbMux);
+}
+
+bool espNeighborsCollect(void)
+{
+    if (graph != NULL)
+    {
+        return true;
+    }
+    graph = (tEspGraphNode *)calloc(ESP_GRAPH_NODES, sizeof(tEspGraphNode));
+    if (graph == NULL)
+    {
+        Serial.println("!!! espNeighborsCollect ERROR: no memory for the graph");
+        return false;
+    }
+    Serial.printf(">>> espNeighborsCollect: up to %d senders\r\n", ESP_GRAPH_NODES);
+    return true;
+}
+
+// A summary when it is due and fresh, cut to what fits; one that does not
+// fit at all waits for the next beacon
+uint8_t espNeighborsBuildExt(uint8_t *buf, uint8_t bufSize)
+{
+    uint32_t now = millis();
+    if ((ownCount == 0) || (now - ownSentMs < ESP_NEIGHBORS_EVERY_MS) || (now - ownSetMs >= ESP_NEIGHBORS_STALE_MS) ||
+        (bufSize < 2 + ESP_NEIGHBORS_ENTRY_LEN))
+    {
+        return 0;
+    }
+    uint8_t fit = (bufSize - 2) / ESP_NEIGHBORS_ENTRY_LEN;
+    portENTER_CRITICAL(&nbMux);
+    uint8_t n = min(ownCount, fit);
+    for (uint8_t i = 0; i < n; i++)
+    {
+        uint8_t *e = &buf[2 + i * ESP_NEIGHBORS_ENTRY_LEN];
+        uint16_t shortId = espShortId(ownList[i].id);
+        e[0] = (uint8_t)shortId;
+        e[1] = (uint8_t)(shortId >> 8);
+        e[2] = packEntry(ownList[i].role, ownList[i].rssi);
+    }
+    portEXIT_CRITICAL(&nbMux);
+    ownSentMs = now;
+    buf[0] = ESP_WIRE_EXT_NEIGHBORS;
+    buf[1] = n * ESP_NEIGHBORS_ENTRY_LEN;
+    return 2 + buf[1];
+}
+
+// The sender's slot, a new one or the oldest when full; under nbMux
+static tEspGraphNode *nodeFor(uint64_t id, uint32_t now)
+{
+    uint8_t oldest = 0;
+    for (uint8_t i = 0; i < graphCount; i++)
+    {
+        if (graph[i].id == id)
+        {
+            return &graph[i];
+        }
+        if ((int32_t)(graph[i].heardMs - graph[oldest].heardMs) < 0)
+        {
+            oldest = i;
+        }
+    }
+    if (graphCount < ESP_GRAPH_NODES)
+    {
+        return &graph[graphCount++];
+    }
+    return (now - graph[oldest].heardMs >= ESP_GRAPH_AGE_MS) ? &graph[oldest] : NULL;
+}
+
+void espNeighborsOnRx(const tEspPacket &pkt, const tEspWireExt &ext, int rssi)
+{
+    const uint8_t *value;
+    uint8_t valueLen;
+    if ((graph == NULL) || (ext.len == 0) || !espWireFindExt(ext, ESP_WIRE_EXT_NEIGHBORS, value, valueLen) ||
+        (valueLen % ESP_NEIGHBORS_ENTRY_LEN))
+    {
+        return;
+    }
+    uint8_t n = min(valueLen / ESP_NEIGHBORS_ENTRY_LEN, ESP_NEIGHBORS_MAX);
+    uint32_t now = millis();
+    portENTER_CRITICAL(&nbMux);
+    tEspGraphNode *node = nodeFor(pkt.deviceID, now);
+    if (node != NULL)
+    {
+        node->id = pkt.deviceID;
+        node->role = (uint8_t)pkt.deviceRole;
+        node->rssi = (int8_t)constrain(rssi, -128, 127);
+        node->heardMs = now;
+        node->edgeCount = n;
+        for (uint8_t i = 0; i < n; i++)
+        {
+            const uint8_t *e = &value[i * ESP_NEIGHBORS_ENTRY_LEN];
+            node->edges[i].shortId = (uint16_t)(e[0] | (e[1] << 8));
+            node->edges[i].role = e[2] >> 6;
+            node->edges[i].rssi = ESP_NEIGHBORS_RSSI_MIN + (e[2] & 0x3F) * ESP_NEIGHBORS_RSSI_STEP;
+        }
+    }
+    portEXIT_CRITICAL(&nbMux);
+}
+
+uint8_t espNeighborGraphCopy(tEspGraphNode *dst, uint8_t maxCount)
+{
+    if (graph == NULL)
+    {
+        return 0;
+    }
+    uint8_t n = 0;
+    uint32_t now = millis();
+    portENTER_CRITICAL(&nbMux);
+    for (uint8_t i = 0; (i < graphCount) && (n < maxCount); i++)
+    {
+        if (now - graph[i].heardMs < ESP_GRAPH_AGE_MS)
+        {
+            dst[n++] = graph[i];
+        }
+    }
+    portEXIT_CRITICAL(&nbMux);
+    return n;
+}
+
+// Short IDs of senders in the graph print as their MAC
+void espNeighborGraphPrint(void)
+{
+    static tEspGraphNode nodes[ESP_GRAPH_NODES];
+    if (graph == NULL)
+    {
+        Serial.println("*** espNeighborGraphPrint WARNING! this device does not collect summaries");
+        return;
+    }
+    uint8_t n = espNeighborGraphCopy(nodes, ESP_GRAPH_NODES);
+    Serial.printf(">>> NEIGHBOR GRAPH: %u senders\r\n", n);
+    uint32_t now = millis();
+    for (uint8_t i = 0; i < n; i++)
+    {
+        const tEspGraphNode &nd = nodes[i];
+        Serial.printf("\t%012llX %-9s %4d dBm %5lu ms ago:", (unsigned long long)nd.id, role2str((tGameRole)nd.role),
+                      nd.rssi, now - nd.heardMs);
+        for (uint8_t k = 0; k < nd.edgeCount; k++)
+        {
+            const tEspGraphEdge &e = nd.edges[k];
+            uint8_t j = 0;
+            while ((j < n) && (espShortId(nodes[j].id) != e.shortId))
+            {
+                j++;
+            }
+            if (j < n)
+            {
+                Serial.printf(" %012llX/%d", (unsigned long long)nodes[j].id, e.rssi);
+            }
+            else
+            {
+                Serial.printf(" ~%04X/%d", e.shortId, e.rssi);
+            }
+        }
+        Serial.println();
+    }
+}
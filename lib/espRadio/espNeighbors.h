@@ -0,0 +1,65 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "espPacket.h"
+#include "espWire.h"
+
+// Neighbour summaries for a proximity graph of the arena. Every
+// ESP_NEIGHBORS_EVERY_MS a player puts its strongest neighbours into a beacon,
+// each as a 16-bit short ID, its role and an RSSI bucket; bases and gateways
+// that collect keep the newest summary per sender, which gives them the
+// approximate graph of who sees whom without any WiFi traffic from the players.
+// Short IDs may collide, the graph is a picture of the arena, not a game input.
+
+#define ESP_WIRE_EXT_NEIGHBORS  8       // {uint16 short ID, uint8 role << 6 | RSSI bucket}..., strongest first
+#define ESP_NEIGHBORS_MAX       8       // top-K per summary
+#define ESP_NEIGHBORS_ENTRY_LEN 3
+#define ESP_NEIGHBORS_EXT_LEN   (2 + ESP_NEIGHBORS_MAX * ESP_NEIGHBORS_ENTRY_LEN)
+#define ESP_NEIGHBORS_EVERY_MS  1000    // per device, a fraction of the beacons
+#define ESP_NEIGHBORS_STALE_MS  3000    // a list not set again this long is not sent
+#define ESP_NEIGHBORS_RSSI_MIN  -110    // bucket 0, then ESP_NEIGHBORS_RSSI_STEP dB each up to 63
+#define ESP_NEIGHBORS_RSSI_STEP 2
+#define ESP_GRAPH_NODES         64      // senders a collector keeps
+#define ESP_GRAPH_AGE_MS        5000    // a sender not heard this long leaves the graph
+
+struct tEspNeighbor
+{
+    uint64_t id;                // 48 bit MAC
+    uint8_t  role;              // tGameRole
+    int8_t   rssi;
+};
+
+// What a collector heard, RSSI back from the bucket
+struct tEspGraphEdge
+{
+    uint16_t shortId;
+    uint8_t  role;              // tGameRole, grNone for roles above grBase
+    int8_t   rssi;
+};
+
+struct tEspGraphNode
+{
+    uint64_t      id;
+    uint8_t       role;
+    int8_t        rssi;         // of the summary's frame at the collector
+    uint32_t      heardMs;
+    uint8_t       edgeCount;
+    tEspGraphEdge edges[ESP_NEIGHBORS_MAX];
+};
+
+inline uint16_t espShortId(uint64_t id)
+{
+    return (uint16_t)(id ^ (id >> 16) ^ (id >> 32));
+}
+
+// Player side, strongest first; repeat at least every ESP_NEIGHBORS_STALE_MS
+void espNeighborsSet(const tEspNeighbor *list, uint8_t count);
+
+// Base and gateway side: allocates the graph on the first call
+bool    espNeighborsCollect(void);
+uint8_t espNeighborGraphCopy(tEspGraphNode *dst, uint8_t maxCount);    // senders heard within ESP_GRAPH_AGE_MS
+void    espNeighborGraphPrint(void);
+
+uint8_t espNeighborsBuildExt(uint8_t *buf, uint8_t bufSize);
+void    espNeighborsOnRx(const tEspPacket &pkt, const tEspWireExt &ext, int rssi);     // WiFi task
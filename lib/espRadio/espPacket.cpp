@@ -1,5 +1,25 @@
 #include "espPacket.h"
 
+static volatile uint32_t sessionProtocolId = ESP_PROTOCOL_ID;
+
+uint32_t espGetProtocolId(void)
+{
+    return sessionProtocolId;
+}
+
+void espSetProtocolId(uint32_t protocolId)
+{
+    if (protocolId == 0)
+    {
+        protocolId = ESP_PROTOCOL_ID;
+    }
+    if (protocolId != sessionProtocolId)
+    {
+        Serial.printf(">>> espSetProtocolId: %lu\r\n", protocolId);
+    }
+    sessionProtocolId = protocolId;
+}
+
 //////////////////
 tEspPacket::tEspPacket(tGameRole dR)
 {
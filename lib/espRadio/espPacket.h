@@ -22,6 +22,11 @@ struct __attribute__((packed)) tEspPacket
     void            print(void);
 };
 
+// Protocol ID of the running game session, ESP_PROTOCOL_ID until the game
+// server assigns another one
+uint32_t espGetProtocolId(void);
+void     espSetProtocolId(uint32_t protocolId);
+
 //int i = sizeof(tEspPacket);
 // int j = sizeof(tEspParam);
 
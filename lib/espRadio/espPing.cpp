@@ -0,0 +1,339 @@
+#include "espPing.h"
+#include "espNeighbors.h"
+#include "espRadio.h"
+
+// Pinger side, the stats under pingMux: WiFi task and the pinger task
+static bool          pinger = false;
+static uint16_t      selfShort = 0;
+static volatile bool requestArmed = false;
+static tEspPingStats stats;
+static tEspPingPeer  peers[ESP_PING_PEERS];
+static uint8_t       peerCount = 0;
+static portMUX_TYPE  pingMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Responder side, the newest request heard: WiFi task and the radio task
+struct tPingPending
+{
+    bool     valid;
+    uint16_t pingerShort;
+    uint16_t seq;
+    uint32_t stamp;
+    uint32_t rxUs;
+    uint32_t rxMs;
+};
+static tPingPending pending;
+static portMUX_TYPE pendingMux = portMUX_INITIALIZER_UNLOCKED;
+
+static inline void put16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void put32(uint8_t *p, uint32_t v)
+{
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        p[i] = (uint8_t)(v >> (8 * i));
+    }
+}
+
+static inline uint16_t get16(const uint8_t *p)
+{
+    return (uint16_t)p[0] | ((uint16_t)p[1] << 8);
+}
+
+static inline uint32_t get32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline uint8_t bucketOf(uint32_t rttUs)
+{
+    uint32_t ms = rttUs / 1000;
+    uint8_t b = (ms < 2) ? 0 : 31 - __builtin_clz(ms);
+    return (b < ESP_PING_BUCKETS) ? b : ESP_PING_BUCKETS - 1;
+}
+
+void espPingStart(uint64_t selfId)
+{
+    portENTER_CRITICAL(&pingMux);
+    memset(&stats, 0, sizeof(stats));
+    memset(peers, 0, sizeof(peers));
+    peerCount = 0;
+    selfShort = espShortId(selfId);
+    pinger = true;
+    portEXIT_CRITICAL(&pingMux);
+    Serial.printf(">>> espPingStart: pinger %04X, a request every %u ms\r\n", (unsigned)selfShort, ESP_PING_INTERVAL_MS);
+}
+
+bool espPingIsPinger(void)
+{
+    return pinger;
+}
+
+void espPingSend(tEspPacket *txPacket)
+{
+    portENTER_CRITICAL(&pingMux);
+    stats.sent++;
+    portEXIT_CRITICAL(&pingMux);
+    requestArmed = true;
+    sendEspPacket(txPacket);
+}
+
+bool espPingReplyDue(void)
+{
+    return pending.valid;
+}
+
+// The request goes into the pinger's frame, a pong into a responder's
+uint8_t espPingBuildExt(uint8_t *buf, uint8_t bufSize)
+{
+    if (pinger)
+    {
+        if (!requestArmed || (bufSize < 2 + 6))
+        {
+            return 0;
+        }
+        requestArmed = false;
+        buf[0] = ESP_WIRE_EXT_PING;
+        buf[1] = 6;
+        put16(buf + 2, (uint16_t)stats.sent);
+        put32(buf + 4, micros());
+        return 2 + 6;
+    }
+    if (!pending.valid || (bufSize < 2 + 10))
+    {
+        return 0;
+    }
+    tPingPending p;
+    portENTER_CRITICAL(&pendingMux);
+    p = pending;
+    pending.valid = false;
+    portEXIT_CRITICAL(&pendingMux);
+    if (!p.valid || (millis() - p.rxMs > ESP_PING_REPLY_MS))
+    {
+        return 0;
+    }
+    uint32_t hold = (micros() - p.rxUs) / 10;
+    buf[0] = ESP_WIRE_EXT_PONG;
+    buf[1] = 10;
+    put16(buf + 2, p.pingerShort);
+    put16(buf + 4, p.seq);
+    put32(buf + 6, p.stamp);
+    put16(buf + 10, (uint16_t)min(hold, (uint32_t)0xFFFF));
+    return 2 + 10;
+}
+
+// Under pingMux: the device's slot, the stalest one when the table is full
+static tEspPingPeer *peerSlot(uint64_t id)
+{
+    uint8_t stalest = 0;
+    for (uint8_t i = 0; i < peerCount; i++)
+    {
+        if (peers[i].id == id)
+        {
+            return &peers[i];
+        }
+        if ((int32_t)(peers[i].heardMs - peers[stalest].heardMs) < 0)
+        {
+            stalest = i;
+        }
+    }
+    uint8_t slot = (peerCount < ESP_PING_PEERS) ? peerCount++ : stalest;
+    memset(&peers[slot], 0, sizeof(tEspPingPeer));
+    peers[slot].id = id;
+    return &peers[slot];
+}
+
+static void onPong(const tEspPacket &pkt, const uint8_t *value, int rssi)
+{
+    uint32_t rxUs = micros();
+    if (get16(value) != selfShort)
+    {
+        return;
+    }
+    uint16_t seq = get16(value + 2);
+    uint32_t rttUs = rxUs - get32(value + 4);
+    uint32_t holdUs = (uint32_t)get16(value + 8) * 10;
+    portENTER_CRITICAL(&pingMux);
+    // the full request number from its low 16 bits, only the last few are taken
+    uint16_t age = (uint16_t)stats.sent - seq;
+    if ((age >= ESP_PING_STALE_MS / ESP_PING_INTERVAL_MS) || (rttUs > ESP_PING_STALE_MS * 1000UL))
+    {
+        stats.stray++;
+        portEXIT_CRITICAL(&pingMux);
+        return;
+    }
+    uint32_t fullSeq = stats.sent - age;
+    uint32_t now = millis();
+    tEspPingPeer *peer = peerSlot(pkt.deviceID);
+    if (peer->replies == 0)
+    {
+        peer->firstSeq = fullSeq;
+        peer->rttMinUs = rttUs;
+    }
+    peer->role = (uint8_t)pkt.deviceRole;
+    peer->rssi = (int8_t)constrain(rssi, -128, 127);
+    peer->replies++;
+    peer->expected = fullSeq - peer->firstSeq + 1;
+    peer->rttSumUs += rttUs;
+    peer->rttMinUs = min(peer->rttMinUs, rttUs);
+    peer->rttMaxUs = max(peer->rttMaxUs, rttUs);
+    peer->heardMs = now;
+    if (stats.replies == 0)
+    {
+        stats.rttMinUs = rttUs;
+    }
+    stats.replies++;
+    stats.buckets[bucketOf(rttUs)]++;
+    stats.rttSumUs += rttUs;
+    stats.holdSumUs += holdUs;
+    stats.rttMinUs = min(stats.rttMinUs, rttUs);
+    stats.rttMaxUs = max(stats.rttMaxUs, rttUs);
+    portEXIT_CRITICAL(&pingMux);
+}
+
+void espPingOnRx(const tEspPacket &pkt, const tEspWireExt &ext, int rssi)
+{
+    const uint8_t *value;
+    uint8_t valueLen;
+    if (ext.len == 0)
+    {
+        return;
+    }
+    if (pinger)
+    {
+        if (espWireFindExt(ext, ESP_WIRE_EXT_PONG, value, valueLen) && (valueLen == 10))
+        {
+            onPong(pkt, value, rssi);
+        }
+        return;
+    }
+    if (!espWireFindExt(ext, ESP_WIRE_EXT_PING, value, valueLen) || (valueLen != 6))
+    {
+        return;
+    }
+    portENTER_CRITICAL(&pendingMux);
+    pending.pingerShort = espShortId(pkt.deviceID);
+    pending.seq = get16(value);
+    pending.stamp = get32(value + 2);
+    pending.rxUs = micros();
+    pending.rxMs = millis();
+    pending.valid = true;
+    portEXIT_CRITICAL(&pendingMux);
+}
+
+// Upper edge of the bucket that holds the pct-th reply, capped at the max
+static uint32_t percentileUs(const tEspPingStats &st, uint32_t pct)
+{
+    uint32_t want = (st.replies * pct + 99) / 100;
+    uint32_t seen = 0;
+    for (uint8_t b = 0; b < ESP_PING_BUCKETS - 1; b++)
+    {
+        seen += st.buckets[b];
+        if (seen >= want)
+        {
+            return min((uint32_t)(2000UL << b), st.rttMaxUs);
+        }
+    }
+    return st.rttMaxUs;
+}
+
+void espPingGetStats(tEspPingStats &st)
+{
+    uint32_t now = millis();
+    uint64_t expected = 0;
+    uint64_t replies = 0;
+    portENTER_CRITICAL(&pingMux);
+    st = stats;
+    st.peers = peerCount;
+    st.reachable = 0;
+    for (uint8_t i = 0; i < peerCount; i++)
+    {
+        if (now - peers[i].heardMs <= ESP_PING_STALE_MS)
+        {
+            st.reachable++;
+            expected += peers[i].expected;
+            replies += peers[i].replies;
+        }
+    }
+    portEXIT_CRITICAL(&pingMux);
+    st.lossPct = expected ? (uint8_t)((expected - min(replies, expected)) * 100 / expected) : 0;
+    st.p50Us = st.replies ? percentileUs(st, 50) : 0;
+    st.p95Us = st.replies ? percentileUs(st, 95) : 0;
+}
+
+uint8_t espPingPeersCopy(tEspPingPeer *dst, uint8_t maxCount)
+{
+    portENTER_CRITICAL(&pingMux);
+    uint8_t n = min(peerCount, maxCount);
+    memcpy(dst, peers, n * sizeof(tEspPingPeer));
+    portEXIT_CRITICAL(&pingMux);
+    return n;
+}
+
+void espPingPrint(void)
+{
+    if (!pinger)
+    {
+        Serial.println(">>> espPingPrint: not a pinger, this device only answers");
+        return;
+    }
+    tEspPingStats st;
+    espPingGetStats(st);
+    Serial.printf(">>> PING: %u sent, %u replies, %u stray; %u of %u devices reachable, %u%% loss\r\n",
+                  (unsigned)st.sent, (unsigned)st.replies, (unsigned)st.stray, (unsigned)st.reachable,
+                  (unsigned)st.peers, (unsigned)st.lossPct);
+    if (st.replies)
+    {
+        Serial.printf("rtt us: min %u, avg %u, p50 %u, p95 %u, max %u; responder hold avg %u\r\n",
+                      (unsigned)st.rttMinUs, (unsigned)(st.rttSumUs / st.replies), (unsigned)st.p50Us,
+                      (unsigned)st.p95Us, (unsigned)st.rttMaxUs, (unsigned)(st.holdSumUs / st.replies));
+    }
+    Serial.print("hist ms:");
+    for (uint8_t b = 0; b < ESP_PING_BUCKETS; b++)
+    {
+        Serial.printf(" %s%u:%u", (b < ESP_PING_BUCKETS - 1) ? "<" : ">=", (unsigned)(2U << ((b < ESP_PING_BUCKETS - 1) ? b : b - 1)),
+                      (unsigned)st.buckets[b]);
+    }
+    Serial.println();
+    tEspPingPeer list[ESP_PING_PEERS];
+    uint8_t n = espPingPeersCopy(list, ESP_PING_PEERS);
+    uint32_t now = millis();
+    Serial.printf("%-14s %4s %5s %8s %6s %8s %8s %8s %7s\r\n", "device", "role", "rssi", "replies", "loss", "min us",
+                  "avg us", "max us", "age ms");
+    for (uint8_t i = 0; i < n; i++)
+    {
+        const tEspPingPeer &p = list[i];
+        Serial.printf("%014llX %4u %5d %8u %5u%% %8u %8u %8u %7u\r\n", (unsigned long long)p.id, (unsigned)p.role,
+                      (int)p.rssi, (unsigned)p.replies,
+                      (unsigned)(p.expected ? (p.expected - min(p.replies, p.expected)) * 100 / p.expected : 0),
+                      (unsigned)p.rttMinUs, (unsigned)(p.replies ? p.rttSumUs / p.replies : 0), (unsigned)p.rttMaxUs,
+                      (unsigned)(now - p.heardMs));
+    }
+}
+
+void espPingWriteJson(tJsonWriter &json)
+{
+    tEspPingStats st;
+    espPingGetStats(st);
+    json.beginObject("ping");
+    json.field("sent", st.sent);
+    json.field("replies", st.replies);
+    json.field("reachable", (unsigned int)st.reachable);
+    json.field("peers", (unsigned int)st.peers);
+    json.field("loss_pct", (unsigned int)st.lossPct);
+    json.field("rtt_min_us", st.rttMinUs);
+    json.field("rtt_avg_us", (unsigned long)(st.replies ? st.rttSumUs / st.replies : 0));
+    json.field("rtt_p50_us", st.p50Us);
+    json.field("rtt_p95_us", st.p95Us);
+    json.field("rtt_max_us", st.rttMaxUs);
+    json.beginArray("hist");
+    for (uint8_t b = 0; b < ESP_PING_BUCKETS; b++)
+    {
+        json.value(st.buckets[b]);
+    }
+    json.endArray();
+    json.endObject();
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "espPacket.h"
+#include "espWire.h"
+#include "jsonWriter.h"
+
+// Radio probe of the venue. A pinger (the "fixPinger" device role) sends a
+// sequenced echo request every ESP_PING_INTERVAL_MS, stamped with its micros()
+// as the frame is built; every device whose radio runs answers it from its
+// radio task as soon as the request woke it, with the stamp and the time it
+// held the request. The pinger keeps the RTT histogram, the loss per device
+// from the sequence numbers, and how many devices answered lately.
+//
+// A pong goes out as an extra beacon, outside the TDMA slot of the device;
+// it is a diagnostic, not meant to run while a game plays.
+
+#define ESP_WIRE_EXT_PING       9       // uint16 seq, uint32 pinger's micros() at encode time
+#define ESP_WIRE_EXT_PONG       10      // uint16 pinger short ID, uint16 seq, uint32 stamp, uint16 hold in 10 us
+#define ESP_PING_INTERVAL_MS    100
+#define ESP_PING_PEERS          32      // devices the pinger keeps apart
+#define ESP_PING_STALE_MS       3000    // a device not heard this long is not reachable
+#define ESP_PING_REPLY_MS       50      // a request not answered this soon is dropped
+#define ESP_PING_BUCKETS        8       // RTT upper bounds 2, 4, ... 128 ms and the rest
+
+struct tEspPingPeer
+{
+    uint64_t id;
+    uint8_t  role;              // tGameRole
+    int8_t   rssi;              // of the last pong
+    uint32_t firstSeq;          // the first request it answered, of tEspPingStats.sent
+    uint32_t replies;
+    uint32_t expected;          // requests sent since firstSeq, at the last pong
+    uint32_t rttMinUs;
+    uint32_t rttMaxUs;
+    uint64_t rttSumUs;
+    uint32_t heardMs;
+};
+
+struct tEspPingStats
+{
+    uint32_t sent;
+    uint32_t replies;
+    uint32_t stray;             // pongs to an old or unknown request
+    uint32_t buckets[ESP_PING_BUCKETS];
+    uint32_t rttMinUs;
+    uint32_t rttMaxUs;
+    uint64_t rttSumUs;
+    uint64_t holdSumUs;         // the responders' part of it
+    uint8_t  peers;             // devices in the table
+    uint8_t  reachable;         // heard within ESP_PING_STALE_MS
+    uint8_t  lossPct;           // of the reachable devices' requests
+    uint32_t p50Us;             // bucket bounds
+    uint32_t p95Us;
+};
+
+// Pinger side: the requests go into the frames sent after this
+void espPingStart(uint64_t selfId);
+bool espPingIsPinger(void);
+void espPingSend(tEspPacket *txPacket);     // one request, the pinger task
+void espPingGetStats(tEspPingStats &st);
+uint8_t espPingPeersCopy(tEspPingPeer *dst, uint8_t maxCount);
+void espPingPrint(void);
+void espPingWriteJson(tJsonWriter &json);   // "ping":{...} member of an open object
+
+// Responder side
+bool espPingReplyDue(void);                 // radio task: a request waits for its pong
+
+uint8_t espPingBuildExt(uint8_t *buf, uint8_t bufSize);
+void    espPingOnRx(const tEspPacket &pkt, const tEspWireExt &ext, int rssi);     // WiFi task
@@ -0,0 +1,426 @@
+#include "espProv.h"
+#include "espRadio.h"
+#include "espNeighbors.h"
+#include "taskRegistry.h"
+
+#include <Preferences.h>
+#include <mbedtls/md.h>
+
+static const char       provKey[] = ESP_PROV_KEY;
+static tEspProvApply    applyFn = NULL;
+static TaskHandle_t     provHandle = NULL;
+static tEspPacket       provPacket;         // the device's ACK frames and the operator's chunks
+static uint16_t         selfShort = 0;
+static portMUX_TYPE     provMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Device side: the blob being put together, written by the WiFi task until
+// rxDone hands it to the provisioning task
+static uint8_t          rxBuf[ESP_PROV_MAX];
+static uint32_t         rxVersion = 0;
+static uint16_t         rxTotal = 0;
+static uint16_t         rxOp = 0;
+static uint32_t         rxBits = 0;         // chunks in, one bit each
+static volatile bool    rxDone = false;
+static uint32_t         appliedVersion = 0;
+static uint32_t         lastVersion = 0;    // the last verdict and its version
+static uint8_t          lastStatus = psApplied;
+
+// The ACK the next frames carry
+static uint16_t         ackOp = 0;
+static uint32_t         ackVersion = 0;
+static uint8_t          ackStatus = psApplied;
+static volatile uint8_t ackLeft = 0;
+static uint32_t         ackLastMs = 0;
+static bool             rebootDue = false;
+
+// Operator side
+static uint8_t          txBuf[ESP_PROV_MAX];
+static uint32_t         txVersion = 0;
+static uint16_t         txTotal = 0;
+static uint16_t         txOffset = 0;
+static volatile bool    txArmed = false;
+static volatile bool    opListening = false;
+static uint32_t         heardApplied = 0;   // the newest version a device said it has
+static tEspProvAck      acks[ESP_PROV_ACKS_MAX];
+static uint8_t          ackCount = 0;
+
+static inline void put16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void put32(uint8_t *p, uint32_t v)
+{
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        p[i] = (uint8_t)(v >> (8 * i));
+    }
+}
+
+static inline uint16_t get16(const uint8_t *p)
+{
+    return (uint16_t)p[0] | ((uint16_t)p[1] << 8);
+}
+
+static inline uint32_t get32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline uint32_t chunkMask(uint16_t total)
+{
+    uint16_t chunks = (total + ESP_PROV_CHUNK - 1) / ESP_PROV_CHUNK;
+    return (chunks >= 32) ? 0xFFFFFFFF : ((1UL << chunks) - 1);
+}
+
+static void provHmac(uint32_t version, const uint8_t *json, size_t len, uint8_t *out)
+{
+    uint8_t v[4];
+    put32(v, version);
+    mbedtls_md_context_t ctx;
+    mbedtls_md_init(&ctx);
+    mbedtls_md_setup(&ctx, mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), 1);
+    mbedtls_md_hmac_starts(&ctx, (const uint8_t *)provKey, strlen(provKey));
+    mbedtls_md_hmac_update(&ctx, v, sizeof(v));
+    mbedtls_md_hmac_update(&ctx, json, len);
+    mbedtls_md_hmac_finish(&ctx, out);
+    mbedtls_md_free(&ctx);
+}
+
+static bool provVerify(uint32_t version, const uint8_t *blob, uint16_t total)
+{
+    uint8_t mac[ESP_PROV_HMAC_LEN];
+    uint16_t jsonLen = total - ESP_PROV_HMAC_LEN;
+    provHmac(version, blob, jsonLen, mac);
+    uint8_t diff = 0;
+    for (uint8_t i = 0; i < ESP_PROV_HMAC_LEN; i++)
+    {
+        diff |= mac[i] ^ blob[jsonLen + i];
+    }
+    return diff == 0;
+}
+
+static uint32_t prefsGet(const char *key)
+{
+    Preferences prefs;
+    if (!prefs.begin(ESP_PROV_NS, true))
+    {
+        return 0;
+    }
+    uint32_t v = prefs.getUInt(key, 0);
+    prefs.end();
+    return v;
+}
+
+static void prefsPut(const char *key, uint32_t v)
+{
+    Preferences prefs;
+    prefs.begin(ESP_PROV_NS);
+    prefs.putUInt(key, v);
+    prefs.end();
+}
+
+// Under provMux
+static void ackRequest(uint16_t op, uint32_t version, uint8_t status)
+{
+    ackOp = op;
+    ackVersion = version;
+    ackStatus = status;
+    ackLeft = ESP_PROV_ACK_FRAMES;
+    ackLastMs = millis();
+}
+
+static void provTask(void *pvParameters)
+{
+    Serial.println(">>> provTask: STARTED");
+    while (true)
+    {
+        ulTaskNotifyTake(pdTRUE, ackLeft ? pdMS_TO_TICKS(ESP_PROV_ACK_JITTER_MS) : portMAX_DELAY);
+        if (rxDone)
+        {
+            uint16_t jsonLen = rxTotal - ESP_PROV_HMAC_LEN;
+            uint8_t status = psSignature;
+            if (provVerify(rxVersion, rxBuf, rxTotal))
+            {
+                status = applyFn((const char *)rxBuf, jsonLen) ? psApplied : psRejected;
+            }
+            Serial.printf(">>> provTask: config version %lu from %04X, %u bytes: %s\r\n", (unsigned long)rxVersion,
+                          (unsigned)rxOp, (unsigned)jsonLen, espProvStatusStr(status));
+            if (status == psApplied)
+            {
+                appliedVersion = rxVersion;
+                prefsPut("ver", appliedVersion);
+                rebootDue = true;
+            }
+            portENTER_CRITICAL(&provMux);
+            lastVersion = rxVersion;
+            lastStatus = status;
+            ackRequest(rxOp, rxVersion, status);
+            rxDone = false;
+            portEXIT_CRITICAL(&provMux);
+        }
+        while (ackLeft)
+        {
+            // the radio task's beacons may carry some of them first
+            delay(selfShort % ESP_PROV_ACK_JITTER_MS + 1);
+            sendEspPacket(&provPacket);
+        }
+        if (rebootDue)
+        {
+            Serial.println(">>> provTask: new config, restarting");
+            delay(ESP_PROV_REBOOT_MS);
+            ESP.restart();
+        }
+    }
+}
+
+void espProvStart(tEspProvApply apply)
+{
+    if (provHandle != NULL)
+    {
+        return;
+    }
+    if (provKey[0] == 0)
+    {
+        Serial.println("*** espProvStart WARNING! No ESP_PROV_KEY in this build, fleet provisioning is off");
+        return;
+    }
+    applyFn = apply;
+    selfShort = espShortId(provPacket.deviceID);
+    appliedVersion = prefsGet("ver");
+    lastVersion = appliedVersion;
+    startReceiver();
+    taskStart(tkProv, provTask, NULL, &provHandle);
+    Serial.printf(">>> espProvStart: config version %lu\r\n", (unsigned long)appliedVersion);
+}
+
+uint32_t espProvVersion(void)
+{
+    return appliedVersion;
+}
+
+uint8_t espProvBuildExt(uint8_t *buf, uint8_t bufSize)
+{
+    uint8_t len = 0;
+    if (txArmed)
+    {
+        uint16_t n = min((uint16_t)ESP_PROV_CHUNK, (uint16_t)(txTotal - txOffset));
+        if (bufSize < 2 + 8 + n)
+        {
+            return 0;
+        }
+        buf[0] = ESP_WIRE_EXT_PROV;
+        buf[1] = 8 + n;
+        put32(buf + 2, txVersion);
+        put16(buf + 6, txTotal);
+        put16(buf + 8, txOffset);
+        memcpy(buf + 10, txBuf + txOffset, n);
+        txArmed = false;
+        return 2 + 8 + n;
+    }
+    if (ackLeft && (bufSize >= 2 + 11))
+    {
+        portENTER_CRITICAL(&provMux);
+        buf[0] = ESP_WIRE_EXT_PROV_ACK;
+        buf[1] = 11;
+        put16(buf + 2, ackOp);
+        put32(buf + 4, ackVersion);
+        buf[8] = ackStatus;
+        put32(buf + 9, appliedVersion);
+        if (ackLeft)
+        {
+            ackLeft--;
+        }
+        portEXIT_CRITICAL(&provMux);
+        len = 2 + 11;
+    }
+    return len;
+}
+
+static void onAck(const tEspPacket &pkt, const uint8_t *value)
+{
+    if (!opListening || (get16(value) != selfShort))
+    {
+        return;
+    }
+    uint32_t version = get32(value + 2);
+    uint32_t applied = get32(value + 7);
+    portENTER_CRITICAL(&provMux);
+    heardApplied = max(heardApplied, applied);
+    if (version == txVersion)
+    {
+        uint8_t i = 0;
+        while ((i < ackCount) && (acks[i].id != pkt.deviceID))
+        {
+            i++;
+        }
+        if ((i == ackCount) && (ackCount < ESP_PROV_ACKS_MAX))
+        {
+            ackCount++;
+        }
+        if (i < ackCount)
+        {
+            acks[i].id = pkt.deviceID;
+            acks[i].status = value[6];
+            acks[i].applied = applied;
+            acks[i].heardMs = millis();
+        }
+    }
+    portEXIT_CRITICAL(&provMux);
+}
+
+static void onChunk(const tEspPacket &pkt, const uint8_t *value, uint8_t valueLen)
+{
+    uint32_t version = get32(value);
+    uint16_t total = get16(value + 4);
+    uint16_t offset = get16(value + 6);
+    uint8_t n = valueLen - 8;
+    if ((provHandle == NULL) || (total <= ESP_PROV_HMAC_LEN) || (total > ESP_PROV_MAX) ||
+        (offset % ESP_PROV_CHUNK) || (n != min((uint16_t)ESP_PROV_CHUNK, (uint16_t)(total - offset))))
+    {
+        return;
+    }
+    uint16_t op = espShortId(pkt.deviceID);
+    bool wake = false;
+    portENTER_CRITICAL(&provMux);
+    if ((version <= appliedVersion) || (version == lastVersion))
+    {
+        // decided already: the operator hears it again, now and then
+        if (millis() - ackLastMs >= ESP_PROV_ACK_MIN_MS)
+        {
+            uint8_t status = (version == lastVersion) ? lastStatus : psStale;
+            ackRequest(op, version, status);
+            wake = true;
+        }
+    }
+    else if (!rxDone)
+    {
+        if ((version != rxVersion) || (total != rxTotal))
+        {
+            rxVersion = version;
+            rxTotal = total;
+            rxBits = 0;
+        }
+        rxOp = op;
+        memcpy(rxBuf + offset, value + 8, n);
+        rxBits |= 1UL << (offset / ESP_PROV_CHUNK);
+        if (rxBits == chunkMask(total))
+        {
+            rxDone = true;
+            wake = true;
+        }
+    }
+    portEXIT_CRITICAL(&provMux);
+    if (wake)
+    {
+        xTaskNotifyGive(provHandle);
+    }
+}
+
+void espProvOnRx(const tEspPacket &pkt, const tEspWireExt &ext)
+{
+    const uint8_t *value;
+    uint8_t valueLen;
+    if (ext.len == 0)
+    {
+        return;
+    }
+    if (espWireFindExt(ext, ESP_WIRE_EXT_PROV_ACK, value, valueLen) && (valueLen == 11))
+    {
+        onAck(pkt, value);
+    }
+    if (espWireFindExt(ext, ESP_WIRE_EXT_PROV, value, valueLen) && (valueLen > 8))
+    {
+        onChunk(pkt, value, valueLen);
+    }
+}
+
+bool espProvSend(const char *json, size_t len, uint32_t version)
+{
+    if (provKey[0] == 0)
+    {
+        Serial.println("!!! espProvSend ERROR: no ESP_PROV_KEY in this build");
+        return false;
+    }
+    if ((len == 0) || (len + ESP_PROV_HMAC_LEN > ESP_PROV_MAX))
+    {
+        Serial.printf("!!! espProvSend ERROR: %u bytes, %u at most\r\n", (unsigned)len, ESP_PROV_MAX - ESP_PROV_HMAC_LEN);
+        return false;
+    }
+    selfShort = espShortId(provPacket.deviceID);
+    if (version == 0)
+    {
+        version = max(prefsGet("op"), max(heardApplied, appliedVersion)) + 1;
+    }
+    prefsPut("op", version);
+    memcpy(txBuf, json, len);
+    provHmac(version, txBuf, len, txBuf + len);
+    portENTER_CRITICAL(&provMux);
+    txVersion = version;
+    txTotal = len + ESP_PROV_HMAC_LEN;
+    ackCount = 0;
+    portEXIT_CRITICAL(&provMux);
+    startReceiver();
+    opListening = true;
+    Serial.printf(">>> espProvSend: version %lu, %u bytes in %u chunks, %u rounds\r\n", (unsigned long)version,
+                  (unsigned)txTotal, (unsigned)((txTotal + ESP_PROV_CHUNK - 1) / ESP_PROV_CHUNK), ESP_PROV_ROUNDS);
+    for (uint8_t round = 0; round < ESP_PROV_ROUNDS; round++)
+    {
+        for (uint16_t offset = 0; offset < txTotal; offset += ESP_PROV_CHUNK)
+        {
+            txOffset = offset;
+            txArmed = true;
+            sendEspPacket(&provPacket);
+            txArmed = false;
+            delay(ESP_PROV_GAP_MS);
+        }
+    }
+    delay(ESP_PROV_ACK_WAIT_MS);
+    opListening = false;
+    espProvPrint();
+    return true;
+}
+
+uint8_t espProvAcksCopy(tEspProvAck *dst, uint8_t maxCount)
+{
+    portENTER_CRITICAL(&provMux);
+    uint8_t n = min(ackCount, maxCount);
+    memcpy(dst, acks, n * sizeof(tEspProvAck));
+    portEXIT_CRITICAL(&provMux);
+    return n;
+}
+
+const char *espProvStatusStr(uint8_t status)
+{
+    switch (status)
+    {
+        case psApplied:     return "applied";
+        case psSignature:   return "bad signature";
+        case psRejected:    return "rejected";
+        case psStale:       return "stale";
+        default:            return "pending";
+    }
+}
+
+void espProvPrint(void)
+{
+    Serial.printf(">>> PROV: %s, applied version %lu, last sent %lu\r\n", provKey[0] ? "keyed" : "no key",
+                  (unsigned long)appliedVersion, (unsigned long)txVersion);
+    tEspProvAck list[ESP_PROV_ACKS_MAX];
+    uint8_t n = espProvAcksCopy(list, ESP_PROV_ACKS_MAX);
+    uint8_t applied = 0;
+    uint32_t now = millis();
+    for (uint8_t i = 0; i < n; i++)
+    {
+        applied += (list[i].status == psApplied) ? 1 : 0;
+        Serial.printf("%014llX %-14s has %lu, %lu ms ago\r\n", (unsigned long long)list[i].id,
+                      espProvStatusStr(list[i].status), (unsigned long)list[i].applied,
+                      (unsigned long)(now - list[i].heardMs));
+    }
+    if (txVersion)
+    {
+        Serial.printf("%u devices answered, %u applied version %lu\r\n", (unsigned)n, (unsigned)applied,
+                      (unsigned long)txVersion);
+    }
+}
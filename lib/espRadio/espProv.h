@@ -0,0 +1,71 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "espPacket.h"
+#include "espWire.h"
+
+// Fleet provisioning over ESP-NOW. An operator device ("prov send") signs a
+// config blob, the shared part of nconf.json (wifi_networks, servers, arena),
+// with HMAC-SHA256 over the version and the JSON under the fleet key, and
+// broadcasts it in chunks a few rounds over. Every device reassembles it in
+// the WiFi task, checks the signature and the version in a low priority
+// task, hands the JSON to the apply handler (ConfigAPI::applyFleetConfig)
+// and answers with an ACK in its next frames; an applied config takes effect
+// on the reboot that follows.
+//
+// The version is monotonic per fleet: a device keeps the last one it applied
+// and takes nothing older, so a recorded broadcast cannot be replayed.
+
+#define ESP_WIRE_EXT_PROV       11      // uint32 version, uint16 total, uint16 offset, the blob's bytes
+#define ESP_WIRE_EXT_PROV_ACK   12      // uint16 operator short ID, uint32 version, uint8 tEspProvStatus, uint32 applied version
+#define ESP_PROV_MAX            2048    // JSON and the HMAC
+#define ESP_PROV_CHUNK          96      // blob bytes per frame
+#define ESP_PROV_HMAC_LEN       32
+#define ESP_PROV_ROUNDS         5       // the operator sends the whole blob this often
+#define ESP_PROV_GAP_MS         8       // between two chunk frames
+#define ESP_PROV_ACK_WAIT_MS    3000    // the operator listens this long after the last round
+#define ESP_PROV_ACK_FRAMES     3
+#define ESP_PROV_ACK_MIN_MS     1000    // between two ACKs to an old version's chunks
+#define ESP_PROV_ACK_JITTER_MS  40      // by short ID, the fleet does not answer in one burst
+#define ESP_PROV_REBOOT_MS      1500    // after an applied config, the ACKs go out first
+#define ESP_PROV_ACKS_MAX       64      // devices the operator lists
+#define ESP_PROV_FILE           "/prov.json"
+#define ESP_PROV_NS             "prov"
+#ifndef ESP_PROV_KEY
+#define ESP_PROV_KEY            ""      // fleet key, -D ESP_PROV_KEY=\"...\"; empty turns provisioning off
+#endif
+
+enum tEspProvStatus
+{
+    psApplied   = 0,
+    psSignature = 1,        // bad HMAC
+    psRejected  = 2,        // the apply handler refused the JSON
+    psStale     = 3,        // older than the applied version
+    psPending   = 0xFF      // operator table: no answer yet
+};
+
+struct tEspProvAck
+{
+    uint64_t id;
+    uint8_t  status;        // tEspProvStatus
+    uint32_t applied;       // the device's applied version
+    uint32_t heardMs;
+};
+
+// Runs in the provisioning task; true once the config is stored
+typedef bool (*tEspProvApply)(const char *json, size_t len);
+
+// Device side: the receiver and the task, once the radio is up; idempotent
+void espProvStart(tEspProvApply apply);
+uint32_t espProvVersion(void);          // the applied version, 0 for none
+
+// Operator side, blocks for the rounds and the ACK wait; version 0 takes
+// the next one after what the operator and the devices it heard have seen
+bool espProvSend(const char *json, size_t len, uint32_t version = 0);
+uint8_t espProvAcksCopy(tEspProvAck *dst, uint8_t maxCount);
+const char *espProvStatusStr(uint8_t status);
+void espProvPrint(void);
+
+uint8_t espProvBuildExt(uint8_t *buf, uint8_t bufSize);
+void    espProvOnRx(const tEspPacket &pkt, const tEspWireExt &ext);        // WiFi task
@@ -5,24 +5,78 @@
 #include "espRadio.h"
 #include "espRx.h"
 #include "espScanRecords.h"
+#include "espWire.h"
+#include "espStats.h"
+#include "espTimecode.h"
+#include "espGateway.h"
+#include "espNeighbors.h"
+#include "loopProfile.h"
+#include "espHitStamp.h"
+#include "espPing.h"
+#include "espRxStream.h"
+#include "espProv.h"
+#include "espTxPower.h"
+#include "energyProfile.h"
+#include "pmLocks.h"
 
 uint8_t broadcastAddress[] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
 
 
-QueueHandle_t radioQ;
 
 static uint16_t deviceNum;
-static tEspPacket rxPacket; 
 static tEspPacket *txPacket = NULL; 
 RTC_DATA_ATTR int espPacketID = 0;
 static bool wasRadioInit = false;
 static bool receiverWasStarted = false;
 extern uint8_t wifiChannel;
 
+// The station's channel is the AP's; forcing another one makes the radio hop
+// between the two, so ESP-NOW follows the AP while associated
+static volatile bool chanCheckDue = true;
+static uint32_t chanCheckMs = 0;
+static uint8_t apChannel = 0;
+static uint8_t apBssid[6];
+static bool apKnown = false;
+
+static void onStaConnected(WiFiEvent_t event, WiFiEventInfo_t info)
+{
+    chanCheckDue = true;
+}
+
+static void moveEspNow(uint8_t channel)
+{
+    wifiChannel = channel;
+    if (wasRadioInit)
+    {
+        esp_now_peer_info_t peerInfo;
+        if (esp_now_get_peer(broadcastAddress, &peerInfo) == ESP_OK)
+        {
+            peerInfo.channel = wifiChannel;
+            esp_now_mod_peer(&peerInfo);
+        }
+    }
+}
+
+static void setHomeChannel(void)
+{
+    wifi_ap_record_t ap;
+    if (esp_wifi_sta_get_ap_info(&ap) == ESP_OK)
+    {
+        wifiChannel = ap.primary;
+        return;
+    }
+    esp_wifi_set_channel(wifiChannel, WIFI_SECOND_CHAN_NONE);
+}
+
 /////////////////
 void prepareWiFi(void)
 {
-    esp_wifi_set_channel(wifiChannel, WIFI_SECOND_CHAN_NONE);
+    static bool eventSet = false;
+    if (!eventSet)
+    {
+        WiFi.onEvent(onStaConnected, ARDUINO_EVENT_WIFI_STA_CONNECTED);
+        eventSet = true;
+    }
     WiFi.mode(WIFI_AP_STA);
     WiFi.setTxPower(WIFI_POWER_19_5dBm);
     //esp_wifi_set_mode(ESPNOW_WIFI_MODE);
@@ -41,7 +95,9 @@ void prepareWiFi(void)
     {
         Serial.printf("esp_wifi_set_max_tx_power(%d) ERROR!!!\r\n", WIFI_TX_POWER);
     }
-    esp_wifi_set_channel(wifiChannel, WIFI_SECOND_CHAN_NONE);
+    setHomeChannel();
+    espStatsOnChannel(ceSet, wifiChannel, apChannel);
+    energyProfLevel(esRadio, 255);
 }
 
 bool initRadio(void)
@@ -116,9 +172,99 @@ bool initRadio(void)
     return false;
 }
 /////////////////
+// Moves ESP-NOW to another channel for the current game session. While the
+// station is associated the channel is owned by the access point, a session
+// channel the AP is not on is refused and ESP-NOW stays on the AP's.
+bool espSetChannel(uint8_t channel)
+{
+    if ((channel == 0) || (channel == wifiChannel))
+    {
+        return true;
+    }
+    if (apChannel != 0)
+    {
+        Serial.printf("*** espSetChannel WARNING! session channel %d, the AP is on %d\r\n", channel, apChannel);
+        espStatsOnChannel(ceRefused, wifiChannel, apChannel);
+        return false;
+    }
+    if (esp_wifi_set_channel(channel, WIFI_SECOND_CHAN_NONE) != ESP_OK)
+    {
+        Serial.printf("!!! espSetChannel ERROR: can not switch to channel %d (staying on %d)\r\n", channel, wifiChannel);
+        return false;
+    }
+    moveEspNow(channel);
+    Serial.printf(">>> espSetChannel: %d\r\n", wifiChannel);
+    return true;
+}
+
+// After an association, and every ESP_CHANNEL_CHECK_MS for an AP that
+// changed its channel or a roam the event was missed for
+void espChannelService(void)
+{
+    uint32_t now = millis();
+    if (!chanCheckDue && (now - chanCheckMs < ESP_CHANNEL_CHECK_MS))
+    {
+        return;
+    }
+    chanCheckDue = false;
+    chanCheckMs = now;
+    wifi_ap_record_t ap;
+    if (esp_wifi_sta_get_ap_info(&ap) != ESP_OK)
+    {
+        // not associated, the channel stays where the neighbours are
+        apChannel = 0;
+        return;
+    }
+    apChannel = ap.primary;
+    bool roamed = apKnown && memcmp(ap.bssid, apBssid, sizeof(apBssid));
+    memcpy(apBssid, ap.bssid, sizeof(apBssid));
+    apKnown = true;
+    if (roamed)
+    {
+        Serial.printf(">>> espChannelService: roamed to %02X:%02X:%02X:%02X:%02X:%02X, channel %d\r\n",
+                      ap.bssid[0], ap.bssid[1], ap.bssid[2], ap.bssid[3], ap.bssid[4], ap.bssid[5], apChannel);
+        espStatsOnChannel(ceRoam, wifiChannel, apChannel);
+    }
+    if (apChannel != wifiChannel)
+    {
+        Serial.printf(">>> espChannelService: ESP-NOW %d -> %d, the AP's\r\n", wifiChannel, apChannel);
+        moveEspNow(apChannel);
+        espStatsOnChannel(ceAlign, wifiChannel, apChannel);
+    }
+}
+
+uint8_t espApChannel(void)
+{
+    return apChannel;
+}
+
+uint8_t espChannel(void)
+{
+    return wifiChannel;
+}
+/////////////////
 bool sendEspPacket(tEspPacket *rData)
 {    
     rData->packetID++;
+    rData->espProtocolID = espGetProtocolId();
+#if ESP_WIRE_TX_VERSION >= 2
+    uint8_t wireBuf[ESP_WIRE_MAX_LEN];
+    uint8_t ext[ESP_WIRE_MAX_EXT];
+    uint8_t extLen = espTxPowerBuildExt(ext, sizeof(ext));
+    extLen += espTimecodeBuildExt(ext + extLen, sizeof(ext) - extLen);
+    extLen += espProvBuildExt(ext + extLen, sizeof(ext) - extLen);
+    extLen += espPingBuildExt(ext + extLen, sizeof(ext) - extLen);
+    extLen += espHitStampBuildExt(ext + extLen, sizeof(ext) - extLen);
+    extLen += espGatewayBuildExt(rData->deviceID, ext + extLen, sizeof(ext) - extLen);
+    extLen += espRelayBuildExt(ext + extLen, sizeof(ext) - extLen);
+    extLen += espNeighborsBuildExt(ext + extLen, sizeof(ext) - extLen);
+    uint16_t wireLen = espWireEncode(rData, wireBuf, sizeof(wireBuf), ext, extLen);
+    if (wireLen)
+    {
+        return sendEspRawPacket(wireBuf, wireLen);
+    }
+#endif
+    espPacketSetCrc(rData);
     return sendEspRawPacket(rData, sizeof(tEspPacket));
 }
 /////////////////
@@ -133,28 +279,96 @@ bool sendEspRawPacket(void *dataBuf, uint16_t bSize)
     }
 
     esp_err_t result = esp_now_send(broadcastAddress, (uint8_t*) dataBuf, bSize);
+    energyProfEvent(esRadio);
 
     return (result == ESP_OK);
 }
 /////////////////
+// Bases, portals and servers, and whatever carries a show start or the
+// arbiter's totals: these skip the coalescing and take the priority lane
+static bool rxPriority(const tEspPacket &rec, const tEspWireExt &ext)
+{
+    if ((rec.deviceRole == grBase) || (rec.deviceRole == grApPortalBeacon) || (rec.deviceRole == grServer))
+    {
+        return true;
+    }
+    const uint8_t *value;
+    uint8_t valueLen;
+    return (ext.len != 0) && (espWireFindExt(ext, ESP_WIRE_EXT_SHOW, value, valueLen) ||
+                              espWireFindExt(ext, ESP_WIRE_EXT_ARBITER, value, valueLen));
+}
+
 void OnDataRecv(const uint8_t *mac, const uint8_t *incomingData, int len)
 {
     tPacketRecord dRecord;    
-    memcpy(&dRecord.rec, incomingData, sizeof(tEspPacket));    
-    dRecord.rssi = getRssi();    
-    dRecord.ms = millis();
-    xQueueSend(radioQ, &dRecord, 1000);
+    tEspWireExt ext;
+    uint32_t rxMs = millis();
+    uint32_t rxUs = micros();
+    if (len == sizeof(tEspPacket))
+    {
+        // legacy (v1) frame, foreign games are dropped here before queueing
+        memcpy(&dRecord.rec, incomingData, sizeof(tEspPacket));    
+        if (dRecord.rec.espProtocolID != espGetProtocolId())
+        {
+            espStatsOnReject(rejProtocol);
+            return;
+        }
+        if (!espPacketCheckCrc(&dRecord.rec))
+        {
+            espStatsOnReject(rejCrc);
+            return;
+        }
+    }
+    else
+    {
+        // wrong length, foreign protocol or bad CRC: never reaches the ring
+        tEspRejectReason reason;
+        if (!espWireDecode(incomingData, len, &dRecord.rec, &ext, &reason))
+        {
+            espStatsOnReject(reason);
+            return;
+        }
+        // the extension area points into incomingData, only valid in here
+        espTimecodeOnRx(ext, rxMs);
+        if (txPacket != NULL)
+        {
+            espHitStampOnRx(dRecord.rec, ext, txPacket->deviceRole);
+        }
+    }
+    if (!getRssiForMac(mac, dRecord.rssi))
+    {
+        dRecord.rssi = getRssi();
+    }
+    dRecord.rssi = espTxPowerNormalize(ext, dRecord.rssi);
+    dRecord.ms = rxMs;
+    espTxPowerOnRx(dRecord.rec, dRecord.rssi);
+    espPingOnRx(dRecord.rec, ext, dRecord.rssi);
+    espProvOnRx(dRecord.rec, ext);
+    espRxStreamOnRx(dRecord.rec, dRecord.rssi, rxUs);
+    espGatewayOnRx(dRecord.rec, ext, dRecord.rssi);
+    espRelayOnRx(ext);
+    espNeighborsOnRx(dRecord.rec, ext, dRecord.rssi);
+    espStatsOnRx(dRecord.rec.deviceID, (uint16_t)dRecord.rec.packetID, dRecord.ms, dRecord.rssi);
+    bool priority = rxPriority(dRecord.rec, ext);
+#if ENOW_RX_COALESCE
+    if (!priority && rxCoalescePush(&dRecord))
+    {
+        return;
+    }
+#endif
+    rxRingPush(&dRecord, priority);
 }
 /////////////////
 bool startReceiver(void)
 {
     if (receiverWasStarted)
         return true;
-    radioQ = xQueueCreate(ENOW_Q_LEN, sizeof(tPacketRecord));
+    rxRingInit();
 
     if (esp_now_register_recv_cb(OnDataRecv) == ESP_OK)
     {
         Serial.println("ESP receiver started");
+        receiverWasStarted = true;
         return true;
     }
     else
@@ -177,12 +391,10 @@ bool receivePacket(tEspPacket *rData, int &rssi, unsigned long &ms)
     {
         return false;
     }
-    BaseType_t res = xQueueReceive(radioQ, &dRecord, 1);
-
-    if (res == pdTRUE)
+    if (rxRingPop(&dRecord, 1, 1) == 1)
     {
         memcpy(rData, &dRecord.rec, sizeof(tEspPacket));
-        if (rData->espProtocolID == ESP_PROTOCOL_ID)
+        if (rData->espProtocolID == espGetProtocolId())
         {
             rssi = dRecord.rssi;
             ms   = dRecord.ms;
@@ -193,6 +405,39 @@ bool receivePacket(tEspPacket *rData, int &rssi, unsigned long &ms)
     return false;
 }
 /////////////////
+// Waits up to waitTicks for the ring to get data, then drains whatever is
+// already there without waiting. Returns the number of valid packets.
+int receivePacketBatch(tPacketRecord *batch, int maxCount, TickType_t waitTicks)
+{
+    if (!receiverWasStarted)
+    {
+        wasRadioInit = initRadio();
+        if (!wasRadioInit)
+        {
+            return 0;
+        }
+        if (!startReceiver())
+        {
+            return 0;
+        }
+    }
+
+    int count = rxRingPop(batch, maxCount, waitTicks);
+    int valid = 0;
+    for (int i = 0; i < count; i++)
+    {
+        if (batch[i].rec.espProtocolID == espGetProtocolId())
+        {
+            if (valid != i)
+            {
+                batch[valid] = batch[i];
+            }
+            valid++;
+        }
+    }
+    return valid;
+}
+/////////////////
 void testSender(uint16_t devID, uint16_t intMs)
 {
     // uint32_t packCount = 0;
@@ -215,9 +460,74 @@ void testSender(uint16_t devID, uint16_t intMs)
     // }
 }
 /////////////////
-void  espInitRxTx(tEspPacket *txPack, bool doRx)
+uint8_t str2protoMask(const char *s)
+{
+    if (!s)
+        return ESP_PROTO_DEFAULT;
+    if (!strcmp(s, "lr"))
+        return WIFI_PROTOCOL_LR;
+    if (!strcmp(s, "bgn"))
+        return WIFI_PROTOCOL_11B | WIFI_PROTOCOL_11G | WIFI_PROTOCOL_11N;
+    if (!strcmp(s, "b"))
+        return WIFI_PROTOCOL_11B;
+    return ESP_PROTO_DEFAULT;
+}
+
+wifi_phy_rate_t str2phyRate(const char *s)
+{
+    if (!s)
+        return WIFI_PHY_RATE_1M_L;
+    if (!strcmp(s, "lr250k"))
+        return WIFI_PHY_RATE_LORA_250K;
+    if (!strcmp(s, "lr500k"))
+        return WIFI_PHY_RATE_LORA_500K;
+    if (!strcmp(s, "2m"))
+        return WIFI_PHY_RATE_2M_L;
+    if (!strcmp(s, "6m"))
+        return WIFI_PHY_RATE_6M;
+    if (!strcmp(s, "12m"))
+        return WIFI_PHY_RATE_12M;
+    if (!strcmp(s, "24m"))
+        return WIFI_PHY_RATE_24M;
+    if (!strcmp(s, "mcs7"))
+        return WIFI_PHY_RATE_MCS7_LGI;
+    return WIFI_PHY_RATE_1M_L;
+}
+
+void espApplyRadioProfile(const tRadioProfile *profile)
+{
+    if (profile == NULL)
+    {
+        return;
+    }
+    uint8_t protoMask = profile->protocolMask;
+    bool isLoraRate = (profile->rate == WIFI_PHY_RATE_LORA_250K) || (profile->rate == WIFI_PHY_RATE_LORA_500K);
+    if (isLoraRate && !(protoMask & WIFI_PROTOCOL_LR))
+    {
+        Serial.println("*** espApplyRadioProfile: LR rate needs the LR protocol, enabling it");
+        protoMask |= WIFI_PROTOCOL_LR;
+    }
+    if (esp_wifi_set_protocol(WIFI_IF_STA, protoMask) != ESP_OK)
+    {
+        Serial.printf("!!! espApplyRadioProfile ERROR: esp_wifi_set_protocol(0x%02X)\r\n", protoMask);
+    }
+    if (esp_wifi_config_espnow_rate(WIFI_IF_STA, profile->rate) != ESP_OK)
+    {
+        Serial.printf("!!! espApplyRadioProfile ERROR: esp_wifi_config_espnow_rate(%d)\r\n", profile->rate);
+    }
+    if (esp_wifi_set_max_tx_power(profile->txPower) != ESP_OK)
+    {
+        Serial.printf("!!! espApplyRadioProfile ERROR: esp_wifi_set_max_tx_power(%d)\r\n", profile->txPower);
+    }
+    espTxPowerSetCeiling(profile->txPower);
+    Serial.printf(">>> espApplyRadioProfile: proto = 0x%02X, rate = %d, txPower = %d\r\n", protoMask, profile->rate, profile->txPower);
+}
+
+void  espInitRxTx(tEspPacket *txPack, bool doRx, const tRadioProfile *profile)
 {        
     static bool wasInit = false;
+    // the profile follows the role, so it is applied on every (re)start
+    espApplyRadioProfile(profile);
     if (wasInit)
     {
         return;
@@ -226,6 +536,7 @@ void  espInitRxTx(tEspPacket *txPack, bool doRx)
     txPacket = txPack;
     rssiReaderInit();
     initRadio();
+    espStatsInit();
     if (doRx)
     {
         startReceiver();
@@ -233,22 +544,61 @@ void  espInitRxTx(tEspPacket *txPack, bool doRx)
 }
 
 extern void addScannedRecord(tEspPacket *rData, unsigned long lastMs, int rssi);
+extern void addScannedAggregate(tEspPacket *rData, unsigned long lastMs, int rssi, int rssiMin, int rssiMax, int32_t rssiSum, uint16_t count);
+// Raw frames (coalescing off or its table full) are handled as they come,
+// coalesced senders are folded in once per call as one aggregate each.
 void espProcessRx(unsigned long toMs)
 {
-    int rssi;
-    unsigned long ms;
+    static tPacketRecord batch[ENOW_RX_BATCH];
+#if ENOW_RX_COALESCE
+    static tPacketAggregate aggBatch[ENOW_AGG_SLOTS];
+#endif
     unsigned long startMs = millis();
-    while(millis() - startMs < toMs)
+    unsigned long elapsedMs = 0;
+    uint32_t drainUs = 0;       // the wait for frames is not the drain
+    while (elapsedMs < toMs)
     {
-        if (receivePacket(&rxPacket, rssi, ms))
-        {            
-            addScannedRecord(&rxPacket, /*rxPacket->deviceRole,*/ ms, rssi);                        
+        TickType_t waitTicks = pdMS_TO_TICKS(toMs - elapsedMs);
+        if (waitTicks == 0)
+        {
+            waitTicks = 1;
+        }
+        int count = receivePacketBatch(batch, ENOW_RX_BATCH, waitTicks);
+        if (count > 0)
+        {
+            // the wait may run at the low clock or sleep, the drain does not
+            tPmHold hold(plRadio);
+            uint32_t batchUs = loopProfNowUs();
+            for (int i = 0; i < count; i++)
+            {
+                addScannedRecord(&batch[i].rec, batch[i].ms, batch[i].rssi);
+            }
+            drainUs += loopProfNowUs() - batchUs;
         }
+        // a pinger's request is answered at once, not in the next slot
+        if (espPingReplyDue() && (txPacket != NULL))
+        {
+            espProcessTx();
+        }
+        elapsedMs = millis() - startMs;
+    }
+#if ENOW_RX_COALESCE
+    tPmHold hold(plRadio);
+    uint32_t aggUs = loopProfNowUs();
+    int aggCount = rxCoalescePop(aggBatch, ENOW_AGG_SLOTS);
+    for (int i = 0; i < aggCount; i++)
+    {
+        tPacketAggregate *agg = &aggBatch[i];
+        addScannedAggregate(&agg->last.rec, agg->last.ms, agg->last.rssi, agg->rssiMin, agg->rssiMax, agg->rssiSum, agg->count);
     }
+    drainUs += loopProfNowUs() - aggUs;
+#endif
+    loopProfRecord(lsRxDrain, drainUs);
 }
 
 void espProcessTx(void)
 {
+    tPmHold hold(plRadio);
     if (!sendEspPacket(txPacket))
     {        
     }
@@ -1,26 +1,52 @@
 #ifndef __ESP_RADIO_H__
 #define __ESP_RADIO_H__
 #include  <Arduino.h>
+#include <esp_wifi_types.h>
 
 #include "espPacket.h"
 #include "espRx.h"
+#include "espRxRing.h"
+#include "espRxCoalesce.h"
+#include "espSlots.h"
+#include "espStats.h"
+#include "espTimecode.h"
+#include "espGateway.h"
+#include "espRelay.h"
 
 #define ENOW_Q_LEN          20
+#define ENOW_RX_BATCH       ENOW_Q_LEN
+#define ESP_CHANNEL_CHECK_MS 1000     // AP channel poll, an association is seen at once
 //#define ESP_CHANNEL         9
 
-struct tPacketRecord
+// Per-role radio settings, loaded from the role JSON ("radioProtocol",
+// "radioRate", "radioTxPower"). Note that an "lr" only protocol also drops
+// the 11b/g/n link to the access point.
+#define ESP_PROTO_DEFAULT   (WIFI_PROTOCOL_11B | WIFI_PROTOCOL_11G | WIFI_PROTOCOL_11N | WIFI_PROTOCOL_LR)
+
+struct tRadioProfile
 {
-    tEspPacket      rec;
-    unsigned long   ms;
-    int             rssi; 
+    uint8_t         protocolMask = ESP_PROTO_DEFAULT;
+    wifi_phy_rate_t rate         = WIFI_PHY_RATE_1M_L;     // ESP-NOW default rate
+    int8_t          txPower      = WIFI_TX_POWER;          // 0.25 dBm units
 };
 
+uint8_t         str2protoMask(const char *s);
+wifi_phy_rate_t str2phyRate(const char *s);
+void espApplyRadioProfile(const tRadioProfile *profile);
+
 bool receivePacket(tEspPacket *rData, int &rssi, unsigned long &ms);
+int  receivePacketBatch(tPacketRecord *batch, int maxCount, TickType_t waitTicks);
 void prepareWiFi(void);
 bool initRadio(void);
+bool startReceiver(void);          // the receive callback, idempotent
 bool sendEspRawPacket(void *dataBuf, uint16_t bSize);
 bool sendEspPacket(tEspPacket *rData);
-void espInitRxTx(tEspPacket *txPack, bool doRx);
+bool espSetChannel(uint8_t channel);
+// Radio task: keeps ESP-NOW on the associated AP's channel, also after a roam
+void espChannelService(void);
+uint8_t espApChannel(void);         // 0 while not associated
+uint8_t espChannel(void);
+void espInitRxTx(tEspPacket *txPack, bool doRx, const tRadioProfile *profile = NULL);
 void espProcessRx(unsigned long toMs);
 void espProcessTx(void);
 
@@ -0,0 +1,272 @@
+#include "espRelay.h"
+
+// Relay extension value, little endian:
+//  off size field
+//   0   1   version   ESP_RELAY_VERSION
+//   1   1   ttl       hops left after the receiver
+//   2   4   seq       server tick
+//   6   1   phase
+//   7   2   timeLeft  seconds at encode time
+//   9   2   gameTimeout
+//  11  6*n  entries {idHash u32, role, age in ticks}
+#define RELAY_FIXED_LEN         11
+#define RELAY_ENTRY_LEN         6
+
+struct tRelaySlot
+{
+    uint32_t idHash;
+    uint8_t  role;
+    uint8_t  repeat;            // beacons left before the round robin
+    uint32_t seq;               // tick the role was last confirmed
+};
+
+static tEspRelayState   relayState;
+static uint8_t          relayTtl = 0;
+static uint32_t         relayRxMs = 0;
+static bool             relayValid = false;
+static tRelaySlot       relayTable[ESP_RELAY_MAX];
+static uint8_t          relayCount = 0;
+static uint8_t          relayCursor = 0;
+static uint32_t         relaySentMs = 0;
+static uint32_t         selfHash = 0;
+static bool             selfPending = false;
+static portMUX_TYPE     relayMux = portMUX_INITIALIZER_UNLOCKED;   // AsyncUDP, WiFi, radio task and the game loop
+
+static inline void putLe(uint8_t *buf, uint32_t v, uint8_t size)
+{
+    for (uint8_t i = 0; i < size; i++)
+    {
+        buf[i] = (uint8_t)(v >> (8 * i));
+    }
+}
+
+static inline uint32_t getLe(const uint8_t *buf, uint8_t size)
+{
+    uint32_t v = 0;
+    for (uint8_t i = 0; i < size; i++)
+    {
+        v |= (uint32_t)buf[i] << (8 * i);
+    }
+    return v;
+}
+
+static bool relayFresh(void)
+{
+    return relayValid && (millis() - relayRxMs < ESP_RELAY_STALE_MS);
+}
+
+// Takes the header if its tick is newer, under relayMux; a server that
+// restarted counts from scratch, so a stale state takes any tick
+static bool acceptState(const tEspRelayState &state, uint8_t ttl)
+{
+    if (!relayFresh())
+    {
+        relayCount = 0;
+    }
+    else if ((int32_t)(state.seq - relayState.seq) <= 0)
+    {
+        if ((state.seq == relayState.seq) && (ttl > relayTtl))
+        {
+            relayTtl = ttl;     // a shorter path to the server
+        }
+        return state.seq == relayState.seq;
+    }
+    relayState = state;
+    relayTtl = ttl;
+    relayRxMs = millis();
+    relayValid = true;
+    selfPending = true;     // new time left, with the role last heard
+    return true;
+}
+
+// Under relayMux
+static void mergeEntry(uint32_t idHash, uint8_t role, uint32_t seq)
+{
+    uint8_t i = 0;
+    while ((i < relayCount) && (relayTable[i].idHash != idHash))
+    {
+        i++;
+    }
+    if (i == relayCount)
+    {
+        if (relayCount == ESP_RELAY_MAX)
+        {
+            return;
+        }
+        relayCount++;
+        relayTable[i].idHash = idHash;
+        relayTable[i].role = role;
+        relayTable[i].repeat = ESP_RELAY_REPEAT;
+        relayTable[i].seq = seq;
+    }
+    else
+    {
+        tRelaySlot &s = relayTable[i];
+        if ((int32_t)(seq - s.seq) <= 0)
+        {
+            return;     // heard before
+        }
+        if (s.role != role)
+        {
+            s.repeat = ESP_RELAY_REPEAT;
+        }
+        s.role = role;
+        s.seq = seq;
+    }
+    if (idHash == selfHash)
+    {
+        selfPending = true;
+    }
+}
+
+void espRelayStart(uint32_t hash)
+{
+    portENTER_CRITICAL(&relayMux);
+    selfHash = hash;
+    selfPending = false;
+    portEXIT_CRITICAL(&relayMux);
+}
+
+void espRelayOffer(const tEspRelayState &state, const tEspRelayEntry *entries, uint16_t count)
+{
+    portENTER_CRITICAL(&relayMux);
+    if (acceptState(state, ESP_RELAY_TTL))
+    {
+        for (uint16_t i = 0; i < count; i++)
+        {
+            mergeEntry(entries[i].idHash, entries[i].role, state.seq);
+        }
+    }
+    portEXIT_CRITICAL(&relayMux);
+}
+
+bool espRelayTake(tEspRelayState &state, uint8_t &role)
+{
+    bool res = false;
+    portENTER_CRITICAL(&relayMux);
+    if (selfPending && relayFresh())
+    {
+        for (uint8_t i = 0; i < relayCount; i++)
+        {
+            if (relayTable[i].idHash == selfHash)
+            {
+                state = relayState;
+                state.timeLeft = (uint16_t)max(0, (int)state.timeLeft - (int)((millis() - relayRxMs) / 1000));
+                role = relayTable[i].role;
+                res = true;
+                break;
+            }
+        }
+    }
+    selfPending = false;
+    portEXIT_CRITICAL(&relayMux);
+    return res;
+}
+
+bool espRelayTally(tEspRelayState &state, uint16_t *counts, uint8_t roles)
+{
+    memset(counts, 0, roles * sizeof(counts[0]));
+    portENTER_CRITICAL(&relayMux);
+    bool res = relayFresh();
+    if (res)
+    {
+        state = relayState;
+        state.timeLeft = (uint16_t)max(0, (int)state.timeLeft - (int)((millis() - relayRxMs) / 1000));
+        for (uint8_t i = 0; i < relayCount; i++)
+        {
+            const tRelaySlot &s = relayTable[i];
+            if ((s.role < roles) && (relayState.seq - s.seq <= ESP_RELAY_TALLY_TICKS))
+            {
+                counts[s.role]++;
+            }
+        }
+    }
+    portEXIT_CRITICAL(&relayMux);
+    return res;
+}
+
+// Changed entries first, then the rest in turn
+uint8_t espRelayBuildExt(uint8_t *buf, uint8_t bufSize)
+{
+    uint32_t now = millis();
+    if ((bufSize < 2 + RELAY_FIXED_LEN) || (now - relaySentMs < ESP_RELAY_EVERY_MS))
+    {
+        return 0;
+    }
+    uint8_t fit = min((bufSize - 2 - RELAY_FIXED_LEN) / RELAY_ENTRY_LEN, ESP_RELAY_BEACON_ENTRIES);
+    uint8_t *v = &buf[2];
+    uint8_t n = 0;
+    portENTER_CRITICAL(&relayMux);
+    if (!relayFresh() || (relayTtl == 0))
+    {
+        portEXIT_CRITICAL(&relayMux);
+        return 0;
+    }
+    v[0] = ESP_RELAY_VERSION;
+    v[1] = relayTtl - 1;
+    putLe(&v[2], relayState.seq, 4);
+    v[6] = relayState.phase;
+    putLe(&v[7], (uint32_t)max(0, (int)relayState.timeLeft - (int)((now - relayRxMs) / 1000)), 2);
+    putLe(&v[9], relayState.gameTimeout, 2);
+    bool taken[ESP_RELAY_MAX] = {false};
+    for (uint8_t i = 0; (i < relayCount) && (n < fit); i++)
+    {
+        if (relayTable[i].repeat > 0)
+        {
+            relayTable[i].repeat--;
+            taken[i] = true;
+            n++;
+        }
+    }
+    for (uint8_t k = 0; (k < relayCount) && (n < fit); k++)
+    {
+        relayCursor %= relayCount;
+        uint8_t i = relayCursor++;
+        if (!taken[i])
+        {
+            taken[i] = true;
+            n++;
+        }
+    }
+    uint8_t *e = &v[RELAY_FIXED_LEN];
+    for (uint8_t i = 0; i < relayCount; i++)
+    {
+        if (taken[i])
+        {
+            putLe(&e[0], relayTable[i].idHash, 4);
+            e[4] = relayTable[i].role;
+            e[5] = (uint8_t)min(relayState.seq - relayTable[i].seq, (uint32_t)0xFF);
+            e += RELAY_ENTRY_LEN;
+        }
+    }
+    portEXIT_CRITICAL(&relayMux);
+    relaySentMs = now;
+    buf[0] = ESP_WIRE_EXT_RELAY;
+    buf[1] = RELAY_FIXED_LEN + n * RELAY_ENTRY_LEN;
+    return 2 + buf[1];
+}
+
+void espRelayOnRx(const tEspWireExt &ext)
+{
+    const uint8_t *value;
+    uint8_t valueLen;
+    if ((ext.len == 0) || !espWireFindExt(ext, ESP_WIRE_EXT_RELAY, value, valueLen) ||
+        (valueLen < RELAY_FIXED_LEN) || (value[0] != ESP_RELAY_VERSION))
+    {
+        return;
+    }
+    tEspRelayState state;
+    state.seq = getLe(&value[2], 4);
+    state.phase = value[6];
+    state.timeLeft = (uint16_t)getLe(&value[7], 2);
+    state.gameTimeout = (uint16_t)getLe(&value[9], 2);
+    portENTER_CRITICAL(&relayMux);
+    if (acceptState(state, value[1]))
+    {
+        for (uint8_t pos = RELAY_FIXED_LEN; pos + RELAY_ENTRY_LEN <= valueLen; pos += RELAY_ENTRY_LEN)
+        {
+            mergeEntry(getLe(&value[pos], 4), value[pos + 4], state.seq - value[pos + 5]);
+        }
+    }
+    portEXIT_CRITICAL(&relayMux);
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "espWire.h"
+
+// Store and forward of the game server's control state over ESP-NOW. A
+// device that hears the game state multicast puts the phase, the time left
+// and a few role entries into its beacons with a hop budget (TTL); devices
+// that hear them keep the newest state per server tick and pass it on with
+// one hop less. A player out of WiFi range still learns a role change, the
+// time left and the end of the game within a few hops.
+//
+// The newest-tick check per entry is the dedup cache: a state heard again
+// over another path is dropped, an entry whose role changed is sent
+// ESP_RELAY_REPEAT times before the others continue in turn.
+
+#define ESP_WIRE_EXT_RELAY      6       // see espRelay.cpp for the layout
+#define ESP_RELAY_VERSION       1
+#define ESP_RELAY_TTL           3       // hops after the device that heard the server
+#define ESP_RELAY_MAX           64      // role entries kept
+#define ESP_RELAY_BEACON_ENTRIES 6      // at most per beacon
+#define ESP_RELAY_REPEAT        3       // beacons a changed entry goes out first
+#define ESP_RELAY_EVERY_MS      200     // per device, not every beacon
+#define ESP_RELAY_STALE_MS      5000    // no newer tick this long, the state is dropped
+#define ESP_RELAY_TALLY_TICKS   30      // entries confirmed this many ticks back are counted
+
+struct tEspRelayState
+{
+    uint32_t seq = 0;           // server tick
+    uint8_t  phase = 0;         // tGameApiPhase
+    uint16_t timeLeft = 0;      // seconds, aged on every hop
+    uint16_t gameTimeout = 0;
+};
+
+struct tEspRelayEntry
+{
+    uint32_t idHash;            // gameMcastIdHash() of the device name
+    uint8_t  role;              // tGameApiRole
+};
+
+void espRelayStart(uint32_t selfHash);
+// A device that heard the server, entries of one part of the tick
+void espRelayOffer(const tEspRelayState &state, const tEspRelayEntry *entries, uint16_t count);
+// Newer relayed state that lists this device, once
+bool espRelayTake(tEspRelayState &state, uint8_t &role);
+// Entries per role of the fresh state, counts[role] for role < roles; an
+// entry not confirmed for ESP_RELAY_TALLY_TICKS has left the game
+bool espRelayTally(tEspRelayState &state, uint16_t *counts, uint8_t roles);
+
+uint8_t espRelayBuildExt(uint8_t *buf, uint8_t bufSize);
+void    espRelayOnRx(const tEspWireExt &ext);
@@ -2,27 +2,103 @@
 
 #include <esp_wifi.h>
 
+// One slot per recently heard sender. Written only from the WiFi task
+// (promiscuous callback), read from the ESP-NOW receive callback which runs
+// in the same task right after it, so no semaphore is needed. The version
+// counter is odd while a slot is being written and lets any other reader
+// detect a torn copy.
+struct tRssiSlot
+{
+    volatile uint32_t   version;
+    uint8_t             mac[6];
+    volatile uint16_t   seqNum;
+    volatile int8_t     rssi;
+    volatile uint32_t   stamp;
+};
+
+static tRssiSlot rssiSlots[RSSI_CAPTURE_SLOTS];
+static volatile uint32_t rssiStamp = 0;
 volatile int rssiVal = 0;
-static SemaphoreHandle_t rssiMutex;
 
-static void setRssi(int rssi)
+static inline uint32_t macHash(const uint8_t *mac)
+{
+    // the last three bytes are the device specific part of the MAC
+    uint32_t h = ((uint32_t)mac[3] << 16) | ((uint32_t)mac[4] << 8) | mac[5];
+    h ^= h >> 7;
+    h *= 0x9E3779B1u;
+    return h >> 26;
+}
+
+static void setRssi(const uint8_t *mac, uint16_t seqNum, int rssi)
 {
-    if (xSemaphoreTake(rssiMutex, ( TickType_t ) 100 ) == pdTRUE )
+    rssiVal = rssi;
+    uint32_t stamp = ++rssiStamp;
+    uint32_t base = macHash(mac);
+    tRssiSlot *victim = NULL;
+    for (int i = 0; i < RSSI_CAPTURE_PROBES; i++)
     {
-        rssiVal = rssi;
-        xSemaphoreGive(rssiMutex);
+        tRssiSlot *slot = &rssiSlots[(base + i) & (RSSI_CAPTURE_SLOTS - 1)];
+        if ((slot->stamp == 0) || (memcmp(slot->mac, mac, 6) == 0))
+        {
+            victim = slot;
+            break;
+        }
+        if ((victim == NULL) || (slot->stamp < victim->stamp))
+        {
+            victim = slot;
+        }
     }
+
+    victim->version++;
+    __sync_synchronize();
+    memcpy(victim->mac, mac, 6);
+    victim->seqNum = seqNum;
+    victim->rssi   = (int8_t)rssi;
+    victim->stamp  = stamp;
+    __sync_synchronize();
+    victim->version++;
 }
 
 int getRssi(void)
 {
-    int res;
-    if (xSemaphoreTake(rssiMutex, ( TickType_t ) 100 ) == pdTRUE )
+    return rssiVal;
+}
+
+bool getRssiForMac(const uint8_t *mac, int &rssi, uint16_t *seqNum)
+{
+    if (mac == NULL)
+    {
+        return false;
+    }
+    uint32_t base = macHash(mac);
+    for (int i = 0; i < RSSI_CAPTURE_PROBES; i++)
     {
-        res = rssiVal;
-        xSemaphoreGive(rssiMutex);
+        const tRssiSlot *slot = &rssiSlots[(base + i) & (RSSI_CAPTURE_SLOTS - 1)];
+        uint32_t v1 = slot->version;
+        if (v1 & 1)
+        {
+            continue;
+        }
+        __sync_synchronize();
+        bool found = (slot->stamp != 0) && (memcmp(slot->mac, mac, 6) == 0);
+        int8_t r = slot->rssi;
+        uint16_t s = slot->seqNum;
+        __sync_synchronize();
+        if (slot->version != v1)
+        {
+            continue;
+        }
+        if (found)
+        {
+            rssi = r;
+            if (seqNum)
+            {
+                *seqNum = s;
+            }
+            return true;
+        }
     }
-    return res;
+    return false;
 }
 
 void promiscuous_rx_cb(void *buf, wifi_promiscuous_pkt_type_t type) 
@@ -55,7 +131,7 @@ void promiscuous_rx_cb(void *buf, wifi_promiscuous_pkt_type_t type)
     static const uint8_t ESPRESSIF_OUI[] = {0x30, 0xAE, 0xA4}; // one of them
     if (ACTION_SUBTYPE == (hdr->frame_ctrl & 0xFF))
     {
-        setRssi(ppkt->rx_ctrl.rssi);
+        setRssi(hdr->sender_oui, hdr->sequence_ctrl >> 4, ppkt->rx_ctrl.rssi);
         //Serial.printf("%02X:%02X:%02X:%02X:%02X:%02X %d\r\n", hdr->addr4[0], hdr->addr4[1], hdr->addr4[2], hdr->addr4[3], hdr->addr4[4], hdr->addr4[5], ppkt->rx_ctrl.rssi);
     }
     
@@ -67,7 +143,6 @@ void promiscuous_rx_cb(void *buf, wifi_promiscuous_pkt_type_t type)
 
 void rssiReaderInit(void)
 {
-    rssiMutex = xSemaphoreCreateMutex(); 
     esp_wifi_set_promiscuous(true);
     esp_wifi_set_promiscuous_rx_cb(&promiscuous_rx_cb);    
 }
\ No newline at end of file
@@ -2,5 +2,11 @@
 
 #include <Arduino.h>
 
+// Per-sender RSSI capture table (promiscuous callback -> ESP-NOW receive callback)
+#define RSSI_CAPTURE_SLOTS      64      // must be a power of two
+#define RSSI_CAPTURE_PROBES     4
+#define RSSI_CAPTURE_NONE       (-127)
+
 int  getRssi(void);
+bool getRssiForMac(const uint8_t *mac, int &rssi, uint16_t *seqNum = NULL);
 void rssiReaderInit(void);
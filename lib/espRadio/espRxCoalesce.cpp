@@ -0,0 +1,112 @@
+#include "espRxCoalesce.h"
+
+static tPacketAggregate slots[ENOW_AGG_SLOTS];
+static int16_t slotIndex[ENOW_AGG_SLOTS * 2];   // deviceID hash -> slot, -1 if empty
+static uint16_t slotCount = 0;
+static uint16_t dirtyCount = 0;
+static bool indexReady = false;
+static portMUX_TYPE aggMux = portMUX_INITIALIZER_UNLOCKED;
+
+static inline uint16_t aggHash(uint64_t deviceID)
+{
+    return (uint16_t)((deviceID * 0x9E3779B97F4A7C15ULL) >> (64 - (ENOW_AGG_BITS + 1)));
+}
+
+static void resetIndex(void)
+{
+    for (int i = 0; i < ENOW_AGG_SLOTS * 2; i++)
+    {
+        slotIndex[i] = -1;
+    }
+    slotCount = 0;
+    dirtyCount = 0;
+    indexReady = true;
+}
+
+// Returns false when the table has no room for a new sender, the caller
+// should then fall back to the plain ring.
+bool rxCoalescePush(const tPacketRecord *pRec)
+{
+    bool res = true;
+    int16_t rssi = (int16_t)pRec->rssi;
+    portENTER_CRITICAL(&aggMux);
+    if (!indexReady)
+    {
+        resetIndex();
+    }
+    uint16_t h = aggHash(pRec->rec.deviceID);
+    int16_t pos = -1;
+    while (slotIndex[h] >= 0)
+    {
+        if (slots[slotIndex[h]].last.rec.deviceID == pRec->rec.deviceID)
+        {
+            pos = slotIndex[h];
+            break;
+        }
+        h = (h + 1) & (ENOW_AGG_SLOTS * 2 - 1);
+    }
+
+    if ((pos < 0) && (slotCount < ENOW_AGG_SLOTS))
+    {
+        pos = slotCount++;
+        slotIndex[h] = pos;
+        slots[pos].count = 0;
+    }
+
+    if (pos < 0)
+    {
+        res = false;
+    }
+    else
+    {
+        tPacketAggregate *agg = &slots[pos];
+        if (agg->count == 0)
+        {
+            agg->rssiMin = rssi;
+            agg->rssiMax = rssi;
+            agg->rssiSum = 0;
+            dirtyCount++;
+        }
+        else
+        {
+            if (rssi < agg->rssiMin)
+                agg->rssiMin = rssi;
+            if (rssi > agg->rssiMax)
+                agg->rssiMax = rssi;
+        }
+        agg->last = *pRec;
+        agg->rssiSum += rssi;
+        if (agg->count < UINT16_MAX)
+            agg->count++;
+    }
+    portEXIT_CRITICAL(&aggMux);
+    return res;
+}
+
+bool rxCoalesceHasData(void)
+{
+    return dirtyCount != 0;
+}
+
+int rxCoalescePop(tPacketAggregate *batch, int maxCount)
+{
+    int n = 0;
+    portENTER_CRITICAL(&aggMux);
+    for (uint16_t i = 0; (i < slotCount) && (n < maxCount); i++)
+    {
+        if (slots[i].count)
+        {
+            batch[n++] = slots[i];
+            slots[i].count = 0;
+            dirtyCount--;
+        }
+    }
+    // senders keep their slots until everything is drained, then the table
+    // starts over so devices that left do not hold slots forever
+    if (dirtyCount == 0)
+    {
+        resetIndex();
+    }
+    portEXIT_CRITICAL(&aggMux);
+    return n;
+}
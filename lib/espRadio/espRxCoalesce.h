@@ -0,0 +1,26 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "espRxRing.h"
+
+// One slot per sender between two consumer drains: the latest frame plus
+// the RSSI statistics of every frame folded into it.
+#ifndef ENOW_RX_COALESCE
+#define ENOW_RX_COALESCE        1
+#endif
+#define ENOW_AGG_BITS           7
+#define ENOW_AGG_SLOTS          (1 << ENOW_AGG_BITS)
+
+struct tPacketAggregate
+{
+    tPacketRecord   last;
+    int16_t         rssiMin;
+    int16_t         rssiMax;
+    int32_t         rssiSum;
+    uint16_t        count;
+};
+
+bool rxCoalescePush(const tPacketRecord *pRec);
+int  rxCoalescePop(tPacketAggregate *batch, int maxCount);
+bool rxCoalesceHasData(void);
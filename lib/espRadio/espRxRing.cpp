@@ -0,0 +1,169 @@
+#include "espRxRing.h"
+#include "espRadio.h"
+
+// Fixed size ring between the WiFi task (producer) and the communicator
+// (consumer). The producer never blocks: a full ring is resolved by the
+// overflow policy inside a short spinlock section. Priority frames have a
+// lane of their own that the consumer empties first; only once it is full
+// does a priority frame take the normal way.
+
+static tPacketRecord ring[ENOW_Q_LEN];
+static uint16_t ringHead = 0;     // next write position
+static uint16_t ringCount = 0;
+static portMUX_TYPE ringMux = portMUX_INITIALIZER_UNLOCKED;
+static volatile TaskHandle_t consumerTask = NULL;
+static tRxOverflowPolicy overflowPolicy = ENOW_RX_OVERFLOW_POLICY;
+static tEspRxStats rxStats;
+static tPacketRecord hiLane[ENOW_RX_HI_LEN];
+static uint16_t hiHead = 0;
+static uint16_t hiCount = 0;
+
+static inline uint16_t ringPos(uint16_t offsetFromTail)
+{
+    return (ringHead + ENOW_Q_LEN - ringCount + offsetFromTail) % ENOW_Q_LEN;
+}
+
+void rxRingInit(void)
+{
+    portENTER_CRITICAL(&ringMux);
+    ringHead = 0;
+    ringCount = 0;
+    hiHead = 0;
+    hiCount = 0;
+    portEXIT_CRITICAL(&ringMux);
+}
+
+bool rxRingPush(const tPacketRecord *pRec, bool priority)
+{
+    bool stored = true;
+    portENTER_CRITICAL(&ringMux);
+    rxStats.received++;
+    if (priority)
+    {
+        if (hiCount < ENOW_RX_HI_LEN)
+        {
+            hiLane[hiHead] = *pRec;
+            hiHead = (hiHead + 1) % ENOW_RX_HI_LEN;
+            hiCount++;
+            rxStats.priority++;
+            portEXIT_CRITICAL(&ringMux);
+            rxRingWakeConsumer();
+            return true;
+        }
+        rxStats.spilled++;
+    }
+    if (ringCount < ENOW_Q_LEN)
+    {
+        ring[ringHead] = *pRec;
+        ringHead = (ringHead + 1) % ENOW_Q_LEN;
+        ringCount++;
+        if (ringCount > rxStats.highWater)
+        {
+            rxStats.highWater = ringCount;
+        }
+    }
+    else
+    {
+        bool merged = false;
+        if (overflowPolicy == rxCoalesceSender)
+        {
+            for (uint16_t i = 0; i < ringCount; i++)
+            {
+                tPacketRecord *slot = &ring[ringPos(i)];
+                if (slot->rec.deviceID == pRec->rec.deviceID)
+                {
+                    *slot = *pRec;
+                    rxStats.coalesced++;
+                    merged = true;
+                    break;
+                }
+            }
+        }
+
+        if (!merged)
+        {
+            if (overflowPolicy == rxDropNewest)
+            {
+                stored = false;
+            }
+            else
+            {
+                // drop the oldest entry: head overwrites the tail
+                ring[ringHead] = *pRec;
+                ringHead = (ringHead + 1) % ENOW_Q_LEN;
+            }
+            rxStats.dropped++;
+        }
+    }
+    portEXIT_CRITICAL(&ringMux);
+
+    if (stored)
+    {
+        rxRingWakeConsumer();
+    }
+    return stored;
+}
+
+void rxRingWakeConsumer(void)
+{
+    TaskHandle_t waiter = consumerTask;
+    if (waiter)
+    {
+        xTaskNotifyGive(waiter);
+    }
+}
+
+void rxRingWaitData(TickType_t waitTicks)
+{
+    if (consumerTask == NULL)
+    {
+        consumerTask = xTaskGetCurrentTaskHandle();
+    }
+    ulTaskNotifyTake(pdTRUE, waitTicks);
+}
+
+int rxRingPop(tPacketRecord *batch, int maxCount, TickType_t waitTicks)
+{
+    portENTER_CRITICAL(&ringMux);
+    bool isEmpty = (ringCount == 0) && (hiCount == 0);
+    portEXIT_CRITICAL(&ringMux);
+
+    if (isEmpty && waitTicks)
+    {
+        rxRingWaitData(waitTicks);
+    }
+
+    int count = 0;
+    portENTER_CRITICAL(&ringMux);
+    while ((count < maxCount) && hiCount)
+    {
+        batch[count++] = hiLane[(hiHead + ENOW_RX_HI_LEN - hiCount) % ENOW_RX_HI_LEN];
+        hiCount--;
+    }
+    while ((count < maxCount) && ringCount)
+    {
+        batch[count++] = ring[ringPos(0)];
+        ringCount--;
+    }
+    portEXIT_CRITICAL(&ringMux);
+    return count;
+}
+
+void rxRingSetPolicy(tRxOverflowPolicy policy)
+{
+    portENTER_CRITICAL(&ringMux);
+    overflowPolicy = policy;
+    portEXIT_CRITICAL(&ringMux);
+}
+
+tRxOverflowPolicy rxRingGetPolicy(void)
+{
+    return overflowPolicy;
+}
+
+void espGetRxStats(tEspRxStats &stats)
+{
+    portENTER_CRITICAL(&ringMux);
+    stats = rxStats;
+    portEXIT_CRITICAL(&ringMux);
+}
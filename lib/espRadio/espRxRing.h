@@ -0,0 +1,45 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "espPacket.h"
+
+enum tRxOverflowPolicy
+{
+    rxDropOldest     = 0,
+    rxDropNewest     = 1,
+    rxCoalesceSender = 2
+};
+
+#ifndef ENOW_RX_OVERFLOW_POLICY
+#define ENOW_RX_OVERFLOW_POLICY     rxCoalesceSender
+#endif
+#define ENOW_RX_HI_LEN              8       // priority lane: bases, portals, servers and control frames
+
+struct tPacketRecord
+{
+    tEspPacket      rec;
+    unsigned long   ms;
+    int             rssi; 
+};
+
+struct tEspRxStats
+{
+    uint32_t        received  = 0;
+    uint32_t        dropped   = 0;
+    uint32_t        coalesced = 0;
+    uint32_t        priority  = 0;      // through the priority lane
+    uint32_t        spilled   = 0;      // priority frames that found the lane full
+    uint16_t        highWater = 0;
+};
+
+void rxRingInit(void);
+// A priority frame is popped ahead of the rest and never dropped by the
+// overflow policy while its lane has room
+bool rxRingPush(const tPacketRecord *pRec, bool priority = false);
+int  rxRingPop(tPacketRecord *batch, int maxCount, TickType_t waitTicks);
+void rxRingWakeConsumer(void);
+void rxRingWaitData(TickType_t waitTicks);
+void rxRingSetPolicy(tRxOverflowPolicy policy);
+tRxOverflowPolicy rxRingGetPolicy(void);
+void espGetRxStats(tEspRxStats &stats);
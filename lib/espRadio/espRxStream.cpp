@@ -0,0 +1,78 @@
+#include "espRxStream.h"
+
+static tEspRxStreamRec   ring[ESP_RX_STREAM_RING];
+static uint16_t          ringHead = 0;     // next write position
+static uint16_t          ringCount = 0;
+static volatile bool     active = false;
+static tEspRxStreamStats streamStats;
+static portMUX_TYPE      streamMux = portMUX_INITIALIZER_UNLOCKED;
+
+void espRxStreamEnable(bool on)
+{
+    portENTER_CRITICAL(&streamMux);
+    if (on && !active)
+    {
+        ringHead = 0;
+        ringCount = 0;
+        memset(&streamStats, 0, sizeof(streamStats));
+    }
+    active = on;
+    portEXIT_CRITICAL(&streamMux);
+    Serial.printf(">>> espRxStreamEnable: %s\r\n", on ? "on" : "off");
+}
+
+bool espRxStreamActive(void)
+{
+    return active;
+}
+
+void espRxStreamOnRx(const tEspPacket &pkt, int rssi, uint32_t us)
+{
+    if (!active)
+    {
+        return;
+    }
+    portENTER_CRITICAL(&streamMux);
+    if (ringCount < ESP_RX_STREAM_RING)
+    {
+        tEspRxStreamRec &r = ring[ringHead];
+        r.us = us;
+        r.deviceID = pkt.deviceID;
+        r.seq = (uint16_t)pkt.packetID;
+        r.rssi = (int8_t)constrain(rssi, -128, 127);
+        r.role = (uint8_t)pkt.deviceRole;
+        ringHead = (ringHead + 1) % ESP_RX_STREAM_RING;
+        ringCount++;
+        streamStats.records++;
+        if (ringCount > streamStats.highWater)
+        {
+            streamStats.highWater = ringCount;
+        }
+    }
+    else
+    {
+        streamStats.dropped++;
+    }
+    portEXIT_CRITICAL(&streamMux);
+}
+
+int espRxStreamPop(tEspRxStreamRec *batch, int maxCount)
+{
+    portENTER_CRITICAL(&streamMux);
+    int n = min((int)ringCount, maxCount);
+    uint16_t tail = (ringHead + ESP_RX_STREAM_RING - ringCount) % ESP_RX_STREAM_RING;
+    for (int i = 0; i < n; i++)
+    {
+        batch[i] = ring[(tail + i) % ESP_RX_STREAM_RING];
+    }
+    ringCount -= n;
+    portEXIT_CRITICAL(&streamMux);
+    return n;
+}
+
+void espRxStreamGetStats(tEspRxStreamStats &st)
+{
+    portENTER_CRITICAL(&streamMux);
+    st = streamStats;
+    portEXIT_CRITICAL(&streamMux);
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "espPacket.h"
+
+// Every accepted frame as it arrives, for RSSI calibration runs: the WiFi task
+// puts a short record of each one into a ring before it is coalesced, the
+// serial commander drains the ring into binary frames (serialCommander.h) and
+// a host script (servers/RssiCapture) writes and analyses the capture.
+// A full ring drops the newest record and counts it.
+
+#define ESP_RX_STREAM_RING      512     // records, 16 bytes each
+#define ESP_RX_STREAM_BATCH     32      // records per serial frame
+
+struct __attribute__((packed)) tEspRxStreamRec
+{
+    uint32_t us;                // micros() of the receive callback
+    uint64_t deviceID;
+    uint16_t seq;               // low bits of the sender's packetID
+    int8_t   rssi;
+    uint8_t  role;              // tGameRole
+};
+
+struct tEspRxStreamStats
+{
+    uint32_t records;
+    uint32_t dropped;
+    uint16_t highWater;
+};
+
+void espRxStreamEnable(bool on);
+bool espRxStreamActive(void);
+void espRxStreamOnRx(const tEspPacket &pkt, int rssi, uint32_t us);     // WiFi task
+int  espRxStreamPop(tEspRxStreamRec *batch, int maxCount);
+void espRxStreamGetStats(tEspRxStreamStats &st);
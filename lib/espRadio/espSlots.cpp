@@ -0,0 +1,102 @@
+#include "espSlots.h"
+#include "espTimecode.h"
+
+static bool     slotActive      = false;
+static uint16_t txSlot          = 0;
+static uint16_t txSlotCount     = 1;
+static uint32_t slotFrameMs     = BEACON_INTERVAL_MS;
+static uint64_t lastSentFrame   = UINT64_MAX;
+static portMUX_TYPE slotMux     = portMUX_INITIALIZER_UNLOCKED;   // set from the game loop, read by the radio task
+
+static inline uint64_t sharedNowMs(void)
+{
+    return espClockNowMs();
+}
+
+static inline uint32_t slotStartMs(void)
+{
+    return (slotFrameMs * txSlot) / txSlotCount;
+}
+
+void espSetTxSlot(int slot, int slotCount, uint32_t frameMs)
+{
+    if ((slot < 0) || (slotCount <= 0) || (slot >= slotCount))
+    {
+        espClearTxSlot();
+        return;
+    }
+    if (frameMs < (uint32_t)slotCount * ESP_SLOT_MIN_MS)
+    {
+        frameMs = (uint32_t)slotCount * ESP_SLOT_MIN_MS;
+    }
+    if (!slotActive || (txSlot != slot) || (txSlotCount != slotCount))
+    {
+        Serial.printf(">>> espSetTxSlot: slot %d of %d, frame %u ms\r\n", slot, slotCount, frameMs);
+    }
+    portENTER_CRITICAL(&slotMux);
+    txSlot = slot;
+    txSlotCount = slotCount;
+    slotFrameMs = frameMs;
+    slotActive = true;
+    portEXIT_CRITICAL(&slotMux);
+}
+
+void espClearTxSlot(void)
+{
+    portENTER_CRITICAL(&slotMux);
+    slotActive = false;
+    lastSentFrame = UINT64_MAX;
+    portEXIT_CRITICAL(&slotMux);
+}
+
+bool espTxSlotActive(void)
+{
+    return slotActive;
+}
+
+// True once per frame, as soon as the own slot has started
+bool espTxSlotDue(void)
+{
+    bool due = false;
+    portENTER_CRITICAL(&slotMux);
+    if (slotActive)
+    {
+        uint64_t now = sharedNowMs();
+        uint64_t frame = now / slotFrameMs;
+        uint32_t phase = now % slotFrameMs;
+        if ((frame != lastSentFrame) && (phase >= slotStartMs()))
+        {
+            lastSentFrame = frame;
+            due = true;
+        }
+    }
+    portEXIT_CRITICAL(&slotMux);
+    return due;
+}
+
+uint32_t espMsToNextSlot(void)
+{
+    uint32_t res = UINT32_MAX;
+    portENTER_CRITICAL(&slotMux);
+    if (slotActive)
+    {
+        uint64_t now = sharedNowMs();
+        uint64_t frame = now / slotFrameMs;
+        uint32_t phase = now % slotFrameMs;
+        uint32_t start = slotStartMs();
+        if ((frame != lastSentFrame) && (phase < start))
+        {
+            res = start - phase;
+        }
+        else if (frame != lastSentFrame)
+        {
+            res = 0;
+        }
+        else
+        {
+            res = slotFrameMs - phase + start;
+        }
+    }
+    portEXIT_CRITICAL(&slotMux);
+    return res;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <Arduino.h>
+
+// TDMA beacon slots. The game server assigns a slot index, the slot count
+// and the frame length; frames start on the shared clock of espTimecode.h,
+// so all devices agree on them. Until a slot is set the caller keeps its own schedule.
+
+#define ESP_SLOT_MIN_MS         2
+
+void     espSetTxSlot(int slot, int slotCount, uint32_t frameMs);
+void     espClearTxSlot(void);
+bool     espTxSlotActive(void);
+bool     espTxSlotDue(void);
+uint32_t espMsToNextSlot(void);
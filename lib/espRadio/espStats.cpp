@@ -0,0 +1,214 @@
+#include "espStats.h"
+#include "espRxRing.h"
+#include "espAirtime.h"
+
+#include <esp_now.h>
+
+struct tSenderTiming
+{
+    uint64_t deviceID;
+    uint32_t lastMs;
+    uint32_t meanIntQ4;     // EMA of the inter-arrival time, ms * 16
+    uint32_t jitterQ4;      // EMA of |interval - mean|, ms * 16
+    uint16_t lastSeq;
+    bool     seqValid;
+};
+
+static tEspChannelStats chStats;
+static tSenderTiming senders[ESP_STATS_SENDERS];
+static uint32_t fpsWindowStartMs = 0;
+static uint32_t fpsWindowFrames = 0;
+static portMUX_TYPE statsMux = portMUX_INITIALIZER_UNLOCKED;
+
+static void onDataSent(const uint8_t *mac, esp_now_send_status_t status)
+{
+    espStatsOnTx(status == ESP_NOW_SEND_SUCCESS);
+}
+
+void espStatsInit(void)
+{
+    static bool wasInit = false;
+    if (wasInit)
+    {
+        return;
+    }
+    if (esp_now_register_send_cb(onDataSent) == ESP_OK)
+    {
+        wasInit = true;
+    }
+    else
+    {
+        Serial.println("!!! espStatsInit ERROR: esp_now_register_send_cb failed");
+    }
+}
+
+void espStatsOnTx(bool ok)
+{
+    portENTER_CRITICAL(&statsMux);
+    if (ok)
+        chStats.txOk++;
+    else
+        chStats.txFail++;
+    portEXIT_CRITICAL(&statsMux);
+}
+
+static tSenderTiming *senderSlot(uint64_t deviceID)
+{
+    uint32_t h = (uint32_t)((deviceID * 0x9E3779B97F4A7C15ULL) >> 32) & (ESP_STATS_SENDERS - 1);
+    tSenderTiming *victim = &senders[h];
+    for (int i = 0; i < 4; i++)
+    {
+        tSenderTiming *s = &senders[(h + i) & (ESP_STATS_SENDERS - 1)];
+        if (s->deviceID == deviceID)
+        {
+            return s;
+        }
+        if ((s->deviceID == 0) || ((int32_t)(s->lastMs - victim->lastMs) < 0))
+        {
+            victim = s;
+        }
+    }
+    victim->deviceID = deviceID;
+    victim->lastMs = 0;
+    victim->meanIntQ4 = 0;
+    victim->jitterQ4 = 0;
+    victim->seqValid = false;
+    return victim;
+}
+
+void espStatsOnRx(uint64_t deviceID, uint16_t seq, unsigned long ms, int rssi)
+{
+    bool bulk = airtimeBulkActive();
+    int bin = (rssi - ESP_STATS_RSSI_MIN) / ESP_STATS_RSSI_STEP;
+    bin = constrain(bin, 0, ESP_STATS_RSSI_BINS - 1);
+
+    portENTER_CRITICAL(&statsMux);
+    chStats.rxFrames++;
+    chStats.rssiHist[bin]++;
+
+    fpsWindowFrames++;
+    uint32_t elapsed = ms - fpsWindowStartMs;
+    if (elapsed >= ESP_STATS_FPS_WINDOW_MS)
+    {
+        chStats.rxFps = (fpsWindowFrames * 1000UL) / elapsed;
+        fpsWindowFrames = 0;
+        fpsWindowStartMs = ms;
+    }
+
+    tSenderTiming *s = senderSlot(deviceID);
+    if (s->lastMs)
+    {
+        uint32_t intQ4 = (ms - s->lastMs) << 4;
+        if (s->meanIntQ4 == 0)
+        {
+            s->meanIntQ4 = intQ4;
+        }
+        else
+        {
+            int32_t dev = (int32_t)intQ4 - (int32_t)s->meanIntQ4;
+            s->meanIntQ4 += dev / 8;
+            s->jitterQ4 += ((int32_t)abs(dev) - (int32_t)s->jitterQ4) / 8;
+        }
+    }
+    s->lastMs = ms;
+    if (s->seqValid)
+    {
+        uint16_t gap = seq - s->lastSeq;
+        if ((gap >= 1) && (gap <= ESP_STATS_SEQ_GAP_MAX))
+        {
+            chStats.rxSeqHeard++;
+            chStats.rxSeqLost += gap - 1;
+            if (bulk)
+            {
+                chStats.rxSeqHeardBulk++;
+                chStats.rxSeqLostBulk += gap - 1;
+            }
+        }
+    }
+    s->lastSeq = seq;
+    s->seqValid = true;
+    portEXIT_CRITICAL(&statsMux);
+}
+
+void espStatsOnReject(tEspRejectReason reason)
+{
+    portENTER_CRITICAL(&statsMux);
+    if (reason == rejLength)
+        chStats.rejLength++;
+    else if (reason == rejProtocol)
+        chStats.rejProtocol++;
+    else
+        chStats.rejCrc++;
+    portEXIT_CRITICAL(&statsMux);
+}
+
+void espStatsOnChannel(tEspChannelEvent ev, uint8_t channel, uint8_t apChannel)
+{
+    portENTER_CRITICAL(&statsMux);
+    if (ev == ceAlign)
+        chStats.chAligns++;
+    else if (ev == ceRoam)
+        chStats.chRoams++;
+    else if (ev == ceRefused)
+        chStats.chRefused++;
+    chStats.channel = channel;
+    chStats.apChannel = apChannel;
+    portEXIT_CRITICAL(&statsMux);
+}
+
+void espStatsGet(tEspChannelStats &stats)
+{
+    uint32_t nowMs = millis();
+    uint32_t jitterSum = 0;
+    uint32_t jitterMax = 0;
+    uint16_t active = 0;
+
+    portENTER_CRITICAL(&statsMux);
+    stats = chStats;
+    for (int i = 0; i < ESP_STATS_SENDERS; i++)
+    {
+        if (!senders[i].deviceID || (nowMs - senders[i].lastMs > ESP_STATS_SENDER_AGE_MS))
+        {
+            continue;
+        }
+        active++;
+        jitterSum += senders[i].jitterQ4;
+        if (senders[i].jitterQ4 > jitterMax)
+            jitterMax = senders[i].jitterQ4;
+    }
+    portEXIT_CRITICAL(&statsMux);
+
+    tEspRxStats rxStats;
+    espGetRxStats(rxStats);
+    stats.ringDropped = rxStats.dropped;
+    stats.ringCoalesced = rxStats.coalesced;
+    stats.ringPriority = rxStats.priority;
+    stats.ringSpilled = rxStats.spilled;
+    stats.senders = active;
+    stats.jitterAvgMs = active ? (jitterSum / active) >> 4 : 0;
+    stats.jitterMaxMs = jitterMax >> 4;
+}
+
+void espStatsPrint(void)
+{
+    tEspChannelStats st;
+    espStatsGet(st);
+    Serial.println(">>>>>>>>>>>>>>> RADIO STATS <<<<<<<<<<<<<<<<<<<");
+    Serial.printf("TX ok/fail:        %lu / %lu\r\n", st.txOk, st.txFail);
+    Serial.printf("RX frames:         %lu (%u fps)\r\n", st.rxFrames, st.rxFps);
+    Serial.printf("Rejected len/proto/crc: %lu / %lu / %lu\r\n", st.rejLength, st.rejProtocol, st.rejCrc);
+    Serial.printf("Ring dropped/coalesced: %lu / %lu\r\n", st.ringDropped, st.ringCoalesced);
+    Serial.printf("Priority lane/spilled:  %lu / %lu\r\n", st.ringPriority, st.ringSpilled);
+    Serial.printf("Senders: %u, jitter avg/max: %u / %u ms\r\n", st.senders, st.jitterAvgMs, st.jitterMaxMs);
+    Serial.printf("Channel: %u (AP %u), aligns/roams/refused: %lu / %lu / %lu\r\n", st.channel, st.apChannel,
+                  st.chAligns, st.chRoams, st.chRefused);
+    Serial.printf("Seq lost/heard:    %lu / %lu, with bulk on air %lu / %lu\r\n", st.rxSeqLost, st.rxSeqHeard,
+                  st.rxSeqLostBulk, st.rxSeqHeardBulk);
+    Serial.print("RSSI histogram:");
+    for (int i = 0; i < ESP_STATS_RSSI_BINS; i++)
+    {
+        Serial.printf(" [%d]%lu", ESP_STATS_RSSI_MIN + i * ESP_STATS_RSSI_STEP, st.rssiHist[i]);
+    }
+    Serial.println();
+    Serial.println("===============================================");
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Channel quality counters for the ESP-NOW layer. Updated from the WiFi
+// task callbacks, read by the status client and the serial commander.
+
+#define ESP_STATS_RSSI_MIN      -100
+#define ESP_STATS_RSSI_STEP     5
+#define ESP_STATS_RSSI_BINS     16      // bin 0: <= -96 dBm ... bin 15: >= -25 dBm
+#define ESP_STATS_SENDERS       64      // must be a power of two
+#define ESP_STATS_FPS_WINDOW_MS 1000
+#define ESP_STATS_SENDER_AGE_MS 5000
+#define ESP_STATS_SEQ_GAP_MAX  64      // a longer seq jump is a reboot or a sender back in range, not loss
+
+enum tEspRejectReason
+{
+    rejLength   = 0,
+    rejProtocol = 1,
+    rejCrc      = 2
+};
+
+// ESP-NOW follows the access point's channel, see espRadio.cpp
+enum tEspChannelEvent
+{
+    ceSet,              // channel set up at radio start, not counted
+    ceAlign,            // moved to the AP's channel after an association
+    ceRoam,             // associated to another AP, realigned if its channel differs
+    ceRefused           // a session channel the AP is not on, kept the AP's
+};
+
+struct tEspChannelStats
+{
+    uint32_t txOk = 0;
+    uint32_t txFail = 0;
+    uint32_t rxFrames = 0;
+    uint16_t rxFps = 0;
+    uint32_t rejLength = 0;
+    uint32_t rejProtocol = 0;
+    uint32_t rejCrc = 0;
+    uint32_t ringDropped = 0;
+    uint32_t ringCoalesced = 0;
+    uint32_t ringPriority = 0;
+    uint32_t ringSpilled = 0;
+    uint16_t senders = 0;           // senders heard within ESP_STATS_SENDER_AGE_MS
+    uint16_t jitterAvgMs = 0;       // mean inter-arrival jitter over those senders
+    uint16_t jitterMaxMs = 0;
+    uint32_t rssiHist[ESP_STATS_RSSI_BINS] = {0};
+    uint8_t  channel = 0;           // ESP-NOW channel
+    uint8_t  apChannel = 0;         // channel of the AP the station is associated to, 0 = none
+    uint32_t chAligns = 0;
+    uint32_t chRoams = 0;
+    uint32_t chRefused = 0;
+    uint32_t rxSeqHeard = 0;        // frames with a seq following one already heard from the sender
+    uint32_t rxSeqLost = 0;         // seq gaps in front of them
+    uint32_t rxSeqHeardBulk = 0;    // the same while bulk WiFi traffic was on air, see espAirtime.h
+    uint32_t rxSeqLostBulk = 0;
+};
+
+void espStatsInit(void);
+void espStatsOnTx(bool ok);
+void espStatsOnRx(uint64_t deviceID, uint16_t seq, unsigned long ms, int rssi);
+void espStatsOnReject(tEspRejectReason reason);
+void espStatsOnChannel(tEspChannelEvent ev, uint8_t channel, uint8_t apChannel);
+void espStatsGet(tEspChannelStats &stats);
+void espStatsPrint(void);
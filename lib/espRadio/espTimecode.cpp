@@ -0,0 +1,274 @@
+#include "espTimecode.h"
+
+struct tClockSample
+{
+    int64_t  offsetMs;
+    uint32_t rttMs;
+    uint32_t atMs;              // millis() in the middle of the round trip
+};
+
+static int64_t          clockOffset = 0;        // at clockBaseMs, the drift runs from there
+static uint32_t         clockBaseMs = 0;
+static int32_t          driftPpm = 0;
+static tEspClockSource  clockSrc = ecsNone;
+static bool             roundTrip = false;      // the server clock comes from round trips
+static tClockSample     samples[ESP_CLOCK_SAMPLES];
+static uint8_t          sampleCount = 0;
+static uint8_t          sampleNext = 0;
+static tClockSample     driftAnchor;
+static tEspClockStats   clockStats;
+static uint8_t          showId = 0;
+static uint64_t         showStartMs = 0;        // 0: no show known
+static uint32_t         showSetMs = 0;
+static tEspShowHandler  showHandler = NULL;
+static portMUX_TYPE     tcMux = portMUX_INITIALIZER_UNLOCKED;   // radio task, WiFi task and the game loop
+
+static inline void putU64(uint8_t *buf, uint64_t v)
+{
+    for (uint8_t i = 0; i < 8; i++)
+    {
+        buf[i] = (uint8_t)(v >> (8 * i));
+    }
+}
+
+static inline uint64_t getU64(const uint8_t *buf)
+{
+    uint64_t v = 0;
+    for (uint8_t i = 0; i < 8; i++)
+    {
+        v |= (uint64_t)buf[i] << (8 * i);
+    }
+    return v;
+}
+
+// Under tcMux
+static int64_t offsetAt(uint32_t ms)
+{
+    return clockOffset + (int64_t)(int32_t)(ms - clockBaseMs) * driftPpm / 1000000;
+}
+
+void espClockServerSample(uint64_t serverMs, uint32_t sendMs, uint32_t rxMs)
+{
+    uint32_t rtt = rxMs - sendMs;
+    if ((serverMs == 0) || (rtt > ESP_CLOCK_MAX_RTT_MS))
+    {
+        return;
+    }
+    tClockSample sample;
+    sample.atMs = sendMs + rtt / 2;
+    sample.offsetMs = (int64_t)serverMs - (int64_t)sample.atMs;
+    sample.rttMs = rtt;
+    bool stepped = false;
+    portENTER_CRITICAL(&tcMux);
+    int64_t err = sample.offsetMs - offsetAt(sample.atMs);
+    if (!roundTrip || (err > ESP_CLOCK_STEP_MS) || (err < -ESP_CLOCK_STEP_MS))
+    {
+        // first round trip, or the server restarted: what was learned is void
+        stepped = roundTrip;
+        sampleCount = 0;
+        sampleNext = 0;
+        driftPpm = 0;
+        driftAnchor = sample;
+        roundTrip = true;
+    }
+    samples[sampleNext] = sample;
+    sampleNext = (sampleNext + 1) % ESP_CLOCK_SAMPLES;
+    if (sampleCount < ESP_CLOCK_SAMPLES)
+    {
+        sampleCount++;
+    }
+    const tClockSample *best = &samples[0];
+    for (uint8_t i = 1; i < sampleCount; i++)
+    {
+        if (samples[i].rttMs < best->rttMs)
+        {
+            best = &samples[i];
+        }
+    }
+    int32_t span = (int32_t)(best->atMs - driftAnchor.atMs);
+    if (span >= ESP_CLOCK_DRIFT_MIN_MS)
+    {
+        int64_t ppm = (best->offsetMs - driftAnchor.offsetMs) * 1000000 / (int64_t)span;
+        if ((ppm <= ESP_CLOCK_MAX_PPM) && (ppm >= -ESP_CLOCK_MAX_PPM))
+        {
+            driftPpm += ((int32_t)ppm - driftPpm) / 4;
+        }
+        driftAnchor = *best;
+    }
+    clockOffset = best->offsetMs;
+    clockBaseMs = best->atMs;
+    clockSrc = ecsServer;
+    clockStats.offsetMs = clockOffset;
+    clockStats.driftPpm = driftPpm;
+    clockStats.rttMs = best->rttMs;
+    clockStats.samples++;
+    if (stepped)
+    {
+        clockStats.steps++;
+    }
+    portEXIT_CRITICAL(&tcMux);
+    if (stepped)
+    {
+        Serial.printf("*** espClockServerSample WARNING! server clock moved by %lld ms\r\n", (long long)err);
+    }
+}
+
+void espClockSetServerOffset(int64_t offsetMs)
+{
+    portENTER_CRITICAL(&tcMux);
+    if (!roundTrip)
+    {
+        clockOffset = offsetMs;
+        clockBaseMs = millis();
+        driftPpm = 0;
+        clockSrc = ecsServer;
+    }
+    portEXIT_CRITICAL(&tcMux);
+}
+
+uint64_t espClockNowMs(void)
+{
+    uint32_t now = millis();
+    portENTER_CRITICAL(&tcMux);
+    int64_t offset = offsetAt(now);
+    portEXIT_CRITICAL(&tcMux);
+    return (uint64_t)((int64_t)now + offset);
+}
+
+void espClockGetStats(tEspClockStats &stats)
+{
+    portENTER_CRITICAL(&tcMux);
+    stats = clockStats;
+    portEXIT_CRITICAL(&tcMux);
+}
+
+tEspClockSource espClockSource(void)
+{
+    return clockSrc;
+}
+
+void espSetShowHandler(tEspShowHandler handler)
+{
+    showHandler = handler;
+}
+
+// False for a repeat; two devices that started the same show on their own
+// both end up on the earlier start
+static bool setShow(uint8_t id, uint64_t startMs)
+{
+    bool isNew = false;
+    portENTER_CRITICAL(&tcMux);
+    bool sameShow = (showStartMs != 0) && (showId == id) && (millis() - showSetMs < ESP_SHOW_DEDUP_MS);
+    if (!sameShow || (startMs < showStartMs))
+    {
+        showId = id;
+        showStartMs = startMs;
+        showSetMs = millis();
+        isNew = true;
+    }
+    portEXIT_CRITICAL(&tcMux);
+    return isNew;
+}
+
+uint64_t espShowStart(uint8_t id, uint32_t leadMs)
+{
+    uint64_t startMs = espClockNowMs() + leadMs;
+    if (!setShow(id, startMs))
+    {
+        // heard from another device already, its start time wins
+        portENTER_CRITICAL(&tcMux);
+        startMs = showStartMs;
+        portEXIT_CRITICAL(&tcMux);
+        return startMs;
+    }
+    Serial.printf(">>> espShowStart: show %u in %u ms\r\n", id, leadMs);
+    if (showHandler != NULL)
+    {
+        showHandler(id, startMs);
+    }
+    return startMs;
+}
+
+// Timecode from the server's clock only, a followed clock is not passed on;
+// a show goes out until it has started
+uint8_t espTimecodeBuildExt(uint8_t *buf, uint8_t bufSize)
+{
+    uint8_t len = 0;
+    uint64_t now = espClockNowMs();
+    if ((clockSrc == ecsServer) && (len + 2 + 8 <= bufSize))
+    {
+        buf[len++] = ESP_WIRE_EXT_TIMECODE;
+        buf[len++] = 8;
+        putU64(&buf[len], now);
+        len += 8;
+    }
+    portENTER_CRITICAL(&tcMux);
+    uint8_t id = showId;
+    uint64_t startMs = showStartMs;
+    portEXIT_CRITICAL(&tcMux);
+    if ((startMs > now) && (len + 2 + 9 <= bufSize))
+    {
+        buf[len++] = ESP_WIRE_EXT_SHOW;
+        buf[len++] = 9;
+        buf[len++] = id;
+        putU64(&buf[len], startMs);
+        len += 8;
+    }
+    return len;
+}
+
+// A timecode arrives late by the air and queueing time, never early: a sample
+// above the estimate is trusted quickly, one below it only slowly
+static void followTimecode(uint64_t tcMs, uint32_t rxMs)
+{
+    int64_t sample = (int64_t)tcMs + ESP_TC_AIR_MS - (int64_t)rxMs;
+    portENTER_CRITICAL(&tcMux);
+    if (clockSrc != ecsServer)
+    {
+        // a follower has no drift of its own, the timecodes carry the server's
+        driftPpm = 0;
+        int64_t err = sample - clockOffset;
+        if ((clockSrc == ecsNone) || (err > ESP_TC_RESYNC_MS) || (err < -ESP_TC_RESYNC_MS))
+        {
+            clockOffset = sample;
+            clockSrc = ecsTimecode;
+        }
+        else if (err > 0)
+        {
+            clockOffset += (err + 1) / 2;
+        }
+        else
+        {
+            clockOffset += err / 8;
+        }
+    }
+    portEXIT_CRITICAL(&tcMux);
+}
+
+void espTimecodeOnRx(const tEspWireExt &ext, uint32_t rxMs)
+{
+    if (ext.len == 0)
+    {
+        return;
+    }
+    const uint8_t *value;
+    uint8_t valueLen;
+    if (espWireFindExt(ext, ESP_WIRE_EXT_TIMECODE, value, valueLen) && (valueLen == 8))
+    {
+        followTimecode(getU64(value), rxMs);
+    }
+    if (espWireFindExt(ext, ESP_WIRE_EXT_SHOW, value, valueLen) && (valueLen == 9))
+    {
+        uint8_t id = value[0];
+        uint64_t startMs = getU64(&value[1]);
+        uint64_t now = espClockNowMs();
+        if ((startMs + ESP_SHOW_DEDUP_MS < now) || (startMs > now + ESP_SHOW_MAX_LEAD_MS))
+        {
+            return;
+        }
+        if (setShow(id, startMs) && (showHandler != NULL))
+        {
+            showHandler(id, startMs);
+        }
+    }
+}
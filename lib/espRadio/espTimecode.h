@@ -0,0 +1,63 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "espWire.h"
+
+// Shared game clock and fleet-wide shows. Devices that hear the game server
+// take its clock and put it as a timecode into their beacons; the others
+// follow the timecodes they receive. A show is a showId with a start time on
+// that clock, repeated in the beacons of everyone who knows it until it starts,
+// so every device plays it at the same moment without asking the server.
+
+#define ESP_WIRE_EXT_TIMECODE   1       // uint64 shared ms at encode time
+#define ESP_WIRE_EXT_SHOW       2       // uint8 showId, uint64 start in shared ms
+#define ESP_TC_AIR_MS           1       // encode to RX callback of a short frame at 1 Mbps
+#define ESP_TC_RESYNC_MS        100     // a timecode further off than this replaces the estimate
+#define ESP_SHOW_DEDUP_MS       5000    // a show started again this soon keeps the first start time
+#define ESP_SHOW_MAX_LEAD_MS    10000   // shows further ahead are taken as garbage
+
+// Server clock from the game API round trips, NTP style: each exchange gives
+// an offset (server time against the middle of the round trip) that is off
+// by at most half its round trip; the offset of the fastest of the last
+// ESP_CLOCK_SAMPLES exchanges is taken, and the drift of the crystal against
+// the server's is measured between such offsets far enough apart
+#define ESP_CLOCK_SAMPLES       8
+#define ESP_CLOCK_MAX_RTT_MS    1000    // slower exchanges say little about the clock
+#define ESP_CLOCK_STEP_MS       1000    // a sample this far off the estimate is a new server clock
+#define ESP_CLOCK_DRIFT_MIN_MS  30000   // offsets this far apart give a drift sample
+#define ESP_CLOCK_MAX_PPM       500     // any more is a clock jump, not a crystal
+
+enum tEspClockSource
+{
+    ecsNone = 0,        // millis()
+    ecsTimecode,        // timecodes heard over ESP-NOW
+    ecsServer           // the game server's response
+};
+
+typedef void (*tEspShowHandler)(uint8_t showId, uint64_t startMs);
+
+struct tEspClockStats
+{
+    int64_t  offsetMs;          // shared = millis() + offset, at the last estimate
+    int32_t  driftPpm;          // server clock against millis()
+    uint32_t rttMs;             // round trip of the sample the offset comes from
+    uint32_t samples;
+    uint32_t steps;             // estimates dropped for a new server clock
+};
+
+// A game API exchange: server_ms of the response, millis() when the request
+// went out and when the response was in
+void            espClockServerSample(uint64_t serverMs, uint32_t sendMs, uint32_t rxMs);
+// One way (pushed or multicast state), only until a round trip is known
+void            espClockSetServerOffset(int64_t offsetMs);  // shared = millis() + offset
+uint64_t        espClockNowMs(void);
+tEspClockSource espClockSource(void);
+void            espClockGetStats(tEspClockStats &stats);
+
+// Called once per new show; the handler runs in the WiFi task, keep it short
+void     espSetShowHandler(tEspShowHandler handler);
+uint64_t espShowStart(uint8_t showId, uint32_t leadMs);    // the start time used
+
+uint8_t  espTimecodeBuildExt(uint8_t *buf, uint8_t bufSize);
+void     espTimecodeOnRx(const tEspWireExt &ext, uint32_t rxMs);
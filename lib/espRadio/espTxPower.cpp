@@ -0,0 +1,114 @@
+#include "espTxPower.h"
+
+#include <esp_wifi.h>
+
+// Density is counted as distinct senders per period in a 64 bit set of
+// sender ID hashes; a collision only undercounts a crowd by one
+
+static portMUX_TYPE txpMux = portMUX_INITIALIZER_UNLOCKED;
+static uint64_t strongSet = 0;          // WiFi task sets, the radio task takes
+static int8_t ceilingPower = WIFI_TX_POWER;
+static volatile int8_t curPower = WIFI_TX_POWER;
+static uint8_t density = 0;
+static uint32_t periodMs = 0;
+
+static void applyPower(int8_t power, uint8_t strong)
+{
+    if (power == curPower)
+    {
+        return;
+    }
+    if (esp_wifi_set_max_tx_power(power) != ESP_OK)
+    {
+        Serial.printf("!!! espTxPowerService ERROR: esp_wifi_set_max_tx_power(%d)\r\n", power);
+        return;
+    }
+    Serial.printf(">>> espTxPowerService: %d -> %d (%u strong neighbours)\r\n", curPower, power, strong);
+    curPower = power;
+}
+
+void espTxPowerSetCeiling(int8_t power)
+{
+    ceilingPower = power;
+    curPower = power;
+    periodMs = millis();
+}
+
+int8_t espTxPowerCurrent(void)
+{
+    return curPower;
+}
+
+uint8_t espTxPowerDensity(void)
+{
+    return density;
+}
+
+void espTxPowerService(tGameRole selfRole)
+{
+    uint32_t now = millis();
+    if (now - periodMs < ESP_TXPC_PERIOD_MS)
+    {
+        return;
+    }
+    periodMs = now;
+    portENTER_CRITICAL(&txpMux);
+    uint64_t set = strongSet;
+    strongSet = 0;
+    portEXIT_CRITICAL(&txpMux);
+    density = __builtin_popcountll(set);
+
+    if (!ESP_TXPC_ENABLE || (selfRole == grBase) || (selfRole == grApPortalBeacon) || (selfRole == grServer))
+    {
+        applyPower(ceilingPower, density);
+        return;
+    }
+    int floorPower = ceilingPower - ESP_TXPC_MAX_CUT;
+    if ((density >= ESP_TXPC_DENSE) && (curPower > floorPower))
+    {
+        applyPower((int8_t)max(floorPower, curPower - ESP_TXPC_STEP), density);
+    }
+    else if ((density <= ESP_TXPC_SPARSE) && (curPower < ceilingPower))
+    {
+        applyPower((int8_t)min((int)ceilingPower, curPower + ESP_TXPC_STEP), density);
+    }
+}
+
+uint8_t espTxPowerBuildExt(uint8_t *buf, uint8_t bufSize)
+{
+    int8_t power = curPower;
+    if ((power == WIFI_TX_POWER) || (bufSize < 3))
+    {
+        return 0;
+    }
+    buf[0] = ESP_WIRE_EXT_TXPOWER;
+    buf[1] = 1;
+    buf[2] = (uint8_t)power;
+    return 3;
+}
+
+int espTxPowerNormalize(const tEspWireExt &ext, int rssi)
+{
+    const uint8_t *value;
+    uint8_t valueLen;
+    if ((ext.len == 0) || !espWireFindExt(ext, ESP_WIRE_EXT_TXPOWER, value, valueLen) || (valueLen < 1))
+    {
+        return rssi;
+    }
+    // what the frame would have come in with at the reference power, rounded
+    int cut = WIFI_TX_POWER - (int8_t)value[0];
+    return rssi + ((cut >= 0) ? (cut + 2) / 4 : (cut - 2) / 4);
+}
+
+void espTxPowerOnRx(const tEspPacket &pkt, int rssi)
+{
+    if (rssi < ESP_TXPC_STRONG_RSSI)
+    {
+        return;
+    }
+    uint64_t id = pkt.deviceID;
+    uint8_t bit = (uint8_t)(id ^ (id >> 6) ^ (id >> 12) ^ (id >> 18) ^ (id >> 24) ^ (id >> 30) ^ (id >> 36) ^ (id >> 42)) & 0x3F;
+    portENTER_CRITICAL(&txpMux);
+    strongSet |= 1ULL << bit;
+    portEXIT_CRITICAL(&txpMux);
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "espPacket.h"
+#include "espWire.h"
+
+// Adaptive TX power. A player in a dense cluster steps its power down, a
+// lonely one back up towards its role profile's ceiling, so crowds stop
+// flooding each other at full power. Every frame below the fleet reference
+// WIFI_TX_POWER says so in an extension and the receiver adds the difference
+// back to the RSSI right in the receive callback, before anything classifies
+// zones, so a neighbour's distance reads the same whatever its power. Bases,
+// portals and servers keep the ceiling: their reach is the edge of their zone.
+
+#define ESP_WIRE_EXT_TXPOWER    13      // int8 sender's TX power, 0.25 dBm units; absent = WIFI_TX_POWER
+#ifndef ESP_TXPC_ENABLE
+#define ESP_TXPC_ENABLE         1
+#endif
+#define ESP_TXPC_PERIOD_MS      5000    // one density count and at most one step per period
+#define ESP_TXPC_STEP           8       // 2 dB
+#define ESP_TXPC_MAX_CUT        24      // 6 dB below the ceiling at most, the far zone stays above the sensitivity floor
+#define ESP_TXPC_STRONG_RSSI    -65     // normalized, a neighbour this close counts towards the density
+#define ESP_TXPC_DENSE          10      // strong neighbours to step down
+#define ESP_TXPC_SPARSE         4       // and to step back up
+
+void    espTxPowerSetCeiling(int8_t power);     // from the radio profile, also resets to it
+int8_t  espTxPowerCurrent(void);
+uint8_t espTxPowerDensity(void);                // strong neighbours of the last period
+void    espTxPowerService(tGameRole selfRole);  // radio task
+
+uint8_t espTxPowerBuildExt(uint8_t *buf, uint8_t bufSize);
+int     espTxPowerNormalize(const tEspWireExt &ext, int rssi);                  // WiFi task
+void    espTxPowerOnRx(const tEspPacket &pkt, int rssi);                        // WiFi task, normalized RSSI
@@ -0,0 +1,196 @@
+#include "espWire.h"
+
+#include <esp_rom_crc.h>
+
+static inline void putField(uint8_t *buf, tWireFieldId id, int32_t value)
+{
+    const tWireField &f = espWireFields[id];
+    for (uint8_t i = 0; i < f.size; i++)
+    {
+        buf[f.offset + i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+static inline int32_t getField(const uint8_t *buf, tWireFieldId id)
+{
+    const tWireField &f = espWireFields[id];
+    uint32_t v = 0;
+    for (uint8_t i = 0; i < f.size; i++)
+    {
+        v |= (uint32_t)buf[f.offset + i] << (8 * i);
+    }
+    if (f.isSigned && (f.size < 4) && (v & (1UL << (8 * f.size - 1))))
+    {
+        v |= ~0UL << (8 * f.size);
+    }
+    return (int32_t)v;
+}
+
+static inline int16_t clampHit(int hit)
+{
+    return (int16_t)constrain(hit, INT16_MIN, INT16_MAX);
+}
+
+uint16_t espWireEncode(const tEspPacket *pkt, uint8_t *buf, uint16_t bufSize, const uint8_t *ext, uint8_t extLen)
+{
+    if (extLen > ESP_WIRE_MAX_EXT)
+    {
+        return 0;
+    }
+    if (bufSize < espWireFixedLen() + 10 + extLen + ESP_WIRE_CRC_LEN)
+    {
+        return 0;
+    }
+
+    putField(buf, wfTag, espWireTag());
+    putField(buf, wfVersion, ESP_WIRE_VERSION);
+    putField(buf, wfRole, (uint8_t)pkt->deviceRole);
+    putField(buf, wfSeq, (uint16_t)pkt->packetID);
+    putField(buf, wfHitNear, clampHit(pkt->hitPointsNear));
+    putField(buf, wfHitMiddle, clampHit(pkt->hitPointsMiddle));
+    putField(buf, wfHitFar, clampHit(pkt->hitPointsFar));
+    putField(buf, wfExtLen, extLen);
+
+    uint16_t pos = espWireFixedLen();
+    uint64_t id = pkt->deviceID;
+    do
+    {
+        uint8_t b = id & 0x7F;
+        id >>= 7;
+        buf[pos++] = id ? (b | 0x80) : b;
+    } while (id);
+
+    if (extLen)
+    {
+        memcpy(&buf[pos], ext, extLen);
+        pos += extLen;
+    }
+
+    uint32_t crc = esp_rom_crc32_le(0, buf, pos);
+    for (uint8_t i = 0; i < ESP_WIRE_CRC_LEN; i++)
+    {
+        buf[pos++] = (uint8_t)(crc >> (8 * i));
+    }
+    return pos;
+}
+
+bool espWireDecode(const uint8_t *buf, int len, tEspPacket *pkt, tEspWireExt *ext, tEspRejectReason *reason)
+{
+    tEspRejectReason dummy;
+    if (reason == NULL)
+    {
+        reason = &dummy;
+    }
+    *reason = rejLength;
+    if ((len < espWireFixedLen() + 1 + ESP_WIRE_CRC_LEN) || (len > ESP_WIRE_MAX_LEN))
+    {
+        return false;
+    }
+    *reason = rejProtocol;
+    if ((uint16_t)getField(buf, wfTag) != espWireTag())
+    {
+        return false;
+    }
+    if (getField(buf, wfVersion) != ESP_WIRE_VERSION)
+    {
+        return false;
+    }
+
+    int dataLen = len - ESP_WIRE_CRC_LEN;
+    uint32_t rxCrc = 0;
+    for (uint8_t i = 0; i < ESP_WIRE_CRC_LEN; i++)
+    {
+        rxCrc |= (uint32_t)buf[dataLen + i] << (8 * i);
+    }
+    *reason = rejCrc;
+    if (esp_rom_crc32_le(0, buf, dataLen) != rxCrc)
+    {
+        return false;
+    }
+    *reason = rejLength;
+
+    int pos = espWireFixedLen();
+    uint64_t id = 0;
+    uint8_t shift = 0;
+    while (true)
+    {
+        if ((pos >= dataLen) || (shift > 63))
+        {
+            return false;
+        }
+        uint8_t b = buf[pos++];
+        id |= (uint64_t)(b & 0x7F) << shift;
+        shift += 7;
+        if (!(b & 0x80))
+        {
+            break;
+        }
+    }
+
+    uint8_t extLen = (uint8_t)getField(buf, wfExtLen);
+    if (pos + extLen != dataLen)
+    {
+        return false;
+    }
+
+    pkt->crc32           = rxCrc;
+    pkt->espProtocolID   = espGetProtocolId();
+    pkt->deviceID        = id;
+    pkt->packetID        = (uint16_t)getField(buf, wfSeq);
+    pkt->deviceRole      = (tGameRole)getField(buf, wfRole);
+    pkt->hitPointsNear   = getField(buf, wfHitNear);
+    pkt->hitPointsMiddle = getField(buf, wfHitMiddle);
+    pkt->hitPointsFar    = getField(buf, wfHitFar);
+
+    if (ext)
+    {
+        ext->data = extLen ? &buf[pos] : NULL;
+        ext->len  = extLen;
+    }
+    return true;
+}
+
+// Legacy frames: CRC over everything after the crc32 field
+uint32_t espPacketCrc(const tEspPacket *pkt)
+{
+    const uint8_t *p = (const uint8_t *)pkt;
+    return esp_rom_crc32_le(0, p + sizeof(pkt->crc32), sizeof(tEspPacket) - sizeof(pkt->crc32));
+}
+
+void espPacketSetCrc(tEspPacket *pkt)
+{
+    pkt->crc32 = espPacketCrc(pkt);
+}
+
+bool espPacketCheckCrc(const tEspPacket *pkt)
+{
+#if ESP_CRC_ALLOW_UNSET
+    if (pkt->crc32 == 0)
+    {
+        return true;
+    }
+#endif
+    return pkt->crc32 == espPacketCrc(pkt);
+}
+
+bool espWireFindExt(const tEspWireExt &ext, uint8_t type, const uint8_t *&value, uint8_t &valueLen)
+{
+    uint8_t pos = 0;
+    while (pos + 2 <= ext.len)
+    {
+        uint8_t t = ext.data[pos];
+        uint8_t l = ext.data[pos + 1];
+        if (pos + 2 + l > ext.len)
+        {
+            return false;
+        }
+        if (t == type)
+        {
+            value = &ext.data[pos + 2];
+            valueLen = l;
+            return true;
+        }
+        pos += 2 + l;
+    }
+    return false;
+}
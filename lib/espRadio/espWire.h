@@ -0,0 +1,103 @@
+#ifndef __ESP_WIRE_H__
+#define __ESP_WIRE_H__
+
+#include <Arduino.h>
+
+#include "espPacket.h"
+#include "espStats.h"
+
+// Compact on-air encoding of tEspPacket (wire version 2).
+//
+//  off size field
+//   0   2   tag       espWireTag(), 16 bit digest of the session protocol ID
+//   2   1   version   ESP_WIRE_VERSION
+//   3   1   role      tGameRole
+//   4   2   seq       low 16 bits of packetID
+//   6   2   hitNear   int16
+//   8   2   hitMiddle int16
+//  10   2   hitFar    int16
+//  12   1   extLen    bytes of TLV extensions after the device ID
+//  13 1-10  deviceID  LEB128 varint
+//   .  ext  TLV area  {type, len, value[len]}...
+//   .   4   crc32     esp_rom_crc32_le over all bytes before it
+//
+// Legacy (version 1) frames are the raw packed tEspPacket and are still
+// accepted on RX. ESP_WIRE_TX_VERSION selects what is sent.
+
+inline uint16_t espWireTag(void)
+{
+    uint32_t id = espGetProtocolId();
+    return (uint16_t)(id ^ (id >> 16));
+}
+#define ESP_WIRE_VERSION        2
+#ifndef ESP_WIRE_TX_VERSION
+#define ESP_WIRE_TX_VERSION     ESP_WIRE_VERSION
+#endif
+#define ESP_WIRE_MAX_EXT        127     // TX power, timecode, show, a gateway report, relayed server state and a neighbour summary
+#define ESP_WIRE_CRC_LEN        4
+#define ESP_WIRE_MAX_LEN        (13 + 10 + ESP_WIRE_MAX_EXT + ESP_WIRE_CRC_LEN)
+
+// Old firmware never filled tEspPacket.crc32, accept those legacy frames
+// until the fleet is updated
+#ifndef ESP_CRC_ALLOW_UNSET
+#define ESP_CRC_ALLOW_UNSET     1
+#endif
+
+enum tWireFieldId
+{
+    wfTag = 0,
+    wfVersion,
+    wfRole,
+    wfSeq,
+    wfHitNear,
+    wfHitMiddle,
+    wfHitFar,
+    wfExtLen,
+    wfCount
+};
+
+struct tWireField
+{
+    uint8_t offset;
+    uint8_t size;
+    bool    isSigned;
+};
+
+constexpr tWireField espWireFields[wfCount] =
+{
+    {0,  2, false},     // tag
+    {2,  1, false},     // version
+    {3,  1, false},     // role
+    {4,  2, false},     // seq
+    {6,  2, true},      // hitNear
+    {8,  2, true},      // hitMiddle
+    {10, 2, true},      // hitFar
+    {12, 1, false},     // extLen
+};
+
+constexpr uint8_t espWireFixedLen(void)
+{
+    return espWireFields[wfCount - 1].offset + espWireFields[wfCount - 1].size;
+}
+
+static_assert(espWireFixedLen() == 13, "wire v2 fixed header size changed");
+
+// TLV extension types, timecode and show in espTimecode.h, gateway ones in espGateway.h,
+// relay in espRelay.h, hit stamp in espHitStamp.h, neighbour summary in espNeighbors.h,
+// TX power in espTxPower.h
+#define ESP_WIRE_EXT_NONE       0
+
+struct tEspWireExt
+{
+    const uint8_t  *data = NULL;    // points into the received frame
+    uint8_t         len  = 0;
+};
+
+uint16_t espWireEncode(const tEspPacket *pkt, uint8_t *buf, uint16_t bufSize, const uint8_t *ext = NULL, uint8_t extLen = 0);
+bool     espWireDecode(const uint8_t *buf, int len, tEspPacket *pkt, tEspWireExt *ext = NULL, tEspRejectReason *reason = NULL);
+uint32_t espPacketCrc(const tEspPacket *pkt);
+void     espPacketSetCrc(tEspPacket *pkt);
+bool     espPacketCheckCrc(const tEspPacket *pkt);
+bool     espWireFindExt(const tEspWireExt &ext, uint8_t type, const uint8_t *&value, uint8_t &valueLen);
+
+#endif
@@ -1,4 +1,5 @@
 #include "ledPlayer.h"
+#include "fsMount.h"
 
 void tLedPlayer::print(void)
 {
@@ -29,12 +30,12 @@ bool tLedPlayer::loadFromJsonFile(void)
         
     loaded = true; 
 
-    if(!LittleFS.begin(true, "/spiffs", 2))
-        if(!LittleFS.begin(true, "/spiffs", 2))
-        {
-            Serial.println("!!! tLedPlayer::loadFromJsonFile: ERROR while mounting SPIFFS!");    
-            return false;
-        }      
+    tFsHandle fs(true);
+    if (!fs.ok())
+    {
+        Serial.println("!!! tLedPlayer::loadFromJsonFile: ERROR while mounting SPIFFS!");    
+        return false;
+    }      
 
     File f = LittleFS.open(LED_FILE_NAME, "r");
     if (!f)
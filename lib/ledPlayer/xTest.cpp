@@ -1,4 +1,5 @@
 #include "ledPlayer.h"
+#include "taskRegistry.h"
 
 void ledTest(void)
 {
@@ -60,13 +61,5 @@ void ledTestTask(void*)
 
 void startLedTestTask(void)
 {
-    xTaskCreatePinnedToCore(
-    ledTestTask,             /* Function to implement the task */
-    "edTestTask",           /* Name of the task */
-    10000,                  /* Stack size in words */
-    NULL,                  /* Task input parameter */
-    3, /* Priority of the task */
-    NULL,                  /* Task handle. */
-    1                      /* Core where the task should run */
-);
+    taskStart(tkLedTest, ledTestTask);
 }
\ No newline at end of file
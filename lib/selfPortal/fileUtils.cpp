@@ -1,23 +1,89 @@
 #include <LittleFS.h>
 #include <ESPAsyncWebServer.h>
+#include <memory>
 
+#include "fsWorker.h"
+
+// All LittleFS work of these handlers runs on the fs worker, see fsWorker.h
+
+#define DIR_LIST_ENTRY_MAX  (2 * 64 + 4)    // an escaped LittleFS name, quotes and comma
+
+// Lister state across the chunk callbacks, an entry that does not fit waits in pending
+struct tDirLister
+{
+    File     root;
+    bool     first = true;
+    bool     done = false;
+    char     pending[DIR_LIST_ENTRY_MAX];
+    uint16_t pendLen = 0;
+    uint16_t pendPos = 0;
+};
+
+static void dirListNext(tDirLister &st)
+{
+    st.pendLen = 0;
+    st.pendPos = 0;
+    File file = st.root ? st.root.openNextFile() : File();
+    if (!file)
+    {
+        st.pending[st.pendLen++] = ']';
+        st.done = true;
+        return;
+    }
+    if (!st.first)
+    {
+        st.pending[st.pendLen++] = ',';
+    }
+    st.first = false;
+    st.pending[st.pendLen++] = '"';
+    for (const char *c = file.name(); *c && (st.pendLen < sizeof(st.pending) - 2); c++)
+    {
+        if ((*c == '"') || (*c == '\\'))
+        {
+            st.pending[st.pendLen++] = '\\';
+        }
+        if ((uint8_t)*c >= 0x20)
+        {
+            st.pending[st.pendLen++] = *c;
+        }
+    }
+    st.pending[st.pendLen++] = '"';
+}
+
+// JSON array of the names, one directory entry per step, nothing held but the entry
 void listFiles(AsyncWebServerRequest *request) 
 {
     Serial.println(">>> listFiles");
-    String json = "[";
-    File root = LittleFS.open("/");
-    File file = root.openNextFile();
-    bool first = true;
-    
-    while(file) {
-        if(!first) json += ",";
-        json += "\"" + String(file.name()) + "\"";
-        first = false;
-        file = root.openNextFile();
-    }
-    json += "]";
-    
-    request->send(200, "application/json", json);
+    fsReply(request, [](tFsReply &r)
+    {
+        std::shared_ptr<tDirLister> st = std::make_shared<tDirLister>();
+        st->root = LittleFS.open("/");
+        st->pending[0] = '[';
+        st->pendLen = 1;
+        r.code = 200;
+        r.contentType = "application/json";
+        r.stream = [st](uint8_t *buf, size_t maxLen) -> size_t
+        {
+            size_t len = 0;
+            while (len < maxLen)
+            {
+                if (st->pendPos < st->pendLen)
+                {
+                    size_t n = min(maxLen - len, (size_t)(st->pendLen - st->pendPos));
+                    memcpy(&buf[len], &st->pending[st->pendPos], n);
+                    st->pendPos += n;
+                    len += n;
+                    continue;
+                }
+                if (st->done)
+                {
+                    break;
+                }
+                dirListNext(*st);
+            }
+            return len;
+        };
+    });
 }
 
 void getFile(AsyncWebServerRequest *request) 
@@ -31,48 +97,98 @@ void getFile(AsyncWebServerRequest *request)
     String filename = request->getParam("file")->value();
     if(!filename.startsWith("/")) filename = "/" + filename;
     
-    if(LittleFS.exists(filename)) {
-        File file = LittleFS.open(filename, "r");
-        String content = file.readString();
-        file.close();
-        request->send(200, "application/json", content);
-    } 
-    else 
+    fsSendFile(request, LittleFS, filename, false);
+}
+
+// One save at a time, like the uploads: the body goes to a temp file as it
+// arrives and replaces the file only once all of it is on flash
+static tFsWriteRef saveWrite;
+static size_t   saveQueued = 0;
+static AsyncWebServerRequest *saveOwner = NULL;
+
+void saveFileBody(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total)
+{
+    if (index == 0)
     {
-        request->send(404, "text/plain", "File not found");
+        if (saveWrite)
+        {
+            // a save that never finished
+            fsWriteAbort(saveWrite);
+            saveWrite = NULL;
+        }
+        saveOwner = request;
+        saveQueued = 0;
+        if (request->hasParam("file"))
+        {
+            String path = request->getParam("file")->value();
+            if (!path.startsWith("/")) path = "/" + path;
+            saveWrite = fsWriteOpen(LittleFS, path, true);
+        }
+    }
+    if ((request != saveOwner) || !saveWrite)
+    {
+        return;
     }
+    if (!fsWriteChunk(saveWrite, data, len))
+    {
+        Serial.printf("!!! saveFileBody ERROR: no room for %u bytes at %u of %u\r\n", len, index, total);
+    }
+    saveQueued += len;
 }
 
 void saveFile(AsyncWebServerRequest *request) 
 {
     Serial.println(">>> saveFile");
-    if(!request->hasParam("file", true) || !request->hasParam("data", true)) 
+    if(!request->hasParam("file")) 
     {
         request->send(400, "text/plain", "Missing parameters");
         return;
     }
     
-    String filename = request->getParam("file", true)->value();
-    String data = request->getParam("data", true)->value();
-    
+    String filename = request->getParam("file")->value();
     if(!filename.startsWith("/")) filename = "/" + filename;
-    
-    File file = LittleFS.open(filename, "w");
-    if(file) 
+
+    // an empty body never reaches saveFileBody
+    if (request->contentLength() == 0)
     {
-        file.print(data);
-        file.close();
-        request->send(200, "text/plain", "File saved successfully");
-    } 
-    else 
+        fsReply(request, [filename](tFsReply &r)
+        {
+            File file = LittleFS.open(filename, "w");
+            r.text(file ? 200 : 500, file ? "File saved successfully" : "Error saving file");
+        });
+        return;
+    }
+    if ((request != saveOwner) || !saveWrite || (saveQueued != request->contentLength()))
     {
+        if (request == saveOwner)
+        {
+            if (saveWrite)
+            {
+                fsWriteAbort(saveWrite);
+            }
+            saveWrite = NULL;
+            saveOwner = NULL;
+        }
         request->send(500, "text/plain", "Error saving file");
+        return;
     }
+    tFsWriteRef w = saveWrite;
+    saveWrite = NULL;
+    saveOwner = NULL;
+    fsReply(request, [w](tFsReply &r)
+    {
+        if (!fsWriteClose(*w))
+        {
+            r.text(500, "Error saving file");
+            return;
+        }
+        Serial.printf(">>> saveFile: [%s] %u bytes\r\n", w->path.c_str(), w->written);
+        r.text(200, "File saved successfully");
+    });
 }
 
-void handleFileManager(AsyncWebServerRequest *request) 
+static void fileManagerPage(tFsReply &r)
 {
-    Serial.println(">>> handleFileManager");
     String html = "<html><body><h1>File manager</h1>";
     html += "<p><a href='/'>Back to main</a></p>";
 
@@ -111,7 +227,14 @@ void handleFileManager(AsyncWebServerRequest *request)
     html += "</form>";
 
     html += "</body></html>";
-    request->send(200, "text/html", html);
+    r.contentType = "text/html";
+    r.text(200, html);
+}
+
+void handleFileManager(AsyncWebServerRequest *request) 
+{
+    Serial.println(">>> handleFileManager");
+    fsReply(request, fileManagerPage);
 }
 
 void handleDelete(AsyncWebServerRequest *request) 
@@ -121,21 +244,21 @@ void handleDelete(AsyncWebServerRequest *request)
     {
         String fileName = request->getParam("file")->value();
         String path = "/" + fileName;
-        if (LittleFS.exists(path)) 
+        fsReply(request, [path](tFsReply &r)
         {
-            if (LittleFS.remove(path)) 
+            if (!LittleFS.exists(path))
+            {
+                r.text(404, "File not found");
+            }
+            else if (LittleFS.remove(path))
             {
-                request->redirect("/files"); 
-            } 
-            else 
+                r.redirect("/files");
+            }
+            else
             {
-                request->send(500, "text/plain", "Error while deleting the file");
+                r.text(500, "Error while deleting the file");
             }
-        } 
-        else 
-        {
-            request->send(404, "text/plain", "File not found");
-        }
+        });
     } 
     else 
     {
@@ -150,14 +273,7 @@ void handleDownload(AsyncWebServerRequest *request)
     {
         String fileName = request->getParam("file")->value();
         String path = "/" + fileName;
-        if (LittleFS.exists(path)) 
-        {
-            request->send(SPIFFS, path, String(), true);
-        } 
-        else 
-        {
-            request->send(404, "text/plain", "File not found");
-        }
+        fsSendFile(request, LittleFS, path, true);
     } 
     else 
     {
@@ -166,41 +282,52 @@ void handleDownload(AsyncWebServerRequest *request)
 }
   
 
+// Written straight to the file, the response waits for the last chunk on flash
+static tFsWriteRef uploadWrite;
+
 void handleUploadResponse(AsyncWebServerRequest *request) 
 {
     Serial.println(">>> handleUploadResponse");
-    String html = "<html><body>";
-    html += "<h2>File upload successfully</h2>";
-    html += "<p><a href='/files'>BACK</a></p>";
-    html += "</body></html>";
-    request->send(200, "text/html", html);
+    if (!uploadWrite)
+    {
+        request->send(400, "text/plain", "No file uploaded");
+        return;
+    }
+    tFsWriteRef w = uploadWrite;
+    uploadWrite = NULL;
+    fsReply(request, [w](tFsReply &r)
+    {
+        if (!fsWriteClose(*w))
+        {
+            r.text(500, "Error uploading file");
+            return;
+        }
+        Serial.println(">>> File uploaded: " + w->path);
+        String html = "<html><body>";
+        html += "<h2>File upload successfully</h2>";
+        html += "<p><a href='/files'>BACK</a></p>";
+        html += "</body></html>";
+        r.contentType = "text/html";
+        r.text(200, html);
+    });
 }
   
   
 void handleUploadProcess(AsyncWebServerRequest *request, String filename, size_t index, uint8_t *data, size_t len, bool final) 
 {
-    Serial.println(">>> handleUploadResponse");
-    static File uploadFile;
-
     if (!index) 
     {  
-        String path = "/" + filename;
-        uploadFile = LittleFS.open(path, FILE_WRITE);
-        if (!uploadFile) 
+        Serial.println(">>> handleUploadProcess");
+        if (uploadWrite)
         {
-            Serial.println("!!! handleUploadProcess. file write ERROR: " + path);
-            return;
+            // an upload that never finished
+            fsWriteAbort(uploadWrite);
         }
+        uploadWrite = fsWriteOpen(LittleFS, "/" + filename, false);
     }
 
-    if (len) 
+    if (len && uploadWrite && !fsWriteChunk(uploadWrite, data, len)) 
     {  
-        uploadFile.write(data, len);
+        Serial.println("!!! handleUploadProcess. file write ERROR: " + filename);
     }
-
-    if (final) 
-    {  
-        uploadFile.close();
-        Serial.println(">>> File uploaded: " + filename);
-    }
-}
\ No newline at end of file
+}
@@ -0,0 +1,465 @@
+#include "fsWorker.h"
+#include "taskRegistry.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <time.h>
+
+struct tFsJob
+{
+    std::function<void(tFsJob &job)> work;
+    uint8_t *data = NULL;       // body chunk, owned
+    size_t   len = 0;
+    ~tFsJob() { free(data); }
+};
+
+// A reply on its way: written by the worker until done, the two read ahead
+// blocks then change hands through blkFull
+struct tFsOp
+{
+    tFsReply      reply;
+    volatile bool done = false;
+    volatile bool abandoned = false;    // the request went away
+    bool          streamed = false;
+    uint8_t      *buf = NULL;
+    uint16_t      blkLen[2] = {0, 0};
+    bool          blkFull[2] = {false, false};
+    bool          eof = false;
+    bool          refillQueued = false;
+    uint8_t       fillIdx = 0;          // worker only
+    uint8_t       drainIdx = 0;         // async_tcp only
+    uint16_t      drainPos = 0;
+    ~tFsOp() { free(buf); }
+};
+typedef std::shared_ptr<tFsOp> tFsOpRef;
+
+static QueueHandle_t fsQueue = NULL;
+static portMUX_TYPE fsMux = portMUX_INITIALIZER_UNLOCKED;
+
+static bool fsSubmit(tFsJob *job, TickType_t waitTicks)
+{
+    if ((fsQueue == NULL) || (xQueueSend(fsQueue, &job, waitTicks) != pdTRUE))
+    {
+        delete job;
+        return false;
+    }
+    return true;
+}
+
+// Fills the free blocks, stops early once the request went away
+static void fsFillAhead(tFsOp &op)
+{
+    portENTER_CRITICAL(&fsMux);
+    op.refillQueued = false;
+    portEXIT_CRITICAL(&fsMux);
+    while (!op.abandoned && !op.eof)
+    {
+        uint8_t i = op.fillIdx;
+        portENTER_CRITICAL(&fsMux);
+        bool full = op.blkFull[i];
+        portEXIT_CRITICAL(&fsMux);
+        if (full)
+        {
+            break;
+        }
+        size_t n = op.reply.stream(&op.buf[i * FS_WORKER_BLOCK], FS_WORKER_BLOCK);
+        portENTER_CRITICAL(&fsMux);
+        op.blkLen[i] = n;
+        op.blkFull[i] = (n > 0);
+        op.eof = (n == 0);
+        portEXIT_CRITICAL(&fsMux);
+        op.fillIdx = i ^ 1;
+    }
+    if (op.eof || op.abandoned)
+    {
+        // closes the file on this task
+        op.reply.stream = nullptr;
+    }
+}
+
+// Keeps back the status and headers until the worker is done, then sends
+// the reply's body or the blocks it reads ahead
+class tFsResponse: public AsyncAbstractResponse
+{
+    public:
+        tFsResponse(const tFsOpRef &op) : _op(op), _bodyPos(0) {}
+        ~tFsResponse()
+        {
+            _op->abandoned = true;
+            if (_op->streamed && !_op->eof)
+            {
+                tFsOpRef op = _op;
+                tFsJob *job = new tFsJob;
+                job->work = [op](tFsJob &) { op->reply.stream = nullptr; };
+                fsSubmit(job, 0);
+            }
+        }
+        bool _sourceValid() const { return true; }
+        void _respond(AsyncWebServerRequest *request)
+        {
+            if (_op->done)
+            {
+                begin(request);
+            }
+        }
+        size_t _ack(AsyncWebServerRequest *request, size_t len, uint32_t time)
+        {
+            if (_state == RESPONSE_SETUP)
+            {
+                if (_op->done)
+                {
+                    begin(request);
+                }
+                return 0;
+            }
+            return AsyncAbstractResponse::_ack(request, len, time);
+        }
+        size_t _fillBuffer(uint8_t *data, size_t len);
+
+    private:
+        tFsOpRef _op;
+        size_t   _bodyPos;
+        void begin(AsyncWebServerRequest *request);
+        void refill(void);
+};
+
+void tFsResponse::begin(AsyncWebServerRequest *request)
+{
+    tFsReply &r = _op->reply;
+    _code = r.code;
+    _contentType = r.contentType;
+    for (uint8_t i = 0; i < r.hdrCount; i++)
+    {
+        addHeader(r.hdrName[i], r.hdrValue[i]);
+    }
+    if (_op->streamed && (r.length == 0))
+    {
+        _contentLength = 0;
+        _sendContentLength = false;
+        _chunked = request->version();
+    }
+    else
+    {
+        _contentLength = _op->streamed ? r.length : r.body.length();
+    }
+    AsyncAbstractResponse::_respond(request);
+}
+
+void tFsResponse::refill(void)
+{
+    bool queue = false;
+    portENTER_CRITICAL(&fsMux);
+    if (!_op->eof && !_op->refillQueued && !(_op->blkFull[0] && _op->blkFull[1]))
+    {
+        _op->refillQueued = queue = true;
+    }
+    portEXIT_CRITICAL(&fsMux);
+    if (!queue)
+    {
+        return;
+    }
+    tFsOpRef op = _op;
+    tFsJob *job = new tFsJob;
+    job->work = [op](tFsJob &) { fsFillAhead(*op); };
+    if (!fsSubmit(job, 0))
+    {
+        // the next call tries again
+        portENTER_CRITICAL(&fsMux);
+        _op->refillQueued = false;
+        portEXIT_CRITICAL(&fsMux);
+    }
+}
+
+size_t tFsResponse::_fillBuffer(uint8_t *data, size_t len)
+{
+    tFsOp &op = *_op;
+    if (!op.streamed)
+    {
+        size_t n = min(len, (size_t)(op.reply.body.length() - _bodyPos));
+        memcpy(data, op.reply.body.c_str() + _bodyPos, n);
+        _bodyPos += n;
+        return n;
+    }
+    size_t out = 0;
+    bool end = false;
+    while (out < len)
+    {
+        uint8_t i = op.drainIdx;
+        portENTER_CRITICAL(&fsMux);
+        bool full = op.blkFull[i];
+        end = !full && op.eof;
+        portEXIT_CRITICAL(&fsMux);
+        if (!full)
+        {
+            break;
+        }
+        // a full block is left alone by the worker
+        size_t n = min(len - out, (size_t)(op.blkLen[i] - op.drainPos));
+        memcpy(&data[out], &op.buf[i * FS_WORKER_BLOCK + op.drainPos], n);
+        out += n;
+        op.drainPos += n;
+        if (op.drainPos == op.blkLen[i])
+        {
+            op.drainPos = 0;
+            op.drainIdx = i ^ 1;
+            portENTER_CRITICAL(&fsMux);
+            op.blkFull[i] = false;
+            portEXIT_CRITICAL(&fsMux);
+        }
+    }
+    refill();
+    if (out || end)
+    {
+        return out;
+    }
+    return RESPONSE_TRY_AGAIN;
+}
+
+static void fsWorkerTask(void *param)
+{
+    tFsJob *job;
+    for (;;)
+    {
+        if (xQueueReceive(fsQueue, &job, portMAX_DELAY) == pdTRUE)
+        {
+            job->work(*job);
+            delete job;
+        }
+    }
+}
+
+bool fsWorkerStart(void)
+{
+    if (fsQueue != NULL)
+    {
+        return true;
+    }
+    fsQueue = xQueueCreate(FS_WORKER_QUEUE_LEN, sizeof(tFsJob *));
+    if (fsQueue == NULL)
+    {
+        Serial.println("!!! fsWorkerStart ERROR: xQueueCreate failed");
+        return false;
+    }
+    if (!taskStart(tkFsWorker, fsWorkerTask))
+    {
+        vQueueDelete(fsQueue);
+        fsQueue = NULL;
+        return false;
+    }
+    Serial.printf(">>> fsWorkerStart: %u jobs, %u byte blocks\r\n", FS_WORKER_QUEUE_LEN, FS_WORKER_BLOCK);
+    return true;
+}
+
+bool fsReply(AsyncWebServerRequest *request, tFsReplyFn fn)
+{
+    tFsOpRef op = std::make_shared<tFsOp>();
+    tFsJob *job = new tFsJob;
+    job->work = [op, fn](tFsJob &)
+    {
+        fn(op->reply);
+        if (op->reply.stream)
+        {
+            op->buf = (uint8_t *)malloc(2 * FS_WORKER_BLOCK);
+            if (op->buf == NULL)
+            {
+                op->reply.stream = nullptr;
+                op->reply.hdrCount = 0;
+                op->reply.text(500, "Out of memory");
+            }
+        }
+        op->streamed = (bool)op->reply.stream;
+        if (op->streamed)
+        {
+            fsFillAhead(*op);
+        }
+        portENTER_CRITICAL(&fsMux);
+        op->done = true;
+        portEXIT_CRITICAL(&fsMux);
+    };
+    if (!fsSubmit(job, 0))
+    {
+        Serial.println("*** fsReply WARNING! queue full");
+        request->send(503, "text/plain", "Busy, try again");
+        return false;
+    }
+    request->send(new tFsResponse(op));
+    return true;
+}
+
+const char *fsContentType(const String &path)
+{
+    static const char *const types[][2] =
+    {
+        {".html", "text/html"}, {".htm", "text/html"}, {".css", "text/css"},
+        {".json", "application/json"}, {".js", "application/javascript"},
+        {".png", "image/png"}, {".gif", "image/gif"}, {".jpg", "image/jpeg"},
+        {".bmp", "image/bmp"}, {".ico", "image/x-icon"}, {".svg", "image/svg+xml"},
+        {".wav", "audio/wav"}, {".mp3", "audio/mpeg"}, {".xml", "text/xml"},
+        {".pdf", "application/pdf"}, {".zip", "application/zip"}, {".gz", "application/x-gzip"},
+        {".bin", "application/octet-stream"},
+    };
+    for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++)
+    {
+        if (path.endsWith(types[i][0]))
+        {
+            return types[i][1];
+        }
+    }
+    return "text/plain";
+}
+
+static String httpDate(time_t t)
+{
+    struct tm tmv;
+    char buf[32];
+    gmtime_r(&t, &tmv);
+    strftime(buf, sizeof(buf), "%a, %d %b %Y %H:%M:%S GMT", &tmv);
+    return String(buf);
+}
+
+bool fsSendFile(AsyncWebServerRequest *request, fs::FS &fs, const String &path, bool download)
+{
+    // the request's headers are gone by the time the worker runs
+    String ifNoneMatch = request->hasHeader("If-None-Match") ? request->header("If-None-Match") : String();
+    String ifModifiedSince = request->hasHeader("If-Modified-Since") ? request->header("If-Modified-Since") : String();
+    fs::FS *pfs = &fs;
+    return fsReply(request, [pfs, path, download, ifNoneMatch, ifModifiedSince](tFsReply &r)
+    {
+        std::shared_ptr<File> file = std::make_shared<File>(pfs->open(path, "r"));
+        if (!*file || file->isDirectory())
+        {
+            r.text(404, "File not found");
+            return;
+        }
+        char etag[32];
+        time_t mtime = file->getLastWrite();
+        snprintf(etag, sizeof(etag), "\"%x-%lx\"", file->size(), (unsigned long)mtime);
+        String lastModified = (mtime > 0) ? httpDate(mtime) : String();
+
+        bool fresh = false;
+        if (ifNoneMatch.length())
+        {
+            fresh = (ifNoneMatch == etag);
+        }
+        else if (lastModified.length() && ifModifiedSince.length())
+        {
+            fresh = (ifModifiedSince == lastModified);
+        }
+
+        r.header("ETag", etag);
+        if (lastModified.length())
+        {
+            r.header("Last-Modified", lastModified);
+        }
+        // the editor changes files behind the browser's back, always revalidate
+        r.header("Cache-Control", "no-cache");
+        if (fresh)
+        {
+            r.text(304, String());
+            return;
+        }
+        String name = path.substring(path.lastIndexOf('/') + 1);
+        r.header("Content-Disposition", String(download ? "attachment" : "inline") + "; filename=\"" + name + "\"");
+        r.code = 200;
+        r.contentType = fsContentType(path);
+        r.length = file->size();
+        r.stream = [file](uint8_t *buf, size_t maxLen) -> size_t
+        {
+            return file->read(buf, maxLen);
+        };
+    });
+}
+
+tFsWriteRef fsWriteOpen(fs::FS &fs, const String &path, bool viaTmp)
+{
+    tFsWriteRef w = std::make_shared<tFsWrite>();
+    w->fs = &fs;
+    w->path = path;
+    w->viaTmp = viaTmp;
+    tFsJob *job = new tFsJob;
+    job->work = [w](tFsJob &)
+    {
+        w->file = w->fs->open(w->viaTmp ? w->path + FS_WRITE_TMP_SUFFIX : w->path, "w");
+        if (!w->file)
+        {
+            Serial.printf("!!! fsWriteOpen ERROR: [%s]\r\n", w->path.c_str());
+            w->failed = true;
+        }
+    };
+    if (!fsSubmit(job, pdMS_TO_TICKS(FS_WORKER_SUBMIT_MS)))
+    {
+        w->failed = true;
+    }
+    return w;
+}
+
+bool fsWriteChunk(const tFsWriteRef &w, const uint8_t *data, size_t len)
+{
+    if (w->failed || (len == 0))
+    {
+        return !w->failed;
+    }
+    tFsJob *job = new tFsJob;
+    job->data = (uint8_t *)malloc(len);
+    if (job->data == NULL)
+    {
+        delete job;
+        w->failed = true;
+        return false;
+    }
+    memcpy(job->data, data, len);
+    job->len = len;
+    job->work = [w](tFsJob &j)
+    {
+        if (w->failed)
+        {
+            return;
+        }
+        if (w->file.write(j.data, j.len) != j.len)
+        {
+            Serial.printf("!!! fsWriteChunk ERROR: [%s] write failed at %u\r\n", w->path.c_str(), w->written);
+            w->failed = true;
+        }
+        w->written += j.len;
+    };
+    if (!fsSubmit(job, pdMS_TO_TICKS(FS_WORKER_SUBMIT_MS)))
+    {
+        w->failed = true;
+        return false;
+    }
+    return true;
+}
+
+static void fsWriteDiscard(tFsWrite &w)
+{
+    w.file.close();
+    if (w.viaTmp)
+    {
+        w.fs->remove(w.path + FS_WRITE_TMP_SUFFIX);
+    }
+}
+
+void fsWriteAbort(const tFsWriteRef &w)
+{
+    w->failed = true;
+    tFsJob *job = new tFsJob;
+    job->work = [w](tFsJob &) { fsWriteDiscard(*w); };
+    fsSubmit(job, pdMS_TO_TICKS(FS_WORKER_SUBMIT_MS));
+}
+
+bool fsWriteClose(tFsWrite &w)
+{
+    if (w.failed)
+    {
+        fsWriteDiscard(w);
+        return false;
+    }
+    w.file.close();
+    // LittleFS renames over an existing file in one step
+    if (w.viaTmp && !w.fs->rename(w.path + FS_WRITE_TMP_SUFFIX, w.path))
+    {
+        w.fs->remove(w.path + FS_WRITE_TMP_SUFFIX);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <Arduino.h>
+#include <FS.h>
+#include <ESPAsyncWebServer.h>
+#include <functional>
+#include <memory>
+
+// Flash work of the web handlers runs on one low priority task instead of
+// async_tcp, so a slow LittleFS operation stalls nobody else's connection.
+// A handler hands fsReply() the work, the request gets a response that holds
+// back its headers until the worker filled the reply in and then streams the
+// body the worker reads ahead, FS_WORKER_BLOCK at a time. Request bodies go
+// to flash through fsWrite*(): the chunks are copied and written in order by
+// the same task. A waiting response is looked at again on the next ack or
+// TCP poll, so an answer may come up to one poll interval late.
+
+#define FS_WORKER_QUEUE_LEN     16
+#define FS_WORKER_SUBMIT_MS     100     // a body chunk waits this long for room, then the write fails
+#define FS_WORKER_BLOCK         2048    // read ahead per buffer, two per streamed reply
+#define FS_REPLY_HEADERS        4
+#define FS_WRITE_TMP_SUFFIX     ".tmp"
+
+// Next part of the body into buf, 0 at the end; runs on the worker
+typedef std::function<size_t(uint8_t *buf, size_t maxLen)> tFsStream;
+
+struct tFsReply
+{
+    int       code = 500;
+    String    contentType = "text/plain";
+    String    body;
+    tFsStream stream;           // instead of body
+    size_t    length = 0;       // of the stream, 0 when unknown: sent chunked
+    String    hdrName[FS_REPLY_HEADERS];
+    String    hdrValue[FS_REPLY_HEADERS];
+    uint8_t   hdrCount = 0;
+
+    void text(int status, const String &msg) { code = status; body = msg; }
+    void redirect(const char *url) { code = 302; body = String(); header("Location", url); }
+    void header(const char *name, const String &value)
+    {
+        if (hdrCount < FS_REPLY_HEADERS)
+        {
+            hdrName[hdrCount] = name;
+            hdrValue[hdrCount++] = value;
+        }
+    }
+};
+
+typedef std::function<void(tFsReply &reply)> tFsReplyFn;
+
+// One body on its way to flash, the handle is shared by its chunks
+struct tFsWrite
+{
+    fs::FS        *fs;
+    String         path;
+    bool           viaTmp;      // written as path + FS_WRITE_TMP_SUFFIX, renamed over path on close
+    File           file;
+    size_t         written = 0;
+    volatile bool  failed = false;
+};
+typedef std::shared_ptr<tFsWrite> tFsWriteRef;
+
+bool fsWorkerStart(void);       // once per server, before begin(); a second call does nothing
+
+// Answers the request from what fn leaves in the reply; false and a 503 when
+// the queue is full
+bool fsReply(AsyncWebServerRequest *request, tFsReplyFn fn);
+
+// The file, or 304 when the client holds the same version, or 404. The ETag
+// is size and mtime, which is all LittleFS knows of one
+bool fsSendFile(AsyncWebServerRequest *request, fs::FS &fs, const String &path, bool download = false);
+const char *fsContentType(const String &path);
+
+tFsWriteRef fsWriteOpen(fs::FS &fs, const String &path, bool viaTmp);
+bool fsWriteChunk(const tFsWriteRef &w, const uint8_t *data, size_t len);  // false: no room, the write is failed
+void fsWriteAbort(const tFsWriteRef &w);
+// In a reply only: true once all of the body is on flash under its path
+bool fsWriteClose(tFsWrite &w);
@@ -0,0 +1,273 @@
+#pragma once
+// Generated by buildscript_portal_assets.py from html/src, do not edit
+
+#include <Arduino.h>
+
+// index.html: 2037 bytes, 842 gzipped
+#define INDEX_HTML_ETAG "\"a8dad1d8293c59be\""
+const uint8_t index_html_gz[] PROGMEM = {
+    0x1F, 0x8B, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0xAD, 0x95, 0x6D, 0x6F, 0xD3, 0x3A,
+    0x14, 0xC7, 0x5F, 0xB7, 0x9F, 0xE2, 0xDC, 0xF0, 0x62, 0xAD, 0xD4, 0x36, 0x24, 0xB4, 0x62, 0x6B,
+    0x93, 0x48, 0x05, 0x3A, 0x98, 0x34, 0x28, 0xEA, 0x82, 0x74, 0x79, 0x35, 0xB9, 0xF1, 0x69, 0x62,
+    0xE6, 0xD8, 0xB9, 0xB6, 0xDB, 0x6D, 0x42, 0xFB, 0xEE, 0xD7, 0x71, 0x52, 0x46, 0x19, 0x17, 0xC6,
+    0x85, 0xB6, 0x72, 0xFD, 0xF0, 0x3F, 0x3F, 0x1F, 0x1F, 0x9F, 0x9C, 0x44, 0x7F, 0xBD, 0x5A, 0xBE,
+    0x4C, 0x3F, 0xBE, 0x5F, 0xC0, 0x9B, 0xF4, 0xED, 0x79, 0x12, 0x15, 0xA6, 0xE4, 0x49, 0x37, 0x2A,
+    0x90, 0xD0, 0xA4, 0x0B, 0x10, 0x19, 0x66, 0x38, 0x26, 0xEF, 0x97, 0xAB, 0x74, 0x7E, 0x1E, 0xF9,
+    0xCD, 0xA8, 0x9E, 0x2F, 0xD1, 0x10, 0x10, 0xA4, 0xC4, 0xD8, 0xDB, 0x31, 0xBC, 0xAE, 0xA4, 0x32,
+    0x1E, 0x64, 0x52, 0x18, 0x14, 0x26, 0xF6, 0xAE, 0x19, 0x35, 0x45, 0x4C, 0x71, 0xC7, 0x32, 0x1C,
+    0xBA, 0xC1, 0x00, 0x98, 0x60, 0x86, 0x11, 0x3E, 0xD4, 0x19, 0xE1, 0x18, 0x07, 0x9E, 0xC3, 0x68,
+    0x73, 0x5B, 0x03, 0x3B, 0x45, 0x00, 0xF0, 0x79, 0x63, 0xCD, 0x87, 0x1B, 0x52, 0x32, 0x7E, 0x3B,
+    0x85, 0xB9, 0xB2, 0xE2, 0x99, 0x45, 0x72, 0xA9, 0xA6, 0x2A, 0x5F, 0xF7, 0xC2, 0xC9, 0x00, 0x82,
+    0x60, 0x3C, 0x80, 0x70, 0x7C, 0xDC, 0x9F, 0x41, 0x49, 0x54, 0xCE, 0xC4, 0x70, 0x2D, 0x8D, 0x91,
+    0xE5, 0x14, 0x82, 0xA7, 0xD5, 0xCD, 0xEC, 0xAE, 0x06, 0x05, 0x3F, 0x05, 0x3D, 0x3B, 0x19, 0xC0,
+    0x53, 0xFB, 0xFB, 0x01, 0x25, 0xFC, 0x11, 0x04, 0x9E, 0x8C, 0x9F, 0xD7, 0xDF, 0xFF, 0x30, 0xEF,
+    0x74, 0x3B, 0xA3, 0x8A, 0xE4, 0xA8, 0x2F, 0x39, 0x13, 0x57, 0xFA, 0x57, 0x48, 0x0D, 0xE2, 0xEE,
+    0x10, 0x70, 0xF9, 0xF3, 0x13, 0x8D, 0x5D, 0x6C, 0x6C, 0x13, 0xF6, 0x1F, 0xA2, 0x98, 0xA8, 0xB6,
+    0xE6, 0x52, 0x6F, 0xD7, 0x25, 0x33, 0xDF, 0x27, 0xB9, 0xB9, 0x6B, 0x64, 0x79, 0x61, 0xA6, 0xB0,
+    0x96, 0x9C, 0xCE, 0x60, 0x4D, 0xB2, 0xAB, 0x5C, 0xC9, 0xAD, 0xA0, 0x6E, 0x87, 0x20, 0x78, 0x66,
+    0xE1, 0xE1, 0xB1, 0x6D, 0x26, 0x81, 0xDD, 0x63, 0x2D, 0x15, 0x45, 0x35, 0x74, 0xD7, 0x37, 0x05,
+    0x2D, 0x39, 0xA3, 0x5F, 0x26, 0xEF, 0xFD, 0x1A, 0x3F, 0xAF, 0xF5, 0xFB, 0x1B, 0x6B, 0x97, 0x15,
+    0xA1, 0x6C, 0xAB, 0xA7, 0x30, 0xB1, 0xB1, 0x72, 0xA9, 0x31, 0x0D, 0xC6, 0x75, 0xDC, 0xA0, 0x22,
+    0x94, 0x32, 0x91, 0x0F, 0x8D, 0xAC, 0x9A, 0xD5, 0x2F, 0x33, 0xFB, 0xF8, 0x4E, 0xDC, 0xED, 0x80,
+    0xFD, 0x1C, 0x1C, 0x6A, 0x4A, 0x32, 0xC3, 0x76, 0x68, 0x33, 0xE8, 0x2B, 0xB7, 0x5B, 0x37, 0x9E,
+    0x9C, 0x1E, 0x4F, 0x4E, 0x82, 0x13, 0x67, 0x16, 0xF9, 0x6D, 0xBA, 0x45, 0x7E, 0x93, 0xDF, 0xD1,
+    0x5A, 0xD2, 0xDB, 0x26, 0x0F, 0x33, 0xC5, 0x2A, 0x93, 0x00, 0x74, 0xC1, 0xF1, 0x37, 0x5B, 0x61,
+    0x99, 0x52, 0x00, 0x95, 0x2B, 0xD4, 0x68, 0x56, 0xF8, 0xCF, 0x16, 0xB5, 0x81, 0x5E, 0xBF, 0x59,
+    0xFF, 0xEC, 0x5A, 0x80, 0x1D, 0x51, 0x70, 0x53, 0x18, 0x53, 0x41, 0x0C, 0x02, 0xAF, 0xE1, 0xEF,
+    0xB7, 0xE7, 0x6F, 0xEC, 0xA8, 0x95, 0xF7, 0xFA, 0xB3, 0x56, 0xE7, 0x34, 0x23, 0x59, 0xA1, 0xE8,
+    0x79, 0xAF, 0x17, 0xA9, 0x37, 0x00, 0xCF, 0x6F, 0xD1, 0xB6, 0x6F, 0xD4, 0x16, 0xBF, 0x91, 0x6A,
+    0x14, 0x74, 0x6F, 0x7E, 0xD7, 0x75, 0x7F, 0xBE, 0x0F, 0xA6, 0x40, 0xA8, 0x33, 0x03, 0x98, 0xD1,
+    0xC8, 0x37, 0xC0, 0x34, 0x68, 0x43, 0x0C, 0xCB, 0x80, 0x08, 0x0A, 0x19, 0xC9, 0x0A, 0xA4, 0x03,
+    0xA7, 0xDA, 0x11, 0x6E, 0x3D, 0xB0, 0x39, 0x52, 0x22, 0x6C, 0x94, 0x2C, 0xDD, 0x64, 0xF3, 0x40,
+    0x36, 0x07, 0x44, 0x93, 0x15, 0xBD, 0x23, 0xBF, 0x7E, 0x70, 0x09, 0x1F, 0x7D, 0xD2, 0x52, 0x1C,
+    0xF5, 0x5B, 0x0F, 0x46, 0x56, 0x2B, 0x7A, 0x0A, 0x75, 0x25, 0x85, 0x46, 0x88, 0x13, 0xD8, 0xF7,
+    0x9D, 0xAE, 0xD7, 0x3F, 0x14, 0x56, 0xB5, 0x62, 0x1F, 0x10, 0xB0, 0x11, 0xCB, 0xB6, 0xA5, 0xAD,
+    0x02, 0x23, 0x57, 0x2C, 0x6C, 0x5C, 0xAA, 0x51, 0x5D, 0x27, 0x66, 0x0F, 0x05, 0x39, 0x9A, 0x05,
+    0xC7, 0xBA, 0xFB, 0xE2, 0xF6, 0x8C, 0xF6, 0x8E, 0x0A, 0xAA, 0x82, 0xA3, 0xBE, 0xBD, 0x5A, 0x81,
+    0xAA, 0xAE, 0x46, 0xCE, 0xB6, 0x9E, 0x7C, 0x9C, 0x6D, 0xF8, 0x3D, 0xDB, 0x70, 0x6F, 0x7B, 0xE7,
+    0x82, 0x69, 0x53, 0xA0, 0xB9, 0xE9, 0x3A, 0xA4, 0x11, 0x65, 0x3B, 0x70, 0x29, 0x11, 0x7B, 0x06,
+    0x6F, 0xCC, 0x90, 0x70, 0x96, 0x8B, 0x69, 0x66, 0xA1, 0xA8, 0x5C, 0x7D, 0xEA, 0x44, 0xAC, 0xCC,
+    0x41, 0xAB, 0x2C, 0xF6, 0xB8, 0xCC, 0x65, 0x53, 0xB3, 0x7C, 0x6B, 0x96, 0x74, 0x1E, 0x07, 0xB0,
+    0x9A, 0xCA, 0x16, 0xD5, 0x00, 0x18, 0x8D, 0xBD, 0xFA, 0x28, 0x5E, 0x62, 0x93, 0x2F, 0xB0, 0x4D,
+    0x75, 0xCF, 0xFA, 0x25, 0x54, 0xB8, 0x47, 0x85, 0x0E, 0x15, 0x7E, 0x83, 0x7A, 0x24, 0xC9, 0x7A,
+    0xD4, 0x4A, 0x28, 0xD3, 0x15, 0x27, 0xB6, 0x16, 0x30, 0x61, 0xAB, 0x0D, 0x0E, 0xD7, 0x5C, 0x66,
+    0x57, 0x16, 0x4D, 0x20, 0xE3, 0x44, 0x6B, 0x1B, 0x47, 0xEF, 0xAB, 0x5A, 0xE4, 0x41, 0xA1, 0x70,
+    0x13, 0xDB, 0xE4, 0x75, 0xA9, 0xE4, 0x25, 0x17, 0xE9, 0x3C, 0xFD, 0x70, 0x11, 0xF9, 0xA4, 0x3D,
+    0xD7, 0x5A, 0xFD, 0xA9, 0x1D, 0x90, 0x32, 0x23, 0xAD, 0xC3, 0x2F, 0x97, 0xEF, 0x4E, 0xCF, 0x5E,
+    0x7F, 0x58, 0xCD, 0xD3, 0xB3, 0xE5, 0xBB, 0xC3, 0x8D, 0x3A, 0xBF, 0xBF, 0xCB, 0x86, 0x71, 0xD4,
+    0x5E, 0x72, 0x7A, 0x76, 0xBE, 0xB8, 0xF8, 0xE3, 0x70, 0x69, 0x88, 0x97, 0x2C, 0xD3, 0xF9, 0x01,
+    0xB8, 0x63, 0x8B, 0xCC, 0xFF, 0x67, 0x5F, 0x06, 0xF7, 0x57, 0xD0, 0xD6, 0x8F, 0x64, 0xB5, 0x78,
+    0xB1, 0x5C, 0xA6, 0x0F, 0x36, 0xB9, 0x4F, 0xAF, 0xC8, 0x6F, 0x0A, 0x9D, 0x5D, 0x76, 0xAF, 0xF7,
+    0x7F, 0x01, 0x40, 0xAD, 0xB4, 0x7A, 0xF5, 0x07, 0x00, 0x00,
+};
+
+// device.html: 5885 bytes, 1801 gzipped
+#define DEVICE_HTML_ETAG "\"4515bd56006f2b9f\""
+const uint8_t device_html_gz[] PROGMEM = {
+    0x1F, 0x8B, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0xCD, 0x58, 0xFF, 0x4F, 0xDB, 0x46,
+    0x14, 0xFF, 0x9D, 0xBF, 0xE2, 0xCD, 0xD3, 0xE4, 0x44, 0x03, 0x87, 0xB6, 0xB4, 0x6C, 0x69, 0x92,
+    0x29, 0x80, 0x19, 0xAC, 0xB4, 0x20, 0x92, 0xA2, 0x4D, 0xD5, 0x84, 0x2E, 0xF6, 0x25, 0x76, 0xB1,
+    0x7D, 0xDE, 0xDD, 0x85, 0x90, 0x21, 0xFE, 0xF7, 0xBD, 0xBB, 0xB3, 0x1D, 0x3B, 0xD8, 0x69, 0x5A,
+    0x6D, 0xD2, 0x22, 0x21, 0xCE, 0xEF, 0xDE, 0x7D, 0xDE, 0xF7, 0x77, 0xCF, 0xEE, 0x7D, 0x77, 0x72,
+    0x79, 0x3C, 0xFE, 0xE3, 0xCA, 0x85, 0xB3, 0xF1, 0xFB, 0x8B, 0x41, 0x2F, 0x90, 0x71, 0x34, 0xD8,
+    0xE9, 0x05, 0x94, 0xF8, 0x83, 0x1D, 0x80, 0x9E, 0x0C, 0x65, 0x44, 0x07, 0x27, 0xEE, 0xCD, 0xF9,
+    0xB1, 0xDB, 0xEB, 0x98, 0x27, 0x45, 0x8F, 0xA9, 0x24, 0x90, 0x90, 0x98, 0xF6, 0xAD, 0xFB, 0x90,
+    0x2E, 0x52, 0xC6, 0xA5, 0x05, 0x1E, 0x4B, 0x24, 0x4D, 0x64, 0xDF, 0x5A, 0x84, 0xBE, 0x0C, 0xFA,
+    0x3E, 0xBD, 0x0F, 0x3D, 0xBA, 0xA7, 0x1F, 0x76, 0x21, 0x4C, 0x42, 0x19, 0x92, 0x68, 0x4F, 0x78,
+    0x24, 0xA2, 0xFD, 0x17, 0x96, 0x86, 0x11, 0x72, 0x69, 0x00, 0x01, 0x26, 0xCC, 0x5F, 0xC2, 0x63,
+    0x4C, 0xF8, 0x2C, 0x4C, 0xBA, 0xF0, 0x62, 0x3F, 0x7D, 0x78, 0x0B, 0x13, 0xE2, 0xDD, 0xCD, 0x38,
+    0x9B, 0x27, 0x7E, 0x17, 0x16, 0x41, 0x28, 0xE9, 0xDB, 0x27, 0xCD, 0x1B, 0x91, 0x09, 0x8D, 0x76,
+    0xF5, 0x12, 0x10, 0x38, 0x9D, 0xCB, 0xFC, 0x61, 0x32, 0x97, 0x92, 0x25, 0xF0, 0x98, 0x3D, 0xAA,
+    0x9F, 0x96, 0xAF, 0x10, 0x15, 0x64, 0x89, 0x9E, 0x12, 0xDF, 0x0F, 0x93, 0x59, 0x17, 0x5E, 0x56,
+    0xE9, 0x13, 0xF6, 0xB0, 0x27, 0xC2, 0xBF, 0xF5, 0xD6, 0x84, 0x71, 0x9F, 0xF2, 0x3D, 0x24, 0x95,
+    0x39, 0xA6, 0x68, 0xE7, 0xDE, 0x94, 0xC4, 0x61, 0xB4, 0xEC, 0xC2, 0x90, 0xA3, 0x55, 0xCF, 0x76,
+    0x11, 0x80, 0xA2, 0xCC, 0x9F, 0x9C, 0x37, 0x87, 0x50, 0x85, 0x37, 0x16, 0xEE, 0x45, 0x74, 0x2A,
+    0xBB, 0x70, 0x50, 0xD2, 0xC9, 0x98, 0x26, 0x68, 0x44, 0x3D, 0x09, 0x8F, 0x35, 0x32, 0x6A, 0x91,
+    0x6B, 0x7C, 0x94, 0x6B, 0xAD, 0x9D, 0xDB, 0x05, 0xC1, 0xA2, 0xD0, 0x2F, 0x88, 0x1E, 0x8B, 0x18,
+    0xEF, 0xC2, 0x8C, 0xD3, 0x65, 0x41, 0xE3, 0xC4, 0x0F, 0xE7, 0xA2, 0x0B, 0xAF, 0x15, 0x5E, 0x45,
+    0xBF, 0x97, 0x3A, 0x0C, 0x29, 0x13, 0x18, 0x3B, 0x96, 0x74, 0xC9, 0x04, 0xC1, 0xE6, 0x4A, 0x84,
+    0xDE, 0x7E, 0xA5, 0x5C, 0x6A, 0xD4, 0x0E, 0x0E, 0xBE, 0x42, 0xE5, 0xE7, 0x22, 0x0C, 0x88, 0xA4,
+    0x0F, 0x92, 0x70, 0x4A, 0xFE, 0x2F, 0xD6, 0x1F, 0xAC, 0x54, 0x73, 0x74, 0x96, 0xDD, 0x8A, 0xF9,
+    0x24, 0x0E, 0x65, 0x97, 0x78, 0x32, 0xBC, 0xA7, 0x00, 0x8F, 0x25, 0xF9, 0x19, 0x36, 0xE3, 0x24,
+    0x99, 0xD1, 0xBA, 0x53, 0x1B, 0xAC, 0x5A, 0xD0, 0x70, 0x16, 0x48, 0x95, 0x6E, 0x91, 0x5F, 0xB5,
+    0xE9, 0xFB, 0xD3, 0xA3, 0x9F, 0x7F, 0x3A, 0x7C, 0xB1, 0x95, 0x55, 0xEB, 0xBC, 0x65, 0xC3, 0x4C,
+    0x11, 0xBC, 0x38, 0x30, 0xF1, 0x34, 0x99, 0xBF, 0x27, 0x59, 0x9A, 0x99, 0x9D, 0x53, 0x26, 0x0C,
+    0xCB, 0x27, 0x36, 0xC4, 0xA7, 0x1D, 0x63, 0x83, 0x52, 0x25, 0xBD, 0xD5, 0x25, 0xF7, 0x15, 0x81,
+    0xA9, 0xB1, 0xEB, 0xB9, 0x6F, 0x21, 0xD7, 0xFC, 0xE0, 0xCD, 0xD1, 0x81, 0x7B, 0x98, 0x7B, 0x4D,
+    0x39, 0xE0, 0x36, 0xAF, 0xE4, 0x6F, 0x71, 0xDA, 0x50, 0xFF, 0xB6, 0x73, 0xDA, 0x1A, 0x6F, 0x25,
+    0x1B, 0xBE, 0xC9, 0x6B, 0xEB, 0x26, 0xE4, 0xD9, 0xF2, 0xF8, 0x2C, 0x57, 0xE0, 0xFB, 0xFD, 0xFD,
+    0xC3, 0xC3, 0xC9, 0x9B, 0xFC, 0x90, 0x24, 0x93, 0x88, 0xFE, 0x37, 0x9E, 0xCE, 0x0A, 0x4C, 0x09,
+    0x40, 0x45, 0xB4, 0xA9, 0x88, 0x91, 0x3E, 0x18, 0xA7, 0x54, 0x0B, 0x02, 0x95, 0x8B, 0x48, 0x2A,
+    0x50, 0x48, 0xBE, 0xDA, 0x80, 0x18, 0xAC, 0xE0, 0xF6, 0xD7, 0xE0, 0x8A, 0x06, 0x6B, 0x9A, 0xF9,
+    0xD6, 0x06, 0xAD, 0x27, 0x05, 0x18, 0x49, 0x7E, 0xB3, 0xE2, 0xDF, 0x2A, 0x2A, 0x83, 0x76, 0xA4,
+    0x8F, 0x0E, 0x57, 0xDD, 0x67, 0x8F, 0x44, 0xE1, 0x0C, 0xAF, 0x1F, 0x65, 0x67, 0x11, 0x15, 0x9F,
+    0x37, 0x6F, 0x46, 0x2C, 0x99, 0xA9, 0x3D, 0x78, 0xD4, 0xB9, 0x02, 0xAA, 0x9F, 0x29, 0x15, 0xFE,
+    0x47, 0x0D, 0xAC, 0xB1, 0x7D, 0xBF, 0xCC, 0xDB, 0x77, 0xAF, 0x93, 0xDD, 0xC3, 0x3B, 0xFA, 0x4E,
+    0xF6, 0x78, 0x98, 0xCA, 0x01, 0xA0, 0x6F, 0xB4, 0x8D, 0xD3, 0x79, 0xE2, 0xA9, 0xE3, 0xE0, 0xB3,
+    0x6B, 0x2A, 0xA8, 0xBC, 0xA6, 0x7F, 0xCD, 0xA9, 0x90, 0xD0, 0x6A, 0x9B, 0xFD, 0xFC, 0xAE, 0xBD,
+    0x27, 0x1C, 0x1E, 0x02, 0x29, 0x53, 0xE8, 0x43, 0x42, 0x17, 0xF0, 0xFB, 0xFB, 0x8B, 0x33, 0x7C,
+    0xCA, 0xD8, 0x5B, 0xED, 0xFC, 0x9E, 0xD3, 0x3C, 0x0E, 0x4B, 0x69, 0xD2, 0xB2, 0x7E, 0x75, 0xC7,
+    0xD6, 0x2E, 0x58, 0x9D, 0x0C, 0x1A, 0xD7, 0x92, 0xCF, 0xE9, 0x1A, 0xAB, 0xA0, 0x89, 0x9F, 0x1F,
+    0xCF, 0x9A, 0x52, 0xA1, 0xD3, 0x8C, 0x9D, 0xB1, 0x98, 0x16, 0x32, 0x0A, 0x65, 0x10, 0x6C, 0x1C,
+    0xC6, 0x94, 0xCD, 0x65, 0x2B, 0xE7, 0x2D, 0xED, 0xAA, 0x9F, 0xCF, 0xBC, 0x79, 0x8C, 0xD3, 0x0A,
+    0x86, 0xD0, 0x23, 0x6A, 0xDF, 0x09, 0x38, 0x9D, 0xF6, 0xAD, 0x8E, 0x55, 0x5C, 0xC8, 0xBB, 0xF0,
+    0x7A, 0x7F, 0xBF, 0x2A, 0x78, 0x11, 0x26, 0x3E, 0x5B, 0x38, 0x2C, 0x89, 0x18, 0xF1, 0xD1, 0xD0,
+    0x1A, 0xF0, 0x29, 0x95, 0x5E, 0xD0, 0xB2, 0x3B, 0x6A, 0x26, 0x22, 0x91, 0xF3, 0x59, 0xB0, 0xC4,
+    0x6E, 0x17, 0x82, 0x1D, 0x19, 0xA0, 0xE1, 0x9C, 0x8A, 0x94, 0x25, 0x82, 0x42, 0x7F, 0x00, 0xF9,
+    0x5A, 0x73, 0xB6, 0xDA, 0xEB, 0xAC, 0xA9, 0xE2, 0x29, 0x2B, 0xFE, 0xC9, 0xC6, 0xE9, 0x2C, 0xB5,
+    0x77, 0xC1, 0x9E, 0x86, 0x3C, 0x5E, 0xE0, 0x85, 0xA9, 0xD6, 0x38, 0x6C, 0xDD, 0x86, 0xBE, 0x5A,
+    0x49, 0x1A, 0xA7, 0x94, 0x13, 0x39, 0x37, 0x1B, 0xF7, 0x9E, 0xA7, 0xFE, 0xC5, 0x24, 0xD0, 0x47,
+    0xC4, 0xED, 0x5C, 0x50, 0x3F, 0x5B, 0x4A, 0x86, 0x1A, 0xDA, 0x7F, 0x3A, 0x53, 0xC6, 0x5D, 0x82,
+    0x4A, 0xDF, 0xAD, 0xCB, 0xC2, 0xE9, 0x6A, 0x0A, 0x48, 0x0E, 0x13, 0x48, 0xDB, 0x2B, 0x97, 0xCD,
+    0xA8, 0x74, 0x23, 0xAA, 0x96, 0x47, 0xCB, 0x73, 0xBF, 0x75, 0xD7, 0x76, 0x54, 0x0D, 0x1C, 0x9B,
+    0xF1, 0x0F, 0xBD, 0x92, 0x7E, 0xBA, 0xFB, 0xB3, 0x3C, 0xF3, 0x3C, 0xB5, 0x57, 0x4F, 0xAB, 0xB5,
+    0x82, 0xCE, 0xFC, 0xE9, 0xDE, 0xE3, 0xC1, 0x11, 0x9B, 0x73, 0x8F, 0xB6, 0x21, 0xC2, 0x6E, 0x39,
+    0xC2, 0x41, 0xA0, 0xC8, 0x99, 0xA7, 0xB7, 0xC6, 0xF9, 0x9D, 0x0E, 0x5C, 0xA8, 0x4E, 0x2A, 0xA9,
+    0x12, 0x2E, 0x39, 0x96, 0x16, 0x4B, 0x28, 0x8C, 0x46, 0x2E, 0x50, 0x05, 0x00, 0x68, 0x37, 0x46,
+    0x5E, 0x07, 0x64, 0x17, 0x17, 0x48, 0xC1, 0x40, 0x2D, 0xB1, 0xAE, 0x68, 0x02, 0x78, 0x01, 0x7B,
+    0x81, 0xBA, 0x9B, 0xFD, 0x6A, 0x06, 0x69, 0x69, 0x01, 0x5B, 0xB4, 0x8A, 0x83, 0x6C, 0xF2, 0xB9,
+    0x5D, 0xC9, 0x6A, 0xCE, 0x16, 0x02, 0xAD, 0xB2, 0xED, 0x5C, 0xF3, 0xCB, 0xC9, 0x67, 0x64, 0x76,
+    0xEE, 0xE8, 0x52, 0xB4, 0x14, 0x77, 0x93, 0x03, 0x95, 0x85, 0x72, 0x99, 0x52, 0x36, 0x55, 0xA0,
+    0xE8, 0x14, 0xF8, 0x0E, 0x61, 0x98, 0x3E, 0x6D, 0xB7, 0x0D, 0xEE, 0x8F, 0x48, 0xE9, 0x49, 0x3E,
+    0xE8, 0x61, 0x83, 0xF3, 0x22, 0x22, 0x44, 0xDF, 0xC2, 0x76, 0x64, 0x0D, 0x6C, 0xF8, 0x11, 0xEE,
+    0xF0, 0xCF, 0xC6, 0xB1, 0xDB, 0xAF, 0xEE, 0x72, 0xB3, 0x9B, 0x41, 0x16, 0x2C, 0x1D, 0x44, 0x29,
+    0x54, 0x5C, 0xB9, 0xB9, 0x29, 0x6A, 0xB6, 0xB2, 0xFC, 0x56, 0x01, 0x65, 0x96, 0xB7, 0x71, 0x5C,
+    0x49, 0x28, 0x57, 0x2F, 0x02, 0x68, 0xAD, 0x52, 0xAE, 0xBE, 0xE6, 0x4A, 0xF1, 0xA9, 0xB8, 0x49,
+    0xE8, 0xF8, 0x65, 0xD5, 0x5F, 0x8A, 0x28, 0xD6, 0x82, 0x0E, 0x8F, 0xB0, 0x0B, 0x9D, 0x3E, 0xD9,
+    0x62, 0x29, 0x30, 0x51, 0x55, 0x1E, 0xAA, 0xF6, 0xC5, 0xD4, 0x62, 0x86, 0xAF, 0x13, 0xA5, 0x64,
+    0xCC, 0xB4, 0xAA, 0x7A, 0xD4, 0xC8, 0x70, 0xB0, 0xDD, 0x6B, 0x01, 0x17, 0x21, 0xA2, 0xA0, 0xCE,
+    0xAB, 0xE0, 0xD1, 0xF5, 0x14, 0x56, 0x9A, 0xA1, 0xA7, 0x50, 0xAD, 0xDF, 0x46, 0x97, 0x1F, 0x9C,
+    0x94, 0x70, 0x41, 0x5B, 0xD4, 0xF1, 0x89, 0x24, 0xED, 0x72, 0x8E, 0xD6, 0xE7, 0x41, 0x99, 0x43,
+    0x45, 0x13, 0x69, 0x78, 0x4D, 0x8B, 0x3B, 0xD1, 0x5E, 0xAB, 0x93, 0xCD, 0x5E, 0xD6, 0x47, 0xEC,
+    0xAA, 0x83, 0x0B, 0x28, 0x27, 0x26, 0x69, 0x0B, 0xCB, 0x66, 0x50, 0x01, 0x84, 0xE6, 0xB4, 0x90,
+    0x8E, 0x7A, 0xF3, 0xDA, 0x98, 0x1B, 0xD2, 0x49, 0xF1, 0x2D, 0x02, 0x39, 0x7E, 0xD8, 0xC0, 0x22,
+    0xA4, 0x9A, 0x52, 0xA6, 0x9C, 0xD2, 0xB5, 0x24, 0x6A, 0x3B, 0x9F, 0x59, 0x98, 0xB4, 0x6C, 0xBB,
+    0x62, 0xFF, 0x53, 0x4D, 0x0D, 0xAF, 0x56, 0x4D, 0x91, 0xB1, 0x13, 0x35, 0x9A, 0xE0, 0x55, 0x25,
+    0xEC, 0x67, 0xD1, 0xD9, 0x2E, 0x36, 0x9B, 0x5D, 0xBB, 0x82, 0x7F, 0xEE, 0x5E, 0xF3, 0x06, 0x6A,
+    0x1C, 0xEC, 0x57, 0x1D, 0xDC, 0xE8, 0x5C, 0xDF, 0xC1, 0xB1, 0xA2, 0xE4, 0xDA, 0x8C, 0xC8, 0x59,
+    0x44, 0xEB, 0xC8, 0x42, 0x84, 0x0D, 0xE4, 0xDB, 0x69, 0x18, 0xC9, 0x9A, 0x3D, 0x32, 0xA3, 0xB7,
+    0xE2, 0x8B, 0x0E, 0xDF, 0xC2, 0xB1, 0x94, 0x73, 0xC6, 0x9F, 0x3B, 0x75, 0xB3, 0xBB, 0x30, 0xE6,
+    0x92, 0xDA, 0xEB, 0x0D, 0xBB, 0x95, 0x09, 0xC1, 0x97, 0x2F, 0x7F, 0x39, 0x52, 0x2C, 0xD0, 0xEF,
+    0x97, 0x6B, 0xD8, 0xB9, 0xBC, 0x72, 0x3F, 0xB4, 0xE1, 0x17, 0x6C, 0x82, 0x38, 0xE3, 0xD8, 0x78,
+    0x81, 0xE1, 0xCB, 0x7E, 0xA2, 0x2A, 0x25, 0x99, 0xB5, 0xED, 0xAF, 0x50, 0x3A, 0xA0, 0x51, 0xC4,
+    0xFE, 0x1D, 0xA5, 0xED, 0x67, 0x72, 0x75, 0xA7, 0xC2, 0x69, 0xC6, 0x4C, 0x30, 0x3B, 0xBD, 0x8E,
+    0xF9, 0x8E, 0xD1, 0x53, 0xDF, 0x16, 0xF4, 0xF7, 0x86, 0xEC, 0xA5, 0x22, 0x8B, 0x79, 0x69, 0x48,
+    0xB7, 0x40, 0xF5, 0x69, 0x24, 0x65, 0x4F, 0x2C, 0xF1, 0xA2, 0xD0, 0xBB, 0xEB, 0x5B, 0x6B, 0x03,
+    0xC6, 0x5B, 0xAB, 0x38, 0x6C, 0x38, 0x07, 0x47, 0xC3, 0xE3, 0x77, 0x30, 0xBE, 0x84, 0xB3, 0xCB,
+    0xF7, 0x6E, 0xAF, 0x63, 0xA8, 0x46, 0x16, 0xAF, 0xF9, 0x67, 0x86, 0xFB, 0x0C, 0xA2, 0xF4, 0x66,
+    0x65, 0x0D, 0x4E, 0x74, 0xAE, 0xC2, 0x50, 0x37, 0x1F, 0xD1, 0xEB, 0x68, 0xF2, 0x40, 0x9D, 0xCB,
+    0xCE, 0x36, 0xA1, 0x94, 0xDE, 0x1A, 0x0A, 0x94, 0xF3, 0x64, 0xCA, 0x60, 0xAC, 0x36, 0x6A, 0x80,
+    0x7A, 0xFA, 0x84, 0x29, 0x06, 0x53, 0x05, 0x41, 0xA5, 0x0A, 0x3E, 0x0C, 0x95, 0x25, 0x32, 0xA8,
+    0x6E, 0x60, 0xD7, 0xB8, 0x19, 0x5E, 0x7C, 0xCC, 0x76, 0x54, 0xD6, 0x96, 0x00, 0xAA, 0x65, 0x74,
+    0xE6, 0x0E, 0xAF, 0x76, 0x61, 0xB2, 0x94, 0x54, 0xD4, 0x75, 0x1F, 0x08, 0xFD, 0xBE, 0xA5, 0x66,
+    0x18, 0x6B, 0xB0, 0x2A, 0x01, 0x68, 0x44, 0x3B, 0xCD, 0xA6, 0x1C, 0xB8, 0xA1, 0x5C, 0xA0, 0x6F,
+    0x1A, 0x21, 0xF3, 0x71, 0x68, 0x3B, 0x58, 0x77, 0x74, 0xF5, 0xEA, 0x25, 0xA0, 0xBF, 0xE0, 0xFC,
+    0xA4, 0x11, 0xD2, 0x4C, 0x55, 0x15, 0x40, 0xF5, 0x6B, 0x04, 0x1D, 0xAF, 0x66, 0xAF, 0x46, 0xCC,
+    0xD2, 0x7C, 0xB6, 0x9D, 0xA6, 0x47, 0x44, 0x4A, 0xCA, 0x97, 0x70, 0xC3, 0x22, 0x89, 0xCD, 0x63,
+    0x17, 0xE2, 0x9B, 0x46, 0x70, 0x9C, 0xF6, 0xB6, 0x03, 0xBD, 0x62, 0x0B, 0x1C, 0x96, 0xB0, 0x88,
+    0xC5, 0x3C, 0x4E, 0xCD, 0x7D, 0x17, 0x0F, 0x83, 0x46, 0x5C, 0x1C, 0x1F, 0xB7, 0xC3, 0x1D, 0x5D,
+    0x9D, 0x9F, 0x9E, 0x8E, 0xE0, 0x23, 0x0E, 0x99, 0x70, 0xB4, 0x31, 0x03, 0xB2, 0x51, 0xF4, 0xAB,
+    0x60, 0xC7, 0x6A, 0x60, 0xFD, 0x32, 0xAE, 0x9E, 0x6B, 0xD7, 0x81, 0x71, 0xA1, 0xF3, 0x1E, 0x8A,
+    0x52, 0xD8, 0x5C, 0x4A, 0x7A, 0xD4, 0x1C, 0xE7, 0xA3, 0x26, 0xBE, 0x17, 0xA5, 0x24, 0xD1, 0x02,
+    0x56, 0x2D, 0x49, 0x89, 0x50, 0xE4, 0x41, 0x63, 0x95, 0x95, 0x0E, 0xE8, 0x81, 0x47, 0x2B, 0xA5,
+    0xD5, 0x68, 0x60, 0x53, 0x43, 0xD0, 0x17, 0x99, 0xF4, 0xC8, 0xD4, 0xC0, 0x35, 0xA8, 0x2B, 0xE9,
+    0xF1, 0x70, 0xF4, 0xAE, 0xB6, 0xA4, 0x8F, 0xAF, 0x3E, 0xD6, 0xD2, 0x47, 0x63, 0xD5, 0xD6, 0x4E,
+    0xAF, 0xDD, 0x52, 0xBD, 0xF7, 0xA4, 0xFE, 0x46, 0x5B, 0x68, 0xA1, 0x87, 0x17, 0xAD, 0x85, 0xEE,
+    0xAF, 0xDB, 0x6B, 0x53, 0x7C, 0x4E, 0xD6, 0x72, 0x07, 0xD7, 0x97, 0x17, 0xA5, 0x87, 0xD1, 0xE8,
+    0xBC, 0x78, 0x38, 0x3D, 0xBF, 0x18, 0xBB, 0xD7, 0xEE, 0x49, 0x41, 0x18, 0xFE, 0xEA, 0xE2, 0x60,
+    0xDF, 0xAC, 0x52, 0x31, 0x0C, 0xD4, 0xAB, 0x65, 0xA2, 0xDE, 0xEB, 0xE0, 0x88, 0x19, 0xE3, 0xE2,
+    0x1F, 0xCA, 0xE5, 0x24, 0x40, 0xFD, 0x16, 0x00, 0x00,
+};
+
+// editor.html: 5490 bytes, 1401 gzipped
+#define EDITOR_HTML_ETAG "\"5600fef5161861e0\""
+const uint8_t editor_html_gz[] PROGMEM = {
+    0x1F, 0x8B, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0xCD, 0x58, 0x59, 0x8F, 0xDB, 0x36,
+    0x10, 0x7E, 0xCF, 0xAF, 0x98, 0x75, 0xD1, 0xCA, 0x46, 0xBD, 0xD6, 0x26, 0xE8, 0x93, 0x8F, 0x0D,
+    0x92, 0xCD, 0x16, 0x48, 0x91, 0x26, 0x41, 0x37, 0x41, 0x91, 0x47, 0x46, 0x1C, 0x59, 0xEC, 0xCA,
+    0xA2, 0x41, 0xD2, 0xEB, 0x18, 0x0B, 0xFF, 0xF7, 0x0E, 0x49, 0xC9, 0x92, 0x65, 0x1D, 0x4E, 0x9A,
+    0x00, 0xD5, 0x83, 0xAD, 0x63, 0x66, 0x38, 0xE7, 0x37, 0x43, 0x02, 0x00, 0xCC, 0x2F, 0x5E, 0xBD,
+    0xBB, 0xF9, 0xF0, 0xE9, 0xFD, 0x2D, 0x24, 0x66, 0x95, 0x5E, 0x3F, 0x01, 0xFB, 0xAE, 0x7A, 0x8B,
+    0x8C, 0xFB, 0x5B, 0xF7, 0x68, 0x84, 0x49, 0xF1, 0xFA, 0x8F, 0xBB, 0x77, 0x6F, 0xE1, 0x96, 0x0B,
+    0x23, 0xD5, 0x3C, 0xF4, 0xAF, 0x4A, 0x12, 0x6D, 0x76, 0xD5, 0x67, 0x7B, 0x7D, 0x96, 0x7C, 0x07,
+    0x8F, 0x10, 0xCB, 0xCC, 0x5C, 0xC6, 0x6C, 0x25, 0xD2, 0xDD, 0x14, 0x5E, 0x28, 0xC1, 0xD2, 0x31,
+    0x68, 0x96, 0xE9, 0x4B, 0x8D, 0x4A, 0xC4, 0x33, 0x58, 0x31, 0xB5, 0x14, 0xD9, 0x14, 0x9E, 0x5D,
+    0xAD, 0xBF, 0xCC, 0x60, 0x7F, 0x24, 0xE2, 0xA7, 0x58, 0xA4, 0xF8, 0x46, 0x68, 0x43, 0x72, 0xAA,
+    0x74, 0x70, 0x75, 0x42, 0x89, 0x4E, 0x31, 0xA2, 0xDB, 0x0A, 0x6E, 0x92, 0x29, 0x3C, 0xBD, 0xBA,
+    0xFA, 0x79, 0x06, 0x09, 0x8A, 0x65, 0x62, 0xA6, 0xF0, 0xDB, 0x55, 0x93, 0x74, 0x6D, 0x98, 0xD9,
+    0x68, 0xE2, 0x89, 0x64, 0x2A, 0xD5, 0x14, 0x96, 0x0A, 0x31, 0x2B, 0x35, 0x7A, 0xDA, 0xB8, 0xD2,
+    0x04, 0x95, 0x72, 0x0B, 0xE5, 0x4C, 0x0A, 0xF9, 0x09, 0xC9, 0xE7, 0x8D, 0x31, 0x32, 0xBB, 0x8C,
+    0xC8, 0x74, 0x26, 0x32, 0x54, 0x07, 0xF5, 0x2F, 0x8D, 0x5C, 0x7B, 0xC1, 0x75, 0x1E, 0xCF, 0x52,
+    0x12, 0x2A, 0xAF, 0x78, 0x9D, 0x74, 0x1E, 0x56, 0x3C, 0x3D, 0x0F, 0xCB, 0x40, 0xCD, 0xAD, 0xBB,
+    0x2B, 0x01, 0x49, 0x9E, 0xF9, 0x80, 0xFD, 0x4E, 0x1E, 0x3C, 0x44, 0x8D, 0x5E, 0x1E, 0x28, 0x2A,
+    0xB1, 0xC3, 0x14, 0x23, 0x03, 0x82, 0x2F, 0x06, 0x85, 0xBF, 0x07, 0x20, 0xB3, 0x28, 0x61, 0xD9,
+    0x12, 0x17, 0x83, 0x28, 0xC1, 0xE8, 0xFE, 0x63, 0xA6, 0xD9, 0x03, 0xF2, 0x1B, 0xF7, 0x4E, 0x0F,
+    0x47, 0x83, 0xE3, 0x58, 0xCF, 0xE5, 0xDA, 0x08, 0x52, 0xFF, 0x81, 0xA5, 0x1B, 0x62, 0x19, 0x5C,
+    0xDF, 0x79, 0x99, 0x0C, 0xAC, 0xC4, 0x79, 0xE8, 0x3F, 0x5F, 0x57, 0xCD, 0x70, 0x04, 0x4D, 0xEA,
+    0x18, 0xFC, 0x62, 0x98, 0x42, 0xE6, 0x14, 0xF2, 0x61, 0xB5, 0xEA, 0x88, 0x6C, 0xBD, 0x31, 0x8B,
+    0x01, 0xB9, 0xE7, 0xFE, 0x85, 0xFE, 0x53, 0x72, 0x11, 0x0B, 0xE4, 0x56, 0x11, 0x4A, 0xC6, 0x9C,
+    0xA3, 0x22, 0x9F, 0x8B, 0x07, 0x88, 0x52, 0xA6, 0xF5, 0x62, 0x50, 0x0F, 0x46, 0x5D, 0xF5, 0xDC,
+    0xF3, 0x64, 0x70, 0x2A, 0xA2, 0xFB, 0xC5, 0xC0, 0x1A, 0x6A, 0xBD, 0x66, 0x65, 0xDF, 0xD1, 0x3D,
+    0xE4, 0x46, 0xCF, 0x43, 0x4F, 0xD9, 0xC3, 0xBE, 0x94, 0x2F, 0x59, 0x74, 0x6F, 0x99, 0xED, 0xFF,
+    0x29, 0xD3, 0x3C, 0x24, 0xDD, 0x6A, 0x9A, 0x5A, 0x4B, 0x7D, 0x32, 0x5A, 0x73, 0x0E, 0xDF, 0x2B,
+    0x21, 0x8A, 0x94, 0x58, 0x9B, 0xE3, 0x95, 0xC9, 0x20, 0x2A, 0x8C, 0x3C, 0xEF, 0x17, 0xC0, 0x65,
+    0xB4, 0x59, 0x61, 0x66, 0x26, 0x4B, 0x34, 0xB7, 0x29, 0xDA, 0xDB, 0x97, 0xBB, 0xD7, 0x7C, 0x18,
+    0x78, 0x8A, 0x60, 0x34, 0x6B, 0xE0, 0x3E, 0xD4, 0x57, 0x07, 0x7F, 0x41, 0xD3, 0x2C, 0xC1, 0xAB,
+    0xFD, 0x8A, 0x8C, 0xE8, 0x10, 0xE1, 0x89, 0xEA, 0x02, 0x52, 0xA4, 0xA4, 0x3B, 0x84, 0x92, 0xF8,
+    0x63, 0x96, 0x6A, 0x3C, 0xA5, 0x91, 0x54, 0x0B, 0x22, 0x63, 0xE9, 0x0D, 0x45, 0x90, 0x44, 0x12,
+    0x61, 0x10, 0x9C, 0x52, 0x51, 0xB0, 0xCD, 0x1B, 0xC9, 0x38, 0x72, 0x97, 0xF2, 0x25, 0xD1, 0x11,
+    0x65, 0x18, 0x82, 0x25, 0x72, 0x86, 0x43, 0x6A, 0x2D, 0xA7, 0xD8, 0xAD, 0xD9, 0x92, 0x1E, 0xE8,
+    0xF5, 0x11, 0xE9, 0x56, 0x64, 0x5C, 0x6E, 0x27, 0x32, 0xB3, 0x5F, 0xAC, 0x76, 0x9B, 0x2C, 0xB2,
+    0x59, 0x3C, 0x1C, 0xC1, 0xE3, 0x11, 0xA1, 0xBD, 0x62, 0x34, 0x51, 0x32, 0x0C, 0x42, 0x2B, 0xD2,
+    0xAE, 0x4F, 0xC6, 0x9E, 0xD0, 0x38, 0x68, 0x30, 0x09, 0x66, 0x43, 0x85, 0x7A, 0x4D, 0xDE, 0x23,
+    0x2D, 0xAF, 0xA1, 0xB8, 0x9F, 0xFC, 0xA3, 0xAD, 0xEC, 0x2E, 0x36, 0xAB, 0xB4, 0xB6, 0x3C, 0x8F,
+    0x8D, 0x44, 0x4E, 0x0F, 0x4B, 0x32, 0x89, 0xA5, 0xBA, 0x65, 0xA4, 0x8F, 0xB3, 0xB2, 0x93, 0xDE,
+    0x5E, 0x22, 0x76, 0x84, 0x13, 0xCC, 0xB8, 0xFE, 0x5B, 0x18, 0x32, 0xC3, 0xE9, 0x12, 0x8C, 0x46,
+    0x3D, 0x8C, 0x87, 0x00, 0xF9, 0xE2, 0xAF, 0x24, 0x40, 0x44, 0xD5, 0x68, 0x30, 0xCF, 0x81, 0x61,
+    0xE0, 0x09, 0xEA, 0xF1, 0x6F, 0xBA, 0x3C, 0xE5, 0xC4, 0xE1, 0x88, 0xF5, 0x39, 0xE9, 0x75, 0x36,
+    0x93, 0x85, 0x81, 0xB3, 0x79, 0x8A, 0xAC, 0x9E, 0xB0, 0xF5, 0x9A, 0x0C, 0xBF, 0x49, 0x44, 0xCA,
+    0x87, 0x5E, 0x50, 0x8F, 0x9A, 0xFB, 0xD6, 0xAF, 0xFB, 0x16, 0xCE, 0x7D, 0x4B, 0x50, 0x23, 0x66,
+    0x93, 0x86, 0xFA, 0x89, 0x8D, 0x91, 0x4E, 0xE4, 0xF6, 0xCE, 0xD5, 0xC9, 0x30, 0xB8, 0x75, 0x2D,
+    0xC6, 0xE6, 0x9D, 0xC8, 0x96, 0x3E, 0xA6, 0x53, 0x08, 0xE0, 0x57, 0x20, 0xDA, 0x31, 0x18, 0xB5,
+    0xC1, 0x51, 0x6D, 0xA9, 0x7D, 0x43, 0xAE, 0x17, 0x09, 0x0B, 0x8D, 0x08, 0xDE, 0x10, 0x5B, 0x4A,
+    0x84, 0x4A, 0x3D, 0xFE, 0xF2, 0x4B, 0xE9, 0x24, 0x1F, 0x8F, 0x8B, 0xC5, 0xA2, 0x56, 0x66, 0x6D,
+    0x19, 0x42, 0x92, 0x2E, 0x08, 0x1F, 0x62, 0xA1, 0x56, 0xC3, 0xE0, 0x93, 0xDC, 0x40, 0x62, 0x81,
+    0x74, 0xE3, 0x55, 0x00, 0xDF, 0x59, 0xF4, 0x84, 0xC6, 0x01, 0x84, 0x1D, 0x7D, 0xD5, 0x9B, 0xFC,
+    0x66, 0xCB, 0xA8, 0xBE, 0x8D, 0x74, 0xA6, 0x03, 0xCB, 0x24, 0xA5, 0xBD, 0x72, 0x5A, 0x3C, 0xEF,
+    0xCE, 0xC6, 0x9A, 0xA2, 0x75, 0x35, 0xDB, 0x03, 0xAA, 0xD0, 0x6C, 0x54, 0xD6, 0x12, 0xB6, 0x27,
+    0xFD, 0x6F, 0xAC, 0xA2, 0xBE, 0x59, 0xD4, 0xE2, 0xD1, 0x11, 0x8E, 0x92, 0xA7, 0xC1, 0xA2, 0x12,
+    0x97, 0x33, 0xB6, 0x2A, 0x4A, 0xA0, 0x34, 0x6D, 0xD6, 0x14, 0xB4, 0x8B, 0x82, 0x7C, 0xD4, 0x6A,
+    0x4F, 0x2B, 0x60, 0x11, 0x54, 0x5B, 0x5D, 0x9E, 0x5B, 0x11, 0x0B, 0x9B, 0x62, 0x07, 0x59, 0x5F,
+    0x8B, 0x5F, 0xB6, 0xFC, 0xBA, 0xF1, 0x8B, 0x33, 0xC3, 0xBA, 0xE1, 0xC8, 0xA8, 0x5D, 0x0F, 0xE6,
+    0xE4, 0xFE, 0x91, 0x6A, 0xC5, 0x8C, 0x41, 0xFE, 0xCA, 0x89, 0x04, 0x3B, 0xEA, 0x4C, 0xB4, 0x51,
+    0x54, 0x2E, 0x22, 0xDE, 0x0D, 0xDD, 0xE3, 0x9A, 0x29, 0x8D, 0x6E, 0xCD, 0xD1, 0x18, 0xB2, 0x4D,
+    0x4A, 0x73, 0xE7, 0xB3, 0x9E, 0xD2, 0xF6, 0xAD, 0xB2, 0x44, 0x9F, 0xEA, 0x2A, 0xDD, 0x9C, 0xA7,
+    0x3D, 0xEA, 0x2B, 0x98, 0x4F, 0x5A, 0x57, 0x11, 0x83, 0x6E, 0xB6, 0xBE, 0xDE, 0x59, 0xBF, 0xAA,
+    0x08, 0xE3, 0x16, 0x4A, 0xDD, 0x9A, 0x54, 0x7D, 0x51, 0x84, 0x5A, 0xC7, 0xE4, 0xA2, 0x5D, 0x17,
+    0x46, 0xEF, 0x21, 0x07, 0xAC, 0xBE, 0xBE, 0x50, 0x73, 0x23, 0xFF, 0x06, 0xEF, 0xF1, 0xFF, 0xA3,
+    0xD3, 0x5E, 0x67, 0x64, 0x92, 0xE0, 0x2E, 0xDB, 0xF2, 0xF8, 0x06, 0x39, 0x1C, 0x77, 0x78, 0xED,
+    0x47, 0xB5, 0x84, 0xBE, 0x8E, 0xD0, 0x81, 0x40, 0xE5, 0x88, 0xFB, 0xFD, 0x11, 0xA8, 0x39, 0x35,
+    0xAA, 0xA6, 0xBC, 0x4F, 0x91, 0x11, 0x76, 0xE8, 0xEA, 0x16, 0x81, 0x7E, 0x94, 0xEE, 0xF1, 0x66,
+    0x1B, 0xB6, 0x35, 0x58, 0x5A, 0xDA, 0x11, 0x1D, 0x52, 0xAA, 0x9A, 0x95, 0xA7, 0x42, 0xDA, 0x91,
+    0xA7, 0x02, 0x26, 0xB9, 0xB0, 0x16, 0xFD, 0x68, 0xB6, 0x54, 0x6C, 0xEB, 0xF6, 0xBD, 0x64, 0x47,
+    0x82, 0xC0, 0xF1, 0x41, 0x44, 0x08, 0x5B, 0x25, 0x0C, 0xCD, 0x6D, 0xC2, 0x75, 0xB6, 0x98, 0xF2,
+    0x36, 0x01, 0xE6, 0x1E, 0x99, 0x52, 0xE2, 0x01, 0x75, 0xA3, 0xB0, 0x02, 0x9F, 0x8B, 0x50, 0x95,
+    0x00, 0x8D, 0x59, 0x24, 0x39, 0x7E, 0xFC, 0xEB, 0xF5, 0x8D, 0x5C, 0x11, 0xF2, 0xDA, 0x01, 0xEB,
+    0xE0, 0xFD, 0x71, 0x47, 0x65, 0xAE, 0xD0, 0x24, 0x92, 0x53, 0xD6, 0xBC, 0x7F, 0x77, 0xF7, 0x21,
+    0x18, 0xB7, 0xD2, 0xD9, 0x3D, 0x25, 0x2A, 0x1A, 0x38, 0x1E, 0x21, 0xC8, 0x0B, 0xF2, 0xF2, 0xC3,
+    0x6E, 0x8D, 0x01, 0xB1, 0xD2, 0xB0, 0x44, 0xBB, 0x1C, 0x66, 0x93, 0x28, 0x94, 0x91, 0x41, 0x73,
+    0x49, 0xA0, 0x8B, 0x6C, 0x15, 0xC0, 0xBE, 0x5D, 0xA0, 0x75, 0xC8, 0xB4, 0x08, 0xC4, 0x57, 0x55,
+    0x43, 0x5F, 0xB3, 0x39, 0x6E, 0x2B, 0xC3, 0x47, 0x90, 0xF7, 0xD3, 0x92, 0x46, 0xDE, 0x8F, 0x1D,
+    0x8E, 0x4C, 0xDD, 0x2F, 0x2D, 0x32, 0xEA, 0x59, 0xA6, 0xBB, 0x37, 0x51, 0x9A, 0x13, 0x0D, 0x49,
+    0xED, 0x83, 0xBF, 0x53, 0x34, 0xCB, 0x6D, 0xFF, 0x7E, 0xC8, 0xD4, 0x3E, 0x83, 0x56, 0x0A, 0xCD,
+    0x6A, 0x6B, 0x2D, 0x1F, 0xC3, 0x45, 0xAE, 0xF8, 0x77, 0x1D, 0x4F, 0x29, 0x33, 0xCF, 0x84, 0xA2,
+    0xB3, 0x9A, 0xC7, 0x37, 0x03, 0xED, 0xFE, 0x6C, 0xD8, 0xAB, 0x9F, 0x1D, 0x34, 0x8D, 0xC0, 0xD5,
+    0x20, 0x1C, 0xF5, 0x31, 0x3B, 0xFC, 0xD6, 0x22, 0x7B, 0x3E, 0xE0, 0x16, 0x87, 0x02, 0x7D, 0x43,
+    0xF7, 0x8F, 0x9A, 0xA7, 0x97, 0x12, 0x3E, 0x93, 0x02, 0x3D, 0x53, 0xF4, 0x7F, 0x1D, 0x86, 0xF3,
+    0x1D, 0x73, 0x2A, 0x3D, 0x42, 0x4C, 0x12, 0x85, 0xB1, 0xDD, 0x88, 0x87, 0xC1, 0x0C, 0xCE, 0xEF,
+    0x4D, 0x65, 0x1E, 0xAC, 0x68, 0x2A, 0xA1, 0xAD, 0xF9, 0x98, 0xA2, 0xE2, 0x53, 0x2E, 0xAF, 0x8B,
+    0x26, 0x1B, 0x0E, 0xE7, 0x10, 0x0E, 0x1A, 0xCA, 0xD2, 0xCB, 0x65, 0xCC, 0x3A, 0x18, 0xDC, 0x39,
+    0xD1, 0x5B, 0xDF, 0xEB, 0x8A, 0x95, 0x9E, 0x43, 0xE0, 0xCE, 0xF9, 0x02, 0x98, 0x9E, 0x9C, 0x36,
+    0x1C, 0x9D, 0xC6, 0x55, 0x0E, 0x66, 0xE6, 0x61, 0x79, 0x06, 0x37, 0x0F, 0xCB, 0xE3, 0xD4, 0x7F,
+    0x01, 0xD4, 0x08, 0xBE, 0xCF, 0x72, 0x15, 0x00, 0x00,
+};
@@ -2,6 +2,9 @@
 #include <ESPAsyncWebServer.h>
 #include <Update.h>
 #include <Adafruit_NeoPixel.h>
+#include "otaVerify.h"
+#include "jsonWriter.h"
+#include "serverSync.h"
 
 // Variables for LED blinking and OTA progress
 bool otaInProgress = false;
@@ -9,6 +12,11 @@ unsigned long previousMillis = 0;
 const long blinkInterval = 100; // 100ms interval for blinking
 size_t otaTotalSize = 0;
 size_t otaCurrentSize = 0;
+static tOtaVerifier otaVerifier;
+static String otaExpectedSha;
+static bool otaImageOk = false;
+static bool otaShaMismatch = false;
+static const char *otaState = "idle";
 
 const char ota_html[] PROGMEM = R"rawliteral(
     <!DOCTYPE HTML><html>
@@ -19,21 +27,37 @@ const char ota_html[] PROGMEM = R"rawliteral(
     <body>
       <h1>Firmware Update</h1>
       <form id="uploadForm" method="POST" action="/update" enctype="multipart/form-data">
-        <input type="file" name="update" accept=".bin">
+        <input type="file" name="update" accept=".bin"><br>
+        <input type="text" id="sha256" size="70" placeholder="SHA-256 of the .bin (optional, checked before the image is booted)"><br>
         <input type="submit" value="Upload Firmware">
       </form>
       <div id="progressSection" style="display:none;">
         <p>Uploading...</p>
         <progress id="progressBar" value="0" max="100"></progress>
         <p id="progressText">0%</p>
+        <p id="rateText"></p>
       </div>
     
       <script>
+        let statusTimer = null;
+        // the device's view: written to flash, rate and ETA
+        function pollStatus() {
+          fetch('/ota_status')
+            .then(response => response.json())
+            .then(s => {
+              let text = Math.round(s.rate_bps / 1024) + ' KB/s';
+              if (s.eta_s >= 0) text += ', ETA ' + s.eta_s + ' s';
+              document.getElementById('rateText').innerText = s.state + ': ' + text;
+            })
+            .catch(() => {});
+        }
         document.getElementById('uploadForm').onsubmit = function(e) {
           e.preventDefault();
           document.getElementById('progressSection').style.display = 'block';
           let formData = new FormData(this);
+          let sha = document.getElementById('sha256').value.trim();
           let xhr = new XMLHttpRequest();
+          statusTimer = setInterval(pollStatus, 1000);
           xhr.upload.onprogress = function(event) {
             if (event.lengthComputable) {
               let percent = Math.round((event.loaded / event.total) * 100);
@@ -42,16 +66,17 @@ const char ota_html[] PROGMEM = R"rawliteral(
             }
           };
           xhr.onload = function() {
+            clearInterval(statusTimer);
             if (xhr.status === 200 && xhr.responseText === 'OK') {
               window.location.href = '/ota_complete'; // Redirect to completion page
             } else {
-              alert('Update failed!');
+              alert('Update failed! ' + xhr.responseText);
               document.getElementById('progressSection').style.display = 'none';
               document.getElementById('progressBar').value = 0;
               document.getElementById('progressText').innerText = '0%';
             }
           };
-          xhr.open('POST', '/update', true);
+          xhr.open('POST', sha ? '/update?sha256=' + encodeURIComponent(sha) : '/update', true);
           xhr.send(formData);
         };
       </script>
@@ -133,10 +158,24 @@ void handleOtaComplete(AsyncWebServerRequest *request)
     delay(100);
 }
 
+void handleOtaStatus(AsyncWebServerRequest *request)
+{
+    tJsonBuffer<192> json;
+    json.beginObject();
+    json.field("state", otaState);
+    json.field("done", otaVerifier.done());
+    json.field("total", otaVerifier.total());
+    json.field("rate_bps", otaVerifier.rateBps());
+    json.field("eta_s", otaVerifier.etaS());
+    json.endObject();
+    request->send(200, "application/json", json.c_str());
+}
+
 void handleOtaUpdateResponse(AsyncWebServerRequest *request)
 {
-    bool shouldReboot = !Update.hasError();
-    AsyncWebServerResponse *response = request->beginResponse(200, "text/plain", shouldReboot ? "OK" : "FAIL");
+    bool shouldReboot = otaImageOk && !Update.hasError();
+    const char *res = shouldReboot ? "OK" : (otaShaMismatch ? "FAIL: SHA-256 mismatch" : "FAIL");
+    AsyncWebServerResponse *response = request->beginResponse(200, "text/plain", res);
     response->addHeader("Connection", "close");
     request->send(response);
     delay(1000);
@@ -158,6 +197,13 @@ void handleOtaUpdateUpload(AsyncWebServerRequest *request, String filename, size
         otaInProgress = true;                    // Start blinking
         otaTotalSize = request->contentLength(); // Get total size of the upload
         otaCurrentSize = 0;
+        otaImageOk = false;
+        otaShaMismatch = false;
+        otaState = "uploading";
+        // the multipart framing counts too, the ETA comes out a little long
+        otaVerifier.begin(otaTotalSize);
+        otaExpectedSha = request->hasParam("sha256") ? request->getParam("sha256")->value() : String();
+        otaStageForget();
         if (!Update.begin(UPDATE_SIZE_UNKNOWN))
         {
             Update.printError(Serial);
@@ -167,18 +213,31 @@ void handleOtaUpdateUpload(AsyncWebServerRequest *request, String filename, size
     {
         Update.printError(Serial);
     }
+    otaVerifier.add(data, len);
+    otaVerifier.printProgress("handleOtaUpdateUpload");
     otaCurrentSize += len; // Update current size
     if (final)
     {
-        if (Update.end(true))
+        otaState = "verifying";
+        if (!otaVerifier.finish(otaExpectedSha))
+        {
+            // not made bootable, the running firmware stays
+            Update.abort();
+            otaShaMismatch = true;
+            otaState = "failed";
+        }
+        else if (Update.end(true))
         {
             Serial.println(">>> OTA update successful!!!");
+            otaImageOk = true;
+            otaState = "done";
             //request->send_P(200, "text/html", ota_complete_html);
             delay(1000);
         }
         else
         {
             Update.printError(Serial);
+            otaState = "failed";
             //String errHtml = ota_error_html;
             //errHtml.replace("__ERR_MESS__", Update.errorString());
             //request->send_P(200, "text/html", errHtml.c_str());                     
@@ -1,6 +1,8 @@
 #include <Arduino.h>
 #include <FreeRTOS.h>
 #include "webPortalBase.h"
+#include "telemetryFeed.h"
+#include "taskRegistry.h"
 #include "../../include/version.h"
 
 #define  PORTAL_BUTTON_PIN      0 
@@ -94,7 +96,7 @@ void initButtonMonitor()
         return;
     wasBtnMonitorInit = true;
     pinMode(PORTAL_BUTTON_PIN, INPUT_PULLUP);  
-    xTaskCreate(buttonMonitorTask, "ButtonMonitor", 2048, NULL, 10, NULL);
+    taskStart(tkButton, buttonMonitorTask);
     attachInterrupt(digitalPinToInterrupt(PORTAL_BUTTON_PIN), buttonISR, FALLING);
 }
 
@@ -130,6 +132,7 @@ void selfPortalOnBoot(uint32_t fwVersion, String portalName)
     tWebPortalBase *wp = new tWebPortalBase(DEFAULT_HTPP_PORT, fwVersion,  portalName, getDeviceMac() + "<br>" + String(VERSION_STR));
     wp->serverOnSetup();
     wp->wifiAPSetup();
+    telemetryAttach(*wp);
     wp->begin();
     Serial.println("Preparing WEB portal: DONE");
     
@@ -0,0 +1,216 @@
+#include "telemetryFeed.h"
+#include "board.h"
+#include "taskRegistry.h"
+
+#include <esp_rom_crc.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#define TELEMETRY_MAX_QUEUED    8       // a slow client skips ticks instead of piling up messages
+#define TELEMETRY_TRACKED_TASKS 32
+
+struct tTelemetrySection
+{
+    const char     *event;
+    tTelemetryFill  fill;
+    uint32_t        crc;        // of the last JSON sent
+};
+
+static void fillSystem(tJsonWriter &json);
+
+static tTelemetrySection sections[TELEMETRY_MAX_SECTIONS] = {{"system", fillSystem, 0}};
+static uint8_t sectionCount = 1;
+static AsyncEventSource *events = NULL;
+static volatile bool forceAll = true;
+static char jsonBuf[TELEMETRY_JSON_BUF];
+
+#if (configGENERATE_RUN_TIME_STATS == 1)
+struct tTaskRun
+{
+    TaskHandle_t handle;
+    uint32_t     runTime;
+};
+
+static tTaskRun taskRun[TELEMETRY_TRACKED_TASKS];
+static uint8_t taskRunCount = 0;
+static uint32_t totalRun = 0;
+
+static uint32_t takeTaskDelta(TaskHandle_t handle, uint32_t runTime, tTaskRun *next, uint8_t &nextCount)
+{
+    uint32_t last = runTime;    // new task: nothing to show until the next tick
+    for (uint8_t i = 0; i < taskRunCount; i++)
+    {
+        if (taskRun[i].handle == handle)
+        {
+            last = taskRun[i].runTime;
+            break;
+        }
+    }
+    if (nextCount < TELEMETRY_TRACKED_TASKS)
+    {
+        next[nextCount].handle = handle;
+        next[nextCount].runTime = runTime;
+        nextCount++;
+    }
+    return runTime - last;
+}
+
+// Busy share of both cores since the previous tick and the busiest tasks
+static void writeTaskCpu(tJsonWriter &json)
+{
+    UBaseType_t count = uxTaskGetNumberOfTasks() + 2;
+    TaskStatus_t *tasks = (TaskStatus_t *)malloc(count * sizeof(TaskStatus_t));
+    if (tasks == NULL)
+    {
+        return;
+    }
+    uint32_t total;
+    count = uxTaskGetSystemState(tasks, count, &total);
+    uint64_t cpuTime = (uint64_t)(total - totalRun) * portNUM_PROCESSORS;
+    totalRun = total;
+
+    tTaskRun next[TELEMETRY_TRACKED_TASKS];
+    uint8_t nextCount = 0;
+    uint64_t idleTime = 0;
+    for (UBaseType_t i = 0; i < count; i++)
+    {
+        tasks[i].ulRunTimeCounter = takeTaskDelta(tasks[i].xHandle, tasks[i].ulRunTimeCounter, next, nextCount);
+        if (!strncmp(tasks[i].pcTaskName, "IDLE", 4))
+        {
+            idleTime += tasks[i].ulRunTimeCounter;
+            tasks[i].ulRunTimeCounter = 0;
+        }
+    }
+    memcpy(taskRun, next, nextCount * sizeof(tTaskRun));
+    taskRunCount = nextCount;
+
+    if (cpuTime > 0)
+    {
+        json.field("cpu_load", (int)(100 - min(idleTime * 100 / cpuTime, (uint64_t)100)));
+        json.beginArray("tasks");
+        for (uint8_t n = 0; n < TELEMETRY_MAX_TASKS; n++)
+        {
+            UBaseType_t top = count;
+            for (UBaseType_t i = 0; i < count; i++)
+            {
+                if ((tasks[i].ulRunTimeCounter > 0) && ((top == count) || (tasks[i].ulRunTimeCounter > tasks[top].ulRunTimeCounter)))
+                {
+                    top = i;
+                }
+            }
+            if (top == count)
+            {
+                break;
+            }
+            json.beginObject();
+            json.field("name", tasks[top].pcTaskName);
+            json.field("pct", (unsigned int)(tasks[top].ulRunTimeCounter * 100 / cpuTime));
+            json.field("stack_free", (unsigned int)tasks[top].usStackHighWaterMark);
+            json.endObject();
+            tasks[top].ulRunTimeCounter = 0;
+        }
+        json.endArray();
+    }
+    free(tasks);
+}
+#endif
+
+static void fillSystem(tJsonWriter &json)
+{
+    json.field("uptime_s", (unsigned long)(millis() / 1000));
+    json.field("heap", ESP.getFreeHeap());
+    json.field("heap_min", ESP.getMinFreeHeap());
+    json.field("heap_max_alloc", ESP.getMaxAllocHeap());
+    json.field("psram", ESP.getFreePsram());
+    json.field("battery_mv", (unsigned int)boardGetVcc());
+    json.field("battery_pct", (unsigned int)boardGetVccPercent());
+#if (configGENERATE_RUN_TIME_STATS == 1)
+    writeTaskCpu(json);
+#else
+    json.field("cpu_load", -1);
+#endif
+}
+
+bool telemetryAddSection(const char *event, tTelemetryFill fill)
+{
+    if (sectionCount >= TELEMETRY_MAX_SECTIONS)
+    {
+        Serial.printf("!!! telemetryAddSection ERROR: no room for [%s]\r\n", event);
+        return false;
+    }
+    sections[sectionCount].event = event;
+    sections[sectionCount].fill = fill;
+    sections[sectionCount].crc = 0;
+    sectionCount++;
+    return true;
+}
+
+// Returns whether anything went out
+static bool sendChanged(bool force)
+{
+    static uint32_t eventId = 0;
+    bool sent = false;
+    for (uint8_t i = 0; i < sectionCount; i++)
+    {
+        tJsonWriter json(jsonBuf, sizeof(jsonBuf));
+        json.beginObject();
+        sections[i].fill(json);
+        json.endObject();
+        if (!json.ok())
+        {
+            Serial.printf("*** telemetry WARNING! [%s] does not fit %u bytes\r\n", sections[i].event, TELEMETRY_JSON_BUF);
+            continue;
+        }
+        uint32_t crc = esp_rom_crc32_le(0, (const uint8_t *)json.c_str(), json.length());
+        if (!force && (crc == sections[i].crc))
+        {
+            continue;
+        }
+        sections[i].crc = crc;
+        events->send(json.c_str(), sections[i].event, ++eventId);
+        sent = true;
+    }
+    return sent;
+}
+
+static void telemetryTask(void *)
+{
+    uint32_t lastSentMs = millis();
+    while (true)
+    {
+        vTaskDelay(pdMS_TO_TICKS(TELEMETRY_MIN_MS));
+        if ((events->count() == 0) || (events->avgPacketsWaiting() > TELEMETRY_MAX_QUEUED))
+        {
+            continue;
+        }
+        bool force = forceAll;
+        forceAll = false;
+        if (sendChanged(force))
+        {
+            lastSentMs = millis();
+        }
+        else if (millis() - lastSentMs >= TELEMETRY_KEEPALIVE_MS)
+        {
+            events->send("{}", "ping", 0);
+            lastSentMs = millis();
+        }
+    }
+}
+
+void telemetryAttach(AsyncWebServer &server)
+{
+    if (events != NULL)
+    {
+        Serial.println("*** telemetryAttach WARNING! already attached");
+        return;
+    }
+    events = new AsyncEventSource(TELEMETRY_PATH);
+    events->onConnect([](AsyncEventSourceClient *client)
+    {
+        client->send("{}", "hello", 0, TELEMETRY_RECONNECT_MS);
+        forceAll = true;
+    });
+    server.addHandler(events);
+    taskStart(tkTelemetry, telemetryTask);
+    Serial.printf(">>> telemetryAttach: %u sections on %s\r\n", sectionCount, TELEMETRY_PATH);
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+
+#include "jsonWriter.h"
+
+// Live telemetry over Server-Sent Events on /events. Each section is one SSE
+// event with a JSON object; a low priority task fills the sections every
+// TELEMETRY_MIN_MS while a client is connected and sends only those whose
+// content changed. A new client gets all sections at once, an idle stream a
+// "ping" every TELEMETRY_KEEPALIVE_MS. The "system" section (heap, battery,
+// task CPU) is built in, the game adds its own with telemetryAddSection().
+
+#define TELEMETRY_PATH          "/events"
+#define TELEMETRY_MIN_MS        500     // fastest rate of one section
+#define TELEMETRY_KEEPALIVE_MS  10000
+#define TELEMETRY_RECONNECT_MS  2000    // retry hint for the browser
+#define TELEMETRY_MAX_SECTIONS  8
+#define TELEMETRY_JSON_BUF      2048
+#define TELEMETRY_MAX_TASKS     6       // busiest tasks in "system"
+
+// Writes the members of the section's object, runs in the telemetry task
+typedef void (*tTelemetryFill)(tJsonWriter &json);
+
+bool telemetryAddSection(const char *event, tTelemetryFill fill);  // event names must be literals
+void telemetryAttach(AsyncWebServer &server);                      // once per server, before begin()
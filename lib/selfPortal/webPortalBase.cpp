@@ -4,15 +4,20 @@
 
 #include "webPortalBase.h"
 #include "utils.h"
-
-#include "html/index_html.h"
-#include "html/device_html.h"
+#include "fsMount.h"
+#include "fsWorker.h"
+#include "jsonWriter.h"
+
+// index, device and editor pages, gzipped by buildscript_portal_assets.py
+#include "html/portal_assets.h"
+#include "tftSnapshot.h"
+#include "serverSync.h"
+#include "valPlayer.h"
 //#include "html/configuration_html.h"
 //#include "html/configuration_files_portal_html.h"
 //#include "html/configuration_file_management_html.h"
 //#include "html/ota_html.h"
 //#include "html/modbus_html.h"
-#include "html/editor_page.h"
 
 
 
@@ -22,6 +27,7 @@ String tWebPortalBase::_devID;
 int tWebPortalBase::_SPIFFSUsed;
 int tWebPortalBase::_SPIFFSTotal;
 bool tWebPortalBase::isReset = false;
+bool tWebPortalBase::isValReload = false;
 bool tWebPortalBase::isOTA = false;
 String tWebPortalBase::otaLink = "";
 String tWebPortalBase::otaSsid = "";
@@ -32,6 +38,9 @@ String tWebPortalBase::_hdr1;
 String tWebPortalBase::_hdr2;
 String tWebPortalBase::_hdr3;
 
+#define PORTAL_JSON_BUF         512
+#define PORTAL_ASSET_MAX_AGE_S  86400   // a firmware update reaches cached browsers within a day
+
 #define PAR_OTA_FILE_LINK "otaFileLink"
 #define PAR_OTA_SSID "otaSSID"
 #define PAR_OTA_PASS "otaPASS"
@@ -141,12 +150,12 @@ void tWebPortalBase::wifiAPSetup()
     // esp_wifi_set_channel(ESP_CHANNEL, WIFI_SECOND_CHAN_NONE);
 
 
-    if (!LittleFS.begin(false))
-        if (!LittleFS.begin(true))
-        {
-            Serial.println("[wifiAPSetup] An Error has occurred while mounting SPIFFS");
-            // return;
-        }
+    // held for the rest of the portal session, the file manager works on it
+    if (!fsAcquire(true))
+    {
+        Serial.println("[wifiAPSetup] An Error has occurred while mounting SPIFFS");
+        // return;
+    }
     _SPIFFSUsed = LittleFS.usedBytes();
     Serial.print("SPIFFS Used bytes=");
     Serial.println(_SPIFFSUsed);
@@ -229,6 +238,80 @@ String tWebPortalBase::processor(const String &var)
     return String();
 }
 
+/////////////////////////////////////
+// A static page as it is in flash, gzipped; a matching If-None-Match gets a 304
+static void sendAsset(AsyncWebServerRequest *request, const uint8_t *gz, size_t len, const char *etag)
+{
+    tWebPortalBase::activityTimeMs = millis();
+    AsyncWebServerResponse *response;
+    if (request->hasHeader("If-None-Match") && (request->header("If-None-Match") == etag))
+    {
+        response = request->beginResponse(304);
+    }
+    else
+    {
+        response = request->beginResponse_P(200, "text/html", gz, len);
+        response->addHeader("Content-Encoding", "gzip");
+    }
+    response->addHeader("ETag", etag);
+    response->addHeader("Cache-Control", "public, max-age=" + String(PORTAL_ASSET_MAX_AGE_S));
+    request->send(response);
+}
+
+// What the pages used to get by template substitution
+static void sendPortalJson(AsyncWebServerRequest *request)
+{
+    tWebPortalBase::activityTimeMs = millis();
+    String portalName = LOCAL_PORTAL_NAME;
+    portalName.replace("_", " ");
+    tJsonBuffer<PORTAL_JSON_BUF> json;
+    json.beginObject();
+    json.field("name", portalName);
+    json.field("hdr1", tWebPortalBase::_hdr1);
+    json.field("hdr2", tWebPortalBase::_hdr2);
+    json.field("hdr3", tWebPortalBase::_hdr3);
+    json.field("heap", ESP.getFreeHeap());
+    json.field("firmware", tWebPortalBase::_versionNum);
+    json.field("dev_id", getDeviceMac());
+    json.field("temperature", "TEMP_111");
+    json.field("vcc", "VCC_111");
+    json.field("fs_used", tWebPortalBase::_SPIFFSUsed);
+    json.field("fs_total", tWebPortalBase::_SPIFFSTotal);
+    json.endObject();
+    if (!json.ok())
+    {
+        request->send(500, "text/plain", "portal.json overflow");
+        return;
+    }
+    AsyncWebServerResponse *response = request->beginResponse(200, "application/json", json.c_str());
+    response->addHeader("Cache-Control", "no-store");
+    request->send(response);
+}
+
+// The frame on the panel, see tftSnapshot.h; its buffer goes with the client
+static void sendSnapshot(AsyncWebServerRequest *request)
+{
+    tWebPortalBase::activityTimeMs = millis();
+    size_t len;
+    uint8_t *snap = tftSnapshotCapture(len);
+    if (snap == NULL)
+    {
+        request->send(503, "text/plain", "no framebuffer");
+        return;
+    }
+    AsyncWebServerResponse *response = request->beginResponse(TFT_SNAP_CT, len,
+        [snap, len](uint8_t *buf, size_t maxLen, size_t index) -> size_t
+        {
+            size_t n = min(maxLen, len - index);
+            memcpy(buf, snap + index, n);
+            return n;
+        });
+    response->addHeader("Cache-Control", "no-store");
+    response->addHeader("Content-Disposition", "attachment; filename=\"snapshot.zfb\"");
+    request->onDisconnect([snap]() { free(snap); });
+    request->send(response);
+}
+
 /////////////////////////////////////
 void tWebPortalBase::notFound(AsyncWebServerRequest *request)
 {
@@ -244,8 +327,7 @@ void tWebPortalBase::serverOnSetup()
         Serial.println("<index>");
         // if(!request->authenticate(WEB_PORTAL_LOGIN, WEB_PORTAL_PASSWORD))
         //     return request->requestAuthentication();
-        request->send_P(200, "text/html", index_html, processor); 
-        activityTimeMs = millis();
+        sendAsset(request, index_html_gz, sizeof(index_html_gz), INDEX_HTML_ETAG);
     }); // index_html
 
     on("/doReset", HTTP_GET, [](AsyncWebServerRequest *request)
@@ -284,6 +366,7 @@ void tWebPortalBase::serverOnSetup()
     on("/ota", HTTP_GET, handleOtaPage);
     on("/update", HTTP_POST, handleOtaUpdateResponse, handleOtaUpdateUpload);
     on("/ota_complete", HTTP_GET, handleOtaComplete);
+    on("/ota_status", HTTP_GET, handleOtaStatus);
 
 
 
@@ -344,8 +427,7 @@ void tWebPortalBase::serverOnSetup()
         //     Serial.println("Bad authentification!!!");
         //     return request->requestAuthentication();
         // }
-        request->send_P(200, "text/html", device_html, processor);
-        activityTimeMs = millis();
+        sendAsset(request, device_html_gz, sizeof(device_html_gz), DEVICE_HTML_ETAG);
     });
 
     
@@ -353,12 +435,23 @@ void tWebPortalBase::serverOnSetup()
     on("/editor", HTTP_GET, [](AsyncWebServerRequest *request)
     {
         Serial.println(">>> EDITOR");
-        request->send_P(200, "text/html", editor_page);
+        sendAsset(request, editor_html_gz, sizeof(editor_html_gz), EDITOR_HTML_ETAG);
     });
     
+    on("/portal.json", HTTP_GET, sendPortalJson);
+    on("/snapshot", HTTP_GET, sendSnapshot);
+    // after /saveFile of val.json or val.bin, the patterns change without a reboot
+    on("/reloadVal", HTTP_GET, [](AsyncWebServerRequest *request)
+    {
+        Serial.println("<reloadVal>");
+        isValReload = true;
+        request->send(202, "text/plain", "reloading the patterns");
+        activityTimeMs = millis();
+    });
+    fsWorkerStart();
     on("/listFiles", HTTP_GET, listFiles);
     on("/getFile", HTTP_GET, getFile);
-    on("/saveFile", HTTP_POST, saveFile);
+    on("/saveFile", HTTP_POST, saveFile, NULL, saveFileBody);
     on("/files", HTTP_GET, handleFileManager);
     on("/download", HTTP_GET, handleDownload);
     on("/upload", HTTP_POST, handleUploadResponse, handleUploadProcess);
@@ -366,7 +459,7 @@ void tWebPortalBase::serverOnSetup()
 
     on("/logo", HTTP_GET, [](AsyncWebServerRequest *request)
     {
-        request->send(SPIFFS, "/logo.png", "image/png");
+        fsSendFile(request, SPIFFS, "/logo.png");
     });
 
     onNotFound(notFound);
@@ -384,6 +477,13 @@ void tWebPortalBase::server_loop()
         delay(100);
         ESP.restart();
     }
+    if (isValReload == true)
+    {
+        isValReload = false;
+        refreshFileInPsram(VAL_FILE_NAME);
+        refreshFileInPsram(VAL_BIN_FILE_NAME);
+        valReload();
+    }
     // if (isOTA == true)
     // {
     //     isOTA = false;
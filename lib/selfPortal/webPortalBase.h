@@ -59,6 +59,7 @@ class tWebPortalBase: public AsyncWebServer
         static String otaPass;
 
         static bool isReset;
+        static bool isValReload;    // /reloadVal, run in server_loop()
         static bool isOTA;
     
         void serverOnSetup(); 
@@ -76,6 +77,7 @@ void createConfigurationFilePage(void);
 void listFiles(AsyncWebServerRequest *request);
 void getFile(AsyncWebServerRequest *request);
 void saveFile(AsyncWebServerRequest *request);
+void saveFileBody(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total);
 void handleUploadProcess(AsyncWebServerRequest *request, String filename, size_t index, uint8_t *data, size_t len, bool final);
 void handleUploadResponse(AsyncWebServerRequest *request);
 void handleDownload(AsyncWebServerRequest *request);
@@ -87,6 +89,7 @@ void handleOtaUpdateUpload(AsyncWebServerRequest *request, String filename, size
 void handleOtaUpdateResponse(AsyncWebServerRequest *request);
 void handleOtaComplete(AsyncWebServerRequest *request);
 void handleOtaPage(AsyncWebServerRequest *request);
+void handleOtaStatus(AsyncWebServerRequest *request);
 
 
 void webDnsInit_AP(void);
@@ -1,21 +1,187 @@
 #include <Arduino.h>
+#include <esp_rom_crc.h>
 
 #include "serialCommander.h"
+#include "taskRegistry.h"
 
 #define SERIAL_COMM_SCAN_LIST           "scan_list"
 extern void onSerialScanList(void);
+#define SERIAL_COMM_RADIO_STATS         "radio_stats"
+extern void onSerialRadioStats(void);
+#define SERIAL_COMM_RX_REC_START        "rx_rec_start"
+extern void onSerialRxRecStart(void);
+#define SERIAL_COMM_RX_REC_STOP         "rx_rec_stop"
+extern void onSerialRxRecStop(void);
+#define SERIAL_COMM_RX_REPLAY           "rx_replay"
+extern void onSerialRxReplay(String args);
+#define SERIAL_COMM_SYNC_BENCH          "sync_bench"
+extern void onSerialSyncBench(String args);
+#define SERIAL_COMM_BENCH               "bench"
+extern void onSerialBench(String args);
+#define SERIAL_COMM_ENERGY              "energy"
+extern void onSerialEnergy(String args);
+#define SERIAL_COMM_TUNE                "tune"
+extern void onSerialTune(String args);
+#define SERIAL_COMM_LOG                 "log"
+extern void onSerialLog(String args);
+#define SERIAL_COMM_JSON_MEM            "json_mem"
+extern void onSerialJsonMem(void);
+#define SERIAL_COMM_TASKS               "tasks"
+extern void onSerialTasks(void);
+#define SERIAL_COMM_LOOP_STATS          "loop_stats"
+extern void onSerialLoopStats(String args);
+#define SERIAL_COMM_HIT_LATENCY         "hit_latency"
+extern void onSerialHitLatency(String args);
+#define SERIAL_COMM_GAME_LOG            "game_log"
+extern void onSerialGameLog(void);
+#define SERIAL_COMM_VAL_RELOAD          "val_reload"
+extern void onSerialValReload(void);
+#define SERIAL_COMM_NEIGHBOR_GRAPH      "neighbor_graph"
+extern void onSerialNeighborGraph(void);
+#define SERIAL_COMM_HTTP_POOL           "http_pool"
+extern void onSerialHttpPool(void);
+#define SERIAL_COMM_MEM_MAP             "mem_map"
+extern void onSerialMemMap(void);
+#define SERIAL_COMM_WIFI_ROAM           "wifi_roam"
+extern void onSerialWifiRoam(void);
+#define SERIAL_COMM_PING_STATS          "ping_stats"
+extern void onSerialPingStats(void);
+#define SERIAL_COMM_RX_STREAM           "rx_stream"
+extern void onSerialRxStream(String args);
+extern void onSerialStreamPoll(void);
+#define SERIAL_COMM_PROV                "prov"
+extern void onSerialProv(String args);
+#if TFT_TEST_PATTERN
+#define SERIAL_COMM_TEST_PATTERN        "test_pattern"
+extern void onSerialTestPattern(String args);
+#endif
 #define SERIAL_COMM_HELP                "help"
 void onHelp(void);
+extern void onSerialBinary(uint8_t type, uint8_t seq, const uint8_t *payload, uint16_t len);
 
-static String getSerialCommand(void)
+#define SLIP_END        0xC0
+#define SLIP_ESC        0xDB
+#define SLIP_ESC_END    0xDC
+#define SLIP_ESC_ESC    0xDD
+#define SERIAL_BIN_HDR  2       // type, seq
+#define SERIAL_BIN_CRC  4
+
+static TaskHandle_t     commTask = NULL;
+static String           textBuf;
+static uint32_t         textLastMs = 0;
+static uint8_t          binBuf[SERIAL_BIN_HDR + SERIAL_BIN_RX_MAX + SERIAL_BIN_CRC];
+static uint16_t         binLen = 0;
+static uint32_t         binStartMs = 0;
+static bool             binOpen = false;
+static bool             binEsc = false;
+static bool             binOverflow = false;
+static volatile bool    captureOn = false;     // serialCommReadText() waits for a block
+static volatile bool    captureDone = false;
+static String           captured;
+
+static uint8_t          txBuf[256];
+static uint16_t         txLen = 0;
+static uint32_t         txCrc = 0;
+
+static void dispatchText(String comS);
+
+static void onBinaryFrame(void)
 {
-    String res = "";
-    if (!Serial.available())
-        return "";
-    delay(30);
-    while(Serial.available())
-        res += (char) Serial.read();
-    return res;
+    if (binOverflow || (binLen < SERIAL_BIN_HDR + SERIAL_BIN_CRC))
+    {
+        Serial.printf("!!! onBinaryFrame ERROR: bad length %u\r\n", binLen);
+        return;
+    }
+    uint16_t dataLen = binLen - SERIAL_BIN_CRC;
+    uint32_t crc = binBuf[dataLen] | (binBuf[dataLen + 1] << 8) | (binBuf[dataLen + 2] << 16) | ((uint32_t)binBuf[dataLen + 3] << 24);
+    if (crc != esp_rom_crc32_le(0, binBuf, dataLen))
+    {
+        Serial.println("!!! onBinaryFrame ERROR: bad CRC");
+        return;
+    }
+    uint8_t type = binBuf[0];
+    uint8_t seq = binBuf[1];
+    if (type == sbPing)
+    {
+        serialBinSend(type | SERIAL_BIN_REPLY, seq, NULL, 0);
+        return;
+    }
+    onSerialBinary(type, seq, &binBuf[SERIAL_BIN_HDR], dataLen - SERIAL_BIN_HDR);
+}
+
+static void onTextBlock(void)
+{
+    String block = textBuf;
+    textBuf = "";
+    if (captureOn && !captureDone)
+    {
+        captured = block;
+        captureDone = true;
+        return;
+    }
+    block.trim();
+    if (block.length())
+    {
+        dispatchText(block);
+    }
+}
+
+static void feedByte(uint8_t c)
+{
+    if (c == SLIP_END)
+    {
+        if (!binOpen)
+        {
+            binOpen = true;
+            binStartMs = millis();
+        }
+        else if (binLen || binOverflow)
+        {
+            onBinaryFrame();
+            binOpen = false;
+        }
+        binLen = 0;
+        binEsc = false;
+        binOverflow = false;
+        return;
+    }
+    if (binOpen)
+    {
+        if (c == SLIP_ESC)
+        {
+            binEsc = true;
+            return;
+        }
+        if (binEsc)
+        {
+            c = (c == SLIP_ESC_END) ? SLIP_END : (c == SLIP_ESC_ESC) ? SLIP_ESC : c;
+            binEsc = false;
+        }
+        if (binLen < sizeof(binBuf))
+        {
+            binBuf[binLen++] = c;
+        }
+        else
+        {
+            binOverflow = true;
+        }
+        return;
+    }
+
+    textLastMs = millis();
+    // a text block for serialCommReadText() may span lines, ends on a pause only
+    if (((c == '\n') || (c == '\r')) && !captureOn)
+    {
+        if (textBuf.length())
+        {
+            onTextBlock();
+        }
+        return;
+    }
+    if (textBuf.length() < SERIAL_COMM_TEXT_MAX)
+    {
+        textBuf += (char)c;
+    }
 }
 
 bool isCommand(String comTxt, String comS)
@@ -28,27 +194,152 @@ bool isCommand(String comTxt, String comS)
 void serialCommTask(void*)
 {
     Serial.println(">>> serialCommTask: STARTED");
-    delay(3000); //wait for scan
     while(true)
     {
         serialCommLoop();
-        delay(10);
+        delay(5);
     }
 }
 
 void serialCommInit(void)
 {
-    xTaskCreatePinnedToCore(serialCommTask, "serialCommTask", 4096, NULL, 5, NULL, APP_CPU_NUM);
+    if (commTask != NULL)
+    {
+        return;
+    }
+    taskStart(tkSerial, serialCommTask, NULL, &commTask);
 }
 
+// Takes what has arrived and returns, a command runs once it is complete
 void serialCommLoop(void)
-{    
-    String comS = getSerialCommand();
-    if (comS == "")
+{
+    int n = Serial.available();
+    while (n-- > 0)
+    {
+        feedByte((uint8_t)Serial.read());
+    }
+    uint32_t idleMs = captureOn ? SERIAL_COMM_JSON_IDLE_MS : SERIAL_COMM_IDLE_MS;
+    if (textBuf.length() && (millis() - textLastMs > idleMs))
+    {
+        onTextBlock();
+    }
+    if (binOpen && binLen && (millis() - binStartMs > SERIAL_BIN_TIMEOUT_MS))
+    {
+        Serial.println("*** serialCommLoop WARNING! Binary frame timed out");
+        binOpen = false;
+        binLen = 0;
+    }
+    onSerialStreamPoll();
+}
+
+bool serialCommReadText(String &out, uint32_t timeoutMs)
+{
+    captureDone = false;
+    captureOn = true;
+    uint32_t startMs = millis();
+    while (!captureDone)
+    {
+        if ((timeoutMs != 0) && (millis() - startMs > timeoutMs))
+        {
+            captureOn = false;
+            return false;
+        }
+        if (commTask == NULL)
+        {
+            serialCommLoop();
+        }
+        delay(5);
+    }
+    out = captured;
+    captured = "";
+    captureOn = false;
+    return true;
+}
+
+static void txFlush(void)
+{
+    if (txLen)
+    {
+        Serial.write(txBuf, txLen);
+        txLen = 0;
+    }
+}
+
+static inline void txPut(uint8_t c)
+{
+    if (txLen >= sizeof(txBuf))
+    {
+        txFlush();
+    }
+    txBuf[txLen++] = c;
+}
+
+static void txEscaped(const uint8_t *data, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        uint8_t c = data[i];
+        if (c == SLIP_END)
+        {
+            txPut(SLIP_ESC);
+            txPut(SLIP_ESC_END);
+        }
+        else if (c == SLIP_ESC)
+        {
+            txPut(SLIP_ESC);
+            txPut(SLIP_ESC_ESC);
+        }
+        else
+        {
+            txPut(c);
+        }
+    }
+}
+
+void serialBinBegin(uint8_t type, uint8_t seq)
+{
+    uint8_t hdr[SERIAL_BIN_HDR] = {type, seq};
+    txLen = 0;
+    txPut(SLIP_END);
+    txCrc = esp_rom_crc32_le(0, hdr, sizeof(hdr));
+    txEscaped(hdr, sizeof(hdr));
+}
+
+void serialBinWrite(const void *data, size_t len)
+{
+    if (len == 0)
     {
         return;
     }
-    
+    txCrc = esp_rom_crc32_le(txCrc, (const uint8_t *)data, len);
+    txEscaped((const uint8_t *)data, len);
+}
+
+void serialBinEnd(void)
+{
+    uint8_t crc[SERIAL_BIN_CRC] = {(uint8_t)txCrc, (uint8_t)(txCrc >> 8), (uint8_t)(txCrc >> 16), (uint8_t)(txCrc >> 24)};
+    txEscaped(crc, sizeof(crc));
+    txPut(SLIP_END);
+    txFlush();
+}
+
+void serialBinSend(uint8_t type, uint8_t seq, const void *data, size_t len)
+{
+    serialBinBegin(type, seq);
+    serialBinWrite(data, len);
+    serialBinEnd();
+}
+
+void serialBinError(uint8_t reqType, uint8_t seq, const char *text)
+{
+    serialBinBegin(sbError | SERIAL_BIN_REPLY, seq);
+    serialBinWrite(&reqType, 1);
+    serialBinWrite(text, strlen(text));
+    serialBinEnd();
+}
+
+static void dispatchText(String comS)
+{
     Serial.printf(">>> Serial command [%s] received\r\n", comS.c_str());
 
     if (isCommand(comS, SERIAL_COMM_SCAN_LIST))
@@ -57,6 +348,169 @@ void serialCommLoop(void)
         return;
     }            
 
+    if (isCommand(comS, SERIAL_COMM_RADIO_STATS))
+    {        
+        onSerialRadioStats();
+        return;
+    }            
+
+    if (isCommand(comS, SERIAL_COMM_RX_REC_START))
+    {        
+        onSerialRxRecStart();
+        return;
+    }            
+
+    if (isCommand(comS, SERIAL_COMM_RX_REC_STOP))
+    {        
+        onSerialRxRecStop();
+        return;
+    }            
+
+    if (isCommand(comS, SERIAL_COMM_RX_REPLAY))
+    {        
+        String args = comS.substring(comS.indexOf(SERIAL_COMM_RX_REPLAY) + strlen(SERIAL_COMM_RX_REPLAY));
+        args.trim();
+        onSerialRxReplay(args);
+        return;
+    }            
+
+    // ahead of SERIAL_COMM_BENCH, which it contains
+    if (isCommand(comS, SERIAL_COMM_SYNC_BENCH))
+    {
+        String args = comS.substring(comS.indexOf(SERIAL_COMM_SYNC_BENCH) + strlen(SERIAL_COMM_SYNC_BENCH));
+        args.trim();
+        onSerialSyncBench(args);
+        return;
+    }
+
+    if (isCommand(comS, SERIAL_COMM_BENCH))
+    {        
+        String args = comS.substring(comS.indexOf(SERIAL_COMM_BENCH) + strlen(SERIAL_COMM_BENCH));
+        args.trim();
+        onSerialBench(args);
+        return;
+    }            
+
+    if (isCommand(comS, SERIAL_COMM_ENERGY))
+    {        
+        String args = comS.substring(comS.indexOf(SERIAL_COMM_ENERGY) + strlen(SERIAL_COMM_ENERGY));
+        args.trim();
+        onSerialEnergy(args);
+        return;
+    }            
+
+    if (isCommand(comS, SERIAL_COMM_TUNE))
+    {
+        String args = comS.substring(comS.indexOf(SERIAL_COMM_TUNE) + strlen(SERIAL_COMM_TUNE));
+        args.trim();
+        onSerialTune(args);
+        return;
+    }
+
+    if (isCommand(comS, SERIAL_COMM_LOG))
+    {
+        String args = comS.substring(comS.indexOf(SERIAL_COMM_LOG) + strlen(SERIAL_COMM_LOG));
+        args.trim();
+        onSerialLog(args);
+        return;
+    }
+
+    if (isCommand(comS, SERIAL_COMM_JSON_MEM))
+    {
+        onSerialJsonMem();
+        return;
+    }
+
+    if (isCommand(comS, SERIAL_COMM_TASKS))
+    {
+        onSerialTasks();
+        return;
+    }
+
+    if (isCommand(comS, SERIAL_COMM_LOOP_STATS))
+    {
+        String args = comS.substring(comS.indexOf(SERIAL_COMM_LOOP_STATS) + strlen(SERIAL_COMM_LOOP_STATS));
+        args.trim();
+        onSerialLoopStats(args);
+        return;
+    }
+
+    if (isCommand(comS, SERIAL_COMM_HIT_LATENCY))
+    {
+        String args = comS.substring(comS.indexOf(SERIAL_COMM_HIT_LATENCY) + strlen(SERIAL_COMM_HIT_LATENCY));
+        args.trim();
+        onSerialHitLatency(args);
+        return;
+    }
+
+    if (isCommand(comS, SERIAL_COMM_GAME_LOG))
+    {
+        onSerialGameLog();
+        return;
+    }
+
+    if (isCommand(comS, SERIAL_COMM_VAL_RELOAD))
+    {
+        onSerialValReload();
+        return;
+    }
+
+    if (isCommand(comS, SERIAL_COMM_NEIGHBOR_GRAPH))
+    {
+        onSerialNeighborGraph();
+        return;
+    }
+
+    if (isCommand(comS, SERIAL_COMM_HTTP_POOL))
+    {
+        onSerialHttpPool();
+        return;
+    }
+
+    if (isCommand(comS, SERIAL_COMM_MEM_MAP))
+    {
+        onSerialMemMap();
+        return;
+    }
+
+    if (isCommand(comS, SERIAL_COMM_WIFI_ROAM))
+    {
+        onSerialWifiRoam();
+        return;
+    }
+
+    if (isCommand(comS, SERIAL_COMM_PING_STATS))
+    {
+        onSerialPingStats();
+        return;
+    }
+
+    if (isCommand(comS, SERIAL_COMM_RX_STREAM))
+    {
+        String args = comS.substring(comS.indexOf(SERIAL_COMM_RX_STREAM) + strlen(SERIAL_COMM_RX_STREAM));
+        args.trim();
+        onSerialRxStream(args);
+        return;
+    }
+
+    if (isCommand(comS, SERIAL_COMM_PROV))
+    {
+        String args = comS.substring(comS.indexOf(SERIAL_COMM_PROV) + strlen(SERIAL_COMM_PROV));
+        args.trim();
+        onSerialProv(args);
+        return;
+    }
+
+#if TFT_TEST_PATTERN
+    if (isCommand(comS, SERIAL_COMM_TEST_PATTERN))
+    {
+        String args = comS.substring(comS.indexOf(SERIAL_COMM_TEST_PATTERN) + strlen(SERIAL_COMM_TEST_PATTERN));
+        args.trim();
+        onSerialTestPattern(args);
+        return;
+    }
+#endif
+
     if (isCommand(comS, SERIAL_COMM_HELP))
     {        
         onHelp();
@@ -72,6 +526,31 @@ void onHelp(void)
     Serial.println(">>>>>>>>>>> SERIAL COMMANDS: <<<<<<<<<<<");
     Serial.printf("%-15s This help\r\n", SERIAL_COMM_HELP);
     Serial.printf("%-15s Print all scanned devices\r\n", SERIAL_COMM_SCAN_LIST);
+    Serial.printf("%-15s Print ESP-NOW channel quality counters\r\n", SERIAL_COMM_RADIO_STATS);
+    Serial.printf("%-15s Start recording the received frames\r\n", SERIAL_COMM_RX_REC_START);
+    Serial.printf("%-15s Stop recording and save the session to PSRamFS\r\n", SERIAL_COMM_RX_REC_STOP);
+    Serial.printf("%-15s [n] Time the firmware hot paths, JSON report\r\n", SERIAL_COMM_BENCH);
+    Serial.printf("%-15s [files] [kb] [new] [nopsram] [noota] Sync and OTA download throughput, JSON report\r\n", SERIAL_COMM_SYNC_BENCH);
+    Serial.printf("%-15s [start|stop] Energy profile per subsystem, no argument prints it\r\n", SERIAL_COMM_ENERGY);
+    Serial.printf("%-15s [module level] Deferred log level (error|warn|info|debug), no argument lists them\r\n", SERIAL_COMM_LOG);
+    Serial.printf("%-15s JSON document bytes held and peak per kind\r\n", SERIAL_COMM_JSON_MEM);
+    Serial.printf("%-15s Stack never used, priority and CPU share of every task\r\n", SERIAL_COMM_TASKS);
+    Serial.printf("%-15s [reset] Game loop stage timings, p50/p99/max over the window\r\n", SERIAL_COMM_LOOP_STATS);
+    Serial.printf("%-15s [on|off|reset] Hit stamps in the beacons, no argument prints the latencies\r\n", SERIAL_COMM_HIT_LATENCY);
+    Serial.printf("%-15s Size and upload state of the game analytics log\r\n", SERIAL_COMM_GAME_LOG);
+    Serial.printf("%-15s Play val.json/val.bin from LittleFS without a reboot\r\n", SERIAL_COMM_VAL_RELOAD);
+    Serial.printf("%-15s Who sees whom, from the players' beacon summaries (bases)\r\n", SERIAL_COMM_NEIGHBOR_GRAPH);
+    Serial.printf("%-15s Shared HTTP connections: reuse counts and the open ones\r\n", SERIAL_COMM_HTTP_POOL);
+    Serial.printf("%-15s Heap map: free, largest blocks and fragmentation, bytes per subsystem\r\n", SERIAL_COMM_MEM_MAP);
+    Serial.printf("%-15s AP roaming: filtered RSSI, scans and reassociations\r\n", SERIAL_COMM_WIFI_ROAM);
+    Serial.printf("%-15s Pinger: RTT histogram, loss and the devices that answer\r\n", SERIAL_COMM_PING_STATS);
+    Serial.printf("%-15s [on|off] Every received frame as binary frames, no argument prints the counters\r\n", SERIAL_COMM_RX_STREAM);
+    Serial.printf("%-15s [send [file]] Broadcast the fleet config, /prov.json by default; no argument prints the ACKs\r\n", SERIAL_COMM_PROV);
+#if TFT_TEST_PATTERN
+    Serial.printf("%-15s [bars] Panel test pattern, the synced one unless bars\r\n", SERIAL_COMM_TEST_PATTERN);
+#endif
+    Serial.printf("%-15s [role json] Replay the saved session, optionally with another role file\r\n", SERIAL_COMM_RX_REPLAY);
+    Serial.println("SLIP framed binary requests for host tools, see serialCommander.h");
 
     Serial.println("=========================================");
 }
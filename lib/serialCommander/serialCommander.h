@@ -1,6 +1,46 @@
 #pragma once
 #include <Arduino.h>
 
+// Text commands and binary frames share the USB-CDC port. A text command ends
+// with a newline or a SERIAL_COMM_IDLE_MS pause. A binary frame is SLIP framed
+// (RFC 1055, 0xC0 before and after it, which text never contains) and holds
+// type, seq, payload and the zlib CRC-32 of those three, little endian. The
+// reply to a request has type | SERIAL_BIN_REPLY and the request's seq. Log
+// lines of other tasks may land inside a long reply, the host drops frames
+// with a bad CRC and asks again.
+
+#define SERIAL_COMM_IDLE_MS     30      // pause that ends a text command without a newline
+#define SERIAL_COMM_JSON_IDLE_MS 100    // pause that ends a text block read by serialCommReadText()
+#define SERIAL_COMM_TEXT_MAX    16384
+#define SERIAL_BIN_RX_MAX       256     // request payload
+#define SERIAL_BIN_TIMEOUT_MS   500     // a frame left open this long is dropped
+#define SERIAL_BIN_REPLY        0x80
+
+enum tSerialBinType
+{
+    sbPing       = 0x01,    // -> empty reply
+    sbDevices    = 0x10,    // -> uint16 count, count x tSerialBinDevice (serialHandlers.cpp)
+    sbRadioStats = 0x11,    // -> tSerialBinRadioStats (serialHandlers.cpp)
+    sbBench      = 0x12,    // [uint32 iterations] -> the benchRunAll JSON
+    sbFrame      = 0x13,    // -> uint16 width, uint16 height, RGB565 pixels as the panel gets them
+    sbSnapshot   = 0x14,    // -> the frame run-length coded with the display timing, see tftSnapshot.h
+    sbRxStream   = 0x15,    // [uint8 on] -> uint8 on; while on, unsolicited sbRxStream | SERIAL_BIN_REPLY
+                            //   frames: uint32 dropped, uint16 count, count x tEspRxStreamRec (espRxStream.h)
+    sbError      = 0x7F     // reply only: uint8 request type, error text
+};
+
 void serialCommInit(void);
 void serialCommLoop(void);
-bool isCommand(String comTxt, String comS);
\ No newline at end of file
+bool isCommand(String comTxt, String comS);
+
+// Next text block from the port instead of a command, newlines included;
+// timeoutMs 0 waits for ever. Runs the parser itself while serialCommInit()
+// has not started the task.
+bool serialCommReadText(String &out, uint32_t timeoutMs = 0);
+
+// Reply frames, from the handlers in the commander task only
+void serialBinBegin(uint8_t type, uint8_t seq);
+void serialBinWrite(const void *data, size_t len);
+void serialBinEnd(void);
+void serialBinSend(uint8_t type, uint8_t seq, const void *data, size_t len);
+void serialBinError(uint8_t reqType, uint8_t seq, const char *text);
@@ -0,0 +1,95 @@
+#include "assetFs.h"
+
+#include <FSImpl.h>
+#include "assetPack.h"
+
+using namespace fs;
+
+class AssetFileImpl : public FileImpl
+{
+public:
+    AssetFileImpl(const char *path, const uint8_t *data, size_t size) : _data(data), _size(size), _pos(0)
+    {
+        strncpy(_path, path, sizeof(_path) - 1);
+        _path[sizeof(_path) - 1] = 0;
+    }
+
+    size_t write(const uint8_t *buf, size_t size) { return 0; }
+
+    size_t read(uint8_t *buf, size_t size)
+    {
+        size_t n = min(size, _size - _pos);
+        memcpy(buf, _data + _pos, n);
+        _pos += n;
+        return n;
+    }
+
+    void flush() {}
+
+    bool seek(uint32_t pos, SeekMode mode)
+    {
+        size_t base = (mode == SeekCur) ? _pos : (mode == SeekEnd) ? _size : 0;
+        if (base + pos > _size)
+        {
+            return false;
+        }
+        _pos = base + pos;
+        return true;
+    }
+
+    size_t position() const { return _pos; }
+    size_t size() const { return _size; }
+    bool setBufferSize(size_t size) { return true; }
+    void close() { _data = NULL; }
+    time_t getLastWrite() { return 0; }
+    const char *path() const { return _path; }
+
+    const char *name() const
+    {
+        const char *slash = strrchr(_path, '/');
+        return slash ? slash + 1 : _path;
+    }
+
+    boolean isDirectory(void) { return false; }
+    FileImplPtr openNextFile(const char *mode) { return FileImplPtr(); }
+    boolean seekDir(long position) { return false; }
+    String getNextFileName(void) { return ""; }
+    String getNextFileName(bool *isDir) { return ""; }
+    void rewindDirectory(void) {}
+    operator bool() { return _data != NULL; }
+
+private:
+    const uint8_t *_data;
+    size_t _size;
+    size_t _pos;
+    char _path[64];
+};
+
+class AssetFSImpl : public FSImpl
+{
+public:
+    FileImplPtr open(const char *path, const char *mode, const bool create)
+    {
+        const uint8_t *data;
+        size_t size;
+        if ((mode[0] != 'r') || (strchr(mode, '+') != NULL) || !assetPackFind(path, &data, &size))
+        {
+            return FileImplPtr();
+        }
+        return std::make_shared<AssetFileImpl>(path, data, size);
+    }
+
+    bool exists(const char *path)
+    {
+        const uint8_t *data;
+        size_t size;
+        return assetPackFind(path, &data, &size);
+    }
+
+    bool rename(const char *pathFrom, const char *pathTo) { return false; }
+    bool remove(const char *path) { return false; }
+    bool mkdir(const char *path) { return false; }
+    bool rmdir(const char *path) { return false; }
+};
+
+FS AssetFS = FS(FSImplPtr(new AssetFSImpl()));
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <FS.h>
+
+// Read-only fs::FS over the mapped asset image (assetPack.h): open() is a
+// hash probe and the file reads copy straight out of the mapping, for the
+// libraries that only take a file, such as the MP3 decoder. Nothing is
+// listed, written or removed. Valid until the next asset sync, like the
+// spans assetPackFind() returns.
+extern fs::FS AssetFS;
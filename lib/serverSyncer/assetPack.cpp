@@ -0,0 +1,287 @@
+#include "assetPack.h"
+
+#include <HTTPClient.h>
+#include "httpPool.h"
+#include <ArduinoJson.h>
+#include <Preferences.h>
+#include <esp_partition.h>
+#include <esp_timer.h>
+#include <esp_heap_caps.h>
+#include "bootProfile.h"
+#include "syncAdmission.h"
+
+static const esp_partition_t *packPartition = NULL;
+static spi_flash_mmap_handle_t packHandle = 0;
+static const uint8_t *packBase = NULL;
+static const tAssetPackEntry *packEntries = NULL;
+static uint16_t packCount = 0;
+static uint16_t *packIndex = NULL;          // open addressed by name hash, entry + 1, 0 is empty
+static uint16_t packIndexMask = 0;
+
+static uint32_t nameHash(const char *name)
+{
+    if (*name == '/')
+    {
+        name++;
+    }
+    uint32_t h = 0x811C9DC5;
+    while (*name)
+    {
+        h = (h ^ (uint8_t)*name++) * 0x01000193;
+    }
+    return h;
+}
+
+static bool findPartition(void)
+{
+    if (packPartition == NULL)
+    {
+        packPartition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, (esp_partition_subtype_t)ASSET_PACK_SUBTYPE,
+                                                 ASSET_PACK_PARTITION);
+    }
+    return packPartition != NULL;
+}
+
+// Built once per mount, a lookup then probes a slot or two instead of the entry table
+static void buildIndex(void)
+{
+    uint32_t slots = 16;
+    while ((slots < 2u * packCount) && (slots < 0x8000))
+    {
+        slots <<= 1;
+    }
+    packIndex = (uint16_t *)heap_caps_calloc(slots, sizeof(uint16_t), MALLOC_CAP_SPIRAM);
+    if (packIndex == NULL)
+    {
+        Serial.println("*** assetPackMount WARNING! no memory for the index, names are looked up in the entry table");
+        return;
+    }
+    packIndexMask = slots - 1;
+    for (uint16_t i = 0; i < packCount; i++)
+    {
+        uint32_t s = packEntries[i].nameHash & packIndexMask;
+        while (packIndex[s] != 0)
+        {
+            s = (s + 1) & packIndexMask;
+        }
+        packIndex[s] = i + 1;
+    }
+}
+
+static const tAssetPackEntry *findEntry(uint32_t h)
+{
+    if (packIndex == NULL)
+    {
+        for (uint16_t i = 0; i < packCount; i++)
+        {
+            if (packEntries[i].nameHash == h)
+            {
+                return &packEntries[i];
+            }
+        }
+        return NULL;
+    }
+    for (uint32_t s = h & packIndexMask; packIndex[s] != 0; s = (s + 1) & packIndexMask)
+    {
+        const tAssetPackEntry *e = &packEntries[packIndex[s] - 1];
+        if (e->nameHash == h)
+        {
+            return e;
+        }
+    }
+    return NULL;
+}
+
+bool assetPackMounted(void)
+{
+    return packBase != NULL;
+}
+
+bool assetPackMount(void)
+{
+    if (packBase != NULL)
+    {
+        return true;
+    }
+    if (!findPartition())
+    {
+        Serial.println("*** assetPackMount: no assets partition");
+        return false;
+    }
+
+    tAssetPackHeader hdr;
+    if ((esp_partition_read(packPartition, 0, &hdr, sizeof(hdr)) != ESP_OK) || (hdr.magic != ASSET_PACK_MAGIC) ||
+        (hdr.version != ASSET_PACK_VERSION) || (hdr.imageSize > packPartition->size) ||
+        (sizeof(hdr) + hdr.count * sizeof(tAssetPackEntry) > hdr.imageSize))
+    {
+        Serial.println("*** assetPackMount: no valid asset image");
+        return false;
+    }
+
+    const void *ptr = NULL;
+    if (esp_partition_mmap(packPartition, 0, hdr.imageSize, SPI_FLASH_MMAP_DATA, &ptr, &packHandle) != ESP_OK)
+    {
+        Serial.println("!!! assetPackMount ERROR: mmap failed");
+        return false;
+    }
+    packBase = (const uint8_t *)ptr;
+    packEntries = (const tAssetPackEntry *)(packBase + sizeof(tAssetPackHeader));
+    packCount = hdr.count;
+    buildIndex();
+    Serial.printf(">>> assetPackMount: %d assets, %lu bytes mapped\r\n", packCount, hdr.imageSize);
+    return true;
+}
+
+void assetPackUnmount(void)
+{
+    if (packBase != NULL)
+    {
+        spi_flash_munmap(packHandle);
+        packBase = NULL;
+        packEntries = NULL;
+        packCount = 0;
+        free(packIndex);
+        packIndex = NULL;
+        packIndexMask = 0;
+    }
+}
+
+bool assetPackFind(const char *name, const uint8_t **data, size_t *size, tAssetFormat *format)
+{
+    if (packBase == NULL)
+    {
+        return false;
+    }
+    const tAssetPackEntry *e = findEntry(nameHash(name));
+    if (e == NULL)
+    {
+        return false;
+    }
+    *data = packBase + e->offset;
+    *size = e->size;
+    if (format)
+    {
+        *format = (tAssetFormat)e->format;
+    }
+    return true;
+}
+
+// Streams the image into the erased partition, the stored hash is cleared
+// first so an interrupted write is fetched again on the next boot
+static bool writeImage(const char *serverAddress, uint32_t imageSize)
+{
+    HTTPClient http;
+    http.begin(String(serverAddress) + "/assets/image");
+    http.setTimeout(10000);
+    syncCollectHeaders(http);
+    int64_t startUs = esp_timer_get_time();
+    int httpCode = http.GET();
+    bootProfHttp(startUs);
+    if ((httpCode != HTTP_CODE_OK) || (http.getSize() != (int)imageSize))
+    {
+        Serial.printf("!!! assetPackSync ERROR: image download failed (%d, %d bytes)\r\n", httpCode, http.getSize());
+        syncNoteAdmission(http, httpCode);
+        http.end();
+        return false;
+    }
+
+    size_t eraseSize = (imageSize + SPI_FLASH_SEC_SIZE - 1) & ~(SPI_FLASH_SEC_SIZE - 1);
+    if (esp_partition_erase_range(packPartition, 0, eraseSize) != ESP_OK)
+    {
+        Serial.println("!!! assetPackSync ERROR: erase failed");
+        http.end();
+        return false;
+    }
+
+    uint8_t *buf = (uint8_t *)malloc(ASSET_PACK_WRITE_BUF);
+    WiFiClient *stream = http.getStreamPtr();
+    uint32_t written = 0;
+    uint32_t lastDataMs = millis();
+    bool ok = (buf != NULL);
+    while (ok && (written < imageSize))
+    {
+        size_t want = min((size_t)ASSET_PACK_WRITE_BUF, (size_t)(imageSize - written));
+        size_t got = stream->readBytes(buf, want);
+        if (got == 0)
+        {
+            if (!http.connected() || (millis() - lastDataMs > 10000))
+            {
+                Serial.println("!!! assetPackSync ERROR: download stalled");
+                ok = false;
+            }
+            continue;
+        }
+        lastDataMs = millis();
+        if (esp_partition_write(packPartition, written, buf, got) != ESP_OK)
+        {
+            Serial.println("!!! assetPackSync ERROR: flash write failed");
+            ok = false;
+        }
+        written += got;
+    }
+    free(buf);
+    http.end();
+    return ok;
+}
+
+bool assetPackSync(const char *serverAddress)
+{
+    if (!findPartition())
+    {
+        Serial.println("*** assetPackSync: no assets partition, assets stay in PSRAM only");
+        return false;
+    }
+
+    String infoUrl = String(serverAddress) + "/assets/info";
+    tHttpLease lease(infoUrl);
+    HTTPClient &http = lease.http();
+    lease.begin(infoUrl);
+    http.setTimeout(10000);
+    int64_t startUs = esp_timer_get_time();
+    int httpCode = http.GET();
+    bootProfHttp(startUs);
+    if (httpCode != HTTP_CODE_OK)
+    {
+        Serial.printf("!!! assetPackSync HTTP ERROR: %d\r\n", httpCode);
+        http.end();
+        return assetPackMount();
+    }
+    JsonDocument doc;
+    DeserializationError error = deserializeJson(doc, http.getString());
+    http.end();
+    if (error)
+    {
+        Serial.println("!!! assetPackSync ERROR: Failed to parse JSON response");
+        return assetPackMount();
+    }
+    String serverHash = doc["hash"].as<String>();
+    uint32_t imageSize = doc["size"].as<uint32_t>();
+
+    Preferences prefs;
+    prefs.begin(ASSET_PACK_PREFS, false);
+    String localHash = prefs.getString("hash", "");
+    if ((localHash == serverHash) && assetPackMount())
+    {
+        prefs.end();
+        Serial.println(">>> assetPackSync: asset image is up to date");
+        return true;
+    }
+    if (imageSize > packPartition->size)
+    {
+        prefs.end();
+        Serial.printf("!!! assetPackSync ERROR: image (%lu bytes) exceeds the partition (%lu bytes)\r\n",
+                      imageSize, packPartition->size);
+        return false;
+    }
+
+    Serial.printf(">>> assetPackSync: fetching asset image (%lu bytes)\r\n", imageSize);
+    assetPackUnmount();
+    prefs.remove("hash");
+    bool ok = writeImage(serverAddress, imageSize) && assetPackMount();
+    if (ok)
+    {
+        prefs.putString("hash", serverHash);
+    }
+    prefs.end();
+    return ok;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Read-only asset image in the "assets" flash partition, built by the file
+// server (/assets/info, /assets/image) and mapped with esp_partition_mmap, so
+// bitmaps are read straight from flash instead of from a PSRAM copy.
+
+#define ASSET_PACK_PARTITION    "assets"
+#define ASSET_PACK_SUBTYPE      0x41
+#define ASSET_PACK_MAGIC        0x3150415A  // "ZAP1"
+#define ASSET_PACK_VERSION      1
+#define ASSET_PACK_PREFS        "assets"
+#define ASSET_PACK_WRITE_BUF    4096        // flash writes are chunked to this size
+
+enum tAssetFormat
+{
+    afRaw = 0,
+    afBmp = 1,
+    afMp3 = 2,
+    afJson = 3,
+    afRgb565 = 4,       // bitmap pre-converted by the server, see tftBmp.cpp
+    afAnim = 5          // ".zan" animation, see tftAnim.h
+};
+
+struct __attribute__((packed)) tAssetPackHeader
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t count;
+    uint32_t imageSize;
+    uint32_t reserved;
+};
+
+struct __attribute__((packed)) tAssetPackEntry
+{
+    uint32_t nameHash;      // FNV-1a of the file name without the leading '/'
+    uint32_t offset;        // from the start of the image
+    uint32_t size;
+    uint8_t  format;        // tAssetFormat
+    uint8_t  pad[3];
+};
+
+bool assetPackSync(const char *serverAddress);  // fetches the image when the server's differs
+bool assetPackMount(void);
+void assetPackUnmount(void);
+bool assetPackMounted(void);
+// name with or without the leading '/', data stays valid until the next sync;
+// a hash probe, no filesystem open, cheap enough for every draw and play
+bool assetPackFind(const char *name, const uint8_t **data, size_t *size, tAssetFormat *format = NULL);
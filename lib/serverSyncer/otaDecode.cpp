@@ -0,0 +1,285 @@
+#include "otaDecode.h"
+#include <esp_heap_caps.h>
+#if CONFIG_IDF_TARGET_ESP32S3
+#include <esp32s3/rom/miniz.h>
+#else
+#include <esp32/rom/miniz.h>
+#endif
+
+static inline uint32_t le32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+tOtaEnc otaEncFromName(const String &name)
+{
+    if (name == "zlib")
+    {
+        return oeZlib;
+    }
+    if (name == "delta")
+    {
+        return oeDelta;
+    }
+    return oeRaw;
+}
+
+const char *otaEncName(tOtaEnc enc)
+{
+    return (enc == oeZlib) ? "zlib" : (enc == oeDelta) ? "delta" : "raw";
+}
+
+tOtaDecoder::~tOtaDecoder()
+{
+    release();
+}
+
+void tOtaDecoder::release(void)
+{
+    free(inflator);
+    free(window);
+    free(oldBuf);
+    free(outBuf);
+    inflator = NULL;
+    window = NULL;
+    oldBuf = NULL;
+    outBuf = NULL;
+}
+
+bool tOtaDecoder::begin(tOtaEnc e, uint32_t size, const esp_partition_t *part, uint32_t partSize,
+                        tOtaSinkFn fn, void *ctx)
+{
+    release();
+    enc = e;
+    imageSize = size;
+    sink = fn;
+    sinkCtx = ctx;
+    outBytes = 0;
+    failed = false;
+    windowPos = 0;
+    streamEnd = false;
+    oldPart = part;
+    oldSize = partSize;
+    oldBufStart = 0;
+    oldBufLen = 0;
+    state = psHeader;
+    hdrLen = 0;
+    oldPos = 0;
+    if ((enc == oeDelta) && ((oldPart == NULL) || (oldSize == 0) || (oldSize > oldPart->size)))
+    {
+        Serial.println("!!! tOtaDecoder ERROR: no running image to patch");
+        return false;
+    }
+
+    inflator = (tinfl_decompressor *)malloc(sizeof(tinfl_decompressor));
+    window = (uint8_t *)heap_caps_malloc(TINFL_LZ_DICT_SIZE, MALLOC_CAP_SPIRAM);
+    if (window == NULL)
+    {
+        window = (uint8_t *)malloc(TINFL_LZ_DICT_SIZE);
+    }
+    bool ok = (inflator != NULL) && (window != NULL);
+    if (enc == oeDelta)
+    {
+        // internal RAM, the flash is written from the sink in between
+        oldBuf = (uint8_t *)heap_caps_malloc(OTA_DECODE_OLD_BUF, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        outBuf = (uint8_t *)heap_caps_malloc(OTA_DECODE_OLD_BUF, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        ok = ok && (oldBuf != NULL) && (outBuf != NULL);
+    }
+    if (!ok)
+    {
+        Serial.println("!!! tOtaDecoder ERROR: out of memory");
+        release();
+        return false;
+    }
+    tinfl_init(inflator);
+    return true;
+}
+
+bool tOtaDecoder::emit(const uint8_t *data, size_t len)
+{
+    if (outBytes + len > imageSize)
+    {
+        Serial.printf("!!! tOtaDecoder ERROR: image longer than %u bytes\r\n", (unsigned)imageSize);
+        return false;
+    }
+    if (!sink(sinkCtx, data, len))
+    {
+        return false;
+    }
+    outBytes += len;
+    return true;
+}
+
+bool tOtaDecoder::readOld(uint32_t pos, uint8_t &value)
+{
+    if (pos >= oldSize)
+    {
+        Serial.printf("!!! tOtaDecoder ERROR: patch reads past the running image (%u)\r\n", (unsigned)pos);
+        return false;
+    }
+    if ((pos < oldBufStart) || (pos >= oldBufStart + oldBufLen))
+    {
+        oldBufStart = pos;
+        oldBufLen = min((uint32_t)OTA_DECODE_OLD_BUF, oldSize - pos);
+        if (esp_partition_read(oldPart, oldBufStart, oldBuf, oldBufLen) != ESP_OK)
+        {
+            Serial.println("!!! tOtaDecoder ERROR: running image read failed");
+            oldBufLen = 0;
+            return false;
+        }
+    }
+    value = oldBuf[pos - oldBufStart];
+    return true;
+}
+
+// The patch records, fed in whatever pieces the inflater hands out
+bool tOtaDecoder::feedInflated(const uint8_t *data, size_t len)
+{
+    if (enc == oeZlib)
+    {
+        return emit(data, len);
+    }
+    while (len > 0)
+    {
+        switch (state)
+        {
+        case psHeader:
+        case psRecord:
+        {
+            uint8_t need = (state == psHeader) ? OTA_DELTA_HDR_SIZE : OTA_DELTA_REC_SIZE;
+            size_t n = min((size_t)(need - hdrLen), len);
+            memcpy(hdr + hdrLen, data, n);
+            hdrLen += n;
+            data += n;
+            len -= n;
+            if (hdrLen < need)
+            {
+                break;
+            }
+            hdrLen = 0;
+            if (state == psHeader)
+            {
+                if ((le32(hdr) != OTA_DELTA_MAGIC) || (le32(hdr + 4) != oldSize) || (le32(hdr + 8) != imageSize))
+                {
+                    Serial.printf("!!! tOtaDecoder ERROR: patch for a %u byte image, running %u\r\n",
+                                  (unsigned)le32(hdr + 4), (unsigned)oldSize);
+                    return false;
+                }
+                state = psRecord;
+                break;
+            }
+            left = le32(hdr);
+            extraLen = le32(hdr + 4);
+            seek = (int32_t)le32(hdr + 8);
+            state = left ? psDiff : psExtra;
+            break;
+        }
+        case psDiff:
+        {
+            size_t n = min((size_t)min(left, (uint32_t)OTA_DECODE_OLD_BUF), len);
+            for (size_t i = 0; i < n; i++)
+            {
+                uint8_t old;
+                if (!readOld(oldPos + i, old))
+                {
+                    return false;
+                }
+                outBuf[i] = old + data[i];
+            }
+            if (!emit(outBuf, n))
+            {
+                return false;
+            }
+            oldPos += n;
+            left -= n;
+            data += n;
+            len -= n;
+            if (left == 0)
+            {
+                state = psExtra;
+            }
+            break;
+        }
+        case psExtra:
+        {
+            size_t n = min((size_t)extraLen, len);
+            if ((n > 0) && !emit(data, n))
+            {
+                return false;
+            }
+            extraLen -= n;
+            data += n;
+            len -= n;
+            break;
+        }
+        case psDone:
+            Serial.println("!!! tOtaDecoder ERROR: data after the last record");
+            return false;
+        }
+        // a record is complete once its extra bytes are, also when there are none
+        if ((state == psExtra) && (extraLen == 0))
+        {
+            oldPos += seek;
+            state = done() ? psDone : psRecord;
+        }
+    }
+    return true;
+}
+
+// Same windowed inflate as the file sync's, the 32 KB window is the output buffer
+bool tOtaDecoder::feed(const uint8_t *data, size_t len, bool last)
+{
+    if (failed || (inflator == NULL))
+    {
+        return false;
+    }
+    // until the inflater wants more than there is, pending output included
+    while (!streamEnd)
+    {
+        size_t inBytes = len;
+        size_t outLen = TINFL_LZ_DICT_SIZE - windowPos;
+        uint32_t flags = TINFL_FLAG_PARSE_ZLIB_HEADER | (last ? 0 : TINFL_FLAG_HAS_MORE_INPUT);
+        tinfl_status status = tinfl_decompress(inflator, data, &inBytes, window, window + windowPos, &outLen, flags);
+        data += inBytes;
+        len -= inBytes;
+        if ((outLen > 0) && !feedInflated(window + windowPos, outLen))
+        {
+            failed = true;
+            return false;
+        }
+        windowPos = (windowPos + outLen) & (TINFL_LZ_DICT_SIZE - 1);
+        if (status < TINFL_STATUS_DONE)
+        {
+            Serial.printf("!!! tOtaDecoder ERROR: corrupt stream (%d)\r\n", (int)status);
+            failed = true;
+            return false;
+        }
+        if (status == TINFL_STATUS_DONE)
+        {
+            streamEnd = true;
+        }
+        else if ((status == TINFL_STATUS_NEEDS_MORE_INPUT) && (len == 0))
+        {
+            if (last)
+            {
+                Serial.println("!!! tOtaDecoder ERROR: truncated stream");
+                failed = true;
+                return false;
+            }
+            break;
+        }
+    }
+    if (streamEnd && (len > 0))
+    {
+        Serial.println("!!! tOtaDecoder ERROR: data after the stream end");
+        failed = true;
+        return false;
+    }
+    if (last && !done())
+    {
+        Serial.printf("!!! tOtaDecoder ERROR: %u bytes decoded, %u expected\r\n", (unsigned)outBytes, (unsigned)imageSize);
+        failed = true;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <Arduino.h>
+#include <esp_partition.h>
+
+// Encoded OTA images, asked for with /update?enc=zlib,delta&from=<md5 of
+// the running image>; the server names the one it sent in X-OTA-Enc:
+//   zlib   the image deflated
+//   delta  a deflated bsdiff style patch against the running image, made by
+//          the OTA server from its archive of the builds it served before:
+//          "ZDP1", old size u32, new size u32, then records of diff length
+//          u32, extra length u32, old seek i32, the diff bytes (added to the
+//          old image from the current old position on) and the extra bytes
+//          (taken as they are); the old position moves by the seek after each
+// The decoder inflates what arrives and hands the image bytes to the sink in
+// order, so the flash writer downstream does not care which one it was.
+
+#define OTA_ENC_ACCEPT          "zlib,delta"
+#define OTA_DELTA_MAGIC         0x3150445A  // "ZDP1"
+#define OTA_DELTA_HDR_SIZE      12
+#define OTA_DELTA_REC_SIZE      12
+#define OTA_DECODE_IN_BUF       4096
+#define OTA_DECODE_OLD_BUF      4096        // running image read ahead, diffs mostly walk it forward
+
+enum tOtaEnc
+{
+    oeRaw,
+    oeZlib,
+    oeDelta
+};
+
+// False stops the decode
+typedef bool (*tOtaSinkFn)(void *ctx, const uint8_t *data, size_t len);
+
+tOtaEnc otaEncFromName(const String &name);
+const char *otaEncName(tOtaEnc enc);
+
+class tOtaDecoder
+{
+public:
+    ~tOtaDecoder();
+
+    // oldPart/oldSize: the running image, delta only
+    bool begin(tOtaEnc enc, uint32_t imageSize, const esp_partition_t *oldPart, uint32_t oldSize,
+               tOtaSinkFn sink, void *ctx);
+    // Compressed bytes as they come off the socket, last with the final ones
+    bool feed(const uint8_t *data, size_t len, bool last);
+    inline bool done(void) const { return outBytes == imageSize; }
+    inline uint32_t produced(void) const { return outBytes; }
+
+private:
+    enum tPatchState
+    {
+        psHeader,
+        psRecord,
+        psDiff,
+        psExtra,
+        psDone
+    };
+
+    bool feedInflated(const uint8_t *data, size_t len);
+    bool emit(const uint8_t *data, size_t len);
+    bool readOld(uint32_t pos, uint8_t &value);
+    void release(void);
+
+    tOtaEnc             enc = oeRaw;
+    tOtaSinkFn          sink = NULL;
+    void               *sinkCtx = NULL;
+    uint32_t            imageSize = 0;
+    uint32_t            outBytes = 0;
+    bool                failed = false;
+
+    struct tinfl_decompressor_tag *inflator = NULL;
+    uint8_t            *window = NULL;
+    size_t              windowPos = 0;
+    bool                streamEnd = false;
+
+    const esp_partition_t *oldPart = NULL;
+    uint32_t            oldSize = 0;
+    uint8_t            *oldBuf = NULL;
+    uint32_t            oldBufStart = 0;
+    uint32_t            oldBufLen = 0;
+    uint8_t            *outBuf = NULL;
+
+    tPatchState         state = psHeader;
+    uint8_t             hdr[OTA_DELTA_HDR_SIZE];
+    uint8_t             hdrLen = 0;
+    uint32_t            left = 0;
+    uint32_t            extraLen = 0;
+    int32_t             seek = 0;
+    uint32_t            oldPos = 0;
+};
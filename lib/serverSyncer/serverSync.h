@@ -2,8 +2,26 @@
 #define SERVER_SYNC_H
 
 #include <Arduino.h>
+#include <FS.h>
 #include <functional>
 
+#ifndef SYNC_BACKGROUND
+#define SYNC_BACKGROUND         1       // stage server changes while waiting for a game
+#endif
+#define SYNC_STAGE_STOP_MS      3000    // the switch waits this long for the background task
+#ifndef OTA_BACKGROUND
+#define OTA_BACKGROUND          1       // stage new firmware while waiting for a game
+#endif
+#ifndef OTA_STAGE_KBPS
+#define OTA_STAGE_KBPS          96      // background firmware download rate cap
+#endif
+#ifndef SYNC_DEVICE_CLASS
+#define SYNC_DEVICE_CLASS       "xGame" // the file server's class tag the list is filtered by
+#endif
+#ifndef SYNC_PLAYER_ROLES
+#define SYNC_PLAYER_ROLES       "human,zombie"  // a game player's files, others only when the game server announces them
+#endif
+
 // Sync progress structure
 struct SyncProgress {
     uint32_t totalBytes;
@@ -27,9 +45,48 @@ bool syncFiles(const char *serverAddress, ProgressCallback callback = nullptr);
 
 // Load all files from SPIFFS to PSRAM (called automatically after sync)
 // Can also be called manually at boot to restore files
+// (a following syncFiles() with an unchanged server list then skips the copy)
 // Returns number of files loaded
 int loadFilesToPsram();
 
+// Audio files are left out of the above: the first use copies them to PSRAM
+// (filename with or without the leading '/'), or a low priority background
+// task can prefetch them all
+bool ensureFileInPsram(const char *filename);
+// A file written to LittleFS outside a sync (the portal's editor) replaces its
+// PSRAM copy; false when it is not on LittleFS, the copy there stays
+bool refreshFileInPsram(const char *filename);
+void startPsramPrefetch(void);
+
+// Asset tiers, "tier" of the file's entry in the file server's list: "psram"
+// keeps a PSRAM copy as above, "stream" never copies and reads the file from
+// LittleFS through StreamFS's read-ahead (streamFs.h); without one a file is
+// copied while PSRAM has room and streamed once it has not. Files the sync
+// stores compressed always need their copy. The filesystem to open a synced
+// asset on: AssetFS for the mapped image, PSRamFS with the copy made, else
+// StreamFS; NULL when the file is nowhere
+fs::FS *assetFsFor(const char *filename);
+
+// Background sync: a low priority task fetches what changed on the server
+// into a staging directory, current files are neither fetched nor touched.
+// The switch stops the task and, when the stage is complete, moves it over
+// the active files at once, the PSRAM copies follow; true when it did. A
+// switch cut short by a reset is finished by the next loadFilesToPsram()
+// or syncFiles(), which also drops an incomplete stage
+void syncStageStart(const char *serverAddress);
+bool syncStageSwitch(void);
+
+// Role tags ("human,zombie", empty for all) of the files the next list asks
+// for, on top of SYNC_DEVICE_CLASS; true when they changed, a running
+// background sync then goes over the new list as well
+bool syncSetRoles(const char *roles);
+
+// The file server's hash of its sync folder, from the discovery reply; the
+// next complete sync stores it. True when the stored one matches it for the
+// current roles, the files on LittleFS are then what the server would send
+void syncSetAssetsSignature(const char *signature);
+bool syncAssetsCurrent(void);
+
 // Set progress callback for sync operations
 void setProgressCallback(ProgressCallback callback);
 
@@ -55,8 +112,25 @@ String getLocalFileList();  // From SPIFFS
 String getServerFileList(const char *serverAddress);
 
 //OTA
-bool performOTAUpdate(const char *otaServerURL, int firmwareSize);
+// Resumes an interrupted update of the same md5; with sha256 the image is
+// checked as it streams in instead of reading the partition back for the MD5.
+// A fresh start asks for the image deflated or as a patch against the running
+// build (otaDecode.h), those are not resumable and fall back to the raw image
+bool performOTAUpdate(const char *otaServerURL, int firmwareSize, const String &md5 = "", const String &sha256 = "");
 bool syncOTA(const char *otaServerURL, int currentVersion);
+bool otaFirmwareCurrent(int currentVersion, int serverVersion, const String &serverMD5);
+
+// Background firmware staging: a low priority task streams a newer server
+// build into the inactive partition, resumably and at OTA_STAGE_KBPS, and
+// checks it without making it bootable. Stop pauses it for the game, the
+// written part stays for the next start. Apply boots into a checked stage
+// (of md5 when given) and restarts, false when there is none; syncOTA()
+// takes a matching stage instead of downloading again
+void otaStageStart(const char *otaServerURL, int currentVersion);
+void otaStageStop(void);
+bool otaStageReady(const String &md5 = "");
+bool otaStageApply(const String &md5 = "");
+void otaStageForget(void);          // the partition is written by something else
 
 #endif // SERVER_SYNC_H
 
@@ -0,0 +1,215 @@
+#include "streamFs.h"
+
+#include <FSImpl.h>
+#include <LittleFS.h>
+#include "fsMount.h"
+#include "memMonitor.h"
+
+using namespace fs;
+
+static const uint8_t STREAM_ZLIB_MAGIC[4] = {'Z', 'G', 'Z', '1'};    // SYNC_ZLIB_MAGIC of syncFiles.cpp
+
+static const char *STREAM_AUDIO_EXTS[] = {".mp3", ".wav", ".ogg", ".aac", ".m4a"};
+static const char *STREAM_IMAGE_EXTS[] = {".bmp", ".rgb", ".anim"};
+
+static bool hasExt(const char *path, const char *const *exts, size_t count)
+{
+    size_t len = strlen(path);
+    for (size_t i = 0; i < count; i++)
+    {
+        size_t extLen = strlen(exts[i]);
+        if ((len >= extLen) && !strcasecmp(path + len - extLen, exts[i]))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t streamReadAhead(const char *path)
+{
+    if (hasExt(path, STREAM_AUDIO_EXTS, sizeof(STREAM_AUDIO_EXTS) / sizeof(STREAM_AUDIO_EXTS[0])))
+    {
+        return STREAM_AUDIO_READAHEAD;
+    }
+    if (hasExt(path, STREAM_IMAGE_EXTS, sizeof(STREAM_IMAGE_EXTS) / sizeof(STREAM_IMAGE_EXTS[0])))
+    {
+        return STREAM_IMAGE_READAHEAD;
+    }
+    return STREAM_READAHEAD;
+}
+
+class StreamFileImpl : public FileImpl
+{
+public:
+    StreamFileImpl(File file, const char *path, uint8_t *buf, size_t bufSize) :
+        _file(file), _buf(buf), _bufSize(bufSize), _bufStart(0), _bufLen(0), _pos(0), _size(file.size())
+    {
+        strncpy(_path, path, sizeof(_path) - 1);
+        _path[sizeof(_path) - 1] = 0;
+    }
+
+    ~StreamFileImpl() { close(); }
+
+    size_t write(const uint8_t *buf, size_t size) { return 0; }
+
+    size_t read(uint8_t *buf, size_t size)
+    {
+        size_t done = 0;
+        while ((done < size) && (_pos < _size) && _buf)
+        {
+            if ((_pos < _bufStart) || (_pos >= _bufStart + _bufLen))
+            {
+                // a read as large as the buffer goes around it
+                if (size - done >= _bufSize)
+                {
+                    size_t n = direct(buf + done, size - done);
+                    done += n;
+                    if (n == 0)
+                    {
+                        break;
+                    }
+                    continue;
+                }
+                if (!refill())
+                {
+                    break;
+                }
+            }
+            size_t ofs = _pos - _bufStart;
+            size_t n = min(size - done, _bufLen - ofs);
+            memcpy(buf + done, _buf + ofs, n);
+            done += n;
+            _pos += n;
+        }
+        return done;
+    }
+
+    void flush() {}
+
+    bool seek(uint32_t pos, SeekMode mode)
+    {
+        size_t base = (mode == SeekCur) ? _pos : (mode == SeekEnd) ? _size : 0;
+        if (base + pos > _size)
+        {
+            return false;
+        }
+        _pos = base + pos;
+        return true;
+    }
+
+    size_t position() const { return _pos; }
+    size_t size() const { return _size; }
+    bool setBufferSize(size_t size) { return true; }
+
+    void close()
+    {
+        if (_buf != NULL)
+        {
+            _file.close();
+            memTagFree(_buf);
+            _buf = NULL;
+            fsRelease();
+        }
+    }
+
+    time_t getLastWrite() { return 0; }
+    const char *path() const { return _path; }
+
+    const char *name() const
+    {
+        const char *slash = strrchr(_path, '/');
+        return slash ? slash + 1 : _path;
+    }
+
+    boolean isDirectory(void) { return false; }
+    FileImplPtr openNextFile(const char *mode) { return FileImplPtr(); }
+    boolean seekDir(long position) { return false; }
+    String getNextFileName(void) { return ""; }
+    String getNextFileName(bool *isDir) { return ""; }
+    void rewindDirectory(void) {}
+    operator bool() { return _buf != NULL; }
+
+private:
+    bool refill(void)
+    {
+        if (!_file.seek(_pos))
+        {
+            return false;
+        }
+        _bufStart = _pos;
+        _bufLen = _file.read(_buf, min(_bufSize, _size - _pos));
+        return _bufLen > 0;
+    }
+
+    size_t direct(uint8_t *buf, size_t size)
+    {
+        if (!_file.seek(_pos))
+        {
+            return 0;
+        }
+        size_t n = _file.read(buf, min(size, _size - _pos));
+        _pos += n;
+        return n;
+    }
+
+    File _file;
+    uint8_t *_buf;
+    size_t _bufSize;
+    size_t _bufStart;       // file offset of _buf[0]
+    size_t _bufLen;
+    size_t _pos;
+    size_t _size;
+    char _path[64];
+};
+
+class StreamFSImpl : public FSImpl
+{
+public:
+    FileImplPtr open(const char *path, const char *mode, const bool create)
+    {
+        if ((mode[0] != 'r') || (strchr(mode, '+') != NULL) || !fsAcquire())
+        {
+            return FileImplPtr();
+        }
+        File file = LittleFS.open(path, "r");
+        uint8_t magic[sizeof(STREAM_ZLIB_MAGIC)];
+        if (!file || file.isDirectory() ||
+            ((file.read(magic, sizeof(magic)) == sizeof(magic)) && !memcmp(magic, STREAM_ZLIB_MAGIC, sizeof(magic))))
+        {
+            if (file)
+            {
+                file.close();
+            }
+            fsRelease();
+            return FileImplPtr();
+        }
+        size_t bufSize = min(streamReadAhead(path), max(file.size(), (size_t)1));
+        uint8_t *buf = (uint8_t *)memTagAlloc(mtSync, bufSize, MALLOC_CAP_SPIRAM);
+        if (buf == NULL)
+        {
+            buf = (uint8_t *)memTagAlloc(mtSync, bufSize, MALLOC_CAP_8BIT);
+        }
+        if (buf == NULL)
+        {
+            Serial.printf("!!! StreamFS ERROR: no %u byte read-ahead for %s\r\n", (unsigned)bufSize, path);
+            file.close();
+            fsRelease();
+            return FileImplPtr();
+        }
+        return std::make_shared<StreamFileImpl>(file, path, buf, bufSize);
+    }
+
+    bool exists(const char *path)
+    {
+        tFsHandle fs;
+        return fs.ok() && LittleFS.exists(path);
+    }
+
+    bool rename(const char *pathFrom, const char *pathTo) { return false; }
+    bool remove(const char *path) { return false; }
+    bool mkdir(const char *path) { return false; }
+    bool rmdir(const char *path) { return false; }
+};
+
+FS StreamFS = FS(FSImplPtr(new StreamFSImpl()));
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <FS.h>
+
+// Read-only fs::FS over LittleFS for the assets of the stream tier
+// (serverSync.h), which get no PSRAM copy. Reads are served from a read-ahead
+// buffer refilled in one flash read, sized for the consumer: a decoder's
+// small reads or a bitmap's row loop then rarely reach LittleFS. An open
+// file keeps LittleFS mounted. Files in the sync's zlib container are not
+// opened, they can only be used from their PSRAM copy.
+
+#define STREAM_AUDIO_READAHEAD  16384           // ~0.4 s of a 320 kbps mp3
+#define STREAM_IMAGE_READAHEAD  (8 * 536 * 3)   // 8 rows of a full width 24-bit bitmap
+#define STREAM_READAHEAD        4096            // anything else
+
+extern fs::FS StreamFS;
+
+// The read-ahead a file of this name gets
+size_t streamReadAhead(const char *path);
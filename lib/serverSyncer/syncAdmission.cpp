@@ -0,0 +1,46 @@
+#include "syncAdmission.h"
+
+static volatile uint32_t retryAfterS = 0;   // the download tasks may note one too
+
+void syncCollectHeaders(HTTPClient &http)
+{
+    static const char *headers[] = {SYNC_RETRY_HEADER};
+    http.collectHeaders(headers, 1);
+}
+
+bool syncNoteAdmission(HTTPClient &http, int httpCode)
+{
+    if (httpCode != HTTP_CODE_SERVICE_UNAVAILABLE)
+    {
+        return false;
+    }
+    long s = http.header(SYNC_RETRY_HEADER).toInt();
+    if (s <= 0)
+    {
+        return false;
+    }
+    retryAfterS = min(s, (long)SYNC_RETRY_MAX_S);
+    Serial.printf(">>> syncNoteAdmission: server busy, back in %u s\r\n", (unsigned)retryAfterS);
+    return true;
+}
+
+bool syncRetryPending(void)
+{
+    return retryAfterS > 0;
+}
+
+uint32_t syncBackoffMs(int attempt, bool &paced)
+{
+    uint32_t s = retryAfterS;
+    retryAfterS = 0;
+    paced = (s > 0);
+    if (paced)
+    {
+        uint32_t ms = s * 1000;
+        return ms + (uint32_t)((uint64_t)ms * SYNC_RETRY_JITTER_PCT / 100 * (esp_random() % 1001) / 1000);
+    }
+    uint32_t ms = SYNC_BACKOFF_BASE_MS << min(max(attempt - 1, 0), 5);
+    ms = min(ms, (uint32_t)SYNC_BACKOFF_MAX_MS);
+    // 0.5x .. 1.5x
+    return ms / 2 + esp_random() % (ms + 1);
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <Arduino.h>
+#include <HTTPClient.h>
+
+// Boot storm pacing. The OTA and file servers give out a few transfer slots
+// and answer the rest with 503 and a Retry-After in seconds; the device comes
+// back that much later plus jitter, so the fleet queues up on the server
+// instead of colliding on the AP. Failures without such an answer back off
+// exponentially, again with jitter, so retrying devices spread out.
+
+#define SYNC_RETRY_HEADER       "Retry-After"
+#define SYNC_BACKOFF_BASE_MS    1000
+#define SYNC_BACKOFF_MAX_MS     30000
+#define SYNC_RETRY_JITTER_PCT   50      // a Retry-After is stretched by up to this, never shortened
+#define SYNC_RETRY_MAX_S        300     // longer ones are capped, the server may have lost count
+
+// Before the request, so the answer keeps the header (a caller collecting
+// others lists SYNC_RETRY_HEADER with them)
+void syncCollectHeaders(HTTPClient &http);
+// After a transfer request: notes a 503's Retry-After, true when it was one
+bool syncNoteAdmission(HTTPClient &http, int httpCode);
+// True while a refusal with Retry-After waits to be honoured
+bool syncRetryPending(void);
+// Wait before the next attempt; takes (clears) the pending Retry-After,
+// paced is set when it was the server's queue rather than a failure
+uint32_t syncBackoffMs(int attempt, bool &paced);
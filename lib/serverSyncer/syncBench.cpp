@@ -0,0 +1,323 @@
+#include "syncBench.h"
+
+#include <WiFi.h>
+#include <HTTPClient.h>
+#include <ArduinoJson.h>
+#include <LittleFS.h>
+#include "PSRamFS.h"
+#include "serverSync.h"
+#include "syncAdmission.h"
+#include "fsMount.h"
+#include "httpPool.h"
+#include "memMonitor.h"
+#include <esp_timer.h>
+
+struct tBenchPart
+{
+    uint64_t bytes = 0;
+    int64_t  wallUs = 0;
+    int64_t  netUs = 0;
+    int64_t  flashUs = 0;
+    int64_t  psramUs = 0;
+    int64_t  connectUs = 0;
+    int64_t  connectMaxUs = 0;
+    uint32_t connects = 0;
+    int64_t  headersUs = 0;     // GET sent to the status line and headers read
+    uint32_t requests = 0;
+    uint32_t retries = 0;
+    uint32_t busy = 0;          // of them 503 with Retry-After
+    uint32_t waitMs = 0;        // backing off, not in the rates
+    uint16_t failed = 0;
+};
+
+static inline int64_t nowUs(void)
+{
+    return esp_timer_get_time();
+}
+
+// Host and port of "http://host[:port]/..."
+static bool urlHostPort(const char *url, String &host, uint16_t &port)
+{
+    String s(url);
+    int start = s.indexOf("://");
+    start = (start < 0) ? 0 : start + 3;
+    int end = s.indexOf('/', start);
+    String hostPort = s.substring(start, (end < 0) ? s.length() : end);
+    int colon = hostPort.indexOf(':');
+    host = (colon < 0) ? hostPort : hostPort.substring(0, colon);
+    port = (colon < 0) ? 80 : (uint16_t)hostPort.substring(colon + 1).toInt();
+    return host.length() > 0;
+}
+
+// The TCP connect on its own, HTTPClient then reuses the connection
+static bool benchConnect(tHttpLease &lease, const char *url, tBenchPart &part)
+{
+    if (lease.client().connected())
+    {
+        return true;
+    }
+    String host;
+    uint16_t port;
+    if (!urlHostPort(url, host, port))
+    {
+        return false;
+    }
+    int64_t t0 = nowUs();
+    bool ok = lease.client().connect(host.c_str(), port, 10000);
+    int64_t us = nowUs() - t0;
+    if (ok)
+    {
+        part.connectUs += us;
+        part.connectMaxUs = max(part.connectMaxUs, us);
+        part.connects++;
+    }
+    return ok;
+}
+
+// One GET; the body goes to flash and PSRAM when the files are open, else it is dropped
+static bool benchFetch(tHttpLease &lease, const String &url, uint32_t expect, uint8_t *buf,
+                       File *flash, File *psram, tBenchPart &part)
+{
+    if (!lease.begin(url) || !benchConnect(lease, url.c_str(), part))
+    {
+        return false;
+    }
+    HTTPClient &http = lease.http();
+    http.setTimeout(30000);
+    syncCollectHeaders(http);
+    int64_t t0 = nowUs();
+    int code = http.GET();
+    part.headersUs += nowUs() - t0;
+    part.requests++;
+    if (code != HTTP_CODE_OK)
+    {
+        Serial.printf("*** syncBenchRun WARNING! %s: HTTP %d\r\n", url.c_str(), code);
+        if (syncNoteAdmission(http, code))
+        {
+            part.busy++;
+        }
+        http.end();
+        return false;
+    }
+    int len = http.getSize();
+    if ((expect > 0) && (len != (int)expect))
+    {
+        Serial.printf("*** syncBenchRun WARNING! %s: %d bytes, %lu asked for\r\n", url.c_str(), len, expect);
+        http.end();
+        return false;
+    }
+
+    WiFiClient *stream = http.getStreamPtr();
+    stream->setTimeout(5000);
+    uint32_t got = 0;
+    bool ok = true;
+    while ((len < 0) || (got < (uint32_t)len))
+    {
+        size_t want = SYNC_BENCH_BUF_SIZE;
+        if (len > 0)
+        {
+            want = min(want, (size_t)(len - got));
+        }
+        t0 = nowUs();
+        size_t n = stream->readBytes(buf, want);
+        part.netUs += nowUs() - t0;
+        if (n == 0)
+        {
+            ok = (len < 0);
+            break;
+        }
+        got += n;
+        if (flash != NULL)
+        {
+            t0 = nowUs();
+            ok = (flash->write(buf, n) == n);
+            part.flashUs += nowUs() - t0;
+        }
+        if (ok && (psram != NULL))
+        {
+            t0 = nowUs();
+            ok = (psram->write(buf, n) == n);
+            part.psramUs += nowUs() - t0;
+        }
+        if (!ok)
+        {
+            Serial.printf("*** syncBenchRun WARNING! write failed at %lu\r\n", got);
+            break;
+        }
+    }
+    http.end();
+    if (ok)
+    {
+        part.bytes += got;
+    }
+    return ok;
+}
+
+// Up to SYNC_BENCH_RETRIES more attempts with the sync's backoff
+static bool benchWithRetries(tHttpLease &lease, const String &url, uint32_t expect, uint8_t *buf,
+                             bool toFlash, bool toPsram, tBenchPart &part)
+{
+    for (int attempt = 0; attempt <= SYNC_BENCH_RETRIES; attempt++)
+    {
+        if (attempt > 0)
+        {
+            bool paced;
+            uint32_t waitMs = syncBackoffMs(attempt - 1, paced);
+            part.retries++;
+            part.waitMs += waitMs;
+            delay(waitMs);
+        }
+        File flash, psram;
+        if (toFlash)
+        {
+            flash = LittleFS.open(SYNC_BENCH_FNAME, "w");
+        }
+        if (toPsram)
+        {
+            psram = PSRamFS.open(SYNC_BENCH_FNAME, "w");
+        }
+        bool ok = benchFetch(lease, url, expect, buf, flash ? &flash : NULL, psram ? &psram : NULL, part);
+        if (flash)
+        {
+            int64_t t0 = nowUs();
+            flash.close();
+            part.flashUs += nowUs() - t0;
+        }
+        if (psram)
+        {
+            psram.close();
+        }
+        if (ok)
+        {
+            return true;
+        }
+        // the connection is in an unknown state
+        lease.client().stop();
+    }
+    part.failed++;
+    return false;
+}
+
+static float rateMBps(uint64_t bytes, int64_t us)
+{
+    return (us > 0) ? (float)bytes / (float)us : 0.0f;
+}
+
+static void benchReport(JsonObject obj, const tBenchPart &part)
+{
+    obj["bytes"] = part.bytes;
+    obj["ms"] = (uint32_t)(part.wallUs / 1000);
+    obj["MBps"] = rateMBps(part.bytes, part.wallUs - (int64_t)part.waitMs * 1000);
+    obj["net_ms"] = (uint32_t)(part.netUs / 1000);
+    obj["net_MBps"] = rateMBps(part.bytes, part.netUs);
+    if (part.flashUs > 0)
+    {
+        obj["flash_ms"] = (uint32_t)(part.flashUs / 1000);
+        obj["flash_MBps"] = rateMBps(part.bytes, part.flashUs);
+    }
+    if (part.psramUs > 0)
+    {
+        obj["psram_ms"] = (uint32_t)(part.psramUs / 1000);
+        obj["psram_MBps"] = rateMBps(part.bytes, part.psramUs);
+    }
+    obj["connects"] = part.connects;
+    obj["connect_avg_ms"] = part.connects ? (float)part.connectUs / part.connects / 1000.0f : 0.0f;
+    obj["connect_max_ms"] = (float)part.connectMaxUs / 1000.0f;
+    obj["requests"] = part.requests;
+    obj["headers_avg_ms"] = part.requests ? (float)part.headersUs / part.requests / 1000.0f : 0.0f;
+    obj["retries"] = part.retries;
+    obj["busy"] = part.busy;
+    obj["wait_ms"] = part.waitMs;
+    obj["failed"] = part.failed;
+}
+
+bool syncBenchRun(const char *fileServerURL, const char *otaServerURL, const tSyncBenchCfg &cfg,
+                  Print &out, String *json)
+{
+    uint16_t files = constrain(cfg.files, (uint16_t)1, (uint16_t)SYNC_BENCH_MAX_FILES);
+    uint32_t size = constrain(cfg.sizeKb, (uint32_t)1, (uint32_t)SYNC_BENCH_MAX_KB) * 1024;
+    if ((fileServerURL == NULL) || (*fileServerURL == 0) || (WiFi.status() != WL_CONNECTED))
+    {
+        Serial.println("!!! syncBenchRun ERROR: no file server or no WiFi");
+        return false;
+    }
+    tFsHandle fs;
+    if (!fs.ok())
+    {
+        Serial.println("!!! syncBenchRun ERROR: LittleFS not mounted");
+        return false;
+    }
+    if (LittleFS.totalBytes() - LittleFS.usedBytes() < size + 16384)
+    {
+        Serial.printf("!!! syncBenchRun ERROR: %lu bytes do not fit on LittleFS\r\n", size);
+        return false;
+    }
+    bool psram = cfg.psram && (getPsramFreeSpace() > size);
+    uint8_t *buf = (uint8_t *)memTagAlloc(mtSync, SYNC_BENCH_BUF_SIZE, MALLOC_CAP_SPIRAM);
+    if (buf == NULL)
+    {
+        buf = (uint8_t *)memTagAlloc(mtSync, SYNC_BENCH_BUF_SIZE, MALLOC_CAP_8BIT);
+    }
+    if (buf == NULL)
+    {
+        Serial.println("!!! syncBenchRun ERROR: no buffer");
+        return false;
+    }
+    Serial.printf(">>> syncBenchRun: %u x %lu bytes from %s, %s, RSSI %d\r\n", files, size, fileServerURL,
+                  cfg.reuse ? "keep-alive" : "connect per file", WiFi.RSSI());
+
+    JsonDocument doc;
+    doc["version"] = 1;
+    doc["rssi"] = WiFi.RSSI();
+    doc["channel"] = WiFi.channel();
+    doc["files"] = files;
+    doc["size"] = size;
+    doc["reuse"] = cfg.reuse;
+
+    tBenchPart sync;
+    int64_t t0 = nowUs();
+    {
+        tHttpLease lease(fileServerURL);
+        for (uint16_t i = 0; i < files; i++)
+        {
+            if (!cfg.reuse)
+            {
+                lease.client().stop();
+            }
+            String url = String(fileServerURL) + "/bench?size=" + String(size) + "&seed=" + String(i);
+            if (!benchWithRetries(lease, url, size, buf, true, psram, sync))
+            {
+                break;
+            }
+        }
+    }
+    sync.wallUs = nowUs() - t0;
+    LittleFS.remove(SYNC_BENCH_FNAME);
+    PSRamFS.remove(SYNC_BENCH_FNAME);
+    benchReport(doc["sync"].to<JsonObject>(), sync);
+
+    bool ok = (sync.failed == 0);
+    if (cfg.ota && (otaServerURL != NULL) && (*otaServerURL != 0))
+    {
+        tBenchPart ota;
+        t0 = nowUs();
+        {
+            tHttpLease lease(otaServerURL);
+            benchWithRetries(lease, String(otaServerURL) + "/update", 0, buf, false, false, ota);
+        }
+        ota.wallUs = nowUs() - t0;
+        benchReport(doc["ota"].to<JsonObject>(), ota);
+        ok = ok && (ota.failed == 0);
+    }
+    memTagFree(buf);
+
+    String line;
+    serializeJson(doc, line);
+    out.println(line);
+    Serial.printf(">>> syncBenchRun: %s\r\n", ok ? "done" : "with failures");
+    if (json != NULL)
+    {
+        *json = line;
+    }
+    return ok;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Throughput of the sync pipeline on the venue's WiFi. Downloads synthetic
+// files from the file server's /bench through the HTTP pool, writes them to
+// LittleFS and, like the preload, to PSRamFS (both deleted afterwards), then
+// streams the OTA server's image without flashing it. Reports the time spent
+// in the network reads, the flash and the PSRAM writes, the TCP connect and
+// the wait for the response headers, and the retries, as one JSON line:
+// {"sync":{..},"ota":{..}} with bytes, ms and MB/s per part.
+
+#define SYNC_BENCH_FILES        4
+#define SYNC_BENCH_KB           256
+#define SYNC_BENCH_MAX_FILES    32
+#define SYNC_BENCH_MAX_KB       4096    // per file, LittleFS holds one at a time
+#define SYNC_BENCH_RETRIES      3       // per file, a 503 waits for its Retry-After
+#define SYNC_BENCH_BUF_SIZE     16384   // as the download pipe's buffers
+#define SYNC_BENCH_FNAME        "/.bench.part"
+
+struct tSyncBenchCfg
+{
+    uint16_t files = SYNC_BENCH_FILES;
+    uint32_t sizeKb = SYNC_BENCH_KB;
+    bool     reuse = true;      // one keep-alive connection, false connects per file
+    bool     psram = true;      // copy every block to PSRamFS as well
+    bool     ota = true;        // then the OTA image, network only
+};
+
+// Blocks the caller for the whole run, not while a sync is in progress.
+// otaServerURL may be NULL; json gets the report line when given
+bool syncBenchRun(const char *fileServerURL, const char *otaServerURL, const tSyncBenchCfg &cfg,
+                  Print &out = Serial, String *json = NULL);
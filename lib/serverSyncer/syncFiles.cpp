@@ -12,12 +12,36 @@
  */
 
 #include <Arduino.h>
+#include <WiFi.h>
 #include <HTTPClient.h>
 #include <ArduinoJson.h>
 #include <LittleFS.h>
+#include <MD5Builder.h>
 #include "PSRamFS.h"
-#include <map>
+#include <vector>
+#include <algorithm>
 #include "serverSync.h"
+#include "assetPack.h"
+#include "assetFs.h"
+#include "streamFs.h"
+#include "syncIndex.h"
+#include "syncAdmission.h"
+#include "fsMount.h"
+#include "bootProfile.h"
+#include "logRing.h"
+#include "jsonAlloc.h"
+#include "taskRegistry.h"
+#include "pmLocks.h"
+#include "httpPool.h"
+#include "memMonitor.h"
+#include "espAirtime.h"
+#include <esp_timer.h>
+#include <esp_heap_caps.h>
+#if CONFIG_IDF_TARGET_ESP32S3
+#include <esp32s3/rom/miniz.h>
+#else
+#include <esp32/rom/miniz.h>
+#endif
 
 // Configuration
 static const bool REMOVE_LOCAL_FILES_NOT_ON_SERVER = false;
@@ -26,31 +50,113 @@ static ProgressCallback progressCallback = nullptr;
 // Buffer size for file operations
 static const size_t COPY_BUFFER_SIZE = 4096;
 
+// Pipelined download: files fetched at once over keep-alive connections, each
+// streaming into a small pool of PSRAM buffers that one writer task drains to flash
+static const int SYNC_PARALLEL_FILES = 2;
+static const int SYNC_PIPE_BUFS_PER_FILE = 3;
+static const size_t SYNC_PIPE_BUF_SIZE = 16384;
+
+// Compressible files are served as "ZGZ1" + raw size (LE) + zlib stream, kept
+// like that in LittleFS and inflated on the copy to PSRAM
+static const char SYNC_ZLIB_MAGIC[4] = {'Z', 'G', 'Z', '1'};
+static const size_t SYNC_ZLIB_HDR_SIZE = 8;
+// Bitmaps are asked for pre-converted to RGB565 as well (drawn by tftBmp.cpp),
+// sounds in the audio profile: mono MP3 at the I2S rate, IMA-ADPCM effects (xSfx.cpp)
+static const char* SYNC_ENC = "zlib,rgb565,audio";
+// Chunk hashes of the list are that many hex digits of the chunk's MD5
+static const unsigned SYNC_CHUNK_HASH_LEN = 8;
+
 // Cached server file list filename
 static const char* SERVER_LIST_CACHE_FILE = "/.server_list.json";
 
+// Server size and hash of every file present in LittleFS, written as each
+// download completes, so a changed list only fetches the files that changed
+static const char* MANIFEST_FILE = "/.manifest.json";
+
+// "<assets hash>;<roles>" of the last complete sync, the discovery reply's
+// hash of the server's sync folder is compared against it at boot
+static const char* ASSETS_SIG_FILE = "/.assets";
+
+// Whole-file downloads land in "<name>.part", renamed once the hash checks out.
+// An interrupted one is kept and listed under "partial" in the manifest with
+// the server hash it belongs to, the next attempt resumes it with a Range request
+static const char* PARTIAL_SUFFIX = ".part";
+
+// Set once loadFilesToPsram() has restored the LittleFS copy, a later sync
+// that finds the server list unchanged then has nothing left to copy
+static bool psramPreloaded = false;
+
+// Large media is not copied to PSRAM up front: ensureFileInPsram() creates the
+// copy on first use, or startPsramPrefetch() fills them in the background
+static const char* PSRAM_LAZY_EXTS[] = {".mp3", ".wav", ".ogg", ".aac"};
+
+// Files read from LittleFS through StreamFS instead of a PSRAM copy, by name
+// hash: the list's stream tier, and the files PSRAM had no room for. Rebuilt
+// from the cached list when the scope is loaded, under spiffsMutex
+static std::vector<uint32_t> streamNames;
+static bool streamTiersLoaded = false;
+
+// LittleFS is shared by the sync, the boot preload and lazy copies; the mount
+// itself belongs to fsMount.h, this lock only keeps two copies of one file apart
+static SemaphoreHandle_t spiffsMutex = NULL;
+
+// The background sync lands new and changed files in the staging directory,
+// with its own manifest (entries describe the staged copy where there is one,
+// the active file otherwise) and, once complete, its own server list cache.
+// The switch writes the journal first and moves everything over; a switch an
+// unexpected reset cut short is rolled forward by the next one
+static const char* STAGE_DIR = "/.stage";
+static const char* STAGE_MANIFEST = "/.stage/.manifest.json";
+static const char* STAGE_LIST = "/.stage/.server_list.json";
+static const char* STAGE_JOURNAL = "/.stage/.commit";
+
+// Set while the background sync runs, it never touches the active files
+static bool syncStaging = false;
+static volatile bool stageRunning = false;
+static volatile bool stageCancel = false;
+static volatile bool stageRescan = false;  // the scope changed while the background sync ran
+static String stageServer;
+
+// The list the file server sends is filtered by the device class and these
+// roles, empty for every role. Files another scope left on LittleFS stay
+// there (they are current again once back in scope) but go to PSRAM only
+// while the cached list holds them
+static String syncRoles;
+// The discovery reply's hash, stored once a sync of the active set completes
+static String syncAssetsSig;
+
 //=============================================================================
 // LittleFS Initialization (internal use)
 //=============================================================================
 
+static void lockSpiffs()
+{
+    if (spiffsMutex == NULL)
+    {
+        spiffsMutex = xSemaphoreCreateMutex();
+    }
+    xSemaphoreTake(spiffsMutex, portMAX_DELAY);
+}
+
+static void unlockSpiffs()
+{
+    xSemaphoreGive(spiffsMutex);
+}
+
 static bool initSpiffs()
 {
-    if (!LittleFS.begin(true)) // true = format if mount fails
+    // a sync rebuilds the contents, a broken filesystem may be formatted
+    if (!fsAcquire(true))
     {
         Serial.println("ERROR: LittleFS initialization failed!");
         return false;
     }
-    
-    Serial.printf("LittleFS initialized: Total=%d, Used=%d, Free=%d bytes\n",
-                  LittleFS.totalBytes(), LittleFS.usedBytes(), 
-                  LittleFS.totalBytes() - LittleFS.usedBytes());
     return true;
 }
 
 static void endSpiffs()
 {
-    LittleFS.end();
-    Serial.println("LittleFS unmounted");
+    fsRelease();
 }
 
 //=============================================================================
@@ -59,7 +165,7 @@ static void endSpiffs()
 
 static bool saveServerListCache(const String &serverListStr)
 {
-    File file = LittleFS.open(SERVER_LIST_CACHE_FILE, "w");
+    File file = LittleFS.open(syncStaging ? STAGE_LIST : SERVER_LIST_CACHE_FILE, "w");
     if (!file)
     {
         Serial.println("ERROR: Failed to create server list cache file");
@@ -81,15 +187,15 @@ static bool saveServerListCache(const String &serverListStr)
     }
 }
 
-static String loadServerListCache()
+static String loadServerListCache(const char *path = SERVER_LIST_CACHE_FILE)
 {
-    if (!LittleFS.exists(SERVER_LIST_CACHE_FILE))
+    if (!LittleFS.exists(path))
     {
         Serial.println("No cached server list found");
         return "";
     }
     
-    File file = LittleFS.open(SERVER_LIST_CACHE_FILE, "r");
+    File file = LittleFS.open(path, "r");
     if (!file)
     {
         Serial.println("ERROR: Failed to open server list cache");
@@ -103,6 +209,21 @@ static String loadServerListCache()
     return content;
 }
 
+static void saveAssetsSig()
+{
+    if (syncAssetsSig.isEmpty())
+    {
+        LittleFS.remove(ASSETS_SIG_FILE);
+        return;
+    }
+    File file = LittleFS.open(ASSETS_SIG_FILE, "w");
+    if (file)
+    {
+        file.print(syncAssetsSig + ";" + syncRoles);
+        file.close();
+    }
+}
+
 static bool isServerListChanged(const String &newServerList)
 {
     String cachedList = loadServerListCache();
@@ -125,6 +246,138 @@ static bool isServerListChanged(const String &newServerList)
     }
 }
 
+//=============================================================================
+// Local Manifest (per-file server hashes)
+//=============================================================================
+
+static bool isInternalFile(const String &filename)
+{
+    return (filename == ".server_list.json") || (filename == ".manifest.json") || (filename == ".commit") ||
+           (filename == ".assets") ||
+           filename.endsWith(PARTIAL_SUFFIX);
+}
+
+// Where a download lands: the active file, or its staged copy while staging
+static String landPath(const String &filename)
+{
+    return (syncStaging ? String(STAGE_DIR) + "/" : String("/")) + filename;
+}
+
+// The copy a manifest entry describes
+static String localPath(const String &filename)
+{
+    String path = landPath(filename);
+    return (!syncStaging || LittleFS.exists(path)) ? path : "/" + filename;
+}
+
+// Same rolling hash the file server lists, h = h * 31 + byte
+static uint32_t updateSyncHash(uint32_t hash, const uint8_t *data, size_t len)
+{
+    while (len--)
+    {
+        hash = hash * 31 + *data++;
+    }
+    return hash;
+}
+
+static void loadManifest(JsonDocument &manifest)
+{
+    // a new stage starts from the active manifest, without its part files
+    bool fresh = syncStaging && !LittleFS.exists(STAGE_MANIFEST);
+    File file = LittleFS.open((syncStaging && !fresh) ? STAGE_MANIFEST : MANIFEST_FILE, "r");
+    if (!file || deserializeJson(manifest, file))
+    {
+        Serial.println("No local manifest - files without an entry will be downloaded");
+        manifest.clear();
+    }
+    if (file)
+    {
+        file.close();
+    }
+    if (!manifest["files"].is<JsonObject>())
+    {
+        manifest["files"].to<JsonObject>();
+    }
+    if (!manifest["partial"].is<JsonObject>() || fresh)
+    {
+        manifest["partial"].to<JsonObject>();
+    }
+}
+
+// The hash the active manifest holds for a file, empty when it has none or
+// a patch of it did not finish; the PSRAM copies are of the active files, so
+// this is the active manifest also while a stage is being filled
+static String activeHash(JsonDocument &active, const String &filename)
+{
+    if (active.isNull())
+    {
+        File file = LittleFS.open(MANIFEST_FILE, "r");
+        if (!file || deserializeJson(active, file))
+        {
+            active["files"].to<JsonObject>();
+        }
+        if (file)
+        {
+            file.close();
+        }
+    }
+    return active["files"][filename]["hash"].as<String>();
+}
+
+static bool saveManifest(JsonDocument &manifest)
+{
+    File file = LittleFS.open(syncStaging ? STAGE_MANIFEST : MANIFEST_FILE, "w");
+    if (!file)
+    {
+        Serial.println("ERROR: Failed to create manifest file");
+        return false;
+    }
+    size_t written = serializeJson(manifest, file);
+    file.close();
+    return written > 0;
+}
+
+// A current manifest entry only counts while the file it describes is still intact
+static bool isLocalCopyIntact(const char *filename, uint32_t size)
+{
+    File file = LittleFS.open(localPath(filename), "r");
+    if (!file)
+    {
+        return false;
+    }
+    bool sizeOk = (file.size() == size);
+    file.close();
+    return sizeOk;
+}
+
+static bool copyLittleFsFile(const String &srcPath, const String &dstPath)
+{
+    File src = LittleFS.open(srcPath, "r");
+    File dst = LittleFS.open(dstPath, "w");
+    bool ok = src && dst;
+    uint8_t buffer[COPY_BUFFER_SIZE];
+    while (ok && src.available())
+    {
+        size_t bytesRead = src.read(buffer, COPY_BUFFER_SIZE);
+        ok = (dst.write(buffer, bytesRead) == bytesRead);
+        yield();
+    }
+    if (src)
+    {
+        src.close();
+    }
+    if (dst)
+    {
+        dst.close();
+    }
+    if (!ok)
+    {
+        Serial.printf("Failed to copy %s to %s\n", srcPath.c_str(), dstPath.c_str());
+        LittleFS.remove(dstPath);
+    }
+    return ok;
+}
+
 //=============================================================================
 // Progress Tracking
 //=============================================================================
@@ -169,7 +422,7 @@ void setProgressCallback(ProgressCallback callback)
 
 bool defaultProgressCallback(uint32_t downloaded, uint32_t total, uint8_t percentage)
 {
-    Serial.printf("Progress: %d/%d bytes (%d%%)\n", downloaded, total, percentage);
+    LOGR(lmSync, llInfo, "Progress: %d/%d bytes (%d%%)\n", downloaded, total, percentage);
     return true;
 }
 
@@ -179,7 +432,7 @@ bool defaultProgressCallback(uint32_t downloaded, uint32_t total, uint8_t percen
 
 String getLocalFileList()
 {
-    JsonDocument doc;
+    JsonDocument doc(jsonPsram(jdkFileList));
     JsonArray files = doc["files"].to<JsonArray>();
 
     Serial.println("=== Local LittleFS file list ===");
@@ -274,7 +527,105 @@ size_t getPsramFreeSpace()
 // Copy Files from LittleFS to PSRAM
 //=============================================================================
 
-static bool copyFileToPsram(const char *filename)
+// Inflates the zlib stream that follows the header, the 32 KB window doubles as the output buffer
+static bool inflateToPsram(File &srcFile, File &dstFile, size_t rawSize, size_t &totalCopied, uint32_t &hash)
+{
+    tinfl_decompressor *inflator = (tinfl_decompressor *)malloc(sizeof(tinfl_decompressor));
+    uint8_t *window = (uint8_t *)memTagAlloc(mtSync, TINFL_LZ_DICT_SIZE, MALLOC_CAP_SPIRAM);
+    if (window == NULL)
+    {
+        window = (uint8_t *)memTagAlloc(mtSync, TINFL_LZ_DICT_SIZE, MALLOC_CAP_8BIT);
+    }
+    uint8_t *inBuf = (uint8_t *)malloc(COPY_BUFFER_SIZE);
+    bool ok = (inflator != NULL) && (window != NULL) && (inBuf != NULL);
+    if (!ok)
+    {
+        Serial.println("!!! inflateToPsram ERROR: out of memory");
+    }
+
+    size_t inAvail = 0;
+    size_t inPos = 0;
+    size_t outPos = 0;
+    tinfl_status status = TINFL_STATUS_NEEDS_MORE_INPUT;
+    if (ok)
+    {
+        tinfl_init(inflator);
+    }
+    while (ok && (status != TINFL_STATUS_DONE))
+    {
+        if ((inAvail == 0) && srcFile.available())
+        {
+            inAvail = srcFile.read(inBuf, COPY_BUFFER_SIZE);
+            inPos = 0;
+            hash = updateSyncHash(hash, inBuf, inAvail);
+        }
+        size_t inBytes = inAvail;
+        size_t outBytes = TINFL_LZ_DICT_SIZE - outPos;
+        uint32_t flags = TINFL_FLAG_PARSE_ZLIB_HEADER;
+        if (srcFile.available())
+        {
+            flags |= TINFL_FLAG_HAS_MORE_INPUT;
+        }
+        status = tinfl_decompress(inflator, inBuf + inPos, &inBytes, window, window + outPos, &outBytes, flags);
+        inPos += inBytes;
+        inAvail -= inBytes;
+
+        if ((outBytes > 0) && (dstFile.write(window + outPos, outBytes) != outBytes))
+        {
+            Serial.println("!!! inflateToPsram ERROR: PSRAM write failed");
+            ok = false;
+        }
+        totalCopied += outBytes;
+        outPos = (outPos + outBytes) & (TINFL_LZ_DICT_SIZE - 1);
+
+        if (status < TINFL_STATUS_DONE)
+        {
+            Serial.printf("!!! inflateToPsram ERROR: corrupt stream (%d)\r\n", (int)status);
+            ok = false;
+        }
+        else if ((status == TINFL_STATUS_NEEDS_MORE_INPUT) && (inAvail == 0) && !srcFile.available())
+        {
+            Serial.println("!!! inflateToPsram ERROR: truncated stream");
+            ok = false;
+        }
+        yield();
+    }
+    if (ok && (totalCopied != rawSize))
+    {
+        Serial.printf("!!! inflateToPsram ERROR: %u bytes inflated, %u expected\r\n", totalCopied, rawSize);
+        ok = false;
+    }
+    // bytes past the stream end count for the file hash all the same
+    while (ok && srcFile.available())
+    {
+        hash = updateSyncHash(hash, inBuf, srcFile.read(inBuf, COPY_BUFFER_SIZE));
+    }
+
+    free(inBuf);
+    memTagFree(window);
+    free(inflator);
+    return ok;
+}
+
+// The stored bytes go through the server hash on the way; a copy that does
+// not match expectHash (empty: not known) is corrupt on flash and goes from
+// LittleFS too, the next sync fetches it again
+static bool rejectCorruptCopy(const char *filename, uint32_t hash, const String &expectHash)
+{
+    if (expectHash.isEmpty() || String(hash, HEX).equalsIgnoreCase(expectHash))
+    {
+        return false;
+    }
+    LOGR(lmSync, llError, "%s on flash hashes to %X, the manifest has %s: dropped", filename,
+         (unsigned)hash, expectHash.c_str());
+    PSRamFS.remove("/" + String(filename));
+    LittleFS.remove("/" + String(filename));
+    return true;
+}
+
+static void markStreamed(const String &filename);
+
+static bool copyFileToPsram(const char *filename, const String &expectHash)
 {
     String spiffsPath = "/";
     spiffsPath += filename;
@@ -292,13 +643,36 @@ static bool copyFileToPsram(const char *filename)
 
     size_t fileSize = srcFile.size();
 
+    // A compressed file needs room for its inflated size
+    uint8_t header[SYNC_ZLIB_HDR_SIZE];
+    uint32_t hash = 0;
+    bool compressed = (srcFile.read(header, SYNC_ZLIB_HDR_SIZE) == SYNC_ZLIB_HDR_SIZE) &&
+                      (memcmp(header, SYNC_ZLIB_MAGIC, sizeof(SYNC_ZLIB_MAGIC)) == 0);
+    if (compressed)
+    {
+        hash = updateSyncHash(hash, header, SYNC_ZLIB_HDR_SIZE);
+        fileSize = (size_t)header[4] | ((size_t)header[5] << 8) | ((size_t)header[6] << 16) | ((size_t)header[7] << 24);
+    }
+    else
+    {
+        srcFile.seek(0);
+    }
+
     // Check PSRAM space
     size_t freeSpace = PSRamFS.totalBytes() - PSRamFS.usedBytes();
     if (fileSize > freeSpace)
     {
-        Serial.printf("Not enough PSRAM space for %s (need %d, have %d)\n",
-                      filename, fileSize, freeSpace);
         srcFile.close();
+        if (compressed)
+        {
+            Serial.printf("Not enough PSRAM space for %s (need %d, have %d)\n",
+                          filename, fileSize, freeSpace);
+            return false;
+        }
+        // stored as is, it can be read from LittleFS instead
+        Serial.printf("Not enough PSRAM space for %s (need %d, have %d), streamed from LittleFS\n",
+                      filename, fileSize, freeSpace);
+        markStreamed(filename);
         return false;
     }
 
@@ -317,9 +691,30 @@ static bool copyFileToPsram(const char *filename)
         return false;
     }
 
+    size_t totalCopied = 0;
+    if (compressed)
+    {
+        size_t storedSize = srcFile.size();
+        bool ok = inflateToPsram(srcFile, dstFile, fileSize, totalCopied, hash);
+        srcFile.close();
+        dstFile.close();
+        if (!ok)
+        {
+            Serial.printf("Inflate error copying %s\n", filename);
+            PSRamFS.remove(psramPath);
+            return false;
+        }
+        if (rejectCorruptCopy(filename, hash, expectHash))
+        {
+            return false;
+        }
+        bootProfPsramCopy(totalCopied);
+        Serial.printf("Loaded to PSRAM: %s (%d bytes, inflated from %d)\n", filename, totalCopied, storedSize);
+        return true;
+    }
+
     // Copy data in chunks
     uint8_t buffer[COPY_BUFFER_SIZE];
-    size_t totalCopied = 0;
 
     while (srcFile.available())
     {
@@ -335,18 +730,130 @@ static bool copyFileToPsram(const char *filename)
             return false;
         }
         
+        hash = updateSyncHash(hash, buffer, bytesRead);
         totalCopied += bytesWritten;
         yield(); // Prevent watchdog timeout
     }
 
     srcFile.close();
     dstFile.close();
+    if (rejectCorruptCopy(filename, hash, expectHash))
+    {
+        return false;
+    }
 
+    bootProfPsramCopy(totalCopied);
     Serial.printf("Loaded to PSRAM: %s (%d bytes)\n", filename, totalCopied);
     return true;
 }
 
-// Internal version - LittleFS must already be initialized
+static bool isLazyFile(const String &filename)
+{
+    String lower = filename;
+    lower.toLowerCase();
+    for (const char *ext : PSRAM_LAZY_EXTS)
+    {
+        if (lower.endsWith(ext))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Bitmaps and animations in the mapped asset image are drawn from flash, they need no PSRAM copy
+static bool isPackedBmp(const String &filename)
+{
+    const uint8_t *data;
+    size_t size;
+    tAssetFormat format;
+    return assetPackFind(filename.c_str(), &data, &size, &format) &&
+           ((format == afBmp) || (format == afRgb565) || (format == afAnim));
+}
+
+static bool copyMappedToPsram(const String &filename, const uint8_t *data, size_t size)
+{
+    File dstFile = PSRamFS.open("/" + filename, "w");
+    if (!dstFile)
+    {
+        Serial.printf("Failed to create PSRAM file: %s\n", filename.c_str());
+        return false;
+    }
+    size_t written = dstFile.write(data, size);
+    dstFile.close();
+    if (written != size)
+    {
+        Serial.printf("Write error copying %s\n", filename.c_str());
+        PSRamFS.remove("/" + filename);
+        return false;
+    }
+    bootProfPsramCopy(size);
+    Serial.printf("Loaded to PSRAM: %s (%d bytes, from the asset image)\n", filename.c_str(), size);
+    return true;
+}
+
+// The scope of the last completed sync, false without a cached list (all files count)
+static bool scopeLoad(tSyncIndex &scope)
+{
+    String cached = loadServerListCache();
+    return !cached.isEmpty() && syncIndexServer(scope, cached);
+}
+
+static bool inScope(const tSyncIndex &scope, bool scoped, const String &filename)
+{
+    return !scoped || (syncIndexFind(scope, filename.c_str()) != NULL);
+}
+
+static void streamTiersFromScope(const tSyncIndex &scope, bool scoped)
+{
+    streamNames.clear();
+    for (uint32_t i = 0; scoped && (i < scope.count); i++)
+    {
+        if (scope.recs[i].tier == atStream)
+        {
+            streamNames.push_back(scope.recs[i].nameHash);
+        }
+    }
+    std::sort(streamNames.begin(), streamNames.end());
+    streamTiersLoaded = true;
+}
+
+static bool isStreamed(const String &filename)
+{
+    if (!streamTiersLoaded)
+    {
+        tSyncIndex scope;
+        streamTiersFromScope(scope, scopeLoad(scope));
+        syncIndexFree(scope);
+    }
+    return std::binary_search(streamNames.begin(), streamNames.end(), syncNameHash(filename.c_str()));
+}
+
+static void markStreamed(const String &filename)
+{
+    uint32_t hash = syncNameHash(filename.c_str());
+    auto it = std::lower_bound(streamNames.begin(), streamNames.end(), hash);
+    if ((it == streamNames.end()) || (*it != hash))
+    {
+        streamNames.insert(it, hash);
+    }
+}
+
+// A lazy file that changed on LittleFS drops its PSRAM copy, the next use
+// copies the new version
+static void refreshPsramCopy(const String &filename, JsonDocument &active)
+{
+    if (!isLazyFile(filename) && !isPackedBmp(filename) && !isStreamed(filename))
+    {
+        copyFileToPsram(filename.c_str(), activeHash(active, filename));
+    }
+    else if (PSRamFS.exists("/" + filename))
+    {
+        PSRamFS.remove("/" + filename);
+    }
+}
+
+// Internal version - LittleFS must already be initialized, lazy files are skipped
 static int loadFilesToPsramInternal()
 {
     int filesLoaded = 0;
@@ -358,6 +865,10 @@ static int loadFilesToPsramInternal()
         Serial.println("Failed to open LittleFS root");
         return 0;
     }
+    tSyncIndex scope;
+    bool scoped = scopeLoad(scope);
+    streamTiersFromScope(scope, scoped);
+    JsonDocument active(jsonPsram(jdkManifest));
 
     File file = root.openNextFile();
     while (file)
@@ -370,10 +881,12 @@ static int loadFilesToPsramInternal()
                 filename = filename.substring(1);
             }
 
-            // Skip the server list cache file
-            if (filename != ".server_list.json")
+            // Skip the server list cache, the manifest, the media loaded on demand, the
+            // streamed files and other scopes' files
+            if (!isInternalFile(filename) && !isLazyFile(filename) && !isPackedBmp(filename) &&
+                !isStreamed(filename) && inScope(scope, scoped, filename))
             {
-                if (copyFileToPsram(filename.c_str()))
+                if (copyFileToPsram(filename.c_str(), activeHash(active, filename)))
                 {
                     filesLoaded++;
                 }
@@ -386,306 +899,1130 @@ static int loadFilesToPsramInternal()
         file = root.openNextFile();
     }
 
-    Serial.printf("Loaded %d files to PSRAM (%d failed)\n", filesLoaded, filesFailed);
-    return filesLoaded;
-}
-
-int loadFilesToPsram()
-{
-    Serial.println("=== Loading files from LittleFS to PSRAM ===");
-    
-    // Initialize LittleFS
-    if (!initSpiffs())
-    {
-        Serial.println("ERROR: Failed to initialize LittleFS!");
-        return 0;
-    }
-
-    int filesLoaded = loadFilesToPsramInternal();
-
-    // End LittleFS
-    endSpiffs();
+    syncIndexFree(scope);
 
-    Serial.printf("=== Loaded %d files to PSRAM ===\n", filesLoaded);
+    Serial.printf("Loaded %d files to PSRAM (%d failed)\n", filesLoaded, filesFailed);
     return filesLoaded;
 }
 
 //=============================================================================
-// Server Communication
+// Staged File Set (background sync)
 //=============================================================================
 
-String getServerFileList(const char *serverAddress)
+static String baseName(const String &path)
 {
-    HTTPClient http;
-    http.begin(String(serverAddress) + "/list");
-    http.setTimeout(10000);
-
-    int httpResponseCode = http.GET();
+    int slash = path.lastIndexOf('/');
+    return (slash < 0) ? path : path.substring(slash + 1);
+}
 
-    if (httpResponseCode == 200)
+static void stageDiscard()
+{
+    File dir = LittleFS.open(STAGE_DIR);
+    if (!dir || !dir.isDirectory())
     {
-        String payload = http.getString();
-        http.end();
-
-        Serial.println("=== Server file list ===");
-
-        JsonDocument serverDoc;
-        DeserializationError error = deserializeJson(serverDoc, payload);
-
-        if (!error)
-        {
-            JsonArray serverFiles = serverDoc["files"];
-            for (JsonObject file : serverFiles)
-            {
-                String filename = file["name"].as<String>();
-                uint32_t fileSize = file["size"].as<uint32_t>();
-                Serial.printf("  %s (%d bytes)\n", filename.c_str(), fileSize);
-            }
-        }
-
-        Serial.println("=== End server file list ===");
-        return payload;
+        return;
     }
-    else
+    std::vector<String> names;
+    File file = dir.openNextFile();
+    while (file)
     {
-        Serial.printf("Error getting file list from server, code: %d\n", httpResponseCode);
-        http.end();
-        return "";
+        names.push_back(baseName(file.name()));
+        file.close();
+        file = dir.openNextFile();
+    }
+    dir.close();
+    for (const String &name : names)
+    {
+        LittleFS.remove(String(STAGE_DIR) + "/" + name);
     }
+    LittleFS.rmdir(STAGE_DIR);
+    Serial.printf("Staging directory cleared (%d files)\n", names.size());
 }
 
-//=============================================================================
-// Download File to LittleFS
-//=============================================================================
-
-static bool downloadFileToSpiffs(const char *serverAddress, const char *filename, 
-                                  SyncProgress &syncProgress, const size_t bufferSize, uint8_t *buffer)
+// Moves a complete stage over the active files, under the lock with LittleFS
+// mounted; the journal makes every step repeatable after a reset
+static bool stageCommit(std::vector<String> &switched, std::vector<String> &dropped)
 {
-    HTTPClient http;
-    http.begin(String(serverAddress) + "/download?file=" + String(filename));
-    http.setTimeout(30000);
-    http.setConnectTimeout(10000);
+    bool journal = LittleFS.exists(STAGE_JOURNAL);
+    if (!journal && !LittleFS.exists(STAGE_LIST))
+    {
+        return false;
+    }
+    if (!journal)
+    {
+        File mark = LittleFS.open(STAGE_JOURNAL, "w");
+        if (!mark)
+        {
+            Serial.println("ERROR: Failed to write the stage journal");
+            return false;
+        }
+        mark.close();
+    }
+    Serial.printf("=== Switching to the staged file set%s ===\n", journal ? " (rolled forward)" : "");
+
+    std::vector<String> names;
+    File dir = LittleFS.open(STAGE_DIR);
+    File file = dir ? dir.openNextFile() : File();
+    while (file)
+    {
+        String name = baseName(file.name());
+        if (!file.isDirectory() && !isInternalFile(name))
+        {
+            names.push_back(name);
+        }
+        file.close();
+        file = dir.openNextFile();
+    }
+    if (dir)
+    {
+        dir.close();
+    }
+    for (const String &name : names)
+    {
+        LittleFS.remove("/" + name);
+        if (LittleFS.rename(String(STAGE_DIR) + "/" + name, "/" + name))
+        {
+            switched.push_back(name);
+        }
+        else
+        {
+            Serial.printf("ERROR: Failed to switch %s\n", name.c_str());
+        }
+    }
+
+    if (LittleFS.exists(STAGE_MANIFEST))
+    {
+        JsonDocument manifest(jsonPsram(jdkManifest));
+        bool staging = syncStaging;
+        syncStaging = true;
+        loadManifest(manifest);
+        syncStaging = false;
+        for (JsonVariant name : manifest["drop"].as<JsonArray>())
+        {
+            String filename = name.as<String>();
+            if (LittleFS.exists("/" + filename))
+            {
+                deleteFileFromSpiffs(filename.c_str());
+                dropped.push_back(filename);
+            }
+        }
+        manifest.remove("drop");
+        saveManifest(manifest);
+        syncStaging = staging;
+        LittleFS.remove(STAGE_MANIFEST);
+    }
+    if (LittleFS.exists(STAGE_LIST))
+    {
+        LittleFS.remove(SERVER_LIST_CACHE_FILE);
+        LittleFS.rename(STAGE_LIST, SERVER_LIST_CACHE_FILE);
+    }
+    stageDiscard();
+    // the stage was listed before the boot's hash, or after it by a later scope
+    LittleFS.remove(ASSETS_SIG_FILE);
+    Serial.printf("=== Switched: %d files, %d removed ===\n", switched.size(), dropped.size());
+    return true;
+}
+
+// PSRAM after a scope change: files that came into it and were current on
+// LittleFS already get their copy, the ones that left it lose theirs
+static void psramFollowScope()
+{
+    tSyncIndex scope;
+    if (!scopeLoad(scope))
+    {
+        return;
+    }
+    streamTiersFromScope(scope, true);
+    std::vector<String> names;
+    File root = LittleFS.open("/");
+    File file = root ? root.openNextFile() : File();
+    while (file)
+    {
+        String filename = baseName(file.name());
+        if (!file.isDirectory() && !isInternalFile(filename))
+        {
+            names.push_back(filename);
+        }
+        file = root.openNextFile();
+    }
+    if (root)
+    {
+        root.close();
+    }
+    JsonDocument active(jsonPsram(jdkManifest));
+    for (const String &name : names)
+    {
+        bool wanted = inScope(scope, true, name);
+        bool copied = PSRamFS.exists("/" + name);
+        if ((!wanted || isStreamed(name)) && copied)
+        {
+            PSRamFS.remove("/" + name);
+        }
+        else if (wanted && !copied && !isLazyFile(name) && !isPackedBmp(name) && !isStreamed(name))
+        {
+            copyFileToPsram(name.c_str(), activeHash(active, name));
+        }
+    }
+    syncIndexFree(scope);
+}
+
+// After a switch at run time the PSRAM copies follow the new files
+static void stagePsramFollow(const std::vector<String> &switched, const std::vector<String> &dropped)
+{
+    JsonDocument active(jsonPsram(jdkManifest));
+    for (const String &name : switched)
+    {
+        refreshPsramCopy(name, active);
+    }
+    for (const String &name : dropped)
+    {
+        PSRamFS.remove("/" + name);
+    }
+    psramFollowScope();
+}
+
+int loadFilesToPsram()
+{
+    Serial.println("=== Loading files from LittleFS to PSRAM ===");
+    
+    // Initialize LittleFS
+    if (!initSpiffs())
+    {
+        Serial.println("ERROR: Failed to initialize LittleFS!");
+        return 0;
+    }
+
+    // a stage the previous boot completed goes live before the copy
+    std::vector<String> switched, dropped;
+    lockSpiffs();
+    stageCommit(switched, dropped);
+    unlockSpiffs();
+
+    int filesLoaded = loadFilesToPsramInternal();
+    psramPreloaded = (filesLoaded > 0);
+
+    // End LittleFS
+    endSpiffs();
+
+    Serial.printf("=== Loaded %d files to PSRAM ===\n", filesLoaded);
+    return filesLoaded;
+}
+
+bool ensureFileInPsram(const char *filename)
+{
+    String name = filename;
+    if (name.startsWith("/"))
+    {
+        name = name.substring(1);
+    }
+    // the asset image is already in memory, a copy from it needs no LittleFS
+    const uint8_t *data;
+    size_t size;
+    if (assetPackFind(name.c_str(), &data, &size))
+    {
+        lockSpiffs();
+        bool ok = PSRamFS.exists("/" + name) || copyMappedToPsram(name, data, size);
+        unlockSpiffs();
+        return ok;
+    }
+    if (!initSpiffs())
+    {
+        return PSRamFS.exists("/" + name);
+    }
+    // checked under the lock, a copy the prefetch task is writing is not done yet
+    lockSpiffs();
+    bool ok = PSRamFS.exists("/" + name);
+    if (!ok && !isStreamed(name) && fileExistsOnSpiffs(name.c_str()))
+    {
+        JsonDocument active(jsonPsram(jdkManifest));
+        ok = copyFileToPsram(name.c_str(), activeHash(active, name));
+    }
+    // a streamed file has no copy, StreamFS reads it (assetFsFor())
+    bool streamed = !ok && isStreamed(name);
+    unlockSpiffs();
+    endSpiffs();
+    if (!ok && !streamed)
+    {
+        Serial.printf("!!! ensureFileInPsram ERROR: [%s] is not available\r\n", name.c_str());
+    }
+    return ok;
+}
+
+bool refreshFileInPsram(const char *filename)
+{
+    String name = filename;
+    if (name.startsWith("/"))
+    {
+        name = name.substring(1);
+    }
+    if (!initSpiffs())
+    {
+        return false;
+    }
+    // not the manifest's version, there is no hash to hold it to
+    lockSpiffs();
+    bool ok = fileExistsOnSpiffs(name.c_str()) && copyFileToPsram(name.c_str(), String());
+    unlockSpiffs();
+    endSpiffs();
+    return ok;
+}
+
+static void psramPrefetchTask(void *param)
+{
+    int filesLoaded = 0;
+    if (initSpiffs())
+    {
+        std::vector<String> names;
+        tSyncIndex scope;
+        bool scoped = scopeLoad(scope);
+        File root = LittleFS.open("/");
+        File file = root ? root.openNextFile() : File();
+        while (file)
+        {
+            String filename = file.name();
+            if (filename.startsWith("/"))
+            {
+                filename = filename.substring(1);
+            }
+            if (!file.isDirectory() && isLazyFile(filename) && inScope(scope, scoped, filename))
+            {
+                names.push_back(filename);
+            }
+            file = root.openNextFile();
+        }
+        root.close();
+        lockSpiffs();
+        streamTiersFromScope(scope, scoped);
+        unlockSpiffs();
+        syncIndexFree(scope);
+
+        // one file per lock, an on-demand copy waits for at most one file
+        JsonDocument active(jsonPsram(jdkManifest));
+        for (const String &name : names)
+        {
+            lockSpiffs();
+            if (!PSRamFS.exists("/" + name) && !isStreamed(name) && copyFileToPsram(name.c_str(), activeHash(active, name)))
+            {
+                filesLoaded++;
+            }
+            unlockSpiffs();
+            vTaskDelay(1);
+        }
+        endSpiffs();
+    }
+    Serial.printf(">>> psramPrefetchTask: %d media files prefetched to PSRAM\r\n", filesLoaded);
+    vTaskDelete(NULL);
+}
+
+void startPsramPrefetch(void)
+{
+    taskStart(tkPsramPrefetch, psramPrefetchTask);
+}
+
+fs::FS *assetFsFor(const char *filename)
+{
+    const uint8_t *data;
+    size_t size;
+    if (assetPackFind(filename, &data, &size))
+    {
+        return &AssetFS;
+    }
+    String name = filename;
+    if (name.startsWith("/"))
+    {
+        name = name.substring(1);
+    }
+    bool streamed = false;
+    if (initSpiffs())
+    {
+        lockSpiffs();
+        streamed = isStreamed(name);
+        unlockSpiffs();
+        endSpiffs();
+    }
+    // a copy that found no room marks the file streamed on the way
+    if (!streamed && ensureFileInPsram(filename))
+    {
+        return &PSRamFS;
+    }
+    return StreamFS.exists(("/" + name).c_str()) ? &StreamFS : NULL;
+}
+
+//=============================================================================
+// Server Communication
+//=============================================================================
+
+String getServerFileList(const char *serverAddress)
+{
+    String url = String(serverAddress) + "/list?enc=" + SYNC_ENC + "&class=" + SYNC_DEVICE_CLASS;
+    if (!syncRoles.isEmpty())
+    {
+        url += "&roles=" + syncRoles;
+    }
+    tHttpLease lease(url);
+    HTTPClient &http = lease.http();
+    lease.begin(url);
+    http.setTimeout(10000);
+
+    int64_t startUs = esp_timer_get_time();
+    int httpResponseCode = http.GET();
+    bootProfHttp(startUs);
+
+    if (httpResponseCode == 200)
+    {
+        String payload = http.getString();
+        http.end();
+
+        // parsed by syncFiles() only when it differs from the cached one
+        Serial.printf("=== Server file list: %u bytes ===\n", payload.length());
+        return payload;
+    }
+    else
+    {
+        Serial.printf("Error getting file list from server, code: %d\n", httpResponseCode);
+        http.end();
+        return "";
+    }
+}
+
+//=============================================================================
+// Pipelined Download to LittleFS
+//=============================================================================
+
+struct tDlFile
+{
+    const tSyncRec *rec;            // main task only, its object is in the list text
+    String name;
+    String hash;                    // expected, from the server list
+    uint32_t size = 0;
+    bool resumable = false;         // the .part file belongs to this hash
+    File file;
+    int contentLength = -1;
+    uint32_t resumeFrom = 0;
+    uint32_t written = 0;           // including the resumed part
+    uint32_t hashState = 0;
+    unsigned long startMs = 0;
+    volatile bool writeFailed = false;
+    bool ok = false;
+    bool kept = false;              // failed, the .part file is left for a resume
+};
+
+struct tDlBlock
+{
+    tDlFile *dl;        // NULL stops the writer
+    uint8_t *buf;       // NULL on the closing block of a file the reader gave up on
+    size_t len;
+    bool last;
+};
+
+struct tDlPipe
+{
+    const char *serverAddress;
+    const String *listText;         // main task only
+    std::vector<tDlFile> *files;
+    size_t next;
+    volatile bool cancel;
+    volatile uint32_t netBytes;
+    SemaphoreHandle_t mutex;
+    SemaphoreHandle_t readersDone;
+    SemaphoreHandle_t writerDone;
+    QueueHandle_t freeBufs;
+    QueueHandle_t blocks;
+    QueueHandle_t results;
+};
+
+static tDlPipe dlPipe;
+static portMUX_TYPE dlMux = portMUX_INITIALIZER_UNLOCKED;
+
+static tDlFile *takeNextFile(void)
+{
+    tDlFile *dl = NULL;
+    xSemaphoreTake(dlPipe.mutex, portMAX_DELAY);
+    if (!dlPipe.cancel && (dlPipe.next < dlPipe.files->size()))
+    {
+        dl = &(*dlPipe.files)[dlPipe.next++];
+    }
+    xSemaphoreGive(dlPipe.mutex);
+    return dl;
+}
+
+static void sendBlock(tDlFile *dl, uint8_t *buf, size_t len, bool last)
+{
+    tDlBlock block = {dl, buf, len, last};
+    xQueueSend(dlPipe.blocks, &block, portMAX_DELAY);
+}
+
+// Network side: streams one file into pool buffers and hands them to the writer
+static bool streamFile(HTTPClient &http, WiFiClient &client, tDlFile *dl)
+{
+    http.setReuse(true);
+    if (!http.begin(client, String(dlPipe.serverAddress) + "/download?file=" + dl->name + "&enc=" + SYNC_ENC))
+    {
+        return false;
+    }
+    http.setTimeout(30000);
+    http.setConnectTimeout(10000);
+
+    String partPath = landPath(dl->name) + PARTIAL_SUFFIX;
+    dl->resumeFrom = 0;
+    if (dl->resumable)
+    {
+        File part = LittleFS.open(partPath, "r");
+        if (part)
+        {
+            dl->resumeFrom = part.size();
+            part.close();
+        }
+        // a complete part file that failed to be renamed is fetched again
+        if (dl->resumeFrom >= dl->size)
+        {
+            dl->resumeFrom = 0;
+        }
+        if (dl->resumeFrom > 0)
+        {
+            http.addHeader("Range", "bytes=" + String(dl->resumeFrom) + "-");
+        }
+    }
+
+    dl->startMs = millis();
+    syncCollectHeaders(http);
+    int64_t startUs = esp_timer_get_time();
+    int httpResponseCode = http.GET();
+    bootProfHttp(startUs);
+
+    // a server that ignores the Range header sends the whole file again
+    if ((httpResponseCode == 200) || ((httpResponseCode == 206) && (dl->resumeFrom > 0)))
+    {
+        if (httpResponseCode == 200)
+        {
+            dl->resumeFrom = 0;
+        }
+    }
+    else
+    {
+        Serial.printf("Download error for file: %s, code: %d\n", dl->name.c_str(), httpResponseCode);
+        syncNoteAdmission(http, httpResponseCode);
+        http.end();
+        return false;
+    }
+
+    dl->contentLength = http.getSize();
+    if (dl->resumeFrom > 0)
+    {
+        Serial.printf("Resuming: %s at %lu (%d bytes left)\n", dl->name.c_str(), dl->resumeFrom, dl->contentLength);
+    }
+    else
+    {
+        Serial.printf("Downloading: %s (%d bytes)\n", dl->name.c_str(), dl->contentLength);
+    }
+
+    // Check LittleFS space
+    size_t freeSpace = LittleFS.totalBytes() - LittleFS.usedBytes();
+    if (dl->contentLength > 0 && (size_t)dl->contentLength > freeSpace)
+    {
+        Serial.printf("Not enough LittleFS space. Need: %d, Available: %d\n",
+                      dl->contentLength, freeSpace);
+        http.end();
+        return false;
+    }
+
+    // the part already on flash is hashed before the new bytes are appended
+    dl->hashState = 0;
+    dl->written = 0;
+    if (dl->resumeFrom > 0)
+    {
+        uint8_t *buf = NULL;
+        xQueueReceive(dlPipe.freeBufs, &buf, portMAX_DELAY);
+        File part = LittleFS.open(partPath, "r");
+        size_t got;
+        while (part && ((got = part.read(buf, SYNC_PIPE_BUF_SIZE)) > 0))
+        {
+            dl->hashState = updateSyncHash(dl->hashState, buf, got);
+            dl->written += got;
+        }
+        if (part)
+        {
+            part.close();
+        }
+        xQueueSend(dlPipe.freeBufs, &buf, portMAX_DELAY);
+        portENTER_CRITICAL(&dlMux);
+        dlPipe.netBytes += dl->written;
+        portEXIT_CRITICAL(&dlMux);
+    }
+    dl->file = LittleFS.open(partPath, (dl->resumeFrom > 0) ? "a" : "w");
+    if (!dl->file || (dl->written != dl->resumeFrom))
+    {
+        Serial.printf("Error creating LittleFS file: %s\n", partPath.c_str());
+        http.end();
+        return false;
+    }
+
+    WiFiClient *stream = http.getStreamPtr();
+    stream->setTimeout(5000);  // 5 second timeout for reads
+
+    int totalRead = 0;
+    bool ok = true;
+    while (dl->contentLength < 0 || totalRead < dl->contentLength)
+    {
+        if (dlPipe.cancel || dl->writeFailed)
+        {
+            ok = false;
+            break;
+        }
+        if (!http.connected() && !stream->available())
+        {
+            if (dl->contentLength > 0)
+            {
+                Serial.println("HTTP connection lost during download");
+                ok = false;
+            }
+            break;
+        }
+
+        uint8_t *buf = NULL;
+        xQueueReceive(dlPipe.freeBufs, &buf, portMAX_DELAY);
+        size_t want = SYNC_PIPE_BUF_SIZE;
+        if (dl->contentLength > 0)
+        {
+            want = min(want, (size_t)(dl->contentLength - totalRead));
+        }
+        size_t got = stream->readBytes(buf, want);
+        if (got == 0)
+        {
+            // timeout or end of stream
+            xQueueSend(dlPipe.freeBufs, &buf, portMAX_DELAY);
+            ok = (dl->contentLength < 0);
+            break;
+        }
+        totalRead += got;
+        portENTER_CRITICAL(&dlMux);
+        dlPipe.netBytes += got;
+        portEXIT_CRITICAL(&dlMux);
+        sendBlock(dl, buf, got, false);
+    }
+    http.end();
+    return ok;
+}
+
+static void dlReaderTask(void *param)
+{
+    {
+        // a slot of the pool per reader for the whole sync, the connection outlives it
+        tHttpLease lease(dlPipe.serverAddress);
+        tDlFile *dl;
+        while ((dl = takeNextFile()) != NULL)
+        {
+            dl->ok = streamFile(lease.http(), lease.client(), dl);
+            if (!dl->ok)
+            {
+                // the connection is in an unknown state, the next file opens a new one
+                lease.client().stop();
+            }
+            sendBlock(dl, NULL, 0, true);
+        }
+    }
+    xSemaphoreGive(dlPipe.readersDone);
+    vTaskDelete(NULL);
+}
+
+static void finishFile(tDlFile *dl)
+{
+    String spiffsPath = landPath(dl->name);
+    String partPath = spiffsPath + PARTIAL_SUFFIX;
+    bool opened = dl->file;
+    if (opened)
+    {
+        dl->file.close();
+    }
+    if (dl->ok && dl->writeFailed)
+    {
+        dl->ok = false;
+    }
+    if (dl->ok && (dl->contentLength > 0) && (dl->written != dl->resumeFrom + (uint32_t)dl->contentLength))
+    {
+        Serial.printf("Size mismatch! Expected: %d, Saved: %d\n", dl->resumeFrom + dl->contentLength, dl->written);
+        dl->ok = false;
+    }
+    bool hashOk = String(dl->hashState, HEX).equalsIgnoreCase(dl->hash);
+    if (dl->ok && !hashOk)
+    {
+        Serial.printf("Hash mismatch for %s, the part file is dropped\n", dl->name.c_str());
+        dl->ok = false;
+        dl->written = 0;
+    }
+    if (dl->ok)
+    {
+        LittleFS.remove(spiffsPath);
+        dl->ok = LittleFS.rename(partPath, spiffsPath);
+    }
+    if (!dl->ok)
+    {
+        // whatever reached flash intact is resumed next time, a part file
+        // this attempt never got to open stays as it was
+        dl->kept = opened ? ((dl->written > 0) && !dl->writeFailed) : dl->resumable;
+        if (opened && !dl->kept)
+        {
+            LittleFS.remove(partPath);
+        }
+        Serial.printf("Download cancelled or failed for: %s (%lu bytes kept)\n", dl->name.c_str(),
+                      dl->kept ? dl->written : 0);
+        return;
+    }
+    Serial.printf("Downloaded to LittleFS: %s (%d bytes, %lu ms)\n",
+                  dl->name.c_str(), dl->written, millis() - dl->startMs);
+}
+
+// Flash side: the only task that writes the downloaded blocks
+static void dlWriterTask(void *param)
+{
+    tDlBlock block;
+    while (xQueueReceive(dlPipe.blocks, &block, portMAX_DELAY) == pdTRUE)
+    {
+        if (block.dl == NULL)
+        {
+            break;
+        }
+        tDlFile *dl = block.dl;
+        if (block.buf != NULL)
+        {
+            if (!dl->writeFailed && (dl->file.write(block.buf, block.len) != block.len))
+            {
+                Serial.printf("Write error in %s at %d\n", dl->name.c_str(), dl->written);
+                dl->writeFailed = true;
+            }
+            if (!dl->writeFailed)
+            {
+                dl->hashState = updateSyncHash(dl->hashState, block.buf, block.len);
+                dl->written += block.len;
+            }
+            xQueueSend(dlPipe.freeBufs, &block.buf, portMAX_DELAY);
+        }
+        if (block.last)
+        {
+            finishFile(dl);
+            xQueueSend(dlPipe.results, &dl, portMAX_DELAY);
+        }
+    }
+    xSemaphoreGive(dlPipe.writerDone);
+    vTaskDelete(NULL);
+}
+
+static void setEntryChunks(JsonObject entry, JsonObject serverFile);
+
+static bool dlCompleteFile(tDlFile *dl, JsonDocument &manifest, SyncProgress &syncProgress,
+                           std::vector<String> &downloadedNames)
+{
+    JsonObject partial = manifest["partial"];
+    if (!dl->ok)
+    {
+        if (dl->kept)
+        {
+            partial[dl->name] = dl->hash;
+        }
+        else
+        {
+            partial.remove(dl->name);
+        }
+        saveManifest(manifest);
+        dlPipe.cancel = true;
+        return false;
+    }
+    partial.remove(dl->name);
+    JsonObject entry = manifest["files"][dl->name].to<JsonObject>();
+    entry["size"] = dl->size;
+    entry["hash"] = dl->hash;
+    JsonDocument fileDoc(jsonPsram(jdkFileList));
+    if (syncIndexParseEntry(*dlPipe.listText, *dl->rec, fileDoc))
+    {
+        setEntryChunks(entry, fileDoc.as<JsonObject>());
+    }
+    saveManifest(manifest);
+    syncProgress.processedFiles++;
+    downloadedNames.push_back(dl->name);
+    return true;
+}
+
+static void dlReportProgress(SyncProgress &syncProgress, uint32_t &reported)
+{
+    uint32_t netBytes = dlPipe.netBytes;
+    if (netBytes != reported)
+    {
+        if (!updateProgress(syncProgress, netBytes - reported, false))
+        {
+            dlPipe.cancel = true;
+        }
+        reported = netBytes;
+    }
+}
+
+// Downloads the files with SYNC_PARALLEL_FILES readers and one writer. The
+// manifest and the progress callback stay on the calling task; stops at the
+// first failure like the sequential sync did.
+static bool downloadFilesPipelined(const char *serverAddress, const String &listText, std::vector<tDlFile> &files,
+                                   JsonDocument &manifest, SyncProgress &syncProgress,
+                                   std::vector<String> &downloadedNames)
+{
+    if (files.empty())
+    {
+        return true;
+    }
+
+    int readers = min(SYNC_PARALLEL_FILES, (int)files.size());
+    int bufCount = readers * SYNC_PIPE_BUFS_PER_FILE;
+
+    dlPipe.serverAddress = serverAddress;
+    dlPipe.listText = &listText;
+    dlPipe.files = &files;
+    dlPipe.next = 0;
+    dlPipe.cancel = false;
+    dlPipe.netBytes = 0;
+    dlPipe.mutex = xSemaphoreCreateMutex();
+    dlPipe.readersDone = xSemaphoreCreateCounting(readers, 0);
+    dlPipe.writerDone = xSemaphoreCreateBinary();
+    dlPipe.freeBufs = xQueueCreate(bufCount, sizeof(uint8_t *));
+    dlPipe.blocks = xQueueCreate(bufCount + readers, sizeof(tDlBlock));
+    dlPipe.results = xQueueCreate(files.size(), sizeof(tDlFile *));
+
+    std::vector<uint8_t *> bufs;
+    for (int i = 0; i < bufCount; i++)
+    {
+        uint8_t *buf = (uint8_t *)memTagAlloc(mtSync, SYNC_PIPE_BUF_SIZE, MALLOC_CAP_SPIRAM);
+        if (buf == NULL)
+        {
+            buf = (uint8_t *)memTagAlloc(mtSync, SYNC_PIPE_BUF_SIZE, MALLOC_CAP_8BIT);
+        }
+        if (buf == NULL)
+        {
+            break;
+        }
+        bufs.push_back(buf);
+        xQueueSend(dlPipe.freeBufs, &buf, 0);
+    }
+
+    bool ok = !bufs.empty();
+    int started = 0;
+    if (!ok)
+    {
+        Serial.println("Failed to allocate download buffers");
+    }
+    else if (!taskStart(tkSyncWriter, dlWriterTask))
+    {
+        Serial.println("Failed to start the sync writer");
+        ok = false;
+    }
+    else
+    {
+        for (int i = 0; i < readers; i++)
+        {
+            if (taskStart(tkSyncReader, dlReaderTask))
+            {
+                started++;
+            }
+        }
+        Serial.printf("Pipelined download: %d files, %d readers, %d x %d byte buffers\n",
+                      files.size(), started, bufs.size(), SYNC_PIPE_BUF_SIZE);
+
+        uint32_t reported = 0;
+        tDlFile *dl;
+        while (uxSemaphoreGetCount(dlPipe.readersDone) < (UBaseType_t)started)
+        {
+            if (xQueueReceive(dlPipe.results, &dl, pdMS_TO_TICKS(100)) == pdTRUE)
+            {
+                ok = dlCompleteFile(dl, manifest, syncProgress, downloadedNames) && ok;
+            }
+            dlReportProgress(syncProgress, reported);
+        }
+
+        // the stop block queues behind the last block of every reader
+        sendBlock(NULL, NULL, 0, true);
+        xSemaphoreTake(dlPipe.writerDone, portMAX_DELAY);
+        while (xQueueReceive(dlPipe.results, &dl, 0) == pdTRUE)
+        {
+            ok = dlCompleteFile(dl, manifest, syncProgress, downloadedNames) && ok;
+        }
+        dlReportProgress(syncProgress, reported);
+        ok = ok && (started > 0) && (dlPipe.next == files.size());
+    }
+
+    for (uint8_t *buf : bufs)
+    {
+        memTagFree(buf);
+    }
+    vQueueDelete(dlPipe.results);
+    vQueueDelete(dlPipe.blocks);
+    vQueueDelete(dlPipe.freeBufs);
+    vSemaphoreDelete(dlPipe.writerDone);
+    vSemaphoreDelete(dlPipe.readersDone);
+    vSemaphoreDelete(dlPipe.mutex);
+    return ok;
+}
+
+//=============================================================================
+// Chunk Transfer (ranged download of the changed chunks only)
+//=============================================================================
+
+enum tPatchResult
+{
+    prNotPossible,      // no usable chunk list, the file is downloaded whole
+    prDone,
+    prFailed
+};
+
+// chunk size of the current server list, 0 for a server without chunk hashes
+static uint32_t serverChunkSize = 0;
 
-    int httpResponseCode = http.GET();
+static uint32_t chunkLength(size_t i, uint32_t fileSize)
+{
+    uint32_t offset = i * serverChunkSize;
+    return min(serverChunkSize, fileSize - offset);
+}
+
+static bool isChunkCurrent(JsonArray serverChunks, JsonArray localChunks, size_t i)
+{
+    return (i < localChunks.size()) && (localChunks[i].as<String>() == serverChunks[i].as<String>());
+}
 
-    if (httpResponseCode != 200)
+// Chunks are patched in place, so the manifest must describe the local copy
+// with the same chunk size and the file must not shrink (there is no truncate)
+static bool canPatchFile(JsonObject serverFile, JsonObject localEntry)
+{
+    if ((serverChunkSize == 0) || localEntry.isNull() ||
+        !serverFile["chunks"].is<JsonArray>() || !localEntry["chunks"].is<JsonArray>() ||
+        (localEntry["cs"].as<uint32_t>() != serverChunkSize))
     {
-        Serial.printf("Download error for file: %s, code: %d\n", filename, httpResponseCode);
-        http.end();
         return false;
     }
-
-    int contentLength = http.getSize();
-    Serial.printf("Downloading: %s (%d bytes)\n", filename, contentLength);
-
-    // Check LittleFS space
-    size_t freeSpace = LittleFS.totalBytes() - LittleFS.usedBytes();
-    if (contentLength > 0 && (size_t)contentLength > freeSpace)
+    uint32_t localSize = localEntry["size"].as<uint32_t>();
+    if (serverFile["size"].as<uint32_t>() < localSize)
+    {
+        return false;
+    }
+    File file = LittleFS.open(localPath(serverFile["name"].as<String>()), "r");
+    if (!file)
     {
-        Serial.printf("Not enough LittleFS space. Need: %d, Available: %d\n",
-                      contentLength, freeSpace);
-        http.end();
         return false;
     }
+    bool sizeOk = (file.size() == localSize);
+    file.close();
+    return sizeOk;
+}
 
-    // Prepare LittleFS path
-    String spiffsPath = "/";
-    spiffsPath += filename;
+static uint32_t patchBytes(JsonObject serverFile, JsonObject localEntry)
+{
+    JsonArray serverChunks = serverFile["chunks"];
+    JsonArray localChunks = localEntry["chunks"];
+    uint32_t serverSize = serverFile["size"].as<uint32_t>();
+    uint32_t total = 0;
+    for (size_t i = 0; i < serverChunks.size(); i++)
+    {
+        if (!isChunkCurrent(serverChunks, localChunks, i))
+        {
+            total += chunkLength(i, serverSize);
+        }
+    }
+    return total;
+}
 
-    // Remove existing file
-    if (LittleFS.exists(spiffsPath))
+static void setEntryChunks(JsonObject entry, JsonObject serverFile)
+{
+    if ((serverChunkSize == 0) || !serverFile["chunks"].is<JsonArray>())
     {
-        LittleFS.remove(spiffsPath);
+        return;
+    }
+    entry["cs"] = serverChunkSize;
+    JsonArray dst = entry["chunks"].to<JsonArray>();
+    for (JsonVariant hash : serverFile["chunks"].as<JsonArray>())
+    {
+        dst.add(hash.as<String>());
     }
+}
 
-    // Create file in LittleFS
-    File file = LittleFS.open(spiffsPath, "w");
-    if (!file)
+// The chunk goes through MD5 as it is written, the server lists the first
+// SYNC_CHUNK_HASH_LEN hex digits of it; a mismatch leaves the chunk unmarked,
+// so the next patch fetches it again
+static bool downloadChunk(HTTPClient &http, WiFiClient &client, const String &url, File &file,
+                          uint32_t offset, uint32_t length, const String &chunkHash, SyncProgress &syncProgress,
+                          const size_t bufferSize, uint8_t *buffer)
+{
+    http.setReuse(true);
+    if (!http.begin(client, url))
+    {
+        return false;
+    }
+    char range[32];
+    snprintf(range, sizeof(range), "bytes=%lu-%lu", (unsigned long)offset, (unsigned long)(offset + length - 1));
+    http.addHeader("Range", range);
+    http.setTimeout(30000);
+    http.setConnectTimeout(10000);
+    syncCollectHeaders(http);
+
+    int64_t startUs = esp_timer_get_time();
+    int httpResponseCode = http.GET();
+    bootProfHttp(startUs);
+
+    // a server that ignores the range answers 200 with the whole file
+    if ((httpResponseCode != HTTP_CODE_PARTIAL_CONTENT) || (http.getSize() != (int)length))
     {
-        Serial.printf("Error creating LittleFS file: %s\n", spiffsPath.c_str());
+        Serial.printf("Chunk download error, range %s, code: %d\n", range, httpResponseCode);
+        syncNoteAdmission(http, httpResponseCode);
         http.end();
         return false;
     }
 
     WiFiClient *stream = http.getStreamPtr();
-    stream->setTimeout(5000);  // 5 second timeout for reads
-    
-    int totalDownloaded = 0;
-    bool shouldContinue = true;
-    unsigned long lastProgressTime = millis();
-    unsigned long downloadStartTime = millis();
-    unsigned long totalNetworkTime = 0;
-    unsigned long totalWriteTime = 0;
+    stream->setTimeout(5000);
+    file.seek(offset);
 
-    // Download loop - read directly with timeout, no polling
-    while (shouldContinue && (contentLength < 0 || totalDownloaded < contentLength))
+    MD5Builder md5;
+    md5.begin();
+    uint32_t done = 0;
+    while (done < length)
     {
-        if (!http.connected() && !stream->available())
+        int bytesRead = stream->readBytes(buffer, min((uint32_t)bufferSize, length - done));
+        if (bytesRead <= 0)
         {
-            if (totalDownloaded < contentLength)
-            {
-                Serial.println("HTTP connection lost during download");
-            }
             break;
         }
-
-        int bytesToRead = bufferSize;
-        if (contentLength > 0)
-        {
-            bytesToRead = min((int)bufferSize, contentLength - totalDownloaded);
-        }
-        
-        unsigned long networkStart = millis();
-        int bytesRead = stream->readBytes(buffer, bytesToRead);
-        totalNetworkTime += millis() - networkStart;
-
-        if (bytesRead > 0)
+        if (file.write(buffer, bytesRead) != (size_t)bytesRead)
         {
-            unsigned long writeStart = millis();
-            size_t bytesWritten = file.write(buffer, bytesRead);
-            totalWriteTime += millis() - writeStart;
-            
-            if (bytesWritten != (size_t)bytesRead)
-            {
-                Serial.printf("Write error: expected %d, written %d\n", bytesRead, bytesWritten);
-                shouldContinue = false;
-                break;
-            }
-
-            totalDownloaded += bytesRead;
-
-            // Progress update every second
-            unsigned long currentTime = millis();
-            if (currentTime - lastProgressTime >= 1000)
-            {
-                Serial.printf("  Downloaded: %d/%d bytes (%.1f%%)\n",
-                              totalDownloaded,
-                              contentLength > 0 ? contentLength : totalDownloaded,
-                              contentLength > 0 ? (totalDownloaded * 100.0 / contentLength) : 0.0);
-                lastProgressTime = currentTime;
-            }
-
-            shouldContinue = updateProgress(syncProgress, bytesRead, false);
+            Serial.printf("Write error at %lu\n", (unsigned long)(offset + done));
+            break;
         }
-        else
+        md5.add(buffer, bytesRead);
+        done += bytesRead;
+        if (!updateProgress(syncProgress, bytesRead, false))
         {
-            // No data received - timeout or end of stream
             break;
         }
-        
         yield();
     }
-
-    file.close();;;
     http.end();
-
-    unsigned long downloadTime = millis() - downloadStartTime;
-
-    if (!shouldContinue)
+    if (done != length)
     {
-        LittleFS.remove(spiffsPath);
-        Serial.printf("Download cancelled or failed for: %s\n", filename);
         return false;
     }
+    md5.calculate();
+    String got = md5.toString().substring(0, SYNC_CHUNK_HASH_LEN);
+    if (!got.equalsIgnoreCase(chunkHash))
+    {
+        Serial.printf("Chunk hash mismatch, range %s: %s, listed %s\n", range, got.c_str(), chunkHash.c_str());
+        return false;
+    }
+    return true;
+}
 
-    // Verify file
-    if (LittleFS.exists(spiffsPath))
+// Rewrites only the chunks whose server hash differs from the manifest. The
+// manifest is updated chunk by chunk, so an interrupted patch resumes where
+// it stopped instead of falling back to a full download.
+static tPatchResult patchFileInSpiffs(const char *serverAddress, JsonObject serverFile, JsonObject localEntry,
+                                      JsonDocument &manifest, SyncProgress &syncProgress,
+                                      const size_t bufferSize, uint8_t *buffer)
+{
+    if (!canPatchFile(serverFile, localEntry))
     {
-        File verifyFile = LittleFS.open(spiffsPath, "r");
-        uint32_t savedSize = verifyFile.size();
-        verifyFile.close();
+        return prNotPossible;
+    }
 
-        if (contentLength > 0 && savedSize != (uint32_t)contentLength)
-        {
-            Serial.printf("Size mismatch! Expected: %d, Saved: %d\n", contentLength, savedSize);
-            LittleFS.remove(spiffsPath);
-            return false;
-        }
+    const char *filename = serverFile["name"].as<const char*>();
+    JsonArray serverChunks = serverFile["chunks"];
+    JsonArray localChunks = localEntry["chunks"];
+    uint32_t serverSize = serverFile["size"].as<uint32_t>();
 
-        Serial.printf("Downloaded to LittleFS: %s (%d bytes, total: %lu ms, download: %lu ms, write: %lu ms)\n", 
-                      filename, savedSize, downloadTime, totalNetworkTime, totalWriteTime);
-        return true;
+    // a staged patch works on a copy of the active file
+    String spiffsPath = landPath(filename);
+    if (syncStaging && !LittleFS.exists(spiffsPath) && !copyLittleFsFile("/" + String(filename), spiffsPath))
+    {
+        return prNotPossible;
     }
-    else
+    File file = LittleFS.open(spiffsPath, "r+");
+    if (!file)
     {
-        Serial.printf("ERROR: File was not saved: %s\n", filename);
-        return false;
+        return prNotPossible;
     }
-}
 
-//=============================================================================
-// Sync Size Calculation
-//=============================================================================
+    // until the last chunk is in, the entry must not match the server hash
+    localEntry["hash"] = "";
+    saveManifest(manifest);
 
-static uint32_t calculateSyncSize(const std::map<String, JsonObject> &serverMap,
-                                   const std::map<String, JsonObject> &localMap)
-{
-    uint32_t totalSize = 0;
+    String url = String(serverAddress) + "/download?file=" + String(filename) + "&enc=" + SYNC_ENC;
+    tHttpLease lease(url);
+    HTTPClient &http = lease.http();
+    WiFiClient &client = lease.client();
+    uint32_t fetched = 0;
+    int chunks = 0;
+    bool ok = true;
 
-    for (const auto &pair : serverMap)
+    for (size_t i = 0; ok && (i < serverChunks.size()); i++)
     {
-        const String &filename = pair.first;
-        JsonObject serverFile = pair.second;
+        if (isChunkCurrent(serverChunks, localChunks, i))
+        {
+            continue;
+        }
+        uint32_t offset = i * serverChunkSize;
+        uint32_t length = chunkLength(i, serverSize);
 
-        auto localIt = localMap.find(filename);
-        if (localIt == localMap.end())
+        while (localChunks.size() <= i)
         {
-            // File not on LittleFS - need to download
-            totalSize += serverFile["size"].as<uint32_t>();
+            localChunks.add("");
         }
-        else
+        localChunks[i] = "";
+        saveManifest(manifest);
+
+        ok = downloadChunk(http, client, url, file, offset, length, serverChunks[i].as<String>(),
+                           syncProgress, bufferSize, buffer);
+        if (ok)
         {
-            // File exists - check if size differs (simple sync check)
-            uint32_t serverSize = serverFile["size"].as<uint32_t>();
-            uint32_t localSize = localIt->second["size"].as<uint32_t>();
-            
-            if (serverSize != localSize)
+            file.flush();
+            localChunks[i] = serverChunks[i].as<String>();
+            if (offset + length > localEntry["size"].as<uint32_t>())
             {
-                totalSize += serverSize;
+                localEntry["size"] = offset + length;
             }
+            saveManifest(manifest);
+            fetched += length;
+            chunks++;
         }
     }
+    file.close();
+
+    if (!ok)
+    {
+        Serial.printf("Chunk transfer failed for: %s\n", filename);
+        lease.drop();
+        return prFailed;
+    }
 
-    return totalSize;
+    localEntry["size"] = serverSize;
+    localEntry["hash"] = serverFile["hash"].as<String>();
+    saveManifest(manifest);
+    Serial.printf("Patched in LittleFS: %s (%d chunks, %lu of %lu bytes fetched)\n",
+                  filename, chunks, (unsigned long)fetched, (unsigned long)serverSize);
+    return prDone;
 }
 
-static uint32_t countSyncFiles(const std::map<String, JsonObject> &serverMap,
-                                const std::map<String, JsonObject> &localMap)
-{
-    uint32_t totalFiles = 0;
+//=============================================================================
+// Sync Size Calculation
+//=============================================================================
 
-    for (const auto &pair : serverMap)
+// Bytes a changed file moves: its changed chunks when it can be patched,
+// the whole file otherwise
+static uint32_t syncBytesFor(JsonObject serverFile, JsonObject localEntry)
+{
+    if (canPatchFile(serverFile, localEntry))
     {
-        const String &filename = pair.first;
-        JsonObject serverFile = pair.second;
-
-        auto localIt = localMap.find(filename);
-        if (localIt == localMap.end())
-        {
-            totalFiles++;
-        }
-        else
-        {
-            uint32_t serverSize = serverFile["size"].as<uint32_t>();
-            uint32_t localSize = localIt->second["size"].as<uint32_t>();
-            
-            if (serverSize != localSize)
-            {
-                totalFiles++;
-            }
-        }
+        return patchBytes(serverFile, localEntry);
     }
-
-    return totalFiles;
+    return serverFile["size"].as<uint32_t>();
 }
 
 //=============================================================================
 // Main Sync Function
 //=============================================================================
 
-bool syncFiles(const char *serverAddress, ProgressCallback callback)
+static bool runSync(const char *serverAddress, ProgressCallback callback)
 {
-    Serial.println("=== Starting File Sync ===");
+    tPmHold hold(plHttp);
+    Serial.printf("=== Starting File Sync%s ===\n", syncStaging ? " (staged)" : "");
     Serial.printf("Server: %s\n", serverAddress);
 
     // Initialize LittleFS for sync operation
@@ -695,6 +2032,23 @@ bool syncFiles(const char *serverAddress, ProgressCallback callback)
         return false;
     }
 
+    if (syncStaging)
+    {
+        LittleFS.mkdir(STAGE_DIR);
+    }
+    else
+    {
+        // the active set is about to change, a stage built on top of it would be stale
+        std::vector<String> switched, dropped;
+        lockSpiffs();
+        if (stageCommit(switched, dropped) && psramPreloaded)
+        {
+            stagePsramFollow(switched, dropped);
+        }
+        stageDiscard();
+        unlockSpiffs();
+    }
+
     setProgressCallback(callback);
 
     SyncProgress syncProgress = {0, 0, 0, 0, 0, 0, millis()};
@@ -708,79 +2062,172 @@ bool syncFiles(const char *serverAddress, ProgressCallback callback)
         return false;
     }
 
+    if (syncStaging && (loadServerListCache(STAGE_LIST) == serverListStr))
+    {
+        Serial.println("Server list already staged - waiting for the switch");
+        endSpiffs();
+        return true;
+    }
+
     // Check if server list has changed (compares full JSON including hashes)
     bool serverListChanged = isServerListChanged(serverListStr);
     
+    if (!serverListChanged && syncStaging)
+    {
+        // the server went back to the active set, whatever was staged is not wanted
+        Serial.println("Files are up to date - nothing to stage");
+        stageDiscard();
+        endSpiffs();
+        return true;
+    }
+
     if (!serverListChanged)
     {
         Serial.println("Files are up to date - no sync needed");
         
-        // Still load files to PSRAM
-        Serial.println("Loading files to PSRAM...");
-        loadFilesToPsramInternal();
+        // Still load files to PSRAM, unless the boot preload already did
+        if (psramPreloaded)
+        {
+            Serial.println("Files already preloaded to PSRAM");
+        }
+        else
+        {
+            Serial.println("Loading files to PSRAM...");
+            loadFilesToPsramInternal();
+        }
+        saveAssetsSig();
         
         endSpiffs();
         return true;
     }
 
-    // Server list changed - need to re-download ALL files from server
-    // (because we can't compute local hashes, we must trust server hashes)
-    Serial.println("Server list changed - re-downloading all files");
+    // Server list changed - fetch only the files whose hash or size differ
+    // from the manifest written by the previous syncs
+    Serial.println("Server list changed - checking files against the manifest");
+
+    // a completed stage for an older list is incomplete for this one
+    if (syncStaging)
+    {
+        LittleFS.remove(STAGE_LIST);
+    }
 
-    // Parse server JSON
-    JsonDocument serverDoc;
-    if (deserializeJson(serverDoc, serverListStr))
+    // Index the server list and the manifest, one record per file
+    tSyncIndex serverIndex;
+    if (!syncIndexServer(serverIndex, serverListStr))
     {
         Serial.println("Error parsing server JSON");
         endSpiffs();
         return false;
     }
+    serverChunkSize = serverIndex.chunkSize;
 
-    JsonArray serverFiles = serverDoc["files"];
+    JsonDocument manifest(jsonPsram(jdkManifest));
+    loadManifest(manifest);
+    JsonObject manifestFiles = manifest["files"];
+
+    tSyncIndex localIndex;
+    if (!syncIndexManifest(localIndex, manifestFiles))
+    {
+        syncIndexFree(serverIndex);
+        endSpiffs();
+        return false;
+    }
+    syncIndexMerge(serverIndex, localIndex);
+    syncIndexFree(localIndex);
 
-    // Calculate total size for progress
-    syncProgress.totalBytes = 0;
-    syncProgress.totalFiles = 0;
-    for (JsonObject file : serverFiles)
+    // Plan the sync; only the files that change get their object parsed
+    JsonDocument fileDoc(jsonPsram(jdkFileList));
+    for (uint32_t i = 0; i < serverIndex.count; i++)
     {
-        syncProgress.totalBytes += file["size"].as<uint32_t>();
+        tSyncRec &rec = serverIndex.recs[i];
+        const char *filename = syncIndexName(serverIndex, rec);
+        if ((rec.state == ssCurrent) && !isLocalCopyIntact(filename, rec.size))
+        {
+            rec.state = ssChanged;
+        }
+        Serial.printf("  %s (%lu bytes)%s\n", filename, (unsigned long)rec.size, (rec.state == ssCurrent) ? "" : " *");
+        if (rec.state == ssCurrent)
+        {
+            continue;
+        }
         syncProgress.totalFiles++;
+        if ((rec.state == ssChanged) && syncIndexParseEntry(serverListStr, rec, fileDoc))
+        {
+            syncProgress.totalBytes += syncBytesFor(fileDoc.as<JsonObject>(), manifestFiles[filename]);
+        }
+        else
+        {
+            syncProgress.totalBytes += rec.size;
+        }
     }
 
-    Serial.printf("Sync plan: %d files, %d bytes to download\n",
-                  syncProgress.totalFiles, syncProgress.totalBytes);
+    Serial.printf("Sync plan: %d of %d files, %d bytes to download\n",
+                  syncProgress.totalFiles, serverIndex.count, syncProgress.totalBytes);
 
     bool shouldContinue = true;
     int filesDownloaded = 0;
+    std::vector<String> downloadedNames;
+    std::vector<tDlFile> fullDownloads;
 
-    // Download ALL files from server
-    for (JsonObject serverFile : serverFiles)
+    // Patch changed files chunk-wise where possible, queue the rest for download
+    for (uint32_t i = 0; shouldContinue && (i < serverIndex.count); i++)
     {
-        if (!shouldContinue)
+        const tSyncRec &rec = serverIndex.recs[i];
+        if (rec.state == ssCurrent)
+        {
+            continue;
+        }
+        const char *filename = syncIndexName(serverIndex, rec);
+        if (!syncIndexParseEntry(serverListStr, rec, fileDoc))
+        {
+            Serial.printf("Bad list entry for: %s\n", filename);
+            shouldContinue = false;
             break;
+        }
+        JsonObject serverFile = fileDoc.as<JsonObject>();
 
-        const char* filename = serverFile["name"].as<const char*>();
-
-        size_t bufferSize = min((size_t)10000, (size_t)ESP.getMaxAllocHeap());
-        uint8_t *buffer = new uint8_t[bufferSize];
-        
-        if (buffer)
+        JsonObject localEntry = manifestFiles[filename];
+        if (canPatchFile(serverFile, localEntry))
         {
-            shouldContinue = downloadFileToSpiffs(serverAddress, filename, 
-                                                   syncProgress, bufferSize, buffer);
+            size_t bufferSize = min((size_t)10000, (size_t)ESP.getMaxAllocHeap());
+            uint8_t *buffer = new uint8_t[bufferSize];
+            tPatchResult patched = patchFileInSpiffs(serverAddress, serverFile, localEntry, manifest,
+                                                     syncProgress, bufferSize, buffer);
             delete[] buffer;
-            
-            if (shouldContinue)
+            if (patched != prNotPossible)
             {
-                filesDownloaded++;
-                syncProgress.processedFiles++;
+                shouldContinue = (patched == prDone);
+                if (shouldContinue)
+                {
+                    filesDownloaded++;
+                    syncProgress.processedFiles++;
+                    downloadedNames.push_back(filename);
+                }
+                continue;
             }
         }
-        else
+
+        // the old entry goes first, an interrupted download must not look current
+        if (manifestFiles[filename].is<JsonObject>())
         {
-            Serial.println("Failed to allocate download buffer");
-            shouldContinue = false;
+            manifestFiles.remove(filename);
+            saveManifest(manifest);
         }
+        tDlFile dl;
+        dl.rec = &rec;
+        dl.name = filename;
+        dl.hash = serverFile["hash"].as<String>();
+        dl.size = rec.size;
+        dl.resumable = (manifest["partial"][filename].as<String>() == dl.hash);
+        fullDownloads.push_back(dl);
+    }
+
+    // whole files go through the pipelined downloader
+    if (shouldContinue && !fullDownloads.empty())
+    {
+        size_t before = downloadedNames.size();
+        shouldContinue = downloadFilesPipelined(serverAddress, serverListStr, fullDownloads, manifest, syncProgress, downloadedNames);
+        filesDownloaded += downloadedNames.size() - before;
     }
 
     // Remove local files not on server (if enabled)
@@ -788,43 +2235,63 @@ bool syncFiles(const char *serverAddress, ProgressCallback callback)
     {
         // Get local file list
         String localListStr = getLocalFileList();
-        JsonDocument localDoc;
+        JsonDocument localDoc(jsonPsram(jdkFileList));
         if (!deserializeJson(localDoc, localListStr))
         {
             JsonArray localFiles = localDoc["files"];
-            
-            // Create server filename set
-            std::map<String, bool> serverFileNames;
-            for (JsonObject file : serverFiles)
-            {
-                serverFileNames[file["name"].as<String>()] = true;
-            }
-            
+
             // Remove files not on server
             for (JsonObject localFile : localFiles)
             {
                 String filename = localFile["name"].as<String>();
-                if (serverFileNames.find(filename) == serverFileNames.end() && 
-                    filename != ".server_list.json")
+                if ((syncIndexFind(serverIndex, filename.c_str()) == NULL) &&
+                    !isInternalFile(filename))
                 {
                     Serial.printf("Removing: %s\n", filename.c_str());
-                    deleteFileFromSpiffs(filename.c_str());
+                    if (syncStaging)
+                    {
+                        manifest["drop"].add(filename);
+                    }
+                    else
+                    {
+                        deleteFileFromSpiffs(filename.c_str());
+                    }
+                    manifestFiles.remove(filename);
                 }
             }
         }
     }
+    syncIndexFree(serverIndex);
 
     // Save server list cache after successful sync
     if (shouldContinue)
     {
+        saveManifest(manifest);
         saveServerListCache(serverListStr);
+        if (!syncStaging)
+        {
+            saveAssetsSig();
+        }
     }
 
-    // Load files to PSRAM
-    if (shouldContinue)
+    // Load files to PSRAM, after a boot preload only the fresh downloads;
+    // staged files wait for the switch
+    if (shouldContinue && !syncStaging)
     {
-        Serial.println("Loading files to PSRAM...");
-        loadFilesToPsramInternal();
+        if (psramPreloaded)
+        {
+            Serial.printf("Loading %d updated files to PSRAM...\n", downloadedNames.size());
+            for (const String &name : downloadedNames)
+            {
+                refreshPsramCopy(name, manifest);
+            }
+            psramFollowScope();
+        }
+        else
+        {
+            Serial.println("Loading files to PSRAM...");
+            loadFilesToPsramInternal();
+        }
     }
 
     // End LittleFS after sync
@@ -839,7 +2306,7 @@ bool syncFiles(const char *serverAddress, ProgressCallback callback)
 
     if (shouldContinue)
     {
-        Serial.printf("=== Sync completed: %d files downloaded ===\n", filesDownloaded);
+        Serial.printf("=== Sync completed: %d files %s ===\n", filesDownloaded, syncStaging ? "staged" : "downloaded");
         return true;
     }
     else
@@ -849,6 +2316,142 @@ bool syncFiles(const char *serverAddress, ProgressCallback callback)
     }
 }
 
+bool syncFiles(const char *serverAddress, ProgressCallback callback)
+{
+    if (stageRunning)
+    {
+        Serial.println("ERROR: Background sync running, stop it with syncStageSwitch() first");
+        return false;
+    }
+    return runSync(serverAddress, callback);
+}
+
+//=============================================================================
+// Background Sync
+//=============================================================================
+
+static void stageSyncTask(void *param)
+{
+    int attempt = 0;
+    while (!stageCancel)
+    {
+        bool done = false;
+        stageRescan = false;
+        if ((WiFi.status() == WL_CONNECTED) && airtimeBulkWait(&stageCancel))
+        {
+            syncStaging = true;
+            airtimeBulkBegin();
+            done = runSync(stageServer.c_str(), [](uint32_t, uint32_t, uint8_t) { return !stageCancel; });
+            airtimeBulkEnd();
+            syncStaging = false;
+        }
+        if (done && !stageRescan)
+        {
+            break;
+        }
+        if (done)
+        {
+            continue;
+        }
+        bool paced;
+        uint32_t waitMs = syncBackoffMs(++attempt, paced);
+        for (uint32_t t = 0; !stageCancel && (t < waitMs); t += 100)
+        {
+            delay(100);
+        }
+    }
+    Serial.printf(">>> stageSyncTask: %s\r\n", stageCancel ? "stopped" : "done");
+    stageRunning = false;
+    vTaskDelete(NULL);
+}
+
+void syncSetAssetsSignature(const char *signature)
+{
+    syncAssetsSig = signature ? signature : "";
+}
+
+bool syncAssetsCurrent(void)
+{
+    if (syncAssetsSig.isEmpty())
+    {
+        return false;
+    }
+    tFsHandle fs;
+    if (!fs.ok() || !LittleFS.exists(ASSETS_SIG_FILE) || LittleFS.exists(STAGE_JOURNAL))
+    {
+        return false;
+    }
+    File file = LittleFS.open(ASSETS_SIG_FILE, "r");
+    String stored = file ? file.readString() : String();
+    file.close();
+    bool current = (stored == syncAssetsSig + ";" + syncRoles);
+    Serial.printf(">>> syncAssetsCurrent: %s %s\r\n", syncAssetsSig.c_str(), current ? "matches the last sync" : "is new");
+    return current;
+}
+
+bool syncSetRoles(const char *roles)
+{
+    String wanted = roles ? roles : "";
+    wanted.trim();
+    if (wanted == syncRoles)
+    {
+        return false;
+    }
+    Serial.printf(">>> syncSetRoles: [%s] -> [%s]\r\n", syncRoles.c_str(), wanted.c_str());
+    syncRoles = wanted;
+    stageRescan = true;
+    return true;
+}
+
+void syncStageStart(const char *serverAddress)
+{
+    if (!SYNC_BACKGROUND || stageRunning || (serverAddress == NULL) || (*serverAddress == 0))
+    {
+        return;
+    }
+    stageServer = serverAddress;
+    stageCancel = false;
+    stageRunning = true;
+    if (!taskStart(tkAssetSync, stageSyncTask))
+    {
+        Serial.println("!!! syncStageStart ERROR: task start failed");
+        stageRunning = false;
+    }
+}
+
+bool syncStageSwitch(void)
+{
+    stageCancel = true;
+    uint32_t startMs = millis();
+    while (stageRunning && (millis() - startMs < SYNC_STAGE_STOP_MS))
+    {
+        delay(10);
+    }
+    if (stageRunning)
+    {
+        Serial.println("*** syncStageSwitch WARNING! the background sync did not stop, no switch");
+        return false;
+    }
+    if (!initSpiffs())
+    {
+        return false;
+    }
+    std::vector<String> switched, dropped;
+    lockSpiffs();
+    bool ok = stageCommit(switched, dropped);
+    if (ok)
+    {
+        stagePsramFollow(switched, dropped);
+    }
+    unlockSpiffs();
+    endSpiffs();
+    if (ok)
+    {
+        Serial.printf(">>> syncStageSwitch: %d files switched, %d removed\r\n", switched.size(), dropped.size());
+    }
+    return ok;
+}
+
 //=============================================================================
 // Debug Utilities
 //=============================================================================
@@ -0,0 +1,416 @@
+#include "syncIndex.h"
+
+#include <algorithm>
+
+#include "jsonAlloc.h"
+
+// Minimal walker over the list text: finds the "files" array and the extent
+// of every element without building anything, ArduinoJson parses the
+// elements themselves
+struct tListScan
+{
+    const char *text;
+    size_t len;
+    size_t pos;
+};
+
+static void skipWs(tListScan &s)
+{
+    while ((s.pos < s.len) && ((s.text[s.pos] == ' ') || (s.text[s.pos] == '\t') ||
+                               (s.text[s.pos] == '\r') || (s.text[s.pos] == '\n')))
+    {
+        s.pos++;
+    }
+}
+
+static bool expect(tListScan &s, char c)
+{
+    skipWs(s);
+    if ((s.pos < s.len) && (s.text[s.pos] == c))
+    {
+        s.pos++;
+        return true;
+    }
+    return false;
+}
+
+// At the opening quote, ends after the closing one
+static bool skipString(tListScan &s)
+{
+    s.pos++;
+    while (s.pos < s.len)
+    {
+        char c = s.text[s.pos++];
+        if (c == '\\')
+        {
+            s.pos++;
+        }
+        else if (c == '"')
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool skipValue(tListScan &s)
+{
+    skipWs(s);
+    if (s.pos >= s.len)
+    {
+        return false;
+    }
+    char c = s.text[s.pos];
+    if (c == '"')
+    {
+        return skipString(s);
+    }
+    if ((c == '{') || (c == '['))
+    {
+        int depth = 0;
+        while (s.pos < s.len)
+        {
+            c = s.text[s.pos];
+            if (c == '"')
+            {
+                if (!skipString(s))
+                {
+                    return false;
+                }
+                continue;
+            }
+            s.pos++;
+            if ((c == '{') || (c == '['))
+            {
+                depth++;
+            }
+            else if (((c == '}') || (c == ']')) && (--depth == 0))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+    // number, true, false, null
+    size_t start = s.pos;
+    while ((s.pos < s.len) && (strchr(",}] \t\r\n", s.text[s.pos]) == NULL))
+    {
+        s.pos++;
+    }
+    return s.pos > start;
+}
+
+// Key at the current position, only compared against plain ASCII names
+static bool readKey(tListScan &s, const char *&key, size_t &keyLen)
+{
+    skipWs(s);
+    if ((s.pos >= s.len) || (s.text[s.pos] != '"'))
+    {
+        return false;
+    }
+    size_t start = s.pos + 1;
+    if (!skipString(s) || !expect(s, ':'))
+    {
+        return false;
+    }
+    key = &s.text[start];
+    keyLen = 0;
+    while ((start + keyLen < s.len) && (s.text[start + keyLen] != '"'))
+    {
+        keyLen++;
+    }
+    return true;
+}
+
+static inline bool keyIs(const char *key, size_t keyLen, const char *name)
+{
+    return (strlen(name) == keyLen) && (strncmp(key, name, keyLen) == 0);
+}
+
+static bool parseHash(const char *text, uint32_t &hash)
+{
+    if ((text == NULL) || (*text == 0))
+    {
+        return false;
+    }
+    char *end;
+    hash = strtoul(text, &end, 16);
+    return *end == 0;
+}
+
+uint32_t syncNameHash(const char *name)
+{
+    uint32_t hash = 2166136261UL;
+    while (*name)
+    {
+        hash ^= (uint8_t)*name++;
+        hash *= 16777619UL;
+    }
+    return hash;
+}
+
+static void *indexAlloc(size_t size)
+{
+    void *ptr = ps_malloc(size);
+    return ptr ? ptr : malloc(size);
+}
+
+static bool indexReserve(tSyncIndex &index, uint32_t count, uint32_t namesSize)
+{
+    syncIndexFree(index);
+    if ((count > SYNC_INDEX_MAX_FILES) || (namesSize > SYNC_INDEX_NAMES))
+    {
+        Serial.printf("!!! syncIndex ERROR: %lu files / %lu name bytes, over the %d / %d budget\r\n",
+                      (unsigned long)count, (unsigned long)namesSize, SYNC_INDEX_MAX_FILES, SYNC_INDEX_NAMES);
+        return false;
+    }
+    index.recs = (tSyncRec *)indexAlloc(max(count, (uint32_t)1) * sizeof(tSyncRec));
+    index.names = (char *)indexAlloc(max(namesSize, (uint32_t)1));
+    index.namesSize = namesSize;
+    if ((index.recs == NULL) || (index.names == NULL))
+    {
+        Serial.println("!!! syncIndex ERROR: no memory for the index");
+        syncIndexFree(index);
+        return false;
+    }
+    return true;
+}
+
+static bool addRec(tSyncIndex &index, const char *name, uint32_t size, const char *hash, tSyncRec &rec)
+{
+    size_t nameLen = strlen(name) + 1;
+    if (index.namesUsed + nameLen > index.namesSize)
+    {
+        Serial.println("!!! syncIndex ERROR: names pool full");
+        return false;
+    }
+    memcpy(&index.names[index.namesUsed], name, nameLen);
+    rec.nameHash = syncNameHash(name);
+    rec.size = size;
+    rec.hashValid = parseHash(hash, rec.hash);
+    rec.nameOff = index.namesUsed;
+    rec.state = ssNew;
+    index.namesUsed += nameLen;
+    index.recs[index.count++] = rec;
+    return true;
+}
+
+static void sortIndex(tSyncIndex &index)
+{
+    std::sort(index.recs, index.recs + index.count,
+              [](const tSyncRec &a, const tSyncRec &b) { return a.nameHash < b.nameHash; });
+}
+
+// Calls onElem(offset, length) for every element of "files" and reads
+// chunk_size on the way
+template <typename F>
+static bool walkList(const String &listText, uint32_t &chunkSize, F onElem)
+{
+    tListScan s = {listText.c_str(), listText.length(), 0};
+    chunkSize = 0;
+    if (!expect(s, '{'))
+    {
+        return false;
+    }
+    if (expect(s, '}'))
+    {
+        return true;
+    }
+    do
+    {
+        const char *key;
+        size_t keyLen;
+        if (!readKey(s, key, keyLen))
+        {
+            return false;
+        }
+        if (keyIs(key, keyLen, "files"))
+        {
+            if (!expect(s, '['))
+            {
+                return false;
+            }
+            if (expect(s, ']'))
+            {
+                continue;
+            }
+            do
+            {
+                skipWs(s);
+                size_t start = s.pos;
+                if (!skipValue(s) || !onElem(start, s.pos - start))
+                {
+                    return false;
+                }
+            } while (expect(s, ','));
+            if (!expect(s, ']'))
+            {
+                return false;
+            }
+        }
+        else if (keyIs(key, keyLen, "chunk_size"))
+        {
+            skipWs(s);
+            chunkSize = strtoul(&s.text[s.pos], NULL, 10);
+            if (!skipValue(s))
+            {
+                return false;
+            }
+        }
+        else if (!skipValue(s))
+        {
+            return false;
+        }
+    } while (expect(s, ','));
+    return expect(s, '}');
+}
+
+bool syncIndexServer(tSyncIndex &index, const String &listText)
+{
+    uint32_t count = 0;
+    uint32_t chunkSize;
+    syncIndexFree(index);
+    if (!walkList(listText, chunkSize, [&](size_t, size_t) { count++; return true; }))
+    {
+        Serial.println("!!! syncIndexServer ERROR: malformed file list");
+        return false;
+    }
+    // names are shorter than the objects they come from
+    if (!indexReserve(index, count, min((uint32_t)listText.length(), (uint32_t)SYNC_INDEX_NAMES)))
+    {
+        return false;
+    }
+    index.chunkSize = chunkSize;
+
+    JsonDocument filter;
+    filter["name"] = true;
+    filter["size"] = true;
+    filter["hash"] = true;
+    filter["tier"] = true;
+    tJsonArenaAllocator arena(jdkFileList, SYNC_INDEX_ELEM_ARENA);
+    JsonDocument elem(&arena);
+    const char *text = listText.c_str();
+    bool ok = walkList(listText, chunkSize, [&](size_t off, size_t len) {
+        arena.reset();
+        if (deserializeJson(elem, text + off, len, DeserializationOption::Filter(filter)))
+        {
+            return false;
+        }
+        const char *name = elem["name"] | "";
+        if (*name == 0)
+        {
+            return true;    // nothing to fetch under
+        }
+        tSyncRec rec;
+        rec.elemOff = off;
+        rec.elemLen = len;
+        const char *tier = elem["tier"] | "";
+        rec.tier = !strcmp(tier, "stream") ? atStream : !strcmp(tier, "psram") ? atPsram : atAuto;
+        return addRec(index, name, elem["size"] | 0UL, elem["hash"] | "", rec);
+    });
+    if (!ok)
+    {
+        Serial.println("!!! syncIndexServer ERROR: bad file entry");
+        syncIndexFree(index);
+        return false;
+    }
+    sortIndex(index);
+    return true;
+}
+
+bool syncIndexManifest(tSyncIndex &index, JsonObject manifestFiles)
+{
+    uint32_t count = 0;
+    uint32_t namesSize = 0;
+    for (JsonPair kv : manifestFiles)
+    {
+        count++;
+        namesSize += strlen(kv.key().c_str()) + 1;
+    }
+    if (!indexReserve(index, count, namesSize))
+    {
+        return false;
+    }
+    for (JsonPair kv : manifestFiles)
+    {
+        JsonObject entry = kv.value();
+        tSyncRec rec;
+        rec.elemOff = 0;
+        rec.elemLen = 0;
+        rec.tier = atAuto;
+        if (!addRec(index, kv.key().c_str(), entry["size"] | 0UL, entry["hash"] | "", rec))
+        {
+            syncIndexFree(index);
+            return false;
+        }
+    }
+    sortIndex(index);
+    return true;
+}
+
+void syncIndexFree(tSyncIndex &index)
+{
+    free(index.recs);
+    free(index.names);
+    index.recs = NULL;
+    index.names = NULL;
+    index.count = 0;
+    index.namesSize = 0;
+    index.namesUsed = 0;
+}
+
+const char *syncIndexName(const tSyncIndex &index, const tSyncRec &rec)
+{
+    return &index.names[rec.nameOff];
+}
+
+const tSyncRec *syncIndexFind(const tSyncIndex &index, const char *name)
+{
+    uint32_t hash = syncNameHash(name);
+    const tSyncRec *begin = index.recs;
+    const tSyncRec *end = begin + index.count;
+    const tSyncRec *it = std::lower_bound(begin, end, hash,
+                                          [](const tSyncRec &r, uint32_t h) { return r.nameHash < h; });
+    for (; (it != end) && (it->nameHash == hash); it++)
+    {
+        if (strcmp(syncIndexName(index, *it), name) == 0)
+        {
+            return it;
+        }
+    }
+    return NULL;
+}
+
+void syncIndexMerge(tSyncIndex &server, const tSyncIndex &local)
+{
+    uint32_t j = 0;
+    for (uint32_t i = 0; i < server.count; i++)
+    {
+        tSyncRec &s = server.recs[i];
+        while ((j < local.count) && (local.recs[j].nameHash < s.nameHash))
+        {
+            j++;
+        }
+        s.state = ssNew;
+        // names that share a hash sit next to each other
+        for (uint32_t k = j; (k < local.count) && (local.recs[k].nameHash == s.nameHash); k++)
+        {
+            const tSyncRec &l = local.recs[k];
+            if (strcmp(syncIndexName(server, s), syncIndexName(local, l)) == 0)
+            {
+                bool same = s.hashValid && l.hashValid && (s.hash == l.hash) && (s.size == l.size);
+                s.state = same ? ssCurrent : ssChanged;
+                break;
+            }
+        }
+    }
+}
+
+bool syncIndexParseEntry(const String &listText, const tSyncRec &rec, JsonDocument &doc)
+{
+    if (rec.elemOff + rec.elemLen > listText.length())
+    {
+        return false;
+    }
+    return !deserializeJson(doc, listText.c_str() + rec.elemOff, rec.elemLen);
+}
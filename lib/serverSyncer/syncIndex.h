@@ -0,0 +1,70 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// Flat index of the file server's /list. The list text is walked once and
+// each file object is parsed on its own (name, size and hash only, in a
+// small arena), so the RAM stays at one record per file plus the names pool
+// however long the list is. Records are sorted by name hash, the manifest
+// of the local copies is indexed the same way and the diff is a single
+// merge over both. A file's full object (chunk hashes) is parsed again from
+// the list text only for the files that change.
+
+#define SYNC_INDEX_MAX_FILES    4096
+#define SYNC_INDEX_NAMES        65536   // names pool, NUL separated
+#define SYNC_INDEX_ELEM_ARENA   1024    // one file object without its chunks
+
+enum tSyncState
+{
+    ssNew,          // not in the manifest
+    ssChanged,      // size or hash differ
+    ssCurrent       // as listed, the caller still checks the file itself
+};
+
+// "tier" of a list entry, where the device keeps the file (serverSync.h)
+enum tAssetTier
+{
+    atAuto,         // none named: PSRAM while it has room, else streamed
+    atPsram,        // "psram": always copied
+    atStream        // "stream": read from LittleFS, never copied
+};
+
+struct tSyncRec
+{
+    uint32_t nameHash;      // FNV-1a of the name as listed
+    uint32_t size;
+    uint32_t hash;          // whole-file hash, hex text in the list
+    uint32_t nameOff;       // into the names pool
+    uint32_t elemOff;       // the file's object in the list text, server index only
+    uint32_t elemLen;
+    uint8_t  state;         // tSyncState, from syncIndexMerge()
+    bool     hashValid;     // an interrupted patch leaves an empty hash
+    uint8_t  tier;          // tAssetTier, server index only
+};
+
+struct tSyncIndex
+{
+    tSyncRec *recs = NULL;
+    uint32_t count = 0;
+    char *names = NULL;
+    uint32_t namesSize = 0;
+    uint32_t namesUsed = 0;
+    uint32_t chunkSize = 0; // server list, 0 without chunk hashes
+};
+
+uint32_t syncNameHash(const char *name);
+
+// false for a malformed list or one over the budget
+bool syncIndexServer(tSyncIndex &index, const String &listText);
+bool syncIndexManifest(tSyncIndex &index, JsonObject manifestFiles);
+void syncIndexFree(tSyncIndex &index);
+
+const char *syncIndexName(const tSyncIndex &index, const tSyncRec &rec);
+const tSyncRec *syncIndexFind(const tSyncIndex &index, const char *name);
+
+// Sets the state of every server record against the local index
+void syncIndexMerge(tSyncIndex &server, const tSyncIndex &local);
+
+// The record's whole file object from the list text, chunks included
+bool syncIndexParseEntry(const String &listText, const tSyncRec &rec, JsonDocument &doc);
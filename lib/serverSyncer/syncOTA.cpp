@@ -1,12 +1,26 @@
 #include "serverSync.h"
 #include <WiFi.h>
 #include <HTTPClient.h>
-#include <Update.h>
+#include <Preferences.h>
 #include <ArduinoJson.h>
 #include <MD5Builder.h>
 #include <esp_partition.h>
 #include <esp_ota_ops.h>
+#include "fsMount.h"
 #include "tft_utils.h"
+#include "bootProfile.h"
+#include "otaVerify.h"
+#include "otaDecode.h"
+#include "syncAdmission.h"
+#include "pmLocks.h"
+#include "httpPool.h"
+#include "memMonitor.h"
+#include "taskRegistry.h"
+#include "espAirtime.h"
+#include <esp_timer.h>
+#include <esp_wifi.h>
+#include <esp_heap_caps.h>
+#include <WiFiUdp.h>
 
 
 // WiFi settings
@@ -21,14 +35,46 @@
 //unsigned long lastCheck = 0;
 
 extern void otaProgressCallback(int progress);
+static bool multicastOTAUpdate(const char *otaServerURL, JsonObject mcast, int firmwareSize, const String &md5);
+// ESP.getSketchMD5() reads the whole app partition, its result is kept in
+// flash next to the ELF SHA-256 of the build it belongs to
 String getCurrentFirmwareMD5(void)
 {
-    // Use built-in ESP32 function to get current sketch MD5
-    String md5 = ESP.getSketchMD5();
+    static String md5;
+    if (!md5.isEmpty())
+    {
+        return md5;
+    }
+    char elfSha[65] = {0};
+    esp_ota_get_app_elf_sha256(elfSha, sizeof(elfSha));
+    Preferences prefs;
+    prefs.begin("ota_md5", false);
+    if (prefs.getString("elf", "") == elfSha)
+    {
+        md5 = prefs.getString("md5", "");
+    }
+    if (md5.isEmpty())
+    {
+        // Use built-in ESP32 function to get current sketch MD5
+        md5 = ESP.getSketchMD5();
+        prefs.putString("elf", elfSha);
+        prefs.putString("md5", md5);
+    }
+    prefs.end();
     Serial.printf("Current firmware MD5: %s\n", md5.c_str());
     return md5;
 }
 
+// Same rule as syncOTA(): a newer server version, or the same one built differently
+bool otaFirmwareCurrent(int currentVersion, int serverVersion, const String &serverMD5)
+{
+    if (serverVersion > currentVersion)
+    {
+        return false;
+    }
+    return (serverVersion < currentVersion) || serverMD5.equalsIgnoreCase(getCurrentFirmwareMD5());
+}
+
 bool syncOTA(const char *otaServerURL, int currentVersion)
 {
     bool res;
@@ -37,11 +83,16 @@ bool syncOTA(const char *otaServerURL, int currentVersion)
         Serial.println("!!! syncOTA ERROR: WiFi not connected");
         return false;
     }
+    tPmHold hold(plHttp);
 
-    HTTPClient http;
-    http.begin(String(otaServerURL) + "/version");
+    String versionUrl = String(otaServerURL) + "/version";
+    tHttpLease lease(versionUrl);
+    HTTPClient &http = lease.http();
+    lease.begin(versionUrl);
 
+    int64_t startUs = esp_timer_get_time();
     int httpCode = http.GET();
+    bootProfHttp(startUs);
     if (httpCode == HTTP_CODE_OK)
     {
         String payload = http.getString();
@@ -62,6 +113,7 @@ bool syncOTA(const char *otaServerURL, int currentVersion)
         int serverVersion = doc["version"].as<int>();
         // Get server MD5 checksum
         String serverMD5 = doc["md5"].as<String>();
+        String serverSHA256 = doc["sha256"] | "";
         int firmwareSize = doc["size"];
         String filename = doc["filename"];
         String currentFirmwareMD5 = getCurrentFirmwareMD5();
@@ -94,8 +146,23 @@ bool syncOTA(const char *otaServerURL, int currentVersion)
         
         if (needsUpdate)
         {
-            Serial.println("Starting OTA update...");
-            res = performOTAUpdate(otaServerURL, firmwareSize);            
+            // staged in the background already, one reboot and it runs
+            http.end();
+            if (otaStageApply(serverMD5))
+            {
+                return true;
+            }
+            // the multicast carousel first, the HTTP download covers what it could not
+            res = false;
+            if (doc["mcast"].is<JsonObject>())
+            {
+                res = multicastOTAUpdate(otaServerURL, doc["mcast"], firmwareSize, serverMD5);
+            }
+            if (!res)
+            {
+                Serial.println("Starting OTA update...");
+                res = performOTAUpdate(otaServerURL, firmwareSize, serverMD5, serverSHA256);
+            }
         }
         else
         {
@@ -115,114 +182,908 @@ bool syncOTA(const char *otaServerURL, int currentVersion)
     return res;
 }
 
-bool performOTAUpdate(const char *otaServerURL, int firmwareSize)
+// Resume state of an interrupted update, kept across reboots: the image MD5,
+// the target partition and how far it is written
+#define OTA_RESUME_PREFS        "ota_resume"
+#define OTA_RESUME_SAVE_BYTES   65536       // progress is persisted every this many bytes
+#define OTA_BUF_SIZE            4096
+#define OTA_STALL_MS            10000
+
+static uint32_t loadResumeOffset(Preferences &prefs, const String &md5, const esp_partition_t *target, int firmwareSize)
+{
+    if (md5.isEmpty() || (prefs.getString("md5", "") != md5) || (prefs.getString("part", "") != target->label))
+    {
+        return 0;
+    }
+    // resumed on a sector boundary, the sector being written may be incomplete
+    uint32_t offset = prefs.getUInt("offset", 0) & ~(SPI_FLASH_SEC_SIZE - 1);
+    return (offset < (uint32_t)firmwareSize) ? offset : 0;
+}
+
+static bool commitOTAImage(const esp_partition_t *target, int firmwareSize, const String &md5);
+static bool streamEncodedImage(HTTPClient &http, tOtaEnc enc, const esp_partition_t *target, int firmwareSize,
+                               const String &md5, const String &sha256);
+
+// An encoded image that did not make it is not asked for again until reboot
+static bool encodedFailed = false;
+
+static String partitionMD5(const esp_partition_t *part, uint32_t size)
+{
+    MD5Builder md5;
+    md5.begin();
+    uint8_t buf[1024];
+    for (uint32_t pos = 0; pos < size; pos += sizeof(buf))
+    {
+        uint32_t len = min((uint32_t)sizeof(buf), size - pos);
+        if (esp_partition_read(part, pos, buf, len) != ESP_OK)
+        {
+            return "";
+        }
+        md5.add(buf, len);
+    }
+    md5.calculate();
+    return md5.toString();
+}
+
+// The part of a resumed image that is already on flash, for the stream hash
+static bool hashWritten(tOtaVerifier &verifier, const esp_partition_t *part, uint32_t size)
 {
-    bool res = false;
+    uint8_t buf[1024];
+    for (uint32_t pos = 0; pos < size; pos += sizeof(buf))
+    {
+        uint32_t len = min((uint32_t)sizeof(buf), size - pos);
+        if (esp_partition_read(part, pos, buf, len) != ESP_OK)
+        {
+            return false;
+        }
+        verifier.add(buf, len, false);
+    }
+    return true;
+}
+
+// Writes the image straight into the next OTA partition, erasing sector by sector
+// ahead of the data, so a retry continues with a Range request where the last
+// attempt stopped; the partition is only made bootable after the digest matches
+bool performOTAUpdate(const char *otaServerURL, int firmwareSize, const String &md5, const String &sha256)
+{
+    tPmHold hold(plHttp);
+    const esp_partition_t *target = esp_ota_get_next_update_partition(NULL);
+    if ((target == NULL) || (firmwareSize <= 0) || ((uint32_t)firmwareSize > target->size))
+    {
+        Serial.println("!!! performOTAUpdate ERROR: Not enough space for update");
+        return false;
+    }
+
+    otaStageForget();
+    Preferences prefs;
+    prefs.begin(OTA_RESUME_PREFS, false);
+    uint32_t offset = loadResumeOffset(prefs, md5, target, firmwareSize);
+
+    // a fresh start takes the image deflated or as a patch against the running
+    // build when the server has one, a resume continues the raw one
     HTTPClient http;
-    http.begin(String(otaServerURL) + "/update");
+    if ((offset == 0) && !encodedFailed)
+    {
+        http.begin(String(otaServerURL) + "/update?enc=" OTA_ENC_ACCEPT "&from=" + getCurrentFirmwareMD5());
+    }
+    else
+    {
+        http.begin(String(otaServerURL) + "/update");
+    }
+    if (offset > 0)
+    {
+        http.addHeader("Range", "bytes=" + String(offset) + "-");
+    }
+    const char *otaHeaders[] = {"X-OTA-Enc", SYNC_RETRY_HEADER};
+    http.collectHeaders(otaHeaders, 2);
 
     int httpCode = http.GET();
-    if (httpCode != HTTP_CODE_OK)
+    if (httpCode == HTTP_CODE_OK)
+    {
+        offset = 0;
+    }
+    else if ((httpCode != HTTP_CODE_PARTIAL_CONTENT) || (offset == 0))
     {
         Serial.printf("!!! performOTAUpdate ERROR: Failed to start download: %d\n", httpCode);
+        syncNoteAdmission(http, httpCode);
         http.end();
+        prefs.end();
         return false;
     }
 
+    tOtaEnc enc = otaEncFromName(http.header("X-OTA-Enc"));
+    if ((httpCode == HTTP_CODE_OK) && (enc != oeRaw))
+    {
+        // nothing of this is resumable, a stale record must not point into it
+        prefs.clear();
+        prefs.end();
+        bool res = streamEncodedImage(http, enc, target, firmwareSize, md5, sha256);
+        http.end();
+        return res;
+    }
+
     int contentLength = http.getSize();
-    if (contentLength != firmwareSize)
+    if (offset + contentLength != (uint32_t)firmwareSize)
     {
         Serial.println("!!! performOTAUpdate ERROR: Content length mismatch");
         http.end();
+        prefs.end();
         return false;
     }
 
-    // Start OTA update
-    if (!Update.begin(contentLength))
+    prefs.putString("md5", md5);
+    prefs.putString("part", target->label);
+    prefs.putUInt("offset", offset);
+
+    if (offset > 0)
     {
-        Serial.println("!!! performOTAUpdate ERROR: Not enough space for update");
+        Serial.printf("Resuming OTA update at %lu of %d bytes\n", offset, firmwareSize);
+    }
+    else
+    {
+        Serial.println("Starting OTA update...");
+        Serial.printf("Firmware size: %d bytes\n", contentLength);
+    }
+
+    tOtaVerifier verifier;
+    verifier.begin(firmwareSize);
+    if (!sha256.isEmpty() && !hashWritten(verifier, target, offset))
+    {
+        Serial.println("!!! performOTAUpdate ERROR: read back of the resumed part failed");
         http.end();
+        prefs.end();
         return false;
     }
 
-    Serial.println("Starting OTA update...");
-    Serial.printf("Firmware size: %d bytes\n", contentLength);
-
     WiFiClient *client = http.getStreamPtr();
-    int written = 0;
+    uint32_t written = offset;
+    uint32_t erasedTo = offset;
+    uint32_t savedAt = offset;
+    uint32_t lastDataMs = millis();
     int progress = 0;
     int lastProgress = -1;
+    bool res = true;
 
-    uint8_t buffer[128];
+    uint8_t *buffer = (uint8_t *)malloc(OTA_BUF_SIZE);
+    if (buffer == NULL)
+    {
+        Serial.println("!!! performOTAUpdate ERROR: out of memory");
+        res = false;
+    }
 
-    while (http.connected() && (written < contentLength))
+    while (res && (written < (uint32_t)firmwareSize))
     {
         size_t available = client->available();
-        if (available)
+        if (!available)
         {
-            int readBytes = client->readBytes(buffer, min(available, sizeof(buffer)));
+            if (!http.connected() || (millis() - lastDataMs > OTA_STALL_MS))
+            {
+                break;
+            }
+            delay(1);
+            continue;
+        }
+        int readBytes = client->readBytes(buffer, min(available, (size_t)OTA_BUF_SIZE));
+        if (readBytes <= 0)
+        {
+            continue;
+        }
+        lastDataMs = millis();
 
-            if (readBytes > 0)
+        if (written + readBytes > erasedTo)
+        {
+            uint32_t eraseEnd = (written + readBytes + SPI_FLASH_SEC_SIZE - 1) & ~(SPI_FLASH_SEC_SIZE - 1);
+            if (esp_partition_erase_range(target, erasedTo, eraseEnd - erasedTo) != ESP_OK)
             {
-                if (Update.write(buffer, readBytes) != readBytes)
-                {
-                    Serial.println("!!! performOTAUpdate ERROR: write failed");
-                    res = false;
-                    break;
-                }
-                written += readBytes;
-
-                // Calculate and display progress
-                progress = (written * 100) / contentLength;
-                if (progress != lastProgress && progress % 5 == 0)
-                {
-                    otaProgressCallback(progress);
-                    lastProgress = progress;
-                }
+                Serial.println("!!! performOTAUpdate ERROR: erase failed");
+                res = false;
+                break;
             }
+            erasedTo = eraseEnd;
+        }
+        if (esp_partition_write(target, written, buffer, readBytes) != ESP_OK)
+        {
+            Serial.println("!!! performOTAUpdate ERROR: write failed");
+            res = false;
+            break;
+        }
+        written += readBytes;
+        verifier.add(buffer, readBytes);
+        verifier.printProgress("performOTAUpdate");
+
+        if (written - savedAt >= OTA_RESUME_SAVE_BYTES)
+        {
+            prefs.putUInt("offset", written);
+            savedAt = written;
+        }
+
+        // Calculate and display progress
+        progress = ((uint64_t)written * 100) / firmwareSize;
+        if (progress != lastProgress && progress % 5 == 0)
+        {
+            otaProgressCallback(progress);
+            lastProgress = progress;
         }
-        delay(1);
     }
+    free(buffer);
+    http.end();
 
-    if (written == contentLength)
+    if (res && (written == (uint32_t)firmwareSize))
     {
         Serial.println(">>> performOTAUpdate: Update completed successfully");
         otaProgressCallback(100);
-        res = true;
     }
     else
     {
-        Serial.printf("!!! performOTAUpdate ERROR:  Update failed. Written: %d, Expected: %d\n", written, contentLength);
-        res = false;
+        // the sectors already on flash are kept for the next attempt
+        prefs.putUInt("offset", res ? written : 0);
+        Serial.printf("!!! performOTAUpdate ERROR:  Update failed. Written: %lu, Expected: %d\n", written, firmwareSize);
+        prefs.end();
+        return false;
     }
 
-    if (Update.end())
+    prefs.clear();
+    prefs.end();
+    if (!sha256.isEmpty())
     {
-        if (Update.isFinished())
+        // hashed on the way in, the MD5 read back of the partition is not needed
+        if (!verifier.finish(sha256))
         {
-            Serial.println(">>> performOTAUpdate: Update successfully finished. Rebooting...");
-            tftPrintText("OTA DONE");
-            delay(2000);
-            ESP.restart();
+            tftPrintText("OTA ERROR[1]");
+            delay(5000);
+            return false;
         }
-        else
+        return commitOTAImage(target, firmwareSize, "");
+    }
+    return commitOTAImage(target, firmwareSize, md5);
+}
+
+// Erase-ahead writer of the decoded image, bounced through internal RAM as the
+// inflate window is in PSRAM
+struct tOtaFlashSink
+{
+    const esp_partition_t *target;
+    uint32_t     written;
+    uint32_t     erasedTo;
+    tOtaVerifier *verifier;
+    uint8_t     *bounce;
+};
+
+static bool flashSinkWrite(void *ctx, const uint8_t *data, size_t len)
+{
+    tOtaFlashSink &sink = *(tOtaFlashSink *)ctx;
+    if (sink.written + len > sink.erasedTo)
+    {
+        uint32_t eraseEnd = (sink.written + len + SPI_FLASH_SEC_SIZE - 1) & ~(SPI_FLASH_SEC_SIZE - 1);
+        if ((eraseEnd > sink.target->size) ||
+            (esp_partition_erase_range(sink.target, sink.erasedTo, eraseEnd - sink.erasedTo) != ESP_OK))
+        {
+            Serial.println("!!! performOTAUpdate ERROR: erase failed");
+            return false;
+        }
+        sink.erasedTo = eraseEnd;
+    }
+    for (size_t pos = 0; pos < len; pos += OTA_BUF_SIZE)
+    {
+        size_t n = min((size_t)OTA_BUF_SIZE, len - pos);
+        memcpy(sink.bounce, data + pos, n);
+        if (esp_partition_write(sink.target, sink.written, sink.bounce, n) != ESP_OK)
+        {
+            Serial.println("!!! performOTAUpdate ERROR: write failed");
+            return false;
+        }
+        sink.written += n;
+    }
+    sink.verifier->add(data, len);
+    return true;
+}
+
+// Inflates, and for a delta patches against the running partition, the image
+// onto the target as it arrives; a failed attempt leaves the next one to the raw image
+static bool streamEncodedImage(HTTPClient &http, tOtaEnc enc, const esp_partition_t *target, int firmwareSize,
+                               const String &md5, const String &sha256)
+{
+    int contentLength = http.getSize();
+    Serial.printf(">>> performOTAUpdate: %s image, %d bytes for %d\r\n", otaEncName(enc), contentLength, firmwareSize);
+    tOtaVerifier verifier;
+    verifier.begin(firmwareSize);
+    tOtaFlashSink sink = {target, 0, 0, &verifier, NULL};
+    tOtaDecoder decoder;
+    sink.bounce = (uint8_t *)memTagAlloc(mtSync, OTA_BUF_SIZE, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    uint8_t *buffer = (uint8_t *)malloc(OTA_BUF_SIZE);
+    bool res = (contentLength > 0) && (sink.bounce != NULL) && (buffer != NULL) &&
+               decoder.begin(enc, firmwareSize, esp_ota_get_running_partition(), ESP.getSketchSize(), flashSinkWrite, &sink);
+    if (!res)
+    {
+        Serial.println("!!! performOTAUpdate ERROR: cannot start the decoder");
+    }
+
+    WiFiClient *client = http.getStreamPtr();
+    uint32_t received = 0;
+    uint32_t lastDataMs = millis();
+    int lastProgress = -1;
+    while (res && (received < (uint32_t)contentLength))
+    {
+        size_t available = client->available();
+        if (!available)
+        {
+            if (!http.connected() || (millis() - lastDataMs > OTA_STALL_MS))
+            {
+                Serial.printf("!!! performOTAUpdate ERROR: stream ended at %lu of %d bytes\r\n", (unsigned long)received, contentLength);
+                res = false;
+                break;
+            }
+            delay(1);
+            continue;
+        }
+        int readBytes = client->readBytes(buffer, min(available, (size_t)min(OTA_BUF_SIZE, contentLength - (int)received)));
+        if (readBytes <= 0)
+        {
+            continue;
+        }
+        lastDataMs = millis();
+        received += readBytes;
+        res = decoder.feed(buffer, readBytes, received == (uint32_t)contentLength);
+        verifier.printProgress("performOTAUpdate");
+
+        int progress = ((uint64_t)received * 100) / contentLength;
+        if ((progress != lastProgress) && (progress % 5 == 0))
+        {
+            otaProgressCallback(progress);
+            lastProgress = progress;
+        }
+    }
+    free(buffer);
+    memTagFree(sink.bounce);
+
+    if (!res || !decoder.done())
+    {
+        encodedFailed = true;
+        Serial.printf("!!! performOTAUpdate ERROR: %s image failed at %lu of %d bytes, the raw one follows\r\n",
+                      otaEncName(enc), (unsigned long)decoder.produced(), firmwareSize);
+        return false;
+    }
+    Serial.printf(">>> performOTAUpdate: %s image decoded, %lu bytes took %d\r\n", otaEncName(enc),
+                  (unsigned long)sink.written, contentLength);
+    otaProgressCallback(100);
+    if (!sha256.isEmpty())
+    {
+        if (!verifier.finish(sha256))
         {
-            Serial.println("!!! performOTAUpdate ERROR: Update failed to finish");
+            encodedFailed = true;
             tftPrintText("OTA ERROR[1]");
             delay(5000);
-            res = false;
+            return false;
         }
+        return commitOTAImage(target, firmwareSize, "");
     }
-    else
+    if (!commitOTAImage(target, firmwareSize, md5))
+    {
+        encodedFailed = true;
+        return false;
+    }
+    return true;
+}
+
+// Checks the written image against the server MD5, when given, and boots into it
+static bool commitOTAImage(const esp_partition_t *target, int firmwareSize, const String &md5)
+{
+    String flashMD5 = md5.isEmpty() ? String() : partitionMD5(target, firmwareSize);
+    if (!md5.isEmpty() && !flashMD5.equalsIgnoreCase(md5))
+    {
+        Serial.printf("!!! performOTAUpdate ERROR: MD5 mismatch (%s), the update starts over\n", flashMD5.c_str());
+        tftPrintText("OTA ERROR[1]");
+        delay(5000);
+        return false;
+    }
+
+    esp_err_t err = esp_ota_set_boot_partition(target);
+    if (err != ESP_OK)
     {
-        Serial.printf("!!! performOTAUpdate ERROR: %d\n", Update.getError());
+        Serial.printf("!!! performOTAUpdate ERROR: %d\n", err);
         tftPrintText("OTA ERROR[2]");
         delay(5000);
-        res = false;
+        return false;
+    }
+    Serial.println(">>> performOTAUpdate: Update successfully finished. Rebooting...");
+    tftPrintText("OTA DONE");
+    fsUnmount();
+    delay(2000);
+    ESP.restart();
+    return true;
+}
+
+//=============================================================================
+// Multicast OTA: the server sends the firmware round as numbered blocks on one
+// multicast group, each device fills a PSRAM copy and a bitmap from the shared
+// stream and NACKs only the blocks it is missing, so the AP carries every block
+// about once whatever the number of devices
+//=============================================================================
+
+#define OTA_MCAST_BLOCK_MAGIC   0x31424F5A  // "ZOB1"
+#define OTA_MCAST_NACK_MAGIC    0x314E4F5A  // "ZON1"
+#define OTA_MCAST_HDR_SIZE      16          // magic, image id, image size, block index
+#define OTA_MCAST_MAX_BLOCK     1400
+#define OTA_MCAST_NACK_MS       1000
+#define OTA_MCAST_STALL_MS      15000       // no block for this long, HTTP takes over
+#define OTA_MCAST_TIMEOUT_MS    300000
+#define OTA_MCAST_MAX_RANGES    80          // per NACK datagram, 6 bytes each
+
+static inline uint32_t le32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline void putLe32(uint8_t *p, uint32_t v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+static IPAddress serverIpFromUrl(const char *url)
+{
+    String host = url;
+    int start = host.indexOf("://");
+    host = host.substring(start < 0 ? 0 : start + 3);
+    int end = host.indexOf(':');
+    if (end < 0)
+    {
+        end = host.indexOf('/');
+    }
+    if (end >= 0)
+    {
+        host = host.substring(0, end);
+    }
+    IPAddress ip;
+    if (!ip.fromString(host))
+    {
+        WiFi.hostByName(host.c_str(), ip);
+    }
+    return ip;
+}
+
+// Ranges of missing blocks, the first call (nothing received) asks for all
+static void sendNack(WiFiUDP &udp, IPAddress serverIp, uint16_t port, uint32_t imageId,
+                     const uint8_t *bitmap, uint32_t blocks)
+{
+    uint8_t pkt[8 + OTA_MCAST_MAX_RANGES * 6];
+    putLe32(pkt, OTA_MCAST_NACK_MAGIC);
+    putLe32(pkt + 4, imageId);
+    size_t len = 8;
+    uint32_t i = 0;
+    while ((i < blocks) && (len + 6 <= sizeof(pkt)))
+    {
+        if (bitmap[i >> 3] & (1 << (i & 7)))
+        {
+            i++;
+            continue;
+        }
+        uint32_t first = i;
+        while ((i < blocks) && !(bitmap[i >> 3] & (1 << (i & 7))) && (i - first < 0xFFFF))
+        {
+            i++;
+        }
+        putLe32(pkt + len, first);
+        pkt[len + 4] = (i - first) & 0xFF;
+        pkt[len + 5] = (i - first) >> 8;
+        len += 6;
+    }
+    udp.beginPacket(serverIp, port);
+    udp.write(pkt, len);
+    udp.endPacket();
+}
+
+// Flashes the complete PSRAM copy in order and hands over to commitOTAImage()
+static bool writeStagedImage(const uint8_t *image, int firmwareSize, const String &md5)
+{
+    otaStageForget();
+    const esp_partition_t *target = esp_ota_get_next_update_partition(NULL);
+    uint32_t eraseSize = (firmwareSize + SPI_FLASH_SEC_SIZE - 1) & ~(SPI_FLASH_SEC_SIZE - 1);
+    if ((target == NULL) || (eraseSize > target->size) ||
+        (esp_partition_erase_range(target, 0, eraseSize) != ESP_OK))
+    {
+        Serial.println("!!! multicastOTAUpdate ERROR: erase failed");
+        return false;
+    }
+    // bounced through internal RAM, PSRAM is not readable while the flash is written
+    uint8_t *buf = (uint8_t *)memTagAlloc(mtSync, OTA_BUF_SIZE, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    bool ok = (buf != NULL);
+    for (uint32_t pos = 0; ok && (pos < (uint32_t)firmwareSize); pos += OTA_BUF_SIZE)
+    {
+        uint32_t len = min((uint32_t)OTA_BUF_SIZE, firmwareSize - pos);
+        memcpy(buf, image + pos, len);
+        ok = (esp_partition_write(target, pos, buf, len) == ESP_OK);
+    }
+    memTagFree(buf);
+    if (!ok)
+    {
+        Serial.println("!!! multicastOTAUpdate ERROR: write failed");
+        return false;
+    }
+    // a pending HTTP resume of the partition is void now
+    Preferences prefs;
+    prefs.begin(OTA_RESUME_PREFS, false);
+    prefs.clear();
+    prefs.end();
+    return commitOTAImage(target, firmwareSize, md5);
+}
+
+static bool multicastOTAUpdate(const char *otaServerURL, JsonObject mcast, int firmwareSize, const String &md5)
+{
+    IPAddress group;
+    uint16_t port = mcast["port"].as<uint16_t>();
+    uint32_t blockSize = mcast["block"].as<uint32_t>();
+    uint32_t imageId = mcast["id"].as<uint32_t>();
+    IPAddress serverIp = serverIpFromUrl(otaServerURL);
+    if (!group.fromString(mcast["group"].as<const char *>()) || !port || !blockSize ||
+        (blockSize > OTA_MCAST_MAX_BLOCK) || (firmwareSize <= 0) || (serverIp == IPAddress()))
+    {
+        Serial.println("!!! multicastOTAUpdate ERROR: bad carousel parameters");
+        return false;
+    }
+
+    uint32_t blocks = (firmwareSize + blockSize - 1) / blockSize;
+    uint8_t *image = (uint8_t *)ps_malloc(firmwareSize);
+    uint8_t *bitmap = (uint8_t *)calloc((blocks + 7) / 8, 1);
+    uint8_t *pkt = (uint8_t *)malloc(OTA_MCAST_HDR_SIZE + blockSize);
+    WiFiUDP udp;
+    bool ok = (image != NULL) && (bitmap != NULL) && (pkt != NULL) && udp.beginMulticast(group, port);
+    if (!ok)
+    {
+        Serial.println("!!! multicastOTAUpdate ERROR: no PSRAM staging buffer or socket");
     }
 
+    // modem sleep would drop most multicast frames between beacons
+    wifi_ps_type_t oldPs = WIFI_PS_NONE;
+    esp_wifi_get_ps(&oldPs);
+    esp_wifi_set_ps(WIFI_PS_NONE);
+
+    Serial.printf(">>> multicastOTAUpdate: %lu blocks of %lu bytes from %s:%d\r\n", blocks, blockSize,
+                  group.toString().c_str(), port);
+    uint32_t received = 0;
+    uint32_t startMs = millis();
+    uint32_t lastBlockMs = startMs;
+    uint32_t lastNackMs = 0;
+    int lastProgress = -1;
+    while (ok && (received < blocks))
+    {
+        uint32_t now = millis();
+        if ((now - lastBlockMs > OTA_MCAST_STALL_MS) || (now - startMs > OTA_MCAST_TIMEOUT_MS))
+        {
+            Serial.printf("!!! multicastOTAUpdate ERROR: carousel stalled at %lu/%lu blocks\r\n", received, blocks);
+            ok = false;
+            break;
+        }
+        if ((lastNackMs == 0) || (now - lastNackMs >= OTA_MCAST_NACK_MS))
+        {
+            sendNack(udp, serverIp, port, imageId, bitmap, blocks);
+            lastNackMs = now;
+        }
+
+        int len = udp.parsePacket();
+        if (len <= 0)
+        {
+            delay(1);
+            continue;
+        }
+        len = udp.read(pkt, OTA_MCAST_HDR_SIZE + blockSize);
+        if ((len <= OTA_MCAST_HDR_SIZE) || (le32(pkt) != OTA_MCAST_BLOCK_MAGIC) || (le32(pkt + 4) != imageId) ||
+            (le32(pkt + 8) != (uint32_t)firmwareSize))
+        {
+            continue;
+        }
+        uint32_t index = le32(pkt + 12);
+        uint32_t expected = min(blockSize, firmwareSize - index * blockSize);
+        if ((index >= blocks) || ((uint32_t)(len - OTA_MCAST_HDR_SIZE) != expected) ||
+            (bitmap[index >> 3] & (1 << (index & 7))))
+        {
+            continue;
+        }
+        memcpy(image + index * blockSize, pkt + OTA_MCAST_HDR_SIZE, expected);
+        bitmap[index >> 3] |= 1 << (index & 7);
+        received++;
+        lastBlockMs = now;
+
+        int progress = ((uint64_t)received * 100) / blocks;
+        if ((progress != lastProgress) && (progress % 5 == 0))
+        {
+            otaProgressCallback(progress);
+            lastProgress = progress;
+        }
+    }
+    udp.stop();
+    esp_wifi_set_ps(oldPs);
+
+    if (ok)
+    {
+        Serial.printf(">>> multicastOTAUpdate: image received in %lu ms\r\n", millis() - startMs);
+        ok = writeStagedImage(image, firmwareSize, md5);
+    }
+    free(pkt);
+    free(bitmap);
+    free(image);
+    return ok;
+}
+
+//=============================================================================
+// Background staging: while the device waits for a game a low priority task
+// streams a newer server build into the inactive partition, throttled and
+// resumable through the same record as performOTAUpdate(). The checked image
+// is only recorded, otaStageApply() makes it bootable between two games
+//=============================================================================
+
+#define OTA_STAGE_PREFS         "ota_stage"     // md5, part and size of the checked image
+
+static volatile bool otaStageRunning = false;
+static volatile bool otaStageCancel = false;
+static String otaStageServer;
+static int otaStageVersion = 0;
+
+void otaStageForget(void)
+{
+    Preferences prefs;
+    prefs.begin(OTA_STAGE_PREFS, false);
+    prefs.clear();
+    prefs.end();
+}
+
+bool otaStageReady(const String &md5)
+{
+    const esp_partition_t *target = esp_ota_get_next_update_partition(NULL);
+    Preferences prefs;
+    if ((target == NULL) || otaStageRunning || !prefs.begin(OTA_STAGE_PREFS, true))
+    {
+        return false;
+    }
+    String staged = prefs.getString("md5", "");
+    bool ready = !staged.isEmpty() && (prefs.getInt("size", 0) > 0) && (prefs.getString("part", "") == target->label) &&
+                 (md5.isEmpty() || staged.equalsIgnoreCase(md5));
+    prefs.end();
+    return ready;
+}
+
+// 1: the image is staged or nothing is newer, 0: try again later
+static int otaStageImage(const String &md5, const String &sha256, int firmwareSize)
+{
+    const esp_partition_t *target = esp_ota_get_next_update_partition(NULL);
+    if ((target == NULL) || (firmwareSize <= 0) || ((uint32_t)firmwareSize > target->size))
+    {
+        Serial.println("!!! otaStageTask ERROR: Not enough space for update");
+        return 1;
+    }
+    otaStageForget();
+
+    // the raw image only, an encoded one cannot be resumed
+    Preferences prefs;
+    prefs.begin(OTA_RESUME_PREFS, false);
+    uint32_t offset = loadResumeOffset(prefs, md5, target, firmwareSize);
+    HTTPClient http;
+    http.begin(otaStageServer + "/update");
+    if (offset > 0)
+    {
+        http.addHeader("Range", "bytes=" + String(offset) + "-");
+    }
+    const char *otaHeaders[] = {SYNC_RETRY_HEADER};
+    http.collectHeaders(otaHeaders, 1);
+    int httpCode = http.GET();
+    if (httpCode == HTTP_CODE_OK)
+    {
+        offset = 0;
+    }
+    else if ((httpCode != HTTP_CODE_PARTIAL_CONTENT) || (offset == 0))
+    {
+        Serial.printf("!!! otaStageTask ERROR: Failed to start download: %d\r\n", httpCode);
+        syncNoteAdmission(http, httpCode);
+        http.end();
+        prefs.end();
+        return 0;
+    }
+    if (offset + http.getSize() != (uint32_t)firmwareSize)
+    {
+        Serial.println("!!! otaStageTask ERROR: Content length mismatch");
+        http.end();
+        prefs.end();
+        return 0;
+    }
+    prefs.putString("md5", md5);
+    prefs.putString("part", target->label);
+    prefs.putUInt("offset", offset);
+    Serial.printf(">>> otaStageTask: %s at %lu of %d bytes\r\n", offset ? "resuming" : "starting", (unsigned long)offset, firmwareSize);
+
+    tOtaVerifier verifier;
+    verifier.begin(firmwareSize);
+    uint8_t *buffer = (uint8_t *)malloc(OTA_BUF_SIZE);
+    bool res = (buffer != NULL) && (sha256.isEmpty() || hashWritten(verifier, target, offset));
+    WiFiClient *client = http.getStreamPtr();
+    uint32_t written = offset;
+    uint32_t erasedTo = offset;
+    uint32_t savedAt = offset;
+    uint32_t startMs = millis();
+    uint32_t lastDataMs = startMs;
+    while (res && !otaStageCancel && (written < (uint32_t)firmwareSize))
+    {
+        size_t available = client->available();
+        if (!available)
+        {
+            if (!http.connected() || (millis() - lastDataMs > OTA_STALL_MS))
+            {
+                break;
+            }
+            delay(1);
+            continue;
+        }
+        int readBytes = client->readBytes(buffer, min(available, (size_t)OTA_BUF_SIZE));
+        if (readBytes <= 0)
+        {
+            continue;
+        }
+        lastDataMs = millis();
+        if (written + readBytes > erasedTo)
+        {
+            uint32_t eraseEnd = (written + readBytes + SPI_FLASH_SEC_SIZE - 1) & ~(SPI_FLASH_SEC_SIZE - 1);
+            res = (esp_partition_erase_range(target, erasedTo, eraseEnd - erasedTo) == ESP_OK);
+            erasedTo = eraseEnd;
+        }
+        res = res && (esp_partition_write(target, written, buffer, readBytes) == ESP_OK);
+        if (!res)
+        {
+            Serial.println("!!! otaStageTask ERROR: flash write failed");
+            break;
+        }
+        written += readBytes;
+        verifier.add(buffer, readBytes);
+        verifier.printProgress("otaStageTask");
+        if (written - savedAt >= OTA_RESUME_SAVE_BYTES)
+        {
+            prefs.putUInt("offset", written);
+            savedAt = written;
+        }
+        // the game server and the other devices keep the air time they need
+        uint32_t dueMs = ((uint64_t)(written - offset) * 1000) / (OTA_STAGE_KBPS * 1024);
+        uint32_t tookMs = millis() - startMs;
+        if (dueMs > tookMs)
+        {
+            delay(dueMs - tookMs);
+        }
+    }
+    free(buffer);
     http.end();
-    return res;
+    if (written < (uint32_t)firmwareSize)
+    {
+        // the sectors on flash are kept for the next attempt
+        prefs.putUInt("offset", res ? written : 0);
+        prefs.end();
+        Serial.printf(">>> otaStageTask: %s at %lu of %d bytes\r\n", otaStageCancel ? "paused" : "cut off",
+                      (unsigned long)written, firmwareSize);
+        return 0;
+    }
+    prefs.clear();
+    prefs.end();
+    bool ok = sha256.isEmpty() ? partitionMD5(target, firmwareSize).equalsIgnoreCase(md5) : verifier.finish(sha256);
+    if (!ok)
+    {
+        Serial.println("!!! otaStageTask ERROR: the staged image does not match, it starts over");
+        return 0;
+    }
+    prefs.begin(OTA_STAGE_PREFS, false);
+    prefs.putString("md5", md5);
+    prefs.putString("part", target->label);
+    prefs.putInt("size", firmwareSize);
+    prefs.end();
+    Serial.printf(">>> otaStageTask: %d bytes staged in %s, %lu ms\r\n", firmwareSize, target->label, millis() - startMs);
+    return 1;
+}
+
+static int otaStageOnce(void)
+{
+    tPmHold hold(plHttp);
+    JsonDocument doc;
+    DeserializationError error;
+    {
+        // the pooled client goes back before the long download
+        String versionUrl = otaStageServer + "/version";
+        tHttpLease lease(versionUrl);
+        HTTPClient &http = lease.http();
+        lease.begin(versionUrl);
+        int httpCode = http.GET();
+        if (httpCode != HTTP_CODE_OK)
+        {
+            Serial.printf("!!! otaStageTask HTTP ERROR: %d\r\n", httpCode);
+            syncNoteAdmission(http, httpCode);
+            http.end();
+            return 0;
+        }
+        error = deserializeJson(doc, http.getString());
+        http.end();
+    }
+    if (error)
+    {
+        Serial.println("!!! otaStageTask ERROR: Failed to parse JSON response");
+        return 0;
+    }
+    String md5 = doc["md5"] | "";
+    if (otaFirmwareCurrent(otaStageVersion, doc["version"].as<int>(), md5) || otaStageReady(md5))
+    {
+        return 1;
+    }
+    return otaStageImage(md5, doc["sha256"] | "", doc["size"] | 0);
+}
+
+static void otaStageTask(void *param)
+{
+    int attempt = 0;
+    while (!otaStageCancel)
+    {
+        if ((WiFi.status() == WL_CONNECTED) && airtimeBulkWait(&otaStageCancel))
+        {
+            airtimeBulkBegin();
+            int staged = otaStageOnce();
+            airtimeBulkEnd();
+            if (staged)
+            {
+                break;
+            }
+        }
+        bool paced;
+        uint32_t waitMs = syncBackoffMs(++attempt, paced);
+        for (uint32_t t = 0; !otaStageCancel && (t < waitMs); t += 100)
+        {
+            delay(100);
+        }
+    }
+    Serial.printf(">>> otaStageTask: %s\r\n", otaStageCancel ? "stopped" : "done");
+    otaStageRunning = false;
+    vTaskDelete(NULL);
+}
+
+void otaStageStart(const char *otaServerURL, int currentVersion)
+{
+    if (!OTA_BACKGROUND || otaStageRunning || (otaServerURL == NULL) || (*otaServerURL == 0))
+    {
+        return;
+    }
+    otaStageServer = otaServerURL;
+    otaStageVersion = currentVersion;
+    otaStageCancel = false;
+    otaStageRunning = true;
+    if (!taskStart(tkOtaStage, otaStageTask))
+    {
+        Serial.println("!!! otaStageStart ERROR: task start failed");
+        otaStageRunning = false;
+    }
+}
+
+void otaStageStop(void)
+{
+    otaStageCancel = true;
+    uint32_t startMs = millis();
+    while (otaStageRunning && (millis() - startMs < SYNC_STAGE_STOP_MS))
+    {
+        delay(10);
+    }
+    if (otaStageRunning)
+    {
+        Serial.println("*** otaStageStop WARNING! the staging task did not stop yet");
+    }
+}
+
+bool otaStageApply(const String &md5)
+{
+    if (!otaStageReady(md5))
+    {
+        return false;
+    }
+    Preferences prefs;
+    prefs.begin(OTA_STAGE_PREFS, false);
+    int firmwareSize = prefs.getInt("size", 0);
+    String staged = prefs.getString("md5", "");
+    prefs.clear();
+    prefs.end();
+    Serial.printf(">>> otaStageApply: firmware %s, %d bytes\r\n", staged.c_str(), firmwareSize);
+    // checked when it was staged, the bootloader checks the image once more
+    return commitOTAImage(esp_ota_get_next_update_partition(NULL), firmwareSize, "");
 }
 
 // #include "serverSync.h"
@@ -1,10 +1,34 @@
 #include "statusClient.h"
 #include "board.h"
+#include "espRxRing.h"
+#include "espStats.h"
+#include "espAirtime.h"
+#include "espTimecode.h"
+#include "uplink.h"
+#include "jsonWriter.h"
+#include "bootProfile.h"
+#include "energyProfile.h"
+#include "logRing.h"
+#include "taskRegistry.h"
+#include "loopProfile.h"
+#include "espHitStamp.h"
+#include "tftSnapshot.h"
+#include "valPlayer.h"
+#include "PSRamFS.h"
+#include "httpPool.h"
+#include "memMonitor.h"
+#include "espPing.h"
+#include "syncBench.h"
+#include "xgConfig.h"
+#include "tunables.h"
 
 #include <WiFi.h>
 #include <HTTPClient.h>
+#include <StreamString.h>
 #include <ArduinoJson.h>
 #include <Preferences.h>
+#include <esp_wifi.h>
+#include <esp_timer.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 #include <freertos/semphr.h>
@@ -12,40 +36,86 @@
 // ============== Internal State ==============
 static char _deviceName[STATUS_DEVICE_NAME_MAX_LEN + 1] = {0};
 static char _serverIP[64] = {0};
+static uint16_t _serverPort = STATUS_SERVER_PORT;
 static char _gameStatus[STATUS_GAME_STATUS_MAX_LEN + 1] = "BOOT";
 static DeviceStatus_t _deviceStatus = DEVICE_STATUS_OPERATION;
 static volatile bool _running = false;
-static TaskHandle_t _taskHandle = NULL;
 static SemaphoreHandle_t _mutex = NULL;
-static bool doUpdate = false;
+
+// Through the HTTP pool, the connection stays open between updates, the status server answers with HTTP/1.1
+static char _statusUrl[96] = {0};
+static volatile bool _snapshotWanted = false;
+static volatile bool _valReloadWanted = false;
+static volatile bool _syncBenchWanted = false;
+static volatile bool _benchWanted = false;
+static char _benchSuite[STATUS_BENCH_SUITE_MAX_LEN + 1] = {0};
+static uint32_t _benchIterations = STATUS_BENCH_DEF_ITERATIONS;
+static tStatusBenchHook _benchHook = NULL;
+
+// Delta reporting: the values of the last delivered report, a full snapshot
+// goes out first, on server request and every STATUS_FULL_INTERVAL_MS
+struct tStatusSnapshot
+{
+    char             name[STATUS_DEVICE_NAME_MAX_LEN + 1];
+    uint32_t         ip;
+    char             ssid[33];
+    int              rssi;
+    uint16_t         batteryMv;
+    uint8_t          batteryPct;
+    int16_t          runtimeMin;        // energyRuntimeMinutes()
+    uint8_t          accelActivity;
+    DeviceStatus_t   deviceStatus;
+    char             gameStatus[STATUS_GAME_STATUS_MAX_LEN + 1];
+    char             tunableSet[TUNABLE_SET_NAME_LEN + 1];
+    uint32_t         freeHeap;
+    uint32_t         maxAllocHeap;
+    tEspRxStats      rx;
+    tEspChannelStats ch;
+    tEspClockStats   clock;
+    tAirtimeStats    air;
+};
+static tStatusSnapshot _lastSent;
+static bool _needFull = true;
+static uint32_t _statusSeq = 0;
+static uint32_t _lastFullMs = 0;
+static uint32_t _lastLoopOver = 0;
+static tMemLevel _lastMemLevel = mlOk;
+static uint32_t _lastHitSamples = 0;
+static char _statusJson[STATUS_JSON_BUF];
 
 // Preferences namespace for storing device name
 static const char* PREFS_NAMESPACE = "statusClient";
 static const char* PREFS_KEY_NAME = "deviceName";
 
-// Accelerometer activity tracking
-static float _accelSamples[100][3];  // Store last N samples [x,y,z]
-static int _accelSampleIndex = 0;
-static int _accelSampleCount = 0;
+// Accelerometer activity, from the accel service
 static uint8_t _accelActivity = 1;   // Current activity level 1-100
-static unsigned long _lastAccelSample = 0;
-static SemaphoreHandle_t _accelMutex = NULL;
 
 //misc
 volatile bool statusClientSuspended = false;
 
 // ============== Forward Declarations ==============
-static void statusClientTask(void* parameter);
+static void statusClientService(void);
 static bool sendStatusUpdate(void);
+static bool sendSnapshot(void);
+static bool fetchPatternFile(const char *filename);
+static bool sendSyncBench(void);
+static bool sendBenchmark(void);
 static DeviceCommand_t checkForCommand(const String& response);
 static bool checkForNewName(const String& response, char* newNameOut, size_t maxLen);
+static uint32_t checkForInterval(const String& response);
+static bool checkForTunables(const String& response);
 static void processCommand(DeviceCommand_t cmd);
-static String getDeviceStatusString(DeviceStatus_t status);
-static uint8_t calculateAccelActivity(void);
+static const char* getDeviceStatusString(DeviceStatus_t status);
 static void generateDefaultName(char* buffer, size_t bufferSize);
 static bool loadNameFromPreferences(void);
 static bool saveNameToPreferences(const char* name);
 
+// The heap watchdog's level changed, reported without waiting for the interval
+static void onMemLevel(tMemLevel level)
+{
+    uplinkKick(ucStatus);
+}
+
 // ============== Public Functions ==============
 
 bool statusClientInit(const char* serverIP)
@@ -67,16 +137,6 @@ bool statusClientInit(const char* serverIP)
         }
     }
     
-    if (_accelMutex == NULL)
-    {
-        _accelMutex = xSemaphoreCreateMutex();
-        if (_accelMutex == NULL)
-        {
-            Serial.println("!!! statusClientInit: Failed to create accel mutex");
-            return false;
-        }
-    }
-    
     // Load device name from Preferences, or generate default if not saved
     if (!loadNameFromPreferences())
     {
@@ -100,6 +160,11 @@ bool statusClientInit(const char* serverIP)
     return statusClientStart();
 }
 
+void statusClientSetServerPort(uint16_t port)
+{
+    _serverPort = port ? port : STATUS_SERVER_PORT;
+}
+
 bool statusClientStart(void)
 {
     if (_running)
@@ -120,27 +185,20 @@ bool statusClientStart(void)
         return false;
     }
     
-    _running = true;
-    
-    // Create the status client task
-    BaseType_t result = xTaskCreatePinnedToCore(
-        statusClientTask,       // Task function
-        "StatusClient",         // Task name
-        4096,                   // Stack size
-        NULL,                   // Parameters
-        1,                      // Priority (low)
-        &_taskHandle,           // Task handle
-        0                       // Core 0 (leave core 1 for main app)
-    );
-    
-    if (result != pdPASS)
-    {
-        Serial.println("!!! statusClientStart: Failed to create task");
-        _running = false;
+    snprintf(_statusUrl, sizeof(_statusUrl), "http://%s:%u/status", _serverIP, (unsigned)_serverPort);
+
+    // Status updates share the uplink task with the game API, below its priority
+    if (!uplinkStart())
+    {
+        Serial.println("!!! statusClientStart: Failed to start uplink");
         return false;
     }
+    _running = true;
+    uplinkSetBulk(ucStatus, true);
+    uplinkRegister(ucStatus, STATUS_UPLINK_PRIORITY, STATUS_UPDATE_INTERVAL_MS, statusClientService);
+    memMonSetHook(onMemLevel);
     
-    Serial.println(">>> statusClientStart: Task started");
+    Serial.println(">>> statusClientStart: Registered on uplink");
     return true;
 }
 
@@ -152,14 +210,7 @@ void statusClientStop(void)
     }
     
     _running = false;
-    
-    // Wait for task to finish
-    if (_taskHandle != NULL)
-    {
-        vTaskDelay(pdMS_TO_TICKS(100));
-        vTaskDelete(_taskHandle);
-        _taskHandle = NULL;
-    }
+    uplinkUnregister(ucStatus);
     
     Serial.println(">>> statusClientStop: Stopped");
 }
@@ -175,8 +226,8 @@ void statusClientSetGameStatus(const char* status)
     {
         strncpy(_gameStatus, status, STATUS_GAME_STATUS_MAX_LEN);
         _gameStatus[STATUS_GAME_STATUS_MAX_LEN] = '\0';
-        doUpdate = true;
         xSemaphoreGive(_mutex);
+        uplinkKick(ucStatus);
         delay(250);
     }
 }
@@ -219,31 +270,6 @@ const char* statusClientGetName(void)
     return "LOAD_ERROR";
 }
 
-void statusClientFeedAccelData(float x, float y, float z)
-{
-    if (_accelMutex == NULL)
-    {
-        return;
-    }
-    
-    if (xSemaphoreTake(_accelMutex, pdMS_TO_TICKS(10)) == pdTRUE)
-    {
-        // Store sample in circular buffer
-        _accelSamples[_accelSampleIndex][0] = x;
-        _accelSamples[_accelSampleIndex][1] = y;
-        _accelSamples[_accelSampleIndex][2] = z;
-        
-        _accelSampleIndex = (_accelSampleIndex + 1) % 100;
-        if (_accelSampleCount < 100)
-        {
-            _accelSampleCount++;
-        }
-        
-        _lastAccelSample = millis();
-        xSemaphoreGive(_accelMutex);
-    }
-}
-
 // ============== Internal Functions ==============
 
 static void generateDefaultName(char* buffer, size_t bufferSize)
@@ -309,64 +335,213 @@ static bool saveNameToPreferences(const char* name)
     return true;
 }
 
-static void statusClientTask(void* parameter)
+// Uplink task, every STATUS_UPDATE_INTERVAL_MS or when kicked
+static void statusClientService(void)
 {
-    Serial.println(">>> StatusClient task running");
-    
-    unsigned long lastUpdate = 0;
-    
-    while (_running)
+    if (!_running || statusClientSuspended)
     {
-        // Check WiFi connection
-        if (WiFi.status() != WL_CONNECTED)
+        return;
+    }
+
+    // Update accelerometer activity level
+    _accelActivity = accelActivity();
+
+    if (!sendStatusUpdate())
+    {
+        Serial.println("!!! StatusClient: Failed to send update");
+    }
+    // asked for in the reply, goes out once the update's connection is done
+    if (_snapshotWanted)
+    {
+        _snapshotWanted = false;
+        if (!sendSnapshot())
         {
-            vTaskDelay(pdMS_TO_TICKS(1000));
-            continue;
+            Serial.println("!!! StatusClient: Failed to send snapshot");
         }
-        
-        // Update accelerometer activity level
-        _accelActivity = calculateAccelActivity();
-        
-        // Time to send status update?
-        unsigned long now = millis();
-        if ((now - lastUpdate >= STATUS_UPDATE_INTERVAL_MS) || (doUpdate))
+    }
+    if (_valReloadWanted)
+    {
+        _valReloadWanted = false;
+        // val.bin is optional, one older than val.json is not used
+        bool ok = fetchPatternFile(VAL_FILE_NAME);
+        if (ok)
         {
-            lastUpdate = now;
-            if (doUpdate) doUpdate = false;
-            if (!sendStatusUpdate())
-            {
-                Serial.println("!!! StatusClient: Failed to send update");
-            }
+            fetchPatternFile(VAL_BIN_FILE_NAME);
+            ok = valReload();
         }
-        
-        vTaskDelay(pdMS_TO_TICKS(100));  // Small delay to prevent tight loop
-        while (statusClientSuspended)
+        if (!ok)
         {
-            delay(100);
+            Serial.println("!!! StatusClient: Failed to reload the patterns");
         }
     }
-    
-    Serial.println(">>> StatusClient task exiting");
-    vTaskDelete(NULL);
+    if (_syncBenchWanted)
+    {
+        _syncBenchWanted = false;
+        if (!sendSyncBench())
+        {
+            Serial.println("!!! StatusClient: Failed to send the sync benchmark");
+        }
+    }
+    if (_benchWanted)
+    {
+        _benchWanted = false;
+        if (!sendBenchmark())
+        {
+            Serial.println("!!! StatusClient: Failed to send the benchmark");
+        }
+    }
+}
+
+// Straight into PSRamFS, LittleFS gets the files with the next sync
+static bool fetchPatternFile(const char *filename)
+{
+    char url[128];
+    snprintf(url, sizeof(url), "http://%s:%u/patterns?file=%s", _serverIP, (unsigned)_serverPort, filename + 1);
+
+    tHttpLease lease(url);
+    HTTPClient &http = lease.http();
+    bool ok = false;
+    if (lease.begin(url))
+    {
+        http.setTimeout(5000);
+        int code = http.GET();
+        if (code == 200)
+        {
+            File f = PSRamFS.open(filename, "w");
+            int len = http.getSize();
+            int written = f ? http.writeToStream(&f) : 0;
+            if (f)
+            {
+                f.close();
+            }
+            ok = (written > 0) && ((len < 0) || (written == len));
+            if (!ok)
+            {
+                PSRamFS.remove(filename);
+            }
+        }
+        Serial.printf(">>> StatusClient: <%s> fetched, HTTP %d\n", filename, code);
+        http.end();
+    }
+    return ok;
+}
+
+static bool sendSnapshot(void)
+{
+    size_t len;
+    uint8_t *snap = tftSnapshotCapture(len);
+    if (snap == NULL)
+    {
+        return false;
+    }
+    uint8_t mac[6];
+    WiFi.macAddress(mac);
+    char url[128];
+    snprintf(url, sizeof(url), "http://%s:%u/snapshot?mac=%02X:%02X:%02X:%02X:%02X:%02X", _serverIP,
+             (unsigned)_serverPort, mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+
+    tHttpLease lease(url);
+    HTTPClient &http = lease.http();
+    bool ok = false;
+    if (lease.begin(url))
+    {
+        http.addHeader("Content-Type", TFT_SNAP_CT);
+        http.setTimeout(10000);
+        int code = http.POST(snap, len);
+        ok = (code == 200);
+        Serial.printf(">>> StatusClient: snapshot of %u bytes posted, HTTP %d\n", (unsigned)len, code);
+        http.end();
+    }
+    free(snap);
+    return ok;
+}
+
+// Default benchmark, the report goes out even when a part of it failed
+static bool sendSyncBench(void)
+{
+    tSyncBenchCfg cfg;
+    String report;
+    syncBenchRun(ConfigAPI::getServerUrl(csFile), ConfigAPI::getServerUrl(csOta), cfg, Serial, &report);
+    if (report.length() == 0)
+    {
+        return false;
+    }
+    uint8_t mac[6];
+    WiFi.macAddress(mac);
+    char url[128];
+    snprintf(url, sizeof(url), "http://%s:%u/syncbench?mac=%02X:%02X:%02X:%02X:%02X:%02X", _serverIP,
+             (unsigned)_serverPort, mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+
+    tHttpLease lease(url);
+    HTTPClient &http = lease.http();
+    bool ok = false;
+    if (lease.begin(url))
+    {
+        http.addHeader("Content-Type", "application/json");
+        http.setTimeout(5000);
+        int code = http.POST(report);
+        ok = (code == 200);
+        Serial.printf(">>> StatusClient: sync benchmark posted, HTTP %d\n", code);
+        http.end();
+    }
+    return ok;
+}
+
+// The suites park the radio task and draw on the panel, a game in progress
+// gets a report saying so instead
+static bool sendBenchmark(void)
+{
+    if (_benchHook == NULL)
+    {
+        return false;
+    }
+    String report;
+    if (airtimePlaying())
+    {
+        Serial.println("*** StatusClient WARNING! benchmark refused during play");
+        report = String("{\"version\":1,\"suite\":\"") + _benchSuite + "\",\"error\":\"in play\"}";
+    }
+    else
+    {
+        StreamString out;
+        _benchHook(_benchSuite, _benchIterations, out);
+        report = out;
+    }
+    uint8_t mac[6];
+    WiFi.macAddress(mac);
+    char url[128];
+    snprintf(url, sizeof(url), "http://%s:%u/benchmark?mac=%02X:%02X:%02X:%02X:%02X:%02X", _serverIP,
+             (unsigned)_serverPort, mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+
+    tHttpLease lease(url);
+    HTTPClient &http = lease.http();
+    bool ok = false;
+    if (lease.begin(url))
+    {
+        http.addHeader("Content-Type", "application/json");
+        http.setTimeout(5000);
+        int code = http.POST(report);
+        ok = (code == 200);
+        Serial.printf(">>> StatusClient: benchmark [%s] posted, HTTP %d\n", _benchSuite, code);
+        http.end();
+    }
+    return ok;
 }
 
 static bool sendStatusUpdate(void)
 {
-    HTTPClient http;
-    
-    // Build URL
-    String url = "http://";
-    url += _serverIP;
-    url += ":";
-    url += STATUS_SERVER_PORT;
-    url += "/status";
+    tHttpLease lease(_statusUrl);
+    HTTPClient &http = lease.http();
     
-    http.begin(url);
+    if (!lease.begin(_statusUrl))
+    {
+        return false;
+    }
     http.addHeader("Content-Type", "application/json");
     http.setTimeout(5000);  // 5 second timeout
     
     // Build JSON payload
-    StaticJsonDocument<512> doc;
+    tJsonWriter json(_statusJson, sizeof(_statusJson));
     
     // Get MAC address
     uint8_t mac[6];
@@ -375,49 +550,241 @@ static bool sendStatusUpdate(void)
     snprintf(macStr, sizeof(macStr), "%02X:%02X:%02X:%02X:%02X:%02X",
              mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
     
-    // Thread-safe read of status values
-    char gameStatusCopy[STATUS_GAME_STATUS_MAX_LEN + 1];
-    DeviceStatus_t deviceStatusCopy;
+    tStatusSnapshot cur;
+    memset(&cur, 0, sizeof(cur));
     
+    // Thread-safe read of status values
     if (xSemaphoreTake(_mutex, pdMS_TO_TICKS(100)) == pdTRUE)
     {
-        strcpy(gameStatusCopy, _gameStatus);
-        deviceStatusCopy = _deviceStatus;
+        strcpy(cur.gameStatus, _gameStatus);
+        cur.deviceStatus = _deviceStatus;
         xSemaphoreGive(_mutex);
     }
     else
     {
-        strcpy(gameStatusCopy, "UNKNOWN");
-        deviceStatusCopy = DEVICE_STATUS_OPERATION;
+        strcpy(cur.gameStatus, "UNKNOWN");
+        cur.deviceStatus = DEVICE_STATUS_OPERATION;
     }
     
-    // Populate JSON
-    doc["mac"] = macStr;
-    doc["name"] = _deviceName;
-    doc["ip"] = WiFi.localIP().toString();
-    doc["ssid"] = WiFi.SSID();
-    doc["rssi"] = WiFi.RSSI();
-    doc["uptime"] = millis() / 1000;
-    doc["battery_mv"] = boardGetVcc();
-    doc["battery_pct"] = boardGetVccPercent();
-    doc["accel_activity"] = _accelActivity;
-    doc["device_status"] = getDeviceStatusString(deviceStatusCopy);
-    doc["game_status"] = gameStatusCopy;
-    doc["free_heap"] = ESP.getFreeHeap();
-    doc["max_alloc_heap"] = ESP.getMaxAllocHeap();
-    
-    String payload;
-    serializeJson(doc, payload);
+    strcpy(cur.name, _deviceName);
+    strlcpy(cur.tunableSet, tunablesSetName(), sizeof(cur.tunableSet));
+    cur.ip = (uint32_t)WiFi.localIP();
+    wifi_ap_record_t apInfo;
+    if (esp_wifi_sta_get_ap_info(&apInfo) == ESP_OK)
+    {
+        strncpy(cur.ssid, (const char *)apInfo.ssid, sizeof(cur.ssid) - 1);
+    }
+    cur.rssi = WiFi.RSSI();
+    cur.batteryMv = boardGetVcc();
+    cur.batteryPct = boardGetVccPercent();
+    cur.runtimeMin = energyRuntimeMinutes();
+    cur.accelActivity = _accelActivity;
+    cur.freeHeap = ESP.getFreeHeap();
+    cur.maxAllocHeap = ESP.getMaxAllocHeap();
+    espGetRxStats(cur.rx);
+    espStatsGet(cur.ch);
+    espClockGetStats(cur.clock);
+    airtimeGetStats(cur.air);
+    
+    if (millis() - _lastFullMs >= STATUS_FULL_INTERVAL_MS)
+    {
+        _needFull = true;
+    }
+    bool full = _needFull;
+    const tStatusSnapshot &last = _lastSent;
+    
+    // Populate JSON: mac, seq and uptime always, the rest when changed
+    json.beginObject();
+    json.field("mac", macStr);
+    json.field("seq", ++_statusSeq);
+    json.field("full", full);
+    json.field("uptime", millis() / 1000);
+    if (full || strcmp(cur.name, last.name))
+        json.field("name", cur.name);
+    if (full || (cur.ip != last.ip))
+        json.fieldIp("ip", cur.ip);
+    if (full || strcmp(cur.ssid, last.ssid))
+        json.field("ssid", cur.ssid);
+    if (full || (abs(cur.rssi - last.rssi) >= STATUS_DELTA_RSSI))
+        json.field("rssi", cur.rssi);
+    if (full || (abs((int)cur.batteryMv - (int)last.batteryMv) >= STATUS_DELTA_BATTERY_MV))
+        json.field("battery_mv", cur.batteryMv);
+    if (full || (cur.batteryPct != last.batteryPct))
+        json.field("battery_pct", cur.batteryPct);
+    if (full || (abs(cur.runtimeMin - last.runtimeMin) >= STATUS_DELTA_RUNTIME_MIN) || ((cur.runtimeMin < 0) != (last.runtimeMin < 0)))
+        json.field("runtime_min", cur.runtimeMin);
+    if (full || (cur.accelActivity != last.accelActivity))
+        json.field("accel_activity", cur.accelActivity);
+    if (full || (cur.deviceStatus != last.deviceStatus))
+        json.field("device_status", getDeviceStatusString(cur.deviceStatus));
+    if (full || strcmp(cur.gameStatus, last.gameStatus))
+        json.field("game_status", cur.gameStatus);
+    if (full || strcmp(cur.tunableSet, last.tunableSet))
+        json.field("tunable_set", cur.tunableSet);
+    if (full || (abs((int32_t)(cur.freeHeap - last.freeHeap)) >= STATUS_DELTA_HEAP))
+        json.field("free_heap", cur.freeHeap);
+    if (full || (abs((int32_t)(cur.maxAllocHeap - last.maxAllocHeap)) >= STATUS_DELTA_HEAP))
+        json.field("max_alloc_heap", cur.maxAllocHeap);
+
+    if (full || (cur.rx.received != last.rx.received))
+        json.field("rx_received", cur.rx.received);
+    if (full || (cur.rx.dropped != last.rx.dropped))
+        json.field("rx_dropped", cur.rx.dropped);
+    if (full || (cur.rx.coalesced != last.rx.coalesced))
+        json.field("rx_coalesced", cur.rx.coalesced);
+    if (full || (cur.rx.priority != last.rx.priority))
+        json.field("rx_priority", cur.rx.priority);
+    if (full || (cur.rx.spilled != last.rx.spilled))
+        json.field("rx_spilled", cur.rx.spilled);
+    if (full || (cur.rx.highWater != last.rx.highWater))
+        json.field("rx_high_water", cur.rx.highWater);
+    uint32_t rejected = cur.ch.rejLength + cur.ch.rejProtocol + cur.ch.rejCrc;
+    if (full || (rejected != last.ch.rejLength + last.ch.rejProtocol + last.ch.rejCrc))
+    {
+        json.field("rx_rejected", rejected);
+        json.field("rx_rej_len", cur.ch.rejLength);
+        json.field("rx_rej_proto", cur.ch.rejProtocol);
+        json.field("rx_rej_crc", cur.ch.rejCrc);
+    }
+    if (full || (cur.ch.rxFps != last.ch.rxFps))
+        json.field("rx_fps", cur.ch.rxFps);
+    if (full || (cur.ch.txOk != last.ch.txOk))
+        json.field("tx_ok", cur.ch.txOk);
+    if (full || (cur.ch.txFail != last.ch.txFail))
+        json.field("tx_fail", cur.ch.txFail);
+    if (full || (cur.ch.senders != last.ch.senders))
+        json.field("radio_senders", cur.ch.senders);
+    if (full || (cur.ch.jitterAvgMs != last.ch.jitterAvgMs))
+        json.field("jitter_avg_ms", cur.ch.jitterAvgMs);
+    if (full || (cur.ch.jitterMaxMs != last.ch.jitterMaxMs))
+        json.field("jitter_max_ms", cur.ch.jitterMaxMs);
+    if (full || (cur.ch.channel != last.ch.channel) || (cur.ch.apChannel != last.ch.apChannel))
+    {
+        json.field("esp_ch", cur.ch.channel);
+        json.field("ap_ch", cur.ch.apChannel);
+    }
+    if (full || (cur.ch.chAligns != last.ch.chAligns) || (cur.ch.chRoams != last.ch.chRoams) ||
+        (cur.ch.chRefused != last.ch.chRefused))
+    {
+        json.field("ch_aligns", cur.ch.chAligns);
+        json.field("ch_roams", cur.ch.chRoams);
+        json.field("ch_refused", cur.ch.chRefused);
+    }
+    // seq loss moves with every frame, it rides along with full reports and deferrals
+    if (full || (cur.air.deferred != last.air.deferred))
+    {
+        json.field("air_seq_heard", cur.ch.rxSeqHeard);
+        json.field("air_seq_lost", cur.ch.rxSeqLost);
+        json.field("air_bulk_heard", cur.ch.rxSeqHeardBulk);
+        json.field("air_bulk_lost", cur.ch.rxSeqLostBulk);
+        json.field("air_deferred", cur.air.deferred);
+        json.field("air_bulk_ms", cur.air.bulkMs);
+    }
+    // server clock estimate, with every full report and when it was stepped
+    if (cur.clock.samples && (full || (cur.clock.steps != last.clock.steps)))
+    {
+        json.field("clock_rtt_ms", cur.clock.rttMs);
+        json.field("clock_drift_ppm", cur.clock.driftPpm);
+        json.field("clock_steps", cur.clock.steps);
+    }
+    if (full || memcmp(cur.ch.rssiHist, last.ch.rssiHist, sizeof(cur.ch.rssiHist)))
+    {
+        json.beginArray("rssi_hist");
+        for (int i = 0; i < ESP_STATS_RSSI_BINS; i++)
+        {
+            json.value(cur.ch.rssiHist[i]);
+        }
+        json.endArray();
+    }
+    // stack headroom and CPU share per task, to size the stacks from the fleet
+    if (full)
+        taskRegistryWriteJson(json);
+    // game loop timing, also as soon as an iteration ran over its budget
+    uint32_t loopOver = loopProfOverTotal();
+    if (full || (loopOver != _lastLoopOver))
+    {
+        loopProfWriteJson(json);
+        _lastLoopOver = loopOver;
+    }
+    // hit latency histograms of this game, whenever there are new hits
+    uint32_t hitSamples = espHitLatencySamples();
+    if ((hitSamples > 0) && (full || (hitSamples != _lastHitSamples)))
+    {
+        espHitLatencyWriteJson(json);
+        _lastHitSamples = hitSamples;
+    }
+    // once per boot, for the fleet boot-time statistics
+    bool withBoot = bootProfPending();
+    if (withBoot)
+        bootProfWriteJson(json);
+    // while a profile runs, the fleet view shows where the battery goes
+    if (energyProfActive())
+        energyProfWriteJson(json);
+    // heap levels, at once when the watchdog's level changed
+    tMemLevel memLevel = memMonLevel();
+    if (full || (memLevel != _lastMemLevel))
+    {
+        memMonWriteJson(json);
+        _lastMemLevel = memLevel;
+    }
+    // a pinger's whole point, every report
+    if (espPingIsPinger())
+        espPingWriteJson(json);
+    // the last lines before a crash, once
+    bool withCrash = logRingCrashPending();
+    if (withCrash)
+        logRingWriteJson(json);
+    json.endObject();
+    if (!json.ok())
+    {
+        Serial.println("!!! StatusClient: report does not fit the JSON buffer");
+        http.end();
+        return false;
+    }
     
     // Send POST request
-    int httpCode = http.POST(payload);
+    int64_t startUs = esp_timer_get_time();
+    int httpCode = http.POST((uint8_t *)_statusJson, json.length());
+    bootProfHttp(startUs);
     
     if (httpCode > 0)
     {
         if (httpCode == HTTP_CODE_OK)
         {
             String response = http.getString();
+            http.end();
+            
+            // Delivered: the next delta is taken against these values
+            _lastSent = cur;
+            if (withBoot)
+            {
+                bootProfDelivered();
+            }
+            if (withCrash)
+            {
+                logRingCrashDelivered();
+            }
+            if (full)
+            {
+                _needFull = false;
+                _lastFullMs = millis();
+            }
+            // the server lost track of us (restart, missed delta)
+            if (response.indexOf("\"resync\"") >= 0)
+            {
+                _needFull = true;
+                uplinkKick(ucStatus);
+            }
             
+            // the server paces the fleet, its interval or back to ours
+            uplinkSetInterval(ucStatus, checkForInterval(response), STATUS_INTERVAL_JITTER_PCT);
+
+            // a tunable set for our cohort, confirmed with the next report
+            if (checkForTunables(response))
+            {
+                uplinkKick(ucStatus);
+            }
+
             // Check for command in response
             DeviceCommand_t cmd = checkForCommand(response);
             if (cmd != CMD_NONE)
@@ -442,11 +809,10 @@ static bool sendStatusUpdate(void)
                     saveNameToPreferences(newName);
                     
                     // Trigger an immediate update to confirm the new name to server
-                    doUpdate = true;
+                    uplinkKick(ucStatus);
                 }
             }
             
-            http.end();
             return true;
         }
         else
@@ -457,8 +823,11 @@ static bool sendStatusUpdate(void)
     else
     {
         Serial.printf("!!! StatusClient: Connection failed: %s\n", http.errorToString(httpCode).c_str());
+        lease.drop();
     }
     
+    // the server may or may not have applied it, start over with a full report
+    _needFull = true;
     http.end();
     return false;
 }
@@ -488,6 +857,24 @@ static DeviceCommand_t checkForCommand(const String& response)
     {
         return CMD_SLEEP;
     }
+    else if (strcmp(cmd, "snapshot") == 0)
+    {
+        return CMD_SNAPSHOT;
+    }
+    else if (strcmp(cmd, "reload_val") == 0)
+    {
+        return CMD_RELOAD_VAL;
+    }
+    else if (strcmp(cmd, "sync_bench") == 0)
+    {
+        return CMD_SYNC_BENCH;
+    }
+    else if (strcmp(cmd, "benchmark") == 0)
+    {
+        strlcpy(_benchSuite, doc["bench_suite"] | "all", sizeof(_benchSuite));
+        _benchIterations = doc["bench_iterations"] | (uint32_t)STATUS_BENCH_DEF_ITERATIONS;
+        return CMD_BENCHMARK;
+    }
     
     return CMD_NONE;
 }
@@ -519,6 +906,40 @@ static bool checkForNewName(const String& response, char* newNameOut, size_t max
     return true;
 }
 
+static uint32_t checkForInterval(const String& response)
+{
+    StaticJsonDocument<256> doc;
+    DeserializationError error = deserializeJson(doc, response);
+    
+    if (error)
+    {
+        return 0;
+    }
+    
+    uint32_t intervalMs = doc["status_interval_ms"] | 0UL;
+    if (intervalMs == 0)
+    {
+        return 0;
+    }
+    return constrain(intervalMs, (uint32_t)STATUS_INTERVAL_MIN_MS, (uint32_t)STATUS_INTERVAL_MAX_MS);
+}
+
+// Only sent while our tunable_set differs from the one the server assigns
+static bool checkForTunables(const String& response)
+{
+    if (response.indexOf("\"tunables\"") < 0)
+    {
+        return false;
+    }
+    JsonDocument doc;
+    if (deserializeJson(doc, response))
+    {
+        return false;
+    }
+    tunablesApply(doc["tunables"]);
+    return true;
+}
+
 static void processCommand(DeviceCommand_t cmd)
 {
     Serial.printf(">>> StatusClient: Processing command %d\n", cmd);
@@ -555,13 +976,41 @@ static void processCommand(DeviceCommand_t cmd)
             boardStartSleep(true, true);
             break;
         }
+
+        case CMD_SNAPSHOT:
+        {
+            Serial.println(">>> StatusClient: SNAPSHOT command received");
+            _snapshotWanted = true;
+            break;
+        }
+
+        case CMD_RELOAD_VAL:
+        {
+            Serial.println(">>> StatusClient: RELOAD_VAL command received");
+            _valReloadWanted = true;
+            break;
+        }
+
+        case CMD_SYNC_BENCH:
+        {
+            Serial.println(">>> StatusClient: SYNC_BENCH command received");
+            _syncBenchWanted = true;
+            break;
+        }
+
+        case CMD_BENCHMARK:
+        {
+            Serial.printf(">>> StatusClient: BENCHMARK command received, suite [%s]\n", _benchSuite);
+            _benchWanted = true;
+            break;
+        }
         
         default:
             break;
     }
 }
 
-static String getDeviceStatusString(DeviceStatus_t status)
+static const char* getDeviceStatusString(DeviceStatus_t status)
 {
     switch (status)
     {
@@ -576,50 +1025,6 @@ static String getDeviceStatusString(DeviceStatus_t status)
     }
 }
 
-static uint8_t calculateAccelActivity(void)
-{
-    if (_accelMutex == NULL || _accelSampleCount < 2)
-    {
-        return 1;  // Minimum activity if no data
-    }
-    
-    if (xSemaphoreTake(_accelMutex, pdMS_TO_TICKS(50)) != pdTRUE)
-    {
-        return _accelActivity;  // Return last known value
-    }
-    
-    // Calculate activity based on variance/movement in samples
-    float sumDelta = 0.0f;
-    
-    for (int i = 1; i < _accelSampleCount; i++)
-    {
-        int prevIdx = (i - 1) % 100;
-        int currIdx = i % 100;
-        
-        float dx = _accelSamples[currIdx][0] - _accelSamples[prevIdx][0];
-        float dy = _accelSamples[currIdx][1] - _accelSamples[prevIdx][1];
-        float dz = _accelSamples[currIdx][2] - _accelSamples[prevIdx][2];
-        
-        // Sum of absolute deltas
-        sumDelta += fabsf(dx) + fabsf(dy) + fabsf(dz);
-    }
-    
-    // Normalize to 1-100 range
-    // Assuming typical movement produces delta sum of 0-10g cumulative
-    float avgDelta = sumDelta / (_accelSampleCount - 1);
-    
-    // Scale: 0g = 1, 1g average delta = 100
-    int activity = (int)(avgDelta * 100.0f) + 1;
-    
-    // Clamp to 1-100
-    if (activity < 1) activity = 1;
-    if (activity > 100) activity = 100;
-    
-    xSemaphoreGive(_accelMutex);
-    
-    return (uint8_t)activity;
-}
-
 void statusClientPause(void)
 {
     delay(500); //to let the next activity start
@@ -632,6 +1037,11 @@ void statusClientResume(void)
     delay(150);
 }
 
+void statusClientSetBenchHook(tStatusBenchHook hook)
+{
+    _benchHook = hook;
+}
+
 // #include "statusClient.h"
 // #include "board.h"
 
@@ -4,10 +4,20 @@
 
 // ============== Configuration ==============
 #define STATUS_UPDATE_INTERVAL_MS   5000    // How often to send status updates
+#define STATUS_INTERVAL_MIN_MS      1000    // Bounds of the server's status_interval_ms
+#define STATUS_INTERVAL_MAX_MS      60000
+#define STATUS_INTERVAL_JITTER_PCT  10
 #define STATUS_ACCEL_SAMPLE_MS      5000    // Accelerometer sampling window for activity calculation
 #define STATUS_SERVER_PORT          5004    // Server port
 #define STATUS_GAME_STATUS_MAX_LEN  32      // Maximum length of game status string
 #define STATUS_DEVICE_NAME_MAX_LEN  32      // Maximum length of device name
+#define STATUS_UPLINK_PRIORITY      1       // Below the game API on the shared uplink
+#define STATUS_FULL_INTERVAL_MS     60000   // Full report at least this often, deltas in between
+#define STATUS_DELTA_RSSI           3       // dB change before RSSI is reported again
+#define STATUS_DELTA_BATTERY_MV     20
+#define STATUS_DELTA_RUNTIME_MIN    5       // change of the predicted runtime before it is reported again
+#define STATUS_DELTA_HEAP           1024
+#define STATUS_JSON_BUF             4352    // Upper bound of a full report with the task list, loop timing, hit latency, boot, energy and crash log reports
 
 // ============== Device Status Enum ==============
 typedef enum {
@@ -20,9 +30,20 @@ typedef enum {
 typedef enum {
     CMD_NONE = 0,
     CMD_REBOOT,
-    CMD_SLEEP
+    CMD_SLEEP,
+    CMD_SNAPSHOT,           // post the frame on the panel to the server's /snapshot
+    CMD_RELOAD_VAL,         // fetch val.json and val.bin from the server's /patterns and play them
+    CMD_SYNC_BENCH,         // run the sync benchmark (syncBench.h), post the report to the server's /syncbench
+    CMD_BENCHMARK           // run the bench_suite of the reply through the bench hook, post the report to /benchmark
 } DeviceCommand_t;
 
+#define STATUS_BENCH_SUITE_MAX_LEN  15
+#define STATUS_BENCH_DEF_ITERATIONS 100
+
+// Runs a named benchmark suite and prints its JSON report to out; the
+// benchmarks live with the firmware, the client only carries the command
+typedef bool (*tStatusBenchHook)(const char* suite, uint32_t iterations, Print &out);
+
 // ============== Initialization ==============
 /**
  * Initialize the status client
@@ -33,14 +54,21 @@ typedef enum {
 bool statusClientInit(const char* serverIP);
 
 /**
- * Start the status client task
+ * Use another status server port than STATUS_SERVER_PORT, from the discovery reply
+ * Takes effect with the next statusClientStart
+ * @param port Server port, 0 restores the default
+ */
+void statusClientSetServerPort(uint16_t port);
+
+/**
+ * Register the status updates on the shared uplink task
  * Should be called after WiFi is connected
  * @return true if task started successfully
  */
 bool statusClientStart(void);
 
 /**
- * Stop the status client task
+ * Stop the status updates
  */
 void statusClientStop(void);
 
@@ -76,25 +104,24 @@ uint8_t statusClientGetAccelActivity(void);
  */
 const char* statusClientGetName(void);
 
-// ============== Internal - called by accel sampling ==============
-/**
- * Feed accelerometer data for activity calculation
- * Should be called periodically with current accel values
- * @param x X-axis acceleration
- * @param y Y-axis acceleration  
- * @param z Z-axis acceleration
- */
-void statusClientFeedAccelData(float x, float y, float z);
-
 void statusClientPause(void);
 void statusClientResume(void);
 
+/**
+ * Set the hook the benchmark command runs, without one the command is ignored
+ * @param hook Suite runner, NULL removes it
+ */
+void statusClientSetBenchHook(tStatusBenchHook hook);
+
 // #pragma once
 
 // #include <Arduino.h>
 
 // // ============== Configuration ==============
 // #define STATUS_UPDATE_INTERVAL_MS   5000    // How often to send status updates
+#define STATUS_INTERVAL_MIN_MS      1000    // Bounds of the server's status_interval_ms
+#define STATUS_INTERVAL_MAX_MS      60000
+#define STATUS_INTERVAL_JITTER_PCT  10
 // #define STATUS_ACCEL_SAMPLE_MS      5000    // Accelerometer sampling window for activity calculation
 // #define STATUS_SERVER_PORT          5004    // Server port
 // #define STATUS_GAME_STATUS_MAX_LEN  32      // Maximum length of game status string
@@ -1,5 +1,8 @@
 #include "tft_utils.h"
 #include "rm67162.h"
+#include "tftCompositor.h"
+#include "tftDigits.h"
+#include "tftPalette.h"
 
 #define TFT_GAME_ICO_X  50
 #define TFT_GAME_ICO_Y  (240 - 160) / 2
@@ -8,14 +11,14 @@
 #define TFT_GAME_TOP_FONT   4
 #define TFT_GAME_BOT_FONT   4
 
-#define TFT_GAME_BASE_ICO_FNAME "/base_ico.bmp"
-#define TFT_GAME_ZOMB_ICO_FNAME "/zomb_ico.bmp"
-#define TFT_GAME_HUMN_ICO_FNAME "/hum_ico.bmp"
 
 #define TFT_GAME_B_COLOR       TFT_YELLOW
 #define TFT_GAME_H_COLOR       TFT_RED
 #define TFT_GAME_Z_COLOR       TFT_GREEN
 
+// The text sprites are 4-bit, black and the role colour at these indices
+#define TFT_GAME_PAL_BG     0
+#define TFT_GAME_PAL_TXT    1
 
 extern TFT_eSPI tft;
 extern TFT_eSprite spr;
@@ -32,9 +35,11 @@ static void drawBitmap(String fName)
     }
     bmpUpdated = true;
     fName__ = fName;
+    // the clear is flushed together with the icon by tftDrawBmp
     spr.fillSprite(TFT_BLACK);
+    tftDirtyAll();
     tftDrawBmp(fName.c_str(), TFT_GAME_ICO_X, TFT_GAME_ICO_Y, TFT_GAME_ICO_W, TFT_GAME_ICO_H);   
-    lcd_PushColors(0, 0, X_TFT_WIDTH, X_TFT_HEIGHT, (uint16_t *)spr.getPointer());
+    tftDirtyFlush();
 }
 
 static void drawStr1(uint16_t txtColor, String str1)
@@ -48,8 +53,8 @@ static void drawStr1(uint16_t txtColor, String str1)
     static String str1__ = "";
     if (!wasInit)
     {
+        sprStr1.setColorDepth(4);
         sprStr1.createSprite(sprWidth, sprHeight);
-        sprStr1.setSwapBytes(1);
         wasInit = true;
     }
     if ((str1 == str1__) && (!bmpUpdated))
@@ -57,12 +62,17 @@ static void drawStr1(uint16_t txtColor, String str1)
         return;
     }
     str1__ = str1;
-    sprStr1.fillSprite(TFT_BLACK);
-    sprStr1.setTextColor(txtColor, TFT_BLACK);
-    sprStr1.setTextSize(8);    
-    sprStr1.setTextDatum(MC_DATUM);    
-    sprStr1.drawString(str1, sprWidth/2, sprHeight/2, 1);    
-    lcd_PushColors(sprX, sprY, sprWidth, sprHeight, (uint16_t *)sprStr1.getPointer());
+    sprStr1.setPaletteColor(TFT_GAME_PAL_BG, TFT_BLACK);
+    sprStr1.setPaletteColor(TFT_GAME_PAL_TXT, txtColor);
+    sprStr1.fillSprite(TFT_GAME_PAL_BG);
+    if (!tftDigitsDraw(sprStr1, str1, sprWidth/2, sprHeight/2, 8, TFT_GAME_PAL_TXT, TFT_GAME_PAL_BG))
+    {
+        sprStr1.setTextColor(TFT_GAME_PAL_TXT, TFT_GAME_PAL_BG);
+        sprStr1.setTextSize(8);
+        sprStr1.setTextDatum(MC_DATUM);
+        sprStr1.drawString(str1, sprWidth/2, sprHeight/2, 1);
+    }
+    tftPalettePush(sprStr1, sprX, sprY);
 }
 
 static void drawStr2(uint16_t txtColor, String str2)
@@ -76,8 +86,8 @@ static void drawStr2(uint16_t txtColor, String str2)
     static String str2__ = "";
     if (!wasInit)
     {
+        sprStr2.setColorDepth(4);
         sprStr2.createSprite(sprWidth, sprHeight);
-        sprStr2.setSwapBytes(1);
         wasInit = true;
     }
     if ((str2 == str2__) && (!bmpUpdated))
@@ -85,12 +95,17 @@ static void drawStr2(uint16_t txtColor, String str2)
         return;
     }
     str2__ = str2;
-    sprStr2.fillSprite(TFT_BLACK);
-    sprStr2.setTextColor(txtColor, TFT_BLACK);
-    sprStr2.setTextSize(4);    
-    sprStr2.setTextDatum(MC_DATUM);        
-    sprStr2.drawString(str2, sprWidth/2, sprHeight/2, 1);    
-    lcd_PushColors(sprX, sprY, sprWidth, sprHeight, (uint16_t *)sprStr2.getPointer());
+    sprStr2.setPaletteColor(TFT_GAME_PAL_BG, TFT_BLACK);
+    sprStr2.setPaletteColor(TFT_GAME_PAL_TXT, txtColor);
+    sprStr2.fillSprite(TFT_GAME_PAL_BG);
+    if (!tftDigitsDraw(sprStr2, str2, sprWidth/2, sprHeight/2, 4, TFT_GAME_PAL_TXT, TFT_GAME_PAL_BG))
+    {
+        sprStr2.setTextColor(TFT_GAME_PAL_TXT, TFT_GAME_PAL_BG);
+        sprStr2.setTextSize(4);
+        sprStr2.setTextDatum(MC_DATUM);
+        sprStr2.drawString(str2, sprWidth/2, sprHeight/2, 1);
+    }
+    tftPalettePush(sprStr2, sprX, sprY);
 }
 
 static void drawSecStr(uint16_t txtColor, String secS)
@@ -104,8 +119,8 @@ static void drawSecStr(uint16_t txtColor, String secS)
     static String secS__ = "";
     if (!wasInit)
     {
+        sprSec.setColorDepth(4);
         sprSec.createSprite(sprWidth, sprHeight);
-        sprSec.setSwapBytes(1);
         wasInit = true;
     }
     if ((secS == secS__) && (!bmpUpdated))
@@ -113,16 +128,25 @@ static void drawSecStr(uint16_t txtColor, String secS)
         return;
     }
     secS__ = secS;
-    sprSec.fillSprite(TFT_BLACK);
-    sprSec.setTextColor(txtColor, TFT_BLACK);
-    sprSec.setTextSize(4);    
-    sprSec.setTextDatum(MC_DATUM);        
-    sprSec.drawString(secS, sprWidth/2, sprHeight/2, 1);    
-    lcd_PushColors(sprX, sprY, sprWidth, sprHeight, (uint16_t *)sprSec.getPointer());
+    sprSec.setPaletteColor(TFT_GAME_PAL_BG, TFT_BLACK);
+    sprSec.setPaletteColor(TFT_GAME_PAL_TXT, txtColor);
+    sprSec.fillSprite(TFT_GAME_PAL_BG);
+    if (!tftDigitsDraw(sprSec, secS, sprWidth/2, sprHeight/2, 4, TFT_GAME_PAL_TXT, TFT_GAME_PAL_BG))
+    {
+        sprSec.setTextColor(TFT_GAME_PAL_TXT, TFT_GAME_PAL_BG);
+        sprSec.setTextSize(4);
+        sprSec.setTextDatum(MC_DATUM);
+        sprSec.drawString(secS, sprWidth/2, sprHeight/2, 1);
+    }
+    tftPalettePush(sprSec, sprX, sprY);
 }
 
+// The text sprites go out through the palette bounce buffers, so each one is
+// rendered while the previous one is still on the bus; the shared spr stays
+// synchronous
 void tftGameScreenRaw(String fName, uint16_t txtColor, String str1, String str2, String secStr)
 {
+    lcd_WaitIdle();
     drawBitmap(fName);
     drawStr1(txtColor, str1);
     drawStr2(txtColor, str2);
@@ -187,6 +211,12 @@ void tftGameScreenZombie(int32_t topVal, int32_t botVal, uint32_t secLeft)
     tftGameScreenRaw(TFT_GAME_ZOMB_ICO_FNAME, TFT_GAME_Z_COLOR, String (topVal),  botVal2Str(botVal), mmss(secLeft));
 }
 
+// Base station scoreboard, humans against zombies
+void tftGameScreenScore(int32_t humans, int32_t zombies, uint32_t secLeft)
+{
+    tftGameScreenRaw(TFT_GAME_BASE_ICO_FNAME, TFT_GAME_B_COLOR, String(humans) + ":" + String(zombies), "H : Z", mmss(secLeft));
+}
+
 void tftGameScreenTest(void)
 {
     while(true)
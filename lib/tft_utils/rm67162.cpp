@@ -1,7 +1,10 @@
 #include "rm67162.h"
 #include "SPI.h"
 #include "Arduino.h"
+#include "energyProfile.h"
+#include "deviceClass.h"
 #include "driver/spi_master.h"
+#include "soc/gpio_struct.h"
 
 const static lcd_cmd_t rm67162_spi_init[] = {
     {0xFE, {0x00}, 0x01}, // PAGE
@@ -33,6 +36,125 @@ const static lcd_cmd_t rm67162_qspi_init[] = {
 
 static spi_device_handle_t spi;
 
+// Pixel data goes out as queued DMA transactions from a ring of descriptors,
+// the last one of a push raises CS from the driver's post callback
+static spi_transaction_ext_t lcdTrans[LCD_QUEUE_DEPTH];
+static uint32_t lcdNext = 0;
+static uint32_t lcdInFlight = 0;
+
+#define LCD_TRANS_LAST      ((void *)1)
+
+// Tearing-effect line: the panel raises it when its scan leaves the visible area
+static SemaphoreHandle_t teSem = NULL;
+
+static void IRAM_ATTR lcd_te_isr(void)
+{
+    BaseType_t woken = pdFALSE;
+    xSemaphoreGiveFromISR(teSem, &woken);
+    if (woken)
+    {
+        portYIELD_FROM_ISR();
+    }
+}
+
+static void IRAM_ATTR lcd_spi_post_cb(spi_transaction_t *t)
+{
+    if (t->user == LCD_TRANS_LAST)
+    {
+#if TFT_CS < 32
+        GPIO.out_w1ts = (1UL << TFT_CS);
+#else
+        GPIO.out1_w1ts.val = (1UL << (TFT_CS - 32));
+#endif
+    }
+}
+
+// Collects one finished transaction, the task sleeps on the driver's queue meanwhile
+static void lcd_reclaim(void)
+{
+    spi_transaction_t *done;
+    if (spi_device_get_trans_result(spi, &done, portMAX_DELAY) == ESP_OK)
+    {
+        lcdInFlight--;
+    }
+}
+
+void lcd_EnableTE(void)
+{
+    if (!devClass.display || (teSem != NULL))
+    {
+        return;
+    }
+    teSem = xSemaphoreCreateBinary();
+    pinMode(TFT_TE, INPUT);
+    attachInterrupt(digitalPinToInterrupt(TFT_TE), lcd_te_isr, RISING);
+}
+
+bool lcd_WaitTE(uint32_t timeoutMs)
+{
+    if (teSem == NULL)
+    {
+        return false;
+    }
+    // an edge left over from an earlier frame says nothing about now
+    xSemaphoreTake(teSem, 0);
+    return xSemaphoreTake(teSem, pdMS_TO_TICKS(timeoutMs)) == pdTRUE;
+}
+
+void lcd_WaitIdle(void)
+{
+#if LCD_USB_QSPI_DREVER == 1
+    while (lcdInFlight > 0)
+    {
+        lcd_reclaim();
+    }
+#endif
+}
+
+// Queues the pixels with CS already low, cmd/addr on the first chunk only;
+// returns once the last chunk is queued, the data must stay valid until then
+static void lcd_queue_pixels(uint16_t *p, size_t len)
+{
+    if constexpr (!devClass.display)
+    {
+        return;
+    }
+    bool first_send = 1;
+    do {
+        if (lcdInFlight == LCD_QUEUE_DEPTH) {
+            lcd_reclaim();
+        }
+        size_t chunk_size = len;
+        spi_transaction_ext_t &t = lcdTrans[lcdNext];
+        lcdNext = (lcdNext + 1) % LCD_QUEUE_DEPTH;
+        memset(&t, 0, sizeof(t));
+        if (first_send) {
+            t.base.flags =
+                SPI_TRANS_MODE_QIO /* | SPI_TRANS_MODE_DIOQIO_ADDR */;
+            t.base.cmd = 0x32 /* 0x12 */;
+            t.base.addr = 0x002C00;
+            first_send = 0;
+        } else {
+            t.base.flags = SPI_TRANS_MODE_QIO | SPI_TRANS_VARIABLE_CMD |
+                           SPI_TRANS_VARIABLE_ADDR | SPI_TRANS_VARIABLE_DUMMY;
+            t.command_bits = 0;
+            t.address_bits = 0;
+            t.dummy_bits = 0;
+        }
+        if (chunk_size > SEND_BUF_SIZE) {
+            chunk_size = SEND_BUF_SIZE;
+        }
+        t.base.tx_buffer = p;
+        t.base.length = chunk_size * 16;
+        len -= chunk_size;
+        p += chunk_size;
+        t.base.user = (len == 0) ? LCD_TRANS_LAST : NULL;
+
+        spi_device_queue_trans(spi, (spi_transaction_t *)&t, portMAX_DELAY);
+        lcdInFlight++;
+    } while (len > 0);
+}
+
 static void WriteComm(uint8_t data)
 {
     TFT_CS_L;
@@ -66,7 +188,13 @@ static void WriteData16(uint16_t data)
 
 static void lcd_send_cmd(uint32_t cmd, uint8_t *dat, uint32_t len)
 {
+    if constexpr (!devClass.display)
+    {
+        return;
+    }
 #if LCD_USB_QSPI_DREVER == 1
+    // polling transfers may not overtake the queued ones
+    lcd_WaitIdle();
     TFT_CS_L;
     spi_transaction_t t;
     memset(&t, 0, sizeof(t));
@@ -92,8 +220,13 @@ static void lcd_send_cmd(uint32_t cmd, uint8_t *dat, uint32_t len)
 #endif
 }
 
+// Headless builds keep the panel in reset, every command and push returns at once
 void rm67162_init(void)
 {
+    if constexpr (!devClass.display)
+    {
+        return;
+    }
     pinMode(TFT_CS, OUTPUT);
     pinMode(TFT_RES, OUTPUT);
 
@@ -124,7 +257,8 @@ void rm67162_init(void)
         .spics_io_num = -1,
         // .spics_io_num = TFT_QSPI_CS,
         .flags = SPI_DEVICE_HALFDUPLEX,
-        .queue_size = 17,
+        .queue_size = LCD_QUEUE_DEPTH + 1,
+        .post_cb = lcd_spi_post_cb,
     };
     ret = spi_bus_initialize(TFT_SPI_HOST, &buscfg, SPI_DMA_CH_AUTO);
     ESP_ERROR_CHECK(ret);
@@ -216,49 +350,34 @@ void lcd_DrawPoint(uint16_t x, uint16_t y, uint16_t color)
     lcd_PushColors(&color, 1);
 }
 
+void lcd_PushColorsAsync(uint16_t x,
+                         uint16_t y,
+                         uint16_t width,
+                         uint16_t high,
+                         uint16_t *data)
+{
+#if LCD_USB_QSPI_DREVER == 1
+    lcd_address_set(x, y, x + width - 1, y + high - 1);
+    TFT_CS_L;
+    lcd_queue_pixels(data, width * high);
+#else
+    lcd_PushColors(x, y, width, high, data);
+#endif
+}
+
 void lcd_PushColors(uint16_t x,
                     uint16_t y,
                     uint16_t width,
                     uint16_t high,
                     uint16_t *data)
 {
+    if constexpr (!devClass.display)
+    {
+        return;
+    }
 #if LCD_USB_QSPI_DREVER == 1
-    bool first_send = 1;
-    size_t len = width * high;
-    uint16_t *p = (uint16_t *)data;
-
-    lcd_address_set(x, y, x + width - 1, y + high - 1);
-    TFT_CS_L;
-    do {
-        size_t chunk_size = len;
-        spi_transaction_ext_t t = {0};
-        memset(&t, 0, sizeof(t));
-        if (first_send) {
-            t.base.flags =
-                SPI_TRANS_MODE_QIO /* | SPI_TRANS_MODE_DIOQIO_ADDR */;
-            t.base.cmd = 0x32 /* 0x12 */;
-            t.base.addr = 0x002C00;
-            first_send = 0;
-        } else {
-            t.base.flags = SPI_TRANS_MODE_QIO | SPI_TRANS_VARIABLE_CMD |
-                           SPI_TRANS_VARIABLE_ADDR | SPI_TRANS_VARIABLE_DUMMY;
-            t.command_bits = 0;
-            t.address_bits = 0;
-            t.dummy_bits = 0;
-        }
-        if (chunk_size > SEND_BUF_SIZE) {
-            chunk_size = SEND_BUF_SIZE;
-        }
-        t.base.tx_buffer = p;
-        t.base.length = chunk_size * 16;
-
-        // spi_device_queue_trans(spi, (spi_transaction_t *)&t, portMAX_DELAY);
-        spi_device_polling_transmit(spi, (spi_transaction_t *)&t);
-        len -= chunk_size;
-        p += chunk_size;
-    } while (len > 0);
-    TFT_CS_H;
-
+    lcd_PushColorsAsync(x, y, width, high, data);
+    lcd_WaitIdle();
 #else
     lcd_address_set(x, y, x + width - 1, y + high - 1);
     TFT_CS_L;
@@ -272,40 +391,15 @@ void lcd_PushColors(uint16_t x,
 
 void lcd_PushColors(uint16_t *data, uint32_t len)
 {
+    if constexpr (!devClass.display)
+    {
+        return;
+    }
 #if LCD_USB_QSPI_DREVER == 1
-    bool first_send = 1;
-    uint16_t *p = (uint16_t *)data;
+    lcd_WaitIdle();
     TFT_CS_L;
-    do {
-        size_t chunk_size = len;
-        spi_transaction_ext_t t = {0};
-        memset(&t, 0, sizeof(t));
-        if (first_send) {
-            t.base.flags =
-                SPI_TRANS_MODE_QIO /* | SPI_TRANS_MODE_DIOQIO_ADDR */;
-            t.base.cmd = 0x32 /* 0x12 */;
-            t.base.addr = 0x002C00;
-            first_send = 0;
-        } else {
-            t.base.flags = SPI_TRANS_MODE_QIO | SPI_TRANS_VARIABLE_CMD |
-                           SPI_TRANS_VARIABLE_ADDR | SPI_TRANS_VARIABLE_DUMMY;
-            t.command_bits = 0;
-            t.address_bits = 0;
-            t.dummy_bits = 0;
-        }
-        if (chunk_size > SEND_BUF_SIZE) {
-            chunk_size = SEND_BUF_SIZE;
-        }
-        t.base.tx_buffer = p;
-        t.base.length = chunk_size * 16;
-
-        // spi_device_queue_trans(spi, (spi_transaction_t *)&t, portMAX_DELAY);
-        spi_device_polling_transmit(spi, (spi_transaction_t *)&t);
-        len -= chunk_size;
-        p += chunk_size;
-    } while (len > 0);
-    TFT_CS_H;
-
+    lcd_queue_pixels(data, len);
+    lcd_WaitIdle();
 #else
     TFT_CS_L;
     SPI.beginTransaction(SPISettings(SPI_FREQUENCY, MSBFIRST, TFT_SPI_MODE));
@@ -316,6 +410,29 @@ void lcd_PushColors(uint16_t *data, uint32_t len)
 #endif
 }
 
+void lcd_setBrightness(uint8_t level)
+{
+    lcd_send_cmd(0x51, &level, 1);
+    energyProfLevel(esDisplay, level);
+}
+
+void lcd_setIdleMode(bool on)
+{
+    lcd_send_cmd(on ? 0x39 : 0x38, NULL, 0);
+}
+
+void lcd_setPartialMode(uint16_t startRow, uint16_t endRow)
+{
+    uint8_t area[4] = {(uint8_t)(startRow >> 8), (uint8_t)startRow, (uint8_t)(endRow >> 8), (uint8_t)endRow};
+    lcd_send_cmd(0x30, area, 4);
+    lcd_send_cmd(0x12, NULL, 0);
+}
+
+void lcd_setNormalMode(void)
+{
+    lcd_send_cmd(0x13, NULL, 0);
+}
+
 void lcd_sleep()
 {
     lcd_send_cmd(0x10, NULL, 0);
@@ -27,6 +27,8 @@
 #define TFT_CS_H digitalWrite(TFT_CS, 1);
 #define TFT_CS_L digitalWrite(TFT_CS, 0);
 
+#define LCD_QUEUE_DEPTH 16  // queued DMA transactions, a full frame takes 8 of SEND_BUF_SIZE
+
 typedef struct
 {
     uint8_t cmd;
@@ -51,4 +53,18 @@ void lcd_PushColors(uint16_t x,
                     uint16_t high,
                     uint16_t *data);
 void lcd_PushColors(uint16_t *data, uint32_t len);
+// Returns once the frame is queued for DMA, data must not change before lcd_WaitIdle()
+void lcd_PushColorsAsync(uint16_t x,
+                         uint16_t y,
+                         uint16_t width,
+                         uint16_t high,
+                         uint16_t *data);
+void lcd_WaitIdle(void);
+void lcd_EnableTE(void);                // TE (0x35) is on from init, this arms the interrupt
+bool lcd_WaitTE(uint32_t timeoutMs);    // false on timeout or when TE is not armed
+void lcd_setBrightness(uint8_t level);  // 0x51, 0 off .. 0xFF
+void lcd_setIdleMode(bool on);          // 0x39/0x38, 8 colours at a lower drive current
+// 0x30 and 0x12, rows are panel rows (the x axis in landscape); lcd_setNormalMode() ends it
+void lcd_setPartialMode(uint16_t startRow, uint16_t endRow);
+void lcd_setNormalMode(void);
 void lcd_sleep();
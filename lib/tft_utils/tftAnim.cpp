@@ -0,0 +1,283 @@
+#include "tftAnim.h"
+
+#include <FS.h>
+#include "TFT_eSPI.h"
+#include "PSRamFS.h"
+#include "assetPack.h"
+#include "streamFs.h"
+#include "tftCompositor.h"
+
+extern TFT_eSprite spr;
+
+#define TFT_ANIM_MAX_DROPS      3       // a late frame is pushed anyway after this many dropped in a row
+
+// Where the ops come from: the mapped asset image, or the PSRAM copy read
+// ahead in TFT_ANIM_READ_BUF blocks
+struct tAnimSource
+{
+    const uint8_t *mem = NULL;
+    fs::File file;
+    uint32_t size = 0;
+    uint32_t pos = 0;
+    uint32_t end = 0;       // of the frame or table being read
+    uint8_t buf[TFT_ANIM_READ_BUF];
+    uint16_t bufLen = 0;
+    uint16_t bufPos = 0;
+};
+
+static tAnimSource src;
+static tTftAnimStats animStats;
+
+static void seekSource(uint32_t pos, uint32_t end)
+{
+    src.pos = pos;
+    src.end = min(end, src.size);
+    if (src.mem == NULL)
+    {
+        src.file.seek(pos);
+        src.bufLen = src.bufPos = 0;
+    }
+}
+
+static bool readSource(void *dst, size_t n)
+{
+    if (src.pos + n > src.end)
+    {
+        return false;
+    }
+    if (src.mem != NULL)
+    {
+        memcpy(dst, src.mem + src.pos, n);
+        src.pos += n;
+        return true;
+    }
+    uint8_t *out = (uint8_t *)dst;
+    while (n > 0)
+    {
+        if (src.bufPos == src.bufLen)
+        {
+            src.bufLen = src.file.read(src.buf, min((uint32_t)sizeof(src.buf), src.end - src.pos));
+            src.bufPos = 0;
+            if (src.bufLen == 0)
+            {
+                return false;
+            }
+        }
+        size_t k = min(n, (size_t)(src.bufLen - src.bufPos));
+        memcpy(out, src.buf + src.bufPos, k);
+        src.bufPos += k;
+        src.pos += k;
+        out += k;
+        n -= k;
+    }
+    return true;
+}
+
+static bool openSource(const char *filename)
+{
+    const uint8_t *data;
+    size_t size;
+    src.mem = NULL;
+    if (assetPackFind(filename, &data, &size))
+    {
+        src.mem = data;
+        src.size = size;
+        return true;
+    }
+    // one PSRAM had no room for, or of the stream tier, is read from LittleFS
+    src.file = PSRamFS.exists(filename) ? PSRamFS.open(filename, "r") : StreamFS.open(filename, "r");
+    if (!src.file)
+    {
+        return false;
+    }
+    src.size = src.file.size();
+    return true;
+}
+
+static void closeSource(void)
+{
+    if (src.mem == NULL)
+    {
+        src.file.close();
+    }
+    src.mem = NULL;
+}
+
+// Frame i into the window of spr, [first, last] are the pixels it changed
+static bool decodeFrame(const tTftAnimHeader &hdr, uint16_t i, int32_t &first, int32_t &last)
+{
+    uint32_t range[2];
+    seekSource(sizeof(tTftAnimHeader) + i * sizeof(uint32_t), sizeof(tTftAnimHeader) + (hdr.frames + 1) * sizeof(uint32_t));
+    if (!readSource(range, sizeof(range)) || (range[1] < range[0]) || (range[1] > src.size))
+    {
+        return false;
+    }
+    seekSource(range[0], range[1]);
+
+    uint16_t *fb = (uint16_t *)spr.getPointer();
+    int16_t fbW = spr.width();
+    int32_t total = (int32_t)hdr.w * hdr.h;
+    int32_t p = 0;
+    first = -1;
+    while ((src.pos < src.end) && (p < total))
+    {
+        uint8_t op;
+        if (!readSource(&op, 1))
+        {
+            return false;
+        }
+        uint8_t kind = op >> 6;
+        uint32_t n = op & 0x3F;
+        uint16_t color = 0;
+        if (n == 0)
+        {
+            uint16_t count;
+            if (!readSource(&count, sizeof(count)))
+            {
+                return false;
+            }
+            n = count;
+        }
+        if ((n == 0) || (kind > TFT_ANIM_OP_LITERAL) || (p + (int32_t)n > total) ||
+            ((kind == TFT_ANIM_OP_RUN) && !readSource(&color, 2)))
+        {
+            return false;
+        }
+        if (kind != TFT_ANIM_OP_SKIP)
+        {
+            if (first < 0)
+            {
+                first = p;
+            }
+            last = p + n - 1;
+        }
+        // ops run on across rows, the window does not
+        while (n > 0)
+        {
+            int32_t col = p % hdr.w;
+            uint32_t k = min(n, (uint32_t)(hdr.w - col));
+            uint16_t *dst = fb + (int32_t)(hdr.y + p / hdr.w) * fbW + hdr.x + col;
+            if (kind == TFT_ANIM_OP_RUN)
+            {
+                for (uint32_t j = 0; j < k; j++)
+                {
+                    dst[j] = color;
+                }
+            }
+            else if ((kind == TFT_ANIM_OP_LITERAL) && !readSource(dst, k * sizeof(uint16_t)))
+            {
+                return false;
+            }
+            p += k;
+            n -= k;
+        }
+    }
+    return true;
+}
+
+bool tftAnimAvailable(const char *filename)
+{
+    const uint8_t *data;
+    size_t size;
+    return assetPackFind(filename, &data, &size) || PSRamFS.exists(filename) || StreamFS.exists(filename);
+}
+
+static bool aborted(tTftAnimAbortFn abortFn)
+{
+    return (abortFn != NULL) && abortFn();
+}
+
+tTftAnimResult tftAnimPlay(const char *filename, tTftAnimAbortFn abortFn)
+{
+    if (!openSource(filename))
+    {
+        return taNone;
+    }
+    tTftAnimHeader hdr;
+    seekSource(0, sizeof(hdr));
+    if (!readSource(&hdr, sizeof(hdr)) || (hdr.magic != TFT_ANIM_MAGIC) || (hdr.version != TFT_ANIM_VERSION) ||
+        (hdr.frames == 0) || (hdr.w == 0) || (hdr.h == 0) ||
+        (hdr.x + hdr.w > spr.width()) || (hdr.y + hdr.h > spr.height()))
+    {
+        Serial.printf("!!! tftAnimPlay ERROR: <%s> is not a %dx%d animation\r\n", filename, spr.width(), spr.height());
+        closeSource();
+        return taError;
+    }
+
+    bool loop = hdr.flags & TFT_ANIM_FLAG_LOOP;
+    uint32_t frameMs = 1000 / constrain(hdr.fps, 1, TFT_ANIM_MAX_FPS);
+    uint32_t startMs = millis();
+    uint32_t decoded = 0;
+    uint32_t shown = 0;
+    uint32_t dropped = 0;
+    uint8_t dropRun = 0;
+    tTftAnimResult result = taDone;
+    animStats.played++;
+    do
+    {
+        for (uint16_t i = 0; (i < hdr.frames) && (result == taDone); i++)
+        {
+            if (aborted(abortFn))
+            {
+                result = taAborted;
+                break;
+            }
+            int32_t first;
+            int32_t last;
+            if (!decodeFrame(hdr, i, first, last))
+            {
+                Serial.printf("!!! tftAnimPlay ERROR: <%s> frame %u is corrupt\r\n", filename, i);
+                result = taError;
+                break;
+            }
+            if (first >= 0)
+            {
+                int16_t r0 = first / hdr.w;
+                int16_t r1 = last / hdr.w;
+                tftDirtyAdd(hdr.x, hdr.y + r0, hdr.w, r1 - r0 + 1);
+            }
+            decoded++;
+
+            // the frame is late once the next one is due, it goes out with the next
+            uint32_t due = startMs + decoded * frameMs;
+            bool lastFrame = !loop && (i + 1 == hdr.frames);
+            if (((int32_t)(millis() - due) > 0) && !lastFrame && (dropRun < TFT_ANIM_MAX_DROPS))
+            {
+                dropped++;
+                dropRun++;
+                continue;
+            }
+            dropRun = 0;
+            tftDirtyFlush();
+            shown++;
+            int32_t waitMs;
+            while (!lastFrame && ((waitMs = (int32_t)(due - millis())) > 0))
+            {
+                if (aborted(abortFn))
+                {
+                    result = taAborted;
+                    break;
+                }
+                vTaskDelay(pdMS_TO_TICKS(min((int32_t)TFT_ANIM_POLL_MS, waitMs)));
+            }
+        }
+    } while (loop && (result == taDone));
+    closeSource();
+    // what was decoded but not pushed goes out, spr and the panel agree again
+    tftDirtyFlush();
+
+    animStats.shown += shown;
+    animStats.dropped += dropped;
+    if (result == taAborted)
+    {
+        animStats.aborted++;
+    }
+    Serial.printf(">>> tftAnimPlay: <%s> %u frames shown, %u dropped in %lu ms%s\r\n", filename, shown, dropped,
+                  millis() - startMs, (result == taAborted) ? ", aborted" : "");
+    return result;
+}
+
+void tftAnimGetStats(tTftAnimStats &st)
+{
+    st = animStats;
+}
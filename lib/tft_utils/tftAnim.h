@@ -0,0 +1,73 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Sprite-sheet animations for the transition screens, one ".zan" file made by
+// servers/SingleSystemServer/make_animation.py from BMP frames. The player
+// reads it straight from the mapped asset image or its PSRAM copy, decodes a
+// frame into spr and sends what changed through the compositor (a full frame
+// on TE, otherwise the changed rows); a frame that falls behind its slot is
+// decoded but not pushed, the next one on time carries its changes along.
+//
+// Layout (little endian): tTftAnimHeader, frames + 1 u32 offsets from the
+// start of the file (the last one is the end of the last frame), then the
+// frames. A frame is a list of ops walking its w x h window row by row, the
+// first op byte holds the kind in bits 7..6 and a count of 1..63 pixels in
+// bits 5..0; a count of 0 means a u16 count follows:
+//   skip       the pixels keep the previous frame's colour
+//   run        one RGB565 colour, big endian, for all of them
+//   literal    count RGB565 colours, big endian
+// The first frame covers the whole window, later ones are deltas; ops that end
+// early leave the rest of the window unchanged.
+
+#define TFT_ANIM_MAGIC          0x314E415A  // "ZAN1"
+#define TFT_ANIM_VERSION        1
+#define TFT_ANIM_MAX_FPS        30
+#define TFT_ANIM_POLL_MS        10          // abort checks while waiting for the next frame
+#define TFT_ANIM_READ_BUF       1024        // ops read ahead from a PSRAM copy
+
+#define TFT_ANIM_FLAG_LOOP      0x01        // plays until aborted
+
+#define TFT_ANIM_OP_SKIP        0
+#define TFT_ANIM_OP_RUN         1
+#define TFT_ANIM_OP_LITERAL     2
+
+struct __attribute__((packed)) tTftAnimHeader
+{
+    uint32_t magic;
+    uint8_t  version;
+    uint8_t  flags;         // TFT_ANIM_FLAG_*
+    uint8_t  fps;
+    uint8_t  reserved;
+    uint16_t x;             // window on the panel
+    uint16_t y;
+    uint16_t w;
+    uint16_t h;
+    uint16_t frames;
+    uint16_t reserved2;
+};
+
+enum tTftAnimResult
+{
+    taNone,                 // no such animation, the caller draws its picture
+    taDone,
+    taAborted,
+    taError
+};
+
+struct tTftAnimStats
+{
+    uint32_t played = 0;
+    uint32_t shown = 0;     // frames pushed
+    uint32_t dropped = 0;   // frames decoded too late to push
+    uint32_t aborted = 0;
+};
+
+// Polled between frames, true ends the animation where it is
+typedef bool (*tTftAnimAbortFn)(void);
+
+bool tftAnimAvailable(const char *filename);
+// Screen task only, returns when the animation ended or abortFn asked for it;
+// the last frame drawn stays in spr
+tTftAnimResult tftAnimPlay(const char *filename, tTftAnimAbortFn abortFn = NULL);
+void tftAnimGetStats(tTftAnimStats &st);
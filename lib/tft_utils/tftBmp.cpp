@@ -3,6 +3,13 @@
 #include "TFT_eSPI.h"
 #include "rm67162.h"
 #include "PSRamFS.h"
+#include "assetPack.h"
+#include "serverSync.h"
+#include "tftCompositor.h"
+#include "tftImageCache.h"
+#include "tftFrame.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
 
 extern TFT_eSprite spr;
 
@@ -23,7 +30,557 @@ uint32_t read32(fs::File &f)
     ((uint8_t *)&result)[3] = f.read(); // MSB
     return result;
 }
-#include "true_color.h"
+
+static inline uint32_t mapped32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline uint16_t mapped16(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static inline uint16_t bgrToRgb565(const uint8_t *p)
+{
+    return ((p[2] & 0xF8) << 8) | ((p[1] & 0xFC) << 3) | (p[0] >> 3);
+}
+
+// Two pixels as one little-endian word, bytes swapped within each pixel when asked
+static inline uint32_t pixelPair(uint32_t lo, uint32_t hi, bool swapBytes)
+{
+    uint32_t pair = lo | (hi << 16);
+    return swapBytes ? (((pair >> 8) & 0x00FF00FF) | ((pair << 8) & 0xFF00FF00)) : pair;
+}
+
+// the kernel may run in place, so its wider accesses must not be assumed apart
+typedef uint32_t __attribute__((may_alias)) tAliasWord;
+typedef uint16_t __attribute__((may_alias)) tAliasHalf;
+
+// BGR888 rows to RGB565, four pixels from three aligned word loads; the first
+// (src & 3) pixels go one by one, which leaves src word aligned. Works in place
+// (dst == src) as the output never overtakes the input.
+void tftBgr888ToRgb565(const uint8_t *src, uint16_t *dstPx, uint32_t n, bool swapBytes)
+{
+    tAliasHalf *dst = dstPx;
+    uint32_t lead = min((uint32_t)((uintptr_t)src & 3), n);
+    for (uint32_t i = 0; i < lead; i++, src += 3)
+    {
+        uint16_t c = bgrToRgb565(src);
+        *dst++ = swapBytes ? (uint16_t)((c >> 8) | (c << 8)) : c;
+    }
+    n -= lead;
+
+    const tAliasWord *in = (const tAliasWord *)src;
+    bool wordOut = ((uintptr_t)dst & 3) == 0;
+    for (; n >= 4; n -= 4, in += 3, dst += 4)
+    {
+        // B0 G0 R0 B1 | G1 R1 B2 G2 | R2 B3 G3 R3
+        uint32_t w0 = in[0];
+        uint32_t w1 = in[1];
+        uint32_t w2 = in[2];
+        uint32_t p0 = ((w0 >> 8) & 0xF800) | ((w0 >> 5) & 0x07E0) | ((w0 >> 3) & 0x001F);
+        uint32_t p1 = (w1 & 0xF800) | ((w1 << 3) & 0x07E0) | (w0 >> 27);
+        uint32_t p2 = ((w2 << 8) & 0xF800) | ((w1 >> 21) & 0x07E0) | ((w1 >> 19) & 0x001F);
+        uint32_t p3 = ((w2 >> 16) & 0xF800) | ((w2 >> 13) & 0x07E0) | ((w2 >> 11) & 0x001F);
+        uint32_t a = pixelPair(p0, p1, swapBytes);
+        uint32_t b = pixelPair(p2, p3, swapBytes);
+        if (wordOut)
+        {
+            ((tAliasWord *)dst)[0] = a;
+            ((tAliasWord *)dst)[1] = b;
+        }
+        else
+        {
+            dst[0] = a;
+            dst[1] = a >> 16;
+            dst[2] = b;
+            dst[3] = b >> 16;
+        }
+    }
+
+    src = (const uint8_t *)in;
+    for (; n > 0; n--, src += 3)
+    {
+        uint16_t c = bgrToRgb565(src);
+        *dst++ = swapBytes ? (uint16_t)((c >> 8) | (c << 8)) : c;
+    }
+}
+
+// Bitmaps pre-converted by the server (enc=rgb565 file sync, asset image):
+// "Z565", width u16, height u16, 8 reserved bytes, then the rows top down in
+// the byte order of the sprite buffer, so drawing is a copy
+#define RGB565_MAGIC        0x3536355A  // "Z565"
+#define RGB565_HDR_SIZE     16
+
+// Copies the rows clipped to a 16-bit sprite, from pixels in memory (mapped
+// flash, the image cache) or, with px NULL, from the Z565 file; a full-width
+// image is one copy
+static void rgb565ToSprite(TFT_eSprite &dst, int16_t x, int16_t y, uint16_t w, uint16_t h,
+                           const uint8_t *px, fs::File *file)
+{
+    uint16_t *fb = (uint16_t *)dst.getPointer();
+    int16_t dw = dst.width();
+    int16_t x0 = max((int16_t)0, x);
+    int16_t x1 = min((int)(x + w), (int)dw);
+    int16_t r0 = max(0, -y);
+    int16_t r1 = min((int)h, dst.height() - y);
+    if ((fb == NULL) || (dst.getColorDepth() != 16) || (x1 <= x0) || (r1 <= r0))
+    {
+        return;
+    }
+    if (&dst == &spr)
+    {
+        tftDirtyAdd(x0, y + r0, x1 - x0, r1 - r0);
+    }
+    size_t len = (x1 - x0) * sizeof(uint16_t);
+    int16_t rows = r1 - r0;
+    if (w == dw)
+    {
+        len *= rows;
+        rows = 1;
+    }
+    for (int16_t r = r0; r < r0 + rows; r++)
+    {
+        uint8_t *dstRow = (uint8_t *)(fb + (int32_t)(y + r) * dw + x0);
+        size_t at = ((size_t)r * w + (x0 - x)) * sizeof(uint16_t);
+        if (px)
+        {
+            memcpy(dstRow, px + at, len);
+        }
+        else
+        {
+            file->seek(RGB565_HDR_SIZE + at);
+            file->read(dstRow, len);
+        }
+    }
+}
+
+// Draws the file when it holds a Z565 image, otherwise rewinds it and returns false
+bool tftRgb565FileToSprite(fs::File &f, int16_t x, int16_t y, TFT_eSprite &dst)
+{
+    uint8_t hdr[RGB565_HDR_SIZE];
+    if ((f.read(hdr, sizeof(hdr)) != sizeof(hdr)) || (mapped32(hdr) != RGB565_MAGIC))
+    {
+        f.seek(0);
+        return false;
+    }
+    uint16_t w = mapped16(hdr + 4);
+    uint16_t h = mapped16(hdr + 6);
+    if (f.size() < RGB565_HDR_SIZE + (size_t)w * h * sizeof(uint16_t))
+    {
+        Serial.printf("!!! tftRgb565FileToSprite ERROR: <%s> is truncated\r\n", f.name());
+        return true;
+    }
+    uint32_t startTime = millis();
+    rgb565ToSprite(dst, x, y, w, h, NULL, &f);
+    Serial.printf(">>> <%s> copied in %lu ms\r\n", f.name(), millis() - startTime);
+    return true;
+}
+
+// Geometry of an uncompressed 24-bit BMP that fits its size; false otherwise
+static bool bmpGeometry(const uint8_t *hdr, size_t size, uint32_t &seekOffset, uint16_t &w, uint16_t &h, uint32_t &rowSize)
+{
+    seekOffset = mapped32(hdr + 10);
+    w = mapped32(hdr + 18);
+    h = mapped32(hdr + 22);
+    rowSize = (w * 3 + 3) & ~3;
+    return (mapped16(hdr) == 0x4D42) && (mapped16(hdr + 26) == 1) && (mapped16(hdr + 28) == 24) &&
+           (mapped32(hdr + 30) == 0) && (seekOffset + rowSize * h <= size);
+}
+
+// The rows of the BMP from memory or, with mem NULL, from the file, top down into px
+static bool bmpDecode(const uint8_t *mem, fs::File *file, uint32_t seekOffset, uint16_t w, uint16_t h,
+                      uint32_t rowSize, uint16_t *px)
+{
+    uint8_t lineBuffer[mem ? 1 : rowSize];
+    for (uint16_t r = 0; r < h; r++)
+    {
+        // bottom up in the file, top down in the cache
+        uint32_t at = seekOffset + (uint32_t)(h - 1 - r) * rowSize;
+        const uint8_t *bptr = mem + at;
+        if (!mem)
+        {
+            file->seek(at);
+            if (file->read(lineBuffer, rowSize) != rowSize)
+            {
+                return false;
+            }
+            bptr = lineBuffer;
+        }
+        tftBgr888ToRgb565(bptr, px + (uint32_t)r * w, w, true);
+    }
+    return true;
+}
+
+static bool bmpHeader(const uint8_t *mem, fs::File *file, uint8_t *hdr)
+{
+    if (mem)
+    {
+        memcpy(hdr, mem, 54);
+        return true;
+    }
+    return file->read(hdr, 54) == 54;
+}
+
+// Decodes a 24-bit BMP from memory or, with mem NULL, from the file into the
+// image cache the first time, then copies it; false (the file rewound) when it
+// is not such a BMP or does not fit the cache, for the row-by-row path to draw
+static bool cachedBmpToSprite(const char *name, const uint8_t *mem, fs::File *file, size_t size,
+                              int16_t x, int16_t y, TFT_eSprite &dst)
+{
+    tftImageCacheLock();
+    const tTftCachedImage *img = tftImageCacheGet(name, size);
+    if (img == NULL)
+    {
+        uint8_t hdr[54];
+        uint32_t seekOffset, rowSize;
+        uint16_t w, h;
+        uint16_t *px = NULL;
+        if (bmpHeader(mem, file, hdr) && bmpGeometry(hdr, size, seekOffset, w, h, rowSize))
+        {
+            px = tftImageCacheAlloc(name, size, w, h);
+        }
+        uint32_t startTime = millis();
+        if ((px != NULL) && !bmpDecode(mem, file, seekOffset, w, h, rowSize, px))
+        {
+            tftImageCacheDrop(name);
+            px = NULL;
+        }
+        if (px == NULL)
+        {
+            tftImageCacheUnlock();
+            if (file)
+            {
+                file->seek(0);
+            }
+            return false;
+        }
+        Serial.printf(">>> <%s> decoded to the image cache in %lu ms (%lu bytes cached)\r\n",
+                      name, millis() - startTime, tftImageCacheUsed());
+        img = tftImageCacheGet(name, size);
+    }
+    rgb565ToSprite(dst, x, y, img->w, img->h, (const uint8_t *)img->px, NULL);
+    tftImageCacheUnlock();
+    return true;
+}
+
+// Decodes into a buffer of its own, outside the cache lock, so the screen
+// task is not held up behind a prefetch; the cache takes the pixels after
+static bool prefetchBmp(const char *name, const uint8_t *mem, fs::File *file, size_t size)
+{
+    tftImageCacheLock();
+    bool cached = tftImageCacheGet(name, size) != NULL;
+    tftImageCacheUnlock();
+    uint8_t hdr[54];
+    uint32_t seekOffset, rowSize;
+    uint16_t w, h;
+    if (cached || !bmpHeader(mem, file, hdr) || !bmpGeometry(hdr, size, seekOffset, w, h, rowSize))
+    {
+        return cached;
+    }
+    uint16_t *px = (uint16_t *)ps_malloc((uint32_t)w * h * sizeof(uint16_t));
+    if (px == NULL)
+    {
+        return false;
+    }
+    if (!bmpDecode(mem, file, seekOffset, w, h, rowSize, px))
+    {
+        free(px);
+        return false;
+    }
+    tftImageCacheLock();
+    bool ok = tftImageCacheInsert(name, size, w, h, px);
+    tftImageCacheUnlock();
+    return ok;
+}
+
+// Gets a picture ready to draw without drawing it: a PSRAM copy of the file
+// and, for a 24-bit BMP, its decoded pixels in the image cache; Z565 images
+// are copied as they are, the PSRAM copy is all they need
+bool tftBmpPrefetch(const char *filename)
+{
+    const uint8_t *bmp;
+    size_t size;
+    tAssetFormat format;
+    if (assetPackFind(filename, &bmp, &size, &format))
+    {
+        return (format != afBmp) || ((size >= 54) && prefetchBmp(filename, bmp, NULL, size));
+    }
+    fs::FS *bmpFs = assetFsFor(filename);
+    if (bmpFs == NULL)
+    {
+        return false;
+    }
+    fs::File f = bmpFs->open(filename, "r");
+    if (!f)
+    {
+        return false;
+    }
+    uint8_t magic[4];
+    bool ok = (f.read(magic, sizeof(magic)) == sizeof(magic)) && (mapped32(magic) == RGB565_MAGIC);
+    if (!ok)
+    {
+        f.seek(0);
+        ok = prefetchBmp(filename, NULL, &f, f.size());
+    }
+    f.close();
+    return ok;
+}
+
+// The PSRAM copy of a BMP through the image cache
+bool tftCachedBmpFileToSprite(fs::File &f, const char *filename, int16_t x, int16_t y, TFT_eSprite &dst)
+{
+    return cachedBmpToSprite(filename, NULL, &f, f.size(), x, y, dst);
+}
+
+// Draws a bitmap from the mapped asset image into the sprite, copying a
+// pre-converted one or decoding a 24-bit BMP straight from flash; false when
+// the file is not in the image
+bool tftPackedBmpToSprite(const char *filename, int16_t x, int16_t y, TFT_eSprite &dst)
+{
+    const uint8_t *bmp;
+    size_t size;
+    tAssetFormat format;
+    if (!assetPackFind(filename, &bmp, &size, &format))
+    {
+        return false;
+    }
+    if ((format == afRgb565) && (size >= RGB565_HDR_SIZE) && (mapped32(bmp) == RGB565_MAGIC))
+    {
+        uint16_t w = mapped16(bmp + 4);
+        uint16_t h = mapped16(bmp + 6);
+        if (RGB565_HDR_SIZE + (size_t)w * h * sizeof(uint16_t) <= size)
+        {
+            rgb565ToSprite(dst, x, y, w, h, bmp + RGB565_HDR_SIZE, NULL);
+            return true;
+        }
+    }
+    if ((format != afBmp) || (size < 54))
+    {
+        return false;
+    }
+    if (cachedBmpToSprite(filename, bmp, NULL, size, x, y, dst))
+    {
+        return true;
+    }
+    uint32_t seekOffset = mapped32(bmp + 10);
+    uint16_t w = mapped32(bmp + 18);
+    uint16_t h = mapped32(bmp + 22);
+    uint16_t padding = (4 - ((w * 3) & 3)) & 3;
+    uint32_t rowSize = w * 3 + padding;
+    if ((mapped16(bmp) != 0x4D42) || (mapped16(bmp + 26) != 1) || (mapped16(bmp + 28) != 24) ||
+        (mapped32(bmp + 30) != 0) || (seekOffset + rowSize * h > size))
+    {
+        Serial.println("BMP format not recognized.");
+        return true;
+    }
+
+    uint32_t startTime = millis();
+    if (&dst == &spr)
+    {
+        tftDirtyAdd(x, y, w, h);
+    }
+    bool oldSwapBytes = dst.getSwapBytes();
+    dst.setSwapBytes(true);
+    uint16_t lineBuffer[w];
+    const uint8_t *row = bmp + seekOffset;
+    y += h - 1;
+    for (uint16_t r = 0; r < h; r++, row += rowSize)
+    {
+        tftBgr888ToRgb565(row, lineBuffer, w, false);
+        // bottom up, as in the file
+        dst.pushImage(x, y--, w, 1, lineBuffer, 16);
+    }
+    dst.setSwapBytes(oldSwapBytes);
+    Serial.printf(">>> <%s> drawn from flash in %lu ms\r\n", filename, millis() - startTime);
+    return true;
+}
+
+// Full-screen pictures skip the sprite push: a band is read and converted into
+// one of two DMA bounce buffers in internal RAM while the band before goes out
+// into its own panel window, so the top of the picture shows before the rest
+// is decoded. spr and, for a BMP, the image cache take the same rows, partial
+// redraws and the next draw find the picture there
+#ifndef TFT_BMP_STREAM
+#define TFT_BMP_STREAM          1
+#endif
+#define TFT_BMP_BAND_ROWS       8       // rows per bounce buffer, two of 8.4 KB
+
+static uint16_t *bandBuf[2] = {NULL, NULL};
+
+struct tBandSource
+{
+    const uint8_t *mem;     // the bytes in memory, NULL: from file
+    fs::File *file;
+    uint32_t first;         // offset of the top row
+    int32_t stride;         // to the next row down, negative for a bottom-up BMP
+    bool bgr888;            // BMP rows, else RGB565 in the sprite's byte order
+};
+
+static bool allocBands(void)
+{
+    for (int i = 0; i < 2; i++)
+    {
+        if (bandBuf[i] == NULL)
+        {
+            bandBuf[i] = (uint16_t *)heap_caps_malloc(TFT_BMP_BAND_ROWS * X_TFT_WIDTH * sizeof(uint16_t),
+                                                      MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+        }
+    }
+    return (bandBuf[0] != NULL) && (bandBuf[1] != NULL);
+}
+
+static bool bandRows(const tBandSource &src, int16_t row, int16_t rows, uint16_t *dst, uint8_t *line)
+{
+    size_t len = X_TFT_WIDTH * (src.bgr888 ? 3 : sizeof(uint16_t));
+    for (int16_t k = 0; k < rows; k++, dst += X_TFT_WIDTH)
+    {
+        uint32_t at = src.first + (int32_t)(row + k) * src.stride;
+        const uint8_t *p = src.mem ? src.mem + at : NULL;
+        if (!src.mem)
+        {
+            uint8_t *into = src.bgr888 ? line : (uint8_t *)dst;
+            if (!src.file->seek(at) || (src.file->read(into, len) != len))
+            {
+                return false;
+            }
+            p = into;
+        }
+        if (src.bgr888)
+        {
+            tftBgr888ToRgb565(p, dst, X_TFT_WIDTH, true);
+        }
+        else if (src.mem)
+        {
+            memcpy(dst, p, len);
+        }
+    }
+    return true;
+}
+
+static bool streamBands(const char *name, const tBandSource &src, uint16_t *cachePx)
+{
+    uint16_t *fb = (uint16_t *)spr.getPointer();
+    uint8_t line[(src.bgr888 && !src.mem) ? X_TFT_WIDTH * 3 : 1];
+    int64_t startUs = esp_timer_get_time();
+    uint32_t firstUs = 0;
+    uint8_t next = 0;
+    // the frame before is out, the bands do not land in the middle of it
+    lcd_WaitIdle();
+    for (int16_t row = 0; row < X_TFT_HEIGHT; row += TFT_BMP_BAND_ROWS)
+    {
+        int16_t rows = min((int16_t)TFT_BMP_BAND_ROWS, (int16_t)(X_TFT_HEIGHT - row));
+        uint16_t *band = bandBuf[next];
+        if (!bandRows(src, row, rows, band, line))
+        {
+            lcd_WaitIdle();
+            Serial.printf("!!! tftDrawBmp ERROR: <%s> ends at row %d\r\n", name, row);
+            return false;
+        }
+        lcd_PushColorsAsync(0, row, X_TFT_WIDTH, rows, band);
+        if (row == 0)
+        {
+            firstUs = (uint32_t)(esp_timer_get_time() - startUs);
+        }
+        // copied while the band is on the bus, DMA only reads it
+        size_t bytes = (size_t)rows * X_TFT_WIDTH * sizeof(uint16_t);
+        memcpy(fb + (int32_t)row * X_TFT_WIDTH, band, bytes);
+        if (cachePx != NULL)
+        {
+            memcpy(cachePx + (int32_t)row * X_TFT_WIDTH, band, bytes);
+        }
+        next ^= 1;
+    }
+    lcd_WaitIdle();
+    tftFrameNotePush(startUs);
+    tftFrameNoteDirect();
+    Serial.printf(">>> <%s> streamed to the panel in %lu ms, first band after %lu us\r\n", name,
+                  (unsigned long)((esp_timer_get_time() - startUs) / 1000), (unsigned long)firstUs);
+    return true;
+}
+
+// A full-screen Z565 or 24-bit BMP from the asset image, the image cache or a
+// file; false with nothing drawn when it is none of those or the panel
+// cannot take bands, the sprite path then draws it
+static bool streamPicture(const char *filename)
+{
+    if (!TFT_BMP_STREAM || (spr.width() != X_TFT_WIDTH) || (spr.height() != X_TFT_HEIGHT) ||
+        (spr.getColorDepth() != 16) || (spr.getPointer() == NULL) || !allocBands())
+    {
+        return false;
+    }
+    tBandSource src = {};
+    tAssetFormat format;
+    size_t size = 0;
+    fs::File f;
+    if (!assetPackFind(filename, &src.mem, &size, &format))
+    {
+        fs::FS *srcFs = assetFsFor(filename);
+        f = srcFs ? srcFs->open(filename, "r") : fs::File();
+        if (!f)
+        {
+            return false;
+        }
+        src.file = &f;
+        size = f.size();
+    }
+    uint8_t hdr[54] = {0};
+    size_t hdrLen = min(size, sizeof(hdr));
+    if (src.mem)
+    {
+        memcpy(hdr, src.mem, hdrLen);
+    }
+    else if (f.read(hdr, hdrLen) != hdrLen)
+    {
+        f.close();
+        return false;
+    }
+
+    bool ok = false;
+    uint32_t seekOffset, rowSize;
+    uint16_t w, h;
+    if ((hdrLen >= RGB565_HDR_SIZE) && (mapped32(hdr) == RGB565_MAGIC))
+    {
+        if ((mapped16(hdr + 4) == X_TFT_WIDTH) && (mapped16(hdr + 6) == X_TFT_HEIGHT) &&
+            (size >= RGB565_HDR_SIZE + (size_t)X_TFT_WIDTH * X_TFT_HEIGHT * sizeof(uint16_t)))
+        {
+            src.first = RGB565_HDR_SIZE;
+            src.stride = X_TFT_WIDTH * sizeof(uint16_t);
+            ok = streamBands(filename, src, NULL);
+        }
+    }
+    else if ((hdrLen == sizeof(hdr)) && bmpGeometry(hdr, size, seekOffset, w, h, rowSize) &&
+             (w == X_TFT_WIDTH) && (h == X_TFT_HEIGHT))
+    {
+        tftImageCacheLock();
+        const tTftCachedImage *img = tftImageCacheGet(filename, size);
+        if (img != NULL)
+        {
+            tBandSource cached = {(const uint8_t *)img->px, NULL, 0, (int32_t)(X_TFT_WIDTH * sizeof(uint16_t)), false};
+            ok = streamBands(filename, cached, NULL);
+        }
+        else
+        {
+            uint16_t *px = tftImageCacheAlloc(filename, size, w, h);
+            src.first = seekOffset + (uint32_t)(h - 1) * rowSize;
+            src.stride = -(int32_t)rowSize;
+            src.bgr888 = true;
+            ok = streamBands(filename, src, px);
+            if (!ok && (px != NULL))
+            {
+                tftImageCacheDrop(filename);
+            }
+        }
+        tftImageCacheUnlock();
+    }
+    if (f)
+    {
+        f.close();
+    }
+    return ok;
+}
+
 void tftDrawBmp(const char *filename, int16_t x, int16_t y, uint16_t wLimit, uint16_t hLimit)
 {
 
@@ -33,10 +590,26 @@ void tftDrawBmp(const char *filename, int16_t x, int16_t y, uint16_t wLimit, uin
         return;
     }
 
+    if ((x == 0) && (y == 0) && (!hLimit || (hLimit >= X_TFT_HEIGHT)) && streamPicture(filename))
+    {
+        return;
+    }
+
+    if (tftPackedBmpToSprite(filename, x, y, spr))
+    {
+        tftDirtyFlush();
+        return;
+    }
+
     fs::File bmpFS;
 
-    // Open requested file on SD card
-    bmpFS = PSRamFS.open(filename, "r");
+    // Open requested file on SD card, a bitmap left out of the asset image
+    // may not have a PSRAM copy yet or be streamed from LittleFS
+    fs::FS *srcFs = assetFsFor(filename);
+    if (srcFs != NULL)
+    {
+        bmpFS = srcFs->open(filename, "r");
+    }
 
     if (!bmpFS)
     {
@@ -45,9 +618,15 @@ void tftDrawBmp(const char *filename, int16_t x, int16_t y, uint16_t wLimit, uin
         return;
     }
 
+    if (tftRgb565FileToSprite(bmpFS, x, y, spr) || tftCachedBmpFileToSprite(bmpFS, filename, x, y, spr))
+    {
+        bmpFS.close();
+        tftDirtyFlush();
+        return;
+    }
+
     uint32_t seekOffset;
     uint16_t w, h, row, col;
-    uint8_t r, g, b;
     int16_t maxY;
 
     uint32_t startTime = millis();
@@ -73,6 +652,7 @@ void tftDrawBmp(const char *filename, int16_t x, int16_t y, uint16_t wLimit, uin
 
         if ((read16(bmpFS) == 1) && (read16(bmpFS) == 24) && (read32(bmpFS) == 0))
         {
+            tftDirtyAdd(x, y, w, h);
             y += h - 1;            
 
             bool oldSwapBytes = spr.getSwapBytes();
@@ -86,26 +666,16 @@ void tftDrawBmp(const char *filename, int16_t x, int16_t y, uint16_t wLimit, uin
             {
 
                 bmpFS.read(lineBuffer, sizeof(lineBuffer));
-                uint8_t *bptr = lineBuffer;
-                uint16_t *tptr = (uint16_t *)lineBuffer;
-                // Convert 24 to 16-bit colours
-                for (uint16_t col = 0; col < w; col++)
-                {
-                    b = *bptr++;
-                    g = *bptr++;
-                    r = *bptr++;
-                    *tptr++ = ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
-                }
+                // Convert 24 to 16-bit colours, in place
+                tftBgr888ToRgb565(lineBuffer, (uint16_t *)lineBuffer, w, false);
 
                 // Push the pixel row to screen, pushImage will crop the line if needed
                 // y is decremented as the BMP image is drawn bottom up
                 //Serial.printf("%d %d\r\n", y, maxY);
                 //if (y < maxY)
                     spr.pushImage(x, y--, wLimit, 1, (uint16_t*)lineBuffer, 16);                
-                //spr.pushImage(0, 0, X_TFT_WIDTH, X_TFT_HEIGHT, (uint16_t *)gImage_true_color);
             }
-            //lcd_PushColors(x, y, w, h, (uint16_t *)spr.getPointer());
-            lcd_PushColors(0, 0, X_TFT_WIDTH, X_TFT_HEIGHT, (uint16_t *)spr.getPointer());
+            tftDirtyFlush();
             spr.setSwapBytes(oldSwapBytes);
             Serial.printf(">>> <%s> Loaded in ", filename);
             Serial.print(millis() - startTime);
@@ -126,10 +696,21 @@ void tftDrawBmpToSprite(const char *filename, int16_t x, int16_t y, uint16_t wLi
         return;
     }
 
+    if (tftPackedBmpToSprite(filename, x, y, spr))
+    {
+        lcd_PushColors(0, 0, X_TFT_WIDTH, X_TFT_HEIGHT, (uint16_t *)spr.getPointer());
+        return;
+    }
+
     fs::File bmpFS;
 
-    // Open requested file on SD card
-    bmpFS = PSRamFS.open(filename, "r");
+    // Open requested file on SD card, a bitmap left out of the asset image
+    // may not have a PSRAM copy yet or be streamed from LittleFS
+    fs::FS *srcFs = assetFsFor(filename);
+    if (srcFs != NULL)
+    {
+        bmpFS = srcFs->open(filename, "r");
+    }
 
     if (!bmpFS)
     {
@@ -138,9 +719,15 @@ void tftDrawBmpToSprite(const char *filename, int16_t x, int16_t y, uint16_t wLi
         return;
     }
 
+    if (tftRgb565FileToSprite(bmpFS, x, y, spr) || tftCachedBmpFileToSprite(bmpFS, filename, x, y, spr))
+    {
+        bmpFS.close();
+        lcd_PushColors(0, 0, X_TFT_WIDTH, X_TFT_HEIGHT, (uint16_t *)spr.getPointer());
+        return;
+    }
+
     uint32_t seekOffset;
     uint16_t w, h, row, col;
-    uint8_t r, g, b;
     int16_t maxY;
 
     uint32_t startTime = millis();
@@ -179,23 +766,14 @@ void tftDrawBmpToSprite(const char *filename, int16_t x, int16_t y, uint16_t wLi
             {
 
                 bmpFS.read(lineBuffer, sizeof(lineBuffer));
-                uint8_t *bptr = lineBuffer;
-                uint16_t *tptr = (uint16_t *)lineBuffer;
-                // Convert 24 to 16-bit colours
-                for (uint16_t col = 0; col < w; col++)
-                {
-                    b = *bptr++;
-                    g = *bptr++;
-                    r = *bptr++;
-                    *tptr++ = ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
-                }
+                // Convert 24 to 16-bit colours, in place
+                tftBgr888ToRgb565(lineBuffer, (uint16_t *)lineBuffer, w, false);
 
                 // Push the pixel row to screen, pushImage will crop the line if needed
                 // y is decremented as the BMP image is drawn bottom up
                 //Serial.printf("%d %d\r\n", y, maxY);
                 //if (y < maxY)
                     spr.pushImage(x, y--, wLimit, 1, (uint16_t*)lineBuffer, 16);                
-                //spr.pushImage(0, 0, X_TFT_WIDTH, X_TFT_HEIGHT, (uint16_t *)gImage_true_color);
             }
             //lcd_PushColors(x, y, w, h, (uint16_t *)spr.getPointer());
             lcd_PushColors(0, 0, X_TFT_WIDTH, X_TFT_HEIGHT, (uint16_t *)spr.getPointer());
@@ -0,0 +1,172 @@
+#include "tftCompositor.h"
+
+#include <TFT_eSPI.h>
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "rm67162.h"
+#include "tftFrame.h"
+
+extern TFT_eSprite spr;
+
+static tTftRect dirty[TFT_DIRTY_MAX_RECTS];
+static uint8_t dirtyCount = 0;
+static uint16_t *stage[2] = {NULL, NULL};
+
+static inline int32_t rectArea(const tTftRect &r)
+{
+    return (int32_t)r.w * r.h;
+}
+
+static tTftRect rectUnion(const tTftRect &a, const tTftRect &b)
+{
+    int16_t x0 = min(a.x, b.x);
+    int16_t y0 = min(a.y, b.y);
+    int16_t x1 = max(a.x + a.w, b.x + b.w);
+    int16_t y1 = max(a.y + a.h, b.y + b.h);
+    return {x0, y0, (int16_t)(x1 - x0), (int16_t)(y1 - y0)};
+}
+
+// Overlapping or touching rects, or ones whose bounding box wastes nothing
+static bool rectMergeable(const tTftRect &a, const tTftRect &b)
+{
+    if ((a.x <= b.x + b.w) && (b.x <= a.x + a.w) && (a.y <= b.y + b.h) && (b.y <= a.y + a.h))
+    {
+        return true;
+    }
+    return rectArea(rectUnion(a, b)) <= rectArea(a) + rectArea(b);
+}
+
+static void mergeDirty(void)
+{
+    bool merged = true;
+    while (merged)
+    {
+        merged = false;
+        for (int i = 0; (i < dirtyCount) && !merged; i++)
+        {
+            for (int j = i + 1; j < dirtyCount; j++)
+            {
+                if (rectMergeable(dirty[i], dirty[j]))
+                {
+                    dirty[i] = rectUnion(dirty[i], dirty[j]);
+                    dirty[j] = dirty[--dirtyCount];
+                    merged = true;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+void tftDirtyAdd(int16_t x, int16_t y, int16_t w, int16_t h)
+{
+    // clip to the frame; the panel takes column windows on even boundaries
+    int16_t x1 = min((int)(x + w), X_TFT_WIDTH);
+    int16_t y1 = min((int)(y + h), X_TFT_HEIGHT);
+    x = max((int16_t)0, x) & ~1;
+    y = max((int16_t)0, y);
+    x1 = min((int)((x1 + 1) & ~1), X_TFT_WIDTH);
+    if ((x1 <= x) || (y1 <= y))
+    {
+        return;
+    }
+    tTftRect r = {x, y, (int16_t)(x1 - x), (int16_t)(y1 - y)};
+
+    if (dirtyCount == TFT_DIRTY_MAX_RECTS)
+    {
+        // no free slot, grow the rect that gets least bigger
+        int best = 0;
+        int32_t bestGrowth = INT32_MAX;
+        for (int i = 0; i < dirtyCount; i++)
+        {
+            int32_t growth = rectArea(rectUnion(dirty[i], r)) - rectArea(dirty[i]);
+            if (growth < bestGrowth)
+            {
+                bestGrowth = growth;
+                best = i;
+            }
+        }
+        dirty[best] = rectUnion(dirty[best], r);
+    }
+    else
+    {
+        dirty[dirtyCount++] = r;
+    }
+    mergeDirty();
+}
+
+void tftDirtyAll(void)
+{
+    dirty[0] = {0, 0, X_TFT_WIDTH, X_TFT_HEIGHT};
+    dirtyCount = 1;
+}
+
+bool tftDirtyPending(void)
+{
+    return dirtyCount > 0;
+}
+
+static bool allocStage(void)
+{
+    for (int i = 0; i < 2; i++)
+    {
+        if (stage[i] == NULL)
+        {
+            stage[i] = (uint16_t *)heap_caps_malloc(TFT_DIRTY_STAGE_PX * sizeof(uint16_t), MALLOC_CAP_DMA);
+        }
+    }
+    if ((stage[0] == NULL) || (stage[1] == NULL))
+    {
+        Serial.println("*** tftDirtyFlush WARNING! No DMA staging buffers, pushing full rows");
+        return false;
+    }
+    return true;
+}
+
+// Full-width bands are contiguous in the framebuffer and go out as they are,
+// narrower windows are gathered row by row into two alternating staging
+// buffers, the next one is filled while the previous one is on the bus
+void tftDirtyFlush(void)
+{
+    if (dirtyCount == 0)
+    {
+        return;
+    }
+    mergeDirty();
+    if ((dirtyCount == 1) && (dirty[0].w == X_TFT_WIDTH) && (dirty[0].h == X_TFT_HEIGHT))
+    {
+        // full frames (picture and role changes) go out tear-free on TE
+        dirtyCount = 0;
+        tftFrameSwap();
+        return;
+    }
+    int64_t startUs = esp_timer_get_time();
+    uint16_t *fb = (uint16_t *)spr.getPointer();
+    bool staged = allocStage();
+    uint8_t next = 0;
+    for (int i = 0; i < dirtyCount; i++)
+    {
+        tTftRect r = dirty[i];
+        if ((r.w == X_TFT_WIDTH) || !staged)
+        {
+            lcd_PushColorsAsync(0, r.y, X_TFT_WIDTH, r.h, fb + (int32_t)r.y * X_TFT_WIDTH);
+            continue;
+        }
+        int16_t rowsPerChunk = max(1, TFT_DIRTY_STAGE_PX / r.w);
+        for (int16_t row = 0; row < r.h; row += rowsPerChunk)
+        {
+            int16_t rows = min(rowsPerChunk, (int16_t)(r.h - row));
+            uint16_t *dst = stage[next];
+            const uint16_t *src = fb + (int32_t)(r.y + row) * X_TFT_WIDTH + r.x;
+            for (int16_t k = 0; k < rows; k++, src += X_TFT_WIDTH, dst += r.w)
+            {
+                memcpy(dst, src, r.w * sizeof(uint16_t));
+            }
+            lcd_PushColorsAsync(r.x, r.y + row, r.w, rows, stage[next]);
+            next ^= 1;
+        }
+    }
+    dirtyCount = 0;
+    lcd_WaitIdle();
+    tftFrameNotePush(startUs);
+}
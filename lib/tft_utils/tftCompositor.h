@@ -0,0 +1,23 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Dirty-rectangle compositor over the spr framebuffer: drawing code marks the
+// regions it changed, tftDirtyFlush() merges overlapping ones and sends only
+// those windows to the panel instead of the full 536x240 frame.
+
+#define TFT_DIRTY_MAX_RECTS     8
+#define TFT_DIRTY_STAGE_PX      4096    // pixels per DMA staging buffer, two are used
+
+struct tTftRect
+{
+    int16_t x;
+    int16_t y;
+    int16_t w;
+    int16_t h;
+};
+
+void tftDirtyAdd(int16_t x, int16_t y, int16_t w, int16_t h);
+void tftDirtyAll(void);
+bool tftDirtyPending(void);
+void tftDirtyFlush(void);        // returns when the panel has the data, spr may be redrawn
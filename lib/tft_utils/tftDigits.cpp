@@ -0,0 +1,142 @@
+#include "tftDigits.h"
+
+#include "tftCompositor.h"
+
+extern TFT_eSPI tft;
+extern TFT_eSprite spr;
+
+struct tDigitAtlas
+{
+    TFT_eSprite *strip = NULL;  // the glyphs side by side, cells of 6 x 8 pixels times size
+    uint8_t size = 0;
+    uint16_t color = 0;
+    uint16_t bgColor = 0;
+};
+
+static tDigitAtlas atlases[TFT_DIGIT_MAX_ATLASES];
+static const uint8_t glyphCount = sizeof(TFT_DIGIT_GLYPHS) - 1;
+
+static tDigitAtlas *getAtlas(uint8_t size, uint16_t color, uint16_t bgColor)
+{
+    tDigitAtlas *slot = NULL;
+    for (int i = 0; i < TFT_DIGIT_MAX_ATLASES; i++)
+    {
+        tDigitAtlas &a = atlases[i];
+        if (a.strip == NULL)
+        {
+            if (slot == NULL)
+            {
+                slot = &a;
+            }
+            continue;
+        }
+        if ((a.size == size) && (a.color == color) && (a.bgColor == bgColor))
+        {
+            return &a;
+        }
+    }
+    if (slot == NULL)
+    {
+        return NULL;
+    }
+
+    uint32_t startTime = millis();
+    TFT_eSprite *strip = new TFT_eSprite(&tft);
+    strip->setColorDepth(16);
+    if (strip->createSprite(6 * size * glyphCount, 8 * size) == NULL)
+    {
+        Serial.println("!!! tftDigitsDraw ERROR: no memory for the glyph atlas");
+        delete strip;
+        return NULL;
+    }
+    strip->fillSprite(bgColor);
+    strip->setTextColor(color, bgColor);
+    strip->setTextSize(size);
+    strip->setTextDatum(TL_DATUM);
+    char glyph[2] = {0, 0};
+    for (uint8_t i = 0; i < glyphCount; i++)
+    {
+        glyph[0] = TFT_DIGIT_GLYPHS[i];
+        strip->drawString(glyph, 6 * size * i, 0, 1);
+    }
+    slot->strip = strip;
+    slot->size = size;
+    slot->color = color;
+    slot->bgColor = bgColor;
+    Serial.printf(">>> tftDigitsDraw: size %u atlas rendered in %lu ms\r\n", size, millis() - startTime);
+    return slot;
+}
+
+bool tftDigitsDraw(TFT_eSprite &dst, const String &str, int16_t cx, int16_t cy,
+                   uint8_t size, uint16_t color, uint16_t bgColor)
+{
+    uint8_t idx[16];
+    size_t len = str.length();
+    uint8_t bpp = dst.getColorDepth();
+    if ((len == 0) || (len > sizeof(idx)) || (size == 0) || ((bpp != 16) && (bpp != 4)))
+    {
+        return false;
+    }
+    for (size_t i = 0; i < len; i++)
+    {
+        const char *g = strchr(TFT_DIGIT_GLYPHS, str[i]);
+        if ((g == NULL) || (str[i] == 0))
+        {
+            return false;
+        }
+        idx[i] = g - TFT_DIGIT_GLYPHS;
+    }
+    // a 4-bit sprite takes the glyphs' shape from a white on black atlas
+    tDigitAtlas *atlas = (bpp == 4) ? getAtlas(size, TFT_WHITE, TFT_BLACK) : getAtlas(size, color, bgColor);
+    if (atlas == NULL)
+    {
+        return false;
+    }
+
+    // MC_DATUM placement of drawString for font 1
+    int16_t cellW = 6 * size;
+    int16_t cellH = 8 * size;
+    int16_t textW = cellW * (int16_t)len;
+    int16_t x = cx - textW / 2;
+    int16_t y = cy - cellH / 2;
+
+    uint16_t *fb = (uint16_t *)dst.getPointer();
+    uint8_t *fb4 = (uint8_t *)dst.getPointer();
+    const uint16_t *strip = (const uint16_t *)atlas->strip->getPointer();
+    int16_t dw = dst.width();
+    int32_t dw4 = (dw + 1) & ~1;    // TFT_eSprite pads 4-bit rows to even pixels
+    int16_t stripW = cellW * glyphCount;
+    int16_t r0 = max(0, -y);
+    int16_t r1 = min((int)cellH, dst.height() - y);
+    for (size_t i = 0; i < len; i++, x += cellW)
+    {
+        int16_t x0 = max((int16_t)0, x);
+        int16_t x1 = min((int)(x + cellW), (int)dw);
+        if (x1 <= x0)
+        {
+            continue;
+        }
+        const uint16_t *src = strip + idx[i] * cellW + (x0 - x);
+        for (int16_t r = r0; r < r1; r++)
+        {
+            if (bpp == 16)
+            {
+                memcpy(fb + (int32_t)(y + r) * dw + x0, src + (int32_t)r * stripW, (x1 - x0) * sizeof(uint16_t));
+                continue;
+            }
+            const uint16_t *s = src + (int32_t)r * stripW;
+            int32_t p = (int32_t)(y + r) * dw4 + x0;
+            for (int16_t c = x0; c < x1; c++, p++)
+            {
+                uint8_t v = ((*s++ != TFT_BLACK) ? color : bgColor) & 0x0F;
+                uint8_t &b = fb4[p >> 1];
+                b = (p & 1) ? ((b & 0xF0) | v) : ((b & 0x0F) | (v << 4));
+            }
+        }
+    }
+    if ((&dst == &spr) && (r1 > r0))
+    {
+        tftDirtyAdd(cx - textW / 2, y + r0, textW, r1 - r0);
+    }
+    return true;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <Arduino.h>
+#include <TFT_eSPI.h>
+
+// Pre-rendered atlas of the GLCD (font 1) glyphs the game screen counters use,
+// one strip per text size and colour pair in PSRAM, built on first use; a
+// counter update becomes tile copies instead of scaled glyph rendering.
+
+#define TFT_DIGIT_GLYPHS        "0123456789+-: "
+#define TFT_DIGIT_MAX_ATLASES   8       // three role colours at the two sizes in use fit
+
+// Same pixels as drawString(str, cx, cy, 1) with MC_DATUM, the size and colours
+// given; false, nothing drawn, when str has a glyph outside the atlas. On a
+// 4-bit sprite the colours are palette indices, all of them share one atlas.
+bool tftDigitsDraw(TFT_eSprite &dst, const String &str, int16_t cx, int16_t cy,
+                   uint8_t size, uint16_t color, uint16_t bgColor);
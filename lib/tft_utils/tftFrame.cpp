@@ -0,0 +1,135 @@
+#include "tftFrame.h"
+
+#include <TFT_eSPI.h>
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "rm67162.h"
+
+extern TFT_eSprite spr;
+
+// TFT_eSprite can flip between two 16-bit frames with frameBuffer(), but puts
+// the second one at an odd byte offset of its own allocation, which neither
+// 16-bit access nor DMA takes, and getPointer() keeps returning the first one
+// whichever is drawn into. Its frame pointers are set to our two buffers on
+// every swap instead, the back one first, so the code writing through
+// getPointer() draws where drawPixel() does
+struct tSprFrames : public TFT_eSprite
+{
+    static uint8_t *TFT_eSprite::*frame1(void)
+    {
+        return &tSprFrames::_img8_1;
+    }
+    static uint8_t *TFT_eSprite::*frame2(void)
+    {
+        return &tSprFrames::_img8_2;
+    }
+};
+
+static uint8_t *frames[2] = {NULL, NULL};   // the sprite's own and the aligned one
+static uint8_t backIdx = 0;                 // the one spr draws into
+static size_t frameBytes = 0;
+static bool backShown = false;              // tftFrameNoteDirect() since the last swap
+static tTftFrameTimes frameTimes;
+
+static void pointSprite(void)
+{
+    spr.*tSprFrames::frame1() = frames[backIdx];
+    spr.*tSprFrames::frame2() = frames[backIdx ^ 1];
+    spr.frameBuffer(1);
+}
+
+bool tftFrameInit(void)
+{
+    lcd_EnableTE();
+#if TFT_DOUBLE_BUFFER
+    if (frames[1] != NULL)
+    {
+        return true;
+    }
+    frames[0] = (uint8_t *)spr.frameBuffer(1);
+    if (frames[0] == NULL)
+    {
+        Serial.println("!!! tftFrameInit ERROR: spr is not created");
+        return false;
+    }
+    frameBytes = (size_t)spr.width() * spr.height() * sizeof(uint16_t);
+    // one pixel more, as TFT_eSprite parks out-of-bounds writes past the end
+    frames[1] = (uint8_t *)heap_caps_aligned_alloc(16, frameBytes + sizeof(uint16_t), MALLOC_CAP_SPIRAM);
+    if (frames[1] == NULL)
+    {
+        Serial.println("*** tftFrameInit WARNING! No PSRAM for the back buffer, single buffered");
+        return false;
+    }
+    memcpy(frames[1], frames[0], frameBytes);
+    backIdx = 0;
+    pointSprite();
+    Serial.printf(">>> tftFrameInit: double buffered, %u bytes per frame\r\n", frameBytes);
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool tftFrameDoubleBuffered(void)
+{
+    return frames[1] != NULL;
+}
+
+const uint16_t *tftFrameFront(void)
+{
+    if ((frames[1] == NULL) || backShown)
+    {
+        return (const uint16_t *)spr.getPointer();
+    }
+    return (const uint16_t *)frames[backIdx ^ 1];
+}
+
+void tftFrameNoteDirect(void)
+{
+    backShown = true;
+}
+
+void tftFrameSwap(bool keepContent)
+{
+    int64_t startUs = esp_timer_get_time();
+    if (frames[1] == NULL)
+    {
+        lcd_WaitTE(TFT_TE_TIMEOUT_MS);
+        lcd_PushColors(0, 0, X_TFT_WIDTH, X_TFT_HEIGHT, (uint16_t *)spr.getPointer());
+        tftFrameNotePush(startUs);
+        return;
+    }
+    uint8_t *front = frames[backIdx];
+    // the buffer about to become the back one must be out on the panel
+    lcd_WaitIdle();
+    lcd_WaitTE(TFT_TE_TIMEOUT_MS);
+    lcd_PushColorsAsync(0, 0, X_TFT_WIDTH, X_TFT_HEIGHT, (uint16_t *)front);
+    tftFrameNotePush(startUs);
+    backShown = false;
+    backIdx ^= 1;
+    pointSprite();
+    if (keepContent)
+    {
+        memcpy(frames[backIdx], front, frameBytes);
+    }
+}
+
+void tftFrameNoteRender(uint32_t ms)
+{
+    frameTimes.renderMs = ms;
+    frameTimes.renderMaxMs = max(frameTimes.renderMaxMs, ms);
+}
+
+void tftFrameNotePush(int64_t startUs)
+{
+    uint32_t us = (uint32_t)(esp_timer_get_time() - startUs);
+    frameTimes.pushUs = us;
+    frameTimes.pushMaxUs = max(frameTimes.pushMaxUs, us);
+    frameTimes.pushes++;
+    frameTimes.lastPushMs = millis();
+}
+
+void tftFrameGetTimes(tTftFrameTimes &times)
+{
+    times = frameTimes;
+}
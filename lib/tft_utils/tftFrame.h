@@ -0,0 +1,40 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Optional double buffering of the spr framebuffer: spr renders into the back
+// buffer while the front one goes out over DMA, the push starts on the panel's
+// tearing-effect edge so a full frame never shows half old, half new.
+// Builds short on PSRAM set TFT_DOUBLE_BUFFER to 0 and keep one 257 KB frame.
+
+#ifndef TFT_DOUBLE_BUFFER
+#define TFT_DOUBLE_BUFFER   1
+#endif
+#define TFT_TE_TIMEOUT_MS   40      // the panel refreshes at ~60 Hz, a missing TE must not stall drawing
+
+bool tftFrameInit(void);            // after spr.createSprite(), false when running single buffered
+bool tftFrameDoubleBuffered(void);
+// Pushes what spr holds on the next TE and flips spr to the other buffer; with
+// keepContent the new back buffer starts as a copy, for partial redraws
+void tftFrameSwap(bool keepContent = true);
+// The frame last pushed (spr itself when single buffered), for snapshots; a
+// swap while it is read turns it into the back buffer and it may tear
+const uint16_t *tftFrameFront(void);
+// spr went to the panel without a swap (a streamed picture), it counts as
+// the front frame until the next swap
+void tftFrameNoteDirect(void);
+
+// Display timing for field debugging, sent along with the snapshots
+struct tTftFrameTimes
+{
+    uint32_t renderMs;      // the last screen the screen task drew, its pushes included
+    uint32_t renderMaxMs;
+    uint32_t pushUs;        // the last push: TE wait and queueing, the whole transfer when synchronous
+    uint32_t pushMaxUs;
+    uint32_t pushes;
+    uint32_t lastPushMs;    // millis() of the last push, old on a frozen screen
+};
+
+void tftFrameNoteRender(uint32_t ms);
+void tftFrameNotePush(int64_t startUs);    // esp_timer_get_time() when the push began
+void tftFrameGetTimes(tTftFrameTimes &times);
@@ -0,0 +1,195 @@
+#include "tftImageCache.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+static tTftCachedImage cache[TFT_IMG_CACHE_SLOTS];
+static uint32_t budget = TFT_IMG_CACHE_BUDGET;
+static uint32_t used = 0;
+static uint32_t useClock = 0;
+static SemaphoreHandle_t cacheMutex = NULL;
+
+static inline uint32_t imageBytes(const tTftCachedImage &img)
+{
+    return (uint32_t)img.w * img.h * sizeof(uint16_t);
+}
+
+static void freeSlot(tTftCachedImage &img)
+{
+    if (img.px == NULL)
+    {
+        return;
+    }
+    used -= imageBytes(img);
+    free(img.px);
+    img.px = NULL;
+    img.name[0] = 0;
+}
+
+static tTftCachedImage *findSlot(const char *name)
+{
+    for (int i = 0; i < TFT_IMG_CACHE_SLOTS; i++)
+    {
+        if (cache[i].px && (strcmp(cache[i].name, name) == 0))
+        {
+            return &cache[i];
+        }
+    }
+    return NULL;
+}
+
+// NULL when nothing is cached
+static tTftCachedImage *lruSlot(void)
+{
+    tTftCachedImage *lru = NULL;
+    for (int i = 0; i < TFT_IMG_CACHE_SLOTS; i++)
+    {
+        if (cache[i].px && ((lru == NULL) || (cache[i].lastUse < lru->lastUse)))
+        {
+            lru = &cache[i];
+        }
+    }
+    return lru;
+}
+
+const tTftCachedImage *tftImageCacheGet(const char *name, uint32_t srcSize)
+{
+    tTftCachedImage *img = findSlot(name);
+    if (img == NULL)
+    {
+        return NULL;
+    }
+    if (img->srcSize != srcSize)
+    {
+        freeSlot(*img);
+        return NULL;
+    }
+    img->lastUse = ++useClock;
+    return img;
+}
+
+// A free slot with room for the bytes under the budget, evicting LRU entries; NULL when they do not fit
+static tTftCachedImage *makeRoom(const char *name, uint32_t bytes)
+{
+    if ((bytes == 0) || (bytes > budget) || (strlen(name) >= TFT_IMG_CACHE_NAME_LEN))
+    {
+        return NULL;
+    }
+    tftImageCacheDrop(name);
+
+    tTftCachedImage *slot = NULL;
+    while (true)
+    {
+        for (int i = 0; (i < TFT_IMG_CACHE_SLOTS) && (slot == NULL); i++)
+        {
+            if (cache[i].px == NULL)
+            {
+                slot = &cache[i];
+            }
+        }
+        if ((slot != NULL) && (used + bytes <= budget))
+        {
+            break;
+        }
+        tTftCachedImage *lru = lruSlot();
+        if (lru == NULL)
+        {
+            return NULL;
+        }
+        freeSlot(*lru);
+    }
+    return slot;
+}
+
+static void fillSlot(tTftCachedImage *slot, const char *name, uint32_t srcSize, uint16_t w, uint16_t h, uint16_t *px)
+{
+    strcpy(slot->name, name);
+    slot->srcSize = srcSize;
+    slot->w = w;
+    slot->h = h;
+    slot->px = px;
+    slot->lastUse = ++useClock;
+    used += imageBytes(*slot);
+}
+
+uint16_t *tftImageCacheAlloc(const char *name, uint32_t srcSize, uint16_t w, uint16_t h)
+{
+    uint32_t bytes = (uint32_t)w * h * sizeof(uint16_t);
+    tTftCachedImage *slot = makeRoom(name, bytes);
+    if (slot == NULL)
+    {
+        return NULL;
+    }
+
+    uint16_t *px = (uint16_t *)ps_malloc(bytes);
+    while ((px == NULL) && (lruSlot() != NULL))
+    {
+        // PSRAM is fragmented or taken by PSRamFS, make room under the budget
+        freeSlot(*lruSlot());
+        px = (uint16_t *)ps_malloc(bytes);
+    }
+    if (px == NULL)
+    {
+        Serial.printf("*** tftImageCacheAlloc WARNING! ps_malloc(%lu) failed\r\n", bytes);
+        return NULL;
+    }
+    fillSlot(slot, name, srcSize, w, h, px);
+    return px;
+}
+
+bool tftImageCacheInsert(const char *name, uint32_t srcSize, uint16_t w, uint16_t h, uint16_t *px)
+{
+    tTftCachedImage *slot = makeRoom(name, (uint32_t)w * h * sizeof(uint16_t));
+    if (slot == NULL)
+    {
+        free(px);
+        return false;
+    }
+    fillSlot(slot, name, srcSize, w, h, px);
+    return true;
+}
+
+void tftImageCacheDrop(const char *name)
+{
+    tTftCachedImage *img = findSlot(name);
+    if (img)
+    {
+        freeSlot(*img);
+    }
+}
+
+void tftImageCacheClear(void)
+{
+    for (int i = 0; i < TFT_IMG_CACHE_SLOTS; i++)
+    {
+        freeSlot(cache[i]);
+    }
+}
+
+void tftImageCacheSetBudget(uint32_t bytes)
+{
+    budget = bytes;
+    tTftCachedImage *lru;
+    while ((used > budget) && ((lru = lruSlot()) != NULL))
+    {
+        freeSlot(*lru);
+    }
+}
+
+uint32_t tftImageCacheUsed(void)
+{
+    return used;
+}
+
+void tftImageCacheLock(void)
+{
+    if (cacheMutex == NULL)
+    {
+        cacheMutex = xSemaphoreCreateMutex();
+    }
+    xSemaphoreTake(cacheMutex, portMAX_DELAY);
+}
+
+void tftImageCacheUnlock(void)
+{
+    xSemaphoreGive(cacheMutex);
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <Arduino.h>
+
+// LRU cache of decoded bitmaps in PSRAM, keyed by file name and source size,
+// so a picture shown again is a copy into the sprite instead of a BMP decode.
+// Pixels are kept top down in the byte order of the sprite buffer.
+// The screen task and the prefetcher share it: hold the lock from a Get or
+// an Alloc until the pixels are used.
+
+#ifndef TFT_IMG_CACHE_BUDGET
+#define TFT_IMG_CACHE_BUDGET    (1536 * 1024)   // bytes of pixels, the four full-screen pictures and the icons
+#endif
+#define TFT_IMG_CACHE_SLOTS     16
+#define TFT_IMG_CACHE_NAME_LEN  32
+
+struct tTftCachedImage
+{
+    char name[TFT_IMG_CACHE_NAME_LEN];
+    uint32_t srcSize;       // size of the file it was decoded from, a resynced file misses
+    uint16_t w;
+    uint16_t h;
+    uint16_t *px;
+    uint32_t lastUse;
+};
+
+const tTftCachedImage *tftImageCacheGet(const char *name, uint32_t srcSize);
+// Reserves an entry, evicting the least recently used ones; NULL when it does not fit the budget
+uint16_t *tftImageCacheAlloc(const char *name, uint32_t srcSize, uint16_t w, uint16_t h);
+// Takes over pixels decoded outside the lock (ps_malloc'ed), frees them when they do not fit
+bool tftImageCacheInsert(const char *name, uint32_t srcSize, uint16_t w, uint16_t h, uint16_t *px);
+void tftImageCacheDrop(const char *name);
+void tftImageCacheClear(void);
+void tftImageCacheSetBudget(uint32_t bytes);
+uint32_t tftImageCacheUsed(void);
+void tftImageCacheLock(void);
+void tftImageCacheUnlock(void);
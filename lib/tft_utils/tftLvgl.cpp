@@ -0,0 +1,130 @@
+#include "tftLvgl.h"
+
+#include "esp_heap_caps.h"
+#include "rm67162.h"
+#include "taskRegistry.h"
+
+static lv_display_t *lvDisp = NULL;
+static SemaphoreHandle_t lvMutex = NULL;
+static volatile bool lvRunning = false;
+
+static uint32_t lvTick(void)
+{
+    return millis();
+}
+
+// lv_conf.h keeps LV_COLOR_16_SWAP, LVGL hands over bands already in panel byte order
+static void lvFlush(lv_display_t *disp, const lv_area_t *area, uint8_t *px)
+{
+    lcd_PushColorsAsync(area->x1, area->y1, lv_area_get_width(area), lv_area_get_height(area), (uint16_t *)px);
+}
+
+// Called before a buffer is rendered into again and at the end of a refresh
+static void lvFlushWait(lv_display_t *disp)
+{
+    lcd_WaitIdle();
+}
+
+// The panel takes column windows on even boundaries only
+static void lvRounder(lv_event_t *e)
+{
+    lv_area_t *area = (lv_area_t *)lv_event_get_param(e);
+    area->x1 &= ~1;
+    area->x2 |= 1;
+}
+
+static void lvglTask(void *pvParameters)
+{
+    Serial.println(">>> lvglTask: STARTED");
+    while (true)
+    {
+        uint32_t sleepMs = TFT_LVGL_MAX_SLEEP_MS;
+        if (lvRunning && tftLvglLock(TFT_LVGL_MAX_SLEEP_MS))
+        {
+            sleepMs = lv_timer_handler();
+            tftLvglUnlock();
+        }
+        if (sleepMs > TFT_LVGL_MAX_SLEEP_MS)
+        {
+            sleepMs = TFT_LVGL_MAX_SLEEP_MS;
+        }
+        vTaskDelay(pdMS_TO_TICKS(max((uint32_t)1, sleepMs)));
+    }
+}
+
+bool tftLvglInit(void)
+{
+    if (lvDisp != NULL)
+    {
+        return true;
+    }
+    size_t bufBytes = X_TFT_WIDTH * TFT_LVGL_BUF_LINES * sizeof(uint16_t);
+    void *buf1 = heap_caps_malloc(bufBytes, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+    void *buf2 = heap_caps_malloc(bufBytes, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+    lvMutex = xSemaphoreCreateRecursiveMutex();
+    if ((buf1 == NULL) || (buf2 == NULL) || (lvMutex == NULL))
+    {
+        Serial.println("!!! tftLvglInit ERROR: no internal memory for the render buffers");
+        free(buf1);
+        free(buf2);
+        return false;
+    }
+
+    lv_init();
+    lv_tick_set_cb(lvTick);
+    lvDisp = lv_display_create(X_TFT_WIDTH, X_TFT_HEIGHT);
+    lv_display_set_color_format(lvDisp, LV_COLOR_FORMAT_RGB565);
+    lv_display_set_buffers(lvDisp, buf1, buf2, bufBytes, LV_DISPLAY_RENDER_MODE_PARTIAL);
+    lv_display_set_flush_cb(lvDisp, lvFlush);
+    lv_display_set_flush_wait_cb(lvDisp, lvFlushWait);
+    lv_display_add_event_cb(lvDisp, lvRounder, LV_EVENT_INVALIDATE_AREA, NULL);
+
+    if (!taskStart(tkLvgl, lvglTask))
+    {
+        return false;
+    }
+    Serial.printf(">>> tftLvglInit: 2 x %u bytes render buffers\r\n", bufBytes);
+    return true;
+}
+
+lv_display_t *tftLvglDisplay(void)
+{
+    return lvDisp;
+}
+
+void tftLvglResume(void)
+{
+    if ((lvDisp == NULL) || !tftLvglLock())
+    {
+        return;
+    }
+    lv_obj_invalidate(lv_display_get_screen_active(lvDisp));
+    lvRunning = true;
+    tftLvglUnlock();
+}
+
+void tftLvglPause(void)
+{
+    if ((lvDisp == NULL) || !tftLvglLock())
+    {
+        return;
+    }
+    lvRunning = false;
+    tftLvglUnlock();
+    lcd_WaitIdle();
+}
+
+bool tftLvglLock(uint32_t timeoutMs)
+{
+    if (lvMutex == NULL)
+    {
+        return false;
+    }
+    TickType_t ticks = (timeoutMs == portMAX_DELAY) ? portMAX_DELAY : pdMS_TO_TICKS(timeoutMs);
+    return xSemaphoreTakeRecursive(lvMutex, ticks) == pdTRUE;
+}
+
+void tftLvglUnlock(void)
+{
+    xSemaphoreGiveRecursive(lvMutex);
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <Arduino.h>
+#include <lvgl.h>
+
+// LVGL display driver for the RM67162: partial render buffers in internal DMA
+// SRAM, each rendered band goes out through lcd_PushColorsAsync() while LVGL
+// renders the next one into the other buffer. A handler task runs the LVGL
+// timers; widgets are touched from other tasks only between tftLvglLock() and
+// tftLvglUnlock(). LVGL and the spr paths share the panel, LVGL draws only
+// while resumed.
+
+#define TFT_LVGL_BUF_LINES      20      // rows per render buffer, two of them, ~21 KB each at 536 px
+#define TFT_LVGL_MAX_SLEEP_MS   30      // upper bound of the handler task's sleep between timer runs
+
+bool tftLvglInit(void);                 // after setupTFT(), starts paused
+lv_display_t *tftLvglDisplay(void);
+void tftLvglResume(void);               // LVGL owns the panel, its screen is redrawn in full
+void tftLvglPause(void);                // returns once the last band is out, spr may push again
+bool tftLvglLock(uint32_t timeoutMs = portMAX_DELAY);
+void tftLvglUnlock(void);
@@ -0,0 +1,156 @@
+#include "tftPalette.h"
+
+#include "esp_heap_caps.h"
+#include "rm67162.h"
+
+static uint16_t *bounce[2] = {NULL, NULL};
+static uint8_t next = 0;            // the one not on the bus
+static uint16_t lut4[16];           // per push, from the sprite's palette
+static uint16_t lut8[256];          // RGB332, built on the first 8-bit push
+static bool lut8Built = false;
+
+// Panel byte order, what spr holds with setSwapBytes(1)
+static inline uint16_t panel565(uint16_t c)
+{
+    return (c >> 8) | (c << 8);
+}
+
+// Same expansion as TFT_eSprite::readPixel() of an 8-bit sprite
+static void buildLut8(void)
+{
+    static const uint8_t blue[] = {0, 11, 21, 31};
+    for (int i = 0; i < 256; i++)
+    {
+        uint16_t c = 0;
+        if (i != 0)
+        {
+            c = (i & 0xE0) << 8 | (i & 0xC0) << 5 | (i & 0x1C) << 6 | (i & 0x1C) << 3 | blue[i & 0x03];
+        }
+        lut8[i] = panel565(c);
+    }
+    lut8Built = true;
+}
+
+static bool allocBounce(void)
+{
+    for (int i = 0; i < 2; i++)
+    {
+        if (bounce[i] == NULL)
+        {
+            bounce[i] = (uint16_t *)heap_caps_malloc(TFT_PAL_BOUNCE_PX * sizeof(uint16_t), MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+        }
+    }
+    if ((bounce[0] == NULL) || (bounce[1] == NULL))
+    {
+        Serial.println("!!! tftPalettePush ERROR: no DMA bounce buffers");
+        return false;
+    }
+    return true;
+}
+
+// One sprite row of w pixels into w * scale panel pixels
+static void expandRow(const uint8_t *row, uint8_t bpp, int16_t w, uint8_t scale, uint16_t *dst)
+{
+    if (bpp == 8)
+    {
+        if (scale == 1)
+        {
+            for (int16_t i = 0; i < w; i++)
+            {
+                dst[i] = lut8[row[i]];
+            }
+            return;
+        }
+        for (int16_t i = 0; i < w; i++, dst += 2)
+        {
+            dst[0] = dst[1] = lut8[row[i]];
+        }
+        return;
+    }
+    // 4 bit: two pixels a byte, the left one in the high nibble
+    for (int16_t i = 0; i < w; i += 2)
+    {
+        uint8_t b = row[i >> 1];
+        uint16_t a = lut4[b >> 4];
+        uint16_t c = lut4[b & 0x0F];
+        if (scale == 1)
+        {
+            *dst++ = a;
+            if (i + 1 < w)
+            {
+                *dst++ = c;
+            }
+            continue;
+        }
+        dst[0] = dst[1] = a;
+        dst += 2;
+        if (i + 1 < w)
+        {
+            dst[0] = dst[1] = c;
+            dst += 2;
+        }
+    }
+}
+
+// Each chunk is a window of its own: lcd_PushColorsAsync() sets the address
+// only once the previous chunk is out, by then the buffer filled next is free
+bool tftPalettePush(TFT_eSprite &src, int16_t x, int16_t y, uint8_t scale)
+{
+    uint8_t bpp = src.getColorDepth();
+    const uint8_t *img = (const uint8_t *)src.getPointer();
+    int16_t w = src.width();
+    int16_t h = src.height();
+    int16_t outW = w * scale;
+    if (((bpp != 4) && (bpp != 8)) || (img == NULL) || ((scale != 1) && (scale != 2)))
+    {
+        Serial.printf("!!! tftPalettePush ERROR: %u bit sprite at scale %u\r\n", bpp, scale);
+        return false;
+    }
+    if ((x < 0) || (y < 0) || (x & 1) || (outW & 1) || (x + outW > X_TFT_WIDTH) || (y + h * scale > X_TFT_HEIGHT) ||
+        (outW > TFT_PAL_BOUNCE_PX / scale))
+    {
+        Serial.printf("!!! tftPalettePush ERROR: %dx%d at %d,%d does not fit\r\n", outW, h * scale, x, y);
+        return false;
+    }
+    if (!allocBounce())
+    {
+        return false;
+    }
+    if (bpp == 8)
+    {
+        if (!lut8Built)
+        {
+            buildLut8();
+        }
+    }
+    else
+    {
+        for (uint8_t i = 0; i < 16; i++)
+        {
+            lut4[i] = panel565(src.getPaletteColor(i));
+        }
+    }
+
+    // TFT_eSprite pads 4-bit rows to an even pixel count
+    size_t stride = (bpp == 8) ? w : ((w + 1) & ~1) / 2;
+    int16_t rowsPerChunk = max(1, TFT_PAL_BOUNCE_PX / (outW * scale));
+    for (int16_t row = 0; row < h; row += rowsPerChunk)
+    {
+        int16_t rows = min(rowsPerChunk, (int16_t)(h - row));
+        uint16_t *dst = bounce[next];
+        const uint8_t *line = img + (size_t)row * stride;
+        for (int16_t k = 0; k < rows; k++, line += stride)
+        {
+            expandRow(line, bpp, w, scale, dst);
+            dst += outW;
+            if (scale == 2)
+            {
+                memcpy(dst, dst - outW, outW * sizeof(uint16_t));
+                dst += outW;
+            }
+        }
+        lcd_PushColorsAsync(x, y + row * scale, outW, rows * scale, bounce[next]);
+        next ^= 1;
+    }
+    return true;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <Arduino.h>
+#include <TFT_eSPI.h>
+
+// Low-depth sprites for screens of a few colours: a 4-bit sprite (its own
+// 16-entry palette) or an 8-bit one (TFT_eSPI's RGB332) takes a quarter or
+// half of the RGB565 bytes in PSRAM. The push expands the indices through a
+// RGB565 lookup table into two DMA bounce buffers in internal RAM, one is
+// filled while the other is on the bus, so the sprite itself is never read
+// by DMA and may be redrawn as soon as the push returns. With scale 2 every
+// pixel goes out as a 2x2 block: a half-resolution background layer, a
+// quarter of the pixels again, for pictures and fills that do not need more.
+
+#define TFT_PAL_BOUNCE_PX       4096    // pixels per bounce buffer, two are used
+
+// Queues src for DMA at x, y (even, the panel takes column windows on even
+// boundaries), width and height times scale (1 or 2); false when it is not a
+// 4 or 8 bit sprite, does not fit the panel or there are no bounce buffers.
+// Returns once the last chunk is queued, lcd_WaitIdle() waits for the rest.
+bool tftPalettePush(TFT_eSprite &src, int16_t x, int16_t y, uint8_t scale = 1);
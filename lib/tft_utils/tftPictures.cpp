@@ -2,51 +2,51 @@
 
 void bazaLogo(void)
 {
-    tftDrawBmp("/xgamelogo.bmp", 0, 0, 536, 240);
+    tftDrawBmp(TFT_PIC_LOGO, 0, 0, 536, 240);
     delay(3000);
 }
 
 void gameWaitLogo(void)
 {
-    tftDrawBmp("/xhat.bmp", 0, 0, 536, 240);    
+    tftDrawBmp(TFT_PIC_WAIT, 0, 0, 536, 240);    
 }
 
 void zombiPreWaitPicture(void)
 {
-    tftDrawBmp("/xzomb.bmp", 0, 0, 536, 240);    
+    tftDrawBmp(TFT_PIC_PRE_ZOMBIE, 0, 0, 536, 240);    
 }
 
 void humanPreWaitPicture(void)
 {
-    tftDrawBmp("/xhum.bmp", 0, 0, 536, 240);    
+    tftDrawBmp(TFT_PIC_PRE_HUMAN, 0, 0, 536, 240);    
 }
 
 void basePreWaitPicture(void)
 {
-    tftDrawBmp("/xbase.bmp", 0, 0, 536, 240);    
+    tftDrawBmp(TFT_PIC_PRE_BASE, 0, 0, 536, 240);    
 }
 
 void gameOverPicture(void)
 {
-    tftDrawBmp("/xgameover.bmp", 0, 0, 536, 240);    
+    tftDrawBmp(TFT_PIC_GAME_OVER, 0, 0, 536, 240);    
 }
 
 void gameCriticalErrorPicture(String msgS)
 {
-    tftDrawBmp("/xerror.bmp", 0, 0, 536, 240);        
+    tftDrawBmp(TFT_PIC_ERROR, 0, 0, 536, 240);        
 }
 
 void humanWinPicture(void)
 {
-    tftDrawBmp("/hwin.bmp", 0, 0, 536, 240);        
+    tftDrawBmp(TFT_PIC_HUMAN_WIN, 0, 0, 536, 240);        
 }
 
 void zombieWinPicture(void)
 {
-    tftDrawBmp("/zwin.bmp", 0, 0, 536, 240);        
+    tftDrawBmp(TFT_PIC_ZOMBIE_WIN, 0, 0, 536, 240);        
 }
 
 void drawPicture(void)
 {
-    tftDrawBmp("/draw.bmp", 0, 0, 536, 240);        
+    tftDrawBmp(TFT_PIC_DRAW, 0, 0, 536, 240);        
 }
\ No newline at end of file
@@ -0,0 +1,83 @@
+#include "tftPower.h"
+
+#include "rm67162.h"
+#include "board.h"
+
+static const uint8_t phaseLevel[] = {TFT_BRIGHT_WAIT, TFT_BRIGHT_PRE_GAME, TFT_BRIGHT_GAME, TFT_BRIGHT_GAME_OVER};
+
+static tTftPowerPhase curPhase = tpPreGame;
+static uint8_t curLevel = 0xD0;         // what rm67162_init() leaves
+static bool idle = false;
+static uint8_t battPct = 100;
+static uint32_t battCheckedMs = 0;
+static bool battChecked = false;
+
+static void applyLevel(uint8_t level)
+{
+    if (level == curLevel)
+    {
+        return;
+    }
+    lcd_setBrightness(level);
+    Serial.printf(">>> tftPower: brightness 0x%02X -> 0x%02X [phase %d] [battery %u%%]\r\n", curLevel, level, curPhase, battPct);
+    curLevel = level;
+}
+
+void tftPowerSetPhase(tTftPowerPhase phase)
+{
+    bool battDue = !battChecked || (millis() - battCheckedMs >= TFT_POWER_BATT_CHECK_MS);
+    if ((phase == curPhase) && !idle && !battDue)
+    {
+        return;
+    }
+    if (battDue)
+    {
+        battPct = boardGetVccPercent();
+        battCheckedMs = millis();
+        battChecked = true;
+    }
+    if (idle)
+    {
+        lcd_setIdleMode(false);
+#if TFT_POWER_IDLE_PARTIAL
+        lcd_setNormalMode();
+#endif
+        idle = false;
+    }
+    curPhase = phase;
+    uint8_t level = phaseLevel[phase];
+    if (battPct < TFT_POWER_LOW_BATT_PCT)
+    {
+        level = (uint16_t)level * TFT_POWER_LOW_BATT_SCALE / 100;
+    }
+    applyLevel(level);
+}
+
+void tftPowerIdle(void)
+{
+    if (idle)
+    {
+        return;
+    }
+#if TFT_POWER_IDLE_PARTIAL
+    lcd_setPartialMode(TFT_POWER_IDLE_ROW_START, TFT_POWER_IDLE_ROW_END);
+#endif
+    lcd_setIdleMode(true);
+    idle = true;
+    applyLevel(min(curLevel, (uint8_t)TFT_BRIGHT_IDLE));
+}
+
+bool tftPowerIsIdle(void)
+{
+    return idle;
+}
+
+tTftPowerPhase tftPowerPhase(void)
+{
+    return curPhase;
+}
+
+uint8_t tftPowerBrightness(void)
+{
+    return curLevel;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Display power manager: the AMOLED draws power per lit pixel and drive level,
+// so brightness follows the game phase and is scaled down on a low battery,
+// and long waits put the panel into idle (8 colour) mode at a dim level.
+// Called from the task that owns the panel only.
+
+enum tTftPowerPhase
+{
+    tpWait,         // waiting for the server to start a game
+    tpPreGame,      // role countdown and critical errors, have to be read
+    tpGame,
+    tpGameOver
+};
+
+#define TFT_BRIGHT_WAIT         0x60
+#define TFT_BRIGHT_PRE_GAME     0xD0
+#define TFT_BRIGHT_GAME         0xB0
+#define TFT_BRIGHT_GAME_OVER    0x80
+#define TFT_BRIGHT_IDLE         0x20
+#define TFT_POWER_LOW_BATT_PCT  25      // below it the phase level is cut to TFT_POWER_LOW_BATT_SCALE %
+#define TFT_POWER_LOW_BATT_SCALE 60
+#define TFT_POWER_BATT_CHECK_MS 60000
+#define TFT_POWER_IDLE_AFTER_MS 30000   // of an unchanged wait screen
+// Idle mode can also narrow the lit area to panel rows IDLE_ROW_START..END,
+// off by default as the band depends on where the wait logo is drawn
+#ifndef TFT_POWER_IDLE_PARTIAL
+#define TFT_POWER_IDLE_PARTIAL  0
+#endif
+#define TFT_POWER_IDLE_ROW_START 0
+#define TFT_POWER_IDLE_ROW_END  (X_TFT_WIDTH - 1)
+
+void tftPowerSetPhase(tTftPowerPhase phase);    // also leaves idle mode, cheap when nothing changed
+void tftPowerIdle(void);
+bool tftPowerIsIdle(void);
+tTftPowerPhase tftPowerPhase(void);
+uint8_t tftPowerBrightness(void);
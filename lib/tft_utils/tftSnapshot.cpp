@@ -0,0 +1,85 @@
+#include "tftSnapshot.h"
+
+#include "esp_heap_caps.h"
+#include "tftFrame.h"
+
+#define TFT_SNAP_RUN_MAX        129
+#define TFT_SNAP_LITERAL_MAX    128
+
+// Worst case, literals all through, shrunk to what it took once coded
+static size_t snapshotMax(size_t pixels)
+{
+    return sizeof(tTftSnapHeader) + pixels * sizeof(uint16_t) + (pixels + TFT_SNAP_LITERAL_MAX - 1) / TFT_SNAP_LITERAL_MAX;
+}
+
+static size_t encodeRle(const uint16_t *px, size_t n, uint8_t *out)
+{
+    uint8_t *o = out;
+    size_t i = 0;
+    while (i < n)
+    {
+        size_t run = 1;
+        while ((i + run < n) && (run < TFT_SNAP_RUN_MAX) && (px[i + run] == px[i]))
+        {
+            run++;
+        }
+        if (run >= 2)
+        {
+            *o++ = 0x80 | (uint8_t)(run - 2);
+            memcpy(o, &px[i], sizeof(uint16_t));
+            o += sizeof(uint16_t);
+            i += run;
+            continue;
+        }
+        // up to where the next run starts
+        size_t start = i;
+        do
+        {
+            i++;
+        } while ((i < n) && (i - start < TFT_SNAP_LITERAL_MAX) && !((i + 1 < n) && (px[i + 1] == px[i])));
+        *o++ = (uint8_t)(i - start - 1);
+        memcpy(o, &px[start], (i - start) * sizeof(uint16_t));
+        o += (i - start) * sizeof(uint16_t);
+    }
+    return o - out;
+}
+
+uint8_t *tftSnapshotCapture(size_t &len)
+{
+    len = 0;
+    const uint16_t *px = tftFrameFront();
+    if (px == NULL)
+    {
+        Serial.println("!!! tftSnapshotCapture ERROR: no framebuffer");
+        return NULL;
+    }
+    size_t pixels = (size_t)X_TFT_WIDTH * X_TFT_HEIGHT;
+    uint8_t *out = (uint8_t *)heap_caps_malloc(snapshotMax(pixels), MALLOC_CAP_SPIRAM);
+    if (out == NULL)
+    {
+        Serial.println("!!! tftSnapshotCapture ERROR: out of PSRAM");
+        return NULL;
+    }
+    uint32_t startMs = millis();
+    tTftFrameTimes times;
+    tftFrameGetTimes(times);
+    tTftSnapHeader &hdr = *(tTftSnapHeader *)out;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = TFT_SNAP_MAGIC;
+    hdr.version = TFT_SNAP_VERSION;
+    hdr.flags = tftFrameDoubleBuffered() ? TFT_SNAP_FLAG_DOUBLE : 0;
+    hdr.w = X_TFT_WIDTH;
+    hdr.h = X_TFT_HEIGHT;
+    hdr.renderMs = times.renderMs;
+    hdr.renderMaxMs = times.renderMaxMs;
+    hdr.pushUs = times.pushUs;
+    hdr.pushMaxUs = times.pushMaxUs;
+    hdr.pushes = times.pushes;
+    hdr.pushAgeMs = times.pushes ? startMs - times.lastPushMs : 0;
+    hdr.uptimeMs = startMs;
+    len = sizeof(hdr) + encodeRle(px, pixels, out + sizeof(hdr));
+
+    uint8_t *shrunk = (uint8_t *)heap_caps_realloc(out, len, MALLOC_CAP_SPIRAM);
+    Serial.printf(">>> tftSnapshotCapture: %u bytes in %lu ms\r\n", (unsigned)len, millis() - startMs);
+    return (shrunk != NULL) ? shrunk : out;
+}
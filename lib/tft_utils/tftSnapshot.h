@@ -0,0 +1,39 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Framebuffer snapshots for field debugging: the frame last pushed to the
+// panel, run-length coded, with the display timing of tftFrame.h. Served by
+// the portal (GET /snapshot), the binary serial protocol (sbSnapshot) and,
+// on the status server's "snapshot" command, posted to its /snapshot.
+//
+// Layout (little endian): tTftSnapHeader, then the w x h pixels row by row as
+// packets of a control byte c and RGB565 pixels as the panel gets them (big
+// endian): c < 0x80 is c + 1 literal pixels, c >= 0x80 one pixel repeated
+// (c & 0x7F) + 2 times.
+
+#define TFT_SNAP_MAGIC          0x3142465A  // "ZFB1"
+#define TFT_SNAP_VERSION        1
+#define TFT_SNAP_CT             "application/x-zgame-frame"
+
+#define TFT_SNAP_FLAG_DOUBLE    0x01        // double buffered, the frame may tear with a swap while it was read
+
+struct __attribute__((packed)) tTftSnapHeader
+{
+    uint32_t magic;
+    uint8_t  version;
+    uint8_t  flags;         // TFT_SNAP_FLAG_*
+    uint16_t w;
+    uint16_t h;
+    uint16_t reserved;
+    uint32_t renderMs;      // tTftFrameTimes
+    uint32_t renderMaxMs;
+    uint32_t pushUs;
+    uint32_t pushMaxUs;
+    uint32_t pushes;
+    uint32_t pushAgeMs;     // since the last push
+    uint32_t uptimeMs;
+};
+
+// Any task; a PSRAM buffer the caller frees, NULL without a framebuffer or memory
+uint8_t *tftSnapshotCapture(size_t &len);
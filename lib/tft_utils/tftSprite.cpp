@@ -1,9 +1,10 @@
 #include "rm67162.h"
 #include <TFT_eSPI.h>   //https://github.com/Bodmer/TFT_eSPI
-#include "true_color.h"
 #include "tft_utils.h"
 
 #include "PSRamFS.h"
+#include "serverSync.h"
+#include "tftFrame.h"
 
 unsigned int rainbow(uint8_t value);
 void drawRainbow();
@@ -51,6 +52,7 @@ void setupTFT(String textS = "BOOT")
 
     spr.createSprite(X_TFT_WIDTH, X_TFT_HEIGHT);
     spr.setSwapBytes(1);
+    tftFrameInit();
     
     spr.fillSprite(TFT_BLACK);
     spr.setTextColor(TFT_GREEN, TFT_BLACK);
@@ -121,6 +123,9 @@ tSprite::~tSprite()
 
 extern uint16_t read16(fs::File &f);
 extern uint32_t read32(fs::File &f);
+extern bool tftPackedBmpToSprite(const char *filename, int16_t x, int16_t y, TFT_eSprite &dst);
+extern bool tftRgb565FileToSprite(fs::File &f, int16_t x, int16_t y, TFT_eSprite &dst);
+extern bool tftCachedBmpFileToSprite(fs::File &f, const char *filename, int16_t x, int16_t y, TFT_eSprite &dst);
 
 void tSprite::drawBmp(const char *filename, int16_t x, int16_t y)
 {
@@ -131,9 +136,19 @@ void tSprite::drawBmp(const char *filename, int16_t x, int16_t y)
         return;
     }
 
+    if (tftPackedBmpToSprite(filename, x, y, *spr))
+    {
+        pushColors();
+        return;
+    }
+
     fs::File bmpFS;
     
-    bmpFS = PSRamFS.open(filename, "r");
+    fs::FS *srcFs = assetFsFor(filename);
+    if (srcFs != NULL)
+    {
+        bmpFS = srcFs->open(filename, "r");
+    }
 
     if (!bmpFS)
     {
@@ -142,9 +157,15 @@ void tSprite::drawBmp(const char *filename, int16_t x, int16_t y)
         return;
     }
 
+    if (tftRgb565FileToSprite(bmpFS, x, y, *spr) || tftCachedBmpFileToSprite(bmpFS, filename, x, y, *spr))
+    {
+        bmpFS.close();
+        pushColors();
+        return;
+    }
+
     uint32_t seekOffset;
     uint16_t w, h, row, col;
-    uint8_t r, g, b;    
 
     uint32_t startTime = millis();
 
@@ -172,19 +193,10 @@ void tSprite::drawBmp(const char *filename, int16_t x, int16_t y)
             {
 
                 bmpFS.read(lineBuffer, sizeof(lineBuffer));
-                uint8_t *bptr = lineBuffer;
-                uint16_t *tptr = (uint16_t *)lineBuffer;
-                // Convert 24 to 16-bit colours
-                for (uint16_t col = 0; col < w; col++)
-                {
-                    b = *bptr++;
-                    g = *bptr++;
-                    r = *bptr++;
-                    *tptr++ = ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
-                }
+                // Convert 24 to 16-bit colours, in place
+                tftBgr888ToRgb565(lineBuffer, (uint16_t *)lineBuffer, w, false);
 
                 spr->pushImage(x, y--, w, 1, (uint16_t*)lineBuffer, 16);                
-                //spr.pushImage(0, 0, X_TFT_WIDTH, X_TFT_HEIGHT, (uint16_t *)gImage_true_color);
             }
             //lcd_PushColors(x, y, w, h, (uint16_t *)spr.getPointer());
             //lcd_PushColors(0, 0, X_TFT_WIDTH, X_TFT_HEIGHT, (uint16_t *)spr->getPointer());
@@ -0,0 +1,54 @@
+#include "tftTestPattern.h"
+
+#if TFT_TEST_PATTERN
+
+#include "TFT_eSPI.h"
+#include "assetPack.h"
+#include "serverSync.h"
+#include "tftCompositor.h"
+#include "tft_utils.h"
+
+extern TFT_eSprite spr;
+
+static const uint16_t barColors[] = {TFT_WHITE, TFT_YELLOW, TFT_CYAN, TFT_GREEN, TFT_MAGENTA, TFT_RED, TFT_BLUE, TFT_BLACK};
+
+// Bars over the top 2/3, a 32 step grey ramp under them, a 1 px white border
+// so a clipped edge or an off by one window shows
+static void drawBuiltIn(void)
+{
+    const int16_t w = spr.width();
+    const int16_t h = spr.height();
+    const int16_t barsH = h * 2 / 3;
+    const uint8_t bars = sizeof(barColors) / sizeof(barColors[0]);
+    for (uint8_t i = 0; i < bars; i++)
+    {
+        int16_t x0 = w * i / bars;
+        spr.fillRect(x0, 0, w * (i + 1) / bars - x0, barsH, barColors[i]);
+    }
+    for (uint8_t i = 0; i < 32; i++)
+    {
+        int16_t x0 = w * i / 32;
+        uint8_t level = i * 255 / 31;
+        spr.fillRect(x0, barsH, w * (i + 1) / 32 - x0, h - barsH, spr.color565(level, level, level));
+    }
+    spr.drawRect(0, 0, w, h, TFT_WHITE);
+    tftDirtyAll();
+    tftDirtyFlush();
+}
+
+void tftTestPattern(bool builtIn)
+{
+    uint32_t startMs = millis();
+    const uint8_t *data;
+    size_t size;
+    if (!builtIn && (assetPackFind(TFT_TEST_PATTERN_FILE, &data, &size) || ensureFileInPsram(TFT_TEST_PATTERN_FILE)))
+    {
+        tftDrawBmp(TFT_TEST_PATTERN_FILE, 0, 0);
+        Serial.printf(">>> tftTestPattern: %s\r\n", TFT_TEST_PATTERN_FILE);
+        return;
+    }
+    drawBuiltIn();
+    Serial.printf(">>> tftTestPattern: built in, %u ms\r\n", (unsigned)(millis() - startMs));
+}
+
+#endif
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Panel bring-up pattern, built in only with TFT_TEST_PATTERN=1. Draws the
+// synced TFT_TEST_PATTERN_FILE when the device has it (made by
+// servers/SingleSystemServer/make_test_pattern.py, the old true colour image
+// compiled into every firmware), else colour bars, a grey ramp and a border
+// drawn straight into spr, so it needs nothing but the panel.
+
+#ifndef TFT_TEST_PATTERN
+#define TFT_TEST_PATTERN        0
+#endif
+#define TFT_TEST_PATTERN_FILE   "/test_pattern.bmp"
+
+#if TFT_TEST_PATTERN
+// Not synchronized with the screen task, for a bench device on the boot or wait screen
+void tftTestPattern(bool builtIn = false);
+#endif
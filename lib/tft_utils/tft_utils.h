@@ -14,6 +14,31 @@
 #define FORCE_UPDATE_AFTER_MS       5000
 #define DELTA_RSSI_FOR_TFT_UPDATE   5
 
+// Full screen pictures and game screen icons, also what the prefetcher warms
+#define TFT_PIC_LOGO                "/xgamelogo.bmp"
+#define TFT_PIC_WAIT                "/xhat.bmp"
+#define TFT_PIC_PRE_ZOMBIE          "/xzomb.bmp"
+#define TFT_PIC_PRE_HUMAN           "/xhum.bmp"
+#define TFT_PIC_PRE_BASE            "/xbase.bmp"
+#define TFT_PIC_GAME_OVER           "/xgameover.bmp"
+#define TFT_PIC_ERROR               "/xerror.bmp"
+#define TFT_PIC_HUMAN_WIN           "/hwin.bmp"
+#define TFT_PIC_ZOMBIE_WIN          "/zwin.bmp"
+#define TFT_PIC_DRAW                "/draw.bmp"
+#define TFT_GAME_BASE_ICO_FNAME     "/base_ico.bmp"
+#define TFT_GAME_ZOMB_ICO_FNAME     "/zomb_ico.bmp"
+#define TFT_GAME_HUMN_ICO_FNAME     "/hum_ico.bmp"
+
+// Transition animations (tftAnim.h), played on entering the screen when the
+// device has them; they should end on the picture above that they lead into.
+// The pre-game ones must not loop, their countdown waits for them.
+#define TFT_ANIM_PRE_ZOMBIE         "/xzomb.zan"
+#define TFT_ANIM_PRE_HUMAN          "/xhum.zan"
+#define TFT_ANIM_PRE_BASE           "/xbase.zan"
+#define TFT_ANIM_HUMAN_WIN          "/hwin.zan"
+#define TFT_ANIM_ZOMBIE_WIN         "/zwin.zan"
+#define TFT_ANIM_DRAW               "/draw.zan"
+
 // struct lcd_cmd_t
 // {
 //     uint8_t cmd;
@@ -57,6 +82,8 @@ void tftPrintThreeLines(String txt1, String txt2, String txt3, uint16_t bgColor,
 void tftDrawBmp(const char *filename, int16_t x, int16_t y, uint16_t wLimit = 0, uint16_t hLimit = 0);
 void tftTestBmp(void);
 void tftDrawBmpToSprite(const char *filename, int16_t x, int16_t y, uint16_t wLimit, uint16_t hLimit, TFT_eSprite &spr);
+void tftBgr888ToRgb565(const uint8_t *src, uint16_t *dst, uint32_t n, bool swapBytes);
+bool tftBmpPrefetch(const char *filename);  // any task, decodes into the image cache without drawing
 
 
 //Picture functions
@@ -74,6 +101,7 @@ void drawPicture(void);
 void tftGameScreenBase(int32_t topVal, int32_t botVal, uint32_t secLeft);
 void tftGameScreenHuman(int32_t topVal, int32_t botVal, uint32_t secLeft);
 void tftGameScreenZombie(int32_t topVal, int32_t botVal, uint32_t secLeft);
+void tftGameScreenScore(int32_t humans, int32_t zombies, uint32_t secLeft);
 void tftGameScreenTest(void);
 
 void tftGameScreenRaw(String fName, uint16_t txtColor, String str1, String str2, String secStr);
@@ -0,0 +1,254 @@
+#include "uplink.h"
+
+#include <WiFi.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+
+#include "taskRegistry.h"
+#include "espAirtime.h"
+
+struct tUplinkSlot
+{
+    tUplinkService service = NULL;
+    uint8_t  priority = 0;
+    uint32_t intervalMs = 0;
+    uint32_t baseIntervalMs = 0;    // the registered one
+    uint8_t  jitterPct = 0;
+    uint32_t dueMs = 0;             // interval with this run's jitter
+    uint32_t lastRunMs = 0;
+    bool     pending = false;
+    bool     bulk = false;
+    bool     deferred = false;      // held back to an airtime gap, counted once
+};
+
+static tUplinkSlot slots[UPLINK_CHANNEL_COUNT];
+static portMUX_TYPE uplinkMux = portMUX_INITIALIZER_UNLOCKED;
+static QueueHandle_t uplinkQueue = NULL;
+static TaskHandle_t uplinkTaskHandle = NULL;
+
+// Picks the highest priority channel that is kicked or due, -1 if none;
+// waitMs is set to the time until the next one becomes due or the next
+// airtime gap for a bulk channel that has to wait for one
+static int pickChannel(uint32_t nowMs, uint32_t &waitMs)
+{
+    int best = -1;
+    waitMs = UPLINK_IDLE_MS;
+    uint32_t airWaitMs = airtimeBulkWaitMs();
+    portENTER_CRITICAL(&uplinkMux);
+    for (int i = 0; i < UPLINK_CHANNEL_COUNT; i++)
+    {
+        tUplinkSlot &slot = slots[i];
+        if (slot.service == NULL)
+        {
+            continue;
+        }
+        uint32_t elapsed = nowMs - slot.lastRunMs;
+        if (slot.pending || (elapsed >= slot.dueMs))
+        {
+            if (slot.bulk && (airWaitMs > 0))
+            {
+                if (!slot.deferred)
+                {
+                    slot.deferred = true;
+                    airtimeOnDeferred();
+                }
+                if (airWaitMs < waitMs)
+                {
+                    waitMs = airWaitMs;
+                }
+                continue;
+            }
+            if ((best < 0) || (slot.priority > slots[best].priority))
+            {
+                best = i;
+            }
+        }
+        else if (slot.dueMs - elapsed < waitMs)
+        {
+            waitMs = slot.dueMs - elapsed;
+        }
+    }
+    portEXIT_CRITICAL(&uplinkMux);
+    return best;
+}
+
+// Under uplinkMux
+static void scheduleNext(tUplinkSlot &slot)
+{
+    uint32_t spread = slot.intervalMs * slot.jitterPct / 100;
+    slot.dueMs = slot.intervalMs;
+    if (spread > 0)
+    {
+        slot.dueMs = slot.intervalMs - spread + esp_random() % (2 * spread + 1);
+    }
+}
+
+static void uplinkTask(void *parameter)
+{
+    Serial.println(">>> uplinkTask: running");
+    while (true)
+    {
+        if (WiFi.status() != WL_CONNECTED)
+        {
+            vTaskDelay(pdMS_TO_TICKS(UPLINK_WIFI_WAIT_MS));
+            continue;
+        }
+
+        uint32_t waitMs;
+        int ch = pickChannel(millis(), waitMs);
+        if (ch < 0)
+        {
+            // a kick only wakes the task, the pending flag is already set
+            uint8_t kicked;
+            xQueueReceive(uplinkQueue, &kicked, pdMS_TO_TICKS(waitMs));
+            continue;
+        }
+
+        tUplinkService service;
+        bool bulk;
+        portENTER_CRITICAL(&uplinkMux);
+        service = slots[ch].service;
+        bulk = slots[ch].bulk;
+        slots[ch].pending = false;
+        slots[ch].deferred = false;
+        slots[ch].lastRunMs = millis();
+        scheduleNext(slots[ch]);
+        portEXIT_CRITICAL(&uplinkMux);
+
+        if (service)
+        {
+            if (bulk)
+            {
+                airtimeBulkBegin();
+            }
+            service();
+            if (bulk)
+            {
+                airtimeBulkEnd();
+            }
+        }
+        // kicks that arrived during the exchange are already folded into the flags
+        xQueueReset(uplinkQueue);
+    }
+}
+
+bool uplinkStart(void)
+{
+    if (uplinkTaskHandle != NULL)
+    {
+        return true;
+    }
+    if (uplinkQueue == NULL)
+    {
+        uplinkQueue = xQueueCreate(UPLINK_QUEUE_LEN, sizeof(uint8_t));
+        if (uplinkQueue == NULL)
+        {
+            Serial.println("!!! uplinkStart ERROR: xQueueCreate failed");
+            return false;
+        }
+    }
+    if (!taskStart(tkUplink, uplinkTask, NULL, &uplinkTaskHandle))
+    {
+        return false;
+    }
+    Serial.println(">>> uplinkStart: task started");
+    return true;
+}
+
+bool uplinkIsRunning(void)
+{
+    return uplinkTaskHandle != NULL;
+}
+
+void uplinkRegister(tUplinkChannel ch, uint8_t priority, uint32_t intervalMs, tUplinkService service)
+{
+    if (ch >= UPLINK_CHANNEL_COUNT)
+    {
+        return;
+    }
+    portENTER_CRITICAL(&uplinkMux);
+    slots[ch].service = service;
+    slots[ch].priority = priority;
+    slots[ch].intervalMs = intervalMs;
+    slots[ch].baseIntervalMs = intervalMs;
+    slots[ch].jitterPct = 0;
+    slots[ch].dueMs = intervalMs;
+    slots[ch].lastRunMs = millis();
+    slots[ch].pending = true;   // first exchange right away
+    slots[ch].deferred = false;
+    portEXIT_CRITICAL(&uplinkMux);
+    uplinkKick(ch);
+}
+
+// An exchange already in flight is finished, the channel is not run again
+void uplinkUnregister(tUplinkChannel ch)
+{
+    if (ch >= UPLINK_CHANNEL_COUNT)
+    {
+        return;
+    }
+    portENTER_CRITICAL(&uplinkMux);
+    slots[ch].service = NULL;
+    slots[ch].pending = false;
+    portEXIT_CRITICAL(&uplinkMux);
+}
+
+void uplinkKick(tUplinkChannel ch)
+{
+    if (ch >= UPLINK_CHANNEL_COUNT)
+    {
+        return;
+    }
+    portENTER_CRITICAL(&uplinkMux);
+    slots[ch].pending = true;
+    portEXIT_CRITICAL(&uplinkMux);
+    if (uplinkQueue != NULL)
+    {
+        uint8_t msg = ch;
+        xQueueSend(uplinkQueue, &msg, 0);
+    }
+}
+
+void uplinkSetInterval(tUplinkChannel ch, uint32_t intervalMs, uint8_t jitterPct)
+{
+    if (ch >= UPLINK_CHANNEL_COUNT)
+    {
+        return;
+    }
+    portENTER_CRITICAL(&uplinkMux);
+    tUplinkSlot &slot = slots[ch];
+    if (intervalMs == 0)
+    {
+        intervalMs = slot.baseIntervalMs;
+        jitterPct = 0;
+    }
+    bool changed = (intervalMs != slot.intervalMs);
+    slot.intervalMs = intervalMs;
+    slot.jitterPct = jitterPct;
+    if (changed)
+    {
+        scheduleNext(slot);
+    }
+    portEXIT_CRITICAL(&uplinkMux);
+    if (changed)
+    {
+        // a shorter interval may already be due, the task reconsiders its wait
+        uint8_t msg = ch;
+        if (uplinkQueue != NULL)
+        {
+            xQueueSend(uplinkQueue, &msg, 0);
+        }
+    }
+}
+
+void uplinkSetBulk(tUplinkChannel ch, bool bulk)
+{
+    if (ch >= UPLINK_CHANNEL_COUNT)
+    {
+        return;
+    }
+    portENTER_CRITICAL(&uplinkMux);
+    slots[ch].bulk = bulk;
+    portEXIT_CRITICAL(&uplinkMux);
+}
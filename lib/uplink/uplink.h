@@ -0,0 +1,36 @@
+#pragma once
+
+#include <Arduino.h>
+
+// One task carries every device-to-server exchange. Producers register a
+// service per channel and kick it when they have news; kicks are coalesced
+// into one pending flag per channel and the highest priority due channel runs first.
+
+#define UPLINK_QUEUE_LEN        8
+#define UPLINK_IDLE_MS          1000    // longest sleep when nothing is due
+#define UPLINK_WIFI_WAIT_MS     1000
+
+enum tUplinkChannel
+{
+    ucGameApi = 0,
+    ucStatus,
+    ucGameLog,
+    UPLINK_CHANNEL_COUNT
+};
+
+typedef void (*tUplinkService)(void);
+
+bool uplinkStart(void);
+bool uplinkIsRunning(void);
+
+// The service runs in the uplink task, at most every intervalMs unless kicked
+void uplinkRegister(tUplinkChannel ch, uint8_t priority, uint32_t intervalMs, tUplinkService service);
+void uplinkUnregister(tUplinkChannel ch);
+void uplinkKick(tUplinkChannel ch);
+// An interval the server advertised, each run is put off by up to jitterPct
+// of it either way so the fleet does not poll in step; 0 restores the
+// registered one
+void uplinkSetInterval(tUplinkChannel ch, uint32_t intervalMs, uint8_t jitterPct = 0);
+// A bulk channel only starts an exchange when espAirtime allows it, during
+// play that is in the shared gaps; the game API stays real-time
+void uplinkSetBulk(tUplinkChannel ch, bool bulk);
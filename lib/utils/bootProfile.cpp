@@ -0,0 +1,174 @@
+#include "bootProfile.h"
+
+#include <esp_timer.h>
+
+static const char *stageNames[BOOT_STAGE_COUNT] =
+    {"PSRAM_FS", "CONFIG", "BOARD", "ACCEL", "NETWORK", "PRELOAD", "DISCO", "STATUS", "OTA", "FILE_SYNC", "VAL_PARSE", "RADIO", "ROLES"};
+
+struct tBootStage
+{
+    int64_t startUs;
+    int64_t endUs;
+};
+
+static tBootStage stages[BOOT_STAGE_COUNT];
+static int64_t steps[BOOT_STEP_COUNT];
+static int64_t bootStartUs = 0;
+static int64_t bootReadyUs = 0;
+static uint32_t httpCount = 0;
+static int64_t httpTotalUs = 0;
+static int64_t httpMaxUs = 0;
+static uint32_t psramBytes = 0;
+static uint32_t psramFiles = 0;
+static volatile bool finished = false;
+static volatile bool pending = false;
+static portMUX_TYPE profMux = portMUX_INITIALIZER_UNLOCKED;
+
+static inline uint32_t toMs(int64_t us)
+{
+    return (uint32_t)(us / 1000);
+}
+
+void bootProfStart(void)
+{
+    memset(stages, 0, sizeof(stages));
+    memset(steps, 0, sizeof(steps));
+    bootStartUs = esp_timer_get_time();
+}
+
+void bootProfStageBegin(tBootStageId id)
+{
+    stages[id].startUs = esp_timer_get_time();
+    stages[id].endUs = 0;
+}
+
+void bootProfStageEnd(tBootStageId id)
+{
+    stages[id].endUs = esp_timer_get_time();
+}
+
+const char *bootProfStageName(tBootStageId id)
+{
+    return stageNames[id];
+}
+
+void bootProfStep(tBootStep step)
+{
+    if (!finished && (steps[step] == 0))
+    {
+        steps[step] = esp_timer_get_time();
+    }
+}
+
+void bootProfHttp(int64_t startUs)
+{
+    if (finished)
+    {
+        return;
+    }
+    int64_t us = esp_timer_get_time() - startUs;
+    portENTER_CRITICAL(&profMux);
+    httpCount++;
+    httpTotalUs += us;
+    if (us > httpMaxUs)
+    {
+        httpMaxUs = us;
+    }
+    portEXIT_CRITICAL(&profMux);
+}
+
+void bootProfPsramCopy(uint32_t bytes)
+{
+    if (finished)
+    {
+        return;
+    }
+    portENTER_CRITICAL(&profMux);
+    psramBytes += bytes;
+    psramFiles++;
+    portEXIT_CRITICAL(&profMux);
+}
+
+// sub-step offsets are relative to the stage they belong to
+static void writeFields(tJsonWriter &json)
+{
+    json.field("start_ms", toMs(bootStartUs));
+    json.field("ready_ms", toMs(bootReadyUs - bootStartUs));
+    json.beginObject("stages");
+    for (int i = 0; i < BOOT_STAGE_COUNT; i++)
+    {
+        if (stages[i].endUs == 0)
+        {
+            continue;
+        }
+        json.beginArray(stageNames[i]);
+        json.value(toMs(stages[i].startUs - bootStartUs));
+        json.value(toMs(stages[i].endUs - stages[i].startUs));
+        json.endArray();
+    }
+    json.endObject();
+    if (steps[bpWifiAssoc] && stages[bsNet].startUs)
+    {
+        json.field("wifi_assoc_ms", toMs(steps[bpWifiAssoc] - stages[bsNet].startUs));
+    }
+    if (steps[bpDhcp] && steps[bpWifiAssoc])
+    {
+        json.field("dhcp_ms", toMs(steps[bpDhcp] - steps[bpWifiAssoc]));
+    }
+    json.field("http_n", httpCount);
+    json.field("http_ms", toMs(httpTotalUs));
+    json.field("http_max_ms", toMs(httpMaxUs));
+    json.field("psram_files", psramFiles);
+    json.field("psram_bytes", psramBytes);
+}
+
+void bootProfFinish(void)
+{
+    bootReadyUs = esp_timer_get_time();
+    finished = true;
+
+    Serial.printf(">>> bootProfFinish: READY in %lu ms (%lu ms since reset)\r\n",
+                  toMs(bootReadyUs - bootStartUs), toMs(bootReadyUs));
+    for (int i = 0; i < BOOT_STAGE_COUNT; i++)
+    {
+        const tBootStage &st = stages[i];
+        if (st.endUs == 0)
+        {
+            continue;
+        }
+        Serial.printf("\t%-10s at +%5lu ms, took %5lu ms\r\n", stageNames[i],
+                      toMs(st.startUs - bootStartUs), toMs(st.endUs - st.startUs));
+    }
+
+    static char buf[BOOT_PROF_JSON_BUF];
+    tJsonWriter json(buf, sizeof(buf));
+    json.beginObject();
+    writeFields(json);
+    json.endObject();
+    if (json.ok())
+    {
+        Serial.printf("BOOT_REPORT %s\r\n", json.c_str());
+    }
+    else
+    {
+        Serial.println("!!! bootProfFinish ERROR: report does not fit the JSON buffer");
+    }
+    pending = true;
+}
+
+bool bootProfPending(void)
+{
+    return pending;
+}
+
+void bootProfDelivered(void)
+{
+    pending = false;
+}
+
+void bootProfWriteJson(tJsonWriter &json)
+{
+    json.beginObject("boot");
+    writeFields(json);
+    json.endObject();
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "jsonWriter.h"
+
+// Boot profiler: stage and sub-step timestamps from esp_timer, reported once the
+// boot is done, as a table plus a BOOT_REPORT JSON line over Serial and as a
+// "boot" object in the first status update that follows.
+
+#define BOOT_PROF_JSON_BUF      640
+
+enum tBootStageId
+{
+    bsPsFs,
+    bsConfig,
+    bsBoard,
+    bsAccel,
+    bsNet,
+    bsPreload,
+    bsDisco,
+    bsStatus,
+    bsOta,
+    bsFileSync,
+    bsValParse,
+    bsRadio,
+    bsRoles,
+    BOOT_STAGE_COUNT
+};
+
+// One-shot sub-steps, only the first occurrence is kept
+enum tBootStep
+{
+    bpWifiAssoc,
+    bpDhcp,
+    BOOT_STEP_COUNT
+};
+
+void bootProfStart(void);
+void bootProfStageBegin(tBootStageId id);
+void bootProfStageEnd(tBootStageId id);
+const char *bootProfStageName(tBootStageId id);
+void bootProfStep(tBootStep step);
+void bootProfHttp(int64_t startUs);             // one HTTP round trip that began at startUs
+void bootProfPsramCopy(uint32_t bytes);         // one file copied from LittleFS to PSRAM
+void bootProfFinish(void);
+bool bootProfPending(void);                     // finished, not yet delivered in a status update
+void bootProfDelivered(void);
+void bootProfWriteJson(tJsonWriter &json);      // "boot":{...} member of an open object
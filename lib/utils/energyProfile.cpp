@@ -0,0 +1,448 @@
+#include "energyProfile.h"
+#include "board.h"
+#include "pmLocks.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+static const char *subsysNames[ENERGY_SUBSYS_COUNT] = {"cpu", "radio", "display", "leds", "vibro", "audio"};
+static const uint16_t subsysMa[ENERGY_SUBSYS_COUNT] =
+    {ENERGY_MA_CPU_BUSY - ENERGY_MA_CPU_IDLE, ENERGY_MA_RADIO_RX, ENERGY_MA_DISPLAY, ENERGY_MA_LEDS, ENERGY_MA_VIBRO, ENERGY_MA_AUDIO};
+
+struct tSubsysAcc
+{
+    uint8_t  level;
+    uint32_t sinceMs;
+    uint64_t levelMs;           // sum of level * ms
+    uint32_t events;
+    uint32_t rtSinceMs;         // the same for the runtime estimate, over its current interval
+    uint64_t rtLevelMs;
+    uint32_t rtEvents;
+};
+
+struct tRuntimeSample
+{
+    uint32_t ms;
+    uint8_t  pct;
+    uint16_t modelMa;           // mean over the interval that ended here
+};
+
+struct tTaskBase
+{
+    TaskHandle_t handle;
+    uint32_t     runTime;
+};
+
+struct tEnergyReport
+{
+    uint32_t elapsedMs;
+    uint8_t  duty[ENERGY_SUBSYS_COUNT];     // %
+    uint32_t events[ENERGY_SUBSYS_COUNT];
+    uint16_t modelMa[ENERGY_SUBSYS_COUNT];
+    uint16_t modelTotalMa;
+    int16_t  battMa;                        // -1: slope not trusted yet
+    int8_t   cpuLoad;                       // %, -1: no run time stats
+};
+
+static tSubsysAcc acc[ENERGY_SUBSYS_COUNT];
+static volatile bool active = false;
+static uint32_t startMs = 0;
+static uint32_t stopMs = 0;
+static uint8_t startPct = 0;
+static portMUX_TYPE energyMux = portMUX_INITIALIZER_UNLOCKED;
+
+static tRuntimeSample rtRing[ENERGY_RT_SAMPLES];
+static uint8_t rtHead = 0;              // next to write
+static uint8_t rtCount = 0;
+
+#if (configGENERATE_RUN_TIME_STATS == 1)
+static tTaskBase taskBase[ENERGY_PROF_MAX_TASKS];
+static uint8_t taskBaseCount = 0;
+static uint32_t totalBase = 0;
+#endif
+
+static inline void integrate(tSubsysAcc &a, uint32_t nowMs)
+{
+    a.levelMs += (uint64_t)a.level * (nowMs - a.sinceMs);
+    a.sinceMs = nowMs;
+}
+
+static inline void integrateRt(tSubsysAcc &a, uint32_t nowMs)
+{
+    a.rtLevelMs += (uint64_t)a.level * (nowMs - a.rtSinceMs);
+    a.rtSinceMs = nowMs;
+}
+
+// Model current of one subsystem from its level integral over elapsedMs
+static uint16_t subsysMaOf(int i, uint64_t levelMs, uint32_t events, uint32_t elapsedMs)
+{
+    uint64_t ms = elapsedMs ? elapsedMs : 1;
+    uint16_t ma = (uint16_t)(levelMs * subsysMa[i] / (255 * ms));
+    if (i == esCpu)
+    {
+        ma += ENERGY_MA_CPU_IDLE;
+    }
+    if (i == esRadio)
+    {
+        // TX on top of the receiver, per frame sent
+        uint64_t airUs = (uint64_t)events * ENERGY_TX_AIR_US;
+        ma += (uint16_t)(airUs * (ENERGY_MA_RADIO_TX - ENERGY_MA_RADIO_RX) / (ms * 1000));
+    }
+    return ma;
+}
+
+void energyProfLevel(tEnergySubsys sub, uint8_t level)
+{
+    portENTER_CRITICAL(&energyMux);
+    tSubsysAcc &a = acc[sub];
+    if (level != a.level)
+    {
+        uint32_t now = millis();
+        if (active)
+        {
+            integrate(a, now);
+        }
+        integrateRt(a, now);
+        a.level = level;
+    }
+    portEXIT_CRITICAL(&energyMux);
+}
+
+void energyProfEvent(tEnergySubsys sub)
+{
+    portENTER_CRITICAL(&energyMux);
+    acc[sub].rtEvents++;
+    if (active)
+    {
+        acc[sub].events++;
+    }
+    portEXIT_CRITICAL(&energyMux);
+}
+
+#if (configGENERATE_RUN_TIME_STATS == 1)
+static TaskStatus_t *taskSnapshot(UBaseType_t &count, uint32_t &total)
+{
+    count = uxTaskGetNumberOfTasks() + 2;
+    TaskStatus_t *tasks = (TaskStatus_t *)malloc(count * sizeof(TaskStatus_t));
+    if (tasks != NULL)
+    {
+        count = uxTaskGetSystemState(tasks, count, &total);
+    }
+    return tasks;
+}
+
+static uint32_t taskBaseOf(TaskHandle_t handle)
+{
+    for (uint8_t i = 0; i < taskBaseCount; i++)
+    {
+        if (taskBase[i].handle == handle)
+        {
+            return taskBase[i].runTime;
+        }
+    }
+    return 0;   // started after the profile
+}
+#endif
+
+void energyProfStart(void)
+{
+    uint32_t now = millis();
+    portENTER_CRITICAL(&energyMux);
+    for (int i = 0; i < ENERGY_SUBSYS_COUNT; i++)
+    {
+        acc[i].sinceMs = now;
+        acc[i].levelMs = 0;
+        acc[i].events = 0;
+    }
+    startMs = now;
+    active = true;
+    portEXIT_CRITICAL(&energyMux);
+    pmStatsReset();
+    startPct = boardGetVccPercent();
+
+#if (configGENERATE_RUN_TIME_STATS == 1)
+    UBaseType_t count;
+    TaskStatus_t *tasks = taskSnapshot(count, totalBase);
+    taskBaseCount = 0;
+    for (UBaseType_t i = 0; (tasks != NULL) && (i < count) && (taskBaseCount < ENERGY_PROF_MAX_TASKS); i++)
+    {
+        taskBase[taskBaseCount].handle = tasks[i].xHandle;
+        taskBase[taskBaseCount].runTime = tasks[i].ulRunTimeCounter;
+        taskBaseCount++;
+    }
+    free(tasks);
+#endif
+    Serial.printf(">>> energyProfStart: battery %u%%\r\n", startPct);
+}
+
+void energyProfStop(void)
+{
+    if (!active)
+    {
+        return;
+    }
+    uint32_t now = millis();
+    portENTER_CRITICAL(&energyMux);
+    for (int i = 0; i < ENERGY_SUBSYS_COUNT; i++)
+    {
+        integrate(acc[i], now);
+    }
+    stopMs = now;
+    active = false;
+    portEXIT_CRITICAL(&energyMux);
+    energyProfPrint();
+}
+
+bool energyProfActive(void)
+{
+    return active;
+}
+
+// Busy share of both cores since the start, the busiest tasks printed on request
+static int8_t cpuLoadSinceStart(bool printTasks)
+{
+#if (configGENERATE_RUN_TIME_STATS == 1)
+    UBaseType_t count;
+    uint32_t total;
+    TaskStatus_t *tasks = taskSnapshot(count, total);
+    if (tasks == NULL)
+    {
+        return -1;
+    }
+    uint64_t cpuTime = (uint64_t)(total - totalBase) * portNUM_PROCESSORS;
+    uint64_t idleTime = 0;
+    for (UBaseType_t i = 0; i < count; i++)
+    {
+        tasks[i].ulRunTimeCounter -= taskBaseOf(tasks[i].xHandle);
+        if (!strncmp(tasks[i].pcTaskName, "IDLE", 4))
+        {
+            idleTime += tasks[i].ulRunTimeCounter;
+        }
+    }
+    if (printTasks)
+    {
+        for (uint8_t n = 0; n < ENERGY_PROF_TOP_TASKS; n++)
+        {
+            UBaseType_t top = count;
+            for (UBaseType_t i = 0; i < count; i++)
+            {
+                if ((tasks[i].ulRunTimeCounter > 0) && ((top == count) || (tasks[i].ulRunTimeCounter > tasks[top].ulRunTimeCounter)))
+                {
+                    top = i;
+                }
+            }
+            if (top == count)
+            {
+                break;
+            }
+            Serial.printf("\ttask %-16s %5.1f%%\r\n", tasks[top].pcTaskName,
+                          cpuTime ? 100.0f * tasks[top].ulRunTimeCounter / cpuTime : 0.0f);
+            tasks[top].ulRunTimeCounter = 0;
+        }
+    }
+    free(tasks);
+    if (cpuTime == 0)
+    {
+        return -1;
+    }
+    return (int8_t)constrain(100 - (int)(idleTime * 100 / cpuTime), 0, 100);
+#else
+    return -1;
+#endif
+}
+
+static void buildReport(tEnergyReport &rep, bool printTasks)
+{
+    uint32_t now = active ? millis() : stopMs;
+    tSubsysAcc snap[ENERGY_SUBSYS_COUNT];
+    portENTER_CRITICAL(&energyMux);
+    for (int i = 0; i < ENERGY_SUBSYS_COUNT; i++)
+    {
+        if (active)
+        {
+            integrate(acc[i], now);
+        }
+        snap[i] = acc[i];
+    }
+    portEXIT_CRITICAL(&energyMux);
+
+    rep.elapsedMs = now - startMs;
+    rep.cpuLoad = cpuLoadSinceStart(printTasks);
+    uint8_t cpuLoad = (rep.cpuLoad >= 0) ? rep.cpuLoad : ENERGY_CPU_LOAD_DEF;
+    snap[esCpu].levelMs = (uint64_t)cpuLoad * 255 / 100 * rep.elapsedMs;
+
+    rep.modelTotalMa = 0;
+    for (int i = 0; i < ENERGY_SUBSYS_COUNT; i++)
+    {
+        uint64_t full = (uint64_t)255 * (rep.elapsedMs ? rep.elapsedMs : 1);
+        rep.duty[i] = (uint8_t)(snap[i].levelMs * 100 / full);
+        rep.events[i] = snap[i].events;
+        rep.modelMa[i] = subsysMaOf(i, snap[i].levelMs, snap[i].events, rep.elapsedMs);
+        rep.modelTotalMa += rep.modelMa[i];
+    }
+
+    rep.battMa = -1;
+    int dropPct = (int)startPct - (int)boardGetVccPercent();
+    if ((dropPct >= ENERGY_SLOPE_MIN_PCT) && (rep.elapsedMs >= ENERGY_SLOPE_MIN_MS))
+    {
+        rep.battMa = (int16_t)((uint64_t)dropPct * ENERGY_BATT_MAH * 36000 / rep.elapsedMs);
+    }
+}
+
+// The model split, scaled to the battery slope once that is trusted
+static uint16_t scaledMa(const tEnergyReport &rep, int i)
+{
+    if ((rep.battMa < 0) || (rep.modelTotalMa == 0))
+    {
+        return rep.modelMa[i];
+    }
+    return (uint32_t)rep.modelMa[i] * rep.battMa / rep.modelTotalMa;
+}
+
+static void writeFields(tJsonWriter &json, const tEnergyReport &rep)
+{
+    json.field("active", active);
+    json.field("elapsed_s", rep.elapsedMs / 1000);
+    json.field("cpu_load", rep.cpuLoad);
+    json.field("model_ma", rep.modelTotalMa);
+    json.field("batt_ma", rep.battMa);
+    json.field("tx_frames", rep.events[esRadio]);
+    json.field("display_pushes", rep.events[esDisplay]);
+    for (int i = 0; i < ENERGY_SUBSYS_COUNT; i++)
+    {
+        json.beginObject(subsysNames[i]);
+        json.field("duty", rep.duty[i]);
+        json.field("ma", scaledMa(rep, i));
+        json.endObject();
+    }
+}
+
+void energyProfPrint(void)
+{
+    if (startMs == 0)
+    {
+        Serial.println("*** energyProfPrint WARNING! no profile yet, use energy start");
+        return;
+    }
+    tEnergyReport rep;
+    buildReport(rep, true);
+    char battText[24] = "n/a (too short)";
+    if (rep.battMa >= 0)
+    {
+        snprintf(battText, sizeof(battText), "%d mA", rep.battMa);
+    }
+    Serial.printf(">>> energyProfPrint: %lu s, model %u mA, battery %s\r\n", rep.elapsedMs / 1000, rep.modelTotalMa, battText);
+    for (int i = 0; i < ENERGY_SUBSYS_COUNT; i++)
+    {
+        Serial.printf("\t%-8s duty %3u%%, %6lu events, %4u mA\r\n", subsysNames[i], rep.duty[i], rep.events[i], scaledMa(rep, i));
+    }
+    pmPrint();
+
+    static char buf[ENERGY_PROF_JSON_BUF];
+    tJsonWriter json(buf, sizeof(buf));
+    json.beginObject();
+    writeFields(json, rep);
+    json.endObject();
+    if (json.ok())
+    {
+        Serial.printf("ENERGY_REPORT %s\r\n", json.c_str());
+    }
+    else
+    {
+        Serial.println("!!! energyProfPrint ERROR: report does not fit the JSON buffer");
+    }
+}
+
+void energyProfWriteJson(tJsonWriter &json)
+{
+    tEnergyReport rep;
+    buildReport(rep, false);
+    json.beginObject("energy");
+    writeFields(json, rep);
+    pmWriteJson(json);
+    json.endObject();
+}
+
+// Closes the current interval: its mean model current and the battery level
+static void runtimeSample(uint32_t now)
+{
+    uint64_t levelMs[ENERGY_SUBSYS_COUNT];
+    uint32_t events[ENERGY_SUBSYS_COUNT];
+    uint32_t elapsedMs = 0;
+    portENTER_CRITICAL(&energyMux);
+    for (int i = 0; i < ENERGY_SUBSYS_COUNT; i++)
+    {
+        tSubsysAcc &a = acc[i];
+        elapsedMs = now - a.rtSinceMs;      // the same for all, they are reset together
+        integrateRt(a, now);
+        levelMs[i] = a.rtLevelMs;
+        events[i] = a.rtEvents;
+        a.rtLevelMs = 0;
+        a.rtEvents = 0;
+    }
+    portEXIT_CRITICAL(&energyMux);
+
+    // no run time stats here, the CPU counts at the default load
+    levelMs[esCpu] = (uint64_t)ENERGY_CPU_LOAD_DEF * 255 / 100 * elapsedMs;
+    uint32_t modelMa = 0;
+    for (int i = 0; i < ENERGY_SUBSYS_COUNT; i++)
+    {
+        modelMa += subsysMaOf(i, levelMs[i], events[i], elapsedMs);
+    }
+
+    uint8_t pct = boardGetVccPercent();
+    if ((rtCount > 0) && (pct > rtRing[(rtHead + ENERGY_RT_SAMPLES - 1) % ENERGY_RT_SAMPLES].pct + 1))
+    {
+        rtCount = 0;    // on a charger, the old slope says nothing any more
+    }
+    tRuntimeSample &s = rtRing[rtHead];
+    s.ms = now;
+    s.pct = pct;
+    s.modelMa = (uint16_t)min(modelMa, (uint32_t)0xFFFF);
+    rtHead = (rtHead + 1) % ENERGY_RT_SAMPLES;
+    if (rtCount < ENERGY_RT_SAMPLES)
+    {
+        rtCount++;
+    }
+}
+
+int16_t energyRuntimeMinutes(void)
+{
+    uint32_t now = millis();
+    const tRuntimeSample *last = &rtRing[(rtHead + ENERGY_RT_SAMPLES - 1) % ENERGY_RT_SAMPLES];
+    if ((rtCount == 0) || (now - last->ms >= ENERGY_RT_SAMPLE_MS))
+    {
+        runtimeSample(now);
+        last = &rtRing[(rtHead + ENERGY_RT_SAMPLES - 1) % ENERGY_RT_SAMPLES];
+    }
+    const tRuntimeSample &first = rtRing[(rtHead + ENERGY_RT_SAMPLES - rtCount) % ENERGY_RT_SAMPLES];
+    if ((rtCount > 1) && (last->pct > first.pct))
+    {
+        return -1;
+    }
+
+    uint32_t ma = last->modelMa;
+    int dropPct = (int)first.pct - (int)last->pct;
+    uint32_t spanMs = last->ms - first.ms;
+    if ((dropPct >= ENERGY_SLOPE_MIN_PCT) && (spanMs >= ENERGY_SLOPE_MIN_MS))
+    {
+        // what the battery really gave over the window, at the load of the last interval
+        uint32_t slopeMa = (uint64_t)dropPct * ENERGY_BATT_MAH * 36000 / spanMs;
+        uint32_t meanMa = 0;
+        for (uint8_t i = 1; i < rtCount; i++)
+        {
+            meanMa += rtRing[(rtHead + ENERGY_RT_SAMPLES - rtCount + i) % ENERGY_RT_SAMPLES].modelMa;
+        }
+        meanMa /= rtCount - 1;
+        if (meanMa > 0)
+        {
+            ma = (uint64_t)slopeMa * last->modelMa / meanMa;
+        }
+    }
+    if (ma == 0)
+    {
+        return ENERGY_RT_MAX_MIN;
+    }
+    uint32_t minutes = (uint32_t)last->pct * ENERGY_BATT_MAH * 60 / 100 / ma;
+    return (int16_t)min(minutes, (uint32_t)ENERGY_RT_MAX_MIN);
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "jsonWriter.h"
+
+// Energy profiler: the subsystems report their level (0-255: radio awake,
+// display brightness, mean LED channel value, vibro PWM, audio playing) when it
+// changes and count their events (frames sent, display pushes). While a
+// profile runs the levels are integrated over time and, with FreeRTOS run time
+// stats, the CPU time of each task. The report turns the duty cycles into mA
+// with the rough per-subsystem currents below and, once the battery has
+// dropped enough, scales them to the current the battery slope shows.
+
+#define ENERGY_PROF_JSON_BUF    384
+#define ENERGY_PROF_MAX_TASKS   32      // the 32 bit run time counters wrap after ~71 min
+#define ENERGY_PROF_TOP_TASKS   6
+
+// Model currents (mA at level 255), rough datasheet figures for the T-Display-S3 AMOLED
+#define ENERGY_MA_CPU_IDLE      22      // both cores in the idle task, WiFi on
+#define ENERGY_MA_CPU_BUSY      48      // both cores busy at 240 MHz
+#define ENERGY_MA_RADIO_RX      95      // receiver on, the extra over the CPU
+#define ENERGY_MA_RADIO_TX      190
+#define ENERGY_TX_AIR_US        1800    // one beacon at 1 Mbps, preamble included
+#define ENERGY_MA_DISPLAY       95      // AMOLED at full brightness, mid-grey content
+#define ENERGY_MA_LEDS          480     // 8 pixels, all channels full on
+#define ENERGY_MA_VIBRO         85
+#define ENERGY_MA_AUDIO         60      // amplifier at the game volumes
+#define ENERGY_CPU_LOAD_DEF     50      // % when run time stats are not built in
+#define ENERGY_RADIO_PS_LEVEL   64      // radio level in modem sleep, awake about a quarter of the time
+
+#define ENERGY_BATT_MAH         1000
+#define ENERGY_SLOPE_MIN_PCT    2       // battery drop before the slope is trusted
+#define ENERGY_SLOPE_MIN_MS     600000
+
+// Runtime estimate, always on: the battery slope over a rolling window, scaled
+// by the model current of the last interval against its mean over the window,
+// so a device that just turned base, went to rest or dimmed its display is
+// predicted at its new load. Until the slope is trusted the model alone counts.
+#define ENERGY_RT_SAMPLE_MS     60000
+#define ENERGY_RT_SAMPLES       32      // window of about half an hour
+#define ENERGY_RT_MAX_MIN       6000
+
+enum tEnergySubsys
+{
+    esCpu,
+    esRadio,
+    esDisplay,
+    esLeds,
+    esVibro,
+    esAudio,
+    ENERGY_SUBSYS_COUNT
+};
+
+// Cheap, from any task, also while no profile runs
+void energyProfLevel(tEnergySubsys sub, uint8_t level);
+void energyProfEvent(tEnergySubsys sub);
+
+void energyProfStart(void);
+void energyProfStop(void);
+bool energyProfActive(void);
+void energyProfPrint(void);                     // table plus an ENERGY_REPORT JSON line
+void energyProfWriteJson(tJsonWriter &json);    // "energy":{...} member of an open object
+
+// Minutes to an empty battery, -1 while charging; from one task, it samples
+// the window on the way, at least once per ENERGY_RT_SAMPLE_MS to stay accurate
+int16_t energyRuntimeMinutes(void);
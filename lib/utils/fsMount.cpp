@@ -0,0 +1,80 @@
+#include "fsMount.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+// created by the first acquire, which the boot makes before any task runs
+static SemaphoreHandle_t fsMutex = NULL;
+static int fsUsers = 0;
+static bool mounted = false;
+static uint32_t mountCount = 0;
+
+static void lockFs(void)
+{
+    if (fsMutex == NULL)
+    {
+        fsMutex = xSemaphoreCreateMutex();
+    }
+    xSemaphoreTake(fsMutex, portMAX_DELAY);
+}
+
+static void unlockFs(void)
+{
+    xSemaphoreGive(fsMutex);
+}
+
+bool fsAcquire(bool formatOnFail)
+{
+    lockFs();
+    if (!mounted)
+    {
+        uint32_t startMs = millis();
+        // nconf.json lives here, a format only when the caller rebuilds the contents anyway
+        mounted = LittleFS.begin(false, "/littlefs", FS_MOUNT_MAX_OPEN) ||
+                  (formatOnFail && LittleFS.begin(true, "/littlefs", FS_MOUNT_MAX_OPEN));
+        if (!mounted)
+        {
+            unlockFs();
+            Serial.println("!!! fsAcquire ERROR: LittleFS mount failed");
+            return false;
+        }
+        mountCount++;
+        Serial.printf(">>> fsAcquire: LittleFS mounted in %lu ms (#%lu), %u of %u bytes used\r\n",
+                      millis() - startMs, mountCount, LittleFS.usedBytes(), LittleFS.totalBytes());
+    }
+    fsUsers++;
+    unlockFs();
+    return true;
+}
+
+void fsRelease(void)
+{
+    lockFs();
+    if (fsUsers > 0)
+    {
+        fsUsers--;
+    }
+    unlockFs();
+}
+
+void fsUnmount(void)
+{
+    lockFs();
+    if (mounted)
+    {
+        if (fsUsers > 0)
+        {
+            Serial.printf("*** fsUnmount WARNING! %d users still hold LittleFS\r\n", fsUsers);
+        }
+        LittleFS.end();
+        mounted = false;
+        fsUsers = 0;
+        Serial.println(">>> fsUnmount: LittleFS unmounted");
+    }
+    unlockFs();
+}
+
+bool fsMounted(void)
+{
+    return mounted;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <Arduino.h>
+#include <LittleFS.h>
+
+// One LittleFS mount for the whole run. The first user mounts it, users only
+// count themselves in and out and the mount stays when the last one leaves;
+// it is taken down explicitly before deep sleep or the OTA reboot, so boot
+// stages and lazy PSRAM copies do not rescan the metadata each time.
+
+#define FS_MOUNT_MAX_OPEN       10
+
+bool fsAcquire(bool formatOnFail = false);      // false when LittleFS can not be mounted
+void fsRelease(void);
+void fsUnmount(void);                           // before deep sleep / OTA reboot, whoever still holds it
+bool fsMounted(void);
+
+// Scoped user, for the callers that only need LittleFS for one function
+class tFsHandle
+{
+public:
+    explicit tFsHandle(bool formatOnFail = false) : held(fsAcquire(formatOnFail)) {}
+    ~tFsHandle() { if (held) fsRelease(); }
+    tFsHandle(const tFsHandle &) = delete;
+    tFsHandle &operator=(const tFsHandle &) = delete;
+    bool ok(void) const { return held; }
+
+private:
+    bool held;
+};
@@ -0,0 +1,176 @@
+#include "jsonAlloc.h"
+#include "memMonitor.h"
+
+// Every tJsonPsramAllocator block starts with its size, the bytes held are
+// counted per kind without asking the heap
+#define JSON_ALLOC_HDR          JSON_ALLOC_ALIGN
+
+static const char *kindNames[JSON_DOC_KIND_COUNT] = {"val", "file_list", "manifest", "config", "role", "game_api", "other"};
+
+static size_t heldBytes[JSON_DOC_KIND_COUNT] = {0};
+static size_t peakBytes[JSON_DOC_KIND_COUNT] = {0};
+static portMUX_TYPE statMux = portMUX_INITIALIZER_UNLOCKED;
+
+static tJsonPsramAllocator psramAllocators[JSON_DOC_KIND_COUNT] = {
+    tJsonPsramAllocator(jdkVal), tJsonPsramAllocator(jdkFileList), tJsonPsramAllocator(jdkManifest),
+    tJsonPsramAllocator(jdkConfig), tJsonPsramAllocator(jdkRole), tJsonPsramAllocator(jdkGameApi),
+    tJsonPsramAllocator(jdkOther)};
+
+static inline size_t alignUp(size_t size)
+{
+    return (size + JSON_ALLOC_ALIGN - 1) & ~(size_t)(JSON_ALLOC_ALIGN - 1);
+}
+
+static void account(tJsonDocKind kind, size_t add, size_t sub)
+{
+    portENTER_CRITICAL(&statMux);
+    heldBytes[kind] = heldBytes[kind] + add - sub;
+    if (heldBytes[kind] > peakBytes[kind])
+    {
+        peakBytes[kind] = heldBytes[kind];
+    }
+    portEXIT_CRITICAL(&statMux);
+    memTagAccount(mtJson, true, add, sub);
+}
+
+// PSRAM first, the internal heap when the board has none or it is full
+static void *psramAlloc(size_t size)
+{
+    void *ptr = ps_malloc(size);
+    return ptr ? ptr : malloc(size);
+}
+
+void *tJsonPsramAllocator::allocate(size_t size)
+{
+    uint8_t *block = (uint8_t *)psramAlloc(JSON_ALLOC_HDR + size);
+    if (block == NULL)
+    {
+        return NULL;
+    }
+    *(size_t *)block = size;
+    account(kind, size, 0);
+    return block + JSON_ALLOC_HDR;
+}
+
+void tJsonPsramAllocator::deallocate(void *ptr)
+{
+    if (ptr == NULL)
+    {
+        return;
+    }
+    uint8_t *block = (uint8_t *)ptr - JSON_ALLOC_HDR;
+    account(kind, 0, *(size_t *)block);
+    free(block);
+}
+
+void *tJsonPsramAllocator::reallocate(void *ptr, size_t newSize)
+{
+    if (ptr == NULL)
+    {
+        return allocate(newSize);
+    }
+    uint8_t *block = (uint8_t *)ptr - JSON_ALLOC_HDR;
+    size_t oldSize = *(size_t *)block;
+    // plain realloc() may move a PSRAM block into the internal heap
+    uint8_t *res = (uint8_t *)ps_realloc(block, JSON_ALLOC_HDR + newSize);
+    if (res == NULL)
+    {
+        res = (uint8_t *)realloc(block, JSON_ALLOC_HDR + newSize);
+    }
+    if (res == NULL)
+    {
+        return NULL;
+    }
+    *(size_t *)res = newSize;
+    account(kind, newSize, oldSize);
+    return res + JSON_ALLOC_HDR;
+}
+
+tJsonArenaAllocator::~tJsonArenaAllocator()
+{
+    reset();
+    free(arena);
+}
+
+void tJsonArenaAllocator::reset(void)
+{
+    account(kind, 0, used);
+    used = 0;
+    lastPtr = NULL;
+    lastSize = 0;
+}
+
+void *tJsonArenaAllocator::allocate(size_t size_)
+{
+    size_ = alignUp(size_);
+    if (arena == NULL)
+    {
+        arena = (uint8_t *)psramAlloc(size);
+    }
+    if ((arena == NULL) || (used + size_ > size))
+    {
+        return spill.allocate(size_);
+    }
+    lastPtr = arena + used;
+    lastSize = size_;
+    used += size_;
+    account(kind, size_, 0);
+    return lastPtr;
+}
+
+// Arena blocks go with the next reset()
+void tJsonArenaAllocator::deallocate(void *ptr)
+{
+    if (!inArena(ptr))
+    {
+        spill.deallocate(ptr);
+    }
+}
+
+void *tJsonArenaAllocator::reallocate(void *ptr, size_t newSize)
+{
+    if (!inArena(ptr))
+    {
+        return spill.reallocate(ptr, newSize);
+    }
+    newSize = alignUp(newSize);
+    if ((ptr == lastPtr) && (used - lastSize + newSize <= size))
+    {
+        // the last block grows or shrinks in place, shrinkToFit() after a parse
+        account(kind, newSize, lastSize);
+        used = used - lastSize + newSize;
+        lastSize = newSize;
+        return ptr;
+    }
+    size_t oldSize = (ptr == lastPtr) ? lastSize : min(newSize, (size_t)(arena + used - (uint8_t *)ptr));
+    void *res = allocate(newSize);
+    if (res)
+    {
+        memcpy(res, ptr, min(oldSize, newSize));
+    }
+    return res;
+}
+
+tJsonPsramAllocator *jsonPsram(tJsonDocKind kind)
+{
+    return &psramAllocators[(kind < JSON_DOC_KIND_COUNT) ? kind : jdkOther];
+}
+
+size_t jsonAllocPeak(tJsonDocKind kind)
+{
+    return (kind < JSON_DOC_KIND_COUNT) ? peakBytes[kind] : 0;
+}
+
+void jsonAllocPrint(void)
+{
+    Serial.println(">>> jsonAllocPrint: JSON document bytes per kind");
+    Serial.printf("%-12s %10s %10s\r\n", "kind", "held", "peak");
+    for (int i = 0; i < JSON_DOC_KIND_COUNT; i++)
+    {
+        Serial.printf("%-12s %10u %10u\r\n", kindNames[i], (unsigned)heldBytes[i], (unsigned)peakBytes[i]);
+    }
+    Serial.printf("internal heap free %u, largest block %u, PSRAM free %u\r\n",
+                  (unsigned)heap_caps_get_free_size(MALLOC_CAP_INTERNAL),
+                  (unsigned)heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL),
+                  (unsigned)ESP.getFreePsram());
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// ArduinoJson allocators that keep the documents out of the internal SRAM the
+// WiFi and ESP-NOW buffers come from. tJsonPsramAllocator puts every pool
+// and string buffer in PSRAM (internal heap only when the board has none).
+// tJsonArenaAllocator is for parse-and-discard documents: a bump arena in
+// PSRAM that reset() empties in O(1) before the next parse, full arenas
+// spill to PSRAM. Both count the bytes held per document kind and keep the
+// peak, jsonAllocPrint() lists them.
+//
+// One allocator per document that can be alive at the same time: the arena
+// has no lock, reset() is only safe once its document was cleared or is
+// about to be deserialized into again.
+
+#define JSON_ALLOC_ALIGN        8
+#define JSON_ARENA_GAME_API     2048    // /api/device response
+#define JSON_ARENA_GAME_PUSH    2048    // pushed game state, same fields
+#define JSON_ARENA_ROLE         4096    // role profile JSON
+
+enum tJsonDocKind
+{
+    jdkVal,             // val.json
+    jdkFileList,        // server and local file lists of the sync
+    jdkManifest,        // sync manifest
+    jdkConfig,          // nconf.json
+    jdkRole,            // role profile JSONs
+    jdkGameApi,         // game API responses and pushed states
+    jdkOther,
+    JSON_DOC_KIND_COUNT
+};
+
+class tJsonPsramAllocator : public ArduinoJson::Allocator
+{
+public:
+    explicit tJsonPsramAllocator(tJsonDocKind kind_) : kind(kind_) {}
+
+    void *allocate(size_t size) override;
+    void deallocate(void *ptr) override;
+    void *reallocate(void *ptr, size_t newSize) override;
+
+private:
+    tJsonDocKind kind;
+};
+
+class tJsonArenaAllocator : public ArduinoJson::Allocator
+{
+public:
+    tJsonArenaAllocator(tJsonDocKind kind_, size_t size_) : kind(kind_), size(size_), spill(kind_) {}
+    ~tJsonArenaAllocator();     // declare it before the document it serves
+
+    void reset(void);
+
+    void *allocate(size_t size) override;
+    void deallocate(void *ptr) override;
+    void *reallocate(void *ptr, size_t newSize) override;
+
+private:
+    inline bool inArena(void *ptr)
+    {
+        return (arena != NULL) && (ptr >= (void *)arena) && (ptr < (void *)(arena + size));
+    }
+
+    tJsonDocKind kind;
+    size_t size;
+    uint8_t *arena = NULL;     // taken from PSRAM on the first allocation
+    size_t used = 0;
+    uint8_t *lastPtr = NULL;
+    size_t lastSize = 0;
+    tJsonPsramAllocator spill;
+};
+
+// One tJsonPsramAllocator per kind, for documents that live in a function scope
+tJsonPsramAllocator *jsonPsram(tJsonDocKind kind);
+
+size_t jsonAllocPeak(tJsonDocKind kind);
+void jsonAllocPrint(void);
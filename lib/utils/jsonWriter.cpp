@@ -0,0 +1,224 @@
+#include "jsonWriter.h"
+
+tJsonWriter::tJsonWriter(char *buf_, size_t size_) : buf(buf_), size(size_)
+{
+    if (size)
+    {
+        buf[0] = 0;
+    }
+    else
+    {
+        overflow = true;
+    }
+}
+
+void tJsonWriter::put(char c)
+{
+    if (len + 1 >= size)
+    {
+        overflow = true;
+        return;
+    }
+    buf[len++] = c;
+    buf[len] = 0;
+}
+
+void tJsonWriter::puts(const char *s)
+{
+    while (*s)
+    {
+        put(*s++);
+    }
+}
+
+void tJsonWriter::putString(const char *s)
+{
+    static const char hex[] = "0123456789abcdef";
+    put('"');
+    for (; s && *s; s++)
+    {
+        uint8_t c = (uint8_t)*s;
+        switch (c)
+        {
+        case '"':
+            puts("\\\"");
+            break;
+        case '\\':
+            puts("\\\\");
+            break;
+        case '\n':
+            puts("\\n");
+            break;
+        case '\r':
+            puts("\\r");
+            break;
+        case '\t':
+            puts("\\t");
+            break;
+        default:
+            if (c < 0x20)
+            {
+                puts("\\u00");
+                put(hex[c >> 4]);
+                put(hex[c & 0x0F]);
+            }
+            else
+            {
+                put(c);
+            }
+            break;
+        }
+    }
+    put('"');
+}
+
+void tJsonWriter::putUnsigned(unsigned long long v)
+{
+    char tmp[21];
+    int n = 0;
+    do
+    {
+        tmp[n++] = '0' + (v % 10);
+        v /= 10;
+    } while (v);
+    while (n)
+    {
+        put(tmp[--n]);
+    }
+}
+
+void tJsonWriter::putSigned(long long v)
+{
+    if (v < 0)
+    {
+        put('-');
+        putUnsigned((unsigned long long)(-(v + 1)) + 1);
+    }
+    else
+    {
+        putUnsigned((unsigned long long)v);
+    }
+}
+
+void tJsonWriter::separator(void)
+{
+    if (depth == 0)
+    {
+        return;
+    }
+    if (!first[depth - 1])
+    {
+        put(',');
+    }
+    first[depth - 1] = false;
+}
+
+void tJsonWriter::key(const char *k)
+{
+    separator();
+    if (k)
+    {
+        putString(k);
+        put(':');
+    }
+}
+
+void tJsonWriter::beginObject(const char *k)
+{
+    key(k);
+    put('{');
+    if (depth >= JSON_WRITER_DEPTH)
+    {
+        overflow = true;
+        return;
+    }
+    first[depth++] = true;
+}
+
+void tJsonWriter::endObject(void)
+{
+    put('}');
+    if (depth)
+    {
+        depth--;
+    }
+}
+
+void tJsonWriter::beginArray(const char *k)
+{
+    key(k);
+    put('[');
+    if (depth >= JSON_WRITER_DEPTH)
+    {
+        overflow = true;
+        return;
+    }
+    first[depth++] = true;
+}
+
+void tJsonWriter::endArray(void)
+{
+    put(']');
+    if (depth)
+    {
+        depth--;
+    }
+}
+
+void tJsonWriter::field(const char *k, const char *v)
+{
+    key(k);
+    putString(v);
+}
+
+void tJsonWriter::field(const char *k, bool v)
+{
+    key(k);
+    puts(v ? "true" : "false");
+}
+
+void tJsonWriter::field(const char *k, long long v)
+{
+    key(k);
+    putSigned(v);
+}
+
+void tJsonWriter::field(const char *k, unsigned long long v)
+{
+    key(k);
+    putUnsigned(v);
+}
+
+// IPAddress as a uint32_t keeps the first octet in the low byte
+void tJsonWriter::fieldIp(const char *k, uint32_t ip)
+{
+    key(k);
+    put('"');
+    for (int i = 0; i < 4; i++)
+    {
+        if (i)
+        {
+            put('.');
+        }
+        putUnsigned((ip >> (8 * i)) & 0xFF);
+    }
+    put('"');
+}
+
+void tJsonWriter::value(const char *v)
+{
+    key(NULL);
+    putString(v);
+}
+
+void tJsonWriter::value(long long v)
+{
+    key(NULL);
+    putSigned(v);
+}
+
+void tJsonWriter::value(unsigned long long v)
+{
+    key(NULL);
+    putUnsigned(v);
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Streaming JSON writer for outbound payloads: writes straight into a caller
+// buffer, never allocates, and turns an overflow into ok() == false instead of
+// a truncated document. Commas and nesting are tracked up to JSON_WRITER_DEPTH.
+
+#define JSON_WRITER_DEPTH   8
+
+class tJsonWriter
+{
+public:
+    tJsonWriter(char *buf, size_t size);
+
+    void beginObject(const char *key = NULL);
+    void endObject(void);
+    void beginArray(const char *key = NULL);
+    void endArray(void);
+
+    // object members
+    void field(const char *key, const char *v);
+    void field(const char *key, bool v);
+    void field(const char *key, long long v);
+    void field(const char *key, unsigned long long v);
+    inline void field(const char *key, int v) { field(key, (long long)v); }
+    inline void field(const char *key, unsigned int v) { field(key, (unsigned long long)v); }
+    inline void field(const char *key, long v) { field(key, (long long)v); }
+    inline void field(const char *key, unsigned long v) { field(key, (unsigned long long)v); }
+    inline void field(const char *key, const String &v) { field(key, v.c_str()); }
+    void fieldIp(const char *key, uint32_t ip);
+
+    // array elements
+    void value(const char *v);
+    void value(long long v);
+    void value(unsigned long long v);
+    inline void value(int v) { value((long long)v); }
+    inline void value(unsigned int v) { value((unsigned long long)v); }
+    inline void value(long v) { value((long long)v); }
+    inline void value(unsigned long v) { value((unsigned long long)v); }
+
+    inline bool ok(void) const { return !overflow && (depth == 0); }
+    inline size_t length(void) const { return len; }
+    inline const char *c_str(void) const { return buf; }
+
+private:
+    void separator(void);
+    void key(const char *k);
+    void put(char c);
+    void puts(const char *s);
+    void putString(const char *s);
+    void putSigned(long long v);
+    void putUnsigned(unsigned long long v);
+
+    char   *buf;
+    size_t  size;
+    size_t  len = 0;
+    bool    overflow = false;
+    uint8_t depth = 0;
+    bool    first[JSON_WRITER_DEPTH];
+};
+
+// Writer with its own buffer; N is the compile-time bound of the payload
+template <size_t N>
+class tJsonBuffer : public tJsonWriter
+{
+public:
+    tJsonBuffer() : tJsonWriter(storage, N) {}
+
+private:
+    char storage[N];
+};
@@ -0,0 +1,307 @@
+#include "logRing.h"
+
+#include <esp_ota_ops.h>
+#include <esp_system.h>
+#include <soc/soc.h>
+
+#include "taskRegistry.h"
+
+struct tLogEntry
+{
+    uint32_t    ms;
+    const char *fmt;
+    uint8_t     module;
+    uint8_t     level;
+    uint8_t     nargs;
+    uint32_t    args[LOG_RING_ARGS];
+};
+
+struct tLogRingRtc
+{
+    uint32_t  magic;
+    uint8_t   appSha[8];        // the format pointers are only good for the firmware that wrote them
+    uint32_t  head;             // entries ever written, wraps
+    tLogEntry ring[LOG_RING_SIZE];
+};
+
+static const char *moduleNames[LOG_MODULE_COUNT] = {"game", "records", "radio", "net", "sync", "board"};
+static const char *levelNames[] = {"error", "warn", "info", "debug"};
+
+RTC_NOINIT_ATTR static tLogRingRtc logRtc;
+static uint32_t     logTail = 0;            // next entry the drainer prints
+static uint32_t     logDropped = 0;
+static uint8_t      logLevels[LOG_MODULE_COUNT];
+static bool         logReady = false;
+static portMUX_TYPE logMux = portMUX_INITIALIZER_UNLOCKED;
+
+static char        *crashBuf = NULL;        // NUL separated lines
+static uint16_t     crashLines = 0;
+static uint8_t      crashReason = 0;        // esp_reset_reason_t
+static volatile bool crashPending = false;
+
+// String literals live in the flash data segment; after a crash nothing else
+// a pointer in the ring points to is still there
+static inline bool inRodata(const void *p)
+{
+    return ((uint32_t)p >= SOC_DROM_LOW) && ((uint32_t)p < SOC_DROM_HIGH);
+}
+
+// printf for the argument types LOGR takes, one conversion at a time
+static size_t formatEntry(const tLogEntry &e, char *buf, size_t size, bool crashed = false)
+{
+    size_t len = 0;
+    uint8_t argPos = 0;
+    const char *p = e.fmt;
+    while (*p && (len + 1 < size))
+    {
+        if (*p != '%')
+        {
+            buf[len++] = *p++;
+            continue;
+        }
+        if (p[1] == '%')
+        {
+            buf[len++] = '%';
+            p += 2;
+            continue;
+        }
+        char spec[16];
+        uint8_t specLen = 0;
+        spec[specLen++] = *p++;
+        while (*p && !strchr("diouxXcspfeEgG", *p) && (specLen < sizeof(spec) - 2))
+        {
+            spec[specLen++] = *p++;
+        }
+        if (!*p)
+        {
+            break;
+        }
+        char conv = *p++;
+        spec[specLen++] = conv;
+        spec[specLen] = 0;
+        if (argPos >= e.nargs)
+        {
+            break;
+        }
+        uint32_t arg = e.args[argPos++];
+        int n;
+        if (strchr("feEgG", conv))
+        {
+            float f;
+            memcpy(&f, &arg, sizeof(f));
+            n = snprintf(&buf[len], size - len, spec, (double)f);
+        }
+        else if (conv == 's')
+        {
+            const char *s = (const char *)arg;
+            if (s == NULL)
+            {
+                s = "(null)";
+            }
+            else if (crashed && !inRodata(s))
+            {
+                s = "(?)";
+            }
+            n = snprintf(&buf[len], size - len, spec, s);
+        }
+        else
+        {
+            n = snprintf(&buf[len], size - len, spec, arg);
+        }
+        if (n > 0)
+        {
+            len = min(len + n, size - 1);
+        }
+    }
+    buf[len] = 0;
+    return len;
+}
+
+static bool resetIsCrash(esp_reset_reason_t reason)
+{
+    return (reason == ESP_RST_PANIC) || (reason == ESP_RST_INT_WDT) || (reason == ESP_RST_TASK_WDT) ||
+           (reason == ESP_RST_WDT) || (reason == ESP_RST_BROWNOUT);
+}
+
+// The last lines of the crashed boot as text, the ring is reused right away
+static void keepCrashLines(esp_reset_reason_t reason)
+{
+    uint32_t count = min(logRtc.head, (uint32_t)LOG_CRASH_LINES);
+    if (count == 0)
+    {
+        return;
+    }
+    crashBuf = (char *)ps_malloc(LOG_CRASH_BUF);
+    if (crashBuf == NULL)
+    {
+        Serial.println("!!! logRingInit ERROR: no PSRAM for the crash log");
+        return;
+    }
+    size_t used = 0;
+    char line[LOG_RING_LINE_MAX];
+    for (uint32_t i = logRtc.head - count; i != logRtc.head; i++)
+    {
+        const tLogEntry &e = logRtc.ring[i & (LOG_RING_SIZE - 1)];
+        if (!inRodata(e.fmt) || (e.nargs > LOG_RING_ARGS))
+        {
+            continue;
+        }
+        int n = snprintf(line, sizeof(line), "%lu ", e.ms);
+        size_t len = n + formatEntry(e, &line[n], sizeof(line) - n, true);
+        while (len && ((line[len - 1] == '\r') || (line[len - 1] == '\n')))
+        {
+            line[--len] = 0;
+        }
+        if (used + len + 1 > LOG_CRASH_BUF)
+        {
+            break;
+        }
+        memcpy(&crashBuf[used], line, len + 1);
+        used += len + 1;
+        crashLines++;
+    }
+    crashReason = (uint8_t)reason;
+    crashPending = (crashLines > 0);
+    Serial.printf("*** logRingInit WARNING! Reset reason %u, %u log lines of the last boot kept\r\n", reason, crashLines);
+}
+
+static void logDrainTask(void *)
+{
+    char line[LOG_RING_LINE_MAX];
+    while (true)
+    {
+        while (true)
+        {
+            tLogEntry e;
+            uint32_t lost = 0;
+            portENTER_CRITICAL(&logMux);
+            if (logTail == logRtc.head)
+            {
+                portEXIT_CRITICAL(&logMux);
+                break;
+            }
+            if (logRtc.head - logTail > LOG_RING_SIZE)
+            {
+                lost = logRtc.head - logTail - LOG_RING_SIZE;
+                logTail = logRtc.head - LOG_RING_SIZE;
+            }
+            e = logRtc.ring[logTail & (LOG_RING_SIZE - 1)];
+            logTail++;
+            portEXIT_CRITICAL(&logMux);
+
+            if (lost)
+            {
+                logDropped += lost;
+                Serial.printf("*** logRing WARNING! %lu lines lost\r\n", lost);
+            }
+            size_t len = formatEntry(e, line, sizeof(line));
+            Serial.write((const uint8_t *)line, len);
+        }
+        vTaskDelay(pdMS_TO_TICKS(LOG_RING_DRAIN_MS));
+    }
+}
+
+void logRingInit(void)
+{
+    if (logReady)
+    {
+        return;
+    }
+    const uint8_t *sha = esp_ota_get_app_description()->app_elf_sha256;
+    esp_reset_reason_t reason = esp_reset_reason();
+    bool valid = (logRtc.magic == LOG_RING_MAGIC) && !memcmp(logRtc.appSha, sha, sizeof(logRtc.appSha));
+    if (valid && resetIsCrash(reason))
+    {
+        keepCrashLines(reason);
+    }
+    memset(&logRtc, 0, sizeof(logRtc));
+    logRtc.magic = LOG_RING_MAGIC;
+    memcpy(logRtc.appSha, sha, sizeof(logRtc.appSha));
+    logTail = 0;
+    for (int i = 0; i < LOG_MODULE_COUNT; i++)
+    {
+        logLevels[i] = llInfo;
+    }
+    logReady = true;
+    taskStart(tkLogDrain, logDrainTask);
+}
+
+bool logRingEnabled(tLogModule module, tLogLevel level)
+{
+    return logReady && (level <= logLevels[module]);
+}
+
+void logRingWrite(tLogModule module, tLogLevel level, const char *fmt, const uint32_t *args, uint8_t nargs)
+{
+    uint32_t ms = millis();
+    portENTER_CRITICAL_SAFE(&logMux);
+    tLogEntry &e = logRtc.ring[logRtc.head & (LOG_RING_SIZE - 1)];
+    e.ms = ms;
+    e.fmt = fmt;
+    e.module = module;
+    e.level = level;
+    e.nargs = nargs;
+    memcpy(e.args, args, nargs * sizeof(uint32_t));
+    logRtc.head++;
+    portEXIT_CRITICAL_SAFE(&logMux);
+}
+
+void logRingSetLevel(tLogModule module, tLogLevel level)
+{
+    logLevels[module] = level;
+}
+
+bool logRingSetLevel(const String &module, const String &level)
+{
+    for (int m = 0; m < LOG_MODULE_COUNT; m++)
+    {
+        if (module != moduleNames[m])
+        {
+            continue;
+        }
+        for (int l = llError; l <= llDebug; l++)
+        {
+            if (level == levelNames[l])
+            {
+                logRingSetLevel((tLogModule)m, (tLogLevel)l);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void logRingPrintLevels(void)
+{
+    Serial.println(">>>>>>>>>>> LOG LEVELS <<<<<<<<<<<");
+    for (int m = 0; m < LOG_MODULE_COUNT; m++)
+    {
+        Serial.printf("%-10s %s\r\n", moduleNames[m], levelNames[logLevels[m]]);
+    }
+    Serial.printf("%lu lines written, %lu lost\r\n", logRtc.head, logDropped);
+}
+
+bool logRingCrashPending(void)
+{
+    return crashPending;
+}
+
+void logRingCrashDelivered(void)
+{
+    crashPending = false;
+}
+
+void logRingWriteJson(tJsonWriter &json)
+{
+    json.beginObject("crash_log");
+    json.field("reason", crashReason);
+    json.beginArray("lines");
+    const char *p = crashBuf;
+    for (uint16_t i = 0; i < crashLines; i++)
+    {
+        json.value(p);
+        p += strlen(p) + 1;
+    }
+    json.endArray();
+    json.endObject();
+}
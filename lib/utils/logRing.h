@@ -0,0 +1,85 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "jsonWriter.h"
+
+// Deferred logging for hot paths: LOGR() stores the format string pointer, up
+// to LOG_RING_ARGS 32-bit arguments and a timestamp in a ring in RTC memory
+// and returns; a low-priority task formats and prints the lines. Levels are
+// set per module at run time, a line below its module's level costs a
+// compare. The ring survives a panic or watchdog reset, the last lines of the
+// crashed boot go out with the next status report.
+//
+// Arguments are taken as 32 bits: no %lld, floats are kept as float, and %s
+// only for strings that outlive the print (literals, role2str()), never a
+// String's c_str().
+
+#define LOG_RING_SIZE       48      // power of two, ~2 KB of RTC slow memory
+#define LOG_RING_ARGS       8
+#define LOG_RING_LINE_MAX   192
+#define LOG_RING_DRAIN_MS   20
+#define LOG_RING_MAGIC      0x474F4C52      // "RLOG"
+#define LOG_CRASH_LINES     16
+#define LOG_CRASH_BUF       1024
+
+enum tLogModule
+{
+    lmGame,
+    lmRecords,
+    lmRadio,
+    lmNet,
+    lmSync,
+    lmBoard,
+    LOG_MODULE_COUNT
+};
+
+enum tLogLevel
+{
+    llError,
+    llWarn,
+    llInfo,
+    llDebug
+};
+
+void logRingInit(void);         // early on boot, after Serial.begin(): keeps a crashed boot's lines, starts the drainer
+void logRingSetLevel(tLogModule module, tLogLevel level);
+bool logRingSetLevel(const String &module, const String &level);   // by name, for the serial command
+void logRingPrintLevels(void);
+bool logRingEnabled(tLogModule module, tLogLevel level);
+void logRingWrite(tLogModule module, tLogLevel level, const char *fmt, const uint32_t *args, uint8_t nargs);
+
+bool logRingCrashPending(void);                 // lines of a crashed boot, not yet delivered
+void logRingCrashDelivered(void);
+void logRingWriteJson(tJsonWriter &json);       // "crash_log":{...} member of an open object
+
+inline uint32_t logRingArg(int v) { return (uint32_t)v; }
+inline uint32_t logRingArg(unsigned int v) { return v; }
+inline uint32_t logRingArg(long v) { return (uint32_t)v; }
+inline uint32_t logRingArg(unsigned long v) { return (uint32_t)v; }
+inline uint32_t logRingArg(const char *v) { return (uint32_t)v; }
+inline uint32_t logRingArg(const void *v) { return (uint32_t)v; }
+inline uint32_t logRingArg(double v)
+{
+    float f = (float)v;
+    uint32_t u;
+    memcpy(&u, &f, sizeof(u));
+    return u;
+}
+uint32_t logRingArg(const String &v) = delete;  // gone by the time the line is printed
+uint32_t logRingArg(long long v) = delete;
+uint32_t logRingArg(unsigned long long v) = delete;
+
+template <typename... tArgs>
+inline void logRingPut(tLogModule module, tLogLevel level, const char *fmt, tArgs... args)
+{
+    static_assert(sizeof...(args) <= LOG_RING_ARGS, "too many LOGR arguments");
+    if (!logRingEnabled(module, level))
+    {
+        return;
+    }
+    const uint32_t packed[sizeof...(args) + 1] = {logRingArg(args)..., 0};
+    logRingWrite(module, level, fmt, packed, sizeof...(args));
+}
+
+#define LOGR(module, level, fmt, ...)   logRingPut(module, level, fmt, ##__VA_ARGS__)
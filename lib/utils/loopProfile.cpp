@@ -0,0 +1,170 @@
+#include "loopProfile.h"
+#include "logRing.h"
+
+static const char *stageNames[LOOP_STAGE_COUNT] = {"rx", "tx", "step", "visual", "api", "loop"};
+static const uint32_t stageBudgetUs[LOOP_STAGE_COUNT] =
+    {LOOP_BUDGET_RX_US, LOOP_BUDGET_TX_US, LOOP_BUDGET_STEP_US, LOOP_BUDGET_VISUAL_US, LOOP_BUDGET_API_US, LOOP_BUDGET_LOOP_US};
+
+struct tLoopHalf
+{
+    uint16_t hist[LOOP_STAGE_COUNT][LOOP_PROF_BUCKETS];    // saturates, a half is only seconds long
+    uint32_t maxUs[LOOP_STAGE_COUNT];
+    uint16_t over[LOOP_STAGE_COUNT];
+};
+
+// halves[cur] fills, the other one is the older half of the window
+static tLoopHalf halves[2];
+static uint8_t cur = 0;
+static uint32_t halfStartMs = 0;
+static uint32_t lastUs[LOOP_STAGE_COUNT];
+static uint32_t overTotal = 0;
+static uint32_t lastLogMs = 0;
+static portMUX_TYPE loopMux = portMUX_INITIALIZER_UNLOCKED;
+
+static inline uint8_t bucketOf(uint32_t us)
+{
+    uint8_t b = 31 - __builtin_clz(us | 1);
+    return (b < LOOP_PROF_BUCKETS) ? b : LOOP_PROF_BUCKETS - 1;
+}
+
+// Under loopMux
+static void rotate(uint32_t nowMs)
+{
+    if (nowMs - halfStartMs < LOOP_PROF_WINDOW_MS / 2)
+    {
+        return;
+    }
+    // a window without records leaves nothing of the older half either
+    bool stale = nowMs - halfStartMs >= LOOP_PROF_WINDOW_MS;
+    cur ^= 1;
+    memset(&halves[cur], 0, sizeof(tLoopHalf));
+    if (stale)
+    {
+        memset(&halves[cur ^ 1], 0, sizeof(tLoopHalf));
+    }
+    halfStartMs = nowMs;
+}
+
+void loopProfRecord(tLoopStage stage, uint32_t us)
+{
+    uint32_t nowMs = millis();
+    bool overBudget = (stageBudgetUs[stage] > 0) && (us > stageBudgetUs[stage]);
+    bool logIt = false;
+    portENTER_CRITICAL(&loopMux);
+    rotate(nowMs);
+    tLoopHalf &h = halves[cur];
+    uint16_t &n = h.hist[stage][bucketOf(us)];
+    if (n < UINT16_MAX)
+    {
+        n++;
+    }
+    if (us > h.maxUs[stage])
+    {
+        h.maxUs[stage] = us;
+    }
+    if (overBudget && (h.over[stage] < UINT16_MAX))
+    {
+        h.over[stage]++;
+    }
+    lastUs[stage] = us;
+    if (overBudget && (stage == lsGameLoop))
+    {
+        overTotal++;
+        logIt = nowMs - lastLogMs >= LOOP_PROF_LOG_MS;
+        if (logIt)
+        {
+            lastLogMs = nowMs;
+        }
+    }
+    portEXIT_CRITICAL(&loopMux);
+    if (logIt)
+    {
+        LOGR(lmGame, llWarn, "game loop %u us over budget: step %u visual %u api %u, rx %u tx %u",
+             (unsigned)us, (unsigned)lastUs[lsGameStep], (unsigned)lastUs[lsVisual], (unsigned)lastUs[lsApiUpdate],
+             (unsigned)lastUs[lsRxDrain], (unsigned)lastUs[lsTx]);
+    }
+}
+
+static uint32_t percentile(const uint32_t *hist, uint32_t count, uint32_t pct, uint32_t maxUs)
+{
+    uint32_t want = (count * pct + 99) / 100;
+    uint32_t seen = 0;
+    for (uint8_t b = 0; b < LOOP_PROF_BUCKETS; b++)
+    {
+        seen += hist[b];
+        if (seen >= want)
+        {
+            uint32_t upper = (b < LOOP_PROF_BUCKETS - 1) ? (2UL << b) - 1 : maxUs;
+            return min(upper, maxUs);
+        }
+    }
+    return maxUs;
+}
+
+void loopProfGet(tLoopStage stage, tLoopStageStats &stats)
+{
+    uint32_t hist[LOOP_PROF_BUCKETS];
+    portENTER_CRITICAL(&loopMux);
+    rotate(millis());
+    const tLoopHalf &a = halves[0];
+    const tLoopHalf &b = halves[1];
+    stats.count = 0;
+    for (uint8_t i = 0; i < LOOP_PROF_BUCKETS; i++)
+    {
+        hist[i] = a.hist[stage][i] + b.hist[stage][i];
+        stats.count += hist[i];
+    }
+    stats.maxUs = max(a.maxUs[stage], b.maxUs[stage]);
+    stats.over = a.over[stage] + b.over[stage];
+    portEXIT_CRITICAL(&loopMux);
+    stats.p50Us = stats.count ? percentile(hist, stats.count, 50, stats.maxUs) : 0;
+    stats.p99Us = stats.count ? percentile(hist, stats.count, 99, stats.maxUs) : 0;
+}
+
+uint32_t loopProfOverTotal(void)
+{
+    return overTotal;
+}
+
+void loopProfReset(void)
+{
+    portENTER_CRITICAL(&loopMux);
+    memset(halves, 0, sizeof(halves));
+    halfStartMs = millis();
+    overTotal = 0;
+    portEXIT_CRITICAL(&loopMux);
+}
+
+void loopProfPrint(void)
+{
+    Serial.printf(">>> loopProfPrint: last %u s, us\r\n", LOOP_PROF_WINDOW_MS / 1000);
+    Serial.printf("%-8s %8s %8s %8s %8s %8s %6s\r\n", "stage", "count", "p50", "p99", "max", "budget", "over");
+    for (int i = 0; i < LOOP_STAGE_COUNT; i++)
+    {
+        tLoopStageStats s;
+        loopProfGet((tLoopStage)i, s);
+        Serial.printf("%-8s %8u %8u %8u %8u %8u %6u\r\n", stageNames[i], (unsigned)s.count, (unsigned)s.p50Us,
+                      (unsigned)s.p99Us, (unsigned)s.maxUs, (unsigned)stageBudgetUs[i], (unsigned)s.over);
+    }
+    Serial.printf("game loop iterations over budget since boot: %u\r\n", (unsigned)overTotal);
+}
+
+void loopProfWriteJson(tJsonWriter &json)
+{
+    json.beginObject("loop");
+    json.field("window_s", LOOP_PROF_WINDOW_MS / 1000);
+    json.field("over_total", overTotal);
+    for (int i = 0; i < LOOP_STAGE_COUNT; i++)
+    {
+        tLoopStageStats s;
+        loopProfGet((tLoopStage)i, s);
+        json.beginObject(stageNames[i]);
+        json.field("n", s.count);
+        json.field("p50", s.p50Us);
+        json.field("p99", s.p99Us);
+        json.field("max", s.maxUs);
+        json.field("over", s.over);
+        json.endObject();
+    }
+    json.endObject();
+}
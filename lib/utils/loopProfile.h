@@ -0,0 +1,62 @@
+#pragma once
+
+#include <Arduino.h>
+#include <esp_timer.h>
+
+#include "jsonWriter.h"
+
+// Game loop timing: the radio task and the game loop record how long each
+// stage took, into log2 buckets of microseconds over a sliding window (two
+// halves, the older one dropped as a new one starts). p50/p99 are the upper
+// edges of their buckets, capped at the window's max. A stage over its budget
+// is counted; a game loop iteration over budget also logs its stage times.
+
+#define LOOP_PROF_BUCKETS       20      // [2^b, 2^(b+1)) us, the last one open ended
+#define LOOP_PROF_WINDOW_MS     10000
+#define LOOP_PROF_LOG_MS        1000    // at most one over-budget line this often
+
+// Budgets in us, 0: none
+#define LOOP_BUDGET_RX_US       4000    // the frames of one RX wait, the wait itself not counted
+#define LOOP_BUDGET_TX_US       2000
+#define LOOP_BUDGET_STEP_US     15000   // visualization included
+#define LOOP_BUDGET_VISUAL_US   10000
+#define LOOP_BUDGET_API_US      3000    // the exchange itself runs on the uplink task
+#define LOOP_BUDGET_LOOP_US     20000   // one game loop iteration, its delay not counted
+
+enum tLoopStage
+{
+    lsRxDrain,
+    lsTx,
+    lsGameStep,
+    lsVisual,
+    lsApiUpdate,
+    lsGameLoop,
+    LOOP_STAGE_COUNT
+};
+
+struct tLoopStageStats
+{
+    uint32_t count;
+    uint32_t p50Us;
+    uint32_t p99Us;
+    uint32_t maxUs;
+    uint32_t over;              // over budget in the window
+};
+
+inline uint32_t loopProfNowUs(void)
+{
+    return (uint32_t)esp_timer_get_time();
+}
+
+// From any task, one stage per task keeps the over-budget line consistent
+void loopProfRecord(tLoopStage stage, uint32_t us);
+inline void loopProfSince(tLoopStage stage, uint32_t startUs)
+{
+    loopProfRecord(stage, loopProfNowUs() - startUs);
+}
+
+void loopProfGet(tLoopStage stage, tLoopStageStats &stats);
+uint32_t loopProfOverTotal(void);           // over-budget game loop iterations since boot
+void loopProfReset(void);
+void loopProfPrint(void);
+void loopProfWriteJson(tJsonWriter &json);  // "loop":{...} member of an open object
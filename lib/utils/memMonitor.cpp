@@ -0,0 +1,275 @@
+#include "memMonitor.h"
+#include "logRing.h"
+#include "taskRegistry.h"
+
+// Header of a tagged block, 8 bytes keep the heap's alignment
+struct tMemTagHdr
+{
+    uint32_t size;
+    uint8_t  tag;
+    uint8_t  psram;
+    uint16_t magic;
+};
+
+#define MEM_TAG_MAGIC           0x4D54  // "MT"
+
+static const char *tagNames[MEM_TAG_COUNT] = {"json", "http", "val", "sync"};
+static const char *levelNames[] = {"ok", "warn", "critical"};
+
+static tMemStats memStats;
+static size_t tagHeld[MEM_TAG_COUNT][2];       // [tag][psram]
+static size_t tagPeak[MEM_TAG_COUNT];
+static uint32_t levelLogMs[3];
+static tMemWarnHook warnHook = NULL;
+static TaskHandle_t memTask = NULL;
+static portMUX_TYPE memMux = portMUX_INITIALIZER_UNLOCKED;
+
+static void sampleRegion(uint32_t caps, tMemRegion &r)
+{
+    multi_heap_info_t info;
+    heap_caps_get_info(&info, caps);
+    r.total = info.total_free_bytes + info.total_allocated_bytes;
+    r.free = info.total_free_bytes;
+    r.minFree = info.minimum_free_bytes;
+    r.largest = info.largest_free_block;
+    r.blocks = info.free_blocks;
+    r.fragPct = r.free ? 100 - (uint8_t)((uint64_t)r.largest * 100 / r.free) : 0;
+    if ((r.minLargest == 0) || (r.largest < r.minLargest))
+    {
+        r.minLargest = r.largest;
+    }
+}
+
+// The level of the internal heap, the current one is held until the numbers
+// are back above its limits by the margin
+static tMemLevel levelOf(const tMemRegion &r, tMemLevel cur)
+{
+    uint32_t margin = (cur != mlOk) ? MEM_MON_CLEAR_MARGIN : 0;
+    uint8_t fragMargin = (cur != mlOk) ? MEM_MON_CLEAR_FRAG : 0;
+    if (r.largest < MEM_MON_CRIT_BLOCK + ((cur == mlCritical) ? margin : 0))
+    {
+        return mlCritical;
+    }
+    if ((r.largest < MEM_MON_WARN_BLOCK + margin) || (r.free < MEM_MON_WARN_FREE + margin) ||
+        (r.fragPct + fragMargin >= MEM_MON_WARN_FRAG))
+    {
+        return mlWarn;
+    }
+    return mlOk;
+}
+
+void memMonSample(void)
+{
+    tMemRegion in;
+    tMemRegion ps;
+    portENTER_CRITICAL(&memMux);
+    in = memStats.internal;
+    ps = memStats.psram;
+    portEXIT_CRITICAL(&memMux);
+    // the heap walk takes its own locks, not under memMux
+    sampleRegion(MALLOC_CAP_INTERNAL, in);
+    if (ESP.getPsramSize())
+    {
+        sampleRegion(MALLOC_CAP_SPIRAM, ps);
+    }
+    tMemLevel prev = memStats.level;
+    tMemLevel level = levelOf(in, prev);
+    portENTER_CRITICAL(&memMux);
+    memStats.internal = in;
+    memStats.psram = ps;
+    memStats.level = level;
+    memStats.samples++;
+    if ((level > mlOk) && (level > prev))
+    {
+        memStats.warnings++;
+    }
+    portEXIT_CRITICAL(&memMux);
+
+    uint32_t now = millis();
+    if ((level != prev) || ((level > mlOk) && (now - levelLogMs[level] >= MEM_MON_LOG_MS)))
+    {
+        levelLogMs[level] = now;
+        if (level > mlOk)
+        {
+            LOGR(lmBoard, (level == mlCritical) ? llError : llWarn,
+                 "heap %s: internal free %u, largest %u, %u%% fragmented in %u blocks, min free %u",
+                 levelNames[level], (unsigned)in.free, (unsigned)in.largest, (unsigned)in.fragPct,
+                 (unsigned)in.blocks, (unsigned)in.minFree);
+        }
+        else
+        {
+            LOGR(lmBoard, llInfo, "heap ok: internal free %u, largest %u", (unsigned)in.free, (unsigned)in.largest);
+        }
+    }
+    if ((level != prev) && (warnHook != NULL))
+    {
+        warnHook(level);
+    }
+}
+
+static void memTaskFn(void *arg)
+{
+    TickType_t lastWake = xTaskGetTickCount();
+    for (;;)
+    {
+        vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(MEM_MON_SAMPLE_MS));
+        memMonSample();
+    }
+}
+
+void memMonStart(void)
+{
+    if (memTask != NULL)
+    {
+        return;
+    }
+    memMonSample();
+    if (!taskStart(tkMemMon, memTaskFn, NULL, &memTask))
+    {
+        return;
+    }
+    Serial.printf(">>> memMonStart: internal %u free, largest %u; PSRAM %u free\r\n",
+                  (unsigned)memStats.internal.free, (unsigned)memStats.internal.largest, (unsigned)memStats.psram.free);
+}
+
+void memMonSetHook(tMemWarnHook hook)
+{
+    warnHook = hook;
+}
+
+void memMonGet(tMemStats &st)
+{
+    portENTER_CRITICAL(&memMux);
+    st = memStats;
+    portEXIT_CRITICAL(&memMux);
+}
+
+tMemLevel memMonLevel(void)
+{
+    return memStats.level;
+}
+
+uint32_t memMonWarnings(void)
+{
+    return memStats.warnings;
+}
+
+#if MEM_MON_TAGS
+void *memTagAlloc(tMemTag tag, size_t size, uint32_t caps)
+{
+    tMemTagHdr *hdr = (tMemTagHdr *)heap_caps_malloc(sizeof(tMemTagHdr) + size, caps);
+    if (hdr == NULL)
+    {
+        return NULL;
+    }
+    hdr->size = size;
+    hdr->tag = tag;
+    hdr->psram = esp_ptr_external_ram(hdr) ? 1 : 0;
+    hdr->magic = MEM_TAG_MAGIC;
+    memTagAccount(tag, hdr->psram, size, 0);
+    return hdr + 1;
+}
+
+void memTagFree(void *ptr)
+{
+    if (ptr == NULL)
+    {
+        return;
+    }
+    tMemTagHdr *hdr = (tMemTagHdr *)ptr - 1;
+    if (hdr->magic != MEM_TAG_MAGIC)
+    {
+        Serial.printf("!!! memTagFree ERROR: %p is not a tagged block\r\n", ptr);
+        return;
+    }
+    hdr->magic = 0;
+    memTagAccount((tMemTag)hdr->tag, hdr->psram, 0, hdr->size);
+    heap_caps_free(hdr);
+}
+#endif
+
+void memTagAccount(tMemTag tag, bool psram, size_t add, size_t sub)
+{
+    portENTER_CRITICAL(&memMux);
+    size_t &held = tagHeld[tag][psram ? 1 : 0];
+    held = held + add - sub;
+    size_t sum = tagHeld[tag][0] + tagHeld[tag][1];
+    if (sum > tagPeak[tag])
+    {
+        tagPeak[tag] = sum;
+    }
+    portEXIT_CRITICAL(&memMux);
+}
+
+size_t memTagHeld(tMemTag tag)
+{
+    return tagHeld[tag][0] + tagHeld[tag][1];
+}
+
+size_t memTagPeak(tMemTag tag)
+{
+    return tagPeak[tag];
+}
+
+static void printRegion(const char *name, const tMemRegion &r)
+{
+    Serial.printf("%-9s %8u %8u %8u %8u %8u %6u %4u%%\r\n", name, (unsigned)r.total, (unsigned)r.free,
+                  (unsigned)r.minFree, (unsigned)r.largest, (unsigned)r.minLargest, (unsigned)r.blocks,
+                  (unsigned)r.fragPct);
+}
+
+void memMonPrint(void)
+{
+    memMonSample();
+    tMemStats st;
+    memMonGet(st);
+    Serial.printf(">>> MEM MAP: %s, %u warnings in %u samples\r\n", levelNames[st.level], (unsigned)st.warnings,
+                  (unsigned)st.samples);
+    Serial.printf("%-9s %8s %8s %8s %8s %8s %6s %5s\r\n", "region", "total", "free", "min", "largest", "min_lrg",
+                  "blocks", "frag");
+    printRegion("internal", st.internal);
+    if (st.psram.total)
+    {
+        printRegion("psram", st.psram);
+    }
+    Serial.printf("levels: warn below %u largest or %u free or from %u%% fragmented, critical below %u largest\r\n",
+                  MEM_MON_WARN_BLOCK, MEM_MON_WARN_FREE, MEM_MON_WARN_FRAG, MEM_MON_CRIT_BLOCK);
+    Serial.printf("%-9s %8s %8s %8s\r\n", "tag", "internal", "psram", "peak");
+    for (int i = 0; i < MEM_TAG_COUNT; i++)
+    {
+        Serial.printf("%-9s %8u %8u %8u\r\n", tagNames[i], (unsigned)tagHeld[i][0], (unsigned)tagHeld[i][1],
+                      (unsigned)tagPeak[i]);
+    }
+}
+
+static void writeRegion(tJsonWriter &json, const char *name, const tMemRegion &r)
+{
+    json.beginObject(name);
+    json.field("free", r.free);
+    json.field("min_free", r.minFree);
+    json.field("largest", r.largest);
+    json.field("min_largest", r.minLargest);
+    json.field("frag_pct", (unsigned int)r.fragPct);
+    json.endObject();
+}
+
+void memMonWriteJson(tJsonWriter &json)
+{
+    tMemStats st;
+    memMonGet(st);
+    json.beginObject("mem");
+    json.field("level", levelNames[st.level]);
+    json.field("warnings", st.warnings);
+    writeRegion(json, "internal", st.internal);
+    if (st.psram.total)
+    {
+        writeRegion(json, "psram", st.psram);
+    }
+    json.beginObject("tags");
+    for (int i = 0; i < MEM_TAG_COUNT; i++)
+    {
+        json.field(tagNames[i], (unsigned long)memTagHeld((tMemTag)i));
+    }
+    json.endObject();
+    json.endObject();
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <Arduino.h>
+#include <esp_heap_caps.h>
+
+#include "jsonWriter.h"
+
+// Heap watchdog: a low-priority task samples heap_caps_get_info() of the
+// internal heap and of PSRAM, keeps the minimum free and the smallest largest
+// block seen, and warns while the internal heap is still usable: WiFi RX/TX
+// and ESP-NOW buffers are taken from it at run time, a largest block below
+// MEM_MON_CRIT_BLOCK starts dropping frames and failing TCP connects. A warn
+// level is logged, counted and handed to the hook, which the status client
+// uses to report at once; the warning clears with some margin above the level.
+//
+// With MEM_MON_TAGS the memTagAlloc() blocks carry a header with their tag and
+// size, the bytes each subsystem holds are counted; without it they are plain
+// heap_caps_malloc() blocks. memTagAccount() counts blocks the caller sizes
+// itself (the JSON allocators do).
+
+#define MEM_MON_SAMPLE_MS       2000
+#define MEM_MON_WARN_BLOCK      16384   // internal largest free block, warn level
+#define MEM_MON_CRIT_BLOCK      8192    // below it WiFi and ESP-NOW buffers start failing
+#define MEM_MON_WARN_FREE       32768   // internal free bytes
+#define MEM_MON_WARN_FRAG       70      // % of the internal free bytes not in the largest block
+#define MEM_MON_CLEAR_MARGIN    4096    // above the levels before a warning clears
+#define MEM_MON_CLEAR_FRAG      5       // % under MEM_MON_WARN_FRAG
+#define MEM_MON_LOG_MS          30000   // at most one line per level this often while it lasts
+
+#ifndef MEM_MON_TAGS
+#define MEM_MON_TAGS            1
+#endif
+
+enum tMemTag
+{
+    mtJson,
+    mtHttp,
+    mtVal,
+    mtSync,
+    MEM_TAG_COUNT
+};
+
+enum tMemLevel
+{
+    mlOk,
+    mlWarn,
+    mlCritical
+};
+
+struct tMemRegion
+{
+    uint32_t total;
+    uint32_t free;
+    uint32_t minFree;           // since boot, from the heap itself
+    uint32_t largest;
+    uint32_t minLargest;        // smallest largest block the samples saw
+    uint32_t blocks;            // free blocks
+    uint8_t  fragPct;           // 100 - largest * 100 / free
+};
+
+struct tMemStats
+{
+    tMemRegion internal;
+    tMemRegion psram;
+    tMemLevel  level;
+    uint32_t   warnings;        // entries into warn or critical since boot
+    uint32_t   samples;
+};
+
+typedef void (*tMemWarnHook)(tMemLevel level);
+
+void memMonStart(void);                 // early on boot, the first sample is taken at once
+void memMonSample(void);                // the task's sample, also from the serial command
+void memMonSetHook(tMemWarnHook hook);  // called from the monitor task on every level change
+void memMonGet(tMemStats &st);
+tMemLevel memMonLevel(void);
+uint32_t memMonWarnings(void);
+void memMonPrint(void);                 // the memory map: both regions and the tags
+void memMonWriteJson(tJsonWriter &json);    // "mem":{...} member of an open object
+
+#if MEM_MON_TAGS
+void *memTagAlloc(tMemTag tag, size_t size, uint32_t caps);
+void memTagFree(void *ptr);
+#else
+inline void *memTagAlloc(tMemTag, size_t size, uint32_t caps) { return heap_caps_malloc(size, caps); }
+inline void memTagFree(void *ptr) { heap_caps_free(ptr); }
+#endif
+void memTagAccount(tMemTag tag, bool psram, size_t add, size_t sub);
+size_t memTagHeld(tMemTag tag);
+size_t memTagPeak(tMemTag tag);
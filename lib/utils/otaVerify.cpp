@@ -0,0 +1,112 @@
+#include "otaVerify.h"
+
+#include <esp_timer.h>
+#include <mbedtls/version.h>
+
+// mbedtls 3 dropped the _ret names IDF 4.4 still wants
+#if MBEDTLS_VERSION_NUMBER >= 0x03000000
+#define SHA256_STARTS   mbedtls_sha256_starts
+#define SHA256_UPDATE   mbedtls_sha256_update
+#define SHA256_FINISH   mbedtls_sha256_finish
+#else
+#define SHA256_STARTS   mbedtls_sha256_starts_ret
+#define SHA256_UPDATE   mbedtls_sha256_update_ret
+#define SHA256_FINISH   mbedtls_sha256_finish_ret
+#endif
+
+tOtaVerifier::~tOtaVerifier()
+{
+    if (started)
+    {
+        mbedtls_sha256_free(&sha);
+    }
+}
+
+void tOtaVerifier::begin(uint32_t total)
+{
+    if (started)
+    {
+        mbedtls_sha256_free(&sha);
+    }
+    mbedtls_sha256_init(&sha);
+    SHA256_STARTS(&sha, 0);
+    started = true;
+    totalBytes = total;
+    doneBytes = 0;
+    streamBytes = 0;
+    streamStartUs = esp_timer_get_time();
+    reportMs = millis();
+    hex[0] = 0;
+}
+
+void tOtaVerifier::add(const uint8_t *data, size_t len, bool transferred)
+{
+    if (!started || (len == 0))
+    {
+        return;
+    }
+    SHA256_UPDATE(&sha, data, len);
+    doneBytes += len;
+    if (transferred)
+    {
+        streamBytes += len;
+    }
+}
+
+bool tOtaVerifier::finish(const String &expectedHex)
+{
+    if (!started)
+    {
+        return false;
+    }
+    uint8_t sum[32];
+    SHA256_FINISH(&sha, sum);
+    mbedtls_sha256_free(&sha);
+    started = false;
+    for (int i = 0; i < 32; i++)
+    {
+        sprintf(&hex[i * 2], "%02x", sum[i]);
+    }
+    uint32_t ms = (uint32_t)((esp_timer_get_time() - streamStartUs) / 1000);
+    Serial.printf(">>> tOtaVerifier: %lu bytes in %lu ms (%lu B/s), SHA-256 %s\r\n", doneBytes, ms, rateBps(), hex);
+    if (expectedHex.isEmpty())
+    {
+        return true;
+    }
+    if (!expectedHex.equalsIgnoreCase(hex))
+    {
+        Serial.printf("!!! tOtaVerifier ERROR: SHA-256 mismatch, expected %s\r\n", expectedHex.c_str());
+        return false;
+    }
+    return true;
+}
+
+uint32_t tOtaVerifier::rateBps(void) const
+{
+    int64_t us = esp_timer_get_time() - streamStartUs;
+    if (us < 1000)
+    {
+        return 0;
+    }
+    return (uint32_t)(((uint64_t)streamBytes * 1000000) / us);
+}
+
+int32_t tOtaVerifier::etaS(void) const
+{
+    uint32_t rate = rateBps();
+    if ((totalBytes == 0) || (rate == 0) || (doneBytes >= totalBytes))
+    {
+        return (totalBytes && (doneBytes >= totalBytes)) ? 0 : -1;
+    }
+    return (int32_t)((totalBytes - doneBytes) / rate);
+}
+
+void tOtaVerifier::printProgress(const char *who)
+{
+    if (millis() - reportMs < OTA_VERIFY_REPORT_MS)
+    {
+        return;
+    }
+    reportMs = millis();
+    Serial.printf(">>> %s: %lu/%lu bytes, %lu B/s, ETA %ld s\r\n", who, doneBytes, totalBytes, rateBps(), etaS());
+}
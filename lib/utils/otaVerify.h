@@ -0,0 +1,42 @@
+#pragma once
+
+#include <Arduino.h>
+#include <mbedtls/sha256.h>
+
+// Streaming check of a firmware image on its way to flash, shared by the
+// portal upload and the HTTP OTA: SHA-256 over the bytes as they arrive (the
+// mbedtls port runs it on the S3 SHA engine) plus the transfer rate and ETA.
+// The expected digest is compared before the partition is made bootable.
+
+#define OTA_VERIFY_HEX_LEN      64
+#define OTA_VERIFY_REPORT_MS    1000
+
+class tOtaVerifier
+{
+public:
+    ~tOtaVerifier();
+
+    // total 0: size not known; a resume hashes the bytes already on flash
+    // with add(..., false) first, they do not count for the rate
+    void begin(uint32_t total);
+    void add(const uint8_t *data, size_t len, bool transferred = true);
+    // Closes the hash; true when expectedHex is empty or matches
+    bool finish(const String &expectedHex);
+
+    inline const char *digest(void) const { return hex; }
+    inline uint32_t done(void) const { return doneBytes; }
+    inline uint32_t total(void) const { return totalBytes; }
+    uint32_t rateBps(void) const;
+    int32_t etaS(void) const;           // -1 while not known
+    void printProgress(const char *who);    // once per OTA_VERIFY_REPORT_MS
+
+private:
+    mbedtls_sha256_context sha;
+    bool     started = false;
+    uint32_t totalBytes = 0;
+    uint32_t doneBytes = 0;
+    uint32_t streamBytes = 0;
+    int64_t  streamStartUs = 0;
+    uint32_t reportMs = 0;
+    char     hex[OTA_VERIFY_HEX_LEN + 1] = {0};
+};
@@ -0,0 +1,204 @@
+#include "pmLocks.h"
+
+#include <esp_pm.h>
+#if CONFIG_IDF_TARGET_ESP32S3
+#include <esp32s3/pm.h>
+#endif
+
+static const char *lockNames[PM_LOCK_COUNT] = {"radio", "display", "audio", "http"};
+
+struct tPmLockAcc
+{
+    uint16_t held;
+    uint32_t sinceMs;
+    uint64_t heldMs;
+};
+
+static bool enabled = false;
+static uint32_t maxMhz = 0;
+static uint32_t statsStartMs = 0;
+static tPmLockAcc locks[PM_LOCK_COUNT];
+static uint16_t anyHeld = 0;            // locks held at all, the CPU is at full clock meanwhile
+static uint32_t anySinceMs = 0;
+static uint64_t anyMs = 0;
+static portMUX_TYPE pmMux = portMUX_INITIALIZER_UNLOCKED;
+#if CONFIG_PM_ENABLE
+static esp_pm_lock_handle_t handles[PM_LOCK_COUNT];
+#endif
+
+bool pmInit(void)
+{
+    maxMhz = getCpuFrequencyMhz();
+    pmStatsReset();
+#if CONFIG_PM_ENABLE && CONFIG_IDF_TARGET_ESP32S3
+    if (!PM_DFS)
+    {
+        return false;
+    }
+    for (int i = 0; i < PM_LOCK_COUNT; i++)
+    {
+        if (esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, lockNames[i], &handles[i]) != ESP_OK)
+        {
+            Serial.printf("!!! pmInit ERROR: lock <%s>\r\n", lockNames[i]);
+            return false;
+        }
+    }
+    // the audio lock may be held since boot, taken for real from now on
+    for (int i = 0; i < PM_LOCK_COUNT; i++)
+    {
+        for (uint16_t n = 0; n < locks[i].held; n++)
+        {
+            esp_pm_lock_acquire(handles[i]);
+        }
+    }
+    esp_pm_config_esp32s3_t pm = {};
+    pm.max_freq_mhz = maxMhz;
+    pm.min_freq_mhz = PM_MIN_CPU_MHZ;
+#if CONFIG_FREERTOS_USE_TICKLESS_IDLE
+    pm.light_sleep_enable = PM_LIGHT_SLEEP;
+#endif
+    esp_err_t err = esp_pm_configure(&pm);
+    if (err != ESP_OK)
+    {
+        Serial.printf("!!! pmInit ERROR: esp_pm_configure (%d)\r\n", (int)err);
+        return false;
+    }
+    enabled = true;
+    Serial.printf(">>> pmInit: %u..%u MHz, light sleep %s\r\n", PM_MIN_CPU_MHZ, (unsigned)maxMhz,
+                  pm.light_sleep_enable ? "on" : "off");
+    return true;
+#else
+    Serial.println("*** pmInit WARNING! no power management in this build, full clock");
+    return false;
+#endif
+}
+
+bool pmEnabled(void)
+{
+    return enabled;
+}
+
+uint32_t pmMaxMhz(void)
+{
+    return maxMhz ? maxMhz : getCpuFrequencyMhz();
+}
+
+void pmAcquire(tPmLock lock)
+{
+    uint32_t now = millis();
+    portENTER_CRITICAL(&pmMux);
+    tPmLockAcc &a = locks[lock];
+    if (a.held++ == 0)
+    {
+        a.sinceMs = now;
+    }
+    if (anyHeld++ == 0)
+    {
+        anySinceMs = now;
+    }
+    portEXIT_CRITICAL(&pmMux);
+#if CONFIG_PM_ENABLE
+    if (enabled)
+    {
+        esp_pm_lock_acquire(handles[lock]);
+    }
+#endif
+}
+
+void pmRelease(tPmLock lock)
+{
+    uint32_t now = millis();
+    portENTER_CRITICAL(&pmMux);
+    tPmLockAcc &a = locks[lock];
+    if (a.held == 0)
+    {
+        portEXIT_CRITICAL(&pmMux);
+        return;
+    }
+    if (--a.held == 0)
+    {
+        a.heldMs += now - a.sinceMs;
+    }
+    if (--anyHeld == 0)
+    {
+        anyMs += now - anySinceMs;
+    }
+    portEXIT_CRITICAL(&pmMux);
+#if CONFIG_PM_ENABLE
+    if (enabled)
+    {
+        esp_pm_lock_release(handles[lock]);
+    }
+#endif
+}
+
+void pmStatsReset(void)
+{
+    uint32_t now = millis();
+    portENTER_CRITICAL(&pmMux);
+    for (int i = 0; i < PM_LOCK_COUNT; i++)
+    {
+        locks[i].heldMs = 0;
+        locks[i].sinceMs = now;
+    }
+    anyMs = 0;
+    anySinceMs = now;
+    statsStartMs = now;
+    portEXIT_CRITICAL(&pmMux);
+}
+
+// Hold times up to now, the ones still held included
+static uint32_t snapshot(uint64_t *heldMs, uint64_t &maxMs)
+{
+    uint32_t now = millis();
+    portENTER_CRITICAL(&pmMux);
+    for (int i = 0; i < PM_LOCK_COUNT; i++)
+    {
+        heldMs[i] = locks[i].heldMs + (locks[i].held ? now - locks[i].sinceMs : 0);
+    }
+    maxMs = anyMs + (anyHeld ? now - anySinceMs : 0);
+    uint32_t elapsedMs = now - statsStartMs;
+    portEXIT_CRITICAL(&pmMux);
+    return elapsedMs;
+}
+
+// Time with a lock held runs at the full clock; the rest is at PM_MIN_CPU_MHZ
+// or asleep with PM on, at the full clock too without it, unless a driver
+// lock kept it up
+void pmPrint(void)
+{
+    uint64_t heldMs[PM_LOCK_COUNT];
+    uint64_t maxMs;
+    uint32_t elapsedMs = snapshot(heldMs, maxMs);
+    uint32_t span = elapsedMs ? elapsedMs : 1;
+    Serial.printf(">>> pmPrint: DFS %s, %lu s\r\n", enabled ? "on" : "off", elapsedMs / 1000);
+    Serial.printf("\t%4u MHz %5.1f%% (locks held)\r\n", (unsigned)pmMaxMhz(), 100.0f * maxMs / span);
+    Serial.printf("\t%4u MHz %5.1f%% (or light sleep)\r\n", enabled ? PM_MIN_CPU_MHZ : (unsigned)pmMaxMhz(),
+                  100.0f * (elapsedMs - maxMs) / span);
+    for (int i = 0; i < PM_LOCK_COUNT; i++)
+    {
+        Serial.printf("\tlock %-8s %5.1f%%\r\n", lockNames[i], 100.0f * heldMs[i] / span);
+    }
+#if CONFIG_PM_ENABLE && CONFIG_PM_PROFILING
+    // the driver's own view, its locks and the time in each mode
+    esp_pm_dump_locks(stdout);
+#endif
+}
+
+void pmWriteJson(tJsonWriter &json)
+{
+    uint64_t heldMs[PM_LOCK_COUNT];
+    uint64_t maxMs;
+    uint32_t elapsedMs = snapshot(heldMs, maxMs);
+    json.beginObject("pm");
+    json.field("dfs", enabled);
+    json.field("max_mhz", pmMaxMhz());
+    json.field("min_mhz", (uint32_t)(enabled ? PM_MIN_CPU_MHZ : pmMaxMhz()));
+    json.field("max_ms", (uint32_t)maxMs);
+    json.field("min_ms", (uint32_t)(elapsedMs - maxMs));
+    for (int i = 0; i < PM_LOCK_COUNT; i++)
+    {
+        json.field(lockNames[i], (uint32_t)heldMs[i]);
+    }
+    json.endObject();
+}
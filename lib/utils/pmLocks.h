@@ -0,0 +1,51 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "jsonWriter.h"
+
+// Dynamic frequency scaling through esp_pm: the CPU runs at PM_MIN_CPU_MHZ
+// unless a subsystem holds its lock, and with tickless idle in the build the
+// chip light sleeps whenever nothing holds one (the WiFi driver keeps it
+// awake unless modem sleep is on). The SPI master and I2S drivers take their
+// own APB locks while transfers are in flight; the ones here keep the CPU at
+// full clock while the work around them runs. Without CONFIG_PM_ENABLE the
+// clock stays where it is, the hold times are still counted.
+
+#ifndef PM_DFS
+#define PM_DFS              1
+#endif
+#ifndef PM_MIN_CPU_MHZ
+#define PM_MIN_CPU_MHZ      80      // idle clock, WiFi needs the APB at 80 MHz
+#endif
+#ifndef PM_LIGHT_SLEEP
+#define PM_LIGHT_SLEEP      1       // only where tickless idle is built in
+#endif
+
+enum tPmLock
+{
+    plRadio,        // ESP-NOW RX drain and TX
+    plDisplay,      // frame render and push
+    plAudio,        // decoder while a track plays
+    plHttp,         // server reports, file sync, OTA
+    PM_LOCK_COUNT
+};
+
+bool pmInit(void);                  // after boot, which runs at full clock
+bool pmEnabled(void);
+uint32_t pmMaxMhz(void);
+
+// Any task, counted: nested holds of one lock are fine
+void pmAcquire(tPmLock lock);
+void pmRelease(tPmLock lock);
+
+struct tPmHold
+{
+    tPmLock lock;
+    tPmHold(tPmLock l) : lock(l) { pmAcquire(lock); }
+    ~tPmHold() { pmRelease(lock); }
+};
+
+void pmStatsReset(void);
+void pmPrint(void);
+void pmWriteJson(tJsonWriter &json);    // "pm":{...} member of an open object
@@ -0,0 +1,232 @@
+#include "taskRegistry.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+static const tTaskSpec taskSpecs[TASK_ID_COUNT] = {
+    {"bootJob",         TASK_BOOT_JOB_STACK,        TASK_BOOT_JOB_PRIO,         TASK_BOOT_JOB_CORE},
+    {"radioTask",       TASK_RADIO_STACK,           TASK_RADIO_PRIO,            TASK_RADIO_CORE},
+    {"Uplink",          TASK_UPLINK_STACK,          TASK_UPLINK_PRIO,           TASK_UPLINK_CORE},
+    {"gameScreenTask",  TASK_GAME_SCREEN_STACK,     TASK_GAME_SCREEN_PRIO,      TASK_GAME_SCREEN_CORE},
+    {"valTask",         TASK_VAL_STACK,             TASK_VAL_PRIO,              TASK_VAL_CORE},
+    {"audioTask",       TASK_AUDIO_STACK,           TASK_AUDIO_PRIO,            TASK_AUDIO_CORE},
+    {"sfxTask",         TASK_SFX_STACK,             TASK_SFX_PRIO,              TASK_SFX_CORE},
+    {"serialCommTask",  TASK_SERIAL_STACK,          TASK_SERIAL_PRIO,           TASK_SERIAL_CORE},
+    {"ButtonMonitor",   TASK_BUTTON_STACK,          TASK_BUTTON_PRIO,           TASK_BUTTON_CORE},
+    {"telemetryTask",   TASK_TELEMETRY_STACK,       TASK_TELEMETRY_PRIO,        TASK_TELEMETRY_CORE},
+    {"logDrainTask",    TASK_LOG_DRAIN_STACK,       TASK_LOG_DRAIN_PRIO,        TASK_LOG_DRAIN_CORE},
+    {"lvglTask",        TASK_LVGL_STACK,            TASK_LVGL_PRIO,             TASK_LVGL_CORE},
+    {"battTask",        TASK_BATTERY_STACK,         TASK_BATTERY_PRIO,          TASK_BATTERY_CORE},
+    {"accelTask",       TASK_ACCEL_STACK,           TASK_ACCEL_PRIO,            TASK_ACCEL_CORE},
+    {"psramPrefetch",   TASK_PSRAM_PREFETCH_STACK,  TASK_PSRAM_PREFETCH_PRIO,   TASK_PSRAM_PREFETCH_CORE},
+    {"assetSync",       TASK_ASSET_SYNC_STACK,      TASK_ASSET_SYNC_PRIO,       TASK_ASSET_SYNC_CORE},
+    {"otaStage",        TASK_OTA_STAGE_STACK,       TASK_OTA_STAGE_PRIO,        TASK_OTA_STAGE_CORE},
+    {"phasePrefetch",   TASK_PREFETCH_STACK,        TASK_PREFETCH_PRIO,         TASK_PREFETCH_CORE},
+    {"syncWriter",      TASK_SYNC_WRITER_STACK,     TASK_SYNC_WRITER_PRIO,      TASK_SYNC_WRITER_CORE},
+    {"syncReader",      TASK_SYNC_READER_STACK,     TASK_SYNC_READER_PRIO,      TASK_SYNC_READER_CORE},
+    {"memMonTask",      TASK_MEM_MON_STACK,         TASK_MEM_MON_PRIO,          TASK_MEM_MON_CORE},
+    {"wifiRoamTask",    TASK_WIFI_ROAM_STACK,       TASK_WIFI_ROAM_PRIO,        TASK_WIFI_ROAM_CORE},
+    {"pingerTask",      TASK_PINGER_STACK,          TASK_PINGER_PRIO,           TASK_PINGER_CORE},
+    {"provTask",        TASK_PROV_STACK,            TASK_PROV_PRIO,             TASK_PROV_CORE},
+    {"fsWorker",        TASK_FS_WORKER_STACK,       TASK_FS_WORKER_PRIO,        TASK_FS_WORKER_CORE},
+    {"ledTestTask",     TASK_LED_TEST_STACK,        TASK_LED_TEST_PRIO,         TASK_LED_TEST_CORE},
+};
+
+// Run time counters of the previous report, the serial table and the status
+// report each keep their own so one does not shorten the other's window
+struct tCpuWindow
+{
+    TaskHandle_t handle[TASK_REG_MAX_TRACKED];
+    uint32_t     runTime[TASK_REG_MAX_TRACKED];
+    uint8_t      count;
+    uint32_t     total;
+};
+
+#if (configUSE_TRACE_FACILITY == 1) && (configGENERATE_RUN_TIME_STATS == 1)
+static tCpuWindow serialWindow;
+static tCpuWindow statusWindow;
+#endif
+
+const tTaskSpec &taskSpec(tTaskId id)
+{
+    return taskSpecs[(id < TASK_ID_COUNT) ? id : tkBootJob];
+}
+
+bool taskStart(tTaskId id, TaskFunction_t fn, void *param, TaskHandle_t *handle, const char *name)
+{
+    const tTaskSpec &spec = taskSpec(id);
+    if (name == NULL)
+    {
+        name = spec.name;
+    }
+    if (xTaskCreatePinnedToCore(fn, name, spec.stack, param, spec.priority, handle, spec.core) != pdPASS)
+    {
+        Serial.printf("!!! taskStart ERROR: no memory for [%s], %u bytes of stack\r\n", name, (unsigned)spec.stack);
+        if (handle != NULL)
+        {
+            *handle = NULL;
+        }
+        return false;
+    }
+    return true;
+}
+
+static const tTaskSpec *specByName(const char *name)
+{
+    for (int i = 0; i < TASK_ID_COUNT; i++)
+    {
+        if (!strcmp(taskSpecs[i].name, name))
+        {
+            return &taskSpecs[i];
+        }
+    }
+    return NULL;
+}
+
+#if (configUSE_TRACE_FACILITY == 1)
+static TaskStatus_t *takeTasks(UBaseType_t &count, uint32_t &total)
+{
+    count = uxTaskGetNumberOfTasks() + 2;
+    TaskStatus_t *tasks = (TaskStatus_t *)malloc(count * sizeof(TaskStatus_t));
+    if (tasks == NULL)
+    {
+        Serial.println("!!! taskRegistry ERROR: no memory for the task list");
+        count = 0;
+        return NULL;
+    }
+    count = uxTaskGetSystemState(tasks, count, &total);
+    return tasks;
+}
+
+#if (configGENERATE_RUN_TIME_STATS == 1)
+// Replaces every ulRunTimeCounter with the part since the window's last
+// report and returns the time both cores had in between, 0 for the first one
+static uint64_t takeCpuDeltas(tCpuWindow &w, TaskStatus_t *tasks, UBaseType_t count, uint32_t total)
+{
+    uint64_t cpuTime = w.total ? (uint64_t)(total - w.total) * portNUM_PROCESSORS : 0;
+    tCpuWindow next;
+    next.count = 0;
+    next.total = total;
+    for (UBaseType_t i = 0; i < count; i++)
+    {
+        uint32_t last = tasks[i].ulRunTimeCounter;  // new task: nothing to show yet
+        for (uint8_t j = 0; j < w.count; j++)
+        {
+            if (w.handle[j] == tasks[i].xHandle)
+            {
+                last = w.runTime[j];
+                break;
+            }
+        }
+        if (next.count < TASK_REG_MAX_TRACKED)
+        {
+            next.handle[next.count] = tasks[i].xHandle;
+            next.runTime[next.count] = tasks[i].ulRunTimeCounter;
+            next.count++;
+        }
+        tasks[i].ulRunTimeCounter -= last;
+    }
+    w = next;
+    return cpuTime;
+}
+#endif
+#endif
+
+void taskRegistryPrint(void)
+{
+    Serial.println(">>> taskRegistryPrint: stack in bytes, cpu since the previous call");
+#if (configUSE_TRACE_FACILITY == 1)
+    UBaseType_t count;
+    uint32_t total;
+    TaskStatus_t *tasks = takeTasks(count, total);
+    if (tasks == NULL)
+    {
+        return;
+    }
+#if (configGENERATE_RUN_TIME_STATS == 1)
+    uint64_t cpuTime = takeCpuDeltas(serialWindow, tasks, count, total);
+#else
+    uint64_t cpuTime = 0;
+#endif
+    Serial.printf("%-16s %4s %4s %6s %6s %6s\r\n", "task", "core", "prio", "stack", "free", "cpu%");
+    for (UBaseType_t i = 0; i < count; i++)
+    {
+        const tTaskSpec *spec = specByName(tasks[i].pcTaskName);
+        char core[6] = "-";
+        char stack[8] = "-";
+        char cpu[12] = "-";
+        if (spec != NULL)
+        {
+            if (spec->core == TASK_CORE_ANY)
+            {
+                strcpy(core, "any");
+            }
+            else
+            {
+                snprintf(core, sizeof(core), "%d", (int)spec->core);
+            }
+            snprintf(stack, sizeof(stack), "%u", (unsigned)spec->stack);
+        }
+        if (cpuTime > 0)
+        {
+            uint32_t permille = (uint32_t)((uint64_t)tasks[i].ulRunTimeCounter * 1000 / cpuTime);
+            snprintf(cpu, sizeof(cpu), "%u.%u", (unsigned)(permille / 10), (unsigned)(permille % 10));
+        }
+        Serial.printf("%-16s %4s %4u %6s %6u %6s\r\n", tasks[i].pcTaskName, core, (unsigned)tasks[i].uxCurrentPriority,
+                      stack, (unsigned)tasks[i].usStackHighWaterMark, cpu);
+    }
+    free(tasks);
+#if (configGENERATE_RUN_TIME_STATS == 1)
+    if (cpuTime == 0)
+    {
+        Serial.println("cpu% from the next call on");
+    }
+#else
+    Serial.println("cpu% needs FreeRTOS run time stats in the build");
+#endif
+#else
+    for (int i = 0; i < TASK_ID_COUNT; i++)
+    {
+        Serial.printf("%-16s core %d prio %u stack %u\r\n", taskSpecs[i].name, (int)taskSpecs[i].core,
+                      (unsigned)taskSpecs[i].priority, (unsigned)taskSpecs[i].stack);
+    }
+#endif
+}
+
+void taskRegistryWriteJson(tJsonWriter &json)
+{
+#if (configUSE_TRACE_FACILITY == 1)
+    UBaseType_t count;
+    uint32_t total;
+    TaskStatus_t *tasks = takeTasks(count, total);
+    if (tasks == NULL)
+    {
+        return;
+    }
+#if (configGENERATE_RUN_TIME_STATS == 1)
+    uint64_t cpuTime = takeCpuDeltas(statusWindow, tasks, count, total);
+#else
+    uint64_t cpuTime = 0;
+#endif
+    json.beginArray("tasks");
+    for (UBaseType_t i = 0; i < count; i++)
+    {
+        const tTaskSpec *spec = specByName(tasks[i].pcTaskName);
+        if (spec == NULL)
+        {
+            continue;
+        }
+        json.beginObject();
+        json.field("name", spec->name);
+        json.field("stack", (unsigned int)spec->stack);
+        json.field("stack_free", (unsigned int)tasks[i].usStackHighWaterMark);
+        if (cpuTime > 0)
+        {
+            json.field("cpu", (unsigned int)((uint64_t)tasks[i].ulRunTimeCounter * 100 / cpuTime));
+        }
+        json.endObject();
+    }
+    json.endArray();
+    free(tasks);
+#endif
+}
@@ -0,0 +1,323 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "jsonWriter.h"
+
+// Every task the firmware starts, with its stack, priority and core in one
+// table. A build env overrides any entry with -D TASK_<NAME>_STACK/_PRIO/_CORE.
+// Stacks are in bytes as ESP-IDF counts them. taskRegistryPrint() lists all
+// running tasks with the stack they never touched and, with FreeRTOS run time
+// stats, their share of both cores since the previous call; the status report
+// carries the same for the registered tasks.
+
+#define TASK_CORE_ANY           tskNO_AFFINITY
+#define TASK_REG_MAX_TRACKED    40      // run time counters kept between two reports
+
+#ifndef TASK_BOOT_JOB_STACK
+#define TASK_BOOT_JOB_STACK     8192    // boot stages run in parallel on their own tasks
+#endif
+#ifndef TASK_BOOT_JOB_PRIO
+#define TASK_BOOT_JOB_PRIO      1
+#endif
+#ifndef TASK_BOOT_JOB_CORE
+#define TASK_BOOT_JOB_CORE      TASK_CORE_ANY
+#endif
+
+#ifndef TASK_RADIO_STACK
+#define TASK_RADIO_STACK        4096
+#endif
+#ifndef TASK_RADIO_PRIO
+#define TASK_RADIO_PRIO         5       // beacons and the RX ring, ahead of screen and LED work
+#endif
+#ifndef TASK_RADIO_CORE
+#define TASK_RADIO_CORE         0
+#endif
+
+#ifndef TASK_UPLINK_STACK
+#define TASK_UPLINK_STACK       6144
+#endif
+#ifndef TASK_UPLINK_PRIO
+#define TASK_UPLINK_PRIO        1
+#endif
+#ifndef TASK_UPLINK_CORE
+#define TASK_UPLINK_CORE        0
+#endif
+
+#ifndef TASK_GAME_SCREEN_STACK
+#define TASK_GAME_SCREEN_STACK  8192
+#endif
+#ifndef TASK_GAME_SCREEN_PRIO
+#define TASK_GAME_SCREEN_PRIO   3
+#endif
+#ifndef TASK_GAME_SCREEN_CORE
+#define TASK_GAME_SCREEN_CORE   APP_CPU_NUM
+#endif
+
+#ifndef TASK_VAL_STACK
+#define TASK_VAL_STACK          10000
+#endif
+#ifndef TASK_VAL_PRIO
+#define TASK_VAL_PRIO           3
+#endif
+#ifndef TASK_VAL_CORE
+#define TASK_VAL_CORE           1       // LED timing
+#endif
+
+#ifndef TASK_AUDIO_STACK
+#define TASK_AUDIO_STACK        4096
+#endif
+#ifndef TASK_AUDIO_PRIO
+#define TASK_AUDIO_PRIO         4
+#endif
+#ifndef TASK_AUDIO_CORE
+#define TASK_AUDIO_CORE         0       // valTask keeps core 1 for LED timing
+#endif
+
+#ifndef TASK_SFX_STACK
+#define TASK_SFX_STACK          3000
+#endif
+#ifndef TASK_SFX_PRIO
+#define TASK_SFX_PRIO           4
+#endif
+#ifndef TASK_SFX_CORE
+#define TASK_SFX_CORE           1
+#endif
+
+#ifndef TASK_SERIAL_STACK
+#define TASK_SERIAL_STACK       8192
+#endif
+#ifndef TASK_SERIAL_PRIO
+#define TASK_SERIAL_PRIO        5
+#endif
+#ifndef TASK_SERIAL_CORE
+#define TASK_SERIAL_CORE        APP_CPU_NUM
+#endif
+
+#ifndef TASK_BUTTON_STACK
+#define TASK_BUTTON_STACK       2048
+#endif
+#ifndef TASK_BUTTON_PRIO
+#define TASK_BUTTON_PRIO        10
+#endif
+#ifndef TASK_BUTTON_CORE
+#define TASK_BUTTON_CORE        TASK_CORE_ANY
+#endif
+
+#ifndef TASK_TELEMETRY_STACK
+#define TASK_TELEMETRY_STACK    4096
+#endif
+#ifndef TASK_TELEMETRY_PRIO
+#define TASK_TELEMETRY_PRIO     1
+#endif
+#ifndef TASK_TELEMETRY_CORE
+#define TASK_TELEMETRY_CORE     APP_CPU_NUM
+#endif
+
+#ifndef TASK_LOG_DRAIN_STACK
+#define TASK_LOG_DRAIN_STACK    4096
+#endif
+#ifndef TASK_LOG_DRAIN_PRIO
+#define TASK_LOG_DRAIN_PRIO     1
+#endif
+#ifndef TASK_LOG_DRAIN_CORE
+#define TASK_LOG_DRAIN_CORE     APP_CPU_NUM
+#endif
+
+#ifndef TASK_LVGL_STACK
+#define TASK_LVGL_STACK         6144
+#endif
+#ifndef TASK_LVGL_PRIO
+#define TASK_LVGL_PRIO          2
+#endif
+#ifndef TASK_LVGL_CORE
+#define TASK_LVGL_CORE          APP_CPU_NUM
+#endif
+
+#ifndef TASK_BATTERY_STACK
+#define TASK_BATTERY_STACK      2048
+#endif
+#ifndef TASK_BATTERY_PRIO
+#define TASK_BATTERY_PRIO       1
+#endif
+#ifndef TASK_BATTERY_CORE
+#define TASK_BATTERY_CORE       0
+#endif
+
+#ifndef TASK_ACCEL_STACK
+#define TASK_ACCEL_STACK        2560
+#endif
+#ifndef TASK_ACCEL_PRIO
+#define TASK_ACCEL_PRIO         1
+#endif
+#ifndef TASK_ACCEL_CORE
+#define TASK_ACCEL_CORE         0
+#endif
+
+#ifndef TASK_PSRAM_PREFETCH_STACK
+#define TASK_PSRAM_PREFETCH_STACK 4096
+#endif
+#ifndef TASK_PSRAM_PREFETCH_PRIO
+#define TASK_PSRAM_PREFETCH_PRIO 0      // only when nothing else wants the CPU
+#endif
+#ifndef TASK_PSRAM_PREFETCH_CORE
+#define TASK_PSRAM_PREFETCH_CORE TASK_CORE_ANY
+#endif
+
+#ifndef TASK_ASSET_SYNC_STACK
+#define TASK_ASSET_SYNC_STACK   8192
+#endif
+#ifndef TASK_ASSET_SYNC_PRIO
+#define TASK_ASSET_SYNC_PRIO    0       // background sync while waiting for a game
+#endif
+#ifndef TASK_ASSET_SYNC_CORE
+#define TASK_ASSET_SYNC_CORE    TASK_CORE_ANY
+#endif
+
+#ifndef TASK_OTA_STAGE_STACK
+#define TASK_OTA_STAGE_STACK    8192
+#endif
+#ifndef TASK_OTA_STAGE_PRIO
+#define TASK_OTA_STAGE_PRIO     0       // background firmware download while waiting for a game
+#endif
+#ifndef TASK_OTA_STAGE_CORE
+#define TASK_OTA_STAGE_CORE     TASK_CORE_ANY
+#endif
+
+#ifndef TASK_PREFETCH_STACK
+#define TASK_PREFETCH_STACK     6144    // a BMP row on the stack while decoding
+#endif
+#ifndef TASK_PREFETCH_PRIO
+#define TASK_PREFETCH_PRIO      0       // next phase pictures and sounds, idle time only
+#endif
+#ifndef TASK_PREFETCH_CORE
+#define TASK_PREFETCH_CORE      TASK_CORE_ANY
+#endif
+
+#ifndef TASK_SYNC_WRITER_STACK
+#define TASK_SYNC_WRITER_STACK  4096
+#endif
+#ifndef TASK_SYNC_WRITER_PRIO
+#define TASK_SYNC_WRITER_PRIO   1
+#endif
+#ifndef TASK_SYNC_WRITER_CORE
+#define TASK_SYNC_WRITER_CORE   TASK_CORE_ANY
+#endif
+
+#ifndef TASK_SYNC_READER_STACK
+#define TASK_SYNC_READER_STACK  6144
+#endif
+#ifndef TASK_SYNC_READER_PRIO
+#define TASK_SYNC_READER_PRIO   1
+#endif
+#ifndef TASK_SYNC_READER_CORE
+#define TASK_SYNC_READER_CORE   TASK_CORE_ANY
+#endif
+
+#ifndef TASK_MEM_MON_STACK
+#define TASK_MEM_MON_STACK      2560
+#endif
+#ifndef TASK_MEM_MON_PRIO
+#define TASK_MEM_MON_PRIO       1
+#endif
+#ifndef TASK_MEM_MON_CORE
+#define TASK_MEM_MON_CORE       TASK_CORE_ANY
+#endif
+
+#ifndef TASK_WIFI_ROAM_STACK
+#define TASK_WIFI_ROAM_STACK    4096    // scan records and the PBKDF2 context
+#endif
+#ifndef TASK_WIFI_ROAM_PRIO
+#define TASK_WIFI_ROAM_PRIO     1
+#endif
+#ifndef TASK_WIFI_ROAM_CORE
+#define TASK_WIFI_ROAM_CORE     0
+#endif
+
+#ifndef TASK_PINGER_STACK
+#define TASK_PINGER_STACK       4096
+#endif
+#ifndef TASK_PINGER_PRIO
+#define TASK_PINGER_PRIO        5       // as the radio task it stands in for
+#endif
+#ifndef TASK_PINGER_CORE
+#define TASK_PINGER_CORE        0
+#endif
+
+#ifndef TASK_PROV_STACK
+#define TASK_PROV_STACK         6144    // the HMAC and the nconf.json merge
+#endif
+#ifndef TASK_PROV_PRIO
+#define TASK_PROV_PRIO          1
+#endif
+#ifndef TASK_PROV_CORE
+#define TASK_PROV_CORE          0
+#endif
+
+#ifndef TASK_FS_WORKER_STACK
+#define TASK_FS_WORKER_STACK    6144    // the file manager page is built on it
+#endif
+#ifndef TASK_FS_WORKER_PRIO
+#define TASK_FS_WORKER_PRIO     1       // below async_tcp, which only waits for it
+#endif
+#ifndef TASK_FS_WORKER_CORE
+#define TASK_FS_WORKER_CORE     TASK_CORE_ANY
+#endif
+
+#ifndef TASK_LED_TEST_STACK
+#define TASK_LED_TEST_STACK     10000
+#endif
+#ifndef TASK_LED_TEST_PRIO
+#define TASK_LED_TEST_PRIO      3
+#endif
+#ifndef TASK_LED_TEST_CORE
+#define TASK_LED_TEST_CORE      1
+#endif
+
+enum tTaskId
+{
+    tkBootJob,
+    tkRadio,
+    tkUplink,
+    tkGameScreen,
+    tkVal,
+    tkAudio,
+    tkSfx,
+    tkSerial,
+    tkButton,
+    tkTelemetry,
+    tkLogDrain,
+    tkLvgl,
+    tkBattery,
+    tkAccel,
+    tkPsramPrefetch,
+    tkAssetSync,
+    tkOtaStage,
+    tkPrefetch,
+    tkSyncWriter,
+    tkSyncReader,
+    tkMemMon,
+    tkWifiRoam,
+    tkPinger,
+    tkProv,
+    tkFsWorker,
+    tkLedTest,
+    TASK_ID_COUNT
+};
+
+struct tTaskSpec
+{
+    const char  *name;
+    uint32_t     stack;
+    UBaseType_t  priority;
+    BaseType_t   core;          // TASK_CORE_ANY: unpinned
+};
+
+const tTaskSpec &taskSpec(tTaskId id);
+
+// Creates the task as its entry says, name NULL for the entry's own. Tasks
+// started more than once (boot jobs) may pass theirs
+bool taskStart(tTaskId id, TaskFunction_t fn, void *param = NULL, TaskHandle_t *handle = NULL, const char *name = NULL);
+
+void taskRegistryPrint(void);
+void taskRegistryWriteJson(tJsonWriter &json);  // "tasks":[...] member of an open object
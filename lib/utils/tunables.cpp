@@ -0,0 +1,142 @@
+#include "tunables.h"
+
+static const tTunableDef tunableDefs[TUNABLE_COUNT] =
+{
+    {"beacon_ms",   ttInt,  20,  1000,  BEACON_INTERVAL_MS,   NULL},
+    {"rssi_filter", ttEnum, 0,   4,     0,                    "role,none,ema,median,kalman"},
+    {"screen_fps",  ttInt,  1,   30,    TUNE_DEF_SCREEN_FPS,  NULL},
+    {"game_api_ms", ttInt,  200, 10000, TUNE_DEF_GAME_API_MS, NULL},
+};
+
+volatile int32_t tunableValues[TUNABLE_COUNT] =
+{
+    BEACON_INTERVAL_MS, 0, TUNE_DEF_SCREEN_FPS, TUNE_DEF_GAME_API_MS
+};
+
+static volatile uint32_t tunedGen = 0;
+static char setName[TUNABLE_SET_NAME_LEN + 1] = "";
+static portMUX_TYPE tuneMux = portMUX_INITIALIZER_UNLOCKED;
+
+uint32_t tunablesGen(void)
+{
+    return tunedGen;
+}
+
+const char *tunablesSetName(void)
+{
+    return setName;
+}
+
+const tTunableDef &tunableDef(tTunableId id)
+{
+    return tunableDefs[id];
+}
+
+static int findTunable(const char *name)
+{
+    for (int i = 0; i < TUNABLE_COUNT; i++)
+    {
+        if (strcmp(tunableDefs[i].name, name) == 0)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static int32_t enumIndex(const char *names, const char *value)
+{
+    size_t len = strlen(value);
+    int32_t index = 0;
+    for (const char *p = names; *p; index++)
+    {
+        const char *end = strchr(p, ',');
+        size_t n = end ? (size_t)(end - p) : strlen(p);
+        if ((n == len) && (strncmp(p, value, n) == 0))
+        {
+            return index;
+        }
+        if (end == NULL)
+        {
+            break;
+        }
+        p = end + 1;
+    }
+    return -1;
+}
+
+static void storeValue(int id, int32_t value)
+{
+    const tTunableDef &def = tunableDefs[id];
+    portENTER_CRITICAL(&tuneMux);
+    tunableValues[id] = constrain(value, def.minValue, def.maxValue);
+    tunedGen++;
+    portEXIT_CRITICAL(&tuneMux);
+}
+
+bool tunableSet(const char *name, JsonVariantConst value)
+{
+    int id = (name != NULL) ? findTunable(name) : -1;
+    if (id < 0)
+    {
+        Serial.printf("*** tunableSet WARNING! unknown tunable [%s]\r\n", name ? name : "");
+        return false;
+    }
+    const tTunableDef &def = tunableDefs[id];
+    int32_t v;
+    if ((def.type == ttBool) && value.is<bool>())
+    {
+        v = value.as<bool>() ? 1 : 0;
+    }
+    else if ((def.type == ttEnum) && value.is<const char *>())
+    {
+        v = enumIndex(def.names, value.as<const char *>());
+        if (v < 0)
+        {
+            Serial.printf("*** tunableSet WARNING! [%s] is not one of %s\r\n", value.as<const char *>(), def.names);
+            return false;
+        }
+    }
+    else if (value.is<int32_t>())
+    {
+        v = value.as<int32_t>();
+    }
+    else
+    {
+        Serial.printf("*** tunableSet WARNING! [%s] has a value of the wrong type\r\n", name);
+        return false;
+    }
+    storeValue(id, v);
+    return true;
+}
+
+void tunablesApply(JsonVariantConst set)
+{
+    const char *name = set["set"] | "";
+    for (int i = 0; i < TUNABLE_COUNT; i++)
+    {
+        storeValue(i, tunableDefs[i].defValue);
+    }
+    int applied = 0;
+    for (JsonPairConst kv : set["values"].as<JsonObjectConst>())
+    {
+        if (tunableSet(kv.key().c_str(), kv.value()))
+        {
+            applied++;
+        }
+    }
+    strlcpy(setName, name, sizeof(setName));
+    Serial.printf(">>> tunablesApply: set [%s], %d values\r\n", setName, applied);
+}
+
+void tunablesPrint(void)
+{
+    Serial.printf(">>>>>>>>>>>>>>> TUNABLES [%s] <<<<<<<<<<<<<<<<<<<\r\n", setName);
+    for (int i = 0; i < TUNABLE_COUNT; i++)
+    {
+        const tTunableDef &def = tunableDefs[i];
+        Serial.printf("%-12s %ld (default %ld, %ld..%ld)%s%s\r\n", def.name, (long)tunableValues[i], (long)def.defValue,
+                      (long)def.minValue, (long)def.maxValue, def.names ? " " : "", def.names ? def.names : "");
+    }
+    Serial.println("===============================================");
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// Runtime tunables: named, typed and bounded parameters the server can set
+// per device cohort with the status reply, so a tuning experiment needs no
+// reflash. A set is applied whole, what it leaves out goes back to its
+// default, and the set name rides along with the status report to split the
+// telemetry by. tunable() is one load from a table; a module that derives
+// state from a value compares tunablesGen() to the generation it last saw.
+
+#ifndef BEACON_INTERVAL_MS
+#define BEACON_INTERVAL_MS      50
+#endif
+#define TUNE_DEF_SCREEN_FPS     15      // display task frame cap, states in between are dropped
+#define TUNE_DEF_GAME_API_MS    1000    // game loop poll on the shared uplink
+#define TUNABLE_SET_NAME_LEN    15
+
+enum tTunableType
+{
+    ttInt,
+    ttBool,
+    ttEnum              // an index into the names list, set by name or by index
+};
+
+enum tTunableId
+{
+    tuBeaconMs = 0,     // radio: beacon interval before density and power scaling
+    tuRssiFilter,       // game: "role" keeps the role JSON's rssiFilter
+    tuScreenFps,        // display
+    tuGameApiMs,        // uplink: game API poll, the server's next_poll_ms still wins
+    TUNABLE_COUNT
+};
+
+struct tTunableDef
+{
+    const char   *name;
+    tTunableType  type;
+    int32_t       minValue;
+    int32_t       maxValue;
+    int32_t       defValue;
+    const char   *names;    // ttEnum: comma separated
+};
+
+extern volatile int32_t tunableValues[TUNABLE_COUNT];
+
+inline int32_t tunable(tTunableId id)
+{
+    return tunableValues[id];
+}
+
+uint32_t tunablesGen(void);
+const char *tunablesSetName(void);      // "" while on the defaults
+const tTunableDef &tunableDef(tTunableId id);
+
+// Clamped to the bounds, false for an unknown name or a value of the wrong type
+bool tunableSet(const char *name, JsonVariantConst value);
+// {"set": name, "values": {name: value, ...}} from the server, NULL or an
+// empty set restores the defaults
+void tunablesApply(JsonVariantConst set);
+void tunablesPrint(void);
@@ -1,8 +1,65 @@
 #include "valPlayer.h"
-Adafruit_NeoPixel neoPixels(VAL_PIXELS_NUM, PIN_LED_MATRIX, NEO_GRB + NEO_KHZ800);
+#include <new>
+#include "esp_heap_caps.h"
+#include "soc/soc_memory_layout.h"
+#include "jsonAlloc.h"
+#include "memMonitor.h"
+#include "taskRegistry.h"
+#include "deviceClass.h"
 static SemaphoreHandle_t statusMutex;
+static QueueHandle_t valCmdQ = NULL;       // tValCmd, only the latest one counts
+static QueueHandle_t valLayerQ = NULL;     // tValLayerCmd, each one in turn
+static QueueSetHandle_t valCmdSet = NULL;  // valTask waits on both
+static uint64_t (*valClock)(void) = NULL;  // valPlayPatternAt() times, millis() when not set
+static uint8_t valPrevId = VAL_PATTERN_NONE;
+static SemaphoreHandle_t packMutex = NULL;              // the pattern tables, against a swap by valTask
+static SemaphoreHandle_t reloadMutex = NULL;            // one valReload() at a time
+static volatile bool valStagedReady = false;
+static volatile uint16_t valGeneration = 0;
+
+static inline uint64_t valNowMs(void)
+{
+    return (valClock != NULL) ? valClock() : millis();
+}
+
+struct tValCmd
+{
+    int16_t  idx;
+    uint64_t atMs;          // 0: now
+};
+
+struct tValLayerCmd
+{
+    uint8_t  layer;
+    uint8_t  id;            // VAL_PATTERN_NONE: stop
+    uint16_t forMs;
+};
+
+static const uint8_t valLayerDuck[VAL_LAYERS] = {100, VAL_DUCK_OVERLAY_PCT, VAL_DUCK_SYSTEM_PCT};
+
+static_assert(sizeof(tValBinHeader) == 24, "val.bin header layout");
+static_assert(sizeof(tValBinPattern) == 68, "val.bin pattern record layout");
+static_assert(sizeof(tLedStrip) == 28, "val.bin strip record layout");
 static tValStatus valStatus;
 static tValPlayer valPlayer;
+static tValPlayer valStaged;        // parsed by valReload(), taken over by valTask
+
+// Other tasks read the tables under it, before valPlayerInit() nothing swaps them
+static void packLock(void)
+{
+    if (packMutex != NULL)
+    {
+        xSemaphoreTake(packMutex, portMAX_DELAY);
+    }
+}
+
+static void packUnlock(void)
+{
+    if (packMutex != NULL)
+    {
+        xSemaphoreGive(packMutex);
+    }
+}
 
 tValStatus *valTakeStatus(void)
 {
@@ -35,101 +92,389 @@ bool valGetStatus(tValStatus *newStat)
     return false;
 }
 
-void tValPlayer::updateCurrPattern(void)
+// Runs in valTask only, the status is written under the mutex when it changes
+void tValPlayer::applyCommand(int16_t cmdIdx)
 {
-    tValStatus *statusPtr = valTakeStatus();
-    String nameToPlay = "";
-    if (statusPtr != NULL)
-    {       
-        String newPatternS = statusPtr->patternName;     
-        if ((newPatternS != "") && (newPatternS != VAL_PLAYING_NAME))                
-        {   
-            if (newPatternS == VAL_NEXT_NAME)
-            {
-                if (patternsCount)
-                {
-                    patternIdx++;
-                    if (patternIdx >= patternsCount)
-                        patternIdx = 0;                    
-                    setPatternByIdx(patternIdx);
-                }
-            }
-            else
-            {
-                setPatternByName(statusPtr->patternName);
-            }                    
-        
-            if (currPattern != NULL)
+    if (cmdIdx == VAL_CMD_NEXT)
+    {
+        if (patternsCount)
+        {
+            patternIdx++;
+            if (patternIdx >= patternsCount)
+                patternIdx = 0;                    
+            setPatternByIdx(patternIdx);
+        }
+    }
+    else if (cmdIdx >= 0)
+    {
+        patternIdx = cmdIdx;
+        setPatternByIdx(cmdIdx);
+    }
+    else
+    {
+        // the current pattern goes on, the caller sees the error in the status
+        Serial.println("!!! tValPlayer::applyCommand ERROR: can't find pattern!!!");
+        tValStatus *statusPtr = valTakeStatus();
+        if (statusPtr != NULL)
+        {
+            statusPtr->error = true;
+            valGiveStatus();
+        }
+        return;
+    }
+
+    if (currPattern != NULL)
+    {
+        // a pattern plays on one layer at a time
+        for (int l = vlOverlay; l < VAL_LAYERS; l++)
+        {
+            if (overlays[l] == currPattern)
             {
-                statusPtr->error = false;
-                statusPtr->isPlaying = true;
-                statusPtr->nowPlayingName = currPattern->name;
-                statusPtr->nowPlayingIdx = patternIdx;
-                currPattern->start();
-                Serial.printf(">>> New pattern playing: %s\r\n", currPattern->name);
+                stopOverlay(l);
             }
-            else
+        }
+        currPattern->start(strips, frames[vlBase], true);
+        showFrame();
+        Serial.printf(">>> New pattern playing: %s\r\n", currPattern->name);
+    }
+    publishStatus();
+}
+
+// valTask only: the layer's pattern starts over the others, the base goes on
+void tValPlayer::applyOverlay(uint8_t layer, uint8_t id, uint16_t forMs)
+{
+    if ((layer <= vlBase) || (layer >= VAL_LAYERS))
+    {
+        return;
+    }
+    if (id == VAL_PATTERN_NONE)
+    {
+        if (overlays[layer] != NULL)
+        {
+            stopOverlay(layer);
+            showFrame();
+        }
+        return;
+    }
+    if (id >= patternsCount)
+    {
+        Serial.println("!!! tValPlayer::applyOverlay ERROR: can't find pattern!!!");
+        return;
+    }
+    tLedPattern *pattern = &patterns[id];
+    for (int l = vlBase; l < VAL_LAYERS; l++)
+    {
+        tLedPattern *other = (l == vlBase) ? currPattern : overlays[l];
+        if ((l != layer) && (other == pattern))
+        {
+            Serial.printf("*** tValPlayer::applyOverlay WARNING! <%s> already plays on layer %d\r\n", pattern->name, l);
+            return;
+        }
+    }
+    overlays[layer] = pattern;
+    overlayUntilMs[layer] = forMs ? max(millis() + forMs, 1UL) : 0;
+    pattern->start(strips, frames[layer], false);
+    updateDuck();
+    showFrame();
+}
+
+void tValPlayer::stopOverlay(uint8_t layer)
+{
+    if (overlays[layer] != NULL)
+    {
+        overlays[layer]->isPlaying = false;
+        overlays[layer] = NULL;
+    }
+    overlayUntilMs[layer] = 0;
+    updateDuck();
+}
+
+// The quietest layer taken sets the track volume
+void tValPlayer::updateDuck(void)
+{
+    uint8_t pct = 100;
+    for (int l = vlOverlay; l < VAL_LAYERS; l++)
+    {
+        if ((overlays[l] != NULL) && (valLayerDuck[l] < pct))
+        {
+            pct = valLayerDuck[l];
+        }
+    }
+    if (pct != duckPct)
+    {
+        duckPct = pct;
+        audioDuck(pct);
+    }
+}
+
+// Bottom up: an overlay pixel that is black shows what is under it, the
+// system layer covers all; the motor runs at the strongest level asked
+void tValPlayer::showFrame(void)
+{
+    // the base frame holds what was shown last even with no pattern
+    tLedFrame out = frames[vlBase];
+    for (int l = vlOverlay; l < VAL_LAYERS; l++)
+    {
+        if (overlays[l] == NULL)
+        {
+            continue;
+        }
+        const tLedFrame &frame = frames[l];
+        for (int i = 0; i < VAL_PIXELS_NUM; i++)
+        {
+            const tLedPixel &px = frame.pixels[i];
+            if ((l == vlSystem) || px.r || px.g || px.b)
             {
-                statusPtr->error = true;
-                statusPtr->isPlaying = false;  
-                statusPtr->nowPlayingName = "ERROR";  
-                statusPtr->nowPlayingIdx = -1;            
+                out.pixels[i] = px;
             }
         }
-        statusPtr->setPatternName(VAL_PLAYING_NAME);
-        valGiveStatus();
+        if (frame.vibro > out.vibro)
+        {
+            out.vibro = frame.vibro;
+        }
     }
+    for (int i = 0; i < VAL_PIXELS_NUM; i++)
+    {
+        ledOutSetPixel(i, out.pixels[i].r, out.pixels[i].g, out.pixels[i].b);
+    }
+    ledOutShow();
+    ledOutVibro(out.vibro);
 }
 
-void tValPlayer::updateIsPlaying(void)
+void tValPlayer::publishStatus(void)
 {
     tValStatus *statusPtr = valTakeStatus();
-    if (statusPtr != NULL)
+    if (statusPtr == NULL)
     {
-        if (currPattern == NULL)
+        return;
+    }
+    if (currPattern != NULL)
+    {
+        statusPtr->error = false;
+        statusPtr->isPlaying = currPattern->isPlaying;
+        statusPtr->nowPlayingName = currPattern->name;
+        statusPtr->nowPlayingIdx = patternIdx;
+    }
+    else
+    {
+        statusPtr->error = true;
+        statusPtr->isPlaying = false;  
+        statusPtr->nowPlayingName = "ERROR";  
+        statusPtr->nowPlayingIdx = -1;            
+    }
+    valGiveStatus();
+}
+
+// How long valTask may block on the command queue before the pattern needs it again
+TickType_t tValPlayer::ticksToNextStrip(void)
+{
+    TickType_t schedTicks = portMAX_DELAY;
+    if (scheduledIdx != VAL_CMD_UNKNOWN)
+    {
+        // the clock can be corrected while waiting, it is read again every VAL_SCHEDULE_CHECK_MS
+        int64_t toStartMs = (int64_t)(scheduledAtMs - valNowMs());
+        schedTicks = (toStartMs <= 0) ? 0 : pdMS_TO_TICKS(min(toStartMs, (int64_t)VAL_SCHEDULE_CHECK_MS));
+    }
+    if (retiredArena != NULL)
+    {
+        long toFreeMs = (long)(retiredMs + VAL_RELOAD_GRACE_MS - millis()) + 1;
+        schedTicks = min(schedTicks, (toFreeMs > 0) ? pdMS_TO_TICKS(toFreeMs) : (TickType_t)0);
+    }
+    bool timed = (currPattern != NULL) && currPattern->isPlaying;
+    long waitMs = timed ? currPattern->msToNext(strips) : 0;
+    for (int l = vlOverlay; l < VAL_LAYERS; l++)
+    {
+        if (overlays[l] == NULL)
         {
-            statusPtr->isPlaying = false;
+            continue;
         }
-        else
+        long layerMs = overlays[l]->msToNext(strips);
+        if (overlayUntilMs[l])
         {
-            statusPtr->isPlaying = currPattern->isPlaying;
+            layerMs = min(layerMs, (long)(overlayUntilMs[l] - millis()) + 1);
         }
-        valGiveStatus();     
+        waitMs = timed ? min(waitMs, layerMs) : layerMs;
+        timed = true;
     }
+    if (!timed)
+    {
+        return schedTicks;
+    }
+    TickType_t stripTicks = (waitMs > 0) ? pdMS_TO_TICKS(waitMs) : 0;
+    return min(stripTicks, schedTicks);
 }
 
+// The LEDs are written once for all the layers that moved on
 void tValPlayer::loopPlayer(void)
 {
+    bool changed = false;
     if (currPattern != NULL)
     {
-        currPattern->loopPlay();
+        changed = currPattern->loopPlay(strips, frames[vlBase], true);
+    }
+    for (int l = vlOverlay; l < VAL_LAYERS; l++)
+    {
+        tLedPattern *overlay = overlays[l];
+        if (overlay == NULL)
+        {
+            continue;
+        }
+        bool expired = overlayUntilMs[l] && ((long)(millis() - overlayUntilMs[l]) >= 0);
+        // played once, its last strip has had its interval
+        bool ended = !overlay->isPlaying && (millis() > overlay->nextStripMs);
+        if (expired || ended)
+        {
+            stopOverlay(l);
+            changed = true;
+        }
+        else if (overlay->loopPlay(strips, frames[l], false))
+        {
+            changed = true;
+        }
+    }
+    if (changed)
+    {
+        showFrame();
     }
 }
 
 void tValPlayer::valTask(void* valPlr)
 {
     tValPlayer *valPlayer = (tValPlayer *) valPlr;       
+    tValCmd cmd;
+    tValLayerCmd layerCmd;
 
     while(true)
     {    
-        valPlayer->updateCurrPattern();
+        // a member of the set is read only once the set has handed it out
+        QueueSetMemberHandle_t ready = xQueueSelectFromSet(valCmdSet, valPlayer->ticksToNextStrip());
+        if ((ready == valLayerQ) && (xQueueReceive(valLayerQ, &layerCmd, 0) == pdTRUE))
+        {
+            valPlayer->applyOverlay(layerCmd.layer, layerCmd.id, layerCmd.forMs);
+        }
+        else if ((ready == valCmdQ) && (xQueueReceive(valCmdQ, &cmd, 0) == pdTRUE))
+        {
+            if (cmd.idx == VAL_CMD_RELOAD)
+            {
+                // the swap below
+            }
+            else if (cmd.atMs == 0)
+            {
+                valPlayer->applyCommand(cmd.idx);
+            }
+            else
+            {
+                valPlayer->scheduledIdx = cmd.idx;
+                valPlayer->scheduledAtMs = cmd.atMs;
+            }
+        }
+        if (valStagedReady)
+        {
+            valPlayer->takePack(valStaged);
+        }
+        valPlayer->freeRetired(false);
+        if ((valPlayer->scheduledIdx != VAL_CMD_UNKNOWN) && ((int64_t)(valPlayer->scheduledAtMs - valNowMs()) <= 0))
+        {
+            Serial.printf(">>> valTask: scheduled start %lld ms late\r\n", (long long)(valNowMs() - valPlayer->scheduledAtMs));
+            valPlayer->applyCommand(valPlayer->scheduledIdx);
+            valPlayer->scheduledIdx = VAL_CMD_UNKNOWN;
+        }
+        bool wasPlaying = (valPlayer->currPattern != NULL) && valPlayer->currPattern->isPlaying;
         valPlayer->loopPlayer();
-        valPlayer->updateIsPlaying();
-        delay(VAL_TASK_DELAY_MS );
+        if (wasPlaying && !valPlayer->currPattern->isPlaying)
+        {
+            valPlayer->publishStatus();
+        }
     }
 }
 
 void tValPlayer::startTask(void)
 {
-    xTaskCreatePinnedToCore(
-    valTask,             /* Function to implement the task */
-    "valTask",           /* Name of the task */
-    10000,                  /* Stack size in words */
-    this,                  /* Task input parameter */
-    3, /* Priority of the task */
-    NULL,                  /* Task handle. */
-    1                      /* Core where the task should run */
-);
+    taskStart(tkVal, valTask, this);
+}
+
+// valTask only, between two strips: the tables of from replace these, the
+// patterns playing and scheduled are found again by name
+void tValPlayer::takePack(tValPlayer &from)
+{
+    char playing[VAL_PATTERN_NAME_SIZE] = "";
+    char scheduled[VAL_PATTERN_NAME_SIZE] = "";
+    bool wasPlaying = (currPattern != NULL) && currPattern->isPlaying;
+    if (currPattern != NULL)
+    {
+        strlcpy(playing, currPattern->name, sizeof(playing));
+    }
+    // transients point into the old tables, they are not carried over
+    bool hadOverlay = false;
+    for (int l = vlOverlay; l < VAL_LAYERS; l++)
+    {
+        hadOverlay = hadOverlay || (overlays[l] != NULL);
+        stopOverlay(l);
+    }
+    if (hadOverlay)
+    {
+        showFrame();
+    }
+    if (scheduledIdx >= 0)
+    {
+        strlcpy(scheduled, patterns[scheduledIdx].name, sizeof(scheduled));
+    }
+
+    // a pack replaced again within the grace goes at once
+    freeRetired(true);
+    packLock();
+    retiredArena = arena;
+    retiredMs = millis();
+    arena = from.arena;
+    patterns = from.patterns;
+    strips = from.strips;
+    byName = from.byName;
+    patternsCount = from.patternsCount;
+    stripsCount = from.stripsCount;
+    currPattern = NULL;
+    patternIdx = -1;
+    valPrevId = VAL_PATTERN_NONE;
+    valGeneration++;
+    packUnlock();
+    from.arena = NULL;
+    from.patterns = NULL;
+    from.strips = NULL;
+    from.byName = NULL;
+    from.patternsCount = 0;
+    from.stripsCount = 0;
+    valStagedReady = false;
+
+    if (scheduled[0])
+    {
+        uint8_t id = findPattern(scheduled);
+        scheduledIdx = (id != VAL_PATTERN_NONE) ? id : VAL_CMD_UNKNOWN;
+    }
+    uint8_t id = playing[0] ? findPattern(playing) : VAL_PATTERN_NONE;
+    Serial.printf(">>> tValPlayer::takePack: %u patterns, <%s> %s\r\n", patternsCount, playing,
+                  (id != VAL_PATTERN_NONE) ? "goes on" : "is gone");
+    if (id == VAL_PATTERN_NONE)
+    {
+        publishStatus();
+    }
+    else if (wasPlaying)
+    {
+        applyCommand(id);
+    }
+    else
+    {
+        patternIdx = id;
+        setPatternByIdx(id);
+        publishStatus();
+    }
+}
+
+void tValPlayer::freeRetired(bool force)
+{
+    if ((retiredArena != NULL) && (force || (millis() - retiredMs >= VAL_RELOAD_GRACE_MS)))
+    {
+        memTagFree(retiredArena);
+        retiredArena = NULL;
+    }
 }
 
 #include "valPlayer.h"
@@ -139,23 +484,56 @@ void tValPlayer::print(void)
     Serial.println(">>> LED PATTERNS:");
     for (int i = 0; i < patternsCount; i++)
     {
-        patterns[i]->print();
+        patterns[i].print(strips);
     }
     Serial.println("---------------------------");
 }
 
 void tValPlayer::setPatternByName(String patternName)
 {            
+    uint8_t idx = findPattern(patternName.c_str());
+    if (idx != VAL_PATTERN_NONE)
+    {
+        patternIdx = idx;
+        currPattern = &patterns[idx];
+        return;
+    }
+    Serial.printf("!!! tValPlayer::setPatternByName ERROR: can't find pattern!!!");         
+}
+
+// Sorted once after loading, the table does not change afterwards
+void tValPlayer::indexNames(void)
+{
     for (int i = 0; i < patternsCount; i++)
     {
-        patternIdx = i;
-        if (patternName == patterns[i]->name)
+        int j = i;
+        while ((j > 0) && (strcmp(patterns[byName[j - 1]].name, patterns[i].name) > 0))
         {
-            currPattern = patterns[i];
-            return;
+            byName[j] = byName[j - 1];
+            j--;
         }
-    }   
-    Serial.printf("!!! tValPlayer::setPatternByName ERROR: can't find pattern!!!");         
+        byName[j] = i;
+    }
+}
+
+uint8_t tValPlayer::findPattern(const char *patternName)
+{
+    int lo = 0;
+    int hi = patternsCount - 1;
+    while (lo <= hi)
+    {
+        int mid = (lo + hi) / 2;
+        int cmp = strcmp(patternName, patterns[byName[mid]].name);
+        if (cmp == 0)
+        {
+            return byName[mid];
+        }
+        if (cmp < 0)
+            hi = mid - 1;
+        else
+            lo = mid + 1;
+    }
+    return VAL_PATTERN_NONE;
 }
 
 void tValPlayer::setPatternByIdx(uint16_t idx)
@@ -166,58 +544,243 @@ void tValPlayer::setPatternByIdx(uint16_t idx)
     }
     else
     {
-        currPattern = patterns[idx];
+        currPattern = &patterns[idx];
     }
 }
 
-bool tValPlayer::loadFromJsonFile(void)
+// One block for the whole set: small ones stay in internal SRAM, where
+// playback reads them, bigger ones go to PSRAM
+bool tValPlayer::allocArena(uint16_t patternsNum, uint16_t stripsNum)
 {
-    JsonDocument doc;   
+    size_t patternsBytes = patternsNum * sizeof(tLedPattern);
+    size_t stripsBytes = stripsNum * sizeof(tLedStrip);
+    size_t bytes = patternsBytes + stripsBytes + patternsNum;
+    if (bytes <= VAL_ARENA_SRAM_MAX)
+    {
+        arena = (uint8_t *)memTagAlloc(mtVal, bytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    }
+    if (arena == NULL)
+    {
+        arena = (uint8_t *)memTagAlloc(mtVal, bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    }
+    if (arena == NULL)
+    {
+        Serial.printf("!!! tValPlayer::allocArena ERROR: no memory for %u bytes\r\n", bytes);
+        return false;
+    }
+    patterns = (tLedPattern *)arena;
+    strips = (tLedStrip *)(arena + patternsBytes);
+    byName = arena + patternsBytes + stripsBytes;
+    for (uint16_t i = 0; i < patternsNum; i++)
+    {
+        new (&patterns[i]) tLedPattern;
+    }
+    for (uint16_t i = 0; i < stripsNum; i++)
+    {
+        new (&strips[i]) tLedStrip;
+    }
+    Serial.printf(">>> tValPlayer::allocArena: %u patterns, %u strips in %u bytes of %s\r\n",
+                  patternsNum, stripsNum, bytes, esp_ptr_external_ram(arena) ? "PSRAM" : "SRAM");
+    return true;
+}
 
-    if (loaded)
-        return true;
-        
-    loaded = true;    
+void tValPlayer::freeArena(void)
+{
+    memTagFree(arena);
+    arena = NULL;
+    patterns = NULL;
+    strips = NULL;
+    byName = NULL;
+    patternsCount = 0;
+    stripsCount = 0;
+}
 
+// val.bin was compiled from val.json when the size and hash it records match
+static bool valBinIsCurrent(const tValBinHeader &hdr)
+{
     File f = PSRamFS.open(VAL_FILE_NAME, "r");
     if (!f)
     {
-        Serial.printf("tValPlayer::loadFromJsonFile: ERROR loading from <%s>\r\n", VAL_FILE_NAME);
-        valPlayError(ERR_VAL_LOAD);
+        return true;            // shipped without its source
+    }
+    bool current = false;
+    if (f.size() == hdr.jsonSize)
+    {
+        uint8_t buf[512];
+        uint32_t hash = 0;
+        int n;
+        while ((n = f.read(buf, sizeof(buf))) > 0)
+        {
+            for (int i = 0; i < n; i++)
+            {
+                hash = hash * 31 + buf[i];
+            }
+        }
+        current = (hash == hdr.jsonHash);
+    }
+    f.close();
+    return current;
+}
+
+bool tValPlayer::loadFromBinFile(void)
+{
+    File f = PSRamFS.open(VAL_BIN_FILE_NAME, "r");
+    if (!f)
+    {
+        return false;
+    }
+    uint32_t startMs = millis();
+    tValBinHeader hdr;
+    bool ok = (f.read((uint8_t *)&hdr, sizeof(hdr)) == sizeof(hdr)) &&
+              !memcmp(hdr.magic, VAL_BIN_MAGIC, sizeof(hdr.magic)) && (hdr.version == VAL_BIN_VERSION) &&
+              (hdr.patternRecSize == sizeof(tValBinPattern)) && (hdr.stripRecSize == sizeof(tLedStrip)) &&
+              (hdr.patternsCount <= VAL_MAX_PATTERNS_NUM) &&
+              (f.size() == sizeof(hdr) + hdr.patternsCount * sizeof(tValBinPattern) + hdr.stripsCount * sizeof(tLedStrip));
+    if (!ok)
+    {
+        Serial.printf("*** tValPlayer::loadFromBinFile WARNING! <%s> is not a version %d pattern pack\r\n", VAL_BIN_FILE_NAME, VAL_BIN_VERSION);
+        f.close();
+        return false;
+    }
+    if (!valBinIsCurrent(hdr))
+    {
+        Serial.printf("*** tValPlayer::loadFromBinFile WARNING! <%s> is older than <%s>\r\n", VAL_BIN_FILE_NAME, VAL_FILE_NAME);
+        f.close();
+        return false;
+    }
+    if (!allocArena(hdr.patternsCount, hdr.stripsCount))
+    {
+        f.close();
+        return false;
+    }
+
+    for (uint16_t i = 0; (i < hdr.patternsCount) && ok; i++)
+    {
+        tValBinPattern rec;
+        ok = (f.read((uint8_t *)&rec, sizeof(rec)) == sizeof(rec)) &&
+             ((uint32_t)rec.firstStrip + rec.stripsCount <= hdr.stripsCount);
+        tLedPattern &p = patterns[i];
+        memcpy(p.name, rec.name, VAL_PATTERN_NAME_SIZE - 1);
+        memcpy(p.SoundFile, rec.soundFile, VAL_MP3_NAME_SIZE - 1);
+        p.firstStrip = rec.firstStrip;
+        p.stripsCount = rec.stripsCount;
+        p.SoundLevel = rec.soundLevel;
+        p.circular = rec.flags & VAL_BIN_CIRCULAR;
+        p.PlaySound = rec.flags & VAL_BIN_SOUND;
+    }
+    // the strip records are the in-memory ones, one read
+    size_t stripsBytes = hdr.stripsCount * sizeof(tLedStrip);
+    ok = ok && (f.read((uint8_t *)strips, stripsBytes) == stripsBytes);
+    f.close();
+    if (!ok)
+    {
+        Serial.printf("!!! tValPlayer::loadFromBinFile ERROR: <%s> is damaged\r\n", VAL_BIN_FILE_NAME);
+        freeArena();
         return false;
     }
+    patternsCount = hdr.patternsCount;
+    stripsCount = hdr.stripsCount;
+    indexNames();
+    Serial.printf(">>> tValPlayer::loadFromBinFile: %u patterns in %lu ms\r\n", patternsCount, millis() - startMs);
+    return true;
+}
+
+// val.bin when it is current, val.json otherwise, into a new arena; ERR_VAL_OK or the error code
+uint8_t tValPlayer::loadPack(void)
+{
+    JsonDocument doc(jsonPsram(jdkVal));
+
+    if (loadFromBinFile())
+    {
+        return ERR_VAL_OK;
+    }
+
+    File f = PSRamFS.open(VAL_FILE_NAME, "r");
+    if (!f)
+    {
+        Serial.printf("tValPlayer::loadFromJsonFile: ERROR loading from <%s>\r\n", VAL_FILE_NAME);
+        return ERR_VAL_LOAD;
+    }
     
     DeserializationError error = deserializeJson(doc, f);
     if (error)
     {
         Serial.printf("JSON deserialize ERROR [%s]\r\n", error.c_str());
-        valPlayError(ERR_VAL_JSON);
         f.close();
-        return false;
+        return ERR_VAL_JSON;
     }
 
-    for (JsonObject pattern : doc["PlayPatterns"].as<JsonArray>()) 
-    {    
-        patterns[patternsCount] = new tLedPattern;
-        patterns[patternsCount]->loadFromJson(pattern);
-        patternsCount++;
+    f.close();
 
-        if (patternsCount >= VAL_MAX_PATTERNS_NUM)
+    // sizes first, the arena is allocated once
+    JsonArray patternsJson = doc["PlayPatterns"].as<JsonArray>();
+    uint16_t patternsNum = 0;
+    uint32_t stripsNum = 0;
+    for (JsonObject pattern : patternsJson) 
+    {    
+        if (patternsNum >= VAL_MAX_PATTERNS_NUM)
         {
             Serial.println("tValPlayer::loadFromJsonFile ERROR: too many patterns!!!");
             break;
         }
+        patternsNum++;
+        stripsNum += pattern["Strips"].as<JsonArray>().size();
+    }
+    if ((stripsNum > UINT16_MAX) || !allocArena(patternsNum, stripsNum))
+    {
+        return ERR_VAL_LOAD;
+    }
+
+    for (JsonObject pattern : patternsJson) 
+    {    
+        if (patternsCount >= patternsNum)
+        {
+            break;
+        }
+        patterns[patternsCount].loadFromJson(pattern, strips, stripsCount);
+        stripsCount += patterns[patternsCount].stripsCount;
+        patternsCount++;
     }   
-    f.close();
+    indexNames();
+    return ERR_VAL_OK;
+}
+
+bool tValPlayer::loadFromJsonFile(void)
+{
+    if (loaded)
+        return true;
+        
+    loaded = true;    
+
+    uint8_t err = loadPack();
+    if (err != ERR_VAL_OK)
+    {
+        valPlayError(err);
+        return false;
+    }
     return true;
 }
 
-bool valPlayerInit(void)
+bool valPlayerInit(tValAudioMode audioMode)
 {
     if (valPlayer.loadFromJsonFile())
     {
         valPlayer.print();
+        ledOutInit();
+        audioSetMode(audioMode);
+        if (devClass.audio && (audioMode == vaEager))
+        {
+            audioTaskStart();
+            sfxBankLoad();
+        }
         statusMutex = xSemaphoreCreateMutex(); 
+        packMutex = xSemaphoreCreateMutex();
+        reloadMutex = xSemaphoreCreateMutex();
+        valCmdQ = xQueueCreate(1, sizeof(tValCmd));
+        valLayerQ = xQueueCreate(VAL_LAYER_Q_LEN, sizeof(tValLayerCmd));
+        valCmdSet = xQueueCreateSet(1 + VAL_LAYER_Q_LEN);
+        xQueueAddToSet(valCmdQ, valCmdSet);
+        xQueueAddToSet(valLayerQ, valCmdSet);
         valPlayer.startTask();
         return true;
     }
@@ -225,36 +788,152 @@ bool valPlayerInit(void)
     return false;
 }
 
-bool valPlayNext(void)
+static bool valPostCommand(int16_t cmdIdx, uint64_t atMs = 0)
 {
-    String resS = "";
-    tValStatus *valStatus = valTakeStatus();
-    if (valStatus == NULL)
+    if (valCmdQ == NULL)
     {
-        Serial.println("!!! valPlayNext ERROR. Can't get mutex");
+        Serial.println("!!! valPostCommand ERROR: the player is not started");
         return false;
     }
-    valStatus->setPatternName(VAL_NEXT_NAME);
-    valGiveStatus();
+    tValCmd cmd = {cmdIdx, atMs};
+    xQueueOverwrite(valCmdQ, &cmd);
     return true;
 }
 
-bool valPlayPattern(String patternName)
+bool valPlayNext(void)
+{
+    return valPostCommand(VAL_CMD_NEXT);
+}
+
+uint8_t valPatternId(const char *patternName)
+{
+    packLock();
+    uint8_t id = valPlayer.findPattern(patternName);
+    packUnlock();
+    return id;
+}
+
+const char *valPatternSound(uint8_t id)
+{
+    const char *sound = NULL;
+    packLock();
+    if ((id != VAL_PATTERN_NONE) && (id < valPlayer.patternsCount))
+    {
+        const tLedPattern &p = valPlayer.patterns[id];
+        sound = (p.PlaySound && (p.SoundFile[0] == '/')) ? p.SoundFile : NULL;
+    }
+    packUnlock();
+    return sound;
+}
+
+bool valReload(void)
+{
+    if (valCmdQ == NULL)
+    {
+        Serial.println("!!! valReload ERROR: the player is not started");
+        return false;
+    }
+    if (xSemaphoreTake(reloadMutex, 0) != pdTRUE)
+    {
+        Serial.println("*** valReload WARNING! a reload is already running");
+        return false;
+    }
+    if (valStagedReady)
+    {
+        Serial.println("*** valReload WARNING! the last pack is still waiting for valTask");
+        xSemaphoreGive(reloadMutex);
+        return false;
+    }
+    uint32_t startMs = millis();
+    uint8_t err = valStaged.loadPack();
+    bool ok = (err == ERR_VAL_OK);
+    if (ok)
+    {
+        valStagedReady = true;
+        // a command already queued wakes valTask just as well
+        tValCmd cmd = {VAL_CMD_RELOAD, 0};
+        xQueueSend(valCmdQ, &cmd, 0);
+        Serial.printf(">>> valReload: %u patterns parsed in %lu ms\r\n", valStaged.patternsCount, millis() - startMs);
+    }
+    else
+    {
+        Serial.printf("!!! valReload ERROR: %u, the patterns playing stay\r\n", err);
+    }
+    xSemaphoreGive(reloadMutex);
+    return ok;
+}
+
+uint16_t valPackGeneration(void)
 {
-    static String prevPatternName = "";
-    String resS = "";
-    if (patternName == prevPatternName)
+    return valGeneration;
+}
+
+bool valPlayPatternId(uint8_t id)
+{
+    if (id == VAL_PATTERN_NONE)
+    {
+        return valPostCommand(VAL_CMD_UNKNOWN);
+    }
+    if (id == valPrevId)
     {
         return true;
     }
-    prevPatternName = patternName;
-    tValStatus *valStatus = valTakeStatus();
-    if (valStatus == NULL)
+    valPrevId = id;
+    return valPostCommand(id);
+}
+
+void valSetClock(uint64_t (*nowMs)(void))
+{
+    valClock = nowMs;
+}
+
+// The scheduled pattern replaces whatever plays then, the next
+// valPlayPatternId() goes through even for the pattern played before
+bool valPlayPatternAt(uint8_t id, uint64_t epochMs)
+{
+    if (id == VAL_PATTERN_NONE)
     {
-        Serial.println("!!! valPlayPattern ERROR. Can't get mutex");
         return false;
     }
-    valStatus->setPatternName(patternName);
-    valGiveStatus();
+    valPrevId = VAL_PATTERN_NONE;
+    return valPostCommand(id, max(epochMs, (uint64_t)1));
+}
+
+static bool valPostLayer(tValLayer layer, uint8_t id, uint16_t forMs)
+{
+    if (valLayerQ == NULL)
+    {
+        Serial.println("!!! valPostLayer ERROR: the player is not started");
+        return false;
+    }
+    if ((layer <= vlBase) || (layer >= VAL_LAYERS))
+    {
+        return false;
+    }
+    tValLayerCmd cmd = {(uint8_t)layer, id, forMs};
+    if (xQueueSend(valLayerQ, &cmd, 0) != pdTRUE)
+    {
+        Serial.println("*** valPostLayer WARNING! the layer queue is full");
+        return false;
+    }
     return true;
-}
\ No newline at end of file
+}
+
+bool valPlayOverlayId(uint8_t id, tValLayer layer, uint16_t forMs)
+{
+    if (id == VAL_PATTERN_NONE)
+    {
+        return false;
+    }
+    return valPostLayer(layer, id, forMs);
+}
+
+bool valStopOverlay(tValLayer layer)
+{
+    return valPostLayer(layer, VAL_PATTERN_NONE, 0);
+}
+
+bool valPlayPattern(String patternName)
+{
+    return valPlayPatternId(valPatternId(patternName.c_str()));
+}
@@ -1,7 +1,6 @@
 #pragma once
 
 #include <Arduino.h>
-#include <Adafruit_NeoPixel.h>
 #include "PSRamFS.h"
 #include <ArduinoJson.h>
 #include "xErrCodes.h"
@@ -9,12 +8,67 @@
 #define VAL_PIXELS_NUM          8
 #define VAL_PATTERN_NAME_SIZE   30
 #define VAL_MP3_NAME_SIZE       30
-#define VAL_MAX_STRIPS_NUM      30
-#define VAL_MAX_PATTERNS_NUM    30
+#define VAL_MAX_PATTERNS_NUM    254     // pattern IDs are uint8_t, VAL_PATTERN_NONE excluded
+#define VAL_ARENA_SRAM_MAX      (16 * 1024)    // bigger pattern sets are packed in PSRAM
 #define VAL_FILE_NAME           "/val.json"
-#define VAL_TASK_DELAY_MS       10
-#define VAL_PLAYING_NAME        "$$$$PLAY$$$"
-#define VAL_NEXT_NAME           "$$$$NEXT$$$$"
+#define VAL_BIN_FILE_NAME       "/val.bin"     // val.json compiled by val_editor.py, loaded when current
+#define VAL_BIN_MAGIC           "VALB"
+#define VAL_BIN_VERSION         2       // 2: vibro is a level, the strip pad byte is the ease
+#define VAL_LED_RMT_CHANNEL     RMT_CHANNEL_0
+#define VAL_LED_RMT_CLK_DIV     2
+#define VAL_LED_TX_WAIT_MS      5       // a frame of 8 pixels is out in ~0.3 ms
+#define VAL_VIBRO_LEDC_CHANNEL  4
+#define VAL_VIBRO_PWM_HZ        20000   // above hearing, the motor integrates it
+#define VAL_FADE_FRAME_MS       20      // output period while a strip fades into the next one
+#define VAL_AUDIO_BUF_SIZE      (48 * 1024)    // decoder input in PSRAM, ~3 s of the 128 kbps clips read from PSRamFS
+#define VAL_AUDIO_FEED_MS       5       // audioTask period, the decoder input is topped up from PSRamFS
+#define VAL_AUDIO_DMA_BUF_COUNT 8       // I2S ring of 8 x 512 frames, ~93 ms at 44.1 kHz
+#define VAL_AUDIO_DMA_BUF_LEN   512
+#ifndef VAL_AUDIO_DECODE_CORE
+#define VAL_AUDIO_DECODE_CORE   0       // the library's decode and I2S write task
+#endif
+#define VAL_SFX_VOICES          2       // effects heard at once, a third trigger takes the oldest voice
+#define VAL_SFX_GAIN            256     // 8.8 fixed point on top of the track, which has its volume applied
+#define VAL_SFX_CHUNK_FRAMES    256     // standalone I2S write, ~6 ms at 44.1 kHz
+#define VAL_SFX_DEFAULT_RATE    44100   // the I2S rate before any track has set one
+#define VAL_SFX_MAX_FRAMES      0xFFFF  // ~1.5 s at 44.1 kHz, longer clips are cut
+
+// Sound effects, 16-bit PCM WAV files decoded to PSRAM by sfxBankLoad()
+enum tSfxId
+{
+    sfxHit = 0,     // /sfx_hit.wav
+    sfxHeal,        // /sfx_heal.wav
+    sfxRole,        // /sfx_role.wav
+    sfxCount
+};
+
+// How a strip moves on to the next one over its intervalMs
+enum tLedEase
+{
+    leStep = 0,     // holds, the next strip replaces it
+    leLinear,
+    leSmooth        // smoothstep, slow at both ends
+};
+#define VAL_CMD_NEXT            -2      // command index: the pattern after the current one
+#define VAL_CMD_UNKNOWN         -1      // command index: a name not in val.json
+#define VAL_CMD_RELOAD          -3      // command index: wakes valTask for the pack valReload() staged
+#define VAL_RELOAD_GRACE_MS     1000    // a replaced pack is freed this long after the swap
+#define VAL_SCHEDULE_CHECK_MS   50      // longest wait before a scheduled start reads the clock again
+#define VAL_PATTERN_NONE        0xFF    // pattern ID of a name not in val.json
+#define VAL_LAYER_Q_LEN         4       // overlay starts and stops waiting for valTask
+#define VAL_DUCK_OVERLAY_PCT    50      // track volume while a vlOverlay pattern plays
+#define VAL_DUCK_SYSTEM_PCT     20      // track volume while a vlSystem pattern plays
+
+// Patterns are composited per LED frame from the bottom up. The base one owns
+// the track, an overlay plays over it without restarting it: its black pixels
+// let the base through, its sound is the effect of the bank it names.
+enum tValLayer
+{
+    vlBase = 0,     // valPlayPatternId(), loops or holds its last strip
+    vlOverlay,      // transients such as a hit flash
+    vlSystem,       // errors and system states, opaque
+    VAL_LAYERS
+};
 
 struct tLedPixel
 {
@@ -26,50 +80,118 @@ struct tLedPixel
     void play(uint8_t pxNum);
 };
 
+// One layer's output before the layers are composited
+struct tLedFrame
+{
+    tLedPixel pixels[VAL_PIXELS_NUM];
+    uint8_t   vibro = 0;
+};
+
+// val.bin layout, little endian:
+// header, then patternsCount tValBinPattern, then stripsCount tLedStrip as they are in memory
+struct tValBinHeader
+{
+    char     magic[4];
+    uint16_t version;
+    uint16_t patternsCount;
+    uint16_t stripsCount;
+    uint8_t  patternRecSize;
+    uint8_t  stripRecSize;
+    uint32_t jsonSize;          // of the val.json it was compiled from,
+    uint32_t jsonHash;          // rolling h * 31 + byte over the file
+    uint32_t reserved;
+};
+
+struct tValBinPattern
+{
+    char     name[VAL_PATTERN_NAME_SIZE];
+    char     soundFile[VAL_MP3_NAME_SIZE];
+    uint16_t firstStrip;
+    uint16_t stripsCount;
+    uint8_t  soundLevel;
+    uint8_t  flags;             // VAL_BIN_CIRCULAR, VAL_BIN_SOUND
+    uint8_t  pad[2];
+};
+#define VAL_BIN_CIRCULAR        0x01
+#define VAL_BIN_SOUND           0x02
+
 struct tLedStrip
 {       
     tLedPixel pixels[VAL_PIXELS_NUM];
-    uint16_t  intervalMs;
-    bool vibro;
+    uint16_t  intervalMs = 0;
+    uint8_t   vibro = 0;        // PWM level, JSON 1 stays full on
+    uint8_t   ease = leStep;    // tLedEase
     void print(void);
-    unsigned long play(void);
+    unsigned long render(tLedFrame &frame) const;
+    void blend(const tLedStrip &to, uint16_t progress256, tLedFrame &frame) const;
     void loadFromJson(JsonArray strip);
 };  
 
 struct tLedPattern
 {
     char name[VAL_PATTERN_NAME_SIZE] = "";
-    tLedStrip *strips[VAL_MAX_STRIPS_NUM];
+    uint16_t firstStrip = 0;    // in the player's strip arena
     uint16_t stripsCount = 0;
     bool circular = false;
     unsigned long nextStripMs = 0;
+    unsigned long stripStartMs = 0;
     uint16_t stripIdx = 0;
+    uint16_t curStrip = 0;      // the one on the LEDs, stripIdx is the next one
     bool PlaySound = false;
     char SoundFile[VAL_MP3_NAME_SIZE] = "";
     uint8_t SoundLevel = 0;
     bool isPlaying = false;
-    void print(void);
-    void start(void);
-    void loopPlay(void);
-    void loadFromJson(JsonObject pattern);
+    void print(tLedStrip *strips);
+    // track: the pattern plays its sound on the decoder, an overlay as an effect
+    void start(tLedStrip *strips, tLedFrame &frame, bool track);
+    bool loopPlay(tLedStrip *strips, tLedFrame &frame, bool track);     // true when the frame changed
+    bool isFading(tLedStrip *strips);
+    long msToNext(tLedStrip *strips);
+    void loadFromJson(JsonObject pattern, tLedStrip *strips, uint16_t first);
 };
 
 struct tValPlayer
 {
     bool loaded = false;
-    tLedPattern *patterns[VAL_MAX_PATTERNS_NUM];
+    // patterns, their strips and the name index packed in one allocation
+    uint8_t *arena = NULL;
+    tLedPattern *patterns = NULL;
+    tLedStrip *strips = NULL;
+    uint8_t *byName = NULL;     // pattern indexes sorted by name
     uint16_t patternsCount = 0;  
+    uint16_t stripsCount = 0;
     tLedPattern *currPattern = NULL;  
     int16_t patternIdx = -1;
+    tLedPattern *overlays[VAL_LAYERS] = {};     // vlBase is currPattern
+    unsigned long overlayUntilMs[VAL_LAYERS] = {};  // 0: as long as the pattern lasts
+    tLedFrame frames[VAL_LAYERS];
+    uint8_t duckPct = 100;
+    int16_t scheduledIdx = VAL_CMD_UNKNOWN;     // valPlayPatternAt() waiting for its time
+    uint64_t scheduledAtMs = 0;
+    uint8_t *retiredArena = NULL;   // the pack valReload() replaced, freed after VAL_RELOAD_GRACE_MS
+    unsigned long retiredMs = 0;
     void print(void);
     //void init(void);
     static void valTask(void* valPlr);
     void setPatternByName(String patternName);
     void setPatternByIdx(uint16_t idx);
-    void updateCurrPattern(void);
-    void updateIsPlaying(void);
+    void indexNames(void);
+    uint8_t findPattern(const char *patternName);
+    void applyCommand(int16_t cmdIdx);
+    void applyOverlay(uint8_t layer, uint8_t id, uint16_t forMs);
+    void stopOverlay(uint8_t layer);
+    void updateDuck(void);
+    void showFrame(void);
+    void publishStatus(void);
+    TickType_t ticksToNextStrip(void);
     void loopPlayer(void);
+    bool allocArena(uint16_t patternsNum, uint16_t stripsNum);
+    void freeArena(void);
+    bool loadFromBinFile(void);
+    uint8_t loadPack(void);
     bool loadFromJsonFile(void);
+    void takePack(tValPlayer &from);
+    void freeRetired(bool force);
     void startTask(void);
 };
 
@@ -77,33 +199,82 @@ struct tValStatus
 {
     bool isPlaying = false;
     bool error = false;
-    String patternName = ""; 
     String nowPlayingName = "";
     int nowPlayingIdx = -1;      
-    inline void setPatternName(String s){patternName = s;}
     inline void set(tValStatus *st)
     {
-        isPlaying = st->isPlaying; error = st->error; patternName = st->patternName; nowPlayingName = st->nowPlayingName; nowPlayingIdx = st->nowPlayingIdx;
+        isPlaying = st->isPlaying; error = st->error; nowPlayingName = st->nowPlayingName; nowPlayingIdx = st->nowPlayingIdx;
     }
 };
 
 
-bool valPlayerInit(void);
+// How valPlayerInit() brings up the sound, picked per device role (src/boot.cpp)
+enum tValAudioMode
+{
+    vaNone = 0,     // never: tracks and effects are dropped
+    vaLazy,         // the audio task with the first track, the effect bank with the first effect
+    vaEager         // both at boot
+};
+
+bool valPlayerInit(tValAudioMode audioMode = vaEager);
 tValStatus *valTakeStatus(void);
 bool valGetStatus(tValStatus *newStat);
 void valGiveStatus(void);
 bool valPlayNext(void);
 bool valPlayPattern(String patternName);
+// Pattern names interned at load time: look the ID up once, play by ID
+uint8_t valPatternId(const char *patternName);
+bool valPlayPatternId(uint8_t id);
+// The track a pattern plays, NULL for none or an unknown ID; stays valid for
+// VAL_RELOAD_GRACE_MS after a reload
+const char *valPatternSound(uint8_t id);
+// val.json or val.bin changed in PSRamFS: parsed in the caller's task into a
+// fresh arena that valTask swaps in between two strips, the pattern playing
+// starts again from the new pack. The old one plays on when the files are bad.
+// Pattern IDs change, look them up again once valPackGeneration() moves on
+bool valReload(void);
+uint16_t valPackGeneration(void);
+// Scheduled start on the clock given to valSetClock(), for devices playing in sync
+void valSetClock(uint64_t (*nowMs)(void));
+bool valPlayPatternAt(uint8_t id, uint64_t epochMs);
+// Over the base pattern on its own timing, forMs 0 plays it once, a circular
+// one until valStopOverlay(); a newer one on the same layer replaces it.
+// The track is ducked while the layer is taken, a reload ends all overlays.
+bool valPlayOverlayId(uint8_t id, tValLayer layer = vlOverlay, uint16_t forMs = 0);
+bool valStopOverlay(tValLayer layer = vlOverlay);
 
-extern Adafruit_NeoPixel neoPixels;
+// LED strip output on a dedicated RMT channel, non-blocking and double buffered
+bool ledOutInit(void);
+void ledOutSetPixel(uint8_t idx, uint8_t r, uint8_t g, uint8_t b);
+void ledOutShow(void);
+void ledOutVibro(uint8_t level);        // LEDC duty, only written when it changes
 // extern tValPlayer valPlayer;
 
 //int i = sizeof(tValPlayer);
 
-void audioLoop(void);
-bool audioPlay(const char *fName, int volume);
+struct tAudioStats
+{
+    uint32_t underruns = 0;     // I2S ring ran dry while a track played
+    uint32_t lateFeeds = 0;     // audioTask periods over twice VAL_AUDIO_FEED_MS
+    uint32_t maxFeedGapMs = 0;
+    uint32_t restarts = 0;      // loops reopened because the decoder could not loop the file
+};
+
+void audioInit(void);
+void audioSetMode(tValAudioMode mode);
+bool audioOnDemand(void);           // vaLazy: the first use starts what it needs
+bool audioTaskStart(void);
+bool audioPlay(const char *fName, int volume, bool loop = false);     // queued to audioTask
 void audioStop(void);
+void audioDuck(uint8_t percent);    // of the track volume, applied by audioTask in a period
 bool audioIsRunning(void);
+uint32_t audioSampleRate(void);     // of the current or last track, 0 before the first one
+tAudioStats audioGetStats(void);
+
+bool sfxBankLoad(void);
+// Any task; in vaLazy the first effect decodes the bank in the caller's task
+bool sfxPlay(tSfxId id);            // mixed over the track, or played alone, within a DMA buffer
+bool sfxPlayFile(const char *fName);    // the effect of the bank loaded from fName, false for none
 
 void valPlayError(uint8_t errB);
 
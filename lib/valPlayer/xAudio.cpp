@@ -2,36 +2,303 @@
 
 #include "Arduino.h"
 #include "Audio.h"
+#include "driver/i2s.h"
+#include "serverSync.h"
+#include "energyProfile.h"
+#include "pmLocks.h"
+#include "taskRegistry.h"
+#include "deviceClass.h"
+
+// audio.loop() reads the file into the decoder's input buffer; it runs in
+// audioTask on its own period, the decoder and its I2S writes run in the
+// library's task. Play and stop requests are queued to audioTask, so the
+// callers never wait on the decoder
+
+enum tAudioOp
+{
+    aoPlay = 0,
+    aoStop
+};
+
+struct tAudioCmd
+{
+    uint8_t op;
+    bool loop;
+    int volume;
+    char file[VAL_MP3_NAME_SIZE];
+};
 
 static Audio audio;
+static bool audioReady = false;
+static int audioVolume = -1;            // the track's own, before ducking
+static int audioAppliedVolume = -1;
+static volatile uint8_t audioDuckPct = 100;
+static char audioFile[VAL_MP3_NAME_SIZE] = "";
+static bool audioLooping = false;
+static bool audioWantLoop = false;      // a loop the decoder could not take is restarted by audioTask
+static bool audioPmHeld = false;        // plAudio while a track plays
+static QueueHandle_t audioCmdQ = NULL;
+static tValAudioMode audioMode = vaEager;
+static QueueHandle_t audioI2sQ = NULL;
+static tAudioStats audioStats;
+
+// The library installs I2S with 16 x 512 frames of DMA, ~190 ms; it is
+// reinstalled with the same format and VAL_AUDIO_DMA_BUF_* before the pins are
+// set, with an event queue that reports the ring running dry
+static void audioI2sInstall(void)
+{
+    i2s_driver_uninstall(I2S_NUM_0);
+    i2s_config_t config = {};
+    config.mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_TX);
+    config.sample_rate = VAL_SFX_DEFAULT_RATE;
+    config.bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT;
+    config.channel_format = I2S_CHANNEL_FMT_RIGHT_LEFT;
+    config.communication_format = I2S_COMM_FORMAT_STAND_I2S;
+    config.intr_alloc_flags = ESP_INTR_FLAG_LEVEL1;
+    config.dma_buf_count = VAL_AUDIO_DMA_BUF_COUNT;
+    config.dma_buf_len = VAL_AUDIO_DMA_BUF_LEN;
+    config.use_apll = false;
+    config.tx_desc_auto_clear = true;
+    config.fixed_mclk = true;
+    config.mclk_multiple = I2S_MCLK_MULTIPLE_128;
+    if (i2s_driver_install(I2S_NUM_0, &config, 8, &audioI2sQ) != ESP_OK)
+    {
+        Serial.println("!!! audioInit ERROR: I2S driver install failed");
+        audioI2sQ = NULL;
+        return;
+    }
+    i2s_zero_dma_buffer(I2S_NUM_0);
+}
+
+// Pins and the input buffer are set once, the buffer cannot be resized after the first song
+void audioInit(void)
+{
+    if (!devClass.audio || audioReady)
+    {
+        return;
+    }
+    audioI2sInstall();
+    audio.setPinout(PIN_I2S_BCLK, PIN_I2S_LRC, PIN_I2S_DOUT);
+    audio.setBufsize(-1, VAL_AUDIO_BUF_SIZE);
+    audio.setAudioTaskCore(VAL_AUDIO_DECODE_CORE);
+    audioReady = true;
+}
+
+// audioTask only, the decoder takes a new volume between two frames
+static void audioApplyVolume(void)
+{
+    if (audioVolume < 0)
+    {
+        return;
+    }
+    int volume = (audioVolume * audioDuckPct) / 100;
+    if (volume != audioAppliedVolume)
+    {
+        audio.setVolume(volume);
+        audioAppliedVolume = volume;
+    }
+}
 
-bool audioPlay(const char *fName, int volume)
+// With loop the decoder seeks back to the audio data at the end of the file,
+// without a reopen or a gap; a loop of the file already playing goes on as it is
+static bool audioStart(const char *fName, int volume, bool loop)
 {
-    audio.setPinout(PIN_I2S_BCLK, PIN_I2S_LRC, PIN_I2S_DOUT);    
+    audioVolume = volume;
+    audioApplyVolume();
+    audioWantLoop = loop;
+    if (loop && audioLooping && audio.isRunning() && !strcmp(audioFile, fName))
+    {
+        return true;
+    }
     audio.stopSong();
-    audio.setVolume(volume);
-    audio.setBufsize(0, 1000000);
 
-    if (audio.connecttoFS(PSRamFS, fName))
+    // a track in the asset image is decoded straight from the mapping, other
+    // media is copied to PSRAM on first use or streamed from LittleFS
+    fs::FS *trackFs = assetFsFor(fName);
+    if ((trackFs != NULL) && audio.connecttoFS(*trackFs, fName))
     {
-        //Serial.println("FS play started");
+        // connecttoFS() resets the loop flag, the M4A decoder refuses it
+        audioLooping = loop && audio.setFileLoop(true);
+        strncpy(audioFile, fName, sizeof(audioFile) - 1);
         return true;
     }
+    audioFile[0] = 0;
+    audioLooping = false;
+    audioWantLoop = false;
     Serial.printf("!!! FS play ERROR: %s\r\n", fName);
     return false;
 }
 
-void audioLoop(void)
+static void audioHalt(void)
+{
+    audio.stopSong();
+    audioFile[0] = 0;
+    audioLooping = false;
+    audioWantLoop = false;
+}
+
+// The ring running dry while a track plays is an underrun; with no track it
+// is just silence
+static void audioCountUnderruns(void)
+{
+    i2s_event_t event;
+    while ((audioI2sQ != NULL) && (xQueueReceive(audioI2sQ, &event, 0) == pdTRUE))
+    {
+        if ((event.type == I2S_EVENT_TX_Q_OVF) && audio.isRunning())
+        {
+            audioStats.underruns++;
+        }
+    }
+}
+
+static void audioTask(void *param)
+{
+    TickType_t lastWake = xTaskGetTickCount();
+    uint32_t lastFeedMs = millis();
+    for (;;)
+    {
+        tAudioCmd cmd;
+        if (xQueueReceive(audioCmdQ, &cmd, 0) == pdTRUE)
+        {
+            if (cmd.op == aoPlay)
+            {
+                audioStart(cmd.file, cmd.volume, cmd.loop);
+            }
+            else
+            {
+                audioHalt();
+            }
+        }
+        audioApplyVolume();
+        if (audio.isRunning())
+        {
+            uint32_t gapMs = millis() - lastFeedMs;
+            if (gapMs > 2 * VAL_AUDIO_FEED_MS)
+            {
+                audioStats.lateFeeds++;
+            }
+            audioStats.maxFeedGapMs = max(audioStats.maxFeedGapMs, gapMs);
+            audio.loop();
+        }
+        else if (audioWantLoop && audioFile[0])
+        {
+            // only when the decoder cannot loop the file itself
+            char fName[VAL_MP3_NAME_SIZE];
+            strncpy(fName, audioFile, sizeof(fName));
+            audioLooping = false;
+            audioStart(fName, audioVolume, true);
+            audioStats.restarts++;
+        }
+        lastFeedMs = millis();
+        bool playing = audio.isRunning();
+        energyProfLevel(esAudio, playing ? 255 : 0);
+        if (playing != audioPmHeld)
+        {
+            // the decoder keeps up only at the full clock
+            if (playing)
+            {
+                pmAcquire(plAudio);
+            }
+            else
+            {
+                pmRelease(plAudio);
+            }
+            audioPmHeld = playing;
+        }
+        audioCountUnderruns();
+        vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(VAL_AUDIO_FEED_MS));
+    }
+}
+
+void audioSetMode(tValAudioMode mode)
+{
+    audioMode = devClass.audio ? mode : vaNone;
+    Serial.printf(">>> audioSetMode: %s\r\n", (mode == vaNone) ? "no sound" : (mode == vaLazy) ? "on first use" : "at boot");
+}
+
+bool audioOnDemand(void)
+{
+    return audioMode == vaLazy;
+}
+
+bool audioTaskStart(void)
+{
+    if constexpr (!devClass.audio)
+    {
+        return false;
+    }
+    if (audioCmdQ != NULL)
+    {
+        return true;
+    }
+    audioInit();
+    audioCmdQ = xQueueCreate(1, sizeof(tAudioCmd));
+    return taskStart(tkAudio, audioTask);
+}
+
+// A newer request replaces one audioTask has not picked up yet
+static bool audioPost(const tAudioCmd &cmd)
+{
+    if (audioCmdQ == NULL)
+    {
+        Serial.println("!!! audioPost ERROR: the audio task is not started");
+        return false;
+    }
+    xQueueOverwrite(audioCmdQ, &cmd);
+    return true;
+}
+
+bool audioPlay(const char *fName, int volume, bool loop)
 {
-    audio.loop();    
+    if (audioCmdQ == NULL)
+    {
+        if (audioMode == vaNone)
+        {
+            return false;
+        }
+        if (audioMode == vaLazy)
+        {
+            Serial.println(">>> audioPlay: starting the audio task for the first track");
+            audioTaskStart();
+        }
+    }
+    tAudioCmd cmd = {};
+    cmd.op = aoPlay;
+    cmd.loop = loop;
+    cmd.volume = volume;
+    strncpy(cmd.file, fName, sizeof(cmd.file) - 1);
+    return audioPost(cmd);
 }
 
+// Nothing plays before the task is started
 void audioStop(void)
 {
-    audio.stopSong();    
+    if (audioCmdQ == NULL)
+    {
+        return;
+    }
+    tAudioCmd cmd = {};
+    cmd.op = aoStop;
+    audioPost(cmd);
+}
+
+// Not queued: a duck must not replace a play request audioTask has not taken
+void audioDuck(uint8_t percent)
+{
+    audioDuckPct = min(percent, (uint8_t)100);
 }
 
 bool audioIsRunning(void)
 {
     return audio.isRunning();
-}
\ No newline at end of file
+}
+
+uint32_t audioSampleRate(void)
+{
+    return audio.getSampleRate();
+}
+
+tAudioStats audioGetStats(void)
+{
+    return audioStats;
+}
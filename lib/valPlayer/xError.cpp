@@ -18,17 +18,16 @@ void valPrintError(uint8_t errB)
 
 void valPlayError(uint8_t errB)
 {
-    neoPixels.setPixelColor(0, neoPixels.Color(0, 0, 20));
+    ledOutSetPixel(0, 0, 0, 20);
     
     for (int i = 0; i < 7; i++)
     {
         if (bitRead(errB, 6 - i))
-            neoPixels.setPixelColor(i + 1, neoPixels.Color(20, 0, 0));
+            ledOutSetPixel(i + 1, 20, 0, 0);
         else 
-            neoPixels.setPixelColor(i + 1, neoPixels.Color(0, 0, 0));
+            ledOutSetPixel(i + 1, 0, 0, 0);
     }
-    delay(1);
-    neoPixels.show();
+    ledOutShow();
     if (errB)
     {        
         valPrintError(errB);
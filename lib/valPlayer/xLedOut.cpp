@@ -0,0 +1,92 @@
+#include "valPlayer.h"
+#include "driver/rmt.h"
+#include "energyProfile.h"
+#include "deviceClass.h"
+
+// WS2812 bit timings in 25 ns RMT ticks (80 MHz APB / VAL_LED_RMT_CLK_DIV)
+#define LED_T0H_TICKS   16
+#define LED_T0L_TICKS   34
+#define LED_T1H_TICKS   32
+#define LED_T1L_TICKS   18
+#define LED_ITEMS_NUM   (VAL_PIXELS_NUM * 3 * 8)
+
+static uint8_t ledGrb[VAL_PIXELS_NUM * 3];
+// the channel reads a frame's items while it is sent, the next one is built in the other
+static rmt_item32_t ledItems[2][LED_ITEMS_NUM];
+static uint8_t ledBack = 0;
+static bool ledReady = false;
+static int16_t vibroLevel = -1;
+
+bool ledOutInit(void)
+{
+    if constexpr (!devClass.leds)
+    {
+        return false;
+    }
+    if (ledReady)
+    {
+        return true;
+    }
+    rmt_config_t config = RMT_DEFAULT_CONFIG_TX((gpio_num_t)PIN_LED_MATRIX, VAL_LED_RMT_CHANNEL);
+    config.clk_div = VAL_LED_RMT_CLK_DIV;
+    config.mem_block_num = 2;
+    if ((rmt_config(&config) != ESP_OK) || (rmt_driver_install(VAL_LED_RMT_CHANNEL, 0, 0) != ESP_OK))
+    {
+        Serial.println("!!! ledOutInit ERROR: RMT channel setup failed");
+        return false;
+    }
+    ledcSetup(VAL_VIBRO_LEDC_CHANNEL, VAL_VIBRO_PWM_HZ, 8);
+    ledcAttachPin(PIN_VIBRO, VAL_VIBRO_LEDC_CHANNEL);
+    ledcWrite(VAL_VIBRO_LEDC_CHANNEL, 0);
+    vibroLevel = 0;
+    ledReady = true;
+    return true;
+}
+
+void ledOutSetPixel(uint8_t idx, uint8_t r, uint8_t g, uint8_t b)
+{
+    if (idx >= VAL_PIXELS_NUM)
+    {
+        return;
+    }
+    ledGrb[idx * 3] = g;
+    ledGrb[idx * 3 + 1] = r;
+    ledGrb[idx * 3 + 2] = b;
+}
+
+// Returns once the frame is handed to the RMT, the previous one has long been
+// out when the strips change every few tens of ms
+void ledOutShow(void)
+{
+    if (!ledOutInit())
+    {
+        return;
+    }
+    const rmt_item32_t bit0 = {{{LED_T0H_TICKS, 1, LED_T0L_TICKS, 0}}};
+    const rmt_item32_t bit1 = {{{LED_T1H_TICKS, 1, LED_T1L_TICKS, 0}}};
+    rmt_item32_t *item = ledItems[ledBack];
+    uint32_t levelSum = 0;
+    for (int i = 0; i < (int)sizeof(ledGrb); i++)
+    {
+        levelSum += ledGrb[i];
+        for (int bit = 7; bit >= 0; bit--)
+        {
+            (item++)->val = (ledGrb[i] & (1 << bit)) ? bit1.val : bit0.val;
+        }
+    }
+    rmt_wait_tx_done(VAL_LED_RMT_CHANNEL, pdMS_TO_TICKS(VAL_LED_TX_WAIT_MS));
+    rmt_write_items(VAL_LED_RMT_CHANNEL, ledItems[ledBack], LED_ITEMS_NUM, false);
+    ledBack ^= 1;
+    energyProfLevel(esLeds, levelSum / sizeof(ledGrb));
+}
+
+void ledOutVibro(uint8_t level)
+{
+    if ((vibroLevel == level) || !ledOutInit())
+    {
+        return;
+    }
+    ledcWrite(VAL_VIBRO_LEDC_CHANNEL, level);
+    vibroLevel = level;
+    energyProfLevel(esVibro, level);
+}
@@ -1,6 +1,6 @@
 #include "valPlayer.h"
 
-void tLedPattern::print(void)
+void tLedPattern::print(tLedStrip *strips)
 {
     Serial.printf("\t<%s>", name);
     if (circular) 
@@ -15,31 +15,47 @@ void tLedPattern::print(void)
     for (int i = 0; i < stripsCount; i++)
     {
         Serial.print("\t\t");
-        strips[i]->print();
+        strips[firstStrip + i].print();
         Serial.println();
     }
 }
 
-void tLedPattern::start(void)
+void tLedPattern::start(tLedStrip *strips, tLedFrame &frame, bool track)
 {
     stripIdx = 0;
     nextStripMs = 0;
     isPlaying = true;
-    if (PlaySound)
+    if (!track)
+    {
+        // the base pattern's track goes on, the effect is mixed over it
+        if (PlaySound)
+        {
+            sfxPlayFile(SoundFile);
+        }
+    }
+    else if (PlaySound)
     {
-        audioPlay(SoundFile, SoundLevel);
+        // the sound loops for as long as the pattern plays
+        audioPlay(SoundFile, SoundLevel, true);
     }
-    loopPlay();
+    else
+    {
+        // audioTask would go on feeding the last pattern's loop
+        audioStop();
+    }
+    loopPlay(strips, frame, track);
 }
 
-void tLedPattern::loopPlay(void)
+bool tLedPattern::loopPlay(tLedStrip *strips, tLedFrame &frame, bool track)
 {    
     if (!stripsCount)
-        return;
+        return false;
 
     if ((millis() > nextStripMs) || (!nextStripMs))
     {
-        nextStripMs = strips[stripIdx]->play();
+        curStrip = stripIdx;
+        stripStartMs = millis();
+        nextStripMs = strips[firstStrip + stripIdx].render(frame);
         stripIdx++;
         if (stripIdx >= stripsCount) 
         {
@@ -53,42 +69,59 @@ void tLedPattern::loopPlay(void)
             }
             else
             {
-                audioStop();
+                if (track)
+                {
+                    audioStop();
+                }
                 isPlaying = false; 
                 stripIdx--;
             }
         }
+        return true;
     }
-    if (PlaySound)
+    if (isFading(strips))
     {
-        audioLoop();
-        if (!audioIsRunning())
-        {
-            audioPlay(SoundFile, SoundLevel);
-            // Serial.print("*** tLedPattern::loopPlay RESTARTED: ");
-            // Serial.println(SoundFile);
-        }
+        const tLedStrip &from = strips[firstStrip + curStrip];
+        uint32_t elapsed = millis() - stripStartMs;
+        uint32_t progress = from.intervalMs ? min((elapsed * 256) / from.intervalMs, (uint32_t)256) : 256;
+        from.blend(strips[firstStrip + stripIdx], progress, frame);
+        return true;
     }
+    return false;
 }
 
-void tLedPattern::loadFromJson(JsonObject pattern)
+// How long loopPlay() has nothing to do, past nextStripMs it moves on; a
+// pattern that has ended waits there for its last strip's interval
+long tLedPattern::msToNext(tLedStrip *strips)
+{
+    long waitMs = (long)(nextStripMs - millis()) + 1;
+    if (isFading(strips) && (waitMs > VAL_FADE_FRAME_MS))
+    {
+        waitMs = VAL_FADE_FRAME_MS;
+    }
+    return waitMs;
+}
+
+// strips has room for all of the pattern's strips from first on, see allocArena()
+// The strip on the LEDs eases into the next one, the last one of a
+// non-circular pattern has nothing to move to
+bool tLedPattern::isFading(tLedStrip *strips)
+{
+    return isPlaying && stripsCount && (stripIdx != curStrip) && (strips[firstStrip + curStrip].ease != leStep);
+}
+
+void tLedPattern::loadFromJson(JsonObject pattern, tLedStrip *strips, uint16_t first)
 {
     strncpy(name, pattern["PatternName"] | "NO_NAME", VAL_PATTERN_NAME_SIZE - 1);
     circular   = pattern["Circular"] | false;
     strncpy(SoundFile, pattern["SoundFile"] | "NA", VAL_MP3_NAME_SIZE - 1);
     SoundLevel = pattern["SoundLevel"];
     PlaySound  = pattern["PlaySound"];
+    firstStrip = first;
     for (JsonArray strip : pattern["Strips"].as<JsonArray>()) 
     {    
-        //loraPackets[loraPacketsCount].loadPacketParams(LoRaPackets);    
-        strips[stripsCount] = new tLedStrip;
-        strips[stripsCount]->loadFromJson(strip);
+        strips[firstStrip + stripsCount].loadFromJson(strip);
         stripsCount++;
-        if (stripsCount >= VAL_MAX_PATTERNS_NUM)
-        {
-            Serial.println("tLedPattern::loadFromJson ERROR: too many strips!!!");
-            break;
-        }
     }
 
 }
@@ -17,5 +17,5 @@ void tLedPixel::set(String hexS)
 
 void tLedPixel::play(uint8_t pxNum)
 {    
-    neoPixels.setPixelColor(pxNum, neoPixels.Color(r, g, b));
+    ledOutSetPixel(pxNum, r, g, b);
 }
\ No newline at end of file
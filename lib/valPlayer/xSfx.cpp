@@ -0,0 +1,356 @@
+#include "valPlayer.h"
+#include "driver/i2s.h"
+#include "serverSync.h"
+#include "taskRegistry.h"
+#include "deviceClass.h"
+
+// Game sound effects are decoded once at boot into PSRAM as 16-bit PCM; a
+// trigger only points a voice at its clip. The voices are mixed into the
+// background track's output right before it goes to I2S, or written to I2S by
+// sfxTask on their own while no track plays
+
+#define WAVE_FORMAT_IMA_ADPCM   0x0011
+
+struct tSfxClip
+{
+    int16_t *pcm = NULL;
+    uint32_t frames = 0;
+    uint32_t rate = 0;
+    uint8_t channels = 0;
+};
+
+struct tSfxVoice
+{
+    const tSfxClip *clip = NULL;
+    uint32_t posQ16 = 0;        // in clip frames, 16.16
+    uint32_t gen = 0;           // bumped on every trigger
+};
+
+static const char *sfxFiles[sfxCount] = {"/sfx_hit.wav", "/sfx_heal.wav", "/sfx_role.wav"};
+static tSfxClip sfxClips[sfxCount];
+static tSfxVoice sfxVoices[VAL_SFX_VOICES];
+static portMUX_TYPE sfxMux = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t sfxTaskHandle = NULL;
+static int16_t sfxOut[VAL_SFX_CHUNK_FRAMES * 2];
+
+static inline int16_t sfxSaturate(int32_t v)
+{
+    return (v > INT16_MAX) ? INT16_MAX : ((v < INT16_MIN) ? INT16_MIN : v);
+}
+
+// Adds the active voices to frames stereo samples at outRate; false when none is left
+static bool sfxMix(int16_t *out, uint32_t frames, uint32_t outRate)
+{
+    tSfxVoice snap[VAL_SFX_VOICES];
+    portENTER_CRITICAL(&sfxMux);
+    memcpy(snap, sfxVoices, sizeof(snap));
+    portEXIT_CRITICAL(&sfxMux);
+
+    bool active = false;
+    for (int v = 0; v < VAL_SFX_VOICES; v++)
+    {
+        tSfxVoice &voice = snap[v];
+        if (voice.clip == NULL)
+        {
+            continue;
+        }
+        const tSfxClip *clip = voice.clip;
+        uint32_t step = ((uint64_t)clip->rate << 16) / (outRate ? outRate : clip->rate);
+        uint32_t endQ16 = clip->frames << 16;
+        int16_t *dst = out;
+        for (uint32_t f = 0; (f < frames) && (voice.posQ16 < endQ16); f++, voice.posQ16 += step)
+        {
+            const int16_t *src = clip->pcm + (voice.posQ16 >> 16) * clip->channels;
+            int32_t l = ((int32_t)src[0] * VAL_SFX_GAIN) >> 8;
+            int32_t r = (clip->channels == 2) ? (((int32_t)src[1] * VAL_SFX_GAIN) >> 8) : l;
+            *dst = sfxSaturate(*dst + l);
+            dst++;
+            *dst = sfxSaturate(*dst + r);
+            dst++;
+        }
+        if (voice.posQ16 >= endQ16)
+        {
+            voice.clip = NULL;
+        }
+        else
+        {
+            active = true;
+        }
+    }
+
+    // a voice retriggered while mixing keeps its new start
+    portENTER_CRITICAL(&sfxMux);
+    for (int v = 0; v < VAL_SFX_VOICES; v++)
+    {
+        if (sfxVoices[v].gen == snap[v].gen)
+        {
+            sfxVoices[v] = snap[v];
+        }
+    }
+    portEXIT_CRITICAL(&sfxMux);
+    return active;
+}
+
+// ESP32-audioI2S hands each decoded chunk over here before its i2s_write(),
+// interleaved stereo after its mono expansion, so validSamples * channels values
+void audio_process_i2s(int16_t *outBuff, uint16_t validSamples, uint8_t bitsPerSample, uint8_t channels, bool *continueI2S)
+{
+    *continueI2S = true;
+    if (bitsPerSample != 16)
+    {
+        return;
+    }
+    sfxMix(outBuff, ((uint32_t)validSamples * channels) / 2, audioSampleRate());
+}
+
+// Without a track the DMA ring plays auto-cleared silence, and a write lands in
+// the next free buffer, one VAL_SFX_CHUNK_FRAMES period from the trigger
+static void sfxTask(void *param)
+{
+    for (;;)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        bool active = true;
+        while (active && !audioIsRunning())
+        {
+            uint32_t rate = audioSampleRate();
+            memset(sfxOut, 0, sizeof(sfxOut));
+            active = sfxMix(sfxOut, VAL_SFX_CHUNK_FRAMES, rate ? rate : VAL_SFX_DEFAULT_RATE);
+            size_t written = 0;
+            i2s_write(I2S_NUM_0, sfxOut, sizeof(sfxOut), &written, portMAX_DELAY);
+        }
+    }
+}
+
+static const int16_t imaSteps[89] =
+{
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+    253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+    1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+    3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442,
+    11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+static const int8_t imaIndex[8] = {-1, -1, -1, -1, 2, 4, 6, 8};
+
+// Mono IMA-ADPCM blocks (4 byte header: first sample, step index) to 16-bit
+// PCM, as the server's enc=audio profile sends the effects; returns the frames
+static uint32_t sfxDecodeAdpcm(const uint8_t *src, uint32_t size, uint16_t blockAlign, int16_t *dst, uint32_t maxFrames)
+{
+    uint32_t frames = 0;
+    for (uint32_t block = 0; (block + 4 <= size) && (frames < maxFrames); block += blockAlign)
+    {
+        const uint8_t *p = src + block;
+        uint32_t end = min(size - block, (uint32_t)blockAlign);
+        int32_t predictor = (int16_t)(p[0] | (p[1] << 8));
+        int index = min(p[2], (uint8_t)88);
+        dst[frames++] = predictor;
+        for (uint32_t i = 4; (i < end) && (frames < maxFrames); i++)
+        {
+            for (int half = 0; (half < 2) && (frames < maxFrames); half++)
+            {
+                uint8_t nibble = half ? (p[i] >> 4) : (p[i] & 0x0F);
+                int32_t step = imaSteps[index];
+                int32_t delta = step >> 3;
+                if (nibble & 4)
+                    delta += step;
+                if (nibble & 2)
+                    delta += step >> 1;
+                if (nibble & 1)
+                    delta += step >> 2;
+                predictor = (nibble & 8) ? predictor - delta : predictor + delta;
+                predictor = sfxSaturate(predictor);
+                index = constrain(index + imaIndex[nibble & 7], 0, 88);
+                dst[frames++] = predictor;
+            }
+        }
+    }
+    return frames;
+}
+
+// RIFF/WAVE with a PCM fmt chunk of 16-bit mono or stereo samples, or mono
+// IMA-ADPCM, which is expanded here so the mixer only ever sees PCM
+static bool sfxLoadClip(const char *fName, tSfxClip &clip)
+{
+    // decoded from the asset image when it holds the clip, without a PSRAM copy of the file
+    fs::FS *clipFs = assetFsFor(fName);
+    if (clipFs == NULL)
+    {
+        return false;
+    }
+    File f = clipFs->open(fName, FILE_READ);
+    if (!f)
+    {
+        return false;
+    }
+    bool ok = false;
+    char riff[12];
+    uint16_t fmt[10] = {0};
+    uint32_t factFrames = 0;
+    if ((f.read((uint8_t *)riff, sizeof(riff)) == sizeof(riff)) && !memcmp(riff, "RIFF", 4) && !memcmp(riff + 8, "WAVE", 4))
+    {
+        char id[4];
+        uint32_t size;
+        while ((f.read((uint8_t *)id, 4) == 4) && (f.read((uint8_t *)&size, 4) == 4))
+        {
+            if (!memcmp(id, "fmt ", 4))
+            {
+                f.read((uint8_t *)fmt, min(size, (uint32_t)sizeof(fmt)));
+                f.seek(f.position() + size - min(size, (uint32_t)sizeof(fmt)));
+            }
+            else if (!memcmp(id, "fact", 4))
+            {
+                f.read((uint8_t *)&factFrames, min(size, (uint32_t)sizeof(factFrames)));
+                f.seek(f.position() + size - min(size, (uint32_t)sizeof(factFrames)) + (size & 1));
+            }
+            else if (!memcmp(id, "data", 4) && (fmt[0] == WAVE_FORMAT_IMA_ADPCM))
+            {
+                // fmt: ..., block align, bits, extra size, samples per block
+                if ((fmt[1] != 1) || (fmt[7] != 4) || (fmt[6] <= 4))
+                {
+                    Serial.printf("!!! sfxBankLoad ERROR: %s is not mono 4-bit IMA-ADPCM\r\n", fName);
+                    break;
+                }
+                uint16_t blockAlign = fmt[6];
+                uint32_t perBlock = (blockAlign - 4) * 2 + 1;
+                uint32_t frames = ((size + blockAlign - 1) / blockAlign) * perBlock;
+                if (factFrames > 0)
+                {
+                    frames = min(frames, factFrames);
+                }
+                frames = min(frames, (uint32_t)VAL_SFX_MAX_FRAMES);
+                uint8_t *adpcm = (uint8_t *)ps_malloc(size);
+                clip.pcm = (int16_t *)ps_malloc(frames * sizeof(int16_t));
+                if ((adpcm == NULL) || (clip.pcm == NULL) || (f.read(adpcm, size) != size))
+                {
+                    Serial.printf("!!! sfxBankLoad ERROR: %s does not fit\r\n", fName);
+                    free(adpcm);
+                    free(clip.pcm);
+                    clip.pcm = NULL;
+                    break;
+                }
+                clip.frames = sfxDecodeAdpcm(adpcm, size, blockAlign, clip.pcm, frames);
+                clip.channels = 1;
+                clip.rate = fmt[2] | ((uint32_t)fmt[3] << 16);
+                free(adpcm);
+                ok = true;
+                break;
+            }
+            else if (!memcmp(id, "data", 4))
+            {
+                // fmt: format, channels, rate low, rate high, byte rate x2, block align, bits
+                if ((fmt[0] != 1) || (fmt[7] != 16) || (fmt[1] < 1) || (fmt[1] > 2))
+                {
+                    Serial.printf("!!! sfxBankLoad ERROR: %s is not 16-bit PCM\r\n", fName);
+                    break;
+                }
+                clip.pcm = (int16_t *)ps_malloc(size);
+                if ((clip.pcm == NULL) || (f.read((uint8_t *)clip.pcm, size) != size))
+                {
+                    Serial.printf("!!! sfxBankLoad ERROR: %s does not fit\r\n", fName);
+                    free(clip.pcm);
+                    clip.pcm = NULL;
+                    break;
+                }
+                clip.channels = fmt[1];
+                clip.rate = fmt[2] | ((uint32_t)fmt[3] << 16);
+                // positions are 16.16 in 32 bits
+                clip.frames = min(size / (2 * clip.channels), (uint32_t)VAL_SFX_MAX_FRAMES);
+                ok = true;
+                break;
+            }
+            else
+            {
+                f.seek(f.position() + size + (size & 1));
+            }
+        }
+    }
+    f.close();
+    // the PCM copy is all that is played, the staged file is not kept twice
+    PSRamFS.remove(fName);
+    return ok;
+}
+
+bool sfxBankLoad(void)
+{
+    if constexpr (!devClass.audio)
+    {
+        return false;
+    }
+    audioInit();
+    uint8_t loaded = 0;
+    for (int i = 0; i < sfxCount; i++)
+    {
+        if (sfxClips[i].pcm != NULL)
+        {
+            loaded++;
+            continue;
+        }
+        if (sfxLoadClip(sfxFiles[i], sfxClips[i]))
+        {
+            Serial.printf(">>> sfxBankLoad: %s, %u frames at %u Hz\r\n", sfxFiles[i], sfxClips[i].frames, sfxClips[i].rate);
+            loaded++;
+        }
+        else
+        {
+            Serial.printf("*** sfxBankLoad WARNING! %s is not loaded\r\n", sfxFiles[i]);
+        }
+    }
+    if (sfxTaskHandle == NULL)
+    {
+        taskStart(tkSfx, sfxTask, NULL, &sfxTaskHandle);
+    }
+    return loaded == sfxCount;
+}
+
+bool sfxPlayFile(const char *fName)
+{
+    for (int i = 0; i < sfxCount; i++)
+    {
+        if (!strcmp(fName, sfxFiles[i]))
+        {
+            return sfxPlay((tSfxId)i);
+        }
+    }
+    return false;
+}
+
+// Takes a free voice or the one furthest into its clip
+bool sfxPlay(tSfxId id)
+{
+    static bool bankTried = false;
+    if ((id < sfxCount) && (sfxClips[id].pcm == NULL) && !bankTried && audioOnDemand())
+    {
+        // once, what did not load then stays silent as with the bank loaded at boot
+        bankTried = true;
+        Serial.println(">>> sfxPlay: loading the effect bank for the first effect");
+        sfxBankLoad();
+    }
+    if ((id >= sfxCount) || (sfxClips[id].pcm == NULL))
+    {
+        return false;
+    }
+    portENTER_CRITICAL(&sfxMux);
+    int slot = 0;
+    for (int v = 0; v < VAL_SFX_VOICES; v++)
+    {
+        if (sfxVoices[v].clip == NULL)
+        {
+            slot = v;
+            break;
+        }
+        if (sfxVoices[v].posQ16 > sfxVoices[slot].posQ16)
+        {
+            slot = v;
+        }
+    }
+    sfxVoices[slot].clip = &sfxClips[id];
+    sfxVoices[slot].posQ16 = 0;
+    sfxVoices[slot].gen++;
+    portEXIT_CRITICAL(&sfxMux);
+    if (sfxTaskHandle != NULL)
+    {
+        xTaskNotifyGive(sfxTaskHandle);
+    }
+    return true;
+}
@@ -9,30 +9,42 @@ void tLedStrip::print(void)
     Serial.print(" ");
     Serial.printf("intervalMs = %u", intervalMs);
     if (vibro)
-        Serial.print(" VIBRO");
+        Serial.printf(" VIBRO %u", vibro);
+    if (ease != leStep)
+        Serial.printf(" EASE %u", ease);
     Serial.println();
 }
 
-unsigned long tLedStrip::play(void)
+unsigned long tLedStrip::render(tLedFrame &frame) const
 {    
     for (int i = 0; i < VAL_PIXELS_NUM; i++)
     {
-        pixels[i].play(i);
+        frame.pixels[i] = pixels[i];
     }
-    delay(1);
-    neoPixels.show();
-    if (vibro)
+    frame.vibro = vibro;
+    
+    return millis() + intervalMs; 
+}
+
+// Fixed point: progress and the eased weight are 0..256
+void tLedStrip::blend(const tLedStrip &to, uint16_t progress256, tLedFrame &frame) const
+{
+    int32_t t = min(progress256, (uint16_t)256);
+    int32_t w = t;
+    if (ease == leSmooth)
     {
-        pinMode(PIN_VIBRO, OUTPUT);
-        digitalWrite(PIN_VIBRO, HIGH);
+        w = (t * t * (3 * 256 - 2 * t)) >> 16;
     }
-    else 
+    for (int i = 0; i < VAL_PIXELS_NUM; i++)
     {
-        pinMode(PIN_VIBRO, OUTPUT);
-        digitalWrite(PIN_VIBRO, LOW);       
+        const tLedPixel &a = pixels[i];
+        const tLedPixel &b = to.pixels[i];
+        tLedPixel &out = frame.pixels[i];
+        out.r = a.r + (((b.r - a.r) * w) >> 8);
+        out.g = a.g + (((b.g - a.g) * w) >> 8);
+        out.b = a.b + (((b.b - a.b) * w) >> 8);
     }
-    
-    return millis() + intervalMs; 
+    frame.vibro = vibro + (((to.vibro - vibro) * w) >> 8);
 }
 
 void tLedStrip::loadFromJson(JsonArray strip)
@@ -47,13 +59,21 @@ void tLedStrip::loadFromJson(JsonArray strip)
             intervalMs = strVal.toInt();            
         
         if (idx == VAL_PIXELS_NUM + 1)
-            vibro = (strVal.toInt() > 0);            
+        {
+            // 0/1 is off/full as before, 2..255 a PWM level
+            long level = strVal.toInt();
+            vibro = (level == 1) ? 255 : constrain(level, 0, 255);
+        }
         
-        if (idx >= VAL_PIXELS_NUM + 1)
+        if (idx == VAL_PIXELS_NUM + 2)
+        {
+            ease = constrain(strVal.toInt(), leStep, leSmooth);
             break;
+        }
         idx++;
         
     }
-    if (idx != VAL_PIXELS_NUM +1)
+    // the ease field is optional, both forms end with idx on it
+    if (idx != VAL_PIXELS_NUM + 2)
         Serial.printf("tLedStrip::loadFromJson ERROR: bad array size [%u]\r\n", idx);
 }
\ No newline at end of file
@@ -0,0 +1,195 @@
+#include "httpPool.h"
+#include "memMonitor.h"
+
+struct tHttpSlot
+{
+    WiFiClient client;
+    HTTPClient http;
+    char host[HTTP_POOL_HOST_SIZE] = "";
+    uint16_t port = 0;
+    uint32_t lastMs = 0;
+    bool busy = false;
+};
+
+static tHttpSlot slots[HTTP_POOL_SLOTS];
+static tHttpPoolStats poolStats;
+static portMUX_TYPE poolMux = portMUX_INITIALIZER_UNLOCKED;
+
+// "http://host[:port]/..." into host and port, 80 without one
+static bool parseHostPort(const String &url, char *host, uint16_t &port)
+{
+    int start = url.indexOf("://");
+    start = (start < 0) ? 0 : start + 3;
+    int end = start;
+    while ((end < (int)url.length()) && (url[end] != '/') && (url[end] != ':'))
+    {
+        end++;
+    }
+    if ((end == start) || (end - start >= HTTP_POOL_HOST_SIZE))
+    {
+        return false;
+    }
+    memcpy(host, url.c_str() + start, end - start);
+    host[end - start] = 0;
+    port = ((end < (int)url.length()) && (url[end] == ':')) ? (uint16_t)url.substring(end + 1).toInt() : 80;
+    return port != 0;
+}
+
+// A free slot of the host, else the free one idle the longest; under poolMux
+static int pickSlot(const char *host, uint16_t port, bool &sameHost)
+{
+    int best = -1;
+    for (int i = 0; i < HTTP_POOL_SLOTS; i++)
+    {
+        tHttpSlot &s = slots[i];
+        if (s.busy)
+        {
+            continue;
+        }
+        if ((s.port == port) && !strcmp(s.host, host))
+        {
+            sameHost = true;
+            return i;
+        }
+        if ((best < 0) || (s.host[0] == 0) || ((int32_t)(s.lastMs - slots[best].lastMs) < 0))
+        {
+            best = i;
+        }
+    }
+    sameHost = false;
+    return best;
+}
+
+tHttpLease::tHttpLease(const String &url) : _slot(-1), _drop(false), _http(NULL), _client(NULL)
+{
+    char host[HTTP_POOL_HOST_SIZE];
+    uint16_t port;
+    bool sameHost = false;
+    if (parseHostPort(url, host, port))
+    {
+        uint32_t startMs = millis();
+        while (true)
+        {
+            portENTER_CRITICAL(&poolMux);
+            _slot = pickSlot(host, port, sameHost);
+            if (_slot >= 0)
+            {
+                slots[_slot].busy = true;
+            }
+            portEXIT_CRITICAL(&poolMux);
+            if ((_slot >= 0) || (millis() - startMs >= HTTP_POOL_WAIT_MS))
+            {
+                break;
+            }
+            delay(HTTP_POOL_POLL_MS);
+        }
+    }
+    poolStats.leases++;
+    if (_slot < 0)
+    {
+        poolStats.unpooled++;
+        _http = new HTTPClient();
+        _client = new WiFiClient();
+        memTagAccount(mtHttp, false, sizeof(HTTPClient) + sizeof(WiFiClient), 0);
+        return;
+    }
+
+    // the health check: the socket is only kept when it is fresh and still open to the host
+    tHttpSlot &s = slots[_slot];
+    if (!sameHost)
+    {
+        if (s.host[0])
+        {
+            poolStats.evicted++;
+        }
+        s.client.stop();
+        strcpy(s.host, host);
+        s.port = port;
+    }
+    else if ((millis() - s.lastMs >= HTTP_POOL_IDLE_MS) || !s.client.connected())
+    {
+        poolStats.stale++;
+        s.client.stop();
+    }
+    else
+    {
+        poolStats.reused++;
+    }
+    _http = &s.http;
+    _client = &s.client;
+}
+
+tHttpLease::~tHttpLease()
+{
+    if (_slot < 0)
+    {
+        _client->stop();
+        delete _http;       // after the stop, HTTPClient's destructor stops the client again
+        delete _client;
+        memTagAccount(mtHttp, false, 0, sizeof(HTTPClient) + sizeof(WiFiClient));
+        return;
+    }
+    tHttpSlot &s = slots[_slot];
+    if (_drop)
+    {
+        s.client.stop();
+    }
+    s.lastMs = millis();
+    portENTER_CRITICAL(&poolMux);
+    s.busy = false;
+    portEXIT_CRITICAL(&poolMux);
+}
+
+// What an earlier lease set on the slot's HTTPClient does not carry over
+bool tHttpLease::begin(const String &url)
+{
+    _http->setTimeout(HTTPCLIENT_DEFAULT_TCP_TIMEOUT);
+    _http->setConnectTimeout(HTTPCLIENT_DEFAULT_TCP_TIMEOUT);
+    _http->collectHeaders(NULL, 0);
+    _http->setReuse(true);
+    return _http->begin(*_client, url);
+}
+
+void httpPoolCloseAll(void)
+{
+    for (int i = 0; i < HTTP_POOL_SLOTS; i++)
+    {
+        tHttpSlot &s = slots[i];
+        portENTER_CRITICAL(&poolMux);
+        bool idle = !s.busy;
+        if (idle)
+        {
+            s.busy = true;
+        }
+        portEXIT_CRITICAL(&poolMux);
+        if (idle)
+        {
+            s.client.stop();
+            s.host[0] = 0;
+            s.port = 0;
+            portENTER_CRITICAL(&poolMux);
+            s.busy = false;
+            portEXIT_CRITICAL(&poolMux);
+        }
+    }
+}
+
+void httpPoolGetStats(tHttpPoolStats &st)
+{
+    st = poolStats;
+}
+
+void httpPoolPrint(void)
+{
+    Serial.printf(">>> HTTP POOL: %lu leases, %lu reused, %lu stale, %lu evicted, %lu unpooled\r\n", poolStats.leases,
+                  poolStats.reused, poolStats.stale, poolStats.evicted, poolStats.unpooled);
+    uint32_t now = millis();
+    for (int i = 0; i < HTTP_POOL_SLOTS; i++)
+    {
+        tHttpSlot &s = slots[i];
+        if (s.host[0])
+        {
+            Serial.printf("\t%s:%u %s, idle %lu ms\r\n", s.host, s.port, s.busy ? "busy" : "free", now - s.lastMs);
+        }
+    }
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <HTTPClient.h>
+
+// Keep-alive connections shared by the firmware's HTTP clients, which mostly
+// talk to one laptop server: a slot is a WiFiClient and the HTTPClient
+// bound to it, keyed by host:port. A lease has its slot to itself; the
+// socket reused by the next lease for that host saves the TCP handshake and
+// the lwIP PCB. An idle or dead socket is closed when its slot is taken.
+// Big one-off streams (OTA image, asset image) keep their own connection,
+// draining what one of them left behind would cost more than a handshake.
+
+#define HTTP_POOL_SLOTS         4           // host:port connections kept at once
+#define HTTP_POOL_HOST_SIZE     48
+#define HTTP_POOL_IDLE_MS       15000       // older idle sockets are closed, the server's keep-alive ends about then
+#define HTTP_POOL_WAIT_MS       1000        // for a busy slot before the lease opens a connection of its own
+#define HTTP_POOL_POLL_MS       10
+
+struct tHttpPoolStats
+{
+    uint32_t leases = 0;
+    uint32_t reused = 0;        // the slot's socket was still open to the host
+    uint32_t stale = 0;         // closed for idling or by the server
+    uint32_t evicted = 0;       // the slot moved to another host
+    uint32_t unpooled = 0;      // all slots busy, the lease had its own connection
+};
+
+class tHttpLease
+{
+public:
+    explicit tHttpLease(const String &url);
+    ~tHttpLease();
+    HTTPClient &http(void) { return *_http; }
+    WiFiClient &client(void) { return *_client; }
+    // http().begin(client(), url) with reuse on; url on the lease's host:port
+    bool begin(const String &url);
+    // the connection is in an unknown state, closed when the lease ends
+    void drop(void) { _drop = true; }
+
+private:
+    int8_t _slot;
+    bool _drop;
+    HTTPClient *_http;
+    WiFiClient *_client;
+    tHttpLease(const tHttpLease &) = delete;
+    tHttpLease &operator=(const tHttpLease &) = delete;
+};
+
+void httpPoolCloseAll(void);            // idle slots, e.g. before WiFi goes down
+void httpPoolGetStats(tHttpPoolStats &st);
+void httpPoolPrint(void);
@@ -1,11 +1,112 @@
 #include "wifiAuto.h"
 #include <esp_event.h>
+#include <Preferences.h>
+#include "bootProfile.h"
+#include "wifiRoam.h"
 
 static WiFiMulti wifiMulti;
 static bool wasAdded = false;
 static bool isConnected = false;
 static bool wasConnected = false;
 static bool wasIP = false;
+static bool staticApplied = false;
+
+// Last successful connection: the config index, BSSID and channel also go to
+// flash for cold boots, the lease only lives in RTC memory for warm ones
+struct tWifiFast
+{
+    uint32_t magic;
+    uint8_t  index;
+    uint8_t  channel;
+    uint8_t  bssid[6];
+    uint32_t ip;        // 0: no lease to reuse
+    uint32_t gateway;
+    uint32_t subnet;
+    uint32_t dns;
+};
+
+RTC_NOINIT_ATTR static tWifiFast fastRtc;
+
+static int configIndexOf(const String &ssid)
+{
+    size_t netCnt = ConfigAPI::getWifiNetworkCount();
+    for (size_t i = 0; i < netCnt; ++i)
+    {
+        String cfgSsid, pass;
+        if (ConfigAPI::getWifiNetwork(i, cfgSsid, pass) && (cfgSsid == ssid))
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static bool fastCacheLoad(tWifiFast &fast)
+{
+    if (fastRtc.magic == WIFI_FAST_MAGIC)
+    {
+        fast = fastRtc;
+        return true;
+    }
+    Preferences prefs;
+    prefs.begin("wififast", true);
+    size_t len = prefs.getBytes("ap", &fast, sizeof(fast));
+    prefs.end();
+    fast.ip = 0;
+    return (len == sizeof(fast)) && (fast.magic == WIFI_FAST_MAGIC);
+}
+
+static void fastCacheStore(void)
+{
+    int index = configIndexOf(WiFi.SSID());
+    if (index < 0)
+    {
+        return;
+    }
+    tWifiFast fast;
+    memset(&fast, 0, sizeof(fast));
+    fast.magic = WIFI_FAST_MAGIC;
+    fast.index = index;
+    fast.channel = WiFi.channel();
+    memcpy(fast.bssid, WiFi.BSSID(), sizeof(fast.bssid));
+    fast.ip = (uint32_t)WiFi.localIP();
+    fast.gateway = (uint32_t)WiFi.gatewayIP();
+    fast.subnet = (uint32_t)WiFi.subnetMask();
+    fast.dns = (uint32_t)WiFi.dnsIP();
+
+    bool apSame = (fastRtc.magic == WIFI_FAST_MAGIC) && (fastRtc.index == fast.index) &&
+                  (fastRtc.channel == fast.channel) && !memcmp(fastRtc.bssid, fast.bssid, sizeof(fast.bssid));
+    fastRtc = fast;
+    if (apSame)
+    {
+        return;
+    }
+
+    // flash is only touched when the AP changed, the lease stays out of it
+    tWifiFast stored;
+    Preferences prefs;
+    prefs.begin("wififast");
+    fast.ip = fast.gateway = fast.subnet = fast.dns = 0;
+    if ((prefs.getBytes("ap", &stored, sizeof(stored)) != sizeof(stored)) || memcmp(&stored, &fast, sizeof(fast)))
+    {
+        prefs.putBytes("ap", &fast, sizeof(fast));
+    }
+    prefs.end();
+}
+
+// WiFiMulti picks the network itself, its static_ip can only follow the association
+static void applyStaticIp(const String &ssid)
+{
+    uint32_t ip, gateway, subnet, dns;
+    int index = configIndexOf(ssid);
+    if ((index < 0) || !ConfigAPI::getWifiStaticIp(index, ip, gateway, subnet, dns))
+    {
+        return;
+    }
+    staticApplied = true;
+    Serial.printf(">>> WiFiAuto: static %s\n", IPAddress(ip).toString().c_str());
+    WiFi.config(IPAddress(ip), IPAddress(gateway), IPAddress(subnet), IPAddress(dns));
+}
 
 static void onWiFiEvent(WiFiEvent_t event, WiFiEventInfo_t info)
 {
@@ -33,6 +134,11 @@ static void onWiFiEvent(WiFiEvent_t event, WiFiEventInfo_t info)
                       WiFi.RSSI());
             isConnected = true;
             wasConnected = true;    
+            bootProfStep(bpWifiAssoc);
+            if (!staticApplied)
+            {
+                applyStaticIp(String((const char *)info.wifi_sta_connected.ssid));
+            }
         }
         
         break;
@@ -41,7 +147,9 @@ static void onWiFiEvent(WiFiEvent_t event, WiFiEventInfo_t info)
         if (!wasIP)
         {
             wasIP = true;
+            bootProfStep(bpDhcp);
             Serial.printf(">>> WiFiAuto: Got IP: %s\n", WiFi.localIP().toString().c_str());
+            fastCacheStore();
             break;
         }
 
@@ -63,6 +171,8 @@ bool WiFiAutoConnect::begin(uint32_t toMs)
 
     WiFi.disconnect(true);
     WiFi.onEvent(onWiFiEvent);    
+    WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);
+    staticApplied = false;
 
     size_t netCnt = ConfigAPI::getWifiNetworkCount();
     if (netCnt == 0)
@@ -91,6 +201,65 @@ bool WiFiAutoConnect::begin(uint32_t toMs)
     return true;
 }
 
+bool WiFiAutoConnect::beginFast(bool reuseLease)
+{
+    if (ConfigAPI::isInitialized() == false)    
+    {
+        return false;
+    }
+    tWifiFast fast;
+    if (!fastCacheLoad(fast))
+    {
+        return false;
+    }
+    String ssid, pass;
+    if ((fast.index >= ConfigAPI::getWifiNetworkCount()) || !ConfigAPI::getWifiNetwork(fast.index, ssid, pass))
+    {
+        Serial.println("*** WiFiAuto: the cached network is no longer in the config");
+        return false;
+    }
+
+    WiFi.disconnect(true);
+    WiFi.onEvent(onWiFiEvent);
+    uint32_t ip, gateway, subnet, dns;
+    const char *ipFrom = "DHCP";
+    if (ConfigAPI::getWifiStaticIp(fast.index, ip, gateway, subnet, dns))
+    {
+        ipFrom = "static";
+    }
+    else if (reuseLease && (fast.ip != 0))
+    {
+        ip = fast.ip;
+        gateway = fast.gateway;
+        subnet = fast.subnet;
+        dns = fast.dns;
+        ipFrom = "lease";
+    }
+    else
+    {
+        ip = 0;
+    }
+    staticApplied = (ip != 0);
+    if (staticApplied)
+    {
+        WiFi.config(IPAddress(ip), IPAddress(gateway), IPAddress(subnet), IPAddress(dns));
+    }
+    else
+    {
+        WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);
+    }
+    Serial.printf(">>> WiFiAuto: Fast connect to %s on ch %d, %s\r\n", ssid.c_str(), fast.channel, ipFrom);
+    // the PMK of the last boot spares the supplicant the PBKDF2 rounds
+    WiFi.begin(ssid.c_str(), wifiRoamPsk(ssid, pass).c_str(), fast.channel, fast.bssid, true);
+    return true;
+}
+
+void WiFiAutoConnect::fastFailed(void)
+{
+    fastRtc.ip = 0;
+    WiFi.disconnect(true);
+}
+
 bool WiFiAutoConnect::isConnected(void)
 {
     return WiFi.isConnected();
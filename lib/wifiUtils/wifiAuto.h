@@ -4,10 +4,19 @@
 #include "xgConfig.h"
 
 #define WIFI_AUTO_RECONNECT (true)
+#define WIFI_FAST_MAGIC         0x54534146      // "FAST"
+#ifndef WIFI_FAST_WAIT_MS
+#define WIFI_FAST_WAIT_MS       3000    // the cached AP gets this long before the full scan
+#endif
 
 namespace WiFiAutoConnect
 {
     bool begin(uint32_t toMs);
+    // Straight to the AP of the last connection on its channel, no scan; the IP is
+    // the network's static_ip, or the last DHCP lease when reuseLease is set.
+    // False when nothing is cached or the network left the config
+    bool beginFast(bool reuseLease);
+    void fastFailed(void);      // the cached AP did not answer, forget the lease
     bool isConnected(void);
     String currentSSID(void);
     void disconnect(void);
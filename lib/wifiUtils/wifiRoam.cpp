@@ -0,0 +1,319 @@
+#include "wifiRoam.h"
+
+#include <esp_wifi.h>
+#include <esp_rom_crc.h>
+#include <sdkconfig.h>
+#include <mbedtls/md.h>
+#include <mbedtls/pkcs5.h>
+#if CONFIG_WPA_11KV_SUPPORT
+#include <esp_rrm.h>
+#define WIFI_ROAM_11KV              1
+#else
+#define WIFI_ROAM_11KV              0
+#endif
+#include "logRing.h"
+#include "taskRegistry.h"
+
+#define WIFI_EID_NEIGHBOR_REPORT    52
+#define WIFI_NR_CHANNEL_OFS         13      // id, len, BSSID, BSSID info, operating class
+
+// The PMK of the last network, kept over warm resets: PBKDF2 costs the S3 about half a second
+struct tRoamPmk
+{
+    uint32_t magic;
+    uint32_t ssidCrc;
+    uint32_t passCrc;
+    uint8_t  pmk[32];
+};
+
+RTC_NOINIT_ATTR static tRoamPmk pmkRtc;
+
+static TaskHandle_t roamTask = NULL;
+static tWifiRoamStats roamStats;
+static int32_t rssi16 = 0;              // EMA, 1/16 dBm
+static uint8_t curBssid[6];
+static bool curKnown = false;
+static bool roamPending = false;        // our own reassociation, not the AP's steering
+static uint32_t lastScanMs = 0;
+static volatile uint16_t nrChannels = 0;    // bit per channel from the last neighbour report
+
+static uint32_t crcOf(const String &s)
+{
+    return esp_rom_crc32_le(0, (const uint8_t *)s.c_str(), s.length());
+}
+
+static bool pmkCached(const String &ssid, const String &pass)
+{
+    return (pmkRtc.magic == WIFI_ROAM_PMK_MAGIC) && (pmkRtc.ssidCrc == crcOf(ssid)) && (pmkRtc.passCrc == crcOf(pass));
+}
+
+// WPA2-PSK only: a passphrase of 8..63 characters, a 64 digit one already is the PSK
+static void pmkDerive(const String &ssid, const String &pass)
+{
+    if ((pass.length() < 8) || (pass.length() > 63) || pmkCached(ssid, pass))
+    {
+        return;
+    }
+    uint32_t startMs = millis();
+    mbedtls_md_context_t ctx;
+    mbedtls_md_init(&ctx);
+    bool ok = (mbedtls_md_setup(&ctx, mbedtls_md_info_from_type(MBEDTLS_MD_SHA1), 1) == 0) &&
+              (mbedtls_pkcs5_pbkdf2_hmac(&ctx, (const uint8_t *)pass.c_str(), pass.length(),
+                                         (const uint8_t *)ssid.c_str(), ssid.length(), 4096,
+                                         sizeof(pmkRtc.pmk), pmkRtc.pmk) == 0);
+    mbedtls_md_free(&ctx);
+    if (!ok)
+    {
+        pmkRtc.magic = 0;
+        Serial.println("!!! wifiRoam ERROR: PMK derivation failed");
+        return;
+    }
+    pmkRtc.ssidCrc = crcOf(ssid);
+    pmkRtc.passCrc = crcOf(pass);
+    pmkRtc.magic = WIFI_ROAM_PMK_MAGIC;
+    LOGR(lmNet, llInfo, "wifiRoam: PMK cached in %u ms", (unsigned)(millis() - startMs));
+}
+
+String wifiRoamPsk(const String &ssid, const String &pass)
+{
+    if (!pmkCached(ssid, pass))
+    {
+        return pass;
+    }
+    char hex[2 * sizeof(pmkRtc.pmk) + 1];
+    for (size_t i = 0; i < sizeof(pmkRtc.pmk); i++)
+    {
+        sprintf(&hex[2 * i], "%02x", pmkRtc.pmk[i]);
+    }
+    return String(hex);
+}
+
+#if WIFI_ROAM_11KV
+// Raw neighbour report elements, a leading dialog token is skipped
+static void onNeighborReport(void *ctx, const uint8_t *report, size_t len)
+{
+    uint16_t mask = 0;
+    size_t pos = ((len > 0) && (report[0] != WIFI_EID_NEIGHBOR_REPORT)) ? 1 : 0;
+    while (pos + 2 <= len)
+    {
+        uint8_t elemLen = report[pos + 1];
+        if ((report[pos] == WIFI_EID_NEIGHBOR_REPORT) && (elemLen + 2 > WIFI_NR_CHANNEL_OFS))
+        {
+            uint8_t ch = report[pos + WIFI_NR_CHANNEL_OFS];
+            if ((ch >= 1) && (ch <= 14))
+            {
+                mask |= 1 << ch;
+            }
+        }
+        pos += 2 + elemLen;
+    }
+    nrChannels = mask;
+}
+#endif
+
+// The strongest other BSSID of the SSID on the channel, 0 channel: all
+static bool scanChannel(const wifi_config_t &cfg, uint8_t channel, wifi_ap_record_t &best)
+{
+    wifi_scan_config_t scan;
+    memset(&scan, 0, sizeof(scan));
+    scan.ssid = (uint8_t *)cfg.sta.ssid;
+    scan.channel = channel;
+    scan.scan_type = WIFI_SCAN_TYPE_ACTIVE;
+    scan.scan_time.active.min = WIFI_ROAM_SCAN_ACTIVE_MS / 2;
+    scan.scan_time.active.max = WIFI_ROAM_SCAN_ACTIVE_MS;
+    if (esp_wifi_scan_start(&scan, true) != ESP_OK)
+    {
+        return false;
+    }
+    wifi_ap_record_t recs[WIFI_ROAM_SCAN_RECORDS];
+    uint16_t n = WIFI_ROAM_SCAN_RECORDS;
+    if (esp_wifi_scan_get_ap_records(&n, recs) != ESP_OK)
+    {
+        return false;
+    }
+    bool found = false;
+    for (uint16_t i = 0; i < n; i++)
+    {
+        if (!memcmp(recs[i].bssid, curBssid, sizeof(curBssid)) ||
+            strcmp((const char *)recs[i].ssid, (const char *)cfg.sta.ssid))
+        {
+            continue;
+        }
+        if (!found || (recs[i].rssi > best.rssi))
+        {
+            best = recs[i];
+            found = true;
+        }
+    }
+    return found;
+}
+
+static bool findCandidate(const wifi_config_t &cfg, uint8_t apChannel, wifi_ap_record_t &best)
+{
+    roamStats.scans++;
+    lastScanMs = millis();
+    if (WIFI_ROAM_SAME_CHANNEL)
+    {
+        return scanChannel(cfg, apChannel, best);
+    }
+    uint16_t mask = nrChannels;
+    if (mask == 0)
+    {
+        return scanChannel(cfg, 0, best);
+    }
+    bool found = false;
+    for (uint8_t ch = 1; ch <= 14; ch++)
+    {
+        wifi_ap_record_t rec;
+        if ((mask & (1 << ch)) && scanChannel(cfg, ch, rec) && (!found || (rec.rssi > best.rssi)))
+        {
+            best = rec;
+            found = true;
+        }
+    }
+    return found;
+}
+
+// Straight to the BSSID; the auto reconnect of a plain disconnect would
+// scan first and may well pick the weak AP again
+static void reassociate(wifi_config_t &cfg, const wifi_ap_record_t &to)
+{
+    LOGR(lmNet, llInfo, "wifiRoam: %d dBm -> %02X:%02X:%02X %d dBm on ch %u", (int)(rssi16 / 16),
+         (unsigned)to.bssid[3], (unsigned)to.bssid[4], (unsigned)to.bssid[5], (int)to.rssi, (unsigned)to.primary);
+    String psk = wifiRoamPsk(WiFi.SSID(), WiFi.psk());
+    if (psk.length() == 64)
+    {
+        memcpy(cfg.sta.password, psk.c_str(), 64);
+    }
+    memcpy(cfg.sta.bssid, to.bssid, sizeof(cfg.sta.bssid));
+    cfg.sta.bssid_set = 1;
+    cfg.sta.channel = to.primary;
+#if WIFI_ROAM_11KV
+    cfg.sta.rm_enabled = 1;
+    cfg.sta.btm_enabled = 1;
+#endif
+    roamPending = true;
+    uint32_t startMs = millis();
+    esp_wifi_disconnect();
+    esp_wifi_set_config(WIFI_IF_STA, &cfg);
+    esp_wifi_connect();
+    while ((millis() - startMs < WIFI_ROAM_ASSOC_MS) && !(WiFi.isConnected() && ((uint32_t)WiFi.localIP() != 0)))
+    {
+        delay(20);
+    }
+    wifi_ap_record_t ap;
+    if ((esp_wifi_sta_get_ap_info(&ap) == ESP_OK) && !memcmp(ap.bssid, to.bssid, sizeof(ap.bssid)))
+    {
+        roamStats.roams++;
+        roamStats.lastRoamMs = millis();
+        roamStats.lastAssocMs = roamStats.lastRoamMs - startMs;
+        memcpy(curBssid, ap.bssid, sizeof(curBssid));
+        rssi16 = ap.rssi * 16;
+        LOGR(lmNet, llInfo, "wifiRoam: associated in %u ms", (unsigned)roamStats.lastAssocMs);
+    }
+    else
+    {
+        // any AP of the network will do
+        roamStats.failed++;
+        LOGR(lmNet, llWarn, "wifiRoam: the new AP did not take us, rescanning");
+        cfg.sta.bssid_set = 0;
+        cfg.sta.channel = 0;
+        esp_wifi_disconnect();
+        esp_wifi_set_config(WIFI_IF_STA, &cfg);
+        esp_wifi_connect();
+        curKnown = false;
+    }
+    roamPending = false;
+}
+
+static void roamCheck(void)
+{
+    wifi_ap_record_t ap;
+    if (!WiFi.isConnected() || (esp_wifi_sta_get_ap_info(&ap) != ESP_OK))
+    {
+        curKnown = false;
+        roamStats.rssi = 0;
+        return;
+    }
+    if (!curKnown || memcmp(ap.bssid, curBssid, sizeof(curBssid)))
+    {
+        if (curKnown && !roamPending)
+        {
+            roamStats.steered++;
+        }
+        memcpy(curBssid, ap.bssid, sizeof(curBssid));
+        curKnown = true;
+        rssi16 = ap.rssi * 16;
+        nrChannels = 0;
+        pmkDerive(WiFi.SSID(), WiFi.psk());
+#if WIFI_ROAM_11KV
+        if (!WIFI_ROAM_SAME_CHANNEL && esp_rrm_is_rrm_supported_connection())
+        {
+            esp_rrm_send_neighbor_rep_request(onNeighborReport, NULL);
+        }
+#endif
+    }
+    rssi16 += ((int32_t)ap.rssi * 16 - rssi16) >> WIFI_ROAM_RSSI_SHIFT;
+    roamStats.rssi = (int8_t)(rssi16 / 16);
+    if ((roamStats.rssi >= WIFI_ROAM_TRIGGER_DBM) || (millis() - lastScanMs < WIFI_ROAM_SCAN_MIN_MS))
+    {
+        return;
+    }
+    wifi_config_t cfg;
+    wifi_ap_record_t best;
+    if ((esp_wifi_get_config(WIFI_IF_STA, &cfg) != ESP_OK) || !findCandidate(cfg, ap.primary, best))
+    {
+        return;
+    }
+    if (best.rssi < roamStats.rssi + WIFI_ROAM_HYSTERESIS_DB)
+    {
+        LOGR(lmNet, llDebug, "wifiRoam: best other AP %d dBm, staying at %d", (int)best.rssi, (int)roamStats.rssi);
+        return;
+    }
+    reassociate(cfg, best);
+}
+
+static void roamTaskFn(void *arg)
+{
+    TickType_t lastWake = xTaskGetTickCount();
+    for (;;)
+    {
+        vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(WIFI_ROAM_CHECK_MS));
+        roamCheck();
+    }
+}
+
+void wifiRoamStart(void)
+{
+    if (roamTask != NULL)
+    {
+        return;
+    }
+    lastScanMs = millis() - WIFI_ROAM_SCAN_MIN_MS;
+    if (!taskStart(tkWifiRoam, roamTaskFn, NULL, &roamTask))
+    {
+        return;
+    }
+    Serial.printf(">>> wifiRoamStart: below %d dBm, %s\r\n", WIFI_ROAM_TRIGGER_DBM,
+                  WIFI_ROAM_SAME_CHANNEL ? "the AP's channel only" : "all channels");
+}
+
+void wifiRoamGetStats(tWifiRoamStats &st)
+{
+    st = roamStats;
+}
+
+void wifiRoamPrint(void)
+{
+    Serial.printf(">>> WIFI ROAM: %s, %d dBm filtered, trigger %d dBm\r\n", WiFi.isConnected() ? WiFi.SSID().c_str() : "-",
+                  roamStats.rssi, WIFI_ROAM_TRIGGER_DBM);
+    Serial.printf("\t%lu scans, %lu roams, %lu failed, %lu steered by the AP\r\n", roamStats.scans, roamStats.roams,
+                  roamStats.failed, roamStats.steered);
+    if (roamStats.roams)
+    {
+        Serial.printf("\tlast roam %lu s ago, associated in %lu ms\r\n", (millis() - roamStats.lastRoamMs) / 1000,
+                      roamStats.lastAssocMs);
+    }
+    Serial.printf("\tPMK %s, 802.11k/v %s\r\n", (pmkRtc.magic == WIFI_ROAM_PMK_MAGIC) ? "cached" : "not cached",
+                  WIFI_ROAM_11KV ? "on" : "not in this build");
+}
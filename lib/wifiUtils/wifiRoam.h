@@ -0,0 +1,48 @@
+#pragma once
+
+#include <Arduino.h>
+#include <WiFi.h>
+
+// Roaming between the venue's APs: a low-priority task follows the RSSI of
+// the AP, and once it has stayed weak it scans the connected SSID for a
+// stronger BSSID and reassociates to it straight away, by BSSID and channel.
+// ESP-NOW follows the AP's channel, so by default only the AP's channel is
+// scanned; a venue whose APs sit on other channels sets WIFI_ROAM_SAME_CHANNEL
+// to 0 and accepts that the game moves with the device.
+//
+// The WPA2 PMK of the network is derived once in the background and given to
+// the supplicant as the 64 hex digit PSK, a reassociation then skips the
+// 4096 PBKDF2 rounds. 802.11k/v is advertised when the prebuilt supplicant
+// has it: the AP can steer the station (BTM) itself, and its neighbour report
+// names the channels worth a scan.
+
+#define WIFI_ROAM_CHECK_MS      2000
+#define WIFI_ROAM_RSSI_SHIFT    2       // EMA of the RSSI, 1/4 per check
+#define WIFI_ROAM_TRIGGER_DBM   -72     // filtered RSSI under which a better AP is looked for
+#define WIFI_ROAM_HYSTERESIS_DB 8       // the candidate must be this much stronger
+#define WIFI_ROAM_SCAN_MIN_MS   30000   // between two scans while the AP stays weak
+#define WIFI_ROAM_ASSOC_MS      3000    // for the new AP before any AP of the SSID is taken
+#define WIFI_ROAM_SCAN_RECORDS  8
+#define WIFI_ROAM_SCAN_ACTIVE_MS 60     // per channel
+#ifndef WIFI_ROAM_SAME_CHANNEL
+#define WIFI_ROAM_SAME_CHANNEL  1
+#endif
+#define WIFI_ROAM_PMK_MAGIC     0x4B4D5052      // "RPMK"
+
+struct tWifiRoamStats
+{
+    int8_t   rssi;              // filtered, 0 while not associated
+    uint32_t scans;
+    uint32_t roams;
+    uint32_t failed;            // the new AP did not take the station
+    uint32_t steered;           // BSSID changes not started here: BTM or a reconnect
+    uint32_t lastRoamMs;
+    uint32_t lastAssocMs;       // how long the last reassociation took
+};
+
+void wifiRoamStart(void);       // once connected, idempotent
+// The PSK the supplicant is given for the network: the cached PMK as 64 hex
+// digits when it was derived for this SSID and passphrase, else the passphrase
+String wifiRoamPsk(const String &ssid, const String &pass);
+void wifiRoamGetStats(tWifiRoamStats &st);
+void wifiRoamPrint(void);
@@ -1,6 +1,7 @@
 #include "wifiUtils.h"
 
 #include <HTTPClient.h>
+#include "httpPool.h"
 #include <Preferences.h>
 #include <esp_wifi.h>
 
@@ -146,25 +147,29 @@ void wifiInit(String ssid, String pass, uint8_t wifiChannel)
 ////////////////////////////////////////////
 String wifiGetString(String fileLink)
 {
-    HTTPClient http;
+    tHttpLease lease(fileLink);
+    HTTPClient &http = lease.http();
 
     String payload = "0";
 
-    http.begin(fileLink);
+    lease.begin(fileLink);
     int httpCode = http.GET();
     if (httpCode > 0)
     {
         if (httpCode == HTTP_CODE_OK)
         {
             payload = http.getString();
+            http.end();
             return payload;
         }
         else
         {
             Serial.println(String("wifiGetString failed[1], error code = ") + httpCode + " URL = " + fileLink);
+            http.end();
             return "";
         }
     }
+    lease.drop();
     Serial.println(String("wifiGetString failed[2], error code = ") + httpCode + " URL = " + fileLink);
     return "";
 }
@@ -344,46 +349,272 @@ void wifiMaxPower(void)
 //     return false;
 // }
 
+// Last answering discovery server, kept in RTC memory for warm boots and in
+// flash for cold ones, so the next lookup can unicast it straight away
+struct tDiscoCache
+{
+    uint32_t magic;
+    uint32_t ip;
+    uint32_t epoch;
+};
+
+RTC_NOINIT_ATTR static tDiscoCache discoRtc;
+
+static bool discoCacheLoad(IPAddress &ip, uint32_t &epoch)
+{
+    if ((discoRtc.magic == WIFI_DISCO_CACHE_MAGIC) && (discoRtc.ip != 0))
+    {
+        ip = IPAddress(discoRtc.ip);
+        epoch = discoRtc.epoch;
+        return true;
+    }
+    Preferences prefs;
+    prefs.begin("disco", true);
+    uint32_t raw = prefs.getUInt("ip", 0);
+    epoch = prefs.getUInt("epoch", 0);
+    prefs.end();
+    if (raw == 0)
+    {
+        return false;
+    }
+    ip = IPAddress(raw);
+    return true;
+}
+
+static void discoCacheStore(IPAddress ip, uint32_t epoch)
+{
+    uint32_t raw = (uint32_t)ip;
+    bool rtcValid = (discoRtc.magic == WIFI_DISCO_CACHE_MAGIC);
+    if (rtcValid && (discoRtc.ip == raw) && (discoRtc.epoch == epoch))
+    {
+        return;
+    }
+    discoRtc.magic = WIFI_DISCO_CACHE_MAGIC;
+    discoRtc.ip = raw;
+    discoRtc.epoch = epoch;
+
+    // flash is only touched when the server actually moved or restarted
+    Preferences prefs;
+    prefs.begin("disco");
+    if ((prefs.getUInt("ip", 0) != raw) || (prefs.getUInt("epoch", 0) != epoch))
+    {
+        prefs.putUInt("ip", raw);
+        prefs.putUInt("epoch", epoch);
+    }
+    prefs.end();
+}
+
+// Firmware the answering server offers for OTA, from the last discovery reply
+static int discoFwVersion = -1;
+static char discoFwMd5[33] = {0};
+static tDiscoServices discoServices;
+static bool discoHaveServices = false;
+static uint8_t discoArena = 0;
+
+static void discoSetFirmware(const char *ver, const char *md5, size_t md5Len)
+{
+    if (md5Len == sizeof(discoFwMd5) - 1)
+    {
+        discoFwVersion = atoi(ver);
+        memcpy(discoFwMd5, md5, md5Len);
+        discoFwMd5[md5Len] = 0;
+    }
+}
+
+// One "key=value" field of the service map, unknown keys are skipped
+static void discoParseField(const char *field, size_t len)
+{
+    const char *eq = (const char *)memchr(field, '=', len);
+    if (eq == NULL)
+    {
+        return;
+    }
+    size_t keyLen = eq - field;
+    const char *value = eq + 1;
+    size_t valueLen = len - keyLen - 1;
+    uint16_t port = (uint16_t)strtoul(value, NULL, 10);
+    discoHaveServices = true;
+    if ((keyLen == 2) && !strncmp(field, "fw", 2))
+    {
+        const char *colon = (const char *)memchr(value, ':', valueLen);
+        if (colon)
+        {
+            discoSetFirmware(value, colon + 1, valueLen - (colon + 1 - value));
+        }
+    }
+    else if ((keyLen == 4) && !strncmp(field, "file", 4))
+    {
+        discoServices.filePort = port;
+    }
+    else if ((keyLen == 4) && !strncmp(field, "game", 4))
+    {
+        // "<ip>:<port>" when the arena's game server runs on another machine
+        const char *colon = (const char *)memchr(value, ':', valueLen);
+        char ipStr[16];
+        size_t n = colon ? (size_t)(colon - value) : 0;
+        if (colon && (n < sizeof(ipStr)))
+        {
+            memcpy(ipStr, value, n);
+            ipStr[n] = 0;
+            IPAddress gameIp;
+            if (gameIp.fromString(ipStr))
+            {
+                discoServices.gameIp = (uint32_t)gameIp;
+                port = (uint16_t)strtoul(colon + 1, NULL, 10);
+            }
+        }
+        discoServices.gamePort = port;
+    }
+    else if ((keyLen == 3) && !strncmp(field, "ota", 3))
+    {
+        discoServices.otaPort = port;
+    }
+    else if ((keyLen == 6) && !strncmp(field, "status", 6))
+    {
+        discoServices.statusPort = port;
+    }
+    else if ((keyLen == 6) && !strncmp(field, "assets", 6) && (valueLen <= WIFI_DISCO_ASSETS_MAX))
+    {
+        memcpy(discoServices.assets, value, valueLen);
+        discoServices.assets[valueLen] = 0;
+    }
+}
+
+// Replies are "<ip>" from older responders, "<ip>;<epoch>",
+// "<ip>;<epoch>;<fw version>;<fw md5>" from a server that also runs OTA, or
+// "<ip>;<epoch>" followed by the "key=value" fields of the service map
+static bool discoParseReply(const char *buf, IPAddress &ip, uint32_t &epoch)
+{
+    char ipStr[16];
+    const char *sep = strchr(buf, ';');
+    size_t n = sep ? (size_t)(sep - buf) : strlen(buf);
+    if ((n == 0) || (n >= sizeof(ipStr)))
+    {
+        return false;
+    }
+    memcpy(ipStr, buf, n);
+    ipStr[n] = 0;
+    epoch = sep ? strtoul(sep + 1, NULL, 10) : 0;
+
+    discoFwVersion = -1;
+    discoFwMd5[0] = 0;
+    memset(&discoServices, 0, sizeof(discoServices));
+    discoHaveServices = false;
+    const char *field = sep ? strchr(sep + 1, ';') : NULL;
+    if (field && !strchr(field, '='))
+    {
+        const char *md5Sep = strchr(field + 1, ';');
+        if (md5Sep)
+        {
+            discoSetFirmware(field + 1, md5Sep + 1, strlen(md5Sep + 1));
+        }
+        field = NULL;
+    }
+    while (field)
+    {
+        field++;
+        const char *next = strchr(field, ';');
+        discoParseField(field, next ? (size_t)(next - field) : strlen(field));
+        field = next;
+    }
+    return ip.fromString(ipStr);
+}
+
+bool wifiDiscoFirmware(int &version, String &md5)
+{
+    if (discoFwVersion < 0)
+    {
+        return false;
+    }
+    version = discoFwVersion;
+    md5 = discoFwMd5;
+    return true;
+}
+
+bool wifiDiscoServices(tDiscoServices &services)
+{
+    services = discoServices;
+    return discoHaveServices;
+}
+
+void wifiDiscoSetArena(uint8_t arena)
+{
+    discoArena = arena;
+}
+
+static void discoSendProbe(WiFiUDP &udp, IPAddress dest)
+{
+    char probe[32];
+    int len = discoArena ? snprintf(probe, sizeof(probe), "%s;arena=%u", WIFI_DISCO_MAGIC, (unsigned)discoArena)
+                         : snprintf(probe, sizeof(probe), "%s", WIFI_DISCO_MAGIC);
+    udp.beginPacket(dest, WIFI_DISCO_PORT);
+    udp.write((const uint8_t *)probe, len);
+    udp.endPacket();
+}
+
+// The cached server is probed by unicast in parallel with the broadcast, the
+// first valid answer wins, so a warm boot usually completes in a few ms
 bool wifiGetDisco(IPAddress &server)
 {
-    WiFiUDP udp;    
-    const uint16_t DISCO_PORT = 4210;
-    const char DISCO_MAGIC[] = "ESP32-LOOK";
-    
-    // Bind to ANY available port (not 4210!)
-    udp.begin(0);  // 0 = random available port
-    
+    WiFiUDP udp;
+    IPAddress cached;
+    uint32_t cachedEpoch = 0;
+    bool haveCached = discoCacheLoad(cached, cachedEpoch);
     IPAddress broadcast(255, 255, 255, 255);
-    udp.beginPacket(broadcast, DISCO_PORT);  // Send TO server's port
-    udp.write((uint8_t *)DISCO_MAGIC, strlen(DISCO_MAGIC));
-    udp.endPacket();
 
+    // Bind to ANY available port (not 4210!)
+    udp.begin(0);
+
+    if (haveCached)
+    {
+        discoSendProbe(udp, cached);
+        Serial.printf(">>> wifiGetDisco: probing cached server %s\r\n", cached.toString().c_str());
+    }
+    discoSendProbe(udp, broadcast);
     Serial.println(">>> wifiGetDisco: Broadcast sent, waiting for response...");
 
     uint32_t start = millis();
-    while (millis() - start < 2000)  // Increased timeout
-    { 
+    uint32_t lastProbeMs = start;
+    while (millis() - start < WIFI_DISCO_TIMEOUT_MS)
+    {
         int len = udp.parsePacket();
         if (len >= 7)
-        { 
-            char buf[16] = {0};
+        {
+            char buf[WIFI_DISCO_REPLY_MAX] = {0};
             udp.read(buf, sizeof(buf) - 1);
-            
+
             Serial.print(">>> Received response: ");
             Serial.println(buf);
-            
-            if (server.fromString(buf))
+
+            IPAddress found;
+            uint32_t epoch = 0;
+            if (discoParseReply(buf, found, epoch))
             {
-                Serial.print(">>> wifiGetDisco: Server found at ");
-                Serial.println(server);
+                if (haveCached && (found == cached) && (epoch != cachedEpoch))
+                {
+                    Serial.println("*** wifiGetDisco: cached server was restarted");
+                }
+                Serial.printf(">>> wifiGetDisco: Server found at %s in %lu ms%s\r\n", found.toString().c_str(),
+                              millis() - start, (haveCached && (found == cached)) ? " (cached)" : "");
+                discoCacheStore(found, epoch);
+                server = found;
                 udp.stop();
                 return true;
             }
         }
-        delay(10);  // Small delay to prevent tight loop
+        if (millis() - lastProbeMs >= WIFI_DISCO_RESEND_MS)
+        {
+            lastProbeMs = millis();
+            if (haveCached)
+            {
+                discoSendProbe(udp, cached);
+            }
+            discoSendProbe(udp, broadcast);
+        }
+        delay(5);
     }
-    
+
     Serial.println(">>> wifiGetDisco: NO SERVER FOUND");
     udp.stop();
     return false;
-}
\ No newline at end of file
+}
@@ -8,6 +8,25 @@
 #define WIFI_TIME_SYNC_INTERVAL_MS      120000
 #define WIFI_MAX_TIME_SYNC_ATTEMPTS     3
 
+#define WIFI_DISCO_PORT                 4210
+#define WIFI_DISCO_MAGIC                "ESP32-LOOK3"   // "3": the responder may answer with the service map
+#define WIFI_DISCO_TIMEOUT_MS           2000
+#define WIFI_DISCO_RESEND_MS            250
+#define WIFI_DISCO_REPLY_MAX            192             // "ip;epoch;fw=ver:md5;file=port;...;assets=hash"
+#define WIFI_DISCO_CACHE_MAGIC          0x4F435344      // "DSCO"
+#define WIFI_DISCO_ASSETS_MAX           16              // hex digits of the sync folder hash
+
+// What the last discovery reply named, 0 and empty where it did not
+struct tDiscoServices
+{
+    uint16_t filePort;
+    uint16_t gamePort;
+    uint16_t otaPort;
+    uint16_t statusPort;
+    uint32_t gameIp;            // "game=<ip>:<port>": the arena's game server runs on another machine
+    char     assets[WIFI_DISCO_ASSETS_MAX + 1];
+};
+
 void wifiStationConnected_evt(WiFiEvent_t event);
 void wifiGotIP_evt(WiFiEvent_t event);
 void wifiStationDisconnected_evt(WiFiEvent_t event);
@@ -29,7 +48,10 @@ void getWiFiCredentials(String &ssid, String &pass, bool &localNet);
 void setWiFiCredentials(String ssid, String pass, bool localNet);
 void setWiFiToLocal(bool localNet);
 void wifiMaxPower(void);
+void wifiDiscoSetArena(uint8_t arena);                 // "ESP32-LOOK3;arena=<n>", the game server of the arena is named
 bool wifiGetDisco(IPAddress &server);
+bool wifiDiscoFirmware(int &version, String &md5);     // OTA firmware named in the last discovery reply
+bool wifiDiscoServices(tDiscoServices &services);      // false when the responder sent no service map
 
 
 #endif
@@ -1,5 +1,10 @@
 #include "xgConfig.h"
 
+#include <Preferences.h>
+#include <esp_rom_crc.h>
+#include "fsMount.h"
+#include "jsonAlloc.h"
+
 ConfigManager::ConfigManager() : initialized(false)
 {
     setDefaults();
@@ -20,7 +25,9 @@ bool ConfigManager::initialize()
         return true;
     }
 
-    if (!LittleFS.begin(false))
+    // never formatted from here, that would take nconf.json with it
+    tFsHandle fs;
+    if (!fs.ok())
     {
         Serial.println("!!! ConfigManager: Failed to initialize SPIFFS");
         return false;
@@ -34,10 +41,6 @@ bool ConfigManager::initialize()
 
     initialized = true;
     Serial.println(">>> ConfigManager: Initialized successfully");
-
-#if (NET_CONFIG_DEINIT_SPIFFS)
-    LittleFS.end();
-#endif
     return true;
 }
 
@@ -70,6 +73,7 @@ void ConfigManager::setDefaults()
     memset(otaServerUrl, 0, MAX_SERVER_URL_LEN);
     memset(wifiNetworks, 0, sizeof(wifiNetworks));
     deviceID = 0;
+    arena = 0;
 #else
     deviceName = "BAZA_GAME";
     isBaseStation = false;
@@ -77,6 +81,7 @@ void ConfigManager::setDefaults()
     fileServerUrl = "";
     gameServerUrl = "";
     otaServerUrl = "";
+    arena = 0;
 #endif
 }
 
@@ -103,6 +108,168 @@ void ConfigManager::deallocateMemory(void *ptr)
     free(ptr);
 }
 
+// A static_ip without a valid gateway and subnet is ignored, the network stays on DHCP
+static void loadStaticIp(JsonObject network, WifiNetwork &wifi)
+{
+    IPAddress ip, gateway, subnet, dns;
+    if (!ip.fromString(network["static_ip"] | ""))
+    {
+        return;
+    }
+    if (!gateway.fromString(network["gateway"] | "") || !subnet.fromString(network["subnet"] | ""))
+    {
+        Serial.printf("ConfigManager: static_ip of %s needs gateway and subnet, using DHCP\n", wifi.getSSID().c_str());
+        return;
+    }
+    if (!dns.fromString(network["dns"] | ""))
+    {
+        dns = gateway;
+    }
+    wifi.staticIp = (uint32_t)ip;
+    wifi.gateway = (uint32_t)gateway;
+    wifi.subnet = (uint32_t)subnet;
+    wifi.dns = (uint32_t)dns;
+}
+
+static void saveStaticIp(JsonObject network, const WifiNetwork &wifi)
+{
+    if (wifi.staticIp == 0)
+    {
+        return;
+    }
+    network["static_ip"] = IPAddress(wifi.staticIp).toString();
+    network["gateway"] = IPAddress(wifi.gateway).toString();
+    network["subnet"] = IPAddress(wifi.subnet).toString();
+    network["dns"] = IPAddress(wifi.dns).toString();
+}
+
+#ifdef USE_PSRAM_FOR_CONFIG
+struct tConfigCacheHdr
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t networkCount;
+    uint32_t srcSize;
+    uint32_t srcStamp;
+    uint8_t  stampIsCrc;
+    uint32_t crc;           // of everything after the header
+};
+
+// The fixed part; the used WifiNetwork slots follow it
+struct tConfigCacheFixed
+{
+    char     deviceName[MAX_DEVICE_NAME_LEN];
+    char     deviceRole[MAX_DEVICE_ROLE_LEN];
+    bool     isBaseStation;
+    uint8_t  arena;
+    uint16_t deviceID;
+    char     fileServerUrl[MAX_SERVER_URL_LEN];
+    char     gameServerUrl[MAX_SERVER_URL_LEN];
+    char     otaServerUrl[MAX_SERVER_URL_LEN];
+    char     sysServerUrl[MAX_SERVER_URL_LEN];
+};
+
+bool ConfigManager::loadCache(uint32_t srcSize, uint32_t srcStamp, bool stampIsCrc)
+{
+    Preferences prefs;
+    if (!prefs.begin(NET_CONFIG_CACHE_NS, true))
+    {
+        return false;
+    }
+    size_t len = prefs.getBytesLength("img");
+    if (len < sizeof(tConfigCacheHdr) + sizeof(tConfigCacheFixed))
+    {
+        prefs.end();
+        return false;
+    }
+    uint8_t *img = static_cast<uint8_t *>(allocateMemory(len));
+    if (!img)
+    {
+        prefs.end();
+        return false;
+    }
+    prefs.getBytes("img", img, len);
+    prefs.end();
+
+    const tConfigCacheHdr *hdr = (const tConfigCacheHdr *)img;
+    const tConfigCacheFixed *fixed = (const tConfigCacheFixed *)(img + sizeof(tConfigCacheHdr));
+    const WifiNetwork *networks = (const WifiNetwork *)(img + sizeof(tConfigCacheHdr) + sizeof(tConfigCacheFixed));
+    size_t bodyLen = len - sizeof(tConfigCacheHdr);
+    bool valid = (hdr->magic == NET_CONFIG_CACHE_MAGIC) && (hdr->version == NET_CONFIG_CACHE_VERSION) &&
+                 (hdr->networkCount <= MAX_WIFI_NETWORKS) &&
+                 (bodyLen == sizeof(tConfigCacheFixed) + hdr->networkCount * sizeof(WifiNetwork)) &&
+                 (hdr->crc == esp_rom_crc32_le(0, img + sizeof(tConfigCacheHdr), bodyLen));
+    bool fresh = valid && (hdr->srcSize == srcSize) && (hdr->srcStamp == srcStamp) && ((bool)hdr->stampIsCrc == stampIsCrc);
+    if (fresh)
+    {
+        memcpy(deviceName, fixed->deviceName, sizeof(deviceName));
+        memcpy(deviceRole, fixed->deviceRole, sizeof(deviceRole));
+        isBaseStation = fixed->isBaseStation;
+        arena = fixed->arena;
+        deviceID = fixed->deviceID;
+        memcpy(fileServerUrl, fixed->fileServerUrl, sizeof(fileServerUrl));
+        memcpy(gameServerUrl, fixed->gameServerUrl, sizeof(gameServerUrl));
+        memcpy(otaServerUrl, fixed->otaServerUrl, sizeof(otaServerUrl));
+        memcpy(sysServerUrl, fixed->sysServerUrl, sizeof(sysServerUrl));
+        wifiNetworkCount = hdr->networkCount;
+        memcpy(wifiNetworks, networks, wifiNetworkCount * sizeof(WifiNetwork));
+        Serial.printf("ConfigManager: Config loaded from the cache, %u networks\n", (unsigned)wifiNetworkCount);
+    }
+    else
+    {
+        Serial.printf("ConfigManager: Config cache %s, parsing JSON\n", valid ? "stale" : "invalid");
+    }
+    deallocateMemory(img);
+    return fresh;
+}
+
+void ConfigManager::storeCache(uint32_t srcSize, uint32_t srcStamp, bool stampIsCrc) const
+{
+    size_t len = sizeof(tConfigCacheHdr) + sizeof(tConfigCacheFixed) + wifiNetworkCount * sizeof(WifiNetwork);
+    uint8_t *img = static_cast<uint8_t *>(calloc(1, len));
+    if (!img)
+    {
+        return;
+    }
+    tConfigCacheHdr *hdr = (tConfigCacheHdr *)img;
+    tConfigCacheFixed *fixed = (tConfigCacheFixed *)(img + sizeof(tConfigCacheHdr));
+    memcpy(fixed->deviceName, deviceName, sizeof(deviceName));
+    memcpy(fixed->deviceRole, deviceRole, sizeof(deviceRole));
+    fixed->isBaseStation = isBaseStation;
+    fixed->arena = arena;
+    fixed->deviceID = deviceID;
+    memcpy(fixed->fileServerUrl, fileServerUrl, sizeof(fileServerUrl));
+    memcpy(fixed->gameServerUrl, gameServerUrl, sizeof(gameServerUrl));
+    memcpy(fixed->otaServerUrl, otaServerUrl, sizeof(otaServerUrl));
+    memcpy(fixed->sysServerUrl, sysServerUrl, sizeof(sysServerUrl));
+    memcpy(img + sizeof(tConfigCacheHdr) + sizeof(tConfigCacheFixed), wifiNetworks, wifiNetworkCount * sizeof(WifiNetwork));
+    hdr->magic = NET_CONFIG_CACHE_MAGIC;
+    hdr->version = NET_CONFIG_CACHE_VERSION;
+    hdr->networkCount = wifiNetworkCount;
+    hdr->srcSize = srcSize;
+    hdr->srcStamp = srcStamp;
+    hdr->stampIsCrc = stampIsCrc;
+    hdr->crc = esp_rom_crc32_le(0, img + sizeof(tConfigCacheHdr), len - sizeof(tConfigCacheHdr));
+
+    Preferences prefs;
+    prefs.begin(NET_CONFIG_CACHE_NS);
+    if (prefs.putBytes("img", img, len) != len)
+    {
+        Serial.println("ConfigManager: Failed to store the config cache");
+    }
+    prefs.end();
+    free(img);
+}
+
+void ConfigManager::dropCache(void)
+{
+    Preferences prefs;
+    prefs.begin(NET_CONFIG_CACHE_NS);
+    prefs.remove("img");
+    prefs.end();
+}
+#endif
+
 bool ConfigManager::loadFromFile()
 {
     if (!LittleFS.exists(NET_CONFIG_FILE_PATH))
@@ -126,6 +293,16 @@ bool ConfigManager::loadFromFile()
         return false;
     }
 
+    uint32_t stamp = (uint32_t)file.getLastWrite();
+    bool stampIsCrc = (stamp == 0);
+#ifdef USE_PSRAM_FOR_CONFIG
+    if (!stampIsCrc && loadCache(fileSize, stamp, false))
+    {
+        file.close();
+        return true;
+    }
+#endif
+
     char *buffer = static_cast<char *>(allocateMemory(fileSize + 1));
     if (!buffer)
     {
@@ -139,8 +316,21 @@ bool ConfigManager::loadFromFile()
     buffer[fileSize] = '\0';
     file.close();
 
+#ifdef USE_PSRAM_FOR_CONFIG
+    if (stampIsCrc)
+    {
+        // no mtime on this LittleFS build, reading the file is still far cheaper than parsing it
+        stamp = esp_rom_crc32_le(0, (const uint8_t *)buffer, fileSize);
+        if (loadCache(fileSize, stamp, true))
+        {
+            deallocateMemory(buffer);
+            return true;
+        }
+    }
+#endif
+
     // Парсим JSON
-    JsonDocument doc;
+    JsonDocument doc(jsonPsram(jdkConfig));
     DeserializationError error = deserializeJson(doc, buffer);
 
     if (error)
@@ -160,6 +350,7 @@ bool ConfigManager::loadFromFile()
     deviceRole[MAX_DEVICE_ROLE_LEN - 1] = '\0';
 
     deviceID = doc["deviceID"] | 1111;
+    arena = min((int)(doc["arena"] | 0), NET_CONFIG_ARENA_MAX);
 
     // isBaseStation = doc["base_station"] | false;
 
@@ -177,6 +368,7 @@ bool ConfigManager::loadFromFile()
             if (strlen(ssid) > 0)
             {
                 wifiNetworks[wifiNetworkCount] = WifiNetwork(ssid, password);
+                loadStaticIp(network, wifiNetworks[wifiNetworkCount]);
                 wifiNetworkCount++;
             }
         }
@@ -202,9 +394,11 @@ bool ConfigManager::loadFromFile()
         strncpy(sysServerUrl, sysUrl, MAX_SERVER_URL_LEN - 1);
         sysServerUrl[MAX_SERVER_URL_LEN - 1] = '\0';
     }
+    storeCache(fileSize, stamp, stampIsCrc);
 #else
     deviceName = doc["device_name"] | "BAZA_GAME";
     isBaseStation = doc["base_station"] | false;
+    arena = min((int)(doc["arena"] | 0), NET_CONFIG_ARENA_MAX);
 
     wifiNetworks.clear();
     if (doc.containsKey("wifi_networks"))
@@ -217,6 +411,7 @@ bool ConfigManager::loadFromFile()
             if (strlen(ssid) > 0)
             {
                 wifiNetworks.emplace_back(ssid, password);
+                loadStaticIp(network, wifiNetworks.back());
             }
         }
     }
@@ -235,6 +430,20 @@ bool ConfigManager::loadFromFile()
     return true;
 }
 
+bool ConfigManager::getWifiStaticIp(size_t index, uint32_t &ip, uint32_t &gateway, uint32_t &subnet, uint32_t &dns) const
+{
+    if (index >= getWifiNetworkCount())
+    {
+        return false;
+    }
+    const WifiNetwork &wifi = wifiNetworks[index];
+    ip = wifi.staticIp;
+    gateway = wifi.gateway;
+    subnet = wifi.subnet;
+    dns = wifi.dns;
+    return ip != 0;
+}
+
 bool ConfigManager::addWifiNetwork(const char *ssid, const char *password)
 {
     if (!ssid || strlen(ssid) == 0)
@@ -301,6 +510,10 @@ bool ConfigManager::saveConfig() const
     doc["device_name"] = deviceName;
     doc["deviceRole"] = deviceRole;
     doc["deviceID"] = deviceID;
+    if (arena)
+    {
+        doc["arena"] = arena;
+    }
 
     JsonArray networks = doc["wifi_networks"].to<JsonArray>();
     for (size_t i = 0; i < wifiNetworkCount; i++)
@@ -308,6 +521,7 @@ bool ConfigManager::saveConfig() const
         JsonObject network = networks.add<JsonObject>();
         network["ssid"] = wifiNetworks[i].ssid;
         network["password"] = wifiNetworks[i].password;
+        saveStaticIp(network, wifiNetworks[i]);
     }
 
     JsonObject servers = doc["servers"].to<JsonObject>();
@@ -317,6 +531,10 @@ bool ConfigManager::saveConfig() const
 #else
     doc["device_name"] = deviceName;
     doc["base_station"] = isBaseStation;
+    if (arena)
+    {
+        doc["arena"] = arena;
+    }
 
     JsonArray networks = doc["wifi_networks"].to<JsonArray>();
     for (const auto &wifi : wifiNetworks)
@@ -324,6 +542,7 @@ bool ConfigManager::saveConfig() const
         JsonObject network = networks.add<JsonObject>();
         network["ssid"] = wifi.ssid;
         network["password"] = wifi.password;
+        saveStaticIp(network, wifi);
     }
 
     JsonObject servers = doc["servers"].to<JsonObject>();
@@ -332,7 +551,12 @@ bool ConfigManager::saveConfig() const
     servers["ota_server"] = otaServerUrl;
 #endif
 
-    File file = LittleFS.open(NET_CONFIG_FILE_PATH, "w");
+#ifdef USE_PSRAM_FOR_CONFIG
+    // a rewrite within the same mtime second may keep the size, the next boot parses it
+    dropCache();
+#endif
+    tFsHandle fs;
+    File file = fs.ok() ? LittleFS.open(NET_CONFIG_FILE_PATH, "w") : File();
     if (!file)
     {
         Serial.println("ConfigManager: Failed to open config file for writing");
@@ -352,12 +576,84 @@ bool ConfigManager::saveConfig() const
     return true;
 }
 
+bool ConfigManager::mergeFleetFile(const char *json, size_t len)
+{
+    JsonDocument patch;
+    DeserializationError error = deserializeJson(patch, json, len);
+    if (error || !patch.is<JsonObject>())
+    {
+        Serial.printf("!!! ConfigManager: fleet config is not a JSON object: %s\n", error.c_str());
+        return false;
+    }
+    tFsHandle fs;
+    if (!fs.ok())
+    {
+        return false;
+    }
+    JsonDocument doc(jsonPsram(jdkConfig));
+    File file = LittleFS.open(NET_CONFIG_FILE_PATH, "r");
+    if (file)
+    {
+        error = deserializeJson(doc, file);
+        file.close();
+        if (error)
+        {
+            Serial.printf("!!! ConfigManager: %s does not parse, fleet config not merged\n", NET_CONFIG_FILE_PATH);
+            return false;
+        }
+    }
+
+    bool changed = false;
+    if (patch["wifi_networks"].is<JsonArray>() && patch["wifi_networks"].size())
+    {
+        doc["wifi_networks"] = patch["wifi_networks"];
+        changed = true;
+    }
+    if (patch["servers"].is<JsonObject>())
+    {
+        if (!doc["servers"].is<JsonObject>())
+        {
+            doc["servers"].to<JsonObject>();
+        }
+        for (JsonPair kv : patch["servers"].as<JsonObject>())
+        {
+            doc["servers"][kv.key()] = kv.value();
+            changed = true;
+        }
+    }
+    if (patch["arena"].is<int>())
+    {
+        doc["arena"] = min(patch["arena"].as<int>(), NET_CONFIG_ARENA_MAX);
+        changed = true;
+    }
+    if (!changed)
+    {
+        Serial.println("!!! ConfigManager: fleet config has nothing to apply");
+        return false;
+    }
+
+#ifdef USE_PSRAM_FOR_CONFIG
+    dropCache();
+#endif
+    file = LittleFS.open(NET_CONFIG_FILE_PATH, "w");
+    if (!file)
+    {
+        Serial.println("!!! ConfigManager: Failed to open config file for writing");
+        return false;
+    }
+    size_t bytesWritten = serializeJsonPretty(doc, file);
+    file.close();
+    Serial.printf("ConfigManager: fleet config merged (%d bytes)\n", bytesWritten);
+    return bytesWritten != 0;
+}
+
 void ConfigManager::printConfig() const
 {
     Serial.println("=== Configuration ===");
 #ifdef USE_PSRAM_FOR_CONFIG
     Serial.printf("Device Name: %s\n", deviceName);
     Serial.printf("Device Role: %s\n", deviceRole);
+    Serial.printf("Arena: %u\n", (unsigned)arena);
     // Serial.printf("Base Station: %s\n", isBaseStation ? "Yes" : "No");
 
     Serial.printf("WiFi Networks (%d):\n", wifiNetworkCount);
@@ -367,6 +663,10 @@ void ConfigManager::printConfig() const
                       i + 1,
                       wifiNetworks[i].ssid,
                       strlen(wifiNetworks[i].password) == 0 ? "[empty]" : "[hidden]");
+        if (wifiNetworks[i].staticIp != 0)
+        {
+            Serial.printf("     static %s\n", IPAddress(wifiNetworks[i].staticIp).toString().c_str());
+        }
     }
 
     Serial.println("Servers:");
@@ -387,6 +687,10 @@ void ConfigManager::printConfig() const
                       i + 1,
                       wifiNetworks[i].ssid.c_str(),
                       wifiNetworks[i].password.isEmpty() ? "[empty]" : "[hidden]");
+        if (wifiNetworks[i].staticIp != 0)
+        {
+            Serial.printf("     static %s\n", IPAddress(wifiNetworks[i].staticIp).toString().c_str());
+        }
     }
 
     Serial.println("Servers:");
@@ -458,6 +762,15 @@ namespace
 namespace ConfigAPI
 {
     String discoServer = "";
+    uint16_t discoFilePort = 0;
+    uint16_t discoGamePort = 0;
+    uint16_t discoOtaPort = 0;
+    uint16_t discoSysPort = 0;
+    String discoGameHost = "";
+    tConfigEndpoint endpoints[CONFIG_SERVER_COUNT] = {};
+
+    static void composeEndpoints(void);
+
     bool initialize()
     {
         if (g_instanceCreated)
@@ -490,6 +803,7 @@ namespace ConfigAPI
 #endif
 
         g_instanceCreated = true;
+        composeEndpoints();
         Serial.println("ConfigAPI: Initialized successfully");
         return true;
     }
@@ -509,6 +823,7 @@ namespace ConfigAPI
 
         g_configInstance = nullptr;
         g_instanceCreated = false;
+        memset(endpoints, 0, sizeof(endpoints));
         Serial.println("ConfigAPI: Deinitialized");
     }
 
@@ -520,6 +835,7 @@ namespace ConfigAPI
     void setDiscoServer(String dS)
     {
         discoServer = dS;
+        composeEndpoints();
     }
 
     String getDiscoServer(void)
@@ -527,9 +843,24 @@ namespace ConfigAPI
         return discoServer;
     }
 
-    String replaceUrlAddress(String fullAddress)
+    void setDiscoPorts(uint16_t filePort, uint16_t gamePort, uint16_t otaPort, uint16_t sysPort)
     {
-        String newAddress = discoServer;
+        discoFilePort = filePort;
+        discoGamePort = gamePort;
+        discoOtaPort = otaPort;
+        discoSysPort = sysPort;
+        composeEndpoints();
+    }
+
+    void setDiscoGameHost(String host)
+    {
+        discoGameHost = host;
+        composeEndpoints();
+    }
+
+    String replaceUrlAddress(String fullAddress, uint16_t port = 0, const String &host = "")
+    {
+        String newAddress = host.length() ? host : discoServer;
         if (newAddress.length() == 0)
         {
             return fullAddress;
@@ -549,6 +880,15 @@ namespace ConfigAPI
 
         String pathAndQuery = "";
         
+        if (port != 0)
+        {
+            // the discovery reply named the port, only the path is kept
+            if (pathStartIndex != -1)
+            {
+                pathAndQuery = remainingUrl.substring(pathStartIndex);
+            }
+            return protocol + newAddress + ":" + String(port) + pathAndQuery;
+        }
         if (portStartIndex != -1 && (pathStartIndex == -1 || portStartIndex < pathStartIndex))
         {         
             String portAndPath = remainingUrl.substring(portStartIndex);
@@ -561,6 +901,54 @@ namespace ConfigAPI
         return protocol + newAddress + pathAndQuery;
     }
 
+    static void composeEndpoint(tConfigEndpoint &ep, const String &url)
+    {
+        memset(&ep, 0, sizeof(ep));
+        if (url.length() >= sizeof(ep.url))
+        {
+            Serial.printf("!!! composeEndpoint ERROR: URL too long [%s]\r\n", url.c_str());
+            return;
+        }
+        strcpy(ep.url, url.c_str());
+
+        const char *hostStart = strstr(ep.url, "://");
+        hostStart = (hostStart == NULL) ? ep.url : hostStart + 3;
+        size_t hostLen = strcspn(hostStart, ":/");
+        if (hostLen < sizeof(ep.host))
+        {
+            memcpy(ep.host, hostStart, hostLen);
+        }
+        const char *p = hostStart + hostLen;
+        if (*p == ':')
+        {
+            ep.port = (uint16_t)strtoul(p + 1, NULL, 10);
+            p += strcspn(p, "/");
+        }
+        ep.pathOfs = (uint16_t)(p - ep.url);
+    }
+
+    static void composeEndpoints(void)
+    {
+        if (!g_instanceCreated || !g_configInstance)
+        {
+            return;
+        }
+        composeEndpoint(endpoints[csFile], replaceUrlAddress(g_configInstance->getFileServerUrl(), discoFilePort));
+        composeEndpoint(endpoints[csGame], replaceUrlAddress(g_configInstance->getGameServerUrl(), discoGamePort, discoGameHost));
+        composeEndpoint(endpoints[csOta], replaceUrlAddress(g_configInstance->getOTAServerUrl(), discoOtaPort));
+        composeEndpoint(endpoints[csSys], replaceUrlAddress(g_configInstance->getSysServerUrl(), discoSysPort));
+    }
+
+    const tConfigEndpoint &getEndpoint(tConfigServer server)
+    {
+        return endpoints[(server < CONFIG_SERVER_COUNT) ? server : csFile];
+    }
+
+    const char *getServerUrl(tConfigServer server)
+    {
+        return getEndpoint(server).url;
+    }
+
     // String getDeviceName()
     // {
     //     if (!isInitialized())
@@ -601,6 +989,15 @@ namespace ConfigAPI
         return g_configInstance->getIsBaseStation();
     }
 
+    uint8_t getArena()
+    {
+        if (!isInitialized())
+        {
+            return 0;
+        }
+        return g_configInstance->getArena();
+    }
+
     String getFileServerUrl()
     {
         if (!isInitialized())
@@ -608,7 +1005,7 @@ namespace ConfigAPI
             Serial.println("ConfigAPI: Not initialized");
             return String("");
         }
-        return replaceUrlAddress(g_configInstance->getFileServerUrl());
+        return String(endpoints[csFile].url);
     }
 
     String getGameServerUrl()
@@ -618,7 +1015,7 @@ namespace ConfigAPI
             Serial.println("ConfigAPI: Not initialized");
             return String("");
         }
-        return replaceUrlAddress(g_configInstance->getGameServerUrl());
+        return String(endpoints[csGame].url);
     }
 
     String getOTAServerUrl()
@@ -628,7 +1025,7 @@ namespace ConfigAPI
             Serial.println("ConfigAPI: Not initialized");
             return String("");
         }
-        return replaceUrlAddress(g_configInstance->getOTAServerUrl());
+        return String(endpoints[csOta].url);
     }
 
     String getSysServerUrl()
@@ -638,7 +1035,7 @@ namespace ConfigAPI
             Serial.println("ConfigAPI: Not initialized");
             return String("");
         }
-        return replaceUrlAddress(g_configInstance->getSysServerUrl());
+        return String(endpoints[csSys].url);
     }
 
     size_t getWifiNetworkCount()
@@ -663,6 +1060,15 @@ namespace ConfigAPI
         return g_configInstance->getWifiNetwork(index, ssid, password);
     }
 
+    bool getWifiStaticIp(size_t index, uint32_t &ip, uint32_t &gateway, uint32_t &subnet, uint32_t &dns)
+    {
+        if (!isInitialized())
+        {
+            return false;
+        }
+        return g_configInstance->getWifiStaticIp(index, ip, gateway, subnet, dns);
+    }
+
     bool addWifiNetwork(const char *ssid, const char *password)
     {
         if (!isInitialized())
@@ -711,7 +1117,14 @@ namespace ConfigAPI
             return false;
         }
         g_configInstance->deinitialize();
-        return g_configInstance->initialize();
+        bool ok = g_configInstance->initialize();
+        composeEndpoints();
+        return ok;
+    }
+
+    bool applyFleetConfig(const char *json, size_t len)
+    {
+        return ConfigManager::mergeFleetFile(json, len);
     }
 
     bool isInstanceCreated()
@@ -17,7 +17,36 @@
 #endif
 
 #define NET_CONFIG_FILE_PATH        "/nconf.json"
-#define NET_CONFIG_DEINIT_SPIFFS    (true)
+
+// Parsed config kept as a binary image in NVS, valid while nconf.json keeps its
+// size and mtime (or CRC when LittleFS keeps no mtime); JSON is parsed only
+// after the file changed
+#define NET_CONFIG_CACHE_NS         "cfgcache"
+#define NET_CONFIG_CACHE_MAGIC      0x46434743      // "CGCF"
+#define NET_CONFIG_CACHE_VERSION    2
+#define NET_CONFIG_ARENA_MAX        15              // "arena" of nconf.json, ARENA_MAX of the game server
+#define NET_CONFIG_ENDPOINT_URL_LEN 160
+#define NET_CONFIG_ENDPOINT_HOST_LEN 64
+
+enum tConfigServer
+{
+    csFile = 0,
+    csGame,
+    csOta,
+    csSys,
+    CONFIG_SERVER_COUNT
+};
+
+// A server URL with the discovery host and port applied, split once. Composed
+// when the config loads and when discovery changes it (boot only), so clients
+// keep the pointers instead of copying the URL on each request.
+struct tConfigEndpoint
+{
+    char        url[NET_CONFIG_ENDPOINT_URL_LEN];   // scheme://host[:port][/path], "" when not configured
+    char        host[NET_CONFIG_ENDPOINT_HOST_LEN];
+    uint16_t    port;                               // 0 when the URL names none
+    uint16_t    pathOfs;                            // url + pathOfs is the path, "" when there is none
+};
 
 struct WifiNetwork
 {
@@ -51,6 +80,11 @@ struct WifiNetwork
     String getSSID() const { return ssid; }
     String getPassword() const { return password; }
 #endif
+    // optional "static_ip", "gateway", "subnet", "dns" of the network, 0: DHCP
+    uint32_t staticIp = 0;
+    uint32_t gateway = 0;
+    uint32_t subnet = 0;
+    uint32_t dns = 0;
 };
 
 class ConfigManager
@@ -76,10 +110,17 @@ private:
     String otaServerUrl;
 #endif
 
+    uint8_t arena;              // the game arena the device plays in, 0 = the only one
+
     bool initialized;
     //static const char *NET_CONFIG_FILE_PATH;
     
     bool loadFromFile();
+#ifdef USE_PSRAM_FOR_CONFIG
+    bool loadCache(uint32_t srcSize, uint32_t srcStamp, bool stampIsCrc);
+    void storeCache(uint32_t srcSize, uint32_t srcStamp, bool stampIsCrc) const;
+    static void dropCache(void);
+#endif
     void setDefaults();
     void *allocateMemory(size_t size);
     void deallocateMemory(void *ptr);
@@ -124,7 +165,9 @@ public:
     }
 #endif
 
+    bool getWifiStaticIp(size_t index, uint32_t &ip, uint32_t &gateway, uint32_t &subnet, uint32_t &dns) const;
     bool getIsBaseStation() const { return isBaseStation; }
+    uint8_t getArena() const { return arena; }
     bool isInitialized() const { return initialized; }
 
     bool addWifiNetwork(const char *ssid, const char *password);
@@ -132,6 +175,8 @@ public:
     
     void printConfig() const;
     bool saveConfig() const;
+    // The shared part of a fleet config into nconf.json, see ConfigAPI::applyFleetConfig
+    static bool mergeFleetFile(const char *json, size_t len);
 
 #ifdef USE_PSRAM_FOR_CONFIG
     static ConfigManager *createInPSRAM();
@@ -147,24 +192,37 @@ namespace ConfigAPI
 
     void setDiscoServer(String dS);
     String getDiscoServer(void);
+    // Ports from the discovery service map, 0 keeps the one in the configured URL
+    void setDiscoPorts(uint16_t filePort, uint16_t gamePort, uint16_t otaPort, uint16_t sysPort);
+    // The arena's game server when it is not on the discovery server, "" for that one
+    void setDiscoGameHost(String host);
 
     String getDeviceName();
     String getDeviceRole();
     uint16_t getDeviceID();
     bool getIsBaseStation();
+    uint8_t getArena();
     String getFileServerUrl();
     String getGameServerUrl();
     String getOTAServerUrl();
     String getSysServerUrl();
+    // The same without a copy, valid until the next setDisco*() or loadConfig()
+    const tConfigEndpoint &getEndpoint(tConfigServer server);
+    const char *getServerUrl(tConfigServer server);
 
     size_t getWifiNetworkCount();
     bool getWifiNetwork(size_t index, String &ssid, String &password);
+    bool getWifiStaticIp(size_t index, uint32_t &ip, uint32_t &gateway, uint32_t &subnet, uint32_t &dns);
     bool addWifiNetwork(const char *ssid, const char *password);
     void clearWifiNetworks();
 
     void printConfig();
     bool saveConfig();
     bool loadConfig();
+    // A fleet provisioning blob (espProv.h): "wifi_networks" replaces the list,
+    // "servers" and "arena" the keys they name, the device's own name, role
+    // and ID stay. The cache is dropped, the next boot parses the file once.
+    bool applyFleetConfig(const char *json, size_t len);
 
     bool isInstanceCreated();
     void forceCleanup();
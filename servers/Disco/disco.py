@@ -23,6 +23,7 @@ def get_preferred_ip():
 
 def responder():
     ip = get_preferred_ip()
+    epoch = int(time.time())
     sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
     sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
     sock.setsockopt(socket.SOL_SOCKET, socket.SO_BROADCAST, 1)
@@ -34,6 +35,8 @@ def responder():
         print(f'Received from {addr}: {data}')  # DEBUG
         if b'ESP32-LOOK' in data:
             response = ip.encode()
+            if data.startswith(b'ESP32-LOOK2'):
+                response = f"{ip};{epoch}".encode()
             sock.sendto(response, addr)
             print(f'Sent response: {response} to {addr}')  # DEBUG
 
@@ -16,6 +16,7 @@ class DiscoveryServer:
         self.running = False
         self.threads = []
         self.sockets = []
+        self.epoch = int(time.time())
         
     def get_all_interfaces(self):
         """Get all available network interfaces with their IP addresses"""
@@ -67,9 +68,12 @@ class DiscoveryServer:
                     self.log(f"Received from {addr[0]}:{addr[1]} on {interface_name}: {data.decode('utf-8', errors='ignore')}")
                     
                     if b'ESP32-LOOK' in data:
-                        response = interface_ip.encode()
-                        sock.sendto(response, addr)
-                        self.log(f"Sent response '{interface_ip}' to {addr[0]}:{addr[1]}", "SUCCESS")
+                        reply = interface_ip
+                        # newer devices cache the server and use the epoch to spot restarts
+                        if data.startswith(b'ESP32-LOOK2'):
+                            reply = f"{interface_ip};{self.epoch}"
+                        sock.sendto(reply.encode(), addr)
+                        self.log(f"Sent response '{reply}' to {addr[0]}:{addr[1]}", "SUCCESS")
                         
                 except socket.timeout:
                     continue
@@ -0,0 +1,3 @@
+pip install pyserial
+python rssi_capture.py %*
+pause
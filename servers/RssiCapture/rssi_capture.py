@@ -0,0 +1,225 @@
+#!/usr/bin/env python3
+"""
+RSSI calibration capture.
+
+The device streams every received ESP-NOW frame over USB-CDC (serial command
+rx_stream, binary type 0x15, see lib/serialCommander/serialCommander.h and
+lib/espRadio/espRxStream.h). This script turns the stream on, writes the
+frames to a CSV file and analyses one or more captures:
+
+    python rssi_capture.py capture COM5 --label close --seconds 60 --out close.csv
+    python rssi_capture.py analyze close.csv middle.csv far.csv
+
+A capture holds one label (the distance or spot the senders were at), the
+analysis prints the RSSI distribution and loss per label and sender and the
+zone thresholds (rssiClose, rssiMiddle, rssiFar) the labels suggest: each one
+lies halfway between two neighbouring labels, so all three take four spots.
+"""
+
+import argparse
+import csv
+import struct
+import sys
+import time
+import zlib
+
+SLIP_END = 0xC0
+SLIP_ESC = 0xDB
+SLIP_ESC_END = 0xDC
+SLIP_ESC_ESC = 0xDD
+SB_RX_STREAM = 0x15
+SB_REPLY = 0x80
+SB_ERROR = 0x7F
+
+STREAM_HDR = struct.Struct('<IH')           # dropped, count
+STREAM_REC = struct.Struct('<IQHbB')        # us, deviceID, seq, rssi, role
+ROLE_NAMES = {0: 'none', 1: 'zombie', 2: 'human', 3: 'base', 4: 'server', 5: 'pinger',
+              55: 'apPortal', 100: 'rssiMonitor'}
+CSV_FIELDS = ['host_time', 'us', 'device', 'role', 'seq', 'rssi', 'label']
+
+
+def slip_frame(frame_type, seq, payload=b''):
+    body = bytes([frame_type, seq]) + payload
+    body += struct.pack('<I', zlib.crc32(body) & 0xFFFFFFFF)
+    out = bytearray([SLIP_END])
+    for c in body:
+        if c == SLIP_END:
+            out += bytes([SLIP_ESC, SLIP_ESC_END])
+        elif c == SLIP_ESC:
+            out += bytes([SLIP_ESC, SLIP_ESC_ESC])
+        else:
+            out.append(c)
+    out.append(SLIP_END)
+    return bytes(out)
+
+
+class SlipReader:
+    """Frames out of the port's bytes, log text in between fails the CRC and is skipped"""
+
+    def __init__(self):
+        self.buf = bytearray()
+        self.open = False
+        self.esc = False
+        self.skipped = 0
+
+    def feed(self, data):
+        frames = []
+        for c in data:
+            if c == SLIP_END:
+                if self.open and len(self.buf) >= 6:
+                    frame = bytes(self.buf)
+                    if zlib.crc32(frame[:-4]) & 0xFFFFFFFF == struct.unpack('<I', frame[-4:])[0]:
+                        frames.append((frame[0], frame[1], frame[2:-4]))
+                    else:
+                        self.skipped += 1
+                # an END also opens the next frame, an empty one is the gap between two
+                self.buf.clear()
+                self.open = True
+                self.esc = False
+            elif not self.open:
+                continue
+            elif self.esc:
+                self.buf.append(SLIP_END if c == SLIP_ESC_END else SLIP_ESC if c == SLIP_ESC_ESC else c)
+                self.esc = False
+            elif c == SLIP_ESC:
+                self.esc = True
+            else:
+                self.buf.append(c)
+        return frames
+
+
+def decode_stream(payload):
+    dropped, count = STREAM_HDR.unpack_from(payload, 0)
+    recs = []
+    offset = STREAM_HDR.size
+    for _ in range(count):
+        if offset + STREAM_REC.size > len(payload):
+            break
+        recs.append(STREAM_REC.unpack_from(payload, offset))
+        offset += STREAM_REC.size
+    return dropped, recs
+
+
+def capture(args):
+    try:
+        import serial
+    except ImportError:
+        print('pyserial is needed: pip install pyserial')
+        return 1
+    port = serial.Serial(args.port, args.baud, timeout=0.1)
+    reader = SlipReader()
+    port.write(slip_frame(SB_RX_STREAM, 1, b'\x01'))
+    started = time.time()
+    frames = 0
+    records = 0
+    lost_frames = 0
+    dropped = 0
+    last_seq = None
+    last_report = started
+    with open(args.out, 'w', newline='') as f:
+        writer = csv.writer(f)
+        writer.writerow(CSV_FIELDS)
+        try:
+            while (args.seconds <= 0) or (time.time() - started < args.seconds):
+                data = port.read(4096)
+                if not data:
+                    continue
+                now = time.time()
+                for frame_type, seq, payload in reader.feed(data):
+                    if frame_type == (SB_ERROR | SB_REPLY):
+                        print(f'device error: {payload[1:].decode(errors="replace")}')
+                        return 1
+                    if frame_type != (SB_RX_STREAM | SB_REPLY) or len(payload) < STREAM_HDR.size:
+                        continue        # the reply to the request itself
+                    if last_seq is not None:
+                        lost_frames += (seq - last_seq - 1) & 0xFF
+                    last_seq = seq
+                    dropped, recs = decode_stream(payload)
+                    frames += 1
+                    records += len(recs)
+                    for us, device, dseq, rssi, role in recs:
+                        writer.writerow([f'{now:.3f}', us, f'{device:014X}', ROLE_NAMES.get(role, role), dseq, rssi,
+                                         args.label])
+                if now - last_report >= 1:
+                    print(f'\r{now - started:6.0f} s  {records} frames  {lost_frames} serial frames lost  '
+                          f'{dropped} dropped on the device  {reader.bad_crc} bad CRC', end='', flush=True)
+                    last_report = now
+        except KeyboardInterrupt:
+            pass
+        finally:
+            port.write(slip_frame(SB_RX_STREAM, 2, b'\x00'))
+            port.close()
+    print(f'\n{records} frames of label "{args.label}" in {args.out}')
+    return 0
+
+
+def percentile(sorted_values, pct):
+    if not sorted_values:
+        return 0
+    pos = min(len(sorted_values) - 1, max(0, int(round(pct / 100 * (len(sorted_values) - 1)))))
+    return sorted_values[pos]
+
+
+def analyze(args):
+    samples = {}        # label -> device -> [(us, seq, rssi)]
+    for name in args.files:
+        with open(name, newline='') as f:
+            for row in csv.DictReader(f):
+                label = row['label'] or name
+                samples.setdefault(label, {}).setdefault(row['device'], []).append(
+                    (int(row['us']), int(row['seq']), int(row['rssi'])))
+    if not samples:
+        print('no frames')
+        return 1
+    medians = {}
+    print(f'{"label":<12} {"device":<16} {"frames":>7} {"loss":>6} {"min":>5} {"p10":>5} {"p50":>5} '
+          f'{"p90":>5} {"max":>5} {"mean":>6} {"std":>5} {"fps":>6}')
+    for label, devices in samples.items():
+        label_rssi = []
+        for device, recs in sorted(devices.items()):
+            recs.sort()
+            rssi = sorted(r[2] for r in recs)
+            label_rssi += rssi
+            # sender frames missing between two heard ones, packetID wraps at 16 bits
+            gaps = sum(((b[1] - a[1]) & 0xFFFF) - 1 for a, b in zip(recs, recs[1:]) if (b[1] - a[1]) & 0xFFFF)
+            expected = len(recs) + gaps
+            span_s = ((recs[-1][0] - recs[0][0]) & 0xFFFFFFFF) / 1e6
+            mean = sum(rssi) / len(rssi)
+            std = (sum((x - mean) ** 2 for x in rssi) / len(rssi)) ** 0.5
+            print(f'{label:<12} {device:<16} {len(rssi):>7} {100 * gaps / expected:>5.1f}% {rssi[0]:>5} '
+                  f'{percentile(rssi, 10):>5} {percentile(rssi, 50):>5} {percentile(rssi, 90):>5} {rssi[-1]:>5} '
+                  f'{mean:>6.1f} {std:>5.1f} {len(rssi) / span_s if span_s > 0 else 0:>6.1f}')
+        label_rssi.sort()
+        medians[label] = percentile(label_rssi, 50)
+
+    # nearest label first; a threshold sits halfway between two neighbouring medians
+    ordered = sorted(medians.items(), key=lambda kv: kv[1], reverse=True)
+    if len(ordered) < 2:
+        return 0
+    print('\nlabels by median RSSI: ' + ', '.join(f'{label} {median}' for label, median in ordered))
+    keys = ['rssiClose', 'rssiMiddle', 'rssiFar']
+    for i, key in enumerate(keys):
+        if i + 1 >= len(ordered):
+            break
+        near, far = ordered[i], ordered[i + 1]
+        print(f'"{key}": {(near[1] + far[1]) // 2}        between {near[0]} and {far[0]}')
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Capture and analyse the RSSI stream of a device')
+    sub = parser.add_subparsers(dest='cmd', required=True)
+    cap = sub.add_parser('capture', help='stream the frames of a device into a CSV file')
+    cap.add_argument('port')
+    cap.add_argument('--baud', type=int, default=115200)
+    cap.add_argument('--label', default='spot')
+    cap.add_argument('--seconds', type=float, default=0, help='0 runs until Ctrl+C')
+    cap.add_argument('--out', default='rssi_capture.csv')
+    ana = sub.add_parser('analyze', help='RSSI statistics and zone thresholds of captures')
+    ana.add_argument('files', nargs='+')
+    args = parser.parse_args()
+    return capture(args) if args.cmd == 'capture' else analyze(args)
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -1,4 +1,5 @@
 netsh advfirewall firewall add rule name="Baza Disco Server" dir=in action=allow protocol=UDP localport=4210
 netsh advfirewall firewall add rule name="Baza File Server" dir=in action=allow protocol=TCP localport=5001
 netsh advfirewall firewall add rule name="Baza Game Server" dir=in action=allow protocol=TCP localport=5000
+netsh advfirewall firewall add rule name="Baza Arena Game Servers" dir=in action=allow protocol=TCP localport=5101-5115
 pause
\ No newline at end of file
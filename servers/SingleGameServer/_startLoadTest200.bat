@@ -0,0 +1,12 @@
+@echo off
+title Zombie Game Load Test
+
+python zombie_test_client.py --load -n 200 -d 300 --json load_200.json
+
+if errorlevel 1 (
+    echo.
+    echo Load test finished with failed requests, see the table above
+    echo.
+)
+
+pause
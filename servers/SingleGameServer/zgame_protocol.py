@@ -0,0 +1,32 @@
+"""Generated by buildscript_protocol.py from protocol/zgame_messages.json, do not edit"""
+import struct
+
+API_BIN_MAGIC = 0x445A  # "ZD"
+API_BIN_VERSION = 2  # 2: the neighbours carry their delivery ratio
+MCAST_MAGIC = 0x475A  # "ZG"
+MCAST_VERSION = 1
+
+# tGameApiBinHeader: POST /api/device body: this header, then id, role, status and comment as u8 length + bytes, then neighborCount tGameApiBinNeighbor
+API_BIN_HEADER_FIELDS = ('magic', 'version', 'neighbor_count', 'ip', 'rssi', 'battery', 'health', 'z_count', 'h_count', 'b_count', 'ap_channel')
+API_BIN_HEADER_VERSIONS = {1: struct.Struct('<HBBIbBhBBBB'), 2: struct.Struct('<HBBIbBhBBBB')}
+API_BIN_HEADER = API_BIN_HEADER_VERSIONS[2]
+
+# tGameApiBinNeighbor
+API_BIN_NEIGHBOR_FIELDS = ('id', 'role', 'rssi', 'zone', 'pdr')
+API_BIN_NEIGHBOR_VERSIONS = {1: struct.Struct('<QBbB'), 2: struct.Struct('<QBbBB')}
+API_BIN_NEIGHBOR = API_BIN_NEIGHBOR_VERSIONS[2]
+
+# tGameMcastHeader: Game state multicast datagram: this header, then count tGameMcastEntry
+MCAST_HEADER_FIELDS = ('magic', 'version', 'phase', 'seq', 'server_ms', 'game_timeout', 'time_left', 'beacon_slots', 'channel', 'beacon_frame_ms', 'protocol_id', 'part', 'parts', 'count')
+MCAST_HEADER_VERSIONS = {1: struct.Struct('<HBBIQHHBBHIBBH')}
+MCAST_HEADER = MCAST_HEADER_VERSIONS[1]
+
+# tGameMcastEntry
+MCAST_ENTRY_FIELDS = ('id_hash', 'role', 'beacon_slot')
+MCAST_ENTRY_VERSIONS = {1: struct.Struct('<IBB')}
+MCAST_ENTRY = MCAST_ENTRY_VERSIONS[1]
+
+
+def unpack_fields(fmt, fields, buf, pos=0):
+    """One message as a dict, an older version of it has the first fields only"""
+    return dict(zip(fields, fmt.unpack_from(buf, pos)))
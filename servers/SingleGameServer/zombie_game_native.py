@@ -9,7 +9,7 @@ No web interface - pure Windows GUI using tkinter.
 # =============================================================================
 # VERSION: Update this version number every time you modify this code!
 # =============================================================================
-VERSION = "1.3.5"
+VERSION = "1.3.6"
 
 import tkinter as tk
 from tkinter import ttk, messagebox, font
@@ -21,8 +21,22 @@ import logging
 import socket
 import sys
 import atexit
+import struct
+import os
+import zlib
+from collections import Counter, deque
 from datetime import datetime, timedelta
-from flask import Flask, request, jsonify
+from flask import Flask, request, jsonify, Response, stream_with_context, g
+from werkzeug.serving import WSGIRequestHandler, make_server
+# Binary message layouts, generated from protocol/zgame_messages.json together
+# with the device's gameProtocol.h
+from zgame_protocol import (API_BIN_MAGIC, API_BIN_HEADER, API_BIN_HEADER_FIELDS, API_BIN_NEIGHBOR_VERSIONS,
+                            MCAST_MAGIC, MCAST_VERSION, MCAST_HEADER, MCAST_ENTRY, unpack_fields)
+
+try:
+    import waitress
+except ImportError:
+    waitress = None
 
 # Configure logging
 logging.basicConfig(
@@ -31,15 +45,64 @@ logging.basicConfig(
 )
 logger = logging.getLogger(__name__)
 
+
+def arg_value(name, default=None):
+    """The value after name on the command line"""
+    if name in sys.argv[:-1]:
+        return sys.argv[sys.argv.index(name) + 1]
+    return default
+
+
+# Arenas: one game server process per arena, "--arena N" (1..ARENA_MAX), each
+# with its own game, HTTP port, ESP-NOW session and multicast group, so a
+# venue runs as many games as it has processes or machines for. A device
+# names its arena in the discovery request ("arena" of nconf.json), the
+# discovery server hands it the game server of that arena, which announces
+# itself there every ARENA_ANNOUNCE_S. Without --arena it is arena 0, the
+# single game server of before.
+ARENA_MAX = 15
+ARENA_PORT_BASE = 5100  # arena N serves on ARENA_PORT_BASE + N, clear of the system server's ports
+ARENA_ID = min(max(int(arg_value('--arena', 0)), 0), ARENA_MAX)
+ARENA_DISCO_PORT = 4210  # the discovery responders, WIFI_DISCO_PORT of the firmware
+ARENA_ANNOUNCE_S = 5
+ARENA_DISCO_HOST = arg_value('--disco', '255.255.255.255')  # the discovery server, broadcast by default
+
 # Configuration
 SERVER_HOST = '0.0.0.0'
-SERVER_PORT = 5000
-LOCK_PORT = 47201  # Port used for single instance lock
+SERVER_PORT = ARENA_PORT_BASE + ARENA_ID if ARENA_ID else 5000
+LOCK_PORT = 47201 + ARENA_ID  # Port used for single instance lock, one per arena
 DEFAULT_HUMAN_PERCENTAGE = 50
 DEFAULT_GAME_TIMEOUT = 30
 DEFAULT_GAME_DURATION = 15
 DEFAULT_NUM_GAMERS = 16
-SETTINGS_FILE = 'zombie_game_settings.json'
+SETTINGS_FILE = f'zombie_game_settings_arena{ARENA_ID}.json' if ARENA_ID else 'zombie_game_settings.json'
+DEFAULT_ESP_CHANNEL = 9  # ESP_WIFI_CHANNEL of the firmware, until the devices report their AP's
+AP_CHANNEL_AGE_S = 30  # AP channels reported within this long decide the session channel
+AP_CHANNEL_EVAL_S = 1
+DEFAULT_PROTOCOL_ID = 123876 + ARENA_ID  # ESP_PROTOCOL_ID of the firmware, keeps the arenas' ESP-NOW apart
+BEACON_FRAME_MS = 50  # Must match BEACON_INTERVAL_MS on the devices
+BEACON_MIN_SLOT_MS = 2
+SERVER_THREADS = 128  # waitress workers, every open /api/events stream keeps one
+SERVER_DEV = '--dev-server' in sys.argv  # Flask's own server, for debugging only
+METRICS_WINDOW = 1024  # latencies kept per endpoint
+# Device report interval per game phase (next_poll_ms), fast where a state change is close
+NEXT_POLL_MS = {
+    'sleep': 10000,
+    'prepare': 5000,
+    'distribution': 1000,
+    'countdown': 1000,
+    'game': 1000,
+    'end': 5000,
+}
+NEXT_POLL_DEFAULT_MS = 1000
+NEXT_POLL_END_MS = 500  # the last seconds of a game, so the result goes out at once
+NEXT_POLL_END_S = 30
+METRICS_LOG_S = 60
+# Scheduled pre-wake: devices put to sleep wake by timer before the next event
+# start, spread by device ID over EVENT_WAKE_WINDOW_S (GAME_WAKE_* of the
+# firmware), so the fleet does not boot against the server in one storm.
+# Set with "--event HH:MM", POST /api/event or on the main screen.
+EVENT_WAKE_WINDOW_S = int(arg_value('--wake-window', 600))
 
 
 # ============== Single Instance Lock ==============
@@ -91,12 +154,94 @@ game_state = {
     'game_timeout': DEFAULT_GAME_TIMEOUT,
     'game_duration': DEFAULT_GAME_DURATION,
     'num_gamers': DEFAULT_NUM_GAMERS,
+    'esp_channel': DEFAULT_ESP_CHANNEL,
+    'ap_channel': 0,  # channel most devices' AP is on, 0 = none reported
+    'protocol_id': DEFAULT_PROTOCOL_ID,
     'game_start_time': None,
     'countdown_end_time': None,  # When countdown ends and actual game starts
+    'event_start': None,  # epoch seconds of the next event, devices pre-wake for it
     'zombies': [],
     'humans': []
 }
-devices_lock = threading.Lock()
+beacon_slots = {}  # device id -> TDMA beacon slot index
+
+
+# ============== State snapshot ==============
+class StateSnapshot:
+    """Read-only copy of the game state, replaced as a whole on every change.
+    dev_versions is the change feed: the snapshot version each device last
+    changed in, a device that did not change keeps its copy and version"""
+    __slots__ = ('version', 'game', 'devices', 'slots', 'dev_versions')
+
+    def __init__(self, version, game, devices, slots, dev_versions):
+        self.version = version
+        self.game = game
+        self.devices = devices
+        self.slots = slots
+        self.dev_versions = dev_versions
+
+
+state_snapshot = StateSnapshot(0, dict(game_state), {}, {}, {})
+
+
+def publish_snapshot():
+    """Must be called with devices_lock held"""
+    global state_snapshot
+    prev = state_snapshot
+    version = prev.version + 1
+    game = dict(game_state)
+    game['zombies'] = tuple(game_state['zombies'])
+    game['humans'] = tuple(game_state['humans'])
+    copies = {}
+    dev_versions = {}
+    for dev_id, dev in devices.items():
+        old = prev.devices.get(dev_id)
+        if old == dev:
+            copies[dev_id] = old
+            dev_versions[dev_id] = prev.dev_versions[dev_id]
+        else:
+            copies[dev_id] = dict(dev)
+            dev_versions[dev_id] = version
+    state_snapshot = StateSnapshot(version, game, copies, dict(beacon_slots), dev_versions)
+
+
+def get_snapshot():
+    """The latest state without taking devices_lock, readers must not modify it"""
+    return state_snapshot
+
+
+class StateLock:
+    """The writers' lock. Leaving it publishes a new snapshot, so the device API,
+    the multicaster and the GUI read the state without waiting for each other"""
+    def __init__(self):
+        self._lock = threading.Lock()
+
+    def __enter__(self):
+        self._lock.acquire()
+        return self
+
+    def __exit__(self, exc_type, exc, tb):
+        try:
+            publish_snapshot()
+        finally:
+            self._lock.release()
+        return False
+
+
+devices_lock = StateLock()
+
+
+def get_beacon_slot(device_id):
+    """Return the beacon slot of a device, assigning the lowest free one on first contact.
+    Must be called with devices_lock held."""
+    slot = beacon_slots.get(device_id)
+    if slot is None:
+        used = set(beacon_slots.values())
+        slot = 0
+        while slot in used:
+            slot += 1
+        beacon_slots[device_id] = slot
+    return slot
 
 
 def assign_roles():
@@ -126,66 +271,135 @@ def assign_roles():
         logger.debug(f"Assigned roles: {num_humans} humans, {total_devices - num_humans} zombies")
 
 
-# Flask API endpoint
-@app.route('/api/device', methods=['GET'])
-def device_update():
+# POST /api/device body formats advertised to the devices (bitmask, see gameComm.h)
+API_FMT_JSON = 0x01
+API_FMT_BIN = 0x02
+API_FORMATS = API_FMT_JSON | API_FMT_BIN
+API_CT_BIN = 'application/x-zgame-device'
+# Gateway batches still carry the version 1 neighbour, without the delivery ratio
+API_BIN_NEIGHBOR_V1 = API_BIN_NEIGHBOR_VERSIONS[1]
+
+# Role tags of the files a device may need next (file server /list?roles=),
+# a player can be handed either side and a human turns zombie in the game
+ASSET_ROLES_PLAYER = 'human,zombie'
+ASSET_ROLES = {'base': 'base'}
+# Phases in which a device may boot the firmware it staged in the background
+# (fw_apply), nobody plays then and the reboot takes a few seconds
+FW_APPLY_STATUSES = ('sleep', 'prepare')
+
+
+def parse_device_bin(body):
+    """Decode the fixed-layout device body, returns the same dict as the JSON formats"""
+    if len(body) < API_BIN_HEADER.size:
+        raise ValueError('short header')
+    hdr = unpack_fields(API_BIN_HEADER, API_BIN_HEADER_FIELDS, body)
+    if hdr['magic'] != API_BIN_MAGIC or hdr['version'] not in API_BIN_NEIGHBOR_VERSIONS:
+        raise ValueError('bad magic or version')
+    neighbor_fmt = API_BIN_NEIGHBOR_VERSIONS[hdr['version']]
+    pos = API_BIN_HEADER.size
+    strings = []
+    for _ in range(4):
+        if pos >= len(body):
+            raise ValueError('short string')
+        length = body[pos]
+        strings.append(body[pos + 1:pos + 1 + length].decode('utf-8', 'replace'))
+        pos += 1 + length
+    neighbors = []
+    for _ in range(hdr['neighbor_count']):
+        if pos + neighbor_fmt.size > len(body):
+            raise ValueError('short neighbor list')
+        neighbors.append(list(neighbor_fmt.unpack_from(body, pos)))
+        pos += neighbor_fmt.size
+    return {
+        'id': strings[0],
+        'ip': socket.inet_ntoa(struct.pack('<I', hdr['ip'])),
+        'rssi': hdr['rssi'],
+        'role': strings[1],
+        'status': strings[2],
+        'health': hdr['health'],
+        'battery': hdr['battery'],
+        'comment': strings[3],
+        'z': hdr['z_count'],
+        'h': hdr['h_count'],
+        'b': hdr['b_count'],
+        'ap_ch': hdr['ap_channel'],
+        'neighbors': neighbors
+    }
+
+
+def read_device_request():
+    """Returns (data, error) for the GET ?data= and both POST formats"""
+    if request.method == 'POST':
+        if request.mimetype == API_CT_BIN:
+            try:
+                return parse_device_bin(request.get_data()), None
+            except ValueError as e:
+                return None, f'Invalid binary body: {e}'
+        data = request.get_json(silent=True)
+        if data is None:
+            return None, 'Invalid JSON format'
+        return data, None
+
     data_str = request.args.get('data')
     if not data_str:
-        return jsonify({'error': 'No data provided'}), 400
-
+        return None, 'No data provided'
     try:
-        data = json.loads(data_str)
+        return json.loads(data_str), None
     except json.JSONDecodeError:
-        return jsonify({'error': 'Invalid JSON format'}), 400
+        return None, 'Invalid JSON format'
 
-    if not all(key in data for key in ['id', 'ip', 'rssi', 'role', 'status', 'health', 'battery', 'comment']):
-        return jsonify({'error': 'Missing required fields'}), 400
 
-    with devices_lock:
-        if game_state['status'] == 'game' and data['role'] in ['human', 'zombie']:
-            role = data['role']
-            if data['id'] in game_state['humans'] and role == 'zombie':
-                game_state['humans'].remove(data['id'])
-                game_state['zombies'].append(data['id'])
-            elif data['id'] in game_state['zombies'] and role == 'human':
-                game_state['zombies'].remove(data['id'])
-                game_state['humans'].append(data['id'])
-        else:
-            if game_state['status'] == 'sleep':
-                role = 'neutral'
-            else:
-                role = devices.get(data['id'], {}).get('role', 'neutral')
-
-        devices[data['id']] = {
-            'id': data['id'],
-            'ip': data['ip'],
-            'rssi': data['rssi'],
-            'role': role,
-            'status': data['status'],
-            'health': data['health'],
-            'battery': data['battery'],
-            'comment': data['comment'],
-            'last_updated': time.time()
-        }
+def build_device_response(device_id):
+    """State a device needs: its role, the game phase and the session radio settings.
+    Must be called with devices_lock held."""
+    beacon_slot = get_beacon_slot(device_id)
+    return state_response(game_state, devices.get(device_id, {}), beacon_slot, len(beacon_slots))
+
+
+def snapshot_response(snap, device_id):
+    """build_device_response() from a snapshot, a device without a slot gets -1"""
+    return state_response(snap.game, snap.devices.get(device_id, {}), snap.slots.get(device_id, -1), len(snap.slots))
 
+
+def state_response(game_state, device, beacon_slot, slot_count):
+    """The response body, from the live state or a snapshot of it"""
+    slot_count = max(slot_count, 1)
     response = {
-        'role': devices[data['id']]['role'],
+        'role': device.get('role', 'neutral'),
         'status': game_state['status'],
         'game_timeout': game_state['game_timeout'],
-        'game_duration': game_state['game_duration']
+        'game_duration': game_state['game_duration'],
+        'beacon_slot': beacon_slot,
+        'beacon_slots': slot_count,
+        'beacon_frame_ms': max(BEACON_FRAME_MS, slot_count * BEACON_MIN_SLOT_MS),
+        'server_ms': int(time.time() * 1000),
+        'channel': game_state['ap_channel'] or game_state['esp_channel'],
+        'protocol_id': game_state['protocol_id'],
+        'api_formats': API_FORMATS,
+        'asset_roles': ASSET_ROLES.get(device.get('role'), ASSET_ROLES_PLAYER),
+        'next_poll_ms': NEXT_POLL_MS.get(game_state['status'], NEXT_POLL_DEFAULT_MS),
+        # always sent, 0 clears the devices' timer wake
+        'event_start_ms': int(game_state['event_start'] * 1000) if game_state.get('event_start') else 0,
+        'wake_window_ms': EVENT_WAKE_WINDOW_S * 1000,
+        'fw_apply': game_state['status'] in FW_APPLY_STATUSES
     }
     
     # Calculate remaining seconds for game_duration during countdown or game
+    # phase_end_ms is on the server_ms clock, the devices count down to it themselves
     if game_state['status'] == 'countdown' and game_state['countdown_end_time']:
         # During countdown, return countdown seconds remaining
         countdown_remaining = (game_state['countdown_end_time'] - datetime.now()).total_seconds()
         response['game_duration'] = max(0, int(countdown_remaining))
+        response['phase_end_ms'] = int(game_state['countdown_end_time'].timestamp() * 1000)
     elif game_state['status'] == 'game' and game_state['game_start_time']:
         # During game, return game seconds remaining
         elapsed = (datetime.now() - game_state['game_start_time']).total_seconds()
         total_duration_seconds = game_state['game_duration'] * 60
         remaining = total_duration_seconds - elapsed
         response['game_duration'] = max(0, int(remaining))
+        response['phase_end_ms'] = int((game_state['game_start_time'].timestamp() + total_duration_seconds) * 1000)
+        if remaining <= NEXT_POLL_END_S:
+            response['next_poll_ms'] = NEXT_POLL_END_MS
     
     # When game is ended, override role with winner information
     if game_state['status'] == 'end':
@@ -197,12 +411,754 @@ def device_update():
             response['role'] = 'hwin'
         else:
             response['role'] = 'draw'
-    
+
+    return response
+
+
+# ============== Request metrics ==============
+class RequestMetrics:
+    """Per-endpoint latency of the API requests, the last METRICS_WINDOW of each.
+    A streamed response counts until its first byte"""
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.samples = {}
+        self.counts = {}
+        self.started = time.time()
+        self.last_log = time.time()
+
+    def record(self, endpoint, ms):
+        with self.lock:
+            self.samples.setdefault(endpoint, deque(maxlen=METRICS_WINDOW)).append(ms)
+            self.counts[endpoint] = self.counts.get(endpoint, 0) + 1
+            log_now = time.time() - self.last_log >= METRICS_LOG_S
+            if log_now:
+                self.last_log = time.time()
+        if log_now:
+            for name, stats in self.summary().items():
+                logger.info(f"API {name}: {stats['count']} requests, {stats['rps']}/s, "
+                            f"p50 {stats['p50_ms']} ms, p95 {stats['p95_ms']} ms, max {stats['max_ms']} ms")
+
+    def summary(self):
+        with self.lock:
+            windows = {name: sorted(window) for name, window in self.samples.items()}
+            counts = dict(self.counts)
+        uptime = max(time.time() - self.started, 1)
+        result = {}
+        for name, window in windows.items():
+            result[name] = {
+                'count': counts[name],
+                'rps': round(counts[name] / uptime, 2),
+                'avg_ms': round(sum(window) / len(window), 2),
+                'p50_ms': round(window[len(window) // 2], 2),
+                'p95_ms': round(window[min(len(window) - 1, len(window) * 95 // 100)], 2),
+                'max_ms': round(window[-1], 2)
+            }
+        return result
+
+
+request_metrics = RequestMetrics()
+
+
+@app.before_request
+def metrics_start():
+    g.request_start = time.perf_counter()
+
+
+@app.after_request
+def metrics_stop(response):
+    start = g.get('request_start')
+    if start is not None and request.endpoint:
+        request_metrics.record(request.endpoint, (time.perf_counter() - start) * 1000)
+    return response
+
+
+@app.route('/api/metrics', methods=['GET'])
+def metrics():
+    return jsonify({'version': VERSION, 'devices': len(get_snapshot().devices),
+                    'server': 'dev' if SERVER_DEV else ('waitress' if waitress else 'threaded'),
+                    'endpoints': request_metrics.summary()})
+
+
+def parse_event_start(value):
+    """Epoch seconds from epoch seconds or "HH:MM" (the next one), None for none"""
+    if value in (None, '', 0):
+        return None
+    if isinstance(value, (int, float)):
+        return float(value)
+    hour, minute = (int(part) for part in str(value).split(':'))
+    start = datetime.now().replace(hour=hour, minute=minute, second=0, microsecond=0)
+    if start <= datetime.now():
+        start += timedelta(days=1)
+    return start.timestamp()
+
+
+def set_event_start(start):
+    """Must be called with devices_lock held"""
+    game_state['event_start'] = start
+    publish_snapshot()
+    if start:
+        logger.info(f"Next event at {datetime.fromtimestamp(start):%Y-%m-%d %H:%M}, "
+                    f"devices wake over the {EVENT_WAKE_WINDOW_S} s before")
+    else:
+        logger.info("Next event cleared")
+
+
+@app.route('/api/event', methods=['GET', 'POST'])
+def event_start():
+    """{"start": epoch seconds | "HH:MM" | null} sets the next event start"""
+    if request.method == 'POST':
+        data = request.get_json(silent=True) or {}
+        try:
+            start = parse_event_start(data.get('start'))
+        except (TypeError, ValueError):
+            return jsonify({'error': 'start must be epoch seconds, "HH:MM" or null'}), 400
+        with devices_lock:
+            set_event_start(start)
+    start = get_snapshot().game.get('event_start')
+    return jsonify({'event_start_ms': int(start * 1000) if start else 0,
+                    'wake_window_ms': EVENT_WAKE_WINDOW_S * 1000})
+
+
+# Push channel: the state of one device as server-sent events, sent on every change
+# (server_ms aside) and as a comment line every PUSH_KEEPALIVE_S so dead peers are noticed
+PUSH_CHECK_S = 0.1
+PUSH_KEEPALIVE_S = 10
+
+
+@app.route('/api/events', methods=['GET'])
+def device_events():
+    device_id = request.args.get('id')
+    if not device_id:
+        return jsonify({'error': 'No id provided'}), 400
+
+    def stream():
+        last_key = None
+        last_sent = 0
+        while True:
+            response = snapshot_response(get_snapshot(), device_id)
+            key = {k: v for k, v in response.items() if k != 'server_ms'}
+            now = time.time()
+            if key != last_key:
+                last_key = key
+                last_sent = now
+                yield f"data: {json.dumps(response, separators=(',', ':'))}\n\n"
+            elif now - last_sent >= PUSH_KEEPALIVE_S:
+                last_sent = now
+                yield ": keepalive\n\n"
+            time.sleep(PUSH_CHECK_S)
+
+    return Response(stream_with_context(stream()), mimetype='text/event-stream',
+                    headers={'Cache-Control': 'no-cache'})
+
+
+# Flask API endpoint
+@app.route('/api/device', methods=['GET', 'POST'])
+def device_update():
+    data, error = read_device_request()
+    if error:
+        return jsonify({'error': error}), 400
+
+    if not all(key in data for key in ['id', 'ip', 'rssi', 'role', 'status', 'health', 'battery', 'comment']):
+        return jsonify({'error': 'Missing required fields'}), 400
+
+    with devices_lock:
+        apply_device_update(data)
+        response = build_device_response(data['id'])
+
     return jsonify(response)
 
 
+def apply_device_update(data):
+    """Stores one device report and follows its role changes during the game.
+    Must be called with devices_lock held."""
+    if game_state['status'] == 'game' and data['role'] in ['human', 'zombie']:
+        role = data['role']
+        if data['id'] in game_state['humans'] and role == 'zombie':
+            game_state['humans'].remove(data['id'])
+            game_state['zombies'].append(data['id'])
+        elif data['id'] in game_state['zombies'] and role == 'human':
+            game_state['zombies'].remove(data['id'])
+            game_state['humans'].append(data['id'])
+    else:
+        if game_state['status'] == 'sleep':
+            role = 'neutral'
+        else:
+            role = devices.get(data['id'], {}).get('role', 'neutral')
+
+    devices[data['id']] = {
+        'id': data['id'],
+        'ip': data['ip'],
+        'rssi': data['rssi'],
+        'role': role,
+        'status': data['status'],
+        'health': data['health'],
+        'battery': data['battery'],
+        'comment': data['comment'],
+        'neighbors': data.get('neighbors', []),
+        'near_counts': (data.get('z', 0), data.get('h', 0), data.get('b', 0)),
+        'ap_channel': data.get('ap_ch', 0),
+        'last_updated': time.time()
+    }
+    update_ap_channel()
+
+
+ap_channel_eval_at = 0
+
+
+def update_ap_channel():
+    """ESP-NOW has to be on the channel of the AP the devices talk HTTP through,
+    else their radio hops between the two; the session channel follows the one
+    most of them report. Must be called with devices_lock held."""
+    global ap_channel_eval_at
+    now = time.time()
+    if now - ap_channel_eval_at < AP_CHANNEL_EVAL_S:
+        return
+    ap_channel_eval_at = now
+    counts = Counter(d['ap_channel'] for d in devices.values()
+                     if d.get('ap_channel') and now - d['last_updated'] < AP_CHANNEL_AGE_S)
+    channel = counts.most_common(1)[0][0] if counts else 0
+    if channel != game_state['ap_channel']:
+        logger.info(f"ESP-NOW channel {channel or game_state['esp_channel']}, "
+                    f"the AP channels reported: {dict(counts)}")
+        game_state['ap_channel'] = channel
+
+
+# ESP-NOW gateway batches (see xBeacon/src/jobGateway.cpp): the reports of the
+# players in range of a gateway, each naming the device by its multicast id hash.
+# A player must have reported directly once so its name is known here
+GW_CT_BATCH = 'application/x-zgame-batch'
+GW_BATCH_MAGIC = 0x4247
+GW_BATCH_VERSION = 1
+GW_BATCH_HEADER = struct.Struct('<HBBI')
+GW_BATCH_RECORD = struct.Struct('<IQHBbhBBBBB')
+GW_ROLES = {1: 'zombie', 2: 'human', 3: 'base'}
+
+
+def parse_gateway_batch(body):
+    """Decode a gateway batch into (seq, records), each record a dict"""
+    if len(body) < GW_BATCH_HEADER.size:
+        raise ValueError('short header')
+    magic, version, count, seq = GW_BATCH_HEADER.unpack_from(body, 0)
+    if magic != GW_BATCH_MAGIC or version != GW_BATCH_VERSION:
+        raise ValueError('bad magic or version')
+    pos = GW_BATCH_HEADER.size
+    records = []
+    for _ in range(count):
+        if pos + GW_BATCH_RECORD.size > len(body):
+            raise ValueError('short record')
+        (name_hash, device_mac, age_ms, role, rssi, health, battery,
+         z_count, h_count, b_count, neighbor_count) = GW_BATCH_RECORD.unpack_from(body, pos)
+        pos += GW_BATCH_RECORD.size
+        neighbors = []
+        for _ in range(neighbor_count):
+            if pos + API_BIN_NEIGHBOR_V1.size > len(body):
+                raise ValueError('short neighbor list')
+            neighbors.append(list(API_BIN_NEIGHBOR_V1.unpack_from(body, pos)))
+            pos += API_BIN_NEIGHBOR_V1.size
+        records.append({
+            'hash': name_hash,
+            'mac': device_mac,
+            'age_ms': age_ms,
+            'role': GW_ROLES.get(role, 'neutral'),
+            'gw_rssi': rssi,
+            'health': health,
+            'battery': battery,
+            'z': z_count,
+            'h': h_count,
+            'b': b_count,
+            'neighbors': neighbors
+        })
+    return seq, records
+
+
+@app.route('/api/gateway', methods=['POST'])
+def gateway_update():
+    if request.mimetype != GW_CT_BATCH:
+        return jsonify({'error': 'Unsupported content type'}), 415
+    try:
+        seq, records = parse_gateway_batch(request.get_data())
+    except ValueError as e:
+        return jsonify({'error': f'Invalid batch: {e}'}), 400
+
+    applied = 0
+    unknown = 0
+    with devices_lock:
+        by_hash = {mcast_id_hash(dev_id): dev_id for dev_id in devices}
+        for rec in records:
+            dev_id = by_hash.get(rec['hash'])
+            if dev_id is None:
+                unknown += 1
+                continue
+            known = devices[dev_id]
+            apply_device_update({
+                'id': dev_id,
+                'ip': known['ip'],
+                'rssi': known['rssi'],
+                'role': rec['role'],
+                'status': known['status'],
+                'health': rec['health'],
+                'battery': rec['battery'],
+                'comment': known['comment'],
+                'neighbors': rec['neighbors'],
+                'z': rec['z'],
+                'h': rec['h'],
+                'b': rec['b']
+            })
+            applied += 1
+    logger.debug(f"Gateway batch {seq} from {request.remote_addr}: {applied} applied, {unknown} unknown")
+    return jsonify({'seq': seq, 'applied': applied, 'unknown': unknown})
+
+
+# Game analytics logs (see gameLog.h): one deflated log per device and game,
+# sent in the result phase. Kept per game, in memory for the last few and as
+# JSON under GAME_LOG_DIR, for the replay view and balance tuning
+GAME_LOG_CT = 'application/x-zgame-log'
+GAME_LOG_MAGIC = 0x314C475A
+GAME_LOG_VERSION = 1
+GAME_LOG_HEADER = struct.Struct('<IBBHIQIhBB')
+GAME_LOG_FLAG_TRUNCATED = 0x01
+GAME_LOG_DIR = os.path.join('game_logs', f'arena{ARENA_ID}') if ARENA_ID else 'game_logs'
+GAME_LOG_KEEP = 16  # games kept in memory
+GAME_LOG_MAX_BYTES = 1024 * 1024  # inflated, the device buffer is 64 KB
+GL_HEALTH, GL_COUNTS, GL_ZONE, GL_ROLE, GL_API_RTT, GL_HIT_LAT, GL_END = range(1, 8)
+GL_DEVICE_ROLES = {0: 'none', 1: 'zombie', 2: 'human', 3: 'base'}
+GL_ZONES = ['out', 'far', 'middle', 'close']
+HIT_LAT_STAGES = ['react', 'screen']
+HIT_LAT_BUCKETS = 12
+
+
+def read_varint(body, pos):
+    value = 0
+    shift = 0
+    while True:
+        if pos >= len(body):
+            raise ValueError('short varint')
+        b = body[pos]
+        pos += 1
+        value |= (b & 0x7F) << shift
+        if b < 0x80:
+            return value, pos
+        shift += 7
+
+
+def parse_game_log(body):
+    """Decode an inflated game log into its header fields and the event list,
+    every event with its ms since the start ('t') and absolute health"""
+    if len(body) < GAME_LOG_HEADER.size + 1:
+        raise ValueError('short header')
+    (magic, version, flags, event_count, protocol_id, start_shared_ms, duration_ms,
+     start_health, start_role, _) = GAME_LOG_HEADER.unpack_from(body, 0)
+    if magic != GAME_LOG_MAGIC or version != GAME_LOG_VERSION:
+        raise ValueError('bad magic or version')
+    pos = GAME_LOG_HEADER.size
+    name_len = body[pos]
+    name = body[pos + 1:pos + 1 + name_len].decode('utf-8', 'replace')
+    pos += 1 + name_len
+
+    t = 0
+    health = start_health
+    events = []
+    result = None
+    hit_latency = None
+    while pos < len(body):
+        dt, pos = read_varint(body, pos)
+        t += dt
+        if pos >= len(body):
+            raise ValueError('short event')
+        kind = body[pos]
+        pos += 1
+        if kind == GL_HEALTH:
+            zz, pos = read_varint(body, pos)
+            health += (zz >> 1) ^ -(zz & 1)
+            events.append({'t': t, 'type': 'health', 'health': health})
+        elif kind == GL_COUNTS:
+            z, h, b = struct.unpack_from('<BBB', body, pos)
+            pos += 3
+            events.append({'t': t, 'type': 'counts', 'z': z, 'h': h, 'b': b})
+        elif kind == GL_ZONE:
+            neighbor, zone, rssi = struct.unpack_from('<QBb', body, pos)
+            pos += 10
+            events.append({'t': t, 'type': 'zone', 'neighbor': f'{neighbor:012X}',
+                           'zone': GL_ZONES[zone] if zone < len(GL_ZONES) else zone, 'rssi': rssi})
+        elif kind == GL_ROLE:
+            role = body[pos]
+            pos += 1
+            events.append({'t': t, 'type': 'role', 'role': GL_DEVICE_ROLES.get(role, role)})
+        elif kind == GL_API_RTT:
+            ms, pos = read_varint(body, pos)
+            events.append({'t': t, 'type': 'api_rtt', 'ms': ms})
+        elif kind == GL_HIT_LAT:
+            hit_latency = {}
+            for stage in HIT_LAT_STAGES:
+                count, pos = read_varint(body, pos)
+                max_ms, pos = read_varint(body, pos)
+                hist = []
+                for _ in range(HIT_LAT_BUCKETS):
+                    n, pos = read_varint(body, pos)
+                    hist.append(n)
+                hit_latency[stage] = {'n': count, 'max': max_ms, 'hist': hist}
+        elif kind == GL_END:
+            code = body[pos]
+            pos += 1
+            result = MCAST_ROLES[code] if code < len(MCAST_ROLES) else code
+        else:
+            raise ValueError(f'unknown event {kind}')
+    return {
+        'id': name,
+        'protocol_id': protocol_id,
+        'start_shared_ms': start_shared_ms,
+        'duration_ms': duration_ms,
+        'start_health': start_health,
+        'start_role': GL_DEVICE_ROLES.get(start_role, start_role),
+        'truncated': bool(flags & GAME_LOG_FLAG_TRUNCATED),
+        'event_count': event_count,
+        'result': result,
+        'hit_latency': hit_latency,
+        'events': events
+    }
+
+
+class GameLogStore:
+    """Device logs per game. A game is named by the time its play phase began,
+    logs that come in after the server went back to sleep join the last one"""
+    def __init__(self, folder=GAME_LOG_DIR, keep=GAME_LOG_KEEP):
+        self.folder = folder
+        self.keep = keep
+        self.lock = threading.Lock()
+        self.games = {}
+        self.order = deque()
+        self.current = None
+
+    def begin(self, started):
+        with self.lock:
+            self.current = started.strftime('%Y%m%d_%H%M%S')
+
+    def add(self, log, started=None):
+        key = started.strftime('%Y%m%d_%H%M%S') if started else None
+        with self.lock:
+            key = key or self.current or 'unknown'
+            if key not in self.games:
+                self.games[key] = {}
+                self.order.append(key)
+                while len(self.order) > self.keep:
+                    self.games.pop(self.order.popleft(), None)
+            self.games[key][log['id']] = log
+        try:
+            path = os.path.join(self.folder, key)
+            os.makedirs(path, exist_ok=True)
+            name = ''.join(c if c.isalnum() or c in '-_' else '_' for c in log['id'])
+            with open(os.path.join(path, f'{name}.json'), 'w', encoding='utf-8') as f:
+                json.dump(log, f, separators=(',', ':'))
+        except OSError as e:
+            logger.warning(f"Game log of {log['id']} not saved: {e}")
+        return key
+
+    def listing(self):
+        with self.lock:
+            return {key: sorted(self.games[key]) for key in self.order}
+
+    def device(self, key, device_id):
+        with self.lock:
+            return self.games.get(key, {}).get(device_id)
+
+    def timeline(self, key):
+        """All devices of a game on one time line: on the shared clock where the
+        device had it, else from the device's own start"""
+        with self.lock:
+            logs = dict(self.games.get(key, {}))
+        if not logs:
+            return None
+        shared = [log['start_shared_ms'] for log in logs.values() if log['start_shared_ms']]
+        origin = min(shared) if shared else 0
+        devices_info = {}
+        merged = []
+        for dev_id, log in logs.items():
+            offset = (log['start_shared_ms'] - origin) if log['start_shared_ms'] else 0
+            devices_info[dev_id] = {k: v for k, v in log.items() if k != 'events'}
+            for ev in log['events']:
+                merged.append(dict(ev, t=ev['t'] + offset, id=dev_id))
+        merged.sort(key=lambda ev: ev['t'])
+        return {'game': key, 'shared_clock': bool(shared), 'devices': devices_info, 'events': merged}
+
+
+game_logs = GameLogStore()
+
+
+@app.route('/api/gamelog', methods=['GET', 'POST'])
+def game_log():
+    if request.method == 'GET':
+        key = request.args.get('game')
+        if not key:
+            return jsonify({'games': game_logs.listing()})
+        device_id = request.args.get('id')
+        result = game_logs.device(key, device_id) if device_id else game_logs.timeline(key)
+        if result is None:
+            return jsonify({'error': 'Unknown game or device'}), 404
+        return jsonify(result)
+
+    if request.mimetype != GAME_LOG_CT:
+        return jsonify({'error': 'Unsupported content type'}), 415
+    try:
+        inflater = zlib.decompressobj()
+        body = inflater.decompress(request.get_data(), GAME_LOG_MAX_BYTES)
+        if inflater.unconsumed_tail:
+            raise ValueError('log too large')
+        log = parse_game_log(body)
+    except (zlib.error, ValueError, struct.error, IndexError) as e:
+        return jsonify({'error': f'Invalid game log: {e}'}), 400
+    key = game_logs.add(log, game_state['game_start_time'])
+    logger.info(f"Game log {key} from {log['id']}: {len(log['events'])} events, {log['duration_ms']} ms"
+                f"{', truncated' if log['truncated'] else ''}")
+    return jsonify({'game': key, 'events': len(log['events'])})
+
+
+# Game state multicast (see gameMcast.h): every tick, and right after a change,
+# all devices get the phase, time left and the role table in one datagram set
+MCAST_GROUP = f'239.77.71.{1 + ARENA_ID}'  # gameMcastGroup() of the device's arena
+MCAST_PORT = 4211
+MCAST_TICK_S = 1.0
+MCAST_CHECK_S = 0.1
+MCAST_ENTRIES_PER_PART = 200
+MCAST_PHASES = ['sleep', 'prepare', 'distribution', 'countdown', 'game', 'end']
+MCAST_ROLES = ['neutral', 'zombie', 'human', 'base', 'zwin', 'hwin', 'draw']
+
+
+def mcast_id_hash(device_id):
+    """FNV-1a, the same as gameMcastIdHash() on the device"""
+    h = 2166136261
+    for b in device_id.encode('utf-8'):
+        h = ((h ^ b) * 16777619) & 0xFFFFFFFF
+    return h
+
+
+class GameStateMulticaster(threading.Thread):
+    """Background thread sending the game state as UDP multicast"""
+    def __init__(self):
+        super().__init__()
+        self.daemon = True
+        self.seq = 0
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM, socket.IPPROTO_UDP)
+        self.sock.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_TTL, 1)
+
+    def snapshot(self):
+        snap = get_snapshot()
+        responses = {dev_id: snapshot_response(snap, dev_id) for dev_id in snap.devices}
+        common = next(iter(responses.values())) if responses else None
+        return common, responses
+
+    def build_datagrams(self, common, responses):
+        entries = [MCAST_ENTRY.pack(mcast_id_hash(dev_id),
+                                    MCAST_ROLES.index(r['role']) if r['role'] in MCAST_ROLES else 0,
+                                    min(max(r['beacon_slot'], 0), 255))
+                   for dev_id, r in responses.items()]
+        parts = [entries[i:i + MCAST_ENTRIES_PER_PART] for i in range(0, len(entries), MCAST_ENTRIES_PER_PART)] or [[]]
+        phase = MCAST_PHASES.index(common['status']) if common['status'] in MCAST_PHASES else 255
+        datagrams = []
+        for index, part in enumerate(parts):
+            header = MCAST_HEADER.pack(MCAST_MAGIC, MCAST_VERSION, phase, self.seq, common['server_ms'],
+                                       common['game_timeout'] & 0xFFFF, common['game_duration'] & 0xFFFF,
+                                       min(common['beacon_slots'], 255), common['channel'] & 0xFF,
+                                       common['beacon_frame_ms'] & 0xFFFF, common['protocol_id'] & 0xFFFFFFFF,
+                                       index, len(parts), len(part))
+            datagrams.append(header + b''.join(part))
+        return datagrams
+
+    def run(self):
+        logger.info(f"Game state multicast on {MCAST_GROUP}:{MCAST_PORT}")
+        last_key = None
+        last_sent = 0
+        while True:
+            time.sleep(MCAST_CHECK_S)
+            try:
+                common, responses = self.snapshot()
+                if common is None:
+                    continue
+                key = {k: {f: v for f, v in r.items() if f != 'server_ms'} for k, r in responses.items()}
+                now = time.time()
+                if key == last_key and now - last_sent < MCAST_TICK_S:
+                    continue
+                last_key = key
+                last_sent = now
+                self.seq = (self.seq + 1) & 0xFFFFFFFF
+                for datagram in self.build_datagrams(common, responses):
+                    self.sock.sendto(datagram, (MCAST_GROUP, MCAST_PORT))
+            except OSError as e:
+                logger.warning(f"Game state multicast failed: {e}")
+
+
+class ArenaAnnouncer(threading.Thread):
+    """Background thread telling the discovery servers where this arena's game
+    server is: "ZGAME-ARENA;<arena>;<port>;<started>", forgotten there when it stops"""
+    def __init__(self):
+        super().__init__()
+        self.daemon = True
+        self.started = int(time.time())
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.sock.setsockopt(socket.SOL_SOCKET, socket.SO_BROADCAST, 1)
+
+    def run(self):
+        logger.info(f"Arena {ARENA_ID} announced to {ARENA_DISCO_HOST}:{ARENA_DISCO_PORT}")
+        message = f"ZGAME-ARENA;{ARENA_ID};{SERVER_PORT};{self.started}".encode()
+        while True:
+            try:
+                self.sock.sendto(message, (ARENA_DISCO_HOST, ARENA_DISCO_PORT))
+            except OSError as e:
+                logger.warning(f"Arena announce failed: {e}")
+            time.sleep(ARENA_ANNOUNCE_S)
+
+
+# Crash recovery: a journal of the game state, one JSON record per line,
+# appended when a snapshot changes what a restart needs. A record holds the
+# game when it changed, the beacon slots when they changed, the devices that
+# changed and the ones that are gone; the file starts with a full record and
+# is rewritten as one past STATE_LOG_COMPACT records. On start the records are
+# replayed, a torn last line dropped, and a journal written to within
+# STATE_RESTORE_MAX_AGE_S continues: the devices get their roles, slots and
+# the clock of the running game with their next poll
+STATE_LOG_FILE = f'zombie_game_state_arena{ARENA_ID}.log' if ARENA_ID else 'zombie_game_state.log'
+STATE_LOG_CHECK_S = 0.5
+STATE_LOG_COMPACT = 2000
+STATE_RESTORE_MAX_AGE_S = 1800
+STATE_RESTORE = '--fresh' not in sys.argv
+STATE_DEVICE_FIELDS = ('id', 'ip', 'role', 'status', 'health', 'battery', 'comment', 'ap_channel')
+STATE_TIME_FIELDS = ('game_start_time', 'countdown_end_time')  # datetimes, journaled as epoch seconds
+state_restored = False  # the GUI resumes the restored screen instead of starting at the main one
+
+
+def journal_game(game):
+    out = dict(game)
+    out['zombies'] = list(game['zombies'])
+    out['humans'] = list(game['humans'])
+    for key in STATE_TIME_FIELDS:
+        if out.get(key) is not None:
+            out[key] = out[key].timestamp()
+    return out
+
+
+def journal_device(device):
+    """The fields a restart needs, the ones every poll changes are left out"""
+    return {field: device.get(field) for field in STATE_DEVICE_FIELDS}
+
+
+class StateJournal(threading.Thread):
+    """Background thread appending the state changes to STATE_LOG_FILE"""
+    def __init__(self, path=STATE_LOG_FILE):
+        super().__init__()
+        self.daemon = True
+        self.path = path
+        self.file = None
+        self.records = 0
+        self.game = None  # as last journaled
+        self.slots = None
+        self.devices = {}
+
+    def write(self, record):
+        self.file.write(json.dumps(record, separators=(',', ':')) + '\n')
+        self.file.flush()
+        os.fsync(self.file.fileno())
+        self.records += 1
+
+    def compact(self, now):
+        tmp = self.path + '.tmp'
+        with open(tmp, 'w', encoding='utf-8') as f:
+            f.write(json.dumps({'t': now, 'full': True, 'game': self.game, 'slots': self.slots,
+                                'dev': self.devices}, separators=(',', ':')) + '\n')
+            f.flush()
+            os.fsync(f.fileno())
+        if self.file:
+            self.file.close()
+        os.replace(tmp, self.path)
+        self.file = open(self.path, 'a', encoding='utf-8')
+        self.records = 1
+
+    def step(self, version):
+        snap = get_snapshot()
+        if snap.version == version:
+            return version
+        now = time.time()
+        game = journal_game(snap.game)
+        slots = dict(snap.slots)
+        devs = {dev_id: journal_device(dev) for dev_id, dev in snap.devices.items()}
+        record = {'t': now}
+        if game != self.game:
+            record['game'] = game
+        if slots != self.slots:
+            record['slots'] = slots
+        changed = {dev_id: dev for dev_id, dev in devs.items() if self.devices.get(dev_id) != dev}
+        if changed:
+            record['dev'] = changed
+        gone = [dev_id for dev_id in self.devices if dev_id not in devs]
+        if gone:
+            record['gone'] = gone
+        self.game, self.slots, self.devices = game, slots, devs
+        if self.file is None or self.records >= STATE_LOG_COMPACT:
+            self.compact(now)
+        elif len(record) > 1:
+            self.write(record)
+        return snap.version
+
+    def run(self):
+        logger.info(f"Game state journal in {self.path}")
+        version = -1
+        while True:
+            time.sleep(STATE_LOG_CHECK_S)
+            try:
+                version = self.step(version)
+            except OSError as e:
+                logger.warning(f"Game state journal failed: {e}")
+                self.file = None
+
+
+def restore_state(path=STATE_LOG_FILE):
+    """Replays the journal into game_state, devices and beacon_slots, before the
+    API starts; True when a recent game was restored"""
+    global state_restored
+    game, slots, devs, last = None, {}, {}, 0
+    try:
+        with open(path, 'r', encoding='utf-8') as f:
+            for line in f:
+                try:
+                    record = json.loads(line)
+                except ValueError:
+                    logger.warning(f"Torn record in {path} dropped")
+                    break
+                if record.get('full'):
+                    slots, devs = {}, {}
+                game = record.get('game', game)
+                slots = record.get('slots', slots)
+                devs.update(record.get('dev', {}))
+                for dev_id in record.get('gone', []):
+                    devs.pop(dev_id, None)
+                last = record.get('t', last)
+    except FileNotFoundError:
+        return False
+    except OSError as e:
+        logger.error(f"Error reading {path}: {e}")
+        return False
+    age = time.time() - last
+    if game is None or age > STATE_RESTORE_MAX_AGE_S:
+        logger.info(f"Game state journal {path} is {int(age)} s old, not restored")
+        return False
+    with devices_lock:
+        for key in STATE_TIME_FIELDS:
+            if game.get(key) is not None:
+                game[key] = datetime.fromtimestamp(game[key])
+        game_state.update(game)
+        beacon_slots.clear()
+        beacon_slots.update(slots)
+        devices.clear()
+        for dev_id, dev in devs.items():
+            devices[dev_id] = dict(dev, rssi=0, neighbors=[], near_counts=(0, 0, 0), last_updated=last)
+    if game_state['status'] == 'game' and game_state['game_start_time']:
+        game_logs.begin(game_state['game_start_time'])
+    state_restored = True
+    logger.info(f"Restored '{game_state['status']}' with {len(devs)} devices from {path}, {int(age)} s old")
+    return True
+
+
 class FlaskThread(threading.Thread):
-    """Background thread to run Flask server"""
+    """Background thread to run Flask server: waitress when it is installed, the
+    threaded werkzeug server otherwise, Flask's development server with --dev-server"""
     def __init__(self, host, port):
         super().__init__()
         self.daemon = True
@@ -210,8 +1166,21 @@ class FlaskThread(threading.Thread):
         self.port = port
         
     def run(self):
-        logger.info(f"Starting Flask server on http://{self.host}:{self.port}")
-        app.run(host=self.host, port=self.port, debug=False, use_reloader=False)
+        # HTTP/1.1 lets the devices keep their API connection open between polls
+        WSGIRequestHandler.protocol_version = "HTTP/1.1"
+        if SERVER_DEV:
+            logger.info(f"Starting Flask development server on http://{self.host}:{self.port}")
+            app.run(host=self.host, port=self.port, debug=False, use_reloader=False)
+            return
+        # one access log line per poll costs more than the poll itself
+        logging.getLogger('werkzeug').setLevel(logging.WARNING)
+        if waitress is not None:
+            logger.info(f"Starting waitress on http://{self.host}:{self.port}, {SERVER_THREADS} threads")
+            waitress.serve(app, host=self.host, port=self.port, threads=SERVER_THREADS,
+                           connection_limit=SERVER_THREADS * 2, ident='zgame')
+            return
+        logger.info(f"Starting threaded server on http://{self.host}:{self.port} (pip install waitress for the pooled one)")
+        make_server(self.host, self.port, app, threaded=True).serve_forever()
 
 
 class ZombieGameApp:
@@ -219,7 +1188,7 @@ class ZombieGameApp:
     
     def __init__(self, root):
         self.root = root
-        self.root.title("Zombie Game - Server Control")
+        self.root.title(f"Zombie Game - Server Control, arena {ARENA_ID}" if ARENA_ID else "Zombie Game - Server Control")
         self.root.geometry("1200x700")
         
         # Prevent window from being resized too small
@@ -234,8 +1203,13 @@ class ZombieGameApp:
         # Current screen
         self.current_screen = None
         
-        # Start with main screen
-        self.show_main_screen()
+        # Start with main screen, or where the restored game was
+        if state_restored and game_state['status'] in ('countdown', 'game'):
+            self.show_game_screen(resume=True)
+        elif state_restored and game_state['status'] == 'end':
+            self.show_end_screen()
+        else:
+            self.show_main_screen()
         
         # Setup close handler
         self.root.protocol("WM_DELETE_WINDOW", self.on_closing)
@@ -277,18 +1251,30 @@ class ZombieGameApp:
     
     def load_settings(self):
         """Load game settings from file"""
+        if state_restored:
+            logger.info(f"Settings of the restored game kept, {SETTINGS_FILE} not loaded")
+            return
         try:
             with open(SETTINGS_FILE, 'r') as f:
                 settings = json.load(f)
+            with devices_lock:
                 game_state['human_percentage'] = settings.get('human_percentage', DEFAULT_HUMAN_PERCENTAGE)
                 game_state['game_timeout'] = settings.get('game_timeout', DEFAULT_GAME_TIMEOUT)
                 game_state['game_duration'] = settings.get('game_duration', DEFAULT_GAME_DURATION)
                 game_state['num_gamers'] = settings.get('num_gamers', DEFAULT_NUM_GAMERS)
+                game_state['esp_channel'] = settings.get('esp_channel', DEFAULT_ESP_CHANNEL)
+                game_state['protocol_id'] = settings.get('protocol_id', DEFAULT_PROTOCOL_ID)
+                if (settings.get('event_start') or 0) > time.time():
+                    game_state['event_start'] = settings['event_start']
                 logger.info(f"Settings loaded from {SETTINGS_FILE}")
         except FileNotFoundError:
             logger.info("No settings file found, using defaults")
         except Exception as e:
             logger.error(f"Error loading settings: {e}")
+        with devices_lock:
+            if '--event' in sys.argv:
+                game_state['event_start'] = parse_event_start(arg_value('--event'))
+            publish_snapshot()
     
     def save_settings(self):
         """Save game settings to file"""
@@ -297,7 +1283,10 @@ class ZombieGameApp:
                 'human_percentage': game_state['human_percentage'],
                 'game_timeout': game_state['game_timeout'],
                 'game_duration': game_state['game_duration'],
-                'num_gamers': game_state['num_gamers']
+                'num_gamers': game_state['num_gamers'],
+                'esp_channel': game_state['esp_channel'],
+                'protocol_id': game_state['protocol_id'],
+                'event_start': game_state['event_start']
             }
             with open(SETTINGS_FILE, 'w') as f:
                 json.dump(settings, f, indent=2)
@@ -335,6 +1324,8 @@ class ZombieGameApp:
         # Server info
         local_ip = self.get_local_ip()
         info_text = f"Server Running\nLocal: 127.0.0.1:{SERVER_PORT}\nNetwork: {local_ip}:{SERVER_PORT}"
+        if ARENA_ID:
+            info_text += f"\nArena {ARENA_ID}"
         info_label = ttk.Label(main_frame, text=info_text, style='Status.TLabel', justify='center')
         info_label.pack(pady=20)
         
@@ -343,12 +1334,32 @@ class ZombieGameApp:
         esp_label = ttk.Label(main_frame, text=esp_info, style='Info.TLabel', justify='center')
         esp_label.pack(pady=10)
         
+        # Next event, the sleeping devices wake for it by themselves
+        event_frame = ttk.Frame(main_frame)
+        event_frame.pack(pady=10)
+        ttk.Label(event_frame, text="Next event (HH:MM):", style='Info.TLabel').pack(side='left', padx=5)
+        start = game_state['event_start']
+        self.event_var = tk.StringVar(value=datetime.fromtimestamp(start).strftime('%H:%M') if start else '')
+        ttk.Entry(event_frame, textvariable=self.event_var, width=8).pack(side='left', padx=5)
+        ttk.Button(event_frame, text="SET", command=self.set_event_time).pack(side='left', padx=5)
+
         # Enter button
         enter_btn = ttk.Button(main_frame, text="START GAME", 
                                command=self.show_prepare_screen,
                                style='Primary.TButton')
         enter_btn.pack(pady=30, ipadx=20)
         
+    def set_event_time(self):
+        """Main screen: the next event start from the entry, empty clears it"""
+        try:
+            start = parse_event_start(self.event_var.get().strip())
+        except ValueError:
+            messagebox.showerror("Next event", "Enter the start as HH:MM, or nothing to clear it")
+            return
+        with devices_lock:
+            set_event_start(start)
+        self.save_settings()
+
     def show_prepare_screen(self):
         """Preparation screen"""
         self.clear_screen()
@@ -460,10 +1471,11 @@ class ZombieGameApp:
         """Called when any setting is changed - saves settings immediately"""
         try:
             # Update game state with current values
-            game_state['num_gamers'] = self.num_gamers_var.get()
-            game_state['human_percentage'] = self.human_pct_var.get()
-            game_state['game_timeout'] = self.timeout_var.get()
-            game_state['game_duration'] = self.duration_var.get()
+            with devices_lock:
+                game_state['num_gamers'] = self.num_gamers_var.get()
+                game_state['human_percentage'] = self.human_pct_var.get()
+                game_state['game_timeout'] = self.timeout_var.get()
+                game_state['game_duration'] = self.duration_var.get()
             # Save to file
             self.save_settings()
             # Update continue button (in case num_gamers changed)
@@ -486,6 +1498,7 @@ class ZombieGameApp:
         if messagebox.askyesno("Confirm", "Are you sure you want to clear all connected devices?"):
             with devices_lock:
                 devices.clear()
+                beacon_slots.clear()
                 game_state['humans'] = []
                 game_state['zombies'] = []
             self.update_device_list()
@@ -500,8 +1513,7 @@ class ZombieGameApp:
     
     def update_continue_button(self):
         """Update Continue button state based on device count"""
-        with devices_lock:
-            device_count = len(devices)
+        device_count = len(get_snapshot().devices)
         required = self.num_gamers_var.get()
         
         if device_count >= required:
@@ -516,26 +1528,52 @@ class ZombieGameApp:
             self.update_continue_button()
             self.prepare_refresh_job = self.root.after(5000, self.refresh_prepare_screen)
     
+    def snapshot_for(self, tree):
+        """The snapshot to draw a tree from, None when it already shows that one.
+        Reads go to the snapshot, so the API threads never wait for the GUI"""
+        snap = get_snapshot()
+        if getattr(tree, 'drawn_version', None) == snap.version:
+            return None
+        tree.drawn_version = snap.version
+        return snap
+
+    def sync_tree(self, tree, snap, dev_ids, row_of):
+        """Brings tree to one row per device of dev_ids from the change feed:
+        only the rows of devices that changed since the tree drew them are
+        updated, the ones that left removed and new ones inserted. The order
+        is set again only when rows came or went, a column sort stays"""
+        drawn = getattr(tree, 'drawn_rows', {})  # device id -> its version drawn
+        rows = {}
+        for dev_id in dev_ids:
+            rows[dev_id] = snap.dev_versions[dev_id]
+            if dev_id not in drawn:
+                tree.insert('', 'end', iid=dev_id, values=row_of(snap.devices[dev_id]))
+            elif drawn[dev_id] != rows[dev_id]:
+                tree.item(dev_id, values=row_of(snap.devices[dev_id]))
+        removed = [dev_id for dev_id in drawn if dev_id not in rows]
+        for dev_id in removed:
+            tree.delete(dev_id)
+        if removed or len(rows) != len(drawn):
+            for index, dev_id in enumerate(rows):
+                tree.move(dev_id, '', index)
+        tree.drawn_rows = rows
+
     def update_device_list(self):
         """Update device list in treeview"""
-        # Clear existing items
-        for item in self.device_tree.get_children():
-            self.device_tree.delete(item)
-        
-        # Add devices
-        with devices_lock:
-            sorted_devices = sorted(devices.values(), key=lambda x: x['id'])
-            for device in sorted_devices:
-                self.device_tree.insert('', 'end', values=(
-                    device['id'],
-                    device['ip'],
-                    device['rssi'],
-                    device['role'],
-                    device['status'],
-                    device['health'],
-                    f"{device['battery']}%",
-                    device['comment']
-                ))
+        snap = self.snapshot_for(self.device_tree)
+        if snap is None:
+            return
+        sorted_ids = sorted(snap.devices, key=lambda dev_id: snap.devices[dev_id]['id'])
+        self.sync_tree(self.device_tree, snap, sorted_ids, lambda device: (
+            device['id'],
+            device['ip'],
+            device['rssi'],
+            device['role'],
+            device['status'],
+            device['health'],
+            f"{device['battery']}%",
+            device['comment']
+        ))
         
         # Update continue button state
         if hasattr(self, 'continue_btn'):
@@ -643,33 +1681,19 @@ class ZombieGameApp:
     
     def update_distribution_lists(self):
         """Update the distribution lists with current assignments"""
-        # Clear existing items
-        for item in self.dist_zombies_tree.get_children():
-            self.dist_zombies_tree.delete(item)
-        for item in self.dist_humans_tree.get_children():
-            self.dist_humans_tree.delete(item)
+        snap = self.snapshot_for(self.dist_zombies_tree)
+        if snap is None:
+            return
+        devices = snap.devices
         
         # Populate lists (sorted by ID)
-        with devices_lock:
-            # Sort zombies by ID
-            sorted_zombies = sorted(game_state['zombies'], key=lambda dev_id: devices.get(dev_id, {}).get('id', dev_id))
-            for dev_id in sorted_zombies:
-                if dev_id in devices:
-                    device = devices[dev_id]
-                    self.dist_zombies_tree.insert('', 'end', iid=dev_id, values=(
-                        device['id'],
-                        device['comment']
-                    ))
-            
-            # Sort humans by ID
-            sorted_humans = sorted(game_state['humans'], key=lambda dev_id: devices.get(dev_id, {}).get('id', dev_id))
-            for dev_id in sorted_humans:
-                if dev_id in devices:
-                    device = devices[dev_id]
-                    self.dist_humans_tree.insert('', 'end', iid=dev_id, values=(
-                        device['id'],
-                        device['comment']
-                    ))
+        for tree, team in ((self.dist_zombies_tree, 'zombies'), (self.dist_humans_tree, 'humans')):
+            sorted_ids = sorted((dev_id for dev_id in snap.game[team] if dev_id in devices),
+                                key=lambda dev_id: devices[dev_id]['id'])
+            self.sync_tree(tree, snap, sorted_ids, lambda device: (
+                device['id'],
+                device['comment']
+            ))
     
     def move_to_human(self):
         """Move selected zombie to humans list"""
@@ -764,19 +1788,20 @@ class ZombieGameApp:
         # Show game screen
         self.show_game_screen()
     
-    def show_game_screen(self):
-        """Game in progress screen"""
+    def show_game_screen(self, resume=False):
+        """Game in progress screen, resume keeps the clock of a restored game"""
         self.clear_screen()
         self.current_screen = 'game'
         
         # Set game state - start with countdown phase
-        with devices_lock:
-            game_state['status'] = 'countdown'
-            game_state['countdown_end_time'] = datetime.now() + timedelta(seconds=game_state['game_timeout'])
-            game_state['game_start_time'] = None  # Will be set when countdown ends
-            
-            for device in devices.values():
-                device['status'] = 'countdown'
+        if not resume:
+            with devices_lock:
+                game_state['status'] = 'countdown'
+                game_state['countdown_end_time'] = datetime.now() + timedelta(seconds=game_state['game_timeout'])
+                game_state['game_start_time'] = None  # Will be set when countdown ends
+                
+                for device in devices.values():
+                    device['status'] = 'countdown'
         
         # Main container
         main_frame = ttk.Frame(self.root, padding=20)
@@ -786,7 +1811,8 @@ class ZombieGameApp:
         header_frame = ttk.Frame(main_frame)
         header_frame.pack(fill='x', pady=(0, 10))
         
-        self.game_title_label = ttk.Label(header_frame, text="Countdown", style='Header.TLabel')
+        title = "Game In Progress" if game_state['status'] == 'game' else "Countdown"
+        self.game_title_label = ttk.Label(header_frame, text=title, style='Header.TLabel')
         self.game_title_label.pack(side='left')
         
         self.timer_label = ttk.Label(header_frame, text="00:00:00", style='Title.TLabel')
@@ -884,55 +1910,32 @@ class ZombieGameApp:
     
     def update_game_teams(self):
         """Update zombies and humans lists with statistics"""
-        # Clear existing items
-        for item in self.zombies_tree.get_children():
-            self.zombies_tree.delete(item)
-        for item in self.humans_tree.get_children():
-            self.humans_tree.delete(item)
-        
-        # Track statistics
-        zombie_count = 0
-        zombie_total_health = 0
-        human_count = 0
-        human_total_health = 0
-        
-        # Add devices to respective teams (sorted by ID)
-        with devices_lock:
-            # Sort and add zombies
-            sorted_zombies = sorted(game_state['zombies'], key=lambda dev_id: devices.get(dev_id, {}).get('id', dev_id))
-            for dev_id in sorted_zombies:
-                if dev_id in devices:
-                    device = devices[dev_id]
-                    self.zombies_tree.insert('', 'end', values=(
-                        device['id'],
-                        device['health'],
-                        f"{device['battery']}%",
-                        device['rssi'],
-                        device['comment']
-                    ))
-                    zombie_count += 1
-                    try:
-                        zombie_total_health += int(device['health'])
-                    except (ValueError, TypeError):
-                        pass
-            
-            # Sort and add humans
-            sorted_humans = sorted(game_state['humans'], key=lambda dev_id: devices.get(dev_id, {}).get('id', dev_id))
-            for dev_id in sorted_humans:
-                if dev_id in devices:
-                    device = devices[dev_id]
-                    self.humans_tree.insert('', 'end', values=(
-                        device['id'],
-                        device['health'],
-                        f"{device['battery']}%",
-                        device['rssi'],
-                        device['comment']
-                    ))
-                    human_count += 1
-                    try:
-                        human_total_health += int(device['health'])
-                    except (ValueError, TypeError):
-                        pass
+        snap = self.snapshot_for(self.zombies_tree)
+        if snap is None:
+            return
+        devices = snap.devices
+        
+        # Add devices to respective teams (sorted by ID), with the team statistics
+        stats = {}
+        for tree, team in ((self.zombies_tree, 'zombies'), (self.humans_tree, 'humans')):
+            sorted_ids = sorted((dev_id for dev_id in snap.game[team] if dev_id in devices),
+                                key=lambda dev_id: devices[dev_id]['id'])
+            self.sync_tree(tree, snap, sorted_ids, lambda device: (
+                device['id'],
+                device['health'],
+                f"{device['battery']}%",
+                device['rssi'],
+                device['comment']
+            ))
+            total_health = 0
+            for dev_id in sorted_ids:
+                try:
+                    total_health += int(devices[dev_id]['health'])
+                except (ValueError, TypeError):
+                    pass
+            stats[team] = (len(sorted_ids), total_health)
+        zombie_count, zombie_total_health = stats['zombies']
+        human_count, human_total_health = stats['humans']
         
         # Update statistics labels
         if hasattr(self, 'zombies_stats_label'):
@@ -945,11 +1948,11 @@ class ZombieGameApp:
         if self.current_screen != 'game':
             return
             
-        with devices_lock:
-            status = game_state['status']
-            countdown_end = game_state['countdown_end_time']
-            game_start = game_state['game_start_time']
-            duration_minutes = game_state['game_duration']
+        game = get_snapshot().game
+        status = game['status']
+        countdown_end = game['countdown_end_time']
+        game_start = game['game_start_time']
+        duration_minutes = game['game_duration']
         
         if status == 'countdown' and countdown_end:
             # Countdown phase
@@ -968,6 +1971,7 @@ class ZombieGameApp:
                     game_state['game_start_time'] = datetime.now()
                     for device in devices.values():
                         device['status'] = 'game'
+                game_logs.begin(game_state['game_start_time'])
                 
                 # Update title to show game in progress
                 if hasattr(self, 'game_title_label'):
@@ -998,10 +2002,10 @@ class ZombieGameApp:
             self.update_game_teams()
             
             # Only check for win conditions during actual game (not countdown)
-            if game_state['status'] == 'game':
-                with devices_lock:
-                    zombie_count = len(game_state['zombies'])
-                    human_count = len(game_state['humans'])
+            game = get_snapshot().game
+            if game['status'] == 'game':
+                zombie_count = len(game['zombies'])
+                human_count = len(game['humans'])
                 
                 if zombie_count == 0:
                     # All zombies eliminated - humans win
@@ -1291,18 +2295,28 @@ def main():
             temp_root.withdraw()
             messagebox.showwarning(
                 "Already Running",
-                "Zombie Game Server is already running.\n\n"
-                "Check your system tray or taskbar for the existing instance."
+                f"Zombie Game Server of arena {ARENA_ID} is already running.\n\n"
+                "Check your system tray or taskbar for the existing instance,\n"
+                "or start another arena with --arena N."
             )
             temp_root.destroy()
         except:
-            print("Error: Zombie Game Server is already running.")
+            print(f"Error: Zombie Game Server of arena {ARENA_ID} is already running.")
         
         sys.exit(1)
     
+    # Before the API answers, so no device is told the server starts over
+    if STATE_RESTORE:
+        restore_state()
+    StateJournal().start()
+    
     # Start Flask server in background
     flask_thread = FlaskThread(SERVER_HOST, SERVER_PORT)
     flask_thread.start()
+
+    # One multicast stream serves every device, independent of the player count
+    GameStateMulticaster().start()
+    ArenaAnnouncer().start()
     
     # Give Flask a moment to start
     time.sleep(1)
@@ -1319,7 +2333,8 @@ def main():
     print("=" * 70)
     print("🎮 ZOMBIE GAME - Native GUI Application")
     print("=" * 70)
-    print(f"\n✓ Server running on: http://{SERVER_HOST}:{SERVER_PORT}")
+    print(f"\n✓ Arena {ARENA_ID}, protocol ID {DEFAULT_PROTOCOL_ID}, multicast {MCAST_GROUP}")
+    print(f"✓ Server running on: http://{SERVER_HOST}:{SERVER_PORT}")
     print(f"✓ Local IP: {local_ip}")
     print(f"✓ ESP32 endpoint: http://{local_ip}:{SERVER_PORT}/api/device")
     print("\n" + "=" * 70)
@@ -0,0 +1,429 @@
+#!/usr/bin/env python3
+"""
+Zombie Game - Load Test
+Headless load generator for the game and system servers: hundreds of asyncio
+virtual devices, each following the request pattern of the firmware, with
+latency percentiles and failure counts per endpoint.
+
+Per virtual device:
+- boot: GET /version (OTA server), GET /list and a few GET /download (file server)
+- every STATUS_INTERVAL_S: POST /status (device status server), full report first
+- every API_INTERVAL_S: /api/device (game server), GET first, then POST JSON once
+  the server advertises it, with the role and health of a trace
+
+Only the standard library is used; every device keeps one HTTP/1.1 connection
+per server open like the firmware does.
+
+Run through zombie_test_client.py --load, or directly:
+    python zombie_load_test.py -n 300 -s http://127.0.0.1:5000 -d 300
+"""
+
+import argparse
+import asyncio
+import json
+import random
+import sys
+import time
+import urllib.parse
+from typing import Dict, List, Optional, Tuple
+
+API_INTERVAL_S = 1.0        # TUNE_DEF_GAME_API_MS
+STATUS_INTERVAL_S = 5.0     # STATUS_UPDATE_INTERVAL_MS
+STATUS_FULL_S = 60.0        # STATUS_FULL_INTERVAL_MS
+FILE_SERVER_PORT = 5001
+STATUS_SERVER_PORT = 5004
+OTA_SERVER_PORT = 5005
+SYNC_ENC = 'zlib,rgb565'
+API_FMT_JSON = 0x01
+READ_CHUNK = 65536
+HEADER_LIMIT = 16384
+
+
+# ============== Statistics ==============
+class EndpointStats:
+    """Latencies and failures of one endpoint"""
+    def __init__(self):
+        self.latencies: List[float] = []
+        self.failures: Dict[str, int] = {}
+        self.bytes = 0
+
+    def ok(self, ms: float, size: int):
+        self.latencies.append(ms)
+        self.bytes += size
+
+    def fail(self, reason: str):
+        self.failures[reason] = self.failures.get(reason, 0) + 1
+
+    @staticmethod
+    def percentile(values: List[float], pct: float) -> float:
+        if not values:
+            return 0.0
+        return values[min(len(values) - 1, int(len(values) * pct / 100))]
+
+
+class LoadStats:
+    def __init__(self):
+        self.endpoints: Dict[str, EndpointStats] = {}
+        self.started = time.time()
+
+    def get(self, name: str) -> EndpointStats:
+        return self.endpoints.setdefault(name, EndpointStats())
+
+    def summary(self) -> dict:
+        elapsed = max(time.time() - self.started, 0.001)
+        result = {}
+        for name, st in sorted(self.endpoints.items()):
+            values = sorted(st.latencies)
+            failed = sum(st.failures.values())
+            total = len(values) + failed
+            result[name] = {
+                'requests': total,
+                'rps': round(total / elapsed, 1),
+                'failed': failed,
+                'fail_pct': round(100.0 * failed / total, 2) if total else 0.0,
+                'p50_ms': round(EndpointStats.percentile(values, 50), 1),
+                'p90_ms': round(EndpointStats.percentile(values, 90), 1),
+                'p99_ms': round(EndpointStats.percentile(values, 99), 1),
+                'max_ms': round(values[-1], 1) if values else 0.0,
+                'mbytes': round(st.bytes / 1e6, 2),
+                'failures': dict(st.failures)
+            }
+        return result
+
+    def print_table(self, title: str):
+        print(f"\n{title} ({time.time() - self.started:.0f} s)")
+        print(f"{'endpoint':<14}{'requests':>9}{'rps':>8}{'failed':>8}{'p50 ms':>9}{'p90 ms':>9}"
+              f"{'p99 ms':>9}{'max ms':>9}{'MB':>8}")
+        for name, row in self.summary().items():
+            print(f"{name:<14}{row['requests']:>9}{row['rps']:>8}{row['failed']:>8}{row['p50_ms']:>9}"
+                  f"{row['p90_ms']:>9}{row['p99_ms']:>9}{row['max_ms']:>9}{row['mbytes']:>8}")
+            if row['failures']:
+                print(f"{'':<14}" + ", ".join(f"{k}: {v}" for k, v in row['failures'].items()))
+        sys.stdout.flush()
+
+
+# ============== HTTP/1.1 keep-alive client ==============
+class HttpError(Exception):
+    pass
+
+
+class KeepAliveClient:
+    """One persistent connection to one server, reopened after an error"""
+    def __init__(self, host: str, port: int, timeout: float):
+        self.host = host
+        self.port = port
+        self.timeout = timeout
+        self.reader: Optional[asyncio.StreamReader] = None
+        self.writer: Optional[asyncio.StreamWriter] = None
+
+    async def close(self):
+        if self.writer is not None:
+            self.writer.close()
+            try:
+                await self.writer.wait_closed()
+            except (OSError, asyncio.TimeoutError):
+                pass
+        self.reader = None
+        self.writer = None
+
+    async def _read_body(self, headers: Dict[str, str], keep: bool) -> Tuple[int, bool]:
+        """Reads and drops the body, returns its size and whether the connection stays usable"""
+        size = 0
+        if headers.get('transfer-encoding', '').lower() == 'chunked':
+            while True:
+                line = await self.reader.readline()
+                chunk = int(line.split(b';')[0].strip() or b'0', 16)
+                if chunk == 0:
+                    await self.reader.readline()
+                    return size, keep
+                await self.reader.readexactly(chunk + 2)
+                size += chunk
+        if 'content-length' in headers:
+            left = int(headers['content-length'])
+            while left > 0:
+                data = await self.reader.readexactly(min(left, READ_CHUNK))
+                left -= len(data)
+                size += len(data)
+            return size, keep
+        while True:
+            data = await self.reader.read(READ_CHUNK)
+            if not data:
+                return size, False
+            size += len(data)
+
+    async def _request(self, method: str, path: str, body: bytes, headers: Dict[str, str]) -> Tuple[int, bytes, int]:
+        if self.writer is None:
+            self.reader, self.writer = await asyncio.open_connection(self.host, self.port, limit=HEADER_LIMIT)
+        lines = [f"{method} {path} HTTP/1.1", f"Host: {self.host}:{self.port}", "Connection: keep-alive"]
+        lines += [f"{k}: {v}" for k, v in headers.items()]
+        if body or method == 'POST':
+            lines.append(f"Content-Length: {len(body)}")
+        self.writer.write(("\r\n".join(lines) + "\r\n\r\n").encode('latin-1') + body)
+        await self.writer.drain()
+        head = await self.reader.readuntil(b"\r\n\r\n")
+        status_line, *header_lines = head.decode('latin-1').split("\r\n")
+        parts = status_line.split(' ', 2)
+        if len(parts) < 2 or not parts[1].isdigit():
+            raise HttpError('bad status line')
+        resp_headers = {}
+        for line in header_lines:
+            if ':' in line:
+                k, v = line.split(':', 1)
+                resp_headers[k.strip().lower()] = v.strip()
+        keep = resp_headers.get('connection', '').lower() != 'close'
+        # small bodies (API replies) are kept, downloads only counted
+        length = resp_headers.get('content-length')
+        if length is not None and int(length) <= HEADER_LIMIT:
+            data = await self.reader.readexactly(int(length))
+            size = len(data)
+        else:
+            data = b''
+            size, keep = await self._read_body(resp_headers, keep)
+        if not keep:
+            await self.close()
+        return int(parts[1]), data, size
+
+    async def request(self, stats: LoadStats, name: str, method: str, path: str,
+                      body: bytes = b'', headers: Optional[Dict[str, str]] = None) -> Optional[bytes]:
+        """The response body on a 2xx, None on any failure (counted under name)"""
+        st = stats.get(name)
+        start = time.perf_counter()
+        try:
+            status, data, size = await asyncio.wait_for(self._request(method, path, body, headers or {}), self.timeout)
+        except asyncio.TimeoutError:
+            st.fail('timeout')
+            await self.close()
+            return None
+        except (OSError, asyncio.IncompleteReadError, asyncio.LimitOverrunError, HttpError, ValueError) as e:
+            st.fail(type(e).__name__)
+            await self.close()
+            return None
+        ms = (time.perf_counter() - start) * 1000
+        if status // 100 != 2:
+            st.fail(f'HTTP {status}')
+            return None
+        st.ok(ms, size)
+        return data
+
+
+# ============== Traces ==============
+class Trace:
+    """Role and health over game time. A recorded trace is a JSON list of
+    {"t": seconds since the game started, "role": ..., "health": ...}"""
+    def __init__(self, steps: Optional[List[dict]] = None):
+        self.steps = sorted(steps, key=lambda s: s['t']) if steps else None
+
+    @staticmethod
+    def load(path: str) -> 'Trace':
+        with open(path, 'r') as f:
+            return Trace(json.load(f))
+
+    def replay(self, elapsed: float, state: dict):
+        """Applies the recorded step for this game time, if there is a trace"""
+        if not self.steps:
+            return False
+        t = elapsed % (self.steps[-1]['t'] + API_INTERVAL_S)
+        for step in self.steps:
+            if step['t'] > t:
+                break
+            state['role'] = step.get('role', state['role'])
+            state['health'] = step.get('health', state['health'])
+        return True
+
+
+def synthetic_step(state: dict, rng: random.Random):
+    """Firmware-like health: fights and heals now and then, a human at zero turns zombie"""
+    if state['role'] not in ('human', 'zombie'):
+        return
+    r = rng.random()
+    if r < 0.15:
+        state['health'] -= rng.randint(1, 10)
+    elif r < 0.22:
+        state['health'] += rng.randint(1, 6)
+    state['health'] = max(0, min(state['health'], 100))
+    if state['role'] == 'human' and state['health'] == 0:
+        state['role'] = 'zombie'
+        state['health'] = 100
+    elif state['role'] == 'zombie' and state['health'] == 0 and rng.random() < 0.1:
+        state['role'] = 'human'
+        state['health'] = 50
+
+
+# ============== Virtual device ==============
+class LoadDevice:
+    def __init__(self, index: int, args, stats: LoadStats, trace: Trace):
+        self.index = index
+        self.name = f"{args.prefix}{index:04d}"
+        self.mac = "AA:BB:%02X:%02X:%02X:%02X" % (0xCC, (index >> 16) & 0xFF, (index >> 8) & 0xFF, index & 0xFF)
+        self.ip = f"10.{(index >> 16) & 0xFF}.{(index >> 8) & 0xFF}.{index & 0xFF}"
+        self.args = args
+        self.stats = stats
+        self.trace = trace
+        self.rng = random.Random(args.seed + index)
+        self.state = {'role': 'neutral', 'status': 'idle', 'health': 100}
+        self.game_start: Optional[float] = None
+        self.api_post = False
+        self.status_seq = 0
+        self.last_full = 0.0
+        self.game = KeepAliveClient(args.game_host, args.game_port, args.timeout)
+        self.status = KeepAliveClient(args.system_host, STATUS_SERVER_PORT, args.timeout)
+
+    async def boot(self):
+        """OTA check and file sync, on their own connections closed afterwards like the firmware"""
+        ota = KeepAliveClient(self.args.system_host, OTA_SERVER_PORT, self.args.timeout)
+        await ota.request(self.stats, '/version', 'GET', '/version')
+        await ota.close()
+        files = KeepAliveClient(self.args.system_host, FILE_SERVER_PORT, self.args.timeout)
+        data = await files.request(self.stats, '/list', 'GET', f"/list?enc={urllib.parse.quote(SYNC_ENC)}")
+        names = []
+        if data:
+            try:
+                names = [f['name'] for f in json.loads(data).get('files', [])]
+            except (ValueError, KeyError, TypeError):
+                self.stats.get('/list').fail('bad JSON')
+        for name in self.rng.sample(names, min(self.args.downloads, len(names))):
+            await files.request(self.stats, '/download', 'GET',
+                                f"/download?file={urllib.parse.quote(name)}&enc={urllib.parse.quote(SYNC_ENC)}")
+        await files.close()
+
+    def api_request(self) -> dict:
+        return {
+            'id': self.name, 'ip': self.ip, 'rssi': -40 - self.rng.randint(0, 40),
+            'role': self.state['role'], 'status': self.state['status'], 'health': self.state['health'],
+            'battery': 80, 'comment': 'load',
+            'z': self.rng.randint(0, 4), 'h': self.rng.randint(0, 4), 'b': self.rng.randint(0, 1)
+        }
+
+    async def api_step(self):
+        body = json.dumps(self.api_request(), separators=(',', ':')).encode()
+        if self.api_post:
+            data = await self.game.request(self.stats, '/api/device', 'POST', '/api/device', body,
+                                           {'Content-Type': 'application/json'})
+        else:
+            path = '/api/device?data=' + urllib.parse.quote(body.decode())
+            data = await self.game.request(self.stats, '/api/device', 'GET', path)
+        if not data:
+            return
+        try:
+            resp = json.loads(data)
+        except ValueError:
+            self.stats.get('/api/device').fail('bad JSON')
+            return
+        self.api_post = bool(resp.get('api_formats', 0) & API_FMT_JSON)
+        phase = resp.get('status', '')
+        if phase == 'game':
+            if self.game_start is None:
+                self.game_start = time.time()
+                self.state['role'] = resp.get('role', self.state['role'])
+            self.state['status'] = 'GAME_LOOP'
+            if not self.trace.replay(time.time() - self.game_start, self.state):
+                synthetic_step(self.state, self.rng)
+        else:
+            self.game_start = None
+            self.state['status'] = 'idle'
+            self.state['role'] = resp.get('role', 'neutral')
+            self.state['health'] = 100
+
+    async def status_step(self):
+        self.status_seq += 1
+        full = time.time() - self.last_full >= STATUS_FULL_S
+        report = {'mac': self.mac, 'seq': self.status_seq, 'full': full, 'uptime': int(time.time() - self.stats.started),
+                  'rssi': -40 - self.rng.randint(0, 40), 'battery_pct': 80,
+                  'game_status': self.state['status'], 'free_heap': 150000 + self.rng.randint(0, 4096)}
+        if full:
+            self.last_full = time.time()
+            report.update({'name': self.name, 'ip': self.ip, 'ssid': 'load', 'device_status': 'online'})
+        await self.status.request(self.stats, '/status', 'POST', '/status',
+                                  json.dumps(report, separators=(',', ':')).encode(),
+                                  {'Content-Type': 'application/json'})
+
+    async def run(self, stop_at: float):
+        await asyncio.sleep(self.rng.uniform(0, self.args.ramp))
+        if self.args.boot:
+            await self.boot()
+        next_api = time.time()
+        next_status = time.time() + self.rng.uniform(0, STATUS_INTERVAL_S)
+        while time.time() < stop_at:
+            now = time.time()
+            if now >= next_api:
+                next_api += API_INTERVAL_S
+                await self.api_step()
+            if self.args.status and now >= next_status:
+                next_status += STATUS_INTERVAL_S
+                await self.status_step()
+            await asyncio.sleep(max(0.0, min(next_api, next_status if self.args.status else next_api) - time.time()))
+        await self.game.close()
+        await self.status.close()
+
+
+# ============== Entry point ==============
+async def run_load(args) -> dict:
+    stats = LoadStats()
+    trace = Trace.load(args.trace) if args.trace else Trace()
+    stop_at = time.time() + args.duration
+    devices = [LoadDevice(i, args, stats, trace) for i in range(args.num_devices)]
+    tasks = [asyncio.create_task(d.run(stop_at)) for d in devices]
+
+    async def reporter():
+        while True:
+            await asyncio.sleep(args.report)
+            stats.print_table(f"{args.num_devices} devices")
+
+    rep = asyncio.create_task(reporter())
+    await asyncio.gather(*tasks)
+    rep.cancel()
+    stats.print_table(f"FINAL, {args.num_devices} devices")
+    return stats.summary()
+
+
+def add_load_arguments(parser: argparse.ArgumentParser):
+    parser.add_argument('-d', '--duration', type=float, default=120, help='Load test length in seconds (default: 120)')
+    parser.add_argument('--ramp', type=float, default=10, help='Devices start spread over this many seconds (default: 10)')
+    parser.add_argument('--report', type=float, default=10, help='Interim report interval in seconds (default: 10)')
+    parser.add_argument('--timeout', type=float, default=5, help='Per-request timeout in seconds (default: 5)')
+    parser.add_argument('--system-host', type=str, default=None,
+                        help='Host of the system server (/status, /list, /download, /version), default: the game server host')
+    parser.add_argument('--downloads', type=int, default=1, help='Files each device downloads at boot (default: 1)')
+    parser.add_argument('--no-boot', dest='boot', action='store_false', help='Skip the OTA check and file sync at boot')
+    parser.add_argument('--no-status', dest='status', action='store_false', help='Skip the /status reports')
+    parser.add_argument('--trace', type=str, default=None, help='Recorded role/health trace (JSON list of {t, role, health})')
+    parser.add_argument('--prefix', type=str, default='LOAD', help='Device name prefix (default: LOAD)')
+    parser.add_argument('--seed', type=int, default=1, help='Random seed (default: 1)')
+    parser.add_argument('--json', type=str, default=None, help='Write the final summary to this file')
+
+
+def run_load_main(args):
+    url = urllib.parse.urlparse(args.server)
+    args.game_host = url.hostname or '127.0.0.1'
+    args.game_port = url.port or 80
+    args.system_host = args.system_host or args.game_host
+    print("=" * 60)
+    print("ZOMBIE GAME - Load Test")
+    print("=" * 60)
+    print(f"Game server:   {args.game_host}:{args.game_port}")
+    print(f"System server: {args.system_host} (status {STATUS_SERVER_PORT}, files {FILE_SERVER_PORT}, OTA {OTA_SERVER_PORT})")
+    print(f"Devices: {args.num_devices}, duration {args.duration:.0f} s, ramp {args.ramp:.0f} s")
+    print("=" * 60)
+    if sys.platform == 'win32':
+        # the selector loop is limited to 512 sockets
+        asyncio.set_event_loop_policy(asyncio.WindowsProactorEventLoopPolicy())
+    summary = asyncio.run(run_load(args))
+    if args.json:
+        with open(args.json, 'w') as f:
+            json.dump({'devices': args.num_devices, 'duration_s': args.duration, 'endpoints': summary}, f, indent=2)
+        print(f"Summary written to {args.json}")
+    failed = sum(row['failed'] for row in summary.values())
+    return 1 if failed else 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Zombie Game Load Test - hundreds of headless virtual devices')
+    parser.add_argument('-n', '--num-devices', type=int, default=200, help='Virtual devices (default: 200)')
+    parser.add_argument('-s', '--server', type=str, default='http://127.0.0.1:5000',
+                        help='Game server URL (default: http://127.0.0.1:5000)')
+    add_load_arguments(parser)
+    sys.exit(run_load_main(parser.parse_args()))
+
+
+if __name__ == '__main__':
+    main()
@@ -870,12 +870,21 @@ def main():
         default='http://127.0.0.1:5000',
         help='Server URL (default: http://127.0.0.1:5000)'
     )
+    parser.add_argument(
+        '--load',
+        action='store_true',
+        help='Headless load test with asyncio devices instead of the GUI (see zombie_load_test.py)'
+    )
+    from zombie_load_test import add_load_arguments, run_load_main
+    add_load_arguments(parser)
     
     args = parser.parse_args()
     
     if args.num_devices < 1:
         print("Error: Number of devices must be at least 1")
         sys.exit(1)
+    if args.load:
+        sys.exit(run_load_main(args))
     if args.num_devices > 100:
         print("Warning: Large number of devices may cause performance issues")
         
@@ -0,0 +1,164 @@
+#!/usr/bin/env python3
+"""
+Transition animation for the devices' ".zan" player (lib/tft_utils/tftAnim.h).
+
+Usage: python make_animation.py output.zan fps frame1.bmp [frame2.bmp ...]
+           [--loop] [--at X Y]
+
+Frames are 24-bit uncompressed BMPs of one size, at most 536x240, shown at
+X, Y on the panel (0, 0 by default). The first frame is stored whole, every
+later one as the pixels that changed from the one before, in runs of one
+colour or literal pixels. The last frame should be the picture of the screen
+the animation leads into (hwin.bmp for hwin.zan), the device draws that
+picture when the animation is missing. Copy the output into sync_files; the
+asset image packs it to be played straight from flash.
+"""
+
+import os
+import struct
+import sys
+
+PANEL_SIZE = (536, 240)
+ANIM_MAGIC = b'ZAN1'
+ANIM_VERSION = 1
+ANIM_FLAG_LOOP = 0x01
+ANIM_MAX_FPS = 30
+ANIM_HEADER = '<4sBBBBHHHHHH'
+OP_SKIP, OP_RUN, OP_LITERAL = 0, 1, 2
+OP_SHORT_MAX = 63           # counts up to this fit the op byte, longer ones take a u16
+OP_LONG_MAX = 0xFFFF
+RUN_MIN = 3                 # shorter repeats go into the literal around them
+
+
+def read_bmp(path):
+    """(width, height, RGB565 pixels top down) of a 24-bit BMP"""
+    with open(path, 'rb') as f:
+        data = f.read()
+    if len(data) < 54 or data[:2] != b'BM':
+        raise ValueError(f"{path}: not a BMP")
+    offset, = struct.unpack_from('<I', data, 10)
+    width, height = struct.unpack_from('<ii', data, 18)
+    planes, bpp, compression = struct.unpack_from('<HHI', data, 26)
+    if planes != 1 or bpp != 24 or compression != 0:
+        raise ValueError(f"{path}: only 24-bit uncompressed BMPs are taken")
+    bottom_up = height > 0
+    height = abs(height)
+    row_size = (width * 3 + 3) & ~3
+    if offset + row_size * height > len(data):
+        raise ValueError(f"{path}: truncated")
+    pixels = []
+    for row in range(height):
+        start = offset + (height - 1 - row if bottom_up else row) * row_size
+        line = data[start:start + width * 3]
+        for i in range(0, width * 3, 3):
+            b, g, r = line[i], line[i + 1], line[i + 2]
+            pixels.append(((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3))
+    return width, height, pixels
+
+
+def op_bytes(kind, count):
+    if count <= OP_SHORT_MAX:
+        return bytes(((kind << 6) | count,))
+    return bytes((kind << 6,)) + struct.pack('<H', count)
+
+
+def encode_frame(pixels, previous):
+    """Ops that turn previous (None for the first frame) into pixels"""
+    out = bytearray()
+    literal = []
+
+    def flush_literal():
+        for start in range(0, len(literal), OP_LONG_MAX):
+            chunk = literal[start:start + OP_LONG_MAX]
+            out.extend(op_bytes(OP_LITERAL, len(chunk)))
+            for px in chunk:
+                out.extend(struct.pack('>H', px))
+        literal.clear()
+
+    n = len(pixels)
+    i = 0
+    pending_skip = 0
+    while i < n:
+        if previous is not None and pixels[i] == previous[i]:
+            j = i
+            while j < n and j - i < OP_LONG_MAX and pixels[j] == previous[j]:
+                j += 1
+            flush_literal()
+            pending_skip += j - i
+            i = j
+            continue
+        # a skip goes out once something changes after it, one at the very
+        # end is left out as the window keeps its pixels anyway
+        if pending_skip:
+            while pending_skip:
+                count = min(pending_skip, OP_LONG_MAX)
+                out.extend(op_bytes(OP_SKIP, count))
+                pending_skip -= count
+        j = i
+        while j < n and j - i < OP_LONG_MAX and pixels[j] == pixels[i] and \
+                (previous is None or pixels[j] != previous[j]):
+            j += 1
+        if j - i >= RUN_MIN:
+            flush_literal()
+            out.extend(op_bytes(OP_RUN, j - i))
+            out.extend(struct.pack('>H', pixels[i]))
+            i = j
+            continue
+        literal.extend(pixels[i:j])
+        i = j
+    flush_literal()
+    return bytes(out)
+
+
+def make_animation(frames, fps, loop=False, at=(0, 0)):
+    size = None
+    encoded = []
+    previous = None
+    for path in frames:
+        width, height, pixels = read_bmp(path)
+        if size is None:
+            size = (width, height)
+        elif size != (width, height):
+            raise ValueError(f"{path}: {width}x{height}, the first frame is {size[0]}x{size[1]}")
+        encoded.append(encode_frame(pixels, previous))
+        previous = pixels
+    width, height = size
+    x, y = at
+    if x + width > PANEL_SIZE[0] or y + height > PANEL_SIZE[1]:
+        raise ValueError(f"{width}x{height} at {x},{y} does not fit the {PANEL_SIZE[0]}x{PANEL_SIZE[1]} panel")
+    fps = max(1, min(ANIM_MAX_FPS, int(fps)))
+    header = struct.pack(ANIM_HEADER, ANIM_MAGIC, ANIM_VERSION, ANIM_FLAG_LOOP if loop else 0, fps, 0,
+                         x, y, width, height, len(encoded), 0)
+    offset = len(header) + 4 * (len(encoded) + 1)
+    table = bytearray()
+    for blob in encoded:
+        table += struct.pack('<I', offset)
+        offset += len(blob)
+    table += struct.pack('<I', offset)
+    return header + bytes(table) + b''.join(encoded)
+
+
+def main(args):
+    loop = '--loop' in args
+    args = [a for a in args if a != '--loop']
+    at = (0, 0)
+    if '--at' in args:
+        k = args.index('--at')
+        at = (int(args[k + 1]), int(args[k + 2]))
+        del args[k:k + 3]
+    if len(args) < 3:
+        print(__doc__)
+        return 1
+    out, fps, frames = args[0], float(args[1]), args[2:]
+    data = make_animation(frames, fps, loop, at)
+    os.makedirs(os.path.dirname(os.path.abspath(out)), exist_ok=True)
+    with open(out, 'wb') as f:
+        f.write(data)
+    width, height = struct.unpack_from('<HH', data, 12)
+    raw = len(frames) * width * height * 2
+    print(f"{out}: {len(frames)} frames, {len(data)} bytes ({100 * len(data) // max(1, raw)}% of RGB565)")
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv[1:]))
@@ -0,0 +1,63 @@
+#!/usr/bin/env python3
+"""
+Panel bring-up pattern for firmware built with TFT_TEST_PATTERN=1.
+
+Usage: python make_test_pattern.py [output.bmp] [width height]
+
+Writes a 24-bit BMP (536x240 by default, the AMOLED panel) with a hue sweep,
+red/green/blue/grey ramps and a 1 px border. It goes to debug_assets/, which
+the file server does not sync; copy it into sync_files as test_pattern.bmp
+for the devices that should have it, they draw it with "test_pattern". It
+replaces the true colour image that used to be compiled into every firmware.
+"""
+
+import colorsys
+import os
+import struct
+import sys
+
+DEFAULT_OUT = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'debug_assets', 'test_pattern.bmp')
+DEFAULT_SIZE = (536, 240)
+
+
+def pattern_pixel(x, y, width, height):
+    """RGB of one pixel, top-down coordinates"""
+    if x == 0 or y == 0 or x == width - 1 or y == height - 1:
+        return 255, 255, 255
+    band = y * 6 // height
+    t = x / (width - 1)
+    if band < 2:
+        # hue sweep, full value in the first band, fading to black in the second
+        value = 1.0 if band == 0 else 1.0 - (y - height / 6) / (height / 6)
+        r, g, b = colorsys.hsv_to_rgb(t, 1.0, max(0.0, value))
+        return int(r * 255), int(g * 255), int(b * 255)
+    level = int(t * 255)
+    return ((level, 0, 0), (0, level, 0), (0, 0, level), (level, level, level))[band - 2]
+
+
+def make_bmp(width, height):
+    row_size = (width * 3 + 3) & ~3
+    pixels = bytearray()
+    for y in range(height - 1, -1, -1):  # bottom-up rows
+        row = bytearray()
+        for x in range(width):
+            r, g, b = pattern_pixel(x, y, width, height)
+            row += bytes((b, g, r))
+        pixels += row + bytes(row_size - len(row))
+    header = struct.pack('<2sIHHI', b'BM', 54 + len(pixels), 0, 0, 54)
+    info = struct.pack('<IiiHHIIiiII', 40, width, height, 1, 24, 0, len(pixels), 2835, 2835, 0, 0)
+    return header + info + bytes(pixels)
+
+
+def main(args):
+    out = args[0] if args else DEFAULT_OUT
+    width, height = (int(args[1]), int(args[2])) if len(args) >= 3 else DEFAULT_SIZE
+    os.makedirs(os.path.dirname(os.path.abspath(out)), exist_ok=True)
+    data = make_bmp(width, height)
+    with open(out, 'wb') as f:
+        f.write(data)
+    print(f"{out}: {width}x{height}, {len(data)} bytes")
+
+
+if __name__ == '__main__':
+    main(sys.argv[1:])
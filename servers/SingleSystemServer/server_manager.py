@@ -7,44 +7,76 @@ Combined GUI for Discovery, File Server, and OTA servers
 
 import socket
 import json
+import sqlite3
 import hashlib
 import os
+import struct
+import zlib
 import sys
 import atexit
 import psutil
 import threading
 import time
 import subprocess
+import fnmatch
+import wave
+from collections import deque
 import platform
 import tkinter as tk
 from tkinter import ttk, scrolledtext, messagebox, simpledialog
 from datetime import datetime
 from http.server import ThreadingHTTPServer, BaseHTTPRequestHandler
-from flask import Flask, request, jsonify, send_file
+from flask import Flask, Response, request, jsonify, send_file
 from werkzeug.utils import secure_filename
 import urllib.parse
+import asyncio
+import io
+import http.client
+from concurrent.futures import ThreadPoolExecutor
+try:
+    from watchdog.observers import Observer
+    from watchdog.events import FileSystemEventHandler
+except ImportError:
+    Observer = None
+    FileSystemEventHandler = object
 
 # ============== Default Configuration ==============
 DEFAULT_CONFIG = {
     'discovery': {
         'port': 4210,
-        'auto_start': True
+        'auto_start': True,
+        'game_port': 5000,      # the game server's port handed out in the service map, it runs apart
+        'arena_port_base': 5100 # arena N's game server until it announced itself, ARENA_PORT_BASE of the game server
     },
     'file_server': {
         'port': 5001,
         'auto_start': True,
-        'sync_folder': './sync_files'
+        'sync_folder': './sync_files',
+        'max_transfers': 6,     # devices downloading at once, the rest are told to come back
+        'sendfile': True        # /download through socket.sendfile, False for Flask's send_file
     },
     'ota_server': {
         'port': 5005,
         'auto_start': True,
         'firmware_dir': './firmware',
-        'firmware_file': 'firmware.bin'
+        'firmware_file': 'firmware.bin',
+        'multicast': True,      # offer the multicast carousel in /version
+        'multicast_rate': 200,  # carousel blocks per second
+        'max_transfers': 4,     # devices fetching the image at once
+        'rate_kbps': 0,         # uplink budget the transfers share evenly, 0 leaves them to TCP
+        'max_connections': 50   # requests in flight, more are refused with 503
     },
     'device_status_server': {
         'port': 5004,
         'auto_start': True,
-        'device_timeout': 30  # Seconds before device considered offline
+        'device_timeout': 30,  # Seconds before device considered offline
+        'history_db': 'device_status.db',  # status report history, '' keeps it in memory only
+        'history_flush_ms': 500,  # the reports of this long go in as one transaction
+        'history_keep_days': 7
+    },
+    'service_host': {
+        'enabled': False,       # all four services on one asyncio loop instead of a thread model each
+        'workers': 32           # requests handled at once over all of them
     }
 }
 
@@ -53,7 +85,909 @@ TCP_PORT = 3232  # Fixed TCP port for discovery
 LOCK_PORT = 47200  # Port used for single instance lock
 
 
+# Status report pacing (status_interval_ms): the fleet's reports add up to about
+# STATUS_TARGET_RATE a second, never so rare that device_timeout takes a device
+# for offline, and fast while a command or name change waits for its answer
+STATUS_TARGET_RATE = 20
+STATUS_INTERVAL_MIN_MS = 5000  # the firmware's STATUS_UPDATE_INTERVAL_MS
+STATUS_INTERVAL_FAST_MS = 1000
+STATUS_TIMEOUT_REPORTS = 3  # reports a device gets to miss before it times out
+
 # ============== Single Instance Lock ==============
+# Radio telemetry fields reported by the devices in /status
+RADIO_STAT_KEYS = (
+    'rx_received', 'rx_dropped', 'rx_coalesced', 'rx_high_water',
+    'rx_rejected', 'rx_rej_len', 'rx_rej_proto', 'rx_rej_crc', 'rx_fps',
+    'tx_ok', 'tx_fail', 'radio_senders', 'jitter_avg_ms', 'jitter_max_ms',
+    'esp_ch', 'ap_ch', 'ch_aligns', 'ch_roams', 'ch_refused',
+    'clock_rtt_ms', 'clock_drift_ppm', 'clock_steps',
+    'air_seq_heard', 'air_seq_lost', 'air_bulk_heard', 'air_bulk_lost',
+    'air_deferred', 'air_bulk_ms',
+)
+
+# Granularity of the delta file sync: /list carries a short md5 per chunk and
+# the devices fetch only the changed chunks with ranged /download requests
+SYNC_CHUNK_SIZE = 64 * 1024
+
+# Devices asking with enc=zlib get compressible files as a zlib stream behind a
+# small header ("ZGZ1" + raw size), stored like that in flash and inflated on
+# the copy to PSRAM. Kept only when it saves at least 10 %.
+SYNC_ZLIB_MAGIC = b'ZGZ1'
+SYNC_ZLIB_MAX_RATIO = 0.9
+SYNC_NO_COMPRESS_EXTS = ('.mp3', '.png', '.jpg', '.jpeg', '.gif', '.ogg', '.gz', '.zip')
+SYNC_ZCACHE_DIR = '.sync_zcache'
+
+# Devices asking with enc=rgb565 (enc is a comma list, zlib goes on top) get
+# 24-bit BMPs pre-converted: "Z565", width u16, height u16, 8 reserved bytes,
+# then top-down big-endian RGB565 rows, the byte order of the device's sprite
+# buffer, so drawing is a copy instead of a per-pixel decode.
+SYNC_RGB565_MAGIC = b'Z565'
+SYNC_RGB565_HEADER = '<4sHH8x'
+
+# Devices asking with enc=audio get sounds in the profile they decode
+# cheapest: MP3 tracks mono at the I2S rate (VAL_SFX_DEFAULT_RATE, so a track
+# never retunes I2S or makes the effects resample) and a low CBR bitrate,
+# through ffmpeg when it is installed; 16-bit PCM WAV effects as mono
+# IMA-ADPCM (4 bits a sample), which sfxBankLoad() expands into PSRAM once.
+# A transcoded file is kept only when it is smaller.
+SYNC_AUDIO_RATE = 44100
+SYNC_AUDIO_MP3_KBPS = 64
+SYNC_AUDIO_ADPCM_BLOCK = 512  # bytes, 1017 samples a block
+SYNC_AUDIO_FFMPEG = 'ffmpeg'
+SYNC_AUDIO_FFMPEG_TIMEOUT_S = 60
+
+# Asset tags, .tags.json in the sync folder: {"<name pattern>": {"role":
+# "human" or a list, "class": "xGame" or a list, "prio": n}, ...}, the first
+# pattern that matches a file tags it. /list?class=xGame&roles=human,zombie
+# leaves out what another class or role is tagged for; an untagged file, or a
+# request without class / roles, matches all. Lower prio is listed (and so
+# fetched) first. Dot files are never listed. "tier": "psram" or "stream"
+# tells the device where to keep the file (serverSync.h): a streamed one is
+# read from its flash and never sent compressed, untiered files go to PSRAM
+# while it has room.
+SYNC_TAGS_FILE = '.tags.json'
+SYNC_DEFAULT_PRIO = 5
+
+# The sync folder index: name -> path with its (size, mtime), walked again on
+# a watcher event (watchdog, when installed) or else at most every
+# SYNC_INDEX_TTL_S; hashes and /list answers are kept until a file changes
+SYNC_INDEX_TTL_S = 2
+
+# /download hands the stored file to the socket (socket.sendfile, a copy loop
+# where the OS has none), answers a single Range and If-None-Match against an
+# ETag of the stored hash, and serves at most SYNC_CLIENT_STREAMS files at once
+# to one address (the firmware runs two downloaders)
+SYNC_CLIENT_STREAMS = 3
+SYNC_SEND_CHUNK = 65536
+
+# Sync benchmark (lib/serverSyncer/syncBench.h): /bench?size=..&seed=.. is a
+# synthetic download through the same admission gate and per-client stream
+# limit as /download, pseudo-random bytes so no encoding on the way shrinks it
+SYNC_BENCH_MAX_SIZE = 16 * 1024 * 1024
+SYNC_BENCH_BLOB_SIZE = 1024 * 1024
+
+# Firmware benchmark (src/bench.h): the benchmark command runs a named suite,
+# the device posts the JSON report to /benchmark. Reports are compared per
+# bench by build, board (device class and chip revision) or battery band.
+BENCH_SUITES = ('all', 'records', 'display', 'json', 'net')
+BENCH_DEF_ITERATIONS = 100
+BENCH_MAX_ITERATIONS = 2000
+BENCH_GROUPS = ('build', 'board', 'battery', 'tunables')
+BENCH_BATTERY_BAND = 25     # % per battery group
+
+# Multicast OTA: the firmware goes round as numbered blocks on one group, every
+# updating device fills its bitmap from the same stream and NACKs (by unicast
+# to the carousel port) only what it missed, so the AP carries each block about
+# once however many devices update. A device joins by NACKing the whole image.
+# Block: "ZOB1", image id u32, image size u32, block index u32, payload
+# NACK:  "ZON1", image id u32, then (first block u32, count u16) ranges
+OTA_MCAST_GROUP = '239.255.42.1'
+OTA_MCAST_PORT = 5006
+OTA_MCAST_BLOCK = 1024
+OTA_MCAST_RESEND_S = 1.5  # a block asked for again this soon is still in flight
+OTA_MCAST_IDLE_S = 15     # the carousel is dropped this long after the last NACK
+
+# Read-only asset image for the devices' "assets" flash partition, which they
+# map with esp_partition_mmap and read bitmaps from without copying them.
+# Header (16 bytes): magic, version u16, count u16, image size u32, reserved u32
+# Entry  (16 bytes): FNV-1a hash of the name u32, offset u32, size u32, format u8, pad
+ASSET_PACK_MAGIC = b'ZAP1'
+ASSET_PACK_VERSION = 1
+ASSET_PACK_CAPACITY = 0x1E0000  # size of the assets partition
+ASSET_PACK_ALIGN = 16
+ASSET_PACK_FILE = '.asset_pack.bin'
+ASSET_FORMATS = {'.bmp': 1, '.mp3': 2, '.json': 3, '.zan': 5}  # anything else is 0, raw
+ASSET_PACK_ORDER = ('.bmp', '.zan', '.json')  # packed first, the rest goes in while it fits
+ASSET_FORMAT_RGB565 = 4  # bitmaps are packed pre-converted when bmp_to_rgb565 takes them
+
+
+def bmp_to_rgb565(data):
+    """24-bit uncompressed BMP to the Z565 image, None for anything else"""
+    if len(data) < 54 or data[:2] != b'BM':
+        return None
+    offset, = struct.unpack_from('<I', data, 10)
+    width, height = struct.unpack_from('<ii', data, 18)
+    planes, bpp, compression = struct.unpack_from('<HHI', data, 26)
+    if planes != 1 or bpp != 24 or compression != 0 or not 0 < width < 0x10000 or not 0 < abs(height) < 0x10000:
+        return None
+    bottom_up = height > 0
+    height = abs(height)
+    row_size = (width * 3 + 3) & ~3
+    if offset + row_size * height > len(data):
+        return None
+    out = bytearray(struct.pack(SYNC_RGB565_HEADER, SYNC_RGB565_MAGIC, width, height))
+    for row in range(height):
+        start = offset + (height - 1 - row if bottom_up else row) * row_size
+        line = data[start:start + width * 3]
+        for i in range(0, width * 3, 3):
+            b, g, r = line[i], line[i + 1], line[i + 2]
+            px = ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3)
+            out += bytes((px >> 8, px & 0xFF))
+    return bytes(out)
+
+
+IMA_STEPS = (
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+    253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+    1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+    3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442,
+    11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767)
+IMA_INDEX = (-1, -1, -1, -1, 2, 4, 6, 8)
+
+
+def wav_to_ima_adpcm(data, rate=SYNC_AUDIO_RATE, block=SYNC_AUDIO_ADPCM_BLOCK):
+    """16-bit PCM WAV to a mono IMA-ADPCM WAV at no more than rate, None for anything else"""
+    try:
+        with wave.open(io.BytesIO(data)) as w:
+            channels, width, src_rate = w.getnchannels(), w.getsampwidth(), w.getframerate()
+            frames = w.readframes(w.getnframes())
+    except (wave.Error, EOFError):
+        return None
+    if width != 2 or channels not in (1, 2) or not frames:
+        return None
+    pcm = struct.unpack(f'<{len(frames) // 2}h', frames[:len(frames) // 2 * 2])
+    if channels == 2:
+        pcm = [(pcm[i] + pcm[i + 1]) >> 1 for i in range(0, len(pcm) - 1, 2)]
+    if src_rate > rate:
+        # linear, the effects are short and band limited enough for it
+        step = src_rate / rate
+        pcm = [int(pcm[int(i * step)] + (pcm[min(int(i * step) + 1, len(pcm) - 1)] - pcm[int(i * step)]) * (i * step % 1))
+               for i in range(int(len(pcm) / step))]
+        src_rate = rate
+    per_block = (block - 4) * 2 + 1
+    out = bytearray()
+    index = 0
+    for start in range(0, len(pcm), per_block):
+        chunk = list(pcm[start:start + per_block])
+        chunk += [chunk[-1]] * (per_block - len(chunk))
+        predictor = chunk[0]
+        out += struct.pack('<hBx', predictor, index)
+        nibbles = []
+        for sample in chunk[1:]:
+            step = IMA_STEPS[index]
+            diff = sample - predictor
+            nibble = 0
+            if diff < 0:
+                nibble, diff = 8, -diff
+            delta = step >> 3
+            for bit in (4, 2, 1):
+                if diff >= step:
+                    nibble |= bit
+                    diff -= step
+                    delta += step
+                step >>= 1
+            predictor = max(-32768, min(32767, predictor - delta if nibble & 8 else predictor + delta))
+            index = max(0, min(88, index + IMA_INDEX[nibble & 7]))
+            nibbles.append(nibble)
+        out += bytes(nibbles[i] | (nibbles[i + 1] << 4) for i in range(0, len(nibbles), 2))
+    fmt = struct.pack('<HHIIHHHH', 0x11, 1, src_rate, src_rate * block // per_block, block, 4, 2, per_block)
+    body = (b'WAVE' + b'fmt ' + struct.pack('<I', len(fmt)) + fmt +
+            b'fact' + struct.pack('<II', 4, len(pcm)) + b'data' + struct.pack('<I', len(out)) + out)
+    return b'RIFF' + struct.pack('<I', len(body)) + body
+
+
+def mp3_transcode(data, rate=SYNC_AUDIO_RATE, kbps=SYNC_AUDIO_MP3_KBPS):
+    """MP3 re-encoded mono at rate and kbps through ffmpeg, None when that is not possible"""
+    try:
+        result = subprocess.run([SYNC_AUDIO_FFMPEG, '-v', 'error', '-i', 'pipe:0', '-map', '0:a', '-map_metadata', '-1',
+                                 '-ac', '1', '-ar', str(rate), '-b:a', f'{kbps}k', '-f', 'mp3', 'pipe:1'],
+                                input=data, capture_output=True, timeout=SYNC_AUDIO_FFMPEG_TIMEOUT_S)
+    except (OSError, subprocess.TimeoutExpired):
+        return None
+    return result.stdout if result.returncode == 0 and result.stdout else None
+
+
+def transcode_audio(name, data):
+    """The device profile of a sound, None when there is none or it would not be smaller"""
+    ext = os.path.splitext(name)[1].lower()
+    converted = wav_to_ima_adpcm(data) if ext == '.wav' else mp3_transcode(data) if ext == '.mp3' else None
+    return converted if converted and len(converted) < len(data) else None
+
+
+def asset_name_hash(name):
+    """FNV-1a of the file name without the leading '/', as the firmware computes it"""
+    h = 0x811C9DC5
+    for byte in name.lstrip('/').encode():
+        h = ((h ^ byte) * 0x01000193) & 0xFFFFFFFF
+    return h
+
+
+def build_asset_pack(paths, out_path, capacity=ASSET_PACK_CAPACITY):
+    """Packs files into an asset image, returns (packed names, skipped names)"""
+    def order(path):
+        ext = os.path.splitext(path)[1].lower()
+        rank = ASSET_PACK_ORDER.index(ext) if ext in ASSET_PACK_ORDER else len(ASSET_PACK_ORDER)
+        return (rank, os.path.basename(path))
+    
+    paths = sorted(paths, key=order)
+    table_size = 16 + 16 * len(paths)
+    offset = (table_size + ASSET_PACK_ALIGN - 1) // ASSET_PACK_ALIGN * ASSET_PACK_ALIGN
+    entries, blobs, packed, skipped, hashes = [], [], [], [], {}
+    for path in paths:
+        name = os.path.basename(path)
+        name_hash = asset_name_hash(name)
+        if name_hash in hashes:
+            raise ValueError(f"asset name hash collision: {name} / {hashes[name_hash]}")
+        with open(path, 'rb') as f:
+            data = f.read()
+        fmt = ASSET_FORMATS.get(os.path.splitext(name)[1].lower(), 0)
+        if fmt == ASSET_FORMATS['.bmp']:
+            converted = bmp_to_rgb565(data)
+            if converted:
+                data, fmt = converted, ASSET_FORMAT_RGB565
+        else:
+            data = transcode_audio(name, data) or data
+        size = len(data)
+        if offset + size > capacity:
+            skipped.append(name)
+            continue
+        hashes[name_hash] = name
+        entries.append(struct.pack('<IIIB3x', name_hash, offset, size, fmt))
+        padding = (-size) % ASSET_PACK_ALIGN
+        blobs.append(data + b'\0' * padding)
+        offset += size + padding
+        packed.append(name)
+    
+    header = struct.pack('<4sHHII', ASSET_PACK_MAGIC, ASSET_PACK_VERSION, len(entries), offset, 0)
+    table = header + b''.join(entries)
+    table += b'\0' * ((table_size + ASSET_PACK_ALIGN - 1) // ASSET_PACK_ALIGN * ASSET_PACK_ALIGN - len(table))
+    with open(out_path, 'wb') as f:
+        f.write(table)
+        for blob in blobs:
+            f.write(blob)
+    return packed, skipped
+
+# Encoded OTA images, asked for with /update?enc=zlib,delta&from=<md5>: the
+# firmware deflated, or a deflated patch against the device's running build
+# when the archive has it. Patch: "ZDP1", old size u32, new size u32, then
+# records of diff length u32, extra length u32, old seek i32, the diff bytes
+# (new minus old, bytewise, from the current old position) and the extra bytes.
+OTA_DELTA_MAGIC = b'ZDP1'
+OTA_DELTA_KEY = 32          # exact match that seeds a copy from the old image
+OTA_DELTA_STEP = 8          # the old image is indexed every this many bytes
+OTA_DELTA_SLACK = 16        # mismatches over matches that end the approximate extension
+OTA_DELTA_MAX_RATIO = 0.8   # a patch not this much smaller than the zlib image is not served
+OTA_DELTA_WAIT_S = 3        # an /update waits this long for a patch being built, then gets zlib
+OTA_HISTORY_DIR = 'history'
+OTA_HISTORY_KEEP = 8        # earlier builds kept to diff against
+OTA_CACHE_DIR = '.ota_cache'
+
+
+def ota_delta_match_len(new, i, old, j):
+    """Length of the copy of old[j:] at new[i:], exact first, then bsdiff style
+    on while matches outweigh the mismatches (shifted code changes addresses,
+    not much else)"""
+    n = min(len(new) - i, len(old) - j)
+    k = 0
+    while k + 64 <= n and new[i + k:i + k + 64] == old[j + k:j + k + 64]:
+        k += 64
+    while k < n and new[i + k] == old[j + k]:
+        k += 1
+    best, score, best_score = k, 0, 0
+    while k < n:
+        score += 1 if new[i + k] == old[j + k] else -1
+        k += 1
+        if score > best_score:
+            best, best_score = k, score
+        elif score < best_score - OTA_DELTA_SLACK:
+            break
+    return best
+
+
+def ota_delta_build(old, new):
+    """Patch turning old into new, uncompressed"""
+    index = {}
+    for j in range(0, len(old) - OTA_DELTA_KEY + 1, OTA_DELTA_STEP):
+        index.setdefault(old[j:j + OTA_DELTA_KEY], j)
+    out = bytearray(struct.pack('<4sII', OTA_DELTA_MAGIC, len(old), len(new)))
+    # the copy the next record starts with: new position, old position, length
+    copy_new, copy_old, copy_len = 0, 0, 0
+    i = 0
+    while True:
+        j = None
+        while i <= len(new) - OTA_DELTA_KEY:
+            j = index.get(bytes(new[i:i + OTA_DELTA_KEY]))
+            if j is not None:
+                break
+            i += 1
+        if j is None:
+            i = len(new)
+        else:
+            covered = copy_new + copy_len
+            while i > covered and j > 0 and new[i - 1] == old[j - 1]:
+                i -= 1
+                j -= 1
+        diff = bytes((a - b) & 0xFF for a, b in zip(new[copy_new:copy_new + copy_len],
+                                                    old[copy_old:copy_old + copy_len]))
+        extra = new[copy_new + copy_len:i]
+        seek = (j - (copy_old + copy_len)) if j is not None else 0
+        out += struct.pack('<IIi', len(diff), len(extra), seek)
+        out += diff
+        out += extra
+        if j is None:
+            return bytes(out)
+        copy_new, copy_old, copy_len = i, j, ota_delta_match_len(new, i, old, j)
+        i += copy_len
+
+
+def ota_delta_apply(old, patch):
+    """new from old and an uncompressed patch, for checking a patch before it is served"""
+    magic, old_size, new_size = struct.unpack_from('<4sII', patch)
+    if magic != OTA_DELTA_MAGIC or old_size != len(old):
+        raise ValueError("patch does not fit the old image")
+    out = bytearray()
+    pos, old_pos = 12, 0
+    while len(out) < new_size:
+        diff_len, extra_len, seek = struct.unpack_from('<IIi', patch, pos)
+        pos += 12
+        if old_pos < 0 or old_pos + diff_len > len(old):
+            raise ValueError("patch reads outside the old image")
+        out += bytes((a + b) & 0xFF for a, b in zip(patch[pos:pos + diff_len], old[old_pos:old_pos + diff_len]))
+        pos += diff_len
+        out += patch[pos:pos + extra_len]
+        pos += extra_len
+        old_pos += diff_len + seek
+    if len(out) != new_size or pos != len(patch):
+        raise ValueError("patch length mismatch")
+    return bytes(out)
+
+
+class OTAImageCache:
+    """zlib and delta encodings of the served firmware, kept in firmware_dir/.ota_cache.
+    Each firmware served is archived in firmware_dir/history by its MD5, which is
+    what devices report as their running build, to diff the next one against"""
+    
+    def __init__(self, log):
+        self.log = log
+        self.lock = threading.Lock()
+        self.building = {}  # (from md5, to md5): Event set when the build ended
+    
+    def archive(self, firmware_dir, firmware_path, md5):
+        history = os.path.join(firmware_dir, OTA_HISTORY_DIR)
+        path = os.path.join(history, md5 + '.bin')
+        try:
+            os.makedirs(history, exist_ok=True)
+            if not os.path.exists(path):
+                with open(firmware_path, 'rb') as src, open(path + '.tmp', 'wb') as dst:
+                    dst.write(src.read())
+                os.replace(path + '.tmp', path)
+                builds = sorted((os.path.join(history, n) for n in os.listdir(history) if n.endswith('.bin')),
+                                key=os.path.getmtime)
+                for old in builds[:-OTA_HISTORY_KEEP]:
+                    os.remove(old)
+        except OSError as e:
+            self.log(f"OTA history archive failed: {e}", "WARNING")
+    
+    def zlib_image(self, firmware_dir, firmware_path, md5):
+        path = os.path.join(firmware_dir, OTA_CACHE_DIR, md5 + '.zlib')
+        with self.lock:
+            if not os.path.exists(path):
+                os.makedirs(os.path.dirname(path), exist_ok=True)
+                with open(firmware_path, 'rb') as f:
+                    data = zlib.compress(f.read(), 9)
+                with open(path + '.tmp', 'wb') as f:
+                    f.write(data)
+                os.replace(path + '.tmp', path)
+        return path
+    
+    def delta_path(self, firmware_dir, from_md5, md5):
+        return os.path.join(firmware_dir, OTA_CACHE_DIR, f"{from_md5}-{md5}.zdp")
+    
+    def delta_image(self, firmware_dir, firmware_path, md5, from_md5, wait_s=0):
+        """Path of the patch from from_md5 to md5, None when there is none yet
+        or it does not pay; starts building it in the background"""
+        from_md5 = ''.join(c for c in from_md5.lower() if c in '0123456789abcdef')
+        old_path = os.path.join(firmware_dir, OTA_HISTORY_DIR, from_md5 + '.bin')
+        if len(from_md5) != 32 or from_md5 == md5 or not os.path.exists(old_path):
+            return None
+        path = self.delta_path(firmware_dir, from_md5, md5)
+        key = (from_md5, md5)
+        with self.lock:
+            done = self.building.get(key)
+            if done is None and not os.path.exists(path) and not os.path.exists(path + '.none'):
+                done = threading.Event()
+                self.building[key] = done
+                threading.Thread(target=self.build_delta, args=(firmware_dir, firmware_path, md5, old_path, path, done),
+                                 daemon=True).start()
+        if done is not None:
+            done.wait(wait_s)
+        return path if os.path.exists(path) else None
+    
+    def build_delta(self, firmware_dir, firmware_path, md5, old_path, path, done):
+        try:
+            start = time.time()
+            with open(old_path, 'rb') as f:
+                old = f.read()
+            with open(firmware_path, 'rb') as f:
+                new = f.read()
+            patch = ota_delta_build(old, new)
+            if ota_delta_apply(old, patch) != new:
+                raise ValueError("patch does not rebuild the image")
+            data = zlib.compress(patch, 9)
+            zlib_size = os.path.getsize(self.zlib_image(firmware_dir, firmware_path, md5))
+            name = os.path.basename(old_path)[:8]
+            if len(data) > zlib_size * OTA_DELTA_MAX_RATIO:
+                open(path + '.none', 'w').close()
+                self.log(f"OTA delta from {name}: {len(data)} bytes, not worth it over zlib {zlib_size}", "INFO")
+            else:
+                with open(path + '.tmp', 'wb') as f:
+                    f.write(data)
+                os.replace(path + '.tmp', path)
+                self.log(f"OTA delta from {name}: {len(data)} bytes for a {len(new)} byte image "
+                         f"(zlib {zlib_size}), built in {time.time() - start:.1f} s", "SUCCESS")
+        except Exception as e:
+            self.log(f"OTA delta build failed: {e}", "ERROR")
+        finally:
+            with self.lock:
+                self.building.pop((os.path.basename(old_path)[:-4], md5), None)
+            done.set()
+    
+    def encoded(self, firmware_dir, firmware_path, md5, accepted, from_md5):
+        """(path, enc) of the smallest image the device takes, enc None for the raw one"""
+        if 'delta' in accepted and from_md5:
+            path = self.delta_image(firmware_dir, firmware_path, md5, from_md5, OTA_DELTA_WAIT_S)
+            if path:
+                return path, 'delta'
+        if 'zlib' in accepted:
+            return self.zlib_image(firmware_dir, firmware_path, md5), 'zlib'
+        return firmware_path, None
+
+# Scalar fields of the one-off boot report, aggregated in /boot_stats
+BOOT_STAT_KEYS = ('ready_ms', 'wifi_assoc_ms', 'dhcp_ms', 'http_n', 'http_ms', 'http_max_ms', 'psram_bytes')
+BOOT_PERCENTILES = (50, 90, 99)
+
+
+# Hit latency reports: per game session, log2 ms histograms per stage
+HIT_LATENCY_STAGES = ('react', 'screen')
+HIT_LATENCY_PERCENTILES = (50, 90, 99)
+
+
+def hist_percentile(hist, pct, max_ms):
+    """Upper edge of the log2 bucket that holds the pct-th sample, capped at max_ms"""
+    total = sum(hist)
+    want = max(1, -(-total * pct // 100))
+    seen = 0
+    for b, count in enumerate(hist):
+        seen += count
+        if seen >= want:
+            upper = (2 << b) - 1 if b < len(hist) - 1 else max_ms
+            return min(upper, max_ms)
+    return max_ms
+
+
+def percentile(values, pct):
+    """Nearest-rank percentile of a non-empty list"""
+    ordered = sorted(values)
+    rank = max(1, -(-len(ordered) * pct // 100))
+    return ordered[rank - 1]
+
+
+# Fleet telemetry: each status report adds a sample of TELEMETRY_KEYS to the
+# device's ring (about three hours at the 5 s report pace), at most one every
+# TELEMETRY_MIN_GAP_S. /telemetry?mac=..&keys=..&since=..&step=.. returns the
+# series, since in epoch seconds or negative for seconds ago, step > 0 averages
+# them into buckets that many seconds wide. step_p99_us and loop_p99_us come
+# from the game loop profile, the last one reported when a delta has none.
+TELEMETRY_RING = 2048
+TELEMETRY_MIN_GAP_S = 2
+TELEMETRY_KEYS = (
+    'battery_mv', 'battery_pct', 'runtime_min', 'free_heap', 'max_alloc_heap', 'rssi', 'accel_activity',
+    'rx_received', 'rx_dropped', 'rx_rejected', 'rx_fps', 'tx_ok', 'tx_fail',
+    'jitter_avg_ms', 'jitter_max_ms', 'step_p99_us', 'loop_p99_us', 'loop_over',
+)
+
+
+class TunableExperiments:
+    """The sets and cohorts of TUNABLES_FILE, read again only when it changes"""
+    
+    def __init__(self, log, path=TUNABLES_FILE):
+        self.log = log
+        self.path = path
+        self.cache = (None, {}, [])  # (file key, sets, cohorts)
+    
+    def load(self):
+        try:
+            stat = os.stat(self.path)
+        except OSError:
+            return {}, []
+        key = (stat.st_size, stat.st_mtime_ns)
+        if self.cache[0] == key:
+            return self.cache[1], self.cache[2]
+        sets, cohorts = {}, []
+        try:
+            with open(self.path, 'r') as f:
+                config = json.load(f)
+            for name, values in config.get('sets', {}).items():
+                if len(name) > TUNABLE_SET_NAME_LEN or not isinstance(values, dict):
+                    self.log(f"Tunable set '{name}' skipped: name over {TUNABLE_SET_NAME_LEN} chars or no values", "WARNING")
+                    continue
+                unknown = [k for k in values if k not in TUNABLE_NAMES]
+                if unknown:
+                    self.log(f"Tunable set '{name}': unknown {', '.join(unknown)} dropped", "WARNING")
+                sets[name] = {k: v for k, v in values.items() if k in TUNABLE_NAMES}
+            for cohort in config.get('cohorts', []):
+                names = cohort.get('split') or [cohort.get('set')]
+                names = [n for n in names if n in sets]
+                if names:
+                    cohorts.append((str(cohort.get('match', '*')).upper(), names))
+            self.log(f"Tunables loaded: {len(sets)} sets, {len(cohorts)} cohorts", "INFO")
+        except Exception as e:
+            self.log(f"Tunables error in {self.path}: {e}", "ERROR")
+        self.cache = (key, sets, cohorts)
+        return sets, cohorts
+    
+    def assign(self, mac, name=''):
+        """(set name, values) the device belongs to, ('', {}) for the defaults"""
+        sets, cohorts = self.load()
+        for pattern, names in cohorts:
+            if fnmatch.fnmatch(mac.upper(), pattern) or fnmatch.fnmatch((name or '').upper(), pattern):
+                picked = names[zlib.crc32(mac.encode()) % len(names)]
+                return picked, sets[picked]
+        return '', {}
+    
+    def summary(self, telemetry, devices, since=None):
+        """Per reported set: its devices and the mean of each telemetry key over their samples"""
+        members = {}
+        for mac, device in devices.items():
+            members.setdefault(device.get('tunable_set') or 'default', []).append(mac)
+        result = {}
+        for set_name, macs in members.items():
+            series = telemetry.query(macs, None, since)
+            entry = {'devices': len(macs)}
+            for key in TELEMETRY_KEYS:
+                values = [v for s in series.values() for v in s.get(key, []) if v is not None]
+                entry[key] = round(sum(values) / len(values), 2) if values else None
+            result[set_name] = entry
+        return result
+
+
+class TelemetryStore:
+    """Per device ring of (time, values in TELEMETRY_KEYS order) samples"""
+    
+    def __init__(self, size=TELEMETRY_RING):
+        self.size = size
+        self.lock = threading.Lock()
+        self.rings = {}  # MAC -> deque of (time, tuple)
+    
+    @staticmethod
+    def sample_of(device):
+        loop = device.get('loop') or {}
+        values = dict(device,
+                      step_p99_us=loop.get('step', {}).get('p99'),
+                      loop_p99_us=loop.get('loop', {}).get('p99'),
+                      loop_over=loop.get('over_total'))
+        return tuple(v if isinstance(v, (int, float)) else None for v in (values.get(k) for k in TELEMETRY_KEYS))
+    
+    def add(self, mac, device, now):
+        with self.lock:
+            ring = self.rings.get(mac)
+            if ring is None:
+                ring = self.rings[mac] = deque(maxlen=self.size)
+            elif now - ring[-1][0] < TELEMETRY_MIN_GAP_S:
+                return
+            ring.append((now, self.sample_of(device)))
+    
+    def query(self, macs=None, keys=None, since=None, step=0):
+        """{MAC: {'t': [...], key: [...]}}, None where a device did not report a key"""
+        keys = [k for k in (keys or TELEMETRY_KEYS) if k in TELEMETRY_KEYS]
+        cols = [TELEMETRY_KEYS.index(k) for k in keys]
+        if since is not None and since < 0:
+            since += time.time()
+        with self.lock:
+            picked = {mac: list(ring) for mac, ring in self.rings.items() if macs is None or mac in macs}
+        result = {}
+        for mac, samples in picked.items():
+            if since is not None:
+                samples = [smp for smp in samples if smp[0] >= since]
+            if step > 0:
+                samples = self.downsample(samples, step)
+            series = {'t': [round(t, 1) for t, _ in samples]}
+            for key, col in zip(keys, cols):
+                series[key] = [values[col] for _, values in samples]
+            result[mac] = series
+        return result
+    
+    @staticmethod
+    def downsample(samples, step):
+        """Mean of every key per bucket of step seconds, stamped with the bucket start"""
+        buckets = []
+        for t, values in samples:
+            start = t - t % step
+            if not buckets or buckets[-1][0] != start:
+                buckets.append((start, [[] for _ in values]))
+            for col, v in enumerate(values):
+                if v is not None:
+                    buckets[-1][1][col].append(v)
+        return [(start, tuple(round(sum(col) / len(col), 2) if col else None for col in cols))
+                for start, cols in buckets]
+    
+    def info(self):
+        with self.lock:
+            return {'devices': len(self.rings), 'samples': sum(len(r) for r in self.rings.values()),
+                    'ring': self.size}
+
+
+# Status history: the reports are queued by /status and a writer thread puts
+# what came in over history_flush_ms into SQLite (WAL) as one transaction, so
+# the request never waits for the disk however large the fleet is. The table
+# keeps every report, the last one per device seeds the device list and the
+# telemetry rings after a restart. /history?mac=..&since=..&limit=.. reads it.
+STATUS_DB_QUEUE_MAX = 50000  # reports waiting for the writer, the oldest are dropped beyond
+STATUS_DB_PRUNE_S = 3600
+STATUS_DB_HISTORY_MAX = 5000  # rows one /history answer returns
+
+
+class StatusHistory(threading.Thread):
+    """Write-behind store of the status reports"""
+    
+    def __init__(self, path, flush_ms=500, keep_days=7, log=None):
+        super().__init__()
+        self.daemon = True
+        self.path = path
+        self.flush_s = max(flush_ms, 50) / 1000
+        self.keep_s = keep_days * 86400
+        self.log = log or (lambda message, level="INFO": None)
+        self.lock = threading.Lock()
+        self.queue = deque()
+        self.wake = threading.Event()
+        self.running = False
+        self.written = 0
+        self.batches = 0
+        self.dropped = 0
+        self.last_batch = (0, 0.0)  # reports, ms
+    
+    def connect(self):
+        db = sqlite3.connect(self.path, timeout=10)
+        db.execute('PRAGMA journal_mode=WAL')
+        db.execute('PRAGMA synchronous=NORMAL')
+        return db
+    
+    def open(self):
+        """Creates the tables; False when the database can not be used"""
+        try:
+            with self.connect() as db:
+                db.execute('CREATE TABLE IF NOT EXISTS status (mac TEXT NOT NULL, t REAL NOT NULL, report TEXT NOT NULL)')
+                db.execute('CREATE INDEX IF NOT EXISTS status_mac_t ON status (mac, t)')
+                db.execute('CREATE INDEX IF NOT EXISTS status_t ON status (t)')
+                db.execute('CREATE TABLE IF NOT EXISTS device (mac TEXT PRIMARY KEY, t REAL NOT NULL, report TEXT NOT NULL)')
+            return True
+        except sqlite3.Error as e:
+            self.log(f"Status history {self.path} not usable: {e}", "ERROR")
+            return False
+    
+    def add(self, mac, device, now):
+        """From the request, only queues a copy"""
+        with self.lock:
+            if len(self.queue) >= STATUS_DB_QUEUE_MAX:
+                self.queue.popleft()
+                self.dropped += 1
+            self.queue.append((mac, now, dict(device)))
+    
+    def flush(self, db):
+        with self.lock:
+            batch, self.queue = self.queue, deque()
+        if not batch:
+            return
+        start = time.time()
+        rows = [(mac, now, json.dumps(device, separators=(',', ':'))) for mac, now, device in batch]
+        with db:
+            db.executemany('INSERT INTO status (mac, t, report) VALUES (?, ?, ?)', rows)
+            db.executemany('INSERT OR REPLACE INTO device (mac, t, report) VALUES (?, ?, ?)', rows)
+        self.written += len(rows)
+        self.batches += 1
+        self.last_batch = (len(rows), round((time.time() - start) * 1000, 1))
+    
+    def run(self):
+        db = self.connect()
+        pruned = 0
+        while self.running or self.queue:
+            self.wake.wait(self.flush_s)
+            self.wake.clear()
+            try:
+                self.flush(db)
+                if time.time() - pruned > STATUS_DB_PRUNE_S:
+                    pruned = time.time()
+                    with db:
+                        gone = db.execute('DELETE FROM status WHERE t < ?', (pruned - self.keep_s,)).rowcount
+                    if gone:
+                        self.log(f"Status history: {gone} reports older than {self.keep_s // 86400} days dropped", "INFO")
+            except sqlite3.Error as e:
+                self.log(f"Status history write failed: {e}", "ERROR")
+        db.close()
+    
+    def start(self):
+        self.running = True
+        super().start()
+    
+    def stop(self):
+        """The queued reports are written before it returns"""
+        self.running = False
+        self.wake.set()
+        self.join(timeout=10)
+    
+    def last_reports(self, since):
+        """{mac: report} of the devices that reported after since"""
+        with self.connect() as db:
+            return {mac: json.loads(report) for mac, report in
+                    db.execute('SELECT mac, report FROM device WHERE t >= ?', (since,))}
+    
+    def query(self, mac=None, since=None, limit=STATUS_DB_HISTORY_MAX):
+        """[(mac, t, report)], oldest first"""
+        sql = 'SELECT mac, t, report FROM status WHERE t >= ?'
+        args = [since or 0]
+        if mac:
+            sql += ' AND mac = ?'
+            args.append(mac)
+        sql += ' ORDER BY t DESC LIMIT ?'
+        args.append(min(limit, STATUS_DB_HISTORY_MAX))
+        with self.connect() as db:
+            rows = db.execute(sql, args).fetchall()
+        return [(m, t, json.loads(report)) for m, t, report in reversed(rows)]
+    
+    def info(self):
+        with self.lock:
+            queued = len(self.queue)
+        return {'db': self.path, 'queued': queued, 'written': self.written, 'batches': self.batches,
+                'dropped': self.dropped, 'last_batch': self.last_batch[0], 'last_batch_ms': self.last_batch[1]}
+
+
+# Boot storm pacing: a few devices transfer at a time, the others get 503 with
+# Retry-After and come back with jitter. A device's slot is a lease renewed by
+# each of its requests (file sync is many of them) and dropped when it goes idle.
+ADMISSION_LEASE_S = 15        # a slot idle this long is given to the next device
+ADMISSION_MIN_RETRY_S = 2
+ADMISSION_MAX_RETRY_S = 120
+
+
+class AdmissionGate:
+    """Transfer slots by client address, FIFO among the devices turned away"""
+    
+    def __init__(self, name, limit, typical_s):
+        self.name = name
+        self.limit = limit
+        self.typical_s = typical_s  # running average of a slot's time, for Retry-After
+        self.lock = threading.Lock()
+        self.active = {}   # key: (admitted at, last seen)
+        self.waiting = {}  # key: (first refused at, expected back by)
+        self.admitted = 0
+        self.refused = 0
+    
+    def expire(self, now):
+        for key, (start, seen) in list(self.active.items()):
+            if now - seen > ADMISSION_LEASE_S:
+                self.end(key, now)
+        for key, (_, due) in list(self.waiting.items()):
+            if now > due + ADMISSION_LEASE_S:
+                del self.waiting[key]
+    
+    def end(self, key, now):
+        start, seen = self.active.pop(key)
+        # an expired lease counts to its last request, not the idle time after it
+        self.typical_s = 0.8 * self.typical_s + 0.2 * max(seen - start, 1)
+    
+    def admit(self, key, limit=None):
+        """None when the device may go ahead, else the seconds it should wait"""
+        now = time.time()
+        limit = self.limit if limit is None else limit
+        with self.lock:
+            self.expire(now)
+            if key in self.active:
+                self.active[key] = (self.active[key][0], now)
+                return None
+            ahead = sum(1 for k, (first, _) in self.waiting.items()
+                        if k != key and first < self.waiting.get(key, (now,))[0])
+            if len(self.active) + ahead < limit:
+                self.waiting.pop(key, None)
+                self.active[key] = (now, now)
+                self.admitted += 1
+                return None
+            rounds = 1 + ahead // max(limit, 1)
+            retry = int(min(max(self.typical_s * rounds, ADMISSION_MIN_RETRY_S), ADMISSION_MAX_RETRY_S))
+            first = self.waiting.get(key, (now,))[0]
+            self.waiting[key] = (first, now + retry)
+            self.refused += 1
+            return retry
+    
+    def release(self, key):
+        with self.lock:
+            if key in self.active:
+                self.end(key, time.time())
+    
+    def info(self):
+        with self.lock:
+            self.expire(time.time())
+            return {'active': len(self.active), 'waiting': len(self.waiting), 'limit': self.limit,
+                    'admitted': self.admitted, 'refused': self.refused, 'typical_s': round(self.typical_s, 1)}
+
+
+# OTA images are read once per version and served from memory to every
+# connection. With a rate budget each transfer in flight is paced to an even
+# share of it, OTA_SEND_SLICE at a time, so the devices of an admission batch
+# finish together instead of the ones with the better link starving the rest
+OTA_SEND_SLICE = 8192
+OTA_BLOB_KEEP = 4  # images in memory: the build and its zlib and delta encodings
+
+
+class BlobCache:
+    """File contents by path, read again only when the file changes"""
+    
+    def __init__(self, keep):
+        self.keep = keep
+        self.lock = threading.Lock()
+        self.blobs = {}  # path -> ((size, mtime), bytes), least recently used first
+    
+    def get(self, path):
+        stat = os.stat(path)
+        key = (stat.st_size, stat.st_mtime_ns)
+        # under the lock, the connections that ask meanwhile wait for the one read
+        with self.lock:
+            entry = self.blobs.pop(path, None)
+            if not entry or entry[0] != key:
+                with open(path, 'rb') as f:
+                    entry = (key, f.read())
+            self.blobs[path] = entry
+            while len(self.blobs) > self.keep:
+                del self.blobs[next(iter(self.blobs))]
+            return entry[1]
+
+
+class TransferPacer:
+    """Splits a byte rate evenly among the transfers running"""
+    
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.active = 0
+        self.sent = 0
+    
+    def send(self, write, data, rate_kbps):
+        """Writes data in slices, each after its share of the budget allows it"""
+        view = memoryview(data)
+        with self.lock:
+            self.active += 1
+        try:
+            due = time.monotonic()
+            for pos in range(0, len(view), OTA_SEND_SLICE):
+                piece = view[pos:pos + OTA_SEND_SLICE]
+                if rate_kbps > 0:
+                    delay = due - time.monotonic()
+                    if delay > 0:
+                        time.sleep(delay)
+                    # a stall is not made up for with a burst
+                    due = max(due, time.monotonic() - 0.1) + len(piece) * self.active * 8 / (rate_kbps * 1000)
+                write(piece)
+                with self.lock:
+                    self.sent += len(piece)
+        finally:
+            with self.lock:
+                self.active -= 1
+    
+    def info(self, rate_kbps):
+        with self.lock:
+            return {'active': self.active, 'rate_kbps': rate_kbps, 'sent': self.sent,
+                    'share_kbps': round(rate_kbps / self.active) if rate_kbps and self.active else rate_kbps}
+
+
 class SingleInstance:
     """
     Ensures only one instance of the application runs at a time.
@@ -153,13 +1087,28 @@ class SettingsManager:
         self.save_config()
 
 # ============== Discovery Server ==============
+# Game servers of the arenas announce themselves on the discovery port (see
+# ArenaAnnouncer of zombie_game_native.py), the device's "arena=" of its
+# request picks the one its service map names
+ARENA_ANNOUNCE = b'ZGAME-ARENA'
+ARENA_TTL_S = 15  # three missed announces and the arena falls back to the configured port
+
+
 class DiscoveryServer:
     def __init__(self, log_callback=None, settings=None):
         self.log_callback = log_callback
         self.settings = settings
+        self.host = None  # AsyncServiceHost, else a thread per interface
         self.running = False
         self.threads = []
         self.sockets = []
+        self.host_keys = []
+        self.epoch = int(time.time())
+        self.firmware_info = None  # () -> (version, md5) of the OTA firmware, or None
+        self.services = None  # () -> {'file': port, ...} of the services running
+        self.assets_signature = None  # () -> hash of the sync folder, or None
+        self.arenas = {}  # arena -> (ip, port, started, last announce) of its game server
+        self.arenas_lock = threading.Lock()
     
     @property
     def port(self):
@@ -205,12 +1154,9 @@ class DiscoveryServer:
             while self.running:
                 try:
                     data, addr = sock.recvfrom(64)
-                    self.log(f"Received from {addr[0]}:{addr[1]} on {interface_name}: {data.decode('utf-8', errors='ignore')}")
-                    
-                    if b'ESP32-LOOK' in data:
-                        response = interface_ip.encode()
-                        sock.sendto(response, addr)
-                        self.log(f"Sent response '{interface_ip}' to {addr[0]}:{addr[1]}", "SUCCESS")
+                    reply = self.answer(data, addr, interface_ip, interface_name)
+                    if reply:
+                        sock.sendto(reply, addr)
                         
                 except socket.timeout:
                     continue
@@ -226,6 +1172,95 @@ class DiscoveryServer:
             except:
                 pass
     
+    def answer(self, data, addr, interface_ip, interface_name):
+        """The reply to a discovery request, None for anything else"""
+        if data.startswith(ARENA_ANNOUNCE):
+            self.arena_announced(data, addr)
+            return None
+        self.log(f"Received from {addr[0]}:{addr[1]} on {interface_name}: {data.decode('utf-8', errors='ignore')}")
+        if b'ESP32-LOOK' not in data:
+            return None
+        reply = interface_ip
+        # newer devices cache the server and use the epoch to spot restarts
+        if data.startswith(b'ESP32-LOOK2'):
+            reply = f"{interface_ip};{self.epoch}"
+            # ... and skip the OTA version request when already current
+            firmware = self.firmware_info() if self.firmware_info else None
+            if firmware:
+                reply += f";{firmware[0]};{firmware[1]}"
+        elif data.startswith(b'ESP32-LOOK3'):
+            reply = self.service_reply(interface_ip, self.arena_of(data))
+        self.log(f"Sent response '{reply}' to {addr[0]}:{addr[1]}", "SUCCESS")
+        return reply.encode()
+    
+    @staticmethod
+    def arena_of(data):
+        """The arena a request names, "ESP32-LOOK3;arena=<n>", 0 without one"""
+        for field in data.decode('utf-8', errors='ignore').split(';')[1:]:
+            key, _, value = field.partition('=')
+            if key == 'arena' and value.isdigit():
+                return int(value)
+        return 0
+    
+    def arena_announced(self, data, addr):
+        """ "ZGAME-ARENA;<arena>;<port>;<started>" of an arena's game server"""
+        try:
+            _, arena, port, started = data.decode('utf-8').split(';')[:4]
+            arena, port, started = int(arena), int(port), int(started)
+        except ValueError:
+            self.log(f"Bad arena announce from {addr[0]}: {data[:64]}", "WARNING")
+            return
+        now = time.time()
+        with self.arenas_lock:
+            known = self.arenas.get(arena)
+            self.arenas[arena] = (addr[0], port, started, now)
+        if known is None or known[:3] != (addr[0], port, started) or now - known[3] > ARENA_TTL_S:
+            self.log(f"Arena {arena}: game server at {addr[0]}:{port}", "SUCCESS")
+    
+    def arena_server(self, arena):
+        """(ip, port) of the arena's game server, ip None for this machine"""
+        with self.arenas_lock:
+            shard = self.arenas.get(arena)
+        if shard and time.time() - shard[3] <= ARENA_TTL_S:
+            return (None if shard[0].startswith('127.') else shard[0]), shard[1]
+        if arena:
+            base = self.settings.get('discovery', 'arena_port_base', 5100) if self.settings else 5100
+            return None, base + arena
+        return None, self.game_port
+    
+    def arena_list(self):
+        now = time.time()
+        with self.arenas_lock:
+            return {arena: {'ip': s[0], 'port': s[1], 'age_s': round(now - s[3], 1)}
+                    for arena, s in sorted(self.arenas.items()) if now - s[3] <= ARENA_TTL_S}
+    
+    def service_reply(self, interface_ip, arena=0):
+        """The service map: "<ip>;<epoch>" then key=value fields, fw=<version>:<md5>
+        of the OTA firmware, the port of every service running and assets=<hash>
+        of the sync folder, so one round trip tells a device what it can skip.
+        game= is the game server of the device's arena, <ip>:<port> when it
+        runs on another machine"""
+        fields = [interface_ip, str(self.epoch)]
+        firmware = self.firmware_info() if self.firmware_info else None
+        if firmware:
+            fields.append(f"fw={firmware[0]}:{firmware[1]}")
+        for name, port in (self.services() if self.services else {}).items():
+            if name == 'game':
+                ip, port = self.arena_server(arena)
+                if ip and ip != interface_ip:
+                    port = f"{ip}:{port}"
+            fields.append(f"{name}={port}")
+        signature = self.assets_signature() if self.assets_signature else None
+        if signature:
+            fields.append(f"assets={signature}")
+        return ';'.join(fields)
+    
+    @property
+    def game_port(self):
+        if self.settings:
+            return self.settings.get('discovery', 'game_port', 5000)
+        return 5000
+    
     def start(self, interfaces):
         if self.running:
             self.log("Server already running", "WARNING")
@@ -241,6 +1276,10 @@ class DiscoveryServer:
         
         self.log(f"Starting discovery server on {len(interfaces)} interface(s)...")
         
+        if self.host:
+            self.start_on_host(interfaces)
+            return
+        
         for interface in interfaces:
             if interface['enabled']:
                 thread = threading.Thread(
@@ -255,6 +1294,22 @@ class DiscoveryServer:
             self.log("No interfaces were started", "ERROR")
             self.running = False
     
+    def start_on_host(self, interfaces):
+        self.host_keys = []
+        for interface in interfaces:
+            if not interface['enabled']:
+                continue
+            ip, name = interface['ip'], interface['name']
+            try:
+                self.host.serve_udp(ip, self.port, lambda data, addr, ip=ip, name=name: self.answer(data, addr, ip, name))
+                self.host_keys.append((ip, self.port))
+                self.log(f"Listening on {name} ({ip}:{self.port}), service host", "SUCCESS")
+            except Exception as e:
+                self.log(f"Failed to bind to {name} ({ip}): {str(e)}", "ERROR")
+        if not self.host_keys:
+            self.log("No interfaces were started", "ERROR")
+            self.running = False
+    
     def stop(self):
         if not self.running:
             return
@@ -262,6 +1317,10 @@ class DiscoveryServer:
         self.log("Stopping discovery server...")
         self.running = False
         
+        for key in self.host_keys:
+            self.host.close(key)
+        self.host_keys = []
+        
         for sock in self.sockets:
             try:
                 sock.close()
@@ -277,13 +1336,179 @@ class DiscoveryServer:
 
 
 # ============== File Server ==============
+def parse_byte_range(header, size):
+    """(start, end) of a single 'bytes=' range, None for the whole file (no
+    header, or one this server does not split), False when unsatisfiable"""
+    if not header or not header.startswith('bytes=') or ',' in header:
+        return None
+    first, _, last = header[6:].strip().partition('-')
+    try:
+        if not first:
+            # the last n bytes
+            length = int(last)
+            if length <= 0:
+                return False
+            return (max(size - length, 0), size - 1)
+        start = int(first)
+        end = min(int(last), size - 1) if last else size - 1
+    except ValueError:
+        return None
+    if start >= size or start > end:
+        return False
+    return (start, end)
+
+
+class SendfileBody:
+    """WSGI body that writes a file range into the socket the request came in on"""
+    def __init__(self, path, offset, length, sock, on_close=None):
+        self.path = path
+        self.offset = offset
+        self.length = length
+        self.sock = sock
+        self.on_close = on_close
+
+    def __iter__(self):
+        with open(self.path, 'rb') as f:
+            if self.sock is not None:
+                # the server sends the status and headers with the first piece
+                yield b''
+                self.sock.sendfile(f, self.offset, self.length)
+                return
+            f.seek(self.offset)
+            left = self.length
+            while left > 0:
+                chunk = f.read(min(SYNC_SEND_CHUNK, left))
+                if not chunk:
+                    break
+                left -= len(chunk)
+                yield chunk
+
+    def close(self):
+        on_close, self.on_close = self.on_close, None
+        if on_close:
+            on_close()
+
+
+_bench_blob = None
+
+
+def bench_group_key(report, group):
+    """The group a firmware benchmark report falls in, see BENCH_GROUPS"""
+    if group == 'build':
+        return str(report.get('build', '?'))
+    if group == 'board':
+        return f"{report.get('class', '?')} rev {report.get('chip_rev', '?')}"
+    if group == 'tunables':
+        return report.get('tunables') or 'default'
+    pct = report.get('battery_pct')
+    if not isinstance(pct, (int, float)):
+        return '?'
+    low = min(int(pct) // BENCH_BATTERY_BAND * BENCH_BATTERY_BAND, 100 - BENCH_BATTERY_BAND)
+    return f"{low}-{low + BENCH_BATTERY_BAND}%"
+
+
+def median(values):
+    values = sorted(values)
+    if not values:
+        return 0
+    mid = len(values) // 2
+    return values[mid] if len(values) % 2 else (values[mid - 1] + values[mid]) / 2
+
+
+def benchmark_summary(reports, group):
+    """Per bench and group of the MAC -> report dict: devices, median of the
+    median_ns and p99_ns, and how much slower than the fastest group, sorted
+    by bench then median"""
+    samples = {}
+    for report in reports.values():
+        if report.get('error'):
+            continue
+        key = bench_group_key(report, group)
+        for bench in report.get('bench', []):
+            entry = samples.setdefault((bench.get('name', '?'), key), {'median': [], 'p99': []})
+            entry['median'].append(bench.get('median_ns', 0))
+            entry['p99'].append(bench.get('p99_ns', 0))
+    rows = []
+    for (name, key), entry in samples.items():
+        rows.append({'bench': name, 'group': key, 'devices': len(entry['median']),
+                     'median_ns': median(entry['median']), 'p99_ns': median(entry['p99'])})
+    fastest = {}
+    for row in rows:
+        if row['bench'] not in fastest or row['median_ns'] < fastest[row['bench']]:
+            fastest[row['bench']] = row['median_ns']
+    for row in rows:
+        best = fastest[row['bench']]
+        row['vs_best_pct'] = round((row['median_ns'] - best) * 100 / best, 1) if best else 0.0
+    rows.sort(key=lambda r: (r['bench'], r['median_ns']))
+    return rows
+
+
+def bench_blob():
+    """SYNC_BENCH_BLOB_SIZE bytes the benchmark downloads are cut from, made once"""
+    global _bench_blob
+    if _bench_blob is None:
+        _bench_blob = os.urandom(SYNC_BENCH_BLOB_SIZE)
+    return _bench_blob
+
+
+class BenchBody:
+    """WSGI body of a /bench download, SYNC_SEND_CHUNK at a time"""
+    def __init__(self, size, seed, on_close=None):
+        self.size = size
+        self.pos = (seed * 7919) % SYNC_BENCH_BLOB_SIZE
+        self.on_close = on_close
+
+    def __iter__(self):
+        blob = bench_blob()
+        left = self.size
+        while left > 0:
+            n = min(SYNC_SEND_CHUNK, left, SYNC_BENCH_BLOB_SIZE - self.pos)
+            yield blob[self.pos:self.pos + n]
+            left -= n
+            self.pos = (self.pos + n) % SYNC_BENCH_BLOB_SIZE
+
+    def close(self):
+        on_close, self.on_close = self.on_close, None
+        if on_close:
+            on_close()
+
+
+class SyncFolderWatch(FileSystemEventHandler):
+    """Marks the file index stale on any change in the sync folder"""
+    def __init__(self, file_server):
+        super().__init__()
+        self.file_server = file_server
+
+    def on_any_event(self, event):
+        self.file_server.index_dirty = True
+
+
 class FileServer:
     def __init__(self, log_callback=None, settings=None):
         self.log_callback = log_callback
         self.settings = settings
+        self.host = None  # AsyncServiceHost, else werkzeug's threaded server
         self.running = False
         self.server_thread = None
         self.app = None
+        self.hash_cache = {}  # path -> ((size, mtime), hash, chunk hashes)
+        self.zlib_cache = {}  # path -> ((size, mtime), compressed path or None)
+        self.rgb565_cache = {}  # path -> ((size, mtime), converted path or None)
+        self.audio_cache = {}  # path -> ((size, mtime), transcoded path or None)
+        self.asset_pack = None  # {'signature', 'hash', 'size', 'count'} of ASSET_PACK_FILE
+        self.tags_cache = (None, [])  # ((size, mtime) of SYNC_TAGS_FILE, [(pattern, tags)])
+        self.index = {}  # name -> (path, (size, mtime)), the first one of a name the walk finds
+        self.index_gen = 0  # bumped whenever the index changes
+        self.index_at = 0
+        self.index_root = None
+        self.index_dirty = True
+        self.index_lock = threading.RLock()
+        self.entry_cache = {}  # (path, enc, streamed) -> ((size, mtime), list entry without tags)
+        self.list_cache = {}  # (enc, class, roles) -> ((index gen, tags key), files)
+        self.watcher = None
+        self.streams = {}  # client address -> /download responses in flight
+        self.streams_lock = threading.Lock()
+        self.gate = AdmissionGate('file', self.max_transfers, 5)
     
     @property
     def port(self):
@@ -296,6 +1521,34 @@ class FileServer:
         if self.settings:
             return self.settings.get('file_server', 'sync_folder', './sync_files')
         return './sync_files'
+    
+    @property
+    def max_transfers(self):
+        if self.settings:
+            return self.settings.get('file_server', 'max_transfers', 6)
+        return 6
+    
+    @property
+    def use_sendfile(self):
+        if self.settings:
+            return self.settings.get('file_server', 'sendfile', True)
+        return True
+    
+    def open_stream(self, addr):
+        """False while the client has SYNC_CLIENT_STREAMS downloads running"""
+        with self.streams_lock:
+            if self.streams.get(addr, 0) >= SYNC_CLIENT_STREAMS:
+                return False
+            self.streams[addr] = self.streams.get(addr, 0) + 1
+            return True
+    
+    def close_stream(self, addr):
+        with self.streams_lock:
+            left = self.streams.get(addr, 0) - 1
+            if left > 0:
+                self.streams[addr] = left
+            else:
+                self.streams.pop(addr, None)
         
     def log(self, message, level="INFO"):
         timestamp = datetime.now().strftime("%H:%M:%S")
@@ -310,59 +1563,426 @@ class FileServer:
             os.makedirs(self.sync_folder)
             self.log(f"Created sync folder: {self.sync_folder}", "SUCCESS")
     
-    def calculate_file_hash(self, filepath):
+    def calculate_file_hashes(self, filepath):
+        """Whole-file hash and per-chunk hashes, recomputed only when the file changes"""
         try:
+            stat = os.stat(filepath)
+            key = (stat.st_size, stat.st_mtime_ns)
+            cached = self.hash_cache.get(filepath)
+            if cached and cached[0] == key:
+                return cached[1], cached[2]
+            hash_value = 0
+            chunks = []
             with open(filepath, 'rb') as f:
-                hash_value = 0
                 while True:
-                    chunk = f.read(1024)
+                    chunk = f.read(SYNC_CHUNK_SIZE)
                     if not chunk:
                         break
                     for byte in chunk:
                         hash_value = (hash_value * 31 + byte) & 0xFFFFFFFF
-            return format(hash_value, 'X')
+                    chunks.append(hashlib.md5(chunk).hexdigest()[:8])
+            result = format(hash_value, 'X')
+            self.hash_cache[filepath] = (key, result, chunks)
+            return result, chunks
         except Exception as e:
             self.log(f"Hash calculation error for {filepath}: {e}", "ERROR")
-            return ""
+            return "", []
     
-    def find_file_in_subdirs(self, filename):
+    def calculate_file_hash(self, filepath):
+        return self.calculate_file_hashes(filepath)[0]
+    
+    def zlib_file(self, filepath):
+        """Path of the compressed representation of a file, None when it is sent as is"""
+        if filepath.lower().endswith(SYNC_NO_COMPRESS_EXTS):
+            return None
         try:
-            for root, dirs, files in os.walk(self.sync_folder):
-                if filename in files:
-                    return os.path.join(root, filename)
+            stat = os.stat(filepath)
+            key = (stat.st_size, stat.st_mtime_ns)
+            cached = self.zlib_cache.get(filepath)
+            if cached and cached[0] == key and (cached[1] is None or os.path.exists(cached[1])):
+                return cached[1]
+            with open(filepath, 'rb') as f:
+                data = f.read()
+            packed = zlib.compress(data, 9)
+            zpath = None
+            if len(packed) + 8 <= len(data) * SYNC_ZLIB_MAX_RATIO:
+                os.makedirs(SYNC_ZCACHE_DIR, exist_ok=True)
+                name = hashlib.md5(os.path.abspath(filepath).encode()).hexdigest() + '.zgz'
+                zpath = os.path.join(SYNC_ZCACHE_DIR, name)
+                with open(zpath, 'wb') as f:
+                    f.write(SYNC_ZLIB_MAGIC + struct.pack('<I', len(data)) + packed)
+                self.log(f"Compressed {os.path.basename(filepath)}: {len(data)} -> {len(packed) + 8} bytes", "INFO")
+            self.zlib_cache[filepath] = (key, zpath)
+            return zpath
         except Exception as e:
-            self.log(f"Error searching for file {filename}: {e}", "ERROR")
-        return None
+            self.log(f"Compression error for {filepath}: {e}", "ERROR")
+            return None
+    
+    def rgb565_file(self, filepath):
+        """Path of the pre-converted Z565 image of a BMP, None when it is sent as is"""
+        if not filepath.lower().endswith('.bmp'):
+            return None
+        try:
+            stat = os.stat(filepath)
+            key = (stat.st_size, stat.st_mtime_ns)
+            cached = self.rgb565_cache.get(filepath)
+            if cached and cached[0] == key and (cached[1] is None or os.path.exists(cached[1])):
+                return cached[1]
+            with open(filepath, 'rb') as f:
+                converted = bmp_to_rgb565(f.read())
+            rpath = None
+            if converted:
+                os.makedirs(SYNC_ZCACHE_DIR, exist_ok=True)
+                name = hashlib.md5(os.path.abspath(filepath).encode()).hexdigest() + '.z565'
+                rpath = os.path.join(SYNC_ZCACHE_DIR, name)
+                with open(rpath, 'wb') as f:
+                    f.write(converted)
+                self.log(f"Converted {os.path.basename(filepath)} to RGB565: {len(converted)} bytes", "INFO")
+            self.rgb565_cache[filepath] = (key, rpath)
+            return rpath
+        except Exception as e:
+            self.log(f"RGB565 conversion error for {filepath}: {e}", "ERROR")
+            return None
+    
+    def audio_file(self, filepath):
+        """Path of the device profile of a sound, None when it is sent as is"""
+        ext = os.path.splitext(filepath)[1].lower()
+        if ext not in ('.mp3', '.wav'):
+            return None
+        try:
+            stat = os.stat(filepath)
+            key = (stat.st_size, stat.st_mtime_ns)
+            cached = self.audio_cache.get(filepath)
+            if cached and cached[0] == key and (cached[1] is None or os.path.exists(cached[1])):
+                return cached[1]
+            with open(filepath, 'rb') as f:
+                data = f.read()
+            converted = transcode_audio(filepath, data)
+            apath = None
+            if converted:
+                os.makedirs(SYNC_ZCACHE_DIR, exist_ok=True)
+                # same extension, the zlib step leaves an MP3 alone
+                name = hashlib.md5(os.path.abspath(filepath).encode()).hexdigest() + '.audio' + ext
+                apath = os.path.join(SYNC_ZCACHE_DIR, name)
+                with open(apath, 'wb') as f:
+                    f.write(converted)
+                self.log(f"Transcoded {os.path.basename(filepath)}: {len(data)} -> {len(converted)} bytes", "INFO")
+            self.audio_cache[filepath] = (key, apath)
+            return apath
+        except Exception as e:
+            self.log(f"Audio transcoding error for {filepath}: {e}", "ERROR")
+            return None
+    
+    def stored_representation(self, filepath, enc):
+        """(path, applied encodings, decoded size) of the representation a device stores"""
+        encs = (enc or '').split(',')
+        stored, applied = filepath, []
+        if 'rgb565' in encs:
+            converted = self.rgb565_file(filepath)
+            if converted:
+                stored = converted
+                applied.append('rgb565')
+        if 'audio' in encs:
+            converted = self.audio_file(filepath)
+            if converted:
+                stored = converted
+                applied.append('audio')
+        decoded_size = os.path.getsize(stored)
+        if 'zlib' in encs and not self.streamed(filepath):
+            packed = self.zlib_file(stored)
+            if packed:
+                stored = packed
+                applied.append('zlib')
+        return stored, applied, decoded_size
+    
+    def streamed(self, filepath):
+        """The tags put the file into the stream tier"""
+        tags = self.file_tags(os.path.basename(filepath), self.load_tags())
+        return bool(tags) and tags.get('tier') == 'stream'
+
+    def stored_file(self, filepath, enc):
+        """The representation a device stores: converted for enc=rgb565, compressed
+        for enc=zlib when worth it"""
+        return self.stored_representation(filepath, enc)[0]
+    
+    def scan_index(self):
+        """The name -> (path, (size, mtime)) index of the sync folder, up to date"""
+        with self.index_lock:
+            now = time.monotonic()
+            folder = self.sync_folder
+            if (not self.index_dirty and folder == self.index_root and
+                    (self.watcher or now - self.index_at < SYNC_INDEX_TTL_S)):
+                return self.index
+            if self.watcher and self.index_root and folder != self.index_root:
+                # the settings moved the sync folder, watch the new one
+                self.stop_watcher()
+                self.start_watcher()
+            self.index_dirty = False
+            self.index_root = folder
+            index = {}
+            try:
+                for root, dirs, filenames in os.walk(folder):
+                    for filename in filenames:
+                        if filename.startswith('.') or filename in index:
+                            continue
+                        filepath = os.path.join(root, filename)
+                        try:
+                            stat = os.stat(filepath)
+                        except OSError:
+                            continue
+                        index[filename] = (filepath, (stat.st_size, stat.st_mtime_ns))
+            except Exception as e:
+                self.log(f"Error indexing the sync folder: {e}", "ERROR")
+            self.index_at = now
+            if index != self.index:
+                self.index = index
+                self.index_gen += 1
+                self.list_cache = {}
+                # entries of files that are gone or changed go too
+                self.entry_cache = {k: v for k, v in self.entry_cache.items()
+                                    if index.get(os.path.basename(k[0]), (None, None))[1] == v[0]}
+            return self.index
+
+    def assets_signature(self):
+        """Short hash of the sync folder (names, sizes, mtimes) and the tags, None while
+        the server is stopped; a device that synced against it has nothing to fetch"""
+        if not self.running:
+            return None
+        with self.index_lock:
+            index = self.scan_index()
+            self.load_tags()
+            text = ''.join(f"{name}:{key[0]}:{key[1]};" for name, (_, key) in sorted(index.items()))
+            text += repr(self.tags_cache[0])
+        return hashlib.md5(text.encode()).hexdigest()[:8]
     
-    def get_file_list(self):
-        files = []
+    def find_file_in_subdirs(self, filename):
+        entry = self.scan_index().get(filename)
+        return entry[0] if entry else None
+
+    def file_entry(self, filepath, key, enc):
+        """The /list entry of one file in the representation enc asks for"""
+        cache_key = (filepath, enc, self.streamed(filepath))
+        cached = self.entry_cache.get(cache_key)
+        if cached and cached[0] == key:
+            return cached[1]
+        stored, applied, decoded_size = self.stored_representation(filepath, enc)
+        file_hash, chunk_hashes = self.calculate_file_hashes(stored)
+        info = {
+            'name': os.path.basename(filepath),
+            'size': os.path.getsize(stored),
+            'hash': file_hash,
+            'chunks': chunk_hashes,
+            'full_path': filepath
+        }
+        if applied:
+            info['enc'] = ','.join(applied)
+            info['raw_size'] = decoded_size
+        self.entry_cache[cache_key] = (key, info)
+        return info
+
+    def load_tags(self):
+        """The [(pattern, tags)] of SYNC_TAGS_FILE, read again only when it changes"""
+        path = os.path.join(self.sync_folder, SYNC_TAGS_FILE)
+        try:
+            stat = os.stat(path)
+        except OSError:
+            return []
+        key = (stat.st_size, stat.st_mtime_ns)
+        if self.tags_cache[0] == key:
+            return self.tags_cache[1]
+        rules = []
         try:
-            for root, dirs, filenames in os.walk(self.sync_folder):
-                for filename in filenames:
-                    filepath = os.path.join(root, filename)
-                    if os.path.isfile(filepath):
-                        file_info = {
-                            'name': filename,
-                            'size': os.path.getsize(filepath),
-                            'hash': self.calculate_file_hash(filepath),
-                            'full_path': filepath
-                        }
-                        files.append(file_info)
+            with open(path, 'r') as f:
+                for pattern, tags in json.load(f).items():
+                    if isinstance(tags, dict):
+                        rules.append((pattern.lower(), tags))
+            self.log(f"Asset tags loaded: {len(rules)} patterns", "INFO")
         except Exception as e:
-            self.log(f"Error getting file list: {e}", "ERROR")
-        return files
+            self.log(f"Asset tags error in {SYNC_TAGS_FILE}: {e}", "ERROR")
+        self.tags_cache = (key, rules)
+        return rules
+    
+    @staticmethod
+    def tag_list(value):
+        if value is None:
+            return []
+        if isinstance(value, str):
+            value = value.split(',')
+        return [v.strip().lower() for v in value if str(v).strip()]
+    
+    def file_tags(self, filename, rules):
+        """{'role': [...], 'class': [...], 'prio': n, 'tier': ''} of the first matching pattern, None untagged"""
+        name = filename.lower()
+        for pattern, tags in rules:
+            if fnmatch.fnmatchcase(name, pattern):
+                return {
+                    'role': self.tag_list(tags.get('role')),
+                    'class': self.tag_list(tags.get('class')),
+                    'prio': int(tags.get('prio', SYNC_DEFAULT_PRIO)),
+                    'tier': str(tags.get('tier', '')).lower()
+                }
+        return None
+    
+    @staticmethod
+    def tags_match(tags, device_class, roles):
+        if not tags:
+            return True
+        if device_class and tags['class'] and device_class.lower() not in tags['class']:
+            return False
+        if roles and tags['role'] and not set(roles) & set(tags['role']):
+            return False
+        return True
+    
+    def get_file_list(self, enc=None, device_class=None, roles=None):
+        """Files of the sync folder; with a device class or roles only the ones tagged for it.
+        The lists are shared, callers must not modify them"""
+        roles = self.tag_list(roles)
+        # one thread hashes a changed file, the devices asking meanwhile wait for it
+        with self.index_lock:
+            index = self.scan_index()
+            rules = self.load_tags()
+            list_key = (enc, (device_class or '').lower(), tuple(roles))
+            valid = (self.index_gen, self.tags_cache[0])
+            cached = self.list_cache.get(list_key)
+            if cached and cached[0] == valid:
+                return cached[1]
+            files = []
+            try:
+                for filename, (filepath, key) in index.items():
+                    tags = self.file_tags(filename, rules)
+                    if not self.tags_match(tags, device_class, roles):
+                        continue
+                    file_info = self.file_entry(filepath, key, enc)
+                    if tags:
+                        file_info = dict(file_info, tags=tags)
+                    files.append(file_info)
+            except Exception as e:
+                self.log(f"Error getting file list: {e}", "ERROR")
+            # stable, untagged files keep the folder order
+            files.sort(key=lambda f: f['tags']['prio'] if 'tags' in f else SYNC_DEFAULT_PRIO)
+            self.list_cache[list_key] = (valid, files)
+            return files
+    
+    def get_asset_pack(self):
+        """Rebuilds the asset image when the sync folder changed, returns its info"""
+        files = self.get_file_list()
+        signature = hashlib.md5(''.join(f"{f['name']}:{f['hash']};" for f in sorted(files, key=lambda f: f['name']))
+                                .encode()).hexdigest()
+        if self.asset_pack and self.asset_pack['signature'] == signature and os.path.exists(ASSET_PACK_FILE):
+            return self.asset_pack
+        packed, skipped = build_asset_pack([f['full_path'] for f in files], ASSET_PACK_FILE)
+        if skipped:
+            self.log(f"Asset image full, left out: {', '.join(skipped)}", "WARNING")
+        self.asset_pack = {
+            'signature': signature,
+            'hash': self.calculate_file_hash(ASSET_PACK_FILE),
+            'size': os.path.getsize(ASSET_PACK_FILE),
+            'count': len(packed)
+        }
+        self.log(f"Asset image built: {len(packed)} files, {self.asset_pack['size']} bytes", "INFO")
+        return self.asset_pack
     
     def create_flask_app(self):
         app = Flask(__name__)
         server = self
         
+        def deferred():
+            """A 503 with Retry-After while the transfer slots are taken, else None"""
+            retry = server.gate.admit(request.remote_addr, server.max_transfers)
+            if retry is None:
+                return None
+            response = jsonify({'error': 'busy', 'retry_after': retry})
+            response.status_code = 503
+            response.headers['Retry-After'] = str(retry)
+            return response
+        
+        def send_stored(path, filename):
+            """The stored file, or the part of it a Range asks for, with an ETag of its hash"""
+            size = os.path.getsize(path)
+            etag = f'"{server.calculate_file_hash(path)}-{size}"'
+            match = [t.strip().replace('W/', '', 1) for t in request.headers.get('If-None-Match', '').split(',')]
+            if etag in match or '*' in match:
+                response = Response(status=304)
+                response.headers['ETag'] = etag
+                return response
+            
+            busy = deferred()
+            if busy:
+                return busy
+            addr = request.remote_addr
+            if not server.open_stream(addr):
+                response = jsonify({'error': 'too many downloads', 'retry_after': 1})
+                response.status_code = 503
+                response.headers['Retry-After'] = '1'
+                return response
+            
+            # a Range (resume, delta sync) for another version gets the whole file
+            if_range = request.headers.get('If-Range')
+            byte_range = parse_byte_range(request.headers.get('Range'), size) if if_range in (None, etag) else None
+            if byte_range is False:
+                server.close_stream(addr)
+                response = Response(status=416)
+                response.headers['Content-Range'] = f"bytes */{size}"
+                return response
+            start, end = byte_range or (0, size - 1)
+            body = SendfileBody(path, start, end - start + 1, request.environ.get('zgame.socket'),
+                                lambda: server.close_stream(addr))
+            response = Response(body, status=206 if byte_range else 200, mimetype='application/octet-stream',
+                                direct_passthrough=True)
+            response.headers['Content-Length'] = str(end - start + 1)
+            response.headers['Accept-Ranges'] = 'bytes'
+            response.headers['ETag'] = etag
+            response.headers['Content-Disposition'] = f"attachment; filename={filename}"
+            if byte_range:
+                response.headers['Content-Range'] = f"bytes {start}-{end}/{size}"
+                server.log(f"File chunk downloaded: {filename} {start}-{end}", "INFO")
+            else:
+                server.log(f"File downloaded: {filename}", "SUCCESS")
+            return response
+        
+        @app.route('/assets/info', methods=['GET'])
+        def asset_info():
+            try:
+                pack = server.get_asset_pack()
+                return jsonify({'hash': pack['hash'], 'size': pack['size'], 'count': pack['count']})
+            except Exception as e:
+                server.log(f"Error in /assets/info: {e}", "ERROR")
+                return jsonify({'error': str(e)}), 500
+        
+        @app.route('/assets/image', methods=['GET'])
+        def asset_image():
+            busy = deferred()
+            if busy:
+                return busy
+            try:
+                server.get_asset_pack()
+                server.log("Asset image downloaded", "SUCCESS")
+                return send_file(os.path.abspath(ASSET_PACK_FILE), as_attachment=True,
+                                 download_name='assets.bin', conditional=True)
+            except Exception as e:
+                server.log(f"Error in /assets/image: {e}", "ERROR")
+                return jsonify({'error': str(e)}), 500
+        
         @app.route('/list', methods=['GET'])
         def list_files():
             try:
-                files = server.get_file_list()
-                response_files = [{'name': f['name'], 'size': f['size'], 'hash': f['hash']} for f in files]
-                server.log(f"File list requested - {len(files)} files", "INFO")
-                return jsonify({'files': response_files})
+                device_class = request.args.get('class')
+                roles = request.args.get('roles')
+                files = server.get_file_list(request.args.get('enc'), device_class, roles)
+                response_files = []
+                for f in files:
+                    entry = {'name': f['name'], 'size': f['size'], 'hash': f['hash'], 'chunks': f['chunks']}
+                    if 'enc' in f:
+                        entry['enc'] = f['enc']
+                        entry['raw_size'] = f['raw_size']
+                    if 'tags' in f:
+                        entry['tags'] = f['tags']
+                        if f['tags']['tier']:
+                            entry['tier'] = f['tags']['tier']
+                    response_files.append(entry)
+                scope = f" for {device_class or 'any class'} / {roles or 'all roles'}" if (device_class or roles) else ""
+                server.log(f"File list requested - {len(files)} files{scope}", "INFO")
+                return jsonify({'chunk_size': SYNC_CHUNK_SIZE, 'files': response_files})
             except Exception as e:
                 server.log(f"Error in /list: {e}", "ERROR")
                 return jsonify({'error': str(e)}), 500
@@ -386,13 +2006,49 @@ class FileServer:
                     server.log(f"File not found: {filename}", "WARNING")
                     return jsonify({'error': 'File not found'}), 404
                 
-                server.log(f"File downloaded: {filename}", "SUCCESS")
-                return send_file(found_filepath, as_attachment=True, download_name=filename)
+                if server.use_sendfile:
+                    return send_stored(server.stored_file(found_filepath, request.args.get('enc')), filename)
+                
+                busy = deferred()
+                if busy:
+                    return busy
+                
+                found_filepath = server.stored_file(found_filepath, request.args.get('enc'))
+                
+                # a Range header (delta sync) is answered with 206 and just that chunk
+                byte_range = request.headers.get('Range')
+                if byte_range:
+                    server.log(f"File chunk downloaded: {filename} {byte_range}", "INFO")
+                else:
+                    server.log(f"File downloaded: {filename}", "SUCCESS")
+                return send_file(found_filepath, as_attachment=True, download_name=filename, conditional=True)
                 
             except Exception as e:
                 server.log(f"Download error: {e}", "ERROR")
                 return jsonify({'error': str(e)}), 500
         
+        @app.route('/bench', methods=['GET'])
+        def bench():
+            """Synthetic file of ?size= bytes for the device's sync benchmark, nothing is stored"""
+            size = request.args.get('size', 0, type=int)
+            seed = request.args.get('seed', 0, type=int)
+            if not 0 < size <= SYNC_BENCH_MAX_SIZE:
+                return jsonify({'error': f'size must be 1..{SYNC_BENCH_MAX_SIZE}'}), 400
+            busy = deferred()
+            if busy:
+                return busy
+            addr = request.remote_addr
+            if not server.open_stream(addr):
+                response = jsonify({'error': 'too many downloads', 'retry_after': 1})
+                response.status_code = 503
+                response.headers['Retry-After'] = '1'
+                return response
+            response = Response(BenchBody(size, seed, lambda: server.close_stream(addr)),
+                                mimetype='application/octet-stream', direct_passthrough=True)
+            response.headers['Content-Length'] = str(size)
+            server.log(f"Bench download: {size} bytes to {addr}", "INFO")
+            return response
+        
         @app.route('/status', methods=['GET'])
         def status():
             try:
@@ -401,7 +2057,8 @@ class FileServer:
                     'status': 'online',
                     'sync_folder': server.sync_folder,
                     'files_count': len(files),
-                    'total_size': sum(f['size'] for f in files)
+                    'total_size': sum(f['size'] for f in files),
+                    'admission': server.gate.info()
                 })
             except Exception as e:
                 return jsonify({'error': str(e)}), 500
@@ -415,9 +2072,21 @@ class FileServer:
     
     def run_server(self):
         try:
-            from werkzeug.serving import make_server
+            from werkzeug.serving import make_server, WSGIRequestHandler
+            
+            # keep-alive lets the devices' parallel downloaders reuse their connections
+            class KeepAliveRequestHandler(WSGIRequestHandler):
+                protocol_version = "HTTP/1.1"
+                
+                def make_environ(self):
+                    environ = super().make_environ()
+                    # /download writes its file into the socket itself
+                    environ['zgame.socket'] = self.connection
+                    return environ
+            
             self.app = self.create_flask_app()
-            self.http_server = make_server('0.0.0.0', self.port, self.app, threaded=True)
+            self.http_server = make_server('0.0.0.0', self.port, self.app, threaded=True,
+                                           request_handler=KeepAliveRequestHandler)
             self.log(f"File server started on port {self.port}", "SUCCESS")
             self.http_server.serve_forever()
         except Exception as e:
@@ -434,9 +2103,20 @@ class FileServer:
         self.log(f"Starting file server on port {self.port}...")
         self.log(f"Sync folder: {os.path.abspath(self.sync_folder)}", "INFO")
         
+        self.start_watcher()
         files = self.get_file_list()
         self.log(f"Files available: {len(files)}", "INFO")
         
+        if self.host:
+            try:
+                self.app = self.create_flask_app()
+                self.host.serve_wsgi(self.port, self.app)
+                self.log(f"File server started on port {self.port}, service host", "SUCCESS")
+            except Exception as e:
+                self.log(f"File server error: {e}", "ERROR")
+                self.running = False
+            return
+        
         self.server_thread = threading.Thread(target=self.run_server, daemon=True)
         self.server_thread.start()
     
@@ -447,19 +2127,47 @@ class FileServer:
         self.log("Stopping file server...")
         self.running = False
         
-        if hasattr(self, 'http_server'):
+        if self.host:
+            self.host.close(self.port)
+        elif hasattr(self, 'http_server'):
             try:
                 self.http_server.shutdown()
             except:
                 pass
+        self.stop_watcher()
         
         self.log("File server stopped", "SUCCESS")
+    
+    def start_watcher(self):
+        """Index updates on change instead of every SYNC_INDEX_TTL_S, with watchdog installed"""
+        self.index_dirty = True
+        if Observer is None:
+            self.log("No watchdog module, the sync folder is rescanned every "
+                     f"{SYNC_INDEX_TTL_S} s while devices ask", "INFO")
+            return
+        try:
+            self.watcher = Observer()
+            self.watcher.schedule(SyncFolderWatch(self), self.sync_folder, recursive=True)
+            self.watcher.daemon = True
+            self.watcher.start()
+        except Exception as e:
+            self.log(f"Sync folder watcher error: {e}", "WARNING")
+            self.watcher = None
+    
+    def stop_watcher(self):
+        if self.watcher:
+            try:
+                self.watcher.stop()
+            except Exception:
+                pass
+            self.watcher = None
 
 
 # ============== OTA Server ==============
 class OTAHandler(BaseHTTPRequestHandler):
     server_instance = None
     _cached_md5 = None
+    _cached_sha256 = None
     _cached_size = None
     _cached_mtime = None
     _cache_lock = threading.Lock()
@@ -523,11 +2231,17 @@ class OTAHandler(BaseHTTPRequestHandler):
             response_data = {
                 "version": firmware_version,
                 "md5": md5_hash,
+                "sha256": self._cached_sha256,
                 "size": file_size,
                 "filename": self.firmware_file,
                 "timestamp": int(time.time())
             }
             
+            carousel = self.server_instance.carousel if self.server_instance else None
+            if carousel:
+                carousel.load(firmware_path, md5_hash)
+                response_data["mcast"] = carousel.info()
+            
             self.send_response(200)
             self.send_header("Content-Type", "application/json")
             self.send_header("Cache-Control", "no-cache")
@@ -540,7 +2254,27 @@ class OTAHandler(BaseHTTPRequestHandler):
             self.log_to_gui(f"Error in version check: {e}", "ERROR")
             self.send_error(500, "Internal Server Error")
     
+    def send_busy(self, retry_s):
+        self.send_response(503)
+        self.send_header("Retry-After", str(retry_s))
+        self.send_header("Content-Length", "0")
+        self.end_headers()
+    
     def handle_firmware_download(self):
+        server = self.server_instance
+        key = self.client_address[0]
+        retry = server.gate.admit(key, server.max_transfers) if server else None
+        if retry is not None:
+            self.send_busy(retry)
+            self.log_to_gui(f"Firmware download from {key} deferred by {retry} s", "INFO")
+            return
+        try:
+            self.send_firmware()
+        finally:
+            if server:
+                server.gate.release(key)
+    
+    def send_firmware(self):
         try:
             firmware_path = os.path.join(self.firmware_dir, self.firmware_file)
             
@@ -548,13 +2282,33 @@ class OTAHandler(BaseHTTPRequestHandler):
                 self.send_error(404, "Firmware not found")
                 return
             
-            file_size = os.path.getsize(firmware_path)
+            file_size = len(self.firmware_blob(firmware_path))
             
             range_header = self.headers.get('Range')
+            query = urllib.parse.parse_qs(urllib.parse.urlparse(self.path).query)
+            accepted = query.get('enc', [''])[0].split(',')
+            cache = self.server_instance.ota_cache if self.server_instance else None
+            if cache and not range_header and ('zlib' in accepted or 'delta' in accepted):
+                md5_hash, _ = self.get_cached_firmware_info(firmware_path)
+                path, enc = cache.encoded(self.firmware_dir, firmware_path, md5_hash, accepted,
+                                          query.get('from', [''])[0])
+                if enc:
+                    self.send_encoded_firmware(path, enc, file_size)
+                    return
+            
             if range_header:
                 ranges = range_header.replace('bytes=', '').split('-')
                 range_start = int(ranges[0]) if ranges[0] else 0
-                range_end = int(ranges[1]) if ranges[1] else file_size - 1
+                range_end = min(int(ranges[1]), file_size - 1) if ranges[1] else file_size - 1
+                
+                # a resume past the end (the image changed meanwhile) is refused
+                if range_start >= file_size or range_start > range_end:
+                    self.send_response(416)
+                    self.send_header("Content-Range", f"bytes */{file_size}")
+                    self.send_header("Content-Length", "0")
+                    self.end_headers()
+                    self.log_to_gui(f"Unsatisfiable firmware range: {range_header}", "WARNING")
+                    return
                 
                 content_length = range_end - range_start + 1
                 
@@ -566,16 +2320,7 @@ class OTAHandler(BaseHTTPRequestHandler):
                 self.send_header("Content-Disposition", f"attachment; filename={self.firmware_file}")
                 self.end_headers()
                 
-                with open(firmware_path, 'rb') as f:
-                    f.seek(range_start)
-                    sent = 0
-                    while sent < content_length:
-                        chunk_size = min(8192, content_length - sent)
-                        chunk = f.read(chunk_size)
-                        if not chunk:
-                            break
-                        self.wfile.write(chunk)
-                        sent += len(chunk)
+                self.write_paced(memoryview(self.firmware_blob(firmware_path))[range_start:range_end + 1])
                 
                 self.log_to_gui(f"Partial firmware sent: {range_start}-{range_end}/{file_size}", "SUCCESS")
             else:
@@ -586,12 +2331,7 @@ class OTAHandler(BaseHTTPRequestHandler):
                 self.send_header("Content-Disposition", f"attachment; filename={self.firmware_file}")
                 self.end_headers()
                 
-                with open(firmware_path, 'rb') as f:
-                    while True:
-                        chunk = f.read(8192)
-                        if not chunk:
-                            break
-                        self.wfile.write(chunk)
+                self.write_paced(self.firmware_blob(firmware_path))
                 
                 self.log_to_gui(f"Full firmware sent: {self.firmware_file} ({file_size} bytes)", "SUCCESS")
             
@@ -599,6 +2339,32 @@ class OTAHandler(BaseHTTPRequestHandler):
             self.log_to_gui(f"Error sending firmware: {e}", "ERROR")
             self.send_error(500, "Internal Server Error")
     
+    def firmware_blob(self, path):
+        server = self.server_instance
+        if server:
+            return server.blobs.get(path)
+        with open(path, 'rb') as f:
+            return f.read()
+    
+    def write_paced(self, data):
+        server = self.server_instance
+        if server:
+            server.pacer.send(self.wfile.write, data, server.rate_kbps)
+        else:
+            self.wfile.write(data)
+    
+    def send_encoded_firmware(self, path, enc, file_size):
+        """Device inflates (and for delta patches) it as it streams in, so no Range"""
+        data = self.firmware_blob(path)
+        self.send_response(200)
+        self.send_header("Content-Type", "application/octet-stream")
+        self.send_header("Content-Length", str(len(data)))
+        self.send_header("X-OTA-Enc", enc)
+        self.end_headers()
+        self.write_paced(data)
+        self.log_to_gui(f"Firmware sent as {enc}: {len(data)} bytes for {file_size} "
+                        f"({file_size / max(len(data), 1):.1f}x smaller)", "SUCCESS")
+    
     def handle_status(self):
         try:
             active_threads = threading.active_count()
@@ -612,6 +2378,9 @@ class OTAHandler(BaseHTTPRequestHandler):
                 "firmware_available": firmware_exists,
                 "timestamp": int(time.time())
             }
+            if self.server_instance:
+                status_data["admission"] = self.server_instance.gate.info()
+                status_data["pacer"] = self.server_instance.pacer.info(self.server_instance.rate_kbps)
             
             if firmware_exists:
                 md5_hash, file_size = self.get_cached_firmware_info(firmware_path)
@@ -638,26 +2407,156 @@ class OTAHandler(BaseHTTPRequestHandler):
             self.log_to_gui(f"Error in status check: {e}", "ERROR")
             self.send_error(500, "Internal Server Error")
     
-    def get_cached_firmware_info(self, firmware_path):
-        with self._cache_lock:
-            current_mtime = os.path.getmtime(firmware_path)
-            
-            if (self._cached_md5 is None or self._cached_mtime != current_mtime):
-                self._cached_md5 = self.calculate_md5(firmware_path)
-                self._cached_size = os.path.getsize(firmware_path)
-                self._cached_mtime = current_mtime
-            
-            return self._cached_md5, self._cached_size
+    def get_cached_firmware_info(self, firmware_path):
+        with self._cache_lock:
+            current_mtime = os.path.getmtime(firmware_path)
+            
+            if (self._cached_md5 is None or self._cached_mtime != current_mtime):
+                self._cached_md5, self._cached_sha256 = self.calculate_digests(firmware_path)
+                self._cached_size = os.path.getsize(firmware_path)
+                self._cached_mtime = current_mtime
+                # the build devices will run next, diffed against once it is replaced
+                if self.server_instance:
+                    self.server_instance.ota_cache.archive(self.firmware_dir, firmware_path, self._cached_md5)
+            
+            return self._cached_md5, self._cached_size
+    
+    def calculate_digests(self, file_path):
+        # MD5 for the version check, SHA-256 for the device's streaming verifier
+        hash_md5 = hashlib.md5()
+        hash_sha256 = hashlib.sha256()
+        with open(file_path, "rb") as f:
+            for chunk in iter(lambda: f.read(4096), b""):
+                hash_md5.update(chunk)
+                hash_sha256.update(chunk)
+        return hash_md5.hexdigest(), hash_sha256.hexdigest()
+    
+    def log_message(self, format, *args):
+        pass  # Suppress default logging
+
+
+class OTAMulticastCarousel:
+    def __init__(self, log, rate):
+        self.log = log
+        self.rate = max(1, rate)
+        self.lock = threading.Condition()
+        self.running = False
+        self.image = b''
+        self.image_id = 0
+        self.image_key = None
+        self.pending = bytearray()
+        self.pending_count = 0
+        self.sent_at = []
+        self.cursor = 0
+        self.last_nack = 0
+        self.sock = None
+    
+    def load(self, firmware_path, md5_hash):
+        """Switches the carousel to the current firmware, the id is taken from its md5"""
+        key = (md5_hash, os.path.getsize(firmware_path))
+        with self.lock:
+            if key == self.image_key:
+                return
+            with open(firmware_path, 'rb') as f:
+                self.image = f.read()
+            self.image_key = key
+            self.image_id = int(md5_hash[:8], 16)
+            blocks = (len(self.image) + OTA_MCAST_BLOCK - 1) // OTA_MCAST_BLOCK
+            self.pending = bytearray(blocks)
+            self.pending_count = 0
+            self.sent_at = [0.0] * blocks
+            self.cursor = 0
+        self.log(f"Multicast OTA carousel: {blocks} blocks, id {self.image_id:08X}", "INFO")
+    
+    def info(self):
+        return {'group': OTA_MCAST_GROUP, 'port': OTA_MCAST_PORT, 'block': OTA_MCAST_BLOCK, 'id': self.image_id}
+    
+    def start(self):
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM, socket.IPPROTO_UDP)
+        self.sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        self.sock.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_TTL, 1)
+        self.sock.bind(('', OTA_MCAST_PORT))
+        self.sock.settimeout(0.5)
+        self.running = True
+        threading.Thread(target=self.nack_loop, daemon=True).start()
+        threading.Thread(target=self.send_loop, daemon=True).start()
+        self.log(f"Multicast OTA carousel on {OTA_MCAST_GROUP}:{OTA_MCAST_PORT}, {self.rate} blocks/s", "SUCCESS")
+    
+    def stop(self):
+        with self.lock:
+            self.running = False
+            self.lock.notify_all()
+        if self.sock:
+            try:
+                self.sock.close()
+            except Exception:
+                pass
+    
+    def nack_loop(self):
+        while self.running:
+            try:
+                data, addr = self.sock.recvfrom(1024)
+            except socket.timeout:
+                continue
+            except OSError:
+                break
+            if len(data) < 8 or data[:4] != b'ZON1':
+                continue
+            image_id = struct.unpack_from('<I', data, 4)[0]
+            now = time.time()
+            with self.lock:
+                if image_id != self.image_id:
+                    continue
+                blocks = len(self.pending)
+                for pos in range(8, len(data) - 5, 6):
+                    first, count = struct.unpack_from('<IH', data, pos)
+                    for index in range(first, min(first + count, blocks)):
+                        if not self.pending[index] and now - self.sent_at[index] >= OTA_MCAST_RESEND_S:
+                            self.pending[index] = 1
+                            self.pending_count += 1
+                self.last_nack = now
+                self.lock.notify_all()
     
-    def calculate_md5(self, file_path):
-        hash_md5 = hashlib.md5()
-        with open(file_path, "rb") as f:
-            for chunk in iter(lambda: f.read(4096), b""):
-                hash_md5.update(chunk)
-        return hash_md5.hexdigest()
+    def next_block(self):
+        """Next requested block from the cursor on, so the requests are served in a circle"""
+        blocks = len(self.pending)
+        for step in range(blocks):
+            index = (self.cursor + step) % blocks
+            if self.pending[index]:
+                self.pending[index] = 0
+                self.pending_count -= 1
+                self.cursor = index + 1
+                return index
+        return None
     
-    def log_message(self, format, *args):
-        pass  # Suppress default logging
+    def send_loop(self):
+        interval = 1.0 / self.rate
+        next_send = time.time()
+        while self.running:
+            with self.lock:
+                while self.running and self.pending_count == 0:
+                    self.lock.wait(1.0)
+                if not self.running:
+                    break
+                if time.time() - self.last_nack > OTA_MCAST_IDLE_S:
+                    # nobody is listening any more
+                    self.pending = bytearray(len(self.pending))
+                    self.pending_count = 0
+                    continue
+                index = self.next_block()
+                if index is None:
+                    continue
+                payload = self.image[index * OTA_MCAST_BLOCK:(index + 1) * OTA_MCAST_BLOCK]
+                packet = struct.pack('<4sIII', b'ZOB1', self.image_id, len(self.image), index) + payload
+                self.sent_at[index] = time.time()
+            try:
+                self.sock.sendto(packet, (OTA_MCAST_GROUP, OTA_MCAST_PORT))
+            except OSError as e:
+                self.log(f"Multicast OTA send error: {e}", "ERROR")
+            next_send = max(next_send + interval, time.time() - 0.1)
+            delay = next_send - time.time()
+            if delay > 0:
+                time.sleep(delay)
 
 
 class ThreadedOTAServer(ThreadingHTTPServer):
@@ -667,15 +2566,46 @@ class ThreadedOTAServer(ThreadingHTTPServer):
         self.connection_count = 0
         self.connection_lock = threading.Lock()
         self.socket.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    
+    def process_request(self, request, client_address):
+        # over the limit the connection is turned away before it gets a thread
+        with self.connection_lock:
+            busy = self.connection_count >= self.max_connections
+            if not busy:
+                self.connection_count += 1
+        if busy:
+            try:
+                request.sendall(f"HTTP/1.1 503 Service Unavailable\r\nRetry-After: {ADMISSION_MIN_RETRY_S}\r\n"
+                                "Content-Length: 0\r\nConnection: close\r\n\r\n".encode())
+            except OSError:
+                pass
+            self.shutdown_request(request)
+            return
+        super().process_request(request, client_address)
+    
+    def process_request_thread(self, request, client_address):
+        try:
+            super().process_request_thread(request, client_address)
+        finally:
+            with self.connection_lock:
+                self.connection_count -= 1
 
 
 class OTAServer:
     def __init__(self, log_callback=None, settings=None):
         self.log_callback = log_callback
         self.settings = settings
+        self.host = None  # AsyncServiceHost, else ThreadedOTAServer
         self.running = False
         self.server_thread = None
         self.httpd = None
+        self.carousel = None
+        self.ota_cache = OTAImageCache(self.log)
+        self.gate = AdmissionGate('ota', self.max_transfers, 20)
+        self.blobs = BlobCache(OTA_BLOB_KEEP)
+        self.pacer = TransferPacer()
+        self.fw_info_key = None
+        self.fw_info = None
     
     @property
     def port(self):
@@ -683,6 +2613,36 @@ class OTAServer:
             return self.settings.get('ota_server', 'port', 5005)
         return 5005
     
+    @property
+    def multicast(self):
+        if self.settings:
+            return self.settings.get('ota_server', 'multicast', True)
+        return True
+    
+    @property
+    def multicast_rate(self):
+        if self.settings:
+            return self.settings.get('ota_server', 'multicast_rate', 200)
+        return 200
+    
+    @property
+    def max_transfers(self):
+        if self.settings:
+            return self.settings.get('ota_server', 'max_transfers', 4)
+        return 4
+    
+    @property
+    def max_connections(self):
+        if self.settings:
+            return self.settings.get('ota_server', 'max_connections', 50)
+        return 50
+    
+    @property
+    def rate_kbps(self):
+        if self.settings:
+            return self.settings.get('ota_server', 'rate_kbps', 0)
+        return 0
+    
     @property
     def firmware_dir(self):
         if self.settings:
@@ -703,6 +2663,33 @@ class OTAServer:
         else:
             print(log_message)
     
+    def firmware_info(self):
+        """(version, md5) of the served firmware for the discovery reply, None without one"""
+        if not self.running:
+            return None
+        firmware_path = os.path.join(self.firmware_dir, self.firmware_file)
+        versioning_path = os.path.join(self.firmware_dir, "versioning")
+        try:
+            if not os.path.exists(firmware_path):
+                return None
+            key = (firmware_path, os.path.getmtime(firmware_path),
+                   os.path.getmtime(versioning_path) if os.path.exists(versioning_path) else 0)
+            if key != self.fw_info_key:
+                hash_md5 = hashlib.md5()
+                with open(firmware_path, "rb") as f:
+                    for chunk in iter(lambda: f.read(65536), b""):
+                        hash_md5.update(chunk)
+                version = "0"
+                if os.path.exists(versioning_path):
+                    with open(versioning_path, 'r') as f:
+                        version = f.read().strip() or "0"
+                self.fw_info = (int(version), hash_md5.hexdigest())
+                self.fw_info_key = key
+            return self.fw_info
+        except Exception as e:
+            self.log(f"Firmware info error: {e}", "ERROR")
+            return None
+    
     def init_firmware_dir(self):
         if not os.path.exists(self.firmware_dir):
             os.makedirs(self.firmware_dir)
@@ -711,7 +2698,7 @@ class OTAServer:
     def run_server(self):
         try:
             OTAHandler.server_instance = self
-            self.httpd = ThreadedOTAServer(('', self.port), OTAHandler, max_connections=50)
+            self.httpd = ThreadedOTAServer(('', self.port), OTAHandler, max_connections=self.max_connections)
             self.log(f"OTA server started on port {self.port}", "SUCCESS")
             self.httpd.serve_forever()
         except Exception as e:
@@ -735,6 +2722,24 @@ class OTAServer:
         else:
             self.log(f"Warning: Firmware file not found: {self.firmware_file}", "WARNING")
         
+        if self.multicast:
+            try:
+                self.carousel = OTAMulticastCarousel(self.log, self.multicast_rate)
+                self.carousel.start()
+            except Exception as e:
+                self.log(f"Multicast OTA disabled: {e}", "WARNING")
+                self.carousel = None
+        
+        if self.host:
+            try:
+                OTAHandler.server_instance = self
+                self.host.serve_handler(self.port, OTAHandler, self.max_connections)
+                self.log(f"OTA server started on port {self.port}, service host", "SUCCESS")
+            except Exception as e:
+                self.log(f"OTA server error: {e}", "ERROR")
+                self.running = False
+            return
+        
         self.server_thread = threading.Thread(target=self.run_server, daemon=True)
         self.server_thread.start()
     
@@ -744,8 +2749,13 @@ class OTAServer:
         
         self.log("Stopping OTA server...")
         self.running = False
+        if self.carousel:
+            self.carousel.stop()
+            self.carousel = None
         
-        if self.httpd:
+        if self.host:
+            self.host.close(self.port)
+        elif self.httpd:
             try:
                 self.httpd.shutdown()
             except:
@@ -754,21 +2764,107 @@ class OTAServer:
         self.log("OTA server stopped", "SUCCESS")
 
 
+# Framebuffer snapshots (lib/tft_utils/tftSnapshot.h): a device told the
+# "snapshot" command posts the frame on its panel to /snapshot?mac=.., the
+# header with its display timing, then run-length coded big-endian RGB565
+# (c < 0x80: c + 1 literal pixels, else one pixel (c & 0x7F) + 2 times). It is
+# kept as a BMP in SNAPSHOT_DIR, GET /snapshot?mac=.. returns the latest,
+# with &info=1 its size and timing.
+SNAPSHOT_MAGIC = 0x3142465A  # "ZFB1"
+SNAPSHOT_HEADER = '<IBBHHHIIIIIII'
+SNAPSHOT_FLAG_DOUBLE = 0x01
+SNAPSHOT_DIR = 'snapshots'
+SNAPSHOT_TIMING = ('render_ms', 'render_max_ms', 'push_us', 'push_max_us', 'pushes', 'push_age_ms', 'uptime_ms')
+
+# Tunable experiments (lib/utils/tunables.h): TUNABLES_FILE next to the server
+# names sets of device tunables and the cohorts they go to, first match wins:
+#   {"sets": {"base": {}, "fast": {"beacon_ms": 30, "rssi_filter": "kalman"}},
+#    "cohorts": [{"match": "AA:BB:*", "set": "fast"}, {"match": "*", "split": ["base", "fast"]}]}
+# match is an fnmatch pattern on the MAC or the name, split spreads the cohort
+# over its sets by a hash of the MAC. A device whose reported tunable_set
+# differs gets {"set", "values"} with its /status response, a set is applied
+# whole. /experiments compares the telemetry of the sets.
+TUNABLES_FILE = 'tunables.json'
+TUNABLE_NAMES = ('beacon_ms', 'rssi_filter', 'screen_fps', 'game_api_ms')
+TUNABLE_SET_NAME_LEN = 15
+
+# Pattern hot reload: a device told the "reload_val" command fetches these
+# from /patterns?file=.. of the sync folder and plays them without a reboot
+PATTERN_FILES = ('val.json', 'val.bin')
+
+
+def snapshot_decode(data):
+    """(info, 24-bit BMP) of a device snapshot, ValueError when it is not one"""
+    size = struct.calcsize(SNAPSHOT_HEADER)
+    if len(data) < size:
+        raise ValueError("short snapshot")
+    magic, version, flags, width, height, _, *timing = struct.unpack_from(SNAPSHOT_HEADER, data)
+    if magic != SNAPSHOT_MAGIC or version != 1 or not width or not height:
+        raise ValueError("not a snapshot")
+    total = width * height
+    pixels = bytearray()
+    i = size
+    while len(pixels) < 2 * total:
+        if i >= len(data):
+            raise ValueError("truncated snapshot")
+        c = data[i]
+        i += 1
+        if c < 0x80:
+            n = 2 * (c + 1)
+            if i + n > len(data):
+                raise ValueError("truncated snapshot")
+            pixels += data[i:i + n]
+            i += n
+        else:
+            if i + 2 > len(data):
+                raise ValueError("truncated snapshot")
+            pixels += data[i:i + 2] * ((c & 0x7F) + 2)
+            i += 2
+    if len(pixels) != 2 * total:
+        raise ValueError("snapshot overruns its frame")
+
+    row_size = (width * 3 + 3) & ~3
+    bmp = bytearray(struct.pack('<2sIHHIIiiHHIIiiII', b'BM', 54 + row_size * height, 0, 0, 54,
+                                40, width, -height, 1, 24, 0, row_size * height, 2835, 2835, 0, 0))
+    pad = bytes(row_size - width * 3)
+    for row in range(height):
+        line = bytearray()
+        for k in range(row * width * 2, (row + 1) * width * 2, 2):
+            px = (pixels[k] << 8) | pixels[k + 1]
+            r, g, b = (px >> 11) & 0x1F, (px >> 5) & 0x3F, px & 0x1F
+            line += bytes(((b << 3) | (b >> 2), (g << 2) | (g >> 4), (r << 3) | (r >> 2)))
+        bmp += line + pad
+    info = dict(zip(SNAPSHOT_TIMING, timing))
+    info.update({'width': width, 'height': height, 'double_buffered': bool(flags & SNAPSHOT_FLAG_DOUBLE),
+                 'bytes': len(data)})
+    return info, bytes(bmp)
+
+
 # ============== Device Status Server ==============
 class DeviceStatusServer:
     def __init__(self, log_callback=None, settings=None, gui_callback=None):
         self.log_callback = log_callback
         self.settings = settings
         self.gui_callback = gui_callback  # Callback to update GUI table
+        self.host = None  # AsyncServiceHost, else werkzeug's threaded server and a monitor thread
         self.running = False
         self.server_thread = None
         self.monitor_thread = None
         self.app = None
         self.devices = {}  # MAC -> device info
         self.pending_commands = {}  # MAC -> command
+        self.pending_command_args = {}  # MAC -> extra reply fields of the pending command
         self.pending_names = {}  # MAC -> new name (server-side name override)
         self.devices_lock = threading.Lock()
         self.known_online_devices = set()  # Track which devices were online
+        self.boot_reports = {}  # MAC -> last boot report
+        self.snapshots = {}  # MAC -> info of the last framebuffer snapshot
+        self.sync_benches = {}  # MAC -> last sync benchmark report
+        self.benchmarks = {}  # MAC -> last firmware benchmark report
+        self.hit_latency = {}  # game session -> MAC -> last hit latency report of that game
+        self.telemetry = TelemetryStore()
+        self.experiments = TunableExperiments(self.log)
+        self.history = None  # StatusHistory while running with a history_db
     
     @property
     def port(self):
@@ -776,11 +2872,46 @@ class DeviceStatusServer:
             return self.settings.get('device_status_server', 'port', 5004)
         return 5004
     
+    def start_history(self):
+        """Opens the history and takes the devices and telemetry of the last run back from it"""
+        path = self.settings.get('device_status_server', 'history_db', 'device_status.db') if self.settings else ''
+        if not path:
+            return
+        history = StatusHistory(path,
+                                self.settings.get('device_status_server', 'history_flush_ms', 500),
+                                self.settings.get('device_status_server', 'history_keep_days', 7),
+                                self.log)
+        if not history.open():
+            return
+        since = time.time() - TELEMETRY_RING * STATUS_INTERVAL_MIN_MS / 1000
+        try:
+            last = history.last_reports(since)
+            samples = history.query(since=since, limit=STATUS_DB_HISTORY_MAX)
+        except sqlite3.Error as e:
+            self.log(f"Status history {path} not read: {e}", "WARNING")
+            last, samples = {}, []
+        with self.devices_lock:
+            for mac, report in last.items():
+                self.devices.setdefault(mac, report)
+        for mac, t, report in samples:
+            self.telemetry.add(mac, report, t)
+        history.start()
+        self.history = history
+        self.log(f"Status history in {path}, {len(last)} devices and {len(samples)} reports taken back", "INFO")
+    
     @property
     def device_timeout(self):
         if self.settings:
             return self.settings.get('device_status_server', 'device_timeout', 30)
         return 30
+
+    def status_interval_ms(self, mac):
+        """Report interval handed to one device in its /status response"""
+        if mac in self.pending_names or mac in self.pending_commands:
+            return STATUS_INTERVAL_FAST_MS
+        by_load = len(self.known_online_devices) * 1000 // STATUS_TARGET_RATE
+        by_timeout = self.device_timeout * 1000 // STATUS_TIMEOUT_REPORTS
+        return max(STATUS_INTERVAL_MIN_MS, min(by_load, by_timeout))
     
     def log(self, message, level="INFO"):
         timestamp = datetime.now().strftime("%H:%M:%S")
@@ -790,8 +2921,16 @@ class DeviceStatusServer:
         else:
             print(log_message)
     
+    @staticmethod
+    def exhaustion_time(device):
+        """When the device's battery runs out by its last runtime_min, None while unknown or charging"""
+        runtime_min = device.get('runtime_min', -1)
+        if not isinstance(runtime_min, (int, float)) or runtime_min < 0:
+            return None
+        return device.get('last_seen', 0) + runtime_min * 60
+    
     def get_devices(self):
-        """Get list of all devices with their status"""
+        """Get list of all devices with their status, the first to run flat first"""
         with self.devices_lock:
             current_time = time.time()
             result = []
@@ -803,8 +2942,56 @@ class DeviceStatusServer:
                 # Add pending name info if there's a rename in progress
                 if mac in self.pending_names:
                     device['pending_name'] = self.pending_names[mac]
+                empty_at = self.exhaustion_time(info)
+                device['empty_in_min'] = None if empty_at is None else max(0, int((empty_at - current_time) // 60))
                 result.append(device)
-            return result
+        result.sort(key=lambda d: (d['empty_in_min'] is None, d['empty_in_min'] or 0))
+        return result
+    
+    def get_boot_stats(self):
+        """Fleet percentiles of the last boot report of every device"""
+        with self.devices_lock:
+            reports = list(self.boot_reports.values())
+        series = {}
+        for report in reports:
+            for key in BOOT_STAT_KEYS:
+                if isinstance(report.get(key), (int, float)):
+                    series.setdefault(key, []).append(report[key])
+            for stage, span in report.get('stages', {}).items():
+                if isinstance(span, list) and len(span) == 2:
+                    series.setdefault(f"stage_{stage}", []).append(span[1])
+        stats = {}
+        for key, values in series.items():
+            stats[key] = {f"p{pct}": percentile(values, pct) for pct in BOOT_PERCENTILES}
+            stats[key]['n'] = len(values)
+        return {'devices': len(reports), 'stats': stats}
+    
+    def get_hit_latency_stats(self):
+        """Hit latency per game, the device histograms merged"""
+        with self.devices_lock:
+            games = {game: list(reports.values()) for game, reports in self.hit_latency.items()}
+        result = {}
+        for game, reports in games.items():
+            stats = {'devices': len(reports), 'dropped': sum(r.get('dropped', 0) for r in reports)}
+            for stage in HIT_LATENCY_STAGES:
+                merged = []
+                max_ms = 0
+                for report in reports:
+                    part = report.get(stage, {})
+                    hist = part.get('hist', [])
+                    if len(merged) < len(hist):
+                        merged.extend([0] * (len(hist) - len(merged)))
+                    for b, count in enumerate(hist):
+                        merged[b] += count
+                    max_ms = max(max_ms, part.get('max', 0))
+                n = sum(merged)
+                entry = {'n': n, 'max': max_ms}
+                if n:
+                    for pct in HIT_LATENCY_PERCENTILES:
+                        entry[f"p{pct}"] = hist_percentile(merged, pct, max_ms)
+                stats[stage] = entry
+            result[str(game)] = stats
+        return {'games': result}
     
     def set_new_name(self, mac, new_name):
         """Set a new name for a device (will be sent in next status response)"""
@@ -826,45 +3013,65 @@ class DeviceStatusServer:
             if mac in self.pending_names:
                 del self.pending_names[mac]
     
-    def set_command(self, mac, command):
-        """Queue a command for a device"""
+    def set_command(self, mac, command, args=None):
+        """Queue a command for a device, args go into the same reply"""
         with self.devices_lock:
             if mac in self.devices:
                 self.pending_commands[mac] = command
+                if args:
+                    self.pending_command_args[mac] = dict(args)
+                else:
+                    self.pending_command_args.pop(mac, None)
                 self.log(f"Command '{command}' queued for device {mac}", "INFO")
                 return True
             return False
     
+    def request_benchmark(self, macs, suite='all', iterations=BENCH_DEF_ITERATIONS):
+        """Queue the benchmark command on the given devices, returns how many took it"""
+        if suite not in BENCH_SUITES:
+            raise ValueError(f"Unknown suite '{suite}'")
+        iterations = max(1, min(int(iterations), BENCH_MAX_ITERATIONS))
+        args = {'bench_suite': suite, 'bench_iterations': iterations}
+        return sum(1 for mac in macs if self.set_command(mac, 'benchmark', args))
+    
+    def get_benchmarks(self, suite=None):
+        """MAC -> last benchmark report, only those of suite if given"""
+        with self.devices_lock:
+            return {mac: report for mac, report in self.benchmarks.items()
+                    if suite is None or report.get('suite') == suite}
+    
     def monitor_devices(self):
         """Monitor devices and detect when they go offline"""
         while self.running:
             time.sleep(5)  # Check every 5 seconds
-            
-            gui_needs_update = False
-            
-            with self.devices_lock:
-                current_time = time.time()
-                for mac, info in self.devices.items():
-                    last_seen = info.get('last_seen', 0)
-                    is_online = (current_time - last_seen) < self.device_timeout
-                    device_name = info.get('name', mac)
-                    
-                    # Check if device just went offline
-                    if not is_online and mac in self.known_online_devices:
-                        self.known_online_devices.remove(mac)
-                        self.log(f"OFFLINE: {device_name} went offline", "WARNING")
-                        gui_needs_update = True
-                    # Check if device came back online
-                    elif is_online and mac not in self.known_online_devices:
-                        self.known_online_devices.add(mac)
-                        gui_needs_update = True
-            
-            # Update GUI if any status changed
-            if gui_needs_update and self.gui_callback:
-                try:
-                    self.gui_callback()
-                except:
-                    pass
+            self.check_devices()
+    
+    def check_devices(self):
+        gui_needs_update = False
+        
+        with self.devices_lock:
+            current_time = time.time()
+            for mac, info in self.devices.items():
+                last_seen = info.get('last_seen', 0)
+                is_online = (current_time - last_seen) < self.device_timeout
+                device_name = info.get('name', mac)
+                
+                # Check if device just went offline
+                if not is_online and mac in self.known_online_devices:
+                    self.known_online_devices.remove(mac)
+                    self.log(f"OFFLINE: {device_name} went offline", "WARNING")
+                    gui_needs_update = True
+                # Check if device came back online
+                elif is_online and mac not in self.known_online_devices:
+                    self.known_online_devices.add(mac)
+                    gui_needs_update = True
+        
+        # Update GUI if any status changed
+        if gui_needs_update and self.gui_callback:
+            try:
+                self.gui_callback()
+            except:
+                pass
     
     def create_flask_app(self):
         app = Flask(__name__)
@@ -884,29 +3091,69 @@ class DeviceStatusServer:
                 with server.devices_lock:
                     # Check if this is a new device or status changed
                     is_new_device = mac not in server.devices
-                    old_device_status = server.devices.get(mac, {}).get('device_status', '')
-                    old_game_status = server.devices.get(mac, {}).get('game_status', '')
-                    new_device_status = data.get('device_status', 'UNKNOWN')
-                    new_game_status = data.get('game_status', '')
-                    device_reported_name = data.get('name', 'Unknown')
+                    previous = server.devices.get(mac, {})
+                    old_device_status = previous.get('device_status', '')
+                    old_game_status = previous.get('game_status', '')
+                    
+                    # The boot report comes once per boot, keep it even when the delta is dropped
+                    boot_report = data.get('boot')
+                    if isinstance(boot_report, dict):
+                        server.boot_reports[mac] = boot_report
+                        server.log(f"BOOT: {previous.get('name', data.get('name', mac))} ready in "
+                                   f"{boot_report.get('ready_ms', '?')} ms", "INFO")
+                    
+                    # Hit latency histograms are cumulative per game, the last one of each device counts
+                    hit_report = data.get('hit_latency')
+                    if isinstance(hit_report, dict) and 'game' in hit_report:
+                        game = hit_report['game']
+                        if game not in server.hit_latency:
+                            server.log(f"HIT LATENCY: first report of game {game}", "INFO")
+                        server.hit_latency.setdefault(game, {})[mac] = hit_report
+                    
+                    # Delta reports only carry changed fields on top of the last full one;
+                    # old firmware sends neither 'seq' nor 'full' and is always treated as full
+                    seq = data.get('seq')
+                    is_full = seq is None or data.get('full', False)
+                    if not is_full and (is_new_device or previous.get('seq') is None or seq != previous['seq'] + 1):
+                        # unknown device or a lost delta: drop it and ask for a full report
+                        return jsonify({'status': 'ok', 'resync': True})
+                    base = {} if is_full else previous
+                    
+                    def field(key, default):
+                        return data.get(key, base.get(key, default))
+                    
+                    new_device_status = field('device_status', 'UNKNOWN')
+                    new_game_status = field('game_status', '')
+                    device_reported_name = field('name', 'Unknown')
                     
                     # Update device info
                     server.devices[mac] = {
                         'mac': mac,
                         'name': device_reported_name,
-                        'ip': data.get('ip', ''),
-                        'ssid': data.get('ssid', ''),
-                        'rssi': data.get('rssi', 0),
-                        'uptime': data.get('uptime', 0),
-                        'battery_mv': data.get('battery_mv', 0),
-                        'battery_pct': data.get('battery_pct', 0),
-                        'accel_activity': data.get('accel_activity', 0),
+                        'ip': field('ip', ''),
+                        'ssid': field('ssid', ''),
+                        'rssi': field('rssi', 0),
+                        'uptime': field('uptime', 0),
+                        'battery_mv': field('battery_mv', 0),
+                        'battery_pct': field('battery_pct', 0),
+                        'runtime_min': field('runtime_min', -1),
+                        'accel_activity': field('accel_activity', 0),
                         'device_status': new_device_status,
                         'game_status': new_game_status,
-                        'free_heap': data.get('free_heap', 0),
-                        'max_alloc_heap': data.get('max_alloc_heap', 0),
+                        'free_heap': field('free_heap', 0),
+                        'max_alloc_heap': field('max_alloc_heap', 0),
+                        'tunable_set': field('tunable_set', None),
+                        'seq': seq,
                         'last_seen': time.time()
                     }
+                    # Radio channel quality counters (absent on old firmware)
+                    for key in RADIO_STAT_KEYS:
+                        server.devices[mac][key] = field(key, 0)
+                    server.devices[mac]['rssi_hist'] = field('rssi_hist', [])
+                    server.devices[mac]['loop'] = field('loop', {})
+                    server.telemetry.add(mac, server.devices[mac], server.devices[mac]['last_seen'])
+                    if server.history:
+                        server.history.add(mac, server.devices[mac], server.devices[mac]['last_seen'])
                     
                     # Mark device as online (for monitor thread)
                     server.known_online_devices.add(mac)
@@ -917,9 +3164,18 @@ class DeviceStatusServer:
                     # Check for pending command
                     if mac in server.pending_commands:
                         response_data['command'] = server.pending_commands[mac]
+                        response_data.update(server.pending_command_args.pop(mac, {}))
                         del server.pending_commands[mac]
                         server.log(f"Sent command '{response_data['command']}' to {device_reported_name}", "SUCCESS")
                     
+                    # Tunable set of the device's cohort until it reports having it,
+                    # firmware without tunables reports no set at all
+                    reported_set = server.devices[mac]['tunable_set']
+                    set_name, set_values = server.experiments.assign(mac, device_reported_name)
+                    if reported_set is not None and reported_set != set_name:
+                        response_data['tunables'] = {'set': set_name, 'values': set_values}
+                        server.log(f"Tunables [{set_name or 'default'}] sent to {device_reported_name}", "INFO")
+                    
                     # Check for pending name change
                     if mac in server.pending_names:
                         pending_new_name = server.pending_names[mac]
@@ -931,6 +3187,8 @@ class DeviceStatusServer:
                             del server.pending_names[mac]
                             server.log(f"Device {mac} confirmed name change to '{pending_new_name}'", "SUCCESS")
                 
+                response_data['status_interval_ms'] = server.status_interval_ms(mac)
+
                 # Log only important events
                 if is_new_device:
                     server.log(f"NEW DEVICE: {device_reported_name} ({data.get('ip', '')}) connected", "SUCCESS")
@@ -957,6 +3215,73 @@ class DeviceStatusServer:
             """Get list of all known devices"""
             return jsonify({'devices': server.get_devices()})
         
+        @app.route('/boot_stats', methods=['GET'])
+        def boot_stats():
+            """Boot-time percentiles across the fleet"""
+            return jsonify(server.get_boot_stats())
+        
+        @app.route('/hit_latency', methods=['GET'])
+        def hit_latency():
+            """Attacker beacon to victim display latency, per game"""
+            return jsonify(server.get_hit_latency_stats())
+        
+        @app.route('/telemetry', methods=['GET'])
+        def telemetry():
+            """Time series of the fleet's status reports, see TELEMETRY_KEYS"""
+            try:
+                macs = request.args.get('mac')
+                keys = request.args.get('keys')
+                since = request.args.get('since')
+                series = server.telemetry.query(macs.split(',') if macs else None,
+                                                keys.split(',') if keys else None,
+                                                float(since) if since else None,
+                                                float(request.args.get('step', 0)))
+                with server.devices_lock:
+                    names = {mac: server.devices.get(mac, {}).get('name', mac) for mac in series}
+                with server.devices_lock:
+                    sets = {mac: server.devices.get(mac, {}).get('tunable_set', '') for mac in series}
+                for mac, entry in series.items():
+                    entry['name'] = names[mac]
+                    entry['tunable_set'] = sets[mac]
+                return jsonify({'keys': [k for k in TELEMETRY_KEYS if not keys or k in keys.split(',')],
+                                'devices': series, 'store': server.telemetry.info()})
+            except ValueError as e:
+                return jsonify({'error': str(e)}), 400
+        
+        @app.route('/experiments', methods=['GET'])
+        def experiments():
+            """Tunable sets, the set each device reports and the telemetry means per set"""
+            try:
+                since = request.args.get('since')
+                sets, cohorts = server.experiments.load()
+                with server.devices_lock:
+                    devices = {mac: dict(info) for mac, info in server.devices.items()}
+                return jsonify({'sets': sets,
+                                'cohorts': [{'match': m, 'sets': n} for m, n in cohorts],
+                                'devices': {mac: d.get('tunable_set', '') for mac, d in devices.items()},
+                                'summary': server.experiments.summary(server.telemetry, devices,
+                                                                      float(since) if since else None)})
+            except ValueError as e:
+                return jsonify({'error': str(e)}), 400
+        
+        @app.route('/history', methods=['GET'])
+        def history():
+            """Stored status reports, oldest first, since in epoch seconds or negative for seconds ago"""
+            if not server.history:
+                return jsonify({'error': 'No history database'}), 404
+            try:
+                since = float(request.args.get('since', -3600))
+                if since < 0:
+                    since += time.time()
+                rows = server.history.query(request.args.get('mac'), since,
+                                            int(request.args.get('limit', STATUS_DB_HISTORY_MAX)))
+                return jsonify({'reports': [dict(report, mac=mac, t=round(t, 1)) for mac, t, report in rows],
+                                'store': server.history.info()})
+            except ValueError as e:
+                return jsonify({'error': str(e)}), 400
+            except sqlite3.Error as e:
+                return jsonify({'error': str(e)}), 500
+        
         @app.route('/command', methods=['POST'])
         def send_command():
             """Queue a command for a device (for external API use)"""
@@ -968,9 +3293,20 @@ class DeviceStatusServer:
                 if not mac or not command:
                     return jsonify({'error': 'Missing mac or command'}), 400
                 
-                if command not in ['reboot', 'sleep']:
+                if command not in ['reboot', 'sleep', 'snapshot', 'reload_val', 'sync_bench', 'benchmark']:
                     return jsonify({'error': 'Invalid command'}), 400
                 
+                if command == 'benchmark':
+                    # mac may be a list, the whole selection runs the same suite
+                    macs = mac if isinstance(mac, list) else [mac]
+                    suite = data.get('suite', 'all')
+                    if suite not in BENCH_SUITES:
+                        return jsonify({'error': f'Invalid suite, one of {", ".join(BENCH_SUITES)}'}), 400
+                    count = server.request_benchmark(macs, suite, data.get('iterations', BENCH_DEF_ITERATIONS))
+                    if not count:
+                        return jsonify({'error': 'Device not found'}), 404
+                    return jsonify({'status': 'ok', 'message': f'Benchmark {suite} queued for {count} device(s)'})
+                
                 if server.set_command(mac, command):
                     return jsonify({'status': 'ok', 'message': f'Command {command} queued for {mac}'})
                 else:
@@ -979,6 +3315,110 @@ class DeviceStatusServer:
             except Exception as e:
                 return jsonify({'error': str(e)}), 500
         
+        @app.route('/snapshot', methods=['POST', 'GET'])
+        def snapshot():
+            """A device's framebuffer posted on the snapshot command, GET returns the latest as BMP"""
+            mac = request.args.get('mac', '').upper()
+            if not mac:
+                return jsonify({'error': 'Missing mac'}), 400
+            path = os.path.join(SNAPSHOT_DIR, mac.replace(':', '') + '.bmp')
+            if request.method == 'GET':
+                if not os.path.exists(path):
+                    return jsonify({'error': 'No snapshot'}), 404
+                if request.args.get('info'):
+                    with server.devices_lock:
+                        return jsonify(server.snapshots.get(mac, {'file': path}))
+                return send_file(os.path.abspath(path), mimetype='image/bmp')
+            try:
+                info, bmp = snapshot_decode(request.get_data())
+            except ValueError as e:
+                server.log(f"Snapshot from {mac} rejected: {e}", "WARNING")
+                return jsonify({'error': str(e)}), 400
+            os.makedirs(SNAPSHOT_DIR, exist_ok=True)
+            with open(path, 'wb') as f:
+                f.write(bmp)
+            info['time'] = time.time()
+            info['file'] = path
+            with server.devices_lock:
+                server.snapshots[mac] = info
+                name = server.devices.get(mac, {}).get('name', mac)
+            server.log(f"Snapshot from {name}: {info['width']}x{info['height']} in {info['bytes']} bytes, "
+                       f"render {info['render_ms']} ms (max {info['render_max_ms']}), "
+                       f"push {info['push_us']} us (max {info['push_max_us']}), "
+                       f"last push {info['push_age_ms']} ms ago -> {path}", "SUCCESS")
+            return jsonify({'status': 'ok', 'file': path})
+        
+        @app.route('/syncbench', methods=['POST', 'GET'])
+        def sync_bench():
+            """A device's sync benchmark report posted on the sync_bench command, GET returns the latest"""
+            mac = request.args.get('mac', '').upper()
+            if not mac:
+                return jsonify({'error': 'Missing mac'}), 400
+            if request.method == 'GET':
+                with server.devices_lock:
+                    report = server.sync_benches.get(mac)
+                if report is None:
+                    return jsonify({'error': 'No report'}), 404
+                return jsonify(report)
+            report = request.get_json(silent=True)
+            if not isinstance(report, dict):
+                return jsonify({'error': 'Invalid JSON'}), 400
+            report['time'] = time.time()
+            with server.devices_lock:
+                server.sync_benches[mac] = report
+                name = server.devices.get(mac, {}).get('name', mac)
+            sync = report.get('sync', {})
+            server.log(f"Sync bench from {name}: {sync.get('bytes', 0)} bytes at {sync.get('MBps', 0)} MB/s "
+                       f"(net {sync.get('net_ms', 0)} ms, flash {sync.get('flash_ms', 0)} ms, "
+                       f"psram {sync.get('psram_ms', 0)} ms, {sync.get('connects', 0)} connects of "
+                       f"{sync.get('connect_avg_ms', 0)} ms, {sync.get('retries', 0)} retries)", "SUCCESS")
+            ota = report.get('ota')
+            if ota:
+                server.log(f"OTA bench from {name}: {ota.get('bytes', 0)} bytes at {ota.get('MBps', 0)} MB/s, "
+                           f"{ota.get('retries', 0)} retries", "SUCCESS")
+            return jsonify({'status': 'ok'})
+        
+        @app.route('/benchmark', methods=['POST', 'GET'])
+        def benchmark():
+            """A device's firmware benchmark report posted on the benchmark command,
+            GET returns the reports and their summary by ?group= (build, board, battery)"""
+            if request.method == 'GET':
+                group = request.args.get('group', 'build')
+                if group not in BENCH_GROUPS:
+                    return jsonify({'error': f'Invalid group, one of {", ".join(BENCH_GROUPS)}'}), 400
+                reports = server.get_benchmarks(request.args.get('suite'))
+                return jsonify({'reports': reports, 'summary': benchmark_summary(reports, group)})
+            mac = request.args.get('mac', '').upper()
+            if not mac:
+                return jsonify({'error': 'Missing mac'}), 400
+            report = request.get_json(silent=True)
+            if not isinstance(report, dict):
+                return jsonify({'error': 'Invalid JSON'}), 400
+            report['time'] = time.time()
+            with server.devices_lock:
+                name = server.devices.get(mac, {}).get('name', mac)
+                report['name'] = name
+                server.benchmarks[mac] = report
+            if report.get('error'):
+                server.log(f"Benchmark [{report.get('suite', '?')}] from {name} failed: {report['error']}", "WARNING")
+            else:
+                server.log(f"Benchmark [{report.get('suite', '?')}] from {name}: {len(report.get('bench', []))} "
+                           f"benches, build {report.get('build', '?')}, battery {report.get('battery_pct', '?')}%",
+                           "SUCCESS")
+            return jsonify({'status': 'ok'})
+        
+        @app.route('/patterns', methods=['GET'])
+        def patterns():
+            """val.json or val.bin of the sync folder, for the reload_val command"""
+            filename = request.args.get('file', '')
+            if filename not in PATTERN_FILES:
+                return jsonify({'error': 'Invalid file'}), 400
+            folder = server.settings.get('file_server', 'sync_folder', './sync_files') if server.settings else './sync_files'
+            path = os.path.abspath(os.path.join(folder, filename))
+            if not os.path.exists(path):
+                return jsonify({'error': 'File not found'}), 404
+            return send_file(path, mimetype='application/octet-stream')
+        
         @app.route('/rename', methods=['POST'])
         def rename_device():
             """Set a new name for a device (for external API use)"""
@@ -1011,13 +3451,18 @@ class DeviceStatusServer:
     
     def run_server(self):
         try:
-            from werkzeug.serving import make_server
+            from werkzeug.serving import make_server, WSGIRequestHandler
             import logging
             log = logging.getLogger('werkzeug')
             log.setLevel(logging.ERROR)  # Suppress Flask's default logging
+
+            # HTTP/1.1 keeps the device status connections open between updates
+            class KeepAliveRequestHandler(WSGIRequestHandler):
+                protocol_version = "HTTP/1.1"
             
             self.app = self.create_flask_app()
-            self.http_server = make_server('0.0.0.0', self.port, self.app, threaded=True)
+            self.http_server = make_server('0.0.0.0', self.port, self.app, threaded=True,
+                                           request_handler=KeepAliveRequestHandler)
             self.log(f"Device status server started on port {self.port}", "SUCCESS")
             self.http_server.serve_forever()
         except Exception as e:
@@ -1031,6 +3476,18 @@ class DeviceStatusServer:
         
         self.running = True
         self.log(f"Starting device status server on port {self.port}...")
+        self.start_history()
+        
+        if self.host:
+            try:
+                self.app = self.create_flask_app()
+                self.host.serve_wsgi(self.port, self.app)
+                self.host.every('status_monitor', 5, self.check_devices)
+                self.log(f"Device status server started on port {self.port}, service host", "SUCCESS")
+            except Exception as e:
+                self.log(f"Device status server error: {e}", "ERROR")
+                self.running = False
+            return
         
         self.server_thread = threading.Thread(target=self.run_server, daemon=True)
         self.server_thread.start()
@@ -1045,15 +3502,351 @@ class DeviceStatusServer:
         self.log("Stopping device status server...")
         self.running = False
         
-        if hasattr(self, 'http_server'):
+        if self.host:
+            self.host.close('status_monitor')
+            self.host.close(self.port)
+        elif hasattr(self, 'http_server'):
             try:
                 self.http_server.shutdown()
             except:
                 pass
         
+        if self.history:
+            self.history.stop()
+            self.history = None
+        
         self.log("Device status server stopped", "SUCCESS")
 
 
+# ============== Service Host ==============
+# One asyncio loop (uvloop where installed) carries the sockets of all four
+# services: the discovery responders of every interface and the three HTTP
+# ports. A connection costs a coroutine while it idles between keep-alive
+# requests, a request gets a thread of the shared pool only while it runs:
+# the Flask apps through WSGI, the OTA handler on a socketless
+# BaseHTTPRequestHandler. /download bodies go out with loop.sendfile().
+# The servers keep their own state, so the caches and the device registry
+# are the same whichever way they are served.
+HOST_WORKERS = 32            # requests running at once over all services
+HOST_IDLE_S = 30             # keep-alive connections idle longer are closed, the devices close theirs at 15 s
+HOST_HEADER_LIMIT = 65536
+HOST_WRITE_TIMEOUT_S = 60
+
+
+class HostStream:
+    """Blocking file-like writer for a worker thread, onto the loop's transport"""
+    def __init__(self, loop, writer):
+        self.loop = loop
+        self.writer = writer
+
+    async def _write(self, data):
+        self.writer.write(data)
+        await self.writer.drain()
+
+    def write(self, data):
+        if data:
+            asyncio.run_coroutine_threadsafe(self._write(bytes(data)), self.loop).result(HOST_WRITE_TIMEOUT_S)
+        return len(data)
+
+    def sendfile(self, path, offset, count):
+        async def send():
+            with open(path, 'rb') as f:
+                await self.loop.sendfile(self.writer.transport, f, offset, count)
+        asyncio.run_coroutine_threadsafe(send(), self.loop).result(HOST_WRITE_TIMEOUT_S + count / 65536)
+
+    def flush(self):
+        pass
+
+
+class HostRequest:
+    def __init__(self, method, target, version, headers, body, addr, port):
+        self.method = method
+        self.target = target
+        self.version = version
+        self.headers = headers
+        self.body = body
+        self.addr = addr
+        self.port = port
+
+    @property
+    def keep_alive(self):
+        connection = self.headers.get('Connection', '').lower()
+        if self.version == 'HTTP/1.1':
+            return connection != 'close'
+        return connection == 'keep-alive'
+
+
+class AsyncServiceHost:
+    def __init__(self, log_callback=None, workers=HOST_WORKERS):
+        self.log_callback = log_callback
+        self.workers = workers
+        self.loop = None
+        self.thread = None
+        self.pool = None
+        self.servers = {}  # key -> asyncio server, datagram transport or timer task
+        self.connections = {}  # port -> open connections
+        self.requests = 0
+
+    def log(self, message, level="INFO"):
+        timestamp = datetime.now().strftime("%H:%M:%S")
+        log_message = f"[{timestamp}] [{level}] {message}"
+        if self.log_callback:
+            self.log_callback(log_message, level)
+        else:
+            print(log_message)
+
+    @property
+    def running(self):
+        return self.loop is not None and self.loop.is_running()
+
+    def start(self):
+        if self.running:
+            return
+        try:
+            import uvloop
+            self.loop = uvloop.new_event_loop()
+            flavour = "uvloop"
+        except ImportError:
+            self.loop = asyncio.new_event_loop()
+            flavour = "asyncio"
+        self.pool = ThreadPoolExecutor(max_workers=self.workers, thread_name_prefix='host')
+        self.loop.set_default_executor(self.pool)
+        ready = threading.Event()
+
+        def run():
+            asyncio.set_event_loop(self.loop)
+            self.loop.call_soon(ready.set)
+            self.loop.run_forever()
+        self.thread = threading.Thread(target=run, daemon=True)
+        self.thread.start()
+        ready.wait(5)
+        self.log(f"Service host started ({flavour}, {self.workers} workers)", "SUCCESS")
+
+    def stop(self):
+        if not self.running:
+            return
+        for key in list(self.servers):
+            self.close(key)
+
+        async def drop_connections():
+            tasks = [t for t in asyncio.all_tasks() if t is not asyncio.current_task()]
+            for task in tasks:
+                task.cancel()
+            await asyncio.gather(*tasks, return_exceptions=True)
+        try:
+            self.call(drop_connections())
+        except Exception:
+            pass
+        self.loop.call_soon_threadsafe(self.loop.stop)
+        self.thread.join(timeout=2.0)
+        self.pool.shutdown(wait=False)
+        self.loop = None
+        self.log("Service host stopped", "SUCCESS")
+
+    def call(self, coro, timeout=5):
+        """Runs a coroutine on the loop from another thread and waits for it"""
+        return asyncio.run_coroutine_threadsafe(coro, self.loop).result(timeout)
+
+    def close(self, key):
+        """Stops what was started under key: a port, (ip, port) of a responder, or a timer name"""
+        async def close_it():
+            server = self.servers.pop(key, None)
+            if server is None:
+                return
+            if isinstance(server, asyncio.Task):
+                server.cancel()
+            elif isinstance(server, asyncio.BaseTransport):
+                server.close()
+            else:
+                server.close()
+                await server.wait_closed()
+        if self.running:
+            try:
+                self.call(close_it())
+            except Exception as e:
+                self.log(f"Close {key}: {e}", "WARNING")
+
+    def info(self):
+        return {'requests': self.requests, 'workers': self.workers,
+                'connections': {port: n for port, n in self.connections.items()}}
+
+    # ---- UDP ----
+    def serve_udp(self, ip, port, answer):
+        """answer(data, addr) -> reply bytes or None, run on the pool"""
+        host = self
+
+        class Responder(asyncio.DatagramProtocol):
+            def connection_made(self, transport):
+                self.transport = transport
+
+            def datagram_received(self, data, addr):
+                async def reply():
+                    try:
+                        out = await host.loop.run_in_executor(None, answer, data, addr)
+                        if out:
+                            self.transport.sendto(out, addr)
+                    except Exception as e:
+                        host.log(f"UDP {ip}:{port}: {e}", "ERROR")
+                host.loop.create_task(reply())
+
+        async def open_it():
+            transport, _ = await self.loop.create_datagram_endpoint(
+                Responder, local_addr=(ip, port), reuse_port=None, allow_broadcast=True)
+            self.servers[(ip, port)] = transport
+        self.call(open_it())
+
+    # ---- timers ----
+    def every(self, name, interval_s, fn):
+        """fn() on the pool every interval_s until close(name)"""
+        async def tick():
+            while True:
+                await asyncio.sleep(interval_s)
+                try:
+                    await self.loop.run_in_executor(None, fn)
+                except Exception as e:
+                    self.log(f"{name}: {e}", "ERROR")
+
+        async def start_it():
+            self.servers[name] = self.loop.create_task(tick())
+        self.call(start_it())
+
+    # ---- HTTP ----
+    def serve_wsgi(self, port, app):
+        self.serve_http(port, lambda req, stream: self.run_wsgi(app, req, stream))
+
+    def serve_handler(self, port, handler_class, max_connections=None):
+        self.serve_http(port, lambda req, stream: self.run_handler(handler_class, req, stream), max_connections)
+
+    def serve_http(self, port, run, max_connections=None):
+        """run(request, stream) -> keep the connection open, on the pool"""
+        async def open_it():
+            server = await asyncio.start_server(
+                lambda r, w: self.connection(port, run, max_connections, r, w),
+                '0.0.0.0', port, limit=HOST_HEADER_LIMIT, reuse_address=True)
+            self.servers[port] = server
+        self.connections.setdefault(port, 0)
+        self.call(open_it())
+
+    async def connection(self, port, run, max_connections, reader, writer):
+        addr = writer.get_extra_info('peername') or ('', 0)
+        if max_connections and self.connections[port] >= max_connections:
+            writer.write(f"HTTP/1.1 503 Service Unavailable\r\nRetry-After: {ADMISSION_MIN_RETRY_S}\r\n"
+                         "Content-Length: 0\r\nConnection: close\r\n\r\n".encode())
+            writer.close()
+            return
+        self.connections[port] += 1
+        stream = HostStream(self.loop, writer)
+        try:
+            while True:
+                req = await self.read_request(reader, addr, port)
+                if req is None:
+                    break
+                self.requests += 1
+                keep = await self.loop.run_in_executor(None, run, req, stream)
+                if not keep:
+                    break
+        except (ConnectionError, asyncio.TimeoutError, asyncio.IncompleteReadError, asyncio.LimitOverrunError,
+                asyncio.CancelledError):
+            # cancelled on stop(), ends as a finished connection
+            pass
+        except Exception as e:
+            self.log(f"Port {port} connection from {addr[0]}: {e}", "ERROR")
+        finally:
+            self.connections[port] -= 1
+            writer.close()
+
+    async def read_request(self, reader, addr, port):
+        try:
+            head = await asyncio.wait_for(reader.readuntil(b'\r\n\r\n'), HOST_IDLE_S)
+        except asyncio.IncompleteReadError:
+            return None
+        lines = head.decode('latin-1').split('\r\n')
+        parts = lines[0].split()
+        if len(parts) != 3:
+            return None
+        headers = http.client.parse_headers(io.BytesIO(head[len(lines[0]) + 2:]))
+        if headers.get('Transfer-Encoding'):
+            # the firmware always sends a Content-Length
+            return None
+        length = int(headers.get('Content-Length') or 0)
+        body = await reader.readexactly(length) if length else b''
+        return HostRequest(parts[0], parts[1], parts[2], headers, body, addr, port)
+
+    def run_wsgi(self, app, req, stream):
+        path, _, query = req.target.partition('?')
+        environ = {
+            'REQUEST_METHOD': req.method,
+            'SCRIPT_NAME': '',
+            'PATH_INFO': urllib.parse.unquote_to_bytes(path).decode('latin-1'),
+            'QUERY_STRING': query,
+            'SERVER_NAME': 'localhost',
+            'SERVER_PORT': str(req.port),
+            'SERVER_PROTOCOL': req.version,
+            'REMOTE_ADDR': req.addr[0],
+            'REMOTE_PORT': str(req.addr[1]),
+            'CONTENT_TYPE': req.headers.get('Content-Type', ''),
+            'CONTENT_LENGTH': str(len(req.body)),
+            'wsgi.version': (1, 0),
+            'wsgi.url_scheme': 'http',
+            'wsgi.input': io.BytesIO(req.body),
+            'wsgi.errors': sys.stderr,
+            'wsgi.multithread': True,
+            'wsgi.multiprocess': False,
+            'wsgi.run_once': False,
+        }
+        for key, value in req.headers.items():
+            name = 'HTTP_' + key.upper().replace('-', '_')
+            if name not in ('HTTP_CONTENT_TYPE', 'HTTP_CONTENT_LENGTH'):
+                environ[name] = value
+        response = []
+
+        def start_response(status, headers, exc_info=None):
+            response[:] = [status, headers]
+            return stream.write
+
+        body = app(environ, start_response)
+        try:
+            status, headers = response
+            code = int(status.split()[0])
+            keep = req.keep_alive
+            sized = any(k.lower() == 'content-length' for k, _ in headers)
+            if not sized and req.method != 'HEAD' and code not in (204, 304) and code >= 200:
+                keep = False
+            head = [f"HTTP/1.1 {status}"] + [f"{k}: {v}" for k, v in headers]
+            if not keep:
+                head.append("Connection: close")
+            stream.write(('\r\n'.join(head) + '\r\n\r\n').encode('latin-1'))
+            if isinstance(body, SendfileBody):
+                stream.sendfile(body.path, body.offset, body.length)
+            else:
+                for chunk in body:
+                    stream.write(chunk)
+            return keep
+        finally:
+            if hasattr(body, 'close'):
+                body.close()
+
+    def run_handler(self, handler_class, req, stream):
+        handler = handler_class.__new__(handler_class)
+        handler.client_address = req.addr
+        handler.server = None
+        handler.rfile = io.BytesIO(req.body)
+        handler.wfile = stream
+        handler.command = req.method
+        handler.path = req.target
+        handler.request_version = req.version
+        handler.requestline = f"{req.method} {req.target} {req.version}"
+        handler.headers = req.headers
+        # as parse_request() decides it, a header the handler sends may change it
+        handler.close_connection = not (req.keep_alive and handler.protocol_version >= 'HTTP/1.1')
+        method = getattr(handler, 'do_' + req.method, None)
+        if method is None:
+            handler.send_error(501, "Unsupported method")
+            return False
+        method()
+        return not handler.close_connection
+
+
 # ============== Rename Dialog ==============
 class RenameDeviceDialog(tk.Toplevel):
     """Dialog for renaming a device"""
@@ -1120,6 +3913,120 @@ class RenameDeviceDialog(tk.Toplevel):
         self.destroy()
 
 
+# ============== Benchmark Window ==============
+class BenchmarkWindow(tk.Toplevel):
+    """Runs a firmware benchmark suite on the selected or all online devices and
+    compares the reports per device and per build, board or battery band"""
+    REFRESH_MS = 2000
+    
+    def __init__(self, parent, status_server, selected_macs):
+        super().__init__(parent)
+        self.status_server = status_server
+        self.selected_macs = list(selected_macs)
+        
+        self.title("Fleet Benchmark")
+        self.geometry("900x600")
+        self.transient(parent)
+        
+        self.create_widgets()
+        self.refresh()
+    
+    def create_widgets(self):
+        main_frame = ttk.Frame(self, padding="10")
+        main_frame.pack(fill=tk.BOTH, expand=True)
+        
+        run_frame = ttk.Frame(main_frame)
+        run_frame.pack(fill=tk.X, pady=(0, 10))
+        ttk.Label(run_frame, text="Suite:").pack(side=tk.LEFT, padx=(0, 5))
+        self.suite_var = tk.StringVar(value='all')
+        ttk.Combobox(run_frame, textvariable=self.suite_var, values=BENCH_SUITES, state='readonly',
+                     width=10).pack(side=tk.LEFT, padx=(0, 10))
+        ttk.Label(run_frame, text="Iterations:").pack(side=tk.LEFT, padx=(0, 5))
+        self.iterations_var = tk.IntVar(value=BENCH_DEF_ITERATIONS)
+        ttk.Spinbox(run_frame, from_=1, to=BENCH_MAX_ITERATIONS, textvariable=self.iterations_var,
+                    width=6).pack(side=tk.LEFT, padx=(0, 10))
+        ttk.Button(run_frame, text=f"Run on Selected ({len(self.selected_macs)})", command=self.run_selected,
+                   state='normal' if self.selected_macs else 'disabled').pack(side=tk.LEFT, padx=(0, 5))
+        ttk.Button(run_frame, text="Run on All Online", command=self.run_all).pack(side=tk.LEFT, padx=(0, 5))
+        
+        ttk.Label(run_frame, text="Compare by:").pack(side=tk.LEFT, padx=(20, 5))
+        self.group_var = tk.StringVar(value='build')
+        group_box = ttk.Combobox(run_frame, textvariable=self.group_var, values=BENCH_GROUPS, state='readonly', width=8)
+        group_box.pack(side=tk.LEFT)
+        group_box.bind('<<ComboboxSelected>>', lambda e: self.refresh(reschedule=False))
+        
+        device_frame = ttk.LabelFrame(main_frame, text="Per Device", padding="5")
+        device_frame.pack(fill=tk.BOTH, expand=True, pady=(0, 10))
+        columns = ('name', 'suite', 'build', 'board', 'battery', 'bench', 'median_us', 'p99_us', 'heap')
+        self.device_tree = ttk.Treeview(device_frame, columns=columns, show='headings', height=10)
+        for col, text, width in (('name', 'Device', 120), ('suite', 'Suite', 60), ('build', 'Build', 60),
+                                 ('board', 'Board', 100), ('battery', 'Battery', 60), ('bench', 'Bench', 200),
+                                 ('median_us', 'Median us', 80), ('p99_us', 'p99 us', 80), ('heap', 'Heap/it', 60)):
+            self.device_tree.heading(col, text=text)
+            self.device_tree.column(col, width=width, anchor=tk.W if col in ('name', 'bench') else tk.CENTER)
+        device_scroll = ttk.Scrollbar(device_frame, orient=tk.VERTICAL, command=self.device_tree.yview)
+        self.device_tree.configure(yscrollcommand=device_scroll.set)
+        self.device_tree.pack(side=tk.LEFT, fill=tk.BOTH, expand=True)
+        device_scroll.pack(side=tk.RIGHT, fill=tk.Y)
+        
+        summary_frame = ttk.LabelFrame(main_frame, text="Comparison", padding="5")
+        summary_frame.pack(fill=tk.BOTH, expand=True)
+        columns = ('bench', 'group', 'devices', 'median_us', 'p99_us', 'vs_best')
+        self.summary_tree = ttk.Treeview(summary_frame, columns=columns, show='headings', height=8)
+        for col, text, width in (('bench', 'Bench', 220), ('group', 'Group', 120), ('devices', 'Devices', 60),
+                                 ('median_us', 'Median us', 90), ('p99_us', 'p99 us', 90), ('vs_best', 'vs Best', 80)):
+            self.summary_tree.heading(col, text=text)
+            self.summary_tree.column(col, width=width, anchor=tk.W if col in ('bench', 'group') else tk.CENTER)
+        self.summary_tree.tag_configure('slow', foreground='red')
+        summary_scroll = ttk.Scrollbar(summary_frame, orient=tk.VERTICAL, command=self.summary_tree.yview)
+        self.summary_tree.configure(yscrollcommand=summary_scroll.set)
+        self.summary_tree.pack(side=tk.LEFT, fill=tk.BOTH, expand=True)
+        summary_scroll.pack(side=tk.RIGHT, fill=tk.Y)
+    
+    def run(self, macs):
+        try:
+            count = self.status_server.request_benchmark(macs, self.suite_var.get(), self.iterations_var.get())
+        except (ValueError, tk.TclError) as e:
+            messagebox.showerror("Error", str(e), parent=self)
+            return
+        self.status_server.log(f"Benchmark [{self.suite_var.get()}] queued for {count} device(s), "
+                               f"results come with their next report", "INFO")
+    
+    def run_selected(self):
+        self.run(self.selected_macs)
+    
+    def run_all(self):
+        online = [d['mac'] for d in self.status_server.get_devices() if d.get('online', False)]
+        if not online:
+            messagebox.showinfo("No Devices", "No online devices to benchmark.", parent=self)
+            return
+        self.run(online)
+    
+    def refresh(self, reschedule=True):
+        if not self.winfo_exists():
+            return
+        reports = self.status_server.get_benchmarks()
+        self.device_tree.delete(*self.device_tree.get_children())
+        for mac, report in sorted(reports.items(), key=lambda item: item[1].get('name', item[0])):
+            head = (report.get('name', mac), report.get('suite', '?'), report.get('build', '?'),
+                    bench_group_key(report, 'board'), f"{report.get('battery_pct', '?')}%")
+            if report.get('error'):
+                self.device_tree.insert('', tk.END, values=head + (f"error: {report['error']}", '', '', ''))
+                continue
+            for bench in report.get('bench', []):
+                self.device_tree.insert('', tk.END, values=head + (
+                    bench.get('name', '?'), f"{bench.get('median_ns', 0) / 1000:.1f}",
+                    f"{bench.get('p99_ns', 0) / 1000:.1f}", f"{bench.get('heap_delta', 0):.1f}"))
+        self.summary_tree.delete(*self.summary_tree.get_children())
+        for row in benchmark_summary(reports, self.group_var.get()):
+            tags = ('slow',) if row['vs_best_pct'] >= 10 else ()
+            self.summary_tree.insert('', tk.END, tags=tags, values=(
+                row['bench'], row['group'], row['devices'], f"{row['median_ns'] / 1000:.1f}",
+                f"{row['p99_ns'] / 1000:.1f}", f"+{row['vs_best_pct']}%" if row['vs_best_pct'] else 'best'))
+        if reschedule:
+            self.after(self.REFRESH_MS, self.refresh)
+
+
 # ============== Main GUI ==============
 class ServerManagerGUI:
     def __init__(self, root):
@@ -1136,12 +4043,24 @@ class ServerManagerGUI:
         self.disco_server = DiscoveryServer(log_callback=self.add_disco_log, settings=self.settings)
         self.file_server = FileServer(log_callback=self.add_file_log, settings=self.settings)
         self.ota_server = OTAServer(log_callback=self.add_ota_log, settings=self.settings)
+        self.disco_server.firmware_info = self.ota_server.firmware_info
+        self.disco_server.services = self.service_ports
+        self.disco_server.assets_signature = self.file_server.assets_signature
         self.device_status_server = DeviceStatusServer(
             log_callback=self.add_device_status_log, 
             settings=self.settings,
             gui_callback=self.schedule_device_table_update
         )
         
+        # opt-in: one asyncio loop for the sockets of all four servers
+        self.service_host = None
+        if self.settings.get('service_host', 'enabled'):
+            self.service_host = AsyncServiceHost(log_callback=self.add_device_status_log,
+                                                 workers=self.settings.get('service_host', 'workers', HOST_WORKERS))
+            self.service_host.start()
+            for server in (self.disco_server, self.file_server, self.ota_server, self.device_status_server):
+                server.host = self.service_host
+        
         self.interfaces = []
         self.interface_vars = []
         
@@ -1422,6 +4341,9 @@ class ServerManagerGUI:
         self.device_sleep_all_btn = ttk.Button(control_frame, text="Sleep All", command=self.send_sleep_all_command)
         self.device_sleep_all_btn.pack(side=tk.LEFT, padx=(0, 5))
         
+        self.device_benchmark_btn = ttk.Button(control_frame, text="Benchmark", command=self.open_benchmark_window)
+        self.device_benchmark_btn.pack(side=tk.LEFT, padx=(0, 5))
+        
         # Current Device section (with separator)
         ttk.Separator(control_frame, orient='vertical').pack(side=tk.LEFT, fill='y', padx=10)
         
@@ -1430,6 +4352,14 @@ class ServerManagerGUI:
         self.device_rename_btn = ttk.Button(control_frame, text="Rename", command=self.rename_selected_device, state='disabled')
         self.device_rename_btn.pack(side=tk.LEFT, padx=(0, 5))
         
+        self.device_snapshot_btn = ttk.Button(control_frame, text="Snapshot", command=self.snapshot_selected_device, state='disabled')
+        self.device_snapshot_btn.pack(side=tk.LEFT, padx=(0, 5))
+        
+        self.device_reload_val_btn = ttk.Button(control_frame, text="Reload Patterns", command=self.reload_val_selected_device, state='disabled')
+        self.device_reload_val_btn.pack(side=tk.LEFT, padx=(0, 5))
+        self.device_sync_bench_btn = ttk.Button(control_frame, text="Sync Bench", command=self.sync_bench_selected_device, state='disabled')
+        self.device_sync_bench_btn.pack(side=tk.LEFT, padx=(0, 5))
+        
         # Device Table
         table_frame = ttk.LabelFrame(tab, text="Connected Devices", padding="10")
         table_frame.grid(row=1, column=0, sticky=(tk.W, tk.E, tk.N, tk.S), pady=(0, 10))
@@ -1462,7 +4392,7 @@ class ServerManagerGUI:
         self.device_tree.column('ssid', width=80, minwidth=60, anchor='center')
         self.device_tree.column('rssi', width=50, minwidth=40, anchor='center')
         self.device_tree.column('uptime', width=70, minwidth=50, anchor='center')
-        self.device_tree.column('battery', width=100, minwidth=70, anchor='center')
+        self.device_tree.column('battery', width=140, minwidth=70, anchor='center')
         self.device_tree.column('accel', width=50, minwidth=40, anchor='center')
         self.device_tree.column('free_heap', width=80, minwidth=60, anchor='center')
         self.device_tree.column('max_alloc', width=80, minwidth=60, anchor='center')
@@ -1875,8 +4805,59 @@ class ServerManagerGUI:
         if selection:
             # Enable rename button when a device is selected
             self.device_rename_btn.config(state='normal')
+            self.device_snapshot_btn.config(state='normal')
+            self.device_reload_val_btn.config(state='normal')
+            self.device_sync_bench_btn.config(state='normal')
         else:
             self.device_rename_btn.config(state='disabled')
+            self.device_snapshot_btn.config(state='disabled')
+            self.device_reload_val_btn.config(state='disabled')
+            self.device_sync_bench_btn.config(state='disabled')
+    
+    def snapshot_selected_device(self):
+        """Ask the selected device for its framebuffer, it arrives with its next report"""
+        selection = self.device_tree.selection()
+        if not selection:
+            messagebox.showinfo("No Selection", "Please select a device to snapshot.")
+            return
+        mac = selection[0]
+        if self.device_status_server.set_command(mac, 'snapshot'):
+            self.add_device_status_log(
+                f"[{datetime.now().strftime('%H:%M:%S')}] [INFO] Snapshot requested from {mac}, saved to {SNAPSHOT_DIR}/",
+                "INFO"
+            )
+        else:
+            messagebox.showerror("Error", "Failed to queue snapshot command.")
+    
+    def reload_val_selected_device(self):
+        """Have the selected device play the sync folder's val.json/val.bin, from its next report on"""
+        selection = self.device_tree.selection()
+        if not selection:
+            messagebox.showinfo("No Selection", "Please select a device to reload.")
+            return
+        mac = selection[0]
+        if self.device_status_server.set_command(mac, 'reload_val'):
+            self.add_device_status_log(
+                f"[{datetime.now().strftime('%H:%M:%S')}] [INFO] Pattern reload requested from {mac}",
+                "INFO"
+            )
+        else:
+            messagebox.showerror("Error", "Failed to queue reload command.")
+    
+    def sync_bench_selected_device(self):
+        """Have the selected device time a download from the file server, the result is logged here"""
+        selection = self.device_tree.selection()
+        if not selection:
+            messagebox.showinfo("No Selection", "Please select a device to benchmark.")
+            return
+        mac = selection[0]
+        if self.device_status_server.set_command(mac, 'sync_bench'):
+            self.add_device_status_log(
+                f"[{datetime.now().strftime('%H:%M:%S')}] [INFO] Sync benchmark requested from {mac}",
+                "INFO"
+            )
+        else:
+            messagebox.showerror("Error", "Failed to queue benchmark command.")
     
     def rename_selected_device(self):
         """Open rename dialog for the selected device"""
@@ -1920,6 +4901,18 @@ class ServerManagerGUI:
             else:
                 messagebox.showerror("Error", "Failed to queue rename command.")
     
+    def service_ports(self):
+        """Ports of the services the discovery reply hands out, the game server's from the settings"""
+        ports = {}
+        if self.file_server.running:
+            ports['file'] = self.file_server.port
+        ports['game'] = self.disco_server.game_port
+        if self.ota_server.running:
+            ports['ota'] = self.ota_server.port
+        if self.device_status_server.running:
+            ports['status'] = self.device_status_server.port
+        return ports
+    
     def schedule_device_table_update(self):
         """Schedule table update on main thread"""
         self.root.after(0, self.refresh_device_table)
@@ -1948,6 +4941,8 @@ class ServerManagerGUI:
             
             # Format battery
             battery_str = f"{device.get('battery_pct', 0)}% ({device.get('battery_mv', 0)}mV)"
+            if device.get('empty_in_min') is not None:
+                battery_str += f" ~{device['empty_in_min'] // 60}h{device['empty_in_min'] % 60:02d}"
             
             # Format heap values (convert bytes to KB)
             free_heap_kb = device.get('free_heap', 0) // 1024
@@ -1992,8 +4987,14 @@ class ServerManagerGUI:
         # Update rename button state
         if self.device_tree.selection():
             self.device_rename_btn.config(state='normal')
+            self.device_snapshot_btn.config(state='normal')
+            self.device_reload_val_btn.config(state='normal')
+            self.device_sync_bench_btn.config(state='normal')
         else:
             self.device_rename_btn.config(state='disabled')
+            self.device_snapshot_btn.config(state='disabled')
+            self.device_reload_val_btn.config(state='disabled')
+            self.device_sync_bench_btn.config(state='disabled')
     
     def send_reboot_all_command(self):
         """Send reboot command to all online devices"""
@@ -2045,6 +5046,10 @@ class ServerManagerGUI:
                 "INFO"
             )
     
+    def open_benchmark_window(self):
+        """Fleet benchmark runs and their comparison, on the selected devices or all online"""
+        BenchmarkWindow(self.root, self.device_status_server, self.device_tree.selection())
+    
     # ===== Utility Methods =====
     def open_folder(self, folder):
         """Open folder in system file manager"""
@@ -2104,11 +5109,23 @@ class ServerManagerGUI:
             self.ota_server.stop()
         if self.device_status_server.running:
             self.device_status_server.stop()
+        if self.service_host:
+            self.service_host.stop()
         
         self.root.destroy()
 
 
 if __name__ == "__main__":
+    # server_manager.py --build-assets <folder> <image>: offline asset image build
+    if len(sys.argv) == 4 and sys.argv[1] == '--build-assets':
+        folder, image = sys.argv[2], sys.argv[3]
+        sources = [os.path.join(root, name) for root, dirs, names in os.walk(folder) for name in names]
+        packed, skipped = build_asset_pack(sources, image)
+        print(f"{image}: {len(packed)} files, {os.path.getsize(image)} bytes")
+        for name in skipped:
+            print(f"  left out (no room): {name}")
+        sys.exit(0)
+    
     # Check for single instance
     instance_lock = SingleInstance()
     
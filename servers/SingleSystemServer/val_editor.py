@@ -4,16 +4,21 @@ LED Pattern Editor for ESP32
 A visual editor for LED strip patterns with MP3 playback support.
 
 Usage: python led_pattern_editor.py [sync_files_directory]
+       python led_pattern_editor.py --compile sync_files_directory
 
 The sync_files directory should contain:
 - val.json (the pattern file)
 - MP3 files referenced in the patterns
+
+Saving also writes val.bin, val.json precompiled for the device; --compile
+only rebuilds val.bin, without the editor window.
 """
 
 import tkinter as tk
 from tkinter import ttk, colorchooser, filedialog, messagebox
 import json
 import os
+import struct
 import sys
 import threading
 import time
@@ -52,6 +57,89 @@ if not AUDIO_BACKEND:
     print("  pip install pygame")
 
 
+# val.bin, loaded by the device in place of val.json, see tValBinHeader in valPlayer.h
+# Header (24 bytes): magic, version u16, patterns u16, strips u16, pattern record size u8,
+#                    strip record size u8, val.json size u32, val.json rolling hash u32, reserved u32
+# Pattern (68 bytes): name[30], sound file[30], first strip u16, strips u16, sound level u8, flags u8, pad[2]
+# Strip (28 bytes): 8 x r, g, b, interval ms u16, vibro level u8, ease u8
+# A strip is [8 colours, interval ms, vibro, optional ease]: vibro 0/1 is off/full, 2..255 a PWM
+# level; ease 0 holds the strip, 1 fades linearly into the next one over its interval, 2 smoothly
+VAL_BIN_MAGIC = b'VALB'
+VAL_BIN_VERSION = 2
+VAL_BIN_HEADER = struct.Struct('<4sHHHBBIII')
+VAL_BIN_PATTERN = struct.Struct('<30s30sHHBB2x')
+VAL_BIN_STRIP = struct.Struct('<24sHBB')
+VAL_BIN_CIRCULAR = 0x01
+VAL_BIN_SOUND = 0x02
+VAL_PIXELS_NUM = 8
+
+
+def _val_int(value):
+    """Strip field as the device reads it: hex with an x in it, decimal otherwise, 0 if unreadable"""
+    text = str(value).strip()
+    try:
+        if 'x' in text.lower():
+            return int(text.lower().replace('0x', ''), 16) & 0xFFFFFFFF
+        return int(text)
+    except ValueError:
+        return 0
+
+
+def _val_name(text):
+    """NUL padded the way the device copies names, at most 29 characters"""
+    return str(text).encode('utf-8')[:29]
+
+
+def _val_default(value, default):
+    """ArduinoJson's value | default: only a missing or null field takes the default"""
+    return default if value is None else value
+
+
+def build_val_bin(data, json_bytes):
+    """val.bin image for the pattern set in data, json_bytes is the val.json it was saved as"""
+    patterns = data.get('PlayPatterns', [])[:254]
+    pattern_recs = []
+    strip_recs = []
+    for pattern in patterns:
+        first = len(strip_recs)
+        for strip in pattern.get('Strips', []):
+            rgb = bytearray()
+            for i in range(VAL_PIXELS_NUM):
+                color = _val_int(strip[i]) if i < len(strip) else 0
+                rgb += bytes(((color >> 16) & 0xFF, (color >> 8) & 0xFF, color & 0xFF))
+            interval = _val_int(strip[VAL_PIXELS_NUM]) if len(strip) > VAL_PIXELS_NUM else 0
+            vibro = _val_int(strip[VAL_PIXELS_NUM + 1]) if len(strip) > VAL_PIXELS_NUM + 1 else 0
+            vibro = 255 if vibro == 1 else min(max(vibro, 0), 255)
+            ease = _val_int(strip[VAL_PIXELS_NUM + 2]) if len(strip) > VAL_PIXELS_NUM + 2 else 0
+            strip_recs.append(VAL_BIN_STRIP.pack(bytes(rgb), interval & 0xFFFF, vibro, min(max(ease, 0), 2)))
+        flags = (VAL_BIN_CIRCULAR if pattern.get('Circular') else 0) | \
+                (VAL_BIN_SOUND if pattern.get('PlaySound') else 0)
+        pattern_recs.append(VAL_BIN_PATTERN.pack(
+            _val_name(_val_default(pattern.get('PatternName'), 'NO_NAME')),
+            _val_name(_val_default(pattern.get('SoundFile'), 'NA')),
+            first, len(strip_recs) - first, int(pattern.get('SoundLevel') or 0) & 0xFF, flags))
+    if len(strip_recs) > 0xFFFF:
+        raise ValueError('too many strips for val.bin')
+    json_hash = 0
+    for byte in json_bytes:
+        json_hash = (json_hash * 31 + byte) & 0xFFFFFFFF
+    header = VAL_BIN_HEADER.pack(VAL_BIN_MAGIC, VAL_BIN_VERSION, len(pattern_recs), len(strip_recs),
+                                 VAL_BIN_PATTERN.size, VAL_BIN_STRIP.size, len(json_bytes), json_hash, 0)
+    return header + b''.join(pattern_recs) + b''.join(strip_recs)
+
+
+def compile_val_bin(folder):
+    """Writes val.bin next to val.json in folder, returns its path"""
+    json_path = os.path.join(folder, 'val.json')
+    with open(json_path, 'rb') as f:
+        json_bytes = f.read()
+    image = build_val_bin(json.loads(json_bytes.decode('utf-8')), json_bytes)
+    bin_path = os.path.join(folder, 'val.bin')
+    with open(bin_path, 'wb') as f:
+        f.write(image)
+    return bin_path
+
+
 class AudioPlayer:
     """Cross-platform audio player with multiple backend support"""
     
@@ -604,6 +692,7 @@ class LEDPatternEditor:
         try:
             with open(self.json_file_path, 'w', encoding='utf-8') as f:
                 json.dump(self.data, f, indent=4)
+            compile_val_bin(os.path.dirname(self.json_file_path))
             self.modified = False
             self.update_title()
             self.status_var.set(f"Saved: {self.json_file_path}")
@@ -697,6 +786,9 @@ class LEDPatternEditor:
                 strip.append(color)
             strip.append(widget_data['duration'].get())
             strip.append(widget_data['vibration'].get())
+            # the ease field is optional, step frames keep the short form
+            if widget_data['ease'].get() not in ('', '0'):
+                strip.append(widget_data['ease'].get())
             strips.append(strip)
             
         pattern['Strips'] = strips
@@ -736,7 +828,8 @@ class LEDPatternEditor:
             'colors': [],
             'buttons': [],
             'duration': tk.StringVar(value=strip_data[8] if len(strip_data) > 8 else '100'),
-            'vibration': tk.StringVar(value=strip_data[9] if len(strip_data) > 9 else '0')
+            'vibration': tk.StringVar(value=strip_data[9] if len(strip_data) > 9 else '0'),
+            'ease': tk.StringVar(value=strip_data[10] if len(strip_data) > 10 else '0')
         }
         
         # Frame index label
@@ -809,10 +902,24 @@ class LEDPatternEditor:
         widget_data['vib_label'] = vib_label
         
         vib_combo = ttk.Combobox(frame, textvariable=widget_data['vibration'], 
-                                 values=['0', '1'], width=3, state='readonly')
+                                 values=['0', '1', '64', '128', '192'], width=4)
         vib_combo.pack(side=tk.LEFT)
         vib_combo.bind('<<ComboboxSelected>>', lambda e: self.mark_modified())
+        vib_combo.bind('<KeyRelease>', lambda e: self.mark_modified())
         widget_data['vib_combo'] = vib_combo
+        ToolTip(vib_combo, lambda: "0 off, 1 full, 2..255 PWM level")
+        
+        # Ease into the next frame: 0 step, 1 linear, 2 smooth
+        ease_label = tk.Label(frame, text="Ease:", bg='#3d3d3d', fg='white')
+        ease_label.pack(side=tk.LEFT, padx=(10, 2))
+        widget_data['ease_label'] = ease_label
+        
+        ease_combo = ttk.Combobox(frame, textvariable=widget_data['ease'],
+                                  values=['0', '1', '2'], width=2, state='readonly')
+        ease_combo.pack(side=tk.LEFT)
+        ease_combo.bind('<<ComboboxSelected>>', lambda e: self.mark_modified())
+        widget_data['ease_combo'] = ease_combo
+        ToolTip(ease_combo, lambda: "0 step, 1 linear fade, 2 smooth fade into the next frame")
         
         # Select button (use padx for better sizing)
         select_btn = tk.Button(frame, text=" Select ", bg='#555555', fg='white',
@@ -1551,6 +1658,13 @@ class LEDPatternEditor:
 def main():
     # Check command line arguments
     sync_dir = None
+    if len(sys.argv) > 2 and sys.argv[1] == '--compile':
+        try:
+            print(f"Written: {compile_val_bin(sys.argv[2])}")
+        except (OSError, ValueError) as e:
+            print(f"Error: {e}")
+            sys.exit(1)
+        return
     if len(sys.argv) > 1:
         sync_dir = sys.argv[1]
         if not os.path.isdir(sync_dir):
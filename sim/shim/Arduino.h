@@ -0,0 +1,133 @@
+#pragma once
+
+// Host stand-in for the parts of the Arduino core used by game/gameEngine,
+// only meant for the native simulator build (see sim/zgameSim.cpp)
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <string>
+#include <algorithm>
+
+using std::min;
+using std::max;
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+// Virtual clock, driven by the simulator
+uint32_t simGetMillis(void);
+void simSetMillis(uint32_t ms);
+inline unsigned long millis(void) { return simGetMillis(); }
+inline void delay(uint32_t) {}
+inline uint32_t esp_random(void) { return (uint32_t)rand(); }
+inline long random(long howbig) { return (howbig > 0) ? rand() % howbig : 0; }
+inline long random(long howsmall, long howbig) { return (howbig > howsmall) ? howsmall + random(howbig - howsmall) : howsmall; }
+inline void *ps_malloc(size_t size) { return malloc(size); }
+inline size_t simStrlcpy(char *dst, const char *src, size_t size)
+{
+    size_t len = strlen(src);
+    if (size)
+    {
+        size_t n = (len < size - 1) ? len : size - 1;
+        memcpy(dst, src, n);
+        dst[n] = 0;
+    }
+    return len;
+}
+#define strlcpy simStrlcpy
+
+typedef int portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED    0
+#define portENTER_CRITICAL(mux)         ((void)(mux))
+#define portEXIT_CRITICAL(mux)          ((void)(mux))
+
+class String
+{
+public:
+    String(const char *s = "") : str(s ? s : "") {}
+    String(const std::string &s) : str(s) {}
+    String(char c) : str(1, c) {}
+    String(int v) : str(std::to_string(v)) {}
+    String(unsigned int v) : str(std::to_string(v)) {}
+    String(long v) : str(std::to_string(v)) {}
+    String(unsigned long v) : str(std::to_string(v)) {}
+    String(long long v) : str(std::to_string(v)) {}
+    String(unsigned long long v) : str(std::to_string(v)) {}
+    String(double v, unsigned int decimals = 2)
+    {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%.*f", decimals, v);
+        str = buf;
+    }
+
+    const char *c_str(void) const { return str.c_str(); }
+    unsigned int length(void) const { return str.length(); }
+    bool reserve(unsigned int size) { str.reserve(size); return true; }
+    bool concat(const char *s) { str += s; return true; }
+    bool concat(char c) { str += c; return true; }
+    int indexOf(const String &s, unsigned int from = 0) const
+    {
+        size_t pos = str.find(s.str, from);
+        return (pos == std::string::npos) ? -1 : (int)pos;
+    }
+    String substring(unsigned int from, unsigned int to = 0xFFFFFFFF) const
+    {
+        if (from > str.length())
+            return String();
+        return String(str.substr(from, (to == 0xFFFFFFFF) ? std::string::npos : to - from));
+    }
+    void trim(void)
+    {
+        size_t b = str.find_first_not_of(" \t\r\n");
+        size_t e = str.find_last_not_of(" \t\r\n");
+        str = (b == std::string::npos) ? "" : str.substr(b, e - b + 1);
+    }
+    long toInt(void) const { return atol(str.c_str()); }
+
+    String &operator+=(const String &s) { str += s.str; return *this; }
+    String &operator+=(const char *s) { str += s; return *this; }
+    String &operator+=(char c) { str += c; return *this; }
+    bool operator==(const String &s) const { return str == s.str; }
+    bool operator==(const char *s) const { return str == s; }
+    bool operator!=(const String &s) const { return str != s.str; }
+    bool operator!=(const char *s) const { return str != s; }
+    char operator[](unsigned int i) const { return str[i]; }
+
+    friend String operator+(const String &a, const String &b) { return String(a.str + b.str); }
+    friend String operator+(const char *a, const String &b) { return String(std::string(a) + b.str); }
+    friend String operator+(const String &a, const char *b) { return String(a.str + b); }
+
+private:
+    std::string str;
+};
+
+class HardwareSerial
+{
+public:
+    int printf(const char *fmt, ...) __attribute__((format(printf, 2, 3)))
+    {
+        va_list args;
+        va_start(args, fmt);
+        int res = vprintf(fmt, args);
+        va_end(args);
+        return res;
+    }
+    void print(const String &s) { fputs(s.c_str(), stdout); }
+    void print(const char *s) { fputs(s, stdout); }
+    void print(int v) { ::printf("%d", v); }
+    void print(unsigned long v) { ::printf("%lu", v); }
+    void println(const String &s) { ::printf("%s\r\n", s.c_str()); }
+    void println(const char *s = "") { ::printf("%s\r\n", s); }
+    void println(int v) { ::printf("%d\r\n", v); }
+};
+extern HardwareSerial Serial;
+
+class EspClass
+{
+public:
+    uint64_t getEfuseMac(void) { return 0; }
+    void restart(void) { exit(1); }
+};
+extern EspClass ESP;
@@ -0,0 +1,48 @@
+#pragma once
+
+// Host stand-in for PSRamFS, paths are used relative to the working directory
+
+#include <Arduino.h>
+
+class File
+{
+public:
+    File(FILE *f = NULL) : fp(f) {}
+    operator bool(void) const { return fp != NULL; }
+    size_t read(uint8_t *buf, size_t size) { return fp ? fread(buf, 1, size, fp) : 0; }
+    size_t write(const uint8_t *buf, size_t size) { return fp ? fwrite(buf, 1, size, fp) : 0; }
+    String readString(void)
+    {
+        std::string res;
+        char buf[256];
+        size_t n;
+        while (fp && (n = fread(buf, 1, sizeof(buf), fp)) > 0)
+            res.append(buf, n);
+        return String(res);
+    }
+    void close(void)
+    {
+        if (fp)
+            fclose(fp);
+        fp = NULL;
+    }
+
+private:
+    FILE *fp;
+};
+
+class PSRamFSClass
+{
+public:
+    File open(const String &path, const char *mode)
+    {
+        std::string m = mode;
+        if (m.find('b') == std::string::npos)
+            m += 'b';
+        const char *p = path.c_str();
+        if (*p == '/')
+            p++;
+        return File(fopen(p, m.c_str()));
+    }
+};
+extern PSRamFSClass PSRamFS;
@@ -0,0 +1,25 @@
+#pragma once
+
+// Host stand-in for lib/espRadio/espRadio.h, only the radio profile types are used by deviceRecords
+
+#include <Arduino.h>
+
+#include "espPacket.h"
+
+typedef int wifi_phy_rate_t;
+#define WIFI_PHY_RATE_1M_L  0
+#define ESP_PROTO_DEFAULT   0x0F
+
+struct tRadioProfile
+{
+    uint8_t         protocolMask = ESP_PROTO_DEFAULT;
+    wifi_phy_rate_t rate         = WIFI_PHY_RATE_1M_L;
+    int8_t          txPower      = WIFI_TX_POWER;
+};
+
+inline uint8_t str2protoMask(const char *) { return ESP_PROTO_DEFAULT; }
+inline wifi_phy_rate_t str2phyRate(const char *) { return WIFI_PHY_RATE_1M_L; }
+
+// No arbiter base in the simulated arena, the probe scores for itself
+inline bool espArbiterHeard(void) { return false; }
+inline int32_t espArbiterTake(void) { return 0; }
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// Host stand-in for lib/utils/jsonAlloc.h: the allocators are plain heap ones
+
+#define JSON_ARENA_GAME_API     2048
+#define JSON_ARENA_GAME_PUSH    2048
+#define JSON_ARENA_ROLE         4096
+
+enum tJsonDocKind
+{
+    jdkVal,
+    jdkFileList,
+    jdkManifest,
+    jdkConfig,
+    jdkRole,
+    jdkGameApi,
+    jdkOther,
+    JSON_DOC_KIND_COUNT
+};
+
+class tJsonArenaAllocator : public ArduinoJson::Allocator
+{
+public:
+    tJsonArenaAllocator(tJsonDocKind, size_t) {}
+
+    void reset(void) {}
+
+    void *allocate(size_t size) override { return malloc(size); }
+    void deallocate(void *ptr) override { free(ptr); }
+    void *reallocate(void *ptr, size_t newSize) override { return realloc(ptr, newSize); }
+};
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Host stand-in for lib/utils/logRing.h: warnings and errors go straight to
+// stdout, the rest is dropped so the simulator's own report stays readable
+
+enum tLogModule
+{
+    lmGame,
+    lmRecords,
+    lmRadio,
+    lmNet,
+    lmSync,
+    lmBoard,
+    LOG_MODULE_COUNT
+};
+
+enum tLogLevel
+{
+    llError,
+    llWarn,
+    llInfo,
+    llDebug
+};
+
+#define LOGR(module, level, fmt, ...)   do { if ((level) <= llWarn) printf(fmt, ##__VA_ARGS__); } while (0)
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <Arduino.h>
+
+#define TFT_BLACK   0x0000
+#define TFT_GREEN   0x07E0
+
+inline void tftPrintThreeLines(String, String, String, uint16_t, uint16_t) {}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Host stand-in, the simulator sets the ID of the device it runs deviceRecords for
+namespace ConfigAPI
+{
+    uint16_t getDeviceID();
+}
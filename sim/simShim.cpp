@@ -0,0 +1,39 @@
+#include <Arduino.h>
+
+#include "PSRamFS.h"
+#include "utils.h"
+#include "xgConfig.h"
+
+HardwareSerial Serial;
+EspClass ESP;
+PSRamFSClass PSRamFS;
+
+static uint32_t simMillis = 0;
+static uint16_t simDeviceID = 0;
+
+uint32_t simGetMillis(void)
+{
+    return simMillis;
+}
+
+void simSetMillis(uint32_t ms)
+{
+    simMillis = ms;
+}
+
+void simSetDeviceID(uint16_t id)
+{
+    simDeviceID = id;
+}
+
+String utilsGetDeviceID64Hex(void)
+{
+    char buf[20];
+    snprintf(buf, sizeof(buf), "%016llX", (unsigned long long)simDeviceID);
+    return String(buf);
+}
+
+uint16_t ConfigAPI::getDeviceID()
+{
+    return simDeviceID;
+}
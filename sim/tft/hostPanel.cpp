@@ -0,0 +1,235 @@
+#include "hostPanel.h"
+
+#include "rm67162.h"
+
+#define PANEL_PIXELS    ((uint32_t)X_TFT_WIDTH * X_TFT_HEIGHT)
+
+static uint16_t panel[PANEL_PIXELS];
+static tHostPanelFrame frame;
+// the window of the last lcd_address_set, where a len-only push goes
+static uint16_t winX0, winY0, winX1, winY1;
+static uint32_t winPos;
+
+void hostPanelBeginFrame(void)
+{
+    frame = tHostPanelFrame();
+}
+
+const tHostPanelFrame &hostPanelFrame(void)
+{
+    return frame;
+}
+
+const uint16_t *hostPanelPixels(void)
+{
+    return panel;
+}
+
+static void notePush(uint16_t w, uint16_t h)
+{
+    frame.pushes++;
+    frame.pixels += (uint32_t)w * h;
+    if ((w == X_TFT_WIDTH) && (h == X_TFT_HEIGHT))
+    {
+        frame.fullPushes++;
+    }
+}
+
+// Pixels into the current window, row by row as the panel fills it
+static void writeWindow(const uint16_t *data, uint32_t len)
+{
+    uint16_t w = winX1 - winX0 + 1;
+    uint16_t h = winY1 - winY0 + 1;
+    for (uint32_t i = 0; (i < len) && (winPos < (uint32_t)w * h); i++, winPos++)
+    {
+        uint32_t x = winX0 + winPos % w;
+        uint32_t y = winY0 + winPos / w;
+        if ((x < X_TFT_WIDTH) && (y < X_TFT_HEIGHT))
+        {
+            panel[y * X_TFT_WIDTH + x] = data[i];
+        }
+    }
+}
+
+void rm67162_init(void)
+{
+    memset(panel, 0, sizeof(panel));
+}
+
+void lcd_address_set(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2)
+{
+    winX0 = x1;
+    winY0 = y1;
+    winX1 = x2;
+    winY1 = y2;
+    winPos = 0;
+}
+
+void lcd_setRotation(uint8_t r)
+{
+}
+
+void lcd_DrawPoint(uint16_t x, uint16_t y, uint16_t color)
+{
+    lcd_address_set(x, y, x, y);
+    uint16_t c = (color >> 8) | (color << 8);
+    writeWindow(&c, 1);
+    notePush(1, 1);
+}
+
+void lcd_fill(uint16_t xsta, uint16_t ysta, uint16_t xend, uint16_t yend, uint16_t color)
+{
+    uint16_t c = (color >> 8) | (color << 8);
+    lcd_address_set(xsta, ysta, xend, yend);
+    for (uint32_t i = 0; i < (uint32_t)(xend - xsta + 1) * (yend - ysta + 1); i++)
+    {
+        writeWindow(&c, 1);
+    }
+    notePush(xend - xsta + 1, yend - ysta + 1);
+}
+
+void lcd_PushColors(uint16_t x, uint16_t y, uint16_t width, uint16_t high, uint16_t *data)
+{
+    lcd_address_set(x, y, x + width - 1, y + high - 1);
+    writeWindow(data, (uint32_t)width * high);
+    notePush(width, high);
+}
+
+void lcd_PushColors(uint16_t *data, uint32_t len)
+{
+    writeWindow(data, len);
+    frame.pixels += len;
+}
+
+// The copy is made at once, so the data is free again as soon as this returns
+void lcd_PushColorsAsync(uint16_t x, uint16_t y, uint16_t width, uint16_t high, uint16_t *data)
+{
+    lcd_PushColors(x, y, width, high, data);
+}
+
+void lcd_WaitIdle(void)
+{
+}
+
+void lcd_EnableTE(void)
+{
+}
+
+bool lcd_WaitTE(uint32_t timeoutMs)
+{
+    return true;
+}
+
+void lcd_setBrightness(uint8_t level)
+{
+}
+
+void lcd_setIdleMode(bool on)
+{
+}
+
+void lcd_setPartialMode(uint16_t startRow, uint16_t endRow)
+{
+}
+
+void lcd_setNormalMode(void)
+{
+}
+
+void lcd_sleep()
+{
+}
+
+// PNG with stored (uncompressed) deflate blocks, so no zlib is needed
+
+static uint32_t crc32(uint32_t crc, const uint8_t *p, size_t n)
+{
+    crc = ~crc;
+    while (n--)
+    {
+        crc ^= *p++;
+        for (int k = 0; k < 8; k++)
+        {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+static void put32(std::string &out, uint32_t v)
+{
+    out += (char)(v >> 24);
+    out += (char)(v >> 16);
+    out += (char)(v >> 8);
+    out += (char)v;
+}
+
+static void chunk(FILE *f, const char *type, const std::string &data)
+{
+    std::string c(type, 4);
+    c += data;
+    std::string len;
+    put32(len, data.size());
+    std::string crc;
+    put32(crc, crc32(0, (const uint8_t *)c.data(), c.size()));
+    fwrite(len.data(), 1, 4, f);
+    fwrite(c.data(), 1, c.size(), f);
+    fwrite(crc.data(), 1, 4, f);
+}
+
+bool hostPanelWritePng(const char *path)
+{
+    FILE *f = fopen(path, "wb");
+    if (f == NULL)
+    {
+        return false;
+    }
+    std::string raw;
+    raw.reserve(PANEL_PIXELS * 3 + X_TFT_HEIGHT);
+    for (uint32_t y = 0; y < X_TFT_HEIGHT; y++)
+    {
+        raw += (char)0;     // filter: none
+        for (uint32_t x = 0; x < X_TFT_WIDTH; x++)
+        {
+            uint16_t be = panel[y * X_TFT_WIDTH + x];
+            uint16_t c = (be >> 8) | (be << 8);
+            uint8_t r = (c >> 11) & 0x1F;
+            uint8_t g = (c >> 5) & 0x3F;
+            uint8_t b = c & 0x1F;
+            raw += (char)((r << 3) | (r >> 2));
+            raw += (char)((g << 2) | (g >> 4));
+            raw += (char)((b << 3) | (b >> 2));
+        }
+    }
+
+    std::string z("\x78\x01", 2);
+    for (size_t at = 0; at < raw.size(); at += 0xFFFF)
+    {
+        uint16_t n = min((size_t)0xFFFF, raw.size() - at);
+        z += (char)((at + n == raw.size()) ? 1 : 0);
+        z += (char)n;
+        z += (char)(n >> 8);
+        z += (char)~n;
+        z += (char)(~n >> 8);
+        z.append(raw, at, n);
+    }
+    uint32_t a = 1, b = 0;
+    for (unsigned char c : raw)
+    {
+        a = (a + c) % 65521;
+        b = (b + a) % 65521;
+    }
+    put32(z, (b << 16) | a);
+
+    std::string ihdr;
+    put32(ihdr, X_TFT_WIDTH);
+    put32(ihdr, X_TFT_HEIGHT);
+    ihdr += std::string("\x08\x02\x00\x00\x00", 5);    // 8-bit RGB
+    fwrite("\x89PNG\r\n\x1a\n", 1, 8, f);
+    chunk(f, "IHDR", ihdr);
+    chunk(f, "IDAT", z);
+    chunk(f, "IEND", "");
+    bool ok = ferror(f) == 0;
+    fclose(f);
+    return ok;
+}
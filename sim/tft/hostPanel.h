@@ -0,0 +1,23 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Memory panel behind the rm67162.h interface for the native_tft build: the
+// pushes land in an X_TFT_WIDTH x X_TFT_HEIGHT framebuffer in panel byte
+// order, and are counted per frame so a change that makes a screen update
+// push more than it needs shows in the numbers.
+
+struct tHostPanelFrame
+{
+    uint32_t pushes = 0;        // windows sent
+    uint32_t fullPushes = 0;    // of those, the whole panel
+    uint64_t pixels = 0;
+};
+
+// Starts counting a new frame
+void hostPanelBeginFrame(void);
+const tHostPanelFrame &hostPanelFrame(void);
+// Big-endian RGB565, what the panel shows
+const uint16_t *hostPanelPixels(void);
+// The panel as an 8-bit RGB PNG, false when the file cannot be written
+bool hostPanelWritePng(const char *path);
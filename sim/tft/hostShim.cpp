@@ -0,0 +1,101 @@
+// Globals and platform calls the tft_utils sources take from the device
+
+#include <Arduino.h>
+#include <chrono>
+
+#include "PSRamFS.h"
+#include "assetPack.h"
+#include "esp_timer.h"
+#include "serverSync.h"
+
+HardwareSerial Serial;
+PSRamFSClass PSRamFS;
+
+static const auto startTime = std::chrono::steady_clock::now();
+
+int64_t esp_timer_get_time(void)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+uint32_t simGetMillis(void)
+{
+    return esp_timer_get_time() / 1000;
+}
+
+bool ensureFileInPsram(const char *filename)
+{
+    return PSRamFS.exists(filename);
+}
+
+// The asset image the file server builds (ASSET_PACK_FILE), read into memory
+// in place of the mapped partition when the simulator is given one
+
+static std::string pack;
+static const tAssetPackEntry *packEntries = NULL;
+static uint16_t packCount = 0;
+
+static uint32_t nameHash(const char *name)
+{
+    if (*name == '/')
+    {
+        name++;
+    }
+    uint32_t h = 0x811C9DC5;
+    while (*name)
+    {
+        h = (h ^ (uint8_t)*name++) * 0x01000193;
+    }
+    return h;
+}
+
+bool hostAssetPackLoad(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (f == NULL)
+    {
+        return false;
+    }
+    char buf[4096];
+    size_t n;
+    pack.clear();
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+    {
+        pack.append(buf, n);
+    }
+    fclose(f);
+    const tAssetPackHeader *hdr = (const tAssetPackHeader *)pack.data();
+    if ((pack.size() < sizeof(*hdr)) || (hdr->magic != ASSET_PACK_MAGIC) || (hdr->version != ASSET_PACK_VERSION) ||
+        (sizeof(*hdr) + hdr->count * sizeof(tAssetPackEntry) > pack.size()))
+    {
+        pack.clear();
+        return false;
+    }
+    packEntries = (const tAssetPackEntry *)(pack.data() + sizeof(*hdr));
+    packCount = hdr->count;
+    return true;
+}
+
+bool assetPackMounted(void)
+{
+    return packCount > 0;
+}
+
+bool assetPackFind(const char *name, const uint8_t **data, size_t *size, tAssetFormat *format)
+{
+    uint32_t h = nameHash(name);
+    for (uint16_t i = 0; i < packCount; i++)
+    {
+        if ((packEntries[i].nameHash == h) && (packEntries[i].offset + packEntries[i].size <= pack.size()))
+        {
+            *data = (const uint8_t *)pack.data() + packEntries[i].offset;
+            *size = packEntries[i].size;
+            if (format)
+            {
+                *format = (tAssetFormat)packEntries[i].format;
+            }
+            return true;
+        }
+    }
+    return false;
+}
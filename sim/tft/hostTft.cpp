@@ -0,0 +1,200 @@
+// TFT_eSprite of shim/TFT_eSPI.h, drawing as the library does into memory
+
+#include <TFT_eSPI.h>
+
+#include "glcdfont.c"
+
+// Colours 0-9 follow the resistor colour code, as the library's
+static const uint16_t defaultPalette[16] = {
+    TFT_BLACK, TFT_BROWN, TFT_RED, TFT_ORANGE, TFT_YELLOW, TFT_GREEN, TFT_BLUE, TFT_PURPLE,
+    TFT_DARKGREY, TFT_WHITE, TFT_CYAN, TFT_MAGENTA, TFT_MAROON, TFT_DARKGREEN, TFT_NAVY, TFT_PINK};
+
+static inline uint8_t rgb332(uint32_t c)
+{
+    return (uint8_t)((c & 0xE000) >> 8 | (c & 0x0700) >> 6 | (c & 0x0018) >> 3);
+}
+
+void *TFT_eSprite::createSprite(int16_t w, int16_t h, uint8_t frames)
+{
+    if (_created)
+        return _img8_1;
+    if ((w < 1) || (h < 1))
+        return NULL;
+    frames = constrain(frames, 1, 2);
+    _dwidth = _iwidth = w;
+    _dheight = h;
+    size_t bytes;
+    if (_bpp == 16)
+        bytes = ((size_t)w * h + 1) * 2;
+    else if (_bpp == 8)
+        bytes = (size_t)w * h + 1;
+    else
+    {
+        _iwidth = (w + 1) & ~1;
+        bytes = (size_t)_iwidth * h / 2 + 1;
+    }
+    // one "off screen" pixel past each frame, as the library allocates
+    _img8_1 = (uint8_t *)calloc(frames, bytes);
+    if (_img8_1 == NULL)
+        return NULL;
+    _img8 = _img8_2 = _img8_1;
+    if (frames > 1)
+        _img8_2 = _img8_1 + bytes - 1;
+    if ((_bpp == 4) && (_colorMap == NULL))
+    {
+        _colorMap = (uint16_t *)malloc(sizeof(defaultPalette));
+        memcpy(_colorMap, defaultPalette, sizeof(defaultPalette));
+    }
+    _created = true;
+    return _img8_1;
+}
+
+void TFT_eSprite::deleteSprite(void)
+{
+    free(_colorMap);
+    _colorMap = NULL;
+    if (_created)
+        free(_img8_1);
+    _img8 = _img8_1 = _img8_2 = NULL;
+    _created = false;
+}
+
+void *TFT_eSprite::frameBuffer(int8_t f)
+{
+    if (!_created)
+        return NULL;
+    _img8 = (f == 2) ? _img8_2 : _img8_1;
+    return _img8;
+}
+
+void *TFT_eSprite::setColorDepth(int8_t b)
+{
+    if (_bpp == b)
+        return _img8_1;
+    _bpp = (b > 8) ? 16 : (b > 4) ? 8 : 4;
+    if (!_created)
+        return NULL;
+    free(_img8_1);
+    _created = false;
+    return createSprite(_dwidth, _dheight);
+}
+
+void TFT_eSprite::setPaletteColor(uint8_t index, uint16_t color)
+{
+    if ((_colorMap != NULL) && (index < 16))
+        _colorMap[index] = color;
+}
+
+uint16_t TFT_eSprite::getPaletteColor(uint8_t index)
+{
+    return ((_colorMap != NULL) && (index < 16)) ? _colorMap[index] : 0;
+}
+
+void TFT_eSprite::drawPixel(int32_t x, int32_t y, uint32_t color)
+{
+    if (!_created || (x < 0) || (y < 0) || (x >= _dwidth) || (y >= _dheight))
+        return;
+    int32_t i = x + y * _iwidth;
+    if (_bpp == 16)
+        ((uint16_t *)_img8)[i] = (uint16_t)((color >> 8) | (color << 8));
+    else if (_bpp == 8)
+        _img8[i] = rgb332(color);
+    else
+    {
+        uint8_t c = color & 0x0F;
+        uint8_t &b = _img8[i >> 1];
+        b = (x & 1) ? ((b & 0xF0) | c) : ((b & 0x0F) | (c << 4));
+    }
+}
+
+uint16_t TFT_eSprite::readPixel(int32_t x, int32_t y)
+{
+    if (!_created || (x < 0) || (y < 0) || (x >= _dwidth) || (y >= _dheight))
+        return 0xFFFF;
+    int32_t i = x + y * _iwidth;
+    if (_bpp == 16)
+    {
+        uint16_t c = ((uint16_t *)_img8)[i];
+        return (c >> 8) | (c << 8);
+    }
+    if (_bpp == 4)
+        return getPaletteColor((x & 1) ? (_img8[i >> 1] & 0x0F) : (_img8[i >> 1] >> 4));
+    static const uint8_t blue[] = {0, 11, 21, 31};
+    uint8_t c = _img8[i];
+    return c ? ((c & 0xE0) << 8 | (c & 0xC0) << 5 | (c & 0x1C) << 6 | (c & 0x1C) << 3 | blue[c & 0x03]) : 0;
+}
+
+void TFT_eSprite::fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color)
+{
+    int32_t x1 = min((int32_t)_dwidth, x + w);
+    int32_t y1 = min((int32_t)_dheight, y + h);
+    for (int32_t yy = max((int32_t)0, y); yy < y1; yy++)
+        for (int32_t xx = max((int32_t)0, x); xx < x1; xx++)
+            drawPixel(xx, yy, color);
+}
+
+void TFT_eSprite::pushImage(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t *data, uint8_t sbpp)
+{
+    if ((data == NULL) || !_created)
+        return;
+    for (int32_t r = 0; r < h; r++)
+    {
+        for (int32_t c = 0; c < w; c++)
+        {
+            int32_t xx = x + c;
+            int32_t yy = y + r;
+            if ((xx < 0) || (yy < 0) || (xx >= _dwidth) || (yy >= _dheight))
+                continue;
+            uint16_t px = data[r * w + c];
+            int32_t i = xx + yy * _iwidth;
+            if (_bpp == 16)
+                // the sprite holds swapped bytes, pushImage copies as is unless told to swap
+                ((uint16_t *)_img8)[i] = _swapBytes ? (uint16_t)((px >> 8) | (px << 8)) : px;
+            else if (_bpp == 8)
+                _img8[i] = _swapBytes ? (uint8_t)((px & 0xE000) >> 8 | (px & 0x0700) >> 6 | (px & 0x0018) >> 3)
+                                      : (uint8_t)((px & 0xE0) | (px & 0x07) << 2 | (px & 0x1800) >> 11);
+            else
+                drawPixel(xx, yy, px);
+        }
+    }
+}
+
+void TFT_eSprite::drawChar(int32_t x, int32_t y, uint16_t c, uint32_t color, uint32_t bg, uint8_t size)
+{
+    if ((c < 32) || (c > 255))
+        return;
+    bool fillbg = (bg != color);
+    for (int8_t i = 0; i < 6; i++)
+    {
+        uint8_t line = (i == 5) ? 0 : pgm_read_byte(font + c * 5 + i);
+        for (int8_t j = 0; j < 8; j++, line >>= 1)
+        {
+            if (line & 0x1)
+                fillRect(x + i * size, y + j * size, size, size, color);
+            else if (fillbg)
+                fillRect(x + i * size, y + j * size, size, size, bg);
+        }
+    }
+}
+
+int16_t TFT_eSprite::drawString(const char *string, int32_t x, int32_t y, uint8_t font)
+{
+    int16_t cwidth = 6 * textsize * strlen(string);
+    int16_t cheight = 8 * textsize;
+    switch (textdatum)
+    {
+    case TC_DATUM: x -= cwidth / 2; break;
+    case TR_DATUM: x -= cwidth; break;
+    case ML_DATUM: y -= cheight / 2; break;
+    case MC_DATUM: x -= cwidth / 2; y -= cheight / 2; break;
+    case MR_DATUM: x -= cwidth; y -= cheight / 2; break;
+    case BL_DATUM: y -= cheight; break;
+    case BC_DATUM: x -= cwidth / 2; y -= cheight; break;
+    case BR_DATUM: x -= cwidth; y -= cheight; break;
+    }
+    for (const char *p = string; *p; p++, x += 6 * textsize)
+    {
+        drawChar(x, y, (uint8_t)*p, textcolor, textbgcolor, textsize);
+    }
+    return cwidth;
+}
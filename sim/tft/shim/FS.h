@@ -0,0 +1,46 @@
+#pragma once
+
+// Host stand-in for the Arduino FS file, a stdio file
+
+#include <Arduino.h>
+
+namespace fs
+{
+
+class File
+{
+public:
+    File(FILE *f = NULL, const char *path = "") : fp(f), path(path) {}
+    operator bool(void) const { return fp != NULL; }
+    int read(void) { return fp ? fgetc(fp) : -1; }
+    size_t read(uint8_t *buf, size_t size) { return fp ? fread(buf, 1, size, fp) : 0; }
+    size_t write(const uint8_t *buf, size_t size) { return fp ? fwrite(buf, 1, size, fp) : 0; }
+    bool seek(uint32_t pos) { return fp && (fseek(fp, pos, SEEK_SET) == 0); }
+    size_t position(void) { return fp ? ftell(fp) : 0; }
+    size_t size(void)
+    {
+        if (!fp)
+            return 0;
+        long at = ftell(fp);
+        fseek(fp, 0, SEEK_END);
+        long end = ftell(fp);
+        fseek(fp, at, SEEK_SET);
+        return end;
+    }
+    int available(void) { return size() - position(); }
+    const char *name(void) const { return path.c_str(); }
+    void close(void)
+    {
+        if (fp)
+            fclose(fp);
+        fp = NULL;
+    }
+
+private:
+    FILE *fp;
+    std::string path;
+};
+
+} // namespace fs
+
+using fs::File;
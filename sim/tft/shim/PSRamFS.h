@@ -0,0 +1,35 @@
+#pragma once
+
+// Host stand-in for PSRamFS: "/name" is looked up in the directory set with
+// setRoot(), the sync files by default
+
+#include "FS.h"
+
+class PSRamFSClass
+{
+public:
+    void setRoot(const char *dir) { root = dir; }
+    std::string path(const String &name) const
+    {
+        const char *p = name.c_str();
+        return root + ((*p == '/') ? "" : "/") + p;
+    }
+    bool exists(const String &name) const
+    {
+        FILE *f = fopen(path(name).c_str(), "rb");
+        if (f)
+            fclose(f);
+        return f != NULL;
+    }
+    fs::File open(const String &name, const char *mode)
+    {
+        std::string m = mode;
+        if (m.find('b') == std::string::npos)
+            m += 'b';
+        return fs::File(fopen(path(name).c_str(), m.c_str()), name.c_str());
+    }
+
+private:
+    std::string root = "servers/SingleSystemServer/sync_files";
+};
+extern PSRamFSClass PSRamFS;
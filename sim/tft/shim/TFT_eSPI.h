@@ -0,0 +1,124 @@
+#pragma once
+
+// Host stand-in for the TFT_eSPI sprite interface used by lib/tft_utils, only
+// meant for the native_tft build (see sim/tft/tftSim.cpp). Sprites keep the
+// memory layout of the library: 16-bit pixels byte swapped, 8-bit RGB332,
+// 4-bit palette indices two a byte with rows padded to even pixels. Text is
+// the built-in 5x7 font (font 1) at any text size, other fonts are drawn
+// with it as well.
+
+#include <Arduino.h>
+
+#define PROGMEM
+#define pgm_read_byte(addr)     (*(const uint8_t *)(addr))
+
+#define TFT_BLACK       0x0000
+#define TFT_NAVY        0x000F
+#define TFT_DARKGREEN   0x03E0
+#define TFT_DARKCYAN    0x03EF
+#define TFT_MAROON      0x7800
+#define TFT_PURPLE      0x780F
+#define TFT_OLIVE       0x7BE0
+#define TFT_LIGHTGREY   0xD69A
+#define TFT_DARKGREY    0x7BEF
+#define TFT_BLUE        0x001F
+#define TFT_GREEN       0x07E0
+#define TFT_CYAN        0x07FF
+#define TFT_RED         0xF800
+#define TFT_MAGENTA     0xF81F
+#define TFT_YELLOW      0xFFE0
+#define TFT_WHITE       0xFFFF
+#define TFT_ORANGE      0xFDA0
+#define TFT_GREENYELLOW 0xB7E0
+#define TFT_PINK        0xFE19
+#define TFT_BROWN       0x9A60
+#define TFT_GOLD        0xFEA0
+#define TFT_SILVER      0xC618
+#define TFT_SKYBLUE     0x867D
+#define TFT_VIOLET      0x915C
+
+#define TL_DATUM 0
+#define TC_DATUM 1
+#define TR_DATUM 2
+#define ML_DATUM 3
+#define CL_DATUM 3
+#define MC_DATUM 4
+#define CC_DATUM 4
+#define MR_DATUM 5
+#define CR_DATUM 5
+#define BL_DATUM 6
+#define BC_DATUM 7
+#define BR_DATUM 8
+
+class TFT_eSPI
+{
+public:
+    TFT_eSPI(int16_t w = X_TFT_WIDTH, int16_t h = X_TFT_HEIGHT) : _width(w), _height(h) {}
+    virtual ~TFT_eSPI() {}
+
+    void setTextColor(uint16_t c) { textcolor = textbgcolor = c; }
+    void setTextColor(uint16_t c, uint16_t b, bool = false) { textcolor = c; textbgcolor = b; }
+    void setTextSize(uint8_t s) { textsize = (s > 0) ? s : 1; }
+    void setTextDatum(uint8_t d) { textdatum = d; }
+    uint8_t getTextDatum(void) { return textdatum; }
+    void setSwapBytes(bool swap) { _swapBytes = swap; }
+    bool getSwapBytes(void) { return _swapBytes; }
+    int16_t textWidth(const String &s, uint8_t font = 1) { return 6 * textsize * s.length(); }
+    int16_t fontHeight(uint8_t font = 1) { return 8 * textsize; }
+    virtual int16_t width(void) { return _width; }
+    virtual int16_t height(void) { return _height; }
+
+protected:
+    int16_t _width;
+    int16_t _height;
+    uint16_t textcolor = TFT_WHITE;
+    uint16_t textbgcolor = TFT_WHITE;
+    uint8_t textsize = 1;
+    uint8_t textdatum = TL_DATUM;
+    bool _swapBytes = false;
+};
+
+class TFT_eSprite : public TFT_eSPI
+{
+public:
+    explicit TFT_eSprite(TFT_eSPI *tft) : _tft(tft) {}
+    ~TFT_eSprite() { deleteSprite(); }
+
+    void *createSprite(int16_t w, int16_t h, uint8_t frames = 1);
+    void deleteSprite(void);
+    bool created(void) { return _created; }
+    void *getPointer(void) { return _created ? _img8_1 : NULL; }
+    void *frameBuffer(int8_t f);
+    void *setColorDepth(int8_t b);
+    int8_t getColorDepth(void) { return _created ? _bpp : 0; }
+    int16_t width(void) override { return _dwidth; }
+    int16_t height(void) override { return _dheight; }
+
+    void setPaletteColor(uint8_t index, uint16_t color);
+    uint16_t getPaletteColor(uint8_t index);
+
+    void fillSprite(uint32_t color) { fillRect(0, 0, _dwidth, _dheight, color); }
+    void fillScreen(uint32_t color) { fillSprite(color); }
+    void fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color);
+    void drawPixel(int32_t x, int32_t y, uint32_t color);
+    uint16_t readPixel(int32_t x, int32_t y);
+    void pushImage(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t *data, uint8_t sbpp = 0);
+    void drawChar(int32_t x, int32_t y, uint16_t c, uint32_t color, uint32_t bg, uint8_t size);
+    int16_t drawString(const char *string, int32_t x, int32_t y, uint8_t font = 1);
+    int16_t drawString(const String &string, int32_t x, int32_t y, uint8_t font = 1)
+    {
+        return drawString(string.c_str(), x, y, font);
+    }
+
+protected:
+    TFT_eSPI *_tft;
+    bool _created = false;
+    uint8_t _bpp = 16;
+    int16_t _iwidth = 0;        // row stride in pixels, even for 4 bit
+    int16_t _dwidth = 0;
+    int16_t _dheight = 0;
+    uint8_t *_img8 = NULL;      // the frame drawn into
+    uint8_t *_img8_1 = NULL;
+    uint8_t *_img8_2 = NULL;    // tftFrame.cpp points this one at its back buffer
+    uint16_t *_colorMap = NULL;
+};
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <stdlib.h>
+
+#define MALLOC_CAP_DMA          (1 << 3)
+#define MALLOC_CAP_SPIRAM       (1 << 10)
+#define MALLOC_CAP_INTERNAL     (1 << 11)
+#define MALLOC_CAP_8BIT         (1 << 2)
+
+inline void *heap_caps_malloc(size_t size, uint32_t) { return malloc(size); }
+inline void *heap_caps_realloc(void *p, size_t size, uint32_t) { return realloc(p, size); }
+inline void *heap_caps_aligned_alloc(size_t align, size_t size, uint32_t)
+{
+    return aligned_alloc(align, (size + align - 1) / align * align);
+}
+inline void heap_caps_free(void *p) { free(p); }
@@ -0,0 +1,11 @@
+#pragma once
+
+// Host stand-in, the native_tft build runs on one thread
+
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+#define portMAX_DELAY           0xFFFFFFFF
+#define pdTRUE                  1
+#define pdMS_TO_TICKS(ms)       (ms)
+inline void vTaskDelay(TickType_t) {}
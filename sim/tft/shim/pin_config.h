@@ -0,0 +1,3 @@
+#pragma once
+
+// rm67162.h wants the panel pins, the host panel has none
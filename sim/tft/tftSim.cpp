@@ -0,0 +1,205 @@
+// Host render of the tft_utils screens for the native_tft PlatformIO env
+// (pio run -e native_tft).
+//
+// gameScreen.cpp, tftBmp.cpp, tftPictures.cpp and the compositor, frame and
+// palette code they push through run as on the device, against host sprites
+// (shim/TFT_eSPI.h) and a memory panel behind rm67162.h (hostPanel.h). Each
+// frame is dumped as a PNG and its pushes counted, and the run fails when a
+// game screen update pushes more than the text that changed, the regression
+// where a small change turns every tick into a full-frame push. Usage:
+//
+//   .pio/build/native_tft/program out=tft_frames ticks=20 png=1
+//       [files=servers/SingleSystemServer/sync_files] [pack=.asset_pack.bin]
+//
+// files= is the directory standing in for PSRamFS, pack= an asset image built
+// by the file server to draw the pictures from as from the mapped partition.
+
+#include <Arduino.h>
+#include <sys/stat.h>
+#include <chrono>
+
+#include "PSRamFS.h"
+#include "hostPanel.h"
+#include "rm67162.h"
+#include "tftFrame.h"
+#include "tft_utils.h"
+
+#define SIM_FILES_DIR           "servers/SingleSystemServer/sync_files"
+// The text sprites of gameScreen.cpp right of the icon: value, delta, timer
+#define SIM_TEXT_W              (X_TFT_WIDTH - 50 - 160)
+#define SIM_STR1_H              100
+#define SIM_STR2_H              90
+#define SIM_SEC_H               60
+
+TFT_eSPI tft = TFT_eSPI();
+TFT_eSprite spr = TFT_eSprite(&tft);
+
+bool hostAssetPackLoad(const char *path);
+
+struct tSimTotals
+{
+    uint32_t frames = 0;
+    uint32_t failed = 0;
+    uint32_t fullPushes = 0;
+    uint64_t pixels = 0;
+};
+
+static tSimTotals totals;
+static String outDir;
+static bool writePng = true;
+
+static String argValue(int argc, char **argv, const char *key, const char *def)
+{
+    size_t keyLen = strlen(key);
+    for (int i = 1; i < argc; i++)
+    {
+        if ((strncmp(argv[i], key, keyLen) == 0) && (argv[i][keyLen] == '='))
+        {
+            return String(argv[i] + keyLen + 1);
+        }
+    }
+    return String(def);
+}
+
+// One frame: what draw() pushed against the pixel budget, 0 for no check
+static void frame(const char *name, uint64_t maxPixels, bool fullAllowed, void (*draw)(void *), void *ctx)
+{
+    hostPanelBeginFrame();
+    auto t0 = std::chrono::steady_clock::now();
+    draw(ctx);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    const tHostPanelFrame &f = hostPanelFrame();
+
+    const char *verdict = "";
+    if (!fullAllowed && f.fullPushes)
+    {
+        verdict = "  !!! full-frame push";
+    }
+    else if (maxPixels && (f.pixels > maxPixels))
+    {
+        verdict = "  !!! over budget";
+    }
+    if (*verdict)
+    {
+        totals.failed++;
+    }
+    Serial.printf("%03lu %-22s pushes %3lu full %lu pixels %7llu (%5.1f%%) %6.2f ms%s\r\n",
+                  (unsigned long)totals.frames, name, (unsigned long)f.pushes, (unsigned long)f.fullPushes,
+                  (unsigned long long)f.pixels, 100.0 * f.pixels / ((uint32_t)X_TFT_WIDTH * X_TFT_HEIGHT), ms, verdict);
+
+    if (writePng)
+    {
+        char path[256];
+        snprintf(path, sizeof(path), "%s/%03lu_%s.png", outDir.c_str(), (unsigned long)totals.frames, name);
+        if (!hostPanelWritePng(path))
+        {
+            Serial.printf("!!! frame ERROR: cannot write <%s>\r\n", path);
+        }
+    }
+    totals.frames++;
+    totals.fullPushes += f.fullPushes;
+    totals.pixels += f.pixels;
+}
+
+static void drawPicture(void *ctx)
+{
+    ((void (*)(void))ctx)();
+}
+
+struct tSimTick
+{
+    void (*screen)(int32_t, int32_t, uint32_t);
+    int32_t topVal;
+    int32_t botVal;
+    uint32_t secLeft;
+};
+
+static void drawGame(void *ctx)
+{
+    tSimTick *t = (tSimTick *)ctx;
+    t->screen(t->topVal, t->botVal, t->secLeft);
+}
+
+// A role's game screen: the first frame brings the icon, each tick after it
+// counts the timer down and now and then moves the value and its delta; a
+// tick may push only the text sprites whose string changed
+static void gameScreen(const char *role, void (*screen)(int32_t, int32_t, uint32_t), int ticks)
+{
+    tSimTick t = {screen, 9000, 0, 300};
+    char name[32];
+    snprintf(name, sizeof(name), "%s_enter", role);
+    frame(name, 0, true, drawGame, &t);
+    snprintf(name, sizeof(name), "%s_same", role);
+    frame(name, 1, false, drawGame, &t);
+    for (int i = 1; i <= ticks; i++)
+    {
+        uint64_t budget = (uint64_t)SIM_TEXT_W * SIM_SEC_H;
+        t.secLeft--;
+        if (i % 5 == 0)
+        {
+            t.topVal -= 37;
+            budget += (uint64_t)SIM_TEXT_W * SIM_STR1_H;
+        }
+        if (i % 3 == 0)
+        {
+            t.botVal = (i % 2) ? -i : i;
+            budget += (uint64_t)SIM_TEXT_W * SIM_STR2_H;
+        }
+        snprintf(name, sizeof(name), "%s_tick%02d", role, i);
+        frame(name, budget, false, drawGame, &t);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    outDir = argValue(argc, argv, "out", "tft_frames");
+    writePng = argValue(argc, argv, "png", "1").toInt() != 0;
+    int ticks = argValue(argc, argv, "ticks", "20").toInt();
+    PSRamFS.setRoot(argValue(argc, argv, "files", SIM_FILES_DIR).c_str());
+    String packPath = argValue(argc, argv, "pack", "");
+    if ((packPath.length() > 0) && !hostAssetPackLoad(packPath.c_str()))
+    {
+        Serial.printf("!!! main ERROR: <%s> is not an asset image\r\n", packPath.c_str());
+        return 1;
+    }
+    if (writePng)
+    {
+        mkdir(outDir.c_str(), 0755);
+    }
+
+    // as tftSprite.cpp sets it up
+    rm67162_init();
+    spr.createSprite(X_TFT_WIDTH, X_TFT_HEIGHT);
+    spr.setSwapBytes(1);
+    tftFrameInit();
+    spr.fillSprite(TFT_BLACK);
+
+    // twice, the second time from the image cache as far as its budget keeps them
+    for (int pass = 0; pass < 2; pass++)
+    {
+        static const struct
+        {
+            const char *name;
+            void (*draw)(void);
+        } pictures[] = {
+            {"logo", bazaLogo}, {"wait", gameWaitLogo}, {"pre_zombie", zombiPreWaitPicture},
+            {"pre_human", humanPreWaitPicture}, {"pre_base", basePreWaitPicture}, {"game_over", gameOverPicture},
+            {"human_win", humanWinPicture}, {"zombie_win", zombieWinPicture}, {"draw", drawPicture},
+        };
+        for (auto &p : pictures)
+        {
+            char name[32];
+            snprintf(name, sizeof(name), "%s%s", p.name, pass ? "_again" : "");
+            frame(name, 0, true, drawPicture, (void *)p.draw);
+        }
+    }
+
+    gameScreen("base", tftGameScreenBase, ticks);
+    gameScreen("human", tftGameScreenHuman, ticks);
+    gameScreen("zombie", tftGameScreenZombie, ticks);
+
+    Serial.printf("{\"frames\":%lu,\"failed\":%lu,\"full_pushes\":%lu,\"pixels\":%llu,\"double_buffered\":%s}\r\n",
+                  (unsigned long)totals.frames, (unsigned long)totals.failed, (unsigned long)totals.fullPushes,
+                  (unsigned long long)totals.pixels, tftFrameDoubleBuffered() ? "true" : "false");
+    return totals.failed ? 1 : 0;
+}
@@ -0,0 +1,389 @@
+// Offline arena simulator for the native PlatformIO env (pio run -e native).
+//
+// Virtual players walk random waypoints through a 2-D arena and beacon every
+// BEACON_INTERVAL_MS. RSSI follows a log-distance path loss model with shadowing.
+// Device 0 (the probe) runs the real deviceRecords/rssiFilter stack on a virtual
+// clock, so table scaling, eviction and damage integration are exercised as on the
+// device. The other players use a lightweight zone model with the same role files
+// to keep the world moving. Usage:
+//
+//   .pio/build/native/program players=200 zombies=20 bases=2 seconds=300 arena=100 seed=1
+//
+// Role files are read from servers/SingleSystemServer/sync_files unless hfile=, zfile=, bfile= are given.
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <math.h>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "PSRamFS.h"
+#include "deviceRecords.h"
+
+#define SIM_STEP_MS             1
+#define SIM_SNAPSHOT_MS         100     // radio task snapshot period
+#define SIM_MOVE_MS             100
+#define SIM_REPORT_MS           10000
+#define SIM_RSSI_AT_1M          -40.0f
+#define SIM_PATH_LOSS_EXP       2.7f
+#define SIM_SHADOWING_DB        4.0f
+#define SIM_SENSITIVITY_DBM     -98.0f
+#define SIM_FRAME_LOSS_PCT      5
+#define SIM_SPEED_MIN_MPS       0.5f
+#define SIM_SPEED_MAX_MPS       2.0f
+#define SIM_PROBE_ID            1
+#define SIM_ROLE_DIR            "servers/SingleSystemServer/sync_files"
+
+void simSetDeviceID(uint16_t id);
+
+struct tSimRoleCfg
+{
+    String fileName;
+    int hitPointsNear = 0;
+    int hitPointsMiddle = 0;
+    int hitPointsFar = 0;
+    int rssiFar = GAME_START_FAR_RSSI;
+    int rssiMiddle = GAME_START_MIDDL_RSSI;
+    int rssiClose = GAME_START_CLOSE_RSSI;
+    int health = 0;
+    int maxHealth = 0;
+};
+
+struct tSimDevice
+{
+    uint16_t  id;
+    tGameRole role;
+    float     x, y;
+    float     wx, wy;           // current waypoint
+    float     speed;            // m/s
+    float     health;
+    uint32_t  nextBeaconMs;
+    uint16_t  seq = 0;          // frame sequence, what the probe's link estimate counts
+};
+
+struct tSimStats
+{
+    uint64_t framesSent = 0;
+    uint64_t framesHeard = 0;
+    uint32_t probeFlips = 0;
+    uint32_t worldFlips = 0;
+    uint16_t maxLive = 0;
+    double   addNs = 0;
+    double   snapshotNs = 0;
+    double   scanNs = 0;
+    uint64_t snapshots = 0;
+    uint64_t scans = 0;
+};
+
+static std::mt19937 rng;
+static tSimRoleCfg roleCfg[4];
+static std::vector<tSimDevice> devices;
+static tSimStats stats;
+
+static float randf(float lo, float hi)
+{
+    return std::uniform_real_distribution<float>(lo, hi)(rng);
+}
+
+static bool loadRoleCfg(tGameRole role, String fName)
+{
+    File file = PSRamFS.open(fName, "r");
+    if (!file)
+    {
+        Serial.printf("!!! loadRoleCfg ERROR: failed to open [%s]\r\n", fName.c_str());
+        return false;
+    }
+    String jsonS = file.readString();
+    file.close();
+
+    JsonDocument doc;
+    DeserializationError error = deserializeJson(doc, jsonS);
+    if (error)
+    {
+        Serial.printf("!!! loadRoleCfg ERROR: [%s] %s\r\n", fName.c_str(), error.c_str());
+        return false;
+    }
+    tSimRoleCfg &cfg = roleCfg[role];
+    cfg.fileName = fName;
+    cfg.hitPointsNear = doc["hitPointsNear"] | 0;
+    cfg.hitPointsMiddle = doc["hitPointsMiddle"] | 0;
+    cfg.hitPointsFar = doc["hitPointsFar"] | 0;
+    cfg.rssiFar = doc["rssiFar"] | GAME_START_FAR_RSSI;
+    cfg.rssiMiddle = doc["rssiMiddle"] | GAME_START_MIDDL_RSSI;
+    cfg.rssiClose = doc["rssiClose"] | GAME_START_CLOSE_RSSI;
+    cfg.health = doc["health"] | 0;
+    cfg.maxHealth = doc["maxHealth"] | 0;
+    return true;
+}
+
+static float pathLossRssi(const tSimDevice &a, const tSimDevice &b)
+{
+    float d = hypotf(a.x - b.x, a.y - b.y);
+    if (d < 0.5f)
+    {
+        d = 0.5f;
+    }
+    float shadow = std::normal_distribution<float>(0.0f, SIM_SHADOWING_DB)(rng);
+    return SIM_RSSI_AT_1M - 10.0f * SIM_PATH_LOSS_EXP * log10f(d) + shadow;
+}
+
+static int zonePoints(const tSimRoleCfg &rx, const tSimRoleCfg &tx, float rssi)
+{
+    if (rssi > rx.rssiClose)
+        return tx.hitPointsNear;
+    if (rssi > rx.rssiMiddle)
+        return tx.hitPointsMiddle;
+    if (rssi >= rx.rssiFar)
+        return tx.hitPointsFar;
+    return 0;
+}
+
+static void moveDevices(float dtS, float arena)
+{
+    for (tSimDevice &dev : devices)
+    {
+        if (dev.role == grBase)
+        {
+            continue;
+        }
+        float dx = dev.wx - dev.x;
+        float dy = dev.wy - dev.y;
+        float dist = hypotf(dx, dy);
+        float step = dev.speed * dtS;
+        if (dist <= step)
+        {
+            dev.x = dev.wx;
+            dev.y = dev.wy;
+            dev.wx = randf(0, arena);
+            dev.wy = randf(0, arena);
+            dev.speed = randf(SIM_SPEED_MIN_MPS, SIM_SPEED_MAX_MPS);
+            continue;
+        }
+        dev.x += dx / dist * step;
+        dev.y += dy / dist * step;
+    }
+}
+
+// Zone model for everybody except the probe, zone points are per game loop interval
+static void worldDamageTick(uint32_t tickMs)
+{
+    float scale = (float)tickMs / GAME_START_LOOP_INT_MS;
+    for (size_t i = 1; i < devices.size(); i++)
+    {
+        tSimDevice &rx = devices[i];
+        if ((rx.role != grZombie) && (rx.role != grHuman))
+        {
+            continue;
+        }
+        float delta = 0;
+        for (size_t j = 0; j < devices.size(); j++)
+        {
+            const tSimDevice &tx = devices[j];
+            if ((i == j) || ((tx.role != grBase) && (tx.role == rx.role)))
+            {
+                continue;
+            }
+            delta += zonePoints(roleCfg[rx.role], roleCfg[tx.role], pathLossRssi(rx, tx)) * scale;
+        }
+        rx.health += delta;
+        if (rx.health > roleCfg[rx.role].maxHealth)
+        {
+            rx.health = roleCfg[rx.role].maxHealth;
+        }
+        if (rx.health < 0)
+        {
+            rx.role = (rx.role == grZombie) ? grHuman : grZombie;
+            rx.health = roleCfg[rx.role].health;
+            stats.worldFlips++;
+        }
+    }
+}
+
+// One beacon from dev, as heard by the probe
+static void deliverToProbe(tSimDevice &dev, uint32_t nowMs)
+{
+    const tSimDevice &probe = devices[0];
+    float rssi = pathLossRssi(probe, dev);
+    stats.framesSent++;
+    dev.seq++;
+    if ((rssi < SIM_SENSITIVITY_DBM) || ((int)(rng() % 100) < SIM_FRAME_LOSS_PCT))
+    {
+        return;
+    }
+    const tSimRoleCfg &cfg = roleCfg[dev.role];
+    tEspPacket pkt(dev.role);
+    pkt.deviceID = dev.id;
+    pkt.packetID = dev.seq;
+    pkt.hitPointsNear = cfg.hitPointsNear;
+    pkt.hitPointsMiddle = cfg.hitPointsMiddle;
+    pkt.hitPointsFar = cfg.hitPointsFar;
+
+    auto t0 = std::chrono::steady_clock::now();
+    addScannedRecord(&pkt, nowMs, (int)lroundf(rssi));
+    stats.addNs += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+    stats.framesHeard++;
+}
+
+static void probeGameStep(void)
+{
+    int zCount, hCount, bCount, healPoints, hitPoints, healthPoints;
+    bool isBase;
+    tGameRole deviceRole;
+
+    auto t0 = std::chrono::steady_clock::now();
+    bool doStep = loopScanRecords(deviceRole, zCount, hCount, bCount, healPoints, hitPoints, healthPoints, isBase);
+    if (!doStep)
+    {
+        return;
+    }
+    stats.scanNs += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+    stats.scans++;
+
+    tDeviceDataRecord *self = getSelfDataRecord();
+    if (self->health > self->maxHealth)
+    {
+        self->health = self->maxHealth;
+    }
+    if (self->health < 0)
+    {
+        tGameRole newRole = revertGameRole();
+        devices[0].role = newRole;
+        stats.probeFlips++;
+    }
+    devices[0].health = self->health;
+}
+
+static void printReport(uint32_t nowMs)
+{
+    int z = 0, h = 0;
+    for (const tSimDevice &dev : devices)
+    {
+        if (dev.role == grZombie)
+            z++;
+        if (dev.role == grHuman)
+            h++;
+    }
+    Serial.printf("[SIM] t = %5lu s, zombies = %3d, humans = %3d, probe = %s hp %d, live = %u\r\n",
+                  (unsigned long)(nowMs / 1000), z, h, role2str(devices[0].role), (int)devices[0].health, getLiveRecordCount());
+}
+
+static String argValue(int argc, char **argv, const char *key, const char *def)
+{
+    size_t keyLen = strlen(key);
+    for (int i = 1; i < argc; i++)
+    {
+        if ((strncmp(argv[i], key, keyLen) == 0) && (argv[i][keyLen] == '='))
+        {
+            return String(argv[i] + keyLen + 1);
+        }
+    }
+    return String(def);
+}
+
+int main(int argc, char **argv)
+{
+    int players = argValue(argc, argv, "players", "200").toInt();
+    int zombies = argValue(argc, argv, "zombies", "20").toInt();
+    int bases = argValue(argc, argv, "bases", "2").toInt();
+    uint32_t durationMs = argValue(argc, argv, "seconds", "300").toInt() * 1000;
+    float arena = argValue(argc, argv, "arena", "100").toInt();
+    rng.seed(argValue(argc, argv, "seed", "1").toInt());
+
+    if (!loadRoleCfg(grHuman, argValue(argc, argv, "hfile", SIM_ROLE_DIR "/xcon_hsettings.json")) ||
+        !loadRoleCfg(grZombie, argValue(argc, argv, "zfile", SIM_ROLE_DIR "/xcon_zsettings.json")) ||
+        !loadRoleCfg(grBase, argValue(argc, argv, "bfile", SIM_ROLE_DIR "/xcon_bsettings.json")))
+    {
+        return 1;
+    }
+    if (players + bases > MAX_REC_COUNT)
+    {
+        Serial.printf("*** main: %d devices for a %d record table, the oldest ones will be evicted\r\n", players + bases, MAX_REC_COUNT);
+    }
+
+    for (int i = 0; i < players + bases; i++)
+    {
+        tSimDevice dev;
+        dev.id = SIM_PROBE_ID + i;
+        dev.role = (i >= players) ? grBase : ((i > 0) && (i <= zombies)) ? grZombie : grHuman;
+        dev.x = dev.wx = randf(0, arena);
+        dev.y = dev.wy = randf(0, arena);
+        dev.speed = randf(SIM_SPEED_MIN_MPS, SIM_SPEED_MAX_MPS);
+        dev.health = roleCfg[dev.role].health;
+        dev.nextBeaconMs = rng() % BEACON_INTERVAL_MS;
+        devices.push_back(dev);
+    }
+
+    simSetDeviceID(devices[0].id);
+    for (tGameRole role : {grHuman, grZombie, grBase})
+    {
+        loadRoleProfile(roleCfg[role].fileName);
+    }
+    if (!setSelfRole(devices[0].role))
+    {
+        return 1;
+    }
+    devices[0].health = getSelfDataRecord()->health;
+
+    auto wallStart = std::chrono::steady_clock::now();
+    for (uint32_t nowMs = 1; nowMs <= durationMs; nowMs += SIM_STEP_MS)
+    {
+        simSetMillis(nowMs);
+        for (size_t i = 1; i < devices.size(); i++)
+        {
+            tSimDevice &dev = devices[i];
+            if ((int32_t)(nowMs - dev.nextBeaconMs) < 0)
+            {
+                continue;
+            }
+            deliverToProbe(dev, nowMs);
+            int jitter = BEACON_INTERVAL_MS / 5;
+            dev.nextBeaconMs = nowMs + BEACON_INTERVAL_MS - jitter + rng() % (2 * jitter + 1);
+        }
+
+        if (nowMs % SIM_SNAPSHOT_MS == 0)
+        {
+            auto t0 = std::chrono::steady_clock::now();
+            publishNeighborSnapshot();
+            stats.snapshotNs += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+            stats.snapshots++;
+            uint16_t live = getLiveRecordCount();
+            if (live > stats.maxLive)
+            {
+                stats.maxLive = live;
+            }
+        }
+
+        probeGameStep();
+
+        if (nowMs % SIM_MOVE_MS == 0)
+        {
+            moveDevices(SIM_MOVE_MS / 1000.0f, arena);
+            worldDamageTick(SIM_MOVE_MS);
+        }
+
+        if (nowMs % SIM_REPORT_MS == 0)
+        {
+            printReport(nowMs);
+        }
+    }
+    double wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - wallStart).count();
+
+    // the probe's link estimate against frames_heard / frames_sent, which also counts the out of range ones
+    static tNeighborRecord recs[MAX_REC_COUNT];
+    uint16_t recCount = copyScannedRecords(recs, MAX_REC_COUNT);
+    uint32_t pdrSum = 0;
+    for (uint16_t i = 0; i < recCount; i++)
+    {
+        pdrSum += recs[i].pdrPct;
+    }
+
+    Serial.printf("{\"players\":%d,\"bases\":%d,\"sim_s\":%lu,\"wall_ms\":%.0f,\"frames_sent\":%llu,\"frames_heard\":%llu,"
+                  "\"link_pdr\":%u,\"max_live\":%u,\"probe_flips\":%lu,\"world_flips\":%lu,\"add_ns\":%.0f,\"snapshot_ns\":%.0f,\"scan_ns\":%.0f}\r\n",
+                  players, bases, (unsigned long)(durationMs / 1000), wallMs, (unsigned long long)stats.framesSent,
+                  (unsigned long long)stats.framesHeard, recCount ? (unsigned)(pdrSum / recCount) : 100, stats.maxLive,
+                  (unsigned long)stats.probeFlips, (unsigned long)stats.worldFlips,
+                  stats.framesHeard ? stats.addNs / stats.framesHeard : 0, stats.snapshots ? stats.snapshotNs / stats.snapshots : 0,
+                  stats.scans ? stats.scanNs / stats.scans : 0);
+    return 0;
+}
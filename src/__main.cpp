@@ -5,6 +5,7 @@
 #include "serialCommander.h"
 #include "xgConfig.h"
 #include "gameEngine.h"
+#include "gamePinger.h"
 
 #include "valPlayer.h"
 #include "tft_utils.h"
@@ -40,19 +41,7 @@ bool processSerialRole(String gameRole)
         String jsonStr = "";
         tftPrintText("SERIAL JSON");
         Serial.println("Enter the game JSON:");
-        while(!Serial.available())
-        {
-            delay(5);
-        }
-        delay(1);
-        while(Serial.available())
-        {
-            jsonStr += (char) Serial.read();
-            if (!Serial.available())
-            {
-                delay(100);
-            }
-        }
+        serialCommReadText(jsonStr);
         Serial.println("=========================");
         Serial.println(jsonStr);
         Serial.println("=========================");
@@ -88,6 +77,11 @@ bool processFixedRole(String deviceRole)
     {
         return startRssiReader();
     }
+
+    if (deviceRole == "fixPinger")
+    {
+        return startPinger();
+    }
    
     // tftPrintText("ROLE CONF. ERROR");
     // while(true)
@@ -159,19 +153,18 @@ void setup()
         }
     }    
     //tftGameScreenTest();
+    serialCommInit();
     processGameRole();    
     //testGameBase();
     //valTest();    
     //testGameHuman();
     //testGameZombie();
-    
-    
-    //serialCommInit();
 }
 
+// The game flow's phases step from here, the loop sleeps as long as the phase allows
 void loop()
 {
     //serialCommLoop();
-    delay(50);
+    delay(gameFlowStep());
     //Serial.println(millis());
 }
\ No newline at end of file
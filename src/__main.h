@@ -10,6 +10,8 @@
 #define DEF_TO_MS               15000
 #define DEF_NET_WAIT_MS         15000
 #define DEF_SLEEP_AFTER_BOOT_FAIL_MS    300000 
+#define DEF_BOOT_JOIN_POLL_MS   100
+#define DEF_PSRAM_PREFETCH      (false) // copy all audio to PSRAM after boot instead of on first play
 
 //#define DEF_WIFI_CHANNEL        1
 
@@ -21,4 +23,5 @@ void checkSleep(bool resetTimer = false);
 bool initOnBoot(void);
 bool netConnect(uint16_t toMs);
 bool netWait(uint16_t toMs);
-void radioConnect(void);
\ No newline at end of file
+void radioConnect(void);
+void telemetryBoot(void);
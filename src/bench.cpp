@@ -0,0 +1,255 @@
+#include "bench.h"
+
+#include <ArduinoJson.h>
+#include <WiFi.h>
+#include <algorithm>
+
+#include "PSRamFS.h"
+#include "board.h"
+#include "deviceClass.h"
+#include "deviceRecords.h"
+#include "gameComm.h"
+#include "jsonAlloc.h"
+#include "rm67162.h"
+#include "tunables.h"
+#include "tft_utils.h"
+#include "valPlayer.h"
+#include "version.h"
+#include "xgConfig.h"
+
+typedef void (*tBenchFn)(uint32_t i);
+
+static uint16_t *benchFrame = NULL;
+static uint8_t *benchBgrBuf = NULL;
+static const uint8_t *benchBgrRow = NULL;
+static uint16_t *benchRgbRow = NULL;
+static String benchValJson;
+static String benchServerURL;
+
+static void benchAddScannedRecord(uint32_t i)
+{
+    tEspPacket pkt(grHuman);
+    pkt.deviceID = 0xBE00 + (i % BENCH_SENDERS);
+    recordsReplaySetClock(i);
+    addScannedRecord(&pkt, i, -60 - (int)(i % 30));
+}
+
+static void benchScanTick(uint32_t i)
+{
+    int health, hitPoints, healPoints;
+    recordsReplaySetClock(i);
+    recordsReplayTick(health, hitPoints, healPoints);
+}
+
+static void benchDrawBmp(uint32_t i)
+{
+    tftDrawBmp(BENCH_BMP_FNAME, 0, 0, X_TFT_WIDTH, X_TFT_HEIGHT);
+}
+
+// the per-pixel loop the BMP decoders had, as the baseline for the kernel
+static void benchBgrScalar(uint32_t i)
+{
+    const uint8_t *bptr = benchBgrRow;
+    for (uint16_t col = 0; col < X_TFT_WIDTH; col++, bptr += 3)
+    {
+        uint16_t c = ((bptr[2] & 0xF8) << 8) | ((bptr[1] & 0xFC) << 3) | (bptr[0] >> 3);
+        benchRgbRow[col] = (c >> 8) | (c << 8);
+    }
+}
+
+static void benchBgrKernel(uint32_t i)
+{
+    tftBgr888ToRgb565(benchBgrRow, benchRgbRow, X_TFT_WIDTH, true);
+}
+
+static void benchPushColors(uint32_t i)
+{
+    lcd_PushColors(0, 0, X_TFT_WIDTH, X_TFT_HEIGHT, benchFrame);
+}
+
+static void benchDeserializeVal(uint32_t i)
+{
+    JsonDocument doc(jsonPsram(jdkVal));
+    deserializeJson(doc, benchValJson);
+}
+
+static void benchSendDeviceData(uint32_t i)
+{
+    tGameApiRequest req;
+    req.role = getSelfDataRecord()->deviceRole;
+    req.status = gasIdle;
+    req.setComment("bench");
+    sendDeviceData(req, benchServerURL.c_str());
+}
+
+static void benchRun(JsonArray results, const char *name, tBenchFn fn, uint32_t iterations)
+{
+    uint32_t *samples = (uint32_t *)malloc(iterations * sizeof(uint32_t));
+    if (samples == NULL)
+    {
+        Serial.printf("!!! benchRun ERROR: no memory for %lu samples\r\n", iterations);
+        return;
+    }
+
+    fn(0); // warm up caches and lazy allocations
+    uint32_t cpuMhz = getCpuFrequencyMhz();
+    int32_t heapBefore = ESP.getFreeHeap();
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        uint32_t startCycles = ESP.getCycleCount();
+        fn(i + 1);
+        samples[i] = (ESP.getCycleCount() - startCycles) * 1000UL / cpuMhz;
+    }
+    int32_t heapAfter = ESP.getFreeHeap();
+
+    std::sort(samples, samples + iterations);
+    JsonObject res = results.add<JsonObject>();
+    res["name"] = name;
+    res["n"] = iterations;
+    res["min_ns"] = samples[0];
+    res["median_ns"] = samples[iterations / 2];
+    res["p99_ns"] = samples[(iterations * 99) / 100];
+    res["heap_delta"] = (float)(heapBefore - heapAfter) / iterations;
+    free(samples);
+}
+
+static void benchSuiteRecords(JsonArray results, uint32_t iterations)
+{
+    // the record table is cleared and the radio task parked, like for a replay
+    recordsReplayBegin(0);
+    benchRun(results, "addScannedRecord", benchAddScannedRecord, iterations);
+    benchRun(results, "loopScanRecords", benchScanTick, iterations);
+    recordsReplayEnd();
+}
+
+static void benchSuiteDisplay(JsonArray results, uint32_t iterations)
+{
+    File bmp = PSRamFS.open(BENCH_BMP_FNAME, "r");
+    if (bmp)
+    {
+        bmp.close();
+        benchRun(results, "tftDrawBmp", benchDrawBmp, iterations);
+    }
+    else
+    {
+        Serial.printf("*** benchRunAll: [%s] not found, tftDrawBmp skipped\r\n", BENCH_BMP_FNAME);
+    }
+
+    // one full-width row, unaligned as BMP rows after the 54-byte header are
+    if (benchBgrBuf == NULL)
+    {
+        benchBgrBuf = (uint8_t *)malloc(X_TFT_WIDTH * 3 + 2);
+        benchRgbRow = (uint16_t *)malloc(X_TFT_WIDTH * sizeof(uint16_t));
+    }
+    if ((benchBgrBuf != NULL) && (benchRgbRow != NULL))
+    {
+        for (int k = 0; k < X_TFT_WIDTH * 3 + 2; k++)
+        {
+            benchBgrBuf[k] = (uint8_t)(k * 37);
+        }
+        benchBgrRow = benchBgrBuf + 2;
+        benchRun(results, "bgr888ToRgb565 scalar (row)", benchBgrScalar, iterations);
+        benchRun(results, "tftBgr888ToRgb565 (row)", benchBgrKernel, iterations);
+    }
+
+    if (benchFrame == NULL)
+    {
+        benchFrame = (uint16_t *)ps_malloc(X_TFT_WIDTH * X_TFT_HEIGHT * sizeof(uint16_t));
+    }
+    if (benchFrame != NULL)
+    {
+        memset(benchFrame, 0, X_TFT_WIDTH * X_TFT_HEIGHT * sizeof(uint16_t));
+        benchRun(results, "lcd_PushColors", benchPushColors, iterations);
+    }
+}
+
+static void benchSuiteJson(JsonArray results, uint32_t iterations)
+{
+    File val = PSRamFS.open(VAL_FILE_NAME, "r");
+    if (val)
+    {
+        benchValJson = val.readString();
+        val.close();
+        benchRun(results, "deserializeJson(val.json)", benchDeserializeVal, iterations);
+        benchValJson = "";
+    }
+    else
+    {
+        Serial.printf("*** benchRunAll: [%s] not found, deserializeJson skipped\r\n", VAL_FILE_NAME);
+    }
+}
+
+static void benchSuiteNet(JsonArray results, uint32_t iterations)
+{
+    if (WiFi.status() == WL_CONNECTED)
+    {
+        benchServerURL = ConfigAPI::getGameServerUrl();
+        benchRun(results, "sendDeviceData", benchSendDeviceData, min(iterations, (uint32_t)BENCH_NET_ITERATIONS));
+    }
+    else
+    {
+        Serial.println("*** benchRunAll: WiFi not connected, sendDeviceData skipped");
+    }
+}
+
+typedef void (*tBenchSuiteFn)(JsonArray results, uint32_t iterations);
+
+struct tBenchSuite
+{
+    const char   *name;
+    tBenchSuiteFn fn;
+};
+
+static const tBenchSuite benchSuites[] =
+{
+    {BENCH_SUITE_RECORDS, benchSuiteRecords},
+    {BENCH_SUITE_DISPLAY, benchSuiteDisplay},
+    {BENCH_SUITE_JSON,    benchSuiteJson},
+    {BENCH_SUITE_NET,     benchSuiteNet},
+};
+
+bool benchRunSuite(const char *suite, uint32_t iterations, Print &out)
+{
+    iterations = constrain(iterations, (uint32_t)1, (uint32_t)BENCH_MAX_ITERATIONS);
+    if ((suite == NULL) || (*suite == 0))
+    {
+        suite = BENCH_SUITE_ALL;
+    }
+    bool all = (strcmp(suite, BENCH_SUITE_ALL) == 0);
+    Serial.printf(">>> benchRunSuite: [%s], %lu iterations\r\n", suite, iterations);
+
+    JsonDocument doc;
+    doc["version"] = 1;
+    doc["suite"] = suite;
+    doc["build"] = BUILD_NUMBER;
+    doc["class"] = devClass.name;
+    doc["chip_rev"] = ESP.getChipRevision();
+    doc["battery_pct"] = boardGetVccPercent();
+    doc["tunables"] = tunablesSetName();
+    doc["cpu_mhz"] = getCpuFrequencyMhz();
+    JsonArray results = doc["bench"].to<JsonArray>();
+
+    bool found = all;
+    for (const tBenchSuite &s : benchSuites)
+    {
+        if (all || (strcmp(suite, s.name) == 0))
+        {
+            s.fn(results, iterations);
+            found = true;
+        }
+    }
+    if (!found)
+    {
+        Serial.printf("!!! benchRunSuite ERROR: unknown suite [%s]\r\n", suite);
+        doc["error"] = "unknown suite";
+    }
+
+    serializeJson(doc, out);
+    out.println();
+    return found;
+}
+
+void benchRunAll(uint32_t iterations, Print &out)
+{
+    benchRunSuite(BENCH_SUITE_ALL, iterations, out);
+}
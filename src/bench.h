@@ -0,0 +1,26 @@
+#pragma once
+
+#include <Arduino.h>
+
+#define BENCH_DEF_ITERATIONS    100
+#define BENCH_MAX_ITERATIONS    2000
+#define BENCH_NET_ITERATIONS    10      // sendDeviceData talks to the game server, keep it short
+#define BENCH_BMP_FNAME         "/xgamelogo.bmp"
+#define BENCH_SENDERS           64
+
+// Suites for benchRunSuite(), "all" runs every one of them
+#define BENCH_SUITE_RECORDS     "records"   // addScannedRecord, loopScanRecords
+#define BENCH_SUITE_DISPLAY     "display"   // tftDrawBmp, the BGR888 kernels, lcd_PushColors
+#define BENCH_SUITE_JSON        "json"      // deserializeJson(val.json)
+#define BENCH_SUITE_NET         "net"       // sendDeviceData
+#define BENCH_SUITE_ALL         "all"
+
+// Runs the firmware hot paths N times each and prints min/median/p99 (ns)
+// and the free heap delta per iteration as one JSON line to out
+void benchRunAll(uint32_t iterations = BENCH_DEF_ITERATIONS, Print &out = Serial);
+
+// The same for one suite, the report also names the build, device class,
+// chip revision, battery level and tunable set so the server can compare a
+// fleet run.
+// An unknown suite gets a report with "error" and false.
+bool benchRunSuite(const char *suite, uint32_t iterations, Print &out);
@@ -4,8 +4,11 @@
 
 #include "PSRamFS.h"
 #include "serverSync.h"
+#include "assetPack.h"
+#include "syncAdmission.h"
 #include "board.h"
 #include "tft_utils.h"
+#include "tftImageCache.h"
 #include "valPlayer.h"
 #include "version.h"
 #include "xgConfig.h"
@@ -14,18 +17,164 @@
 #include "gameEngine.h"
 #include "statusClient.h"
 #include "version.h"
+#include "bench.h"
+#include "bootProfile.h"
+#include "taskRegistry.h"
+#include "warmState.h"
+#include "gameCheckpoint.h"
+#include "pmLocks.h"
+#include "memMonitor.h"
+#include "deviceClass.h"
+#include "espRadio.h"
+#include "espProv.h"
+
+// A stage that runs on its own task while the boot carries on. The TFT and
+// checkSleep() stay with the boot task, which joins the job when it needs it.
+struct tBootJob
+{
+    tBootStageId stage;
+    bool (*run)(void);
+    SemaphoreHandle_t doneSem;
+    bool ok;
+};
+
+static void bootStage(tBootStageId id, void (*stage)(void))
+{
+    bootProfStageBegin(id);
+    stage();
+    bootProfStageEnd(id);
+}
+
+static void bootJobTask(void *param)
+{
+    tBootJob *job = (tBootJob *)param;
+    bootProfStageBegin(job->stage);
+    job->ok = job->run();
+    bootProfStageEnd(job->stage);
+    xSemaphoreGive(job->doneSem);
+    vTaskDelete(NULL);
+}
+
+static void bootJobStart(tBootJob &job)
+{
+    job.ok = false;
+    job.doneSem = xSemaphoreCreateBinary();
+    if ((job.doneSem != NULL) &&
+        taskStart(tkBootJob, bootJobTask, &job, NULL, bootProfStageName(job.stage)))
+    {
+        return;
+    }
+    Serial.printf("*** bootJobStart: no task for [%s], running it inline\r\n", bootProfStageName(job.stage));
+    bootProfStageBegin(job.stage);
+    job.ok = job.run();
+    bootProfStageEnd(job.stage);
+    if (job.doneSem != NULL)
+    {
+        xSemaphoreGive(job.doneSem);
+    }
+}
+
+static bool bootJobJoin(tBootJob &job)
+{
+    if (job.doneSem == NULL)
+    {
+        return job.ok;
+    }
+    while (xSemaphoreTake(job.doneSem, pdMS_TO_TICKS(DEF_BOOT_JOIN_POLL_MS)) != pdTRUE)
+    {
+        checkSleep();
+    }
+    vSemaphoreDelete(job.doneSem);
+    job.doneSem = NULL;
+    return job.ok;
+}
+
+static bool netStartJob(void)
+{
+    return netConnect(DEF_NET_WAIT_MS);
+}
+
+static bool preloadJob(void)
+{
+    return loadFilesToPsram() > 0;
+}
+
+// What each device role brings up, by ConfigAPI::getDeviceRole(). The base
+// and the RSSI reader stay put and play a sound now and then, a role error
+// only shows its LEDs, the pinger needs none of it; a role not listed gets
+// everything as before.
+enum tBootPart
+{
+    bpAccel     = 0x01,     // accelerometer and its sampling task
+    bpSound     = 0x02,     // audio task and effect bank at boot
+    bpSoundLazy = 0x04      // the same on first use
+};
+
+struct tBootPlan
+{
+    const char *deviceRole;
+    uint8_t parts;          // tBootPart
+};
+
+static const tBootPlan bootPlans[] =
+{
+    {"gamePlayer",  bpAccel | bpSound},
+    {"fixZombie",   bpAccel | bpSound},
+    {"fixHuman",    bpAccel | bpSound},
+    {"fromSerial",  bpAccel | bpSound},
+    {"fixBase",     bpSoundLazy},
+    {"fixRSSI",     bpSoundLazy},
+    {"fixPinger",   0},
+    {"roleError",   0},
+};
+
+static uint8_t bootParts = bpAccel | bpSound;
+
+// The device class has the last word, a part its build left out is never started
+static void bootPlanSelect(const String &deviceRole)
+{
+    for (const tBootPlan &plan : bootPlans)
+    {
+        if (deviceRole == plan.deviceRole)
+        {
+            bootParts = plan.parts;
+            break;
+        }
+    }
+    if constexpr (!devClass.accel)
+    {
+        bootParts &= ~bpAccel;
+    }
+    if constexpr (!devClass.audio)
+    {
+        bootParts &= ~(bpSound | bpSoundLazy);
+    }
+    Serial.printf(">>> bootPlanSelect: %s [%s] accel %s, sound %s\r\n", devClass.name, deviceRole.c_str(), (bootParts & bpAccel) ? "on" : "off",
+                  (bootParts & bpSound) ? "at boot" : (bootParts & bpSoundLazy) ? "on first use" : "off");
+}
+
+static bool valParseJob(void)
+{
+    tValAudioMode audioMode = (bootParts & bpSound) ? vaEager : (bootParts & bpSoundLazy) ? vaLazy : vaNone;
+    return valPlayerInit(audioMode);
+}
+
+static tBootJob netJob = {bsNet, netStartJob};
+static tBootJob filesJob = {bsPreload, preloadJob};
+static tBootJob valJob = {bsValParse, valParseJob};
+static bool psramHadFiles = false;
 
 static void boardInit(void)
 {
     boardPowerOn();
     delay(10);       
     Wire.begin(PIN_I2C_SDA, PIN_I2C_SCL, 100000);
+    batteryMonitorStart();
     if (DEF_USE_TFT)
     {
        setupTFT("BAZA BOOT"); 
        //tftPrintText("BAZA BOOT");
        tftPrintText(statusClientGetName());
-       delay(2000);              
     }
     valPlayError(ERR_VAL_OK);
     //delay(1000);
@@ -52,6 +201,27 @@ void checkSleep(bool resetTimer)
     }
 }
 
+// Between the attempts of a server stage: the server's Retry-After when it
+// queued this device, which is no failure and feeds the sleep timer, else a
+// jittered backoff that counts towards it
+static void bootRetryWait(int attempt, const char *what)
+{
+    bool paced;
+    uint32_t waitMs = syncBackoffMs(attempt, paced);
+    Serial.printf(">>> bootRetryWait: %s attempt #%d, next in %u ms%s\r\n", what, attempt, (unsigned)waitMs,
+                  paced ? " (server queue)" : "");
+    if (paced)
+    {
+        tftPrintText(String(what) + " WAIT " + String((waitMs + 999) / 1000) + "s");
+    }
+    uint32_t startMs = millis();
+    while (millis() - startMs < waitMs)
+    {
+        delay(100);
+        checkSleep(paced);
+    }
+}
+
 static bool configInit(void)
 {
     if (ConfigAPI::initialize())
@@ -66,7 +236,6 @@ static bool configInit(void)
 static bool psFsInit(void)
 {
     Serial.print(">>> PSRAM FS INIT...");
-    delay(500);
     if (!PSRamFS.begin())
     {
         Serial.println("ERROR!!!");
@@ -83,16 +252,18 @@ static bool accelInitOnBoot(void)
 {
     if (accelInit())
     {
+        accelServiceStart();
         return true;
     }
     return false;
 }
 
-static void configBoot(void)
+// The config itself is read before the board comes up, so the WiFi association
+// can start right away, this only reports the outcome once the TFT is alive
+static void configBoot(bool configOk)
 {
     tftPrintText("CONFIG");
-    delay(100);
-    if (!configInit())
+    if (!configOk)
     {
         tftPrintText("!CONFIG ERROR!");
         while(1)
@@ -121,25 +292,35 @@ static void accelBoot(void)
     checkSleep(true);
 }
 
+// A device that does not get onto the network may be waiting for the
+// credentials of a new one, a provisioning broadcast reaches it anyway
+static void provListen(void)
+{
+    initRadio();
+    espProvStart(ConfigAPI::applyFleetConfig);
+}
+
 static void netBoot(void)
 {    
     int a = 0;
     tftPrintText("NETWORK");
-    delay(100);
 
-    if (netConnect(DEF_NET_WAIT_MS))
+    if (bootJobJoin(netJob))
     {        
         while(!netWait(DEF_NET_WAIT_MS))
         {
             a++;
             Serial.printf("*** Wi-Fi connection attempt #%d\r\n", a);
             tftPrintText("NETWORK " + String(a));
+            provListen();
             checkSleep();
         }
+        bootProfStageEnd(bsNet);
     }
     else 
     {
         tftPrintText("!NET. ERROR!");
+        provListen();
         while(true)
         {
             checkSleep();
@@ -154,7 +335,32 @@ static void discoBoot(void)
     int a = 0;
     const int maxAttempts = 10;
     tftPrintText("DISCO");    
-    delay(100);
+    if (gameRejoinPending() && (gameRejoinState().serverIp != 0))
+    {
+        // back into a game, the servers are the ones it was played with
+        const tGameCheckpoint &ck = gameRejoinState();
+        server = IPAddress(ck.serverIp);
+        Serial.printf(">> DISCO SKIPPED, game rejoin: %s\r\n", server.toString().c_str());
+        ConfigAPI::setDiscoServer(server.toString());
+        ConfigAPI::setDiscoPorts(ck.filePort, ck.gamePort, ck.otaPort, ck.statusPort);
+        if (ck.gameIp != 0)
+        {
+            ConfigAPI::setDiscoGameHost(IPAddress(ck.gameIp).toString());
+        }
+        statusClientSetServerPort(ck.statusPort);
+        return;
+    }
+    uint32_t warmIp;
+    // the warm cache keeps the discovery server only, not the game server of an arena
+    if ((ConfigAPI::getArena() == 0) && warmDiscoIp(warmIp))
+    {
+        server = IPAddress(warmIp);
+        Serial.printf(">> DISCO SKIPPED, warm resume: %s\r\n", server.toString().c_str());
+        ConfigAPI::setDiscoServer(server.toString());
+        gameCheckpointSetServer(warmIp, 0, 0, 0, 0);
+        return;
+    }
+    wifiDiscoSetArena(ConfigAPI::getArena());
     while(true)
     {
         bool res = wifiGetDisco(server);
@@ -170,6 +376,27 @@ static void discoBoot(void)
             Serial.print(">> DISCO COMPLETED: ");
             Serial.println(serverIpStr);
             ConfigAPI::setDiscoServer(serverIpStr);
+            warmSetDiscoIp((uint32_t)server);
+            gameCheckpointSetServer((uint32_t)server, 0, 0, 0, 0);
+            tDiscoServices services;
+            if (wifiDiscoServices(services))
+            {
+                // the server's ports win over the ones in the config URLs
+                Serial.printf(">> DISCO SERVICES: file %u game %u ota %u status %u assets %s\r\n",
+                              services.filePort, services.gamePort, services.otaPort, services.statusPort, services.assets);
+                ConfigAPI::setDiscoPorts(services.filePort, services.gamePort, services.otaPort, services.statusPort);
+                statusClientSetServerPort(services.statusPort);
+                syncSetAssetsSignature(services.assets);
+                gameCheckpointSetServer((uint32_t)server, services.filePort, services.gamePort, services.otaPort, services.statusPort);
+                if (services.gameIp != 0)
+                {
+                    // the arena's game server runs on another machine
+                    Serial.printf(">> DISCO ARENA %u: game server %s\r\n", (unsigned)ConfigAPI::getArena(),
+                                  IPAddress(services.gameIp).toString().c_str());
+                    ConfigAPI::setDiscoGameHost(IPAddress(services.gameIp).toString());
+                    gameCheckpointSetGameHost(services.gameIp);
+                }
+            }
             break;
         }
         if (a > maxAttempts)
@@ -187,15 +414,37 @@ static void otaBoot(void)
 {
     int a = 0;    
     int fwVer = String(BUILD_NUMBER).toInt();
+
+    // the discovery reply already named the server's firmware, no request is needed when it is ours
+    int serverVer;
+    String serverMd5;
+    if (warmOtaCurrent())
+    {
+        Serial.printf(">>> otaBoot: firmware %d was current before the nap\r\n", fwVer);
+        return;
+    }
+    if (gameRejoinPending())
+    {
+        // the game played with this firmware, updates wait for the lobby's next boot
+        Serial.printf(">>> otaBoot: firmware %d, skipped for the game rejoin\r\n", fwVer);
+        return;
+    }
+    if (wifiDiscoFirmware(serverVer, serverMd5) && otaFirmwareCurrent(fwVer, serverVer, serverMd5))
+    {
+        Serial.printf(">>> otaBoot: firmware %d is current (from discovery)\r\n", fwVer);
+        warmSetOtaCurrent();
+        return;
+    }
     statusClientSetGameStatus("OTA_CHECK");
     statusClientPause();
     tftPrintText("OTA");
-    delay(100);    
+    bool otaChecked = true;
     while (!syncOTA(ConfigAPI::getOTAServerUrl().c_str(), fwVer))
     {        
         if (DEF_CAN_SKIP_OTA)
         {
             Serial.println("*** WARNING: OTA SKIPPED!");
+            otaChecked = false;
             break;
         }
         else 
@@ -203,9 +452,14 @@ static void otaBoot(void)
             a++;
             Serial.printf("!!! OTA sync failed, attempt #%d\r\n", a);
             tftPrintText("OTA " + String(a));
+            bootRetryWait(a, "OTA");
         }
         checkSleep();
     }
+    if (otaChecked)
+    {
+        warmSetOtaCurrent();
+    }
     checkSleep(true);
     statusClientResume();
 }
@@ -214,13 +468,13 @@ static void statusBoot(void)
 {
     int a = 0;    
     tftPrintText("STATUS CLIENT");
-    delay(100);        
     while (!statusClientInit(/*ConfigAPI::getDeviceName().c_str(), */ConfigAPI::getDiscoServer().c_str()))
     {                
         checkSleep();
         a++;
         tftPrintText("STATUS CLIENT ERR " + String(a));
     }
+    statusClientSetBenchHook(benchRunSuite);
     checkSleep(true);
 }
 
@@ -247,38 +501,90 @@ bool fsProgressCallback(uint32_t downloaded, uint32_t total, uint8_t percentage)
 }
 
 
+// The role tags of the files a device keeps, the game server may announce others
+static const char *assetRolesFor(const String &deviceRole)
+{
+    if (deviceRole == "fixBase")
+    {
+        return "base";
+    }
+    if ((deviceRole == "fixZombie") || (deviceRole == "fixHuman") || (deviceRole == "gamePlayer"))
+    {
+        return SYNC_PLAYER_ROLES;
+    }
+    return "";
+}
+
 static void fileSyncBoot(void)
 {
     int a = 0;    
+    syncSetRoles(assetRolesFor(ConfigAPI::getDeviceRole()));
     statusClientSetGameStatus("FILE SYNC");
     statusClientPause();
     tftPrintText("FILE SYNC");
-    delay(100);
 
-    if (!checkFsInit())
+    // the preload owns LittleFS until it is done
+    bool preloaded = bootJobJoin(filesJob);
+    if (preloaded)
     {
+        Serial.println(">>> fileSyncBoot: LittleFS files preloaded to PSRAM");
+    }
+
+    bootProfStageBegin(bsFileSync);
+    if (preloaded && (warmFilesSynced() || gameRejoinPending()))
+    {
+        // PSRAM is lost in deep sleep and in a crash, LittleFS still holds what was synced before
+        tftPrintText("FILE SYNC READY");
+    }
+    else if (preloaded && syncAssetsCurrent())
+    {
+        // the server's sync folder hashes the same as at the last complete sync, no list to fetch
+        tftPrintText("FILE SYNC READY");
+        warmSetFilesSynced();
+    }
+    else if (preloaded && SYNC_BACKGROUND)
+    {
+        // a complete set is on LittleFS, server changes are staged while the device waits for a game
+        tftPrintText("FILE SYNC READY");
+        warmSetFilesSynced();
+    }
+    else if (!psramHadFiles)
+    {
+        // the image goes first, the sync then knows which bitmaps need no PSRAM copy
+        // the image is optional, it is only waited for when the server queued the device
+        int assetTries = 0;
+        while (!assetPackSync(ConfigAPI::getFileServerUrl().c_str()) && syncRetryPending())
+        {
+            bootRetryWait(++assetTries, "ASSETS");
+        }
         while (!syncFiles(ConfigAPI::getFileServerUrl().c_str(), fsProgressCallback))
         {
             a++;
             Serial.printf("!!! File sync failed, attempt #%d\r\n", a);
             tftPrintText("FILE SYNC ERR " + String(a));
+            bootRetryWait(a, "FILE SYNC");
             checkSleep();
         }
         checkSleep(true);    
+        // bitmaps decoded before the sync (boot logo) may have been replaced
+        tftImageCacheLock();
+        tftImageCacheClear();
+        tftImageCacheUnlock();
+        warmSetFilesSynced();
     }
     else 
     {
         tftPrintText("FILE SYNC READY");
-        delay(500);
+        warmSetFilesSynced();
     }
+    bootProfStageEnd(bsFileSync);
     statusClientResume();
 }
 
 static void valPlayerBoot(void)
 {
     tftPrintText("VAL_PLAYER");
-    delay(500);
-    if (!valPlayerInit())
+    if (!bootJobJoin(valJob))
     {
         while(1)
         {
@@ -290,32 +596,65 @@ static void valPlayerBoot(void)
     }
 }
 
+static void roleProfilesBoot(void)
+{
+    tftPrintText("ROLES");
+    if (!gameLoadRoleProfiles())
+    {
+        Serial.println("*** roleProfilesBoot: some role files are missing, they will be read when the game starts");
+    }
+}
+
 static void radioBoot(void)
 {
     checkSleep(true);
     tftPrintText("RADIO");
     radioConnect();
-    delay(100);
+    espProvStart(ConfigAPI::applyFleetConfig);
 }
 
 bool initOnBoot(void)
 {
     bool wasError = false;    
 
+    bootProfStart();
     Serial.begin(115200);
+    logRingInit();
+    memMonStart();
+    warmStateInit();
+    gameCheckpointInit();
+    telemetryBoot();
 
+    bootProfStageBegin(bsPsFs);
     if (!psFsInit())
     {
         wasError = true;
     }    
+    psramHadFiles = !wasError && checkFsInit();
+    // bitmaps in the asset image are drawn from flash, the preload skips them
+    assetPackMount();
+    bootProfStageEnd(bsPsFs);
+
+    // WiFi association and the LittleFS -> PSRAM copy only need the config,
+    // they run while the board, the TFT, the accelerometer and discovery come up
+    bootProfStageBegin(bsConfig);
+    bool configOk = configInit();
+    bootProfStageEnd(bsConfig);
+    if (configOk)
+    {
+        bootPlanSelect(ConfigAPI::getDeviceRole());
+        bootJobStart(netJob);
+        if (!wasError)
+        {
+            bootJobStart(filesJob);
+        }
+    }
 
-    boardInit();          
+    bootStage(bsBoard, boardInit);
 
-    delay(1500);
     Serial.println(">>> BOOT");
     Serial.print(">>> BAZA GAME TERMINAL ");
     Serial.println(VERSION_STR);
-    delay(10);
 
     if (wasError)
     {
@@ -327,25 +666,37 @@ bool initOnBoot(void)
         }
         return false;
     }
-    else 
+    checkSleep(true);
+    configBoot(configOk);
+    if (bootParts & bpAccel)
     {
-    
+        bootStage(bsAccel, accelBoot);
     }
-    checkSleep(true);
-    accelBoot();    
-    configBoot();
     netBoot();    
-    discoBoot();
-    statusBoot();        
-    otaBoot();       
-    fileSyncBoot();                
-    radioBoot();
+    bootStage(bsDisco, discoBoot);
+    bootStage(bsStatus, statusBoot);
+    bootStage(bsOta, otaBoot);
+    fileSyncBoot();
+    // val.json is in PSRAM now, it is parsed while the radio comes up
+    bootJobStart(valJob);
+    bootStage(bsRadio, radioBoot);
     valPlayerBoot();  
-    valPlayPattern(ON_BOOT_PATTERN);
+    gamePatternsResolve();
+    gameShowsInit();
+    bootStage(bsRoles, roleProfilesBoot);
+    gamePlayPattern(gpOnBoot);
     statusClientSetGameStatus("READY");
     bazaLogo();    
     //tftPrintText("READY!");    
+    // the STARTED update is the first one to carry the boot report
+    bootProfFinish();
+    // boot ran at the full clock, from here on only the work that holds a lock does
+    pmInit();
     statusClientSetGameStatus("STARTED");
+    if (DEF_PSRAM_PREFETCH)
+    {
+        startPsramPrefetch();
+    }
 
     return true;
 }
@@ -2,6 +2,9 @@
 #include "wifiUtils.h"
 #include "espRadio.h"
 #include "wifiAuto.h"
+#include "wifiRoam.h"
+#include "warmState.h"
+#include "gameCheckpoint.h"
 
 uint8_t wifiChannel = ESP_WIFI_CHANNEL;
 
@@ -11,11 +14,39 @@ static void netPrint(void)
     Serial.println(DEF_SSID);
 }
 
+// The AP of the last connection first, its lease too on a warm resume or a game rejoin
+static bool netRejoin(void)
+{
+    if (!WiFiAutoConnect::beginFast(warmResume() || gameRejoinPending()))
+    {
+        return false;
+    }
+    uint32_t startMs = millis();
+    while (millis() - startMs < WIFI_FAST_WAIT_MS)
+    {
+        if (WiFi.isConnected() && ((uint32_t)WiFi.localIP() != 0))
+        {
+            Serial.printf(">>> netRejoin: CONNECTED in %lu ms\r\n", millis() - startMs);
+            return true;
+        }
+        delay(10);
+    }
+    Serial.println("*** netRejoin: the cached AP did not answer, scanning");
+    WiFiAutoConnect::fastFailed();
+    return false;
+}
+
 bool netConnect(uint16_t toMs)
 {
     netPrint();
     delay(10);
     prepareWiFi();
+    if (netRejoin())
+    {
+        wifiMaxPower();
+        wifiRoamStart();
+        return true;
+    }
     /// wifiInit(DEF_SSID, DEF_PASS, wifiChannel);
     if (!WiFiAutoConnect::begin(toMs))
     {
@@ -29,6 +60,7 @@ bool netConnect(uint16_t toMs)
     }
     wifiMaxPower();
     netWait(toMs);
+    wifiRoamStart();
     return true;
 }
 void radioConnect(void)
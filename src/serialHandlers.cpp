@@ -1,9 +1,489 @@
 #include <Arduino.h>
+#include <StreamString.h>
 
 #include "deviceRecords.h"
+#include "espStats.h"
+#include "rxRecorder.h"
+#include "bench.h"
+#include "energyProfile.h"
+#include "tunables.h"
+#include "logRing.h"
+#include "jsonAlloc.h"
+#include "taskRegistry.h"
+#include "loopProfile.h"
+#include "espHitStamp.h"
+#include "espNeighbors.h"
+#include "gameLog.h"
+#include "serialCommander.h"
+#include "tftTestPattern.h"
+#include "tftFrame.h"
+#include "tftSnapshot.h"
+#include "rm67162.h"
+#include "serverSync.h"
+#include "valPlayer.h"
+#include "httpPool.h"
+#include "memMonitor.h"
+#include "wifiRoam.h"
+#include "espPing.h"
+#include "espRxStream.h"
+#include "espProv.h"
+#include "fsMount.h"
+#include "syncBench.h"
+#include "xgConfig.h"
+
+// Binary reply payloads, packed and little endian as the host reads them
+struct __attribute__((packed)) tSerialBinDevice
+{
+    uint64_t deviceID;
+    uint8_t  deviceRole;        // tGameRole
+    uint8_t  zone;              // tRssiZone
+    uint32_t ageMs;             // since the last frame heard
+    int16_t  rssi;
+    int16_t  rssiFiltered;
+    int16_t  rssiMin;
+    int16_t  rssiMax;
+    uint16_t rssiCount;
+    uint8_t  pdrPct;            // frames heard of the ones sent
+    uint8_t  lossBurst;         // longest run lost, decaying
+};
+
+struct __attribute__((packed)) tSerialBinRadioStats
+{
+    uint32_t txOk;
+    uint32_t txFail;
+    uint32_t rxFrames;
+    uint16_t rxFps;
+    uint32_t rejLength;
+    uint32_t rejProtocol;
+    uint32_t rejCrc;
+    uint32_t ringDropped;
+    uint32_t ringCoalesced;
+    uint16_t senders;
+    uint16_t jitterAvgMs;
+    uint16_t jitterMaxMs;
+    uint32_t rssiHist[ESP_STATS_RSSI_BINS];
+};
 
 void onSerialScanList(void)
 {
     Serial.println(">>> onSerialScanList");
     printScannedRecords();
-}
\ No newline at end of file
+}
+
+void onSerialRadioStats(void)
+{
+    Serial.println(">>> onSerialRadioStats");
+    espStatsPrint();
+}
+
+void onSerialRxRecStart(void)
+{
+    Serial.println(">>> onSerialRxRecStart");
+    rxRecorderStart();
+}
+
+void onSerialRxRecStop(void)
+{
+    Serial.println(">>> onSerialRxRecStop");
+    rxRecorderStop();
+}
+
+void onSerialRxReplay(String args)
+{
+    Serial.printf(">>> onSerialRxReplay [%s]\r\n", args.c_str());
+    if (args.length() && !setSelfJsonFromFile(args))
+    {
+        return;
+    }
+
+    tRxReplayResult res;
+    if (!rxReplayRun(RX_REC_FNAME, res))
+    {
+        return;
+    }
+    Serial.printf("{\"frames\":%lu,\"ticks\":%lu,\"session_ms\":%lu,\"elapsed_ms\":%lu,\"start_health\":%d,\"end_health\":%d,\"min_health\":%d,\"max_health\":%d,\"hit\":%lld,\"heal\":%lld}\r\n",
+                  res.frames, res.ticks, res.sessionMs, res.elapsedMs, res.startHealth, res.endHealth, res.minHealth, res.maxHealth, res.hitPoints, res.healPoints);
+}
+
+void onSerialBench(String args)
+{
+    Serial.printf(">>> onSerialBench [%s]\r\n", args.c_str());
+    uint32_t iterations = args.length() ? args.toInt() : BENCH_DEF_ITERATIONS;
+    benchRunAll(iterations);
+}
+
+void onSerialEnergy(String args)
+{
+    Serial.printf(">>> onSerialEnergy [%s]\r\n", args.c_str());
+    if (args == "start")
+    {
+        energyProfStart();
+    }
+    else if (args == "stop")
+    {
+        energyProfStop();
+    }
+    else
+    {
+        energyProfPrint();
+    }
+}
+
+// tune <name> <value> sets one tunable until the server assigns a set, a
+// value that is not JSON is taken as a string (enum names)
+void onSerialTune(String args)
+{
+    Serial.printf(">>> onSerialTune [%s]\r\n", args.c_str());
+    int sp = args.indexOf(' ');
+    if (sp > 0)
+    {
+        String value = args.substring(sp + 1);
+        value.trim();
+        JsonDocument doc;
+        if (deserializeJson(doc, value))
+        {
+            doc.set(value);
+        }
+        tunableSet(args.substring(0, sp).c_str(), doc.as<JsonVariantConst>());
+    }
+    else if (args.length())
+    {
+        Serial.println("!!! onSerialTune ERROR: use tune <name> <value>");
+    }
+    tunablesPrint();
+}
+
+void onSerialLog(String args)
+{
+    Serial.printf(">>> onSerialLog [%s]\r\n", args.c_str());
+    int sp = args.indexOf(' ');
+    if (args.length() && ((sp < 0) || !logRingSetLevel(args.substring(0, sp), args.substring(sp + 1))))
+    {
+        Serial.println("!!! onSerialLog ERROR: use log <module> <level>");
+    }
+    logRingPrintLevels();
+}
+
+void onSerialJsonMem(void)
+{
+    Serial.println(">>> onSerialJsonMem");
+    jsonAllocPrint();
+}
+
+void onSerialTasks(void)
+{
+    Serial.println(">>> onSerialTasks");
+    taskRegistryPrint();
+}
+
+void onSerialLoopStats(String args)
+{
+    Serial.printf(">>> onSerialLoopStats [%s]\r\n", args.c_str());
+    if (args == "reset")
+    {
+        loopProfReset();
+    }
+    else
+    {
+        loopProfPrint();
+    }
+}
+
+void onSerialHitLatency(String args)
+{
+    Serial.printf(">>> onSerialHitLatency [%s]\r\n", args.c_str());
+    if (args == "on")
+    {
+        espHitStampEnable(true);
+    }
+    else if (args == "off")
+    {
+        espHitStampEnable(false);
+    }
+    else if (args == "reset")
+    {
+        espHitLatencyReset();
+    }
+    else
+    {
+        espHitLatencyPrint();
+    }
+}
+
+void onSerialGameLog(void)
+{
+    gameLogPrint();
+}
+
+void onSerialNeighborGraph(void)
+{
+    espNeighborGraphPrint();
+}
+
+// [files] [kb] [new] [nopsram] [noota], the numbers first
+void onSerialSyncBench(String args)
+{
+    Serial.printf(">>> onSerialSyncBench [%s]\r\n", args.c_str());
+    tSyncBenchCfg cfg;
+    int n = 0;
+    while (args.length())
+    {
+        int sp = args.indexOf(' ');
+        String word = (sp < 0) ? args : args.substring(0, sp);
+        args = (sp < 0) ? "" : args.substring(sp + 1);
+        args.trim();
+        if (word == "new")
+        {
+            cfg.reuse = false;
+        }
+        else if (word == "nopsram")
+        {
+            cfg.psram = false;
+        }
+        else if (word == "noota")
+        {
+            cfg.ota = false;
+        }
+        else if (n == 0)
+        {
+            cfg.files = word.toInt();
+            n++;
+        }
+        else if (n == 1)
+        {
+            cfg.sizeKb = word.toInt();
+            n++;
+        }
+    }
+    syncBenchRun(ConfigAPI::getServerUrl(csFile), ConfigAPI::getServerUrl(csOta), cfg);
+}
+
+void onSerialHttpPool(void)
+{
+    httpPoolPrint();
+}
+
+void onSerialMemMap(void)
+{
+    memMonPrint();
+}
+
+void onSerialWifiRoam(void)
+{
+    wifiRoamPrint();
+}
+
+void onSerialPingStats(void)
+{
+    espPingPrint();
+}
+
+void onSerialRxStream(String args)
+{
+    Serial.printf(">>> onSerialRxStream [%s]\r\n", args.c_str());
+    if (args == "on")
+    {
+        espRxStreamEnable(true);
+        return;
+    }
+    if (args == "off")
+    {
+        espRxStreamEnable(false);
+        return;
+    }
+    tEspRxStreamStats st;
+    espRxStreamGetStats(st);
+    Serial.printf(">>> RX STREAM: %s, %lu records, %lu dropped, ring high water %u of %u\r\n",
+                  espRxStreamActive() ? "on" : "off", st.records, st.dropped, st.highWater, ESP_RX_STREAM_RING);
+}
+
+// "send [file]": the operator side, the devices in range apply it and reboot
+void onSerialProv(String args)
+{
+    Serial.printf(">>> onSerialProv [%s]\r\n", args.c_str());
+    if (!args.startsWith("send"))
+    {
+        espProvPrint();
+        return;
+    }
+    String fName = args.substring(4);
+    fName.trim();
+    if (fName.length() == 0)
+    {
+        fName = ESP_PROV_FILE;
+    }
+    String json;
+    {
+        tFsHandle fs;
+        File file = fs.ok() ? LittleFS.open(fName, "r") : File();
+        if (!file)
+        {
+            Serial.printf("!!! onSerialProv ERROR: no %s\r\n", fName.c_str());
+            return;
+        }
+        json = file.readString();
+        file.close();
+    }
+    espProvSend(json.c_str(), json.length());
+}
+
+// Commander task, every pass: what the ring holds goes out at once
+void onSerialStreamPoll(void)
+{
+    static tEspRxStreamRec batch[ESP_RX_STREAM_BATCH];
+    static uint8_t frameSeq = 0;
+    if (!espRxStreamActive())
+    {
+        return;
+    }
+    int count;
+    while ((count = espRxStreamPop(batch, ESP_RX_STREAM_BATCH)) > 0)
+    {
+        tEspRxStreamStats st;
+        espRxStreamGetStats(st);
+        uint16_t n = (uint16_t)count;
+        serialBinBegin(sbRxStream | SERIAL_BIN_REPLY, frameSeq++);
+        serialBinWrite(&st.dropped, sizeof(st.dropped));
+        serialBinWrite(&n, sizeof(n));
+        serialBinWrite(batch, count * sizeof(tEspRxStreamRec));
+        serialBinEnd();
+    }
+}
+
+// A file missing on LittleFS keeps its PSRAM copy
+void onSerialValReload(void)
+{
+    refreshFileInPsram(VAL_FILE_NAME);
+    refreshFileInPsram(VAL_BIN_FILE_NAME);
+    Serial.printf(">>> onSerialValReload: %s\r\n", valReload() ? "staged" : "failed");
+}
+
+#if TFT_TEST_PATTERN
+void onSerialTestPattern(String args)
+{
+    Serial.printf(">>> onSerialTestPattern [%s]\r\n", args.c_str());
+    tftTestPattern(args == "bars");
+}
+#endif
+
+static void binDevices(uint8_t seq)
+{
+    static tNeighborRecord recs[MAX_REC_COUNT];
+    uint16_t count = copyScannedRecords(recs, MAX_REC_COUNT);
+    uint32_t nowMs = millis();
+    serialBinBegin(sbDevices | SERIAL_BIN_REPLY, seq);
+    serialBinWrite(&count, sizeof(count));
+    for (uint16_t i = 0; i < count; i++)
+    {
+        tSerialBinDevice d;
+        d.deviceID = recs[i].deviceID;
+        d.deviceRole = (uint8_t)recs[i].deviceRole;
+        d.zone = (uint8_t)recs[i].zone;
+        d.ageMs = nowMs - recs[i].lastReceivedMs;
+        d.rssi = recs[i].rssi;
+        d.rssiFiltered = recs[i].rssiFiltered;
+        d.rssiMin = recs[i].rssiMin;
+        d.rssiMax = recs[i].rssiMax;
+        d.rssiCount = recs[i].rssiCount;
+        d.pdrPct = recs[i].pdrPct;
+        d.lossBurst = recs[i].lossBurst;
+        serialBinWrite(&d, sizeof(d));
+    }
+    serialBinEnd();
+}
+
+static void binRadioStats(uint8_t seq)
+{
+    tEspChannelStats st;
+    espStatsGet(st);
+    tSerialBinRadioStats b;
+    b.txOk = st.txOk;
+    b.txFail = st.txFail;
+    b.rxFrames = st.rxFrames;
+    b.rxFps = st.rxFps;
+    b.rejLength = st.rejLength;
+    b.rejProtocol = st.rejProtocol;
+    b.rejCrc = st.rejCrc;
+    b.ringDropped = st.ringDropped;
+    b.ringCoalesced = st.ringCoalesced;
+    b.senders = st.senders;
+    b.jitterAvgMs = st.jitterAvgMs;
+    b.jitterMaxMs = st.jitterMaxMs;
+    memcpy(b.rssiHist, st.rssiHist, sizeof(b.rssiHist));
+    serialBinSend(sbRadioStats | SERIAL_BIN_REPLY, seq, &b, sizeof(b));
+}
+
+static void binFrame(uint8_t seq)
+{
+    const uint16_t *pix = tftFrameFront();
+    if (pix == NULL)
+    {
+        serialBinError(sbFrame, seq, "no framebuffer");
+        return;
+    }
+    uint16_t size[2] = {X_TFT_WIDTH, X_TFT_HEIGHT};
+    serialBinBegin(sbFrame | SERIAL_BIN_REPLY, seq);
+    serialBinWrite(size, sizeof(size));
+    // row by row, the frame is in PSRAM and the USB FIFO is small anyway
+    for (uint16_t y = 0; y < X_TFT_HEIGHT; y++)
+    {
+        serialBinWrite(&pix[(uint32_t)y * X_TFT_WIDTH], X_TFT_WIDTH * sizeof(uint16_t));
+    }
+    serialBinEnd();
+}
+
+static void binSnapshot(uint8_t seq)
+{
+    size_t len;
+    uint8_t *snap = tftSnapshotCapture(len);
+    if (snap == NULL)
+    {
+        serialBinError(sbSnapshot, seq, "no framebuffer");
+        return;
+    }
+    serialBinSend(sbSnapshot | SERIAL_BIN_REPLY, seq, snap, len);
+    free(snap);
+}
+
+void onSerialBinary(uint8_t type, uint8_t seq, const uint8_t *payload, uint16_t len)
+{
+    switch (type)
+    {
+    case sbDevices:
+        binDevices(seq);
+        break;
+    case sbRadioStats:
+        binRadioStats(seq);
+        break;
+    case sbBench:
+    {
+        uint32_t iterations = BENCH_DEF_ITERATIONS;
+        if (len >= sizeof(iterations))
+        {
+            memcpy(&iterations, payload, sizeof(iterations));
+        }
+        // built first, the bench logs as it goes and would land inside the frame
+        StreamString json;
+        benchRunAll(iterations, json);
+        serialBinSend(sbBench | SERIAL_BIN_REPLY, seq, json.c_str(), json.length());
+        break;
+    }
+    case sbFrame:
+        binFrame(seq);
+        break;
+    case sbSnapshot:
+        binSnapshot(seq);
+        break;
+    case sbRxStream:
+    {
+        uint8_t on = (len >= 1) ? payload[0] : 1;
+        espRxStreamEnable(on != 0);
+        serialBinSend(sbRxStream | SERIAL_BIN_REPLY, seq, &on, sizeof(on));
+        break;
+    }
+    default:
+        Serial.printf("!!! onSerialBinary ERROR: unknown type 0x%02X\r\n", type);
+        serialBinError(type, seq, "unknown type");
+        break;
+    }
+}
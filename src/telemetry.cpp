@@ -0,0 +1,81 @@
+#include <Arduino.h>
+
+#include "__main.h"
+#include "deviceRecords.h"
+#include "espStats.h"
+#include "gameRole.h"
+#include "telemetryFeed.h"
+
+#define TELEMETRY_NEIGHBORS     24      // strongest ones, the whole table does not fit an event
+
+static void fillRadio(tJsonWriter &json)
+{
+    tEspChannelStats st;
+    espStatsGet(st);
+    json.field("tx_ok", st.txOk);
+    json.field("tx_fail", st.txFail);
+    json.field("rx_frames", st.rxFrames);
+    json.field("rx_fps", (unsigned int)st.rxFps);
+    json.field("rej_length", st.rejLength);
+    json.field("rej_protocol", st.rejProtocol);
+    json.field("rej_crc", st.rejCrc);
+    json.field("ring_dropped", st.ringDropped);
+    json.field("senders", (unsigned int)st.senders);
+    json.field("jitter_avg_ms", (unsigned int)st.jitterAvgMs);
+    json.field("jitter_max_ms", (unsigned int)st.jitterMaxMs);
+}
+
+static void fillNeighbors(tJsonWriter &json)
+{
+    static tNeighborRecord recs[MAX_REC_COUNT];
+    uint16_t count = copyScannedRecords(recs, MAX_REC_COUNT);
+    uint32_t nowMs = millis();
+    json.field("count", (unsigned int)count);
+    json.beginArray("devices");
+    for (uint8_t n = 0; n < TELEMETRY_NEIGHBORS; n++)
+    {
+        int top = -1;
+        for (uint16_t i = 0; i < count; i++)
+        {
+            if ((recs[i].deviceID != 0) && ((top < 0) || (recs[i].rssiFiltered > recs[top].rssiFiltered)))
+            {
+                top = i;
+            }
+        }
+        if (top < 0)
+        {
+            break;
+        }
+        char id[17];
+        snprintf(id, sizeof(id), "%012llX", (unsigned long long)recs[top].deviceID);
+        json.beginObject();
+        json.field("id", id);
+        json.field("role", role2str(recs[top].deviceRole));
+        json.field("rssi", (int)recs[top].rssi);
+        json.field("rssi_filt", (int)recs[top].rssiFiltered);
+        json.field("zone", (int)recs[top].zone);
+        json.field("pdr", (unsigned int)recs[top].pdrPct);
+        json.field("loss_burst", (unsigned int)recs[top].lossBurst);
+        json.field("interval_ms", (unsigned int)recs[top].intervalMs);
+        json.field("age_s", (unsigned long)((nowMs - recs[top].lastReceivedMs) / 1000));
+        json.endObject();
+        recs[top].deviceID = 0;
+    }
+    json.endArray();
+}
+
+static void fillGame(tJsonWriter &json)
+{
+    tDeviceDataRecord *self = getSelfDataRecord();
+    json.field("role", role2str(self->deviceRole));
+    json.field("health", self->health);
+    json.field("max_health", self->maxHealth);
+    json.field("live_records", (unsigned int)getLiveRecordCount());
+}
+
+void telemetryBoot(void)
+{
+    telemetryAddSection("radio", fillRadio);
+    telemetryAddSection("neighbors", fillNeighbors);
+    telemetryAddSection("game", fillGame);
+}
@@ -21,6 +21,8 @@ extern void loopTFT(void);
 extern void jobNone(void);
 extern void jobServer(void);
 extern void startPlayerJob(void);
+extern void jobGateway(void);
+extern void jobLowPower(void);
 
 
 void onTouchBtn(void)
@@ -53,6 +55,10 @@ void initDevice(void)
 void setup(void)
 {
     Serial.begin(115200);
+#if (XBEACON_LOW_POWER)
+    // never returns, the panel and the rest of the board stay off
+    jobLowPower();
+#endif
     //waitG0();
     pinMode(PIN_POWER, OUTPUT);
     digitalWrite(PIN_POWER, HIGH);
@@ -65,6 +71,12 @@ void setup(void)
 
     Wire.begin(PIN_I2C_SDA, PIN_I2C_SCL, 4000000);
 
+#if (XBEACON_GATEWAY)
+    // never returns, beacons and forwards the player reports
+    tftPrintThreeLines("ESP-NOW", "GATEWAY", "", TFT_BLACK, TFT_GREEN);
+    prepareWiFi();
+    jobGateway();
+#endif
     prepareWiFi();
     espInitRxTx(grApPortalBeacon, false);
 
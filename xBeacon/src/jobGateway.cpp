@@ -0,0 +1,247 @@
+#include <Arduino.h>
+#include <WiFi.h>
+#include <HTTPClient.h>
+
+#include "espRadio.h"
+#include "espNeighbors.h"
+#include "wifiUtils.h"
+
+// ESP-NOW to WiFi gateway: collects the player reports the beacons carry
+// (see espGateway.h) and posts the fresh ones to the game server as one
+// batch every GW_BATCH_MS. Must sit on the ESP-NOW channel, so the venue AP
+// has to use the same one.
+
+#ifndef GW_WIFI_SSID
+#define GW_WIFI_SSID            "tcutestnet"
+#endif
+#ifndef GW_WIFI_PASS
+#define GW_WIFI_PASS            "tcutestpass"
+#endif
+#ifndef GW_SERVER_PORT
+#define GW_SERVER_PORT          5000    // game server, found by discovery
+#endif
+#define GW_BATCH_PATH           "/api/gateway"
+#define GW_BATCH_CT             "application/x-zgame-batch"
+#define GW_BATCH_MAGIC          0x4247  // "GB"
+#define GW_BATCH_VERSION        1
+#define GW_BATCH_MS             2000
+#define GW_BEACON_MS            50
+#define GW_MAX_PLAYERS          64
+#define GW_HTTP_TIMEOUT_MS      1500
+#define GW_RX_DRAIN             16
+
+// Batch body, little endian: this header, then count records, each followed
+// by its neighborCount tGwBinNeighbor
+struct __attribute__((packed)) tGwBinHeader
+{
+    uint16_t magic;
+    uint8_t  version;
+    uint8_t  count;
+    uint32_t seq;
+};
+
+struct __attribute__((packed)) tGwBinRecord
+{
+    uint32_t nameHash;
+    uint64_t deviceID;
+    uint16_t ageMs;             // since the gateway heard the report
+    uint8_t  role;              // tGameRole
+    int8_t   rssi;              // at the gateway
+    int16_t  health;
+    uint8_t  battery;
+    uint8_t  zCount;
+    uint8_t  hCount;
+    uint8_t  bCount;
+    uint8_t  neighborCount;
+};
+
+struct __attribute__((packed)) tGwBinNeighbor
+{
+    uint64_t id;
+    uint8_t  role;
+    int8_t   rssi;
+    uint8_t  zone;
+};
+
+struct tGwPlayer
+{
+    uint64_t   deviceID;
+    tGameRole  role;
+    int8_t     rssi;
+    uint32_t   heardMs;
+    bool       fresh;          // not forwarded yet
+    tEspReport report;
+};
+
+uint8_t wifiChannel = ESP_CHANNEL;     // espRadio's, the firmware's own in the game build
+
+static tGwPlayer players[GW_MAX_PLAYERS];
+static uint8_t playerCount = 0;
+static uint32_t gwDropped = 0;
+static portMUX_TYPE gwMux = portMUX_INITIALIZER_UNLOCKED;     // WiFi task and the gateway loop
+static uint8_t batchBuf[sizeof(tGwBinHeader) + GW_MAX_PLAYERS * (sizeof(tGwBinRecord) + ESP_REPORT_NEIGHBORS * sizeof(tGwBinNeighbor))];
+static tEspPacket gwPacket(grApPortalBeacon);
+static HTTPClient gwHttp;
+static String gwUrl;
+
+static void onReport(const tEspPacket &pkt, int rssi, const tEspReport &report)
+{
+    uint64_t deviceID = pkt.deviceID;
+    portENTER_CRITICAL(&gwMux);
+    int slot = -1;
+    for (int i = 0; i < playerCount; i++)
+    {
+        if (players[i].deviceID == deviceID)
+        {
+            slot = i;
+            break;
+        }
+    }
+    if ((slot < 0) && (playerCount < GW_MAX_PLAYERS))
+    {
+        slot = playerCount++;
+    }
+    if (slot >= 0)
+    {
+        tGwPlayer &p = players[slot];
+        p.deviceID = deviceID;
+        p.role = pkt.deviceRole;
+        p.rssi = (int8_t)constrain(rssi, -128, 127);
+        p.heardMs = millis();
+        p.fresh = true;
+        p.report = report;
+    }
+    else
+    {
+        gwDropped++;
+    }
+    portEXIT_CRITICAL(&gwMux);
+}
+
+// Takes the fresh reports, returns the body length (0: nothing new)
+static size_t buildBatch(uint32_t seq)
+{
+    tGwBinHeader hdr = {GW_BATCH_MAGIC, GW_BATCH_VERSION, 0, seq};
+    size_t n = sizeof(hdr);
+    uint32_t now = millis();
+    portENTER_CRITICAL(&gwMux);
+    for (int i = 0; i < playerCount; i++)
+    {
+        tGwPlayer &p = players[i];
+        if (!p.fresh)
+        {
+            continue;
+        }
+        p.fresh = false;
+        tGwBinRecord rec;
+        rec.nameHash = p.report.nameHash;
+        rec.deviceID = p.deviceID;
+        rec.ageMs = (uint16_t)min(now - p.heardMs, (uint32_t)0xFFFF);
+        rec.role = (uint8_t)p.role;
+        rec.rssi = p.rssi;
+        rec.health = p.report.health;
+        rec.battery = p.report.battery;
+        rec.zCount = p.report.zCount;
+        rec.hCount = p.report.hCount;
+        rec.bCount = p.report.bCount;
+        rec.neighborCount = p.report.neighborCount;
+        memcpy(batchBuf + n, &rec, sizeof(rec));
+        n += sizeof(rec);
+        for (int k = 0; k < rec.neighborCount; k++)
+        {
+            tGwBinNeighbor nb = {p.report.neighbors[k].id, p.report.neighbors[k].role,
+                                 p.report.neighbors[k].rssi, p.report.neighbors[k].zone};
+            memcpy(batchBuf + n, &nb, sizeof(nb));
+            n += sizeof(nb);
+        }
+        hdr.count++;
+    }
+    portEXIT_CRITICAL(&gwMux);
+    if (hdr.count == 0)
+    {
+        return 0;
+    }
+    memcpy(batchBuf, &hdr, sizeof(hdr));
+    return n;
+}
+
+static bool findServer(void)
+{
+    IPAddress ip;
+    if (!wifiGetDisco(ip))
+    {
+        return false;
+    }
+    gwUrl = "http://" + ip.toString() + ":" + String(GW_SERVER_PORT) + GW_BATCH_PATH;
+    Serial.printf(">>> gateway: forwarding to %s\r\n", gwUrl.c_str());
+    return true;
+}
+
+static void postBatch(void)
+{
+    static uint32_t seq = 0;
+    size_t len = buildBatch(seq + 1);
+    if (len == 0)
+    {
+        return;
+    }
+    seq++;
+    if ((gwUrl.length() == 0) && !findServer())
+    {
+        Serial.println("*** gateway WARNING! no game server, batch dropped");
+        return;
+    }
+    gwHttp.setReuse(true);
+    gwHttp.setTimeout(GW_HTTP_TIMEOUT_MS);
+    if (!gwHttp.begin(gwUrl))
+    {
+        return;
+    }
+    gwHttp.addHeader("Content-Type", GW_BATCH_CT);
+    uint32_t startMs = millis();
+    int code = gwHttp.POST(batchBuf, len);
+    if (code != HTTP_CODE_OK)
+    {
+        Serial.printf("!!! gateway ERROR: batch %u, HTTP %d\r\n", seq, code);
+        gwHttp.end();
+        gwUrl = "";     // discover again, the server may have moved
+        return;
+    }
+    gwHttp.getString();
+    Serial.printf(">>> gateway: batch %u, %u players, %u bytes, %u ms, %u dropped\r\n",
+                  seq, batchBuf[3], (unsigned)len, millis() - startMs, gwDropped);
+}
+
+void jobGateway(void)
+{
+    Serial.println(">>> jobGateway");
+    wifiInit(GW_WIFI_SSID, GW_WIFI_PASS, ESP_CHANNEL);
+    while (!wifiIsConnected())
+    {
+        Serial.printf(">>> gateway: Wi-Fi connection %s\r\n", GW_WIFI_SSID);
+        delay(1000);
+    }
+    espGatewayStart(onReport, ESP_GATEWAY_FLAG_FORWARD);
+    espNeighborsCollect();
+    espInitRxTx(&gwPacket, true);
+
+    tPacketRecord drain[GW_RX_DRAIN];
+    uint32_t lastBeaconMs = 0;
+    uint32_t lastBatchMs = millis();
+    while (true)
+    {
+        // the reports were taken in the RX callback, the frames are not needed
+        receivePacketBatch(drain, GW_RX_DRAIN, 0);
+        if (millis() - lastBeaconMs >= GW_BEACON_MS)
+        {
+            lastBeaconMs = millis();
+            sendEspPacket(&gwPacket);
+        }
+        if (millis() - lastBatchMs >= GW_BATCH_MS)
+        {
+            lastBatchMs = millis();
+            postBatch();
+        }
+        delay(1);
+    }
+}
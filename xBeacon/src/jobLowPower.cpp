@@ -0,0 +1,111 @@
+#include <Arduino.h>
+#include <WiFi.h>
+#include <esp_wifi.h>
+#include <esp_sleep.h>
+
+#include "espRadio.h"
+
+// TX-only beacon for static battery beacons (AP portal, zone markers): wakes
+// on the timer, sends one ESP-NOW frame and sleeps again, nothing else is
+// started. In deep sleep only RTC memory survives, the packet ID is kept
+// there so the receivers see one sender counting on; light sleep keeps RAM
+// and the WiFi driver, it wakes sooner for a little more current.
+
+#ifndef XBEACON_LP_INTERVAL_MS
+#define XBEACON_LP_INTERVAL_MS  1000    // between two frames
+#endif
+#ifndef XBEACON_LP_LIGHT_SLEEP
+#define XBEACON_LP_LIGHT_SLEEP  0       // 1: light sleep between frames, 0: deep sleep
+#endif
+#define XBEACON_LP_TX_WAIT_MS   20      // for the send callback before the radio goes down
+#define XBEACON_LP_STATUS_EVERY 60      // frames between two serial lines
+
+extern uint8_t wifiChannel;
+
+RTC_DATA_ATTR static uint64_t lpPacketId = 0;
+RTC_DATA_ATTR static uint32_t lpSent = 0;
+RTC_DATA_ATTR static uint32_t lpFailed = 0;
+
+static tEspPacket lpPacket(grApPortalBeacon);
+
+// Sent once the callback has counted it, ok or not, or once the wait is over
+static bool lpSendOne(void)
+{
+    tEspChannelStats before;
+    espStatsGet(before);
+    lpPacket.packetID = lpPacketId;
+    bool queued = sendEspPacket(&lpPacket);
+    lpPacketId = lpPacket.packetID;
+    if (!queued)
+    {
+        return false;
+    }
+    uint32_t startMs = millis();
+    tEspChannelStats now;
+    do
+    {
+        espStatsGet(now);
+        if (now.txOk + now.txFail != before.txOk + before.txFail)
+        {
+            return now.txOk != before.txOk;
+        }
+        delay(1);
+    } while (millis() - startMs < XBEACON_LP_TX_WAIT_MS);
+    return false;
+}
+
+static void lpRadioUp(void)
+{
+    WiFi.mode(WIFI_STA);
+    esp_wifi_set_channel(wifiChannel, WIFI_SECOND_CHAN_NONE);
+    if (esp_wifi_set_max_tx_power(WIFI_TX_POWER) != ESP_OK)
+    {
+        Serial.printf("!!! jobLowPower ERROR: esp_wifi_set_max_tx_power(%d)\r\n", WIFI_TX_POWER);
+    }
+    initRadio();
+    espStatsInit();
+}
+
+static void lpSleep(void)
+{
+    esp_sleep_enable_timer_wakeup((uint64_t)XBEACON_LP_INTERVAL_MS * 1000);
+    if (XBEACON_LP_LIGHT_SLEEP)
+    {
+        esp_wifi_stop();
+        esp_light_sleep_start();
+        esp_wifi_start();
+        esp_wifi_set_channel(wifiChannel, WIFI_SECOND_CHAN_NONE);
+        return;
+    }
+    esp_deep_sleep_start();
+}
+
+// Never returns
+void jobLowPower(void)
+{
+    bool firstBoot = (esp_sleep_get_wakeup_cause() != ESP_SLEEP_WAKEUP_TIMER);
+    if (firstBoot)
+    {
+        Serial.printf(">>> jobLowPower: one frame every %d ms, %s sleep\r\n", XBEACON_LP_INTERVAL_MS,
+                      XBEACON_LP_LIGHT_SLEEP ? "light" : "deep");
+    }
+    lpRadioUp();
+    while (true)
+    {
+        if (lpSendOne())
+        {
+            lpSent++;
+        }
+        else
+        {
+            lpFailed++;
+        }
+        if (firstBoot || ((lpSent + lpFailed) % XBEACON_LP_STATUS_EVERY == 0))
+        {
+            Serial.printf(">>> jobLowPower: packet %llu, %lu sent, %lu failed\r\n", lpPacketId, lpSent, lpFailed);
+            Serial.flush();
+        }
+        firstBoot = false;
+        lpSleep();
+    }
+}
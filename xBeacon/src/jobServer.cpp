@@ -4,6 +4,8 @@
 #include "tft_utils.h"
 #include "zgConfig.h"
 #include "wifiUtils.h"
+#include "telemetryFeed.h"
+#include "fsWorker.h"
 
 #include "AsyncTCP.h"
 #include "ESPAsyncWebServer.h"
@@ -30,7 +32,6 @@ uint32_t lastServerUpdatedMs = 0;
 bool wasWiFiConnected = false;
 
 tWebServer *webServer;
-AsyncEventSource events("/events");
 
 void serverUpdateTft(void)
 {
@@ -81,12 +82,6 @@ void wifiConnect(void)
     mdnsInit();
 }
 
-void webLoop(void)
-{
-    events.send(String(millis()).c_str(), "plisttxt", millis());
-}
-
-
 void jobServer(void)
 {
     if (!valPlayerInit())
@@ -104,7 +99,6 @@ void jobServer(void)
     while(true)
     {
         serverUpdateTft();
-        webLoop();
         delay(WEB_LOOP_PERIOD_MS);
     }
 }
@@ -130,16 +124,23 @@ void tWebServer::init(void)
     //         request->send_P(200, "text/html", index_html, processor);        
     // });
 
-    serveStatic("/", SPIFFS, "/").setDefaultFile("index.htm");
-    on("/start.html", HTTP_GET, [](AsyncWebServerRequest *request){request->send(SPIFFS, "/start.html", "text/html"); });
+    // static files come through onNotFoundHandler, read on the fs worker
+    fsWorkerStart();
+    on("/start.html", HTTP_GET, [](AsyncWebServerRequest *request){fsSendFile(request, SPIFFS, "/start.html"); });
 
     onNotFound(onNotFoundHandler);
-    addHandler(&events);
+    telemetryAttach(*this);
     begin();
 }
 
 void tWebServer::onNotFoundHandler(AsyncWebServerRequest *request)
 {
+    if (request->method() == HTTP_GET)
+    {
+        String path = request->url();
+        fsSendFile(request, SPIFFS, path.endsWith("/") ? path + "index.htm" : path);
+        return;
+    }
     Serial.println("Web not found:");
     Serial.println(request->methodToString());
     Serial.println(request->url());    
@@ -163,7 +164,7 @@ void tWebServer::processGetReq(AsyncWebServerRequest *request)
     if (reqString == "start")
     {
         Serial.println(">>>START");
-        request->send(SPIFFS, "/start.html", "text/html");
+        fsSendFile(request, SPIFFS, "/start.html");
     }
 
     Serial.flush();